@@ -32,6 +32,7 @@
 #include <chrono>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -328,6 +329,75 @@ bool AuditImpl::configure() {
     return true;
 }
 
+EventRing& AuditImpl::getThreadRing() {
+    static thread_local cb::ThreadRingRegistry<EventRing>::Handle threadRing;
+
+    auto* ring = threadRing.get(eventRings);
+    if (ring == nullptr) {
+        ring = &eventRings.add(threadRing);
+    }
+    return *ring;
+}
+
+void AuditImpl::wakeConsumer() {
+    if (consumer_sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> guard(producer_consumer_lock);
+        events_arrived.notify_all();
+    }
+}
+
+bool AuditImpl::hasQueuedEvents() {
+    bool queued = false;
+    eventRings.forEach([&queued](const EventRing& ring) {
+        queued = queued || !ring.empty();
+    });
+    return queued;
+}
+
+size_t AuditImpl::drainEventRings() {
+    const auto rings = eventRings.getRings();
+
+    // Merge the rings by sequence number. Only drain the events submitted
+    // before we started, so busy producers can't keep us here forever.
+    const auto end = next_sequence.load();
+    using Head = std::pair<uint64_t, EventRing*>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    auto addHead = [&heads, end](EventRing& ring) {
+        const auto* event = ring.front();
+        if (event && event->seqno < end) {
+            heads.emplace(event->seqno, &ring);
+        }
+    };
+    for (const auto& entry : rings) {
+        addHead(entry->ring);
+    }
+
+    size_t count = 0;
+    while (!heads.empty()) {
+        auto& ring = *heads.top().second;
+        heads.pop();
+        const auto& event = *ring.front();
+        try {
+            Event ev(event.id, {event.payload.data(), event.payload.size()});
+            if (!ev.process(*this)) {
+                dropped_events++;
+            }
+        } catch (const std::exception& e) {
+            dropped_events++;
+            LOG_WARNING("Audit: Failed to process audit event {}: {}",
+                        event.id,
+                        e.what());
+        }
+        ring.pop();
+        ++count;
+        addHead(ring);
+    }
+    queued_events -= count;
+
+    eventRings.reap();
+    return count;
+}
+
 bool AuditImpl::put_event(uint32_t event_id, cb::const_char_buffer payload) {
     if (!config.is_auditd_enabled()) {
         // Audit is disabled
@@ -339,16 +409,20 @@ bool AuditImpl::put_event(uint32_t event_id, cb::const_char_buffer payload) {
     //       in the correct fields.. if not we should add an
     //       event to the audit trail saying it is one in an illegal
     //       format (or missing fields)
-    try {
-        auto new_event = std::make_unique<Event>(event_id, payload);
-        std::lock_guard<std::mutex> guard(producer_consumer_lock);
-        if (filleventqueue.size() < max_audit_queue) {
-            filleventqueue.push(std::move(new_event));
-            events_arrived.notify_all();
+    //
+    // The caller may be a front end thread, so don't wait for the consumer
+    // to catch up if the queue is full
+    if (queued_events.fetch_add(1) < max_audit_queue) {
+        try {
+            getThreadRing().push(event_id, payload, next_sequence);
+            wakeConsumer();
             return true;
+        } catch (const std::bad_alloc&) {
         }
-    } catch (const std::bad_alloc&) {
+    } else {
+        queue_full++;
     }
+    queued_events--;
 
     dropped_events++;
     LOG_WARNING("Audit: Dropping audit event {}: {}",
@@ -393,55 +467,86 @@ void AuditImpl::notify_io_complete(gsl::not_null<const void*> cookie,
 
 void AuditImpl::stats(const AddStatFn& add_stats,
                       gsl::not_null<const void*> cookie) {
-    const auto* enabled = config.is_auditd_enabled() ? "true" : "false";
-    add_stats("enabled",
-              (uint16_t)strlen("enabled"),
-              enabled,
-              (uint32_t)strlen(enabled),
-              cookie.get());
-    const auto num_of_dropped_events = std::to_string(dropped_events);
-    add_stats("dropped_events",
-              (uint16_t)strlen("dropped_events"),
-              num_of_dropped_events.data(),
-              (uint32_t)num_of_dropped_events.length(),
-              cookie.get());
+    auto add_stat = [&add_stats, &cookie](const char* key,
+                                          const std::string& value) {
+        add_stats(key,
+                  (uint16_t)strlen(key),
+                  value.data(),
+                  (uint32_t)value.length(),
+                  cookie.get());
+    };
+
+    add_stat("enabled", config.is_auditd_enabled() ? "true" : "false");
+    add_stat("dropped_events", std::to_string(dropped_events));
+
+    add_stat("queued_events", std::to_string(queued_events));
+    add_stat("queue_full", std::to_string(queue_full));
+    add_stat("write_batches", std::to_string(write_batches));
 }
 
 void AuditImpl::consume_events() {
-    std::unique_lock<std::mutex> lock(producer_consumer_lock);
-    // Tell the main thread that we're up and running
-    events_arrived.notify_one();
-
-    while (!stop_audit_consumer) {
-        if (filleventqueue.empty()) {
-            events_arrived.wait_for(
-                    lock,
-                    std::chrono::seconds(auditfile.get_seconds_to_rotation()));
-            if (filleventqueue.empty()) {
-                // We timed out, so just rotate the files
-                if (auditfile.maybe_rotate_files()) {
-                    // If the file was rotated then we need to open a new
-                    // audit.log file.
-                    auditfile.ensure_open();
+    {
+        std::lock_guard<std::mutex> guard(producer_consumer_lock);
+        // Tell the main thread that we're up and running
+        events_arrived.notify_one();
+    }
+
+    bool stop = false;
+    while (!stop) {
+        {
+            std::unique_lock<std::mutex> lock(producer_consumer_lock);
+            if (!stop_audit_consumer && filleventqueue.empty() &&
+                !hasQueuedEvents()) {
+                // Tell the producers that they need to notify us, and
+                // check again for events which was queued before they
+                // could see the flag
+                consumer_sleeping.store(true, std::memory_order_seq_cst);
+                if (!hasQueuedEvents()) {
+                    events_arrived.wait_for(
+                            lock,
+                            std::chrono::seconds(
+                                    auditfile.get_seconds_to_rotation()));
+                }
+                consumer_sleeping.store(false, std::memory_order_seq_cst);
+
+                if (!stop_audit_consumer && filleventqueue.empty() &&
+                    !hasQueuedEvents()) {
+                    // We timed out, so just rotate the files
+                    if (auditfile.maybe_rotate_files()) {
+                        // If the file was rotated then we need to open a
+                        // new audit.log file.
+                        auditfile.ensure_open();
+                    }
+                    continue;
                 }
             }
+            processeventqueue.swap(filleventqueue);
+            stop = stop_audit_consumer;
         }
-        /* now have producer_consumer lock!
-         * event(s) have arrived or shutdown requested
-         */
-        processeventqueue.swap(filleventqueue);
-        lock.unlock();
         // Now outside of the producer_consumer_lock
 
+        // Write all of the events queued so far as a single batch, and
+        // flush the file once for the entire batch
+        auto count = drainEventRings();
         while (!processeventqueue.empty()) {
             auto& event = processeventqueue.front();
             if (!event->process(*this)) {
                 dropped_events++;
             }
             processeventqueue.pop();
+            ++count;
         }
+
+        if (count) {
+            auditfile.flush();
+            write_batches++;
+        }
+    }
+
+    // Write the events queued before we was asked to stop
+    if (drainEventRings()) {
         auditfile.flush();
-        lock.lock();
+        write_batches++;
     }
 
     // close the auditfile
@@ -20,9 +20,11 @@
 #include "auditfile.h"
 #include "event.h"
 #include "eventdescriptor.h"
+#include "eventring.h"
 
 #include <memcached/audit_interface.h>
 #include <platform/platform_thread.h>
+#include <utilities/thread_ring_registry.h>
 
 #include <atomic>
 #include <cinttypes>
@@ -31,6 +33,7 @@
 #include <mutex>
 #include <queue>
 #include <unordered_map>
+#include <vector>
 
 class AuditImpl : public cb::audit::Audit {
 public:
@@ -103,6 +106,22 @@ protected:
      */
     void create_audit_event(uint32_t event_id, nlohmann::json& payload);
 
+    /// Get (and create on first use) the event ring owned by the calling
+    /// thread
+    EventRing& getThreadRing();
+
+    /// Wake up the consumer thread if it is waiting for events
+    void wakeConsumer();
+
+    /// Check if any of the event rings contains events
+    bool hasQueuedEvents();
+
+    /// Process all of the events currently queued in the event rings (in
+    /// the order they were submitted), and free the rings of the threads
+    /// which have exited
+    /// @return the number of events processed
+    size_t drainEventRings();
+
     void notify_event_state_changed(uint32_t id, bool enabled) const;
     struct {
         mutable std::mutex mutex;
@@ -127,9 +146,27 @@ protected:
     /// The consumer should run until this flag is set to true
     bool stop_audit_consumer = {false};
 
-    // We maintain two Event queues. At any one time one will be used to accept
-    // new events, and the other will be processed. The two queues are swapped
-    // periodically.
+    /**
+     * The events submitted through put_event are pre-serialized into a
+     * ring buffer owned by the submitting thread (and drained by the
+     * consumer in batches). A ring is released once it is drained after
+     * its thread exited.
+     */
+    cb::ThreadRingRegistry<EventRing> eventRings;
+
+    /// The sequence number of the next event submitted to the rings
+    std::atomic<uint64_t> next_sequence{0};
+
+    /// The number of events queued in all of the rings
+    std::atomic<size_t> queued_events{0};
+
+    /// Set by the consumer thread while it is waiting for events (so that
+    /// the producers only signal the condition variable when needed)
+    std::atomic<bool> consumer_sleeping{false};
+
+    // ConfigureEvents are rare and go through a mutex protected queue.
+    // At any one time one will be used to accept new events, and the other
+    // will be processed. The two queues are swapped periodically.
     std::queue<std::unique_ptr<Event>> processeventqueue;
     std::queue<std::unique_ptr<Event>> filleventqueue;
     std::condition_variable events_arrived;
@@ -138,11 +175,19 @@ protected:
     /// The number of events currently dropped.
     std::atomic<uint32_t> dropped_events = {0};
 
+    /// The number of events dropped because max_audit_queue events were
+    /// already queued
+    std::atomic<uint64_t> queue_full = {0};
+
+    /// The number of batches written (and flushed) by the consumer
+    std::atomic<uint64_t> write_batches = {0};
+
     ServerCookieIface* cookie_api;
 
     /// The hostname we want to inject to the audit events
     const std::string hostname;
 
 private:
+    /// The number of events which may be queued (by all threads)
     const size_t max_audit_queue = 50000;
 };
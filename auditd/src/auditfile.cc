@@ -118,6 +118,7 @@ bool AuditFile::open() {
 
 void AuditFile::close_and_rotate_log() {
     cb_assert(file);
+    write_buffer_to_file();
     file.reset();
     if (current_size == 0) {
         remove(open_file_name.c_str());
@@ -226,13 +227,15 @@ bool AuditFile::write_event_to_disk(nlohmann::json& output) {
     bool ret = true;
     try {
         const auto content = output.dump();
-        current_size += fprintf(file.get(), "%s\n", content.c_str());
-        if (ferror(file.get())) {
-            LOG_WARNING("Audit: writing to disk error: {}", cb_strerror());
+        write_buffer.append(content);
+        write_buffer.push_back('\n');
+        current_size += content.size() + 1;
+        if (!buffered) {
+            ret = flush();
+        } else if (write_buffer.size() >= write_buffer_size &&
+                   !write_buffer_to_file()) {
             ret = false;
             close_and_rotate_log();
-        } else if (!buffered) {
-            ret = flush();
         }
     } catch (const std::bad_alloc&) {
         LOG_WARNING(
@@ -245,6 +248,21 @@ bool AuditFile::write_event_to_disk(nlohmann::json& output) {
     return ret;
 }
 
+bool AuditFile::write_buffer_to_file() {
+    if (write_buffer.empty()) {
+        return true;
+    }
+
+    const auto nw =
+            fwrite(write_buffer.data(), 1, write_buffer.size(), file.get());
+    const bool success = nw == write_buffer.size() && !ferror(file.get());
+    // Keep the allocated memory for the next batch
+    write_buffer.clear();
+    if (!success) {
+        LOG_WARNING("Audit: writing to disk error: {}", cb_strerror());
+    }
+    return success;
+}
 
 void AuditFile::set_log_directory(const std::string &new_directory) {
     if (log_directory == new_directory) {
@@ -277,6 +295,10 @@ void AuditFile::reconfigure(const AuditConfig &config) {
 
 bool AuditFile::flush() {
     if (is_open()) {
+        if (!write_buffer_to_file()) {
+            close_and_rotate_log();
+            return false;
+        }
         if (fflush(file.get()) != 0) {
             LOG_WARNING("Audit: writing to disk error: {}", cb_strerror());
             close_and_rotate_log();
@@ -61,7 +61,10 @@ public:
     void cleanup_old_logfile(const std::string& log_path);
 
     /**
-     * Write a json formatted object to the disk
+     * Write a json formatted object to the disk. The event is added to
+     * an internal buffer which is written to the file when it is full,
+     * when the file is flushed or closed (unless running in unbuffered
+     * mode where every event gets flushed).
      *
      * @param output the data to write
      * @return true if success, false otherwise
@@ -82,7 +85,8 @@ public:
     void reconfigure(const AuditConfig &config);
 
     /**
-     * Flush the buffers to the disk
+     * Write all of the buffered events to the file, and flush the buffers
+     * to the disk
      */
     bool flush();
 
@@ -93,6 +97,7 @@ public:
 
 private:
     bool open();
+    bool write_buffer_to_file();
     bool time_to_rotate_log() const;
     void close_and_rotate_log();
     void set_log_directory(const std::string &new_directory);
@@ -119,5 +124,10 @@ private:
     size_t max_log_size = 20 * 1024 * 1024;
     uint32_t rotate_interval = 900;
     bool buffered = true;
+
+    /// Events written, but not yet passed on to the file
+    std::string write_buffer;
+    /// The number of bytes to buffer before writing them to the file
+    static const size_t write_buffer_size = 64 * 1024;
 };
 
@@ -0,0 +1,186 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/sized_buffer.h>
+
+#include <atomic>
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+/**
+ * EventRing is an unbounded single producer / single consumer queue of
+ * (already serialized) audit events.
+ *
+ * Every thread submitting audit events owns its own ring, so the
+ * producers never contend with each other, and the only synchronization
+ * with the consumer is the head and tail counters. The events are stored
+ * in blocks of slots: the producer links in a new block when the current
+ * one is full, and the consumer hands the blocks it has drained back to
+ * the producer (keeping one spare). Once a slot's string has grown big
+ * enough the producer copies the payload without allocating any memory.
+ * The caller bounds the number of queued events.
+ *
+ * Each event is stamped with a sequence number as it is published, so
+ * that the consumer can merge the rings of all of the threads in the
+ * order the events were submitted.
+ */
+class EventRing {
+public:
+    struct Event {
+        uint64_t seqno = 0;
+        uint32_t id = 0;
+        std::string payload;
+    };
+
+    /**
+     * @param blockSize the number of events in each block of the ring
+     */
+    explicit EventRing(size_t blockSize = 256)
+        : blockSize(blockSize),
+          headBlock(new Block(blockSize)),
+          tailBlock(headBlock) {
+    }
+
+    EventRing(const EventRing&) = delete;
+
+    ~EventRing() {
+        while (headBlock) {
+            auto* next = headBlock->next.load(std::memory_order_acquire);
+            delete headBlock;
+            headBlock = next;
+        }
+        delete spare.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Add an event to the ring (may only be called by the owning thread)
+     *
+     * @param id the event identifier
+     * @param payload the serialized event
+     * @param sequence the counter to take the event's sequence number from
+     * @throws std::bad_alloc if a new block is needed and can't be allocated
+     */
+    void push(uint32_t id,
+              cb::const_char_buffer payload,
+              std::atomic<uint64_t>& sequence) {
+        if (tailIndex == blockSize) {
+            auto* block = spare.exchange(nullptr, std::memory_order_acquire);
+            if (block == nullptr) {
+                block = new Block(blockSize);
+            } else {
+                block->next.store(nullptr, std::memory_order_relaxed);
+            }
+            tailBlock->next.store(block, std::memory_order_release);
+            tailBlock = block;
+            tailIndex = 0;
+        }
+        auto& slot = tailBlock->slots[tailIndex++];
+        slot.id = id;
+        slot.payload.assign(payload.data(), payload.size());
+        slot.seqno = sequence.fetch_add(1);
+        // seq_cst so that the publication is ordered before the producer
+        // looks if it needs to wake the consumer
+        tail.store(tail.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_seq_cst);
+    }
+
+    /**
+     * Get the oldest event in the ring (may only be called by the consumer
+     * thread)
+     *
+     * @return the event, or nullptr if the ring is empty
+     */
+    const Event* front() {
+        if (head.load(std::memory_order_relaxed) ==
+            tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        if (headIndex == blockSize) {
+            // The producer linked in the next block before it published
+            // the event
+            auto* drained = headBlock;
+            headBlock = drained->next.load(std::memory_order_acquire);
+            headIndex = 0;
+            delete spare.exchange(drained, std::memory_order_acq_rel);
+        }
+        return &headBlock->slots[headIndex];
+    }
+
+    /// Remove the event returned by front() (consumer only)
+    void pop() {
+        ++headIndex;
+        head.store(head.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    /**
+     * Pass all of the events currently in the ring to the callback
+     * (may only be called by the consumer thread)
+     *
+     * @param callback function called with the id and payload of each event
+     * @return the number of events drained
+     */
+    template <typename Callback>
+    size_t drain(Callback&& callback) {
+        const auto count = size();
+        for (size_t ii = 0; ii < count; ++ii) {
+            const auto* event = front();
+            callback(event->id, event->payload);
+            pop();
+        }
+        return count;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_seq_cst) ==
+               tail.load(std::memory_order_seq_cst);
+    }
+
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) -
+               head.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Block {
+        explicit Block(size_t size) : slots(size) {
+        }
+        std::vector<Event> slots;
+        std::atomic<Block*> next{nullptr};
+    };
+
+    const size_t blockSize;
+
+    /// The block (and slot in it) holding the next event to consume (only
+    /// used by the consumer)
+    Block* headBlock;
+    size_t headIndex = 0;
+
+    /// The block (and slot in it) to fill next (only used by the producer)
+    Block* tailBlock;
+    size_t tailIndex = 0;
+
+    /// A drained block handed back to the producer for reuse
+    std::atomic<Block*> spare{nullptr};
+
+    /// The number of events consumed (written by the consumer)
+    alignas(64) std::atomic<size_t> head{0};
+    /// The number of events published (written by the producer)
+    alignas(64) std::atomic<size_t> tail{0};
+};
@@ -0,0 +1,106 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "eventring.h"
+
+#include <folly/portability/GTest.h>
+#include <thread>
+
+TEST(EventRingTest, GrowsWhenBlockIsFull) {
+    EventRing ring(3);
+    std::atomic<uint64_t> sequence{0};
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(nullptr, ring.front());
+    const std::string payload = "{}";
+    for (uint32_t ii = 0; ii < 10; ++ii) {
+        ring.push(ii, payload, sequence);
+    }
+    EXPECT_EQ(10, ring.size());
+    EXPECT_EQ(10, sequence);
+
+    for (uint32_t ii = 0; ii < 10; ++ii) {
+        const auto* event = ring.front();
+        ASSERT_NE(nullptr, event);
+        EXPECT_EQ(ii, event->id);
+        EXPECT_EQ(ii, event->seqno);
+        EXPECT_EQ(payload, event->payload);
+        ring.pop();
+    }
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(nullptr, ring.front());
+}
+
+TEST(EventRingTest, DrainInOrder) {
+    EventRing ring(4);
+    std::atomic<uint64_t> sequence{0};
+    uint32_t next = 0;
+    // Run multiple rounds to make sure that the blocks are reused
+    for (int round = 0; round < 3; ++round) {
+        for (uint32_t ii = 0; ii < 3; ++ii) {
+            const auto payload = std::to_string(round * 3 + ii);
+            ring.push(round * 3 + ii, payload, sequence);
+        }
+        EXPECT_EQ(3, ring.drain([&next](uint32_t id, const std::string& p) {
+            EXPECT_EQ(next, id);
+            EXPECT_EQ(std::to_string(next), p);
+            ++next;
+        }));
+        EXPECT_TRUE(ring.empty());
+    }
+}
+
+// The sequence numbers tell the order the events were pushed across rings
+TEST(EventRingTest, SequenceIsSharedBetweenRings) {
+    EventRing first;
+    EventRing second;
+    std::atomic<uint64_t> sequence{0};
+    first.push(1, "a", sequence);
+    second.push(2, "b", sequence);
+    first.push(3, "c", sequence);
+    EXPECT_EQ(0, first.front()->seqno);
+    EXPECT_EQ(1, second.front()->seqno);
+    first.pop();
+    EXPECT_EQ(2, first.front()->seqno);
+}
+
+TEST(EventRingTest, ConcurrentProducerConsumer) {
+    EventRing ring(16);
+    std::atomic<uint64_t> sequence{0};
+    const uint32_t total = 100000;
+
+    std::thread producer([&ring, &sequence, total]() {
+        const std::string payload = "payload";
+        for (uint32_t ii = 0; ii < total; ++ii) {
+            ring.push(ii, payload, sequence);
+            if (ring.size() > 64) {
+                // Don't let the ring grow without bounds
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t next = 0;
+    while (next < total) {
+        ring.drain([&next](uint32_t id, const std::string& payload) {
+            EXPECT_EQ(next, id);
+            EXPECT_EQ("payload", payload);
+            ++next;
+        });
+    }
+    producer.join();
+    EXPECT_TRUE(ring.empty());
+}
@@ -236,6 +236,22 @@ TEST_F(UserTest, TestNoSha1) {
     EXPECT_NO_THROW(u.getPassword(Mechanism::PLAIN));
 }
 
+TEST_F(UserTest, ScramKeysDerivedAtLoad) {
+    using namespace cb::sasl;
+    auto u = pwdb::UserFactory::create(root);
+
+    const auto& md = u.getPassword(Mechanism::SCRAM_SHA1);
+    const auto algo = cb::crypto::Algorithm::SHA1;
+    EXPECT_EQ(cb::crypto::digest(
+                      algo,
+                      cb::crypto::HMAC(algo, md.getPassword(), "Client Key")),
+              md.getStoredKey());
+    EXPECT_EQ(cb::crypto::HMAC(algo, md.getPassword(), "Server Key"),
+              md.getServerKey());
+
+    EXPECT_TRUE(u.getPassword(Mechanism::PLAIN).getStoredKey().empty());
+}
+
 TEST_F(UserTest, InvalidLabel) {
     root["gssapi"] = "foo";
     EXPECT_THROW(auto u = cb::sasl::pwdb::UserFactory::create(root),
@@ -260,6 +276,8 @@ TEST_F(UserTest, CreateDummy) {
             "ZLBvongMC+gVSc8JsnCmK8CE+KJrCdS/8fT4cvb3IkJJGTgaGQ+HGuQaXKTN9829l/"
             "8eoUUpiI2Cyk/CRnULtw==",
             meta.getSalt());
+    EXPECT_EQ(cb::crypto::SHA512_DIGEST_SIZE, meta.getStoredKey().size());
+    EXPECT_EQ(cb::crypto::SHA512_DIGEST_SIZE, meta.getServerKey().size());
 }
 
 class PasswordDatabaseTest : public ::testing::Test {
@@ -447,22 +447,49 @@ std::pair<Error, const_char_buffer> ServerBackend::step(
     auto idx = client_final_message.find(",p=");
     client_final_message_without_proof = client_final_message.substr(0, idx);
 
-    // Generate the server signature
+    // Verify the proof by using the StoredKey and ServerKey cached in the
+    // user entry (RFC 5802 section 3):
+    //
+    //   ClientSignature := HMAC(StoredKey, AuthMessage)
+    //   ClientKey       := ClientProof XOR ClientSignature
+    //   H(ClientKey) must be equal to StoredKey
+    //   ServerSignature := HMAC(ServerKey, AuthMessage)
+    const auto& passwordMeta = user.getPassword(mechanism);
+    const auto authMessage = getAuthMessage();
 
     std::stringstream out;
-
-    auto serverSignature = getServerSignature();
-    addAttribute(out, 'v', serverSignature, false);
+    addAttribute(out,
+                 'v',
+                 cb::crypto::HMAC(
+                         algorithm, passwordMeta.getServerKey(), authMessage),
+                 false);
     server_final_message = out.str();
 
-    std::string clientproof = iter->second;
-    std::string my_clientproof = Couchbase::Base64::encode(getClientProof());
+    std::string clientproof;
+    try {
+        clientproof = Couchbase::Base64::decode(iter->second);
+    } catch (const std::exception&) {
+        // Treated as an incorrect proof (the size won't match)
+    }
+
+    const auto& storedKey = passwordMeta.getStoredKey();
+    bool match = false;
+    if (clientproof.size() == storedKey.size()) {
+        const auto clientSignature =
+                cb::crypto::HMAC(algorithm, storedKey, authMessage);
+        std::string clientKey;
+        clientKey.resize(clientproof.size());
+        for (std::size_t ii = 0; ii < clientKey.size(); ++ii) {
+            clientKey[ii] = clientproof[ii] ^ clientSignature[ii];
+        }
+        const auto key = cb::crypto::digest(algorithm, clientKey);
+        match = cbsasl_secure_compare(key.data(),
+                                      key.size(),
+                                      storedKey.data(),
+                                      storedKey.size()) == 0;
+    }
 
-    int fail = cbsasl_secure_compare(clientproof.c_str(),
-                                     clientproof.length(),
-                                     my_clientproof.c_str(),
-                                     my_clientproof.length()) ^
-               gsl::narrow_cast<int>(user.isDummy());
+    const int fail = (match ? 0 : 1) | gsl::narrow_cast<int>(user.isDummy());
 
     if (fail != 0) {
         if (user.isDummy()) {
@@ -115,35 +115,28 @@ User UserFactory::create(const std::string& unm, const std::string& passwd) {
 User UserFactory::createDummy(const std::string& unm, const Mechanism& mech) {
     User ret{unm};
 
-    // Generate a random password
-    std::vector<uint8_t> salt;
-    std::string passwd;
-
-    switch (mech) {
-    case Mechanism::SCRAM_SHA512:
-        salt.resize(cb::crypto::SHA512_DIGEST_SIZE);
-        break;
-    case Mechanism::SCRAM_SHA256:
-        salt.resize(cb::crypto::SHA256_DIGEST_SIZE);
-        break;
-    case Mechanism::SCRAM_SHA1:
-        salt.resize(cb::crypto::SHA1_DIGEST_SIZE);
-        break;
-    case Mechanism::PLAIN:
-        throw std::logic_error(
-                "cb::cbsasl::UserFactory::createDummy invalid algorithm");
-    }
-
-    if (salt.empty()) {
+    if (mech == Mechanism::PLAIN) {
         throw std::logic_error(
                 "cb::cbsasl::UserFactory::createDummy invalid algorithm");
     }
 
-    generateSalt(salt, passwd);
+    // A dummy user never authenticates, so there is no password to
+    // generate the secrets from (generateSecrets uses random keys)
+    ret.generateSecrets(mech, {});
 
-    // Generate the secrets by using that random password
-    ret.generateSecrets(mech, passwd);
+    return ret;
+}
 
+/**
+ * Create the password metadata for one of the SCRAM mechanisms from the
+ * JSON in the password database, and derive its keys
+ */
+static User::PasswordMetaData createScramMetaData(
+        const nlohmann::json& obj, cb::crypto::Algorithm algorithm) {
+    User::PasswordMetaData ret(obj);
+    if (cb::crypto::isSupported(algorithm)) {
+        ret.deriveScramKeys(algorithm);
+    }
     return ret;
 }
 
@@ -174,14 +167,14 @@ User UserFactory::create(const nlohmann::json& obj) {
         if (label == "n") {
             // skip. we've already processed this
         } else if (label == "sha512") {
-            User::PasswordMetaData pd(it.value());
-            ret.password[Mechanism::SCRAM_SHA512] = pd;
+            ret.password[Mechanism::SCRAM_SHA512] = createScramMetaData(
+                    it.value(), cb::crypto::Algorithm::SHA512);
         } else if (label == "sha256") {
-            User::PasswordMetaData pd(it.value());
-            ret.password[Mechanism::SCRAM_SHA256] = pd;
+            ret.password[Mechanism::SCRAM_SHA256] = createScramMetaData(
+                    it.value(), cb::crypto::Algorithm::SHA256);
         } else if (label == "sha1") {
-            User::PasswordMetaData pd(it.value());
-            ret.password[Mechanism::SCRAM_SHA1] = pd;
+            ret.password[Mechanism::SCRAM_SHA1] = createScramMetaData(
+                    it.value(), cb::crypto::Algorithm::SHA1);
         } else if (label == "plain") {
             User::PasswordMetaData pd(Couchbase::Base64::decode(it.value()));
             ret.password[Mechanism::PLAIN] = pd;
@@ -279,13 +272,36 @@ void User::generateSecrets(const Mechanism& mech, const std::string& passwd) {
         generateSalt(salt, encodedSalt);
     }
 
-    auto digest = cb::crypto::PBKDF2_HMAC(
-            algorithm,
-            passwd,
-            {reinterpret_cast<const char*>(salt.data()), salt.size()},
-            IterationCount);
+    std::string digest;
+    if (dummy) {
+        // The dummy user is created for every authentication attempt for
+        // an unknown user, and the client can't authenticate as it anyway
+        // so use a random salted password rather than running the
+        // (expensive) PBKDF2 function. The salt and iteration count is
+        // still the same as before so the client can't tell the
+        // difference.
+        digest.resize(salt.size());
+        cb::RandomGenerator randomGenerator;
+        if (!randomGenerator.getBytes(&digest[0], digest.size())) {
+            throw std::runtime_error("Failed to get random bytes");
+        }
+    } else {
+        digest = cb::crypto::PBKDF2_HMAC(
+                algorithm,
+                passwd,
+                {reinterpret_cast<const char*>(salt.data()), salt.size()},
+                IterationCount);
+    }
+
+    PasswordMetaData metadata(digest, encodedSalt, IterationCount);
+    metadata.deriveScramKeys(algorithm);
+    password[mech] = std::move(metadata);
+}
 
-    password[mech] = PasswordMetaData(digest, encodedSalt, IterationCount);
+void User::PasswordMetaData::deriveScramKeys(cb::crypto::Algorithm algorithm) {
+    stored_key = cb::crypto::digest(
+            algorithm, cb::crypto::HMAC(algorithm, password, "Client Key"));
+    server_key = cb::crypto::HMAC(algorithm, password, "Server Key");
 }
 
 User::PasswordMetaData::PasswordMetaData(const nlohmann::json& obj) {
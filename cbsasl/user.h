@@ -93,6 +93,26 @@ public:
             return iteration_count;
         }
 
+        /**
+         * Derive the SCRAM StoredKey and ServerKey from the salted
+         * password. They're derived once when the user entry is created
+         * (when the password database is loaded) so that the server
+         * doesn't need to recompute them for every authentication.
+         *
+         * @param algorithm the hash algorithm used by the mechanism
+         */
+        void deriveScramKeys(cb::crypto::Algorithm algorithm);
+
+        /// StoredKey := H(HMAC(SaltedPassword, "Client Key"))
+        const std::string& getStoredKey() const {
+            return stored_key;
+        }
+
+        /// ServerKey := HMAC(SaltedPassword, "Server Key")
+        const std::string& getServerKey() const {
+            return server_key;
+        }
+
     private:
         // Base 64 encoded version of the salt
         std::string salt;
@@ -102,6 +122,10 @@ public:
 
         // The iteration count used for generating the password
         int iteration_count;
+
+        // The cached SCRAM keys (empty for PLAIN)
+        std::string stored_key;
+        std::string server_key;
     };
 
     /**
@@ -78,3 +78,19 @@ int DummyAllocHooks::set_allocator_property(const char* name,
                                             size_t newlen) {
     return 1;
 }
+
+bool DummyAllocHooks::create_arena(unsigned* arena) {
+    return false;
+}
+
+void DummyAllocHooks::release_arena(unsigned arena) {
+    // empty
+}
+
+bool DummyAllocHooks::set_thread_arena(unsigned arena) {
+    return false;
+}
+
+bool DummyAllocHooks::get_arena_allocated(unsigned arena, size_t* value) {
+    return false;
+}
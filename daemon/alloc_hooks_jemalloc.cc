@@ -41,6 +41,10 @@
 #include <malloc.h>
 #endif
 
+#include <mutex>
+#include <string>
+#include <vector>
+
 /* jemalloc checks for this symbol, and it's contents for the config to use. */
 JEMALLOC_EXPORT
 const char* je_malloc_conf =
@@ -216,7 +220,7 @@ bool JemallocHooks::enable_thread_cache(bool enable) {
 }
 
 bool JemallocHooks::get_allocator_property(const char* name, size_t* value) {
-    return jemalloc_get_stats_prop(name, value);
+    return jemalloc_get_stats_prop(name, value) == 0;
 }
 
 int JemallocHooks::set_allocator_property(const char* name,
@@ -224,3 +228,86 @@ int JemallocHooks::set_allocator_property(const char* name,
                                           size_t newlen) {
     return je_mallctl(name, nullptr, 0, newp, newlen);
 }
+
+/* Arenas given back by release_arena, for reuse by create_arena. */
+static std::mutex released_arenas_mutex;
+static std::vector<unsigned> released_arenas;
+
+bool JemallocHooks::create_arena(unsigned* arena) {
+    {
+        std::lock_guard<std::mutex> lh(released_arenas_mutex);
+        if (!released_arenas.empty()) {
+            *arena = released_arenas.back();
+            released_arenas.pop_back();
+            return true;
+        }
+    }
+    size_t size = sizeof(*arena);
+    int err = je_mallctl("arenas.create", arena, &size, NULL, 0);
+    if (err != 0) {
+        LOG_WARNING("jemalloc_create_arena() error {}", err);
+        return false;
+    }
+    return true;
+}
+
+void JemallocHooks::release_arena(unsigned arena) {
+    if (arena == 0) {
+        return;
+    }
+    const auto purge = "arena." + std::to_string(arena) + ".purge";
+    int err = je_mallctl(purge.c_str(), NULL, NULL, NULL, 0);
+    if (err != 0) {
+        LOG_WARNING("jemalloc_release_arena({}) error {}", arena, err);
+    }
+    std::lock_guard<std::mutex> lh(released_arenas_mutex);
+    released_arenas.push_back(arena);
+}
+
+bool JemallocHooks::set_thread_arena(unsigned arena) {
+    /* Most switches are to the arena the thread is already using. */
+    static thread_local unsigned current = 0;
+    if (arena == current) {
+        return true;
+    }
+    struct Mib {
+        size_t mib[2];
+        size_t len = sizeof(mib) / sizeof(mib[0]);
+        bool valid;
+    };
+    static const Mib mib = [] {
+        Mib m;
+        m.valid = je_mallctlnametomib("thread.arena", m.mib, &m.len) == 0;
+        return m;
+    }();
+    if (!mib.valid) {
+        return false;
+    }
+    int err = je_mallctlbymib(
+            mib.mib, mib.len, NULL, NULL, &arena, sizeof(arena));
+    if (err != 0) {
+        LOG_WARNING("jemalloc_set_thread_arena({}) error {}", arena, err);
+        return false;
+    }
+    current = arena;
+    return true;
+}
+
+bool JemallocHooks::get_arena_allocated(unsigned arena, size_t* value) {
+    size_t epoch = 1;
+    size_t sz = sizeof(epoch);
+    /* jemalloc can cache its statistics - force a refresh */
+    je_mallctl("epoch", &epoch, &sz, &epoch, sz);
+
+    const auto prefix = "stats.arenas." + std::to_string(arena);
+    size_t small;
+    size_t large;
+    if (jemalloc_get_stats_prop((prefix + ".small.allocated").c_str(),
+                                &small) != 0 ||
+        jemalloc_get_stats_prop((prefix + ".large.allocated").c_str(),
+                                &large) != 0) {
+        return false;
+    }
+    *value = small + large;
+    return true;
+}
@@ -0,0 +1,75 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "allocation_counter.h"
+#include "alloc_hooks.h"
+
+#include <atomic>
+
+using NewHook = void (*)(const void* ptr, size_t size);
+
+/// The Counts of the region the current thread is in (if any)
+static thread_local AllocationCounter::Counts* currentCounts = nullptr;
+
+/// The hook registered by the engine, which we forward allocations to
+static std::atomic<NewHook> forwardHook{nullptr};
+
+/// Set if our hook is installed with the allocator
+static bool installed = false;
+
+static void countingNewHook(const void* ptr, size_t size) {
+    auto* counts = currentCounts;
+    if (counts) {
+        ++counts->allocations;
+        counts->bytes += size;
+    }
+    auto hook = forwardHook.load(std::memory_order_relaxed);
+    if (hook) {
+        hook(ptr, size);
+    }
+}
+
+AllocationCounter::Region::Region(Counts& counts) : previous(currentCounts) {
+    currentCounts = &counts;
+}
+
+AllocationCounter::Region::~Region() {
+    currentCounts = previous;
+}
+
+void AllocationCounter::initialize() {
+    installed = AllocHooks::add_new_hook(countingNewHook);
+}
+
+bool AllocationCounter::isAvailable() {
+    return installed;
+}
+
+bool AllocationCounter::add_new_hook(NewHook hook) {
+    if (!installed) {
+        return AllocHooks::add_new_hook(hook);
+    }
+    NewHook expected = nullptr;
+    return forwardHook.compare_exchange_strong(expected, hook);
+}
+
+bool AllocationCounter::remove_new_hook(NewHook hook) {
+    if (!installed) {
+        return AllocHooks::remove_new_hook(hook);
+    }
+    NewHook expected = hook;
+    return forwardHook.compare_exchange_strong(expected, nullptr);
+}
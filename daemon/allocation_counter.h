@@ -0,0 +1,74 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Counts the memory allocations made by a thread while it is inside a
+ * counting region (see AllocationCounter::Region), so we can report how
+ * many allocations each command makes (see allocation_tracking_enabled).
+ *
+ * The allocator only supports a single new hook, which is used by the
+ * engines for their memory accounting. The daemon therefore installs its
+ * own hook at startup and forwards every allocation to the hook registered
+ * by the engine (via the ServerAllocatorIface, which is served by
+ * AllocationCounter::add_new_hook / remove_new_hook).
+ */
+class AllocationCounter {
+public:
+    /// The allocations made within a region
+    struct Counts {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    /**
+     * While a Region exists, the allocations made by the calling thread are
+     * added to the provided Counts. Regions may be nested; allocations are
+     * only counted by the innermost one.
+     */
+    class Region {
+    public:
+        explicit Region(Counts& counts);
+        ~Region();
+
+        Region(const Region&) = delete;
+        Region& operator=(const Region&) = delete;
+
+    private:
+        Counts* const previous;
+    };
+
+    /**
+     * Install the daemon's new hook with the allocator. If it cannot be
+     * installed (no allocator hooks on this platform), hooks registered via
+     * add_new_hook are passed directly to the allocator and no allocations
+     * are counted.
+     */
+    static void initialize();
+
+    /// @return true if allocations can be counted
+    static bool isAvailable();
+
+    /// Register the (single) hook to forward new allocations to
+    static bool add_new_hook(void (*hook)(const void* ptr, size_t size));
+
+    /// Remove the hook previously registered with add_new_hook
+    static bool remove_new_hook(void (*hook)(const void* ptr, size_t size));
+};
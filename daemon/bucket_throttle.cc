@@ -0,0 +1,376 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "bucket_throttle.h"
+
+#include "buckets.h"
+#include "connection.h"
+#include "cookie.h"
+#include "memcached.h"
+#include "settings.h"
+
+#include <logger/logger.h>
+#include <mcbp/protocol/opcode.h>
+#include <memcached/server_cookie_iface.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+/// How often the deferred requests are checked
+static const std::chrono::milliseconds TickInterval{10};
+
+static BucketThrottle::Limits parseLimits(const nlohmann::json& json,
+                                          const std::string& what) {
+    if (!json.is_object()) {
+        throw std::invalid_argument(what + " must be an object");
+    }
+    BucketThrottle::Limits limits;
+    for (auto it = json.begin(); it != json.end(); ++it) {
+        if (it.key() == "collections") {
+            continue;
+        }
+        if (!it.value().is_number_unsigned()) {
+            throw std::invalid_argument(what + " \"" + it.key() +
+                                        "\" must be an unsigned integer");
+        }
+        if (it.key() == "ops_per_sec") {
+            limits.opsPerSecond = it.value().get<size_t>();
+        } else if (it.key() == "bytes_per_sec") {
+            limits.bytesPerSecond = it.value().get<size_t>();
+        } else {
+            throw std::invalid_argument(what + ": unknown attribute \"" +
+                                        it.key() + "\"");
+        }
+    }
+    return limits;
+}
+
+bool BucketThrottle::Config::isUnlimited() const {
+    return bucket.isUnlimited() &&
+           std::all_of(collections.begin(),
+                       collections.end(),
+                       [](const std::pair<const CollectionID, Limits>& entry) {
+                           return entry.second.isUnlimited();
+                       });
+}
+
+BucketThrottle::Config BucketThrottle::parseConfig(const nlohmann::json& json) {
+    Config config;
+    config.bucket = parseLimits(json, "bucket_throttle");
+    auto collections = json.find("collections");
+    if (collections == json.end()) {
+        return config;
+    }
+    if (!collections->is_object()) {
+        throw std::invalid_argument(
+                "bucket_throttle: \"collections\" must be an object");
+    }
+    for (auto it = collections->begin(); it != collections->end(); ++it) {
+        uint32_t cid;
+        try {
+            size_t pos = 0;
+            cid = uint32_t(std::stoul(it.key(), &pos, 16));
+            if (pos != it.key().size()) {
+                throw std::invalid_argument("trailing characters");
+            }
+        } catch (const std::exception&) {
+            throw std::invalid_argument(
+                    "bucket_throttle: invalid collection id \"" + it.key() +
+                    "\"");
+        }
+        if (it.value().find("collections") != it.value().end()) {
+            throw std::invalid_argument(
+                    "bucket_throttle: collection " + it.key() +
+                    " can't contain collections");
+        }
+        config.collections[CollectionID(cid)] = parseLimits(
+                it.value(), "bucket_throttle: collection " + it.key());
+    }
+    return config;
+}
+
+BucketThrottle::TokenBucket::TokenBucket(
+        Limits limits, std::chrono::steady_clock::time_point now)
+    : limits(limits),
+      ops(double(limits.opsPerSecond)),
+      bytes(double(limits.bytesPerSecond)),
+      lastRefill(now) {
+}
+
+void BucketThrottle::TokenBucket::refill(
+        std::chrono::steady_clock::time_point now) {
+    const auto elapsed =
+            std::chrono::duration<double>(now - lastRefill).count();
+    if (elapsed <= 0) {
+        return;
+    }
+    lastRefill = now;
+    ops = std::min(ops + elapsed * limits.opsPerSecond,
+                   double(limits.opsPerSecond));
+    bytes = std::min(bytes + elapsed * limits.bytesPerSecond,
+                     double(limits.bytesPerSecond));
+}
+
+bool BucketThrottle::TokenBucket::isAvailable(size_t size) const {
+    if (limits.opsPerSecond != 0 && ops < 1) {
+        return false;
+    }
+    // A request larger than a second's worth of bytes may run once the
+    // bucket is full (it'll then be in debt for a while)
+    return limits.bytesPerSecond == 0 ||
+           bytes >= std::min(double(size), double(limits.bytesPerSecond));
+}
+
+void BucketThrottle::TokenBucket::consume(size_t size) {
+    if (limits.opsPerSecond != 0) {
+        ops -= 1;
+    }
+    if (limits.bytesPerSecond != 0) {
+        bytes -= size;
+    }
+}
+
+void BucketThrottle::configure(const Config& config) {
+    std::list<Waiter> released;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        const auto now = std::chrono::steady_clock::now();
+        bucket = TokenBucket(config.bucket, now);
+        collections.clear();
+        for (const auto& entry : config.collections) {
+            if (!entry.second.isUnlimited()) {
+                collections.emplace(entry.first,
+                                    TokenBucket(entry.second, now));
+            }
+        }
+        enabled = !config.isUnlimited();
+        released.swap(waiting);
+        numWaiting = 0;
+    }
+    release(released);
+}
+
+void BucketThrottle::reset() {
+    configure({});
+    numDeferred.reset();
+    deferredTime.reset();
+}
+
+BucketThrottle::Admission BucketThrottle::tryConsume(
+        CollectionID collection,
+        size_t bytes,
+        std::chrono::steady_clock::time_point now) {
+    bucket.refill(now);
+    if (!bucket.isAvailable(bytes)) {
+        return Admission::BucketLimited;
+    }
+    auto iter = collections.find(collection);
+    if (iter != collections.end()) {
+        iter->second.refill(now);
+        if (!iter->second.isAvailable(bytes)) {
+            return Admission::CollectionLimited;
+        }
+        iter->second.consume(bytes);
+    }
+    bucket.consume(bytes);
+    return Admission::Admitted;
+}
+
+bool BucketThrottle::admit(Cookie& cookie,
+                           CollectionID collection,
+                           size_t bytes) {
+    std::lock_guard<std::mutex> guard(mutex);
+    const auto now = std::chrono::steady_clock::now();
+    if (waiting.empty() &&
+        tryConsume(collection, bytes, now) == Admission::Admitted) {
+        return true;
+    }
+
+    // Keep the cookie alive while it's deferred (released in release())
+    get_server_api()->cookie->reserve(&cookie);
+    waiting.push_back({&cookie, collection, bytes, now});
+    numWaiting = waiting.size();
+    ++numDeferred;
+    return false;
+}
+
+void BucketThrottle::tick(bool releaseAll) {
+    if (numWaiting.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    std::list<Waiter> released;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (releaseAll) {
+            released.swap(waiting);
+        } else {
+            const auto now = std::chrono::steady_clock::now();
+            auto iter = waiting.begin();
+            while (iter != waiting.end()) {
+                const auto admission =
+                        tryConsume(iter->collection, iter->bytes, now);
+                if (admission == Admission::BucketLimited) {
+                    break;
+                }
+                if (admission == Admission::Admitted) {
+                    auto next = std::next(iter);
+                    released.splice(released.end(), waiting, iter);
+                    iter = next;
+                } else {
+                    ++iter;
+                }
+            }
+        }
+        numWaiting = waiting.size();
+    }
+    release(released);
+}
+
+void BucketThrottle::release(const std::list<Waiter>& waiters) {
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& waiter : waiters) {
+        deferredTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                                now - waiter.since)
+                                .count();
+        // The admission check isn't repeated when the request is
+        // re-executed. The cookie is blocked, so its front end thread
+        // doesn't touch it until notified.
+        waiter.cookie->setThrottleAdmitted();
+        notify_io_complete(waiter.cookie, ENGINE_SUCCESS);
+        get_server_api()->cookie->release(waiter.cookie);
+    }
+}
+
+void configureBucketThrottle(Bucket& bucket) {
+    std::string name;
+    {
+        std::lock_guard<std::mutex> guard(bucket.mutex);
+        if (bucket.state != Bucket::State::Ready || bucket.name[0] == '\0') {
+            return;
+        }
+        name = bucket.name;
+    }
+
+    BucketThrottle::Config config;
+    const auto settings = Settings::instance().getBucketThrottle();
+    if (!settings.empty()) {
+        try {
+            const auto json = nlohmann::json::parse(settings);
+            auto entry = json.find(name);
+            if (entry != json.end()) {
+                config = BucketThrottle::parseConfig(*entry);
+            }
+        } catch (const std::exception& e) {
+            // The setting was verified when it was set
+            LOG_WARNING("Failed to configure the throttle of bucket [{}]: {}",
+                        name,
+                        e.what());
+        }
+    }
+
+    bucket.throttle.configure(config);
+}
+
+void reconfigureBucketThrottles() {
+    for (auto& bucket : all_buckets) {
+        configureBucketThrottle(bucket);
+    }
+}
+
+/// @return true if the opcode is a document operation (subject to throttling)
+static bool isThrottled(cb::mcbp::ClientOpcode opcode) {
+    using cb::mcbp::ClientOpcode;
+    if (cb::mcbp::is_reorder_supported(opcode)) {
+        return true;
+    }
+    switch (opcode) {
+    case ClientOpcode::SubdocGet:
+    case ClientOpcode::SubdocExists:
+    case ClientOpcode::SubdocDictAdd:
+    case ClientOpcode::SubdocDictUpsert:
+    case ClientOpcode::SubdocDelete:
+    case ClientOpcode::SubdocReplace:
+    case ClientOpcode::SubdocArrayPushLast:
+    case ClientOpcode::SubdocArrayPushFirst:
+    case ClientOpcode::SubdocArrayInsert:
+    case ClientOpcode::SubdocArrayAddUnique:
+    case ClientOpcode::SubdocCounter:
+    case ClientOpcode::SubdocMultiLookup:
+    case ClientOpcode::SubdocMultiMutation:
+    case ClientOpcode::SubdocGetCount:
+    case ClientOpcode::GetMeta:
+    case ClientOpcode::GetqMeta:
+    case ClientOpcode::GetRandomKey:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool admitRequest(Cookie& cookie) {
+    if (cookie.isThrottleAdmitted()) {
+        return true;
+    }
+
+    auto& connection = cookie.getConnection();
+    auto& bucket = connection.getBucket();
+    if (!bucket.throttle.isEnabled() || connection.isInternal() ||
+        !isThrottled(cookie.getHeader().getRequest().getClientOpcode())) {
+        cookie.setThrottleAdmitted();
+        return true;
+    }
+
+    const auto collection = connection.isCollectionsSupported()
+                                    ? cookie.getRequestKey().getCollectionID()
+                                    : CollectionID(CollectionID::Default);
+    if (bucket.throttle.admit(cookie, collection, cookie.getPacket().size())) {
+        cookie.setThrottleAdmitted();
+        return true;
+    }
+    return false;
+}
+
+static struct event* throttleTimer = nullptr;
+
+static void throttleTimerHandler(evutil_socket_t, short, void*) {
+    for (auto& bucket : all_buckets) {
+        bucket.throttle.tick(bucket.state != Bucket::State::Ready);
+    }
+}
+
+void initializeBucketThrottleTimer(struct event_base* base) {
+    throttleTimer =
+            event_new(base, -1, EV_PERSIST, throttleTimerHandler, nullptr);
+    if (throttleTimer == nullptr) {
+        throw std::bad_alloc();
+    }
+    const auto usec =
+            std::chrono::duration_cast<std::chrono::microseconds>(TickInterval)
+                    .count();
+    struct timeval tv;
+    tv.tv_sec = long(usec / 1000000);
+    tv.tv_usec = long(usec % 1000000);
+    event_add(throttleTimer, &tv);
+}
+
+void shutdownBucketThrottleTimer() {
+    if (throttleTimer != nullptr) {
+        event_free(throttleTimer);
+        throttleTimer = nullptr;
+    }
+}
@@ -0,0 +1,203 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/dockey.h>
+#include <nlohmann/json_fwd.hpp>
+#include <relaxed_atomic.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+class Bucket;
+class Cookie;
+struct event_base;
+
+/**
+ * Throughput limits for a bucket (and optionally for individual collections
+ * in the bucket), enforced before a request is dispatched to the engine.
+ *
+ * The limits are enforced with token buckets holding (up to) one second's
+ * worth of operations and request bytes. A request arriving when there
+ * aren't enough tokens is deferred: the cookie is blocked (EWOULDBLOCK) and
+ * notified once tokens are available, so a throttled connection doesn't
+ * consume any CPU while it waits. Deferred requests are admitted in the
+ * order they arrived (a request held back by the limit of its collection
+ * doesn't hold back the requests for other collections).
+ */
+class BucketThrottle {
+public:
+    struct Limits {
+        /// The maximum number of operations per second (0 == unlimited)
+        size_t opsPerSecond = 0;
+        /// The maximum number of request bytes per second (0 == unlimited)
+        size_t bytesPerSecond = 0;
+
+        bool isUnlimited() const {
+            return opsPerSecond == 0 && bytesPerSecond == 0;
+        }
+    };
+
+    struct Config {
+        Limits bucket;
+        std::unordered_map<CollectionID, Limits> collections;
+
+        bool isUnlimited() const;
+    };
+
+    /**
+     * Parse the throttle configuration of a bucket:
+     *
+     *     {
+     *       "ops_per_sec": 10000,
+     *       "bytes_per_sec": 10485760,
+     *       "collections": {"8": {"ops_per_sec": 1000}}
+     *     }
+     *
+     * All of the attributes are optional. The collections are identified
+     * by their (hex) collection id.
+     *
+     * @throws std::invalid_argument if the configuration is invalid
+     */
+    static Config parseConfig(const nlohmann::json& json);
+
+    /**
+     * Replace the limits. All deferred requests are released (and the
+     * token buckets start out full).
+     */
+    void configure(const Config& config);
+
+    /// @return true if any limits are configured
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Check if the request may be executed now.
+     *
+     * @param cookie the cookie executing the request
+     * @param collection the collection the request operates on
+     * @param bytes the size of the request
+     * @return true if the request may run, false if it has been deferred
+     *         (the caller should block the cookie; it is notified once the
+     *         request may run)
+     */
+    bool admit(Cookie& cookie, CollectionID collection, size_t bytes);
+
+    /**
+     * Notify the deferred requests which may now run.
+     *
+     * @param releaseAll release all of the deferred requests (the bucket
+     *                   is going away)
+     */
+    void tick(bool releaseAll);
+
+    /// @return the number of requests deferred since the bucket was created
+    uint64_t getDeferred() const {
+        return numDeferred;
+    }
+
+    /// @return the total time (in us) requests spent deferred
+    uint64_t getDeferredTime() const {
+        return deferredTime;
+    }
+
+    /// @return the number of requests currently deferred
+    size_t getWaiting() const {
+        return numWaiting.load(std::memory_order_relaxed);
+    }
+
+    /// Remove all limits and release any deferred request
+    void reset();
+
+protected:
+    class TokenBucket {
+    public:
+        TokenBucket() = default;
+        TokenBucket(Limits limits, std::chrono::steady_clock::time_point now);
+
+        /// Add the tokens accrued since the last refill
+        void refill(std::chrono::steady_clock::time_point now);
+
+        /// @return true if an operation of the given size may run
+        bool isAvailable(size_t bytes) const;
+
+        void consume(size_t bytes);
+
+    private:
+        Limits limits;
+        double ops = 0;
+        double bytes = 0;
+        std::chrono::steady_clock::time_point lastRefill;
+    };
+
+    enum class Admission { Admitted, BucketLimited, CollectionLimited };
+
+    /// Try to take the tokens for a request. Caller must hold the mutex.
+    Admission tryConsume(CollectionID collection,
+                         size_t bytes,
+                         std::chrono::steady_clock::time_point now);
+
+    struct Waiter {
+        Cookie* cookie;
+        CollectionID collection;
+        size_t bytes;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    /// Notify the (reserved) cookies of the released waiters
+    void release(const std::list<Waiter>& waiters);
+
+    std::atomic_bool enabled{false};
+    std::atomic<size_t> numWaiting{0};
+    cb::RelaxedAtomic<uint64_t> numDeferred{0};
+    cb::RelaxedAtomic<uint64_t> deferredTime{0};
+
+    std::mutex mutex;
+    TokenBucket bucket;
+    std::unordered_map<CollectionID, TokenBucket> collections;
+    std::list<Waiter> waiting;
+};
+
+/**
+ * Configure the throttle of the bucket from the *bucket_throttle* setting
+ * (which holds the configuration of the buckets by name). A bucket which
+ * isn't listed isn't throttled.
+ */
+void configureBucketThrottle(Bucket& bucket);
+
+/// Reconfigure the throttle of all of the buckets
+void reconfigureBucketThrottles();
+
+/**
+ * Check the throughput limits of the cookie's bucket before the request is
+ * dispatched. Only document operations from external connections are
+ * throttled; a request is only checked the first time it is executed.
+ *
+ * @return true if the request may run, false if it has been deferred
+ */
+bool admitRequest(Cookie& cookie);
+
+/// Start the timer which releases the deferred requests
+void initializeBucketThrottleTimer(struct event_base* base);
+
+/// Stop the timer started by initializeBucketThrottleTimer
+void shutdownBucketThrottleTimer();
@@ -23,20 +23,32 @@
 
 Bucket::Bucket() = default;
 
+uint64_t Bucket::getResponseCount(size_t status) const {
+    uint64_t ret = 0;
+    for (const auto& counters : responseCounters) {
+        ret += counters[status];
+    }
+    return ret;
+}
+
 void Bucket::reset() {
     std::lock_guard<std::mutex> guard(mutex);
     state = Bucket::State::None;
     name[0] = '\0';
+    deletionPhase = DeletionPhase::None;
     setEngine(nullptr);
     topkeys.reset();
     clusterConfiguration.reset();
     max_document_size = default_max_item_size;
     supportedFeatures = {};
-    for (auto& c : responseCounters) {
-        c.reset();
+    for (auto& counters : responseCounters) {
+        for (auto& c : counters) {
+            c.reset();
+        }
     }
     subjson_operation_times.reset();
     timings.reset();
+    throttle.reset();
     for (auto& s : stats) {
         s.reset();
     }
@@ -127,6 +139,21 @@ std::string to_string(Bucket::Type type) {
     throw std::logic_error("Invalid bucket type: " + std::to_string(int(type)));
 }
 
+std::string to_string(Bucket::DeletionPhase phase) {
+    switch (phase) {
+    case Bucket::DeletionPhase::None:
+        return "none";
+    case Bucket::DeletionPhase::Disconnecting:
+        return "disconnecting";
+    case Bucket::DeletionPhase::ShuttingDown:
+        return "shutting down";
+    case Bucket::DeletionPhase::Cleanup:
+        return "cleanup";
+    }
+    throw std::invalid_argument("Invalid bucket deletion phase: " +
+                                std::to_string(int(phase)));
+}
+
 std::string to_string(Bucket::State state) {
     switch (state) {
     case Bucket::State::None:
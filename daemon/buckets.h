@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include "bucket_throttle.h"
 #include "cluster_config.h"
 #include "mcbp_validators.h"
 #include "timings.h"
@@ -27,6 +28,7 @@
 #include <nlohmann/json_fwd.hpp>
 #include <utilities/hdrhistogram.h>
 
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 
@@ -64,6 +66,18 @@ public:
         Destroying
     };
 
+    /// The progress of the deletion of a bucket in the Destroying state
+    enum class DeletionPhase : uint8_t {
+        /// The bucket isn't being deleted
+        None,
+        /// Waiting for the connections to the bucket to disconnect
+        Disconnecting,
+        /// The engine is shutting down and releasing its memory
+        ShuttingDown,
+        /// Releasing the resources held by the front end
+        Cleanup
+    };
+
     enum class Type : uint8_t {
         Unknown,
         NoBucket,
@@ -110,6 +124,13 @@ public:
      */
     std::atomic<State> state{State::None};
 
+    /**
+     * The deletion progress (reported in "stats bucket_details" while the
+     * bucket is Destroying). Protected by the mutex.
+     */
+    DeletionPhase deletionPhase{DeletionPhase::None};
+    std::chrono::steady_clock::time_point deletionStart;
+
     /**
      * The type of bucket
      */
@@ -150,12 +171,34 @@ public:
     Hdr1sfMicroSecHistogram subjson_operation_times;
 
     using ResponseCounter = cb::RelaxedAtomic<uint64_t>;
+    using ResponseCounters =
+            std::array<ResponseCounter, size_t(cb::mcbp::Status::COUNT)>;
 
     /**
      * Response counters that count the number of times a specific response
-     * status is sent
+     * status is sent, one set per front-end thread (like stats) so that
+     * sending a response doesn't write to memory shared with the other
+     * threads.
+     */
+    std::vector<ResponseCounters> responseCounters;
+
+    /**
+     * Count a response with the given status sent by a front-end thread
+     */
+    void countResponse(size_t thread, cb::mcbp::Status status) {
+        ++responseCounters[thread][size_t(status)];
+    }
+
+    /**
+     * @returns the number of responses sent with the given status (by all
+     *          front-end threads)
      */
-    std::array<ResponseCounter, size_t(cb::mcbp::Status::COUNT)> responseCounters;
+    uint64_t getResponseCount(size_t status) const;
+
+    /**
+     * The throughput limits of the bucket
+     */
+    BucketThrottle throttle;
 
     /**
      * The cluster configuration for this bucket
@@ -195,6 +238,8 @@ protected:
 
 std::string to_string(Bucket::State state);
 
+std::string to_string(Bucket::DeletionPhase phase);
+
 std::string to_string(Bucket::Type type);
 
 /**
@@ -22,7 +22,9 @@
 #include "memcached.h"
 #include "server_event.h"
 
-#include <mcbp/protocol/framebuilder.h>
+#include <mcbp/protocol/request.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
 
@@ -60,45 +62,61 @@ public:
 
     bool execute(Connection& connection) override {
         auto& bucket = connection.getBucket();
-        auto payload = bucket.clusterConfiguration.getConfiguration();
-        if (payload.first < connection.getClustermapRevno()) {
+        const auto known = connection.getClustermapRevno();
+        auto update = bucket.clusterConfiguration.getUpdate(
+                connection.isClustermapChangeNotificationDeltaSupported()
+                        ? known
+                        : ClusterConfiguration::NoConfiguration);
+        if (update.revision < known) {
             // Ignore.. we've already sent a newer cluster config
             return true;
         }
 
-        connection.setClustermapRevno(payload.first);
-        LOG_INFO("{}: Sending Cluster map revision {}",
+        connection.setClustermapRevno(update.revision);
+        const bool delta = update.base != ClusterConfiguration::NoConfiguration;
+        LOG_INFO("{}: Sending Cluster map revision {}{}",
                  connection.getId(),
-                 payload.first);
+                 update.revision,
+                 delta ? " (delta from " + std::to_string(update.base) + ")"
+                       : std::string{});
 
         std::string name = bucket.name;
 
-        using namespace cb::mcbp;
-        size_t needed = sizeof(Request) + // packet header
-                        4 + // rev number in extdata
-                        name.size() + // the name of the bucket
-                        payload.second->size(); // The actual payload
+        // The extras contains the cluster revision number as an uint32_t
+        // (followed by the revision the delta applies to for deltas)
+        std::array<uint32_t, 2> extras{{htonl(update.revision),
+                                        htonl(uint32_t(update.base))}};
+        const size_t extlen = delta ? sizeof(extras) : sizeof(extras[0]);
 
+        using namespace cb::mcbp;
+        Request req = {};
+        req.setMagic(Magic::ServerRequest);
+        req.setOpcode(ServerOpcode::ClustermapChangeNotification);
+        req.setExtlen(uint8_t(extlen));
+        req.setKeylen(uint16_t(name.size()));
+        req.setBodylen(
+                uint32_t(extlen + name.size() + update.payload->size()));
+        req.setDatatype(cb::mcbp::Datatype::JSON);
+
+        // Only the header, extras and key is copied into the write buffer.
+        // The payload is shared by all of the connections we're pushing
+        // the revision to, and added to the iovector as is.
+        const size_t needed = sizeof(req) + extlen + name.size();
         connection.write->ensureCapacity(needed);
-        FrameBuilder<Request> builder(connection.write->wdata());
-        builder.setMagic(Magic::ServerRequest);
-        builder.setDatatype(cb::mcbp::Datatype::JSON);
-        builder.setOpcode(ServerOpcode::ClustermapChangeNotification);
-
-        // The extras contains the cluster revision number as an uint32_t
-        const uint32_t rev = htonl(payload.first);
-        builder.setExtras(
-                {reinterpret_cast<const uint8_t*>(&rev), sizeof(rev)});
-        builder.setKey(
-                {reinterpret_cast<const uint8_t*>(name.data()), name.size()});
-        builder.setValue(
-                {reinterpret_cast<const uint8_t*>(payload.second->data()),
-                 payload.second->size()});
+        auto wbuf = connection.write->wdata();
+        auto next = std::copy_n(reinterpret_cast<const uint8_t*>(&req),
+                                sizeof(req),
+                                wbuf.begin());
+        next = std::copy_n(
+                reinterpret_cast<const uint8_t*>(extras.data()), extlen, next);
+        std::copy(name.begin(), name.end(), next);
 
         // Inject our packet into the stream!
         connection.addMsgHdr(true);
-        connection.addIov(connection.write->wdata().data(), needed);
+        connection.addIov(wbuf.data(), needed);
         connection.write->produced(needed);
+        connection.addIov(update.payload->data(), update.payload->size());
+        connection.pushSharedBuffer(std::move(update.payload));
 
         connection.setState(StateMachine::State::send_data);
         connection.setWriteAndGo(StateMachine::State::new_cmd);
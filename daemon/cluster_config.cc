@@ -16,16 +16,113 @@
  */
 #include "cluster_config.h"
 
+#include <nlohmann/json.hpp>
 #include <subdoc/operations.h>
 
 #include <cstdlib>
 #include <stdexcept>
 
-void ClusterConfiguration::setConfiguration(cb::const_char_buffer buffer,
-                                            int rev) {
+/// Remove the vBucket map from the configuration and return it (null if
+/// the configuration don't have one)
+static nlohmann::json extractVBucketMap(nlohmann::json& json) {
+    auto server = json.find("vBucketServerMap");
+    if (server == json.end() || !server->is_object()) {
+        return {};
+    }
+    auto map = server->find("vBucketMap");
+    if (map == server->end() || !map->is_array()) {
+        return {};
+    }
+    nlohmann::json ret = std::move(*map);
+    server->erase(map);
+    return ret;
+}
+
+/**
+ * Create the delta from the previous configuration to the next one
+ *
+ * @return the delta, or nullptr if the configurations differ in more than
+ *         the vBucket map entries (or the delta isn't smaller than the next
+ *         configuration)
+ */
+static std::shared_ptr<std::string> createDelta(const std::string& previous,
+                                                int base,
+                                                cb::const_char_buffer next,
+                                                int rev) {
+    try {
+        auto from = nlohmann::json::parse(previous);
+        auto to = nlohmann::json::parse(next.begin(), next.end());
+        if (!from.is_object() || !to.is_object()) {
+            return {};
+        }
+
+        const auto fromMap = extractVBucketMap(from);
+        const auto toMap = extractVBucketMap(to);
+        if (!fromMap.is_array() || !toMap.is_array() ||
+            fromMap.size() != toMap.size()) {
+            return {};
+        }
+
+        from.erase("rev");
+        to.erase("rev");
+        if (from != to) {
+            return {};
+        }
+
+        auto changes = nlohmann::json::object();
+        for (size_t ii = 0; ii < toMap.size(); ++ii) {
+            if (fromMap[ii] != toMap[ii]) {
+                changes[std::to_string(ii)] = toMap[ii];
+            }
+        }
+
+        nlohmann::json json = {{"rev", rev},
+                               {"baseRev", base},
+                               {"vBucketMap", std::move(changes)}};
+        auto ret = std::make_shared<std::string>(json.dump());
+        if (ret->size() < next.size()) {
+            return ret;
+        }
+    } catch (const std::exception&) {
+        // Not JSON (we don't validate the content of the configuration);
+        // the clients will receive the full configuration
+    }
+
+    return {};
+}
+
+void ClusterConfiguration::update(cb::const_char_buffer buffer, int rev) {
+    std::shared_ptr<std::string> previous;
+    int base;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        previous = config;
+        base = revision;
+    }
+
+    // Build the new objects without holding the lock (the configuration
+    // may be megabytes and we don't want to block the front end threads)
+    std::shared_ptr<std::string> nextDelta;
+    if (base != NoConfiguration && base < rev) {
+        nextDelta = createDelta(*previous, base, buffer, rev);
+    }
+    auto next = std::make_shared<std::string>(buffer.begin(), buffer.end());
+
     std::lock_guard<std::mutex> guard(mutex);
+    if (config != previous) {
+        // Someone else replaced the configuration in the meantime so the
+        // delta isn't from the previous configuration
+        nextDelta.reset();
+    }
     revision = rev;
-    config = std::make_shared<std::string>(buffer.begin(), buffer.end());
+    config = std::move(next);
+    delta = std::move(nextDelta);
+    deltaBase = delta ? base : NoConfiguration;
+}
+
+void ClusterConfiguration::setConfiguration(cb::const_char_buffer buffer,
+                                            int rev) {
+    update(buffer, rev);
 }
 
 void ClusterConfiguration::setConfiguration(cb::const_char_buffer buffer) {
@@ -36,9 +133,15 @@ void ClusterConfiguration::setConfiguration(cb::const_char_buffer buffer) {
                 "revision");
     }
 
+    update(buffer, rev);
+}
+
+ClusterConfiguration::Update ClusterConfiguration::getUpdate(int known) const {
     std::lock_guard<std::mutex> guard(mutex);
-    revision = rev;
-    config = std::make_shared<std::string>(buffer.begin(), buffer.end());
+    if (delta && known == deltaBase) {
+        return {revision, deltaBase, delta};
+    }
+    return {revision, NoConfiguration, config};
 }
 
 int ClusterConfiguration::getRevisionNumber(cb::const_char_buffer buffer) {
@@ -71,4 +174,6 @@ void ClusterConfiguration::reset() {
     std::lock_guard<std::mutex> guard(mutex);
     revision = NoConfiguration;
     config = std::make_shared<std::string>();
+    delta.reset();
+    deltaBase = NoConfiguration;
 }
@@ -29,12 +29,22 @@
  * Each configuration object contains a revision number identified by
  *
  *    "rev": number
+ *
+ * When a new configuration replace the previous one and the only
+ * difference between them (except for the revision number) is the content
+ * of the entries in "vBucketServerMap.vBucketMap", we also create (once
+ * per revision) a compact delta which may be pushed to the clients who
+ * already know the previous revision:
+ *
+ *    {"rev": number, "baseRev": number, "vBucketMap": {"vbid": [...]}}
  */
 class ClusterConfiguration {
 public:
     static const int NoConfiguration = -1;
     ClusterConfiguration()
-        : config(std::make_shared<std::string>()), revision(NoConfiguration) {
+        : config(std::make_shared<std::string>()),
+          revision(NoConfiguration),
+          deltaBase(NoConfiguration) {
     }
 
     void setConfiguration(cb::const_char_buffer buffer, int rev);
@@ -52,6 +62,24 @@ public:
         return std::make_pair(revision, config);
     };
 
+    /// The message to send to a client to bring it up to date
+    struct Update {
+        /// The revision the client will be at
+        int revision;
+        /// The revision the delta applies to (or NoConfiguration if
+        /// payload is the full configuration)
+        int base;
+        std::shared_ptr<std::string> payload;
+    };
+
+    /**
+     * Get the delta from the provided revision to the current
+     * configuration if we've got one, otherwise the full configuration.
+     *
+     * @param known the revision the client currently use
+     */
+    Update getUpdate(int known) const;
+
     /**
      * Pick out the revision number from the provided cluster configuration.
      *
@@ -85,4 +113,13 @@ protected:
      * Cached revision so we don't have to parse it every time
      */
     int revision;
+
+    /// The delta from deltaBase to revision (empty if we don't have one)
+    std::shared_ptr<std::string> delta;
+
+    /// The revision the delta applies to
+    int deltaBase;
+
+    /// Replace the configuration (and create the delta from the current)
+    void update(cb::const_char_buffer buffer, int rev);
 };
@@ -44,8 +44,10 @@
 #include <platform/string_hex.h>
 #include <platform/timeutils.h>
 #include <utilities/logtags.h>
+#include <utilities/thread_cpu_time.h>
 #include <gsl/gsl>
 
+#include <algorithm>
 #include <cctype>
 #include <exception>
 #ifndef WIN32
@@ -194,6 +196,10 @@ nlohmann::json Connection::toJSON() const {
         features.push_back("CCN");
     }
 
+    if (isClustermapChangeNotificationDeltaSupported()) {
+        features.push_back("CCN delta");
+    }
+
     ret["features"] = features;
 
     ret["thread"] = getThread().index;
@@ -228,6 +234,12 @@ nlohmann::json Connection::toJSON() const {
     ret["dcp_no_value"] = isDcpNoValue();
     ret["max_reqs_per_event"] = max_reqs_per_event;
     ret["nevents"] = numEvents;
+    ret["event_budget_usec"] =
+            std::chrono::duration_cast<std::chrono::microseconds>(eventBudget)
+                    .count();
+    ret["command_cost_usec"] =
+            std::chrono::duration_cast<std::chrono::microseconds>(commandCost)
+                    .count();
     ret["state"] = getStateName();
 
     nlohmann::json libevt;
@@ -300,6 +312,7 @@ void Connection::restartAuthentication() {
 
 cb::engine_errc Connection::dropPrivilege(cb::rbac::Privilege privilege) {
     if (privilegeContext.dropPrivilege(privilege)) {
+        authorizedOpcodes.reset();
         return cb::engine_errc::success;
     }
 
@@ -326,12 +339,12 @@ cb::rbac::PrivilegeAccess Connection::checkPrivilege(
         // but let the client deal with whatever happens after
         // a single update.
         try {
-            privilegeContext = cb::rbac::createContext(
-                    getUsername(), getDomain(), all_buckets[bucketIndex].name);
+            setPrivilegeContext(cb::rbac::createContext(
+                    getUsername(), getDomain(), all_buckets[bucketIndex].name));
         } catch (const cb::rbac::NoSuchBucketException&) {
             // Remove all access to the bucket
-            privilegeContext =
-                    cb::rbac::createContext(getUsername(), getDomain(), "");
+            setPrivilegeContext(
+                    cb::rbac::createContext(getUsername(), getDomain(), ""));
             LOG_INFO(
                     "{}: RBAC: Connection::checkPrivilege({}) {} No access "
                     "to "
@@ -536,8 +549,8 @@ void Connection::setBucketIndex(int bucketIndex) {
         if (authenticated) {
             // The user have logged in, so we should create a context
             // representing the users context in the desired bucket.
-            privilegeContext = cb::rbac::createContext(
-                    username, getDomain(), all_buckets[bucketIndex].name);
+            setPrivilegeContext(cb::rbac::createContext(
+                    username, getDomain(), all_buckets[bucketIndex].name));
         } else if (is_default_bucket_enabled() &&
                    strcmp("default", all_buckets[bucketIndex].name) == 0) {
             // We've just connected to the _default_ bucket, _AND_ the client
@@ -547,16 +560,16 @@ void Connection::setBucketIndex(int bucketIndex) {
             // a while... lets look up a profile named "default" and
             // assign that. It should only contain access to the default
             // bucket.
-            privilegeContext = cb::rbac::createContext(
-                    "default", getDomain(), all_buckets[bucketIndex].name);
+            setPrivilegeContext(cb::rbac::createContext(
+                    "default", getDomain(), all_buckets[bucketIndex].name));
         } else {
             // The user has not authenticated, and this isn't for the
             // "default bucket". Assign an empty profile which won't give
             // you any privileges.
-            privilegeContext = cb::rbac::PrivilegeContext{getDomain()};
+            setPrivilegeContext(cb::rbac::PrivilegeContext{getDomain()});
         }
     } catch (const cb::rbac::Exception&) {
-        privilegeContext = cb::rbac::PrivilegeContext{getDomain()};
+        setPrivilegeContext(cb::rbac::PrivilegeContext{getDomain()});
     }
 
     if (bucketIndex == 0) {
@@ -564,6 +577,7 @@ void Connection::setBucketIndex(int bucketIndex) {
         // no bucket instead of EACCESS. Lets give the connection all
         // possible bucket privileges
         privilegeContext.setBucketPrivileges();
+        authorizedOpcodes.reset();
     }
 }
 
@@ -716,14 +730,32 @@ void Connection::shrinkBuffers() {
     }
 }
 
+void Connection::releaseIoVectors() {
+    if (getState() != StateMachine::State::waiting) {
+        return;
+    }
+    msgcurr = 0;
+    iovused = 0;
+    msglist.clear();
+    msglist.shrink_to_fit();
+    iov.clear();
+    iov.shrink_to_fit();
+    corkedSending.clear();
+    corkedSending.shrink_to_fit();
+    if (corked.empty()) {
+        corked.shrink_to_fit();
+    }
+}
+
 void Connection::setAuthenticated(bool authenticated) {
     Connection::authenticated = authenticated;
     if (authenticated) {
         updateDescription();
-        privilegeContext = cb::rbac::createContext(username, getDomain(), "");
+        setPrivilegeContext(
+                cb::rbac::createContext(username, getDomain(), ""));
     } else {
         resetUsernameCache();
-        privilegeContext = cb::rbac::PrivilegeContext{getDomain()};
+        setPrivilegeContext(cb::rbac::PrivilegeContext{getDomain()});
     }
 }
 
@@ -793,6 +825,17 @@ int Connection::sslPreConnection() {
     if (r == 1) {
         ssl.drainBioSendPipe(socketDescriptor);
         ssl.setConnected();
+        {
+            auto& handshakes = tls_handshakes[getThread().index];
+            const auto usec =
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            ssl.getHandshakeDuration());
+            if (ssl.isSessionReused()) {
+                handshakes.resumed.add(usec);
+            } else {
+                handshakes.full.add(usec);
+            }
+        }
         auto certResult = ssl.getCertUserName();
         bool disconnect = false;
         switch (certResult.first) {
@@ -838,11 +881,23 @@ int Connection::sslPreConnection() {
             return -1;
         }
 
-         LOG_INFO("{}: Using SSL cipher:{}",
-                 getId(),
-                 ssl.getCurrentCipherName());
+        if (ssl.isDirect()) {
+            LOG_INFO("{}: Using SSL cipher:{} kTLS send:{} recv:{}",
+                     getId(),
+                     ssl.getCurrentCipherName(),
+                     ssl.isKtlsSend() ? "yes" : "no",
+                     ssl.isKtlsRecv() ? "yes" : "no");
+        } else {
+            LOG_INFO("{}: Using SSL cipher:{}",
+                     getId(),
+                     ssl.getCurrentCipherName());
+        }
     } else {
-        if (ssl.getError(r) == SSL_ERROR_WANT_READ) {
+        const auto error = ssl.getError(r);
+        if (error == SSL_ERROR_WANT_READ ||
+            (ssl.isDirect() && error == SSL_ERROR_WANT_WRITE)) {
+            // In kTLS mode OpenSSL writes the handshake to the socket
+            // itself, and may find it full
             ssl.drainBioSendPipe(socketDescriptor);
             cb::net::set_ewouldblock();
             return -1;
@@ -882,6 +937,7 @@ int Connection::recv(char* dest, size_t nbytes) {
             res = sslRead(dest, nbytes);
         }
     } else {
+        get_thread_stats(this)->recv_syscalls++;
         res = (int)::cb::net::recv(socketDescriptor, dest, nbytes, 0);
         if (res > 0) {
             totalRecv += res;
@@ -893,7 +949,9 @@ int Connection::recv(char* dest, size_t nbytes) {
 
 ssize_t Connection::sendmsg(struct msghdr* m) {
     ssize_t res = 0;
-    if (ssl.isEnabled()) {
+    // With kernel TLS offload for sending, the kernel encrypts whatever we
+    // write to the socket so we can send the plaintext iovecs directly.
+    if (ssl.isEnabled() && !ssl.isKtlsSend()) {
         for (int ii = 0; ii < int(m->msg_iovlen); ++ii) {
             int n = sslWrite(reinterpret_cast<char*>(m->msg_iov[ii].iov_base),
                              m->msg_iov[ii].iov_len);
@@ -926,6 +984,7 @@ ssize_t Connection::sendmsg(struct msghdr* m) {
         ssl.drainBioSendPipe(socketDescriptor);
         return res;
     } else {
+        get_thread_stats(this)->send_syscalls++;
         res = cb::net::sendmsg(socketDescriptor, m, 0);
         if (res > 0) {
             totalSend += res;
@@ -989,6 +1048,13 @@ Connection::TransmitResult Connection::transmit() {
         // buffer to send to the client). Go ahead and send more data
     }
 
+    if (!transmitStarted) {
+        transmitStarted = true;
+        if (!corked.empty()) {
+            attachCorkedResponses();
+        }
+    }
+
     while (msgcurr < msglist.size() && msglist[msgcurr].msg_iovlen == 0) {
         /* Finished writing the current msg; advance to the next. */
         msgcurr++;
@@ -1002,6 +1068,7 @@ Connection::TransmitResult Connection::transmit() {
         auto error = cb::net::get_socket_error();
         if (res > 0) {
             get_thread_stats(this)->bytes_written += res;
+            sentThisEvent += res;
 
             if (adjust_msghdr(*write, m, res) == 0) {
                 msgcurr++;
@@ -1218,7 +1285,9 @@ int Connection::sslWrite(const char* src, size_t nbytes) {
             const int error = ssl.getError(n);
             if (error == SSL_ERROR_WANT_WRITE) {
                 ssl.drainBioSendPipe(socketDescriptor);
-                if (ssl.morePendingOutput()) {
+                // In kTLS mode OpenSSL writes the socket directly, so it
+                // is the socket which is full
+                if (ssl.isDirect() || ssl.morePendingOutput()) {
                     cb::net::set_ewouldblock();
                     return -1;
                 }
@@ -1243,12 +1312,20 @@ bool Connection::useCookieSendResponse(std::size_t size) const {
     // the value. (when the cost of copying exceeds the cost of creating
     // two (or 3) extra TLS frames. Start by keep it fixed to see if it
     // makes any difference in showfast.
+    // With kernel TLS offload for sending each IO vector isn't a separate
+    // TLS frame, so there is nothing to gain by the copy.
     static constexpr std::size_t SslCopyLimit = 4096;
-    return isSslEnabled() && size < SslCopyLimit;
+    return isSslEnabled() && !ssl.isKtlsSend() && size < SslCopyLimit;
 }
 
 bool Connection::dcpUseWriteBuffer(size_t size) const {
-    return isSslEnabled() && size < write->wsize();
+    // With TLS each IO vector entry is written (and encrypted) separately, so
+    // small messages are copied into the write buffer to send them in as few
+    // TLS frames as possible. Messages which don't fit a single frame gain
+    // nothing from that, so they reference the item's value directly (the
+    // item is reserved until it has been sent) instead of copying it.
+    return isSslEnabled() && !ssl.isKtlsSend() && size <= TlsFrameSize &&
+           size < write->wsize();
 }
 
 void Connection::addMsgHdr(bool reset) {
@@ -1256,6 +1333,7 @@ void Connection::addMsgHdr(bool reset) {
         msgcurr = 0;
         msglist.clear();
         iovused = 0;
+        transmitStarted = false;
     }
 
     msglist.emplace_back();
@@ -1266,7 +1344,7 @@ void Connection::addMsgHdr(bool reset) {
        msg_flags, the last 3 of which aren't defined on solaris: */
     memset(&msg, 0, sizeof(struct msghdr));
 
-    msg.msg_iov = &iov.data()[iovused];
+    msg.msg_iov = iov.data() + iovused;
 
     msgbytes = 0;
     STATS_MAX(this, msgused_high_watermark, gsl::narrow<int>(msglist.size()));
@@ -1325,8 +1403,9 @@ void Connection::ensureIovSpace() {
         return;
     }
 
-    // Try to double the size of the array
-    iov.resize(iov.size() * 2);
+    // Try to double the size of the array (it is empty after
+    // releaseIoVectors())
+    iov.resize(std::max(iov.size() * 2, size_t(IOV_LIST_INITIAL)));
 
     /* Point all the msghdr structures at the new list. */
     size_t ii;
@@ -1337,8 +1416,35 @@ void Connection::ensureIovSpace() {
     }
 }
 
+void Connection::attachCorkedResponses() {
+    // The buffers alternate, so their capacity is reused
+    corkedSending.swap(corked);
+
+    if (msglist.empty()) {
+        addMsgHdr(false);
+    }
+    ensureIovSpace();
+    std::move_backward(
+            iov.begin(), iov.begin() + iovused, iov.begin() + iovused + 1);
+    iov[0].iov_base = corkedSending.data();
+    iov[0].iov_len = corkedSending.size();
+    ++iovused;
+    if (msglist.front().msg_iovlen == IOV_MAX) {
+        msglist.emplace(msglist.begin());
+        memset(&msglist.front(), 0, sizeof(struct msghdr));
+    }
+    msglist.front().msg_iovlen++;
+
+    // Point the message headers at their (moved) entries
+    size_t iovnum = 0;
+    for (auto& msg : msglist) {
+        msg.msg_iov = &iov[iovnum];
+        iovnum += msg.msg_iovlen;
+    }
+}
+
 bool Connection::enableSSL(const std::string& cert, const std::string& pkey) {
-    if (ssl.enable(cert, pkey)) {
+    if (ssl.enable(cert, pkey, socketDescriptor)) {
         if (Settings::instance().getVerbose() > 1) {
             ssl.dumpCipherList(getId());
         }
@@ -1504,12 +1610,25 @@ bool Connection::processServerEvents() {
 }
 
 void Connection::runEventLoop(short which) {
+    const auto cpuStart = cb::getThreadCpuTime();
     conn_loan_buffers(this);
     currentEvent = which;
     numEvents = max_reqs_per_event;
+    sentThisEvent = 0;
+    eventBudget = std::chrono::microseconds(
+            Settings::instance().getEventTimeBudget());
+    if (eventBudget.count() != 0) {
+        eventStart = commandStart = std::chrono::steady_clock::now();
+        scheduler_fairness[thread.index].events++;
+    }
+    // The TLS layer moves data to and from the socket on its own schedule;
+    // account for the system calls it made while serving this event.
+    const auto sslRecvCalls = ssl.getRecvCalls();
+    const auto sslSendCalls = ssl.getSendCalls();
 
     try {
         runStateMachinery();
+        flushCorkedResponses();
     } catch (const std::exception& e) {
         bool logged = false;
         if (getState() == StateMachine::State::execute ||
@@ -1576,7 +1695,342 @@ void Connection::runEventLoop(short which) {
         }
     }
 
+    if (eventBudget.count() != 0) {
+        const auto used = std::chrono::steady_clock::now() - eventStart;
+        if (used > eventBudget) {
+            auto& fairness = scheduler_fairness[thread.index];
+            fairness.overruns++;
+            fairness.overrun_usec +=
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            used - eventBudget)
+                            .count();
+        }
+    }
+
+    if (ssl.getRecvCalls() != sslRecvCalls ||
+        ssl.getSendCalls() != sslSendCalls) {
+        auto* stats = get_thread_stats(this);
+        stats->recv_syscalls += ssl.getRecvCalls() - sslRecvCalls;
+        stats->send_syscalls += ssl.getSendCalls() - sslSendCalls;
+    }
+
     conn_return_buffers(this);
+
+    // Charged to the bucket the connection is bound to at the end of the
+    // event (a SelectBucket charges the whole event to the new bucket).
+    get_thread_stats(this)->cpu_time_ns +=
+            (cb::getThreadCpuTime() - cpuStart).count();
+}
+
+bool Connection::consumeEventBudget() {
+    if (eventBudget.count() == 0) {
+        return --numEvents >= 0;
+    }
+
+    // Update the cost estimate with the command which just completed
+    // (weight 1/8 so a single slow command doesn't dominate).
+    const auto now = std::chrono::steady_clock::now();
+    const auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now - commandStart);
+    commandCost += (cost - commandCost) / 8;
+    commandStart = now;
+
+    auto& fairness = scheduler_fairness[thread.index];
+    // Stop if running another command of the typical cost for this
+    // connection would take us past the budget. Connections with cheap
+    // commands get to run many of them per timeslice, while bulk
+    // operations only get as much time as anyone else.
+    if ((now - eventStart) + commandCost > eventBudget) {
+        fairness.budget_yields++;
+        return false;
+    }
+    fairness.commands++;
+    return true;
+}
+
+bool Connection::isSendBudgetExhausted() const {
+    const auto max = Settings::instance().getMaxSendPerEvent();
+    return max != 0 && sentThisEvent >= max;
+}
+
+void Connection::countResponse(cb::mcbp::Status status) {
+    getBucket().countResponse(thread.index, status);
+}
+
+bool Connection::corkResponse() {
+    // Only while another command will run straight away to produce the
+    // next response. With TLS in userspace every IO vector entry is written
+    // separately anyway.
+    const auto limit = Settings::instance().getResponseCorkSize();
+    if (limit == 0 || transmitStarted ||
+        write_and_go != StateMachine::State::new_cmd || isDCP() ||
+        (isSslEnabled() && !ssl.isKtlsSend()) || !isPacketAvailable()) {
+        return false;
+    }
+
+    size_t size = 0;
+    for (const auto& msg : msglist) {
+        for (size_t ii = 0; ii < size_t(msg.msg_iovlen); ++ii) {
+            size += msg.msg_iov[ii].iov_len;
+        }
+    }
+    if (size == 0 || corked.size() + size > limit) {
+        return false;
+    }
+
+    for (const auto& msg : msglist) {
+        for (size_t ii = 0; ii < size_t(msg.msg_iovlen); ++ii) {
+            const auto* data =
+                    static_cast<const uint8_t*>(msg.msg_iov[ii].iov_base);
+            corked.insert(
+                    corked.end(), data, data + msg.msg_iov[ii].iov_len);
+        }
+    }
+
+    // The response no longer references anything
+    releaseTempAlloc();
+    releaseReservedItems();
+    write->clear();
+    msgcurr = 0;
+    msglist.clear();
+    iovused = 0;
+    get_thread_stats(this)->responses_corked++;
+    return true;
+}
+
+void Connection::flushCorkedResponses() {
+    if (corked.empty()) {
+        return;
+    }
+
+    switch (getState()) {
+    case StateMachine::State::closing:
+    case StateMachine::State::pending_close:
+    case StateMachine::State::immediate_close:
+    case StateMachine::State::destroyed:
+        corked.clear();
+        return;
+    default:
+        break;
+    }
+
+    struct iovec vec;
+    vec.iov_base = corked.data();
+    vec.iov_len = corked.size();
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &vec;
+    msg.msg_iovlen = 1;
+
+    // Errors (and whatever the socket didn't accept) are dealt with when
+    // the next response is transmitted
+    const auto res = sendmsg(&msg);
+    if (res > 0) {
+        get_thread_stats(this)->bytes_written += res;
+        sentThisEvent += res;
+        corked.erase(corked.begin(), corked.begin() + res);
+    }
+}
+
+/**
+ * The commands which may be reordered on a connection allowing unordered
+ * execution; they only depend on earlier commands operating on the same
+ * document. Everything else (Noop, stats, DCP, bucket management etc.) is
+ * executed in order with respect to all other commands.
+ */
+static bool isReorderable(cb::mcbp::ClientOpcode opcode) {
+    using cb::mcbp::ClientOpcode;
+    switch (opcode) {
+    case ClientOpcode::Get:
+    case ClientOpcode::Getq:
+    case ClientOpcode::Getk:
+    case ClientOpcode::Getkq:
+    case ClientOpcode::GetReplica:
+    case ClientOpcode::GetLocked:
+    case ClientOpcode::UnlockKey:
+    case ClientOpcode::Gat:
+    case ClientOpcode::Gatq:
+    case ClientOpcode::Touch:
+    case ClientOpcode::GetMeta:
+    case ClientOpcode::Set:
+    case ClientOpcode::Setq:
+    case ClientOpcode::Add:
+    case ClientOpcode::Addq:
+    case ClientOpcode::Replace:
+    case ClientOpcode::Replaceq:
+    case ClientOpcode::Delete:
+    case ClientOpcode::Deleteq:
+    case ClientOpcode::Append:
+    case ClientOpcode::Appendq:
+    case ClientOpcode::Prepend:
+    case ClientOpcode::Prependq:
+    case ClientOpcode::Increment:
+    case ClientOpcode::Incrementq:
+    case ClientOpcode::Decrement:
+    case ClientOpcode::Decrementq:
+    case ClientOpcode::SubdocGet:
+    case ClientOpcode::SubdocExists:
+    case ClientOpcode::SubdocGetCount:
+    case ClientOpcode::SubdocMultiLookup:
+    case ClientOpcode::SubdocMultiMutation:
+    case ClientOpcode::SubdocDictAdd:
+    case ClientOpcode::SubdocDictUpsert:
+    case ClientOpcode::SubdocDelete:
+    case ClientOpcode::SubdocReplace:
+    case ClientOpcode::SubdocArrayPushLast:
+    case ClientOpcode::SubdocArrayPushFirst:
+    case ClientOpcode::SubdocArrayInsert:
+    case ClientOpcode::SubdocArrayAddUnique:
+    case ClientOpcode::SubdocCounter:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// @return true if both (request) cookies operate on the same document
+static bool isSameDocument(const Cookie& a, const Cookie& b) {
+    const auto& ra = a.getRequest();
+    const auto& rb = b.getRequest();
+    const auto ka = ra.getKey();
+    const auto kb = rb.getKey();
+    return ra.getVBucket() == rb.getVBucket() && ka.size() == kb.size() &&
+           std::equal(ka.begin(), ka.end(), kb.begin());
+}
+
+bool Connection::parkCookie(bool blocked) {
+    if (!allowUnorderedExecution()) {
+        return false;
+    }
+
+    auto& cookie = *cookies.front();
+    const auto& header = cookie.getHeader();
+    bool reorderable = false;
+    if (header.isRequest()) {
+        const auto& request = header.getRequest();
+        reorderable = cb::mcbp::is_client_magic(request.getMagic()) &&
+                      isReorderable(request.getClientOpcode());
+        if (reorderable) {
+            // The client may request the command to be a barrier
+            request.parseFrameExtras(
+                    [&reorderable](cb::mcbp::request::FrameInfoId id,
+                                   cb::const_byte_buffer) -> bool {
+                        if (id == cb::mcbp::request::FrameInfoId::Barrier) {
+                            reorderable = false;
+                            return false;
+                        }
+                        return true;
+                    });
+        }
+    }
+
+    if (cookie.getParkState() != Cookie::ParkState::None) {
+        // A parked command which was resumed and blocked again. It already
+        // owns a copy of its packet (and it is no longer in the input
+        // buffer) so just put it back unless it is a barrier, which keeps
+        // the connection blocked until it completes.
+        if (!blocked || !reorderable) {
+            return false;
+        }
+        cookie.setParkState(Cookie::ParkState::Blocked);
+        // It was parked before any ordered command (no command is started
+        // once one is parked), and those must still wait for it.
+        auto pos = std::find_if(cookies.begin() + 1,
+                                cookies.end(),
+                                [](const std::unique_ptr<Cookie>& c) {
+                                    return c->getParkState() ==
+                                           Cookie::ParkState::Ordered;
+                                });
+        auto parked = std::move(cookies.front());
+        cookies.front() = std::unique_ptr<Cookie>{new Cookie(*this)};
+        cookies.insert(pos, std::move(parked));
+        return true;
+    }
+
+    if (blocked) {
+        if (!reorderable ||
+            cookies.size() >=
+                    Settings::instance()
+                            .getMaxConcurrentCommandsPerConnection()) {
+            return false;
+        }
+    } else {
+        if (cookies.size() == 1) {
+            // Nothing parked to wait for
+            return false;
+        }
+        if (reorderable &&
+            std::none_of(cookies.begin() + 1,
+                         cookies.end(),
+                         [&cookie](const std::unique_ptr<Cookie>& c) {
+                             return isSameDocument(*c, cookie);
+                         })) {
+            return false;
+        }
+    }
+
+    // The input buffer is reused for the following commands, so the cookie
+    // needs its own copy of the packet
+    cookie.preserveRequest();
+    read->consume([&cookie](cb::const_byte_buffer buffer) -> ssize_t {
+        size_t size = cookie.getPacket(Cookie::PacketContent::Full).size();
+        if (size > buffer.size()) {
+            throw std::logic_error(
+                    "Connection::parkCookie: Not enough data in input buffer");
+        }
+        return gsl::narrow<ssize_t>(size);
+    });
+    cookie.setParkState(blocked ? Cookie::ParkState::Blocked
+                                : Cookie::ParkState::Ordered);
+
+    cookies.push_back(std::move(cookies.front()));
+    cookies.front() = std::unique_ptr<Cookie>{new Cookie(*this)};
+    return true;
+}
+
+/**
+ * Locate the first parked cookie which may be executed: a blocked command
+ * which the engine has notified, or an ordered command once all of the
+ * commands parked before it completed.
+ *
+ * @return the index of the cookie, or 0 if none of them may run
+ */
+static size_t findRunnableParkedCookie(
+        const std::vector<std::unique_ptr<Cookie>>& cookies) {
+    for (size_t ii = 1; ii < cookies.size(); ++ii) {
+        const auto& cookie = *cookies[ii];
+        if (cookie.getParkState() == Cookie::ParkState::Ordered) {
+            if (ii == 1) {
+                return ii;
+            }
+        } else if (!cookie.isEwouldblock()) {
+            return ii;
+        }
+    }
+    return 0;
+}
+
+bool Connection::resumeParkedCookie() {
+    const auto idx = findRunnableParkedCookie(cookies);
+    if (idx == 0) {
+        return false;
+    }
+    cookies.front() = std::move(cookies[idx]);
+    cookies.erase(cookies.begin() + idx);
+    return true;
+}
+
+bool Connection::hasRunnableParkedCookie() const {
+    return findRunnableParkedCookie(cookies) != 0;
+}
+
+bool Connection::hasOrderedParkedCookie() const {
+    return std::any_of(cookies.begin() + 1,
+                       cookies.end(),
+                       [](const std::unique_ptr<Cookie>& c) {
+                           return c->getParkState() ==
+                                  Cookie::ParkState::Ordered;
+                       });
 }
 
 bool Connection::close() {
@@ -2652,6 +3106,34 @@ ENGINE_ERROR_CODE Connection::abort(uint32_t opaque,
     return add_packet_to_send_pipe(builder.getFrame()->getFrame());
 }
 
+ENGINE_ERROR_CODE Connection::seqno_advanced(uint32_t opaque,
+                                             Vbid vbucket,
+                                             uint64_t seqno,
+                                             cb::mcbp::DcpStreamId sid) {
+    using Framebuilder = cb::mcbp::FrameBuilder<cb::mcbp::Request>;
+    using cb::mcbp::Request;
+    using cb::mcbp::request::DcpSeqnoAdvancedPayload;
+    uint8_t buffer[sizeof(Request) + sizeof(DcpSeqnoAdvancedPayload) +
+                   sizeof(cb::mcbp::DcpStreamIdFrameInfo)];
+
+    Framebuilder builder({buffer, sizeof(buffer)});
+    builder.setMagic(sid ? cb::mcbp::Magic::AltClientRequest
+                         : cb::mcbp::Magic::ClientRequest);
+    builder.setOpcode(cb::mcbp::ClientOpcode::DcpSeqnoAdvanced);
+    builder.setOpaque(opaque);
+    builder.setVBucket(vbucket);
+
+    DcpSeqnoAdvancedPayload payload(seqno);
+    builder.setExtras(payload.getBuffer());
+
+    if (sid) {
+        cb::mcbp::DcpStreamIdFrameInfo framedSid(sid);
+        builder.setFramingExtras(framedSid.getBuf());
+    }
+
+    return add_packet_to_send_pipe(builder.getFrame()->getFrame());
+}
+
 ////////////////////////////////////////////////////////////////////////////
 //                                                                        //
 //               End DCP Message producer interface                       //
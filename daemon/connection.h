@@ -18,6 +18,7 @@
 
 #include "datatype.h"
 #include "dynamic_buffer.h"
+#include "mcbp_frame_batch.h"
 #include "ssl_context.h"
 #include "statemachine.h"
 #include "stats.h"
@@ -36,6 +37,7 @@
 #include <platform/socket.h>
 
 #include <array>
+#include <bitset>
 #include <chrono>
 #include <memory>
 #include <queue>
@@ -271,6 +273,25 @@ public:
      */
     cb::engine_errc dropPrivilege(cb::rbac::Privilege privilege);
 
+    /**
+     * Check if we've already verified that the current privilege context
+     * grants access to the provided opcode (so the privilege chain for
+     * the command don't need to be evaluated again)
+     */
+    bool isOpcodeAuthorized(cb::mcbp::ClientOpcode opcode) const {
+        return authorizedOpcodes.test(uint8_t(opcode)) &&
+               !privilegeContext.isStale();
+    }
+
+    /**
+     * Remember that the current privilege context grants access to the
+     * provided opcode. The cache is reset every time the privilege
+     * context change.
+     */
+    void setOpcodeAuthorized(cb::mcbp::ClientOpcode opcode) {
+        authorizedOpcodes.set(uint8_t(opcode));
+    }
+
     int getBucketIndex() const {
         return bucketIndex.load(std::memory_order_relaxed);
     }
@@ -334,6 +355,14 @@ public:
         Connection::cccp.store(cccp, std::memory_order_release);
     }
 
+    bool isClustermapChangeNotificationDeltaSupported() const {
+        return cccp_delta;
+    }
+
+    void setClustermapChangeNotificationDeltaSupported(bool cccp_delta) {
+        Connection::cccp_delta = cccp_delta;
+    }
+
     bool allowUnorderedExecution() const {
         return allow_unordered_execution;
     }
@@ -453,6 +482,94 @@ public:
         return --numEvents;
     }
 
+    /**
+     * Check if the connection may run another command in this timeslice
+     * of the worker thread, or if it should back off to let other
+     * connections run.
+     *
+     * With an event time budget configured the decision is based on the
+     * time used so far in this timeslice and the observed cost of the
+     * commands this connection runs; otherwise the connection may run
+     * max_reqs_per_event commands.
+     *
+     * @return true if the connection may run another command
+     */
+    bool consumeEventBudget();
+
+    /**
+     * Check if the connection has sent max_send_per_event bytes in this
+     * timeslice of the worker thread, and should back off (with the rest
+     * of the response pending) to let other connections run. A large
+     * response is then sent in slices interleaved with the other
+     * connections' work, rather than in one go.
+     */
+    bool isSendBudgetExhausted() const;
+
+    /**
+     * Count a response with the given status sent to the client (in the
+     * connected bucket's counters for this front-end thread)
+     */
+    void countResponse(cb::mcbp::Status status);
+
+    /**
+     * Hold back the response about to be sent if another pipelined command
+     * is ready to execute, and fewer than response_cork_size bytes of
+     * responses are held back. The response is copied aside (releasing
+     * everything it references) and sent ahead of the next response which
+     * isn't held back, in the same sendmsg() call.
+     *
+     * @return true if the response was held back
+     */
+    bool corkResponse();
+
+    /**
+     * Send what the socket accepts of the responses held back, without
+     * waiting for it to become writable. Called when the connection stops
+     * executing commands (it blocked, yielded or ran out of input) so the
+     * client isn't kept waiting for them; the rest goes out ahead of the
+     * next response.
+     */
+    void flushCorkedResponses();
+
+    /**
+     * Park the command of the current cookie, if the connection allows
+     * unordered execution, so that the following commands may run:
+     *
+     *   * a command which blocked (returned EWOULDBLOCK) is parked as
+     *     Blocked if it may be reordered, and the connection has fewer than
+     *     Settings::getMaxConcurrentCommandsPerConnection() commands in
+     *     flight. It resumes once notified; if it blocks again it is
+     *     parked back ahead of any Ordered command.
+     *   * a command which hasn't started is parked as Ordered if it must
+     *     not run ahead of the parked commands (it can't be reordered, or
+     *     it is for the same document). No further commands are started
+     *     until it has run.
+     *
+     * The packet of a parked cookie is preserved and consumed from the
+     * input, and a new cookie becomes the current cookie.
+     *
+     * @param blocked true if the current command returned EWOULDBLOCK,
+     *                false if it is about to be executed
+     * @return true if the cookie was parked
+     */
+    bool parkCookie(bool blocked);
+
+    /**
+     * Make a parked cookie which may run (a notified Blocked command, or an
+     * Ordered command with no commands parked ahead of it) the current
+     * cookie, replacing the (idle) current cookie.
+     *
+     * @return true if a parked cookie was resumed
+     */
+    bool resumeParkedCookie();
+
+    /// @return true if any of the parked cookies may run
+    bool hasRunnableParkedCookie() const;
+
+    /// @return true if an Ordered command is parked, so no further commands
+    ///         may start
+    bool hasOrderedParkedCookie() const;
+
     /**
      * Set the number of events to process per timeslice of the worker
      * thread before yielding.
@@ -516,6 +633,14 @@ public:
      */
     void shrinkBuffers();
 
+    /**
+     * Release the sendmsg() iov and msghdr lists of an idle connection
+     * (one waiting for its next request); they're allocated again by the
+     * next response. No-op if the connection is in any other state, as a
+     * partially sent response may still reference them.
+     */
+    void releaseIoVectors();
+
     /**
      * Receive data from the socket
      *
@@ -645,12 +770,23 @@ public:
             cb_free(ptr);
         }
         temp_alloc.resize(0);
+        shared_buffers.clear();
+        corkedSending.clear();
     }
 
     void pushTempAlloc(char* ptr) {
         temp_alloc.push_back(ptr);
     }
 
+    /**
+     * Keep a reference to the buffer until the connection is done sending
+     * all of the data (so that we may add the buffer to the iovector
+     * instead of copying it into the write buffer)
+     */
+    void pushSharedBuffer(std::shared_ptr<const std::string> buffer) {
+        shared_buffers.emplace_back(std::move(buffer));
+    }
+
     /**
      * Enable the datatype which corresponds to the feature
      *
@@ -768,6 +904,11 @@ public:
         return *cookies.front();
     }
 
+    /// The pre-validated frames at the head of the read buffer
+    FrameBatch& getInputFrames() {
+        return inputFrames;
+    }
+
     /**
      * Get the number of cookies currently bound to this connection
      */
@@ -962,6 +1103,11 @@ public:
                             uint64_t prepared_seqno,
                             uint64_t abort_seqno) override;
 
+    ENGINE_ERROR_CODE seqno_advanced(uint32_t opaque,
+                                     Vbid vbucket,
+                                     uint64_t seqno,
+                                     cb::mcbp::DcpStreamId sid) override;
+
 protected:
     /**
      * Protected constructor so that it may only be used by MockSubclasses
@@ -992,6 +1138,12 @@ protected:
      */
     void ensureIovSpace();
 
+    /**
+     * Put the responses held back by corkResponse() in front of the
+     * response about to be transmitted.
+     */
+    void attachCorkedResponses();
+
     /**
      * Try to enable SSL for this connection
      *
@@ -1064,6 +1216,19 @@ protected:
      */
     cb::rbac::PrivilegeContext privilegeContext{cb::sasl::Domain::Local};
 
+    /**
+     * The opcodes we've already checked that privilegeContext grants
+     * access to. Must be cleared every time privilegeContext is modified
+     * (use setPrivilegeContext())
+     */
+    std::bitset<0x100> authorizedOpcodes;
+
+    /// Install a new privilege context (and reset authorizedOpcodes)
+    void setPrivilegeContext(cb::rbac::PrivilegeContext context) {
+        privilegeContext = std::move(context);
+        authorizedOpcodes.reset();
+    }
+
     /**
      * The SASL object used to do sasl authentication
      */
@@ -1143,6 +1308,10 @@ protected:
 
     std::atomic_bool cccp{false};
 
+    /// Does the client want to receive the vBucket map changes instead of
+    /// the full cluster map (when possible)
+    bool cccp_delta{false};
+
     bool allow_unordered_execution{false};
 
     std::queue<std::unique_ptr<ServerEvent>> server_events;
@@ -1203,6 +1372,33 @@ protected:
      */
     int numEvents = 0;
 
+    /**
+     * The time this connection may use in a single worker thread
+     * timeslice (0 if limited by numEvents instead)
+     */
+    std::chrono::nanoseconds eventBudget{0};
+
+    /// When the current worker thread timeslice started
+    std::chrono::steady_clock::time_point eventStart;
+
+    /// When the last command in the current timeslice started
+    std::chrono::steady_clock::time_point commandStart;
+
+    /// Moving average of the time spent per command by this connection
+    std::chrono::nanoseconds commandCost{0};
+
+    /// The number of bytes sent in the current worker thread timeslice
+    size_t sentThisEvent = 0;
+
+    /// Responses held back by corkResponse()
+    std::vector<uint8_t> corked;
+
+    /// Responses held back which are being sent with the current response
+    std::vector<uint8_t> corkedSending;
+
+    /// Set once transmit() has started sending the current response
+    bool transmitStarted = false;
+
     // Members related to libevent
 
     /** Is the connection currently registered in libevent? */
@@ -1224,6 +1420,9 @@ protected:
     /** which state to go into after finishing current write */
     StateMachine::State write_and_go = StateMachine::State::new_cmd;
 
+    /// Frames decoded (but not yet parsed) from the read buffer
+    FrameBatch inputFrames;
+
     /* data for the mwrite state */
     std::vector<iovec> iov;
     /** number of elements used in iov[] */
@@ -1250,6 +1449,9 @@ protected:
      */
     std::vector<char*> temp_alloc;
 
+    /// Buffers shared with others (see pushSharedBuffer)
+    std::vector<std::shared_ptr<const std::string>> shared_buffers;
+
     /**
      * If the client enabled the mutation seqno feature each mutation
      * command will return the vbucket UUID and sequence number for the
@@ -1268,12 +1470,10 @@ protected:
     size_t totalSend = 0;
 
     /**
-     * The list of commands currently being processed. Currently we
-     * only use a single entry in this vector (and always reuse that
-     * object for all commands), but when the client tries to
-     * enable unordered execution we may operate with multiple
-     * commands at the same time and they're all stored in this
-     * vector)
+     * The list of commands currently being processed. The first entry is
+     * the current cookie (which is reused for all commands); when the
+     * client enabled unordered execution the commands which were parked
+     * (see parkCookie()) follow it, in the order they were received.
      */
     std::vector<std::unique_ptr<Cookie>> cookies;
 
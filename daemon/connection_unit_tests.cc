@@ -15,12 +15,15 @@
  */
 
 #include "connection.h"
+#include "cookie.h"
 #include "enginemap.h"
 #include "front_end_thread.h"
 #include "log_macros.h"
 #include "memcached.h"
 
 #include <folly/portability/GTest.h>
+#include <mcbp/protocol/framebuilder.h>
+#include <platform/pipe.h>
 
 /// A mock connection which doesn't own a socket and isn't bound to libevent
 class MockConnection : public Connection {
@@ -80,3 +83,127 @@ TEST_F(ConnectionUnitTests, AddIov) {
     ASSERT_EQ(reinterpret_cast<const void*>(0x200), iov[1].iov_base);
     ASSERT_EQ(0x200, iov[1].iov_len);
 }
+
+/// A connection allowing unordered execution with a pipeline of GET
+/// requests in its input buffer
+class ConnectionParkTests : public ConnectionUnitTests {
+protected:
+    void SetUp() override {
+        connection.setAllowUnorderedExecution(true);
+        connection.read = std::make_unique<cb::Pipe>(1024);
+    }
+
+    /// Add a GET request for the key to the input buffer
+    void addGet(const std::string& key) {
+        std::vector<uint8_t> frame(sizeof(cb::mcbp::Request) + key.size());
+        cb::mcbp::RequestBuilder builder({frame.data(), frame.size()});
+        builder.setMagic(cb::mcbp::Magic::ClientRequest);
+        builder.setOpcode(cb::mcbp::ClientOpcode::Get);
+        builder.setKey(key);
+        connection.read->produce([&frame](cb::byte_buffer buffer) -> ssize_t {
+            std::copy(frame.begin(), frame.end(), buffer.begin());
+            return frame.size();
+        });
+    }
+
+    /// Let the current cookie reference the next packet in the input buffer
+    Cookie& nextCommand() {
+        auto& cookie = connection.getCookieObject();
+        cookie.reset();
+        auto input = connection.read->rdata();
+        const auto* req =
+                reinterpret_cast<const cb::mcbp::Request*>(input.data());
+        cookie.setPacket(Cookie::PacketContent::Full, req->getFrame());
+        return cookie;
+    }
+};
+
+TEST_F(ConnectionParkTests, BlockedCommandIsParked) {
+    addGet("blocked");
+    addGet("other");
+    addGet("blocked");
+
+    // The first command blocks and is parked
+    auto& first = nextCommand();
+    first.setEwouldblock(true);
+    ASSERT_TRUE(connection.parkCookie(true));
+    EXPECT_EQ(2, connection.getNumberOfCookies());
+    EXPECT_EQ(Cookie::ParkState::Blocked, first.getParkState());
+    EXPECT_FALSE(connection.hasRunnableParkedCookie());
+    EXPECT_NE(&first, &connection.getCookieObject());
+
+    // A command for another document may run ahead of it
+    nextCommand();
+    EXPECT_FALSE(connection.parkCookie(false));
+    connection.read->consume([](cb::const_byte_buffer) -> ssize_t {
+        return sizeof(cb::mcbp::Request) + 5;
+    });
+
+    // .. but not a command for the same document
+    auto& third = nextCommand();
+    ASSERT_TRUE(connection.parkCookie(false));
+    EXPECT_EQ(Cookie::ParkState::Ordered, third.getParkState());
+    EXPECT_TRUE(connection.hasOrderedParkedCookie());
+    EXPECT_FALSE(connection.hasRunnableParkedCookie());
+    EXPECT_TRUE(connection.read->empty());
+
+    // Once notified the blocked command resumes (with its own copy of the
+    // packet), followed by the ordered command
+    first.setEwouldblock(false);
+    ASSERT_TRUE(connection.resumeParkedCookie());
+    EXPECT_EQ(&first, &connection.getCookieObject());
+    EXPECT_EQ("blocked",
+              std::string(reinterpret_cast<const char*>(
+                                  first.getRequest().getKey().data()),
+                          first.getRequest().getKey().size()));
+
+    connection.getCookieObject().reset();
+    ASSERT_TRUE(connection.resumeParkedCookie());
+    EXPECT_EQ(&third, &connection.getCookieObject());
+    EXPECT_EQ(1, connection.getNumberOfCookies());
+}
+
+TEST_F(ConnectionParkTests, ResumedCommandBlocksAgain) {
+    addGet("blocked");
+    addGet("blocked");
+
+    auto& first = nextCommand();
+    first.setEwouldblock(true);
+    ASSERT_TRUE(connection.parkCookie(true));
+    auto& second = nextCommand();
+    ASSERT_TRUE(connection.parkCookie(false));
+    EXPECT_EQ(Cookie::ParkState::Ordered, second.getParkState());
+
+    // The blocked command is notified, resumes and blocks again (e.g. a
+    // background fetch followed by a durable write)
+    first.setEwouldblock(false);
+    ASSERT_TRUE(connection.resumeParkedCookie());
+    EXPECT_EQ(&first, &connection.getCookieObject());
+    first.setEwouldblock(true);
+    ASSERT_TRUE(connection.parkCookie(true));
+    EXPECT_EQ(3, connection.getNumberOfCookies());
+
+    // The ordered command still waits for it, and no new command starts
+    EXPECT_TRUE(connection.hasOrderedParkedCookie());
+    EXPECT_FALSE(connection.hasRunnableParkedCookie());
+    EXPECT_FALSE(connection.resumeParkedCookie());
+
+    first.setEwouldblock(false);
+    ASSERT_TRUE(connection.resumeParkedCookie());
+    EXPECT_EQ(&first, &connection.getCookieObject());
+    connection.getCookieObject().reset();
+    ASSERT_TRUE(connection.resumeParkedCookie());
+    EXPECT_EQ(&second, &connection.getCookieObject());
+    EXPECT_EQ(1, connection.getNumberOfCookies());
+}
+
+TEST_F(ConnectionParkTests, OrderedExecution) {
+    connection.setAllowUnorderedExecution(false);
+    addGet("blocked");
+
+    auto& cookie = nextCommand();
+    cookie.setEwouldblock(true);
+    EXPECT_FALSE(connection.parkCookie(true));
+    EXPECT_EQ(1, connection.getNumberOfCookies());
+    cookie.setEwouldblock(false);
+}
@@ -52,12 +52,15 @@ enum class BufferLoan {
 
 /** Function prototypes ******************************************************/
 
-static BufferLoan loan_single_buffer(Connection& c,
-                                     std::unique_ptr<cb::Pipe>& thread_buf,
-                                     std::unique_ptr<cb::Pipe>& conn_buf);
-static void maybe_return_single_buffer(Connection& c,
-                                       std::unique_ptr<cb::Pipe>& thread_buf,
-                                       std::unique_ptr<cb::Pipe>& conn_buf);
+static BufferLoan loan_single_buffer(
+        Connection& c,
+        std::vector<std::unique_ptr<cb::Pipe>>& pool,
+        buffer_pool_stats::Pool& pool_stats,
+        std::unique_ptr<cb::Pipe>& conn_buf);
+static void maybe_return_single_buffer(
+        std::vector<std::unique_ptr<cb::Pipe>>& pool,
+        buffer_pool_stats::Pool& pool_stats,
+        std::unique_ptr<cb::Pipe>& conn_buf);
 static void conn_destructor(Connection* c);
 static Connection* allocate_connection(SOCKET sfd,
                                        event_base* base,
@@ -151,7 +154,9 @@ void run_event_loop(Connection* c, short which) {
     using namespace std::chrono;
     const auto ns = duration_cast<nanoseconds>(stop - start);
     c->addCpuTime(ns);
-    scheduler_info[c->getThread().index].add(duration_cast<microseconds>(ns));
+    const auto us = duration_cast<microseconds>(ns);
+    scheduler_info[c->getThread().index].add(us);
+    thread_loads[c->getThread().index].busy_usec += us.count();
 
     if (c->shouldDelete()) {
         release_connection(c);
@@ -193,7 +198,10 @@ void conn_loan_buffers(Connection* c) {
     }
 
     auto* ts = get_thread_stats(c);
-    switch (loan_single_buffer(*c, c->getThread().read, c->read)) {
+    auto& thread = c->getThread();
+    auto& pool_stats = buffer_pools[thread.index];
+    switch (loan_single_buffer(
+            *c, thread.readPool, pool_stats.read, c->read)) {
     case BufferLoan::Existing:
         ts->rbufs_existing++;
         break;
@@ -205,7 +213,8 @@ void conn_loan_buffers(Connection* c) {
         break;
     }
 
-    switch (loan_single_buffer(*c, c->getThread().write, c->write)) {
+    switch (loan_single_buffer(
+            *c, thread.writePool, pool_stats.write, c->write)) {
     case BufferLoan::Existing:
         ts->wbufs_existing++;
         break;
@@ -228,8 +237,18 @@ void conn_return_buffers(Connection* c) {
         return;
     }
 
-    maybe_return_single_buffer(*c, c->getThread().read, c->read);
-    maybe_return_single_buffer(*c, c->getThread().write, c->write);
+    auto& thread = c->getThread();
+    auto& pool_stats = buffer_pools[thread.index];
+    maybe_return_single_buffer(thread.readPool, pool_stats.read, c->read);
+    if (!c->read) {
+        c->getInputFrames().clear();
+    }
+    maybe_return_single_buffer(thread.writePool, pool_stats.write, c->write);
+
+    if (!c->read && !c->write) {
+        // Nothing in flight; don't keep the send vectors either
+        c->releaseIoVectors();
+    }
 }
 
 /** Internal functions *******************************************************/
@@ -238,6 +257,14 @@ void conn_return_buffers(Connection* c) {
  * Destructor for all connection objects. Release all allocated resources.
  */
 static void conn_destructor(Connection* c) {
+    thread_loads[c->getThread().index].connections--;
+    auto& pool_stats = buffer_pools[c->getThread().index];
+    if (c->read) {
+        pool_stats.read.in_use--;
+    }
+    if (c->write) {
+        pool_stats.write.in_use--;
+    }
     delete c;
     stats.conn_structs--;
 }
@@ -288,20 +315,25 @@ static void release_connection(Connection* c) {
 
 /**
  * If the connection doesn't already have a populated conn_buff, ensure that
- * it does by either loaning out the threads, or allocating a new one if
- * necessary.
+ * it does by either borrowing one from the thread's pool, or allocating a
+ * new one if the pool is empty.
  */
-static BufferLoan loan_single_buffer(Connection& c,
-                                     std::unique_ptr<cb::Pipe>& thread_buf,
-                                     std::unique_ptr<cb::Pipe>& conn_buf) {
+static BufferLoan loan_single_buffer(
+        Connection& c,
+        std::vector<std::unique_ptr<cb::Pipe>>& pool,
+        buffer_pool_stats::Pool& pool_stats,
+        std::unique_ptr<cb::Pipe>& conn_buf) {
     /* Already have a (partial) buffer - nothing to do. */
     if (conn_buf) {
         return BufferLoan::Existing;
     }
 
     // If the thread has a buffer, let's loan that to the connection
-    if (thread_buf) {
-        thread_buf.swap(conn_buf);
+    if (!pool.empty()) {
+        conn_buf = std::move(pool.back());
+        pool.pop_back();
+        pool_stats.pooled--;
+        pool_stats.in_use_high_watermark.setIfGreater(++pool_stats.in_use);
         return BufferLoan::Loaned;
     }
 
@@ -320,19 +352,32 @@ static BufferLoan loan_single_buffer(Connection& c,
         return BufferLoan::Existing;
     }
 
+    pool_stats.in_use_high_watermark.setIfGreater(++pool_stats.in_use);
     return BufferLoan::Allocated;
 }
 
-static void maybe_return_single_buffer(Connection& c,
-                                       std::unique_ptr<cb::Pipe>& thread_buf,
-                                       std::unique_ptr<cb::Pipe>& conn_buf) {
-    if (conn_buf && conn_buf->empty()) {
-        // Buffer clean, dispose of it
-        if (thread_buf) {
-            // Already got a thread buffer.. release this one
-            conn_buf.reset();
-        } else {
-            conn_buf.swap(thread_buf);
-        }
+/**
+ * Return the connection's buffer to the thread's pool if it is drained.
+ * Buffers which grew above READ_BUFFER_HIGHWAT (to fit a large packet), or
+ * which would grow the pool above BUFFER_POOL_MAX_SIZE, are released
+ * instead.
+ */
+static void maybe_return_single_buffer(
+        std::vector<std::unique_ptr<cb::Pipe>>& pool,
+        buffer_pool_stats::Pool& pool_stats,
+        std::unique_ptr<cb::Pipe>& conn_buf) {
+    if (!conn_buf || !conn_buf->empty()) {
+        return;
+    }
+
+    pool_stats.in_use--;
+    if (pool.size() >= BUFFER_POOL_MAX_SIZE ||
+        conn_buf->capacity() > READ_BUFFER_HIGHWAT) {
+        conn_buf.reset();
+        return;
     }
+
+    conn_buf->clear();
+    pool.emplace_back(std::move(conn_buf));
+    pool_stats.pooled_high_watermark.setIfGreater(++pool_stats.pooled);
 }
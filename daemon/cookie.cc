@@ -23,10 +23,13 @@
 #include "mcbp.h"
 #include "mcbp_executors.h"
 #include "settings.h"
+#include "tracing.h"
 
+#include <boost/optional/optional.hpp>
 #include <logger/logger.h>
 #include <mcbp/mcbp.h>
 #include <mcbp/protocol/framebuilder.h>
+#include <memcached/sampling_profiler.h>
 #include <nlohmann/json.hpp>
 #include <phosphor/phosphor.h>
 #include <platform/checked_snprintf.h>
@@ -34,6 +37,7 @@
 #include <platform/timeutils.h>
 #include <platform/uuid.h>
 #include <utilities/logtags.h>
+#include <array>
 #include <chrono>
 
 nlohmann::json Cookie::toJSON() const {
@@ -60,6 +64,9 @@ nlohmann::json Cookie::toJSON() const {
 
     ret["connection"] = connection.getDescription();
     ret["ewouldblock"] = ewouldblock;
+    if (parkState != ParkState::None) {
+        ret["parked"] = parkState == ParkState::Blocked ? "blocked" : "ordered";
+    }
     ret["aiostat"] = to_string(cb::engine_errc(aiostat));
     ret["refcount"] = uint32_t(refcount);
     ret["engine_storage"] = cb::to_hex(uint64_t(engine_storage));
@@ -112,10 +119,40 @@ const std::string& Cookie::getErrorJson() {
     return json_message;
 }
 
+/**
+ * Get the name of the opcode of the packet (to tag the profiler samples
+ * taken while executing it). The names have static storage.
+ */
+static const char* getOpcodeName(const cb::mcbp::Header& header) {
+    static const auto names = [] {
+        std::array<std::string, 256> ret;
+        for (int ii = 0; ii < 256; ++ii) {
+            const auto opcode = cb::mcbp::ClientOpcode(ii);
+            ret[ii] = cb::mcbp::is_valid_opcode(opcode)
+                              ? to_string(opcode)
+                              : cb::to_hex(uint8_t(ii));
+        }
+        return ret;
+    }();
+    if (header.isResponse()) {
+        return "response";
+    }
+    return names[header.getOpcode()].c_str();
+}
+
 bool Cookie::execute() {
     // Reset ewouldblock state!
     setEwouldblock(false);
     const auto& header = getHeader();
+    boost::optional<AllocationCounter::Region> allocationRegion;
+    if (Settings::instance().isAllocationTrackingEnabled()) {
+        allocationRegion.emplace(allocations);
+    }
+    boost::optional<cb::profiler::ScopedTag> profilerTag;
+    if (Settings::instance().getSamplingProfilerFrequency() != 0) {
+        profilerTag.emplace(connection.getBucket().name,
+                            getOpcodeName(header));
+    }
     if (header.isResponse()) {
         execute_response_packet(*this, header.getResponse());
     } else {
@@ -294,8 +331,7 @@ void Cookie::sendResponse(cb::mcbp::Status status) {
             // The responseCounter is updated here as this is non-responding
             // code hence mcbp_add_header will not be called (which is what
             // normally updates the responseCounters).
-            auto& bucket = connection.getBucket();
-            ++bucket.responseCounters[int(cb::mcbp::Status::Success)];
+            connection.countResponse(cb::mcbp::Status::Success);
             connection.setState(StateMachine::State::new_cmd);
             return;
         }
@@ -353,7 +389,7 @@ void Cookie::sendResponse(cb::mcbp::Status status,
 
     size_t needed = sizeof(cb::mcbp::Header) + value.size() + key.size() +
                     extras.size();
-    if (isTracingEnabled()) {
+    if (isTracingRequested()) {
         needed += MCBP_TRACING_RESPONSE_SIZE;
     }
     connection.write->ensureCapacity(needed);
@@ -502,6 +538,8 @@ void Cookie::maybeLogSlowCommand(
                 command,
                 c.getPeername(),
                 c.getBucket().name);
+
+        dumpTraceOnSlowOperation();
     }
 }
 
@@ -510,7 +548,9 @@ Cookie::Cookie(Connection& conn) : connection(conn) {
 
 void Cookie::initialize(cb::const_byte_buffer header, bool tracing_enabled) {
     reset();
-    enableTracing = tracing_enabled;
+    tracingRequested = tracing_enabled;
+    enableTracing =
+            tracing_enabled || Settings::instance().isPhaseTimingsEnabled();
     setPacket(Cookie::PacketContent::Header, header);
     start = std::chrono::steady_clock::now();
     tracer.begin(cb::tracing::TraceCode::REQUEST, start);
@@ -526,9 +566,12 @@ void Cookie::reset() {
     commandContext.reset();
     dynamicBuffer.clear();
     tracer.clear();
+    allocations = {};
     ewouldblock = false;
     openTracingContext.clear();
     authorized = false;
+    throttleAdmitted = false;
+    parkState = ParkState::None;
 }
 
 void Cookie::setOpenTracingContext(cb::const_byte_buffer context) {
@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include "allocation_counter.h"
 #include "dynamic_buffer.h"
 #include "tracing/tracer.h"
 
@@ -25,6 +26,7 @@
 #include <memcached/engine_error.h>
 #include <nlohmann/json.hpp>
 #include <platform/sized_buffer.h>
+#include <atomic>
 #include <chrono>
 
 // Forward decls
@@ -65,7 +67,9 @@ public:
      * this method should be the constructor).
      *
      * @param header the packet header
-     * @param tracing_enabled if tracing is enabled for this request
+     * @param tracing_enabled if the client requested tracing for this
+     *                        request (spans are also recorded when phase
+     *                        timings are enabled)
      */
     void initialize(cb::const_byte_buffer header, bool tacing_enabled);
 
@@ -451,10 +455,30 @@ public:
         return start;
     }
 
+    /**
+     * Get the allocations made by the front-end thread while executing
+     * this command (only counted if allocation tracking is enabled)
+     */
+    const AllocationCounter::Counts& getAllocations() const {
+        return allocations;
+    }
+
+    /**
+     * Are spans being recorded for this command? This is the case if the
+     * client requested tracing, or if phase timings are being collected.
+     */
     bool isTracingEnabled() const {
         return enableTracing;
     }
 
+    /**
+     * Did the client request tracing information for this command (and
+     * hence the response should carry the server duration)?
+     */
+    bool isTracingRequested() const {
+        return tracingRequested;
+    }
+
     void setTracingEnabled(bool enable) {
         enableTracing = enable;
     }
@@ -520,6 +544,30 @@ public:
         validated = value;
     }
 
+    /**
+     * On connections allowing unordered execution a command may be parked
+     * so that the following commands may run, see Connection::parkCookie().
+     * The packet of a parked command is preserved (and already consumed
+     * from the connection's input).
+     */
+    enum class ParkState : uint8_t {
+        /// The command isn't parked
+        None,
+        /// The command blocked in the engine, and may resume once notified
+        Blocked,
+        /// The command hasn't started; it must not run before the commands
+        /// parked ahead of it
+        Ordered
+    };
+
+    ParkState getParkState() const {
+        return parkState;
+    }
+
+    void setParkState(ParkState state) {
+        parkState = state;
+    }
+
     /**
      * @return true is setAuthorized has been called
      */
@@ -540,8 +588,24 @@ public:
         authorized = true;
     }
 
+    /**
+     * @return true if the command has passed the throughput limits of the
+     *         bucket (see admitRequest()), and shouldn't be checked again
+     *         when it is re-executed
+     */
+    bool isThrottleAdmitted() const {
+        return throttleAdmitted.load(std::memory_order_acquire);
+    }
+
+    /// Set by the bucket throttle (possibly from another thread while the
+    /// command is blocked)
+    void setThrottleAdmitted() {
+        throttleAdmitted.store(true, std::memory_order_release);
+    }
+
 protected:
     bool enableTracing = false;
+    bool tracingRequested = false;
     cb::tracing::Tracer tracer;
 
     /// The tracing context provided by the client to use as the
@@ -591,6 +655,9 @@ protected:
      */
     std::chrono::steady_clock::time_point start;
 
+    /// The allocations made while executing the current command
+    AllocationCounter::Counts allocations;
+
     /**
      *  command-specific context - for use by command executors to maintain
      *  additional state while executing a command. For example
@@ -631,4 +698,10 @@ protected:
 
     /// see isAuthorized/setAuthorized
     bool authorized = false;
+
+    /// see isThrottleAdmitted/setThrottleAdmitted
+    std::atomic_bool throttleAdmitted{false};
+
+    /// see getParkState/setParkState
+    ParkState parkState = ParkState::None;
 };
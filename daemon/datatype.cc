@@ -38,6 +38,7 @@ bool Datatype::isSupported(cb::mcbp::Feature feature) {
     case cb::mcbp::Feature::Invalid2:
     case cb::mcbp::Feature::Duplex:
     case cb::mcbp::Feature::ClustermapChangeNotification:
+    case cb::mcbp::Feature::ClustermapChangeNotificationDelta:
     case cb::mcbp::Feature::UnorderedExecution:
     case cb::mcbp::Feature::Tracing:
     case cb::mcbp::Feature::AltRequestSupport:
@@ -71,6 +72,7 @@ void Datatype::enable(cb::mcbp::Feature feature) {
     case cb::mcbp::Feature::Invalid:
     case cb::mcbp::Feature::Invalid2:
     case cb::mcbp::Feature::ClustermapChangeNotification:
+    case cb::mcbp::Feature::ClustermapChangeNotificationDelta:
     case cb::mcbp::Feature::UnorderedExecution:
     case cb::mcbp::Feature::Tracing:
     case cb::mcbp::Feature::AltRequestSupport:
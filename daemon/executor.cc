@@ -67,6 +67,7 @@ void Executor::run() {
             // notification method will try to grab the thread lock later
             // on..
             task->getMutex().unlock();
+            --load;
 
             // tell the task that the executor consider it done with the
             // task and will no longer operate on it.
@@ -76,6 +77,7 @@ void Executor::run() {
             lock.lock();
             waitq[task.get()] = task;
             lock.unlock();
+            --load;
             // Release the task lock so that the backend thread may start
             // using it
             task->getMutex().unlock();
@@ -104,6 +106,7 @@ void Executor::schedule(const std::shared_ptr<Task>& task, bool runnable) {
 
     if (runnable) {
         runq.push(task);
+        ++load;
         idlecond.notify_all();
     } else {
         waitq[task.get()] = task;
@@ -123,6 +126,7 @@ void Executor::makeRunnable(Task* task) {
         throw std::runtime_error("Internal error object is not in the waitq");
     }
     runq.push(iter->second);
+    ++load;
     waitq.erase(iter);
     idlecond.notify_all();
 }
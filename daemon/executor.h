@@ -83,6 +83,15 @@ public:
 
     size_t futureqSize() const;
 
+    /**
+     * The number of tasks this executor has to run before it could start
+     * on a newly scheduled one: the tasks in the runq plus the one being
+     * executed (if any). Read without the lock, so only a hint.
+     */
+    size_t getLoad() const {
+        return load.load(std::memory_order_relaxed);
+    }
+
 protected:
     void run() override;
 
@@ -108,6 +117,11 @@ protected:
      */
     std::queue<std::shared_ptr<Task> > runq;
 
+    /**
+     * The runnable tasks plus the executing task; see getLoad()
+     */
+    std::atomic<size_t> load{0};
+
     /**
      * When a task is being served by a backend thread it is put in
      * the "wait queue". These commands may be runnable in any given order
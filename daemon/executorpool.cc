@@ -22,6 +22,7 @@
 #include <platform/processclock.h>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <string>
 
 cb::ExecutorPool::ExecutorPool(size_t sz)
@@ -43,7 +44,21 @@ void cb::ExecutorPool::schedule(std::shared_ptr<Task>& task, bool runnable) {
             "The mutex should be held when trying to schedule a event");
     }
 
-    executors[++roundRobin % executors.size()]->schedule(task, runnable);
+    const size_t start = ++roundRobin;
+    Executor* target = nullptr;
+    size_t targetLoad = std::numeric_limits<size_t>::max();
+    for (size_t ii = 0; ii < executors.size(); ++ii) {
+        auto* executor = executors[(start + ii) % executors.size()].get();
+        const auto load = executor->getLoad();
+        if (load < targetLoad) {
+            target = executor;
+            targetLoad = load;
+            if (load == 0) {
+                break;
+            }
+        }
+    }
+    target->schedule(task, runnable);
 }
 
 void cb::ExecutorPool::clockTick() {
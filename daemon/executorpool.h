@@ -54,6 +54,11 @@ public:
      * Schedule a task for execution at some time. The tasks mutex
      * must be held while calling this method to avoid race conditions.
      *
+     * The task is pinned to the least loaded executor (the first idle
+     * one found, starting from the next in round robin order), so a
+     * long running task doesn't hold up tasks scheduled after it while
+     * other executors are idle.
+     *
      * @param task the task to execute
      * @param runnable is the task runnable, or should it be put in
      *                 the wait queue..
@@ -81,10 +86,10 @@ private:
     std::vector< std::unique_ptr<Executor> > executors;
 
     /**
-     * We'll be using round robin to distribute the tasks to the
-     * worker threads
+     * Where the search for the least loaded executor starts, advanced
+     * round robin to spread tasks over equally loaded executors
      */
-    std::atomic_int roundRobin;
+    std::atomic<size_t> roundRobin;
 };
 
 } // namespace cb
@@ -21,30 +21,44 @@
 #include "server_event.h"
 #include "start_sasl_auth_task.h"
 
+#include <cbcrypto/cbcrypto.h>
 #include <logger/logger.h>
 #include <mcbp/protocol/framebuilder.h>
 #include <nlohmann/json.hpp>
 #include <platform/base64.h>
 #include <algorithm>
+#include <random>
 
 /// The one and only handle to the external authentication manager
 std::unique_ptr<ExternalAuthManagerThread> externalAuthManager;
 
 /**
  * The AuthenticationRequestServerEvent is responsible for injecting
- * the Authentication Request packet onto the connections stream.
+ * a batch of Authentication Request packets onto the connections stream.
+ * All of the packets are written with a single write to the socket
+ * (rather than one event, and send, per request) to cut down the
+ * overhead of reconnect storms.
  */
 class AuthenticationRequestServerEvent : public ServerEvent {
 public:
-    AuthenticationRequestServerEvent(uint32_t id,
-                                     StartSaslAuthTask& req,
-                                     bool authenticateOnly)
-        : id(id) {
+    /**
+     * Add a request to the batch
+     *
+     * @param id the opaque to use for the request
+     * @param req the authentication request
+     * @param authenticateOnly if the provider should only authenticate the
+     *                         user (and not return the RBAC entry)
+     */
+    void add(uint32_t id, StartSaslAuthTask& req, bool authenticateOnly) {
         nlohmann::json json;
         json["mechanism"] = req.getMechanism();
         json["challenge"] = cb::base64::encode(req.getChallenge(), false);
         json["authentication-only"] = authenticateOnly;
-        payload = json.dump();
+        requests.emplace_back(id, json.dump());
+    }
+
+    size_t size() const {
+        return requests.size();
     }
 
     std::string getDescription() const override {
@@ -54,22 +68,30 @@ public:
     bool execute(Connection& connection) override {
         using namespace cb::mcbp;
 
-        const size_t needed = sizeof(cb::mcbp::Request) + payload.size();
+        size_t needed = 0;
+        for (const auto& request : requests) {
+            needed += sizeof(cb::mcbp::Request) + request.second.size();
+        }
         connection.write->ensureCapacity(needed);
-        RequestBuilder builder(connection.write->wdata());
-        builder.setMagic(Magic::ServerRequest);
-        builder.setDatatype(cb::mcbp::Datatype::JSON);
-        builder.setOpcode(ServerOpcode::Authenticate);
-        builder.setOpaque(id);
-
-        // The extras contains the cluster revision number as an uint32_t
-        builder.setValue({reinterpret_cast<const uint8_t*>(payload.data()),
-                          payload.size()});
+        const auto* start = connection.write->wdata().data();
+
+        for (const auto& request : requests) {
+            const auto& payload = request.second;
+            RequestBuilder builder(connection.write->wdata());
+            builder.setMagic(Magic::ServerRequest);
+            builder.setDatatype(cb::mcbp::Datatype::JSON);
+            builder.setOpcode(ServerOpcode::Authenticate);
+            builder.setOpaque(request.first);
+            builder.setValue(
+                    {reinterpret_cast<const uint8_t*>(payload.data()),
+                     payload.size()});
+            connection.write->produced(sizeof(cb::mcbp::Request) +
+                                       payload.size());
+        }
 
-        // Inject our packet into the stream!
+        // Inject our packets into the stream!
         connection.addMsgHdr(true);
-        connection.addIov(connection.write->wdata().data(), needed);
-        connection.write->produced(needed);
+        connection.addIov(start, needed);
 
         connection.setState(StateMachine::State::send_data);
         connection.setWriteAndGo(StateMachine::State::new_cmd);
@@ -77,8 +99,8 @@ public:
     }
 
 protected:
-    const uint32_t id;
-    std::string payload;
+    /// The opaque and payload of each of the requests in the batch
+    std::vector<std::pair<uint32_t, std::string>> requests;
 };
 
 /**
@@ -121,6 +143,16 @@ protected:
     const std::string payload;
 };
 
+ExternalAuthManagerThread::ExternalAuthManagerThread()
+    : Couchbase::Thread("mcd:ext_auth") {
+    std::random_device rd;
+    std::uniform_int_distribution<int> dist(0, 255);
+    authCacheSecret.resize(32);
+    for (auto& c : authCacheSecret) {
+        c = static_cast<char>(dist(rd));
+    }
+}
+
 void ExternalAuthManagerThread::add(Connection& connection) {
     std::lock_guard<std::mutex> guard(mutex);
 
@@ -274,32 +306,36 @@ void ExternalAuthManagerThread::processRequestQueue() {
     // We'll be using the first connection in the list of connections.
     auto* provider = connections.front();
 
-    // Ok, build up a list of all of the server events before locking
+    // Ok, build up the batch of all of the requests before locking
     // the provider, so that I don't need to block the provider for a long
-    // period of time.
-    std::vector<std::unique_ptr<AuthenticationRequestServerEvent>> events;
-    // Just authenticate if we've got an entry which is newer than 2x of the
-    // push interval (and that it is newer than the max rbac cache age)
-    const auto then = std::chrono::steady_clock::now() -
-                      2 * activeUsersPushInterval.load();
+    // period of time. Requests which were recently authenticated are
+    // answered from the cache without involving the provider.
+    auto event = std::make_unique<AuthenticationRequestServerEvent>();
     while (!incomingRequests.empty()) {
-        using namespace std::chrono;
-
-        const auto ts = cb::rbac::getExternalUserTimestamp(
-                incomingRequests.front()->getUsername());
-        const auto timestamp = ts ? ts.get() : steady_clock::time_point{};
-        const uint64_t age = static_cast<uint64_t>(
-                duration_cast<seconds>(timestamp.time_since_epoch()).count());
-
-        const bool authOnly =
-                (timestamp > then) &&
-                (age >= rbacCacheEpoch.load(std::memory_order_acquire));
-        events.emplace_back(std::make_unique<AuthenticationRequestServerEvent>(
-                next, *incomingRequests.front(), authOnly));
-        requestMap[next++] = std::make_pair(provider, incomingRequests.front());
+        auto& request = *incomingRequests.front();
+        if (isAuthCached(request)) {
+            ++stats.cacheHits;
+            incommingResponse.emplace(std::make_unique<AuthResponse>(
+                    next, cb::mcbp::Status::Success, cb::const_byte_buffer{}));
+            requestMap[next++] = std::make_pair(nullptr, &request);
+        } else {
+            event->add(next,
+                       request,
+                       isAuthenticateOnly(request.getUsername()));
+            requestMap[next++] = std::make_pair(provider, &request);
+        }
         incomingRequests.pop();
     }
 
+    stats.maxOutstanding =
+            std::max(stats.maxOutstanding, uint64_t(requestMap.size()));
+    if (event->size() == 0) {
+        return;
+    }
+    ++stats.batches;
+    stats.requests += event->size();
+    stats.maxBatchSize = std::max(stats.maxBatchSize, uint64_t(event->size()));
+
     // We cannot hold the internal lock when we try to lock the front
     // end thread as that'll cause a potential deadlock with the "add",
     // "remove" and "responseReceived" as they'll hold the thread
@@ -314,11 +350,9 @@ void ExternalAuthManagerThread::processRequestQueue() {
     // doing this).
     {
         std::lock_guard<std::mutex> guard(provider->getThread().mutex);
-        // The provider is locked, so I can move all of the server events
-        // over to the providers connection
-        for (auto& ev : events) {
-            provider->enqueueServerEvent(std::move(ev));
-        }
+        // The provider is locked, so I can move the batch over to the
+        // providers connection
+        provider->enqueueServerEvent(std::move(event));
         provider->signalIfIdle();
     }
 
@@ -326,6 +360,65 @@ void ExternalAuthManagerThread::processRequestQueue() {
     mutex.lock();
 }
 
+bool ExternalAuthManagerThread::isAuthenticateOnly(
+        const std::string& user) const {
+    using namespace std::chrono;
+
+    // Just authenticate if we've got an entry which is newer than 2x of the
+    // push interval (and that it is newer than the max rbac cache age)
+    const auto then = steady_clock::now() - 2 * activeUsersPushInterval.load();
+    const auto ts = cb::rbac::getExternalUserTimestamp(user);
+    const auto timestamp = ts ? ts.get() : steady_clock::time_point{};
+    const uint64_t age = static_cast<uint64_t>(
+            duration_cast<seconds>(timestamp.time_since_epoch()).count());
+
+    return (timestamp > then) &&
+           (age >= rbacCacheEpoch.load(std::memory_order_acquire));
+}
+
+std::string ExternalAuthManagerThread::getAuthCacheKey(
+        const std::string& challenge) const {
+    return cb::crypto::HMAC(
+            cb::crypto::Algorithm::SHA256, authCacheSecret, challenge);
+}
+
+bool ExternalAuthManagerThread::isAuthCached(StartSaslAuthTask& request) {
+    if (authCacheTtl.load() == std::chrono::microseconds::zero()) {
+        return false;
+    }
+
+    const auto username = request.getUsername();
+    auto iter = authCache.find(username);
+    if (iter == authCache.end()) {
+        return false;
+    }
+
+    // The RBAC entry must still be valid as we won't get a new one from
+    // the provider
+    if (iter->second.expiry < std::chrono::steady_clock::now() ||
+        iter->second.rbacCacheEpoch !=
+                rbacCacheEpoch.load(std::memory_order_acquire) ||
+        !isAuthenticateOnly(username)) {
+        authCache.erase(iter);
+        return false;
+    }
+
+    return iter->second.key == getAuthCacheKey(request.getChallenge());
+}
+
+nlohmann::json ExternalAuthManagerThread::getStats() {
+    std::lock_guard<std::mutex> guard(mutex);
+    nlohmann::json ret;
+    ret["requests"] = stats.requests;
+    ret["cache_hits"] = stats.cacheHits;
+    ret["cached_users"] = authCache.size();
+    ret["batches"] = stats.batches;
+    ret["max_batch_size"] = stats.maxBatchSize;
+    ret["outstanding"] = requestMap.size();
+    ret["max_outstanding"] = stats.maxOutstanding;
+    return ret;
+}
+
 void ExternalAuthManagerThread::setRbacCacheEpoch(
         std::chrono::steady_clock::time_point tp) {
     using namespace std::chrono;
@@ -344,6 +437,20 @@ void ExternalAuthManagerThread::processResponseQueue() {
                         entry->opaque);
         } else {
             StartSaslAuthTask* task = iter->second.second;
+            // Only responses from the provider update the cache (so that
+            // cached entries expire)
+            if (iter->second.first != nullptr) {
+                const auto username = task->getUsername();
+                const auto ttl = authCacheTtl.load();
+                if (entry->status != cb::mcbp::Status::Success) {
+                    authCache.erase(username);
+                } else if (ttl != std::chrono::microseconds::zero()) {
+                    authCache[username] = {
+                            getAuthCacheKey(task->getChallenge()),
+                            std::chrono::steady_clock::now() + ttl,
+                            rbacCacheEpoch.load(std::memory_order_acquire)};
+                }
+            }
             requestMap.erase(iter);
             mutex.unlock();
             task->externalAuthResponse(entry->status, entry->payload);
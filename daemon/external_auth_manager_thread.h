@@ -42,8 +42,7 @@ class StartSaslAuthTask;
  */
 class ExternalAuthManagerThread : public Couchbase::Thread {
 public:
-    ExternalAuthManagerThread() : Couchbase::Thread("mcd:ext_auth") {
-    }
+    ExternalAuthManagerThread();
     ExternalAuthManagerThread(const ExternalAuthManagerThread&) = delete;
 
     /**
@@ -104,6 +103,21 @@ public:
 
     void setRbacCacheEpoch(std::chrono::steady_clock::time_point tp);
 
+    /**
+     * Set how long a successful authentication may be reused for the same
+     * user and password without asking the authentication provider
+     * (0 disables the cache)
+     */
+    void setAuthCacheTtl(std::chrono::microseconds ttl) {
+        authCacheTtl.store(ttl);
+    }
+
+    /**
+     * Get the statistics of the requests sent to the authentication
+     * provider and of the authentication cache
+     */
+    nlohmann::json getStats();
+
 protected:
     /// The main loop of the thread
     void run() override;
@@ -128,6 +142,25 @@ protected:
     /// Push the list of active users to the authentication provider
     void pushActiveUsers();
 
+    /**
+     * Should we ask the authentication provider for the RBAC entry of the
+     * named user, or just to authenticate the user (the RBAC entry we've
+     * got is new enough)?
+     */
+    bool isAuthenticateOnly(const std::string& user) const;
+
+    /**
+     * The key to use in the authentication cache for the challenge (a
+     * HMAC so that the cache doesn't hold the password)
+     */
+    std::string getAuthCacheKey(const std::string& challenge) const;
+
+    /**
+     * Check if the request was recently successfully authenticated with
+     * the same challenge, and the user's RBAC entry is still valid.
+     */
+    bool isAuthCached(StartSaslAuthTask& request);
+
     /// Let the daemon thread run as long as this member is set to true
     bool running = true;
 
@@ -248,6 +281,45 @@ protected:
      * number of seconds instead.
      */
     std::atomic<uint64_t> rbacCacheEpoch{{}};
+
+    /**
+     * During reconnect storms (e.g. after a node restart) the same users
+     * authenticate over and over again, and each request would otherwise
+     * be a round trip to the authentication provider (and typically on to
+     * LDAP). A successful authentication is reused for the same username
+     * and challenge for authCacheTtl, as long as the RBAC cache epoch
+     * hasn't changed and the user's RBAC entry is still valid. Failures
+     * are never cached (and drop the user's entry).
+     */
+    struct AuthCacheEntry {
+        /// HMAC of the challenge which was authenticated
+        std::string key;
+        /// The entry may not be used after this time
+        std::chrono::steady_clock::time_point expiry;
+        /// The RBAC cache epoch when the entry was created
+        uint64_t rbacCacheEpoch;
+    };
+    std::unordered_map<std::string, AuthCacheEntry> authCache;
+
+    /// Random key for the HMAC of the challenges in the authentication cache
+    std::string authCacheSecret;
+
+    std::atomic<std::chrono::microseconds> authCacheTtl{
+            std::chrono::seconds(10)};
+
+    /// Statistics of the authentication requests
+    struct {
+        /// Requests sent to the authentication provider
+        uint64_t requests = 0;
+        /// Requests answered from the authentication cache
+        uint64_t cacheHits = 0;
+        /// Number of batches the requests were sent to the provider in
+        uint64_t batches = 0;
+        /// The largest number of requests sent in a single batch
+        uint64_t maxBatchSize = 0;
+        /// The largest number of requests waiting for the provider
+        uint64_t maxOutstanding = 0;
+    } stats;
 };
 
 extern std::unique_ptr<ExternalAuthManagerThread> externalAuthManager;
@@ -17,12 +17,16 @@
 
 #pragma once
 
-#include <JSON_checker.h>
+#include "inflated_value_cache.h"
+
 #include <event.h>
+#include <folly/AtomicLinkedList.h>
 #include <memcached/engine_error.h>
 #include <platform/platform_thread.h>
+#include <relaxed_atomic.h>
 #include <platform/socket.h>
 #include <subdoc/operations.h>
+#include <utilities/json_validator.h>
 
 #include <atomic>
 #include <memory>
@@ -98,12 +102,53 @@ struct FrontEndThread {
     /// Mutex to lock protect access to this object.
     std::mutex mutex;
 
-    /// Set of connections with pending async io ops.
-    struct {
-        std::mutex mutex;
+    /**
+     * Set of connections with pending async io ops.
+     *
+     * Notifications are posted (from any thread) to a lock-free queue,
+     * and moved to the map by the front end thread itself, which is the
+     * only thread accessing the map.
+     */
+    class PendingIo {
+    public:
+        /**
+         * Post a notification for the connection; may be called from any
+         * thread.
+         *
+         * @param c the connection to notify
+         * @param cookie the cookie to notify (may be nullptr to just run the
+         *               connection)
+         * @param status the status to notify the cookie with
+         * @return true if the queue was empty, and the front end thread needs
+         *         to be woken up. (If not, there is already a wakeup
+         *         pending which shall see this notification)
+         */
+        bool push(Connection* c, Cookie* cookie, ENGINE_ERROR_CODE status);
+
+        /**
+         * Move all of the posted notifications into the map. Must only be
+         * called by the front end thread.
+         */
+        void drain();
+
+        /// The notifications moved into the map (front end thread only)
         PendingIoMap map;
+
+        /// The number of notifications moved into the map
+        cb::RelaxedAtomic<uint64_t> notifications{0};
+
+    protected:
+        struct Notification {
+            Connection* connection;
+            Cookie* cookie;
+            ENGINE_ERROR_CODE status;
+        };
+        folly::AtomicLinkedList<Notification> queue;
     } pending_io;
 
+    /// The number of times the thread was woken up by its notification pipe
+    cb::RelaxedAtomic<uint64_t> wakeups{0};
+
     /// A list of connections to signal if they're idle
     class NotificationList {
     public:
@@ -119,11 +164,18 @@ struct FrontEndThread {
     /// index of this thread in the threads array
     size_t index = 0;
 
-    /// Shared read buffer for all connections serviced by this thread.
-    std::unique_ptr<cb::Pipe> read;
+    /// The NUMA node the thread is bound to (-1 if it isn't bound)
+    int numaNode = -1;
 
-    /// Shared write buffer for all connections serviced by this thread.
-    std::unique_ptr<cb::Pipe> write;
+    /**
+     * Pools of idle network buffers for the connections serviced by this
+     * thread. A connection borrows a read and a write buffer only while it
+     * has data in flight, and returns them once drained (see
+     * conn_loan_buffers() / conn_return_buffers()), so idle connections
+     * don't keep any buffer memory.
+     */
+    std::vector<std::unique_ptr<cb::Pipe>> readPool;
+    std::vector<std::unique_ptr<cb::Pipe>> writePool;
 
     /**
      * Shared sub-document operation for all connections serviced by this
@@ -135,7 +187,11 @@ struct FrontEndThread {
      * Shared validator used by all connections serviced by this thread
      * when they need to validate a JSON document
      */
-    JSON_checker::Validator validator;
+    cb::JsonValidator validator;
+
+    /// The inflated values of compressed documents recently read by the
+    /// connections serviced by this thread
+    InflatedValueCache inflatedValues;
 
     /// Is the thread running or not
     std::atomic_bool running{false};
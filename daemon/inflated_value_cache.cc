@@ -0,0 +1,120 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "inflated_value_cache.h"
+
+#include "settings.h"
+#include "stats.h"
+
+#include <functional>
+
+size_t InflatedValueCache::KeyHash::operator()(const Key& key) const {
+    // The same key rarely exists in several vbuckets (or buckets) at once
+    return std::hash<std::string>()(key.key) ^ std::hash<uint64_t>()(key.cas);
+}
+
+size_t InflatedValueCache::getEntrySize(const Key& key, const Value& value) {
+    // Include (roughly) the overhead of the map node and LRU list node
+    return key.key.size() + value->size() + sizeof(Key) + sizeof(Entry) +
+           4 * sizeof(void*);
+}
+
+InflatedValueCache::Value InflatedValueCache::get(
+        int bucket,
+        Vbid vbucket,
+        const DocKey& key,
+        uint64_t cas,
+        uint64_t seqno,
+        cb::const_char_buffer compressed) {
+    const auto capacity = Settings::instance().getInflatedValueCacheSize();
+    if (capacity == 0) {
+        clear();
+        auto value = std::make_shared<cb::compression::Buffer>();
+        if (!cb::compression::inflate(
+                    cb::compression::Algorithm::Snappy, compressed, *value)) {
+            return {};
+        }
+        return value;
+    }
+
+    Key entryKey{bucket,
+                 vbucket,
+                 cas,
+                 seqno,
+                 {reinterpret_cast<const char*>(key.data()), key.size()}};
+    auto iter = entries.find(entryKey);
+    if (iter != entries.end()) {
+        lru.splice(lru.begin(), lru, iter->second.lruPosition);
+        if (stats) {
+            stats->hits++;
+        }
+        return iter->second.value;
+    }
+
+    auto value = std::make_shared<cb::compression::Buffer>();
+    if (!cb::compression::inflate(
+                cb::compression::Algorithm::Snappy, compressed, *value)) {
+        return {};
+    }
+    if (stats) {
+        stats->misses++;
+    }
+
+    // Don't let a single (large) document flush most of the cache
+    const auto size = getEntrySize(entryKey, value);
+    if (size <= capacity / 8) {
+        evict(capacity - size);
+        auto inserted =
+                entries.emplace(std::move(entryKey), Entry{value, {}}).first;
+        lru.push_front(&inserted->first);
+        inserted->second.lruPosition = lru.begin();
+        bytes += size;
+    } else {
+        // Not cached, but the capacity may have been reduced
+        evict(capacity);
+    }
+
+    if (stats) {
+        stats->items = entries.size();
+        stats->bytes = bytes;
+    }
+    return value;
+}
+
+void InflatedValueCache::evict(size_t capacity) {
+    while (bytes > capacity && !lru.empty()) {
+        auto iter = entries.find(*lru.back());
+        bytes -= getEntrySize(iter->first, iter->second.value);
+        lru.pop_back();
+        entries.erase(iter);
+        if (stats) {
+            stats->evictions++;
+        }
+    }
+}
+
+void InflatedValueCache::clear() {
+    if (entries.empty()) {
+        return;
+    }
+    lru.clear();
+    entries.clear();
+    bytes = 0;
+    if (stats) {
+        stats->items = 0;
+        stats->bytes = 0;
+    }
+}
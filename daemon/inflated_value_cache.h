@@ -0,0 +1,122 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/dockey.h>
+#include <memcached/vbucket.h>
+#include <platform/compress.h>
+#include <platform/sized_buffer.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+struct inflated_value_cache_stats;
+
+/**
+ * A small, bounded, LRU cache of the inflated values of Snappy compressed
+ * documents, owned by a front end thread.
+ *
+ * Buckets in passive or active compression mode keep (hot) documents
+ * compressed, so every read from a client which didn't enable Snappy (or
+ * of a document with xattrs) would otherwise inflate the same value again.
+ * A version of a document is identified by its key, vbucket, CAS and
+ * seqno, so a cached value is never returned for a modified document; the
+ * entries of old versions simply age out.
+ *
+ * The cache is sized by Settings::getInflatedValueCacheSize(), and only
+ * accessed by the thread owning it (apart from its stats).
+ */
+class InflatedValueCache {
+public:
+    using Value = std::shared_ptr<const cb::compression::Buffer>;
+
+    /**
+     * Get the inflated value of a document, from the cache or by inflating
+     * (and caching) it.
+     *
+     * The returned buffer is shared, so it stays valid (for the response
+     * referencing it) even if evicted from the cache.
+     *
+     * @param bucket the index of the bucket the document belongs to
+     * @param vbucket the vbucket the document belongs to
+     * @param key the key of the document
+     * @param cas the CAS of the document
+     * @param seqno the seqno of the document
+     * @param compressed the (Snappy compressed) value of the document
+     * @return the inflated value, or nullptr if the value couldn't be
+     *         inflated
+     * @throws std::bad_alloc
+     */
+    Value get(int bucket,
+              Vbid vbucket,
+              const DocKey& key,
+              uint64_t cas,
+              uint64_t seqno,
+              cb::const_char_buffer compressed);
+
+    /// Set the stats object to maintain for this cache
+    void setStats(inflated_value_cache_stats& value) {
+        stats = &value;
+    }
+
+    /// Remove all of the entries
+    void clear();
+
+protected:
+    struct Key {
+        bool operator==(const Key& other) const {
+            return cas == other.cas && seqno == other.seqno &&
+                   vbucket == other.vbucket && bucket == other.bucket &&
+                   key == other.key;
+        }
+
+        int bucket;
+        Vbid vbucket;
+        uint64_t cas;
+        uint64_t seqno;
+        std::string key;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Value value;
+        /// This entry's position in the LRU list
+        std::list<const Key*>::iterator lruPosition;
+    };
+
+    /// @return the number of bytes accounted to an entry
+    static size_t getEntrySize(const Key& key, const Value& value);
+
+    /// Evict the least recently used entries until using <= capacity bytes
+    void evict(size_t capacity);
+
+    std::unordered_map<Key, Entry, KeyHash> entries;
+
+    /// The keys of entries, most recently used first
+    std::list<const Key*> lru;
+
+    /// The number of bytes accounted to the entries
+    size_t bytes = 0;
+
+    inflated_value_cache_stats* stats = nullptr;
+};
@@ -22,9 +22,11 @@
 #include "connections.h"
 #include "cookie.h"
 #include "tracing.h"
+#include "traffic_capture.h"
 #include "utilities/string_utilities.h"
 #include <logger/logger.h>
 #include <mcbp/mcbp.h>
+#include <memcached/sampling_profiler.h>
 
 /*
  * Implement ioctl-style memcached commands (ioctl_get / ioctl_set).
@@ -136,13 +138,47 @@ ENGINE_ERROR_CODE ioctlRbacDbDump(Cookie& cookie,
     return ENGINE_SUCCESS;
 }
 
+/**
+ * Get the samples recorded by the sampling profiler (see
+ * sampling_profiler_frequency) in folded stack format
+ */
+static ENGINE_ERROR_CODE ioctlGetProfilerFolded(Cookie& cookie,
+                                                const StrToStrMap& arguments,
+                                                std::string& value) {
+    if (!arguments.empty() || !value.empty()) {
+        return ENGINE_EINVAL;
+    }
+    if (!cb::profiler::isSupported()) {
+        return ENGINE_ENOTSUP;
+    }
+
+    value = cb::profiler::toFolded();
+    return ENGINE_SUCCESS;
+}
+
+/**
+ * Get the status of the traffic capture (see capture.start)
+ */
+static ENGINE_ERROR_CODE ioctlGetCaptureStatus(Cookie& cookie,
+                                               const StrToStrMap& arguments,
+                                               std::string& value) {
+    if (!arguments.empty() || !value.empty()) {
+        return ENGINE_EINVAL;
+    }
+
+    value = getTrafficCaptureStatus().dump();
+    return ENGINE_SUCCESS;
+}
+
 static const std::unordered_map<std::string, GetCallbackFunc> ioctl_get_map{
         {"trace.config", ioctlGetTracingConfig},
         {"trace.status", ioctlGetTracingStatus},
         {"trace.dump.begin", ioctlGetTracingBeginDump},
         {"trace.dump.chunk", ioctlGetTracingDumpChunk},
         {"sla", ioctlGetMcbpSla},
-        {"rbac.db.dump", ioctlRbacDbDump}};
+        {"rbac.db.dump", ioctlRbacDbDump},
+        {"profiler.folded", ioctlGetProfilerFolded},
+        {"capture.status", ioctlGetCaptureStatus}};
 
 ENGINE_ERROR_CODE ioctl_get_property(Cookie& cookie,
                                      const std::string& key,
@@ -182,6 +218,77 @@ static ENGINE_ERROR_CODE ioctlSetMcbpSla(Cookie& cookie,
     return ENGINE_SUCCESS;
 }
 
+/**
+ * Discard the samples recorded by the sampling profiler
+ */
+static ENGINE_ERROR_CODE ioctlSetProfilerClear(Cookie& cookie,
+                                               const StrToStrMap&,
+                                               const std::string&) {
+    cb::profiler::clear();
+    auto& c = cookie.getConnection();
+    LOG_INFO("{}: IOCTL_SET: profiler.clear called", c.getId());
+    return ENGINE_SUCCESS;
+}
+
+/**
+ * Start capturing the requests of a sample of the connections:
+ *
+ *     capture.start?path=<file>[&percent=<1-100>][&max_size=<bytes>]
+ *
+ * percent defaults to 10, and max_size to 1GB.
+ */
+static ENGINE_ERROR_CODE ioctlSetCaptureStart(Cookie& cookie,
+                                              const StrToStrMap& arguments,
+                                              const std::string&) {
+    std::string path;
+    size_t percent = 10;
+    size_t maxSize = 1024 * 1024 * 1024;
+    try {
+        for (const auto& arg : arguments) {
+            if (arg.first == "path") {
+                path = arg.second;
+            } else if (arg.first == "percent") {
+                percent = std::stoul(arg.second);
+            } else if (arg.first == "max_size") {
+                maxSize = std::stoull(arg.second);
+            } else {
+                return ENGINE_EINVAL;
+            }
+        }
+    } catch (const std::exception&) {
+        return ENGINE_EINVAL;
+    }
+    if (path.empty()) {
+        return ENGINE_EINVAL;
+    }
+
+    auto& c = cookie.getConnection();
+    try {
+        startTrafficCapture(path, percent, maxSize);
+    } catch (const std::exception& e) {
+        LOG_WARNING("{}: IOCTL_SET: capture.start failed: {}",
+                    c.getId(),
+                    e.what());
+        cookie.setErrorContext(e.what());
+        return ENGINE_EINVAL;
+    }
+    LOG_INFO("{}: {} IOCTL_SET: capture.start called",
+             c.getId(),
+             c.getDescription());
+    return ENGINE_SUCCESS;
+}
+
+static ENGINE_ERROR_CODE ioctlSetCaptureStop(Cookie& cookie,
+                                             const StrToStrMap&,
+                                             const std::string&) {
+    stopTrafficCapture();
+    auto& c = cookie.getConnection();
+    LOG_INFO("{}: {} IOCTL_SET: capture.stop called",
+             c.getId(),
+             c.getDescription());
+    return ENGINE_SUCCESS;
+}
+
 static const std::unordered_map<std::string, SetCallbackFunc> ioctl_set_map{
         {"jemalloc.prof.active", setJemallocProfActive},
         {"jemalloc.prof.dump", setJemallocProfDump},
@@ -190,7 +297,10 @@ static const std::unordered_map<std::string, SetCallbackFunc> ioctl_set_map{
         {"trace.start", ioctlSetTracingStart},
         {"trace.stop", ioctlSetTracingStop},
         {"trace.dump.clear", ioctlSetTracingClearDump},
-        {"sla", ioctlSetMcbpSla}};
+        {"sla", ioctlSetMcbpSla},
+        {"profiler.clear", ioctlSetProfilerClear},
+        {"capture.start", ioctlSetCaptureStart},
+        {"capture.stop", ioctlSetCaptureStop}};
 
 ENGINE_ERROR_CODE ioctl_set_property(Cookie& cookie,
                                      const std::string& key,
@@ -35,6 +35,7 @@
 #include <folly/Synchronized.h>
 #include <nlohmann/json.hpp>
 
+#include <cctype>
 #include <sstream>
 
 static folly::Synchronized<cb::audit::UniqueAuditPtr> auditHandle;
@@ -281,6 +282,12 @@ namespace audit {
 namespace document {
 
 void add(const Cookie& cookie, Operation operation) {
+    add(cookie, operation, cookie.getRequest().getKey());
+}
+
+void add(const Cookie& cookie,
+         Operation operation,
+         cb::const_byte_buffer key) {
     uint32_t id = 0;
     switch (operation) {
     case Operation::Read:
@@ -309,7 +316,14 @@ void add(const Cookie& cookie, Operation operation) {
     const auto& connection = cookie.getConnection();
     auto root = create_memcached_audit_object(connection);
     root["bucket"] = connection.getBucket().name;
-    root["key"] = cookie.getPrintableRequestKey();
+    std::string printableKey{reinterpret_cast<const char*>(key.data()),
+                             key.size()};
+    for (auto& ii : printableKey) {
+        if (!std::isgraph(ii)) {
+            ii = '.';
+        }
+    }
+    root["key"] = printableKey;
 
     switch (operation) {
     case Operation::Read:
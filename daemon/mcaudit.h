@@ -109,6 +109,13 @@ namespace document {
 enum class Operation;
 
 void add(const Cookie& c, Operation operation);
+
+/**
+ * As add(c, operation), but for the given document key instead of the key
+ * of the cookie's request (for commands which operate on multiple
+ * documents).
+ */
+void add(const Cookie& c, Operation operation, cb::const_byte_buffer key);
 } // namespace document
 } // namespace audit
 } // namespace cb
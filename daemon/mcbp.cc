@@ -31,6 +31,8 @@
 #include <nlohmann/json.hpp>
 #include <platform/compress.h>
 #include <platform/string_hex.h>
+#include <tracing/trace_helpers.h>
+#include <gsl/gsl>
 
 static cb::const_byte_buffer mcbp_add_header(Cookie& cookie,
                                              cb::Pipe& pipe,
@@ -52,7 +54,7 @@ static cb::const_byte_buffer mcbp_add_header(Cookie& cookie,
     header->response.setOpaque(opaque);
     header->response.setCas(cas);
 
-    if (cookie.isTracingEnabled()) {
+    if (cookie.isTracingRequested()) {
         // When tracing is enabled we'll be using the alternative
         // response header where we inject the framing header.
         // For now we'll just hard-code the adding of the bytes
@@ -128,10 +130,75 @@ void mcbp_add_header(Cookie& cookie,
         }
     }
 
-    ++connection.getBucket().responseCounters[uint16_t(status)];
+    connection.countResponse(status);
     connection.addIov(wbuf.data(), wbuf.size());
 }
 
+void mcbp_send_document(Cookie& cookie,
+                        const uint32_t& flags,
+                        cb::const_char_buffer key,
+                        cb::const_char_buffer value,
+                        uint8_t datatype,
+                        uint64_t cas) {
+    auto& connection = cookie.getConnection();
+    const auto bodylen =
+            gsl::narrow<uint32_t>(sizeof(flags) + key.size() + value.size());
+
+    if (connection.useCookieSendResponse(bodylen)) {
+        cookie.sendResponse(
+                cb::mcbp::Status::Success,
+                {reinterpret_cast<const char*>(&flags), sizeof(flags)},
+                key,
+                value,
+                cb::mcbp::Datatype(datatype),
+                cas);
+        return;
+    }
+
+    cookie.setCas(cas);
+    mcbp_add_header(cookie,
+                    cb::mcbp::Status::Success,
+                    sizeof(flags),
+                    gsl::narrow<uint16_t>(key.size()),
+                    bodylen,
+                    datatype);
+    connection.addIov(&flags, sizeof(flags));
+    connection.addIov(key.data(), key.size());
+    connection.addIov(value.data(), value.size());
+    connection.setState(StateMachine::State::send_data);
+}
+
+void mcbp_append_header(Cookie& cookie,
+                        cb::mcbp::Status status,
+                        uint8_t ext_len,
+                        uint16_t key_len,
+                        uint32_t body_len,
+                        uint8_t datatype,
+                        uint64_t cas) {
+    auto& connection = cookie.getConnection();
+    const auto& header = cookie.getHeader();
+    const auto wbuf = mcbp_add_header(cookie,
+                                      *connection.write,
+                                      header.getOpcode(),
+                                      status,
+                                      ext_len,
+                                      key_len,
+                                      body_len,
+                                      datatype,
+                                      header.getOpaque(),
+                                      cas);
+    connection.countResponse(status);
+    connection.addIov(wbuf.data(), wbuf.size());
+}
+
+size_t mcbp_response_header_size(const Cookie& cookie) {
+    size_t size = sizeof(cb::mcbp::Response);
+    if (cookie.isTracingRequested()) {
+        size += MCBP_TRACING_RESPONSE_SIZE;
+    }
+    return size;
+}
+
 static bool mcbp_response_handler(const void* key,
                                   uint16_t keylen,
                                   const void* ext,
@@ -154,6 +221,7 @@ static bool mcbp_response_handler(const void* key,
          mcbp::datatype::is_xattr(datatype))) {
         // The client is not snappy-aware, and the content contains
         // snappy encoded data. Or it's xattr compressed. We need to inflate it!
+        TRACE_SCOPE(*cookie, cb::tracing::TraceCode::DECOMPRESS);
         if (!cb::compression::inflate(cb::compression::Algorithm::Snappy,
                                       payload, buffer)) {
             std::string mykey(reinterpret_cast<const char*>(key), keylen);
@@ -223,7 +291,7 @@ static bool mcbp_response_handler(const void* key,
     builder.setCas(cas);
     builder.validate();
 
-    ++c->getBucket().responseCounters[uint16_t(status)];
+    c->countResponse(status);
     dbuf.moveOffset(needed);
     return true;
 }
@@ -272,6 +340,32 @@ void mcbp_collect_timings(Cookie& cookie) {
         all_buckets[bucketid].timings.collect(opcode, elapsed);
     }
 
+    if (Settings::instance().isPhaseTimingsEnabled()) {
+        for (const auto& span : cookie.getTracer().getDurations()) {
+            // The whole request is already covered by the opcode timings,
+            // and a span which was never ended has no duration.
+            if (span.code == cb::tracing::TraceCode::REQUEST ||
+                span.duration == cb::tracing::Span::Duration::max()) {
+                continue;
+            }
+            const std::chrono::microseconds duration{span.duration.count()};
+            all_buckets[0].timings.collectPhase(span.code, duration);
+            if (bucketid != 0) {
+                all_buckets[bucketid].timings.collectPhase(span.code,
+                                                           duration);
+            }
+        }
+    }
+
+    if (Settings::instance().isAllocationTrackingEnabled()) {
+        const auto& allocations = cookie.getAllocations();
+        all_buckets[0].timings.collectAllocations(opcode, allocations);
+        if (bucketid != 0) {
+            all_buckets[bucketid].timings.collectAllocations(opcode,
+                                                             allocations);
+        }
+    }
+
     // Log operations taking longer than the "slow" threshold for the opcode.
     cookie.maybeLogSlowCommand(elapsed);
 
@@ -44,4 +44,64 @@ void mcbp_add_header(Cookie& cookie,
                      uint32_t body_len,
                      uint8_t datatype);
 
+/**
+ * Send a successful document response (the flags as extras, the optional
+ * key and the value) for the current command. Used by the retrieval
+ * commands (GET, GAT, GET_LOCKED, GET_REPLICA).
+ *
+ * Unless the connection prefers a copy (small responses over user space
+ * TLS, see Connection::useCookieSendResponse()) the response isn't copied:
+ * the IO vector references the flags, key and value, so the caller must
+ * keep them alive (e.g. keep the engine item pinned) until the response
+ * has been transmitted. The command contexts do so by owning the item, as
+ * a context lives until the connection starts its next command.
+ *
+ * @param cookie the command context to send the response for
+ * @param flags the document flags (referenced, not copied)
+ * @param key the key to send (empty if none)
+ * @param value the value to send
+ * @param datatype The datatype to inject into the header
+ * @param cas The CAS to inject into the header
+ * @throws std::bad_alloc
+ */
+void mcbp_send_document(Cookie& cookie,
+                        const uint32_t& flags,
+                        cb::const_char_buffer key,
+                        cb::const_char_buffer value,
+                        uint8_t datatype,
+                        uint64_t cas);
+
+/**
+ * Append an additional response header for the current command to the
+ * connection's IO vector, after any responses already added (unlike
+ * mcbp_add_header() which starts a new response message). Used by commands
+ * which send multiple response messages in a single write.
+ *
+ * The caller must have reserved room for the header in the write pipe up
+ * front (see mcbp_response_header_size()); growing the pipe would invalidate
+ * IO vector entries which already point into it.
+ *
+ * @param cookie the command context to add the header for
+ * @param status The error code to use
+ * @param ext_len The length of the ext field
+ * @param key_len The length of the key field
+ * @param body_len THe length of the body field
+ * @param datatype The datatype to inject into the header
+ * @param cas The CAS to inject into the header
+ * @throws std::bad_alloc
+ */
+void mcbp_append_header(Cookie& cookie,
+                        cb::mcbp::Status status,
+                        uint8_t ext_len,
+                        uint16_t key_len,
+                        uint32_t body_len,
+                        uint8_t datatype,
+                        uint64_t cas);
+
+/**
+ * @return the number of bytes of the write pipe used by each response header
+ *         added for the given cookie.
+ */
+size_t mcbp_response_header_size(const Cookie& cookie);
+
 extern AddResponseFn mcbpResponseHandlerFn;
@@ -17,6 +17,7 @@
 
 #include "mcbp_executors.h"
 
+#include "bucket_throttle.h"
 #include "buckets.h"
 #include "config_parse.h"
 #include "external_auth_manager_thread.h"
@@ -24,10 +25,12 @@
 #include "mc_time.h"
 #include "mcaudit.h"
 #include "mcbp.h"
+#include "mcbp_frame_batch.h"
 #include "mcbp_privileges.h"
 #include "mcbp_topkeys.h"
 #include "protocol/mcbp/appendprepend_context.h"
 #include "protocol/mcbp/arithmetic_context.h"
+#include "protocol/mcbp/arithmetic_multi_context.h"
 #include "protocol/mcbp/audit_configure_context.h"
 #include "protocol/mcbp/create_remove_bucket_command_context.h"
 #include "protocol/mcbp/dcp_deletion.h"
@@ -41,6 +44,7 @@
 #include "protocol/mcbp/get_context.h"
 #include "protocol/mcbp/get_locked_context.h"
 #include "protocol/mcbp/get_meta_context.h"
+#include "protocol/mcbp/get_multi_context.h"
 #include "protocol/mcbp/mutation_context.h"
 #include "protocol/mcbp/rbac_reload_command_context.h"
 #include "protocol/mcbp/remove_context.h"
@@ -132,8 +136,7 @@ static void process_bin_unknown_packet(Cookie& cookie) {
         if (cookie.getDynamicBuffer().getRoot() != nullptr) {
             // We assume that if the underlying engine returns a success then
             // it is sending a success to the client.
-            ++connection.getBucket()
-                      .responseCounters[int(cb::mcbp::Status::Success)];
+            connection.countResponse(cb::mcbp::Status::Success);
             cookie.sendDynamicBuffer();
         } else {
             connection.setState(StateMachine::State::new_cmd);
@@ -191,6 +194,10 @@ static void get_executor(Cookie& cookie) {
     process_bin_get(cookie);
 }
 
+static void get_multi_executor(Cookie& cookie) {
+    cookie.obtainContext<GetMultiCommandContext>(cookie).drive();
+}
+
 static void get_meta_executor(Cookie& cookie) {
     process_bin_get_meta(cookie);
 }
@@ -323,6 +330,10 @@ static void arithmetic_executor(Cookie& cookie) {
     cookie.obtainContext<ArithmeticCommandContext>(cookie, req).drive();
 }
 
+static void arithmetic_multi_executor(Cookie& cookie) {
+    cookie.obtainContext<ArithmeticMultiCommandContext>(cookie).drive();
+}
+
 static void set_ctrl_token_executor(Cookie& cookie) {
     using cb::mcbp::request::SetCtrlTokenPayload;
     auto& req = cookie.getRequest(Cookie::PacketContent::Full);
@@ -658,6 +669,8 @@ void initialize_mbcp_lookup_map() {
                            process_bin_dcp_response);
     setup_response_handler(cb::mcbp::ClientOpcode::DcpAbort,
                            process_bin_dcp_response);
+    setup_response_handler(cb::mcbp::ClientOpcode::DcpSeqnoAdvanced,
+                           process_bin_dcp_response);
     setup_response_handler(cb::mcbp::ClientOpcode::GetErrorMap,
                            process_bin_dcp_response);
 
@@ -733,7 +746,9 @@ void initialize_mbcp_lookup_map() {
     setup_handler(cb::mcbp::ClientOpcode::Get, get_executor);
     setup_handler(cb::mcbp::ClientOpcode::Getq, get_executor);
     setup_handler(cb::mcbp::ClientOpcode::Getk, get_executor);
+    setup_handler(cb::mcbp::ClientOpcode::GetMulti, get_multi_executor);
     setup_handler(cb::mcbp::ClientOpcode::Getkq, get_executor);
+    setup_handler(cb::mcbp::ClientOpcode::GetReplica, get_executor);
     setup_handler(cb::mcbp::ClientOpcode::GetMeta, get_meta_executor);
     setup_handler(cb::mcbp::ClientOpcode::GetqMeta, get_meta_executor);
     setup_handler(cb::mcbp::ClientOpcode::Gat, gat_executor);
@@ -744,6 +759,8 @@ void initialize_mbcp_lookup_map() {
     setup_handler(cb::mcbp::ClientOpcode::Stat, stat_executor);
     setup_handler(cb::mcbp::ClientOpcode::Increment, arithmetic_executor);
     setup_handler(cb::mcbp::ClientOpcode::Incrementq, arithmetic_executor);
+    setup_handler(cb::mcbp::ClientOpcode::ArithmeticMulti,
+                  arithmetic_multi_executor);
     setup_handler(cb::mcbp::ClientOpcode::Decrement, arithmetic_executor);
     setup_handler(cb::mcbp::ClientOpcode::Decrementq, arithmetic_executor);
     setup_handler(cb::mcbp::ClientOpcode::GetCmdTimer, get_cmd_timer_executor);
@@ -834,8 +851,16 @@ void execute_client_request_packet(Cookie& cookie,
 
     const auto opcode = request.getClientOpcode();
     auto res = cb::rbac::PrivilegeAccess::Ok;
-    if (!cookie.isAuthorized()) {
+    if (!cookie.isAuthorized() && !c->isOpcodeAuthorized(opcode)) {
         res = privilegeChains.invoke(opcode, cookie);
+        // The privilege chains only depend on the privilege context, so
+        // we may skip them for the following commands with the same
+        // opcode until the context change. Privilege debug grants access
+        // to everything so we can't cache those results.
+        if (res == cb::rbac::PrivilegeAccess::Ok &&
+            !Settings::instance().isPrivilegeDebug()) {
+            c->setOpcodeAuthorized(opcode);
+        }
     }
 
     switch (res) {
@@ -854,6 +879,12 @@ void execute_client_request_packet(Cookie& cookie,
         return;
     case cb::rbac::PrivilegeAccess::Ok:
         cookie.setAuthorized();
+        if (!admitRequest(cookie)) {
+            // Deferred by the throughput limits of the bucket; the cookie
+            // is notified once it may run
+            cookie.setEwouldblock(true);
+            return;
+        }
         handlers[std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode)](
                 cookie);
         return;
@@ -977,8 +1008,17 @@ void try_read_mcbp_command(Cookie& cookie) {
             cb::const_byte_buffer{input.data(), sizeof(cb::mcbp::Request)},
             c.isTracingEnabled());
 
+    // Pipelined frames are decoded (and their headers checked) in batches;
+    // a pre-validated frame is complete and skips the checks below
+    auto& frames = c.getInputFrames();
+    auto frame = frames.next(input);
+    if (frame.empty() &&
+        frames.scan(input, Settings::instance().getMaxPacketSize()) != 0) {
+        frame = frames.next(input);
+    }
+
     const auto& header = cookie.getHeader();
-    if (!header.isValid()) {
+    if (frame.empty() && !header.isValid()) {
         LOG_WARNING(
                 "{}: Invalid packet format detected (magic: {:#x}), closing "
                 "connection",
@@ -1002,6 +1042,13 @@ void try_read_mcbp_command(Cookie& cookie) {
         }
     }
 
+    if (!frame.empty()) {
+        c.addMsgHdr(true);
+        cookie.setPacket(Cookie::PacketContent::Full, frame);
+        c.setState(StateMachine::State::validate);
+        return;
+    }
+
     // Protect ourself from someone trying to kill us by sending insanely
     // large packets.
     if (header.getBodylen() > Settings::instance().getMaxPacketSize()) {
@@ -0,0 +1,61 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "mcbp_frame_batch.h"
+
+#include <mcbp/protocol/header.h>
+
+size_t FrameBatch::scan(cb::const_byte_buffer input, size_t maxPacketSize) {
+    count = current = 0;
+    size_t offset = 0;
+    while (count < MaxFrames &&
+           input.size() - offset >= sizeof(cb::mcbp::Header)) {
+        const auto& header =
+                *reinterpret_cast<const cb::mcbp::Header*>(input.data() + offset);
+        const auto bodylen = header.getBodylen();
+        if (bodylen > maxPacketSize || !header.isValid()) {
+            break;
+        }
+        const auto size = sizeof(cb::mcbp::Header) + bodylen;
+        if (input.size() - offset < size) {
+            break;
+        }
+        sizes[count++] = uint32_t(size);
+        offset += size;
+    }
+    return count;
+}
+
+cb::const_byte_buffer FrameBatch::next(cb::const_byte_buffer input) {
+    if (empty()) {
+        return {};
+    }
+
+    const auto size = sizes[current];
+    if (input.size() >= size) {
+        const auto& header =
+                *reinterpret_cast<const cb::mcbp::Header*>(input.data());
+        if (sizeof(cb::mcbp::Header) + header.getBodylen() == size) {
+            ++current;
+            return {input.data(), size};
+        }
+    }
+
+    // The input doesn't start with the frame we scanned
+    clear();
+    return {};
+}
@@ -0,0 +1,84 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Batched decode of the frames in a connection's input buffer
+ */
+#pragma once
+
+#include <platform/sized_buffer.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A client pipelining small requests typically has many complete frames in
+ * the read buffer after a single recv(). Rather than locating and checking
+ * the header of one frame per state machine iteration, FrameBatch scans the
+ * input buffer once for all the complete frames at its head and runs the
+ * opcode independent header checks on them (the magic and length fields
+ * adding up (Header::isValid()), and the packet size limit) in a tight
+ * loop. The frames are then handed out, in order, as pre-validated by
+ * next(); the opcode specific validators still run for each of them.
+ *
+ * Only the frame sizes are recorded, as the frames always start at the
+ * head of the read buffer (a command consumes its frame before the next is
+ * parsed), and the buffer may be moved (by pack() or growing it) between
+ * commands.
+ */
+class FrameBatch {
+public:
+    /// The maximum number of frames decoded by a single scan
+    static constexpr size_t MaxFrames = 32;
+
+    /**
+     * Scan the input for complete frames with a valid header no bigger than
+     * maxPacketSize. Scanning stops at the first incomplete (or invalid)
+     * frame, which is left for the per-packet path to deal with.
+     *
+     * @param input the data in the read buffer
+     * @param maxPacketSize the maximum (body) size of a packet
+     * @return the number of frames found
+     */
+    size_t scan(cb::const_byte_buffer input, size_t maxPacketSize);
+
+    /**
+     * Get the next pre-validated frame from the head of the input.
+     *
+     * @param input the data in the read buffer
+     * @return the frame, or an empty buffer if no pre-validated frames
+     *         are left (or the input no longer matches the scan, in which
+     *         case the batch is discarded)
+     */
+    cb::const_byte_buffer next(cb::const_byte_buffer input);
+
+    bool empty() const {
+        return current == count;
+    }
+
+    /// Discard the remaining frames
+    void clear() {
+        current = count = 0;
+    }
+
+private:
+    /// The size (header + body) of each frame found in the last scan
+    std::array<uint32_t, MaxFrames> sizes;
+    size_t count = 0;
+    size_t current = 0;
+};
@@ -76,6 +76,7 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
     setup(cb::mcbp::ClientOpcode::Get, require<Privilege::Read>);
     setup(cb::mcbp::ClientOpcode::Getq, require<Privilege::Read>);
     setup(cb::mcbp::ClientOpcode::Getk, require<Privilege::Read>);
+    setup(cb::mcbp::ClientOpcode::GetMulti, require<Privilege::Read>);
     setup(cb::mcbp::ClientOpcode::Getkq, require<Privilege::Read>);
     setup(cb::mcbp::ClientOpcode::GetFailoverLog, require<Privilege::Read>);
     setup(cb::mcbp::ClientOpcode::Set, require<Privilege::Upsert>);
@@ -98,6 +99,9 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
     setup(cb::mcbp::ClientOpcode::Decrement, require<Privilege::Upsert>);
     setup(cb::mcbp::ClientOpcode::Decrementq, require<Privilege::Read>);
     setup(cb::mcbp::ClientOpcode::Decrementq, require<Privilege::Upsert>);
+    setup(cb::mcbp::ClientOpcode::ArithmeticMulti, require<Privilege::Read>);
+    setup(cb::mcbp::ClientOpcode::ArithmeticMulti,
+          require<Privilege::Upsert>);
     setup(cb::mcbp::ClientOpcode::Quit, empty);
     setup(cb::mcbp::ClientOpcode::Quitq, empty);
     setup(cb::mcbp::ClientOpcode::Flush, require<Privilege::BucketManagement>);
@@ -233,6 +237,8 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
     setup(cb::mcbp::ClientOpcode::AddqWithMeta, require<Privilege::MetaWrite>);
     setup(cb::mcbp::ClientOpcode::DelWithMeta, require<Privilege::MetaWrite>);
     setup(cb::mcbp::ClientOpcode::DelqWithMeta, require<Privilege::MetaWrite>);
+    setup(cb::mcbp::ClientOpcode::SetWithMetaMulti,
+          require<Privilege::MetaWrite>);
 
     /**
      * Command to create a new checkpoint on a given vbucket by force
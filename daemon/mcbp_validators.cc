@@ -20,6 +20,8 @@
 #include "connection.h"
 #include "cookie.h"
 #include "memcached.h"
+#include "protocol/mcbp/arithmetic_multi_context.h"
+#include "protocol/mcbp/get_multi_context.h"
 #include "subdocument_validators.h"
 #include "xattr/utils.h"
 #include <logger/logger.h>
@@ -35,7 +37,10 @@ using cb::mcbp::Status;
 
 bool is_document_key_valid(Cookie& cookie) {
     const auto& req = cookie.getRequest(Cookie::PacketContent::Header);
-    const auto& key = req.getKey();
+    return is_document_key_valid(cookie, req.getKey());
+}
+
+bool is_document_key_valid(Cookie& cookie, cb::const_byte_buffer key) {
     if (!cookie.getConnection().isCollectionsSupported()) {
         return true;
     }
@@ -610,12 +615,12 @@ static Status dcp_system_event_validator(Cookie& cookie) {
     return verify_common_dcp_restrictions(cookie);
 }
 
-static bool is_valid_xattr_blob(const cb::mcbp::Request& request) {
-    auto value = request.getValue();
+static bool is_valid_xattr_blob(cb::const_byte_buffer value,
+                                protocol_binary_datatype_t datatype) {
     cb::compression::Buffer buffer;
     cb::const_char_buffer xattr{reinterpret_cast<const char*>(value.data()),
                                 value.size()};
-    if (mcbp::datatype::is_snappy(uint8_t(request.getDatatype()))) {
+    if (mcbp::datatype::is_snappy(datatype)) {
         // Inflate the xattr data and validate that.
         if (!cb::compression::inflate(
                     cb::compression::Algorithm::Snappy, xattr, buffer)) {
@@ -627,6 +632,12 @@ static bool is_valid_xattr_blob(const cb::mcbp::Request& request) {
     return cb::xattr::validate(xattr);
 }
 
+static bool is_valid_xattr_blob(const cb::mcbp::Request& request) {
+    return is_valid_xattr_blob(
+            request.getValue(),
+            protocol_binary_datatype_t(request.getDatatype()));
+}
+
 static Status dcp_mutation_validator(Cookie& cookie) {
     using cb::mcbp::request::DcpMutationPayload;
 
@@ -1163,6 +1174,63 @@ static Status get_validator(Cookie& cookie) {
     return Status::Success;
 }
 
+static Status get_replica_validator(Cookie& cookie) {
+    auto& header = cookie.getHeader();
+
+    // Pass the extras len in because we will check it manually as the
+    // max staleness is optional
+    auto status = McbpValidator::verify_header(cookie,
+                                               header.getExtlen(),
+                                               ExpectedKeyLen::NonZero,
+                                               ExpectedValueLen::Zero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+    if (header.getExtlen() != 0 && header.getExtlen() != sizeof(uint32_t)) {
+        cookie.setErrorContext("Request must include extras of length 0 or 4");
+        return Status::Einval;
+    }
+    if (!is_document_key_valid(cookie)) {
+        return Status::Einval;
+    }
+
+    return Status::Success;
+}
+
+static Status get_multi_validator(Cookie& cookie) {
+    auto status = McbpValidator::verify_header(cookie,
+                                               0,
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::NonZero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    const auto& req = cookie.getRequest(Cookie::PacketContent::Full);
+    status = Status::Success;
+    const bool wellFormed = GetMultiCommandContext::parseKeys(
+            req.getValue(),
+            [&cookie, &status](Vbid, cb::const_byte_buffer key) {
+                if (key.empty() || key.size() > KEY_MAX_LENGTH) {
+                    cookie.setErrorContext("Invalid key length:" +
+                                           std::to_string(key.size()));
+                    status = Status::Einval;
+                } else if (!is_document_key_valid(cookie, key)) {
+                    status = Status::Einval;
+                }
+                return status == Status::Success;
+            });
+    if (!wellFormed) {
+        cookie.setErrorContext("Truncated key entry");
+        return Status::Einval;
+    }
+    return status;
+}
+
 static Status gat_validator(Cookie& cookie) {
     auto status =
             McbpValidator::verify_header(cookie,
@@ -1251,6 +1319,46 @@ static Status arithmetic_validator(Cookie& cookie) {
     return Status::Success;
 }
 
+static Status arithmetic_multi_validator(Cookie& cookie) {
+    auto status = McbpValidator::verify_header(cookie,
+                                               0,
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::NonZero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    const auto& req = cookie.getRequest(Cookie::PacketContent::Full);
+    status = Status::Success;
+    const bool wellFormed = ArithmeticMultiCommandContext::parseEntries(
+            req.getValue(),
+            [&cookie, &status](Vbid,
+                               cb::mcbp::ClientOpcode opcode,
+                               const cb::mcbp::request::ArithmeticPayload&,
+                               cb::const_byte_buffer key) {
+                if (opcode != cb::mcbp::ClientOpcode::Increment &&
+                    opcode != cb::mcbp::ClientOpcode::Decrement) {
+                    cookie.setErrorContext("Invalid opcode:" +
+                                           std::to_string(int(opcode)));
+                    status = Status::Einval;
+                } else if (key.empty() || key.size() > KEY_MAX_LENGTH) {
+                    cookie.setErrorContext("Invalid key length:" +
+                                           std::to_string(key.size()));
+                    status = Status::Einval;
+                } else if (!is_document_key_valid(cookie, key)) {
+                    status = Status::Einval;
+                }
+                return status == Status::Success;
+            });
+    if (!wellFormed) {
+        cookie.setErrorContext("Truncated entry");
+        return Status::Einval;
+    }
+    return status;
+}
+
 static Status get_cmd_timer_validator(Cookie& cookie) {
     return McbpValidator::verify_header(cookie,
                                         1,
@@ -1613,6 +1721,62 @@ static Status mutate_with_meta_validator(Cookie& cookie) {
     return Status::Success;
 }
 
+static Status set_with_meta_multi_validator(Cookie& cookie) {
+    auto& header = cookie.getHeader();
+    // The extras is either empty or the (4-byte) options for all entries
+    auto status = McbpValidator::verify_header(cookie,
+                                               header.getExtlen(),
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::NonZero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+    if (header.getExtlen() != 0 && header.getExtlen() != sizeof(uint32_t)) {
+        cookie.setErrorContext("Request extras invalid");
+        return Status::Einval;
+    }
+
+    const auto& req = cookie.getRequest(Cookie::PacketContent::Full);
+    auto& connection = cookie.getConnection();
+    status = Status::Success;
+    const bool wellFormed =
+            cb::mcbp::request::SetWithMetaMultiEntry::parse(
+                    req.getValue(),
+                    [&cookie, &connection, &status](
+                            const cb::mcbp::request::SetWithMetaMultiEntry&
+                                    entry,
+                            cb::const_byte_buffer key,
+                            cb::const_byte_buffer value) {
+                        const auto datatype = entry.getDatatype();
+                        if (key.empty() || key.size() > KEY_MAX_LENGTH) {
+                            cookie.setErrorContext(
+                                    "Invalid key length:" +
+                                    std::to_string(key.size()));
+                            status = Status::Einval;
+                        } else if (!is_document_key_valid(cookie, key)) {
+                            status = Status::Einval;
+                        } else if (!mcbp::datatype::is_valid(datatype) ||
+                                   !connection.isDatatypeEnabled(datatype)) {
+                            cookie.setErrorContext(
+                                    "Invalid datatype:" +
+                                    std::to_string(int(datatype)));
+                            status = Status::Einval;
+                        } else if (mcbp::datatype::is_xattr(datatype) &&
+                                   !is_valid_xattr_blob(value, datatype)) {
+                            cookie.setErrorContext("Xattr blob invalid");
+                            status = Status::XattrEinval;
+                        }
+                        return status == Status::Success;
+                    });
+    if (!wellFormed) {
+        cookie.setErrorContext("Truncated entry");
+        return Status::Einval;
+    }
+    return status;
+}
+
 static Status get_errmap_validator(Cookie& cookie) {
     auto status = McbpValidator::verify_header(cookie,
                                                0,
@@ -1810,12 +1974,29 @@ static Status scrub_validator(Cookie& cookie) {
 }
 
 static Status get_random_key_validator(Cookie& cookie) {
-    return McbpValidator::verify_header(cookie,
-                                        0,
-                                        ExpectedKeyLen::Zero,
-                                        ExpectedValueLen::Zero,
-                                        ExpectedCas::NotSet,
-                                        PROTOCOL_BINARY_RAW_BYTES);
+    const auto extlen = cookie.getHeader().getExtlen();
+    auto status = McbpValidator::verify_header(cookie,
+                                               extlen,
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::Zero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    // The extras (if present) request a sample of keys: the number of keys
+    // to sample, optionally followed by the collection to sample them from
+    if (extlen != 0 && extlen != sizeof(uint32_t) &&
+        extlen != 2 * sizeof(uint32_t)) {
+        cookie.setErrorContext(
+                "Expected 4 bytes of extras containing the number of keys to "
+                "sample, optionally followed by 4 bytes containing the "
+                "collection");
+        return Status::Einval;
+    }
+
+    return Status::Success;
 }
 
 /**
@@ -2163,6 +2344,7 @@ McbpValidator::McbpValidator() {
     setup(cb::mcbp::ClientOpcode::Getq, get_validator);
     setup(cb::mcbp::ClientOpcode::Getk, get_validator);
     setup(cb::mcbp::ClientOpcode::Getkq, get_validator);
+    setup(cb::mcbp::ClientOpcode::GetMulti, get_multi_validator);
     setup(cb::mcbp::ClientOpcode::Gat, gat_validator);
     setup(cb::mcbp::ClientOpcode::Gatq, gat_validator);
     setup(cb::mcbp::ClientOpcode::Touch, gat_validator);
@@ -2173,6 +2355,8 @@ McbpValidator::McbpValidator() {
     setup(cb::mcbp::ClientOpcode::Incrementq, arithmetic_validator);
     setup(cb::mcbp::ClientOpcode::Decrement, arithmetic_validator);
     setup(cb::mcbp::ClientOpcode::Decrementq, arithmetic_validator);
+    setup(cb::mcbp::ClientOpcode::ArithmeticMulti,
+          arithmetic_multi_validator);
     setup(cb::mcbp::ClientOpcode::GetCmdTimer, get_cmd_timer_validator);
     setup(cb::mcbp::ClientOpcode::SetCtrlToken, set_ctrl_token_validator);
     setup(cb::mcbp::ClientOpcode::GetCtrlToken, get_ctrl_token_validator);
@@ -2238,6 +2422,8 @@ McbpValidator::McbpValidator() {
     setup(cb::mcbp::ClientOpcode::AddqWithMeta, mutate_with_meta_validator);
     setup(cb::mcbp::ClientOpcode::DelWithMeta, mutate_with_meta_validator);
     setup(cb::mcbp::ClientOpcode::DelqWithMeta, mutate_with_meta_validator);
+    setup(cb::mcbp::ClientOpcode::SetWithMetaMulti,
+          set_with_meta_multi_validator);
     setup(cb::mcbp::ClientOpcode::GetErrorMap, get_errmap_validator);
     setup(cb::mcbp::ClientOpcode::GetLocked, get_locked_validator);
     setup(cb::mcbp::ClientOpcode::UnlockKey, unlock_validator);
@@ -2276,7 +2462,7 @@ McbpValidator::McbpValidator() {
           enable_disable_traffic_validator);
     setup(cb::mcbp::ClientOpcode::GetKeys, get_keys_validator);
     setup(cb::mcbp::ClientOpcode::SetParam, set_param_validator);
-    setup(cb::mcbp::ClientOpcode::GetReplica, get_validator);
+    setup(cb::mcbp::ClientOpcode::GetReplica, get_replica_validator);
     setup(cb::mcbp::ClientOpcode::ReturnMeta, return_meta_validator);
     setup(cb::mcbp::ClientOpcode::SeqnoPersistence,
           seqno_persistence_validator);
@@ -75,3 +75,9 @@ protected:
  * @return true if the keylen represents a valid key for the connection
  */
 bool is_document_key_valid(Cookie& cookie);
+
+/**
+ * Validate the given key (e.g. one of several keys encoded in the value of
+ * a request) as per is_document_key_valid(Cookie&).
+ */
+bool is_document_key_valid(Cookie& cookie, cb::const_byte_buffer key);
@@ -16,6 +16,8 @@
 
 #include "memcached.h"
 #include "alloc_hooks.h"
+#include "allocation_counter.h"
+#include "bucket_throttle.h"
 #include "buckets.h"
 #include "cmdline.h"
 #include "config_parse.h"
@@ -50,11 +52,13 @@
 #include "server_socket.h"
 #include "session_cas.h"
 #include "settings.h"
+#include "ssl_server_context.h"
 #include "stats.h"
 #include "subdocument.h"
 #include "timings.h"
 #include "topkeys.h"
 #include "tracing.h"
+#include "traffic_capture.h"
 #include "utilities/engine_loader.h"
 #include "utilities/terminate_handler.h"
 
@@ -64,6 +68,7 @@
 #include <mcbp/mcbp.h>
 #include <memcached/audit_interface.h>
 #include <memcached/rbac.h>
+#include <memcached/sampling_profiler.h>
 #include <memcached/server_bucket_iface.h>
 #include <memcached/server_cookie_iface.h>
 #include <memcached/server_core_iface.h>
@@ -134,6 +139,7 @@ std::atomic<bool> memcached_shutdown;
 std::atomic<bool> service_online;
 
 std::unique_ptr<cb::ExecutorPool> executorPool;
+std::unique_ptr<cb::ExecutorPool> saslExecutorPool;
 
 /* Mutex for global stats */
 std::mutex stats_mutex;
@@ -363,6 +369,8 @@ static void stats_init() {
     stats.total_conns.reset();
     stats.daemon_conns.reset();
     stats.rejected_conns.reset();
+    stats.numa_local_conns.reset();
+    stats.numa_remote_conns.reset();
     stats.curr_conns.store(0, std::memory_order_relaxed);
 }
 
@@ -380,6 +388,8 @@ void stats_reset(Cookie& cookie) {
     }
     stats.total_conns.reset();
     stats.rejected_conns.reset();
+    stats.numa_local_conns.reset();
+    stats.numa_remote_conns.reset();
     threadlocal_stats_reset(cookie.getConnection().getBucket().stats);
     bucket_reset_stats(cookie);
 }
@@ -478,6 +488,10 @@ static void opcode_attributes_override_changed_listener(const std::string&,
              cb::mcbp::sla::to_json().dump());
 }
 
+static void bucket_throttle_changed_listener(const std::string&, Settings&) {
+    reconfigureBucketThrottles();
+}
+
 static void interfaces_changed_listener(const std::string&, Settings &s) {
     check_listen_conn = true;
     notify_dispatcher();
@@ -532,6 +546,28 @@ static void settings_init() {
                             s.getActiveExternalUsersPushInterval());
                 }
             });
+    Settings::instance().addChangeListener(
+            "external_auth_cache_ttl",
+            [](const std::string&, Settings& s) -> void {
+                if (externalAuthManager) {
+                    externalAuthManager->setAuthCacheTtl(
+                            s.getExternalAuthCacheTtl());
+                }
+            });
+
+    // The SSL contexts shared by the connections must be rebuilt when
+    // one of the settings used to create them change
+    for (const auto* key : {"ssl_cipher_list",
+                            "ssl_cipher_suites",
+                            "ssl_cipher_order",
+                            "ssl_minimum_protocol",
+                            "ssl_ktls_enabled",
+                            "client_cert_auth"}) {
+        Settings::instance().addChangeListener(
+                key, [](const std::string&, Settings&) -> void {
+                    invalidateSslServerContexts();
+                });
+    }
 
     Settings::instance().addChangeListener(
             "opentracing_config", [](const std::string&, Settings& s) -> void {
@@ -643,6 +679,8 @@ static void update_settings_from_config()
     Settings::instance().addChangeListener(
             "opcode_attributes_override",
             opcode_attributes_override_changed_listener);
+    Settings::instance().addChangeListener("bucket_throttle",
+                                           bucket_throttle_changed_listener);
 }
 
 struct {
@@ -706,6 +744,15 @@ static nlohmann::json get_bucket_details_UNLOCKED(const Bucket& bucket,
             json["clients"] = bucket.clients;
             json["name"] = bucket.name;
             json["type"] = to_string(bucket.type);
+            if (bucket.deletionPhase != Bucket::DeletionPhase::None) {
+                json["deletion"] = {
+                        {"phase", to_string(bucket.deletionPhase)},
+                        {"elapsed_ms",
+                         std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() -
+                                 bucket.deletionStart)
+                                 .count()}};
+            }
         } catch (const std::exception& e) {
             LOG_ERROR("Failed to generate bucket details: {}", e.what());
         }
@@ -803,18 +850,16 @@ void event_handler(evutil_socket_t fd, short which, void *arg) {
     // object was scheduled to run in the dispatcher before the
     // callback for the worker thread is executed.
     //
-    {
-        std::lock_guard<std::mutex> lock(thr.pending_io.mutex);
-        auto iter = thr.pending_io.map.find(c);
-        if (iter != thr.pending_io.map.end()) {
-            for (const auto& pair : iter->second) {
-                if (pair.first) {
-                    pair.first->setAiostat(pair.second);
-                    pair.first->setEwouldblock(false);
-                }
+    thr.pending_io.drain();
+    auto iter = thr.pending_io.map.find(c);
+    if (iter != thr.pending_io.map.end()) {
+        for (const auto& pair : iter->second) {
+            if (pair.first) {
+                pair.first->setAiostat(pair.second);
+                pair.first->setEwouldblock(false);
             }
-            thr.pending_io.map.erase(iter);
         }
+        thr.pending_io.map.erase(iter);
     }
 
     // Remove the connection from the notification list if it's there
@@ -1730,8 +1775,8 @@ struct ServerCookieApi : public ServerCookieIface {
 class ServerApi : public SERVER_HANDLE_V1 {
 public:
     ServerApi() : server_handle_v1_t() {
-        hooks_api.add_new_hook = AllocHooks::add_new_hook;
-        hooks_api.remove_new_hook = AllocHooks::remove_new_hook;
+        hooks_api.add_new_hook = AllocationCounter::add_new_hook;
+        hooks_api.remove_new_hook = AllocationCounter::remove_new_hook;
         hooks_api.add_delete_hook = AllocHooks::add_delete_hook;
         hooks_api.remove_delete_hook = AllocHooks::remove_delete_hook;
         hooks_api.get_extra_stats_size = AllocHooks::get_extra_stats_size;
@@ -1741,6 +1786,10 @@ public:
         hooks_api.release_free_memory = AllocHooks::release_free_memory;
         hooks_api.enable_thread_cache = AllocHooks::enable_thread_cache;
         hooks_api.get_allocator_property = AllocHooks::get_allocator_property;
+        hooks_api.create_arena = AllocHooks::create_arena;
+        hooks_api.release_arena = AllocHooks::release_arena;
+        hooks_api.set_thread_arena = AllocHooks::set_thread_arena;
+        hooks_api.get_arena_allocated = AllocHooks::get_arena_allocated;
 
         core = &core_api;
         callback = &callback_api;
@@ -1893,6 +1942,7 @@ void CreateBucketThread::create() {
                  name);
         bucket.max_document_size = engine->getMaxItemSize();
         bucket.supportedFeatures = engine->getFeatures();
+        configureBucketThrottle(bucket);
     } else {
         {
             std::lock_guard<std::mutex> guard(bucket.mutex);
@@ -1916,6 +1966,11 @@ void CreateBucketThread::run()
     task->makeRunnable();
 }
 
+static void setDeletionPhase(Bucket& bucket, Bucket::DeletionPhase phase) {
+    std::lock_guard<std::mutex> guard(bucket.mutex);
+    bucket.deletionPhase = phase;
+}
+
 void DestroyBucketThread::destroy() {
     ENGINE_ERROR_CODE ret = ENGINE_KEY_ENOENT;
     std::unique_lock<std::mutex> all_bucket_lock(buckets_lock);
@@ -1944,6 +1999,10 @@ void DestroyBucketThread::destroy() {
             if (all_buckets[ii].state == Bucket::State::Ready) {
                 ret = ENGINE_SUCCESS;
                 all_buckets[ii].state = Bucket::State::Destroying;
+                all_buckets[ii].deletionPhase =
+                        Bucket::DeletionPhase::Disconnecting;
+                all_buckets[ii].deletionStart =
+                        std::chrono::steady_clock::now();
             } else {
                 ret = ENGINE_KEY_EEXISTS;
             }
@@ -1968,6 +2027,9 @@ void DestroyBucketThread::destroy() {
 
     all_buckets[idx].getEngine()->initiate_shutdown();
     all_buckets[idx].getEngine()->cancel_all_operations_in_ewb_state();
+    // Release the requests deferred by the throughput limits (the timer
+    // releasing them isn't running during shutdown)
+    all_buckets[idx].throttle.configure({});
 
     LOG_INFO("{} Delete bucket [{}]. Engine ready for shutdown",
              connection_id,
@@ -2082,12 +2144,14 @@ void DestroyBucketThread::destroy() {
 
     LOG_INFO(
             "{} Delete bucket [{}]. Shut down the bucket", connection_id, name);
+    setDeletionPhase(bucket, Bucket::DeletionPhase::ShuttingDown);
 
     bucket.getEngine()->destroy(force);
 
     LOG_INFO("{} Delete bucket [{}]. Clean up allocated resources ",
              connection_id,
              name);
+    setDeletionPhase(bucket, Bucket::DeletionPhase::Cleanup);
     bucket.reset();
 
     LOG_INFO("{} Delete bucket [{}] complete", connection_id, name);
@@ -2105,6 +2169,7 @@ void initialize_buckets() {
     size_t numthread = Settings::instance().getNumWorkerThreads() + 1;
     for (auto &b : all_buckets) {
         b.stats.resize(numthread);
+        b.responseCounters.resize(numthread);
     }
 
     // To make the life easier for us in the code, index 0
@@ -2298,6 +2363,7 @@ extern "C" int memcached_main(int argc, char **argv) {
     cb_initialize_sockets();
 
     AllocHooks::initialize();
+    AllocationCounter::initialize();
 
     /* init settings */
     settings_init();
@@ -2345,6 +2411,20 @@ extern "C" int memcached_main(int argc, char **argv) {
 
     LOG_INFO("Using SLA configuration: {}", cb::mcbp::sla::to_json().dump());
 
+    Settings::instance().addChangeListener(
+            "sampling_profiler_frequency",
+            [](const std::string&, Settings& s) -> void {
+                cb::profiler::start(s.getSamplingProfilerFrequency());
+            });
+    if (Settings::instance().getSamplingProfilerFrequency() != 0) {
+        if (cb::profiler::isSupported()) {
+            cb::profiler::start(
+                    Settings::instance().getSamplingProfilerFrequency());
+        } else {
+            LOG_WARNING("Sampling profiler is not supported on this platform");
+        }
+    }
+
     auto opentracingconfig = Settings::instance().getOpenTracingConfig();
     if (opentracingconfig) {
         OpenTracing::updateConfig(*opentracingconfig);
@@ -2406,6 +2486,8 @@ extern "C" int memcached_main(int argc, char **argv) {
     externalAuthManager = std::make_unique<ExternalAuthManagerThread>();
     externalAuthManager->setPushActiveUsersInterval(
             Settings::instance().getActiveExternalUsersPushInterval());
+    externalAuthManager->setAuthCacheTtl(
+            Settings::instance().getExternalAuthCacheTtl());
     externalAuthManager->start();
 
     initialize_audit();
@@ -2472,6 +2554,8 @@ extern "C" int memcached_main(int argc, char **argv) {
 
     executorPool = std::make_unique<cb::ExecutorPool>(
             Settings::instance().getNumWorkerThreads());
+    saslExecutorPool = std::make_unique<cb::ExecutorPool>(
+            Settings::instance().getNumWorkerThreads());
 
     initializeTracing();
     TRACE_GLOBAL0("memcached", "Started");
@@ -2486,6 +2570,8 @@ extern "C" int memcached_main(int argc, char **argv) {
     /* Initialise memcached time keeping */
     mc_time_init(main_base);
 
+    initializeBucketThrottleTimer(main_base);
+
     // Optional parent monitor
     {
         const int parent = Settings::instance().getParentIdentifier();
@@ -2504,6 +2590,8 @@ extern "C" int memcached_main(int argc, char **argv) {
     }
 
     LOG_INFO("Initiating graceful shutdown.");
+    cb::profiler::stop();
+    stopTrafficCapture();
     delete_all_buckets();
 
     if (parent_monitor) {
@@ -2532,7 +2620,8 @@ extern "C" int memcached_main(int argc, char **argv) {
     LOG_INFO("Releasing thread resources");
     threads_cleanup();
 
-    LOG_INFO("Shutting down executor pool");
+    LOG_INFO("Shutting down executor pools");
+    saslExecutorPool.reset();
     executorPool.reset();
 
     LOG_INFO("Releasing signal handlers");
@@ -2565,6 +2654,7 @@ extern "C" int memcached_main(int argc, char **argv) {
     shutdown_openssl();
 
     LOG_INFO("Shutting down libevent");
+    shutdownBucketThrottleTimer();
     event_base_free(main_base);
 
     if (OpenTracing::isEnabled()) {
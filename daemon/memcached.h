@@ -11,6 +11,7 @@
 #include <mutex>
 #include <queue>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 /** \file
@@ -41,6 +42,9 @@
 #define IOV_LIST_HIGHWAT 50
 #define MSG_LIST_HIGHWAT 20
 
+/** Max number of idle read (and write) buffers pooled per worker thread */
+#define BUFFER_POOL_MAX_SIZE 32
+
 /* Maximum length of config which can be validated */
 #define CONFIG_VALIDATE_MAX_LENGTH (64 * 1024)
 
@@ -86,6 +90,12 @@ int is_listen_thread(void);
 
 void threadlocal_stats_reset(std::vector<thread_stats>& thread_stats);
 
+/**
+ * Get the number of IO notifications the worker threads have handled, and
+ * the number of times they were woken up through their notification pipe.
+ */
+std::pair<uint64_t, uint64_t> get_worker_notification_stats();
+
 void notify_io_complete(gsl::not_null<const void*> cookie,
                         ENGINE_ERROR_CODE status);
 void safe_close(SOCKET sfd);
@@ -133,6 +143,13 @@ class ExecutorPool;
 }
 extern std::unique_ptr<cb::ExecutorPool> executorPool;
 
+/**
+ * The executor pool used to run the SASL authentication tasks. SCRAM
+ * authentication is CPU intensive, so it runs in its own pool to avoid
+ * a storm of reconnecting clients from delaying the other tasks.
+ */
+extern std::unique_ptr<cb::ExecutorPool> saslExecutorPool;
+
 void iterate_all_connections(std::function<void(Connection&)> callback);
 
 void start_stdin_listener(std::function<void()> function);
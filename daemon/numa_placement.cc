@@ -0,0 +1,76 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "numa_placement.h"
+
+#include <logger/logger.h>
+#include <platform/strerror.h>
+
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+#ifndef WIN32
+#include <sys/socket.h>
+#endif
+
+int getNumaNodeCount() {
+#ifdef HAVE_LIBNUMA
+    if (numa_available() == 0) {
+        return numa_num_configured_nodes();
+    }
+#endif
+    return 1;
+}
+
+bool bindCurrentThreadToNumaNode(int node) {
+#ifdef HAVE_LIBNUMA
+    if (numa_available() != 0) {
+        return false;
+    }
+    if (numa_run_on_node(node) != 0) {
+        LOG_WARNING("Failed to bind thread to NUMA node {}: {}",
+                    node,
+                    cb_strerror());
+        return false;
+    }
+    // Override the (process wide) interleave policy so that the memory
+    // used by the connections served by this thread is local to it
+    numa_set_localalloc();
+    return true;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+int getNumaNodeOfSocket(SOCKET sfd) {
+#if defined(HAVE_LIBNUMA) && defined(SO_INCOMING_CPU)
+    if (numa_available() != 0) {
+        return -1;
+    }
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(sfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) != 0 ||
+        cpu < 0) {
+        return -1;
+    }
+    return numa_node_of_cpu(cpu);
+#else
+    (void)sfd;
+    return -1;
+#endif
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/socket.h>
+
+/**
+ * Helpers used to place the front end threads on the NUMA nodes when
+ * *numa_aware_threads* is enabled. All of them degrade gracefully to a
+ * single node if memcached isn't built with libnuma (or the system doesn't
+ * support NUMA).
+ */
+
+/// @return the number of NUMA nodes (1 if NUMA isn't available)
+int getNumaNodeCount();
+
+/**
+ * Bind the calling thread to the CPUs of the given node, and make its
+ * memory allocations prefer the node.
+ *
+ * @return true if the thread was bound
+ */
+bool bindCurrentThreadToNumaNode(int node);
+
+/**
+ * Get the NUMA node of the CPU which processed the incoming packets for
+ * the socket (the CPU servicing the NIC queue the connection is hashed to).
+ *
+ * @return the node, or -1 if it can't be determined
+ */
+int getNumaNodeOfSocket(SOCKET sfd);
@@ -20,9 +20,12 @@
 #include <daemon/cookie.h>
 #include <daemon/stats.h>
 #include <memcached/durability_spec.h>
+#include <snappy.h>
 #include <xattr/blob.h>
 #include <xattr/utils.h>
 
+#include <algorithm>
+
 AppendPrependCommandContext::AppendPrependCommandContext(
         Cookie& cookie, const cb::mcbp::Request& req)
     : SteppableCommandContext(cookie),
@@ -127,7 +130,12 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::getItem() {
             return ENGINE_LOCKED;
         }
 
-        if (mcbp::datatype::is_snappy(oldItemInfo.datatype)) {
+        if (mcbp::datatype::is_snappy(oldItemInfo.datatype) &&
+            !mcbp::datatype::is_xattr(oldItemInfo.datatype)) {
+            // Inflate directly into the new item (we need the xattrs
+            // before we may allocate it, so that only works without them)
+            inflateIntoNewItem = true;
+        } else if (mcbp::datatype::is_snappy(oldItemInfo.datatype)) {
             try {
                 cb::const_char_buffer payload(static_cast<const char*>(
                                               oldItemInfo.value[0].iov_base),
@@ -155,6 +163,13 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::allocateNewItem() {
 
     if (buffer.size() != 0) {
         old = {buffer.data(), buffer.size()};
+    } else if (inflateIntoNewItem) {
+        // Inflated into the new item below
+        old = {nullptr,
+               cb::compression::get_uncompressed_length(
+                       cb::compression::Algorithm::Snappy,
+                       {static_cast<const char*>(oldItemInfo.value[0].iov_base),
+                        oldItemInfo.value[0].iov_len})};
     }
 
     // If we're operating on a document containing xattr's we need to
@@ -201,7 +216,23 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::allocateNewItem() {
                          pair.second.value[0].iov_len};
 
     // copy the data over..
-    if (mode == Mode::Append) {
+    if (inflateIntoNewItem) {
+        const auto* compressed =
+                static_cast<const char*>(oldItemInfo.value[0].iov_base);
+        auto* dest = reinterpret_cast<char*>(body.buf);
+        if (mode == Mode::Prepend) {
+            dest += value.len;
+        }
+        if (!snappy::RawUncompress(
+                    compressed, oldItemInfo.value[0].iov_len, dest)) {
+            return ENGINE_FAILED;
+        }
+        memcpy(mode == Mode::Append ? body.buf + old.len : body.buf,
+               value.buf,
+               value.len);
+        old.buf = reinterpret_cast<char*>(body.buf) +
+                  (mode == Mode::Append ? 0 : value.len);
+    } else if (mode == Mode::Append) {
         memcpy(body.buf, old.buf, old.len);
         memcpy(body.buf + old.len, value.buf, value.len);
     } else {
@@ -213,12 +244,19 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::allocateNewItem() {
                old.len - body_offset);
     }
     // If the resulting document's data is valid JSON, set the datatype flag
-    // to reflect this.
+    // to reflect this. There is no need to validate the (potentially large)
+    // result if we know that the added data broke the JSON document.
     cb::const_byte_buffer buf{
             reinterpret_cast<const uint8_t*>(body.buf + body_offset),
-            old.len + value.len};
+            old.len - body_offset + value.len};
+    const cb::const_byte_buffer oldBody{
+            reinterpret_cast<const uint8_t*>(old.buf + body_offset),
+            old.len - body_offset};
     // Update the documents's datatype and CAS values
-    setDatatypeJSONFromValue(buf, datatype);
+    if (!mcbp::datatype::is_json(oldItemInfo.datatype) ||
+        !breaksJsonDocument(mode, oldBody, value)) {
+        setDatatypeJSONFromValue(buf, datatype);
+    }
     bucket_item_set_datatype(connection, newitem.get(), datatype);
     bucket_item_set_cas(connection, newitem.get(), oldItemInfo.cas);
 
@@ -267,10 +305,34 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::storeItem() {
     return ret;
 }
 
+bool AppendPrependCommandContext::breaksJsonDocument(
+        Mode mode,
+        cb::const_byte_buffer document,
+        cb::const_byte_buffer value) {
+    auto isSpace = [](uint8_t c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    };
+    if (std::all_of(value.data(), value.data() + value.size(), isSpace)) {
+        return false;
+    }
+
+    const auto* begin = document.data();
+    const auto* end = document.data() + document.size();
+    if (mode == Mode::Append) {
+        while (end != begin && isSpace(*(end - 1))) {
+            --end;
+        }
+        return end != begin && (*(end - 1) == '}' || *(end - 1) == ']');
+    }
+    const auto* it = std::find_if_not(begin, end, isSpace);
+    return it != end && (*it == '{' || *it == '[');
+}
+
 ENGINE_ERROR_CODE AppendPrependCommandContext::reset() {
     olditem.reset();
     newitem.reset();
     buffer.reset();
+    inflateIntoNewItem = false;
 
     state = State::GetItem;
     return ENGINE_SUCCESS;
@@ -77,6 +77,20 @@ protected:
 
     ENGINE_ERROR_CODE reset();
 
+    /**
+     * Check if the result of adding value to a JSON document is known to
+     * not be JSON (without validating the result): a JSON object or array
+     * ends at its closing bracket, so nothing but whitespace may precede or
+     * follow it.
+     *
+     * @param mode if the value is appended or prepended
+     * @param document the (JSON) body of the existing document
+     * @param value the data to add
+     */
+    static bool breaksJsonDocument(Mode mode,
+                                   cb::const_byte_buffer document,
+                                   cb::const_byte_buffer value);
+
 private:
     const Mode mode;
     const Vbid vbucket;
@@ -88,6 +102,10 @@ private:
     cb::unique_item_ptr newitem;
 
     cb::compression::Buffer buffer;
+
+    /// Set if the existing (Snappy compressed) value should be inflated
+    /// directly into the new item rather than into buffer
+    bool inflateIntoNewItem = false;
     cb::compression::Buffer inputbuffer;
     State state;
 
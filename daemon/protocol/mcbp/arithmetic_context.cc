@@ -244,8 +244,7 @@ ENGINE_ERROR_CODE ArithmeticCommandContext::sendResult() {
     }
 
     if (cookie.getRequest().isQuiet()) {
-        ++connection.getBucket()
-                  .responseCounters[int(cb::mcbp::Status::Success)];
+        connection.countResponse(cb::mcbp::Status::Success);
         connection.setState(StateMachine::State::new_cmd);
         return ENGINE_SUCCESS;
     }
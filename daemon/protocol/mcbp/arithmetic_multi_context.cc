@@ -0,0 +1,381 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "arithmetic_multi_context.h"
+
+#include "engine_wrapper.h"
+
+#include <daemon/buckets.h>
+#include <daemon/cookie.h>
+#include <daemon/mcaudit.h>
+#include <daemon/memcached.h>
+#include <daemon/stats.h>
+#include <daemon/topkeys.h>
+#include <logger/logger.h>
+#include <mcbp/protocol/status.h>
+#include <memcached/util.h>
+#include <xattr/blob.h>
+
+#include <algorithm>
+#include <cstring>
+
+using cb::mcbp::request::ArithmeticPayload;
+
+bool ArithmeticMultiCommandContext::parseEntries(
+        cb::const_byte_buffer value,
+        std::function<bool(Vbid,
+                           cb::mcbp::ClientOpcode,
+                           const ArithmeticPayload&,
+                           cb::const_byte_buffer)> callback) {
+    size_t offset = 0;
+    while (offset < value.size()) {
+        if (offset + EntryHeaderSize > value.size()) {
+            return false;
+        }
+        uint16_t vbid;
+        uint16_t keylen;
+        ArithmeticPayload extras;
+        std::memcpy(&vbid, value.data() + offset, sizeof(vbid));
+        offset += sizeof(vbid);
+        std::memcpy(&keylen, value.data() + offset, sizeof(keylen));
+        offset += sizeof(keylen);
+        const auto opcode = cb::mcbp::ClientOpcode(value.data()[offset]);
+        offset += 1;
+        std::memcpy(&extras, value.data() + offset, sizeof(extras));
+        offset += sizeof(extras);
+        keylen = ntohs(keylen);
+        if (offset + keylen > value.size()) {
+            return false;
+        }
+        if (!callback(Vbid(ntohs(vbid)),
+                      opcode,
+                      extras,
+                      {value.data() + offset, keylen})) {
+            return true;
+        }
+        offset += keylen;
+    }
+    return true;
+}
+
+ArithmeticMultiCommandContext::ArithmeticMultiCommandContext(Cookie& cookie)
+    : SteppableCommandContext(cookie) {
+    // The validator has already checked the value is well formed.
+    parseEntries(cookie.getRequest().getValue(),
+                 [this](Vbid vbucket,
+                        cb::mcbp::ClientOpcode opcode,
+                        const ArithmeticPayload& extras,
+                        cb::const_byte_buffer key) {
+                     entries.emplace_back();
+                     auto& entry = entries.back();
+                     entry.vbucket = vbucket;
+                     entry.key = key;
+                     entry.increment =
+                             opcode == cb::mcbp::ClientOpcode::Increment;
+                     entry.extras = extras;
+                     return true;
+                 });
+
+    order.resize(entries.size());
+    for (size_t ii = 0; ii < order.size(); ++ii) {
+        order[ii] = ii;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return entries[a].vbucket < entries[b].vbucket;
+    });
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::applyMutations() {
+    while (next < order.size()) {
+        auto ret = applyMutation(entries[order[next]]);
+        if (ret != ENGINE_SUCCESS) {
+            return ret;
+        }
+        ++next;
+    }
+
+    state = State::SendResponse;
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::applyMutation(Entry& entry) {
+    auto ret = ENGINE_SUCCESS;
+    try {
+        while (ret == ENGINE_SUCCESS && entry.state != EntryState::Done) {
+            switch (entry.state) {
+            case EntryState::GetItem:
+                ret = getItem(entry);
+                break;
+            case EntryState::CreateNewItem:
+                ret = createNewItem(entry);
+                break;
+            case EntryState::StoreNewItem:
+                ret = storeNewItem(entry);
+                break;
+            case EntryState::AllocateNewItem:
+                ret = allocateNewItem(entry);
+                break;
+            case EntryState::StoreItem:
+                ret = storeItem(entry);
+                break;
+            case EntryState::Done:
+                break;
+            }
+        }
+    } catch (const cb::engine_error& error) {
+        ret = ENGINE_ERROR_CODE(error.code().value());
+    }
+
+    if (ret == ENGINE_SUCCESS) {
+        // Entry completed
+        if (entry.increment) {
+            STATS_INCR(&connection, incr_hits);
+        } else {
+            STATS_INCR(&connection, decr_hits);
+        }
+        auto& bucket = connection.getBucket();
+        if (bucket.topkeys != nullptr) {
+            const auto key = connection.makeDocKey(entry.key);
+            bucket.topkeys->updateKey(
+                    key.data(), key.size(), mc_time_get_current_time());
+        }
+    } else if (ret == ENGINE_EWOULDBLOCK || ret == ENGINE_DISCONNECT) {
+        return ret;
+    } else {
+        if (ret == ENGINE_LOCKED || ret == ENGINE_LOCKED_TMPFAIL) {
+            STATS_INCR(&connection, lock_errors);
+        }
+        const auto remapped = connection.remapErrorCode(ret);
+        if (remapped == ENGINE_DISCONNECT) {
+            return ENGINE_DISCONNECT;
+        }
+        entry.status = cb::engine_errc(remapped);
+        entry.result = 0;
+        entry.state = EntryState::Done;
+    }
+
+    entry.olditem.reset();
+    entry.newitem.reset();
+    entry.buffer.reset();
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::getItem(Entry& entry) {
+    auto ret = bucket_get(
+            cookie, connection.makeDocKey(entry.key), entry.vbucket);
+    if (ret.first == cb::engine_errc::success) {
+        entry.olditem = std::move(ret.second);
+        if (!bucket_get_item_info(
+                    connection, entry.olditem.get(), &entry.oldItemInfo)) {
+            return ENGINE_FAILED;
+        }
+
+        if (mcbp::datatype::is_snappy(entry.oldItemInfo.datatype)) {
+            cb::const_char_buffer payload(
+                    static_cast<const char*>(
+                            entry.oldItemInfo.value[0].iov_base),
+                    entry.oldItemInfo.value[0].iov_len);
+            try {
+                if (!cb::compression::inflate(
+                            cb::compression::Algorithm::Snappy,
+                            payload,
+                            entry.buffer)) {
+                    return ENGINE_FAILED;
+                }
+            } catch (const std::bad_alloc&) {
+                return ENGINE_ENOMEM;
+            }
+        }
+        entry.state = EntryState::AllocateNewItem;
+    } else if (ret.first == cb::engine_errc::no_such_key) {
+        if (entry.extras.getExpiration() != 0xffffffff) {
+            entry.state = EntryState::CreateNewItem;
+            ret.first = cb::engine_errc::success;
+        } else if (entry.increment) {
+            STATS_INCR(&connection, incr_misses);
+        } else {
+            STATS_INCR(&connection, decr_misses);
+        }
+    }
+
+    return ENGINE_ERROR_CODE(ret.first);
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::createNewItem(Entry& entry) {
+    const std::string value{std::to_string(entry.extras.getInitial())};
+    entry.result = entry.extras.getInitial();
+
+    auto pair = bucket_allocate_ex(cookie,
+                                   connection.makeDocKey(entry.key),
+                                   value.size(),
+                                   0, // no privileged bytes
+                                   0, // Empty flags
+                                   entry.extras.getExpiration(),
+                                   PROTOCOL_BINARY_DATATYPE_JSON,
+                                   entry.vbucket);
+    entry.newitem = std::move(pair.first);
+    std::memcpy(pair.second.value[0].iov_base, value.data(), value.size());
+    entry.state = EntryState::StoreNewItem;
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::storeNewItem(Entry& entry) {
+    auto ret = store(entry, OPERATION_ADD);
+    if (ret == ENGINE_SUCCESS) {
+        entry.state = EntryState::Done;
+    } else if (ret == ENGINE_KEY_EEXISTS || ret == ENGINE_NOT_STORED) {
+        // Someone created the document after we looked for it; retry
+        reset(entry);
+        ret = ENGINE_SUCCESS;
+    }
+    return ret;
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::allocateNewItem(
+        Entry& entry) {
+    const auto& info = entry.oldItemInfo;
+    size_t oldsize = info.nbytes;
+    const auto* src = static_cast<const char*>(info.value[0].iov_base);
+    if (entry.buffer.size() != 0) {
+        src = entry.buffer.data();
+        oldsize = entry.buffer.size();
+    }
+
+    // Preserve the XATTRs of the existing item if it had any
+    size_t xattrsize = 0;
+    size_t priv_bytes = 0;
+    if (mcbp::datatype::is_xattr(info.datatype)) {
+        cb::xattr::Blob blob({const_cast<char*>(src), oldsize},
+                             mcbp::datatype::is_snappy(info.datatype));
+        priv_bytes = blob.get_system_size();
+        xattrsize = blob.size();
+    }
+    const std::string payload(src + xattrsize, oldsize - xattrsize);
+
+    uint64_t oldval;
+    if (!safe_strtoull(payload.c_str(), oldval)) {
+        return ENGINE_DELTA_BADVAL;
+    }
+
+    const auto delta = entry.extras.getDelta();
+    if (entry.increment) {
+        oldval += delta;
+    } else {
+        oldval = oldval < delta ? 0 : oldval - delta;
+    }
+    entry.result = oldval;
+    const std::string value = std::to_string(entry.result);
+
+    auto datatype = PROTOCOL_BINARY_DATATYPE_JSON;
+    if (xattrsize > 0) {
+        datatype |= PROTOCOL_BINARY_DATATYPE_XATTR;
+    }
+
+    auto pair = bucket_allocate_ex(cookie,
+                                   connection.makeDocKey(entry.key),
+                                   xattrsize + value.size(),
+                                   priv_bytes,
+                                   info.flags,
+                                   rel_time_t(info.exptime),
+                                   datatype,
+                                   entry.vbucket);
+    entry.newitem = std::move(pair.first);
+    auto* body = static_cast<char*>(pair.second.value[0].iov_base);
+    std::memcpy(body, src, xattrsize);
+    std::memcpy(body + xattrsize, value.data(), value.size());
+    bucket_item_set_cas(connection, entry.newitem.get(), info.cas);
+
+    entry.state = EntryState::StoreItem;
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::storeItem(Entry& entry) {
+    auto ret = store(entry, OPERATION_CAS);
+    if (ret == ENGINE_SUCCESS) {
+        entry.state = EntryState::Done;
+    } else if (ret == ENGINE_KEY_EEXISTS) {
+        // The document was modified after we read it; retry
+        reset(entry);
+        ret = ENGINE_SUCCESS;
+    }
+    return ret;
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::store(
+        Entry& entry, ENGINE_STORE_OPERATION operation) {
+    uint64_t ncas = 0;
+    auto ret = connection.getBucketEngine()->store(&cookie,
+                                                   entry.newitem.get(),
+                                                   ncas,
+                                                   operation,
+                                                   {},
+                                                   DocumentState::Alive);
+    if (ret == ENGINE_SUCCESS) {
+        cb::audit::document::add(
+                cookie, cb::audit::document::Operation::Modify, entry.key);
+    } else if (ret == ENGINE_DISCONNECT) {
+        LOG_WARNING("{}: {} ArithmeticMulti store returned ENGINE_DISCONNECT",
+                    connection.getId(),
+                    connection.getDescription());
+    }
+    return ret;
+}
+
+void ArithmeticMultiCommandContext::reset(Entry& entry) {
+    entry.olditem.reset();
+    entry.newitem.reset();
+    entry.buffer.reset();
+    entry.state = EntryState::GetItem;
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::sendResponse() {
+    std::string value(entries.size() * ResultSize, '\0');
+    auto* ptr = &value[0];
+    for (const auto& entry : entries) {
+        const uint16_t status =
+                htons(uint16_t(cb::mcbp::to_status(entry.status)));
+        const uint64_t result = htonll(entry.result);
+        std::memcpy(ptr, &status, sizeof(status));
+        std::memcpy(ptr + sizeof(status), &result, sizeof(result));
+        ptr += ResultSize;
+    }
+
+    state = State::Done;
+    cookie.sendResponse(cb::mcbp::Status::Success,
+                        {},
+                        {},
+                        {value.data(), value.size()},
+                        cb::mcbp::Datatype::Raw,
+                        0);
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE ArithmeticMultiCommandContext::step() {
+    auto ret = ENGINE_SUCCESS;
+    do {
+        switch (state) {
+        case State::ApplyMutations:
+            ret = applyMutations();
+            break;
+        case State::SendResponse:
+            ret = sendResponse();
+            break;
+        case State::Done:
+            return ENGINE_SUCCESS;
+        }
+    } while (ret == ENGINE_SUCCESS);
+    return ret;
+}
@@ -0,0 +1,158 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "steppable_command_context.h"
+
+#include <mcbp/protocol/opcode.h>
+#include <memcached/engine.h>
+#include <memcached/protocol_binary.h>
+#include <platform/compress.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * The ArithmeticMultiCommandContext is a state machine used by the
+ * memcached core to implement the ArithmeticMulti operation; applying a
+ * batch of independent increment / decrement operations (which may
+ * operate on documents in different vbuckets) with a single request.
+ *
+ * The value of the request is a sequence of entries, one per counter:
+ *
+ *     vbucket (2 bytes, network byte order)
+ *     key length (2 bytes, network byte order)
+ *     opcode (1 byte, Increment or Decrement)
+ *     delta, initial and expiration (20 bytes, as the extras of Increment)
+ *     key (key length bytes, encoded as for any other command)
+ *
+ * Each entry follows the rules of ArithmeticCommandContext. The entries
+ * are applied grouped by vbucket, one at a time (the engine may only track
+ * a single blocking operation per cookie), and the failure of one entry
+ * doesn't affect the others. A single response is sent once all entries
+ * are applied, containing the status and the new value of each entry in
+ * request order.
+ */
+class ArithmeticMultiCommandContext : public SteppableCommandContext {
+public:
+    enum class State : uint8_t { ApplyMutations, SendResponse, Done };
+
+    explicit ArithmeticMultiCommandContext(Cookie& cookie);
+
+    /**
+     * Parse the entries of an ArithmeticMulti request value, calling the
+     * callback for each one.
+     *
+     * @param value The value of the request
+     * @param callback Called with the vbucket, opcode, payload and key of
+     *                 each entry; return false to stop parsing.
+     * @return false if the value is malformed (an entry is truncated)
+     */
+    static bool parseEntries(
+            cb::const_byte_buffer value,
+            std::function<bool(Vbid,
+                               cb::mcbp::ClientOpcode,
+                               const cb::mcbp::request::ArithmeticPayload&,
+                               cb::const_byte_buffer)> callback);
+
+    /// The size of an entry in the request (excluding the key)
+    static const size_t EntryHeaderSize =
+            2 * sizeof(uint16_t) + 1 +
+            sizeof(cb::mcbp::request::ArithmeticPayload);
+
+    /// The size of the status and value of an entry in the response
+    static const size_t ResultSize = sizeof(uint16_t) + sizeof(uint64_t);
+
+protected:
+    ENGINE_ERROR_CODE step() override;
+
+    /**
+     * Apply the outstanding entries (in vbucket order).
+     *
+     * @return ENGINE_EWOULDBLOCK if an entry is blocked in the engine,
+     *         ENGINE_SUCCESS once all entries have been applied, or
+     *         ENGINE_DISCONNECT if the connection should be closed.
+     */
+    ENGINE_ERROR_CODE applyMutations();
+
+    /// Send the status and the value of every entry
+    ENGINE_ERROR_CODE sendResponse();
+
+private:
+    enum class EntryState : uint8_t {
+        GetItem,
+        CreateNewItem,
+        StoreNewItem,
+        AllocateNewItem,
+        StoreItem,
+        Done
+    };
+
+    struct Entry {
+        Vbid vbucket;
+        cb::const_byte_buffer key;
+        bool increment = true;
+        cb::mcbp::request::ArithmeticPayload extras;
+        EntryState state = EntryState::GetItem;
+        cb::engine_errc status = cb::engine_errc::success;
+        uint64_t result = 0;
+        cb::unique_item_ptr olditem;
+        item_info oldItemInfo;
+        cb::unique_item_ptr newitem;
+        cb::compression::Buffer buffer;
+    };
+
+    /**
+     * Run the state machine of the entry until it's done (successfully or
+     * with an error stored in the entry) or blocks.
+     *
+     * @return ENGINE_SUCCESS once the entry is done, ENGINE_EWOULDBLOCK
+     *         or ENGINE_DISCONNECT
+     */
+    ENGINE_ERROR_CODE applyMutation(Entry& entry);
+
+    ENGINE_ERROR_CODE getItem(Entry& entry);
+
+    ENGINE_ERROR_CODE createNewItem(Entry& entry);
+
+    ENGINE_ERROR_CODE storeNewItem(Entry& entry);
+
+    ENGINE_ERROR_CODE allocateNewItem(Entry& entry);
+
+    ENGINE_ERROR_CODE storeItem(Entry& entry);
+
+    /**
+     * Store the item of the entry (bucket_store would audit the key of the
+     * request, which is empty)
+     */
+    ENGINE_ERROR_CODE store(Entry& entry, ENGINE_STORE_OPERATION operation);
+
+    /// Restart the entry after losing a race with another mutation
+    void reset(Entry& entry);
+
+    std::vector<Entry> entries;
+
+    /// Indexes into entries in the order they are applied (grouped by
+    /// vbucket)
+    std::vector<size_t> order;
+
+    /// The next element in order to apply
+    size_t next = 0;
+
+    State state = State::ApplyMutations;
+};
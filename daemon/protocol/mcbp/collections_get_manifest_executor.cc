@@ -34,8 +34,7 @@ void collections_get_manifest_executor(Cookie& cookie) {
         if (cookie.getDynamicBuffer().getRoot() != nullptr) {
             // We assume that if the underlying engine returns a success then
             // it is sending a success to the client.
-            ++connection.getBucket()
-                      .responseCounters[int(cb::mcbp::Status::Success)];
+            connection.countResponse(cb::mcbp::Status::Success);
             cookie.sendDynamicBuffer();
         } else {
             connection.setState(StateMachine::State::new_cmd);
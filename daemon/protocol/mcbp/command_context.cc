@@ -0,0 +1,167 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "command_context.h"
+
+#include <relaxed_atomic.h>
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+
+/// Blocks are pooled in power of two size classes from 64 bytes ...
+constexpr std::size_t MinBlockSize = 64;
+/// ... up to 4k; bigger contexts always use the global operator new
+constexpr std::size_t NumSizeClasses = 7;
+/// The maximum number of idle blocks kept per size class and thread
+constexpr std::size_t MaxPooledBlocks = 64;
+
+std::size_t getSizeClass(std::size_t size) {
+    std::size_t sizeClass = 0;
+    std::size_t blockSize = MinBlockSize;
+    while (blockSize < size) {
+        blockSize <<= 1;
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+std::size_t getBlockSize(std::size_t sizeClass) {
+    return MinBlockSize << sizeClass;
+}
+
+class ContextPool;
+
+/// All live pools, so the stats may be summed over every thread
+struct PoolRegistry {
+    std::mutex mutex;
+    std::vector<ContextPool*> pools;
+    // The counters of the pools of the threads which have exited
+    uint64_t heapAllocations = 0;
+    uint64_t poolReuses = 0;
+};
+
+PoolRegistry& getRegistry() {
+    // Never destroyed, as thread local pools may outlive static destruction
+    static auto* registry = new PoolRegistry;
+    return *registry;
+}
+
+/**
+ * The per thread pool of idle context blocks. A context is normally created
+ * and destroyed by the same front end thread, but a block freed by another
+ * thread simply ends up in that thread's pool (all blocks come from the
+ * global operator new).
+ */
+class ContextPool {
+public:
+    ContextPool() {
+        auto& registry = getRegistry();
+        std::lock_guard<std::mutex> guard(registry.mutex);
+        registry.pools.push_back(this);
+    }
+
+    ~ContextPool() {
+        for (auto& blocks : free) {
+            for (auto* block : blocks) {
+                ::operator delete(block);
+            }
+        }
+        auto& registry = getRegistry();
+        std::lock_guard<std::mutex> guard(registry.mutex);
+        registry.heapAllocations += heapAllocations;
+        registry.poolReuses += poolReuses;
+        registry.pools.erase(std::find(
+                registry.pools.begin(), registry.pools.end(), this));
+    }
+
+    void* allocate(std::size_t size) {
+        const auto sizeClass = getSizeClass(size);
+        if (sizeClass >= NumSizeClasses) {
+            heapAllocations++;
+            return ::operator new(size);
+        }
+
+        auto& blocks = free[sizeClass];
+        if (blocks.empty()) {
+            heapAllocations++;
+            return ::operator new(getBlockSize(sizeClass));
+        }
+        auto* ret = blocks.back();
+        blocks.pop_back();
+        poolReuses++;
+        return ret;
+    }
+
+    void deallocate(void* ptr, std::size_t size) {
+        const auto sizeClass = getSizeClass(size);
+        if (sizeClass < NumSizeClasses &&
+            free[sizeClass].size() < MaxPooledBlocks) {
+            try {
+                free[sizeClass].push_back(ptr);
+                return;
+            } catch (const std::bad_alloc&) {
+                // Fall through and release the block
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+    cb::RelaxedAtomic<uint64_t> heapAllocations{0};
+    cb::RelaxedAtomic<uint64_t> poolReuses{0};
+
+private:
+    std::array<std::vector<void*>, NumSizeClasses> free;
+};
+
+ContextPool& getPool() {
+    thread_local ContextPool pool;
+    return pool;
+}
+
+} // namespace
+
+void* CommandContext::operator new(std::size_t size) {
+    return getPool().allocate(size);
+}
+
+void CommandContext::operator delete(void* ptr, std::size_t size) {
+    getPool().deallocate(ptr, size);
+}
+
+uint64_t CommandContext::getHeapAllocations() {
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> guard(registry.mutex);
+    auto ret = registry.heapAllocations;
+    for (const auto* pool : registry.pools) {
+        ret += pool->heapAllocations;
+    }
+    return ret;
+}
+
+uint64_t CommandContext::getPoolReuses() {
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> guard(registry.mutex);
+    auto ret = registry.poolReuses;
+    for (const auto* pool : registry.pools) {
+        ret += pool->poolReuses;
+    }
+    return ret;
+}
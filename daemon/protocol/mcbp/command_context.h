@@ -19,6 +19,9 @@
 #include <memcached/engine_error.h>
 #include <memcached/types.h>
 
+#include <cstddef>
+#include <cstdint>
+
 /**
  *  A command may need to store command specific context during the duration
  *  of a command (you might for instance want to keep state between multiple
@@ -27,11 +30,34 @@
  *  The implementation of such commands should subclass this class and
  *  allocate an instance and store in the commands commandContext member (which
  *  will be deleted and set to nullptr between each command being processed).
+ *
+ *  As a context is created for most commands, the memory for them is
+ *  recycled through a per thread pool (see operator new) instead of being
+ *  returned to the allocator when the command completes.
  */
 class CommandContext {
 public:
     virtual ~CommandContext(){};
 
+    /**
+     * Allocate the memory for a context from the calling thread's pool,
+     * falling back to the global operator new when the pool has no block
+     * of the right size class (or the context is too big to be pooled).
+     */
+    static void* operator new(std::size_t size);
+
+    /**
+     * Return the memory of a context to the calling thread's pool (the
+     * size is that of the most derived type, as the destructor is virtual)
+     */
+    static void operator delete(void* ptr, std::size_t size);
+
+    /// The number of contexts allocated from the heap (pool misses)
+    static uint64_t getHeapAllocations();
+
+    /// The number of contexts allocated by reusing a pooled block
+    static uint64_t getPoolReuses();
+
     /**
      * The `pre_link_document()` is a hook called from the underlying engine
      * as part of the `store()` method in the engine API. See the `pre_link()`
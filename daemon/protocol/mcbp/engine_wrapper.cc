@@ -249,6 +249,22 @@ cb::EngineErrorItemPair bucket_get_locked(Cookie& cookie,
     return ret;
 }
 
+cb::EngineErrorItemPair bucket_get_replica(
+        Cookie& cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        std::chrono::milliseconds maxStaleness) {
+    auto& c = cookie.getConnection();
+    auto ret = c.getBucketEngine()->get_replica(
+            &cookie, key, vbucket, maxStaleness);
+    if (ret.first == cb::engine_errc::disconnect) {
+        LOG_WARNING("{}: {} bucket_get_replica return ENGINE_DISCONNECT",
+                    c.getId(),
+                    c.getDescription());
+    }
+    return ret;
+}
+
 size_t bucket_get_max_item_size(Cookie& cookie) {
     auto& c = cookie.getConnection();
     return c.getBucketEngine()->getMaxItemSize();
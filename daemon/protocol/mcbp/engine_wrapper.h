@@ -109,6 +109,12 @@ cb::EngineErrorItemPair bucket_get_locked(Cookie& cookie,
                                           Vbid vbucket,
                                           uint32_t lock_timeout);
 
+cb::EngineErrorItemPair bucket_get_replica(
+        Cookie& cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        std::chrono::milliseconds maxStaleness);
+
 ENGINE_ERROR_CODE bucket_unlock(Cookie& cookie,
                                 const DocKey& key,
                                 Vbid vbucket,
@@ -26,7 +26,6 @@
 #include <mcbp/protocol/header.h>
 #include <memcached/durability_spec.h>
 #include <xattr/utils.h>
-#include <gsl/gsl>
 
 uint32_t GatCommandContext::getExptime(Cookie& cookie) {
     auto extras = cookie.getRequest(Cookie::PacketContent::Full).getExtdata();
@@ -124,33 +123,7 @@ ENGINE_ERROR_CODE GatCommandContext::sendResponse() {
     }
     datatype = connection.getEnabledDatatypes(datatype);
 
-    const auto bodylen =
-            gsl::narrow<uint32_t>(sizeof(info.flags) + payload.size());
-
-    if (connection.useCookieSendResponse(bodylen)) {
-        cookie.sendResponse(cb::mcbp::Status::Success,
-                            {reinterpret_cast<const char*>(&info.flags),
-                             sizeof(info.flags)},
-                            {},
-                            {payload.buf, payload.len},
-                            cb::mcbp::Datatype(info.datatype),
-                            info.cas);
-    } else {
-        // Set the CAS to add into the header
-        cookie.setCas(info.cas);
-        mcbp_add_header(cookie,
-                        cb::mcbp::Status::Success,
-                        sizeof(info.flags),
-                        0, // no key
-                        bodylen,
-                        datatype);
-
-        // Add the flags
-        connection.addIov(&info.flags, sizeof(info.flags));
-        // Add the value
-        connection.addIov(payload.buf, payload.len);
-        connection.setState(StateMachine::State::send_data);
-    }
+    mcbp_send_document(cookie, info.flags, {}, payload, datatype, info.cas);
     cb::audit::document::add(cookie, cb::audit::document::Operation::Read);
     state = State::Done;
     return ENGINE_SUCCESS;
@@ -159,8 +132,7 @@ ENGINE_ERROR_CODE GatCommandContext::sendResponse() {
 ENGINE_ERROR_CODE GatCommandContext::noSuchItem() {
     STATS_MISS(&connection, get);
     if (cookie.getRequest().isQuiet()) {
-        ++connection.getBucket()
-                    .responseCounters[int(cb::mcbp::Status::KeyEnoent)];
+        connection.countResponse(cb::mcbp::Status::KeyEnoent);
         connection.setState(StateMachine::State::new_cmd);
     } else {
         cookie.sendResponse(cb::mcbp::Status::KeyEnoent);
@@ -20,16 +20,30 @@
 
 #include <daemon/buckets.h>
 #include <daemon/debug_helpers.h>
+#include <daemon/front_end_thread.h>
 #include <daemon/mcaudit.h>
 #include <daemon/mcbp.h>
 #include <daemon/memcached.h>
 #include <logger/logger.h>
+#include <tracing/trace_helpers.h>
 #include <xattr/utils.h>
-#include <gsl/gsl>
 
 ENGINE_ERROR_CODE GetCommandContext::getItem() {
     const auto key = cookie.getRequestKey();
-    auto ret = bucket_get(cookie, key, vbucket);
+    cb::EngineErrorItemPair ret;
+    const auto& request = cookie.getHeader().getRequest();
+    if (request.getClientOpcode() == cb::mcbp::ClientOpcode::GetReplica) {
+        // The (optional) extras is the max staleness the client accepts
+        auto maxStaleness = std::chrono::milliseconds::max();
+        const auto extras = request.getExtdata();
+        if (extras.size() == sizeof(uint32_t)) {
+            maxStaleness = std::chrono::milliseconds(ntohl(
+                    *reinterpret_cast<const uint32_t*>(extras.data())));
+        }
+        ret = bucket_get_replica(cookie, key, vbucket, maxStaleness);
+    } else {
+        ret = bucket_get(cookie, key, vbucket);
+    }
     if (ret.first == cb::engine_errc::success) {
         it = std::move(ret.second);
         if (!bucket_get_item_info(connection, it.get(), &info)) {
@@ -61,12 +75,19 @@ ENGINE_ERROR_CODE GetCommandContext::getItem() {
 
 ENGINE_ERROR_CODE GetCommandContext::inflateItem() {
     try {
-        if (!cb::compression::inflate(cb::compression::Algorithm::Snappy,
-                                      payload, buffer)) {
+        TRACE_SCOPE(cookie, cb::tracing::TraceCode::DECOMPRESS);
+        inflated = connection.getThread().inflatedValues.get(
+                connection.getBucketIndex(),
+                vbucket,
+                info.key,
+                info.cas,
+                info.seqno,
+                payload);
+        if (!inflated) {
             LOG_WARNING("{}: Failed to inflate item", connection.getId());
             return ENGINE_FAILED;
         }
-        payload = buffer;
+        payload = {inflated->data(), inflated->size()};
         info.datatype &= ~PROTOCOL_BINARY_DATATYPE_SNAPPY;
     } catch (const std::bad_alloc&) {
         return ENGINE_ENOMEM;
@@ -84,59 +105,19 @@ ENGINE_ERROR_CODE GetCommandContext::sendResponse() {
 
     info.datatype = connection.getEnabledDatatypes(info.datatype);
 
-    uint16_t keylen = 0;
-    uint32_t bodylen = gsl::narrow<uint32_t>(sizeof(info.flags) + payload.len);
-    auto key = info.key;
-
+    cb::const_char_buffer key;
     if (shouldSendKey()) {
+        auto docKey = info.key;
         // Client doesn't support collection-ID in the key
         if (!connection.isCollectionsSupported()) {
-            key = key.makeDocKeyWithoutCollectionID();
+            docKey = docKey.makeDocKeyWithoutCollectionID();
         }
-        keylen = gsl::narrow<uint16_t>(key.size());
-        bodylen += keylen;
+        key = {reinterpret_cast<const char*>(docKey.data()), docKey.size()};
     }
 
-    // Set the CAS to add into the header
-    if (connection.useCookieSendResponse(bodylen)) {
-        if (shouldSendKey()) {
-            cookie.sendResponse(
-                    cb::mcbp::Status::Success,
-                    {reinterpret_cast<const char*>(&info.flags),
-                     sizeof(info.flags)},
-                    {reinterpret_cast<const char*>(key.data()), key.size()},
-                    {payload.buf, payload.len},
-                    cb::mcbp::Datatype(info.datatype),
-                    info.cas);
-        } else {
-            cookie.sendResponse(cb::mcbp::Status::Success,
-                                {reinterpret_cast<const char*>(&info.flags),
-                                 sizeof(info.flags)},
-                                {},
-                                {payload.buf, payload.len},
-                                cb::mcbp::Datatype(info.datatype),
-                                info.cas);
-        }
-    } else {
-        cookie.setCas(info.cas);
-        mcbp_add_header(cookie,
-                        cb::mcbp::Status::Success,
-                        sizeof(info.flags),
-                        keylen,
-                        bodylen,
-                        info.datatype);
-
-        // Add the flags
-        connection.addIov(&info.flags, sizeof(info.flags));
-
-        // Add the value
-        if (shouldSendKey()) {
-            connection.addIov(key.data(), key.size());
-        }
-
-        connection.addIov(payload.buf, payload.len);
-        connection.setState(StateMachine::State::send_data);
-    }
+    // The key and value reference the item (or the inflated copy we own)
+    mcbp_send_document(
+            cookie, info.flags, key, payload, info.datatype, info.cas);
     cb::audit::document::add(cookie, cb::audit::document::Operation::Read);
 
     STATS_HIT(&connection, get);
@@ -152,8 +133,7 @@ ENGINE_ERROR_CODE GetCommandContext::noSuchItem() {
     const auto key = cookie.getRequestKey();
 
     if (cookie.getRequest().isQuiet()) {
-        ++connection.getBucket()
-                  .responseCounters[int(cb::mcbp::Status::KeyEnoent)];
+        connection.countResponse(cb::mcbp::Status::KeyEnoent);
         connection.setState(StateMachine::State::new_cmd);
     } else {
         if (shouldSendKey()) {
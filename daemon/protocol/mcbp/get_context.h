@@ -17,6 +17,7 @@
 #pragma once
 
 #include <daemon/cookie.h>
+#include <daemon/inflated_value_cache.h>
 #include <daemon/stats.h>
 #include <daemon/topkeys.h>
 #include <mcbp/protocol/header.h>
@@ -26,7 +27,7 @@
 
 /**
  * The GetCommandContext is a state machine used by the memcached
- * core to implement the Get operation
+ * core to implement the Get (and GetReplica) operations
  */
 class GetCommandContext : public SteppableCommandContext {
 public:
@@ -59,14 +60,16 @@ protected:
 
     /**
      * We've got 4 different permutations of the retrieval commands where
-     * two of them returns the key as part of the response.
+     * two of them returns the key as part of the response (plus
+     * GET_REPLICA, which always returns the key).
      *
      * @return true if we should add the key as part of the response
      */
     bool shouldSendKey() {
         const auto opcode = cookie.getHeader().getRequest().getClientOpcode();
         return opcode == cb::mcbp::ClientOpcode::Getk ||
-               opcode == cb::mcbp::ClientOpcode::Getkq;
+               opcode == cb::mcbp::ClientOpcode::Getkq ||
+               opcode == cb::mcbp::ClientOpcode::GetReplica;
     }
 
     /**
@@ -128,6 +131,7 @@ private:
     item_info info;
 
     cb::const_char_buffer payload;
-    cb::compression::Buffer buffer;
+    /// The inflated value (shared with the thread's InflatedValueCache)
+    InflatedValueCache::Value inflated;
     State state;
 };
@@ -87,8 +87,7 @@ ENGINE_ERROR_CODE GetMetaCommandContext::sendResponse() {
 ENGINE_ERROR_CODE GetMetaCommandContext::noSuchItem() {
 
     if (cookie.getRequest().isQuiet()) {
-        auto& bucket = connection.getBucket();
-        bucket.responseCounters[int(cb::mcbp::Status::KeyEnoent)]++;
+        connection.countResponse(cb::mcbp::Status::KeyEnoent);
         connection.setState(StateMachine::State::new_cmd);
     } else {
         auto& req = cookie.getRequest();
@@ -0,0 +1,264 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "get_multi_context.h"
+
+#include "engine_wrapper.h"
+
+#include <daemon/buckets.h>
+#include <daemon/cookie.h>
+#include <daemon/front_end_thread.h>
+#include <daemon/mcaudit.h>
+#include <daemon/mcbp.h>
+#include <daemon/memcached.h>
+#include <daemon/stats.h>
+#include <daemon/topkeys.h>
+#include <logger/logger.h>
+#include <xattr/utils.h>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <cstring>
+
+bool GetMultiCommandContext::parseKeys(
+        cb::const_byte_buffer value,
+        std::function<bool(Vbid, cb::const_byte_buffer)> callback) {
+    size_t offset = 0;
+    while (offset < value.size()) {
+        if (offset + 2 * sizeof(uint16_t) > value.size()) {
+            return false;
+        }
+        uint16_t vbid;
+        uint16_t keylen;
+        std::memcpy(&vbid, value.data() + offset, sizeof(vbid));
+        offset += sizeof(vbid);
+        std::memcpy(&keylen, value.data() + offset, sizeof(keylen));
+        offset += sizeof(keylen);
+        keylen = ntohs(keylen);
+        if (offset + keylen > value.size()) {
+            return false;
+        }
+        if (!callback(Vbid(ntohs(vbid)), {value.data() + offset, keylen})) {
+            return true;
+        }
+        offset += keylen;
+    }
+    return true;
+}
+
+GetMultiCommandContext::GetMultiCommandContext(Cookie& cookie)
+    : SteppableCommandContext(cookie) {
+    // The validator has already checked the value is well formed.
+    parseKeys(cookie.getRequest().getValue(),
+              [this](Vbid vbucket, cb::const_byte_buffer key) {
+                  entries.emplace_back();
+                  entries.back().vbucket = vbucket;
+                  entries.back().key = key;
+                  return true;
+              });
+
+    order.resize(entries.size());
+    for (size_t ii = 0; ii < order.size(); ++ii) {
+        order[ii] = ii;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return entries[a].vbucket < entries[b].vbucket;
+    });
+}
+
+ENGINE_ERROR_CODE GetMultiCommandContext::processItem(
+        Entry& entry, cb::EngineErrorItemPair ret) {
+    entry.pending = false;
+    entry.status = ret.first;
+
+    switch (ret.first) {
+    case cb::engine_errc::success:
+        break;
+    case cb::engine_errc::no_such_key:
+        STATS_MISS(&connection, get);
+        return ENGINE_SUCCESS;
+    case cb::engine_errc::disconnect:
+        return ENGINE_DISCONNECT;
+    default:
+        // Reported with the key in the per-document response.
+        entry.status = cb::engine_errc(
+                connection.remapErrorCode(ENGINE_ERROR_CODE(ret.first)));
+        if (entry.status == cb::engine_errc::disconnect) {
+            return ENGINE_DISCONNECT;
+        }
+        return ENGINE_SUCCESS;
+    }
+
+    entry.item = std::move(ret.second);
+    if (!bucket_get_item_info(connection, entry.item.get(), &entry.info)) {
+        LOG_WARNING("{}: Failed to get item info", connection.getId());
+        return ENGINE_FAILED;
+    }
+
+    entry.payload = {static_cast<const char*>(entry.info.value[0].iov_base),
+                     entry.info.value[0].iov_len};
+
+    if (mcbp::datatype::is_snappy(entry.info.datatype) &&
+        (mcbp::datatype::is_xattr(entry.info.datatype) ||
+         !connection.isSnappyEnabled())) {
+        try {
+            entry.inflated = connection.getThread().inflatedValues.get(
+                    connection.getBucketIndex(),
+                    entry.vbucket,
+                    entry.info.key,
+                    entry.info.cas,
+                    entry.info.seqno,
+                    entry.payload);
+            if (!entry.inflated) {
+                LOG_WARNING("{}: Failed to inflate item", connection.getId());
+                return ENGINE_FAILED;
+            }
+        } catch (const std::bad_alloc&) {
+            return ENGINE_ENOMEM;
+        }
+        entry.payload = {entry.inflated->data(), entry.inflated->size()};
+        entry.info.datatype &= ~PROTOCOL_BINARY_DATATYPE_SNAPPY;
+    }
+
+    if (mcbp::datatype::is_xattr(entry.info.datatype)) {
+        entry.payload = cb::xattr::get_body(entry.payload);
+        entry.info.datatype &= ~PROTOCOL_BINARY_DATATYPE_XATTR;
+    }
+    entry.info.datatype = connection.getEnabledDatatypes(entry.info.datatype);
+
+    STATS_HIT(&connection, get);
+    auto& bucket = connection.getBucket();
+    if (bucket.topkeys != nullptr) {
+        const auto key = connection.makeDocKey(entry.key);
+        bucket.topkeys->updateKey(
+                key.data(), key.size(), mc_time_get_current_time());
+    }
+    cb::audit::document::add(
+            cookie, cb::audit::document::Operation::Read, entry.key);
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE GetMultiCommandContext::getItems() {
+    bool blocked = false;
+    for (const auto index : order) {
+        auto& entry = entries[index];
+        if (!entry.pending) {
+            continue;
+        }
+
+        auto ret = bucket_get(
+                cookie, connection.makeDocKey(entry.key), entry.vbucket);
+        if (ret.first == cb::engine_errc::would_block) {
+            blocked = true;
+            if (allRequested) {
+                break;
+            }
+            continue;
+        }
+
+        const auto status = processItem(entry, std::move(ret));
+        if (status != ENGINE_SUCCESS) {
+            return status;
+        }
+    }
+    allRequested = true;
+
+    if (blocked) {
+        return ENGINE_EWOULDBLOCK;
+    }
+    state = State::SendResponse;
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE GetMultiCommandContext::sendResponse() {
+    // Headers (and the flags following them) are written to the write pipe,
+    // which must not be reallocated once the IO vector points into it;
+    // reserve space for all of them (plus the terminator) up front.
+    const auto headerSize = mcbp_response_header_size(cookie);
+    size_t needed = headerSize;
+    for (const auto& entry : entries) {
+        if (entry.status != cb::engine_errc::no_such_key) {
+            needed += headerSize + sizeof(entry.info.flags);
+        }
+    }
+    connection.write->ensureCapacity(needed);
+    connection.addMsgHdr(true);
+
+    for (const auto index : order) {
+        auto& entry = entries[index];
+        const auto keylen = gsl::narrow<uint16_t>(entry.key.size());
+        if (entry.status == cb::engine_errc::success) {
+            mcbp_append_header(
+                    cookie,
+                    cb::mcbp::Status::Success,
+                    sizeof(entry.info.flags),
+                    keylen,
+                    gsl::narrow<uint32_t>(sizeof(entry.info.flags) + keylen +
+                                          entry.payload.size()),
+                    entry.info.datatype,
+                    entry.info.cas);
+            // Copy the flags into the pipe directly after the header, so
+            // the two share one IO vector entry.
+            auto* flags = connection.write->wdata().data();
+            std::memcpy(flags, &entry.info.flags, sizeof(entry.info.flags));
+            connection.write->produced(sizeof(entry.info.flags));
+            connection.addIov(flags, sizeof(entry.info.flags));
+            connection.addIov(entry.key.data(), entry.key.size());
+            connection.addIov(entry.payload.data(), entry.payload.size());
+        } else if (entry.status != cb::engine_errc::no_such_key) {
+            mcbp_append_header(cookie,
+                               cb::mcbp::to_status(entry.status),
+                               0,
+                               keylen,
+                               keylen,
+                               PROTOCOL_BINARY_RAW_BYTES,
+                               0);
+            connection.addIov(entry.key.data(), entry.key.size());
+        }
+    }
+
+    // And the terminator.
+    mcbp_append_header(cookie,
+                       cb::mcbp::Status::Success,
+                       0,
+                       0,
+                       0,
+                       PROTOCOL_BINARY_RAW_BYTES,
+                       0);
+
+    connection.setState(StateMachine::State::send_data);
+    connection.setWriteAndGo(StateMachine::State::new_cmd);
+    state = State::Done;
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE GetMultiCommandContext::step() {
+    auto ret = ENGINE_SUCCESS;
+    do {
+        switch (state) {
+        case State::GetItems:
+            ret = getItems();
+            break;
+        case State::SendResponse:
+            ret = sendResponse();
+            break;
+        case State::Done:
+            return ENGINE_SUCCESS;
+        }
+    } while (ret == ENGINE_SUCCESS);
+
+    return ret;
+}
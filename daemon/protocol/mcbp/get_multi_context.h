@@ -0,0 +1,124 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "steppable_command_context.h"
+
+#include <daemon/inflated_value_cache.h>
+#include <memcached/engine.h>
+
+#include <functional>
+#include <vector>
+
+/**
+ * The GetMultiCommandContext is a state machine used by the memcached
+ * core to implement the GetMulti operation; fetching a batch of documents
+ * (which may live in different vbuckets) with a single request.
+ *
+ * The value of the request is a sequence of entries, one per document:
+ *
+ *     vbucket (2 bytes, network byte order)
+ *     key length (2 bytes, network byte order)
+ *     key (key length bytes, encoded as for any other command)
+ *
+ * All of the documents are looked up in the engine before any of them are
+ * sent; documents which need to be fetched from disk are all requested from
+ * the engine up front, so they may be fetched as a single batch. The
+ * responses are then sent in one write:
+ *
+ *   * A response (status Success, extras containing the flags, the key and
+ *     the value) for every document found.
+ *   * A response with the key and the status for every document which
+ *     failed with something other than "no such key" (e.g. a NotMyVbucket).
+ *     Missing documents are not reported.
+ *   * A terminating response with status Success and no key or value.
+ *
+ * Responses are grouped by vbucket, and not necessarily in request order.
+ */
+class GetMultiCommandContext : public SteppableCommandContext {
+public:
+    enum class State : uint8_t { GetItems, SendResponse, Done };
+
+    explicit GetMultiCommandContext(Cookie& cookie);
+
+    /**
+     * Parse the entries of a GetMulti request value, calling the callback
+     * for each one.
+     *
+     * @param value The value of the request
+     * @param callback Called with the vbucket and key of each entry; return
+     *                 false to stop parsing.
+     * @return false if the value is malformed (an entry is truncated)
+     */
+    static bool parseKeys(
+            cb::const_byte_buffer value,
+            std::function<bool(Vbid, cb::const_byte_buffer)> callback);
+
+protected:
+    ENGINE_ERROR_CODE step() override;
+
+    /**
+     * Look up the documents which haven't been looked up yet. The first time
+     * through every outstanding document is requested from the engine
+     * (so that all of the documents which need a background fetch are
+     * scheduled together); when resumed after blocking we stop at the first
+     * document which still blocks, to avoid requesting it yet another time
+     * for every other document whose fetch completes.
+     *
+     * @return ENGINE_EWOULDBLOCK if any document needs to be fetched,
+     *         ENGINE_SUCCESS once all documents have been looked up,
+     *         or a standard engine error code if the whole command fails.
+     */
+    ENGINE_ERROR_CODE getItems();
+
+    /**
+     * Add the responses for all the documents to the connection's IO vector,
+     * pointing directly into the items (or the inflated copies of them).
+     */
+    ENGINE_ERROR_CODE sendResponse();
+
+private:
+    struct Entry {
+        Vbid vbucket;
+        cb::const_byte_buffer key;
+        bool pending = true;
+        cb::engine_errc status = cb::engine_errc::success;
+        cb::unique_item_ptr item;
+        item_info info;
+        cb::const_char_buffer payload;
+        InflatedValueCache::Value inflated;
+    };
+
+    /**
+     * Record the result of looking up entry.
+     * @return ENGINE_SUCCESS, or an error if the whole command should fail.
+     */
+    ENGINE_ERROR_CODE processItem(Entry& entry, cb::EngineErrorItemPair ret);
+
+    /// The documents requested; not resized after construction so the
+    /// responses may refer to entries directly.
+    std::vector<Entry> entries;
+
+    /// Indexes into entries in the order they are looked up (grouped by
+    /// vbucket).
+    std::vector<size_t> order;
+
+    /// Set once every document has been requested once.
+    bool allRequested = false;
+
+    State state = State::GetItems;
+};
@@ -76,6 +76,7 @@ void buildRequestVector(FeatureSet& requested, cb::sized_buffer<const uint16_t>
         case cb::mcbp::Feature::OpenTracing:
         case cb::mcbp::Feature::Duplex:
         case cb::mcbp::Feature::ClustermapChangeNotification:
+        case cb::mcbp::Feature::ClustermapChangeNotificationDelta:
         case cb::mcbp::Feature::UnorderedExecution:
         case cb::mcbp::Feature::Tracing:
         case cb::mcbp::Feature::AltRequestSupport:
@@ -132,6 +133,17 @@ void buildRequestVector(FeatureSet& requested, cb::sized_buffer<const uint16_t>
                                             " needs Duplex");
             }
             break;
+        case cb::mcbp::Feature::ClustermapChangeNotificationDelta:
+            // Needs clustermap change notification
+            if (!containsFeature(
+                        requested,
+                        cb::mcbp::Feature::ClustermapChangeNotification)) {
+                throw std::invalid_argument(
+                        to_string(feature) + " needs " +
+                        to_string(cb::mcbp::Feature::
+                                          ClustermapChangeNotification));
+            }
+            break;
         }
     }
 }
@@ -188,6 +200,7 @@ void process_hello_packet_executor(Cookie& cookie) {
     connection.setCollectionsSupported(false);
     connection.setDuplexSupported(false);
     connection.setClustermapChangeNotificationSupported(false);
+    connection.setClustermapChangeNotificationDeltaSupported(false);
     connection.setTracingEnabled(false);
     connection.setAllowUnorderedExecution(false);
 
@@ -306,6 +319,10 @@ void process_hello_packet_executor(Cookie& cookie) {
             connection.setClustermapChangeNotificationSupported(true);
             added = true;
             break;
+        case cb::mcbp::Feature::ClustermapChangeNotificationDelta:
+            connection.setClustermapChangeNotificationDeltaSupported(true);
+            added = true;
+            break;
         case cb::mcbp::Feature::UnorderedExecution:
             if (connection.isDCP()) {
                 LOG_INFO(
@@ -27,6 +27,7 @@
 #include <memcached/protocol_binary.h>
 #include <memcached/types.h>
 #include <phosphor/phosphor.h>
+#include <tracing/trace_helpers.h>
 #include <xattr/utils.h>
 
 MutationCommandContext::MutationCommandContext(Cookie& cookie,
@@ -131,6 +132,7 @@ ENGINE_ERROR_CODE MutationCommandContext::validateInput() {
             cb::const_char_buffer value_buf{reinterpret_cast<const char*>(value.buf),
                                             value.len};
 
+            TRACE_SCOPE(cookie, cb::tracing::TraceCode::DECOMPRESS);
             if (!cb::compression::inflate(cb::compression::Algorithm::Snappy,
                                           value_buf,
                                           decompressed_value)) {
@@ -335,8 +337,7 @@ ENGINE_ERROR_CODE MutationCommandContext::sendResponse() {
     state = State::Done;
 
     if (cookie.getRequest().isQuiet()) {
-        ++connection.getBucket()
-                  .responseCounters[int(cb::mcbp::Status::Success)];
+        connection.countResponse(cb::mcbp::Status::Success);
         connection.setState(StateMachine::State::new_cmd);
         return ENGINE_SUCCESS;
     }
@@ -28,11 +28,50 @@
 #include <daemon/step_sasl_auth_task.h>
 #include <logger/logger.h>
 
+#include <atomic>
+
+/// The number of authentication tasks queued or running in the
+/// SASL executor pool
+static std::atomic<size_t> authInFlight{0};
+
+SaslAuthCommandContext::~SaslAuthCommandContext() {
+    releaseAdmission();
+}
+
+bool SaslAuthCommandContext::tryAdmit() {
+    const auto max = Settings::instance().getMaxConcurrentAuthentications();
+    auto current = authInFlight.load();
+    do {
+        if (current >= max) {
+            return false;
+        }
+    } while (!authInFlight.compare_exchange_weak(current, current + 1));
+    admitted = true;
+    return true;
+}
+
+void SaslAuthCommandContext::releaseAdmission() {
+    if (admitted) {
+        admitted = false;
+        authInFlight--;
+    }
+}
+
 ENGINE_ERROR_CODE SaslAuthCommandContext::initial() {
     if (!connection.isSaslAuthEnabled()) {
         return ENGINE_ENOTSUP;
     }
 
+    if (!tryAdmit()) {
+        // Queueing up more work would only make every client wait
+        // longer; tell the client to back off and retry instead
+        LOG_DEBUG("{}: Too many concurrent SASL authentications",
+                  connection.getId());
+        cookie.sendResponse(cb::mcbp::Status::Etmpfail);
+        state = State::Done;
+        return ENGINE_SUCCESS;
+    }
+
     auto k = request.getKey();
     auto v = request.getValue();
 
@@ -56,13 +95,14 @@ ENGINE_ERROR_CODE SaslAuthCommandContext::initial() {
     }
 
     std::lock_guard<std::mutex> guard(task->getMutex());
-    executorPool->schedule(task, true);
+    saslExecutorPool->schedule(task, true);
 
     state = State::ParseAuthTaskResult;
     return ENGINE_EWOULDBLOCK;
 }
 
 ENGINE_ERROR_CODE SaslAuthCommandContext::parseAuthTaskResult() {
+    releaseAdmission();
     auto auth_task = reinterpret_cast<SaslAuthTask*>(task.get());
 
     switch (auth_task->getError()) {
@@ -52,6 +52,8 @@ public:
           state(State::Initial) {
     }
 
+    ~SaslAuthCommandContext() override;
+
 protected:
     ENGINE_ERROR_CODE step() override;
 
@@ -62,8 +64,21 @@ protected:
     ENGINE_ERROR_CODE authBadParameters();
     ENGINE_ERROR_CODE authFailure();
 
+    /**
+     * Try to reserve one of the slots in the SASL executor pool (limited
+     * by max_concurrent_authentications)
+     *
+     * @return true if the task may be scheduled
+     */
+    bool tryAdmit();
+
+    /// Release the slot reserved by tryAdmit (if any)
+    void releaseAdmission();
+
 private:
     const cb::mcbp::Request& request;
     State state;
     std::shared_ptr<Task> task;
+    /// Set when we hold one of the slots in the SASL executor pool
+    bool admitted = false;
 };
@@ -14,6 +14,7 @@
  *   See the License for the specific language governing permissions and
  *   limitations under the License.
  */
+#include "command_context.h"
 #include "engine_errc_2_mcbp.h"
 #include "engine_wrapper.h"
 #include "logger/logger.h"
@@ -24,6 +25,7 @@
 #include <daemon/connection.h>
 #include <daemon/cookie.h>
 #include <daemon/executorpool.h>
+#include <daemon/external_auth_manager_thread.h>
 #include <daemon/mc_time.h>
 #include <daemon/mcaudit.h>
 #include <daemon/memcached.h>
@@ -224,16 +226,76 @@ static ENGINE_ERROR_CODE server_stats(const AddStatFn& add_stat_callback,
         add_stat(cookie, add_stat_callback, "bytes_read", thread_stats.bytes_read);
         add_stat(cookie, add_stat_callback, "bytes_written",
                  thread_stats.bytes_written);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "front_end_cpu_time_ns",
+                 thread_stats.cpu_time_ns);
+        const auto& throttle = cookie.getConnection().getBucket().throttle;
+        add_stat(cookie,
+                 add_stat_callback,
+                 "throttle_deferred",
+                 throttle.getDeferred());
+        add_stat(cookie,
+                 add_stat_callback,
+                 "throttle_deferred_time_us",
+                 throttle.getDeferredTime());
+        add_stat(cookie,
+                 add_stat_callback,
+                 "throttle_waiting",
+                 throttle.getWaiting());
         add_stat(cookie, add_stat_callback, "accepting_conns",
                  is_listen_disabled() ? 0 : 1);
         add_stat(cookie, add_stat_callback, "listen_disabled_num",
                  get_listen_disabled_num());
         add_stat(cookie, add_stat_callback, "rejected_conns", stats.rejected_conns);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "numa_local_connections",
+                 stats.numa_local_conns);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "numa_remote_connections",
+                 stats.numa_remote_conns);
         add_stat(cookie,
                  add_stat_callback,
                  "threads",
                  Settings::instance().getNumWorkerThreads());
         add_stat(cookie, add_stat_callback, "conn_yields", thread_stats.conn_yields);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "recv_syscalls",
+                 thread_stats.recv_syscalls);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "send_syscalls",
+                 thread_stats.send_syscalls);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "responses_corked",
+                 thread_stats.responses_corked);
+        const auto notification_stats = get_worker_notification_stats();
+        add_stat(cookie,
+                 add_stat_callback,
+                 "thread_notifications",
+                 notification_stats.first);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "thread_wakeups",
+                 notification_stats.second);
+        const uint64_t total_syscalls =
+                thread_stats.recv_syscalls + thread_stats.send_syscalls;
+        add_stat(cookie,
+                 add_stat_callback,
+                 "syscalls_per_op",
+                 total_ops == 0 ? 0.0 : double(total_syscalls) / total_ops);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "cmd_context_heap_allocs",
+                 CommandContext::getHeapAllocations());
+        add_stat(cookie,
+                 add_stat_callback,
+                 "cmd_context_pool_reuses",
+                 CommandContext::getPoolReuses());
         add_stat(cookie, add_stat_callback, "rbufs_allocated",
                  thread_stats.rbufs_allocated);
         add_stat(cookie, add_stat_callback, "rbufs_loaned",
@@ -269,11 +331,13 @@ static ENGINE_ERROR_CODE server_stats(const AddStatFn& add_stat_callback,
         add_stat(cookie, add_stat_callback, "cmd_mutation_10s_duration_us",
                  mutation_latency.duration_ns / 1000);
 
-        auto& respCounters =
-                cookie.getConnection().getBucket().responseCounters;
-        // Ignore success responses by starting from begin + 1
-        uint64_t total_resp_errors = std::accumulate(
-                std::begin(respCounters) + 1, std::end(respCounters), 0);
+        const auto& bucket = cookie.getConnection().getBucket();
+        // Ignore success responses by starting from 1
+        uint64_t total_resp_errors = 0;
+        for (size_t resp = 1; resp < size_t(cb::mcbp::Status::COUNT);
+             ++resp) {
+            total_resp_errors += bucket.getResponseCount(resp);
+        }
         add_stat(cookie,
                  add_stat_callback,
                  "total_resp_errors",
@@ -397,7 +461,13 @@ static ENGINE_ERROR_CODE stat_reset_executor(const std::string& arg,
  * Handler for the <code>stats sched</code> used to get the
  * histogram for the scheduler histogram.
  *
- * @param arg - should be empty
+ * @param arg - empty, "aggregate", "fairness" (the per thread stats for
+ *              the time based connection scheduler), "load" (the per
+ *              thread load used to place new connections, and how
+ *              imbalanced it is), "buffers" (the per
+ *              thread network buffer pools), "inflated_values" (the per
+ *              thread inflated value caches) or "tls_handshake" (the
+ *              time spent in full and resumed TLS handshakes)
  * @param cookie the command context
  */
 static ENGINE_ERROR_CODE stat_sched_executor(const std::string& arg,
@@ -428,6 +498,123 @@ static ENGINE_ERROR_CODE stat_sched_executor(const std::string& arg,
                      gsl::narrow<uint32_t>(hist.size()),
                      &cookie);
         return ENGINE_SUCCESS;
+    } else if (arg == "fairness") {
+        for (size_t ii = 0; ii < scheduler_fairness.size(); ++ii) {
+            const auto& fairness = scheduler_fairness[ii];
+            nlohmann::json json;
+            json["events"] = fairness.events.load();
+            json["commands"] = fairness.commands.load();
+            json["budget_yields"] = fairness.budget_yields.load();
+            json["overruns"] = fairness.overruns.load();
+            json["overrun_usec"] = fairness.overrun_usec.load();
+            const auto value = json.dump();
+            const std::string key = std::to_string(ii);
+            append_stats(key.data(),
+                         gsl::narrow<uint16_t>(key.size()),
+                         value.data(),
+                         gsl::narrow<uint32_t>(value.size()),
+                         &cookie);
+        }
+        return ENGINE_SUCCESS;
+    } else if (arg == "load") {
+        uint64_t totalRate = 0;
+        uint64_t maxRate = 0;
+        uint64_t totalConnections = 0;
+        uint64_t maxConnections = 0;
+        for (size_t ii = 0; ii < thread_loads.size(); ++ii) {
+            const auto& load = thread_loads[ii];
+            nlohmann::json json;
+            json["connections"] = load.connections.load();
+            json["placed"] = load.placed.load();
+            json["busy_usec"] = load.busy_usec.load();
+            json["busy_rate"] = load.busy_rate.load();
+            const auto value = json.dump();
+            const std::string key = std::to_string(ii);
+            append_stats(key.data(),
+                         gsl::narrow<uint16_t>(key.size()),
+                         value.data(),
+                         gsl::narrow<uint32_t>(value.size()),
+                         &cookie);
+            totalRate += load.busy_rate;
+            maxRate = std::max(maxRate, load.busy_rate.load());
+            totalConnections += load.connections;
+            maxConnections = std::max(maxConnections, load.connections.load());
+        }
+        // How far the busiest thread is above the mean (1.0 when balanced)
+        auto imbalance = [n = thread_loads.size()](uint64_t max,
+                                                   uint64_t total) {
+            return total == 0 ? 1.0 : double(max) * n / total;
+        };
+        nlohmann::json json;
+        json["busy_rate"] = imbalance(maxRate, totalRate);
+        json["connections"] = imbalance(maxConnections, totalConnections);
+        const auto value = json.dump();
+        static const std::string key = {"imbalance"};
+        append_stats(key.data(),
+                     gsl::narrow<uint16_t>(key.size()),
+                     value.data(),
+                     gsl::narrow<uint32_t>(value.size()),
+                     &cookie);
+        return ENGINE_SUCCESS;
+    } else if (arg == "buffers") {
+        auto to_json = [](const buffer_pool_stats::Pool& pool) {
+            nlohmann::json json;
+            json["in_use"] = pool.in_use.load();
+            json["in_use_high_watermark"] = pool.in_use_high_watermark.load();
+            json["pooled"] = pool.pooled.load();
+            json["pooled_high_watermark"] = pool.pooled_high_watermark.load();
+            return json;
+        };
+        for (size_t ii = 0; ii < buffer_pools.size(); ++ii) {
+            nlohmann::json json;
+            json["read"] = to_json(buffer_pools[ii].read);
+            json["write"] = to_json(buffer_pools[ii].write);
+            const auto value = json.dump();
+            const std::string key = std::to_string(ii);
+            append_stats(key.data(),
+                         gsl::narrow<uint16_t>(key.size()),
+                         value.data(),
+                         gsl::narrow<uint32_t>(value.size()),
+                         &cookie);
+        }
+        return ENGINE_SUCCESS;
+    } else if (arg == "inflated_values") {
+        for (size_t ii = 0; ii < inflated_value_caches.size(); ++ii) {
+            const auto& cache = inflated_value_caches[ii];
+            nlohmann::json json;
+            json["hits"] = cache.hits.load();
+            json["misses"] = cache.misses.load();
+            json["evictions"] = cache.evictions.load();
+            json["items"] = cache.items.load();
+            json["bytes"] = cache.bytes.load();
+            const auto value = json.dump();
+            const std::string key = std::to_string(ii);
+            append_stats(key.data(),
+                         gsl::narrow<uint16_t>(key.size()),
+                         value.data(),
+                         gsl::narrow<uint32_t>(value.size()),
+                         &cookie);
+        }
+        return ENGINE_SUCCESS;
+    } else if (arg == "tls_handshake") {
+        Hdr1sfMicroSecHistogram resumed{};
+        Hdr1sfMicroSecHistogram full{};
+        for (const auto& h : tls_handshakes) {
+            resumed += h.resumed;
+            full += h.full;
+        }
+        auto add = [&cookie](const std::string& key,
+                             Hdr1sfMicroSecHistogram& histogram) {
+            auto hist = histogram.to_string();
+            append_stats(key.data(),
+                         gsl::narrow<uint16_t>(key.size()),
+                         hist.data(),
+                         gsl::narrow<uint32_t>(hist.size()),
+                         &cookie);
+        };
+        add("resumed", resumed);
+        add("full", full);
+        return ENGINE_SUCCESS;
     } else {
         return ENGINE_EINVAL;
     }
@@ -569,6 +756,39 @@ static ENGINE_ERROR_CODE stat_topkeys_json_executor(const std::string& arg,
     }
 }
 
+/**
+ * Handler for the <code>stats hotkeys_json</code> command used to retrieve
+ * a JSON document containing the keys with the highest (recent) access
+ * frequency in the attached bucket.
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_hotkeys_json_executor(const std::string& arg,
+                                                    Cookie& cookie) {
+    if (!arg.empty()) {
+        return ENGINE_EINVAL;
+    }
+
+    auto& bucket = all_buckets[cookie.getConnection().getBucketIndex()];
+    if (bucket.topkeys == nullptr) {
+        return ENGINE_NO_BUCKET;
+    }
+
+    nlohmann::json hotkeys_doc;
+    auto ret = bucket.topkeys->hot_keys_json_stats(hotkeys_doc);
+    if (ret == ENGINE_SUCCESS) {
+        char key[] = "hotkeys_json";
+        const auto hotkeys_str = hotkeys_doc.dump();
+        append_stats(key,
+                     (uint16_t)strlen(key),
+                     hotkeys_str.data(),
+                     uint32_t(hotkeys_str.size()),
+                     &cookie);
+    }
+    return ret;
+}
+
 /**
  * Handler for the <code>stats subdoc_execute</code> command used to retrieve
  * information from the subdoc subsystem.
@@ -607,12 +827,12 @@ static ENGINE_ERROR_CODE stat_subdoc_execute_executor(const std::string& arg,
 static ENGINE_ERROR_CODE stat_responses_json_executor(const std::string& arg,
                                                       Cookie& cookie) {
     try {
-        auto& respCounters =
-                cookie.getConnection().getBucket().responseCounters;
+        const auto& bucket = cookie.getConnection().getBucket();
         nlohmann::json json;
 
-        for (uint16_t resp = 0; resp < respCounters.size(); ++resp) {
-            const auto value = respCounters[resp].load();
+        for (uint16_t resp = 0; resp < uint16_t(cb::mcbp::Status::COUNT);
+             ++resp) {
+            const auto value = bucket.getResponseCount(resp);
             if (value > 0) {
                 std::stringstream stream;
                 stream << std::hex << resp;
@@ -633,6 +853,79 @@ static ENGINE_ERROR_CODE stat_responses_json_executor(const std::string& arg,
     }
 }
 
+/**
+ * Handler for the <code>stats phase_timings</code> used to get the
+ * histograms of the duration of each traced phase of the commands run
+ * against the selected bucket (see phase_timings_enabled).
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_phase_timings_executor(const std::string& arg,
+                                                     Cookie& cookie) {
+    if (!arg.empty()) {
+        return ENGINE_EINVAL;
+    }
+
+    using cb::tracing::TraceCode;
+    const auto& timings = cookie.getConnection().getBucket().timings;
+    for (int ii = 0; ii <= int(TraceCode::DECOMPRESS); ++ii) {
+        const auto code = TraceCode(ii);
+        auto histo = timings.get_phase_histogram(code);
+        if (!histo) {
+            continue;
+        }
+        const auto key = to_string(code);
+        const auto value = histo->to_string();
+        append_stats(key.data(),
+                     gsl::narrow<uint16_t>(key.size()),
+                     value.data(),
+                     gsl::narrow<uint32_t>(value.size()),
+                     &cookie);
+    }
+    return ENGINE_SUCCESS;
+}
+
+/**
+ * Handler for the <code>stats allocations</code> used to get the number of
+ * memory allocations (and bytes allocated) made by the commands of each
+ * opcode run against the selected bucket (see allocation_tracking_enabled).
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_allocations_executor(const std::string& arg,
+                                                   Cookie& cookie) {
+    if (!arg.empty()) {
+        return ENGINE_EINVAL;
+    }
+
+    try {
+        const auto& timings = cookie.getConnection().getBucket().timings;
+        for (int ii = 0; ii < MAX_NUM_OPCODES; ++ii) {
+            const auto opcode = cb::mcbp::ClientOpcode(ii);
+            const auto stats = timings.get_allocation_stats(opcode);
+            if (stats.ops == 0 || !cb::mcbp::is_valid_opcode(opcode)) {
+                continue;
+            }
+            const auto key = to_string(opcode);
+            nlohmann::json json;
+            json["ops"] = stats.ops;
+            json["allocations"] = stats.allocations;
+            json["bytes"] = stats.bytes;
+            const auto value = json.dump();
+            append_stats(key.data(),
+                         gsl::narrow<uint16_t>(key.size()),
+                         value.data(),
+                         gsl::narrow<uint32_t>(value.size()),
+                         &cookie);
+        }
+        return ENGINE_SUCCESS;
+    } catch (const std::bad_alloc&) {
+        return ENGINE_ENOMEM;
+    }
+}
+
 static ENGINE_ERROR_CODE stat_tracing_executor(const std::string& arg,
                                                Cookie& cookie) {
     class MemcachedCallback : public phosphor::StatsCallback {
@@ -699,6 +992,29 @@ static ENGINE_ERROR_CODE stat_tracing_executor(const std::string& arg,
     }
 }
 
+/**
+ * Handler for the <code>stats external_auth</code> used to get statistics
+ * of the requests sent to the external authentication provider.
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_external_auth_executor(const std::string& arg,
+                                                     Cookie& cookie) {
+    if (!arg.empty()) {
+        return ENGINE_EINVAL;
+    }
+    if (externalAuthManager) {
+        for (const auto& entry : externalAuthManager->getStats().items()) {
+            add_stat(cookie,
+                     appendStatsFn,
+                     entry.key().c_str(),
+                     entry.value().dump());
+        }
+    }
+    return ENGINE_SUCCESS;
+}
+
 static ENGINE_ERROR_CODE stat_all_stats(const std::string& arg,
                                         Cookie& cookie) {
     auto value = cookie.getRequest().getValue();
@@ -744,9 +1060,13 @@ static std::unordered_map<std::string, struct command_stat_handler>
                 {"connections", {false, stat_connections_executor}},
                 {"topkeys", {false, stat_topkeys_executor}},
                 {"topkeys_json", {false, stat_topkeys_json_executor}},
+                {"hotkeys_json", {false, stat_hotkeys_json_executor}},
                 {"subdoc_execute", {false, stat_subdoc_execute_executor}},
                 {"responses", {false, stat_responses_json_executor}},
-                {"tracing", {true, stat_tracing_executor}}};
+                {"phase_timings", {false, stat_phase_timings_executor}},
+                {"allocations", {false, stat_allocations_executor}},
+                {"tracing", {true, stat_tracing_executor}},
+                {"external_auth", {true, stat_external_auth_executor}}};
 
 /**
  * For a given key, try and return the handler for it
@@ -876,8 +1196,7 @@ ENGINE_ERROR_CODE StatsCommandContext::commandComplete() {
         append_stats(nullptr, 0, nullptr, 0, static_cast<void*>(&cookie));
 
         // We just want to record this once rather than for each packet sent
-        ++connection.getBucket()
-                  .responseCounters[int(cb::mcbp::Status::Success)];
+        connection.countResponse(cb::mcbp::Status::Success);
         cookie.sendDynamicBuffer();
         break;
     case ENGINE_EWOULDBLOCK:
@@ -890,8 +1209,8 @@ ENGINE_ERROR_CODE StatsCommandContext::commandComplete() {
         // stats for these.
         break;
     default:
-        ++connection.getBucket().responseCounters[int(
-                cb::mcbp::to_status(cb::engine_errc(command_exit_code)))];
+        connection.countResponse(
+                cb::mcbp::to_status(cb::engine_errc(command_exit_code)));
         break;
     }
     state = State::Done;
@@ -29,8 +29,18 @@
 #include <memory>
 
 class Hdr1sfMicroSecHistogram;
+struct scheduler_fairness_stats;
+struct thread_load_stats;
+struct buffer_pool_stats;
+struct inflated_value_cache_stats;
+struct tls_handshake_stats;
 
 bool is_default_bucket_enabled();
 void set_default_bucket_enabled(bool enabled);
 
 extern std::vector<Hdr1sfMicroSecHistogram> scheduler_info;
+extern std::vector<scheduler_fairness_stats> scheduler_fairness;
+extern std::vector<thread_load_stats> thread_loads;
+extern std::vector<buffer_pool_stats> buffer_pools;
+extern std::vector<inflated_value_cache_stats> inflated_value_caches;
+extern std::vector<tls_handshake_stats> tls_handshakes;
@@ -27,6 +27,7 @@
 #include <gsl/gsl>
 #include <system_error>
 
+#include "bucket_throttle.h"
 #include "log_macros.h"
 #include "opentracing_config.h"
 #include "settings.h"
@@ -54,6 +55,7 @@ Settings::Settings()
       topkeys_size(0) {
     verbose.store(0);
     connection_idle_time.reset();
+    event_time_budget.reset();
     dedupe_nmvb_maps.store(false);
     xattr_enabled.store(false);
     privilege_debug.store(false);
@@ -190,6 +192,23 @@ static void handle_topkeys_enabled(Settings& s, const nlohmann::json& obj) {
     s.setTopkeysEnabled(obj.get<bool>());
 }
 
+/**
+ * Handle the "topkeys_max_sample_interval" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_topkeys_max_sample_interval(Settings& s,
+                                               const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("topkeys_max_sample_interval" must be an unsigned int)");
+    }
+    s.setTopkeysMaxSampleInterval(obj.get<size_t>());
+}
+
 static void handle_scramsha_fallback_salt(Settings& s,
                                           const nlohmann::json& obj) {
     // Try to base64 decode it to validate that it is a legal value..
@@ -221,6 +240,23 @@ static void handle_active_external_users_push_interval(
     }
 }
 
+static void handle_external_auth_cache_ttl(Settings& s,
+                                           const nlohmann::json& obj) {
+    switch (obj.type()) {
+    case nlohmann::json::value_t::number_unsigned:
+        s.setExternalAuthCacheTtl(std::chrono::seconds(obj.get<int>()));
+        break;
+    case nlohmann::json::value_t::string:
+        s.setExternalAuthCacheTtl(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        cb::text2time(obj.get<std::string>())));
+        break;
+    default:
+        cb::throwJsonTypeError(R"("external_auth_cache_ttl" must
+                                be a number or string)");
+    }
+}
+
 static void handle_max_concurrent_commands_per_connection(
         Settings& s, const nlohmann::json& obj) {
     if (!obj.is_number_unsigned()) {
@@ -230,6 +266,20 @@ static void handle_max_concurrent_commands_per_connection(
     s.setMaxConcurrentCommandsPerConnection(obj.get<size_t>());
 }
 
+static void handle_max_concurrent_authentications(Settings& s,
+                                                  const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("max_concurrent_authentications" must be a positive number)");
+    }
+    const auto value = obj.get<size_t>();
+    if (value == 0) {
+        throw std::invalid_argument(
+                R"("max_concurrent_authentications" must be at least 1)");
+    }
+    s.setMaxConcurrentAuthentications(value);
+}
+
 /**
  * Handle the "tracing_enabled" tag in the settings
  *
@@ -242,6 +292,49 @@ static void handle_tracing_enabled(Settings& s, const nlohmann::json& obj) {
     s.setTracingEnabled(obj.get<bool>());
 }
 
+/**
+ * Handle the "phase_timings_enabled" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_phase_timings_enabled(Settings& s,
+                                         const nlohmann::json& obj) {
+    s.setPhaseTimingsEnabled(obj.get<bool>());
+}
+
+/**
+ * Handle the "allocation_tracking_enabled" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_allocation_tracking_enabled(Settings& s,
+                                               const nlohmann::json& obj) {
+    s.setAllocationTrackingEnabled(obj.get<bool>());
+}
+
+/**
+ * Handle the "sampling_profiler_frequency" tag in the settings
+ *
+ *  The value must be an unsigned integer
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_sampling_profiler_frequency(Settings& s,
+                                               const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                "\"sampling_profiler_frequency\" must be an unsigned int");
+    }
+    s.setSamplingProfilerFrequency(obj.get<size_t>());
+}
+
 /**
  * Handle the "stdin_listener" tag in the settings
  *
@@ -331,6 +424,71 @@ static void handle_connection_idle_time(Settings& s,
     s.setConnectionIdleTime(obj.get<unsigned int>());
 }
 
+/**
+ * Handle the "event_time_budget" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_event_time_budget(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("event_time_budget" must be an unsigned int)");
+    }
+    s.setEventTimeBudget(obj.get<size_t>());
+}
+
+/**
+ * Handle the "max_send_per_event" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_max_send_per_event(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("max_send_per_event" must be an unsigned int)");
+    }
+    s.setMaxSendPerEvent(obj.get<size_t>());
+}
+
+/**
+ * Handle the "response_cork_size" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_response_cork_size(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("response_cork_size" must be an unsigned int)");
+    }
+    s.setResponseCorkSize(obj.get<size_t>());
+}
+
+/**
+ * Handle the "inflated_value_cache_size" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_inflated_value_cache_size(Settings& s,
+                                             const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("inflated_value_cache_size" must be an unsigned int)");
+    }
+    s.setInflatedValueCacheSize(obj.get<size_t>());
+}
+
 /**
  * Handle the "bio_drain_buffer_sz" tag in the settings
  *
@@ -442,6 +600,18 @@ static void handle_ssl_cipher_order(Settings& s, const nlohmann::json& obj) {
     s.setSslCipherOrder(obj.get<bool>());
 }
 
+/**
+ * Handle the "ssl_ktls_enabled" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_ssl_ktls_enabled(Settings& s, const nlohmann::json& obj) {
+    s.setSslKtlsEnabled(obj.get<bool>());
+}
+
 /**
  * Handle the "ssl_minimum_protocol" tag in the settings
  *
@@ -577,6 +747,59 @@ static void handle_opcode_attributes_override(Settings& s,
     s.setOpcodeAttributesOverride(obj.dump());
 }
 
+/**
+ * Handle the "bucket_throttle" tag in the settings
+ *
+ *  The value must be an object with the throughput limits of each bucket
+ *  to throttle
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_bucket_throttle(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_object()) {
+        cb::throwJsonTypeError(R"("bucket_throttle" must be an object)");
+    }
+    s.setBucketThrottle(obj.dump());
+}
+
+/**
+ * Handle the "tracing_auto_dump_dir" tag in the settings
+ *
+ *  The value must be a string
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_tracing_auto_dump_dir(Settings& s,
+                                         const nlohmann::json& obj) {
+    if (!obj.is_string()) {
+        cb::throwJsonTypeError(R"("tracing_auto_dump_dir" must be a string)");
+    }
+    s.setTracingAutoDumpDir(obj.get<std::string>());
+}
+
+/**
+ * Handle the "tracing_auto_dump_interval" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_tracing_auto_dump_interval(Settings& s,
+                                              const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("tracing_auto_dump_interval" must be an unsigned int)");
+    }
+    s.setTracingAutoDumpInterval(obj.get<size_t>());
+}
+
+static void handle_numa_aware_threads(Settings& s, const nlohmann::json& obj) {
+    s.setNumaAwareThreads(obj.get<bool>());
+}
+
 static void handle_extensions(Settings& s, const nlohmann::json& obj) {
     LOG_INFO("Extensions ignored");
 }
@@ -672,12 +895,17 @@ void Settings::reconfigure(const nlohmann::json& json) {
             {"reqs_per_event_low_priority", handle_low_reqs_event},
             {"verbosity", handle_verbosity},
             {"connection_idle_time", handle_connection_idle_time},
+            {"event_time_budget", handle_event_time_budget},
+            {"max_send_per_event", handle_max_send_per_event},
+            {"response_cork_size", handle_response_cork_size},
+            {"inflated_value_cache_size", handle_inflated_value_cache_size},
             {"bio_drain_buffer_sz", handle_bio_drain_buffer_sz},
             {"datatype_json", handle_datatype_json},
             {"datatype_snappy", handle_datatype_snappy},
             {"root", handle_root},
             {"ssl_cipher_list", handle_ssl_cipher_list},
             {"ssl_cipher_order", handle_ssl_cipher_order},
+            {"ssl_ktls_enabled", handle_ssl_ktls_enabled},
             {"ssl_minimum_protocol", handle_ssl_minimum_protocol},
             {"breakpad", handle_breakpad},
             {"max_packet_size", handle_max_packet_size},
@@ -691,14 +919,28 @@ void Settings::reconfigure(const nlohmann::json& json) {
             {"client_cert_auth", handle_client_cert_auth},
             {"collections_enabled", handle_collections_enabled},
             {"opcode_attributes_override", handle_opcode_attributes_override},
+            {"bucket_throttle", handle_bucket_throttle},
+            {"tracing_auto_dump_dir", handle_tracing_auto_dump_dir},
+            {"tracing_auto_dump_interval", handle_tracing_auto_dump_interval},
+            {"numa_aware_threads", handle_numa_aware_threads},
             {"topkeys_enabled", handle_topkeys_enabled},
+            {"topkeys_max_sample_interval",
+             handle_topkeys_max_sample_interval},
             {"tracing_enabled", handle_tracing_enabled},
+            {"phase_timings_enabled", handle_phase_timings_enabled},
+            {"allocation_tracking_enabled",
+             handle_allocation_tracking_enabled},
+            {"sampling_profiler_frequency",
+             handle_sampling_profiler_frequency},
             {"scramsha_fallback_salt", handle_scramsha_fallback_salt},
             {"external_auth_service", handle_external_auth_service},
             {"active_external_users_push_interval",
              handle_active_external_users_push_interval},
+            {"external_auth_cache_ttl", handle_external_auth_cache_ttl},
             {"max_concurrent_commands_per_connection",
              handle_max_concurrent_commands_per_connection},
+            {"max_concurrent_authentications",
+             handle_max_concurrent_authentications},
             {"opentracing", handle_opentracing},
             {"portnumber_file", handle_portnumber_file},
             {"parent_identifier", handle_parent_identifier}};
@@ -730,6 +972,24 @@ void Settings::setOpcodeAttributesOverride(const std::string& value) {
     notify_changed("opcode_attributes_override");
 }
 
+void Settings::setBucketThrottle(const std::string& value) {
+    if (!value.empty()) {
+        // Verify the content...
+        const auto json = nlohmann::json::parse(value);
+        if (!json.is_object()) {
+            throw std::invalid_argument(
+                    R"("bucket_throttle" must be an object)");
+        }
+        for (auto it = json.begin(); it != json.end(); ++it) {
+            BucketThrottle::parseConfig(it.value());
+        }
+    }
+
+    bucket_throttle.wlock()->assign(value);
+    has.bucket_throttle = true;
+    notify_changed("bucket_throttle");
+}
+
 void Settings::updateSettings(const Settings& other, bool apply) {
     if (other.has.rbac_file) {
         if (other.rbac_file != rbac_file) {
@@ -753,6 +1013,12 @@ void Settings::updateSettings(const Settings& other, bool apply) {
                 "bio_drain_buffer_sz can't be changed dynamically");
         }
     }
+    if (other.has.numa_aware_threads) {
+        if (other.numa_aware_threads != numa_aware_threads) {
+            throw std::invalid_argument(
+                    "numa_aware_threads can't be changed dynamically");
+        }
+    }
     if (other.has.datatype_json) {
         if (other.datatype_json != datatype_json) {
             throw std::invalid_argument(
@@ -878,6 +1144,38 @@ void Settings::updateSettings(const Settings& other, bool apply) {
             setConnectionIdleTime(other.connection_idle_time);
         }
     }
+    if (other.has.event_time_budget) {
+        if (other.event_time_budget != event_time_budget) {
+            LOG_INFO("Change event time budget from {} to {} usec",
+                     event_time_budget.load(),
+                     other.event_time_budget.load());
+            setEventTimeBudget(other.event_time_budget);
+        }
+    }
+    if (other.has.max_send_per_event) {
+        if (other.max_send_per_event != max_send_per_event) {
+            LOG_INFO("Change max send per event from {} to {} bytes",
+                     max_send_per_event.load(),
+                     other.max_send_per_event.load());
+            setMaxSendPerEvent(other.max_send_per_event);
+        }
+    }
+    if (other.has.response_cork_size) {
+        if (other.response_cork_size != response_cork_size) {
+            LOG_INFO("Change response cork size from {} to {} bytes",
+                     response_cork_size.load(),
+                     other.response_cork_size.load());
+            setResponseCorkSize(other.response_cork_size);
+        }
+    }
+    if (other.has.inflated_value_cache_size) {
+        if (other.inflated_value_cache_size != inflated_value_cache_size) {
+            LOG_INFO("Change inflated value cache size from {} to {}",
+                     inflated_value_cache_size.load(),
+                     other.inflated_value_cache_size.load());
+            setInflatedValueCacheSize(other.inflated_value_cache_size);
+        }
+    }
     if (other.has.max_packet_size) {
         if (other.max_packet_size != max_packet_size) {
             LOG_INFO("Change max packet size from {} to {}",
@@ -920,6 +1218,14 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.ssl_ktls_enabled) {
+        if (other.isSslKtlsEnabled() != isSslKtlsEnabled()) {
+            LOG_INFO("{} kernel TLS offload for new connections",
+                     other.isSslKtlsEnabled() ? "Enable" : "Disable");
+        }
+        setSslKtlsEnabled(other.isSslKtlsEnabled());
+    }
+
     if (other.has.client_cert_auth) {
         const auto m = client_cert_mapper.to_string();
         const auto o = other.client_cert_mapper.to_string();
@@ -1063,6 +1369,39 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.bucket_throttle) {
+        auto current = getBucketThrottle();
+        auto proposed = other.getBucketThrottle();
+
+        if (proposed != current) {
+            LOG_INFO(R"(Change bucket throttle from "{}" to "{}")",
+                     current,
+                     proposed);
+            setBucketThrottle(proposed);
+        }
+    }
+
+    if (other.has.tracing_auto_dump_dir) {
+        auto current = getTracingAutoDumpDir();
+        auto proposed = other.getTracingAutoDumpDir();
+
+        if (proposed != current) {
+            LOG_INFO(R"(Change tracing auto dump directory from "{}" to "{}")",
+                     current,
+                     proposed);
+            setTracingAutoDumpDir(proposed);
+        }
+    }
+
+    if (other.has.tracing_auto_dump_interval) {
+        if (other.tracing_auto_dump_interval != tracing_auto_dump_interval) {
+            LOG_INFO("Change tracing auto dump interval from {} to {} seconds",
+                     tracing_auto_dump_interval.load(),
+                     other.tracing_auto_dump_interval.load());
+            setTracingAutoDumpInterval(other.tracing_auto_dump_interval);
+        }
+    }
+
     if (other.has.topkeys_enabled) {
         if (other.isTopkeysEnabled() != isTopkeysEnabled()) {
             LOG_INFO("{} topkeys support",
@@ -1071,6 +1410,16 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         setTopkeysEnabled(other.isTopkeysEnabled());
     }
 
+    if (other.has.topkeys_max_sample_interval) {
+        if (other.topkeys_max_sample_interval !=
+            topkeys_max_sample_interval) {
+            LOG_INFO("Change topkeys max sample interval from {} to {}",
+                     topkeys_max_sample_interval.load(),
+                     other.topkeys_max_sample_interval.load());
+            setTopkeysMaxSampleInterval(other.topkeys_max_sample_interval);
+        }
+    }
+
     if (other.has.tracing_enabled) {
         if (other.isTracingEnabled() != isTracingEnabled()) {
             LOG_INFO("{} tracing support",
@@ -1079,6 +1428,33 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         setTracingEnabled(other.isTracingEnabled());
     }
 
+    if (other.has.phase_timings_enabled) {
+        if (other.isPhaseTimingsEnabled() != isPhaseTimingsEnabled()) {
+            LOG_INFO("{} phase timings",
+                     other.isPhaseTimingsEnabled() ? "Enable" : "Disable");
+        }
+        setPhaseTimingsEnabled(other.isPhaseTimingsEnabled());
+    }
+
+    if (other.has.allocation_tracking_enabled) {
+        if (other.isAllocationTrackingEnabled() !=
+            isAllocationTrackingEnabled()) {
+            LOG_INFO("{} allocation tracking",
+                     other.isAllocationTrackingEnabled() ? "Enable"
+                                                         : "Disable");
+        }
+        setAllocationTrackingEnabled(other.isAllocationTrackingEnabled());
+    }
+
+    if (other.has.sampling_profiler_frequency) {
+        if (other.sampling_profiler_frequency != sampling_profiler_frequency) {
+            LOG_INFO("Change sampling profiler frequency from {} to {}",
+                     sampling_profiler_frequency.load(),
+                     other.sampling_profiler_frequency.load());
+            setSamplingProfilerFrequency(other.sampling_profiler_frequency);
+        }
+    }
+
     if (other.has.scramsha_fallback_salt) {
         const auto o = other.getScramshaFallbackSalt();
         const auto m = getScramshaFallbackSalt();
@@ -1143,6 +1519,20 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.external_auth_cache_ttl) {
+        if (getExternalAuthCacheTtl() != other.getExternalAuthCacheTtl()) {
+            LOG_INFO(
+                    R"(Change external authentication cache ttl from {}ms to {}ms)",
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                            getExternalAuthCacheTtl())
+                            .count(),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                            other.getExternalAuthCacheTtl())
+                            .count());
+            setExternalAuthCacheTtl(other.getExternalAuthCacheTtl());
+        }
+    }
+
     if (other.has.opentracing_config) {
         auto o = other.getOpenTracingConfig();
         auto m = getOpenTracingConfig();
@@ -1183,6 +1573,19 @@ void Settings::updateSettings(const Settings& other, bool apply) {
                     other.getMaxConcurrentCommandsPerConnection());
         }
     }
+
+    if (other.has.max_concurrent_authentications) {
+        if (other.getMaxConcurrentAuthentications() !=
+            getMaxConcurrentAuthentications()) {
+            LOG_INFO(
+                    "Change max number of concurrent authentications from {} "
+                    "to {}",
+                    getMaxConcurrentAuthentications(),
+                    other.getMaxConcurrentAuthentications());
+            setMaxConcurrentAuthentications(
+                    other.getMaxConcurrentAuthentications());
+        }
+    }
 }
 
 /**
@@ -1378,3 +1781,13 @@ void Settings::setMaxConcurrentCommandsPerConnection(size_t num) {
     has.max_concurrent_commands_per_connection = true;
     notify_changed("max_concurrent_commands_per_connection");
 }
+
+size_t Settings::getMaxConcurrentAuthentications() const {
+    return max_concurrent_authentications.load(std::memory_order_consume);
+}
+
+void Settings::setMaxConcurrentAuthentications(size_t num) {
+    max_concurrent_authentications.store(num, std::memory_order_release);
+    has.max_concurrent_authentications = true;
+    notify_changed("max_concurrent_authentications");
+}
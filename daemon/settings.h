@@ -282,6 +282,99 @@ public:
         notify_changed("connection_idle_time");
     }
 
+    /**
+     * Get the time budget for serving a connection per notification from
+     * the event library. When non-zero a connection yields once it has
+     * used its budget (or would exceed it running one more command of
+     * its typical cost) rather than after a fixed number of requests.
+     *
+     * @return the time budget in microseconds, or 0 if the number of
+     *         requests per event is used
+     */
+    size_t getEventTimeBudget() const {
+        return event_time_budget;
+    }
+
+    /**
+     * Set the time budget for serving a connection per notification from
+     * the event library
+     *
+     * @param value the number of microseconds (0 to use reqs_per_event)
+     */
+    void setEventTimeBudget(size_t value) {
+        Settings::event_time_budget = value;
+        has.event_time_budget = true;
+        notify_changed("event_time_budget");
+    }
+
+    /**
+     * Get the maximum number of bytes a connection may send per
+     * notification from the event library before it yields to the other
+     * connections on its thread, so that sending a large response doesn't
+     * hold up everyone else.
+     *
+     * @return the number of bytes, or 0 for no limit
+     */
+    size_t getMaxSendPerEvent() const {
+        return max_send_per_event;
+    }
+
+    /**
+     * Set the maximum number of bytes a connection may send per
+     * notification from the event library
+     *
+     * @param value the number of bytes (0 for no limit)
+     */
+    void setMaxSendPerEvent(size_t value) {
+        Settings::max_send_per_event = value;
+        has.max_send_per_event = true;
+        notify_changed("max_send_per_event");
+    }
+
+    /**
+     * Get the number of bytes of small responses to pipelined commands a
+     * connection may hold back, to send them together with the responses
+     * which follow in a single system call.
+     *
+     * @return the number of bytes, or 0 to send every response on its own
+     */
+    size_t getResponseCorkSize() const {
+        return response_cork_size;
+    }
+
+    /**
+     * Set the number of bytes of responses a connection may hold back
+     *
+     * @param value the number of bytes (0 to disable corking)
+     */
+    void setResponseCorkSize(size_t value) {
+        Settings::response_cork_size = value;
+        has.response_cork_size = true;
+        notify_changed("response_cork_size");
+    }
+
+    /**
+     * Get the size of each front end thread's cache of inflated (Snappy
+     * compressed) document values
+     *
+     * @return the size in bytes, or 0 if values aren't cached
+     */
+    size_t getInflatedValueCacheSize() const {
+        return inflated_value_cache_size;
+    }
+
+    /**
+     * Set the size of each front end thread's cache of inflated document
+     * values
+     *
+     * @param value the number of bytes (0 to disable the cache)
+     */
+    void setInflatedValueCacheSize(size_t value) {
+        Settings::inflated_value_cache_size = value;
+        has.inflated_value_cache_size = true;
+        notify_changed("inflated_value_cache_size");
+    }
+
     /**
      * Get the root directory of the couchbase installation
      *
@@ -337,6 +430,15 @@ public:
 
     void setMaxConcurrentCommandsPerConnection(size_t num);
 
+    /**
+     * Get the maximum number of SASL authentication requests which may be
+     * queued or running in the authentication thread pool at the same
+     * time (additional requests are rejected with a temporary failure)
+     */
+    size_t getMaxConcurrentAuthentications() const;
+
+    void setMaxConcurrentAuthentications(size_t num);
+
     /**
      * Set the number of request to handle per notification from the
      * event library
@@ -515,6 +617,16 @@ public:
 
     void setSslCipherOrder(bool ordered);
 
+    bool isSslKtlsEnabled() const {
+        return ssl_ktls_enabled.load(std::memory_order_acquire);
+    }
+
+    void setSslKtlsEnabled(bool enabled) {
+        ssl_ktls_enabled.store(enabled, std::memory_order_release);
+        has.ssl_ktls_enabled = true;
+        notify_changed("ssl_ktls_enabled");
+    }
+
     /// get the configured SSL protocol mask
     long getSslProtocolMask()const {
         return ssl_protocol_mask.load();
@@ -575,6 +687,26 @@ public:
         has.topkeys_size = true;
     }
 
+    /**
+     * Get the maximum sampling interval used by topkeys (1 == every
+     * access is tracked)
+     */
+    size_t getTopkeysMaxSampleInterval() const {
+        return topkeys_max_sample_interval;
+    }
+
+    /**
+     * Set the maximum sampling interval used by topkeys
+     *
+     * @param value the highest N topkeys may use when only tracking 1 of N
+     *              accesses (0 and 1 tracks every access)
+     */
+    void setTopkeysMaxSampleInterval(size_t value) {
+        Settings::topkeys_max_sample_interval = value;
+        has.topkeys_max_sample_interval = true;
+        notify_changed("topkeys_max_sample_interval");
+    }
+
     /**
      * Get the list of available SASL Mechanisms
      *
@@ -717,6 +849,76 @@ public:
 
     void setOpcodeAttributesOverride(const std::string& value);
 
+    /**
+     * Get the throughput limits of the buckets (a JSON object with the
+     * configuration of each throttled bucket by name, see BucketThrottle)
+     */
+    const std::string getBucketThrottle() const {
+        return std::string{*bucket_throttle.rlock()};
+    }
+
+    /**
+     * Set the throughput limits of the buckets
+     *
+     * @throws std::invalid_argument if the configuration is invalid
+     */
+    void setBucketThrottle(const std::string& value);
+
+    /**
+     * Get the directory the (always on) trace is written to when a slow
+     * operation is detected
+     *
+     * @return the directory, or an empty string if disabled
+     */
+    std::string getTracingAutoDumpDir() const {
+        return std::string{*tracing_auto_dump_dir.rlock()};
+    }
+
+    /**
+     * Set the directory the trace is written to when a slow operation is
+     * detected
+     *
+     * @param value the directory (an empty string to disable)
+     */
+    void setTracingAutoDumpDir(const std::string& value) {
+        tracing_auto_dump_dir.wlock()->assign(value);
+        has.tracing_auto_dump_dir = true;
+        notify_changed("tracing_auto_dump_dir");
+    }
+
+    /**
+     * Get the minimum number of seconds between two automatic dumps of the
+     * trace
+     */
+    size_t getTracingAutoDumpInterval() const {
+        return tracing_auto_dump_interval;
+    }
+
+    /**
+     * Set the minimum number of seconds between two automatic dumps of the
+     * trace
+     */
+    void setTracingAutoDumpInterval(size_t value) {
+        tracing_auto_dump_interval = value;
+        has.tracing_auto_dump_interval = true;
+        notify_changed("tracing_auto_dump_interval");
+    }
+
+    /**
+     * Should the front end threads be spread over (and bound to) the NUMA
+     * nodes, with new connections dispatched to a thread on the node which
+     * received the connection?
+     */
+    bool isNumaAwareThreads() const {
+        return numa_aware_threads;
+    }
+
+    void setNumaAwareThreads(bool enabled) {
+        numa_aware_threads = enabled;
+        has.numa_aware_threads = true;
+        notify_changed("numa_aware_threads");
+    }
+
     bool isTopkeysEnabled() const {
         return topkeys_enabled.load(std::memory_order_acquire);
     }
@@ -737,6 +939,42 @@ public:
         notify_changed("tracing_enabled");
     }
 
+    bool isPhaseTimingsEnabled() const {
+        return phase_timings_enabled.load(std::memory_order_acquire);
+    }
+
+    void setPhaseTimingsEnabled(bool enabled) {
+        Settings::phase_timings_enabled.store(enabled,
+                                              std::memory_order_release);
+        has.phase_timings_enabled = true;
+        notify_changed("phase_timings_enabled");
+    }
+
+    bool isAllocationTrackingEnabled() const {
+        return allocation_tracking_enabled.load(std::memory_order_acquire);
+    }
+
+    void setAllocationTrackingEnabled(bool enabled) {
+        Settings::allocation_tracking_enabled.store(enabled,
+                                                    std::memory_order_release);
+        has.allocation_tracking_enabled = true;
+        notify_changed("allocation_tracking_enabled");
+    }
+
+    /**
+     * Get the frequency (samples per second per thread) of the sampling
+     * profiler, or 0 if it is disabled.
+     */
+    size_t getSamplingProfilerFrequency() const {
+        return sampling_profiler_frequency;
+    }
+
+    void setSamplingProfilerFrequency(size_t value) {
+        Settings::sampling_profiler_frequency = value;
+        has.sampling_profiler_frequency = true;
+        notify_changed("sampling_profiler_frequency");
+    }
+
     void setScramshaFallbackSalt(const std::string& value) {
         scramsha_fallback_salt.wlock()->assign(value);
         has.scramsha_fallback_salt = true;
@@ -770,6 +1008,16 @@ public:
         notify_changed("active_external_users_push_interval");
     }
 
+    std::chrono::microseconds getExternalAuthCacheTtl() const {
+        return external_auth_cache_ttl.load(std::memory_order_acquire);
+    }
+
+    void setExternalAuthCacheTtl(const std::chrono::microseconds ttl) {
+        external_auth_cache_ttl.store(ttl, std::memory_order_release);
+        has.external_auth_cache_ttl = true;
+        notify_changed("external_auth_cache_ttl");
+    }
+
     /**
      * Get the (optional) OpenTracing configuration.
      *
@@ -858,6 +1106,30 @@ protected:
      */
     cb::RelaxedAtomic<size_t> connection_idle_time;
 
+    /**
+     * The number of microseconds a connection may be served per
+     * notification from the event library (0 == use reqs_per_event)
+     */
+    cb::RelaxedAtomic<size_t> event_time_budget;
+
+    /**
+     * The number of bytes a connection may send per notification from the
+     * event library (0 == no limit)
+     */
+    cb::RelaxedAtomic<size_t> max_send_per_event{4 * 1024 * 1024};
+
+    /**
+     * The number of bytes of responses a connection may hold back while it
+     * has more pipelined commands to execute (0 == disabled)
+     */
+    cb::RelaxedAtomic<size_t> response_cork_size{16 * 1024};
+
+    /**
+     * The number of bytes each front end thread may use to cache inflated
+     * document values (0 == disabled)
+     */
+    cb::RelaxedAtomic<size_t> inflated_value_cache_size{1024 * 1024};
+
     /**
      * The root directory of the installation
      */
@@ -905,6 +1177,10 @@ protected:
     /// if we should use the ssl cipher ordering
     std::atomic_bool ssl_cipher_order{true};
 
+    /// if new TLS connections should try to offload the record encryption
+    /// and decryption to the kernel (kTLS)
+    std::atomic_bool ssl_ktls_enabled{false};
+
     /**
      * The minimum ssl protocol to use (by default this is TLS1)
      */
@@ -921,6 +1197,12 @@ protected:
      */
     int topkeys_size;
 
+    /**
+     * The highest sampling interval topkeys may use when the access rate
+     * is high (1 == track every access)
+     */
+    cb::RelaxedAtomic<size_t> topkeys_max_sample_interval{1};
+
     /// The available sasl mechanism list
     folly::Synchronized<std::string> sasl_mechanisms;
 
@@ -950,6 +1232,18 @@ protected:
     /// Any settings to override opcode attributes
     folly::Synchronized<std::string> opcode_attributes_override;
 
+    /// The throughput limits of the buckets (JSON)
+    folly::Synchronized<std::string> bucket_throttle;
+
+    /// Where to dump the trace on a slow operation (empty == disabled)
+    folly::Synchronized<std::string> tracing_auto_dump_dir;
+
+    /// The minimum number of seconds between automatic trace dumps
+    cb::RelaxedAtomic<size_t> tracing_auto_dump_interval{300};
+
+    /// Bind the front end threads to the NUMA nodes (not dynamic)
+    bool numa_aware_threads = false;
+
     /**
      * Is topkeys enabled or not
      */
@@ -960,6 +1254,20 @@ protected:
      */
     std::atomic_bool tracing_enabled{true};
 
+    /**
+     * Should the per-phase spans of every command be recorded and
+     * aggregated into the phase timings histograms (regardless of whether
+     * the client requested tracing)
+     */
+    std::atomic_bool phase_timings_enabled{false};
+
+    /// Count the allocations made while executing each command
+    std::atomic_bool allocation_tracking_enabled{false};
+
+    /// The number of samples per second per thread taken by the sampling
+    /// profiler (0 = disabled)
+    cb::RelaxedAtomic<size_t> sampling_profiler_frequency{0};
+
     /**
      * Use standard input listener
      */
@@ -973,6 +1281,10 @@ protected:
     std::atomic<std::chrono::microseconds> active_external_users_push_interval{
             std::chrono::minutes(5)};
 
+    /// How long a successful external authentication may be reused
+    std::atomic<std::chrono::microseconds> external_auth_cache_ttl{
+            std::chrono::seconds(10)};
+
     /// The maximum number of connections allowed
     std::atomic<size_t> max_connections{60000};
 
@@ -986,6 +1298,10 @@ protected:
     /// blocking execution
     std::atomic<std::size_t> max_concurrent_commands_per_connection{32};
 
+    /// The maximum number of SASL authentications queued or running
+    /// in the authentication thread pool
+    std::atomic<std::size_t> max_concurrent_authentications{1024};
+
     /// The name of the file to store portnumber information
     /// May also be set in environment (cannot change)
     std::string portnumber_file;
@@ -1012,6 +1328,10 @@ public:
         bool default_reqs_per_event;
         bool verbose;
         bool connection_idle_time;
+        bool event_time_budget;
+        bool max_send_per_event;
+        bool response_cork_size;
+        bool inflated_value_cache_size;
         bool bio_drain_buffer_sz;
         bool datatype_json;
         bool datatype_snappy;
@@ -1020,10 +1340,12 @@ public:
         bool max_packet_size;
         bool ssl_cipher_list;
         bool ssl_cipher_order;
+        bool ssl_ktls_enabled = false;
         bool ssl_cipher_suites;
         bool ssl_minimum_protocol;
         bool client_cert_auth;
         bool topkeys_size;
+        bool topkeys_max_sample_interval;
         bool sasl_mechanisms;
         bool ssl_sasl_mechanisms;
         bool dedupe_nmvb_maps;
@@ -1033,13 +1355,22 @@ public:
         bool opcode_attributes_override;
         bool topkeys_enabled;
         bool tracing_enabled;
+        bool phase_timings_enabled = false;
+        bool allocation_tracking_enabled = false;
+        bool sampling_profiler_frequency = false;
+        bool bucket_throttle = false;
+        bool tracing_auto_dump_dir = false;
+        bool tracing_auto_dump_interval = false;
+        bool numa_aware_threads = false;
         bool stdin_listener;
         bool scramsha_fallback_salt;
         bool external_auth_service;
         bool active_external_users_push_interval = false;
+        bool external_auth_cache_ttl = false;
         bool max_connections = false;
         bool system_connections = false;
         bool max_concurrent_commands_per_connection = false;
+        bool max_concurrent_authentications = false;
         bool opentracing_config = false;
 
         bool portnumber_file = false;
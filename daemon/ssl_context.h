@@ -22,7 +22,9 @@
 #include <nlohmann/json_fwd.hpp>
 #include <platform/pipe.h>
 #include <platform/socket.h>
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 /**
@@ -55,6 +57,17 @@
  *
  * It would most likely be more efficient to refactor our code to implement
  * our own BIO object instead.
+ *
+ * When kernel TLS offload is enabled (the "ssl_ktls_enabled" setting, and
+ * an OpenSSL built with kTLS support) OpenSSL reads and writes the socket
+ * directly instead, and once the handshake is complete it moves the record
+ * encryption (and decryption) into the kernel where the cipher allows it.
+ * The BIO pair and pipes are then unused, and when the kernel encrypts the
+ * data we send the connection may write plaintext directly to the socket.
+ *
+ * All connections using the same certificate share the SSL_CTX (and with
+ * it the session cache and ticket keys), so that reconnecting clients may
+ * resume their session instead of performing a full handshake.
  */
 class SslContext {
 public:
@@ -75,10 +88,29 @@ public:
     }
 
     /**
-     * Set the status of the connected flag
+     * Set the status of the connected flag (the handshake is complete)
+     */
+    void setConnected();
+
+    /**
+     * Is OpenSSL reading and writing the socket directly (kTLS mode)
+     * rather than through our BIO pair?
      */
-    void setConnected() {
-        connected = true;
+    bool isDirect() const {
+        return direct;
+    }
+
+    /**
+     * Has the kernel taken over the encryption of the data sent on the
+     * socket? If so plaintext may be sent directly on the socket.
+     */
+    bool isKtlsSend() const {
+        return ktlsSend;
+    }
+
+    /// Has the kernel taken over the decryption of the received data?
+    bool isKtlsRecv() const {
+        return ktlsRecv;
     }
 
     /**
@@ -93,9 +125,10 @@ public:
      *
      * @param cert the certificate file to use
      * @param pkey the private key file to use
+     * @param sfd the connection's socket (used directly in kTLS mode)
      * @return true if success, false if we failed to enable SSL
      */
-    bool enable(const std::string& cert, const std::string& pkey);
+    bool enable(const std::string& cert, const std::string& pkey, SOCKET sfd);
 
     /**
      * Disable SSL for this connection
@@ -126,6 +159,16 @@ public:
         return !outputPipe.empty();
     }
 
+    /// The number of recv system calls made on the socket so far
+    size_t getRecvCalls() const {
+        return recvCalls;
+    }
+
+    /// The number of send system calls made on the socket so far
+    size_t getSendCalls() const {
+        return sendCalls;
+    }
+
     /**
      * Dump the list of available ciphers to the log
      * @param id the connection id. Its only used in the
@@ -152,17 +195,42 @@ public:
     /// Get the name of the cipher in use
     const char* getCurrentCipherName() const;
 
+    /**
+     * Get the time it took to complete the handshake (from the connection
+     * was accepted). Only valid when the connection is connected.
+     */
+    std::chrono::steady_clock::duration getHandshakeDuration() const {
+        return handshakeDuration;
+    }
+
+    /// Did the client resume a previous session (an abbreviated handshake)?
+    bool isSessionReused() const {
+        return sessionReused;
+    }
+
 protected:
     bool drainInputSocketBuf();
 
     bool enabled = false;
     bool connected = false;
     bool error = false;
+    // OpenSSL uses the socket directly (kTLS mode)
+    bool direct = false;
+    // The kernel encrypts / decrypts the records (only in kTLS mode)
+    bool ktlsSend = false;
+    bool ktlsRecv = false;
     BIO* application = nullptr;
     BIO* network = nullptr;
-    SSL_CTX* ctx = nullptr;
+    // The context is shared with the other connections using the same
+    // certificate (see getSslServerContext())
+    std::shared_ptr<SSL_CTX> ctx;
     SSL* client = nullptr;
 
+    // When the handshake started, and how long it took to complete
+    std::chrono::steady_clock::time_point handshakeStart;
+    std::chrono::steady_clock::duration handshakeDuration{};
+    bool sessionReused = false;
+
     // The pipe used to buffer data between the socket and the SSL library
     // (data being read)
     cb::Pipe inputPipe;
@@ -174,4 +242,8 @@ protected:
     size_t totalRecv = 0;
     // Total number of bytes sent to the network
     size_t totalSend = 0;
+    // Number of recv system calls made on the socket
+    size_t recvCalls = 0;
+    // Number of send system calls made on the socket
+    size_t sendCalls = 0;
 };
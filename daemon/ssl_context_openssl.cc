@@ -19,6 +19,7 @@
 #include "memcached.h"
 #include "runtime.h"
 #include "settings.h"
+#include "ssl_server_context.h"
 #include "ssl_utils.h"
 
 #include <logger/logger.h>
@@ -58,56 +59,44 @@ bool SslContext::havePendingInputData() {
     return false;
 }
 
-bool SslContext::enable(const std::string& cert, const std::string& pkey) {
-    const auto& settings = Settings::instance();
-    ctx = SSL_CTX_new(SSLv23_server_method());
-    SSL_CTX_set_options(ctx, settings.getSslProtocolMask());
-    SSL_CTX_set_mode(ctx,
-                     SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
-                             SSL_MODE_ENABLE_PARTIAL_WRITE);
-
-    /* @todo don't read files, but use in-memory-copies */
-    if (!SSL_CTX_use_certificate_chain_file(ctx, cert.c_str()) ||
-        !SSL_CTX_use_PrivateKey_file(ctx, pkey.c_str(), SSL_FILETYPE_PEM)) {
-        LOG_WARNING("Failed to use SSL cert {} and pkey {}",
-                    cb::UserDataView(cert),
-                    cb::UserDataView(pkey));
-        return false;
+void SslContext::setConnected() {
+    connected = true;
+    handshakeDuration = std::chrono::steady_clock::now() - handshakeStart;
+    sessionReused = SSL_session_reused(client) == 1;
+#ifdef SSL_OP_ENABLE_KTLS
+    if (direct) {
+        ktlsSend = BIO_get_ktls_send(SSL_get_wbio(client));
+        ktlsRecv = BIO_get_ktls_recv(SSL_get_rbio(client));
     }
+#endif
+}
 
-    try {
-        set_ssl_ctx_ciphers(ctx,
-                            settings.getSslCipherList(),
-                            settings.getSslCipherSuites());
-    } catch (const std::runtime_error& error) {
-        LOG_WARNING("{}", error.what());
+bool SslContext::enable(const std::string& cert,
+                        const std::string& pkey,
+                        SOCKET sfd) {
+    const auto& settings = Settings::instance();
+    ctx = getSslServerContext(cert, pkey);
+    if (!ctx) {
         return false;
     }
 
-    int ssl_flags = 0;
-    switch (settings.getClientCertMode()) {
-    case cb::x509::Mode::Mandatory:
-        ssl_flags |= SSL_VERIFY_FAIL_IF_NO_PEER_CERT;
-    // FALLTHROUGH
-    case cb::x509::Mode::Enabled: {
-        ssl_flags |= SSL_VERIFY_PEER;
-        STACK_OF(X509_NAME)* certNames = SSL_load_client_CA_file(cert.c_str());
-        if (certNames == NULL) {
-            LOG_WARNING("Failed to read SSL cert {}", cb::UserDataView(cert));
-            return false;
-        }
-        SSL_CTX_set_client_CA_list(ctx, certNames);
-        SSL_CTX_load_verify_locations(ctx, cert.c_str(), nullptr);
-        SSL_CTX_set_verify(ctx, ssl_flags, nullptr);
-        break;
-    }
-    case cb::x509::Mode::Disabled:
-        break;
-    }
+    direct = false;
+#ifdef SSL_OP_ENABLE_KTLS
+    direct = (SSL_CTX_get_options(ctx.get()) & SSL_OP_ENABLE_KTLS) != 0;
+#endif
 
     enabled = true;
     error = false;
     client = nullptr;
+    handshakeStart = std::chrono::steady_clock::now();
+
+    if (direct) {
+        // OpenSSL reads and writes the socket itself (which is required
+        // for it to hand the crypto state over to the kernel)
+        client = SSL_new(ctx.get());
+        SSL_set_fd(client, int(sfd));
+        return true;
+    }
 
     try {
         inputPipe.ensureCapacity(settings.getBioDrainBufferSize());
@@ -121,7 +110,7 @@ bool SslContext::enable(const std::string& cert, const std::string& pkey) {
                      &network,
                      Settings::instance().getBioDrainBufferSize());
 
-    client = SSL_new(ctx);
+    client = SSL_new(ctx.get());
     SSL_set_bio(client, application, application);
 
     return true;
@@ -140,9 +129,7 @@ void SslContext::disable() {
         SSL_free(client);
     }
     error = false;
-    if (ctx != nullptr) {
-        SSL_CTX_free(ctx);
-    }
+    ctx.reset();
     enabled = false;
 }
 
@@ -165,6 +152,11 @@ bool SslContext::drainInputSocketBuf() {
 }
 
 void SslContext::drainBioRecvPipe(SOCKET sfd) {
+    if (direct) {
+        // OpenSSL reads the socket itself
+        return;
+    }
+
     bool stop;
 
     do {
@@ -174,6 +166,7 @@ void SslContext::drainBioRecvPipe(SOCKET sfd) {
         // If there is room in the input pipe (the internal buffer for read)
         // try to read out as much as possible from the socket
         if (!inputPipe.full()) {
+            ++recvCalls;
             auto n = inputPipe.produce([sfd](cb::byte_buffer data) -> ssize_t {
                 return cb::net::recv(sfd,
                                      reinterpret_cast<char*>(data.data()),
@@ -209,12 +202,18 @@ void SslContext::drainBioRecvPipe(SOCKET sfd) {
 }
 
 void SslContext::drainBioSendPipe(SOCKET sfd) {
+    if (direct) {
+        // OpenSSL writes the socket itself
+        return;
+    }
+
     bool stop;
 
     do {
         stop = true;
         // Try to move data from our internal buffer to the socket
         if (!outputPipe.empty()) {
+            ++sendCalls;
             auto n = outputPipe.consume(
                     [sfd](cb::const_byte_buffer data) -> ssize_t {
                         return cb::net::send(
@@ -285,6 +284,18 @@ nlohmann::json SslContext::toJSON() const {
         obj["error"] = error;
         obj["total_recv"] = totalRecv;
         obj["total_send"] = totalSend;
+        if (connected) {
+            obj["handshake_usec"] =
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            handshakeDuration)
+                            .count();
+            obj["session_reused"] = sessionReused;
+        }
+        obj["ktls"] = direct;
+        if (direct) {
+            obj["ktls_send"] = ktlsSend;
+            obj["ktls_recv"] = ktlsRecv;
+        }
     }
 
     return obj;
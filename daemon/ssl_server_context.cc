@@ -0,0 +1,321 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "ssl_server_context.h"
+
+#include "settings.h"
+#include "ssl_utils.h"
+
+#include <logger/logger.h>
+#include <memcached/openssl.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <utilities/logtags.h>
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+/// The session id context (required for resumption when we verify the
+/// client certificates)
+static const unsigned char sessionIdContext[] = "memcached";
+
+/**
+ * The keys used to encrypt and authenticate the session tickets. All of
+ * the contexts share the same keys, so a ticket issued by one context is
+ * still valid after the context is rebuilt.
+ */
+struct TicketKey {
+    std::array<unsigned char, 16> name;
+    std::array<unsigned char, 32> aesKey;
+    std::array<unsigned char, 32> hmacKey;
+    std::chrono::steady_clock::time_point created;
+};
+
+static struct {
+    std::mutex mutex;
+    /// [0] is used to issue new tickets, [1] is the previous key
+    std::array<TicketKey, 2> keys;
+    bool initialized = false;
+} ticketKeys;
+
+static TicketKey createTicketKey() {
+    TicketKey ret;
+    if (RAND_bytes(ret.name.data(), int(ret.name.size())) != 1 ||
+        RAND_bytes(ret.aesKey.data(), int(ret.aesKey.size())) != 1 ||
+        RAND_bytes(ret.hmacKey.data(), int(ret.hmacKey.size())) != 1) {
+        throw std::runtime_error(
+                "createTicketKey: Failed to generate random bytes");
+    }
+    ret.created = std::chrono::steady_clock::now();
+    return ret;
+}
+
+/// Rotate the ticket keys if the current key is too old (the caller
+/// must hold the mutex)
+static void maybeRotateTicketKeys() {
+    const auto age =
+            std::chrono::steady_clock::now() - ticketKeys.keys[0].created;
+    if (!ticketKeys.initialized || age >= 2 * SslTicketKeyRotationInterval) {
+        // The previous key would have expired as well
+        ticketKeys.keys[0] = createTicketKey();
+        ticketKeys.keys[1] = createTicketKey();
+        ticketKeys.initialized = true;
+    } else if (age >= SslTicketKeyRotationInterval) {
+        ticketKeys.keys[1] = ticketKeys.keys[0];
+        ticketKeys.keys[0] = createTicketKey();
+        LOG_INFO("Rotated the TLS session ticket key");
+    }
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+using TicketMacCtx = EVP_MAC_CTX;
+
+static bool initTicketMac(TicketMacCtx* mac, const TicketKey& key) {
+    OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_octet_string(
+                    OSSL_MAC_PARAM_KEY,
+                    const_cast<unsigned char*>(key.hmacKey.data()),
+                    key.hmacKey.size()),
+            OSSL_PARAM_construct_utf8_string(
+                    OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0),
+            OSSL_PARAM_construct_end()};
+    return EVP_MAC_CTX_set_params(mac, params) == 1;
+}
+#else
+using TicketMacCtx = HMAC_CTX;
+
+static bool initTicketMac(TicketMacCtx* mac, const TicketKey& key) {
+    return HMAC_Init_ex(mac,
+                        key.hmacKey.data(),
+                        int(key.hmacKey.size()),
+                        EVP_sha256(),
+                        nullptr) == 1;
+}
+#endif
+
+/**
+ * Called by OpenSSL to encrypt a new session ticket (enc == 1) or to
+ * decrypt a ticket provided by the client (enc == 0).
+ *
+ * @return -1 on error, 0 if the ticket can't be used (a full
+ *         handshake is performed), 1 on success and 2 if the ticket
+ *         was accepted but should be replaced with a new one
+ */
+static int ticketKeyCallback(SSL*,
+                             unsigned char* name,
+                             unsigned char* iv,
+                             EVP_CIPHER_CTX* cipher,
+                             TicketMacCtx* mac,
+                             int enc) {
+    std::lock_guard<std::mutex> guard(ticketKeys.mutex);
+    try {
+        maybeRotateTicketKeys();
+    } catch (const std::exception& e) {
+        LOG_WARNING("Failed to rotate the TLS session ticket key: {}",
+                    e.what());
+        if (!ticketKeys.initialized) {
+            return -1;
+        }
+    }
+
+    if (enc == 1) {
+        const auto& key = ticketKeys.keys[0];
+        if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) {
+            return -1;
+        }
+        std::copy(key.name.begin(), key.name.end(), name);
+        if (EVP_EncryptInit_ex(cipher,
+                               EVP_aes_256_cbc(),
+                               nullptr,
+                               key.aesKey.data(),
+                               iv) != 1 ||
+            !initTicketMac(mac, key)) {
+            return -1;
+        }
+        return 1;
+    }
+
+    for (size_t ii = 0; ii < ticketKeys.keys.size(); ++ii) {
+        const auto& key = ticketKeys.keys[ii];
+        if (std::equal(key.name.begin(), key.name.end(), name)) {
+            if (!initTicketMac(mac, key) ||
+                EVP_DecryptInit_ex(cipher,
+                                   EVP_aes_256_cbc(),
+                                   nullptr,
+                                   key.aesKey.data(),
+                                   iv) != 1) {
+                return -1;
+            }
+            // Ask OpenSSL to issue a new ticket if it was encrypted with
+            // the previous key
+            return ii == 0 ? 1 : 2;
+        }
+    }
+
+    // Unknown (or expired) key
+    return 0;
+}
+
+/// Get the modification time of the file (or 0 if it doesn't exist)
+static time_t getModificationTime(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        return st.st_mtime;
+    }
+    return 0;
+}
+
+static std::shared_ptr<SSL_CTX> createSslServerContext(
+        const std::string& cert, const std::string& pkey) {
+    const auto& settings = Settings::instance();
+    std::shared_ptr<SSL_CTX> ret(SSL_CTX_new(SSLv23_server_method()),
+                                 SSL_CTX_free);
+    if (!ret) {
+        LOG_WARNING("Failed to create SSL context");
+        return {};
+    }
+    auto* ctx = ret.get();
+    SSL_CTX_set_options(ctx, settings.getSslProtocolMask());
+
+    if (settings.isSslKtlsEnabled()) {
+#ifdef SSL_OP_ENABLE_KTLS
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#else
+        static std::atomic_bool warned{false};
+        if (!warned.exchange(true)) {
+            LOG_WARNING(
+                    "ssl_ktls_enabled is set, but OpenSSL is built without "
+                    "kTLS support; using user space TLS");
+        }
+#endif
+    }
+    SSL_CTX_set_mode(ctx,
+                     SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                             SSL_MODE_ENABLE_PARTIAL_WRITE);
+
+    if (!SSL_CTX_use_certificate_chain_file(ctx, cert.c_str()) ||
+        !SSL_CTX_use_PrivateKey_file(ctx, pkey.c_str(), SSL_FILETYPE_PEM)) {
+        LOG_WARNING("Failed to use SSL cert {} and pkey {}",
+                    cb::UserDataView(cert),
+                    cb::UserDataView(pkey));
+        return {};
+    }
+
+    try {
+        set_ssl_ctx_ciphers(ctx,
+                            settings.getSslCipherList(),
+                            settings.getSslCipherSuites());
+    } catch (const std::runtime_error& error) {
+        LOG_WARNING("{}", error.what());
+        return {};
+    }
+
+    int ssl_flags = 0;
+    switch (settings.getClientCertMode()) {
+    case cb::x509::Mode::Mandatory:
+        ssl_flags |= SSL_VERIFY_FAIL_IF_NO_PEER_CERT;
+    // FALLTHROUGH
+    case cb::x509::Mode::Enabled: {
+        ssl_flags |= SSL_VERIFY_PEER;
+        STACK_OF(X509_NAME)* certNames = SSL_load_client_CA_file(cert.c_str());
+        if (certNames == NULL) {
+            LOG_WARNING("Failed to read SSL cert {}", cb::UserDataView(cert));
+            return {};
+        }
+        SSL_CTX_set_client_CA_list(ctx, certNames);
+        SSL_CTX_load_verify_locations(ctx, cert.c_str(), nullptr);
+        SSL_CTX_set_verify(ctx, ssl_flags, nullptr);
+        break;
+    }
+    case cb::x509::Mode::Disabled:
+        break;
+    }
+
+    // Allow the clients to resume their sessions (from the session cache,
+    // or by using a session ticket)
+    SSL_CTX_set_session_id_context(
+            ctx, sessionIdContext, sizeof(sessionIdContext) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_timeout(
+            ctx, long(2 * SslTicketKeyRotationInterval.count()));
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticketKeyCallback);
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb(ctx, ticketKeyCallback);
+#endif
+
+    return ret;
+}
+
+namespace {
+struct CachedContext {
+    std::shared_ptr<SSL_CTX> ctx;
+    time_t certModified;
+    time_t pkeyModified;
+    /// When we last checked if the files was modified
+    std::chrono::steady_clock::time_point lastChecked;
+};
+} // namespace
+
+static struct {
+    std::mutex mutex;
+    /// Keyed by the certificate and private key files
+    std::map<std::pair<std::string, std::string>, CachedContext> contexts;
+} cache;
+
+std::shared_ptr<SSL_CTX> getSslServerContext(const std::string& cert,
+                                             const std::string& pkey) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    auto& entry = cache.contexts[{cert, pkey}];
+    if (entry.ctx && now - entry.lastChecked < std::chrono::seconds(1)) {
+        return entry.ctx;
+    }
+
+    const auto certModified = getModificationTime(cert);
+    const auto pkeyModified = getModificationTime(pkey);
+    entry.lastChecked = now;
+    if (entry.ctx && entry.certModified == certModified &&
+        entry.pkeyModified == pkeyModified) {
+        return entry.ctx;
+    }
+
+    if (entry.ctx) {
+        LOG_INFO("SSL cert {} or pkey {} changed; creating a new SSL context",
+                 cb::UserDataView(cert),
+                 cb::UserDataView(pkey));
+    }
+    entry.ctx = createSslServerContext(cert, pkey);
+    entry.certModified = certModified;
+    entry.pkeyModified = pkeyModified;
+    return entry.ctx;
+}
+
+void invalidateSslServerContexts() {
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    cache.contexts.clear();
+}
@@ -0,0 +1,59 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+struct ssl_ctx_st;
+typedef struct ssl_ctx_st SSL_CTX;
+
+/**
+ * The SSL_CTX used by a connection holds the certificate chain, the
+ * private key and the TLS configuration, but also the server side session
+ * cache and the keys used to encrypt session tickets. All connections
+ * using the same certificate and key therefore share the same context so
+ * that a reconnecting client may resume its previous session (and skip
+ * the key exchange and certificate verification), and we don't have to
+ * read and parse the certificate and key for every new connection.
+ *
+ * The context is rebuilt when one of the TLS related settings change, or
+ * when the certificate or key file is modified.
+ *
+ * @param cert the certificate file to use
+ * @param pkey the private key file to use
+ * @return the context to use, or nullptr if we failed to create it (the
+ *         reason is logged)
+ */
+std::shared_ptr<SSL_CTX> getSslServerContext(const std::string& cert,
+                                             const std::string& pkey);
+
+/**
+ * Drop all of the cached contexts so that the next connection creates a
+ * new one with the current settings (existing connections keep using the
+ * context they were created with)
+ */
+void invalidateSslServerContexts();
+
+/**
+ * The interval between each rotation of the key used to encrypt new
+ * session tickets. Tickets encrypted with the previous key are still
+ * accepted (and replaced with a new ticket), so a ticket is valid for up
+ * to two intervals.
+ */
+constexpr std::chrono::seconds SslTicketKeyRotationInterval{3600};
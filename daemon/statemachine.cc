@@ -27,6 +27,7 @@
 #include "mcbp_executors.h"
 #include "sasl_tasks.h"
 #include "settings.h"
+#include "traffic_capture.h"
 
 #include <logger/logger.h>
 #include <mcbp/mcbp.h>
@@ -188,7 +189,7 @@ bool StateMachine::conn_ship_log() {
         /* and it will slowly grow.. */
         connection.setNumEvents(connection.getMaxReqsPerEvent());
     } else if (connection.isWriteEvent()) {
-        if (connection.decrementNumEvents() >= 0) {
+        if (connection.consumeEventBudget()) {
             auto& cookie = connection.getCookieObject();
             connection.addMsgHdr(true);
             cookie.setEwouldblock(false);
@@ -235,6 +236,11 @@ bool StateMachine::conn_waiting() {
         return true;
     }
 
+    if (connection.hasRunnableParkedCookie()) {
+        setCurrentState(State::new_cmd);
+        return true;
+    }
+
     if (!connection.updateEvent(EV_READ | EV_PERSIST)) {
         LOG_WARNING(
                 "{}: conn_waiting - Unable to update libevent "
@@ -254,6 +260,11 @@ bool StateMachine::conn_read_packet_header() {
         return true;
     }
 
+    if (connection.hasRunnableParkedCookie()) {
+        setCurrentState(State::new_cmd);
+        return true;
+    }
+
     auto res = connection.tryReadNetwork();
     switch (res) {
     case Connection::TryReadResult::NoDataReceived:
@@ -300,11 +311,21 @@ bool StateMachine::conn_new_cmd() {
      * connection will only process a certain number of operations
      * before they will back off.
      */
-    if (connection.decrementNumEvents() >= 0) {
+    if (connection.consumeEventBudget()) {
         connection.getCookieObject().reset();
 
         connection.shrinkBuffers();
-        if (connection.read->rsize() >= sizeof(cb::mcbp::Header)) {
+        if (connection.resumeParkedCookie()) {
+            // Continue one of the commands parked on a connection allowing
+            // unordered execution
+            setCurrentState(State::execute);
+        } else if (connection.hasOrderedParkedCookie()) {
+            // Don't start any more commands until the parked command which
+            // must be executed in order has run. We'll get notified once
+            // one of the blocked commands completes
+            connection.unregisterEvent();
+            return false;
+        } else if (connection.read->rsize() >= sizeof(cb::mcbp::Header)) {
             setCurrentState(State::parse_cmd);
         } else if (connection.isSslEnabled()) {
             setCurrentState(State::read_packet_header);
@@ -386,6 +407,7 @@ bool StateMachine::conn_validate() {
                 return true;
             }
             cookie.setValidated(true);
+            maybeCaptureRequest(cookie);
         } else {
             // We should not be receiving a server command.
             // Audit and log
@@ -406,10 +428,30 @@ bool StateMachine::conn_execute() {
         return true;
     }
 
-    auto& cookie = connection.getCookieObject();
-    cookie.setEwouldblock(false);
+    auto* cookie = &connection.getCookieObject();
+    if (connection.getNumberOfCookies() > 1 && cookie->isEwouldblock()) {
+        // We're still waiting for the current command, but got notified
+        // for one of the parked commands. It'll run once the current
+        // command completes.
+        connection.unregisterEvent();
+        return false;
+    }
+
+    if (cookie->getParkState() == Cookie::ParkState::None &&
+        connection.parkCookie(false)) {
+        // The command must wait for the parked commands ahead of it
+        setCurrentState(State::new_cmd);
+        return true;
+    }
 
-    if (!cookie.execute()) {
+    cookie->setEwouldblock(false);
+
+    if (!cookie->execute()) {
+        if (connection.parkCookie(true)) {
+            // Let the following commands run while this one is blocked
+            setCurrentState(State::new_cmd);
+            return true;
+        }
         connection.unregisterEvent();
         return false;
     }
@@ -422,12 +464,17 @@ bool StateMachine::conn_execute() {
                 "conn_execute: Should leave conn_execute for !EWOULDBLOCK");
     }
 
-    mcbp_collect_timings(cookie);
+    mcbp_collect_timings(*cookie);
+
+    if (cookie->getParkState() != Cookie::ParkState::None) {
+        // The packet of a parked command was already consumed from the
+        // input buffer when it was parked
+        return true;
+    }
 
     // Consume the packet we just executed from the input buffer
-    connection.read->consume([&cookie](
-                                     cb::const_byte_buffer buffer) -> ssize_t {
-        size_t size = cookie.getPacket(Cookie::PacketContent::Full).size();
+    connection.read->consume([cookie](cb::const_byte_buffer buffer) -> ssize_t {
+        size_t size = cookie->getPacket(Cookie::PacketContent::Full).size();
         if (size > buffer.size()) {
             throw std::logic_error(
                     "conn_execute: Not enough data in input buffer");
@@ -438,7 +485,7 @@ bool StateMachine::conn_execute() {
     // as cleared in the cookie to avoid having it dumped in toJSON and
     // using freed memory. We cannot call reset on the cookie as we
     // want to preserve the error context and id.
-    cookie.clearPacket();
+    cookie->clearPacket();
     return true;
 }
 
@@ -447,6 +494,12 @@ bool StateMachine::conn_read_packet_body() {
         return true;
     }
 
+    if (connection.hasRunnableParkedCookie()) {
+        // Run the parked command, we'll continue reading the packet after
+        setCurrentState(State::new_cmd);
+        return true;
+    }
+
     if (connection.isPacketAvailable()) {
         throw std::logic_error(
                 "conn_read_packet_body: should not be called with the complete "
@@ -514,6 +567,12 @@ bool StateMachine::conn_read_packet_body() {
 }
 
 bool StateMachine::conn_send_data() {
+    if (connection.corkResponse()) {
+        // Sent together with the response to the next pipelined command
+        setCurrentState(connection.getWriteAndGo());
+        return true;
+    }
+
     bool ret = true;
 
     switch (connection.transmit()) {
@@ -528,6 +587,17 @@ bool StateMachine::conn_send_data() {
         break;
 
     case Connection::TransmitResult::Incomplete:
+        if (connection.isSendBudgetExhausted()) {
+            // Let the other connections on this thread run, and continue
+            // sending once we're notified that the socket is writable.
+            connection.yield();
+            if (!connection.updateEvent(EV_WRITE | EV_PERSIST)) {
+                setCurrentState(State::closing);
+                break;
+            }
+            ret = false;
+            break;
+        }
         LOG_DEBUG("{} - Incomplete transfer. Will retry", connection.getId());
         break;
 
@@ -554,7 +624,7 @@ bool StateMachine::conn_immediate_close() {
     auto& thread = connection.getThread();
     thread.notification.remove(&connection);
     // remove from pending-io list
-    std::lock_guard<std::mutex> lock(thread.pending_io.mutex);
+    thread.pending_io.drain();
     thread.pending_io.map.erase(&connection);
 
     // Set the connection to the sentinal state destroyed and return
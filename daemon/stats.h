@@ -17,6 +17,7 @@
 #pragma once
 
 #include <relaxed_atomic.h>
+#include <utilities/hdrhistogram.h>
 
 #include <cstdint>
 #include <mutex>
@@ -48,6 +49,9 @@ struct thread_stats {
         bytes_read = 0;
         cmd_flush = 0;
         conn_yields = 0;
+        recv_syscalls = 0;
+        send_syscalls = 0;
+        responses_corked = 0;
         auth_cmds = 0;
         auth_errors = 0;
         cmd_subdoc_lookup = 0;
@@ -69,6 +73,8 @@ struct thread_stats {
 
         iovused_high_watermark = 0;
         msgused_high_watermark = 0;
+
+        cpu_time_ns = 0;
     }
 
     thread_stats & operator += (const thread_stats &other) {
@@ -89,6 +95,9 @@ struct thread_stats {
         bytes_written += other.bytes_written;
         cmd_flush += other.cmd_flush;
         conn_yields += other.conn_yields;
+        recv_syscalls += other.recv_syscalls;
+        send_syscalls += other.send_syscalls;
+        responses_corked += other.responses_corked;
         auth_cmds += other.auth_cmds;
         auth_errors += other.auth_errors;
         cmd_subdoc_lookup += other.cmd_subdoc_lookup;
@@ -112,6 +121,8 @@ struct thread_stats {
         iovused_high_watermark.setIfGreater(other.iovused_high_watermark);
         msgused_high_watermark.setIfGreater(other.msgused_high_watermark);
 
+        cpu_time_ns += other.cpu_time_ns;
+
         return *this;
     }
 
@@ -139,6 +150,12 @@ struct thread_stats {
     cb::RelaxedAtomic<uint64_t> cmd_flush;
     cb::RelaxedAtomic<uint64_t>
             conn_yields; /* # of yields for connections (-R option)*/
+    /* # of system calls made to read from client sockets */
+    cb::RelaxedAtomic<uint64_t> recv_syscalls;
+    /* # of system calls made to write to client sockets */
+    cb::RelaxedAtomic<uint64_t> send_syscalls;
+    /* # of responses held back to be sent with the following ones */
+    cb::RelaxedAtomic<uint64_t> responses_corked;
     cb::RelaxedAtomic<uint64_t> auth_cmds;
     cb::RelaxedAtomic<uint64_t> auth_errors;
     /* # of subdoc lookup commands (GET/EXISTS/MULTI_LOOKUP) */
@@ -185,6 +202,91 @@ struct thread_stats {
     cb::RelaxedAtomic<int> iovused_high_watermark;
     /* High value Connection->msgused has got to */
     cb::RelaxedAtomic<int> msgused_high_watermark;
+
+    /* CPU time (ns) the front end threads spent serving the connections
+       bound to the bucket */
+    cb::RelaxedAtomic<uint64_t> cpu_time_ns;
+};
+
+/**
+ * Per front end thread stats describing how the time based connection
+ * scheduler (Settings::getEventTimeBudget()) shares the thread between
+ * its connections.
+ */
+struct scheduler_fairness_stats {
+    /* # of events a connection was served with a time budget */
+    cb::RelaxedAtomic<uint64_t> events{0};
+    /* # of commands run within those events */
+    cb::RelaxedAtomic<uint64_t> commands{0};
+    /* # of times a connection yielded as it had used its time budget */
+    cb::RelaxedAtomic<uint64_t> budget_yields{0};
+    /* # of events which ran longer than the time budget */
+    cb::RelaxedAtomic<uint64_t> overruns{0};
+    /* Total time (in usec) events ran past the time budget */
+    cb::RelaxedAtomic<uint64_t> overrun_usec{0};
+};
+
+/**
+ * Per front end thread load, used by the dispatcher to place new
+ * connections on the least loaded thread.
+ */
+struct thread_load_stats {
+    /* # of connections currently bound to the thread */
+    cb::RelaxedAtomic<uint64_t> connections{0};
+    /* Total time (in usec) the thread spent serving connection events */
+    cb::RelaxedAtomic<uint64_t> busy_usec{0};
+    /* Recent busy time (in usec per second), as last sampled by the
+       dispatcher */
+    cb::RelaxedAtomic<uint64_t> busy_rate{0};
+    /* # of connections the dispatcher placed on the thread */
+    cb::RelaxedAtomic<uint64_t> placed{0};
+};
+
+/**
+ * Per front end thread stats for the pools of network buffers its
+ * connections borrow from (see FrontEndThread::readPool / writePool).
+ */
+struct buffer_pool_stats {
+    struct Pool {
+        /* # of buffers currently held by connections */
+        cb::RelaxedAtomic<uint64_t> in_use{0};
+        /* Highest # of buffers held by connections at the same time */
+        cb::RelaxedAtomic<uint64_t> in_use_high_watermark{0};
+        /* # of idle buffers currently in the pool */
+        cb::RelaxedAtomic<uint64_t> pooled{0};
+        /* Highest # of idle buffers in the pool at the same time */
+        cb::RelaxedAtomic<uint64_t> pooled_high_watermark{0};
+    };
+    Pool read;
+    Pool write;
+};
+
+/**
+ * Per front end thread stats for its cache of inflated document values
+ * (see InflatedValueCache).
+ */
+struct inflated_value_cache_stats {
+    /* # of reads served with a cached inflated value */
+    cb::RelaxedAtomic<uint64_t> hits{0};
+    /* # of reads which had to inflate the value */
+    cb::RelaxedAtomic<uint64_t> misses{0};
+    /* # of entries evicted to make space for others */
+    cb::RelaxedAtomic<uint64_t> evictions{0};
+    /* # of entries currently in the cache */
+    cb::RelaxedAtomic<uint64_t> items{0};
+    /* # of bytes currently used by the cache */
+    cb::RelaxedAtomic<uint64_t> bytes{0};
+};
+
+/**
+ * Per front end thread histograms of the time it took to complete the
+ * TLS handshake for the connections (from the connection was accepted).
+ */
+struct tls_handshake_stats {
+    /* Handshakes where the client resumed a previous session */
+    Hdr1sfMicroSecHistogram resumed;
+    /* Full handshakes */
+    Hdr1sfMicroSecHistogram full;
 };
 
 /**
@@ -220,6 +322,14 @@ struct stats {
 
     /** The number of times I reject a client */
     cb::RelaxedAtomic<uint64_t> rejected_conns;
+
+    /**
+     * The number of connections dispatched to a front end thread on the
+     * NUMA node which received them (and the number which had to be
+     * served by a thread on another node) with numa_aware_threads
+     */
+    cb::RelaxedAtomic<uint64_t> numa_local_conns;
+    cb::RelaxedAtomic<uint64_t> numa_remote_conns;
 };
 
 class Connection;
@@ -43,6 +43,9 @@
 #include <xattr/blob.h>
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <memory>
+
 static const std::array<SubdocCmdContext::Phase, 2> phases{{SubdocCmdContext::Phase::XATTR,
                                                             SubdocCmdContext::Phase::Body}};
 
@@ -550,12 +553,13 @@ static bool subdoc_fetch(Cookie& cookie,
 
 /**
  * Perform the subjson operation specified by {spec} to one path in the
- * document.
+ * document (normally spec.path, but see SubdocPrefixIndex).
  */
 static cb::mcbp::Status subdoc_operate_one_path(
         SubdocCmdContext& context,
         SubdocCmdContext::OperationSpec& spec,
-        const cb::const_char_buffer& in_doc) {
+        const cb::const_char_buffer& in_doc,
+        cb::const_char_buffer path) {
     // Prepare the specified sub-document command.
     auto& op = context.connection.getThread().subdoc_op;
     op.clear();
@@ -585,7 +589,7 @@ static cb::mcbp::Status subdoc_operate_one_path(
     }
 
     // ... and execute it.
-    const auto subdoc_res = op.op_exec(spec.path.buf, spec.path.len);
+    const auto subdoc_res = op.op_exec(path.buf, path.len);
 
     switch (subdoc_res) {
     case Subdoc::Error::SUCCESS:
@@ -666,6 +670,168 @@ static cb::mcbp::Status subdoc_operate_wholedoc(
     }
 }
 
+/**
+ * Serves the lookups of a multi-path lookup which share a leading path from
+ * the value of that path. The document is parsed once to locate the value of
+ * each shared prefix (e.g. "profile.address" for "profile.address.city" and
+ * "profile.address.zip"), and each of those lookups then only parses that
+ * (sub)value, instead of every lookup parsing the document from the start.
+ *
+ * Lookups are grouped by their first path component, and each group of two
+ * or more gets the longest leading path shared by all of them. If a prefix
+ * can't be resolved to an object or array (or the paths use escaped
+ * components) its lookups fall back to operating on the whole document, so
+ * the results (and errors) are the same either way.
+ */
+class SubdocPrefixIndex {
+public:
+    /// Build the index for the body lookups of the context
+    explicit SubdocPrefixIndex(SubdocCmdContext& context,
+                               cb::const_char_buffer doc);
+
+    /**
+     * Get the document and path to execute spec with: the value of its
+     * prefix and the path relative to it if indexed, otherwise the
+     * document and the spec's path.
+     */
+    std::pair<cb::const_char_buffer, cb::const_char_buffer> lookup(
+            const SubdocCmdContext::OperationSpec& spec,
+            cb::const_char_buffer doc) const;
+
+private:
+    static bool isIndexable(const SubdocCmdContext::OperationSpec& spec);
+
+    /// Is there a component boundary ('.' or '[') at pos of path
+    static bool isBoundary(cb::const_char_buffer path, size_t pos) {
+        return pos > 0 && pos < path.size() &&
+               (path.buf[pos] == '.' || path.buf[pos] == '[');
+    }
+
+    struct Entry {
+        /// The shared leading path
+        cb::const_char_buffer prefix;
+        /// The value of the prefix in the document
+        cb::const_char_buffer value;
+    };
+    std::vector<Entry> entries;
+};
+
+SubdocPrefixIndex::SubdocPrefixIndex(SubdocCmdContext& context,
+                                     cb::const_char_buffer doc) {
+    auto& operations = context.getOperations();
+    std::vector<const SubdocCmdContext::OperationSpec*> specs;
+    for (const auto& spec : operations) {
+        if (isIndexable(spec)) {
+            specs.push_back(&spec);
+        }
+    }
+
+    std::vector<bool> grouped(specs.size());
+    for (size_t ii = 0; ii < specs.size(); ++ii) {
+        if (grouped[ii]) {
+            continue;
+        }
+
+        // The longest common prefix of the paths starting with the same
+        // component as this one
+        const auto first = specs[ii]->path;
+        size_t length = first.size();
+        size_t members = 1;
+        for (size_t jj = ii + 1; jj < specs.size(); ++jj) {
+            const auto path = specs[jj]->path;
+            size_t common = 0;
+            const auto max = std::min(length, path.size());
+            while (common < max && path.buf[common] == first.buf[common]) {
+                ++common;
+            }
+            // Must share (at least) the first component
+            bool sameComponent = false;
+            for (size_t pos = 1; pos <= common; ++pos) {
+                if (isBoundary(first, pos) && isBoundary(path, pos)) {
+                    sameComponent = true;
+                    break;
+                }
+            }
+            if (sameComponent) {
+                grouped[jj] = true;
+                length = common;
+                ++members;
+            }
+        }
+        if (members < 2) {
+            continue;
+        }
+
+        // Back off to a component boundary in all of the group's paths
+        for (; length > 0; --length) {
+            bool boundary = isBoundary(first, length);
+            for (size_t jj = ii + 1; boundary && jj < specs.size(); ++jj) {
+                const auto path = specs[jj]->path;
+                if (path.size() > length &&
+                    std::equal(path.buf, path.buf + length, first.buf)) {
+                    boundary = isBoundary(path, length);
+                }
+            }
+            if (boundary) {
+                break;
+            }
+        }
+        if (length == 0) {
+            continue;
+        }
+
+        // Locate the value of the prefix
+        auto& op = context.connection.getThread().subdoc_op;
+        Subdoc::Result result;
+        op.clear();
+        op.set_result_buf(&result);
+        op.set_code(Subdoc::Command::GET);
+        op.set_doc(doc.buf, doc.len);
+        if (op.op_exec(first.buf, length) != Subdoc::Error::SUCCESS) {
+            continue;
+        }
+        const auto loc = result.matchloc();
+        if (loc.length == 0 || (loc.at[0] != '{' && loc.at[0] != '[')) {
+            continue;
+        }
+        entries.push_back({{first.buf, length}, {loc.at, loc.length}});
+    }
+}
+
+bool SubdocPrefixIndex::isIndexable(
+        const SubdocCmdContext::OperationSpec& spec) {
+    switch (spec.traits.subdocCommand) {
+    case Subdoc::Command::GET:
+    case Subdoc::Command::EXISTS:
+    case Subdoc::Command::GET_COUNT:
+        break;
+    default:
+        return false;
+    }
+    const auto path = spec.path;
+    return spec.traits.scope == CommandScope::SubJSON && path.len != 0 &&
+           std::find(path.buf, path.buf + path.len, '`') == path.buf + path.len;
+}
+
+std::pair<cb::const_char_buffer, cb::const_char_buffer>
+SubdocPrefixIndex::lookup(const SubdocCmdContext::OperationSpec& spec,
+                          cb::const_char_buffer doc) const {
+    if (isIndexable(spec)) {
+        const auto path = spec.path;
+        for (const auto& entry : entries) {
+            const auto length = entry.prefix.size();
+            if (isBoundary(path, length) &&
+                std::equal(path.buf, path.buf + length, entry.prefix.buf)) {
+                // "a.b" + ".c" => "c" in the value of "a.b", but
+                // "a.b" + "[1]" => "[1]"
+                const auto skip = path.buf[length] == '.' ? length + 1 : length;
+                return {entry.value, {path.buf + skip, path.size() - skip}};
+            }
+        }
+    }
+    return {doc, spec.path};
+}
+
 /**
  * Run through all of the subdoc operations for the current phase on
  * a single 'document' (either the user document, or a XATTR).
@@ -692,13 +858,36 @@ static bool operate_single_doc(SubdocCmdContext& context,
     modified = false;
     auto& operations = context.getOperations();
 
+    // Multi-path lookups on the body share the parsing of common prefixes
+    std::unique_ptr<SubdocPrefixIndex> prefixIndex;
+    if (!context.traits.is_mutator &&
+        context.traits.path == SubdocPath::MULTI &&
+        context.getCurrentPhase() == SubdocCmdContext::Phase::Body &&
+        mcbp::datatype::is_json(doc_datatype) && operations.size() > 1) {
+        prefixIndex = std::make_unique<SubdocPrefixIndex>(context, doc);
+    }
+
+    // For mutations the next operation's input document is built in
+    // the spare buffer, which swaps roles with temp_buffer (so each of
+    // them is only reallocated if it needs to grow).
+    size_t temp_buffer_size = 0;
+    std::unique_ptr<char[]> spare_buffer;
+    size_t spare_buffer_size = 0;
+
     // 2. Perform each of the operations on document.
     for (auto op = operations.begin(); op != operations.end(); op++) {
         switch (op->traits.scope) {
         case CommandScope::SubJSON:
             if (mcbp::datatype::is_json(doc_datatype)) {
                 // Got JSON, perform the operation.
-                op->status = subdoc_operate_one_path(context, *op, doc);
+                if (prefixIndex) {
+                    const auto input = prefixIndex->lookup(*op, doc);
+                    op->status = subdoc_operate_one_path(
+                            context, *op, input.first, input.second);
+                } else {
+                    op->status = subdoc_operate_one_path(
+                            context, *op, doc, op->path);
+                }
             } else {
                 // No good; need to have JSON.
                 op->status = cb::mcbp::Status::SubdocDocNotJson;
@@ -726,27 +915,34 @@ static bool operate_single_doc(SubdocCmdContext& context,
                 // storage for iovecs from the result. Ideally we'd
                 // either permit subjson to take an iovec as input, or
                 // permit subjson to take all the multipaths at once.
-                // For now we make a contiguous region in a temporary
-                // char[], and point in_doc at that.
-                std::unique_ptr<char[]> temp(new char[new_doc_len]);
+                // For now we make a contiguous region in the spare
+                // buffer (which isn't the source of any of the iovecs),
+                // and point in_doc at that.
+                if (spare_buffer_size < new_doc_len) {
+                    spare_buffer.reset(new char[new_doc_len]);
+                    spare_buffer_size = new_doc_len;
+                }
 
                 size_t offset = 0;
                 for (auto& loc : op->result.newdoc()) {
-                    std::copy(loc.at, loc.at + loc.length, temp.get() + offset);
+                    std::copy(loc.at,
+                              loc.at + loc.length,
+                              spare_buffer.get() + offset);
                     offset += loc.length;
                 }
 
-                // Copying complete - safe to delete the old temp_doc
-                // (even if it was the source of some of the newdoc
-                // iovecs).
-                temp_buffer.swap(temp);
+                // Copying complete - the old temp_doc (which may have been
+                // the source of some of the newdoc iovecs) becomes the
+                // spare buffer for the next operation.
+                temp_buffer.swap(spare_buffer);
+                std::swap(temp_buffer_size, spare_buffer_size);
                 doc.buf = temp_buffer.get();
                 doc.len = new_doc_len;
 
                 if (op->traits.scope == CommandScope::WholeDoc) {
                     // the entire document has been replaced as part of a
                     // wholedoc op update the datatype to match
-                    JSON_checker::Validator validator;
+                    auto& validator = context.connection.getThread().validator;
                     bool isValidJson = validator.validate(
                             reinterpret_cast<const uint8_t*>(doc.data()),
                             doc.size());
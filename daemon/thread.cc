@@ -9,6 +9,7 @@
 #include "listening_port.h"
 #include "log_macros.h"
 #include "memcached.h"
+#include "numa_placement.h"
 #include "opentracing.h"
 #include "settings.h"
 #include "stats.h"
@@ -16,6 +17,7 @@
 #include <utilities/hdrhistogram.h>
 
 #include <memcached/openssl.h>
+#include <memcached/sampling_profiler.h>
 #include <nlohmann/json.hpp>
 #include <openssl/conf.h>
 #include <phosphor/phosphor.h>
@@ -23,14 +25,17 @@
 #include <platform/strerror.h>
 
 #include <fcntl.h>
+#include <algorithm>
 #include <atomic>
 #include <cerrno>
+#include <chrono>
 #include <condition_variable>
 #include <csignal>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
 #ifndef WIN32
 #include <netinet/tcp.h> // For TCP_NODELAY etc
 #endif
@@ -93,6 +98,11 @@ void FrontEndThread::NotificationList::swap(std::vector<Connection*>& other) {
  */
 static std::vector<FrontEndThread> threads;
 std::vector<Hdr1sfMicroSecHistogram> scheduler_info;
+std::vector<scheduler_fairness_stats> scheduler_fairness;
+std::vector<thread_load_stats> thread_loads;
+std::vector<buffer_pool_stats> buffer_pools;
+std::vector<inflated_value_cache_stats> inflated_value_caches;
+std::vector<tls_handshake_stats> tls_handshakes;
 
 /*
  * Number of worker threads that have finished setting themselves up.
@@ -205,6 +215,11 @@ static void setup_thread(FrontEndThread& me) {
  */
 static void worker_libevent(void *arg) {
     auto& me = *reinterpret_cast<FrontEndThread*>(arg);
+    cb::profiler::ScopedThreadRegistration profilerRegistration("mc:worker");
+
+    if (me.numaNode != -1 && !bindCurrentThreadToNumaNode(me.numaNode)) {
+        me.numaNode = -1;
+    }
 
     // Any per-thread setup can happen here; thread_init() will block until
     // all threads have finished initializing.
@@ -249,6 +264,7 @@ static void dispatch_new_connections(FrontEndThread& me) {
 
     for (const auto& entry : connections) {
         if (conn_new(entry.first, *entry.second, me.base, me) == nullptr) {
+            thread_loads[me.index].connections--;
             if (entry.second->system) {
                 --stats.system_conns;
             }
@@ -270,6 +286,7 @@ static void thread_libevent_process(evutil_socket_t fd, short, void* arg) {
     // to care about race conditions for stuff people try to notify us
     // about.
     drain_notification_channel(fd);
+    me.wakeups++;
 
     if (memcached_shutdown) {
         // Someone requested memcached to shut down. The listen thread should
@@ -290,10 +307,8 @@ static void thread_libevent_process(evutil_socket_t fd, short, void* arg) {
     dispatch_new_connections(me);
 
     FrontEndThread::PendingIoMap pending;
-    {
-        std::lock_guard<std::mutex> lock(me.pending_io.mutex);
-        me.pending_io.map.swap(pending);
-    }
+    me.pending_io.drain();
+    me.pending_io.map.swap(pending);
 
     TRACE_LOCKGUARD_TIMED(me.mutex,
                           "mutex",
@@ -378,20 +393,142 @@ void notify_io_complete(gsl::not_null<const void*> void_cookie,
 /* Which thread we assigned a connection to most recently. */
 static size_t last_thread = 0;
 
+/**
+ * The dispatcher's view of the load of each front end thread. Only
+ * accessed by the dispatcher thread.
+ */
+static struct {
+    std::chrono::steady_clock::time_point lastSample;
+    /// thread_load_stats::busy_usec of each thread at lastSample
+    std::vector<uint64_t> lastBusyUsec;
+    /// Moving average (weight 1/4) of the busy time, in usec per second
+    std::vector<double> busyRate;
+    /// Connections placed on each thread since lastSample
+    std::vector<uint64_t> placedSinceSample;
+} dispatcher_load;
+
+/**
+ * Update the dispatcher's view of the thread loads from the time each
+ * thread spent serving connections since the last sample. Samples are
+ * taken at most every 100ms, as a connection's cost only shows up once
+ * it has been served for a while.
+ */
+static void sample_thread_loads() {
+    using namespace std::chrono;
+    const auto now = steady_clock::now();
+    const auto nthr = threads.size();
+    if (dispatcher_load.busyRate.size() != nthr) {
+        dispatcher_load.lastSample = now;
+        dispatcher_load.lastBusyUsec.assign(nthr, 0);
+        dispatcher_load.busyRate.assign(nthr, 0.0);
+        dispatcher_load.placedSinceSample.assign(nthr, 0);
+        for (size_t ii = 0; ii < nthr; ++ii) {
+            dispatcher_load.lastBusyUsec[ii] = thread_loads[ii].busy_usec;
+        }
+        return;
+    }
+
+    const auto elapsed = now - dispatcher_load.lastSample;
+    if (elapsed < milliseconds(100)) {
+        return;
+    }
+    const auto seconds = duration<double>(elapsed).count();
+    for (size_t ii = 0; ii < nthr; ++ii) {
+        const uint64_t busy = thread_loads[ii].busy_usec;
+        const auto rate = (busy - dispatcher_load.lastBusyUsec[ii]) / seconds;
+        dispatcher_load.lastBusyUsec[ii] = busy;
+        auto& average = dispatcher_load.busyRate[ii];
+        average += (rate - average) / 4;
+        dispatcher_load.placedSinceSample[ii] = 0;
+        thread_loads[ii].busy_rate = uint64_t(average);
+    }
+    dispatcher_load.lastSample = now;
+}
+
+/**
+ * Pick the least loaded of the candidate threads for a new connection.
+ * The load of a thread is its recent busy time, plus the average cost of
+ * a connection for each connection placed on it since the load was
+ * sampled (so a burst of new connections is spread out before their cost
+ * shows up). Ties (e.g. all threads idle) go to the thread with the fewest
+ * connections, and then round robin.
+ */
+static size_t pick_least_loaded_thread(const std::vector<size_t>& candidates) {
+    sample_thread_loads();
+
+    double totalRate = 0;
+    uint64_t totalConnections = 0;
+    for (size_t ii = 0; ii < threads.size(); ++ii) {
+        totalRate += dispatcher_load.busyRate[ii];
+        totalConnections += thread_loads[ii].connections;
+    }
+    const double connectionCost =
+            totalRate / std::max(uint64_t(1), totalConnections);
+
+    size_t best = candidates.front();
+    double bestLoad = std::numeric_limits<double>::max();
+    uint64_t bestConnections = std::numeric_limits<uint64_t>::max();
+    for (const auto tid : candidates) {
+        const double load =
+                dispatcher_load.busyRate[tid] +
+                connectionCost * dispatcher_load.placedSinceSample[tid];
+        const uint64_t connections = thread_loads[tid].connections;
+        if (load < bestLoad ||
+            (load == bestLoad && connections < bestConnections)) {
+            best = tid;
+            bestLoad = load;
+            bestConnections = connections;
+        }
+    }
+    return best;
+}
+
 /*
  * Dispatches a new connection to another thread. This is only ever called
  * from the main thread, or because of an incoming connection.
  */
 void dispatch_conn_new(SOCKET sfd, SharedListeningPort& interface) {
-    size_t tid = (last_thread + 1) % Settings::instance().getNumWorkerThreads();
+    // Consider the threads starting after the last one used, so that ties
+    // are placed round robin.
+    const auto nthr = threads.size();
+    std::vector<size_t> candidates;
+    candidates.reserve(nthr);
+    for (size_t ii = 1; ii <= nthr; ++ii) {
+        candidates.push_back((last_thread + ii) % nthr);
+    }
+
+    if (threads[candidates.front()].numaNode != -1) {
+        // Prefer the threads on the node which received the connection
+        // so that its buffers and state stay local to the node
+        const auto node = getNumaNodeOfSocket(sfd);
+        std::vector<size_t> local;
+        for (const auto tid : candidates) {
+            if (node != -1 && threads[tid].numaNode == node) {
+                local.push_back(tid);
+            }
+        }
+        if (!local.empty()) {
+            candidates.swap(local);
+            ++stats.numa_local_conns;
+        } else {
+            ++stats.numa_remote_conns;
+        }
+    }
+    const auto tid = pick_least_loaded_thread(candidates);
     auto& thread = threads[tid];
     last_thread = tid;
+    dispatcher_load.placedSinceSample[tid]++;
+    thread_loads[tid].placed++;
+    // Counted here rather than when the thread picks the connection up, so
+    // the next placement sees it
+    thread_loads[tid].connections++;
 
     try {
         thread.new_conn_queue.push(sfd, interface);
     } catch (const std::bad_alloc& e) {
         LOG_WARNING("dispatch_conn_new: Failed to dispatch new connection: {}",
                     e.what());
+        thread_loads[tid].connections--;
 
         if (interface->system) {
             --stats.system_conns;
@@ -418,6 +555,15 @@ void notify_dispatcher() {
 
 /******************************* GLOBAL STATS ******************************/
 
+std::pair<uint64_t, uint64_t> get_worker_notification_stats() {
+    std::pair<uint64_t, uint64_t> ret{0, 0};
+    for (const auto& thread : threads) {
+        ret.first += thread.pending_io.notifications;
+        ret.second += thread.wakeups;
+    }
+    return ret;
+}
+
 void threadlocal_stats_reset(std::vector<thread_stats>& thread_stats) {
     for (auto& ii : thread_stats) {
         ii.reset();
@@ -434,6 +580,11 @@ void thread_init(size_t nthr,
                  struct event_base* main_base,
                  void (*dispatcher_callback)(evutil_socket_t, short, void*)) {
     scheduler_info.resize(nthr);
+    scheduler_fairness = std::vector<scheduler_fairness_stats>(nthr);
+    thread_loads = std::vector<thread_load_stats>(nthr);
+    buffer_pools = std::vector<buffer_pool_stats>(nthr);
+    inflated_value_caches = std::vector<inflated_value_cache_stats>(nthr);
+    tls_handshakes = std::vector<tls_handshake_stats>(nthr);
 
     try {
         threads = std::vector<FrontEndThread>(nthr);
@@ -443,11 +594,25 @@ void thread_init(size_t nthr,
 
     setup_dispatcher(main_base, dispatcher_callback);
 
+    const auto numaNodes = getNumaNodeCount();
+    const bool numaAware =
+            Settings::instance().isNumaAwareThreads() && numaNodes > 1;
+    if (Settings::instance().isNumaAwareThreads()) {
+        LOG_INFO("NUMA aware front end threads: {}",
+                 numaAware ? "enabled over " + std::to_string(numaNodes) +
+                                     " nodes"
+                           : std::string("disabled (single node)"));
+    }
+
     for (size_t ii = 0; ii < nthr; ii++) {
         if (!create_notification_pipe(threads[ii])) {
             FATAL_ERROR(EXIT_FAILURE, "Cannot create notification pipe");
         }
         threads[ii].index = ii;
+        if (numaAware) {
+            threads[ii].numaNode = int(ii % numaNodes);
+        }
+        threads[ii].inflatedValues.setStats(inflated_value_caches[ii]);
 
         setup_thread(threads[ii]);
     }
@@ -506,28 +671,33 @@ void notify_thread(FrontEndThread& thread) {
     }
 }
 
+bool FrontEndThread::PendingIo::push(Connection* c,
+                                     Cookie* cookie,
+                                     ENGINE_ERROR_CODE status) {
+    return queue.insertHead({c, cookie, status});
+}
+
+void FrontEndThread::PendingIo::drain() {
+    uint64_t count = 0;
+    queue.sweep([this, &count](Notification&& notification) {
+        ++count;
+        auto& entries = map[notification.connection];
+        for (const auto& pair : entries) {
+            if (pair.first == notification.cookie) {
+                // we've already got a pending notification for this
+                // cookie.. Ignore it
+                return;
+            }
+        }
+        entries.emplace_back(notification.cookie, notification.status);
+    });
+    if (count) {
+        notifications += count;
+    }
+}
+
 int add_conn_to_pending_io_list(Connection* c,
                                 Cookie* cookie,
                                 ENGINE_ERROR_CODE status) {
-    auto& thread = c->getThread();
-
-    std::lock_guard<std::mutex> lock(thread.pending_io.mutex);
-    auto iter = thread.pending_io.map.find(c);
-    if (iter == thread.pending_io.map.end()) {
-        thread.pending_io.map.emplace(
-                c,
-                std::vector<std::pair<Cookie*, ENGINE_ERROR_CODE>>{
-                        {cookie, status}});
-        return 1;
-    }
-
-    for (const auto& pair : iter->second) {
-        if (pair.first == cookie) {
-            // we've already got a pending notification for this
-            // cookie.. Ignore it
-            return 0;
-        }
-    }
-    iter->second.emplace_back(cookie, status);
-    return 1;
+    return c->getThread().pending_io.push(c, cookie, status) ? 1 : 0;
 }
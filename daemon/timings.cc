@@ -23,21 +23,37 @@ Timings::Timings() {
 
 Timings::~Timings() {
     std::lock_guard<std::mutex> lg(histogram_mutex);
-    for (auto& t : timings) {
-        delete t;
+    for (auto* store : {&timings, &phase_timings}) {
+        for (auto& shard : *store) {
+            for (auto& t : shard.histograms) {
+                delete t;
+            }
+        }
     }
 }
 
 void Timings::reset() {
     {
         std::lock_guard<std::mutex> lg(histogram_mutex);
-        for (auto& t : timings) {
-            if (t) {
-                t.load()->reset();
+        for (auto* store : {&timings, &phase_timings}) {
+            for (auto& shard : *store) {
+                for (auto& t : shard.histograms) {
+                    if (t) {
+                        t.load()->reset();
+                    }
+                }
             }
         }
     }
 
+    for (auto& shard : allocation_counters) {
+        for (auto& counters : shard.opcodes) {
+            counters.ops = 0;
+            counters.allocations = 0;
+            counters.bytes = 0;
+        }
+    }
+
     {
         std::lock_guard<std::mutex> lg(lock);
         interval_latency_lookups.reset();
@@ -60,9 +76,8 @@ void Timings::collect(cb::mcbp::ClientOpcode opcode,
 }
 
 std::string Timings::generate(cb::mcbp::ClientOpcode opcode) {
-    auto* histoPtr =
-            timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode)]
-                    .load();
+    auto histoPtr = get_timing_histogram(
+            std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode));
     if (histoPtr) {
         return histoPtr->to_string();
     }
@@ -115,13 +130,12 @@ static const cb::mcbp::ClientOpcode timings_retrievals[] = {
         cb::mcbp::ClientOpcode::SubdocGet,
         cb::mcbp::ClientOpcode::SubdocExists};
 
-uint64_t Timings::get_aggregated_mutation_stats() {
-
+uint64_t Timings::get_value_count(cb::mcbp::ClientOpcode opcode) const {
+    const auto index =
+            std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode);
     uint64_t ret = 0;
-    for (auto cmd : timings_mutations) {
-        auto* histoPtr =
-                timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd)]
-                        .load();
+    for (const auto& shard : timings) {
+        auto* histoPtr = shard[index].load();
         if (histoPtr) {
             ret += histoPtr->getValueCount();
         }
@@ -129,16 +143,20 @@ uint64_t Timings::get_aggregated_mutation_stats() {
     return ret;
 }
 
+uint64_t Timings::get_aggregated_mutation_stats() {
+
+    uint64_t ret = 0;
+    for (auto cmd : timings_mutations) {
+        ret += get_value_count(cmd);
+    }
+    return ret;
+}
+
 uint64_t Timings::get_aggregated_retrival_stats() {
 
     uint64_t ret = 0;
     for (auto cmd : timings_retrievals) {
-        auto* histoPtr =
-                timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd)]
-                        .load();
-        if (histoPtr) {
-            ret += histoPtr->getValueCount();
-        }
+        ret += get_value_count(cmd);
     }
     return ret;
 }
@@ -153,19 +171,68 @@ cb::sampling::Interval Timings::get_interval_lookup_latency() {
     return interval_latency_lookups.getAggregate();
 }
 
-Hdr1sfMicroSecHistogram& Timings::get_or_create_timing_histogram(
-        uint8_t opcode) {
-    if (!timings[opcode]) {
+Hdr1sfMicroSecHistogram& Timings::get_or_create_histogram(
+        CoreStore<HistogramShard>& store, uint8_t index) {
+    auto& histo = store.get()[index];
+    if (!histo) {
         std::lock_guard<std::mutex> allocLock(histogram_mutex);
-        if (!timings[opcode]) {
-            timings[opcode] = new Hdr1sfMicroSecHistogram();
+        if (!histo) {
+            histo = new Hdr1sfMicroSecHistogram();
         }
     }
-    return *(timings[opcode].load());
+    return *(histo.load());
 }
 
-Hdr1sfMicroSecHistogram* Timings::get_timing_histogram(uint8_t opcode) const {
-    return timings[opcode].load();
+std::unique_ptr<Hdr1sfMicroSecHistogram> Timings::merge_histograms(
+        const CoreStore<HistogramShard>& store, uint8_t index) {
+    std::unique_ptr<Hdr1sfMicroSecHistogram> merged;
+    for (const auto& shard : store) {
+        auto* histoPtr = shard[index].load();
+        if (histoPtr) {
+            if (!merged) {
+                merged = std::make_unique<Hdr1sfMicroSecHistogram>();
+            }
+            *merged += *histoPtr;
+        }
+    }
+    return merged;
+}
+
+std::unique_ptr<Hdr1sfMicroSecHistogram> Timings::get_timing_histogram(
+        uint8_t opcode) const {
+    return merge_histograms(timings, opcode);
+}
+
+void Timings::collectPhase(cb::tracing::TraceCode code,
+                           std::chrono::microseconds duration) {
+    get_or_create_histogram(phase_timings, uint8_t(code)).add(duration);
+}
+
+std::unique_ptr<Hdr1sfMicroSecHistogram> Timings::get_phase_histogram(
+        cb::tracing::TraceCode code) const {
+    return merge_histograms(phase_timings, uint8_t(code));
+}
+
+void Timings::collectAllocations(cb::mcbp::ClientOpcode opcode,
+                                 const AllocationCounter::Counts& counts) {
+    auto& counters = allocation_counters.get().opcodes[uint8_t(opcode)];
+    counters.ops.fetch_add(1, std::memory_order_relaxed);
+    counters.allocations.fetch_add(counts.allocations,
+                                   std::memory_order_relaxed);
+    counters.bytes.fetch_add(counts.bytes, std::memory_order_relaxed);
+}
+
+Timings::AllocationStats Timings::get_allocation_stats(
+        cb::mcbp::ClientOpcode opcode) const {
+    AllocationStats stats;
+    for (const auto& shard : allocation_counters) {
+        const auto& counters = shard.opcodes[uint8_t(opcode)];
+        stats.ops += counters.ops.load(std::memory_order_relaxed);
+        stats.allocations +=
+                counters.allocations.load(std::memory_order_relaxed);
+        stats.bytes += counters.bytes.load(std::memory_order_relaxed);
+    }
+    return stats;
 }
 
 void Timings::sample(std::chrono::seconds sample_interval) {
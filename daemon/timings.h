@@ -16,13 +16,17 @@
  */
 #pragma once
 
+#include "allocation_counter.h"
 #include "timing_interval.h"
 
 #include <mcbp/protocol/opcode.h>
+#include <tracing/tracetypes.h>
 
 #include <platform/corestore.h>
 #include <utilities/hdrhistogram.h>
 #include <array>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -30,6 +34,10 @@
 
 /** Records timings for each memcached opcode. Each opcode has a histogram of
  * times.
+ *
+ * The histograms are sharded per core so that front-end threads recording
+ * command completions don't contend on the same cache lines; the shards
+ * are merged when the timings are read.
  */
 class Timings {
 public:
@@ -48,18 +56,78 @@ public:
     cb::sampling::Interval get_interval_lookup_latency();
 
     /**
-     * Get a pointer to the underlying histogram for the specified opcode
-     * @return a pointer to the underling HdrMicroSecHistogram for this opcode
-     * if there isn't one allocated already a nullptr will be returned.
+     * Get the histogram for the specified opcode, merged across all cores.
+     * @return a copy of the timings for this opcode, or nullptr if none have
+     * been recorded on any core yet.
      */
-    Hdr1sfMicroSecHistogram* get_timing_histogram(uint8_t opcode) const;
+    std::unique_ptr<Hdr1sfMicroSecHistogram> get_timing_histogram(
+            uint8_t opcode) const;
+
+    /// Record the duration of one phase (traced span) of a command.
+    void collectPhase(cb::tracing::TraceCode code,
+                      std::chrono::microseconds duration);
+
+    /**
+     * Get the histogram of the durations recorded for the specified phase,
+     * merged across all cores.
+     * @return a copy of the timings for this phase, or nullptr if none have
+     * been recorded yet.
+     */
+    std::unique_ptr<Hdr1sfMicroSecHistogram> get_phase_histogram(
+            cb::tracing::TraceCode code) const;
+
+    /// The allocations made by all of the commands of an opcode
+    struct AllocationStats {
+        uint64_t ops = 0;
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    /// Record the allocations made by one command (see
+    /// allocation_tracking_enabled).
+    void collectAllocations(cb::mcbp::ClientOpcode opcode,
+                            const AllocationCounter::Counts& counts);
+
+    /// @return the allocations recorded for opcode, summed across all cores
+    AllocationStats get_allocation_stats(cb::mcbp::ClientOpcode opcode) const;
 
 private:
+    /// One core's histograms, indexed by opcode. Zero-initialised, as
+    /// CoreStore may default-construct the shards.
+    struct HistogramShard {
+        std::atomic<Hdr1sfMicroSecHistogram*>& operator[](size_t opcode) {
+            return histograms[opcode];
+        }
+        const std::atomic<Hdr1sfMicroSecHistogram*>& operator[](
+                size_t opcode) const {
+            return histograms[opcode];
+        }
+
+        std::array<std::atomic<Hdr1sfMicroSecHistogram*>, MAX_NUM_OPCODES>
+                histograms{};
+    };
+
     /**
-     * Method to get histogram for timing, if the histogram hasn't been created
-     * yet, for the given opcode then we will allocate one
+     * Method to get the current core's histogram for timing, if the
+     * histogram hasn't been created yet, for the given opcode then we will
+     * allocate one
      */
-    Hdr1sfMicroSecHistogram& get_or_create_timing_histogram(uint8_t opcode);
+    Hdr1sfMicroSecHistogram& get_or_create_timing_histogram(uint8_t opcode) {
+        return get_or_create_histogram(timings, opcode);
+    }
+
+    /// Get (allocating if needed) the current core's histogram at index in
+    /// the given store.
+    Hdr1sfMicroSecHistogram& get_or_create_histogram(
+            CoreStore<HistogramShard>& store, uint8_t index);
+
+    /// @returns the histograms at index in store merged across all cores, or
+    /// nullptr if none exist.
+    static std::unique_ptr<Hdr1sfMicroSecHistogram> merge_histograms(
+            const CoreStore<HistogramShard>& store, uint8_t index);
+
+    /// @returns the total count of values recorded for opcode on all cores.
+    uint64_t get_value_count(cb::mcbp::ClientOpcode opcode) const;
 
     // This lock is only held by sample() and some blocks within generate().
     // It guards the various IntervalSeries variables which internally
@@ -68,12 +136,28 @@ private:
 
     cb::sampling::IntervalSeries interval_latency_lookups;
     cb::sampling::IntervalSeries interval_latency_mutations;
-    // create an array of unique_ptrs as we want to create HdrHistograms
+    // create arrays of pointers as we want to create HdrHistograms
     // in a lazy manner as their foot print is larger than our old
-    // histogram class
-    std::array<std::atomic<Hdr1sfMicroSecHistogram*>, MAX_NUM_OPCODES> timings;
+    // histogram class. Sharded by core like interval_counters; once a core
+    // has recorded an opcode, recording it again doesn't allocate or lock.
+    CoreStore<HistogramShard> timings;
+    // The duration of traced phases (spans) of commands, indexed by
+    // TraceCode. Only populated when phase timings are enabled.
+    CoreStore<HistogramShard> phase_timings;
     std::mutex histogram_mutex;
 
+    /// One core's allocation counters, indexed by opcode
+    struct AllocationShard {
+        struct Counters {
+            std::atomic<uint64_t> ops{0};
+            std::atomic<uint64_t> allocations{0};
+            std::atomic<uint64_t> bytes{0};
+        };
+        std::array<Counters, MAX_NUM_OPCODES> opcodes;
+    };
+    // Only updated when allocation tracking is enabled.
+    CoreStore<AllocationShard> allocation_counters;
+
     // Sharded by core as cache contention was observed due to the number of
     // threads attempting to update the same timings stats.
     CoreStore<std::array<cb::sampling::Interval, MAX_NUM_OPCODES>>
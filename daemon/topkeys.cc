@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <cstring>
 #include <gsl/gsl>
+#include <limits>
 #include <set>
 #include <stdexcept>
 
@@ -102,11 +103,40 @@
  * least-recently-used element is selected as a 'victim' and it's
  * contents is replaced by the incoming key.  Finally the linked-list
  * is updated to move the updated element to the head of the list.
+ *
+ * === Hot keys ===
+ *
+ * The LRU list says which keys were accessed recently, but not how
+ * often. To find the keys with the highest access frequency each Shard
+ * also counts every access in a count-min sketch: SketchDepth rows of
+ * SketchWidth counters, where each row maps the key (by its hash) to a
+ * different counter. The estimated count of a key is the lowest of its
+ * counters; it may overestimate (if other keys share all of the
+ * counters), but never underestimates. Every DecayInterval updates all of
+ * the counters are halved so the estimates follow the current workload.
+ *
+ * When the estimate of the accessed key is at least the lowest count in
+ * the Shard's (small) list of hot keys, the key is added to the list
+ * (replacing the key with the lowest count) or has its count updated.
+ * The stats call merges the hot keys of all of the shards, adding up the
+ * counts of the keys which are hot on multiple cores.
+ *
+ * === Sampling ===
+ *
+ * Every access takes the shard mutex and searches the shard, which adds
+ * up at high access rates. When topkeys_max_sample_interval is above 1
+ * each front end thread only tracks 1 of every N accesses, and counts
+ * the tracked access N times (so the counts stay unbiased estimates).
+ * The thread recalculates N every second from its access rate in the
+ * previous second, aiming for TargetSamplesPerSecond tracked accesses,
+ * so a lightly loaded thread still tracks every access.
  */
 TopKeys::TopKeys(int mkeys)
-    : keys_to_return(mkeys * legacy_multiplier), shards(cb::get_cpu_count()) {
+    : keys_to_return(mkeys * legacy_multiplier),
+      hot_keys_to_return(mkeys),
+      shards(cb::get_cpu_count()) {
     for (auto& shard : shards) {
-        shard->setMaxKeys(keys_to_return);
+        shard->setMaxKeys(keys_to_return, hot_keys_to_return);
     }
 }
 
@@ -117,8 +147,52 @@ void TopKeys::updateKey(const void* key,
                         size_t nkey,
                         rel_time_t operation_time) {
     if (Settings::instance().isTopkeysEnabled()) {
-        doUpdateKey(key, nkey, operation_time);
+        const auto count = sample(operation_time);
+        if (count != 0) {
+            doUpdateKey(key, nkey, operation_time, count);
+        }
+    }
+}
+
+uint32_t TopKeys::sample(rel_time_t operation_time) {
+    const auto max = Settings::instance().getTopkeysMaxSampleInterval();
+    if (max <= 1) {
+        return 1;
+    }
+
+    // The sampling state of the calling thread (shared by all buckets so
+    // the interval follows the total access rate of the thread)
+    struct Sampler {
+        uint32_t interval = 1;
+        uint32_t countdown = 1;
+        uint32_t accesses = 0;
+        rel_time_t second = 0;
+    };
+    static thread_local Sampler sampler;
+
+    ++sampler.accesses;
+    if (operation_time != sampler.second) {
+        // Pick the smallest interval (a power of two) which brings the
+        // number of tracked accesses down to the target rate
+        const uint32_t elapsed = operation_time > sampler.second
+                                         ? operation_time - sampler.second
+                                         : 1;
+        const uint32_t rate = sampler.accesses / elapsed;
+        uint32_t interval = 1;
+        while (interval < max && rate / interval > TargetSamplesPerSecond) {
+            interval <<= 1;
+        }
+        sampler.interval = uint32_t(std::min(size_t(interval), max));
+        sampler.countdown = std::min(sampler.countdown, sampler.interval);
+        sampler.accesses = 0;
+        sampler.second = operation_time;
     }
+
+    if (--sampler.countdown != 0) {
+        return 0;
+    }
+    sampler.countdown = sampler.interval;
+    return sampler.interval;
 }
 
 ENGINE_ERROR_CODE TopKeys::stats(const void* cookie,
@@ -140,6 +214,37 @@ ENGINE_ERROR_CODE TopKeys::json_stats(nlohmann::json& object,
     return ENGINE_SUCCESS;
 }
 
+ENGINE_ERROR_CODE TopKeys::hot_keys_json_stats(nlohmann::json& object) {
+    if (!Settings::instance().isTopkeysEnabled()) {
+        return ENGINE_SUCCESS;
+    }
+
+    std::unordered_map<std::string, uint32_t> map;
+    for (auto& shard : shards) {
+        shard->collectHotKeys(map);
+    }
+
+    std::vector<std::pair<std::string, uint32_t>> items(map.begin(),
+                                                        map.end());
+    std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) {
+        return a.second > b.second;
+    });
+    if (items.size() > hot_keys_to_return) {
+        items.resize(hot_keys_to_return);
+    }
+
+    nlohmann::json hotkeys = nlohmann::json::array();
+    for (const auto& item : items) {
+        nlohmann::json obj;
+        obj["key"] = item.first;
+        obj["count"] = item.second;
+        hotkeys.push_back(obj);
+    }
+    object["hotkeys"] = hotkeys;
+
+    return ENGINE_SUCCESS;
+}
+
 TopKeys::Shard& TopKeys::getShard() {
     auto stripe =
             folly::AccessSpreader<std::atomic>::cachedCurrent(shards.size());
@@ -163,7 +268,8 @@ TopKeys::topkey_t* TopKeys::Shard::searchForKey(
 
 bool TopKeys::Shard::updateKey(const cb::const_char_buffer& key,
                                size_t key_hash,
-                               const rel_time_t ct) {
+                               const rel_time_t ct,
+                               uint32_t count) {
     try {
         std::lock_guard<std::mutex> lock(mutex);
 
@@ -200,7 +306,9 @@ bool TopKeys::Shard::updateKey(const cb::const_char_buffer& key,
         }
 
         // Increment access count.
-        found_key->second.ti_access_count++;
+        found_key->second.ti_access_count += count;
+
+        updateHotKeys(key, key_hash, count);
         return true;
 
     } catch (const std::bad_alloc&) {
@@ -209,9 +317,80 @@ bool TopKeys::Shard::updateKey(const cb::const_char_buffer& key,
     }
 }
 
+void TopKeys::Shard::updateHotKeys(const cb::const_char_buffer& key,
+                                   size_t key_hash,
+                                   uint32_t count) {
+    // Derive the counter of each row from the key hash (double hashing)
+    const size_t step = (key_hash >> 32) | 1;
+    uint32_t estimate = std::numeric_limits<uint32_t>::max();
+    for (size_t row = 0; row < SketchDepth; ++row) {
+        auto& counter = sketch[row][(key_hash + row * step) % SketchWidth];
+        counter = uint16_t(std::min(uint32_t(counter) + count,
+                                    uint32_t(UINT16_MAX)));
+        estimate = std::min(estimate, uint32_t(counter));
+    }
+
+    if (max_hot != 0 && estimate >= hot_min) {
+        auto it = std::find_if(hot.begin(), hot.end(), [&](const auto& e) {
+            return e.first.hash == key_hash && e.first.key.size() == key.len &&
+                   std::memcmp(e.first.key.data(), key.buf, key.len) == 0;
+        });
+        if (it != hot.end()) {
+            it->second = estimate;
+        } else if (hot.size() < max_hot) {
+            hot.emplace_back(KeyId{key_hash, std::string(key.buf, key.len)},
+                             estimate);
+        } else {
+            auto victim = std::min_element(
+                    hot.begin(), hot.end(), [](const auto& a, const auto& b) {
+                        return a.second < b.second;
+                    });
+            victim->first.hash = key_hash;
+            victim->first.key.assign(key.buf, key.len);
+            victim->second = estimate;
+        }
+
+        if (hot.size() == max_hot) {
+            hot_min = std::min_element(hot.begin(),
+                                       hot.end(),
+                                       [](const auto& a, const auto& b) {
+                                           return a.second < b.second;
+                                       })
+                              ->second;
+        }
+    }
+
+    updates += count;
+    if (updates >= DecayInterval) {
+        decay();
+    }
+}
+
+void TopKeys::Shard::decay() {
+    for (auto& row : sketch) {
+        for (auto& counter : row) {
+            counter >>= 1;
+        }
+    }
+    for (auto& entry : hot) {
+        entry.second >>= 1;
+    }
+    hot_min >>= 1;
+    updates = 0;
+}
+
+void TopKeys::Shard::collectHotKeys(
+        std::unordered_map<std::string, uint32_t>& map) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& entry : hot) {
+        map[entry.first.key] += entry.second;
+    }
+}
+
 void TopKeys::doUpdateKey(const void* key,
                           size_t nkey,
-                          rel_time_t operation_time) {
+                          rel_time_t operation_time,
+                          uint32_t count) {
     if (key == nullptr || nkey == 0) {
         throw std::invalid_argument(
                 "TopKeys::doUpdateKey: key must be specified");
@@ -224,7 +403,7 @@ void TopKeys::doUpdateKey(const void* key,
         std::hash<cb::const_char_buffer> hash_fn;
         const size_t key_hash = hash_fn(key_buf);
 
-        getShard().updateKey(key_buf, key_hash, operation_time);
+        getShard().updateKey(key_buf, key_hash, operation_time, count);
     } catch (const std::bad_alloc&) {
         // Failed to increment topkeys, continue...
     }
@@ -34,6 +34,10 @@ struct tk_context;
  * Tracks the top N most recently accessed keys. The details are
  * accessible by a stats call, which is used by ns_server to print the
  * top keys list in the GUI.
+ *
+ * In addition TopKeys estimates the access frequency of every key with a
+ * (decaying) count-min sketch, and keeps a list of the keys with the
+ * highest frequency (the hot keys).
  */
 
 struct topkey_item_t {
@@ -91,8 +95,48 @@ public:
     ENGINE_ERROR_CODE json_stats(nlohmann::json& object,
                                  rel_time_t current_time);
 
+    /**
+     * Populate the object with the keys with the highest estimated access
+     * frequency (the counts are halved every DecayInterval accesses, so
+     * they reflect the recent accesses):
+     * {
+     *   "hotkeys": [
+     *      {
+     *          "key": "somekey",
+     *          "count": nnn
+     *      }, ..., { ... }
+     *    ]
+     * }
+     */
+    ENGINE_ERROR_CODE hot_keys_json_stats(nlohmann::json& object);
+
+    /// The number of counters in each row of the count-min sketch
+    static const size_t SketchWidth = 512;
+    /// The number of rows (hash functions) of the count-min sketch
+    static const size_t SketchDepth = 4;
+    /// The number of accesses (per shard) between each halving of the
+    /// access counts
+    static const size_t DecayInterval = 16384;
+
+    /// The number of accesses per second each front end thread tries to
+    /// track when sampling is enabled (topkeys_max_sample_interval > 1)
+    static const uint32_t TargetSamplesPerSecond = 10000;
+
 protected:
-    void doUpdateKey(const void* key, size_t nkey, rel_time_t operation_time);
+    /**
+     * Decide if the calling thread should track the current access (see
+     * topkeys_max_sample_interval)
+     *
+     * @param operation_time the time of the access
+     * @return the number of accesses the access represents, or 0 if it
+     *         shouldn't be tracked
+     */
+    static uint32_t sample(rel_time_t operation_time);
+
+    void doUpdateKey(const void* key,
+                     size_t nkey,
+                     rel_time_t operation_time,
+                     uint32_t count);
 
     void doStatsInner(const tk_context& stat_context);
     ENGINE_ERROR_CODE doStats(const void* cookie,
@@ -115,6 +159,12 @@ private:
      */
     const size_t keys_to_return;
 
+    /**
+     * The number of hot keys tracked by each shard (and returned via
+     * stats)
+     */
+    const size_t hot_keys_to_return;
+
     class Shard;
 
     Shard& getShard();
@@ -124,14 +174,17 @@ private:
     // Responsible for tracking the top {mkeys} within it's keyspace.
     class Shard {
     public:
-        void setMaxKeys(size_t mkeys) {
+        void setMaxKeys(size_t mkeys, size_t mhot) {
             max_keys = mkeys;
             storage.reserve(max_keys);
             // reallocating storage invalidates the LRU list.
             list.clear();
+            max_hot = mhot;
+            hot.reserve(max_hot);
         }
 
-        // Updates the topkey 'ranking' for the specified key.
+        // Updates the topkey 'ranking' for the specified key (count is the
+        // number of accesses to add).
         // If the item does not exist it will be created (with it's creation
         // time set to operation_time), otherwise the existing item will be
         // updated.
@@ -139,7 +192,8 @@ private:
         // new item, returns false.
         bool updateKey(const cb::const_char_buffer& key,
                        size_t key_hash,
-                       rel_time_t operation_time);
+                       rel_time_t operation_time,
+                       uint32_t count);
 
         typedef void (*iterfunc_t)(const topkey_t& it, void* arg);
 
@@ -147,7 +201,21 @@ private:
          */
         void accept_visitor(iterfunc_t visitor_func, void* visitor_ctx);
 
+        /// Add the hot keys of the shard (and their counts) to the map
+        void collectHotKeys(std::unordered_map<std::string, uint32_t>& map);
+
     private:
+        /**
+         * Count the access in the sketch, and update the hot keys if the
+         * key's estimated count is now among the highest
+         */
+        void updateHotKeys(const cb::const_char_buffer& key,
+                           size_t key_hash,
+                           uint32_t count);
+
+        /// Halve all of the sketch and hot key counts
+        void decay();
+
         // An ordered list of topkey_t*, used for LRU.
         typedef std::list<topkey_t*> key_history_t;
 
@@ -168,6 +236,23 @@ private:
         // Underlying topkey storage.
         key_storage_t storage;
 
+        // The count-min sketch. The counters are halved every
+        // DecayInterval accesses so they rarely get near the max value
+        // (but saturate if a sampled access is counted many times)
+        std::array<std::array<uint16_t, SketchWidth>, SketchDepth> sketch{};
+
+        // Accesses since the last decay
+        size_t updates = 0;
+
+        // Maximum number of hot keys to track
+        size_t max_hot = 0;
+
+        // The keys with the highest estimated counts (unordered)
+        std::vector<std::pair<KeyId, uint32_t>> hot;
+
+        // The lowest count in hot (0 until it's full)
+        uint32_t hot_min = 0;
+
         // Mutex to serialize access to this shard.
         std::mutex mutex;
     };
@@ -20,12 +20,16 @@
 #include "cookie.h"
 #include "executorpool.h"
 #include "memcached.h"
+#include "settings.h"
 #include "task.h"
 #include "tracing_types.h"
 
 #include <daemon/protocol/mcbp/command_context.h>
+#include <logger/logger.h>
 
+#include <atomic>
 #include <chrono>
+#include <cstdio>
 #include <memory>
 #include <mutex>
 
@@ -100,6 +104,95 @@ void initializeTracing() {
     }
 }
 
+/**
+ * A task taking the trace recorded so far (restarting tracing straight
+ * away), and writing it to a file. Runs on an executor as the export is
+ * far too slow for a front-end thread.
+ */
+class TraceAutoDumpTask : public Task {
+public:
+    explicit TraceAutoDumpTask(std::string path) : path(std::move(path)) {
+    }
+
+    Status execute() override {
+        // Copied first; ioctlSetTracingStart locks the config before the
+        // TraceLog.
+        phosphor::TraceConfig config = [] {
+            std::lock_guard<std::mutex> lh(configMutex);
+            return lastConfig;
+        }();
+
+        std::unique_ptr<DumpContext> dump;
+        {
+            std::lock_guard<phosphor::TraceLog> lh(PHOSPHOR_INSTANCE);
+            if (!PHOSPHOR_INSTANCE.isEnabled()) {
+                // Stopped (to be dumped by hand) since the dump was
+                // requested; leave that trace alone.
+                return Status::Finished;
+            }
+            PHOSPHOR_INSTANCE.stop(lh);
+            dump = std::make_unique<DumpContext>(
+                    PHOSPHOR_INSTANCE.getTraceContext(lh));
+            PHOSPHOR_INSTANCE.start(lh, config);
+        }
+
+        std::unique_ptr<FILE, decltype(&fclose)> fp(fopen(path.c_str(), "w"),
+                                                     &fclose);
+        if (!fp) {
+            LOG_WARNING("Failed to open {} to dump the trace", path);
+            return Status::Finished;
+        }
+
+        std::string chunk(1024 * 1024, '\0');
+        while (!dump->json_export.done()) {
+            const auto count = dump->json_export.read(&chunk[0], chunk.size());
+            if (fwrite(chunk.data(), 1, count, fp.get()) != count) {
+                LOG_WARNING("Failed to write the trace to {}", path);
+                return Status::Finished;
+            }
+        }
+        LOG_INFO("Dumped the trace preceding a slow operation to {}", path);
+        return Status::Finished;
+    }
+
+    void notifyExecutionComplete() override {
+    }
+
+private:
+    const std::string path;
+};
+
+/// When the trace was last dumped automatically
+static std::atomic<std::chrono::steady_clock::time_point> lastAutoDump;
+
+void dumpTraceOnSlowOperation() {
+    const auto dir = Settings::instance().getTracingAutoDumpDir();
+    if (dir.empty()) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::seconds interval{
+            Settings::instance().getTracingAutoDumpInterval()};
+    auto last = lastAutoDump.load();
+    if (last != std::chrono::steady_clock::time_point{} &&
+        now < last + interval) {
+        return;
+    }
+    // Only one of the threads seeing slow operations at once dumps.
+    if (!lastAutoDump.compare_exchange_strong(last, now)) {
+        return;
+    }
+
+    const auto stamp = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+    std::shared_ptr<Task> task = std::make_shared<TraceAutoDumpTask>(
+            dir + "/memcached_trace." + std::to_string(stamp.count()) +
+            ".json");
+    std::lock_guard<std::mutex> guard(task->getMutex());
+    executorPool->schedule(task, true);
+}
+
 void deinitializeTracing() {
     dump_remover.reset();
     phosphor::TraceLog::getInstance().stop();
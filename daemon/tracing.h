@@ -41,6 +41,15 @@ void initializeTracing();
  */
 void deinitializeTracing();
 
+/**
+ * Notify tracing that a slow operation was detected. If enabled (see the
+ * "tracing_auto_dump_dir" setting) and no dump was written within the last
+ * "tracing_auto_dump_interval" seconds, the trace recorded so far is written
+ * to a file in the background (in the same JSON format as kv_trace_dump),
+ * and tracing restarts with the same config.
+ */
+void dumpTraceOnSlowOperation();
+
 /**
  * IOCTL Get callback to get the tracing status
  * @param[out] value Either "enabled" or "disabled" depending on status
@@ -0,0 +1,111 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "traffic_capture.h"
+
+#include "connection.h"
+#include "cookie.h"
+
+#include <folly/Synchronized.h>
+#include <logger/logger.h>
+#include <mcbp/protocol/header.h>
+#include <mcbp/protocol/request.h>
+#include <nlohmann/json.hpp>
+#include <utilities/traffic_capture.h>
+
+#include <memory>
+#include <stdexcept>
+
+std::atomic_bool trafficCaptureActive{false};
+
+namespace {
+struct Capture {
+    std::unique_ptr<cb::capture::Writer> writer;
+    size_t samplePercent = 0;
+};
+} // namespace
+
+static folly::Synchronized<Capture> capture;
+
+void startTrafficCapture(const std::string& path,
+                         size_t samplePercent,
+                         size_t maxSize) {
+    if (samplePercent == 0 || samplePercent > 100) {
+        throw std::invalid_argument(
+                "startTrafficCapture: samplePercent must be in the range "
+                "1-100");
+    }
+    auto writer = std::make_unique<cb::capture::Writer>(path, maxSize);
+    auto locked = capture.wlock();
+    locked->writer = std::move(writer);
+    locked->samplePercent = samplePercent;
+    trafficCaptureActive = true;
+    LOG_INFO("Capturing the requests of {}% of the connections to {}",
+             samplePercent,
+             path);
+}
+
+void stopTrafficCapture() {
+    auto locked = capture.wlock();
+    trafficCaptureActive = false;
+    if (locked->writer) {
+        LOG_INFO("Stopped capturing requests to {}: {} requests captured",
+                 locked->writer->getPath(),
+                 locked->writer->getRecords());
+        locked->writer.reset();
+    }
+}
+
+nlohmann::json getTrafficCaptureStatus() {
+    auto locked = capture.rlock();
+    nlohmann::json ret;
+    ret["active"] = locked->writer != nullptr;
+    if (locked->writer) {
+        ret["path"] = locked->writer->getPath();
+        ret["sample_percent"] = locked->samplePercent;
+        ret["records"] = locked->writer->getRecords();
+        ret["size"] = locked->writer->getSize();
+        ret["full"] = locked->writer->isFull();
+    }
+    return ret;
+}
+
+void doCaptureRequest(Cookie& cookie) {
+    auto& connection = cookie.getConnection();
+    if (connection.isDCP()) {
+        // The DCP streams can't be replayed
+        return;
+    }
+    const auto& header = cookie.getHeader();
+    if (!header.isRequest()) {
+        return;
+    }
+    switch (header.getRequest().getClientOpcode()) {
+    case cb::mcbp::ClientOpcode::SaslAuth:
+    case cb::mcbp::ClientOpcode::SaslStep:
+        // Never store credentials
+        return;
+    default:
+        break;
+    }
+
+    auto locked = capture.rlock();
+    if (!locked->writer ||
+        (connection.getId() % 100) >= locked->samplePercent) {
+        return;
+    }
+    locked->writer->write(connection.getId(), cookie.getPacket());
+}
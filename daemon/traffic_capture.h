@@ -0,0 +1,70 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <nlohmann/json_fwd.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+class Cookie;
+
+/*
+ * Capture of the request frames received from a sample of the client
+ * connections to a file (see utilities/traffic_capture.h for the format),
+ * so production-shaped traffic can be replayed against a test node with
+ * mcreplay.
+ *
+ * The capture is controlled through ioctl_set (capture.start /
+ * capture.stop) and its status is available through ioctl_get
+ * (capture.status). SASL authentication requests are never captured.
+ */
+
+/**
+ * Start capturing (replacing any capture in progress).
+ *
+ * @param path the file to write the capture to
+ * @param samplePercent percentage of the connections to capture (1-100)
+ * @param maxSize the maximum size of the capture file in bytes
+ * @throws std::invalid_argument if samplePercent is out of range
+ * @throws std::system_error if the file cannot be created
+ */
+void startTrafficCapture(const std::string& path,
+                         size_t samplePercent,
+                         size_t maxSize);
+
+/// Stop the capture in progress (if any)
+void stopTrafficCapture();
+
+/// @return the status of the capture as JSON
+nlohmann::json getTrafficCaptureStatus();
+
+/// Set while a capture is in progress
+extern std::atomic_bool trafficCaptureActive;
+
+void doCaptureRequest(Cookie& cookie);
+
+/**
+ * Record the (validated) request of the cookie if a capture is in progress
+ * and the connection is one of those sampled
+ */
+inline void maybeCaptureRequest(Cookie& cookie) {
+    if (trafficCaptureActive.load(std::memory_order_relaxed)) {
+        doCaptureRequest(cookie);
+    }
+}
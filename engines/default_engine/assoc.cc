@@ -16,6 +16,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <mutex>
 #include <thread>
@@ -25,6 +27,15 @@
 #define hashsize(n) ((size_t)1<<(n))
 #define hashmask(n) (hashsize(n)-1)
 
+/*
+ * The hashtable is protected by a set of lock stripes, selected by the low
+ * bits of an item's hash. Expanding the table only adds higher bits to the
+ * bucket index, so an old bucket and every new bucket its items move to
+ * share a stripe, so migrating a bucket needs only that stripe. Must not
+ * exceed hashsize(initial hashpower - 1).
+ */
+#define ASSOC_LOCK_STRIPES 1024
+
 struct Assoc {
     Assoc(unsigned int hp) : hashpower(hp) {
         primary_hashtable.resize(hashsize(hashpower));
@@ -44,26 +55,46 @@ struct Assoc {
     std::vector<hash_item*> old_hashtable;
 
     /* Number of items in the hash table. */
-    unsigned int hash_items{0};
+    std::atomic<unsigned int> hash_items{0};
 
-    /* Flag: Are we in the middle of expanding now? */
-    bool expanding{false};
+    /*
+     * Flag: Are we in the middle of expanding now? Only changed with all
+     * stripes held.
+     */
+    std::atomic<bool> expanding{false};
 
     /*
      * During expansion we migrate values with bucket granularity; this is how
      * far we've gotten so far. Ranges from 0 .. hashsize(hashpower - 1) - 1.
+     * Advanced with the stripe of the bucket being migrated held, so a
+     * reader's comparison against its own bucket is stable.
      */
-    unsigned int expand_bucket{0};
+    std::atomic<unsigned int> expand_bucket{0};
 
     /*
-     * serialise access to the hashtable
+     * serialise access to the buckets in each stripe. hashpower and the
+     * tables themselves are only resized with all stripes held.
      */
-    std::mutex mutex;
+    std::array<std::mutex, ASSOC_LOCK_STRIPES> locks;
 };
 
 /* One hashtable for all */
 static struct Assoc* global_assoc = nullptr;
 
+static std::mutex& assoc_lock(uint32_t hash) {
+    return global_assoc->locks[hash & (ASSOC_LOCK_STRIPES - 1)];
+}
+
+/* Lock every stripe, for changes to the layout of the hashtable */
+static std::vector<std::unique_lock<std::mutex>> assoc_lock_all() {
+    std::vector<std::unique_lock<std::mutex>> guards;
+    guards.reserve(ASSOC_LOCK_STRIPES);
+    for (auto& lock : global_assoc->locks) {
+        guards.emplace_back(lock);
+    }
+    return guards;
+}
+
 /* assoc factory. returns one new assoc or NULL if out-of-memory */
 static struct Assoc* assoc_consruct(int hashpower) {
     try {
@@ -98,7 +129,7 @@ hash_item *assoc_find(uint32_t hash, const hash_key *key) {
     unsigned int oldbucket;
     hash_item *ret = NULL;
     int depth = 0;
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
+    std::lock_guard<std::mutex> guard(assoc_lock(hash));
     if (global_assoc->expanding &&
         (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
     {
@@ -125,7 +156,7 @@ hash_item *assoc_find(uint32_t hash, const hash_key *key) {
 /*
     returns the address of the item pointer before the key.  if *item == 0,
     the item wasn't found
-    assoc->lock is assumed to be held by the caller.
+    the stripe for hash is assumed to be held by the caller.
 */
 static hash_item** _hashitem_before(uint32_t hash, const hash_key* key) {
     hash_item **pos;
@@ -158,7 +189,7 @@ static void assoc_maintenance_thread(void *arg);
 
 /*
     grows the hashtable to the next power of 2.
-    assoc->lock is assumed to be held by the caller.
+    all stripes are assumed to be held by the caller.
 */
 static void assoc_expand() {
     global_assoc->old_hashtable.swap(global_assoc->primary_hashtable);
@@ -198,26 +229,37 @@ int assoc_insert(uint32_t hash, hash_item *it) {
 
     cb_assert(assoc_find(hash, item_get_key(it)) == 0);  /* shouldn't have duplicately named things defined */
 
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    if (global_assoc->expanding &&
-        (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
+    bool expand;
     {
-        it->h_next = global_assoc->old_hashtable[oldbucket];
-        global_assoc->old_hashtable[oldbucket] = it;
-    } else {
-        it->h_next = global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
-        global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)] = it;
+        std::lock_guard<std::mutex> guard(assoc_lock(hash));
+        if (global_assoc->expanding &&
+            (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
+        {
+            it->h_next = global_assoc->old_hashtable[oldbucket];
+            global_assoc->old_hashtable[oldbucket] = it;
+        } else {
+            it->h_next = global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
+            global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)] = it;
+        }
+
+        global_assoc->hash_items++;
+        expand = !global_assoc->expanding &&
+                 global_assoc->hash_items >
+                         (hashsize(global_assoc->hashpower) * 3) / 2;
     }
 
-    global_assoc->hash_items++;
-    if (! global_assoc->expanding && global_assoc->hash_items > (hashsize(global_assoc->hashpower) * 3) / 2) {
-        assoc_expand();
+    if (expand) {
+        /* Another insert may have beaten us to it; check again */
+        auto guards = assoc_lock_all();
+        if (! global_assoc->expanding && global_assoc->hash_items > (hashsize(global_assoc->hashpower) * 3) / 2) {
+            assoc_expand();
+        }
     }
     return 1;
 }
 
 void assoc_delete(uint32_t hash, const hash_key *key) {
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
+    std::lock_guard<std::mutex> guard(assoc_lock(hash));
     hash_item **before = _hashitem_before(hash, key);
 
     if (*before) {
@@ -242,39 +284,41 @@ static void assoc_maintenance_thread(void *arg) {
     bool done = false;
     do {
         int ii;
-        std::lock_guard<std::mutex> guard(global_assoc->mutex);
 
-        for (ii = 0; ii < hash_bulk_move && global_assoc->expanding; ++ii) {
+        for (ii = 0; ii < hash_bulk_move && !done; ++ii) {
             hash_item *it, *next;
             int bucket;
-
-            for (it = global_assoc->old_hashtable[global_assoc->expand_bucket];
-                 NULL != it; it = next) {
-                next = it->h_next;
-                const hash_key* key = item_get_key(it);
-                bucket = crc32c(hash_key_get_key(key),
-                                hash_key_get_key_len(key),
-                                0) & hashmask(global_assoc->hashpower);
-                it->h_next = global_assoc->primary_hashtable[bucket];
-                global_assoc->primary_hashtable[bucket] = it;
+            const unsigned int expand_bucket = global_assoc->expand_bucket;
+
+            {
+                std::lock_guard<std::mutex> guard(assoc_lock(expand_bucket));
+                for (it = global_assoc->old_hashtable[expand_bucket];
+                     NULL != it; it = next) {
+                    next = it->h_next;
+                    const hash_key* key = item_get_key(it);
+                    bucket = crc32c(hash_key_get_key(key),
+                                    hash_key_get_key_len(key),
+                                    0) & hashmask(global_assoc->hashpower);
+                    it->h_next = global_assoc->primary_hashtable[bucket];
+                    global_assoc->primary_hashtable[bucket] = it;
+                }
+
+                global_assoc->old_hashtable[expand_bucket] = NULL;
+                global_assoc->expand_bucket++;
             }
 
-            global_assoc->old_hashtable[global_assoc->expand_bucket] = NULL;
-            global_assoc->expand_bucket++;
-            if (global_assoc->expand_bucket == hashsize(global_assoc->hashpower - 1)) {
+            if (expand_bucket + 1 == hashsize(global_assoc->hashpower - 1)) {
+                auto guards = assoc_lock_all();
                 global_assoc->expanding = false;
                 global_assoc->old_hashtable.resize(0);
                 global_assoc->old_hashtable.shrink_to_fit();
                 LOG_INFO("Hash table expansion done");
+                done = true;
             }
         }
-        if (!global_assoc->expanding) {
-            done = true;
-        }
     } while (!done);
 }
 
 bool assoc_expanding() {
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
     return global_assoc->expanding;
 }
@@ -78,6 +78,9 @@ void default_engine_constructor(struct default_engine* engine, bucket_id_t id)
     engine->config.factor = 1.25;
     engine->config.chunk_size = 48;
     engine->config.item_size_max= 1024 * 1024;
+    engine->config.slab_automove = true;
+    engine->config.scrub_threads = 1;
+    engine->config.scrub_chunk_size = 200;
     engine->config.xattr_enabled = true;
     engine->config.compression_mode = BucketCompressionMode::Off;
     engine->config.min_compression_ratio = default_min_compression_ratio;
@@ -132,6 +135,11 @@ ENGINE_ERROR_CODE default_engine::initialize(const char* config_str) {
         return ret;
     }
 
+    ret = item_lru_maintainer_start(this);
+    if (ret != ENGINE_SUCCESS) {
+        return ret;
+    }
+
     return ENGINE_SUCCESS;
 }
 
@@ -141,6 +149,9 @@ void default_engine::destroy(const bool force) {
 
 void destroy_engine_instance(struct default_engine* engine) {
     if (engine->initialized) {
+        /* The scrubber normally stopped it already */
+        item_lru_maintainer_stop(engine);
+
         /* Destory the slabs cache */
         slabs_destroy(engine);
 
@@ -508,10 +519,22 @@ ENGINE_ERROR_CODE default_engine::get_stats(gsl::not_null<const void*> cookie,
                 add_stat("scrubber:last_run", 17, val, len, cookie);
             }
 
-            len = sprintf(val, "%" PRIu64, scrubber.visited);
+            len = sprintf(val, "%" PRIu64, scrubber.visited.load());
             add_stat("scrubber:visited", 16, val, len, cookie);
-            len = sprintf(val, "%" PRIu64, scrubber.cleaned);
+            len = sprintf(val, "%" PRIu64, scrubber.cleaned.load());
             add_stat("scrubber:cleaned", 16, val, len, cookie);
+
+            const uint64_t chunks = scrubber.chunks;
+            len = sprintf(val, "%" PRIu64, chunks);
+            add_stat("scrubber:chunks", 15, val, len, cookie);
+            if (chunks != 0) {
+                len = sprintf(val,
+                              "%" PRIu64,
+                              scrubber.chunk_total_usec.load() / chunks);
+                add_stat("scrubber:chunk_avg_usec", 23, val, len, cookie);
+                len = sprintf(val, "%" PRIu64, scrubber.chunk_max_usec.load());
+                add_stat("scrubber:chunk_max_usec", 23, val, len, cookie);
+            }
         }
     } else {
         ret = ENGINE_KEY_ENOENT;
@@ -614,7 +637,7 @@ static ENGINE_ERROR_CODE initalize_configuration(struct default_engine *se,
    se->config.vb0 = true;
 
    if (cfg_str != NULL) {
-       struct config_item items[13];
+       struct config_item items[16];
        int ii = 0;
 
        memset(&items, 0, sizeof(items));
@@ -677,9 +700,24 @@ static ENGINE_ERROR_CODE initalize_configuration(struct default_engine *se,
        items[ii].value.dt_bool = &se->config.keep_deleted;
        ++ii;
 
+       items[ii].key = "slab_automove";
+       items[ii].datatype = DT_BOOL;
+       items[ii].value.dt_bool = &se->config.slab_automove;
+       ++ii;
+
+       items[ii].key = "scrub_threads";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.scrub_threads;
+       ++ii;
+
+       items[ii].key = "scrub_chunk_size";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.scrub_chunk_size;
+       ++ii;
+
        items[ii].key = NULL;
        ++ii;
-       cb_assert(ii == 13);
+       cb_assert(ii == 16);
        ret = ENGINE_ERROR_CODE(se->server.core->parse_config(cfg_str,
                                                              items,
                                                              stderr));
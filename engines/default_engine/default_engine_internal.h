@@ -37,9 +37,12 @@ struct default_engine;
 /** The item is deleted (may only be accessed if explicitly asked for) */
 #define ITEM_ZOMBIE (4)
 
+/** The item has been read since the LRU maintainer last looked at it */
+#define ITEM_ACTIVE (8)
+
 struct config {
    size_t verbose;
-   rel_time_t oldest_live;
+   std::atomic<rel_time_t> oldest_live;
    bool evict_to_free;
    size_t maxbytes;
    bool preallocate;
@@ -50,6 +53,9 @@ struct config {
    bool vb0;
    char *uuid;
    bool keep_deleted;
+   bool slab_automove;
+   size_t scrub_threads;
+   size_t scrub_chunk_size;
    std::atomic<bool> xattr_enabled;
    std::atomic<BucketCompressionMode> compression_mode;
    std::atomic<float> min_compression_ratio;
@@ -68,8 +74,12 @@ struct engine_stats {
 
 struct engine_scrubber {
     std::mutex lock;
-    uint64_t visited;
-    uint64_t cleaned;
+    std::atomic<uint64_t> visited;
+    std::atomic<uint64_t> cleaned;
+    /* The chunks of items scrubbed at a time, and how long they took */
+    std::atomic<uint64_t> chunks;
+    std::atomic<uint64_t> chunk_total_usec;
+    std::atomic<uint64_t> chunk_max_usec;
     time_t started;
     time_t stopped;
     bool running;
@@ -7,6 +7,11 @@
 #include <string.h>
 #include <time.h>
 #include <gsl/gsl>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <thread>
+#include <vector>
 
 #include "default_engine_internal.h"
 #include "engine_manager.h"
@@ -20,19 +25,25 @@
 /* Forward Declarations */
 static void item_link_q(struct default_engine *engine, hash_item *it);
 static void item_unlink_q(struct default_engine *engine, hash_item *it);
+static void item_move_q(struct default_engine* engine,
+                        hash_item* it,
+                        lru_segment seg);
 static hash_item *do_item_alloc(struct default_engine *engine,
                                 const hash_key *key,
                                 const int flags, const rel_time_t exptime,
                                 const int nbytes,
                                 const void *cookie,
-                                uint8_t datatype);
+                                uint8_t datatype,
+                                const std::mutex* held_stripe);
 static hash_item* do_item_get(struct default_engine* engine,
                               const hash_key* key,
                               const DocStateFilter document_state);
 static int do_item_link(struct default_engine *engine,
                         const void* cookie,
                         hash_item *it);
-static void do_item_unlink(struct default_engine *engine, hash_item *it);
+static void do_item_unlink(struct default_engine* engine,
+                           hash_item* it,
+                           bool lru_locked = false);
 static ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine *engine,
                                              hash_item *it);
 static void do_item_release(struct default_engine *engine, hash_item *it);
@@ -53,11 +64,34 @@ static void hash_key_destroy(hash_key* hkey);
 static void hash_key_copy_to_item(hash_item* dst, const hash_key* src);
 
 /*
- * We only reposition items in the LRU queue if they haven't been repositioned
- * in this many seconds. That saves us from churning on frequently-accessed
- * items.
+ * Share of the items of a slab class the HOT and WARM segments may hold
+ * before the LRU maintainer moves their tail down.
  */
-#define ITEM_UPDATE_INTERVAL 60
+#define LRU_HOT_PERCENT 20
+#define LRU_WARM_PERCENT 40
+
+/* Max number of items the LRU maintainer moves per slab class per run */
+#define LRU_MAINTAINER_BATCH 500
+
+/* Bounds of the LRU maintainer's sleep between runs */
+static const std::chrono::microseconds lru_maintainer_min_sleep{1000};
+static const std::chrono::microseconds lru_maintainer_max_sleep{100000};
+
+/*
+ * The slab automover looks at the evictions every SLAB_AUTOMOVE_WINDOW
+ * seconds, and moves a page once the same class was starved for
+ * SLAB_AUTOMOVE_WINDOWS windows. The class giving up the page must have
+ * been idle for as long, and its oldest item must be at least
+ * SLAB_AUTOMOVE_AGE_RATIO times older than the items the starved class
+ * evicted.
+ */
+#define SLAB_AUTOMOVE_WINDOW 10
+#define SLAB_AUTOMOVE_WINDOWS 3
+#define SLAB_AUTOMOVE_AGE_RATIO 2
+
+/* The order we look for an item to reclaim or evict in the LRU segments */
+static const lru_segment eviction_order[] = {COLD_LRU, WARM_LRU, HOT_LRU};
+
 /*
  * To avoid scanning through the complete cache in some circumstances we'll
  * just give up and return an error after inspecting a fixed number of objects.
@@ -65,8 +99,44 @@ static void hash_key_copy_to_item(hash_item* dst, const hash_key* src);
 static const int search_items = 50;
 
 void item_stats_reset(struct default_engine *engine) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
-    memset(engine->items.itemstats, 0, sizeof(engine->items.itemstats));
+    for (int ii = 0; ii < POWER_LARGEST; ++ii) {
+        std::lock_guard<std::mutex> guard(engine->items.lru_locks[ii]);
+        memset(&engine->items.itemstats[ii], 0, sizeof(itemstats_t));
+    }
+}
+
+static uint32_t hash_key_hash(const hash_key* key) {
+    return crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0);
+}
+
+/* Get the lock stripe serialising access to the items with the given key */
+static std::mutex& item_lock(struct default_engine* engine,
+                             const hash_key* key) {
+    return engine->items.stripes[hash_key_hash(key) % ITEM_LOCK_STRIPES];
+}
+
+/*
+ * Try to lock the stripe of an item found by walking an LRU (whose lru_lock
+ * is held by the caller, so we may not block on the stripe). If held_stripe
+ * is the item's stripe the caller already owns it and lock is left empty.
+ * Returns true if the caller may now modify the item; cursors are never
+ * returned.
+ */
+static bool try_lock_item(struct default_engine* engine,
+                          const hash_item* it,
+                          const std::mutex* held_stripe,
+                          std::unique_lock<std::mutex>& lock) {
+    const hash_key* key = item_get_key(it);
+    if (key->header.len == 0 && it->nbytes == 0) {
+        /* scrubber cursor */
+        return false;
+    }
+    auto& stripe = item_lock(engine, key);
+    if (&stripe == held_stripe) {
+        return true;
+    }
+    lock = std::unique_lock<std::mutex>(stripe, std::try_to_lock);
+    return lock.owns_lock();
 }
 
 
@@ -79,7 +149,7 @@ static size_t ITEM_ntotal(struct default_engine *engine,
 
 /* Get the next CAS id for a new item. */
 static uint64_t get_cas_id(void) {
-    static uint64_t cas_id = 0;
+    static std::atomic<uint64_t> cas_id{0};
     return ++cas_id;
 }
 
@@ -94,6 +164,46 @@ static uint64_t get_cas_id(void) {
 # define DEBUG_REFCNT(it,op) while(0)
 #endif
 
+/*
+ * Evict (or reclaim, if it has expired) an item from the tail of a slab
+ * class' LRU, looking in COLD before WARM and HOT. We don't necessarily
+ * unlink the tail as it may be in use (refcount > 0); search up from the
+ * tails for an unused item and give up after search_items tries.
+ * The caller must hold the lru_lock of the class.
+ * Returns true if an item was unlinked.
+ */
+static bool lru_evict(struct default_engine* engine,
+                      unsigned int id,
+                      rel_time_t current_time,
+                      const std::mutex* held_stripe) {
+    int tries = search_items;
+    for (auto seg : eviction_order) {
+        for (auto* search = engine->items.tails[id][seg];
+             tries > 0 && search != NULL;
+             tries--, search = search->prev) {
+            std::unique_lock<std::mutex> search_lock;
+            if (!try_lock_item(engine, search, held_stripe, search_lock)) {
+                continue;
+            }
+            if (search->refcount == 0 && search->locktime <= current_time) {
+                if (search->exptime == 0 || search->exptime > current_time) {
+                    engine->items.itemstats[id].evicted++;
+                    engine->items.itemstats[id].evicted_time = current_time - search->time;
+                    if (search->exptime != 0) {
+                        engine->items.itemstats[id].evicted_nonzero++;
+                    }
+                    engine->stats.evictions++;
+                } else {
+                    engine->items.itemstats[id].reclaimed++;
+                    engine->stats.reclaimed++;
+                }
+                do_item_unlink(engine, search, true);
+                return true;
+            }
+        }
+    }
+    return false;
+}
 
 /*@null@*/
 hash_item *do_item_alloc(struct default_engine *engine,
@@ -102,7 +212,8 @@ hash_item *do_item_alloc(struct default_engine *engine,
                          const rel_time_t exptime,
                          const int nbytes,
                          const void *cookie,
-                         uint8_t datatype) {
+                         uint8_t datatype,
+                         const std::mutex* held_stripe) {
     hash_item *it = NULL;
     int tries = search_items;
     hash_item *search;
@@ -120,26 +231,39 @@ hash_item *do_item_alloc(struct default_engine *engine,
     oldest_live = engine->config.oldest_live;
     current_time = engine->server.core->get_current_time();
 
-    for (search = engine->items.tails[id];
-         tries > 0 && search != NULL;
-         tries--, search=search->prev) {
-        if (search->refcount == 0 &&
-            ((search->time < oldest_live) || /* dead by flush */
-             (search->exptime != 0 && search->exptime < current_time)) &&
-            (search->locktime <= current_time)) {
-            it = search;
-            /* I don't want to actually free the object, just steal
-             * the item to avoid to grab the slab mutex twice ;-)
-             */
-            engine->stats.reclaimed++;
-            engine->items.itemstats[id].reclaimed++;
-            it->refcount = 1;
-            slabs_adjust_mem_requested(engine, it->slabs_clsid, ITEM_ntotal(engine, it), ntotal);
-            do_item_unlink(engine, it);
-            /* Initialize the item block: */
-            it->slabs_clsid = 0;
-            it->refcount = 0;
-            break;
+    {
+        std::lock_guard<std::mutex> lru(engine->items.lru_locks[id]);
+        for (auto seg : eviction_order) {
+            for (search = engine->items.tails[id][seg];
+                 tries > 0 && search != NULL;
+                 tries--, search=search->prev) {
+                /* An item another thread is using can't be reclaimed anyway */
+                std::unique_lock<std::mutex> search_lock;
+                if (!try_lock_item(engine, search, held_stripe, search_lock)) {
+                    continue;
+                }
+                if (search->refcount == 0 &&
+                    ((search->time < oldest_live) || /* dead by flush */
+                     (search->exptime != 0 && search->exptime < current_time)) &&
+                    (search->locktime <= current_time)) {
+                    it = search;
+                    /* I don't want to actually free the object, just steal
+                     * the item to avoid to grab the slab mutex twice ;-)
+                     */
+                    engine->stats.reclaimed++;
+                    engine->items.itemstats[id].reclaimed++;
+                    it->refcount = 1;
+                    slabs_adjust_mem_requested(engine, it->slabs_clsid, ITEM_ntotal(engine, it), ntotal);
+                    do_item_unlink(engine, it, true);
+                    /* Initialize the item block: */
+                    it->slabs_clsid = 0;
+                    it->refcount = 0;
+                    break;
+                }
+            }
+            if (it != NULL) {
+                break;
+            }
         }
     }
 
@@ -149,7 +273,7 @@ hash_item *do_item_alloc(struct default_engine *engine,
         ** Could not find an expired item at the tail, and memory allocation
         ** failed. Try to evict some items!
         */
-        tries = search_items;
+        std::unique_lock<std::mutex> lru(engine->items.lru_locks[id]);
 
         /* If requested to not push old items out of cache when memory runs out,
          * we're out of luck at this point...
@@ -161,36 +285,21 @@ hash_item *do_item_alloc(struct default_engine *engine,
         }
 
         /*
-         * try to get one off the right LRU
-         * don't necessariuly unlink the tail because it may be locked: refcount>0
-         * search up from tail an item with refcount==0 and unlink it; give up after search_items
-         * tries
+         * The LRU maintainer normally keeps some memory free ahead of us;
+         * if it couldn't keep up evict an item ourselves.
          */
-
-        if (engine->items.tails[id] == 0) {
+        if (engine->items.heads[id][HOT_LRU] == 0 &&
+            engine->items.heads[id][WARM_LRU] == 0 &&
+            engine->items.heads[id][COLD_LRU] == 0) {
             engine->items.itemstats[id].outofmemory++;
             return NULL;
         }
 
-        for (search = engine->items.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
-            if (search->refcount == 0 && search->locktime <= current_time) {
-                if (search->exptime == 0 || search->exptime > current_time) {
-                    engine->items.itemstats[id].evicted++;
-                    engine->items.itemstats[id].evicted_time = current_time - search->time;
-                    if (search->exptime != 0) {
-                        engine->items.itemstats[id].evicted_nonzero++;
-                    }
-                    engine->stats.evictions++;
-                } else {
-                    engine->items.itemstats[id].reclaimed++;
-                    engine->stats.reclaimed++;
-                }
-                do_item_unlink(engine, search);
-                break;
-            }
-        }
+        lru_evict(engine, id, current_time, held_stripe);
+        lru.unlock();
         it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
         if (it == 0) {
+            lru.lock();
             engine->items.itemstats[id].outofmemory++;
             /* Last ditch effort. There is a very rare bug which causes
              * refcount leaks. We've fixed most of them, but it still happens,
@@ -200,14 +309,28 @@ hash_item *do_item_alloc(struct default_engine *engine,
              * free it anyway.
              */
             tries = search_items;
-            for (search = engine->items.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
-                if (search->refcount != 0 && search->time + TAIL_REPAIR_TIME < current_time) {
-                    engine->items.itemstats[id].tailrepairs++;
-                    search->refcount = 0;
-                    do_item_unlink(engine, search);
+            bool repaired = false;
+            for (auto seg : eviction_order) {
+                for (search = engine->items.tails[id][seg];
+                     tries > 0 && search != NULL;
+                     tries--, search=search->prev) {
+                    std::unique_lock<std::mutex> search_lock;
+                    if (!try_lock_item(engine, search, held_stripe, search_lock)) {
+                        continue;
+                    }
+                    if (search->refcount != 0 && search->time + TAIL_REPAIR_TIME < current_time) {
+                        engine->items.itemstats[id].tailrepairs++;
+                        search->refcount = 0;
+                        do_item_unlink(engine, search, true);
+                        repaired = true;
+                        break;
+                    }
+                }
+                if (repaired) {
                     break;
                 }
             }
+            lru.unlock();
             it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
             if (it == 0) {
                 return NULL;
@@ -219,8 +342,6 @@ hash_item *do_item_alloc(struct default_engine *engine,
 
     it->slabs_clsid = id;
 
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
-
     it->next = it->prev = it->h_next = 0;
     it->refcount = 1;     /* the caller will have a reference */
     DEBUG_REFCNT(it, '*');
@@ -228,6 +349,7 @@ hash_item *do_item_alloc(struct default_engine *engine,
     it->nbytes = nbytes;
     it->flags = flags;
     it->datatype = datatype;
+    it->lru = HOT_LRU;
     it->exptime = exptime;
     it->locktime = 0;
     hash_key_copy_to_item(it, key);
@@ -238,8 +360,6 @@ static void item_free(struct default_engine *engine, hash_item *it) {
     size_t ntotal = ITEM_ntotal(engine, it);
     unsigned int clsid;
     cb_assert((it->iflag & ITEM_LINKED) == 0);
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
-    cb_assert(it != engine->items.tails[it->slabs_clsid]);
     cb_assert(it->refcount == 0 || engine->scrubber.force_delete);
 
     /* so slab size changer can tell later if item is already free or not */
@@ -250,13 +370,15 @@ static void item_free(struct default_engine *engine, hash_item *it) {
     slabs_free(engine, it, ntotal, clsid);
 }
 
+/* The caller must hold the lru_lock of the item's slab class */
 static void item_link_q(struct default_engine *engine, hash_item *it) { /* item is the new head */
     hash_item **head, **tail;
     cb_assert(it->slabs_clsid < POWER_LARGEST);
     cb_assert((it->iflag & ITEM_SLABBED) == 0);
 
-    head = &engine->items.heads[it->slabs_clsid];
-    tail = &engine->items.tails[it->slabs_clsid];
+    cb_assert(it->lru < NUM_LRU_SEGMENTS);
+    head = &engine->items.heads[it->slabs_clsid][it->lru];
+    tail = &engine->items.tails[it->slabs_clsid][it->lru];
     cb_assert(it != *head);
     cb_assert((*head && *tail) || (*head == 0 && *tail == 0));
     it->prev = 0;
@@ -264,15 +386,17 @@ static void item_link_q(struct default_engine *engine, hash_item *it) { /* item
     if (it->next) it->next->prev = it;
     *head = it;
     if (*tail == 0) *tail = it;
-    engine->items.sizes[it->slabs_clsid]++;
+    engine->items.sizes[it->slabs_clsid][it->lru]++;
     return;
 }
 
+/* The caller must hold the lru_lock of the item's slab class */
 static void item_unlink_q(struct default_engine *engine, hash_item *it) {
     hash_item **head, **tail;
     cb_assert(it->slabs_clsid < POWER_LARGEST);
-    head = &engine->items.heads[it->slabs_clsid];
-    tail = &engine->items.tails[it->slabs_clsid];
+    cb_assert(it->lru < NUM_LRU_SEGMENTS);
+    head = &engine->items.heads[it->slabs_clsid][it->lru];
+    tail = &engine->items.tails[it->slabs_clsid][it->lru];
 
     if (*head == it) {
         cb_assert(it->prev == 0);
@@ -287,10 +411,41 @@ static void item_unlink_q(struct default_engine *engine, hash_item *it) {
 
     if (it->next) it->next->prev = it->prev;
     if (it->prev) it->prev->next = it->next;
-    engine->items.sizes[it->slabs_clsid]--;
+    engine->items.sizes[it->slabs_clsid][it->lru]--;
     return;
 }
 
+/* Put new_it, a copy of it, in its place in the LRU.
+ * The caller must hold the lru_lock of the item's slab class */
+static void item_replace_q(struct default_engine* engine,
+                           hash_item* it,
+                           hash_item* new_it) {
+    hash_item** head = &engine->items.heads[it->slabs_clsid][it->lru];
+    hash_item** tail = &engine->items.tails[it->slabs_clsid][it->lru];
+    if (new_it->prev) {
+        new_it->prev->next = new_it;
+    } else {
+        cb_assert(*head == it);
+        *head = new_it;
+    }
+    if (new_it->next) {
+        new_it->next->prev = new_it;
+    } else {
+        cb_assert(*tail == it);
+        *tail = new_it;
+    }
+}
+
+/* Move an item to the head of another segment of its slab class' LRU.
+ * The caller must hold the lru_lock of the item's slab class */
+static void item_move_q(struct default_engine* engine,
+                        hash_item* it,
+                        lru_segment seg) {
+    item_unlink_q(engine, it);
+    it->lru = seg;
+    item_link_q(engine, it);
+}
+
 int do_item_link(struct default_engine *engine,
                  const void* cookie,
                  hash_item *it) {
@@ -298,9 +453,9 @@ int do_item_link(struct default_engine *engine,
     cb_assert((it->iflag & (ITEM_LINKED|ITEM_SLABBED)) == 0);
     it->iflag |= ITEM_LINKED;
     it->time = engine->server.core->get_current_time();
+    it->lru = HOT_LRU;
 
-    assoc_insert(crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0),
-                 it);
+    assoc_insert(hash_key_hash(key), it);
 
     engine->stats.curr_bytes += ITEM_ntotal(engine, it);
     engine->stats.curr_items += 1;
@@ -327,20 +482,35 @@ int do_item_link(struct default_engine *engine,
         return 0;
     }
 
-    item_link_q(engine, it);
+    {
+        std::lock_guard<std::mutex> lru(
+                engine->items.lru_locks[it->slabs_clsid]);
+        item_link_q(engine, it);
+    }
 
     return 1;
 }
 
-void do_item_unlink(struct default_engine *engine, hash_item *it) {
+/*
+ * The caller must hold the item's stripe lock, and the lru_lock of its slab
+ * class iff lru_locked.
+ */
+void do_item_unlink(struct default_engine* engine,
+                    hash_item* it,
+                    bool lru_locked) {
     const hash_key* key = item_get_key(it);
     if ((it->iflag & ITEM_LINKED) != 0) {
         it->iflag &= ~ITEM_LINKED;
         engine->stats.curr_bytes -= ITEM_ntotal(engine, it);
         engine->stats.curr_items -= 1;
-        assoc_delete(crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0),
-                     key);
-        item_unlink_q(engine, it);
+        assoc_delete(hash_key_hash(key), key);
+        if (lru_locked) {
+            item_unlink_q(engine, it);
+        } else {
+            std::lock_guard<std::mutex> lru(
+                    engine->items.lru_locks[it->slabs_clsid]);
+            item_unlink_q(engine, it);
+        }
         if (it->refcount == 0 || engine->scrubber.force_delete) {
             item_free(engine, it);
         }
@@ -364,10 +534,12 @@ ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine* engine,
             stored->iflag &= ~ITEM_LINKED;
             engine->stats.curr_bytes -= ITEM_ntotal(engine, stored);
             engine->stats.curr_items -= 1;
-            assoc_delete(crc32c(hash_key_get_key(key),
-                                hash_key_get_key_len(key), 0),
-                         key);
-            item_unlink_q(engine, stored);
+            assoc_delete(hash_key_hash(key), key);
+            {
+                std::lock_guard<std::mutex> lru(
+                        engine->items.lru_locks[stored->slabs_clsid]);
+                item_unlink_q(engine, stored);
+            }
             if (stored->refcount == 0 || engine->scrubber.force_delete) {
                 item_free(engine, stored);
             }
@@ -390,16 +562,15 @@ void do_item_release(struct default_engine *engine, hash_item *it) {
     }
 }
 
+/*
+ * Record that the item was accessed. The caller must hold the item's stripe
+ * lock. We only flag the item; the LRU maintainer moves it out of the way of
+ * eviction the next time it reaches the tail of its segment.
+ */
 void do_item_update(struct default_engine *engine, hash_item *it) {
-    rel_time_t current_time = engine->server.core->get_current_time();
-    if (it->time < current_time - ITEM_UPDATE_INTERVAL) {
-        cb_assert((it->iflag & ITEM_SLABBED) == 0);
-
-        if ((it->iflag & ITEM_LINKED) != 0) {
-            item_unlink_q(engine, it);
-            it->time = current_time;
-            item_link_q(engine, it);
-        }
+    cb_assert((it->iflag & ITEM_SLABBED) == 0);
+    if ((it->iflag & ITEM_ACTIVE) == 0) {
+        it->iflag |= ITEM_ACTIVE;
     }
 }
 
@@ -419,32 +590,50 @@ static void do_item_stats(struct default_engine* engine,
     int i;
     rel_time_t current_time = engine->server.core->get_current_time();
     for (i = 0; i < POWER_LARGEST; i++) {
-        if (engine->items.tails[i] != NULL) {
-            const char *prefix = "items";
+        std::lock_guard<std::mutex> lru(engine->items.lru_locks[i]);
+        const char *prefix = "items";
+        const hash_item* oldest = NULL;
+        for (auto seg : eviction_order) {
             int search = search_items;
-            while (search > 0 &&
-                   engine->items.tails[i] != NULL &&
-                   ((engine->config.oldest_live != 0 && /* Item flushd */
-                     engine->config.oldest_live <= current_time &&
-                     engine->items.tails[i]->time <= engine->config.oldest_live) ||
-                    (engine->items.tails[i]->exptime != 0 && /* and not expired */
-                     engine->items.tails[i]->exptime < current_time))) {
+            while (search > 0 && engine->items.tails[i][seg] != NULL) {
+                auto* tail = engine->items.tails[i][seg];
+                std::unique_lock<std::mutex> tail_lock;
+                if (!try_lock_item(engine, tail, nullptr, tail_lock) ||
+                    !((engine->config.oldest_live != 0 && /* Item flushd */
+                       engine->config.oldest_live <= current_time &&
+                       tail->time <= engine->config.oldest_live) ||
+                      (tail->exptime != 0 && /* and not expired */
+                       tail->exptime < current_time))) {
+                    break;
+                }
                 --search;
-                if (engine->items.tails[i]->refcount == 0) {
-                    do_item_unlink(engine, engine->items.tails[i]);
+                if (tail->refcount == 0) {
+                    do_item_unlink(engine, tail, true);
                 } else {
                     break;
                 }
             }
-            if (engine->items.tails[i] == NULL) {
-                /* We removed all of the items in this slab class */
-                continue;
+            if (oldest == NULL) {
+                oldest = engine->items.tails[i][seg];
             }
+        }
+        if (oldest == NULL) {
+            /* We removed all of the items in this slab class */
+            continue;
+        }
 
+        {
+            const auto* sizes = engine->items.sizes[i];
             add_statistics(c, add_stats, prefix, i, "number", "%u",
-                           engine->items.sizes[i]);
+                           sizes[HOT_LRU] + sizes[WARM_LRU] + sizes[COLD_LRU]);
+            add_statistics(c, add_stats, prefix, i, "number_hot", "%u",
+                           sizes[HOT_LRU]);
+            add_statistics(c, add_stats, prefix, i, "number_warm", "%u",
+                           sizes[WARM_LRU]);
+            add_statistics(c, add_stats, prefix, i, "number_cold", "%u",
+                           sizes[COLD_LRU]);
             add_statistics(c, add_stats, prefix, i, "age", "%u",
-                           engine->items.tails[i]->time);
+                           oldest->time);
             add_statistics(c, add_stats, prefix, i, "evicted",
                            "%u", engine->items.itemstats[i].evicted);
             add_statistics(c, add_stats, prefix, i, "evicted_nonzero",
@@ -457,6 +646,10 @@ static void do_item_stats(struct default_engine* engine,
                            "%u", engine->items.itemstats[i].tailrepairs);;
             add_statistics(c, add_stats, prefix, i, "reclaimed",
                            "%u", engine->items.itemstats[i].reclaimed);;
+            add_statistics(c, add_stats, prefix, i, "moves_to_cold",
+                           "%u", engine->items.itemstats[i].moves_to_cold);
+            add_statistics(c, add_stats, prefix, i, "moves_to_warm",
+                           "%u", engine->items.itemstats[i].moves_to_warm);
         }
     }
 }
@@ -476,17 +669,20 @@ static void do_item_stats_sizes(struct default_engine* engine,
 
         /* build the histogram */
         for (i = 0; i < POWER_LARGEST; i++) {
-            hash_item *iter = engine->items.heads[i];
-            while (iter) {
-                size_t ntotal = ITEM_ntotal(engine, iter);
-                size_t bucket = ntotal / 32;
-                if ((ntotal % 32) != 0) {
-                    bucket++;
-                }
-                if (bucket < num_buckets) {
-                    histogram[bucket]++;
+            std::lock_guard<std::mutex> lru(engine->items.lru_locks[i]);
+            for (int seg = 0; seg < NUM_LRU_SEGMENTS; ++seg) {
+                hash_item *iter = engine->items.heads[i][seg];
+                while (iter) {
+                    size_t ntotal = ITEM_ntotal(engine, iter);
+                    size_t bucket = ntotal / 32;
+                    if ((ntotal % 32) != 0) {
+                        bucket++;
+                    }
+                    if (bucket < num_buckets) {
+                        histogram[bucket]++;
+                    }
+                    iter = iter->next;
                 }
-                iter = iter->next;
             }
         }
 
@@ -512,19 +708,17 @@ hash_item* do_item_get(struct default_engine* engine,
                        const hash_key* key,
                        const DocStateFilter documentStateFilter) {
     rel_time_t current_time = engine->server.core->get_current_time();
-    hash_item *it = assoc_find(crc32c(hash_key_get_key(key),
-                                      hash_key_get_key_len(key), 0),
-                               key);
+    hash_item *it = assoc_find(hash_key_hash(key), key);
 
     if (it != NULL && engine->config.oldest_live != 0 &&
         engine->config.oldest_live <= current_time &&
         it->time <= engine->config.oldest_live) {
-        do_item_unlink(engine, it);           /* MTSAFE - items.lock held */
+        do_item_unlink(engine, it);           /* MTSAFE - stripe lock held */
         it = NULL;
     }
 
     if (it != NULL && it->exptime != 0 && it->exptime <= current_time) {
-        do_item_unlink(engine, it);           /* MTSAFE - items.lock held */
+        do_item_unlink(engine, it);           /* MTSAFE - stripe lock held */
         it = NULL;
     }
 
@@ -638,11 +832,8 @@ hash_item *item_alloc(struct default_engine *engine,
         return NULL;
     }
 
-    {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
-        it = do_item_alloc(
-                engine, &hkey, flags, exptime, nbytes, cookie, datatype);
-    }
+    it = do_item_alloc(
+            engine, &hkey, flags, exptime, nbytes, cookie, datatype, nullptr);
     hash_key_destroy(&hkey);
     return it;
 }
@@ -674,7 +865,7 @@ hash_item* item_get(struct default_engine* engine,
                     const void* cookie,
                     const hash_key& key,
                     const DocStateFilter state) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, &key));
     return do_item_get(engine, &key, state);
 }
 
@@ -683,7 +874,7 @@ hash_item* item_get(struct default_engine* engine,
  * needed.
  */
 void item_release(struct default_engine *engine, hash_item *item) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, item_get_key(item)));
     do_item_release(engine, item);
 }
 
@@ -691,13 +882,13 @@ void item_release(struct default_engine *engine, hash_item *item) {
  * Unlinks an item from the LRU and hashtable.
  */
 void item_unlink(struct default_engine *engine, hash_item *item) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, item_get_key(item)));
     do_item_unlink(engine, item);
 }
 
 ENGINE_ERROR_CODE safe_item_unlink(struct default_engine *engine,
                                    hash_item *it) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, item_get_key(it)));
     return do_safe_item_unlink(engine, it);
 }
 
@@ -716,7 +907,7 @@ ENGINE_ERROR_CODE store_item(struct default_engine *engine,
         item->iflag |= ITEM_ZOMBIE;
     }
 
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, item_get_key(item)));
     ret = do_store_item(engine, item, operation, cookie, &stored_item);
     if (ret == ENGINE_SUCCESS) {
         *cas = stored_item->cas;
@@ -729,7 +920,8 @@ ENGINE_ERROR_CODE do_item_get_locked(struct default_engine* engine,
                                      const void* cookie,
                                      hash_item** it,
                                      const hash_key* hkey,
-                                     rel_time_t locktime) {
+                                     rel_time_t locktime,
+                                     const std::mutex& stripe) {
     hash_item* item = do_item_get(engine, hkey, DocStateFilter::Alive);
     if (item == nullptr) {
         return ENGINE_KEY_ENOENT;
@@ -767,7 +959,8 @@ ENGINE_ERROR_CODE do_item_get_locked(struct default_engine* engine,
         // Unfortunately I can't return the actual object as that'll cause
         // the item's cas to be masked out ;-)
         auto* clone = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                    item->nbytes, cookie, item->datatype);
+                                    item->nbytes, cookie, item->datatype,
+                                    &stripe);
         if (clone == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
@@ -788,14 +981,16 @@ ENGINE_ERROR_CODE do_item_get_locked(struct default_engine* engine,
         // Multiple entities holds a reference to the object. We
         // need to do a copy/replace.
         auto* clone1 = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                     item->nbytes, cookie, item->datatype);
+                                     item->nbytes, cookie, item->datatype,
+                                     &stripe);
         if (clone1 == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
         }
 
         auto* clone2 = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                     item->nbytes, cookie, item->datatype);
+                                     item->nbytes, cookie, item->datatype,
+                                     &stripe);
         if (clone2 == nullptr) {
             do_item_release(engine, item);
             do_item_release(engine, clone1);
@@ -834,8 +1029,9 @@ ENGINE_ERROR_CODE item_get_locked(struct default_engine* engine,
 
     ENGINE_ERROR_CODE ret;
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
-        ret = do_item_get_locked(engine, cookie, it, &hkey, locktime);
+        auto& stripe = item_lock(engine, &hkey);
+        std::lock_guard<std::mutex> guard(stripe);
+        ret = do_item_get_locked(engine, cookie, it, &hkey, locktime, stripe);
     }
     hash_key_destroy(&hkey);
 
@@ -845,7 +1041,8 @@ ENGINE_ERROR_CODE item_get_locked(struct default_engine* engine,
 static ENGINE_ERROR_CODE do_item_unlock(struct default_engine* engine,
                                         const void* cookie,
                                         const hash_key* hkey,
-                                        uint64_t cas) {
+                                        uint64_t cas,
+                                        const std::mutex& stripe) {
     hash_item* item = do_item_get(engine, hkey, DocStateFilter::Alive);
     if (item == nullptr) {
         return ENGINE_KEY_ENOENT;
@@ -874,7 +1071,8 @@ static ENGINE_ERROR_CODE do_item_unlock(struct default_engine* engine,
     } else {
         // Someone else holds a reference to the object.
         auto* clone = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                    item->nbytes, cookie, item->datatype);
+                                    item->nbytes, cookie, item->datatype,
+                                    &stripe);
         if (clone == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
@@ -904,8 +1102,9 @@ ENGINE_ERROR_CODE item_unlock(struct default_engine* engine,
 
     ENGINE_ERROR_CODE ret;
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
-        ret = do_item_unlock(engine, cookie, &hkey, cas);
+        auto& stripe = item_lock(engine, &hkey);
+        std::lock_guard<std::mutex> guard(stripe);
+        ret = do_item_unlock(engine, cookie, &hkey, cas, stripe);
     }
     hash_key_destroy(&hkey);
 
@@ -916,7 +1115,8 @@ ENGINE_ERROR_CODE do_item_get_and_touch(struct default_engine* engine,
                                         const void* cookie,
                                         hash_item** it,
                                         const hash_key* hkey,
-                                        rel_time_t exptime) {
+                                        rel_time_t exptime,
+                                        const std::mutex& stripe) {
     hash_item* item = do_item_get(engine, hkey, DocStateFilter::Alive);
     if (item == nullptr) {
         return ENGINE_KEY_ENOENT;
@@ -950,7 +1150,8 @@ ENGINE_ERROR_CODE do_item_get_and_touch(struct default_engine* engine,
         // Multiple entities holds a reference to the object. We
         // need to do a copy/replace.
         auto* clone = do_item_alloc(engine, hkey, item->flags, exptime,
-                                    item->nbytes, cookie, item->datatype);
+                                    item->nbytes, cookie, item->datatype,
+                                    &stripe);
         if (clone == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
@@ -982,8 +1183,9 @@ ENGINE_ERROR_CODE item_get_and_touch(struct default_engine* engine,
 
     ENGINE_ERROR_CODE ret;
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
-        ret = do_item_get_and_touch(engine, cookie, it, &hkey, exptime);
+        auto& stripe = item_lock(engine, &hkey);
+        std::lock_guard<std::mutex> guard(stripe);
+        ret = do_item_get_and_touch(engine, cookie, it, &hkey, exptime, stripe);
     }
     hash_key_destroy(&hkey);
 
@@ -994,31 +1196,37 @@ ENGINE_ERROR_CODE item_get_and_touch(struct default_engine* engine,
  * Flushes expired items after a flush_all call
  */
 void item_flush_expired(struct default_engine *engine) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
-
     rel_time_t now = engine->server.core->get_current_time();
     if (now > engine->config.oldest_live) {
         engine->config.oldest_live = now - 1;
     }
 
     for (int ii = 0; ii < POWER_LARGEST; ii++) {
-        hash_item *iter, *next;
-        /*
-         * The LRU is sorted in decreasing time order, and an item's
-         * timestamp is never newer than its last access time, so we
-         * only need to walk back until we hit an item older than the
-         * oldest_live time.
-         * The oldest_live checking will auto-expire the remaining items.
-         */
-        for (iter = engine->items.heads[ii]; iter != NULL; iter = next) {
-            if (iter->time >= engine->config.oldest_live) {
+        std::lock_guard<std::mutex> lru(engine->items.lru_locks[ii]);
+        for (int seg = 0; seg < NUM_LRU_SEGMENTS; ++seg) {
+            hash_item *iter, *next;
+            /*
+             * HOT and WARM are sorted in decreasing time order (items are
+             * linked at their head with the current time), and an item's
+             * timestamp is never newer than its last access time, so we
+             * only need to walk back until we hit an item older than the
+             * oldest_live time. COLD gets inactive items with their old
+             * timestamp, so it has to be walked in full.
+             * The oldest_live checking will auto-expire the remaining items
+             * (including any we skip here as another thread is using them).
+             */
+            for (iter = engine->items.heads[ii][seg]; iter != NULL; iter = next) {
                 next = iter->next;
-                if ((iter->iflag & ITEM_SLABBED) == 0) {
-                    do_item_unlink(engine, iter);
+                if (iter->time >= engine->config.oldest_live) {
+                    std::unique_lock<std::mutex> iter_lock;
+                    if ((iter->iflag & ITEM_SLABBED) == 0 &&
+                        try_lock_item(engine, iter, nullptr, iter_lock)) {
+                        do_item_unlink(engine, iter, true);
+                    }
+                } else if (seg != COLD_LRU) {
+                    /* We've hit the first old item. Continue to the next queue. */
+                    break;
                 }
-            } else {
-                /* We've hit the first old item. Continue to the next queue. */
-                break;
             }
         }
     }
@@ -1027,26 +1235,25 @@ void item_flush_expired(struct default_engine *engine) {
 void item_stats(struct default_engine* engine,
                 const AddStatFn& add_stat,
                 const void* cookie) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
     do_item_stats(engine, add_stat, cookie);
 }
 
 void item_stats_sizes(struct default_engine* engine,
                       const AddStatFn& add_stat,
                       const void* cookie) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
     do_item_stats_sizes(engine, add_stat, cookie);
 }
 
 static void do_item_link_cursor(struct default_engine *engine,
-                                hash_item *cursor, int ii)
+                                hash_item *cursor, int ii, int seg)
 {
     cursor->slabs_clsid = (uint8_t)ii;
+    cursor->lru = (uint8_t)seg;
     cursor->next = NULL;
-    cursor->prev = engine->items.tails[ii];
-    engine->items.tails[ii]->next = cursor;
-    engine->items.tails[ii] = cursor;
-    engine->items.sizes[ii]++;
+    cursor->prev = engine->items.tails[ii][seg];
+    engine->items.tails[ii][seg]->next = cursor;
+    engine->items.tails[ii][seg] = cursor;
+    engine->items.sizes[ii][seg]++;
 }
 
 typedef ENGINE_ERROR_CODE (*ITERFUNC)(struct default_engine *engine,
@@ -1070,7 +1277,7 @@ static bool do_item_walk_cursor(struct default_engine *engine,
         ++ii;
         item_unlink_q(engine, cursor);
 
-        if (ptr == engine->items.heads[cursor->slabs_clsid]) {
+        if (ptr == engine->items.heads[cursor->slabs_clsid][cursor->lru]) {
             done = true;
             cursor->prev = NULL;
         } else {
@@ -1078,6 +1285,7 @@ static bool do_item_walk_cursor(struct default_engine *engine,
             cursor->prev = ptr->prev;
             cursor->prev->next = cursor;
             ptr->prev = cursor;
+            engine->items.sizes[cursor->slabs_clsid][cursor->lru]++;
         }
 
         /* Ignore cursors */
@@ -1108,6 +1316,13 @@ static ENGINE_ERROR_CODE item_scrub(struct default_engine *engine,
         scrubber is used for generic bucket deletion and scrub_cmd
         all expired or orphaned items are unlinked
     */
+    /* We're walking the LRU so can't wait for an item in use; it is
+       visited again by the next scrub. */
+    std::unique_lock<std::mutex> lock;
+    if (!try_lock_item(engine, item, nullptr, lock)) {
+        return ENGINE_SUCCESS;
+    }
+
     if (engine->scrubber.force_delete && item->refcount > 0) {
         // warn that someone isn't releasing items before deleting their bucket.
         LOG_WARNING("Bucket ({}) deletion is removing an item with refcount {}",
@@ -1117,48 +1332,125 @@ static ENGINE_ERROR_CODE item_scrub(struct default_engine *engine,
 
     if (engine->scrubber.force_delete || (item->refcount == 0 &&
        (item->exptime != 0 && item->exptime < current_time))) {
-        do_item_unlink(engine, item);
+        do_item_unlink(engine, item, true);
         engine->scrubber.cleaned++;
     }
     return ENGINE_SUCCESS;
 }
 
+/* Account for the time a chunk of the scrub held the lru_lock */
+static void item_scrub_record_chunk(struct default_engine *engine,
+                                    uint64_t usec) {
+    auto& scrubber = engine->scrubber;
+    scrubber.chunks++;
+    scrubber.chunk_total_usec += usec;
+    uint64_t max = scrubber.chunk_max_usec;
+    while (usec > max &&
+           !scrubber.chunk_max_usec.compare_exchange_weak(max, usec)) {
+    }
+}
+
+/*
+ * Scrub the LRU segment the cursor is linked into, scrub_chunk_size items
+ * at a time. The lru_lock is released (and the cpu yielded) between the
+ * chunks so the front end threads using the class don't stall behind the
+ * scrub.
+ */
 static void item_scrub_class(struct default_engine *engine,
                              hash_item *cursor) {
-
+    const int steplength =
+            int(std::max(engine->config.scrub_chunk_size, size_t(1)));
     ENGINE_ERROR_CODE ret;
     bool more;
     do {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
-        more = do_item_walk_cursor(engine, cursor, 200, item_scrub, NULL, &ret);
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> guard(
+                    engine->items.lru_locks[cursor->slabs_clsid]);
+            more = do_item_walk_cursor(
+                    engine, cursor, steplength, item_scrub, NULL, &ret);
+        }
+        item_scrub_record_chunk(
+                engine,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count());
         if (ret != ENGINE_SUCCESS) {
             break;
         }
+        std::this_thread::yield();
     } while (more);
 }
 
-void item_scrubber_main(struct default_engine *engine)
-{
+/* The state shared by the threads scrubbing an engine */
+struct item_scrub_context {
+    struct default_engine* engine;
+    /* The next slab class to scrub */
+    std::atomic<int> next_class{0};
+};
+
+/* Scrub slab classes until there are no more left to scrub */
+static void item_scrub_classes(struct item_scrub_context* ctx) {
+    struct default_engine* engine = ctx->engine;
     hash_item cursor;
     int ii;
 
     memset(&cursor, 0, sizeof(cursor));
     cursor.refcount = 1;
-    for (ii = 0; ii < POWER_LARGEST; ++ii) {
-        bool skip = false;
-        {
-            std::lock_guard<std::mutex> guard(engine->items.lock);
-            if (engine->items.heads[ii] == NULL) {
-                skip = true;
-            } else {
-                /* add the item at the tail */
-                do_item_link_cursor(engine, &cursor, ii);
+    while ((ii = ctx->next_class++) < POWER_LARGEST) {
+        for (int seg = 0; seg < NUM_LRU_SEGMENTS; ++seg) {
+            bool skip = false;
+            {
+                std::lock_guard<std::mutex> guard(engine->items.lru_locks[ii]);
+                if (engine->items.heads[ii][seg] == NULL) {
+                    skip = true;
+                } else {
+                    /* add the item at the tail */
+                    do_item_link_cursor(engine, &cursor, ii, seg);
+                }
+            }
+
+            if (!skip) {
+                item_scrub_class(engine, &cursor);
             }
         }
+    }
+}
+
+static void item_scrub_worker(void* arg) {
+    item_scrub_classes(static_cast<struct item_scrub_context*>(arg));
+}
 
-        if (!skip) {
-            item_scrub_class(engine, &cursor);
+void item_scrubber_main(struct default_engine *engine)
+{
+    if (engine->scrubber.force_delete) {
+        /* Don't let the maintainer move items between the segments while
+         * we're deleting them */
+        item_lru_maintainer_stop(engine);
+    }
+
+    /*
+     * The slab classes are scrubbed in parallel by scrub_threads threads
+     * (including this one); each class is only scrubbed by one of them.
+     */
+    struct item_scrub_context ctx;
+    ctx.engine = engine;
+    std::vector<cb_thread_t> workers;
+    for (size_t ii = 1; ii < engine->config.scrub_threads; ++ii) {
+        cb_thread_t tid;
+        if (cb_create_named_thread(
+                    &tid, item_scrub_worker, &ctx, 0, "mc:scrub worker") !=
+            0) {
+            LOG_WARNING("Failed to create a scrubber worker thread: {}",
+                        strerror(errno));
+            break;
         }
+        workers.push_back(tid);
+    }
+
+    item_scrub_classes(&ctx);
+    for (auto& tid : workers) {
+        cb_join_thread(tid);
     }
 
     std::lock_guard<std::mutex> guard(engine->scrubber.lock);
@@ -1176,6 +1468,9 @@ bool item_start_scrub(struct default_engine *engine)
         engine->scrubber.stopped = 0;
         engine->scrubber.visited = 0;
         engine->scrubber.cleaned = 0;
+        engine->scrubber.chunks = 0;
+        engine->scrubber.chunk_total_usec = 0;
+        engine->scrubber.chunk_max_usec = 0;
         engine->scrubber.running = true;
         engine_manager_scrub_engine(engine);
         return true;
@@ -1184,6 +1479,326 @@ bool item_start_scrub(struct default_engine *engine)
     return false;
 }
 
+/*
+ * Look at the item at the tail of a segment of a slab class' LRU (the
+ * caller must hold its lru_lock), and move it to where it belongs:
+ *  - dead (expired or flushed) unused items are reclaimed
+ *  - active items move to the head of WARM
+ *  - inactive items move to inactive_to
+ * Returns true if an item was moved or reclaimed.
+ */
+static bool lru_pull_tail(struct default_engine* engine,
+                          unsigned int id,
+                          lru_segment seg,
+                          lru_segment inactive_to,
+                          rel_time_t current_time) {
+    const rel_time_t oldest_live = engine->config.oldest_live;
+    int tries = 5;
+    for (auto* search = engine->items.tails[id][seg];
+         tries > 0 && search != NULL;
+         tries--, search = search->prev) {
+        std::unique_lock<std::mutex> search_lock;
+        if (!try_lock_item(engine, search, nullptr, search_lock)) {
+            continue;
+        }
+
+        const bool flushed = oldest_live != 0 &&
+                             oldest_live <= current_time &&
+                             search->time <= oldest_live;
+        if ((flushed ||
+             (search->exptime != 0 && search->exptime < current_time)) &&
+            search->refcount == 0 && search->locktime <= current_time) {
+            engine->items.itemstats[id].reclaimed++;
+            engine->stats.reclaimed++;
+            do_item_unlink(engine, search, true);
+            return true;
+        }
+
+        auto to = inactive_to;
+        if ((search->iflag & ITEM_ACTIVE) != 0) {
+            search->iflag &= ~ITEM_ACTIVE;
+            /* Keep the time of a flushed item so it stays dead (and HOT and
+             * WARM stay sorted) */
+            if (flushed) {
+                to = COLD_LRU;
+            } else {
+                search->time = current_time;
+                to = WARM_LRU;
+            }
+        }
+        if (to == seg && seg == COLD_LRU) {
+            return false;
+        }
+
+        item_move_q(engine, search, to);
+        if (to == COLD_LRU) {
+            engine->items.itemstats[id].moves_to_cold++;
+        } else if (to == WARM_LRU) {
+            engine->items.itemstats[id].moves_to_warm++;
+        }
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Run the LRU maintainer over a slab class: keep HOT and WARM within their
+ * limits, rescue active items from the tail of COLD, and evict from COLD if
+ * the class is running out of memory.
+ * Returns the number of items moved or unlinked.
+ */
+static int lru_maintain_class(struct default_engine* engine,
+                              unsigned int id) {
+    const rel_time_t current_time = engine->server.core->get_current_time();
+    int did = 0;
+
+    std::lock_guard<std::mutex> lru(engine->items.lru_locks[id]);
+    for (int ii = 0; ii < LRU_MAINTAINER_BATCH; ++ii) {
+        const auto* sizes = engine->items.sizes[id];
+        const unsigned int total =
+                sizes[HOT_LRU] + sizes[WARM_LRU] + sizes[COLD_LRU];
+        bool moved = false;
+
+        if (sizes[HOT_LRU] > total * LRU_HOT_PERCENT / 100) {
+            moved |= lru_pull_tail(
+                    engine, id, HOT_LRU, COLD_LRU, current_time);
+        }
+        if (sizes[WARM_LRU] > total * LRU_WARM_PERCENT / 100) {
+            moved |= lru_pull_tail(
+                    engine, id, WARM_LRU, COLD_LRU, current_time);
+        }
+        moved |= lru_pull_tail(engine, id, COLD_LRU, COLD_LRU, current_time);
+
+        if (engine->config.evict_to_free &&
+            slabs_low_on_memory(engine, id)) {
+            moved |= lru_evict(engine, id, current_time, nullptr);
+        }
+
+        if (!moved) {
+            break;
+        }
+        ++did;
+    }
+
+    return did;
+}
+
+/*
+ * Free a chunk of the page being moved out of slab class id: a live item is
+ * copied to another chunk of the class (or evicted if there is none).
+ * Returns true if the chunk is free, false if it is in use and has to be
+ * looked at again.
+ */
+static bool slab_rescue_chunk(struct default_engine* engine,
+                              unsigned int id,
+                              hash_item* it) {
+    /* The key of a linked item can't change while we hold the lru_lock */
+    std::lock_guard<std::mutex> lru(engine->items.lru_locks[id]);
+    if ((it->iflag & ITEM_SLABBED) != 0) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock;
+    if ((it->iflag & ITEM_LINKED) == 0 ||
+        !try_lock_item(engine, it, nullptr, lock) || it->refcount != 0) {
+        engine->slabs.rebalance.busy_items++;
+        return false;
+    }
+
+    const size_t ntotal = ITEM_ntotal(engine, it);
+    auto* moved = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
+    if (moved == NULL) {
+        /* No free chunk outside of the page, so make room in it instead */
+        engine->slabs.rebalance.evictions++;
+        engine->items.itemstats[id].evicted++;
+        engine->stats.evictions++;
+        do_item_unlink(engine, it, true);
+        return true;
+    }
+
+    memcpy(moved, it, ntotal);
+    hash_key* key = item_get_key(moved);
+    key->header.full_key = (hash_key_data*)&key->key_storage;
+    item_replace_q(engine, it, moved);
+    const uint32_t hash = hash_key_hash(key);
+    assoc_delete(hash, key);
+    assoc_insert(hash, moved);
+
+    it->iflag = ITEM_SLABBED;
+    it->slabs_clsid = 0;
+    slabs_free(engine, it, ntotal, id);
+    engine->slabs.rebalance.rescues++;
+    return true;
+}
+
+/* Make a pass over the page being moved between slab classes (if any) */
+static void slab_rebalance_pass(struct default_engine* engine) {
+    unsigned int id;
+    char* page;
+    unsigned int size;
+    unsigned int chunks;
+    if (!slabs_reassign_page(engine, &id, &page, &size, &chunks)) {
+        return;
+    }
+
+    bool clean = true;
+    for (unsigned int ii = 0; ii < chunks; ++ii) {
+        auto* it = reinterpret_cast<hash_item*>(page + size_t(ii) * size);
+        if (!slab_rescue_chunk(engine, id, it)) {
+            clean = false;
+        }
+    }
+    slabs_reassign_pass(engine, clean);
+}
+
+/*
+ * Once a window has passed, look at the evictions of each slab class and
+ * start moving a page if one class has been starved for long enough (see
+ * SLAB_AUTOMOVE_WINDOW).
+ */
+static void slab_automove(struct default_engine* engine,
+                          rel_time_t current_time) {
+    auto& automove = engine->items.automove;
+    if (current_time - automove.window_start < SLAB_AUTOMOVE_WINDOW) {
+        return;
+    }
+    automove.window_start = current_time;
+
+    /* How long the oldest item of each idle class has been around */
+    rel_time_t ages[POWER_LARGEST] = {};
+    unsigned int winner = 0;
+    rel_time_t winner_age = 0;
+    for (unsigned int id = POWER_SMALLEST;
+         id <= engine->slabs.power_largest;
+         ++id) {
+        unsigned int evicted;
+        rel_time_t evicted_time;
+        const hash_item* oldest = NULL;
+        {
+            std::lock_guard<std::mutex> lru(engine->items.lru_locks[id]);
+            evicted = engine->items.itemstats[id].evicted;
+            evicted_time = engine->items.itemstats[id].evicted_time;
+            for (auto seg : eviction_order) {
+                if (engine->items.tails[id][seg] != NULL) {
+                    oldest = engine->items.tails[id][seg];
+                    break;
+                }
+            }
+            /* An empty class doesn't need its pages at all */
+            ages[id] = oldest ? current_time - oldest->time
+                              : std::numeric_limits<rel_time_t>::max();
+        }
+
+        if (evicted == automove.evicted[id]) {
+            automove.idle_windows[id]++;
+        } else {
+            automove.idle_windows[id] = 0;
+            if (winner == 0 || evicted_time < winner_age) {
+                winner = id;
+                winner_age = evicted_time;
+            }
+        }
+        automove.evicted[id] = evicted;
+    }
+
+    if (winner != 0 && winner == automove.winner) {
+        automove.winner_windows++;
+    } else {
+        automove.winner = winner;
+        automove.winner_windows = winner != 0 ? 1 : 0;
+    }
+    if (automove.winner_windows < SLAB_AUTOMOVE_WINDOWS) {
+        return;
+    }
+
+    /* Take the page from the idle class which keeps its items the longest */
+    unsigned int donor = 0;
+    for (unsigned int id = POWER_SMALLEST;
+         id <= engine->slabs.power_largest;
+         ++id) {
+        if (id != winner &&
+            automove.idle_windows[id] >= SLAB_AUTOMOVE_WINDOWS &&
+            ages[id] / SLAB_AUTOMOVE_AGE_RATIO > winner_age &&
+            (donor == 0 || ages[id] > ages[donor]) &&
+            slabs_class_pages(engine, id) > 2) {
+            donor = id;
+        }
+    }
+
+    if (donor != 0 && slabs_reassign_start(engine, donor, winner)) {
+        LOG_INFO("Moving a slab page from class {} to {}", donor, winner);
+        automove.winner_windows = 0;
+    }
+}
+
+static void lru_maintainer_main(void* arg) {
+    auto* engine = static_cast<struct default_engine*>(arg);
+    auto& maintainer = engine->items.maintainer;
+    auto sleep = lru_maintainer_max_sleep;
+
+    std::unique_lock<std::mutex> guard(maintainer.lock);
+    while (!maintainer.stop) {
+        guard.unlock();
+        int did = 0;
+        for (unsigned int id = POWER_SMALLEST;
+             id <= engine->slabs.power_largest;
+             ++id) {
+            did += lru_maintain_class(engine, id);
+        }
+
+        if (engine->config.slab_automove) {
+            slab_rebalance_pass(engine);
+            slab_automove(engine, engine->server.core->get_current_time());
+        }
+
+        /* Back off while there is nothing to do */
+        if (did > 0) {
+            sleep = std::max(sleep / 2, lru_maintainer_min_sleep);
+        } else {
+            sleep = std::min(sleep * 2, lru_maintainer_max_sleep);
+        }
+
+        guard.lock();
+        maintainer.cond.wait_for(
+                guard, sleep, [&maintainer] { return maintainer.stop; });
+    }
+}
+
+ENGINE_ERROR_CODE item_lru_maintainer_start(struct default_engine* engine) {
+    auto& maintainer = engine->items.maintainer;
+    std::lock_guard<std::mutex> guard(maintainer.lock);
+    if (maintainer.running) {
+        return ENGINE_SUCCESS;
+    }
+
+    maintainer.stop = false;
+    if (cb_create_named_thread(&maintainer.thread,
+                               lru_maintainer_main,
+                               engine,
+                               0,
+                               "mc:lru maint") != 0) {
+        LOG_WARNING("Failed to create the LRU maintainer thread: {}",
+                    strerror(errno));
+        return ENGINE_FAILED;
+    }
+    maintainer.running = true;
+    return ENGINE_SUCCESS;
+}
+
+void item_lru_maintainer_stop(struct default_engine* engine) {
+    auto& maintainer = engine->items.maintainer;
+    {
+        std::lock_guard<std::mutex> guard(maintainer.lock);
+        if (!maintainer.running) {
+            return;
+        }
+        maintainer.running = false;
+        maintainer.stop = true;
+    }
+    maintainer.cond.notify_all();
+    cb_join_thread(maintainer.thread);
+}
+
 static bool hash_key_create(hash_key* hkey,
                             const void* key,
                             const size_t nkey,
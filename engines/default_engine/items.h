@@ -4,9 +4,12 @@
 #include "slabs.h"
 
 #include <gsl/gsl-lite.h>
+#include <platform/platform_thread.h>
 #include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstring>
+#include <mutex>
 
 /*
  * You should not try to aquire any of the item locks before calling these
@@ -24,7 +27,10 @@ typedef struct _hash_item {
      */
     uint64_t cas;
 
-    /** least recent access */
+    /**
+     * least recent access (as of the last time the item was moved to the
+     * head of an LRU segment)
+     */
     rel_time_t time;
 
     /** When the item will expire (relative to process startup) */
@@ -60,7 +66,10 @@ typedef struct _hash_item {
     /** to identify the type of the data */
     uint8_t datatype;
 
-    // There is 3 spare bytes due to alignment
+    /** which segment (lru_segment) of our slab class' LRU we're in */
+    uint8_t lru;
+
+    // There is 2 spare bytes due to alignment
 } hash_item;
 
 /*
@@ -145,17 +154,87 @@ typedef struct {
     unsigned int outofmemory;
     unsigned int tailrepairs;
     unsigned int reclaimed;
+    unsigned int moves_to_cold;
+    unsigned int moves_to_warm;
 } itemstats_t;
 
+/*
+ * The LRU of each slab class is split into three segments. New items are
+ * linked at the head of HOT, and reading an item only flags it as
+ * ITEM_ACTIVE. The LRU maintainer thread moves items between the segments:
+ *  - HOT and WARM are limited to LRU_HOT_PERCENT and LRU_WARM_PERCENT of the
+ *    class' items. Past that their tail moves to WARM if it is active, or to
+ *    COLD if not.
+ *  - an active item at the tail of COLD moves back to WARM.
+ *  - expired items found on the way are reclaimed, and once a class can't
+ *    allocate any more memory the tail of COLD is evicted ahead of demand.
+ * Reads therefore never take an LRU lock, and allocations only evict
+ * (COLD first) if the maintainer has fallen behind.
+ */
+enum lru_segment : uint8_t {
+    HOT_LRU = 0,
+    WARM_LRU = 1,
+    COLD_LRU = 2,
+    NUM_LRU_SEGMENTS = 3
+};
+
+/* State of the LRU maintainer thread of an engine */
+struct lru_maintainer {
+    std::mutex lock;
+    std::condition_variable cond;
+    bool running{false};
+    bool stop{false};
+    cb_thread_t thread;
+};
+
+/*
+ * State of the slab automover (only used by the LRU maintainer thread).
+ * Every window it looks at the evictions of each slab class; once the same
+ * class had to evict the youngest items for a few windows in a row, a page
+ * is moved to it from a class which hasn't evicted anything for as long and
+ * keeps its items around for much longer.
+ */
+struct slab_automove {
+    rel_time_t window_start;
+    /* The evictions of each class at the start of the window */
+    unsigned int evicted[POWER_LARGEST];
+    /* The number of windows in a row each class didn't evict anything */
+    unsigned int idle_windows[POWER_LARGEST];
+    /* The class which evicted the youngest items, and for how many windows */
+    unsigned int winner;
+    unsigned int winner_windows;
+};
+
+/**
+ * Number of stripes the item locks are split across. All operations on a key
+ * (lookup, link / unlink and changes to the item's refcount and metadata)
+ * serialise on the stripe selected by the hash of the key, so operations on
+ * different keys may run in parallel.
+ */
+#define ITEM_LOCK_STRIPES 256
+
 struct items {
-   hash_item *heads[POWER_LARGEST];
-   hash_item *tails[POWER_LARGEST];
+   hash_item *heads[POWER_LARGEST][NUM_LRU_SEGMENTS];
+   hash_item *tails[POWER_LARGEST][NUM_LRU_SEGMENTS];
    itemstats_t itemstats[POWER_LARGEST];
-   unsigned int sizes[POWER_LARGEST];
+   unsigned int sizes[POWER_LARGEST][NUM_LRU_SEGMENTS];
    /*
-    * serialise access to the items data
-   */
-   std::mutex lock;
+    * serialise access to the items hashing to each stripe.
+    * Lock order: stripes -> lru_locks -> (slab class lock / assoc lock).
+    * Code walking an LRU (and hence holding its lru_lock) may only
+    * try_lock a stripe.
+    */
+   std::mutex stripes[ITEM_LOCK_STRIPES];
+   /*
+    * serialise access to the LRU of each slab class (heads, tails, sizes,
+    * itemstats, and the next, prev and lru members of the items in it).
+    * The maintainer only moves items whose stripe it could try-lock, as it
+    * also updates their time and iflag.
+    */
+   std::mutex lru_locks[POWER_LARGEST];
+
+   struct lru_maintainer maintainer;
+   struct slab_automove automove;
 };
 
 
@@ -351,3 +430,16 @@ void item_scrubber_main(struct default_engine *engine);
  * @return true if the scrubber has been invoked
  */
 bool item_start_scrub(struct default_engine *engine);
+
+/**
+ * Start the LRU maintainer thread for the engine
+ * @param engine handle to the storage engine
+ * @return ENGINE_SUCCESS, or ENGINE_FAILED if the thread couldn't be created
+ */
+ENGINE_ERROR_CODE item_lru_maintainer_start(struct default_engine* engine);
+
+/**
+ * Stop (and join) the engine's LRU maintainer thread, if it is running
+ * @param engine handle to the storage engine
+ */
+void item_lru_maintainer_stop(struct default_engine* engine);
@@ -10,12 +10,14 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <logger/logger.h>
 #include <platform/cb_malloc.h>
 #include <platform/cbassert.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #ifdef VALGRIND
 // switch to malloc if VALGRIND so we can get some useful insight.
@@ -176,16 +178,40 @@ static int grow_slab_list (struct default_engine *engine, const unsigned int id)
     return 1;
 }
 
+/*
+ * The size of the pages of a slab class. All pages have the same size when
+ * they may be moved between the classes.
+ */
+static size_t slab_page_size(struct default_engine *engine,
+                             const slabclass_t *p) {
+    if (engine->config.slab_automove) {
+        return engine->config.item_size_max;
+    }
+    return p->size * p->perslab;
+}
+
+/* Check if ptr points into the chunks of the given page of a slab class */
+static bool slab_page_contains(const slabclass_t *p,
+                               const char *page,
+                               const void *ptr) {
+    const char *chunk = static_cast<const char*>(ptr);
+    return chunk >= page && chunk < page + p->size * p->perslab;
+}
+
 static int do_slabs_newslab(struct default_engine *engine, const unsigned int id) {
     slabclass_t *p = &engine->slabs.slabclass[id];
-    int len = p->size * p->perslab;
+    int len = (int)slab_page_size(engine, p);
     char *ptr;
 
-    if ((engine->slabs.mem_limit && engine->slabs.mem_malloced + len > engine->slabs.mem_limit && p->slabs > 0) ||
-        (grow_slab_list(engine, id) == 0) ||
-        ((ptr = static_cast<char*>(memory_allocate(engine, (size_t)len))) == 0)) {
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        if ((engine->slabs.mem_limit && engine->slabs.mem_malloced + len > engine->slabs.mem_limit && p->slabs > 0) ||
+            (grow_slab_list(engine, id) == 0) ||
+            ((ptr = static_cast<char*>(memory_allocate(engine, (size_t)len))) == 0)) {
 
-        return 0;
+            return 0;
+        }
+        engine->slabs.mem_malloced += len;
     }
 
     memset(ptr, 0, (size_t)len);
@@ -193,7 +219,6 @@ static int do_slabs_newslab(struct default_engine *engine, const unsigned int id
     p->end_page_free = p->perslab;
 
     p->slab_list[p->slabs++] = ptr;
-    engine->slabs.mem_malloced += len;
 
     return 1;
 }
@@ -210,11 +235,14 @@ static void *do_slabs_alloc(struct default_engine *engine, const size_t size, un
     p = &engine->slabs.slabclass[id];
 
 #ifdef USE_SYSTEM_MALLOC
-    if (engine->slabs.mem_limit && engine->slabs.mem_malloced + size > engine->slabs.mem_limit) {
-        MEMCACHED_SLABS_ALLOCATE_FAILED(size, id);
-        return 0;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        if (engine->slabs.mem_limit && engine->slabs.mem_malloced + size > engine->slabs.mem_limit) {
+            MEMCACHED_SLABS_ALLOCATE_FAILED(size, id);
+            return 0;
+        }
+        engine->slabs.mem_malloced += size;
     }
-    engine->slabs.mem_malloced += size;
     ret = cb_calloc(1, size);
     MEMCACHED_SLABS_ALLOCATE(size, id, 0, ret);
     return ret;
@@ -247,6 +275,21 @@ static void *do_slabs_alloc(struct default_engine *engine, const size_t size, un
     return ret;
 }
 
+/* Put a chunk on the freelist of a slab class */
+static bool slabs_freelist_push(slabclass_t *p, void *ptr) {
+    if (p->sl_curr == p->sl_total) { /* need more space on the free list */
+        int new_size = (p->sl_total != 0) ? p->sl_total * 2 : 16;  /* 16 is arbitrary */
+        void **new_slots = static_cast<void**>(cb_realloc(p->slots,
+                                               new_size * sizeof(void *)));
+        if (new_slots == 0)
+            return false;
+        p->slots = new_slots;
+        p->sl_total = new_size;
+    }
+    p->slots[p->sl_curr++] = ptr;
+    return true;
+}
+
 static void do_slabs_free(struct default_engine *engine, void *ptr, const size_t size, unsigned int id) {
     slabclass_t *p;
 
@@ -256,21 +299,24 @@ static void do_slabs_free(struct default_engine *engine, void *ptr, const size_t
     p = &engine->slabs.slabclass[id];
 
 #ifdef USE_SYSTEM_MALLOC
-    engine->slabs.mem_malloced -= size;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        engine->slabs.mem_malloced -= size;
+    }
     cb_free(ptr);
     return;
 #endif
 
-    if (p->sl_curr == p->sl_total) { /* need more space on the free list */
-        int new_size = (p->sl_total != 0) ? p->sl_total * 2 : 16;  /* 16 is arbitrary */
-        void **new_slots = static_cast<void**>(cb_realloc(p->slots,
-                                               new_size * sizeof(void *)));
-        if (new_slots == 0)
-            return;
-        p->slots = new_slots;
-        p->sl_total = new_size;
+    if (engine->slabs.rebalance.src == id &&
+        slab_page_contains(p, engine->slabs.rebalance.page, ptr)) {
+        /* The page is being moved to another class, don't hand the chunk
+         * out again */
+        p->requested -= size;
+        return;
     }
-    p->slots[p->sl_curr++] = ptr;
+
+    if (!slabs_freelist_push(p, ptr))
+        return;
     p->requested -= size;
     return;
 }
@@ -334,6 +380,7 @@ static void do_slabs_stats(struct default_engine* engine,
     unsigned int total = 0;
 
     for(i = POWER_SMALLEST; i <= engine->slabs.power_largest; i++) {
+        std::lock_guard<std::mutex> guard(engine->slabs.class_locks[i]);
         slabclass_t *p = &engine->slabs.slabclass[i];
         if (p->slabs != 0) {
             uint32_t perslab, slabs;
@@ -363,9 +410,34 @@ static void do_slabs_stats(struct default_engine* engine,
 
     /* add overall slab stats and append terminator */
 
+    uint64_t malloced;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        malloced = engine->slabs.mem_malloced;
+    }
     add_statistics(cookie, add_stats, NULL, -1, "active_slabs", "%d", total);
     add_statistics(cookie, add_stats, NULL, -1, "total_malloced", "%" PRIu64,
-                   (uint64_t)engine->slabs.mem_malloced);
+                   malloced);
+
+    const auto& rebal = engine->slabs.rebalance;
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_running", "%u",
+                   rebal.src.load() != 0 ? 1u : 0u);
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_last_src",
+                   "%u", rebal.last_src.load());
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_last_dst",
+                   "%u", rebal.last_dst.load());
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_started",
+                   "%" PRIu64, rebal.started.load());
+    add_statistics(cookie, add_stats, NULL, -1, "slabs_moved", "%" PRIu64,
+                   rebal.moved.load());
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_aborted",
+                   "%" PRIu64, rebal.aborted.load());
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_rescues",
+                   "%" PRIu64, rebal.rescues.load());
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_evictions",
+                   "%" PRIu64, rebal.evictions.load());
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_busy_items",
+                   "%" PRIu64, rebal.busy_items.load());
 }
 
 static void *memory_allocate(struct default_engine *engine, size_t size) {
@@ -398,32 +470,215 @@ static void *memory_allocate(struct default_engine *engine, size_t size) {
 }
 
 void *slabs_alloc(struct default_engine *engine, size_t size, unsigned int id) {
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
+    if (id < POWER_SMALLEST || id > engine->slabs.power_largest) {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[id]);
     return do_slabs_alloc(engine, size, id);
 }
 
 void slabs_free(struct default_engine *engine, void *ptr, size_t size, unsigned int id) {
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
+    if (id < POWER_SMALLEST || id > engine->slabs.power_largest) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[id]);
     do_slabs_free(engine, ptr, size, id);
 }
 
+bool slabs_low_on_memory(struct default_engine *engine, unsigned int id) {
+    if (id < POWER_SMALLEST || id > engine->slabs.power_largest) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[id]);
+    slabclass_t *p = &engine->slabs.slabclass[id];
+#ifdef USE_SYSTEM_MALLOC
+    std::lock_guard<std::mutex> mem_guard(engine->slabs.lock);
+    return engine->slabs.mem_limit &&
+           engine->slabs.mem_malloced + p->size * SLABS_LOW_WATERMARK >
+                   engine->slabs.mem_limit;
+#else
+    unsigned int free_chunks = p->sl_curr;
+    if (p->end_page_ptr != 0) {
+        free_chunks += p->end_page_free;
+    }
+    if (free_chunks >= std::min(p->perslab, SLABS_LOW_WATERMARK)) {
+        return false;
+    }
+
+    /* same test as do_slabs_newslab uses to refuse a new page */
+    std::lock_guard<std::mutex> mem_guard(engine->slabs.lock);
+    size_t len = slab_page_size(engine, p);
+    return engine->slabs.mem_limit &&
+           engine->slabs.mem_malloced + len > engine->slabs.mem_limit &&
+           p->slabs > 0;
+#endif
+}
+
+bool slabs_reassign_start(struct default_engine *engine,
+                          unsigned int src,
+                          unsigned int dst) {
+#ifdef USE_SYSTEM_MALLOC
+    return false;
+#else
+    auto& rebal = engine->slabs.rebalance;
+    if (!engine->config.slab_automove || src == dst ||
+        src < POWER_SMALLEST || src > engine->slabs.power_largest ||
+        dst < POWER_SMALLEST || dst > engine->slabs.power_largest ||
+        rebal.src != 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[src]);
+    slabclass_t *p = &engine->slabs.slabclass[src];
+    if (p->slabs < 2) {
+        return false;
+    }
+
+    char *page = static_cast<char*>(p->slab_list[0]);
+
+    /* Take the free chunks of the page off the freelist... */
+    unsigned int kept = 0;
+    for (unsigned int ii = 0; ii < p->sl_curr; ++ii) {
+        if (!slab_page_contains(p, page, p->slots[ii])) {
+            p->slots[kept++] = p->slots[ii];
+        }
+    }
+    p->sl_curr = kept;
+
+    /* ...and the ones never handed out, which we mark as free */
+    if (p->end_page_ptr != 0 && slab_page_contains(p, page, p->end_page_ptr)) {
+        char *chunk = static_cast<char*>(p->end_page_ptr);
+        for (unsigned int ii = 0; ii < p->end_page_free; ++ii) {
+            reinterpret_cast<hash_item*>(chunk)->iflag = ITEM_SLABBED;
+            chunk += p->size;
+        }
+        p->end_page_ptr = 0;
+        p->end_page_free = 0;
+    }
+
+    rebal.dst = dst;
+    rebal.page = page;
+    rebal.busy_passes = 0;
+    rebal.src = src;
+
+    rebal.last_src = src;
+    rebal.last_dst = dst;
+    rebal.started++;
+    return true;
+#endif
+}
+
+bool slabs_reassign_page(struct default_engine *engine,
+                         unsigned int *id,
+                         char **page,
+                         unsigned int *size,
+                         unsigned int *chunks) {
+    const auto& rebal = engine->slabs.rebalance;
+    const unsigned int src = rebal.src;
+    if (src == 0) {
+        return false;
+    }
+    *id = src;
+    *page = rebal.page;
+    *size = engine->slabs.slabclass[src].size;
+    *chunks = engine->slabs.slabclass[src].perslab;
+    return true;
+}
+
+/* Give the page being moved back to its class */
+static void slabs_reassign_abort(struct default_engine *engine) {
+    auto& rebal = engine->slabs.rebalance;
+    const unsigned int src = rebal.src;
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[src]);
+    slabclass_t *p = &engine->slabs.slabclass[src];
+
+    char *chunk = rebal.page;
+    for (unsigned int ii = 0; ii < p->perslab; ++ii) {
+        if ((reinterpret_cast<hash_item*>(chunk)->iflag & ITEM_SLABBED) != 0) {
+            slabs_freelist_push(p, chunk);
+        }
+        chunk += p->size;
+    }
+
+    rebal.src = 0;
+    rebal.page = nullptr;
+    rebal.aborted++;
+}
+
+void slabs_reassign_pass(struct default_engine *engine, bool clean) {
+    auto& rebal = engine->slabs.rebalance;
+    const unsigned int src = rebal.src;
+    const unsigned int dst = rebal.dst;
+    if (src == 0) {
+        return;
+    }
+
+    if (!clean) {
+        if (++rebal.busy_passes > SLAB_REASSIGN_MAX_BUSY_PASSES) {
+            LOG_WARNING("Giving up moving a page from slab class {} to {}, "
+                        "it has items which stay in use",
+                        src,
+                        dst);
+            slabs_reassign_abort(engine);
+        }
+        return;
+    }
+
+    /* This is the only place we hold two class locks at once */
+    std::unique_lock<std::mutex> src_guard(engine->slabs.class_locks[src],
+                                           std::defer_lock);
+    std::unique_lock<std::mutex> dst_guard(engine->slabs.class_locks[dst],
+                                           std::defer_lock);
+    std::lock(src_guard, dst_guard);
+
+    slabclass_t *s = &engine->slabs.slabclass[src];
+    slabclass_t *d = &engine->slabs.slabclass[dst];
+    if (d->end_page_ptr != 0 || grow_slab_list(engine, dst) == 0) {
+        /* Try again on the next pass once dst used up its end page */
+        return;
+    }
+
+    for (unsigned int ii = 0; ii < s->slabs; ++ii) {
+        if (s->slab_list[ii] == rebal.page) {
+            s->slab_list[ii] = s->slab_list[--s->slabs];
+            break;
+        }
+    }
+
+    memset(rebal.page, 0, slab_page_size(engine, d));
+    d->end_page_ptr = rebal.page;
+    d->end_page_free = d->perslab;
+    d->slab_list[d->slabs++] = rebal.page;
+
+    rebal.src = 0;
+    rebal.page = nullptr;
+    rebal.moved++;
+}
+
+unsigned int slabs_class_pages(struct default_engine *engine, unsigned int id) {
+    if (id < POWER_SMALLEST || id > engine->slabs.power_largest) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[id]);
+    return engine->slabs.slabclass[id].slabs;
+}
+
 void slabs_stats(struct default_engine* engine,
                  const AddStatFn& add_stats,
                  const void* c) {
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
     do_slabs_stats(engine, add_stats, c);
 }
 
 void slabs_adjust_mem_requested(struct default_engine *engine, unsigned int id, size_t old, size_t ntotal)
 {
     slabclass_t *p;
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
     if (id < POWER_SMALLEST || id > engine->slabs.power_largest) {
         throw std::invalid_argument(
                 "slabs_adjust_mem_requested: Internal error! Invalid slab "
                 "class");
     }
 
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[id]);
     p = &engine->slabs.slabclass[id];
     p->requested = p->requested - old + ntotal;
 }
@@ -4,6 +4,7 @@
 #include <memcached/engine_common.h>
 #include <memcached/engine_error.h>
 
+#include <atomic>
 #include <mutex>
 
 /* Slab sizing definitions. */
@@ -13,6 +14,12 @@
 #define DONT_PREALLOC_SLABS
 #define MAX_NUMBER_OF_SLAB_CLASSES (POWER_LARGEST + 1)
 
+/* Free chunks a slab class should keep before it counts as low on memory */
+#define SLABS_LOW_WATERMARK 8u
+
+/* Passes over a page being moved which found busy items before we give up */
+#define SLAB_REASSIGN_MAX_BUSY_PASSES 1000
+
 /* powers-of-N allocation structures */
 
 typedef struct {
@@ -52,9 +59,39 @@ struct slabs {
    } allocs;
 
    /**
-    * Access to the slab allocator is protected by this lock
+    * Access to each slab class is protected by its own lock, so allocations
+    * of different sizes don't contend.
+    */
+   std::mutex class_locks[MAX_NUMBER_OF_SLAB_CLASSES];
+
+   /**
+    * Protects the memory shared by all slab classes (mem_malloced, mem_base,
+    * mem_current, mem_avail and allocs). Taken after a class lock.
     */
    std::mutex lock;
+
+   /**
+    * A page being moved from slab class src to dst by the slab automover.
+    * src is 0 when no page is being moved, and is only changed with its
+    * class lock held (so a thread holding a class lock may check if that
+    * class' page is being moved). The rest is only used by the thread
+    * moving the page (the LRU maintainer), apart from the counters.
+    */
+   struct {
+      std::atomic<unsigned int> src{0};
+      unsigned int dst{0};
+      char *page{nullptr};
+      unsigned int busy_passes{0};
+
+      std::atomic<unsigned int> last_src{0};
+      std::atomic<unsigned int> last_dst{0};
+      std::atomic<uint64_t> started{0};
+      std::atomic<uint64_t> moved{0};
+      std::atomic<uint64_t> aborted{0};
+      std::atomic<uint64_t> rescues{0};
+      std::atomic<uint64_t> evictions{0};
+      std::atomic<uint64_t> busy_items{0};
+   } rebalance;
 };
 
 
@@ -89,6 +126,51 @@ void slabs_free(struct default_engine *engine, void *ptr, size_t size, unsigned
 /** Adjust the stats for memory requested */
 void slabs_adjust_mem_requested(struct default_engine *engine, unsigned int id, size_t old, size_t ntotal);
 
+/**
+ * Check if the slab class is about to run out of memory: it has fewer than
+ * SLABS_LOW_WATERMARK free chunks left and may not allocate another page.
+ * Used by the LRU maintainer to evict ahead of the allocations.
+ */
+bool slabs_low_on_memory(struct default_engine *engine, unsigned int id);
+
+/**
+ * Start moving a page from slab class src to dst. The page is taken off
+ * the allocator of src at once: its free chunks are never handed out
+ * again, and chunks freed in it are not reused.
+ * Live items in it have to be relocated (or evicted) by the caller before
+ * the page is given to dst, see slabs_reassign_page / slabs_reassign_pass.
+ * @return false if a page is already being moved, src has less than two
+ *         pages or slab automove is disabled
+ */
+bool slabs_reassign_start(struct default_engine *engine,
+                          unsigned int src,
+                          unsigned int dst);
+
+/**
+ * Get the page currently being moved (if any)
+ * @param id set to the class the page is moved from
+ * @param page set to the start of the page
+ * @param size set to the size of the chunks in the page
+ * @param chunks set to the number of chunks in the page
+ * @return true if a page is being moved
+ */
+bool slabs_reassign_page(struct default_engine *engine,
+                         unsigned int *id,
+                         char **page,
+                         unsigned int *size,
+                         unsigned int *chunks);
+
+/**
+ * Report the result of a pass over all of the chunks of the page being
+ * moved. Once a pass found all of them free the page is given to the
+ * destination class; if it keeps finding items in use the move is aborted
+ * after SLAB_REASSIGN_MAX_BUSY_PASSES passes.
+ */
+void slabs_reassign_pass(struct default_engine *engine, bool clean);
+
+/** Get the number of pages held by a slab class */
+unsigned int slabs_class_pages(struct default_engine *engine, unsigned int id);
+
 /** Fill buffer with stats */ /*@null@*/
 void slabs_stats(struct default_engine* engine,
                  const AddStatFn& add_stats,
@@ -29,6 +29,7 @@
 #include "engine_fixture.h"
 #include "item.h"
 #include "kv_bucket.h"
+#include "mutation_log.h"
 
 class AccessLogBenchEngine : public EngineFixture {
 protected:
@@ -38,7 +39,7 @@ protected:
         memoryTracker->reset();
 
         // If the access scanner is running then it will always scan
-        varConfig = "alog_resident_ratio_threshold=100;";
+        varConfig = extraConfig + "alog_resident_ratio_threshold=100;";
         varConfig += "alog_max_stored_items=" +
                      std::to_string(alog_max_stored_items);
         EngineFixture::SetUp(state);
@@ -53,9 +54,24 @@ protected:
 
     const size_t alog_max_stored_items = 2048;
 
+    /// Additional configuration (set by the derived fixtures)
+    std::string extraConfig;
+
     BenchmarkMemoryTracker* memoryTracker;
 };
 
+/// Fixture which writes the access log, using the write buffer size given by
+/// range(0)
+class AccessLogWriteBenchEngine : public AccessLogBenchEngine {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        extraConfig = "max_num_shards=1;alog_path=benchmarks-test/access.log;";
+        extraConfig += "alog_write_buffer_size=" +
+                       std::to_string(state.range(0)) + ";";
+        AccessLogBenchEngine::SetUp(state);
+    }
+};
+
 /*
  * Varies whether the access scanner is running or not. Also varies the
  * number of items stored in the vbucket. The purpose of this benchmark is to
@@ -114,3 +130,64 @@ static void AccessScannerArguments(benchmark::internal::Benchmark* b) {
 BENCHMARK_REGISTER_F(AccessLogBenchEngine, MemoryOverhead)
         ->Apply(AccessScannerArguments)
         ->MinTime(0.000001);
+
+/*
+ * Measures the time to generate the access log (visiting the items and
+ * writing the log).
+ * Variables:
+ *  - range(0) : The size of the writes (0 writes every block separately)
+ *  - range(1) : The number of items to fill the vbucket with
+ */
+BENCHMARK_DEFINE_F(AccessLogWriteBenchEngine, GenerateLog)
+(benchmark::State& state) {
+    engine->getKVBucket()->setVBucketState(Vbid(0), vbucket_state_active);
+
+    std::string value(200, 'x');
+    std::string keyPrefixPre(20, 'a');
+    for (int i = 0; i < state.range(1); ++i) {
+        auto item = make_item(vbid, keyPrefixPre + std::to_string(i), value);
+        engine->getKVBucket()->set(item, cookie);
+    }
+
+    ExTask task = std::make_shared<AccessScanner>(*(engine->getKVBucket()),
+                                                  engine->getConfiguration(),
+                                                  engine->getEpStats(),
+                                                  1000);
+    ExecutorPool::get()->schedule(task);
+    while (state.KeepRunning()) {
+        executorPool->wake(task->getId());
+        executorPool->runNextTask(AUXIO_TASK_IDX, "Generating access log");
+        executorPool->runNextTask(AUXIO_TASK_IDX,
+                                  "Item Access Scanner on vb:0");
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+BENCHMARK_REGISTER_F(AccessLogWriteBenchEngine, GenerateLog)
+        ->ArgPair(0, 65536)
+        ->ArgPair(1024 * 1024, 65536)
+        ->ArgPair(0, 262144)
+        ->ArgPair(1024 * 1024, 262144);
+
+/*
+ * Measures checksumming an access log block, which loading the log (at
+ * warmup) does for every block.
+ * Variables:
+ *  - range(0) : The log version (4: CRC32, 5: CRC32C)
+ */
+static void AccessLogBlockChecksum(benchmark::State& state) {
+    const auto version = MutationLogVersion(state.range(0));
+    state.SetLabel(version >= MutationLogVersion::V5 ? "CRC32C" : "CRC32");
+
+    std::vector<uint8_t> block(MIN_LOG_HEADER_SIZE);
+    for (size_t ii = 0; ii < block.size(); ++ii) {
+        block[ii] = uint8_t(ii * 31);
+    }
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(MutationLog::blockChecksum(
+                version, block.data(), block.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * block.size());
+}
+
+BENCHMARK(AccessLogBlockChecksum)->Arg(4)->Arg(5);
@@ -43,6 +43,8 @@ public:
 
     size_t getMaxAlloc();
     size_t getCurrentAlloc();
+    /// @return the number of allocations made since the last reset
+    size_t getNumAllocations();
 
 private:
     BenchmarkMemoryTracker(const ServerAllocatorIface& hooks_api);
@@ -55,4 +57,5 @@ private:
     ServerAllocatorIface hooks_api;
     static std::atomic<size_t> maxTotalAllocation;
     static std::atomic<size_t> currentAlloc;
+    static std::atomic<size_t> numAllocations;
 };
@@ -0,0 +1,300 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of the disk read paths - GETs of non-resident documents (via
+ * the BgFetcher and KVStore::getMulti), GETs of missing keys (the bloom
+ * filter) and warmup - against buckets evicted to a target resident ratio.
+ */
+
+#include "bgfetcher.h"
+#include "engine_fixture.h"
+#include "ep_bucket.h"
+#include "fakes/fake_executorpool.h"
+#include "item.h"
+#include "kv_bucket.h"
+#include "kvshard.h"
+#include "tests/mock/mock_global_task.h"
+#include "vbucket.h"
+
+#include <folly/portability/GTest.h>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+static std::string to_string(EvictionPolicy policy) {
+    return policy == EvictionPolicy::Full ? "full_eviction" : "value_only";
+}
+
+class BgFetchBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        policy = state.range(0) ? EvictionPolicy::Full : EvictionPolicy::Value;
+        varConfig = "backend=couchdb;max_size=1000000000;"
+                    "item_eviction_policy=" +
+                    to_string(policy);
+        EngineFixture::SetUp(state);
+        if (state.thread_index == 0) {
+            engine->getKVBucket()->setVBucketState(vbid,
+                                                   vbucket_state_active);
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      engine->getKVBucket()->deleteVBucket(vbid, nullptr));
+            executorPool->runNextTask(
+                    AUXIO_TASK_IDX,
+                    "Removing (dead) vb:0 from memory and disk");
+        }
+        EngineFixture::TearDown(state);
+    }
+
+    static std::string makeKey(size_t i) {
+        return "key" + std::to_string(i);
+    }
+
+    /**
+     * Store and persist itemCount documents, then evict documents until
+     * (approximately) residentPercent of them remain resident.
+     */
+    void populate(size_t itemCount, size_t residentPercent) {
+        // Pre-size the HashTable so resizing doesn't skew the results.
+        engine->getKVBucket()->getVBucket(vbid)->ht.resize(itemCount);
+        const std::string value(256, 'x');
+        for (size_t i = 0; i < itemCount; ++i) {
+            auto item = make_item(vbid, makeKey(i), value);
+            ASSERT_EQ(ENGINE_SUCCESS, engine->getKVBucket()->set(item, cookie));
+        }
+        flushAllItems();
+
+        for (size_t i = 0; i < itemCount; ++i) {
+            if (i % 100 >= residentPercent) {
+                evict(makeKey(i));
+            }
+        }
+    }
+
+    void flushAllItems() {
+        auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+        bool moreAvailable;
+        do {
+            std::tie(moreAvailable, std::ignore) = ep.flushVBucket(vbid);
+        } while (moreAvailable);
+    }
+
+    void evict(const std::string& key) {
+        const char* msg;
+        ASSERT_EQ(cb::mcbp::Status::Success,
+                  engine->getKVBucket()->evictKey(
+                          {key, DocKeyEncodesCollectionId::No}, vbid, &msg));
+    }
+
+    GetValue get(const std::string& key) {
+        const auto options = static_cast<get_options_t>(
+                QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | DELETE_TEMP |
+                HIDE_LOCKED_CAS | TRACK_STATISTICS);
+        return engine->getKVBucket()->get(
+                {key, DocKeyEncodesCollectionId::No}, vbid, cookie, options);
+    }
+
+    /// Run the BgFetcher once, fetching all of the queued keys.
+    void runBGFetcher() {
+        MockGlobalTask mockTask(engine->getTaskable(),
+                                TaskId::MultiBGFetcherTask);
+        static_cast<EPBucket&>(*engine->getKVBucket())
+                .getBgFetcher(vbid)
+                ->run(&mockTask);
+    }
+
+    EvictionPolicy policy;
+};
+
+/*
+ * GETs spread over all of the documents of a bucket at the given resident
+ * ratio; every GET of a non-resident document goes through the BgFetcher.
+ * Arguments: eviction policy (0 = value, 1 = full), resident percent.
+ */
+BENCHMARK_DEFINE_F(BgFetchBench, GetAtResidentRatio)
+(benchmark::State& state) {
+    const size_t itemCount = 10000;
+    populate(itemCount, state.range(1));
+
+    size_t bgFetches = 0;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const auto key = makeKey(i++ % itemCount);
+        auto gv = get(key);
+        if (gv.getStatus() == ENGINE_EWOULDBLOCK) {
+            runBGFetcher();
+            gv = get(key);
+            ++bgFetches;
+
+            // Evict the document again to keep the resident ratio.
+            state.PauseTiming();
+            ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+            evict(key);
+            state.ResumeTiming();
+        }
+        ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(to_string(policy).c_str());
+    state.counters["BgFetches"] = bgFetches;
+}
+
+/*
+ * Batches of GETs of non-resident documents, fetched from disk by a single
+ * BgFetcher run (i.e. a single KVStore::getMulti).
+ * Arguments: eviction policy (0 = value, 1 = full), batch size.
+ */
+BENCHMARK_DEFINE_F(BgFetchBench, BatchedBgFetch)
+(benchmark::State& state) {
+    const size_t itemCount = 10000;
+    const size_t batchSize = state.range(1);
+    populate(itemCount, 0);
+
+    std::vector<std::string> keys;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        keys.clear();
+        for (size_t b = 0; b < batchSize; ++b) {
+            keys.push_back(makeKey(i++ % itemCount));
+            ASSERT_EQ(ENGINE_EWOULDBLOCK, get(keys.back()).getStatus());
+        }
+        runBGFetcher();
+        for (const auto& key : keys) {
+            ASSERT_EQ(ENGINE_SUCCESS, get(key).getStatus());
+        }
+
+        state.PauseTiming();
+        for (const auto& key : keys) {
+            evict(key);
+        }
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * batchSize);
+    state.SetLabel(to_string(policy).c_str());
+}
+
+/*
+ * GETs of keys which don't exist. Under full eviction these are answered
+ * by the bloom filter without touching disk.
+ * Arguments: eviction policy (0 = value, 1 = full), unused.
+ */
+BENCHMARK_DEFINE_F(BgFetchBench, GetMissing)
+(benchmark::State& state) {
+    const size_t itemCount = 10000;
+    populate(itemCount, 0);
+
+    size_t bgFetches = 0;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const auto key = "missing" + std::to_string(i++);
+        auto gv = get(key);
+        if (gv.getStatus() == ENGINE_EWOULDBLOCK) {
+            // Bloom filter false positive
+            runBGFetcher();
+            gv = get(key);
+            ++bgFetches;
+        }
+        ASSERT_EQ(ENGINE_KEY_ENOENT, gv.getStatus());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(to_string(policy).c_str());
+    state.counters["BgFetches"] = bgFetches;
+}
+
+/*
+ * Warmup of a bucket with the given number of (persisted) documents.
+ * Arguments: eviction policy (0 = value, 1 = full), number of documents.
+ */
+BENCHMARK_DEFINE_F(BgFetchBench, Warmup)
+(benchmark::State& state) {
+    const size_t itemCount = state.range(1);
+    populate(itemCount, 100);
+
+    auto& readerQueue = *executorPool->getLpTaskQ()[READER_TASK_IDX];
+    while (state.KeepRunning()) {
+        // Replace the engine with one which warms up from the same files.
+        state.PauseTiming();
+        engine->getEpStats().isShutdown = true;
+        executorPool->cancelAndClearAll();
+        for (task_type_t t : {WRITER_TASK_IDX,
+                              READER_TASK_IDX,
+                              AUXIO_TASK_IDX,
+                              NONIO_TASK_IDX}) {
+            auto& queue = *executorPool->getLpTaskQ()[t];
+            while (queue.getFutureQueueSize() > 0 ||
+                   queue.getReadyQueueSize() > 0) {
+                CheckedExecutor executor(executorPool, queue);
+                executor.runCurrentTask();
+                executor.completeCurrentTask();
+            }
+            executorPool->stopTaskGroup(engine->getTaskable().getGID(),
+                                        t,
+                                        engine->getEpStats().forceShutdown);
+        }
+        engine.reset();
+
+        engine = SynchronousEPEngine::build(
+                "dbname=benchmarks-test;ht_locks=47;" + varConfig +
+                ";warmup=true");
+        auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+        ep.initializeWarmupTask();
+        ep.startWarmupTask();
+        state.ResumeTiming();
+
+        while (ep.isWarmingUp()) {
+            CheckedExecutor executor(executorPool, readerQueue);
+            executor.runCurrentTask();
+            executor.completeCurrentTask();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * itemCount);
+    state.SetLabel(to_string(policy).c_str());
+}
+
+static void ResidentRatioArguments(benchmark::internal::Benchmark* b) {
+    for (int policy : {0, 1}) {
+        for (int resident : {100, 50, 10, 0}) {
+            b->ArgPair(policy, resident);
+        }
+    }
+}
+
+BENCHMARK_REGISTER_F(BgFetchBench, GetAtResidentRatio)
+        ->Apply(ResidentRatioArguments);
+
+BENCHMARK_REGISTER_F(BgFetchBench, BatchedBgFetch)
+        ->ArgPair(0, 1)
+        ->ArgPair(0, 32)
+        ->ArgPair(1, 1)
+        ->ArgPair(1, 32);
+
+BENCHMARK_REGISTER_F(BgFetchBench, GetMissing)->ArgPair(0, 0)->ArgPair(1, 0);
+
+BENCHMARK_REGISTER_F(BgFetchBench, Warmup)
+        ->ArgPair(0, 10000)
+        ->ArgPair(1, 10000)
+        ->Iterations(5);
@@ -21,9 +21,13 @@
 
 #include "atomic.h"
 #include "checkpoint_iterator.h"
+#include "chunked_queue.h"
 
 #include <benchmark/benchmark.h>
+#include <utilities/memory_tracking_allocator.h>
 #include <list>
+#include <memory>
+#include <vector>
 
 typedef std::unique_ptr<int> TestItem;
 typedef std::list<TestItem> ListContainer;
@@ -59,3 +63,110 @@ static void BM_CheckpointIteratorCompare(benchmark::State& state) {
 
 // Register the function as a benchmark
 BENCHMARK(BM_CheckpointIteratorCompare);
+
+/*
+ * Benchmarks comparing the container previously used for the CheckpointQueue
+ * (std::list) against the ChunkedQueue now used, for the operations a
+ * Checkpoint performs on it. The items are refcounted pointers, as the
+ * queued_items in a Checkpoint are.
+ */
+typedef std::shared_ptr<int> QueueItem;
+typedef std::list<QueueItem, MemoryTrackingAllocator<QueueItem>> ListQueue;
+typedef ChunkedQueue<QueueItem, MemoryTrackingAllocator<QueueItem>>
+        ChunkedCheckpointQueue;
+
+template <typename Queue>
+static void fillQueue(Queue& queue, size_t count) {
+    for (size_t ii = 0; ii < count; ++ii) {
+        queue.push_back(std::make_shared<int>(ii));
+    }
+}
+
+/**
+ * Benchmark walking a cursor (CheckpointIterator) over a queue of
+ * state.range(0) items, as CheckpointManager::getItemsForCursor does - and
+ * report the bytes allocated by the queue per item.
+ */
+template <typename Queue>
+static void BM_CheckpointQueueCursorWalk(benchmark::State& state) {
+    MemoryTrackingAllocator<QueueItem> allocator;
+    Queue queue(allocator);
+    const size_t count = state.range(0);
+    fillQueue(queue, count);
+
+    using Iterator = CheckpointIterator<Queue>;
+    const Iterator end(queue, Iterator::Position::end);
+    while (state.KeepRunning()) {
+        for (Iterator cursor(queue, Iterator::Position::begin); cursor != end;
+             ++cursor) {
+            benchmark::DoNotOptimize((*cursor).get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["QueueBytesPerItem"] =
+            *allocator.getBytesAllocated() / double(count);
+}
+BENCHMARK_TEMPLATE(BM_CheckpointQueueCursorWalk, ListQueue)
+        ->Range(64, 64 * 1024);
+BENCHMARK_TEMPLATE(BM_CheckpointQueueCursorWalk, ChunkedCheckpointQueue)
+        ->Range(64, 64 * 1024);
+
+/**
+ * Benchmark queueing state.range(0) items and then removing all of them
+ * from the front (as expelling items from, or removing a closed unreferenced
+ * checkpoint does).
+ */
+template <typename Queue>
+static void BM_CheckpointQueuePushAndExpel(benchmark::State& state) {
+    MemoryTrackingAllocator<QueueItem> allocator;
+    Queue queue(allocator);
+    const size_t count = state.range(0);
+    // Items are created up front, so only the queue operations are timed.
+    std::vector<QueueItem> items;
+    for (size_t ii = 0; ii < count; ++ii) {
+        items.push_back(std::make_shared<int>(ii));
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& item : items) {
+            queue.push_back(item);
+        }
+        queue.erase(queue.begin(), queue.end());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK_TEMPLATE(BM_CheckpointQueuePushAndExpel, ListQueue)
+        ->Range(64, 64 * 1024);
+BENCHMARK_TEMPLATE(BM_CheckpointQueuePushAndExpel, ChunkedCheckpointQueue)
+        ->Range(64, 64 * 1024);
+
+/**
+ * Benchmark de-duplication: each iteration queues a new item and erases the
+ * oldest instance of the same key from the middle of the queue, as
+ * Checkpoint::queueDirty does. The queue holds state.range(0) keys.
+ */
+template <typename Queue>
+static void BM_CheckpointQueueDedupe(benchmark::State& state) {
+    MemoryTrackingAllocator<QueueItem> allocator;
+    Queue queue(allocator);
+    const size_t count = state.range(0);
+    std::vector<typename Queue::iterator> positions;
+    for (size_t ii = 0; ii < count; ++ii) {
+        queue.push_back(std::make_shared<int>(ii));
+        positions.push_back(std::prev(queue.end()));
+    }
+
+    auto item = std::make_shared<int>(0);
+    size_t key = 0;
+    while (state.KeepRunning()) {
+        queue.push_back(item);
+        queue.erase(positions[key]);
+        positions[key] = std::prev(queue.end());
+        key = (key + 1) % count;
+    }
+    state.counters["QueueBytesPerItem"] =
+            *allocator.getBytesAllocated() / double(count);
+}
+BENCHMARK_TEMPLATE(BM_CheckpointQueueDedupe, ListQueue)->Range(64, 64 * 1024);
+BENCHMARK_TEMPLATE(BM_CheckpointQueueDedupe, ChunkedCheckpointQueue)
+        ->Range(64, 64 * 1024);
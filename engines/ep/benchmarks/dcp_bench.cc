@@ -0,0 +1,278 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of the DCP producer path (ActiveStream, the checkpoint
+ * processor, backfills, the ready queue and flow control) with many
+ * streams spread over a number of replica connections.
+ */
+
+#include "checkpoint_manager.h"
+#include "dcp/active_stream_checkpoint_processor_task.h"
+#include "dcp/backfill-manager.h"
+#include "engine_fixture.h"
+#include "ep_bucket.h"
+#include "failover-table.h"
+#include "item.h"
+#include "kv_bucket.h"
+#include "tests/mock/mock_dcp.h"
+#include "tests/mock/mock_dcp_producer.h"
+#include "vbucket.h"
+
+#include <folly/portability/GTest.h>
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+enum class DcpPhase {
+    // Streams are created against vbuckets whose items are only on disk
+    // (as when a new replica is built during a rebalance).
+    Backfill = 0,
+    // Established streams receive new mutations from the checkpoints (the
+    // steady state of a replica).
+    InMemory = 1
+};
+
+class DcpBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        varConfig = "backend=couchdb;max_size=1000000000";
+        EngineFixture::SetUp(state);
+        if (state.thread_index == 0) {
+            numVBuckets = state.range(0);
+            for (size_t vb = 0; vb < numVBuckets; ++vb) {
+                engine->getKVBucket()->setVBucketState(Vbid(vb),
+                                                       vbucket_state_active);
+            }
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            connections.clear();
+        }
+        EngineFixture::TearDown(state);
+    }
+
+    /// A replica connection (i.e. a DcpProducer and the client draining it)
+    struct Connection {
+        std::shared_ptr<MockDcpProducer> producer;
+        std::unique_ptr<MockDcpMessageProducers> producers;
+        /// Bytes received and not yet acknowledged
+        size_t unacked = 0;
+
+        ~Connection() {
+            if (producer) {
+                producer->closeAllStreams();
+                producer->cancelCheckpointCreatorTask();
+            }
+        }
+    };
+
+    /// Store itemsPerVBucket documents into every vbucket.
+    void loadItems(size_t itemsPerVBucket) {
+        const std::string value(256, 'x');
+        for (size_t vb = 0; vb < numVBuckets; ++vb) {
+            for (size_t i = 0; i < itemsPerVBucket; ++i) {
+                auto item = make_item(
+                        Vbid(vb), "key" + std::to_string(i), value);
+                ASSERT_EQ(ENGINE_SUCCESS,
+                          engine->getKVBucket()->set(item, cookie));
+            }
+        }
+    }
+
+    /**
+     * Persist all of the vbuckets and remove their (closed) checkpoints, so
+     * a stream from seqno 0 has to backfill from disk.
+     */
+    void flushAndRemoveCheckpoints() {
+        auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+        for (size_t vb = 0; vb < numVBuckets; ++vb) {
+            auto vbucket = engine->getKVBucket()->getVBucket(Vbid(vb));
+            vbucket->checkpointManager->createNewCheckpoint();
+            bool moreAvailable;
+            do {
+                std::tie(moreAvailable, std::ignore) =
+                        ep.flushVBucket(Vbid(vb));
+            } while (moreAvailable);
+            bool newCheckpointCreated;
+            vbucket->checkpointManager->removeClosedUnrefCheckpoints(
+                    *vbucket, newCheckpointCreated);
+        }
+    }
+
+    /// Create the connections, and a stream for every vbucket (spread
+    /// round-robin over the connections).
+    void createStreams(size_t numConnections) {
+        for (size_t c = 0; c < numConnections; ++c) {
+            auto conn = std::make_unique<Connection>();
+            conn->producer = std::make_shared<MockDcpProducer>(
+                    *engine,
+                    cookie,
+                    "replica" + std::to_string(c),
+                    /*flags*/ 0,
+                    /*startTask*/ false);
+            conn->producer->createCheckpointProcessorTask();
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      conn->producer->control(
+                              0,
+                              "connection_buffer_size",
+                              std::to_string(BufferSize)));
+            conn->producers =
+                    std::make_unique<MockDcpMessageProducers>(engine.get());
+            connections.push_back(std::move(conn));
+        }
+
+        for (size_t vb = 0; vb < numVBuckets; ++vb) {
+            auto vbucket = engine->getKVBucket()->getVBucket(Vbid(vb));
+            auto& producer = *connections[vb % numConnections]->producer;
+            uint64_t rollbackSeqno;
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      producer.streamRequest(
+                              /*flags*/ 0,
+                              /*opaque*/ vb,
+                              Vbid(vb),
+                              /*start_seqno*/ 0,
+                              /*end_seqno*/ ~0ull,
+                              vbucket->failovers->getLatestUUID(),
+                              /*snap_start_seqno*/ 0,
+                              /*snap_end_seqno*/ 0,
+                              &rollbackSeqno,
+                              mock_dcp_add_failover_log,
+                              {}));
+        }
+    }
+
+    /**
+     * Step the connections until the given number of mutations have been
+     * received, running the backfill and checkpoint processor tasks
+     * whenever no connection has anything ready. Received bytes are
+     * acknowledged (flow control) whenever half of the buffer is used.
+     *
+     * @return the number of bytes received
+     */
+    size_t drain(size_t mutations) {
+        size_t received = 0;
+        size_t bytes = 0;
+        while (received < mutations) {
+            bool progress = false;
+            for (auto& conn : connections) {
+                auto& producers = *conn->producers;
+                producers.last_op = cb::mcbp::ClientOpcode::Invalid;
+                if (conn->producer->step(&producers) != ENGINE_SUCCESS ||
+                    producers.last_op == cb::mcbp::ClientOpcode::Invalid) {
+                    continue;
+                }
+                progress = true;
+                if (producers.last_op == cb::mcbp::ClientOpcode::DcpMutation) {
+                    ++received;
+                }
+                bytes += producers.last_packet_size;
+                conn->unacked += producers.last_packet_size;
+                if (conn->unacked >= BufferSize / 2) {
+                    ack(*conn);
+                }
+            }
+
+            if (!progress) {
+                for (auto& conn : connections) {
+                    ack(*conn);
+                    conn->producer->getBFM().backfill();
+                    for (size_t shard = 0;; ++shard) {
+                        auto* task =
+                                conn->producer->getCheckpointSnapshotTask(
+                                        shard);
+                        if (!task) {
+                            break;
+                        }
+                        task->run();
+                    }
+                }
+            }
+        }
+        return bytes;
+    }
+
+    void ack(Connection& conn) {
+        if (conn.unacked) {
+            conn.producer->bufferAcknowledgement(0, Vbid(0), conn.unacked);
+            conn.unacked = 0;
+        }
+    }
+
+    static const size_t BufferSize = 10 * 1024 * 1024;
+    static const size_t ItemsPerVBucket = 100;
+    static const size_t NumConnections = 3;
+
+    size_t numVBuckets = 0;
+    std::vector<std::unique_ptr<Connection>> connections;
+};
+
+/*
+ * Stream every vbucket to NumConnections replica connections with flow
+ * control enabled, reporting items/s, bytes/s and the CPU time per item.
+ * Arguments: number of vbuckets (streams), DcpPhase.
+ */
+BENCHMARK_DEFINE_F(DcpBench, Streams)
+(benchmark::State& state) {
+    const auto phase = DcpPhase(state.range(1));
+    const size_t mutations = numVBuckets * ItemsPerVBucket;
+
+    if (phase == DcpPhase::Backfill) {
+        loadItems(ItemsPerVBucket);
+        flushAndRemoveCheckpoints();
+    } else {
+        // Establish the streams (against empty vbuckets) up front.
+        createStreams(NumConnections);
+    }
+
+    size_t totalItems = 0;
+    size_t totalBytes = 0;
+    std::clock_t cpuTicks = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        if (phase == DcpPhase::Backfill) {
+            connections.clear();
+            createStreams(NumConnections);
+        } else {
+            loadItems(ItemsPerVBucket);
+        }
+        state.ResumeTiming();
+
+        const auto cpuStart = std::clock();
+        totalBytes += drain(mutations);
+        cpuTicks += std::clock() - cpuStart;
+        totalItems += mutations;
+    }
+
+    state.SetItemsProcessed(totalItems);
+    state.SetBytesProcessed(totalBytes);
+    state.SetLabel(phase == DcpPhase::Backfill ? "backfill" : "in-memory");
+    if (totalItems) {
+        state.counters["CPUNsPerItem"] =
+                (double(cpuTicks) * 1e9 / CLOCKS_PER_SEC) / totalItems;
+    }
+}
+
+BENCHMARK_REGISTER_F(DcpBench, Streams)
+        ->Args({1024, int(DcpPhase::Backfill)})
+        ->Args({1024, int(DcpPhase::InMemory)})
+        ->Unit(benchmark::kMillisecond);
@@ -26,6 +26,7 @@
 #include <engines/ep/src/defragmenter.h>
 #include <folly/portability/GTest.h>
 #include <valgrind/valgrind.h>
+#include <ctime>
 
 class DefragmentBench : public benchmark::Fixture {
 public:
@@ -135,6 +136,31 @@ protected:
         return {visitor.getVisitedCount(), duration};
     }
 
+    /// Remove 3 of every 4 documents, leaving all slabs sparsely populated
+    void fragmentVbucket() {
+        const size_t ndocs = vbucket->ht.getNumItems();
+        for (size_t i = 0; i < ndocs; i++) {
+            if (i % 4 == 0) {
+                continue;
+            }
+            std::string key = "key" + std::to_string(i);
+            auto res = vbucket->ht.findForWrite(makeStoredDocKey(key));
+            ASSERT_TRUE(res.storedValue);
+            vbucket->ht.unlocked_del(res.lock, res.storedValue);
+        }
+    }
+
+    /// @return the bytes the allocator has mapped (after releasing free
+    ///         memory back to the OS)
+    static size_t getMappedBytes() {
+        auto* alloc_hooks = get_mock_server_api()->alloc_hooks;
+        alloc_hooks->release_free_memory();
+        allocator_stats stats = {0};
+        stats.ext_stats.resize(alloc_hooks->get_extra_stats_size());
+        alloc_hooks->get_allocator_stats(&stats);
+        return stats.fragmentation_size + stats.allocated_size;
+    }
+
     std::unique_ptr<VBucket> vbucket;
     EPStats globalStats;
     CheckpointConfig checkpointConfig;
@@ -186,8 +212,57 @@ BENCHMARK_DEFINE_F(DefragmentBench, DefragAge10_20ms)(benchmark::State& state) {
             total.first / std::chrono::duration<double>(total.second).count();
 }
 
+/*
+ * Measure how much memory a single defragmenter pass over a fragmented
+ * vbucket gives back to the OS per CPU second. The second parameter is the
+ * defragmenter_sparse_class_threshold (100 moves all documents).
+ */
+BENCHMARK_DEFINE_F(DefragmentBench, DefragFragmented)(benchmark::State& state) {
+    auto* alloc_hooks = get_mock_server_api()->alloc_hooks;
+    double reclaimed = 0;
+    double cpuSeconds = 0;
+    size_t moved = 0;
+    size_t skipped = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        vbucket->ht.clear();
+        populateVbucket();
+        fragmentVbucket();
+        const auto before = getMappedBytes();
+        DefragmentVisitor visitor(
+                DefragmenterTask::getMaxValueSize(alloc_hooks));
+        visitor.setBlobAgeThreshold(0);
+        visitor.setStoredValueAgeThreshold(0);
+        visitor.setDeadline(std::chrono::steady_clock::now() +
+                            std::chrono::minutes(1));
+        state.ResumeTiming();
+
+        const auto start = std::clock();
+        visitor.setSizeClasses(DefragmenterTask::getSizeClasses(
+                alloc_hooks, 0, state.range(1)));
+        vbucket->ht.pauseResumeVisit(visitor, HashTable::Position());
+        const auto end = std::clock();
+
+        state.PauseTiming();
+        const auto after = getMappedBytes();
+        reclaimed += before > after ? before - after : 0;
+        cpuSeconds += double(end - start) / CLOCKS_PER_SEC;
+        moved += visitor.getDefragCount() + visitor.getStoredValueDefragCount();
+        skipped += visitor.getSkippedCount();
+        state.ResumeTiming();
+    }
+    state.counters["BytesReclaimedPerCPUSec"] =
+            cpuSeconds > 0 ? reclaimed / cpuSeconds : 0;
+    state.counters["Moved"] = moved / double(state.iterations());
+    state.counters["Skipped"] = skipped / double(state.iterations());
+}
+
 BENCHMARK_REGISTER_F(DefragmentBench, Visit)->Range(0,1);
 BENCHMARK_REGISTER_F(DefragmentBench, DefragAlways)->Range(0,1);
 BENCHMARK_REGISTER_F(DefragmentBench, DefragAge10)->Range(0,1);
 BENCHMARK_REGISTER_F(DefragmentBench, DefragAge10_20ms)->Range(0,1);
-
+BENCHMARK_REGISTER_F(DefragmentBench, DefragFragmented)
+        ->Args({0, 100})
+        ->Args({0, 90})
+        ->Args({1, 100})
+        ->Args({1, 90});
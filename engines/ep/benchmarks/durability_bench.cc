@@ -0,0 +1,244 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of the SyncWrite path - tracking prepares in the
+ * ActiveDurabilityMonitor, processing replica seqno acks and committing -
+ * for a number of replicas and in-flight SyncWrites.
+ */
+
+#include "checkpoint_manager.h"
+#include "durability/active_durability_monitor.h"
+#include "engine_fixture.h"
+#include "ep_bucket.h"
+#include "item.h"
+#include "kv_bucket.h"
+#include "vbucket.h"
+
+#include <folly/portability/GTest.h>
+#include <memcached/durability_spec.h>
+#include <nlohmann/json.hpp>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+class DurabilityBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        varConfig =
+                "backend=couchdb;max_size=1000000000;"
+                "sync_writes_max_allowed_replicas=3";
+        EngineFixture::SetUp(state);
+        if (state.thread_index == 0) {
+            auto chain = nlohmann::json::array({"active"});
+            for (int r = 0; r < state.range(0); ++r) {
+                replicas.push_back("replica" + std::to_string(r));
+                chain.push_back(replicas.back());
+            }
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      engine->getKVBucket()->setVBucketState(
+                              vbid,
+                              vbucket_state_active,
+                              {{"topology", nlohmann::json::array({chain})}}));
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            replicas.clear();
+        }
+        EngineFixture::TearDown(state);
+    }
+
+    VBucket& getVBucket() {
+        return *engine->getKVBucket()->getVBucket(vbid);
+    }
+
+    /// Store count SyncWrites (keys key0..key<count-1>) with the given level.
+    void addSyncWrites(size_t count, cb::durability::Level level) {
+        for (size_t i = 0; i < count; ++i) {
+            auto item = make_item(vbid, "key" + std::to_string(i), value);
+            item.setPendingSyncWrite({level, {}});
+            ASSERT_EQ(ENGINE_SYNC_WRITE_PENDING,
+                      engine->getKVBucket()->set(item, cookie));
+        }
+    }
+
+    /**
+     * A mock of the replica side of the durability protocol: every replica
+     * acknowledges (as its PassiveDurabilityMonitor would) that it has
+     * prepared up to the given seqno.
+     */
+    void ackFromReplicas(uint64_t preparedSeqno) {
+        auto& vb = getVBucket();
+        folly::SharedMutex::ReadHolder rlh(vb.getStateLock());
+        for (const auto& replica : replicas) {
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      vb.seqnoAcknowledged(rlh, replica, preparedSeqno));
+        }
+    }
+
+    /// Persist everything and drop the closed checkpoints, so memory usage
+    /// doesn't grow over the iterations.
+    void flushAndRemoveCheckpoints() {
+        auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+        auto& vb = getVBucket();
+        bool moreAvailable;
+        do {
+            std::tie(moreAvailable, std::ignore) = ep.flushVBucket(vbid);
+        } while (moreAvailable);
+        vb.checkpointManager->createNewCheckpoint();
+        bool newCheckpointCreated;
+        vb.checkpointManager->removeClosedUnrefCheckpoints(
+                vb, newCheckpointCreated);
+    }
+
+    const std::string value = std::string(256, 'x');
+    std::vector<std::string> replicas;
+};
+
+/*
+ * Add SyncWrites (KVBucket::set of a prepare, which tracks it in the
+ * ActiveDurabilityMonitor) until the given number are in-flight.
+ * Arguments: number of replicas, number of in-flight SyncWrites.
+ */
+BENCHMARK_DEFINE_F(DurabilityBench, AddSyncWrite)
+(benchmark::State& state) {
+    const size_t inflight = state.range(1);
+    while (state.KeepRunning()) {
+        addSyncWrites(inflight, cb::durability::Level::Majority);
+
+        state.PauseTiming();
+        ackFromReplicas(getVBucket().getHighSeqno());
+        getVBucket().processResolvedSyncWrites();
+        flushAndRemoveCheckpoints();
+        ASSERT_EQ(0, getVBucket().getDurabilityMonitor().getNumTracked());
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * inflight);
+}
+
+/*
+ * Process a seqno ack from every replica for each of the in-flight
+ * SyncWrites - i.e. the replicas acknowledge every prepare individually,
+ * moving the ADM tracking positions one SyncWrite at a time.
+ * Arguments: number of replicas, number of in-flight SyncWrites.
+ */
+BENCHMARK_DEFINE_F(DurabilityBench, SeqnoAckReceived)
+(benchmark::State& state) {
+    const size_t inflight = state.range(1);
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        const auto startSeqno = getVBucket().getHighSeqno();
+        addSyncWrites(inflight, cb::durability::Level::Majority);
+        state.ResumeTiming();
+
+        for (size_t i = 1; i <= inflight; ++i) {
+            ackFromReplicas(startSeqno + i);
+        }
+
+        state.PauseTiming();
+        getVBucket().processResolvedSyncWrites();
+        flushAndRemoveCheckpoints();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * inflight);
+}
+
+/*
+ * Commit the in-flight SyncWrites, all of which have been satisfied by a
+ * single ack (from every replica) covering them.
+ * Arguments: number of replicas, number of in-flight SyncWrites.
+ */
+BENCHMARK_DEFINE_F(DurabilityBench, Commit)
+(benchmark::State& state) {
+    const size_t inflight = state.range(1);
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        addSyncWrites(inflight, cb::durability::Level::Majority);
+        state.ResumeTiming();
+
+        ackFromReplicas(getVBucket().getHighSeqno());
+        getVBucket().processResolvedSyncWrites();
+
+        state.PauseTiming();
+        ASSERT_EQ(0, getVBucket().getDurabilityMonitor().getNumTracked());
+        flushAndRemoveCheckpoints();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * inflight);
+}
+
+/*
+ * End-to-end latency of a single PersistToMajority SyncWrite: the prepare
+ * is stored, persisted by the flusher (satisfying the active), acked by the
+ * (mock) replicas, committed, and the commit persisted.
+ * Arguments: number of replicas, unused.
+ */
+BENCHMARK_DEFINE_F(DurabilityBench, SyncWriteLatency)
+(benchmark::State& state) {
+    auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+    auto& vb = getVBucket();
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        auto item = make_item(vbid, "key" + std::to_string(i++ % 1000), value);
+        item.setPendingSyncWrite({cb::durability::Level::PersistToMajority, {}});
+        ASSERT_EQ(ENGINE_SYNC_WRITE_PENDING,
+                  engine->getKVBucket()->set(item, cookie));
+        const auto prepareSeqno = vb.getHighSeqno();
+
+        // Flush the prepare (notifying the ADM of its persistence)
+        ep.flushVBucket(vbid);
+        ackFromReplicas(prepareSeqno);
+        vb.processResolvedSyncWrites();
+        ASSERT_EQ(0, vb.getDurabilityMonitor().getNumTracked());
+
+        // Flush the commit
+        ep.flushVBucket(vbid);
+
+        state.PauseTiming();
+        bool newCheckpointCreated;
+        vb.checkpointManager->removeClosedUnrefCheckpoints(
+                vb, newCheckpointCreated);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void ThroughputArguments(benchmark::internal::Benchmark* b) {
+    for (int replicas : {1, 2, 3}) {
+        for (int inflight : {1000, 10000, 100000}) {
+            b->Args({replicas, inflight});
+        }
+    }
+    b->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK_REGISTER_F(DurabilityBench, AddSyncWrite)
+        ->Apply(ThroughputArguments);
+
+BENCHMARK_REGISTER_F(DurabilityBench, SeqnoAckReceived)
+        ->Apply(ThroughputArguments);
+
+BENCHMARK_REGISTER_F(DurabilityBench, Commit)->Apply(ThroughputArguments);
+
+BENCHMARK_REGISTER_F(DurabilityBench, SyncWriteLatency)
+        ->Args({1, 0})
+        ->Args({2, 0})
+        ->Args({3, 0})
+        ->Unit(benchmark::kMicrosecond);
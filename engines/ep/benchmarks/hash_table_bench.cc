@@ -252,6 +252,119 @@ BENCHMARK_DEFINE_F(HashTableBench, Delete)(benchmark::State& state) {
     state.SetItemsProcessed(state.iterations());
 }
 
+/**
+ * Benchmarks for key lookup / hashing costs, parameterised by bucket layout
+ * (range 0: 0 = Chained, 1 = Tagged) and key length (range 1).
+ *
+ * The HashTable is deliberately kept small relative to the number of items so
+ * that buckets have chains of several elements, where the Tagged layout
+ * avoids comparing keys which don't match.
+ */
+class HashTableKeyBench : public benchmark::Fixture {
+public:
+    void SetUp(benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            const auto layout = state.range(0) ? HashTable::BucketLayout::Tagged
+                                               : HashTable::BucketLayout::Chained;
+            ht = std::make_unique<HashTable>(
+                    stats,
+                    std::make_unique<StoredValueFactory>(stats),
+                    numItems / 4,
+                    Configuration().getHtLocks(),
+                    layout);
+
+            // Keys share a long common prefix (the worst case for comparing
+            // chained keys), differing only in their suffix.
+            const auto keyLen = size_t(state.range(1));
+            const auto data = std::string(1, 'x');
+            items.clear();
+            items.reserve(numItems);
+            for (size_t i = 0; i < numItems; i++) {
+                auto suffix = std::to_string(i);
+                auto key = std::string(keyLen - std::min(keyLen, suffix.size()),
+                                       'k') +
+                           suffix;
+                items.emplace_back(
+                        DocKey(key, DocKeyEncodesCollectionId::No),
+                        0,
+                        0,
+                        data.data(),
+                        data.size());
+                ASSERT_EQ(MutationStatus::WasClean, ht->set(items.back()));
+            }
+        }
+    }
+
+    void TearDown(benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            ht.reset();
+            items.clear();
+        }
+    }
+
+    EPStats stats;
+    std::unique_ptr<HashTable> ht;
+    std::vector<Item> items;
+    static const size_t numItems = 100000;
+    static const size_t batchSize = 16;
+};
+
+// Benchmark finding existing keys.
+BENCHMARK_DEFINE_F(HashTableKeyBench, FindForRead)(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        auto& key = items[state.iterations() % numItems].getKey();
+        benchmark::DoNotOptimize(ht->findForRead(key));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Benchmark hashing a batch of keys one at a time via DocKey::hash().
+BENCHMARK_DEFINE_F(HashTableKeyBench, HashKeys)(benchmark::State& state) {
+    std::vector<DocKey> keys;
+    for (size_t i = 0; i < batchSize; i++) {
+        keys.push_back(items[i].getKey());
+    }
+    std::vector<uint32_t> hashes(batchSize);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < keys.size(); i++) {
+            hashes[i] = keys[i].hash();
+        }
+        benchmark::DoNotOptimize(hashes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * batchSize);
+}
+
+// Benchmark hashing a batch of keys via HashTable::hashKeys().
+BENCHMARK_DEFINE_F(HashTableKeyBench, HashKeysBatch)(benchmark::State& state) {
+    std::vector<DocKey> keys;
+    for (size_t i = 0; i < batchSize; i++) {
+        keys.push_back(items[i].getKey());
+    }
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(HashTable::hashKeys(keys));
+    }
+    state.SetItemsProcessed(state.iterations() * batchSize);
+}
+
+// Benchmark finding a batch of keys, hashed and prefetched as a batch first
+// (as per a multi-key bgfetch completion).
+BENCHMARK_DEFINE_F(HashTableKeyBench, FindBatchPrefetched)
+(benchmark::State& state) {
+    std::vector<DocKey> keys;
+    size_t next = 0;
+    while (state.KeepRunning()) {
+        keys.clear();
+        for (size_t i = 0; i < batchSize; i++) {
+            keys.push_back(items[next++ % numItems].getKey());
+        }
+        ht->prefetchBuckets(HashTable::hashKeys(keys));
+        for (const auto& key : keys) {
+            benchmark::DoNotOptimize(ht->findForRead(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batchSize);
+}
+
 BENCHMARK_REGISTER_F(HashTableBench, FindForRead)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems);
@@ -267,3 +380,20 @@ BENCHMARK_REGISTER_F(HashTableBench, Replace)
 BENCHMARK_REGISTER_F(HashTableBench, Delete)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems);
+
+// Short (< 32B) and long (> 200B) keys, for each bucket layout.
+static void KeyBenchArgs(benchmark::internal::Benchmark* b) {
+    for (int layout : {0, 1}) {
+        for (int keyLen : {16, 250}) {
+            b->Args({layout, keyLen});
+        }
+    }
+}
+
+BENCHMARK_REGISTER_F(HashTableKeyBench, FindForRead)
+        ->Apply(KeyBenchArgs)
+        ->Iterations(HashTableKeyBench::numItems);
+BENCHMARK_REGISTER_F(HashTableKeyBench, HashKeys)->Apply(KeyBenchArgs);
+BENCHMARK_REGISTER_F(HashTableKeyBench, HashKeysBatch)->Apply(KeyBenchArgs);
+BENCHMARK_REGISTER_F(HashTableKeyBench, FindBatchPrefetched)
+        ->Apply(KeyBenchArgs);
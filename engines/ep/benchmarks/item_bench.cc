@@ -19,11 +19,19 @@
  * Benchmarks relating to the Item class.
  */
 
+#include "benchmark_memory_tracker.h"
 #include "item.h"
+#include "stats.h"
+#include "stored_value_factories.h"
+#include "tests/module_tests/test_helpers.h"
 
+#include <JSON_checker.h>
 #include <benchmark/benchmark.h>
+#include <programs/engine_testapp/mock_server.h>
+#include <utilities/json_validator.h>
 
 #include <algorithm>
+#include <string>
 
 static void BM_CompareQueuedItemsBySeqnoAndKey(benchmark::State& state) {
     std::vector<queued_item> items;
@@ -46,3 +54,89 @@ static void BM_CompareQueuedItemsBySeqnoAndKey(benchmark::State& state) {
 }
 // Register the function as a benchmark
 BENCHMARK(BM_CompareQueuedItemsBySeqnoAndKey);
+
+/**
+ * A representative document for datatype detection: an object of strings,
+ * numbers and a nested array, of (roughly) size bytes.
+ */
+static std::string makeJsonDocument(size_t size) {
+    std::string json = R"({"id":123456,"active":true,"tags":["a","b","c"])";
+    for (size_t ii = 0; json.size() < size; ++ii) {
+        json += ",\"field_" + std::to_string(ii) + "\":\"" +
+                std::string(48, 'x') + "\",\"count_" + std::to_string(ii) +
+                "\":" + std::to_string(ii * 31);
+    }
+    json += "}";
+    return json;
+}
+
+static void BM_DatatypeDetectJSONChecker(benchmark::State& state) {
+    const auto json = makeJsonDocument(state.range(0));
+    JSON_checker::Validator validator;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(validator.validate(
+                reinterpret_cast<const uint8_t*>(json.data()), json.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+static void BM_DatatypeDetectJsonValidator(benchmark::State& state) {
+    const auto json = makeJsonDocument(state.range(0));
+    cb::JsonValidator validator;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(validator.validate(
+                reinterpret_cast<const uint8_t*>(json.data()), json.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+// Arguments: {approximate document size in bytes}.
+BENCHMARK(BM_DatatypeDetectJSONChecker)->Arg(256)->Arg(4096)->Arg(65536);
+BENCHMARK(BM_DatatypeDetectJsonValidator)->Arg(256)->Arg(4096)->Arg(65536);
+
+/**
+ * The value copies and allocations of a SET below the engine API: the
+ * StoredValue is created from the (daemon allocated) Item, then the Item
+ * queued in the checkpoint is created from the StoredValue.
+ *
+ * Arguments: the value size (values of up to 64 bytes are stored inline),
+ * and whether the queued item shares the value of the stored Item (as
+ * VBucket::queueDirty does) or copies the StoredValue's inline value (as it
+ * used to).
+ */
+static void BM_SetPathValueCopies(benchmark::State& state) {
+    EPStats stats;
+    InlineValueStoredValueFactory factory(stats, 64);
+    const std::string value(state.range(0), 'x');
+    const Item item(makeStoredDocKey("key"), 0, 0, value.data(), value.size());
+    const bool shareValue = state.range(1);
+
+    auto* tracker = BenchmarkMemoryTracker::getInstance(
+            *get_mock_server_api()->alloc_hooks);
+    tracker->reset();
+    size_t copies = 0;
+    while (state.KeepRunning()) {
+        auto sv = factory(item, nullptr);
+        const bool share = shareValue && sv->isValueInline();
+        queued_item qi(sv->toItem(Vbid(0),
+                                  StoredValue::HideLockedCas::No,
+                                  share ? StoredValue::IncludeValue::No
+                                        : StoredValue::IncludeValue::Yes));
+        if (share) {
+            qi->replaceValue(item.getValue().get());
+        }
+        // The inline copy, and the copy of it for the queued item
+        copies += sv->isValueInline() ? (share ? 1 : 2) : 0;
+        benchmark::DoNotOptimize(qi);
+    }
+    state.counters["AllocationsPerSet"] =
+            double(tracker->getNumAllocations()) / state.iterations();
+    state.counters["ValueCopiesPerSet"] = double(copies) / state.iterations();
+    BenchmarkMemoryTracker::destroyInstance();
+}
+// Arguments: value size, share the Item's value
+BENCHMARK(BM_SetPathValueCopies)
+        ->Args({32, 0})
+        ->Args({32, 1})
+        ->Args({1024, 0})
+        ->Args({1024, 1});
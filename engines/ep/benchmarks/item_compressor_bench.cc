@@ -70,9 +70,10 @@ public:
     }
 
 protected:
-    /* Fill the bucket with the given number of docs.
+    /* Fill the bucket with the given number of docs, giving hotPercent of
+     * them a frequency counter of hotFreqCounter.
      */
-    void populateVbucket() {
+    void populateVbucket(int64_t hotPercent = 0, uint8_t hotFreqCounter = 0) {
         // How many items to create in the VBucket
         const size_t ndocs = 50000;
 
@@ -91,6 +92,10 @@ protected:
                                              PROTOCOL_BINARY_RAW_BYTES,
                                              false);
             ASSERT_EQ(MutationStatus::WasClean, vbucket->ht.set(*item));
+            if (int64_t(i % 100) < hotPercent) {
+                vbucket->ht.findForWrite(item->getKey())
+                        .storedValue->setFreqCounterValue(hotFreqCounter);
+            }
         }
 
         ASSERT_EQ(ndocs, vbucket->ht.getNumItems());
@@ -117,4 +122,47 @@ BENCHMARK_DEFINE_F(ItemCompressorBench, Visit)(benchmark::State& state) {
     state.SetItemsProcessed(visitor.getVisitedCount());
 }
 
+/*
+ * Compress a freshly populated VBucket each iteration, with the given
+ * percentage (second parameter) of its items hot, reporting the memory
+ * saved per CPU second spent compressing.
+ */
+BENCHMARK_DEFINE_F(ItemCompressorBench, CompressColdItems)
+(benchmark::State& state) {
+    const auto hotPercent = state.range(1);
+    const uint8_t freqCounterThreshold = 32;
+    ItemCompressorVisitor visitor;
+    visitor.setCompressionMode(BucketCompressionMode::Active);
+    visitor.setMinCompressionRatio(config.getMinCompressionRatio());
+    visitor.setFreqCounterThreshold(freqCounterThreshold);
+    visitor.setCurrentVBucket(*vbucket);
+    size_t bytesSaved = 0;
+    size_t hot = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        vbucket->ht.clear();
+        populateVbucket(hotPercent, freqCounterThreshold + 1);
+        visitor.clearStats();
+        state.ResumeTiming();
+
+        HashTable::Position pos;
+        while (pos != vbucket->ht.endPosition()) {
+            visitor.setDeadline(std::chrono::steady_clock::now() +
+                                std::chrono::milliseconds(20));
+            pos = vbucket->ht.pauseResumeVisit(visitor, pos);
+        }
+        bytesSaved += visitor.getBytesSaved();
+        hot += visitor.getHotCount();
+    }
+    state.counters["BytesSaved"] = bytesSaved;
+    state.counters["HotSkipped"] = hot;
+    // Rate counters are divided by the CPU time of the benchmark.
+    state.counters["BytesSavedPerCPUSec"] =
+            benchmark::Counter(bytesSaved, benchmark::Counter::kIsRate);
+}
+
 BENCHMARK_REGISTER_F(ItemCompressorBench, Visit)->Range(0, 1);
+BENCHMARK_REGISTER_F(ItemCompressorBench, CompressColdItems)
+        ->Args({0, 0})
+        ->Args({0, 20})
+        ->Args({0, 80});
@@ -21,6 +21,8 @@
 
 #include <benchmark/benchmark.h>
 
+#include <atomic>
+
 #include <platform/sysinfo.h>
 
 #include "stats.h"
@@ -48,6 +50,13 @@ public:
     TestEPStats stats;
 };
 
+/// Stands in for the allocator's arena stats; read on each arena refresh.
+static bool getArenaAllocated(unsigned, size_t* value) {
+    static std::atomic<size_t> allocated{1024 * 1024};
+    *value = allocated.fetch_add(128);
+    return true;
+}
+
 BENCHMARK_DEFINE_F(MemoryAllocationStat, AllocNRead1)(benchmark::State& state) {
     if (state.thread_index == 0) {
         stats.reset();
@@ -119,6 +128,45 @@ BENCHMARK_DEFINE_F(MemoryAllocationStat, AllocNReadPreciseM)
     }
 }
 
+// As AllocNRead1, for a bucket with its own allocator arena: allocations
+// aren't tracked individually, and reads use the arena's stats (re-read at
+// most every EPStats::arenaMemoryRefreshInterval).
+BENCHMARK_DEFINE_F(MemoryAllocationStat, ArenaAllocNRead1)
+(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        stats.reset();
+        stats.memoryTrackerEnabled = true;
+        stats.setMemoryArena(1, getArenaAllocated);
+    }
+
+    while (state.KeepRunning()) {
+        for (int i = 0; i < state.range(0); i++) {
+            stats.memAllocated(128);
+        }
+        stats.getEstimatedTotalMemoryUsed();
+    }
+}
+
+// As AllocNReadPreciseM, for a bucket with its own allocator arena; each
+// precise read re-reads the arena's stats.
+BENCHMARK_DEFINE_F(MemoryAllocationStat, ArenaAllocNReadPreciseM)
+(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        stats.reset();
+        stats.memoryTrackerEnabled = true;
+        stats.setMemoryArena(1, getArenaAllocated);
+    }
+
+    while (state.KeepRunning()) {
+        for (int i = 0; i < state.range(0); i++) {
+            stats.memAllocated(128);
+        }
+        for (int j = 0; j < state.range(1); j++) {
+            stats.getPreciseTotalMemoryUsed();
+        }
+    }
+}
+
 // Tests cover a rough, but realistic range seen from a running cluster (with
 // pillowfight load). The range was discovered by counting calls to
 // memAllocated/deallocated and then logging how many had occurred for each
@@ -147,3 +195,16 @@ BENCHMARK_REGISTER_F(MemoryAllocationStat, AllocNReadPreciseM)
         // memory alloc/dealloc
         ->Args({1000, 10})
         ->Args({100000, 10});
+
+// The arena variants use the same arguments as their tracked counterparts, so
+// the two can be compared directly.
+BENCHMARK_REGISTER_F(MemoryAllocationStat, ArenaAllocNRead1)
+        ->Threads(cb::get_cpu_count() * 4)
+        ->Args({0})
+        ->Args({200})
+        ->Args({1000});
+
+BENCHMARK_REGISTER_F(MemoryAllocationStat, ArenaAllocNReadPreciseM)
+        ->Threads(cb::get_cpu_count() * 4)
+        ->Args({1000, 10})
+        ->Args({100000, 10});
@@ -37,6 +37,7 @@
 
 #include <algorithm>
 #include <thread>
+#include <vector>
 
 enum class Store { Couchstore = 0, RocksDB = 1 };
 
@@ -58,7 +59,7 @@ protected:
         varConfig = "backend=" + to_string(store) +
                     // A number of benchmarks require more than the default
                     // 100MB bucket quota - bump to ~1GB.
-                    ";max_size=1000000000";
+                    ";max_size=1000000000" + extraConfig;
         EngineFixture::SetUp(state);
         if (state.thread_index == 0) {
             engine->getKVBucket()->setVBucketState(Vbid(0),
@@ -91,6 +92,21 @@ protected:
     }
 
     Store store;
+    /// Additional configuration for subclasses (starting with ';')
+    std::string extraConfig;
+};
+
+/**
+ * VBucketBench with the item eviction policy taken from the second argument
+ * (0: value eviction, 1: full eviction).
+ */
+class EvictionPolicyVBucketBench : public VBucketBench {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        extraConfig = std::string(";item_eviction_policy=") +
+                      (state.range(1) ? "full_eviction" : "value_only");
+        VBucketBench::SetUp(state);
+    }
 };
 
 /**
@@ -255,6 +271,65 @@ BENCHMARK_DEFINE_F(VBucketBench, CreateDeleteStoredValue)
     }
 }
 
+/*
+ * Multiple front-end threads updating documents in the same vBucket. Every
+ * set updates the VBucket's ops counters, the dirty queue stats and the
+ * EPStats counters, so this measures how well the threads scale when they
+ * all write to the same VBucket and EPStats objects.
+ */
+BENCHMARK_DEFINE_F(VBucketBench, MultiWriterSet)
+(benchmark::State& state) {
+    // Each thread uses its own cookie and key range. The key range is small
+    // enough for all of the keys to be de-duplicated in the open checkpoint,
+    // the flusher isn't running.
+    const void* threadCookie = create_mock_cookie();
+    const int keysPerThread = 1000;
+    std::vector<std::string> keys;
+    for (int i = 0; i < keysPerThread; ++i) {
+        keys.push_back("key" + std::to_string(state.thread_index) + "_" +
+                       std::to_string(i));
+    }
+
+    const std::string value(1, 'x');
+    int i = 0;
+    while (state.KeepRunning()) {
+        auto item = make_item(vbid, keys[i++ % keysPerThread], value);
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  engine->getKVBucket()->set(item, threadCookie));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    destroy_mock_cookie(threadCookie);
+}
+
+/*
+ * GET of resident documents through KVBucket::get; the front end GET hot
+ * path below the engine API, under each eviction policy.
+ */
+BENCHMARK_DEFINE_F(EvictionPolicyVBucketBench, GetResident)
+(benchmark::State& state) {
+    const int numKeys = 10000;
+    std::vector<StoredDocKey> keys;
+    const std::string value(16, 'x');
+    for (int i = 0; i < numKeys; ++i) {
+        auto item = make_item(vbid, "key" + std::to_string(i), value);
+        ASSERT_EQ(ENGINE_SUCCESS, engine->getKVBucket()->set(item, cookie));
+        keys.emplace_back(item.getKey());
+    }
+
+    const auto options = static_cast<get_options_t>(
+            QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | DELETE_TEMP |
+            HIDE_LOCKED_CAS | TRACK_STATISTICS);
+    int i = 0;
+    while (state.KeepRunning()) {
+        auto gv = engine->getKVBucket()->get(
+                keys[i++ % numKeys], vbid, cookie, options);
+        ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+        benchmark::DoNotOptimize(gv);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
 /*
  * MB-31834: Load throughput degradation when the number of checkpoints
  * eligible for removing is high.
@@ -399,6 +474,16 @@ BENCHMARK_REGISTER_F(MemTrackingVBucketBench, QueueDirty)
         ->Args({10000})
         ->Args({1000000});
 
+BENCHMARK_REGISTER_F(VBucketBench, MultiWriterSet)
+        ->Args({0})
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+
+// Arguments: store (couchstore only), eviction policy (value, full)
+BENCHMARK_REGISTER_F(EvictionPolicyVBucketBench, GetResident)
+        ->Args({0, 0})
+        ->Args({0, 1});
+
 static void FlushArguments(benchmark::internal::Benchmark* b) {
     // Add both couchstore (0) and rocksdb (1) variants for a range of sizes.
     for (size_t items = 1; items <= 1000000; items *= 100) {
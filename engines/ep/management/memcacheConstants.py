@@ -76,6 +76,10 @@ CMD_COLLECTIONS_GET_MANIFEST = 0xba
 CMD_COLLECTIONS_GET_ID = 0xbb
 CMD_COLLECTIONS_GET_SCOPE_ID = 0xbc
 
+CMD_GET_MULTI = 0xbd
+CMD_ARITHMETIC_MULTI = 0xbe
+CMD_SET_WITH_META_MULTI = 0xbf
+
 CMD_GET_ERROR_MAP = 0xfe
 
 # event IDs for the SYNC command responses
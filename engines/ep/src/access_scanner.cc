@@ -28,6 +28,7 @@
 #include <platform/dirutils.h>
 #include <platform/platform_time.h>
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 
@@ -58,6 +59,11 @@ public:
         next = name + ".next";
 
         log = std::make_unique<MutationLog>(next, conf.getAlogBlockSize());
+        // The new log only replaces the current one once it's complete, so
+        // there's no point in flushing (and syncing) every commit; write it
+        // in large sequential writes and sync it once when it's closed.
+        log->setSyncConfig(0);
+        log->setWriteBufferSize(conf.getAlogWriteBufferSize());
         log->open();
         if (!log->isOpen()) {
             EP_LOG_WARN("Failed to open access log: '{}'", next);
@@ -86,6 +92,10 @@ public:
 
     void update(Vbid vbid) {
         if (log != nullptr) {
+            // Logged in key order: neighbouring keys share long prefixes,
+            // which the log delta-encodes, and warmup then fetches them in
+            // the order of the by-id index.
+            std::sort(accessed.begin(), accessed.end());
             for (auto it = accessed.begin(); it != accessed.end(); ++it) {
                 log->newItem(vbid, *it);
             }
@@ -21,7 +21,6 @@
 #include "executorpool.h"
 #include "executorthread.h"
 #include "kv_bucket.h"
-#include "kvshard.h"
 #include "tasks.h"
 #include "vbucket_bgfetch_item.h"
 #include <phosphor/phosphor.h>
@@ -29,8 +28,8 @@
 #include <climits>
 #include <vector>
 
-BgFetcher::BgFetcher(KVBucket& s, KVShard& k)
-    : BgFetcher(s, k, s.getEPEngine().getEpStats()) {
+BgFetcher::BgFetcher(KVBucket& s)
+    : BgFetcher(s, s.getEPEngine().getEpStats()) {
 }
 
 BgFetcher::~BgFetcher() {
@@ -88,7 +87,7 @@ size_t BgFetcher::doFetch(Vbid vbId, vb_bgfetch_queue_t& itemsToFetch) {
                     startTime.time_since_epoch())
                     .count());
 
-    shard.getROUnderlying()->getMulti(vbId, itemsToFetch);
+    store.getROUnderlying(vbId)->getMulti(vbId, itemsToFetch);
 
     std::vector<bgfetched_item_t> fetchedItems;
     for (const auto& fetch : itemsToFetch) {
@@ -135,7 +134,7 @@ bool BgFetcher::run(GlobalTask *task) {
 
     std::vector<Vbid> bg_vbs(pendingVbs.size());
     {
-        LockHolder lh(queueMutex);
+        QueueLockHolder lh(queueMutex);
         bg_vbs.assign(pendingVbs.begin(), pendingVbs.end());
         pendingVbs.clear();
     }
@@ -143,12 +142,12 @@ bool BgFetcher::run(GlobalTask *task) {
     size_t num_fetched_items = 0;
 
     for (const auto vbId : bg_vbs) {
-        VBucketPtr vb = shard.getBucket(vbId);
+        VBucketPtr vb = store.getVBucket(vbId);
         if (vb) {
             // Requeue the bg fetch task if vbucket DB file is not created yet.
             if (vb->isBucketCreation()) {
                 {
-                    LockHolder lh(queueMutex);
+                    QueueLockHolder lh(queueMutex);
                     pendingVbs.insert(vbId);
                 }
                 wakeUpTaskIfSnoozed();
@@ -167,9 +166,14 @@ bool BgFetcher::run(GlobalTask *task) {
     return true;
 }
 
-bool BgFetcher::pendingJob() const {
-    for (const auto vbid : shard.getVBuckets()) {
-        VBucketPtr vb = shard.getBucket(vbid);
+bool BgFetcher::pendingJob() {
+    std::vector<Vbid> vbs;
+    {
+        QueueLockHolder lh(queueMutex);
+        vbs.assign(pendingVbs.begin(), pendingVbs.end());
+    }
+    for (const auto vbid : vbs) {
+        VBucketPtr vb = store.getVBucket(vbid);
         if (vb && vb->hasPendingBGFetchItems()) {
             return true;
         }
@@ -20,17 +20,20 @@
 #include <set>
 #include <string>
 
+#include "lock_profiler.h"
 #include "vbucket.h"
 
 // Forward declarations.
 class EPStats;
 class KVBucket;
-class KVShard;
 class GlobalTask;
 
 /**
  * Dispatcher job responsible for batching data reads and push to
  * underlying storage
+ *
+ * A BgFetcher reads the items of the vBuckets assigned to it by the bucket
+ * (see EPBucket::getBgFetcher()).
  */
 class BgFetcher {
 public:
@@ -38,11 +41,10 @@ public:
      * Construct a BgFetcher
      *
      * @param s  The store
-     * @param k  The shard to which this background fetcher belongs
      * @param st reference to statistics
      */
-    BgFetcher(KVBucket& s, KVShard& k, EPStats& st)
-        : store(s), shard(k), taskId(0), stats(st), pendingFetch(false) {
+    BgFetcher(KVBucket& s, EPStats& st)
+        : store(s), taskId(0), stats(st), pendingFetch(false) {
     }
 
     /**
@@ -52,24 +54,27 @@ public:
      * from KVBucket's reference to EPEngine's epstats.
      *
      * @param s The store
-     * @param k The shard to which this background fetcher belongs
      */
-    BgFetcher(KVBucket& s, KVShard& k);
+    explicit BgFetcher(KVBucket& s);
 
     ~BgFetcher();
 
     void start(void);
     void stop(void);
     bool run(GlobalTask *task);
-    bool pendingJob(void) const;
+    bool pendingJob(void);
     void notifyBGEvent(void);
     void setTaskId(size_t newId) { taskId = newId; }
     void addPendingVB(Vbid vbId) {
-        LockHolder lh(queueMutex);
+        QueueLockHolder lh(queueMutex);
         pendingVbs.insert(vbId);
     }
 
 private:
+    /// LockHolder for queueMutex, profiled by the LockProfiler.
+    using QueueLockHolder =
+            ProfiledLockHolder<LockHolder, LockProfiler::Site::BgFetcherQueue>;
+
     size_t doFetch(Vbid vbId, vb_bgfetch_queue_t& items);
 
     /// If the BGFetch task is currently snoozed (not scheduled to
@@ -78,7 +83,6 @@ private:
     void wakeUpTaskIfSnoozed();
 
     KVBucket& store;
-    KVShard& shard;
     size_t taskId;
     std::mutex queueMutex;
     EPStats &stats;
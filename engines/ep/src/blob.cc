@@ -20,6 +20,8 @@
 #include "objectregistry.h"
 
 #include <cstring>
+#include <stdexcept>
+#include <string>
 
 Blob* Blob::New(const char* start, const size_t len) {
     size_t total_len = getAllocationSize(len);
@@ -39,6 +41,10 @@ Blob* Blob::Copy(const Blob& other) {
     return t;
 }
 
+Blob* Blob::Embed(void* storage, const Blob& other) {
+    return new (storage) Blob(other, EmbeddedTag{});
+}
+
 Blob::Blob(const char* start, const size_t len)
     : size(static_cast<uint32_t>(len)), age(0) {
     if (start != NULL) {
@@ -55,13 +61,30 @@ Blob::Blob(const size_t len) : Blob(nullptr, len) {
 }
 
 Blob::Blob(const Blob& other)
-    : size(other.size.load()),
+    : size(other.size.load() & ~embeddedFlag),
       // While this is a copy, it is a new allocation therefore reset age.
       age(0) {
     std::memcpy(data, other.data, other.valueSize());
     ObjectRegistry::onCreateBlob(this);
 }
 
+Blob::Blob(const Blob& other, EmbeddedTag)
+    : size(other.size.load() | embeddedFlag), age(0) {
+    std::memcpy(data, other.data, other.valueSize());
+    ObjectRegistry::onCreateBlob(this);
+}
+
+void Blob::overwrite(const Blob& other) {
+    if (other.valueSize() != valueSize()) {
+        throw std::invalid_argument(
+                "Blob::overwrite: size mismatch (" +
+                std::to_string(valueSize()) + " vs " +
+                std::to_string(other.valueSize()) + ")");
+    }
+    std::memcpy(data, other.data, valueSize());
+    size = (size & embeddedFlag) | (other.size & ~embeddedFlag);
+}
+
 const std::string Blob::to_s() const {
     return std::string(data, valueSize());
 }
@@ -20,6 +20,8 @@
 #include "atomic.h"
 #include "tagged_ptr.h"
 
+#include <algorithm>
+
 /**
  * A blob is a minimal sized storage for data up to 2^32 bytes long.
  */
@@ -52,6 +54,25 @@ public:
      */
     static Blob* Copy(const Blob& other);
 
+    /**
+     * Creates a copy of the specified Blob in the given storage (which must
+     * be at least getEmbeddedSize(other.valueSize()) bytes), rather than in a
+     * new allocation. The copy is "embedded": its Deleter only destroys it,
+     * leaving the storage to its owner.
+     */
+    static Blob* Embed(void* storage, const Blob& other);
+
+    /// @return the storage needed to embed a Blob of the given value size.
+    static size_t getEmbeddedSize(size_t len) {
+        return std::max(sizeof(Blob), getAllocationSize(len));
+    }
+
+    /**
+     * Overwrite the contents of this Blob with those of other, which must be
+     * the same size. The age is kept - this is still the same allocation.
+     */
+    void overwrite(const Blob& other);
+
     // Actual accessorish things.
 
     /**
@@ -65,7 +86,7 @@ public:
      * Get the size of this Blob's value.
      */
     size_t valueSize() const {
-        return size & ~(0x80000000);
+        return size & ~(uncompressibleFlag | embeddedFlag);
     }
 
     /**
@@ -99,7 +120,7 @@ public:
      * Check if the given data is compressible
      */
     bool isCompressible() {
-        return ~(size & 0x80000000);
+        return ~(size & uncompressibleFlag);
     }
 
     /**
@@ -107,7 +128,15 @@ public:
      * This should be fine given that the maximum value we support is 20 MiB
      */
     void setUncompressible() {
-        size |= 0x80000000;
+        size |= uncompressibleFlag;
+    }
+
+    /**
+     * True if this Blob lives in storage owned by something else (see
+     * Embed()), rather than in its own allocation.
+     */
+    bool isEmbedded() const {
+        return size & embeddedFlag;
     }
 
     /**
@@ -132,7 +161,11 @@ public:
     class Deleter {
     public:
         void operator()(TaggedPtr<Blob> item) {
-            delete item.get();
+            if (item->isEmbedded()) {
+                item->~Blob();
+            } else {
+                delete item.get();
+            }
         }
     };
 
@@ -140,6 +173,13 @@ private:
     //Ensure Blob size of 12 bytes by padding by 3.
     static constexpr int paddingSize{3};
 
+    static constexpr uint32_t uncompressibleFlag = 0x80000000;
+    static constexpr uint32_t embeddedFlag = 0x40000000;
+
+    struct EmbeddedTag {};
+
+    Blob(const Blob& other, EmbeddedTag);
+
 protected:
     /* Constructor.
      * @param start If non-NULL, pointer to array which will be copied into
@@ -159,7 +199,7 @@ protected:
 
     // Size of the value. The highest bit is used to represent if the
     // value is compressible or not. If set, then the value is not
-    // compressible. This needs to be an atomic variable as there could
+    // compressible. The next bit is set if the Blob is embedded. This needs to be an atomic variable as there could
     // be a data race between threads that update the size
     // (e.g, the setUncompressible API) and the ones that read the size
     std::atomic<uint32_t> size;
@@ -21,7 +21,9 @@
 
 #include "murmurhash3.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #if __x86_64__ || __ppc64__
 #define MURMURHASH_3 MurmurHash3_x64_128
@@ -29,19 +31,96 @@
 #define MURMURHASH_3 MurmurHash3_x86_128
 #endif
 
+constexpr size_t BloomFilter::blockBits;
+constexpr size_t BloomFilter::wordsPerBlock;
+
 BloomFilter::BloomFilter(size_t key_count, double false_positive_prob,
                          bfilter_status_t new_status) {
 
     status = new_status;
-    filterSize = estimateFilterSize(key_count, false_positive_prob);
+    noOfBlocks = std::max(
+            size_t(1),
+            (estimateFilterSize(key_count, false_positive_prob) + blockBits -
+             1) / blockBits);
+    filterSize = noOfBlocks * blockBits;
     noOfHashes = estimateNoOfHashes(key_count);
     keyCounter = 0;
-    bitArray.assign(filterSize, false);
+    allocateBlocks();
+}
+
+BloomFilter::BloomFilter(size_t numBlocks,
+                         size_t numHashes,
+                         size_t keyCount,
+                         bfilter_status_t newStatus)
+    : filterSize(numBlocks * blockBits),
+      noOfHashes(numHashes),
+      noOfBlocks(numBlocks),
+      keyCounter(keyCount),
+      status(newStatus) {
+    allocateBlocks();
+}
+
+void BloomFilter::allocateBlocks() {
+    storage.assign(noOfBlocks * wordsPerBlock + wordsPerBlock - 1, 0);
+    const auto misalignment =
+            reinterpret_cast<uintptr_t>(storage.data()) % (blockBits / 8);
+    blocks = storage.data() +
+             (misalignment ? (blockBits / 8 - misalignment) / 8 : 0);
+}
+
+namespace {
+struct SerialisedHeader {
+    uint32_t version;
+    uint32_t noOfHashes;
+    uint64_t noOfBlocks;
+    uint64_t keyCounter;
+};
+constexpr uint32_t serialisedVersion = 1;
+} // namespace
+
+std::string BloomFilter::serialise() const {
+    if (!blocks) {
+        return {};
+    }
+    const SerialisedHeader header{serialisedVersion,
+                                  uint32_t(noOfHashes),
+                                  noOfBlocks,
+                                  keyCounter};
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char*>(blocks),
+                noOfBlocks * blockBits / 8);
+    return data;
+}
+
+std::unique_ptr<BloomFilter> BloomFilter::deserialise(
+        cb::const_char_buffer data, bfilter_status_t newStatus) {
+    SerialisedHeader header;
+    if (data.size() < sizeof(header)) {
+        return {};
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.version != serialisedVersion || header.noOfBlocks == 0 ||
+        header.noOfHashes == 0 || header.noOfHashes > blockBits ||
+        (data.size() - sizeof(header)) % (blockBits / 8) != 0 ||
+        (data.size() - sizeof(header)) / (blockBits / 8) !=
+                header.noOfBlocks) {
+        return {};
+    }
+
+    // Constructor is protected, so can't use make_unique.
+    std::unique_ptr<BloomFilter> filter(new BloomFilter(header.noOfBlocks,
+                                                        header.noOfHashes,
+                                                        header.keyCounter,
+                                                        newStatus));
+    std::memcpy(filter->blocks,
+                data.data() + sizeof(header),
+                header.noOfBlocks * blockBits / 8);
+    return filter;
 }
 
 BloomFilter::~BloomFilter() {
     status = BFILTER_DISABLED;
-    bitArray.clear();
+    clearBits();
 }
 
 size_t BloomFilter::estimateFilterSize(size_t key_count,
@@ -51,15 +130,42 @@ size_t BloomFilter::estimateFilterSize(size_t key_count,
 }
 
 size_t BloomFilter::estimateNoOfHashes(size_t key_count) {
-    return round(((double) filterSize / key_count) * (log(2.0)));
+    const size_t hashes =
+            round(((double)filterSize / key_count) * (log(2.0)));
+    return std::min(std::max(hashes, size_t(1)), blockBits);
 }
 
-uint64_t BloomFilter::hashDocKey(const DocKey& key, uint32_t iteration) {
-    uint64_t result = 0;
+std::pair<uint64_t, uint64_t> BloomFilter::hashDocKey(const DocKey& key) {
+    uint64_t result[2];
     auto hashable = key.getIdAndKey();
-    uint32_t seed = iteration + (uint32_t(hashable.first) * noOfHashes);
-    MURMURHASH_3(hashable.second.data(), hashable.second.size(), seed, &result);
-    return result;
+    MURMURHASH_3(hashable.second.data(),
+                 hashable.second.size(),
+                 uint32_t(hashable.first),
+                 result);
+    return {result[0], result[1]};
+}
+
+uint64_t* BloomFilter::getBlock(const std::pair<uint64_t, uint64_t>& hash) {
+    return blocks + (hash.first % noOfBlocks) * wordsPerBlock;
+}
+
+BloomFilter::BlockMask BloomFilter::getMask(
+        const std::pair<uint64_t, uint64_t>& hash) const {
+    // Derive the noOfHashes bit positions from the second half of the hash
+    // by double hashing.
+    const uint32_t h1 = uint32_t(hash.second);
+    const uint32_t h2 = uint32_t(hash.second >> 32) | 1;
+    BlockMask mask{};
+    for (uint32_t i = 0; i < noOfHashes; i++) {
+        const uint32_t bit = (h1 + i * h2) % blockBits;
+        mask[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+    return mask;
+}
+
+void BloomFilter::clearBits() {
+    storage.clear();
+    blocks = nullptr;
 }
 
 void BloomFilter::setStatus(bfilter_status_t to) {
@@ -72,7 +178,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_PENDING:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                clearBits();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -80,7 +186,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_COMPACTING:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                clearBits();
             } else if (to == BFILTER_ENABLED) {
                 status = to;
             }
@@ -88,7 +194,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_ENABLED:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                clearBits();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -116,15 +222,15 @@ std::string BloomFilter::getStatusString() {
 
 void BloomFilter::addKey(const DocKey& key) {
     if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
-        bool overlap = true;
-        for (uint32_t i = 0; i < noOfHashes; i++) {
-            uint64_t result = hashDocKey(key, i);
-            if (overlap && bitArray[result % filterSize] == 0) {
-                overlap = false;
-            }
-            bitArray[result % filterSize] = 1;
+        const auto hash = hashDocKey(key);
+        const auto mask = getMask(hash);
+        auto* block = getBlock(hash);
+        uint64_t added = 0;
+        for (size_t w = 0; w < wordsPerBlock; w++) {
+            added |= mask[w] & ~block[w];
+            block[w] |= mask[w];
         }
-        if (!overlap) {
+        if (added) {
             keyCounter++;
         }
     }
@@ -132,12 +238,16 @@ void BloomFilter::addKey(const DocKey& key) {
 
 bool BloomFilter::maybeKeyExists(const DocKey& key) {
     if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
-        for (uint32_t i = 0; i < noOfHashes; i++) {
-            uint64_t result = hashDocKey(key, i);
-            if (bitArray[result % filterSize] == 0) {
-                // The key does NOT exist.
-                return false;
-            }
+        const auto hash = hashDocKey(key);
+        const auto mask = getMask(hash);
+        const auto* block = getBlock(hash);
+        uint64_t missing = 0;
+        for (size_t w = 0; w < wordsPerBlock; w++) {
+            missing |= mask[w] & ~block[w];
+        }
+        if (missing) {
+            // The key does NOT exist.
+            return false;
         }
     }
     // The key may exist.
@@ -16,7 +16,13 @@
  */
 #pragma once
 
+#include <platform/sized_buffer.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 struct DocKey;
@@ -33,9 +39,20 @@ enum bfilter_status_t {
  * We are to maintain the vbucket-number of these instances.
  *
  * Each vbucket will hold one such object.
+ *
+ * The filter is "blocked": the bit array is split into cache line sized
+ * blocks, and all of a key's bits are set in the one block chosen by its
+ * hash. Adding or checking a key therefore touches a single cache line
+ * (rather than one per hash function), and only needs one hash of the key;
+ * a block is probed a word at a time with no branches, which the compiler
+ * can vectorise.
  */
 class BloomFilter {
 public:
+    /// Bits per block; 64 bytes, i.e. one cache line.
+    static constexpr size_t blockBits = 512;
+    static constexpr size_t wordsPerBlock = blockBits / 64;
+
     BloomFilter(size_t key_count, double false_positive_prob,
                 bfilter_status_t newStatus = BFILTER_DISABLED);
     ~BloomFilter();
@@ -50,17 +67,57 @@ public:
     size_t getNumOfKeysInFilter();
     size_t getFilterSize();
 
+    /**
+     * Encode the filter's bits, to be persisted (see
+     * KVStore::persistBloomFilter). The encoding is in host byte order.
+     */
+    std::string serialise() const;
+
+    /**
+     * Decode a filter encoded by serialise().
+     *
+     * @param data the encoded filter
+     * @param newStatus the status the decoded filter should have
+     * @return the filter, or nullptr if data is not a valid encoding.
+     */
+    static std::unique_ptr<BloomFilter> deserialise(
+            cb::const_char_buffer data,
+            bfilter_status_t newStatus = BFILTER_ENABLED);
+
 protected:
+    BloomFilter(size_t numBlocks,
+                size_t numHashes,
+                size_t keyCount,
+                bfilter_status_t newStatus);
+
+    /// Allocate (zeroed) storage for noOfBlocks blocks.
+    void allocateBlocks();
+
+    using BlockMask = std::array<uint64_t, wordsPerBlock>;
+
     size_t estimateFilterSize(size_t key_count, double false_positive_prob);
     size_t estimateNoOfHashes(size_t key_count);
 
-    uint64_t hashDocKey(const DocKey& key, uint32_t iteration);
+    /// @return the 128-bit hash of the key (and its collection).
+    std::pair<uint64_t, uint64_t> hashDocKey(const DocKey& key);
+
+    /// @return the block which the key with the given hash maps to.
+    uint64_t* getBlock(const std::pair<uint64_t, uint64_t>& hash);
+
+    /// @return the bits within its block of the key with the given hash.
+    BlockMask getMask(const std::pair<uint64_t, uint64_t>& hash) const;
+
+    void clearBits();
 
     size_t filterSize;
     size_t noOfHashes;
+    size_t noOfBlocks;
 
     size_t keyCounter;
 
     bfilter_status_t status;
-    std::vector<bool> bitArray;
+    /// Backing storage for the blocks; over-allocated by a block so that
+    /// the blocks can start on a cache line boundary.
+    std::vector<uint64_t> storage;
+    uint64_t* blocks;
 };
@@ -0,0 +1,57 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "cached_stats.h"
+
+void CachedStats::addStats(std::chrono::milliseconds maxAge,
+                           const void* cookie,
+                           const AddStatFn& add_stat,
+                           const Generator& generate) {
+    if (maxAge.count() == 0) {
+        generate(add_stat);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lh(mutex);
+    const auto now = std::chrono::steady_clock::now();
+    if (!valid || now - generated >= maxAge) {
+        stats.clear();
+        generate([this](const char* key,
+                        const uint16_t klen,
+                        const char* val,
+                        const uint32_t vlen,
+                        gsl::not_null<const void*>) {
+            stats.emplace_back(std::string(key, klen), std::string(val, vlen));
+        });
+        generated = now;
+        valid = true;
+    }
+
+    for (const auto& stat : stats) {
+        add_stat(stat.first.data(),
+                 uint16_t(stat.first.size()),
+                 stat.second.data(),
+                 uint32_t(stat.second.size()),
+                 cookie);
+    }
+}
+
+void CachedStats::invalidate() {
+    std::lock_guard<std::mutex> lh(mutex);
+    valid = false;
+    stats.clear();
+}
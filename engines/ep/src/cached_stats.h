@@ -0,0 +1,59 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <memcached/engine_common.h>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Caches the output of an expensive stat group (one which visits every
+ * vBucket or connection) for a bounded time, so that frequent monitoring
+ * polls replay the last result instead of recomputing it each time.
+ *
+ * Generation is serialised, so concurrent requests for stale stats wait
+ * for a single regeneration rather than all walking the bucket at once.
+ */
+class CachedStats {
+public:
+    using Generator = std::function<void(const AddStatFn&)>;
+
+    /**
+     * Output the stats via add_stat, first regenerating them by calling
+     * `generate` if the cached copy is older than maxAge. With a maxAge of
+     * zero the stats are always generated directly, without caching.
+     */
+    void addStats(std::chrono::milliseconds maxAge,
+                  const void* cookie,
+                  const AddStatFn& add_stat,
+                  const Generator& generate);
+
+    /// Discard the cached stats, so the next addStats() regenerates them.
+    void invalidate();
+
+private:
+    std::mutex mutex;
+    bool valid = false;
+    std::chrono::steady_clock::time_point generated;
+    std::vector<std::pair<std::string, std::string>> stats;
+};
@@ -96,6 +96,131 @@ std::ostream& operator<<(std::ostream& os, const CheckpointCursor& c) {
     return os;
 }
 
+CheckpointKeyIndex::CheckpointKeyIndex(const allocator_type& alloc)
+    : slotAllocator(alloc), expelled(alloc) {
+}
+
+CheckpointKeyIndex::~CheckpointKeyIndex() {
+    if (slots) {
+        slotAllocator.deallocate(slots, capacity);
+    }
+}
+
+uint32_t CheckpointKeyIndex::hashKey(const StoredDocKey& key) {
+    const auto hash = key.hash();
+    return hash == 0 ? 1 : hash;
+}
+
+index_entry* CheckpointKeyIndex::find(const StoredDocKey& key,
+                                      CheckpointIndexKeyNamespace ns) {
+    if (numSlotsUsed != 0) {
+        const auto hash = hashKey(key);
+        for (auto ii = slotFor(hash); !slots[ii].isEmpty();
+             ii = (ii + 1) & (capacity - 1)) {
+            auto& slot = slots[ii];
+            if (slot.hash == hash && slot.ns == ns &&
+                (*slot.getEntry().position)->getKey() == key) {
+                return &slot.getEntry();
+            }
+        }
+    }
+
+    if (!expelled.empty()) {
+        auto itr = expelled.find({key, ns});
+        if (itr != expelled.end()) {
+            return &itr->second;
+        }
+    }
+    return nullptr;
+}
+
+void CheckpointKeyIndex::insert(const StoredDocKey& key,
+                                CheckpointIndexKeyNamespace ns,
+                                const index_entry& entry) {
+    if (!expelled.empty()) {
+        expelled.erase({key, ns});
+    }
+
+    reserveSlot();
+    const auto hash = hashKey(key);
+    auto ii = slotFor(hash);
+    while (!slots[ii].isEmpty()) {
+        ii = (ii + 1) & (capacity - 1);
+    }
+    slots[ii].set(hash, ns, entry);
+    ++numSlotsUsed;
+}
+
+bool CheckpointKeyIndex::expel(const StoredDocKey& key,
+                               CheckpointIndexKeyNamespace ns,
+                               const ChkptQueueIterator& end) {
+    if (numSlotsUsed == 0) {
+        return false;
+    }
+    const auto hash = hashKey(key);
+    for (auto ii = slotFor(hash); !slots[ii].isEmpty();
+         ii = (ii + 1) & (capacity - 1)) {
+        auto& slot = slots[ii];
+        if (slot.hash == hash && slot.ns == ns &&
+            (*slot.getEntry().position)->getKey() == key) {
+            auto entry = slot.getEntry();
+            entry.invalidate(end);
+            expelled.emplace(CheckpointIndexKey(key, ns), entry);
+            eraseSlot(ii);
+            return true;
+        }
+    }
+    return false;
+}
+
+void CheckpointKeyIndex::reserveSlot() {
+    // Keep the load factor at or below 3/4.
+    if ((numSlotsUsed + 1) * 4 <= capacity * 3) {
+        return;
+    }
+
+    const auto oldSlots = slots;
+    const auto oldCapacity = capacity;
+    capacity = oldCapacity ? oldCapacity * 2 : 16;
+    slots = slotAllocator.allocate(capacity);
+    for (size_t ii = 0; ii < capacity; ++ii) {
+        new (&slots[ii]) Slot();
+    }
+
+    for (size_t ii = 0; ii < oldCapacity; ++ii) {
+        const auto& slot = oldSlots[ii];
+        if (!slot.isEmpty()) {
+            auto jj = slotFor(slot.hash);
+            while (!slots[jj].isEmpty()) {
+                jj = (jj + 1) & (capacity - 1);
+            }
+            slots[jj] = slot;
+        }
+    }
+    if (oldSlots) {
+        slotAllocator.deallocate(oldSlots, oldCapacity);
+    }
+}
+
+void CheckpointKeyIndex::eraseSlot(size_t index) {
+    // Backward shift deletion: move back any following Slot in the same
+    // probe sequence whose preferred slot is not after the hole, so lookups
+    // don't need tombstones.
+    const auto mask = capacity - 1;
+    auto hole = index;
+    for (auto ii = (index + 1) & mask; !slots[ii].isEmpty();
+         ii = (ii + 1) & mask) {
+        const auto preferred = slotFor(slots[ii].hash);
+        // Distance from the preferred slot to ii, and to the hole.
+        if (((ii - preferred) & mask) >= ((ii - hole) & mask)) {
+            slots[hole] = slots[ii];
+            hole = ii;
+        }
+    }
+    slots[hole].hash = 0;
+    --numSlotsUsed;
+}
+
 Checkpoint::Checkpoint(EPStats& st,
                        uint64_t id,
                        uint64_t snapStart,
@@ -142,6 +267,9 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
     }
     TrackOverhead trackOverhead(*this);
     QueueDirtyStatus rv;
+    // The keyIndex entry for the previous (non-expelled) item for the key,
+    // if there was one.
+    index_entry* liveEntry = nullptr;
 
     // Check if the item is a meta item
     if (qi->isCheckPointMetaItem()) {
@@ -149,10 +277,10 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
         rv = QueueDirtyStatus::SuccessNewItem;
         addItemToCheckpoint(qi);
     } else {
-        checkpoint_index::iterator it = keyIndex.find(
-                {qi->getKey(),
-                 qi->isCommitted() ? CheckpointIndexKeyNamespace::Committed
-                                   : CheckpointIndexKeyNamespace::Prepared});
+        auto* existing = keyIndex.find(
+                qi->getKey(),
+                qi->isCommitted() ? CheckpointIndexKeyNamespace::Committed
+                                  : CheckpointIndexKeyNamespace::Prepared);
 
         // Before de-duplication could discard a delete, store the largest
         // "rev-seqno" encountered
@@ -163,17 +291,17 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
 
         // Check if this checkpoint already has an item for the same key
         // and the item has not been expelled.
-        if (it != keyIndex.end()) {
-            if (it->second.mutation_id > highestExpelledSeqno) {
+        if (existing) {
+            if (existing->mutation_id > highestExpelledSeqno) {
                 // Normal path - we haven't expelled the item. We have a valid
                 // cursor position to read the item and make our de-dupe checks.
-                const auto currPos = it->second.position;
+                const auto currPos = existing->position;
                 if (!(canDedup(*currPos, qi))) {
                     return QueueDirtyStatus::FailureDuplicateItem;
                 }
 
                 rv = QueueDirtyStatus::SuccessExistingItem;
-                const int64_t currMutationId{it->second.mutation_id};
+                const int64_t currMutationId{existing->mutation_id};
 
                 // Given the key already exists, need to check all cursors in
                 // this Checkpoint and see if the existing item for this key is
@@ -220,6 +348,9 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
                 queuedItemsMemUsage -= ((*currPos)->size());
                 // Remove the existing item for the same key from the list.
                 toWrite.erase(currPos.getUnderlyingIterator());
+                // The existing index entry is updated (to the new item)
+                // below.
+                liveEntry = existing;
             } else {
                 // The old item has been expelled, but we can continue to use
                 // this checkpoint in most cases. If the previous op was a
@@ -232,7 +363,7 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
                 // queued_item and freed the memory. The index_entry has the
                 // information we need though to tell us if this item was a
                 // SyncWrite.
-                if (it->second.isSyncWrite() ||
+                if (existing->isSyncWrite() ||
                     qi->getOperation() == queue_op::commit_sync_write) {
                     return QueueDirtyStatus::FailureDuplicateItem;
                 }
@@ -266,19 +397,17 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
                 // Did not manage to insert - so update the value directly
                 result.first->second = entry;
             }
+        } else if (liveEntry) {
+            // Update the existing entry directly; it can't be looked up by
+            // key again as the item it refers to has been removed.
+            *liveEntry = entry;
         } else {
             // Insert the new entry into the keyIndex
-            auto result = keyIndex.emplace(
-                    CheckpointIndexKey(
-                            qi->getKey(),
+            keyIndex.insert(qi->getKey(),
                             qi->isCommitted()
                                     ? CheckpointIndexKeyNamespace::Committed
-                                    : CheckpointIndexKeyNamespace::Prepared),
-                    entry);
-            if (!result.second) {
-                // Did not manage to insert - so update the value directly
-                result.first->second = entry;
-            }
+                                    : CheckpointIndexKeyNamespace::Prepared,
+                            entry);
         }
     }
 
@@ -325,52 +454,38 @@ void Checkpoint::addItemToCheckpoint(const queued_item& qi) {
 ExpelResult Checkpoint::expelItems(CheckpointCursor& expelUpToAndIncluding) {
     TrackOverhead trackOverhead(*this);
     ExpelResult expelResult;
-    // Perform the expel inside this inner scope, this ensures that the expelled
-    // items are deallocated within this function allowing memOverhead to be
-    // tracked.
-    {
-        CheckpointQueue expelledItems(trackingAllocator);
-
-        ChkptQueueIterator iterator = expelUpToAndIncluding.currentPos;
-
-        // Record the seqno of the last item to be expelled.
-        highestExpelledSeqno =
-                iterator.getUnderlyingIterator()->get()->getBySeqno();
-
-        // The item to be swapped with the dummy is not expected to be a
-        // meta-data item.
-        Expects(!iterator.getUnderlyingIterator()
-                         ->get()
-                         ->isCheckPointMetaItem());
-
-        // Swap the item pointed to by our iterator with the dummy item
-        auto dummy = begin().getUnderlyingIterator();
-        iterator.getUnderlyingIterator()->swap(*dummy);
-
-        /*
-         * Move from (and including) the first item in the checkpoint queue upto
-         * (but not including) the item pointed to by iterator.  The item
-         * pointed to by iterator is now the new dummy item for the checkpoint
-         * queue.
-         */
-        expelledItems.splice(expelledItems.begin(),
-                             toWrite,
-                             begin().getUnderlyingIterator(),
-                             iterator.getUnderlyingIterator());
-
-        if (getState() == CHECKPOINT_OPEN) {
-            // Whilst cp is open invalidate item
-            for (const auto& expelled : expelledItems) {
-                if (!expelled->isCheckPointMetaItem()) {
-                    auto itr = keyIndex.find(
-                            {expelled->getKey(),
-                             expelled->isCommitted()
-                                     ? CheckpointIndexKeyNamespace::Committed
-                                     : CheckpointIndexKeyNamespace::Prepared});
-                    Expects(itr != keyIndex.end());
-                    itr->second.invalidate(end());
-                }
-            }
+    ChkptQueueIterator iterator = expelUpToAndIncluding.currentPos;
+
+    // Record the seqno of the last item to be expelled.
+    highestExpelledSeqno =
+            iterator.getUnderlyingIterator()->get()->getBySeqno();
+
+    // The item to be swapped with the dummy is not expected to be a
+    // meta-data item.
+    Expects(!iterator.getUnderlyingIterator()->get()->isCheckPointMetaItem());
+
+    /*
+     * Expel from (and including) the first item in the checkpoint queue upto
+     * and including the item pointed to by iterator. The first item (the
+     * dummy) is then swapped into the position of the latter to become the
+     * new dummy item for the checkpoint queue.
+     */
+    const auto first = begin().getUnderlyingIterator();
+    const auto last = iterator.getUnderlyingIterator();
+    for (auto it = std::next(first); it != std::next(last); ++it) {
+        const auto& expelled = *it;
+        if (getState() == CHECKPOINT_OPEN &&
+            !expelled->isCheckPointMetaItem()) {
+            // Whilst cp is open invalidate item. This must be done before
+            // the item is moved, as the keyIndex is verified against the key
+            // of the item an entry points to.
+            const bool found = keyIndex.expel(
+                    expelled->getKey(),
+                    expelled->isCommitted()
+                            ? CheckpointIndexKeyNamespace::Committed
+                            : CheckpointIndexKeyNamespace::Prepared,
+                    end());
+            Expects(found);
         }
 
         /*
@@ -378,16 +493,20 @@ ExpelResult Checkpoint::expelItems(CheckpointCursor& expelUpToAndIncluding) {
          * being expelled from memory, and record the expelled amount in the
          * result.
          */
-        const auto addSize = [](size_t a, queued_item qi) {
-            return a + qi->size();
-        };
-
-        expelResult.estimateOfFreeMemory = std::accumulate(
-                expelledItems.begin(), expelledItems.end(), 0, addSize);
-        queuedItemsMemUsage -= expelResult.estimateOfFreeMemory;
-        expelResult.expelCount = expelledItems.size();
+        expelResult.estimateOfFreeMemory += expelled->size();
+        ++expelResult.expelCount;
     }
 
+    // Swap the item pointed to by our iterator with the dummy item
+    auto dummy = begin().getUnderlyingIterator();
+    iterator.getUnderlyingIterator()->swap(*dummy);
+    queuedItemsMemUsage -= expelResult.estimateOfFreeMemory;
+
+    // Erasing from the front of the queue frees every chunk which has been
+    // expelled completely; this happens before trackOverhead is destroyed,
+    // allowing memOverhead to be tracked.
+    toWrite.erase(first, last);
+
     expelResult.estimateOfFreeMemory +=
             std::abs(trackOverhead.getToWriteDifference());
     return expelResult;
@@ -409,12 +528,12 @@ int64_t Checkpoint::getMutationId(const CheckpointCursor& cursor) const {
         return cursor_item_idx->second.mutation_id;
     }
 
-    auto cursor_item_idx =
-            keyIndex.find({(*cursor.currentPos)->getKey(),
-                           (*cursor.currentPos)->isCommitted()
-                                   ? CheckpointIndexKeyNamespace::Committed
-                                   : CheckpointIndexKeyNamespace::Prepared});
-    if (cursor_item_idx == keyIndex.end()) {
+    const auto* cursor_item_idx =
+            keyIndex.find((*cursor.currentPos)->getKey(),
+                          (*cursor.currentPos)->isCommitted()
+                                  ? CheckpointIndexKeyNamespace::Committed
+                                  : CheckpointIndexKeyNamespace::Prepared);
+    if (!cursor_item_idx) {
         throw std::logic_error(
                 "Checkpoint::queueDirty: Unable "
                 "to find key in keyIndex with op:" +
@@ -422,7 +541,7 @@ int64_t Checkpoint::getMutationId(const CheckpointCursor& cursor) const {
                 " seqno:" + std::to_string((*cursor.currentPos)->getBySeqno()) +
                 "for cursor:" + cursor.name + " in current checkpoint.");
     }
-    return cursor_item_idx->second.mutation_id;
+    return cursor_item_idx->mutation_id;
 }
 
 Checkpoint::TrackOverhead::~TrackOverhead() {
@@ -19,6 +19,7 @@
 
 #include "checkpoint_iterator.h"
 #include "checkpoint_types.h"
+#include "chunked_queue.h"
 #include "ep_types.h"
 #include "item.h"
 #include "monotonic.h"
@@ -31,8 +32,11 @@
 
 #include <list>
 #include <map>
+#include <new>
 #include <set>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 
 #define GIGANTOR ((size_t)1<<(sizeof(size_t)*8-1))
 
@@ -57,11 +61,13 @@ enum checkpoint_state {
 
 const char* to_string(enum checkpoint_state);
 
-// List is used for queueing mutations as vector incurs shift operations for
-// de-duplication.  We template the list on a queued_item and our own
-// memory allocator which allows memory usage to be tracked.
-typedef std::list<queued_item, MemoryTrackingAllocator<queued_item>>
-        CheckpointQueue;
+// A ChunkedQueue is used for queueing mutations; it keeps the queued_items
+// contiguous (unlike a list), while allowing the existing item for a key to be
+// removed on de-duplication without shifting the others (unlike a vector) and
+// keeping cursor positions stable. We template the queue on a queued_item and
+// our own memory allocator which allows memory usage to be tracked.
+using CheckpointQueue =
+        ChunkedQueue<queued_item, MemoryTrackingAllocator<queued_item>>;
 
 // Iterator for the Checkpoint queue.  The iterator is templated on the
 // queue type (CheckpointQueue).
@@ -140,15 +146,135 @@ public:
 } // namespace std
 
 /**
- * The checkpoint index maps a key to a checkpoint index_entry.
+ * The checkpoint index maps a key (and namespace) to the checkpoint
+ * index_entry of the item for that key in the Checkpoint.
+ *
+ * Every item in the Checkpoint has an index entry, so to keep memory usage
+ * down the index does not hold a copy of each key. Instead it is an open
+ * addressing (linear probing) hash table of the key hash and index_entry;
+ * lookups are verified against the key of the item the index_entry
+ * points to.
+ *
+ * That is not possible for items which have been expelled, so when an item
+ * is expelled its (invalidated) entry is moved into a map which does hold a
+ * copy of the key.
+ *
+ * All memory is allocated through the given MemoryTrackingAllocator.
  */
-using checkpoint_index = std::unordered_map<
-        CheckpointIndexKey,
-        index_entry,
-        std::hash<CheckpointIndexKey>,
-        std::equal_to<CheckpointIndexKey>,
-        MemoryTrackingAllocator<
-                std::pair<const CheckpointIndexKey, index_entry>>>;
+class CheckpointKeyIndex {
+public:
+    using allocator_type = MemoryTrackingAllocator<index_entry>;
+
+    explicit CheckpointKeyIndex(const allocator_type& alloc);
+
+    CheckpointKeyIndex(const CheckpointKeyIndex&) = delete;
+    CheckpointKeyIndex& operator=(const CheckpointKeyIndex&) = delete;
+
+    ~CheckpointKeyIndex();
+
+    /**
+     * Find the entry for the given key.
+     * @return the entry, or nullptr if there is none. The pointer is
+     *         invalidated by any subsequent insert() or expel().
+     */
+    index_entry* find(const StoredDocKey& key, CheckpointIndexKeyNamespace ns);
+
+    const index_entry* find(const StoredDocKey& key,
+                            CheckpointIndexKeyNamespace ns) const {
+        return const_cast<CheckpointKeyIndex*>(this)->find(key, ns);
+    }
+
+    /**
+     * Add the entry for the given key, which must point to an item with that
+     * key. To update an existing (non-expelled) entry, assign to the result
+     * of find() instead; any expelled entry for the key is replaced.
+     */
+    void insert(const StoredDocKey& key,
+                CheckpointIndexKeyNamespace ns,
+                const index_entry& entry);
+
+    /**
+     * Invalidate the entry for the given key as its item is being expelled;
+     * must be called while the item is still in the Checkpoint.
+     *
+     * @param end Checkpoint::end()
+     * @return false if there is no (non-expelled) entry for the key.
+     */
+    bool expel(const StoredDocKey& key,
+               CheckpointIndexKeyNamespace ns,
+               const ChkptQueueIterator& end);
+
+    /// @return the number of keys in the index (including expelled ones).
+    size_t size() const {
+        return numSlotsUsed + expelled.size();
+    }
+
+    allocator_type get_allocator() const {
+        return allocator_type(slotAllocator);
+    }
+
+private:
+    struct Slot {
+        bool isEmpty() const {
+            return hash == 0;
+        }
+
+        index_entry& getEntry() {
+            return *reinterpret_cast<index_entry*>(&entry);
+        }
+
+        void set(uint32_t h,
+                 CheckpointIndexKeyNamespace n,
+                 const index_entry& e) {
+            hash = h;
+            ns = n;
+            new (&entry) index_entry(e);
+        }
+
+        /// The key hash; zero if the slot is empty.
+        uint32_t hash = 0;
+        CheckpointIndexKeyNamespace ns = CheckpointIndexKeyNamespace::Committed;
+        /// Only constructed when the slot isn't empty (index_entry is not
+        /// default constructible); trivially destructible so never destroyed.
+        std::aligned_storage<sizeof(index_entry), alignof(index_entry)>::type
+                entry;
+    };
+    static_assert(std::is_trivially_copyable<index_entry>::value &&
+                          std::is_trivially_destructible<index_entry>::value,
+                  "CheckpointKeyIndex::Slot expects a trivial index_entry");
+
+    /// The hash used for key; never zero (which marks an empty slot).
+    static uint32_t hashKey(const StoredDocKey& key);
+
+    size_t slotFor(uint32_t hash) const {
+        // The key hash is a simple string hash; mix the bits before
+        // selecting a slot using the low ones.
+        return (hash * 0x9E3779B1u) & (capacity - 1);
+    }
+
+    /// Grow the table (if needed) to hold another entry.
+    void reserveSlot();
+
+    /// Remove the Slot at index, shifting back any Slots displaced past it.
+    void eraseSlot(size_t index);
+
+    using SlotAllocator = MemoryTrackingAllocator<Slot>;
+    using expelled_index = std::unordered_map<
+            CheckpointIndexKey,
+            index_entry,
+            std::hash<CheckpointIndexKey>,
+            std::equal_to<CheckpointIndexKey>,
+            MemoryTrackingAllocator<
+                    std::pair<const CheckpointIndexKey, index_entry>>>;
+
+    SlotAllocator slotAllocator;
+    Slot* slots = nullptr;
+    /// Number of slots in the table; zero or a power of two.
+    size_t capacity = 0;
+    size_t numSlotsUsed = 0;
+    /// Entries for items which have been expelled from the Checkpoint.
+    expelled_index expelled;
+};
 
 /**
  * The meta_checkpoint_index does not hold items that care about durability so
@@ -494,20 +620,27 @@ public:
         *checkpointState.wlock() = state;
     }
 
-    void incNumOfCursorsInCheckpoint() {
-        ++numOfCursorsInCheckpoint;
+    /// Record that the given cursor now resides in this checkpoint.
+    void addCursor(CheckpointCursor& cursor) {
+        cursors.insert(&cursor);
+    }
+
+    /// Record that the given cursor no longer resides in this checkpoint.
+    void removeCursor(CheckpointCursor& cursor) {
+        cursors.erase(&cursor);
     }
 
-    void decNumOfCursorsInCheckpoint() {
-        --numOfCursorsInCheckpoint;
+    /// @returns the cursors which reside in this checkpoint.
+    const std::unordered_set<CheckpointCursor*>& getCursors() const {
+        return cursors;
     }
 
     bool isNoCursorsInCheckpoint() const {
-        return (numOfCursorsInCheckpoint == 0);
+        return cursors.empty();
     }
 
     size_t getNumCursorsInCheckpoint() const {
-        return numOfCursorsInCheckpoint;
+        return cursors.size();
     }
 
     /**
@@ -725,15 +858,18 @@ private:
     /// Number of meta items (see Item::isCheckPointMetaItem).
     size_t numMetaItems;
 
-    // Count of the number of cursors that reside in the checkpoint
-    cb::NonNegativeCounter<size_t> numOfCursorsInCheckpoint = 0;
+    // The cursors that reside in the checkpoint. Indexed here (rather than
+    // just counted) so that queries which only care about the cursors in
+    // particular checkpoints don't have to visit every cursor of the
+    // CheckpointManager.
+    std::unordered_set<CheckpointCursor*> cursors;
 
     // Allocator used for tracking memory used by toWrite
     MemoryTrackingAllocator<queued_item> trackingAllocator;
     // Allocator used for tracking memory used by keyIndex and metaKeyIndex
-    checkpoint_index::allocator_type keyIndexTrackingAllocator;
+    CheckpointKeyIndex::allocator_type keyIndexTrackingAllocator;
     CheckpointQueue toWrite;
-    checkpoint_index               keyIndex;
+    CheckpointKeyIndex keyIndex;
     /* Index for meta keys like "dummy_key" */
     meta_checkpoint_index metaKeyIndex;
 
@@ -37,6 +37,10 @@ public:
             config.setCheckpointMaxItems(value);
         } else if (key.compare("max_checkpoints") == 0) {
             config.setMaxCheckpoints(value);
+        } else if (key.compare("chk_cursor_read_batch_size") == 0) {
+            config.setCursorReadBatchSize(value);
+        } else if (key.compare("chk_max_size") == 0) {
+            config.setCheckpointMaxSize(value);
         }
     }
 
@@ -83,6 +87,8 @@ CheckpointConfig::CheckpointConfig(EventuallyPersistentEngine& e) {
     itemNumBasedNewCheckpoint = config.isItemNumBasedNewChk();
     keepClosedCheckpoints = config.isKeepClosedChks();
     persistenceEnabled = config.getBucketType() == "persistent";
+    cursorReadBatchSize = config.getChkCursorReadBatchSize();
+    checkpointMaxSize = config.getChkMaxSize();
 }
 
 void CheckpointConfig::addConfigChangeListener(
@@ -103,6 +109,12 @@ void CheckpointConfig::addConfigChangeListener(
     configuration.addValueChangedListener(
             "keep_closed_chks",
             std::make_unique<ChangeListener>(engine.getCheckpointConfig()));
+    configuration.addValueChangedListener(
+            "chk_cursor_read_batch_size",
+            std::make_unique<ChangeListener>(engine.getCheckpointConfig()));
+    configuration.addValueChangedListener(
+            "chk_max_size",
+            std::make_unique<ChangeListener>(engine.getCheckpointConfig()));
 }
 
 bool CheckpointConfig::validateCheckpointMaxItemsParam(
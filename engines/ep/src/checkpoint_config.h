@@ -21,6 +21,8 @@
 
 class EventuallyPersistentEngine;
 
+const size_t DEFAULT_CURSOR_READ_BATCH_SIZE = 0;
+
 /**
  * A class containing the config parameters for checkpoint.
  */
@@ -50,6 +52,14 @@ public:
         return maxCheckpoints;
     }
 
+    size_t getCheckpointMaxSize() const {
+        return checkpointMaxSize;
+    }
+
+    void setCheckpointMaxSize(size_t value) {
+        checkpointMaxSize = value;
+    }
+
     bool isItemNumBasedNewCheckpoint() const {
         return itemNumBasedNewCheckpoint;
     }
@@ -62,6 +72,14 @@ public:
         return persistenceEnabled;
     }
 
+    size_t getCursorReadBatchSize() const {
+        return cursorReadBatchSize;
+    }
+
+    void setCursorReadBatchSize(size_t value) {
+        cursorReadBatchSize = value;
+    }
+
 protected:
     friend class CheckpointConfigChangeListener;
     friend class EventuallyPersistentEngine;
@@ -93,6 +111,8 @@ private:
     size_t checkpointMaxItems;
     // Number of max checkpoints allowed
     size_t maxCheckpoints;
+    // Checkpoint memory budget (in bytes) of each vBucket (0 for no limit)
+    size_t checkpointMaxSize = 0;
     // Flag indicating if a new checkpoint is created once the number of items
     // in the current
     // checkpoint is greater than the max number allowed.
@@ -104,4 +124,8 @@ private:
 
     // Flag indicating if persistence is enabled.
     bool persistenceEnabled;
+
+    // Max number of items a cursor reads while holding the queueLock
+    // (0 for no limit).
+    size_t cursorReadBatchSize = DEFAULT_CURSOR_READ_BATCH_SIZE;
 };
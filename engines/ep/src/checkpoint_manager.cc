@@ -32,6 +32,8 @@
 #include <gsl.h>
 #include <phosphor/phosphor.h>
 
+#include <thread>
+
 CheckpointManager::CheckpointManager(EPStats& st,
                                      Vbid vbucket,
                                      CheckpointConfig& config,
@@ -46,7 +48,7 @@ CheckpointManager::CheckpointManager(EPStats& st,
       lastBySeqno(lastSeqno),
       pCursorPreCheckpointId(0),
       flusherCB(cb) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     lastBySeqno.setLabel("CheckpointManager(" + vbucketId.to_string() +
                          ")::lastBySeqno");
@@ -71,7 +73,7 @@ uint64_t CheckpointManager::getOpenCheckpointId_UNLOCKED(const LockHolder& lh) {
 }
 
 uint64_t CheckpointManager::getOpenCheckpointId() {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return getOpenCheckpointId_UNLOCKED(lh);
 }
 
@@ -82,12 +84,12 @@ uint64_t CheckpointManager::getLastClosedCheckpointId_UNLOCKED(
 }
 
 uint64_t CheckpointManager::getLastClosedCheckpointId() {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return getLastClosedCheckpointId_UNLOCKED(lh);
 }
 
 void CheckpointManager::setOpenCheckpointId(uint64_t id) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     setOpenCheckpointId_UNLOCKED(lh, id);
 }
 
@@ -252,7 +254,7 @@ void CheckpointManager::addOpenCheckpoint(
 
 CursorRegResult CheckpointManager::registerCursorBySeqno(
         const std::string& name, uint64_t startBySeqno) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return registerCursorBySeqno_UNLOCKED(lh, name, startBySeqno);
 }
 
@@ -271,11 +273,9 @@ CursorRegResult CheckpointManager::registerCursorBySeqno_UNLOCKED(
 
     // If cursor exists with the same name as the one being created, then
     // remove it.
-    for (const auto& cursor : connCursors) {
-        if (cursor.first == name) {
-            removeCursor_UNLOCKED(cursor.second.get());
-            break;
-        }
+    auto existing = connCursors.find(name);
+    if (existing != connCursors.end()) {
+        removeCursor_UNLOCKED(existing->second.get());
     }
 
     CursorRegResult result;
@@ -294,7 +294,7 @@ CursorRegResult CheckpointManager::registerCursorBySeqno_UNLOCKED(
                                                              itr,
                                                              (*itr)->begin());
             connCursors[name] = cursor;
-            (*itr)->incNumOfCursorsInCheckpoint();
+            (*itr)->addCursor(*cursor);
             result.seqno = st;
             result.cursor.setCursor(cursor);
             result.tryBackfill = true;
@@ -319,7 +319,7 @@ CursorRegResult CheckpointManager::registerCursorBySeqno_UNLOCKED(
             auto cursor =
                     std::make_shared<CheckpointCursor>(name, itr, iitr);
             connCursors[name] = cursor;
-            (*itr)->incNumOfCursorsInCheckpoint();
+            (*itr)->addCursor(*cursor);
             result.cursor.setCursor(cursor);
             break;
         }
@@ -339,7 +339,7 @@ CursorRegResult CheckpointManager::registerCursorBySeqno_UNLOCKED(
 }
 
 bool CheckpointManager::removeCursor(CheckpointCursor* cursor) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return removeCursor_UNLOCKED(cursor);
 }
 
@@ -365,7 +365,7 @@ bool CheckpointManager::removeCursor_UNLOCKED(CheckpointCursor* cursor) {
                  cursor->name,
                  vbucketId);
 
-    (*cursor->currentCheckpoint)->decNumOfCursorsInCheckpoint();
+    (*cursor->currentCheckpoint)->removeCursor(*cursor);
     cursor->currentCheckpoint = checkpointList.end();
 
     if (connCursors.erase(cursor->name) == 0) {
@@ -418,7 +418,7 @@ size_t CheckpointManager::removeClosedUnrefCheckpoints(
     // returns).
     CheckpointList unrefCheckpointList;
     {
-        LockHolder lh(queueLock);
+        QueueLockHolder lh(queueLock);
         uint64_t oldCheckpointId = 0;
         bool canCreateNewCheckpoint = false;
         if (checkpointList.size() < checkpointConfig.getMaxCheckpoints() ||
@@ -506,7 +506,7 @@ size_t CheckpointManager::removeClosedUnrefCheckpoints(
 ExpelResult CheckpointManager::expelUnreferencedCheckpointItems() {
     ExpelResult expelResult;
     {
-        LockHolder lh(queueLock);
+        QueueLockHolder lh(queueLock);
 
         Checkpoint* oldestCheckpoint = checkpointList.front().get();
 
@@ -524,17 +524,17 @@ ExpelResult CheckpointManager::expelUnreferencedCheckpointItems() {
             return {};
         }
 
-        // Sort first by checkpointID then by seqno to find the first cursor.
-        const auto compareByCkptAndSeqno = [](const auto& a, const auto& b) {
-            return a.second->getCkptIdAndSeqno() <
-                   b.second->getCkptIdAndSeqno();
+        // The oldest checkpoint is referenced, so the cursor with the lowest
+        // seqno is one of the cursors in it; only those need comparing.
+        const auto& oldestCursors = oldestCheckpoint->getCursors();
+        const auto compareByCkptAndSeqno = [](const auto* a, const auto* b) {
+            return a->getCkptIdAndSeqno() < b->getCkptIdAndSeqno();
         };
 
-        auto earliestCursor = std::min_element(
-                connCursors.begin(), connCursors.end(), compareByCkptAndSeqno);
-
-        std::shared_ptr<CheckpointCursor> lowestCheckpointCursor =
-                earliestCursor->second;
+        CheckpointCursor* lowestCheckpointCursor = *std::min_element(
+                oldestCursors.begin(),
+                oldestCursors.end(),
+                compareByCkptAndSeqno);
 
         // Sanity check - if the oldest checkpoint is referenced, the cursor
         // with the lowest seqno should be in that checkpoint.
@@ -602,51 +602,33 @@ ExpelResult CheckpointManager::expelUnreferencedCheckpointItems() {
 }
 
 std::vector<Cursor> CheckpointManager::getListOfCursorsToDrop() {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     Checkpoint* persistentCheckpoint =
             (persistenceCursor == nullptr)
                     ? nullptr
                     : persistenceCursor->currentCheckpoint->get();
     /*
-     * Iterate through the list of checkpoints and add the checkpoint to
-     * a set of valid checkpoints until we reach either an open checkpoint
-     * or a checkpoint that contains the persistence cursor.
+     * Iterate through the list of checkpoints until we reach either an open
+     * checkpoint or a checkpoint that contains the persistence cursor. The
+     * cursors residing in the checkpoints before that can be dropped; each
+     * checkpoint indexes its own cursors, so only those are visited.
      */
-    std::unordered_set<Checkpoint*> validChkpts;
+    std::vector<Cursor> cursorsToDrop;
     for (const auto& chkpt : checkpointList) {
         if (persistentCheckpoint == chkpt.get() ||
             chkpt->getState() == CHECKPOINT_OPEN) {
             break;
-        } else {
-            validChkpts.insert(chkpt.get());
         }
-    }
-
-    /*
-     * If we cannot find any valid checkpoints to remove cursors from
-     * then just return an empty vector.
-     */
-    if (validChkpts.empty()) {
-        return {};
-    }
-
-    /*
-     * Iterate through all cursors and if the cursor resides in one of the
-     * valid checkpoints (i.e. a checkpoint that cursors can be deleted
-     * from) then add the cursor to the cursorsToDrop vector.
-     */
-    std::vector<Cursor> cursorsToDrop;
-    for (const auto& cursor : connCursors) {
-        if (validChkpts.count(cursor.second->currentCheckpoint->get()) > 0) {
-            cursorsToDrop.emplace_back(cursor.second);
+        for (const auto* cursor : chkpt->getCursors()) {
+            cursorsToDrop.emplace_back(connCursors.at(cursor->name));
         }
     }
     return cursorsToDrop;
 }
 
 bool CheckpointManager::hasClosedCheckpointWhichCanBeRemoved() const {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     // Check oldest checkpoint; if closed and contains no cursors then
     // we can remove it (and possibly additional old-but-not-oldest
     // checkpoints).
@@ -677,7 +659,7 @@ bool CheckpointManager::queueDirty(
                  "seqno",
                  qi->getBySeqno());
 
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     bool canCreateNewCheckpoint = false;
     if (checkpointList.size() < checkpointConfig.getMaxCheckpoints() ||
@@ -787,7 +769,7 @@ void CheckpointManager::queueSetVBState(VBucket& vb) {
     auto vbstate = vb.getTransitionState();
 
     // Take lock to serialize use of {lastBySeqno} and to queue op.
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     // Create the setVBState operation, and enqueue it.
     queued_item item = createCheckpointItem(/*id*/0, vbucketId,
@@ -830,13 +812,15 @@ CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor(
                  "CheckpointManager::getItemsForCursor",
                  "vbid",
                  vbucketId.get());
-    LockHolder lh(queueLock);
     if (!cursorPtr) {
         EP_LOG_WARN("getItemsForCursor(): Caller had a null cursor {}",
                     vbucketId);
         return {};
     }
 
+    const auto batchSize = checkpointConfig.getCursorReadBatchSize();
+    std::unique_lock<std::mutex> lh(queueLock);
+
     auto& cursor = *cursorPtr;
 
     // Fetch whole checkpoints; as long as we don't exceed the approx item
@@ -845,6 +829,7 @@ CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor(
                           (*cursor.currentCheckpoint)->getMaxDeletedRevSeqno());
 
     size_t itemCount = 0;
+    size_t batchCount = 0;
     bool enteredNewCp = true;
     while ((result.moreAvailable = incrCursor(cursor))) {
         // We only want to return items from contiguous checkpoints with the
@@ -894,6 +879,24 @@ CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor(
                 break;
             }
         }
+
+        // Only yield while the cursor is in a closed checkpoint. Writes
+        // meanwhile go to the open checkpoint, where de-duplication could
+        // move an unread item of the snapshot range already recorded above
+        // its end. The cursor may still be removed (cursor dropping)
+        // meanwhile; incrCursor handles that.
+        if (batchSize != 0 && ++batchCount >= batchSize &&
+            (*cursor.currentCheckpoint)->getState() == CHECKPOINT_CLOSED) {
+            // Let any front-end writes waiting on the lock in.
+            batchCount = 0;
+            lh.unlock();
+            if (cursorReadYieldHook) {
+                cursorReadYieldHook();
+            } else {
+                std::this_thread::yield();
+            }
+            lh.lock();
+        }
     }
 
     if (globalBucketLogger->should_log(spdlog::level::debug)) {
@@ -942,17 +945,17 @@ void CheckpointManager::notifyFlusher() {
 }
 
 void CheckpointManager::setBySeqno(int64_t seqno) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     lastBySeqno = seqno;
 }
 
 int64_t CheckpointManager::getHighSeqno() const {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return lastBySeqno;
 }
 
 int64_t CheckpointManager::nextBySeqno() {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return ++lastBySeqno;
 }
 
@@ -961,7 +964,7 @@ void CheckpointManager::dump() const {
 }
 
 void CheckpointManager::clear(VBucket& vb, uint64_t seqno) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     clear_UNLOCKED(vb.getState(), seqno);
 
     // Reset the disk write queue size stat for the vbucket
@@ -1005,8 +1008,8 @@ void CheckpointManager::resetCursors(bool resetPersistenceCursor) {
 
         // Only change the counts if the checkpoints are different
         if (cit.second->currentCheckpoint != checkpointList.begin()) {
-            (*cit.second->currentCheckpoint)->decNumOfCursorsInCheckpoint();
-            checkpointList.front()->incNumOfCursorsInCheckpoint();
+            (*cit.second->currentCheckpoint)->removeCursor(*cit.second);
+            checkpointList.front()->addCursor(*cit.second);
         }
 
         cit.second->currentCheckpoint = checkpointList.begin();
@@ -1029,19 +1032,19 @@ bool CheckpointManager::moveCursorToNextCheckpoint(CheckpointCursor &cursor) {
     }
 
     // Remove cursor from its current checkpoint.
-    (*it)->decNumOfCursorsInCheckpoint();
+    (*it)->removeCursor(cursor);
 
     // Move the cursor to the next checkpoint.
     ++it;
     cursor.currentPos = (*it)->begin();
     // Add cursor to its new current checkpoint.
-    (*it)->incNumOfCursorsInCheckpoint();
+    (*it)->addCursor(cursor);
 
     return true;
 }
 
 size_t CheckpointManager::getNumOpenChkItems() const {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return getOpenCheckpoint_UNLOCKED(lh).getNumItems();
 }
 
@@ -1061,10 +1064,15 @@ uint64_t CheckpointManager::checkOpenCheckpoint_UNLOCKED(const LockHolder& lh,
     // (2) current checkpoint is reached to the max number of items allowed.
     // (3) time elapsed since the creation of the current checkpoint is greater
     //     than the threshold
+    // (4) current checkpoint uses at least the vBucket's checkpoint memory
+    //     budget.
+    const auto maxSize = checkpointConfig.getCheckpointMaxSize();
     if (forceCreation ||
         (checkpointConfig.isItemNumBasedNewCheckpoint() &&
          openCkpt.getNumItems() >= checkpointConfig.getCheckpointMaxItems()) ||
-        (openCkpt.getNumItems() > 0 && timeBound)) {
+        (openCkpt.getNumItems() > 0 && timeBound) ||
+        (maxSize != 0 && openCkpt.getNumItems() > 0 &&
+         openCkpt.getMemConsumption() >= maxSize)) {
         checkpoint_id = openCkpt.getId();
         addNewCheckpoint_UNLOCKED(checkpoint_id + 1);
     }
@@ -1073,7 +1081,7 @@ uint64_t CheckpointManager::checkOpenCheckpoint_UNLOCKED(const LockHolder& lh,
 
 size_t CheckpointManager::getNumItemsForCursor(
         const CheckpointCursor* cursor) const {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return getNumItemsForCursor_UNLOCKED(cursor);
 }
 
@@ -1101,7 +1109,7 @@ size_t CheckpointManager::getNumItemsForCursor_UNLOCKED(
 }
 
 void CheckpointManager::clear(vbucket_state_t vbState) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     clear_UNLOCKED(vbState, lastBySeqno);
 }
 
@@ -1121,7 +1129,7 @@ bool CheckpointManager::isLastMutationItemInCheckpoint(
 }
 
 void CheckpointManager::setBackfillPhase(uint64_t start, uint64_t end) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     setOpenCheckpointId_UNLOCKED(lh, 0);
     auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
     openCkpt.setSnapshotStartSeqno(start);
@@ -1133,7 +1141,7 @@ void CheckpointManager::createSnapshot(
         uint64_t snapEndSeqno,
         boost::optional<uint64_t> highCompletedSeqno,
         CheckpointType checkpointType) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
     const auto openCkptId = openCkpt.getId();
@@ -1158,7 +1166,7 @@ void CheckpointManager::createSnapshot(
 }
 
 void CheckpointManager::resetSnapshotRange() {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     checkpointList.back()->setSnapshotStartSeqno(
             static_cast<uint64_t>(lastBySeqno));
@@ -1168,7 +1176,7 @@ void CheckpointManager::resetSnapshotRange() {
 
 void CheckpointManager::updateCurrentSnapshot(uint64_t snapEnd,
                                               CheckpointType checkpointType) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     auto& ckpt = getOpenCheckpoint_UNLOCKED(lh);
     ckpt.setSnapshotEndSeqno(snapEnd);
@@ -1176,7 +1184,7 @@ void CheckpointManager::updateCurrentSnapshot(uint64_t snapEnd,
 }
 
 snapshot_info_t CheckpointManager::getSnapshotInfo() {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
@@ -1201,7 +1209,7 @@ snapshot_info_t CheckpointManager::getSnapshotInfo() {
 }
 
 uint64_t CheckpointManager::getOpenSnapshotStartSeqno() const {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
     return openCkpt.getSnapshotStartSeqno();
@@ -1252,7 +1260,7 @@ queued_item CheckpointManager::createCheckpointItem(uint64_t id,
 }
 
 uint64_t CheckpointManager::createNewCheckpoint() {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
@@ -1265,12 +1273,12 @@ uint64_t CheckpointManager::createNewCheckpoint() {
 }
 
 uint64_t CheckpointManager::getPersistenceCursorPreChkId() {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return pCursorPreCheckpointId;
 }
 
 void CheckpointManager::itemsPersisted() {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     auto itr = persistenceCursor->currentCheckpoint;
     pCursorPreCheckpointId = ((*itr)->getId() > 0) ? (*itr)->getId() - 1 : 0;
 }
@@ -1292,12 +1300,17 @@ size_t CheckpointManager::getMemoryOverhead_UNLOCKED() const {
 }
 
 size_t CheckpointManager::getMemoryUsage() const {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return getMemoryUsage_UNLOCKED();
 }
 
+bool CheckpointManager::isOverMemoryBudget() const {
+    const auto maxSize = checkpointConfig.getCheckpointMaxSize();
+    return maxSize != 0 && getMemoryUsage() > maxSize;
+}
+
 size_t CheckpointManager::getMemoryUsageOfUnrefCheckpoints() const {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
 
     size_t memUsage = 0;
     for (const auto& checkpoint : checkpointList) {
@@ -1311,13 +1324,13 @@ size_t CheckpointManager::getMemoryUsageOfUnrefCheckpoints() const {
 }
 
 size_t CheckpointManager::getMemoryOverhead() const {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     return getMemoryOverhead_UNLOCKED();
 }
 
 void CheckpointManager::addStats(const AddStatFn& add_stat,
                                  const void* cookie) {
-    LockHolder lh(queueLock);
+    QueueLockHolder lh(queueLock);
     char buf[256];
 
     try {
@@ -20,6 +20,7 @@
 #include "checkpoint_types.h"
 #include "cursor.h"
 #include "ep_types.h"
+#include "lock_profiler.h"
 #include "monotonic.h"
 #include "queue_op.h"
 
@@ -210,6 +211,12 @@ public:
      * Note: It is only valid to fetch complete checkpoints; as such we cannot
      * limit to a precise number of items.
      *
+     * While reading closed checkpoints the queueLock is released briefly
+     * every chk_cursor_read_batch_size items, so a long read doesn't block
+     * front-end writes for its whole duration. The open checkpoint is read
+     * without releasing the lock, as de-duplication could otherwise move an
+     * unread item out of the snapshot range recorded for it.
+     *
      * @param cursor CheckpointCursor to read items from and advance
      * @param[in/out] items container which items will be appended to.
      * @param approxLimit Approximate number of items to add.
@@ -336,6 +343,12 @@ public:
      */
     size_t getMemoryUsageOfUnrefCheckpoints() const;
 
+    /**
+     * @return true if the checkpoints use more memory than the vBucket's
+     *         checkpoint memory budget (chk_max_size)
+     */
+    bool isOverMemoryBudget() const;
+
     /**
      * Function returns a list of cursors to drop so as to unreference
      * certain checkpoints within the manager, invoked by the cursor-dropper.
@@ -396,6 +409,13 @@ public:
     std::function<void(const CheckpointCursor* cursor, Vbid vbid)>
             runGetItemsHook;
 
+    /**
+     * Member std::function variable, to allow us to inject code into
+     * getItemsForCursor() while it has released the queueLock between
+     * batches of items.
+     */
+    std::function<void()> cursorReadYieldHook;
+
 protected:
     /**
      * Advance the given cursor. Protected as it's valid to call this from
@@ -513,6 +533,10 @@ protected:
                                      Vbid vbid,
                                      queue_op checkpoint_op);
 
+    /// LockHolder for queueLock, profiled by the LockProfiler.
+    using QueueLockHolder =
+            ProfiledLockHolder<LockHolder, LockProfiler::Site::CheckpointQueue>;
+
     EPStats                 &stats;
     CheckpointConfig        &checkpointConfig;
     mutable std::mutex       queueLock;
@@ -16,6 +16,7 @@
  */
 
 #include "bucket_logger.h"
+#include "checkpoint_config.h"
 #include "checkpoint_manager.h"
 #include "checkpoint_remover.h"
 #include "checkpoint_visitor.h"
@@ -64,6 +65,9 @@
 //    cursor_dropping_checkpoint_mem_upper_mark and 'mem_used' (Y) is greater
 //    than mem_low_watermark (L).
 // 2) If 'mem_used' (Y) is greater than cursor_dropping_upper_mark (D)
+// 3) If checkpoint_memory_ratio is non-zero and checkpoint memory usage (X) is
+//    greater than that percentage of the bucket quota (the checkpoint memory
+//    budget of the bucket), whatever 'mem_used' (Y) is.
 //
 // If case 1 is the trigger this function will return X - A as the target amount
 // to free.
@@ -71,6 +75,9 @@
 // If case 2 is the trigger this function will return Y - C as the target amount
 // to free.
 //
+// If case 3 is the trigger this function will return the amount X exceeds the
+// budget by.
+//
 // When memory reduction is required two different techniques are applied:
 // 1) First checkpoint expelling. If that technique does not 'free' the required
 //    target, then a second technique is applied.
@@ -106,6 +113,11 @@ ClosedUnrefCheckpointRemoverTask::isReductionInCheckpointMemoryNeeded() const {
     const bool memUsedExceedsCursorDroppingUpperMark =
             memUsed > stats.cursorDroppingUThreshold.load();
 
+    const auto chkptMemBudget =
+            (bucketQuota * config.getCheckpointMemoryRatio()) / 100;
+    const bool ckptMemExceedsBudget =
+            chkptMemBudget != 0 && vBucketChkptMemSize > chkptMemBudget;
+
     auto toMB = [](size_t bytes) { return bytes / (1024 * 1024); };
     if (memUsedExceedsCursorDroppingUpperMark ||
         ckptMemExceedsCheckpointMemoryThreshold) {
@@ -145,6 +157,18 @@ ClosedUnrefCheckpointRemoverTask::isReductionInCheckpointMemoryNeeded() const {
         // Memory recovery is required.
         return std::make_pair(true, amountOfMemoryToClear);
     }
+    if (ckptMemExceedsBudget) {
+        const auto amountOfMemoryToClear = vBucketChkptMemSize - chkptMemBudget;
+        EP_LOG_INFO(
+                "Triggering memory recovery as checkpoint_memory ({} MB) "
+                "exceeds checkpoint_memory_ratio ({}%, {} MB). Attempting to "
+                "free {} MB of memory.",
+                toMB(vBucketChkptMemSize),
+                config.getCheckpointMemoryRatio(),
+                toMB(chkptMemBudget),
+                toMB(amountOfMemoryToClear));
+        return std::make_pair(true, amountOfMemoryToClear);
+    }
     // Memory recovery is not required.
     return std::make_pair(false, 0);
 }
@@ -204,6 +228,39 @@ size_t ClosedUnrefCheckpointRemoverTask::attemptMemoryRecovery(
     return memoryCleared;
 }
 
+size_t ClosedUnrefCheckpointRemoverTask::expelOverBudgetVBuckets() {
+    KVBucketIface* kvBucket = engine->getKVBucket();
+    const auto maxSize = engine->getCheckpointConfig().getCheckpointMaxSize();
+    if (maxSize == 0) {
+        return 0;
+    }
+
+    size_t memoryCleared = 0;
+    auto vbuckets = kvBucket->getVBuckets().getVBucketsSortedByChkMgrMem();
+    for (const auto& it : vbuckets) {
+        if (it.second <= maxSize) {
+            continue;
+        }
+        VBucketPtr vb = kvBucket->getVBucket(it.first);
+        if (!vb) {
+            continue;
+        }
+        auto expelResult =
+                vb->checkpointManager->expelUnreferencedCheckpointItems();
+        EP_LOG_DEBUG(
+                "Expelled {} unreferenced checkpoint items from {} as its "
+                "checkpoints use {} bytes (chk_max_size {}), estimated to "
+                "have recovered {} bytes.",
+                expelResult.expelCount,
+                vb->getId(),
+                it.second,
+                maxSize,
+                expelResult.estimateOfFreeMemory);
+        memoryCleared += expelResult.estimateOfFreeMemory;
+    }
+    return memoryCleared;
+}
+
 bool ClosedUnrefCheckpointRemoverTask::run(void) {
     TRACE_EVENT0("ep-engine/task", "ClosedUnrefCheckpointRemoverTask");
     bool inverse = true;
@@ -212,6 +269,11 @@ bool ClosedUnrefCheckpointRemoverTask::run(void) {
         size_t amountOfMemoryToClear{0};
         size_t amountOfMemoryRecovered{0};
 
+        // Keep every vBucket within its own checkpoint memory budget first
+        if (engine->getConfiguration().isChkExpelEnabled()) {
+            expelOverBudgetVBuckets();
+        }
+
         std::tie(shouldReduceMemory, amountOfMemoryToClear) =
                 isReductionInCheckpointMemoryNeeded();
         if (shouldReduceMemory) {
@@ -53,6 +53,13 @@ public:
     size_t attemptMemoryRecovery(MemoryRecoveryMechanism mechanism,
                                  size_t amountOfMemoryToClear);
 
+    /**
+     * Expels items from the checkpoints of every vBucket which uses more
+     * than its checkpoint memory budget (chk_max_size).
+     * @return the amount (in bytes) that was recovered.
+     */
+    size_t expelOverBudgetVBuckets();
+
     bool run(void);
 
     std::string getDescription() {
@@ -0,0 +1,387 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * A sequence container with the iterator semantics of std::list, but which
+ * stores its elements contiguously in fixed size chunks (an unrolled linked
+ * list).
+ *
+ * Compared to std::list this needs one allocation per ChunkSize elements
+ * (instead of one per element), has no per-element pointer overhead, and
+ * iterating touches adjacent memory - at the cost of holding on to chunks
+ * which are only partially used.
+ *
+ * Elements may only be added at the back, but may be erased from anywhere.
+ * As with std::list:
+ *
+ * - push_back() / emplace_back() invalidate no iterators (end() remains
+ *   end()).
+ * - erase() only invalidates iterators to the erased elements.
+ *
+ * An element erased from the middle of a chunk leaves a hole which is
+ * skipped by iteration; the chunk is freed once all of its elements have
+ * been erased. Erasing from the front (e.g. erase(begin(), pos)) is
+ * therefore cheap, freeing whole chunks at a time.
+ *
+ * All memory is allocated through (a rebound copy of) the given Allocator.
+ */
+template <class T, class Allocator = std::allocator<T>, size_t ChunkSize = 64>
+class ChunkedQueue {
+    static_assert(ChunkSize > 0 && ChunkSize <= 64,
+                  "ChunkedQueue: ChunkSize must be in the range [1, 64]");
+
+    struct Chunk {
+        bool isErased(size_t slot) const {
+            return (erased >> slot) & 1;
+        }
+
+        T* at(size_t slot) {
+            return reinterpret_cast<T*>(&slots[slot]);
+        }
+
+        Chunk* prev = nullptr;
+        Chunk* next = nullptr;
+        /// Index of the first slot which may hold an element.
+        uint8_t first = 0;
+        /// Index one past the last slot which has been used.
+        uint8_t last = 0;
+        /// Number of elements (not erased) in the chunk.
+        uint8_t live = 0;
+        /// Bitmask of the slots in [first, last) whose element was erased.
+        uint64_t erased = 0;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type
+                slots[ChunkSize];
+    };
+
+    using ChunkAllocator =
+            typename std::allocator_traits<Allocator>::template rebind_alloc<
+                    Chunk>;
+    using ChunkAllocTraits = std::allocator_traits<ChunkAllocator>;
+
+    template <bool IsConst>
+    class Iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename std::conditional<IsConst, const T*, T*>::type;
+        using reference =
+                typename std::conditional<IsConst, const T&, T&>::type;
+
+        Iterator() = default;
+
+        /// Allow conversion from iterator to const_iterator.
+        template <bool WasConst,
+                  typename = typename std::enable_if<IsConst && !WasConst>::type>
+        Iterator(const Iterator<WasConst>& other)
+            : queue(other.queue), chunk(other.chunk), slot(other.slot) {
+        }
+
+        reference operator*() const {
+            return *chunk->at(slot);
+        }
+
+        pointer operator->() const {
+            return chunk->at(slot);
+        }
+
+        Iterator& operator++() {
+            ++slot;
+            skipForward();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto before = *this;
+            operator++();
+            return before;
+        }
+
+        Iterator& operator--() {
+            if (chunk == nullptr) {
+                // end() - step back into the last chunk.
+                chunk = queue->tail;
+                slot = chunk->last;
+            }
+            do {
+                while (slot == chunk->first) {
+                    chunk = chunk->prev;
+                    slot = chunk->last;
+                }
+                --slot;
+            } while (chunk->isErased(slot));
+            return *this;
+        }
+
+        Iterator operator--(int) {
+            auto before = *this;
+            operator--();
+            return before;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return chunk == other.chunk && slot == other.slot;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !operator==(other);
+        }
+
+    private:
+        friend class ChunkedQueue;
+        template <bool>
+        friend class Iterator;
+
+        Iterator(const ChunkedQueue* queue, Chunk* chunk, size_t slot)
+            : queue(queue), chunk(chunk), slot(uint8_t(slot)) {
+            skipForward();
+        }
+
+        /// Advance (if necessary) from slot to the next element, or end().
+        void skipForward() {
+            while (chunk != nullptr) {
+                if (slot == chunk->last) {
+                    chunk = chunk->next;
+                    slot = chunk ? chunk->first : 0;
+                } else if (chunk->isErased(slot)) {
+                    ++slot;
+                } else {
+                    return;
+                }
+            }
+            slot = 0;
+        }
+
+        const ChunkedQueue* queue = nullptr;
+        /// nullptr for end().
+        Chunk* chunk = nullptr;
+        uint8_t slot = 0;
+    };
+
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = typename std::allocator_traits<Allocator>::pointer;
+    using const_pointer =
+            typename std::allocator_traits<Allocator>::const_pointer;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    static constexpr size_t chunkSize = ChunkSize;
+
+    ChunkedQueue() = default;
+
+    explicit ChunkedQueue(const Allocator& alloc) : alloc(alloc) {
+    }
+
+    ChunkedQueue(const ChunkedQueue&) = delete;
+    ChunkedQueue& operator=(const ChunkedQueue&) = delete;
+
+    ~ChunkedQueue() {
+        clear();
+    }
+
+    allocator_type get_allocator() const {
+        return allocator_type(alloc);
+    }
+
+    iterator begin() {
+        return iterator(this, head, head ? head->first : 0);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, head, head ? head->first : 0);
+    }
+
+    iterator end() {
+        return iterator(this, nullptr, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, nullptr, 0);
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    size_type size() const {
+        return count;
+    }
+
+    reference front() {
+        return *begin();
+    }
+
+    reference back() {
+        return *std::prev(end());
+    }
+
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    template <class... Args>
+    reference emplace_back(Args&&... args) {
+        if (tail == nullptr || tail->last == ChunkSize) {
+            appendChunk();
+        }
+        auto* element = tail->at(tail->last);
+        new (element) T(std::forward<Args>(args)...);
+        ++tail->last;
+        ++tail->live;
+        ++count;
+        return *element;
+    }
+
+    /**
+     * Erase the element at pos.
+     * @return iterator to the element following pos.
+     */
+    iterator erase(const_iterator pos) {
+        auto* chunk = pos.chunk;
+        const auto slot = pos.slot;
+        iterator next(this, chunk, slot + 1);
+
+        chunk->at(slot)->~T();
+        chunk->erased |= uint64_t(1) << slot;
+        --chunk->live;
+        --count;
+
+        if (chunk->live == 0) {
+            if (chunk == tail) {
+                // Keep the (now empty) tail around to append to.
+                chunk->first = chunk->last = 0;
+                chunk->erased = 0;
+                next = end();
+            } else {
+                freeChunk(chunk);
+            }
+        } else {
+            // Trim any erased slots from the front of the chunk, so walking
+            // from begin() (the common case) doesn't have to skip them.
+            while (chunk->first < chunk->last &&
+                   chunk->isErased(chunk->first)) {
+                chunk->erased &= ~(uint64_t(1) << chunk->first);
+                ++chunk->first;
+            }
+        }
+        return next;
+    }
+
+    /**
+     * Erase the elements in the range [first, last).
+     * @return last
+     */
+    iterator erase(const_iterator first, const_iterator last) {
+        while (first != last) {
+            first = erase(first);
+        }
+        return iterator(this, last.chunk, last.slot);
+    }
+
+    void clear() {
+        while (head != nullptr) {
+            auto* chunk = head;
+            head = chunk->next;
+            destroyElements(*chunk);
+            deallocateChunk(chunk);
+        }
+        tail = nullptr;
+        count = 0;
+    }
+
+    /// @return the number of chunks currently allocated.
+    size_t getNumChunks() const {
+        return numChunks;
+    }
+
+    /// @return the number of bytes allocated for each chunk.
+    static constexpr size_t getChunkAllocationSize() {
+        return sizeof(Chunk);
+    }
+
+private:
+    void appendChunk() {
+        auto* chunk = ChunkAllocTraits::allocate(alloc, 1);
+        new (chunk) Chunk();
+        chunk->prev = tail;
+        if (tail) {
+            tail->next = chunk;
+        } else {
+            head = chunk;
+        }
+        tail = chunk;
+        ++numChunks;
+    }
+
+    /// Unlink an (empty) chunk from the queue and free it.
+    void freeChunk(Chunk* chunk) {
+        if (chunk->prev) {
+            chunk->prev->next = chunk->next;
+        } else {
+            head = chunk->next;
+        }
+        if (chunk->next) {
+            chunk->next->prev = chunk->prev;
+        } else {
+            tail = chunk->prev;
+        }
+        deallocateChunk(chunk);
+    }
+
+    void deallocateChunk(Chunk* chunk) {
+        chunk->~Chunk();
+        ChunkAllocTraits::deallocate(alloc, chunk, 1);
+        --numChunks;
+    }
+
+    static void destroyElements(Chunk& chunk) {
+        for (size_t slot = chunk.first; slot < chunk.last; ++slot) {
+            if (!chunk.isErased(slot)) {
+                chunk.at(slot)->~T();
+            }
+        }
+    }
+
+    ChunkAllocator alloc;
+    Chunk* head = nullptr;
+    Chunk* tail = nullptr;
+    size_t count = 0;
+    size_t numChunks = 0;
+};
+
+template <class T, class Allocator, size_t ChunkSize>
+constexpr size_t ChunkedQueue<T, Allocator, ChunkSize>::chunkSize;
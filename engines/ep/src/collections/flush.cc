@@ -93,5 +93,6 @@ void Collections::VB::Flush::checkAndTriggerPurge(Vbid vbid,
 void Collections::VB::Flush::triggerPurge(Vbid vbid, KVBucket& bucket) {
     CompactionConfig config;
     config.db_file_id = vbid;
+    config.dropped_collections_only = true;
     bucket.scheduleCompaction(vbid, config, nullptr);
 }
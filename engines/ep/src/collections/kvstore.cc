@@ -17,6 +17,7 @@
 
 #include "collections/kvstore.h"
 #include "collections/kvstore_generated.h"
+#include <map>
 #include <sstream>
 
 namespace Collections {
@@ -255,6 +256,68 @@ flatbuffers::DetachedBuffer encodeDroppedCollections(
     return builder.Release();
 }
 
+flatbuffers::DetachedBuffer encodeCollectionsStats(
+        const std::unordered_map<CollectionID, VB::PersistedStats>& updated,
+        const std::vector<DroppedCollection>& droppedCollections,
+        cb::const_byte_buffer stats) {
+    // Merge what was read with the updates (ordered by collection, so the
+    // same stats always encode the same way).
+    std::map<CollectionIDType, VB::PersistedStats> merged;
+    if (stats.size() > 0) {
+        verifyFlatbuffersData<Collections::KVStore::CollectionsStats>(
+                stats, "encodeCollectionsStats()");
+        auto fbData =
+                flatbuffers::GetRoot<Collections::KVStore::CollectionsStats>(
+                        stats.data());
+        for (const auto& entry : *fbData->entries()) {
+            merged[entry->collectionId()] = {entry->itemCount(),
+                                             entry->highSeqno()};
+        }
+    }
+    for (const auto& entry : updated) {
+        merged[entry.first] = entry.second;
+    }
+    for (const auto& dropped : droppedCollections) {
+        merged.erase(dropped.collectionId);
+    }
+
+    flatbuffers::FlatBufferBuilder builder;
+    std::vector<flatbuffers::Offset<Collections::KVStore::CollectionStats>>
+            entries;
+    entries.reserve(merged.size());
+    for (const auto& entry : merged) {
+        entries.push_back(Collections::KVStore::CreateCollectionStats(
+                builder,
+                entry.first,
+                entry.second.itemCount,
+                entry.second.highSeqno));
+    }
+
+    auto vector = builder.CreateVectorOfSortedTables(&entries);
+    auto final = Collections::KVStore::CreateCollectionsStats(builder, vector);
+    builder.Finish(final);
+
+    // write back
+    return builder.Release();
+}
+
+boost::optional<VB::PersistedStats> decodeCollectionStats(
+        cb::const_byte_buffer stats, CollectionID cid) {
+    if (stats.size() == 0) {
+        return {};
+    }
+    verifyFlatbuffersData<Collections::KVStore::CollectionsStats>(
+            stats, "decodeCollectionStats()");
+    auto fbData = flatbuffers::GetRoot<Collections::KVStore::CollectionsStats>(
+            stats.data());
+    // entries are sorted by collectionId; binary search for cid
+    const auto* entry = fbData->entries()->LookupByKey(uint32_t(cid));
+    if (!entry) {
+        return {};
+    }
+    return VB::PersistedStats(entry->itemCount(), entry->highSeqno());
+}
+
 flatbuffers::DetachedBuffer encodeScopes(
         Collections::KVStore::CommitMetaData& collectionsMeta,
         cb::const_byte_buffer scopes) {
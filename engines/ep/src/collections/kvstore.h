@@ -24,8 +24,11 @@
 
 #pragma once
 
+#include "collections/collection_persisted_stats.h"
 #include "collections/collections_types.h"
+#include <boost/optional.hpp>
 #include <flatbuffers/flatbuffers.h>
+#include <unordered_map>
 #include <vector>
 
 class DiskDocKey;
@@ -210,6 +213,28 @@ flatbuffers::DetachedBuffer encodeScopes(
         Collections::KVStore::CommitMetaData& collectionsMeta,
         cb::const_byte_buffer scopes);
 
+/**
+ * Encode the persisted stats of the vBucket's collections into a flatbuffer.
+ * Includes merging with what was read off disk.
+ * @param updated the stats of the collections changed by the flush
+ * @param droppedCollections collections whose stats are to be removed
+ * @param stats collection stats buffer from local data store
+ */
+flatbuffers::DetachedBuffer encodeCollectionsStats(
+        const std::unordered_map<CollectionID, VB::PersistedStats>& updated,
+        const std::vector<DroppedCollection>& droppedCollections,
+        cb::const_byte_buffer stats);
+
+/**
+ * Decode the stats of one collection from the local doc buffer.
+ * @param stats collection stats buffer from local data store
+ * @param cid collection to look up
+ * @return the collection's stats, or an uninitialised optional if the buffer
+ *         doesn't hold any for it.
+ */
+boost::optional<VB::PersistedStats> decodeCollectionStats(
+        cb::const_byte_buffer stats, CollectionID cid);
+
 /// callback to inform KV-engine that KVStore dropped key@seqno
 using DroppedCb = std::function<void(const DiskDocKey&, int64_t)>;
 
@@ -243,6 +243,23 @@ public:
     Collections::Summary summary;
 };
 
+/// Sums the HashTable item memory of the given collections over all vbuckets
+class CollectionMemoryVBucketVisitor : public VBucketVisitor {
+public:
+    explicit CollectionMemoryVBucketVisitor(std::vector<CollectionID> cids) {
+        for (const auto cid : cids) {
+            summary[cid] = 0;
+        }
+    }
+
+    void visitBucket(const VBucketPtr& vb) override {
+        for (auto& entry : summary) {
+            entry.second += vb->ht.getCollectionItemMemory(entry.first);
+        }
+    }
+    Collections::Summary summary;
+};
+
 class CollectionDetailedVBucketVisitor : public VBucketVisitor {
 public:
     CollectionDetailedVBucketVisitor(const void* c, const AddStatFn& a)
@@ -295,6 +312,40 @@ private:
 // collections
 //   - return top level stats (manager/manifest)
 //   - return per collection item counts from all active VBs
+std::unordered_set<CollectionID>
+Collections::Manager::getEvictionPreferredCollections(KVBucket& bucket) const {
+    std::vector<CollectionEntry> settings;
+    {
+        std::lock_guard<std::mutex> lg(lock);
+        if (current) {
+            settings = current->getEvictionSettings();
+        }
+    }
+
+    std::unordered_set<CollectionID> rv;
+    std::vector<CollectionID> withQuota;
+    for (const auto& collection : settings) {
+        if (collection.lowEvictionPriority) {
+            rv.insert(collection.id);
+        } else if (collection.memQuota) {
+            withQuota.push_back(collection.id);
+        }
+    }
+
+    if (!withQuota.empty()) {
+        CollectionMemoryVBucketVisitor visitor(std::move(withQuota));
+        bucket.visit(visitor);
+        for (const auto& collection : settings) {
+            auto itr = visitor.summary.find(collection.id);
+            if (itr != visitor.summary.end() &&
+                itr->second > collection.memQuota.get()) {
+                rv.insert(collection.id);
+            }
+        }
+    }
+    return rv;
+}
+
 ENGINE_ERROR_CODE Collections::Manager::doCollectionStats(
         KVBucket& bucket,
         const void* cookie,
@@ -333,6 +384,12 @@ ENGINE_ERROR_CODE Collections::Manager::doCollectionStats(
         bucket.getCollectionsManager().addCollectionStats(cookie, add_stat);
         CollectionCountVBucketVisitor visitor;
         bucket.visit(visitor);
+        std::vector<CollectionID> cids;
+        for (const auto& entry : visitor.summary) {
+            cids.push_back(entry.first);
+        }
+        CollectionMemoryVBucketVisitor memVisitor(std::move(cids));
+        bucket.visit(memVisitor);
         for (const auto& entry : visitor.summary) {
             try {
                 const int bsize = 512;
@@ -342,6 +399,14 @@ ENGINE_ERROR_CODE Collections::Manager::doCollectionStats(
                                  "collection:%s:items",
                                  entry.first.to_string().c_str());
                 add_casted_stat(buffer, entry.second, add_stat, cookie);
+                checked_snprintf(buffer,
+                                 bsize,
+                                 "collection:%s:mem_used",
+                                 entry.first.to_string().c_str());
+                add_casted_stat(buffer,
+                                memVisitor.summary[entry.first],
+                                add_stat,
+                                cookie);
             } catch (const std::exception& e) {
                 EP_LOG_WARN(
                         "Collections::Manager::doStats failed to build stats: "
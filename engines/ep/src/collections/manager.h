@@ -23,6 +23,7 @@
 
 #include <memory>
 #include <mutex>
+#include <unordered_set>
 
 class KVBucket;
 class VBucket;
@@ -96,6 +97,15 @@ public:
      */
     void addScopeStats(const void* cookie, const AddStatFn& add_stat) const;
 
+    /**
+     * Compute the collections which the item pager should evict from before
+     * any others: those with a low eviction priority and those whose item
+     * memory, summed across all of the bucket's vbuckets, exceeds their
+     * memQuota.
+     */
+    std::unordered_set<CollectionID> getEvictionPreferredCollections(
+            KVBucket& bucket) const;
+
     /**
      * Perform actions for a completed warmup - currently check if any
      * collections are 'deleting' and require erasing retriggering.
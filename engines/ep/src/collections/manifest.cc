@@ -51,6 +51,12 @@ static constexpr nlohmann::json::value_t UidType =
 static constexpr char const* MaxTtlKey = "maxTTL";
 static constexpr nlohmann::json::value_t MaxTtlType =
         nlohmann::json::value_t::number_unsigned;
+static constexpr char const* MemQuotaKey = "memQuota";
+static constexpr nlohmann::json::value_t MemQuotaType =
+        nlohmann::json::value_t::number_unsigned;
+static constexpr char const* EvictionPriorityKey = "evictionPriority";
+static constexpr nlohmann::json::value_t EvictionPriorityType =
+        nlohmann::json::value_t::string;
 
 /**
  * Get json sub-object from the json object for key and check the type.
@@ -160,6 +166,10 @@ Manifest::Manifest(cb::const_char_buffer json,
             auto cuid = getJsonObject(collection, UidKey, UidType);
             auto cmaxttl = cb::getOptionalJsonObject(
                     collection, MaxTtlKey, MaxTtlType);
+            auto cmemquota = cb::getOptionalJsonObject(
+                    collection, MemQuotaKey, MemQuotaType);
+            auto cpriority = cb::getOptionalJsonObject(
+                    collection, EvictionPriorityKey, EvictionPriorityType);
 
             auto cnameValue = cname.get<std::string>();
             if (!validName(cnameValue)) {
@@ -217,9 +227,27 @@ Manifest::Manifest(cb::const_char_buffer json,
                 maxTtl = std::chrono::seconds(value);
             }
 
+            boost::optional<size_t> memQuota;
+            if (cmemquota) {
+                memQuota = cmemquota.get().get<uint64_t>();
+            }
+
+            bool lowEvictionPriority = false;
+            if (cpriority) {
+                auto value = cpriority.get().get<std::string>();
+                if (value == "low") {
+                    lowEvictionPriority = true;
+                } else if (value != "normal") {
+                    throw std::invalid_argument(
+                            "Manifest::Manifest invalid evictionPriority:" +
+                            value);
+                }
+            }
+
             enableDefaultCollection(cuidValue);
             this->collections.emplace(cuidValue, cnameValue);
-            scopeCollections.push_back({cuidValue, maxTtl});
+            scopeCollections.push_back(
+                    {cuidValue, maxTtl, memQuota, lowEvictionPriority});
         }
 
         this->scopes.emplace(uidValue,
@@ -297,6 +325,13 @@ std::string Manifest::toJson() const {
                     json << R"(,"maxTTL":)" << std::dec
                          << collection.maxTtl.get().count();
                 }
+                if (collection.memQuota) {
+                    json << R"(,"memQuota":)" << std::dec
+                         << collection.memQuota.get();
+                }
+                if (collection.lowEvictionPriority) {
+                    json << R"(,"evictionPriority":"low")";
+                }
                 json << "}";
                 if (nCollections != scope.second.collections.size() - 1) {
                     json << ",";
@@ -317,6 +352,18 @@ std::string Manifest::toJson() const {
     return json.str();
 }
 
+std::vector<CollectionEntry> Manifest::getEvictionSettings() const {
+    std::vector<CollectionEntry> rv;
+    for (const auto& scope : scopes) {
+        for (const auto& collection : scope.second.collections) {
+            if (collection.memQuota || collection.lowEvictionPriority) {
+                rv.push_back(collection);
+            }
+        }
+    }
+    return rv;
+}
+
 void Manifest::addCollectionStats(const void* cookie,
                                   const AddStatFn& add_stat) const {
     try {
@@ -336,6 +383,25 @@ void Manifest::addCollectionStats(const void* cookie,
                              entry.first.to_string().c_str());
             add_casted_stat(buffer, entry.second.c_str(), add_stat, cookie);
         }
+
+        for (const auto& collection : getEvictionSettings()) {
+            if (collection.memQuota) {
+                checked_snprintf(buffer,
+                                 bsize,
+                                 "manifest:collection:%s:mem_quota",
+                                 collection.id.to_string().c_str());
+                add_casted_stat(
+                        buffer, collection.memQuota.get(), add_stat, cookie);
+            }
+            checked_snprintf(buffer,
+                             bsize,
+                             "manifest:collection:%s:eviction_priority",
+                             collection.id.to_string().c_str());
+            add_casted_stat(buffer,
+                            collection.lowEvictionPriority ? "low" : "normal",
+                            add_stat,
+                            cookie);
+        }
     } catch (const std::exception& e) {
         EP_LOG_WARN(
                 "Manifest::addCollectionStats failed to build stats "
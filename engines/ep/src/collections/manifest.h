@@ -33,6 +33,10 @@ static const size_t MaxCollectionNameSize = 30;
 struct CollectionEntry {
     CollectionID id;
     cb::ExpiryLimit maxTtl;
+    /// Optional memory quota (bytes) across all of the node's vbuckets
+    boost::optional<size_t> memQuota;
+    /// Low priority collections are evicted from before any others
+    bool lowEvictionPriority = false;
 };
 
 struct Scope {
@@ -196,6 +200,12 @@ public:
      */
     std::string toJson() const;
 
+    /**
+     * @return the entries of all collections which define a memQuota or a
+     *         low eviction priority
+     */
+    std::vector<CollectionEntry> getEvictionSettings() const;
+
     void addCollectionStats(const void* cookie,
                             const AddStatFn& add_stat) const;
 
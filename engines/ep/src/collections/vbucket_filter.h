@@ -159,6 +159,24 @@ public:
         return systemEventsAllowed;
     }
 
+    /**
+     * @return the collection if this filter allows the items of exactly one
+     *         collection (and that collection's system events), so a backfill
+     *         need only read that collection's keys.
+     */
+    boost::optional<CollectionID> getSingleCollection() const {
+        if (passthrough || scopeID) {
+            return {};
+        }
+        if (filter.empty() && defaultAllowed) {
+            return CollectionID(CollectionID::Default);
+        }
+        if (filter.size() == 1 && !defaultAllowed) {
+            return *filter.begin();
+        }
+        return {};
+    }
+
     std::string getUid() const;
 
     cb::mcbp::DcpStreamId getStreamId() const {
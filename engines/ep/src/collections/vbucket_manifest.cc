@@ -867,8 +867,8 @@ boost::optional<std::vector<CollectionID>> Manifest::getCollectionsForScope(
 }
 
 bool Manifest::operator==(const Manifest& rhs) const {
-    std::lock_guard<cb::ReaderLock> readLock(rwlock.reader());
-    std::lock_guard<cb::ReaderLock> otherReadLock(rhs.rwlock.reader());
+    std::lock_guard<cb::ReaderLock> readLock(getReadLock().reader());
+    std::lock_guard<cb::ReaderLock> otherReadLock(rhs.getReadLock().reader());
 
     if (rhs.map.size() != map.size()) {
         return false;
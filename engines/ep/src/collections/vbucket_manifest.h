@@ -24,10 +24,13 @@
 #include "systemevent.h"
 
 #include <boost/optional/optional_fwd.hpp>
+#include <folly/CachelinePadded.h>
 #include <platform/non_negative_counter.h>
 #include <platform/rwlock.h>
 #include <platform/sized_buffer.h>
 
+#include <array>
+#include <atomic>
 #include <functional>
 #include <iostream>
 #include <mutex>
@@ -73,11 +76,22 @@ namespace VB {
  * for the entire scope of the set path to ensure no other thread can interleave
  * collection create/delete and cause an inconsistency in the checkpoint
  * ordering.
+ *
+ * Every front-end key operation obtains read access, so the internal lock is
+ * striped: a reader locks (shared) only the stripe assigned to its thread, a
+ * writer locks (exclusive) all of the stripes. Readers on different threads
+ * therefore don't contend on a single lock cacheline, whilst a writer still
+ * excludes every reader - preserving the checkpoint ordering described above.
  */
 class Manifest {
 public:
     using container = ::std::unordered_map<CollectionID, ManifestEntry>;
 
+    /// Number of stripes of the internal lock.
+    static constexpr size_t LockStripes = 8;
+    using LockStripe = folly::CachelinePadded<cb::RWLock>;
+    using LockStripes_t = std::array<LockStripe, LockStripes>;
+
     /**
      * RAII read locking for access to the Manifest.
      */
@@ -498,12 +512,15 @@ public:
      */
     class WriteHandle {
     public:
-        WriteHandle(Manifest& m, cb::RWLock& lock)
-            : writeLock(lock), manifest(m) {
+        /// Locks every stripe, always in the same (index) order.
+        WriteHandle(Manifest& m, LockStripes_t& locks) : manifest(m) {
+            for (size_t ii = 0; ii < LockStripes; ++ii) {
+                writeLocks[ii] = std::unique_lock<cb::WriterLock>(*locks[ii]);
+            }
         }
 
         WriteHandle(WriteHandle&& rhs)
-            : writeLock(std::move(rhs.writeLock)), manifest(rhs.manifest) {
+            : writeLocks(std::move(rhs.writeLocks)), manifest(rhs.manifest) {
         }
 
         /**
@@ -639,7 +656,7 @@ public:
         }
 
     private:
-        std::unique_lock<cb::WriterLock> writeLock;
+        std::array<std::unique_lock<cb::WriterLock>, LockStripes> writeLocks;
         Manifest& manifest;
     };
 
@@ -674,11 +691,11 @@ public:
     Manifest(const KVStore::Manifest& data);
 
     ReadHandle lock() const {
-        return {this, rwlock};
+        return {this, getReadLock()};
     }
 
     CachingReadHandle lock(DocKey key, bool allowSystem = false) const {
-        return {this, rwlock, key, allowSystem};
+        return {this, getReadLock(), key, allowSystem};
     }
 
     /**
@@ -686,7 +703,7 @@ public:
      * @return StatsReadHandle object with read lock on the manifest
      */
     StatsReadHandle lock(CollectionID cid) const {
-        return {this, rwlock, cid};
+        return {this, getReadLock(), cid};
     }
 
     // Explictly delete rvalue StoredDocKey usage. A CachingReadHandle wants to
@@ -697,7 +714,7 @@ public:
                            bool allowSystem = false) const = delete;
 
     WriteHandle wlock() {
-        return {*this, rwlock};
+        return {*this, rwlocks};
     }
 
     /**
@@ -1249,16 +1266,29 @@ protected:
     bool dropInProgress{false};
 
     /**
-     * shared lock to allow concurrent readers and safe updates
+     * @return the stripe of the lock which readers on the calling thread use.
+     *         Threads are assigned to stripes round-robin on first use.
+     */
+    cb::RWLock& getReadLock() const {
+        static std::atomic<size_t> nextStripe{0};
+        static thread_local const size_t stripe =
+                nextStripe.fetch_add(1, std::memory_order_relaxed) %
+                LockStripes;
+        return *rwlocks[stripe];
+    }
+
+    /**
+     * shared lock (striped, see class comment) to allow concurrent readers and
+     * safe updates
      */
-    mutable cb::RWLock rwlock;
+    mutable LockStripes_t rwlocks;
 
     friend std::ostream& operator<<(std::ostream& os, const Manifest& manifest);
 
     static constexpr char const* UidKey = "uid";
 };
 
-/// Note that the VB::Manifest << operator does not obtain the rwlock
+/// Note that the VB::Manifest << operator does not obtain the lock
 /// it is used internally in the object for exception string generation so must
 /// not double lock.
 std::ostream& operator<<(std::ostream& os, const Manifest& manifest);
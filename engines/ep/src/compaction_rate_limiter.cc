@@ -0,0 +1,117 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compaction_rate_limiter.h"
+
+#include "stats.h"
+
+#include <algorithm>
+#include <thread>
+
+constexpr size_t CompactionRateLimiter::backoffDivisor;
+constexpr std::chrono::milliseconds CompactionRateLimiter::backoffCheckInterval;
+
+CompactionRateLimiter::CompactionRateLimiter(
+        EPStats& stats, std::function<bool()> shouldBackOff)
+    : stats(stats), shouldBackOff(std::move(shouldBackOff)) {
+}
+
+void CompactionRateLimiter::setMaxBytesPerSec(size_t value) {
+    std::lock_guard<std::mutex> lh(mutex);
+    bytes.limit = value;
+}
+
+void CompactionRateLimiter::setMaxIOPS(size_t value) {
+    std::lock_guard<std::mutex> lh(mutex);
+    ops.limit = value;
+}
+
+void CompactionRateLimiter::acquire(size_t nbytes) {
+    double wait;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (bytes.limit == 0 && ops.limit == 0) {
+            return;
+        }
+        refill(now());
+        wait = std::max(bytes.take(nbytes, backedOff),
+                        ops.take(1, backedOff));
+    }
+
+    if (wait > 0) {
+        const std::chrono::microseconds duration(
+                static_cast<int64_t>(wait * 1000000));
+        ++stats.compactionIOThrottled;
+        stats.compactionIOThrottleTime += duration.count();
+        sleepFor(duration);
+    }
+}
+
+bool CompactionRateLimiter::isEnabled() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return bytes.limit != 0 || ops.limit != 0;
+}
+
+bool CompactionRateLimiter::isBackedOff() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return backedOff;
+}
+
+CompactionRateLimiter::Clock::time_point CompactionRateLimiter::now() const {
+    return Clock::now();
+}
+
+void CompactionRateLimiter::sleepFor(std::chrono::microseconds duration) {
+    std::this_thread::sleep_for(duration);
+}
+
+void CompactionRateLimiter::refill(Clock::time_point time) {
+    if (time - lastBackoffCheck >= backoffCheckInterval) {
+        lastBackoffCheck = time;
+        const bool backOff = shouldBackOff && shouldBackOff();
+        if (backOff && !backedOff) {
+            ++stats.compactionIOBackoffs;
+        }
+        backedOff = backOff;
+    }
+
+    // The first I/O starts with a full budget.
+    const double elapsed =
+            lastRefill == Clock::time_point()
+                    ? 1.0
+                    : std::chrono::duration<double>(time - lastRefill).count();
+    lastRefill = time;
+    bytes.refill(elapsed, backedOff);
+    ops.refill(elapsed, backedOff);
+}
+
+double CompactionRateLimiter::Bucket::getRate(bool backedOff) const {
+    return backedOff ? double(limit) / backoffDivisor : double(limit);
+}
+
+void CompactionRateLimiter::Bucket::refill(double elapsed, bool backedOff) {
+    const double rate = getRate(backedOff);
+    tokens = std::min(tokens + elapsed * rate, rate);
+}
+
+double CompactionRateLimiter::Bucket::take(size_t amount, bool backedOff) {
+    if (limit == 0) {
+        return 0;
+    }
+    tokens -= amount;
+    return tokens < 0 ? -tokens / getRate(backedOff) : 0;
+}
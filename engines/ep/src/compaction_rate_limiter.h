@@ -0,0 +1,108 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+class EPStats;
+
+/**
+ * Token bucket limiting the disk I/O issued by compaction, in both bytes
+ * and operations per second, so that compaction doesn't starve the flusher
+ * of disk bandwidth.
+ *
+ * A single limiter is shared by all of a bucket's compactions; each read or
+ * write a compaction makes takes its size (and one op) from the budget,
+ * and the compaction thread sleeps until the budget has been refilled if
+ * it is overdrawn. The budget may accumulate up to one second's worth of
+ * I/O while compaction is idle.
+ *
+ * The limiter periodically asks shouldBackOff whether the front-end
+ * workload is suffering (e.g. the flusher is falling behind); while it is,
+ * the budget is cut to 1/backoffDivisor of the configured rates.
+ *
+ * A limit of zero means that dimension is unlimited.
+ */
+class CompactionRateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t backoffDivisor = 4;
+    static constexpr std::chrono::milliseconds backoffCheckInterval{100};
+
+    CompactionRateLimiter(EPStats& stats, std::function<bool()> shouldBackOff);
+
+    virtual ~CompactionRateLimiter() = default;
+
+    void setMaxBytesPerSec(size_t value);
+
+    void setMaxIOPS(size_t value);
+
+    /**
+     * Take the budget for a single I/O of nbytes, blocking the caller until
+     * the budget allows it.
+     */
+    void acquire(size_t nbytes);
+
+    /// @return true if either limit is set.
+    bool isEnabled() const;
+
+    /// @return true if the limiter is currently running at the reduced rate.
+    bool isBackedOff() const;
+
+protected:
+    // Virtual to allow tests to control time.
+    virtual Clock::time_point now() const;
+    virtual void sleepFor(std::chrono::microseconds duration);
+
+private:
+    /**
+     * Add the budget accumulated since the last refill, and re-evaluate
+     * shouldBackOff if it's due. Caller must hold the mutex.
+     */
+    void refill(Clock::time_point time);
+
+    /// A single dimension (bytes or ops) of the budget.
+    struct Bucket {
+        /// @return the current rate, taking back-off into account.
+        double getRate(bool backedOff) const;
+
+        /// Add the budget for elapsed seconds, up to one second's worth.
+        void refill(double elapsed, bool backedOff);
+
+        /// Take amount from the budget; @return the seconds to wait until it
+        /// is no longer overdrawn.
+        double take(size_t amount, bool backedOff);
+
+        size_t limit = 0;
+        /// May go negative, when the budget is overdrawn.
+        double tokens = 0;
+    };
+
+    EPStats& stats;
+    const std::function<bool()> shouldBackOff;
+
+    mutable std::mutex mutex;
+    Bucket bytes;
+    Bucket ops;
+    bool backedOff = false;
+    Clock::time_point lastRefill;
+    Clock::time_point lastBackoffCheck;
+};
@@ -116,7 +116,7 @@ ConnMap::ConnMap(EventuallyPersistentEngine &theEngine)
     Configuration &config = engine.getConfiguration();
     size_t max_vbs = config.getMaxVbuckets();
     for (size_t i = 0; i < max_vbs; ++i) {
-        vbConns.push_back(std::list<std::weak_ptr<ConnHandler>>());
+        vbConns.push_back(std::make_shared<const VBConnList>());
     }
 }
 
@@ -186,6 +186,26 @@ void ConnMap::processPendingNotifications() {
     }
 }
 
+std::shared_ptr<const ConnMap::VBConnList> ConnMap::getVBConns(
+        Vbid vbid) const {
+    return std::atomic_load(&vbConns[vbid.get()]);
+}
+
+void ConnMap::updateVBConns_UNLOCKED(
+        Vbid vbid, const std::function<void(VBConnList&)>& update) {
+    const auto current = getVBConns(vbid);
+    auto next = std::make_shared<VBConnList>();
+    next->reserve(current->size() + 1);
+    for (const auto& conn : *current) {
+        if (!conn.expired()) {
+            next->push_back(conn);
+        }
+    }
+    update(*next);
+    std::atomic_store(&vbConns[vbid.get()],
+                      std::shared_ptr<const VBConnList>(std::move(next)));
+}
+
 void ConnMap::addVBConnByVBId(std::shared_ptr<ConnHandler> conn, Vbid vbid) {
     if (!conn.get()) {
         return;
@@ -193,24 +213,22 @@ void ConnMap::addVBConnByVBId(std::shared_ptr<ConnHandler> conn, Vbid vbid) {
 
     size_t lock_num = vbid.get() % vbConnLockNum;
     std::lock_guard<std::mutex> lh(vbConnLocks[lock_num]);
-    vbConns[vbid.get()].emplace_back(std::move(conn));
+    updateVBConns_UNLOCKED(vbid, [&conn](VBConnList& vb_conns) {
+        vb_conns.emplace_back(std::move(conn));
+    });
 }
 
 void ConnMap::removeVBConnByVBId_UNLOCKED(const void* connCookie, Vbid vbid) {
-    std::list<std::weak_ptr<ConnHandler>>& vb_conns = vbConns[vbid.get()];
-    for (auto itr = vb_conns.begin(); itr != vb_conns.end();) {
-        auto connection = (*itr).lock();
-        if (!connection) {
-            // ConnHandler no longer exists, cleanup.
-            itr = vb_conns.erase(itr);
-        } else if (connection->getCookie() == connCookie) {
-            // Found conn with matching cookie, done.
-            vb_conns.erase(itr);
-            break;
-        } else {
-            ++itr;
+    updateVBConns_UNLOCKED(vbid, [connCookie](VBConnList& vb_conns) {
+        for (auto itr = vb_conns.begin(); itr != vb_conns.end(); ++itr) {
+            auto connection = itr->lock();
+            if (connection && connection->getCookie() == connCookie) {
+                // Found conn with matching cookie, done.
+                vb_conns.erase(itr);
+                break;
+            }
         }
-    }
+    });
 }
 
 void ConnMap::removeVBConnByVBId(const void* connCookie, Vbid vbid) {
@@ -220,13 +238,11 @@ void ConnMap::removeVBConnByVBId(const void* connCookie, Vbid vbid) {
 }
 
 bool ConnMap::vbConnectionExists(ConnHandler* conn, Vbid vbid) {
-    size_t lock_num = vbid.get() % vbConnLockNum;
-    std::lock_guard<std::mutex> lh(vbConnLocks[lock_num]);
-    auto& connsForVb = vbConns[vbid.get()];
+    const auto connsForVb = getVBConns(vbid);
 
     // Check whether the connhandler already exists in vbConns for the
     // provided vbid
-    for (const auto& existingConn : connsForVb) {
+    for (const auto& existingConn : *connsForVb) {
         if (conn == existingConn.lock().get()) {
             return true;
         }
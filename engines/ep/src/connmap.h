@@ -22,9 +22,11 @@
 #include "dcp/dcp-types.h"
 
 #include <climits>
+#include <functional>
 #include <iterator>
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -128,8 +130,34 @@ protected:
             std::unordered_map<const void*, std::shared_ptr<ConnHandler>>;
     CookieToConnectionMap map_;
 
+    /// The connections associated with a vbucket. A list is never modified
+    /// once it is published in vbConns (see updateVBConns_UNLOCKED)
+    using VBConnList = std::vector<std::weak_ptr<ConnHandler>>;
+
+    /**
+     * Get (a snapshot of) the connections associated with the vbucket.
+     * The snapshot is read without holding vbConnLocks so that the
+     * notifications for every mutation don't contend with each other, or
+     * with the (rare) adding and removing of connections.
+     */
+    std::shared_ptr<const VBConnList> getVBConns(Vbid vbid) const;
+
+    /**
+     * Publish a modified copy of the list of connections associated with
+     * the vbucket. The caller must hold vbConnLocks for the vbucket so that
+     * concurrent updates don't get lost.
+     *
+     * @param vbid the vbucket to update
+     * @param update function called to modify the copy (the copy don't
+     *               contain any expired connections)
+     */
+    void updateVBConns_UNLOCKED(Vbid vbid,
+                                const std::function<void(VBConnList&)>& update);
+
+    /// Serialise the updates of vbConns
     std::vector<std::mutex> vbConnLocks;
-    std::vector<std::list<std::weak_ptr<ConnHandler>>> vbConns;
+    /// Must be accessed with std::atomic_load / std::atomic_store
+    std::vector<std::shared_ptr<const VBConnList>> vbConns;
 
     /* Handle to the engine who owns us */
     EventuallyPersistentEngine &engine;
@@ -0,0 +1,125 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/CachelinePadded.h>
+#include <platform/corestore.h>
+#include <relaxed_atomic.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * A counter for events which happen on the hot path of many threads (e.g.
+ * once per operation), but which is only read occasionally (stats).
+ *
+ * Each core updates its own (cacheline padded) counter, so updates don't
+ * bounce a shared cacheline between the cores; reading the value sums the
+ * counters of all cores. It has the same interface as the counters it
+ * replaces (cb::RelaxedAtomic<size_t>) so it may be used as a drop in
+ * replacement.
+ *
+ * As a read is O(number of cores), and each counter uses a cacheline pair
+ * per core, it shouldn't be used for values which are read on the hot path.
+ */
+class CoreLocalCounter {
+public:
+    CoreLocalCounter() {
+        store(0);
+    }
+
+    explicit CoreLocalCounter(size_t initial) {
+        store(initial);
+    }
+
+    CoreLocalCounter(const CoreLocalCounter&) = delete;
+    CoreLocalCounter& operator=(const CoreLocalCounter&) = delete;
+
+    void fetch_add(size_t n) {
+        values.get()->fetch_add(int64_t(n));
+    }
+
+    void fetch_sub(size_t n) {
+        values.get()->fetch_sub(int64_t(n));
+    }
+
+    void operator++() {
+        fetch_add(1);
+    }
+
+    void operator++(int) {
+        fetch_add(1);
+    }
+
+    void operator--() {
+        fetch_sub(1);
+    }
+
+    void operator--(int) {
+        fetch_sub(1);
+    }
+
+    void operator+=(size_t n) {
+        fetch_add(n);
+    }
+
+    void operator-=(size_t n) {
+        fetch_sub(n);
+    }
+
+    /// @return the sum of the per-core counters
+    size_t load() const {
+        int64_t result = 0;
+        for (const auto& core : values) {
+            result += core->load();
+        }
+        // An item may be counted on one core and removed on another, and
+        // the cores aren't read atomically
+        return size_t(std::max(int64_t(0), result));
+    }
+
+    operator size_t() const {
+        return load();
+    }
+
+    /**
+     * Set the counter to the given value. Updates made by other threads
+     * while storing may be lost (this is used to reset the stats).
+     */
+    void store(size_t value) {
+        bool first = true;
+        for (auto& core : values) {
+            core->store(first ? int64_t(value) : 0);
+            first = false;
+        }
+    }
+
+    CoreLocalCounter& operator=(size_t value) {
+        store(value);
+        return *this;
+    }
+
+private:
+    CoreStore<folly::CachelinePadded<cb::RelaxedAtomic<int64_t>>> values;
+};
+
+inline std::ostream& operator<<(std::ostream& os,
+                                const CoreLocalCounter& counter) {
+    return os << counter.load();
+}
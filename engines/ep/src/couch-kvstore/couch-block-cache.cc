@@ -0,0 +1,222 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-block-cache.h"
+
+#include <cstring>
+
+constexpr size_t CouchBlockCache::blockSize;
+constexpr size_t CouchBlockCache::protectedPercent;
+
+CouchBlockCache::CouchBlockCache(size_t maxSize)
+    : maxBlocks(maxSize / blockSize),
+      maxProtectedBlocks((maxBlocks * protectedPercent) / 100),
+      hits(0),
+      misses(0),
+      evictions(0),
+      memUsed(0) {
+}
+
+uint64_t CouchBlockCache::getFileId(const std::string& path) {
+    std::lock_guard<std::mutex> lh(mutex);
+    return fileIds.emplace(path, fileIds.size()).first->second;
+}
+
+bool CouchBlockCache::lookup(uint64_t file, cs_off_t offset, void* buf) {
+    std::lock_guard<std::mutex> lh(mutex);
+    auto found = index.find({file, offset});
+    if (found == index.end()) {
+        ++misses;
+        return false;
+    }
+
+    auto it = found->second;
+    std::memcpy(buf, it->data.get(), blockSize);
+    if (it->isProtected) {
+        protect.splice(protect.begin(), protect, it);
+    } else {
+        // Second read; promote to the protected segment.
+        it->isProtected = true;
+        protect.splice(protect.begin(), probation, it);
+        demoteExcess();
+    }
+    ++hits;
+    return true;
+}
+
+void CouchBlockCache::insert(uint64_t file, cs_off_t offset, const void* buf) {
+    if (maxBlocks == 0) {
+        return;
+    }
+    std::unique_ptr<uint8_t[]> data(new uint8_t[blockSize]);
+    std::memcpy(data.get(), buf, blockSize);
+
+    std::lock_guard<std::mutex> lh(mutex);
+    const Key key{file, offset};
+    if (index.count(key)) {
+        // Another reader raced us to it.
+        return;
+    }
+    makeRoom();
+    probation.push_front({key, false, std::move(data)});
+    index.emplace(key, probation.begin());
+    memUsed += blockSize;
+}
+
+void CouchBlockCache::invalidate(uint64_t file, cs_off_t offset, size_t size) {
+    std::lock_guard<std::mutex> lh(mutex);
+    if (index.empty()) {
+        return;
+    }
+    const cs_off_t end = offset + size;
+    for (cs_off_t block = offset - (offset % blockSize); block < end;
+         block += blockSize) {
+        auto found = index.find({file, block});
+        if (found != index.end()) {
+            erase(found->second);
+        }
+    }
+}
+
+void CouchBlockCache::makeRoom() {
+    while (index.size() >= maxBlocks) {
+        auto& segment = probation.empty() ? protect : probation;
+        erase(std::prev(segment.end()));
+        ++evictions;
+    }
+}
+
+void CouchBlockCache::demoteExcess() {
+    while (protect.size() > maxProtectedBlocks) {
+        auto it = std::prev(protect.end());
+        it->isProtected = false;
+        probation.splice(probation.begin(), protect, it);
+    }
+}
+
+void CouchBlockCache::erase(BlockList::iterator it) {
+    index.erase(it->key);
+    auto& segment = it->isProtected ? protect : probation;
+    segment.erase(it);
+    memUsed -= blockSize;
+}
+
+couch_file_handle BlockCacheOps::constructor(couchstore_error_info_t* errinfo) {
+    auto* cf = new CachedFile(wrapped_ops.constructor(errinfo));
+    return reinterpret_cast<couch_file_handle>(cf);
+}
+
+couchstore_error_t BlockCacheOps::open(couchstore_error_info_t* errinfo,
+                                       couch_file_handle* h,
+                                       const char* path,
+                                       int flags) {
+    auto* cf = reinterpret_cast<CachedFile*>(*h);
+    cf->file = cache.getFileId(path);
+    return wrapped_ops.open(errinfo, &cf->orig_handle, path, flags);
+}
+
+couchstore_error_t BlockCacheOps::close(couchstore_error_info_t* errinfo,
+                                        couch_file_handle h) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    return wrapped_ops.close(errinfo, cf->orig_handle);
+}
+
+couchstore_error_t BlockCacheOps::set_periodic_sync(couch_file_handle h,
+                                                    uint64_t period_bytes) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    return wrapped_ops.set_periodic_sync(cf->orig_handle, period_bytes);
+}
+
+couchstore_error_t BlockCacheOps::set_tracing_enabled(couch_file_handle h) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    return wrapped_ops.set_tracing_enabled(cf->orig_handle);
+}
+
+couchstore_error_t BlockCacheOps::set_write_validation_enabled(
+        couch_file_handle h) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    return wrapped_ops.set_write_validation_enabled(cf->orig_handle);
+}
+
+couchstore_error_t BlockCacheOps::set_mprotect_enabled(couch_file_handle h) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    return wrapped_ops.set_mprotect_enabled(cf->orig_handle);
+}
+
+ssize_t BlockCacheOps::pread(couchstore_error_info_t* errinfo,
+                             couch_file_handle h,
+                             void* buf,
+                             size_t sz,
+                             cs_off_t off) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    // Only whole, aligned blocks (couchstore's buffered reads) are cached;
+    // anything else (e.g. unbuffered reads) goes straight to the file.
+    const bool isBlock = sz == CouchBlockCache::blockSize &&
+                         (off % CouchBlockCache::blockSize) == 0;
+    if (isBlock && cache.lookup(cf->file, off, buf)) {
+        return sz;
+    }
+
+    ssize_t result = wrapped_ops.pread(errinfo, cf->orig_handle, buf, sz, off);
+    // A short read is the (still growing) last block of the file.
+    if (isBlock && result == ssize_t(sz)) {
+        cache.insert(cf->file, off, buf);
+    }
+    return result;
+}
+
+ssize_t BlockCacheOps::pwrite(couchstore_error_info_t* errinfo,
+                              couch_file_handle h,
+                              const void* buf,
+                              size_t sz,
+                              cs_off_t off) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    cache.invalidate(cf->file, off, sz);
+    return wrapped_ops.pwrite(errinfo, cf->orig_handle, buf, sz, off);
+}
+
+cs_off_t BlockCacheOps::goto_eof(couchstore_error_info_t* errinfo,
+                                 couch_file_handle h) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    return wrapped_ops.goto_eof(errinfo, cf->orig_handle);
+}
+
+couchstore_error_t BlockCacheOps::sync(couchstore_error_info_t* errinfo,
+                                       couch_file_handle h) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    return wrapped_ops.sync(errinfo, cf->orig_handle);
+}
+
+couchstore_error_t BlockCacheOps::advise(couchstore_error_info_t* errinfo,
+                                         couch_file_handle h,
+                                         cs_off_t offs,
+                                         cs_off_t len,
+                                         couchstore_file_advice_t adv) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    return wrapped_ops.advise(errinfo, cf->orig_handle, offs, len, adv);
+}
+
+FileOpsInterface::FHStats* BlockCacheOps::get_stats(couch_file_handle h) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    return wrapped_ops.get_stats(cf->orig_handle);
+}
+
+void BlockCacheOps::destructor(couch_file_handle h) {
+    auto* cf = reinterpret_cast<CachedFile*>(h);
+    wrapped_ops.destructor(cf->orig_handle);
+    delete cf;
+}
@@ -0,0 +1,205 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <libcouchstore/couch_db.h>
+#include <relaxed_atomic.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A size-bounded cache of couchstore file blocks, shared by all the
+ * vBucket files of a CouchKVStore (and its read-only twin).
+ *
+ * couchstore reads its files through a read buffer, one aligned
+ * blockSize block at a time; the B-tree nodes walked by every lookup
+ * therefore come back as the same blocks again and again, and keeping them
+ * here saves going to the OS (and the disk, once document bodies have
+ * pushed them out of the page cache) for each one.
+ *
+ * Blocks are evicted with a segmented LRU: blocks enter a probationary
+ * segment, and are promoted to a protected segment (of up to
+ * protectedPercent of the capacity) the second time they are read. The
+ * upper levels of the B-trees, read on every lookup, stay pinned in the
+ * protected segment, while blocks read once (most document bodies, scans)
+ * only ever displace each other.
+ *
+ * couchstore files are append-only, and named by revision, so a cached
+ * block never goes stale while the file exists; writes overlapping a cached
+ * block still invalidate it to be safe.
+ */
+class CouchBlockCache {
+public:
+    static constexpr size_t blockSize = 4096;
+    static constexpr size_t protectedPercent = 80;
+
+    explicit CouchBlockCache(size_t maxSize);
+
+    /**
+     * @return the identifier used for the blocks of the file at path (the
+     *         same one each time the file is opened).
+     */
+    uint64_t getFileId(const std::string& path);
+
+    /**
+     * Copy the cached block at offset of the given file into buf.
+     * @return true if the block was cached.
+     */
+    bool lookup(uint64_t file, cs_off_t offset, void* buf);
+
+    /// Add the blockSize bytes at buf as the block at offset of the file.
+    void insert(uint64_t file, cs_off_t offset, const void* buf);
+
+    /// Remove any cached blocks overlapping [offset, offset + size).
+    void invalidate(uint64_t file, cs_off_t offset, size_t size);
+
+    size_t getHits() const {
+        return hits;
+    }
+
+    size_t getMisses() const {
+        return misses;
+    }
+
+    size_t getEvictions() const {
+        return evictions;
+    }
+
+    /// @return the memory used by the cached blocks.
+    size_t getMemUsed() const {
+        return memUsed;
+    }
+
+    size_t getMaxSize() const {
+        return maxBlocks * blockSize;
+    }
+
+private:
+    struct Key {
+        bool operator==(const Key& other) const {
+            return file == other.file && offset == other.offset;
+        }
+        uint64_t file;
+        cs_off_t offset;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<uint64_t>()(key.file * 31 + key.offset);
+        }
+    };
+
+    struct Block {
+        Key key;
+        bool isProtected;
+        std::unique_ptr<uint8_t[]> data;
+    };
+
+    using BlockList = std::list<Block>;
+
+    /// Evict from the probationary segment (then the protected one) until
+    /// there is room for another block. Caller must hold the mutex.
+    void makeRoom();
+
+    /// Move blocks over the protected segment's limit back to the head of
+    /// the probationary segment. Caller must hold the mutex.
+    void demoteExcess();
+
+    void erase(BlockList::iterator it);
+
+    const size_t maxBlocks;
+    const size_t maxProtectedBlocks;
+
+    mutable std::mutex mutex;
+    /// Most recently used blocks at the front.
+    BlockList probation;
+    BlockList protect;
+    std::unordered_map<Key, BlockList::iterator, KeyHash> index;
+    std::unordered_map<std::string, uint64_t> fileIds;
+
+    cb::RelaxedAtomic<size_t> hits;
+    cb::RelaxedAtomic<size_t> misses;
+    cb::RelaxedAtomic<size_t> evictions;
+    cb::RelaxedAtomic<size_t> memUsed;
+};
+
+/**
+ * FileOpsInterface implementation which serves couchstore's block reads
+ * from (and adds them to) a CouchBlockCache, passing all other operations
+ * through to the wrapped implementation.
+ */
+class BlockCacheOps : public FileOpsInterface {
+public:
+    BlockCacheOps(CouchBlockCache& cache, FileOpsInterface& ops)
+        : cache(cache), wrapped_ops(ops) {
+    }
+
+    couch_file_handle constructor(couchstore_error_info_t* errinfo) override;
+    couchstore_error_t open(couchstore_error_info_t* errinfo,
+                            couch_file_handle* handle,
+                            const char* path,
+                            int oflag) override;
+    couchstore_error_t close(couchstore_error_info_t* errinfo,
+                             couch_file_handle handle) override;
+    couchstore_error_t set_periodic_sync(couch_file_handle handle,
+                                         uint64_t period_bytes) override;
+    couchstore_error_t set_tracing_enabled(couch_file_handle handle) override;
+    couchstore_error_t set_write_validation_enabled(
+            couch_file_handle handle) override;
+    couchstore_error_t set_mprotect_enabled(couch_file_handle handle) override;
+
+    ssize_t pread(couchstore_error_info_t* errinfo,
+                  couch_file_handle handle,
+                  void* buf,
+                  size_t nbytes,
+                  cs_off_t offset) override;
+    ssize_t pwrite(couchstore_error_info_t* errinfo,
+                   couch_file_handle handle,
+                   const void* buf,
+                   size_t nbytes,
+                   cs_off_t offset) override;
+    cs_off_t goto_eof(couchstore_error_info_t* errinfo,
+                      couch_file_handle handle) override;
+    couchstore_error_t sync(couchstore_error_info_t* errinfo,
+                            couch_file_handle handle) override;
+    couchstore_error_t advise(couchstore_error_info_t* errinfo,
+                              couch_file_handle handle,
+                              cs_off_t offset,
+                              cs_off_t len,
+                              couchstore_file_advice_t advice) override;
+    FHStats* get_stats(couch_file_handle handle) override;
+    void destructor(couch_file_handle handle) override;
+
+protected:
+    CouchBlockCache& cache;
+    FileOpsInterface& wrapped_ops;
+
+    struct CachedFile {
+        explicit CachedFile(couch_file_handle orig_handle)
+            : orig_handle(orig_handle) {
+        }
+
+        couch_file_handle orig_handle;
+        uint64_t file = 0;
+    };
+};
@@ -0,0 +1,168 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-fs-dropcache.h"
+
+#include "kvstore.h"
+
+#include <algorithm>
+
+void DropCacheOps::Range::add(cs_off_t offset, size_t size) {
+    const cs_off_t rangeEnd = offset + size;
+    if (empty()) {
+        begin = offset;
+        end = rangeEnd;
+    } else {
+        begin = std::min(begin, offset);
+        end = std::max(end, rangeEnd);
+    }
+}
+
+void DropCacheOps::DroppingFile::reset() {
+    previous = {};
+    current = {};
+    currentBytes = 0;
+}
+
+void DropCacheOps::drop(DroppingFile& df, const Range& range) {
+    if (range.empty()) {
+        return;
+    }
+    // Only advice; a failure leaves the pages cached but is otherwise
+    // harmless, so it isn't reported to couchstore.
+    couchstore_error_info_t errinfo;
+    if (wrapped_ops.advise(&errinfo,
+                           df.orig_handle,
+                           range.begin,
+                           range.end - range.begin,
+                           COUCHSTORE_FILE_ADVICE_DONTNEED) ==
+        COUCHSTORE_SUCCESS) {
+        stats.totalBytesDropped += range.end - range.begin;
+    }
+}
+
+couch_file_handle DropCacheOps::constructor(couchstore_error_info_t* errinfo) {
+    auto* df = new DroppingFile(wrapped_ops.constructor(errinfo));
+    return reinterpret_cast<couch_file_handle>(df);
+}
+
+couchstore_error_t DropCacheOps::open(couchstore_error_info_t* errinfo,
+                                      couch_file_handle* h,
+                                      const char* path,
+                                      int flags) {
+    auto* df = reinterpret_cast<DroppingFile*>(*h);
+    df->reset();
+    return wrapped_ops.open(errinfo, &df->orig_handle, path, flags);
+}
+
+couchstore_error_t DropCacheOps::close(couchstore_error_info_t* errinfo,
+                                       couch_file_handle h) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    return wrapped_ops.close(errinfo, df->orig_handle);
+}
+
+couchstore_error_t DropCacheOps::set_periodic_sync(couch_file_handle h,
+                                                   uint64_t period_bytes) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    df->periodBytes = period_bytes;
+    return wrapped_ops.set_periodic_sync(df->orig_handle, period_bytes);
+}
+
+couchstore_error_t DropCacheOps::set_tracing_enabled(couch_file_handle h) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    return wrapped_ops.set_tracing_enabled(df->orig_handle);
+}
+
+couchstore_error_t DropCacheOps::set_write_validation_enabled(
+        couch_file_handle h) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    return wrapped_ops.set_write_validation_enabled(df->orig_handle);
+}
+
+couchstore_error_t DropCacheOps::set_mprotect_enabled(couch_file_handle h) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    return wrapped_ops.set_mprotect_enabled(df->orig_handle);
+}
+
+ssize_t DropCacheOps::pread(couchstore_error_info_t* errinfo,
+                            couch_file_handle h,
+                            void* buf,
+                            size_t sz,
+                            cs_off_t off) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    return wrapped_ops.pread(errinfo, df->orig_handle, buf, sz, off);
+}
+
+ssize_t DropCacheOps::pwrite(couchstore_error_info_t* errinfo,
+                             couch_file_handle h,
+                             const void* buf,
+                             size_t sz,
+                             cs_off_t off) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    ssize_t result = wrapped_ops.pwrite(errinfo, df->orig_handle, buf, sz, off);
+    if (result > 0) {
+        df->current.add(off, result);
+        df->currentBytes += result;
+        if (df->periodBytes != 0 && df->currentBytes >= df->periodBytes) {
+            // A period's worth of bytes has been written since previous, so
+            // the wrapped ops have synced it.
+            drop(*df, df->previous);
+            df->previous = df->current;
+            df->current = {};
+            df->currentBytes = 0;
+        }
+    }
+    return result;
+}
+
+cs_off_t DropCacheOps::goto_eof(couchstore_error_info_t* errinfo,
+                                couch_file_handle h) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    return wrapped_ops.goto_eof(errinfo, df->orig_handle);
+}
+
+couchstore_error_t DropCacheOps::sync(couchstore_error_info_t* errinfo,
+                                      couch_file_handle h) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    const auto result = wrapped_ops.sync(errinfo, df->orig_handle);
+    if (result == COUCHSTORE_SUCCESS) {
+        drop(*df, df->previous);
+        drop(*df, df->current);
+        df->reset();
+    }
+    return result;
+}
+
+couchstore_error_t DropCacheOps::advise(couchstore_error_info_t* errinfo,
+                                        couch_file_handle h,
+                                        cs_off_t offs,
+                                        cs_off_t len,
+                                        couchstore_file_advice_t adv) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    return wrapped_ops.advise(errinfo, df->orig_handle, offs, len, adv);
+}
+
+FileOpsInterface::FHStats* DropCacheOps::get_stats(couch_file_handle h) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    return wrapped_ops.get_stats(df->orig_handle);
+}
+
+void DropCacheOps::destructor(couch_file_handle h) {
+    auto* df = reinterpret_cast<DroppingFile*>(h);
+    wrapped_ops.destructor(df->orig_handle);
+    delete df;
+}
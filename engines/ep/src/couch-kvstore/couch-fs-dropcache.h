@@ -0,0 +1,118 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <libcouchstore/couch_db.h>
+
+struct FileStats;
+
+/**
+ * FileOpsInterface implementation which drops the data it writes from the
+ * OS page cache once that data is on disk, so streaming a file out (a
+ * compaction or a large flush) doesn't evict the pages reads need. All
+ * operations are passed through to the wrapped implementation.
+ *
+ * Dirty pages can't be dropped, so a range is only dropped once it's known
+ * to be synced:
+ * - after a successful sync(), everything written since the last drop;
+ * - with periodic sync configured (fsync_after_every_n_bytes_written), once
+ *   another period of bytes has been written after a range, the wrapped
+ *   implementation has synced at least once since the range was written.
+ *
+ * couchstore's writes are buffered and unaligned, so bypassing the page
+ * cache with O_DIRECT isn't an option.
+ */
+class DropCacheOps : public FileOpsInterface {
+public:
+    DropCacheOps(FileStats& stats, FileOpsInterface& ops)
+        : stats(stats), wrapped_ops(ops) {
+    }
+
+    couch_file_handle constructor(couchstore_error_info_t* errinfo) override;
+    couchstore_error_t open(couchstore_error_info_t* errinfo,
+                            couch_file_handle* handle,
+                            const char* path,
+                            int oflag) override;
+    couchstore_error_t close(couchstore_error_info_t* errinfo,
+                             couch_file_handle handle) override;
+    couchstore_error_t set_periodic_sync(couch_file_handle handle,
+                                         uint64_t period_bytes) override;
+    couchstore_error_t set_tracing_enabled(couch_file_handle handle) override;
+    couchstore_error_t set_write_validation_enabled(
+            couch_file_handle handle) override;
+    couchstore_error_t set_mprotect_enabled(couch_file_handle handle) override;
+
+    ssize_t pread(couchstore_error_info_t* errinfo,
+                  couch_file_handle handle,
+                  void* buf,
+                  size_t nbytes,
+                  cs_off_t offset) override;
+    ssize_t pwrite(couchstore_error_info_t* errinfo,
+                   couch_file_handle handle,
+                   const void* buf,
+                   size_t nbytes,
+                   cs_off_t offset) override;
+    cs_off_t goto_eof(couchstore_error_info_t* errinfo,
+                      couch_file_handle handle) override;
+    couchstore_error_t sync(couchstore_error_info_t* errinfo,
+                            couch_file_handle handle) override;
+    couchstore_error_t advise(couchstore_error_info_t* errinfo,
+                              couch_file_handle handle,
+                              cs_off_t offset,
+                              cs_off_t len,
+                              couchstore_file_advice_t advice) override;
+    FHStats* get_stats(couch_file_handle handle) override;
+    void destructor(couch_file_handle handle) override;
+
+protected:
+    /// A range of a file, [begin, end).
+    struct Range {
+        void add(cs_off_t offset, size_t size);
+
+        bool empty() const {
+            return begin == end;
+        }
+
+        cs_off_t begin = 0;
+        cs_off_t end = 0;
+    };
+
+    struct DroppingFile {
+        explicit DroppingFile(couch_file_handle orig_handle)
+            : orig_handle(orig_handle) {
+        }
+
+        /// Forget everything written so far (without dropping it).
+        void reset();
+
+        couch_file_handle orig_handle;
+        uint64_t periodBytes = 0;
+
+        /// Written before the current range; synced if periodBytes is set.
+        Range previous;
+        /// Written since previous, and the number of bytes written to it.
+        Range current;
+        uint64_t currentBytes = 0;
+    };
+
+    /// Advise the OS to drop the range of the file from the page cache.
+    void drop(DroppingFile& df, const Range& range);
+
+    FileStats& stats;
+    FileOpsInterface& wrapped_ops;
+};
@@ -454,6 +454,14 @@ public:
         return reinterpret_cast<char*>(&allMeta);
     }
 
+    /*
+     * Return a pointer to the metadata previously prepared for persistence
+     * by prepareAndGetForPersistence() (without byte-swapping it again).
+     */
+    char* getPreparedForPersistence() {
+        return reinterpret_cast<char*>(&allMeta);
+    }
+
     void setCas(uint64_t cas) {
         allMeta.v0.setCas(cas);
     }
@@ -20,22 +20,33 @@
 #include "collections/collection_persisted_stats.h"
 #include "collections/kvstore_generated.h"
 #include "common.h"
+#include "compaction_rate_limiter.h"
+#include "couch-kvstore/couch-fs-dropcache.h"
+#include "couch-kvstore/couch-fs-ratelimit.h"
 #include "diskdockey.h"
 #include "ep_time.h"
 #include "item.h"
 #include "kvstore_config.h"
 #include "rollback_result.h"
+#include "systemevent.h"
 #include "vbucket.h"
 #include "vbucket_bgfetch_item.h"
 #include "vbucket_state.h"
 
-#include <JSON_checker.h>
+#include <folly/portability/SysStat.h>
+#include <folly/portability/Unistd.h>
 #include <nlohmann/json.hpp>
 #include <phosphor/phosphor.h>
 #include <platform/compress.h>
 #include <platform/dirutils.h>
+#include <snappy.h>
+#include <utilities/json_validator.h>
 #include <gsl/gsl>
+
+#include <algorithm>
+#include <functional>
 #include <shared_mutex>
+#include <unordered_map>
 
 extern "C" {
     static int recordDbDumpC(Db *db, DocInfo *docinfo, void *ctx)
@@ -51,6 +62,52 @@ extern "C" {
     }
 }
 
+/**
+ * getMulti() body reads which start within this many bytes of the end of the
+ * previous one are counted as adjacent (they share, or directly follow, the
+ * couchstore block just read).
+ */
+static constexpr uint64_t getMultiAdjacentBytes = 4096;
+
+/**
+ * Number of discarded updates whose keys rollback() looks up in the Rollback
+ * header with a single walk of the by-id tree.
+ */
+static constexpr size_t rollbackBatchSize = 1024;
+
+/**
+ * Scan callback used by rollback(): collects the discarded updates, handing
+ * them on for processing a batch at a time.
+ */
+class RollbackBatchCallback : public StatusCallback<GetValue> {
+public:
+    using ProcessBatch = std::function<bool(std::vector<GetValue>&)>;
+
+    explicit RollbackBatchCallback(ProcessBatch process)
+        : process(std::move(process)) {
+        batch.reserve(rollbackBatchSize);
+    }
+
+    void callback(GetValue& val) override {
+        batch.push_back(std::move(val));
+        if (batch.size() >= rollbackBatchSize && !flush()) {
+            // Cancel the scan; the rollback has failed.
+            setStatus(ENGINE_ENOMEM);
+        }
+    }
+
+    /// Process the discarded updates collected so far.
+    bool flush() {
+        bool success = batch.empty() || process(batch);
+        batch.clear();
+        return success;
+    }
+
+private:
+    ProcessBatch process;
+    std::vector<GetValue> batch;
+};
+
 static std::string getStrError(Db *db) {
     const size_t max_msg_len = 256;
     char msg[max_msg_len];
@@ -69,7 +126,7 @@ static std::string getStrError(Db *db) {
  * @return JSON or RAW bytes
  */
 static protocol_binary_datatype_t determine_datatype(sized_buf doc) {
-    if (checkUTF8JSON(reinterpret_cast<uint8_t*>(doc.buf), doc.size)) {
+    if (cb::isValidJson(reinterpret_cast<uint8_t*>(doc.buf), doc.size)) {
         return PROTOCOL_BINARY_DATATYPE_JSON;
     } else {
         return PROTOCOL_BINARY_RAW_BYTES;
@@ -208,18 +265,44 @@ struct GetMultiCbCtx {
         : cks(c), vbId(v), fetches(f) {
     }
 
+    /**
+     * A document whose body is still to be read; holds a deep copy of the
+     * DocInfo (which couchstore frees once the callback returns).
+     */
+    struct DeferredFetch {
+        DeferredFetch(const DocInfo& docinfo, vb_bgfetch_item_ctx_t& fetch)
+            : info(docinfo),
+              id(docinfo.id.buf, docinfo.id.size),
+              meta(docinfo.rev_meta.buf, docinfo.rev_meta.size),
+              fetch(&fetch) {
+        }
+
+        /// @return the DocInfo, pointing at our copies of its buffers.
+        DocInfo& getDocInfo() {
+            info.id = {&id[0], id.size()};
+            info.rev_meta = {&meta[0], meta.size()};
+            return info;
+        }
+
+        DocInfo info;
+        std::string id;
+        std::string meta;
+        vb_bgfetch_item_ctx_t* fetch;
+    };
+
     CouchKVStore &cks;
     Vbid vbId;
     vb_bgfetch_queue_t &fetches;
+    std::vector<DeferredFetch> deferred;
 };
 
 struct AllKeysCtx {
-    AllKeysCtx(std::shared_ptr<Callback<const DiskDocKey&>> callback,
+    AllKeysCtx(std::shared_ptr<StatusCallback<const DiskDocKey&>> callback,
                uint32_t cnt)
         : cb(callback), count(cnt) {
     }
 
-    std::shared_ptr<Callback<const DiskDocKey&>> cb;
+    std::shared_ptr<StatusCallback<const DiskDocKey&>> cb;
     uint32_t count;
 };
 
@@ -304,14 +387,34 @@ CouchRequest::CouchRequest(const Item& it, MutationRequestCallback cb)
 
 CouchRequest::~CouchRequest() = default;
 
+Doc* CouchRequest::getDbDoc() {
+    if (isDelete() && value.get() == nullptr) {
+        return nullptr;
+    }
+    // The request may have been moved since it was created; point at the key
+    // where it is now.
+    dbDoc.id = to_sized_buf(key);
+    return &dbDoc;
+}
+
+DocInfo* CouchRequest::getDbDocInfo() {
+    // As getDbDoc(), re-point at our own key and metadata.
+    dbDocInfo.id = to_sized_buf(key);
+    dbDocInfo.rev_meta.buf = meta.getPreparedForPersistence();
+    return &dbDocInfo;
+}
+
 namespace Collections {
 static constexpr const char* manifestName = "_local/collections/manifest";
 static constexpr const char* openCollectionsName = "_local/collections/open";
 static constexpr const char* scopesName = "_local/scope/open";
 static constexpr const char* droppedCollectionsName =
         "_local/collections/dropped";
+static constexpr const char* statsName = "_local/collections/stats";
 } // namespace Collections
 
+static constexpr const char* bloomFilterName = "_local/bloomfilter";
+
 CouchKVStore::CouchKVStore(KVStoreConfig& config)
     : CouchKVStore(config, *couchstore_get_default_file_ops()) {
 }
@@ -319,11 +422,17 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config)
 CouchKVStore::CouchKVStore(KVStoreConfig& config,
                            FileOpsInterface& ops,
                            bool readOnly,
-                           std::shared_ptr<RevisionMap> dbFileRevMap)
+                           std::shared_ptr<RevisionMap> dbFileRevMap,
+                           std::shared_ptr<CouchBlockCache> blockCache,
+                           std::shared_ptr<FileGenerations> fileGenerations)
     : KVStore(config, readOnly),
       dbname(config.getDBName()),
       dbFileRevMap(dbFileRevMap),
+      fileGenerations(fileGenerations),
+      readHandleHits(0),
+      readHandleMisses(0),
       intransaction(false),
+      blockCache(blockCache),
       scanCounter(0),
       logger(config.getLogger()),
       base_ops(ops) {
@@ -331,6 +440,15 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config,
     statCollectingFileOps = getCouchstoreStatsOps(st.fsStats, base_ops);
     statCollectingFileOpsCompaction = getCouchstoreStatsOps(
         st.fsStatsCompaction, base_ops);
+    if (blockCache) {
+        blockCacheOps = std::make_unique<BlockCacheOps>(
+                *blockCache, *statCollectingFileOps);
+    }
+    if (!readOnly && config.getCouchstoreDropFlushedPages()) {
+        dropCacheOps = std::make_unique<DropCacheOps>(
+                st.fsStats,
+                blockCacheOps ? *blockCacheOps : *statCollectingFileOps);
+    }
 
     // init db file map with default revision number, 1
     numDbFiles = configuration.getMaxVBuckets();
@@ -342,6 +460,7 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config,
     cachedFileSize.assign(numDbFiles, cb::RelaxedAtomic<uint64_t>(0));
     cachedSpaceUsed.assign(numDbFiles, cb::RelaxedAtomic<uint64_t>(0));
     cachedVBStates.resize(numDbFiles);
+    readHandles.resize(numDbFiles);
 
     initialize();
 }
@@ -350,7 +469,12 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config, FileOpsInterface& ops)
     : CouchKVStore(config,
                    ops,
                    false /*readonly*/,
-                   std::make_shared<RevisionMap>(config.getMaxVBuckets())) {
+                   std::make_shared<RevisionMap>(config.getMaxVBuckets()),
+                   config.getCouchstoreBlockCacheSize()
+                           ? std::make_shared<CouchBlockCache>(
+                                     config.getCouchstoreBlockCacheSize())
+                           : nullptr,
+                   std::make_shared<FileGenerations>(config.getMaxVBuckets())) {
 }
 
 /**
@@ -359,15 +483,20 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config, FileOpsInterface& ops)
 std::unique_ptr<CouchKVStore> CouchKVStore::makeReadOnlyStore() {
     // Not using make_unique due to the private constructor we're calling
     return std::unique_ptr<CouchKVStore>(
-            new CouchKVStore(configuration, dbFileRevMap));
+            new CouchKVStore(
+                    configuration, dbFileRevMap, blockCache, fileGenerations));
 }
 
 CouchKVStore::CouchKVStore(KVStoreConfig& config,
-                           std::shared_ptr<RevisionMap> dbFileRevMap)
+                           std::shared_ptr<RevisionMap> dbFileRevMap,
+                           std::shared_ptr<CouchBlockCache> blockCache,
+                           std::shared_ptr<FileGenerations> fileGenerations)
     : CouchKVStore(config,
                    *couchstore_get_default_file_ops(),
                    true /*readonly*/,
-                   dbFileRevMap) {
+                   dbFileRevMap,
+                   blockCache,
+                   fileGenerations) {
 }
 
 void CouchKVStore::initialize() {
@@ -429,6 +558,7 @@ void CouchKVStore::initialize() {
 
 CouchKVStore::~CouchKVStore() {
     close();
+    closeReadHandles();
 }
 
 void CouchKVStore::reset(Vbid vbucketId) {
@@ -473,13 +603,12 @@ void CouchKVStore::set(const Item& itm, SetCallback cb) {
                         "true to perform a set operation.");
     }
 
-    // each req will be de-allocated after commit
-    pendingReqsQ.emplace_back(itm, std::move(cb));
+    addPendingRequest(itm, std::move(cb));
 }
 
 GetValue CouchKVStore::get(const DiskDocKey& key, Vbid vb) {
     DbHolder db(*this);
-    couchstore_error_t errCode = openDB(vb, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openReadHandle(vb, db);
     if (errCode != COUCHSTORE_SUCCESS) {
         ++st.numGetFailure;
         logger.warn("CouchKVStore::get: openDB error:{}, {}",
@@ -557,7 +686,7 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
     int numItems = itms.size();
 
     DbHolder db(*this);
-    couchstore_error_t errCode = openDB(vb, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openReadHandle(vb, db);
     if (errCode != COUCHSTORE_SUCCESS) {
         logger.warn(
                 "CouchKVStore::getMulti: openDB error:{}, "
@@ -579,10 +708,40 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
         ++idx;
     }
 
+    // The handle may have been used by earlier reads; only count ours.
+    auto* stats = couchstore_get_db_filestats(db);
+    const auto startReadCount = stats ? stats->getReadCount() : 0;
+
     GetMultiCbCtx ctx(*this, vb, itms);
+    ctx.deferred.reserve(itms.size());
 
+    // Walk the by-id tree once for the whole batch; getMultiCb only records
+    // which document bodies need reading (metadata-only fetches complete
+    // straight away)...
     errCode = couchstore_docinfos_by_id(
             db, ids.data(), itms.size(), 0, getMultiCbC, &ctx);
+
+    // ... then read the bodies in file order, so the reads move forwards
+    // through the file and documents written together (which we often
+    // fetch together) are served from the same blocks.
+    std::sort(ctx.deferred.begin(),
+              ctx.deferred.end(),
+              [](const GetMultiCbCtx::DeferredFetch& a,
+                 const GetMultiCbCtx::DeferredFetch& b) {
+                  return a.info.bp < b.info.bp;
+              });
+    uint64_t prevEnd = 0;
+    size_t adjacentReads = 0;
+    for (auto& fetch : ctx.deferred) {
+        if (prevEnd != 0 && fetch.info.bp < prevEnd + getMultiAdjacentBytes) {
+            ++adjacentReads;
+        }
+        prevEnd = fetch.info.bp + fetch.info.physical_size;
+        completeGetMultiFetch(db, fetch.getDocInfo(), *fetch.fetch, vb);
+    }
+    st.getMultiBodyReadHisto.add(ctx.deferred.size());
+    st.getMultiAdjacentReadHisto.add(adjacentReads);
+
     if (errCode != COUCHSTORE_SUCCESS) {
         st.numGetFailure += numItems;
         logger.warn(
@@ -598,9 +757,8 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
 
     // If available, record how many reads() we did for this getMulti;
     // and the average reads per document.
-    auto* stats = couchstore_get_db_filestats(db);
     if (stats != nullptr) {
-        const auto readCount = stats->getReadCount();
+        const auto readCount = stats->getReadCount() - startReadCount;
         st.getMultiFsReadCount += readCount;
         st.getMultiFsReadHisto.add(readCount);
         st.getMultiFsReadPerDocHisto.add(readCount / itms.size());
@@ -699,6 +857,14 @@ void CouchKVStore::del(const Item& itm, DeleteCallback cb) {
                         "true to perform a delete operation.");
     }
 
+    addPendingRequest(itm, std::move(cb));
+}
+
+void CouchKVStore::addPendingRequest(const Item& itm,
+                                     MutationRequestCallback cb) {
+    if (pendingReqsQ.size() == pendingReqsQ.capacity()) {
+        ++pendingReqsAllocs;
+    }
     pendingReqsQ.emplace_back(itm, std::move(cb));
 }
 
@@ -786,8 +952,8 @@ static int edit_docinfo_hook(DocInfo **info, const sized_buf *item) {
         }
 
         protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
-        if (checkUTF8JSON(reinterpret_cast<const uint8_t*>(data.data()),
-                          data.size())) {
+        if (cb::isValidJson(reinterpret_cast<const uint8_t*>(data.data()),
+                            data.size())) {
             datatype = PROTOCOL_BINARY_DATATYPE_JSON;
         }
 
@@ -1058,6 +1224,19 @@ bool CouchKVStore::compactDBInternal(compaction_ctx* hook_ctx,
     couchstore_compact_hook       hook = time_purge_hook;
     couchstore_docinfo_hook dhook = docinfo_hook;
     FileOpsInterface         *def_iops = statCollectingFileOpsCompaction.get();
+    // Declared ahead of the DbHolders, as it must outlive their files.
+    std::unique_ptr<RateLimitedOps> rateLimitedOps;
+    if (hook_ctx->rateLimiter && hook_ctx->rateLimiter->isEnabled()) {
+        rateLimitedOps = std::make_unique<RateLimitedOps>(
+                *hook_ctx->rateLimiter, *def_iops);
+        def_iops = rateLimitedOps.get();
+    }
+    std::unique_ptr<DropCacheOps> dropCacheCompactionOps;
+    if (configuration.getCouchstoreDropCompactedPages()) {
+        dropCacheCompactionOps = std::make_unique<DropCacheOps>(
+                st.fsStatsCompaction, *def_iops);
+        def_iops = dropCacheCompactionOps.get();
+    }
     DbHolder compactdb(*this);
     DbHolder targetDb(*this);
     couchstore_error_t         errCode = COUCHSTORE_SUCCESS;
@@ -1219,6 +1398,15 @@ bool CouchKVStore::compactDBInternal(compaction_ctx* hook_ctx,
         state->onDiskPrepares -= hook_ctx->stats.preparesPurged;
         // Must sync the modified state back
         saveVBState(targetDb.getDb(), *state);
+        // The file holds exactly the keys the compaction saw, so the filter
+        // it built is valid until the next write.
+        if (hook_ctx->getBloomFilter) {
+            const auto filter = hook_ctx->getBloomFilter();
+            if (!filter.empty()) {
+                writeBloomFilter(
+                        *targetDb.getDb(), info.last_sequence, filter);
+            }
+        }
         errCode = couchstore_commit(targetDb.getDb());
         if (errCode != COUCHSTORE_SUCCESS) {
             logger.warn(
@@ -1404,6 +1592,24 @@ bool CouchKVStore::getStat(const char* name, size_t& value)  {
     } else if (strcmp("io_bg_fetch_read_count", name) == 0) {
         value = st.getMultiFsReadCount;
         return true;
+    } else if (strcmp("read_handle_cache_hits", name) == 0) {
+        value = readHandleHits;
+        return true;
+    } else if (strcmp("read_handle_cache_misses", name) == 0) {
+        value = readHandleMisses;
+        return true;
+    } else if (blockCache && strcmp("block_cache_hits", name) == 0) {
+        value = blockCache->getHits();
+        return true;
+    } else if (blockCache && strcmp("block_cache_misses", name) == 0) {
+        value = blockCache->getMisses();
+        return true;
+    } else if (blockCache && strcmp("block_cache_evictions", name) == 0) {
+        value = blockCache->getEvictions();
+        return true;
+    } else if (blockCache && strcmp("block_cache_mem_used", name) == 0) {
+        value = blockCache->getMemUsed();
+        return true;
     }
 
     return false;
@@ -1540,7 +1746,8 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
         return scan_failed;
     }
 
-    if (ctx->lastReadSeqno == ctx->maxSeqno) {
+    // (A key order scan may have read the last seqno before other items)
+    if (!ctx->keyOrder && ctx->lastReadSeqno == ctx->maxSeqno) {
         return scan_success;
     }
 
@@ -1562,6 +1769,15 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
         db = itr->second;
     }
 
+    if (ctx->collection) {
+        auto status = scanCollection(db, *ctx);
+        TRACE_EVENT_END1("CouchKVStore",
+                         "scan",
+                         "lastReadSeqno",
+                         ctx->lastReadSeqno);
+        return status;
+    }
+
     uint64_t start = ctx->startSeqno;
     if (ctx->lastReadSeqno != 0) {
         start = ctx->lastReadSeqno + 1;
@@ -1592,6 +1808,165 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
     return scan_success;
 }
 
+/**
+ * @return the (inclusive) key ranges a collection scan reads: the collection's
+ *         committed keys, its prepared keys (in the DurabilityPrepare
+ *         namespace) and the key of its system event.
+ */
+static std::array<std::pair<std::string, std::string>, 3>
+getCollectionScanRanges(CollectionID collection) {
+    const auto prefix = Collections::makeCollectionIdIntoString(collection);
+    const auto preparePrefix =
+            Collections::makeCollectionIdIntoString(
+                    CollectionID(CollectionID::DurabilityPrepare,
+                                 CollectionID::SkipIDVerificationTag{})) +
+            prefix;
+    const auto eventKey = DiskDocKey(
+            StoredDocKey(SystemEventFactory::makeKey(SystemEvent::Collection,
+                                                     prefix),
+                         CollectionID::System));
+    const std::string event(reinterpret_cast<const char*>(eventKey.data()),
+                            eventKey.size());
+    // Keys are at most 250 bytes, so any key with a prefix sorts below
+    // the prefix followed by that many 0xff bytes.
+    const std::string keyEnd(250, '\xff');
+    return {{{prefix, prefix + keyEnd},
+             {preparePrefix, preparePrefix + keyEnd},
+             {event, event}}};
+}
+
+static sized_buf toSizedBuf(const std::string& str) {
+    return sized_buf{const_cast<char*>(str.data()), str.size()};
+}
+
+scan_error_t CouchKVStore::scanCollection(Db* db, ScanContext& ctx) {
+    CollectionScan* scan;
+    {
+        LockHolder lh(scanLock);
+        scan = &collectionScans[ctx.scanId];
+    }
+
+    const auto ranges = getCollectionScanRanges(*ctx.collection);
+    if (ctx.keyOrder) {
+        return scanCollectionByKey(db, ctx, *scan, ranges);
+    }
+
+    if (!scan->loaded) {
+        uint64_t start = ctx.startSeqno;
+        if (ctx.lastReadSeqno != 0) {
+            start = ctx.lastReadSeqno + 1;
+        }
+
+        std::array<sized_buf, 6> rangeBufs;
+        for (size_t ii = 0; ii < ranges.size(); ++ii) {
+            rangeBufs[ii * 2] = toSizedBuf(ranges[ii].first);
+            rangeBufs[ii * 2 + 1] = toSizedBuf(ranges[ii].second);
+        }
+
+        struct LoadState {
+            uint64_t start;
+            uint64_t end;
+            std::deque<CollectionScanDoc>& docs;
+        };
+        LoadState state{start, uint64_t(ctx.maxSeqno), scan->docs};
+        auto callback = [](Db*, DocInfo* docinfo, void* ctx) -> int {
+            auto& state = *reinterpret_cast<LoadState*>(ctx);
+            if (docinfo->db_seq >= state.start &&
+                docinfo->db_seq <= state.end) {
+                state.docs.emplace_back(*docinfo);
+            }
+            return COUCHSTORE_SUCCESS;
+        };
+
+        auto errorCode = couchstore_docinfos_by_id(
+                db,
+                rangeBufs.data(),
+                rangeBufs.size(),
+                RANGES | getDocFilter(ctx.docFilter),
+                callback,
+                &state);
+        if (errorCode != COUCHSTORE_SUCCESS) {
+            logger.warn(
+                    "CouchKVStore::scanCollection couchstore_docinfos_by_id "
+                    "error:{} [{}]",
+                    couchstore_strerror(errorCode),
+                    couchkvstore_strerrno(db, errorCode));
+            return scan_failed;
+        }
+        std::sort(scan->docs.begin(),
+                  scan->docs.end(),
+                  [](const CollectionScanDoc& a, const CollectionScanDoc& b) {
+                      return a.info.db_seq < b.info.db_seq;
+                  });
+        scan->loaded = true;
+    }
+
+    while (!scan->docs.empty()) {
+        if (recordDbDump(db, &scan->docs.front().getDocInfo(), &ctx) ==
+            COUCHSTORE_ERROR_CANCEL) {
+            return scan_again;
+        }
+        scan->docs.pop_front();
+    }
+    return scan_success;
+}
+
+scan_error_t CouchKVStore::scanCollectionByKey(
+        Db* db,
+        ScanContext& ctx,
+        CollectionScan& scan,
+        const std::array<std::pair<std::string, std::string>, 3>& ranges) {
+    // The items are returned as they're found (nothing is held); a paused
+    // scan resumes from the key it stopped at (the item wasn't taken).
+    struct ReadState {
+        ScanContext& ctx;
+        std::string& resumeKey;
+        bool paused;
+    };
+    ReadState state{ctx, scan.resumeKey, false};
+    auto callback = [](Db* db, DocInfo* docinfo, void* ctx) -> int {
+        auto& state = *reinterpret_cast<ReadState*>(ctx);
+        if (docinfo->db_seq < uint64_t(state.ctx.startSeqno) ||
+            docinfo->db_seq > uint64_t(state.ctx.maxSeqno)) {
+            return COUCHSTORE_SUCCESS;
+        }
+        if (recordDbDump(db, docinfo, &state.ctx) == COUCHSTORE_ERROR_CANCEL) {
+            state.resumeKey.assign(docinfo->id.buf, docinfo->id.size);
+            state.paused = true;
+            return COUCHSTORE_ERROR_CANCEL;
+        }
+        return COUCHSTORE_SUCCESS;
+    };
+
+    for (; scan.range < ranges.size(); ++scan.range) {
+        const auto& range = ranges[scan.range];
+        const std::string start =
+                scan.resumeKey.empty() ? range.first : scan.resumeKey;
+        std::array<sized_buf, 2> rangeBufs = {
+                {toSizedBuf(start), toSizedBuf(range.second)}};
+        auto errorCode = couchstore_docinfos_by_id(
+                db,
+                rangeBufs.data(),
+                rangeBufs.size(),
+                RANGES | getDocFilter(ctx.docFilter),
+                callback,
+                &state);
+        if (state.paused) {
+            return scan_again;
+        }
+        if (errorCode != COUCHSTORE_SUCCESS) {
+            logger.warn(
+                    "CouchKVStore::scanCollectionByKey "
+                    "couchstore_docinfos_by_id error:{} [{}]",
+                    couchstore_strerror(errorCode),
+                    couchkvstore_strerrno(db, errorCode));
+            return scan_failed;
+        }
+        scan.resumeKey.clear();
+    }
+    return scan_success;
+}
+
 void CouchKVStore::destroyScanContext(ScanContext* ctx) {
     if (!ctx) {
         return;
@@ -1603,12 +1978,13 @@ void CouchKVStore::destroyScanContext(ScanContext* ctx) {
         closeDatabaseHandle(itr->second);
         scans.erase(itr);
     }
+    collectionScans.erase(ctx->scanId);
     delete ctx;
 }
 
 DbInfo CouchKVStore::getDbInfo(Vbid vbid) {
     DbHolder db(*this);
-    couchstore_error_t errCode = openDB(vbid, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openReadHandle(vbid, db);
     if (errCode == COUCHSTORE_SUCCESS) {
         DbInfo info;
         errCode = couchstore_db_info(db, &info);
@@ -1707,6 +2083,107 @@ couchstore_error_t CouchKVStore::openDB(Vbid vbucketId,
     return openSpecificDB(vbucketId, fileRev, db, options, ops);
 }
 
+couchstore_error_t CouchKVStore::openReadHandle(Vbid vbucketId, DbHolder& db) {
+    if (!configuration.getCouchstoreCacheReadHandles()) {
+        return openDB(vbucketId, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    }
+
+    // Read the generation before opening the file, so a header committed
+    // whilst we open it leaves the handle stale (rather than wrongly current).
+    const uint64_t generation = fileGenerations->headers[vbucketId.get()];
+    CachedReadHandle cached;
+    std::vector<Db*> stale;
+    {
+        std::lock_guard<std::mutex> lh(readHandlesMutex);
+        // Files have been removed since we last looked; don't keep them open.
+        const uint64_t removals = fileGenerations->removals;
+        if (removals != readHandlesCheckedAt) {
+            readHandlesCheckedAt = removals;
+            for (size_t vb = 0; vb < readHandles.size(); ++vb) {
+                auto& handle = readHandles[vb];
+                if (handle.db &&
+                    handle.generation != fileGenerations->headers[vb]) {
+                    stale.push_back(handle.db);
+                    handle = {};
+                }
+            }
+        }
+        std::swap(cached, readHandles[vbucketId.get()]);
+    }
+    for (auto* staleDb : stale) {
+        closeDatabaseHandle(staleDb);
+    }
+
+    if (cached.db) {
+        if (cached.generation == generation &&
+            cached.fileRev == (*dbFileRevMap)[vbucketId.get()]) {
+            ++readHandleHits;
+            *db.getDbAddress() = cached.db;
+            db.setFileRev(cached.fileRev);
+            db.setOpenedFor(vbucketId, false);
+            db.setReadHandleGeneration(generation);
+            return COUCHSTORE_SUCCESS;
+        }
+        closeDatabaseHandle(cached.db);
+    }
+
+    ++readHandleMisses;
+    const auto errCode = openDB(vbucketId, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    if (errCode == COUCHSTORE_SUCCESS) {
+        db.setReadHandleGeneration(generation);
+    }
+    return errCode;
+}
+
+void CouchKVStore::returnReadHandle(Vbid vbucketId,
+                                    uint64_t fileRev,
+                                    uint64_t generation,
+                                    Db* db) {
+    if (generation == fileGenerations->headers[vbucketId.get()]) {
+        std::lock_guard<std::mutex> lh(readHandlesMutex);
+        auto& handle = readHandles[vbucketId.get()];
+        if (!handle.db) {
+            handle = {db, fileRev, generation};
+            return;
+        }
+    }
+    // Stale, or another reader has already cached a handle of the vBucket.
+    closeDatabaseHandle(db);
+}
+
+void CouchKVStore::fileHeadersChanged(Vbid vbucketId) {
+    ++fileGenerations->headers[vbucketId.get()];
+}
+
+void CouchKVStore::fileRemoved(Vbid vbucketId) {
+    fileHeadersChanged(vbucketId);
+    ++fileGenerations->removals;
+
+    // Close our own handle now, so it doesn't hold the file open whilst it's
+    // removed.
+    CachedReadHandle cached;
+    {
+        std::lock_guard<std::mutex> lh(readHandlesMutex);
+        std::swap(cached, readHandles[vbucketId.get()]);
+    }
+    if (cached.db) {
+        closeDatabaseHandle(cached.db);
+    }
+}
+
+void CouchKVStore::closeReadHandles() {
+    std::vector<CachedReadHandle> handles(readHandles.size());
+    {
+        std::lock_guard<std::mutex> lh(readHandlesMutex);
+        std::swap(handles, readHandles);
+    }
+    for (auto& handle : handles) {
+        if (handle.db) {
+            closeDatabaseHandle(handle.db);
+        }
+    }
+}
+
 couchstore_error_t CouchKVStore::openSpecificDB(Vbid vbucketId,
                                                 uint64_t fileRev,
                                                 DbHolder& db,
@@ -1714,9 +2191,16 @@ couchstore_error_t CouchKVStore::openSpecificDB(Vbid vbucketId,
                                                 FileOpsInterface* ops) {
     std::string dbFileName = getDBFileName(dbname, vbucketId, fileRev);
     db.setFileRev(fileRev); // save the rev so the caller can log it
+    db.setOpenedFor(vbucketId, !(options & COUCHSTORE_OPEN_FLAG_RDONLY));
 
     if(ops == nullptr) {
-        ops = statCollectingFileOps.get();
+        if (dropCacheOps) {
+            ops = dropCacheOps.get();
+        } else if (blockCacheOps) {
+            ops = blockCacheOps.get();
+        } else {
+            ops = statCollectingFileOps.get();
+        }
     }
 
     couchstore_error_t errorCode = COUCHSTORE_SUCCESS;
@@ -1867,8 +2351,9 @@ couchstore_error_t CouchKVStore::fetchDoc(Db* db,
     }
 
     if (metaOnly == GetMetaOnly::Yes) {
-        auto it = makeItemFromDocInfo(
-                vbId, *docinfo, *metadata, {nullptr, docinfo->size});
+        // The value isn't read from disk, so don't allocate space for it
+        // (only the metadata is used to restore the StoredValue)
+        auto it = makeItemFromDocInfo(vbId, *docinfo, *metadata, {nullptr, 0});
 
         docValue = GetValue(std::move(it));
         // update ep-engine IO stats
@@ -1877,8 +2362,14 @@ couchstore_error_t CouchKVStore::fetchDoc(Db* db,
     } else {
         Doc *doc = nullptr;
         sized_buf value = {nullptr, 0};
-        errCode = couchstore_open_doc_with_docinfo(db, docinfo, &doc,
-                                                   DECOMPRESS_DOC_BODIES);
+        // The body is inflated directly into the new Item (rather than
+        // letting couchstore inflate it into a buffer we would have to copy).
+        // Documents with V0 metadata need the inflated body to determine
+        // their datatype, so let couchstore inflate those.
+        const bool isV0 = metadata->getVersionInitialisedFrom() ==
+                          MetaData::Version::V0;
+        errCode = couchstore_open_doc_with_docinfo(
+                db, docinfo, &doc, isV0 ? DECOMPRESS_DOC_BODIES : 0);
         if (errCode == COUCHSTORE_SUCCESS) {
             if (doc == nullptr) {
                 throw std::logic_error("CouchKVStore::fetchDoc: doc is NULL");
@@ -1893,7 +2384,7 @@ couchstore_error_t CouchKVStore::fetchDoc(Db* db,
 
             value = doc->data;
 
-            if (metadata->getVersionInitialisedFrom() == MetaData::Version::V0) {
+            if (isV0) {
                 // This is a super old version of a couchstore file.
                 // Try to determine if the document is JSON or raw bytes
                 metadata->setDataType(determine_datatype(doc->data));
@@ -1904,8 +2395,29 @@ couchstore_error_t CouchKVStore::fetchDoc(Db* db,
             return errCode;
         }
 
+        const bool inflate = !isV0 && value.size > 0 &&
+                             (docinfo->content_meta & COUCH_DOC_IS_COMPRESSED);
         try {
-            auto it = makeItemFromDocInfo(vbId, *docinfo, *metadata, value);
+            std::unique_ptr<Item> it;
+            if (inflate) {
+                size_t inflatedSize;
+                if (!snappy::GetUncompressedLength(
+                            value.buf, value.size, &inflatedSize)) {
+                    couchstore_free_document(doc);
+                    return COUCHSTORE_ERROR_CORRUPT;
+                }
+                it = makeItemFromDocInfo(
+                        vbId, *docinfo, *metadata, {nullptr, inflatedSize});
+                // The Item is newly created so nobody else may see the value
+                if (!snappy::RawUncompress(value.buf,
+                                           value.size,
+                                           const_cast<char*>(it->getData()))) {
+                    couchstore_free_document(doc);
+                    return COUCHSTORE_ERROR_CORRUPT;
+                }
+            } else {
+                it = makeItemFromDocInfo(vbId, *docinfo, *metadata, value);
+            }
             docValue = GetValue(std::move(it));
         } catch (std::bad_alloc&) {
             couchstore_free_document(doc);
@@ -1914,8 +2426,8 @@ couchstore_error_t CouchKVStore::fetchDoc(Db* db,
 
         // update ep-engine IO stats
         ++st.io_bg_fetch_docs_read;
-        st.io_bgfetch_doc_bytes +=
-                (docinfo->id.size + docinfo->rev_meta.size + value.size);
+        st.io_bgfetch_doc_bytes += (docinfo->id.size + docinfo->rev_meta.size +
+                                    docValue.item->getNBytes());
 
         couchstore_free_document(doc);
     }
@@ -2087,7 +2599,15 @@ bool CouchKVStore::commit2couchstore(Collections::VB::Flush& collectionsFlush) {
 
     commitCallback(pendingReqsQ, kvctx, errCode);
 
-    pendingReqsQ.clear();
+    st.commitRequestAllocs = pendingReqsAllocs;
+    pendingReqsAllocs = 0;
+    // Keep the storage of the requests for the next batch, unless this batch
+    // needed less than half of it (e.g. after a one-off large flush).
+    if (pendingCommitCnt < pendingReqsQ.capacity() / 2) {
+        PendingRequestQueue().swap(pendingReqsQ);
+    } else {
+        pendingReqsQ.clear();
+    }
     return success;
 }
 
@@ -2247,12 +2767,17 @@ couchstore_error_t CouchKVStore::saveDocs(Vbid vbid,
             }
         }
 
-        auto collectionStatsSize = kvctx.collectionsFlush.saveCollectionStats(
-                std::bind(&CouchKVStore::saveCollectionStats,
-                          this,
-                          std::ref(*db),
-                          std::placeholders::_1,
-                          std::placeholders::_2));
+        // Gather the stats of every changed collection, so they are all
+        // written in a single update of the stats doc.
+        std::unordered_map<CollectionID, Collections::VB::PersistedStats>
+                collectionStats;
+        kvctx.collectionsFlush.saveCollectionStats(
+                [&collectionStats](CollectionID cid,
+                                   Collections::VB::PersistedStats stats) {
+                    collectionStats[cid] = stats;
+                    return size_t(0);
+                });
+        auto collectionStatsSize = saveCollectionStats(*db, collectionStats);
 
         state->onDiskPrepares += kvctx.onDiskPrepareDelta;
         errCode = saveVBState(db, *state);
@@ -2598,34 +3123,32 @@ couchstore_error_t CouchKVStore::saveVBState(Db *db,
 }
 
 size_t CouchKVStore::saveCollectionStats(
-        Db& db, CollectionID cid, Collections::VB::PersistedStats stats) {
+        Db& db,
+        const std::unordered_map<CollectionID, Collections::VB::PersistedStats>&
+                stats) {
+    if (stats.empty() && collectionsMeta.droppedCollections.empty()) {
+        return 0;
+    }
     TRACE_EVENT0("CouchKVStore", "saveCollectionStats");
 
-    // Write out the stats in BE to a local doc named after the collection
-    // Using set-notation cardinality - |cid| which helps keep the keys small
-    std::string docName = "|" + cid.to_string() + "|";
-
-    LocalDoc lDoc;
-    lDoc.id.buf = const_cast<char*>(docName.c_str());
-    lDoc.id.size = docName.size();
-
-    auto encodedStats = stats.getLebEncodedStats();
-    lDoc.json.buf = const_cast<char*>(encodedStats.data());
-    lDoc.json.size = encodedStats.size();
-    lDoc.deleted = 0;
-
-    auto errCode = couchstore_save_local_document(&db, &lDoc);
-
-    if (errCode != COUCHSTORE_SUCCESS) {
-        logger.warn(
-                "CouchKVStore::saveCollectionStats cid:{} "
-                "couchstore_save_local_document "
-                "error:{} [{}]",
-                cid.to_string(),
-                couchstore_strerror(errCode),
-                couchkvstore_strerrno(&db, errCode));
+    auto current = readLocalDoc(db, Collections::statsName);
+    cb::const_byte_buffer empty;
+    const auto currentBuf = current.getLocalDoc() ? current.getBuffer() : empty;
+    auto buf = Collections::KVStore::encodeCollectionsStats(
+            stats, collectionsMeta.droppedCollections, currentBuf);
+
+    // The same stats always encode to the same bytes; skip the write if
+    // nothing changed.
+    if (buf.size() == currentBuf.size() &&
+        std::equal(buf.data(), buf.data() + buf.size(), currentBuf.data())) {
+        return 0;
     }
-    return encodedStats.size();
+
+    writeLocalDoc(db,
+                  Collections::statsName,
+                  {reinterpret_cast<const char*>(buf.data()),
+                   buf.size()}); // internally logs
+    return buf.size();
 }
 
 void CouchKVStore::deleteCollectionStats(Db& db, CollectionID cid) {
@@ -2634,9 +3157,20 @@ void CouchKVStore::deleteCollectionStats(Db& db, CollectionID cid) {
 
 Collections::VB::PersistedStats CouchKVStore::getCollectionStats(
         const KVFileHandle& kvFileHandle, CollectionID collection) {
+    const auto& db = static_cast<const CouchKVFileHandle&>(kvFileHandle);
+    auto allStats = readLocalDoc(*db.getDb(), Collections::statsName);
+    if (allStats.getLocalDoc()) {
+        auto stats = Collections::KVStore::decodeCollectionStats(
+                allStats.getBuffer(), collection);
+        if (stats) {
+            return *stats;
+        }
+    }
+
+    // Not updated since the stats were stored in a local doc per collection.
+    // Using set-notation cardinality - |cid| which helps keep the keys small
     std::string docName = "|" + collection.to_string() + "|";
 
-    const auto& db = static_cast<const CouchKVFileHandle&>(kvFileHandle);
     sized_buf id;
     id.buf = const_cast<char*>(docName.c_str());
     id.size = docName.size();
@@ -2674,7 +3208,6 @@ int CouchKVStore::getMultiCb(Db *db, DocInfo *docinfo, void *ctx) {
 
     GetMultiCbCtx *cbCtx = static_cast<GetMultiCbCtx *>(ctx);
     auto key = makeDiskDocKey(docinfo->id);
-    KVStoreStats& st = cbCtx->cks.getKVStoreStat();
 
     vb_bgfetch_queue_t::iterator qitr = cbCtx->fetches.find(key);
     if (qitr == cbCtx->fetches.end()) {
@@ -2691,15 +3224,29 @@ int CouchKVStore::getMultiCb(Db *db, DocInfo *docinfo, void *ctx) {
     }
 
     vb_bgfetch_item_ctx_t& bg_itm_ctx = (*qitr).second;
+    if (bg_itm_ctx.isMetaOnly == GetMetaOnly::Yes) {
+        cbCtx->cks.completeGetMultiFetch(db, *docinfo, bg_itm_ctx, cbCtx->vbId);
+    } else {
+        // Read the body once the whole batch has been looked up.
+        cbCtx->deferred.emplace_back(*docinfo, bg_itm_ctx);
+    }
+
+    return 0;
+}
+
+void CouchKVStore::completeGetMultiFetch(Db* db,
+                                         DocInfo& docinfo,
+                                         vb_bgfetch_item_ctx_t& bg_itm_ctx,
+                                         Vbid vbId) {
     GetMetaOnly meta_only = bg_itm_ctx.isMetaOnly;
 
-    couchstore_error_t errCode = cbCtx->cks.fetchDoc(
-            db, docinfo, bg_itm_ctx.value, cbCtx->vbId, meta_only);
+    couchstore_error_t errCode =
+            fetchDoc(db, &docinfo, bg_itm_ctx.value, vbId, meta_only);
     if (errCode != COUCHSTORE_SUCCESS && (meta_only == GetMetaOnly::No)) {
         st.numGetFailure++;
     }
 
-    bg_itm_ctx.value.setStatus(cbCtx->cks.couchErr2EngineErr(errCode));
+    bg_itm_ctx.value.setStatus(couchErr2EngineErr(errCode));
 
     bool return_val_ownership_transferred = false;
     for (auto& fetch : bg_itm_ctx.bgfetched_list) {
@@ -2716,14 +3263,12 @@ int CouchKVStore::getMultiCb(Db *db, DocInfo *docinfo, void *ctx) {
         }
     }
     if (!return_val_ownership_transferred) {
-        cbCtx->cks.logger.warn(
-                "CouchKVStore::getMultiCb called with zero"
+        logger.warn(
+                "CouchKVStore::completeGetMultiFetch called with zero "
                 "items in bgfetched_list, {}, seqno:{}",
-                cbCtx->vbId,
-                docinfo->rev_seq);
+                vbId,
+                docinfo.rev_seq);
     }
-
-    return 0;
 }
 
 
@@ -2771,7 +3316,7 @@ size_t CouchKVStore::getNumPersistedDeletes(Vbid vbid) {
     }
 
     DbHolder db(*this);
-    couchstore_error_t errCode = openDB(vbid, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openReadHandle(vbid, db);
     if (errCode == COUCHSTORE_SUCCESS) {
         DbInfo info;
         errCode = couchstore_db_info(db, &info);
@@ -2880,6 +3425,29 @@ RollbackResult CouchKVStore::rollback(Vbid vbid,
         return RollbackResult(false);
     }
 
+    // The Rollback Header will be at or before the requested rollback point,
+    // so at least the updates after it are discarded. If that is already too
+    // many, reset now rather than after walking back through the headers.
+    uint64_t minRollbackSeqCount = 0;
+    errCode = couchstore_changes_count(
+            db, rollbackSeqno + 1, latestSeqno, &minRollbackSeqCount);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.warn(
+                "CouchKVStore::rollback: "
+                "couchstore_changes_count({}, {}) error:{} [{}], "
+                "{}, rev:{}",
+                rollbackSeqno + 1,
+                latestSeqno,
+                couchstore_strerror(errCode),
+                cb_strerror(),
+                vbid,
+                db.getFileRev());
+        return RollbackResult(false);
+    }
+    if (isRollbackTooLarge(totSeqCount, minRollbackSeqCount)) {
+        return RollbackResult(false);
+    }
+
     // Open the vBucket file again; and search for a header which is
     // before the requested rollback point - the Rollback Header.
     DbHolder newdb(*this);
@@ -2940,11 +3508,7 @@ RollbackResult CouchKVStore::rollback(Vbid vbid,
         return RollbackResult(false);
     }
 
-    // Allow rollbacks when we have fewer than 10 items even if the requested
-    // rollback point is in the first half of our seqnos. This allows much
-    // easier testing as we do not have to write x items before the majority of
-    // tests to verify certain rollback behaviours.
-    if (totSeqCount > 10 && (totSeqCount / 2) <= rollbackSeqCount) {
+    if (isRollbackTooLarge(totSeqCount, rollbackSeqCount)) {
         //doresetVbucket flag set or rollback is greater than 50%,
         //reset the vbucket and send the entire snapshot
         return RollbackResult(false);
@@ -2960,15 +3524,28 @@ RollbackResult CouchKVStore::rollback(Vbid vbid,
     //   deleted in the Rollback header).
     // * If the key is present in the Rollback header then replace the in-memory
     // value with the value from the Rollback header.
+    // If the callback needs the keys' state in the Rollback header, look them
+    // up a batch at a time rather than leaving it to do so key by key.
     cb->setDbHeader(newdb);
+    std::shared_ptr<RollbackBatchCallback> batchCb;
+    if (cb->needsPreRollbackState()) {
+        batchCb = std::make_shared<RollbackBatchCallback>(
+                [this, &newdb, vbid, &cb](std::vector<GetValue>& batch) {
+                    return rollbackDiscardedUpdates(newdb, vbid, batch, *cb);
+                });
+    }
     auto cl = std::make_shared<NoLookupCallback>();
-    ScanContext* ctx = initScanContext(cb, cl, vbid, info.last_sequence+1,
-                                       DocumentFilter::ALL_ITEMS,
-                                       ValueFilter::KEYS_ONLY);
+    ScanContext* ctx = initScanContext(
+            batchCb ? std::shared_ptr<StatusCallback<GetValue>>(batchCb) : cb,
+            cl,
+            vbid,
+            info.last_sequence + 1,
+            DocumentFilter::ALL_ITEMS,
+            ValueFilter::KEYS_ONLY);
     scan_error_t error = scan(ctx);
     destroyScanContext(ctx);
 
-    if (error != scan_success) {
+    if (error != scan_success || (batchCb && !batchCb->flush())) {
         return RollbackResult(false);
     }
 
@@ -2993,10 +3570,94 @@ RollbackResult CouchKVStore::rollback(Vbid vbid,
                           vb_state->lastSnapEnd);
 }
 
+bool CouchKVStore::isRollbackTooLarge(uint64_t totSeqCount,
+                                      uint64_t rollbackSeqCount) {
+    // Allow rollbacks when we have fewer than 10 items even if the requested
+    // rollback point is in the first half of our seqnos. This allows much
+    // easier testing as we do not have to write x items before the majority of
+    // tests to verify certain rollback behaviours.
+    return totSeqCount > 10 && (totSeqCount / 2) <= rollbackSeqCount;
+}
+
+bool CouchKVStore::rollbackDiscardedUpdates(Db* rollbackDb,
+                                            Vbid vbid,
+                                            std::vector<GetValue>& discarded,
+                                            RollbackCB& cb) {
+    struct LookupState {
+        CouchKVStore& cks;
+        Vbid vbid;
+        std::unordered_map<DiskDocKey, GetValue> found;
+        couchstore_error_t fetchError;
+    };
+    LookupState state{*this, vbid, {}, COUCHSTORE_SUCCESS};
+
+    // The by-seqno index only holds the latest update of each key, so every
+    // key appears once.
+    std::vector<DiskDocKey> keys;
+    std::vector<sized_buf> ids;
+    keys.reserve(discarded.size());
+    ids.reserve(discarded.size());
+    for (const auto& val : discarded) {
+        keys.emplace_back(*val.item);
+        ids.push_back(to_sized_buf(keys.back()));
+    }
+
+    auto lookupCb = [](Db* db, DocInfo* docinfo, void* ctx) -> int {
+        auto& state = *reinterpret_cast<LookupState*>(ctx);
+        GetValue preRollback;
+        auto errCode = state.cks.fetchDoc(
+                db, docinfo, preRollback, state.vbid, GetMetaOnly::No);
+        if (errCode != COUCHSTORE_SUCCESS) {
+            state.fetchError = errCode;
+            return errCode;
+        }
+        preRollback.setStatus(ENGINE_SUCCESS);
+        state.found.emplace(makeDiskDocKey(docinfo->id),
+                            std::move(preRollback));
+        return COUCHSTORE_SUCCESS;
+    };
+
+    auto errCode = couchstore_docinfos_by_id(
+            rollbackDb, ids.data(), ids.size(), 0, lookupCb, &state);
+    if (errCode != COUCHSTORE_SUCCESS ||
+        state.fetchError != COUCHSTORE_SUCCESS) {
+        if (errCode == COUCHSTORE_SUCCESS) {
+            errCode = state.fetchError;
+        }
+        logger.warn(
+                "CouchKVStore::rollbackDiscardedUpdates: "
+                "couchstore_docinfos_by_id error:{} [{}], {}, numDocs:{}",
+                couchstore_strerror(errCode),
+                couchkvstore_strerrno(rollbackDb, errCode),
+                vbid,
+                discarded.size());
+        return false;
+    }
+
+    for (size_t ii = 0; ii < discarded.size(); ++ii) {
+        auto& val = discarded[ii];
+        auto it = state.found.find(keys[ii]);
+        if (it == state.found.end()) {
+            GetValue notFound; // ENGINE_KEY_ENOENT
+            cb.discardedUpdate(val, notFound);
+        } else {
+            cb.discardedUpdate(val, it->second);
+        }
+        if (cb.getStatus() == ENGINE_ENOMEM) {
+            return false;
+        }
+    }
+    return true;
+}
+
 int populateAllKeys(Db *db, DocInfo *docinfo, void *ctx) {
     AllKeysCtx *allKeysCtx = (AllKeysCtx *)ctx;
     auto key = makeDiskDocKey(docinfo->id);
     (allKeysCtx->cb)->callback(key);
+    if (allKeysCtx->cb->getStatus() != ENGINE_SUCCESS) {
+        // The callback doesn't want any more keys
+        return COUCHSTORE_ERROR_CANCEL;
+    }
     if (--(allKeysCtx->count) <= 0) {
         //Only when count met is less than the actual number of entries
         return COUCHSTORE_ERROR_CANCEL;
@@ -3004,13 +3665,13 @@ int populateAllKeys(Db *db, DocInfo *docinfo, void *ctx) {
     return COUCHSTORE_SUCCESS;
 }
 
-ENGINE_ERROR_CODE
-CouchKVStore::getAllKeys(Vbid vbid,
-                         const DiskDocKey& start_key,
-                         uint32_t count,
-                         std::shared_ptr<Callback<const DiskDocKey&>> cb) {
+ENGINE_ERROR_CODE CouchKVStore::getAllKeys(
+        Vbid vbid,
+        const DiskDocKey& start_key,
+        uint32_t count,
+        std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) {
     DbHolder db(*this);
-    couchstore_error_t errCode = openDB(vbid, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openReadHandle(vbid, db);
     if(errCode == COUCHSTORE_SUCCESS) {
         sized_buf ref = to_sized_buf(start_key);
 
@@ -3054,6 +3715,7 @@ void CouchKVStore::unlinkCouchFile(Vbid vbucket, uint64_t fRev) {
                  vbucket,
                  fRev,
                  fname);
+    fileRemoved(vbucket);
 
     if (remove(fname.c_str()) == -1) {
         logger.warn(
@@ -3071,6 +3733,42 @@ void CouchKVStore::unlinkCouchFile(Vbid vbucket, uint64_t fRev) {
     }
 }
 
+size_t CouchKVStore::truncateVBucketFile(Vbid vbucket,
+                                         uint64_t fileRev,
+                                         size_t bytes) {
+    if (isReadOnly()) {
+        throw std::logic_error(
+                "CouchKVStore::truncateVBucketFile: Not valid on a read-only "
+                "object.");
+    }
+
+    auto fname = getDBFileName(dbname, vbucket, fileRev);
+    cb::io::sanitizePath(fname);
+
+    struct stat st;
+    if (bytes == 0 || stat(fname.c_str(), &st) == -1) {
+        return 0;
+    }
+    const auto size = size_t(st.st_size);
+    if (size <= bytes) {
+        // The remainder is released by the unlink
+        return 0;
+    }
+
+    const auto newSize = size - bytes;
+    if (truncate(fname.c_str(), off_t(newSize)) == -1) {
+        logger.warn(
+                "CouchKVStore::truncateVBucketFile: truncate error:{}, {}, "
+                "rev:{}, fname:{}",
+                errno,
+                vbucket,
+                fileRev,
+                fname);
+        return 0;
+    }
+    return newSize;
+}
+
 void CouchKVStore::removeCompactFile(const std::string& dbname, Vbid vbid) {
     std::string dbfile =
             getDBFileName(dbname, vbid, (*dbFileRevMap)[vbid.get()]);
@@ -3197,6 +3895,71 @@ couchstore_error_t CouchKVStore::writeLocalDoc(Db& db,
     return errCode;
 }
 
+couchstore_error_t CouchKVStore::writeBloomFilter(
+        Db& db, uint64_t highSeqno, cb::const_char_buffer filter) {
+    std::string value(reinterpret_cast<const char*>(&highSeqno),
+                      sizeof(highSeqno));
+    value.append(filter.data(), filter.size());
+    return writeLocalDoc(db, bloomFilterName, value);
+}
+
+bool CouchKVStore::persistBloomFilter(Vbid vbid,
+                                      uint64_t highSeqno,
+                                      cb::const_char_buffer filter) {
+    if (isReadOnly()) {
+        throw std::logic_error(
+                "CouchKVStore::persistBloomFilter: Not valid on a read-only "
+                "object.");
+    }
+
+    DbHolder db(*this);
+    auto errCode = openDB(vbid, db, 0);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        return false;
+    }
+    errCode = writeBloomFilter(*db.getDb(), highSeqno, filter);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        return false;
+    }
+    errCode = couchstore_commit(db.getDb());
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.warn(
+                "CouchKVStore::persistBloomFilter: couchstore_commit "
+                "error:{} [{}], {}",
+                couchstore_strerror(errCode),
+                couchkvstore_strerrno(db, errCode),
+                vbid);
+        return false;
+    }
+    return true;
+}
+
+std::pair<uint64_t, std::string> CouchKVStore::getPersistedBloomFilter(
+        Vbid vbid) {
+    DbHolder db(*this);
+    if (openReadHandle(vbid, db) != COUCHSTORE_SUCCESS) {
+        return {0, {}};
+    }
+
+    auto doc = readLocalDoc(*db.getDb(), bloomFilterName);
+    if (!doc.getLocalDoc()) {
+        return {0, {}};
+    }
+    const auto buffer = doc.getBuffer();
+    uint64_t highSeqno;
+    if (buffer.size() < sizeof(highSeqno)) {
+        logger.warn(
+                "CouchKVStore::getPersistedBloomFilter: {} invalid size:{}",
+                vbid,
+                buffer.size());
+        return {0, {}};
+    }
+    std::memcpy(&highSeqno, buffer.data(), sizeof(highSeqno));
+    return {highSeqno,
+            {reinterpret_cast<const char*>(buffer.data()) + sizeof(highSeqno),
+             buffer.size() - sizeof(highSeqno)}};
+}
+
 couchstore_error_t CouchKVStore::deleteLocalDoc(Db& db,
                                                 const std::string& name) {
     LocalDoc lDoc{};
@@ -3221,7 +3984,7 @@ couchstore_error_t CouchKVStore::deleteLocalDoc(Db& db,
 Collections::KVStore::Manifest CouchKVStore::getCollectionsManifest(Vbid vbid) {
     DbHolder db(*this);
 
-    couchstore_error_t errCode = openDB(vbid, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openReadHandle(vbid, db);
     if (errCode != COUCHSTORE_SUCCESS) {
         // openDB would of logged any critical error
         return Collections::KVStore::Manifest{
@@ -3247,7 +4010,7 @@ std::vector<Collections::KVStore::DroppedCollection>
 CouchKVStore::getDroppedCollections(Vbid vbid) {
     DbHolder db(*this);
 
-    couchstore_error_t errCode = openDB(vbid, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openReadHandle(vbid, db);
     if (errCode != COUCHSTORE_SUCCESS) {
         return {};
     }
@@ -3266,6 +4029,95 @@ CouchKVStore::getDroppedCollections(Db& db) {
     return Collections::KVStore::decodeDroppedCollections(dropped.getBuffer());
 }
 
+bool CouchKVStore::eraseEmptyDroppedCollections(Vbid vbid) {
+    if (isReadOnly()) {
+        throw std::logic_error(
+                "CouchKVStore::eraseEmptyDroppedCollections: Not valid on a "
+                "read-only object.");
+    }
+
+    DbHolder db(*this);
+    auto errCode = openDB(vbid, db, 0);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        return false;
+    }
+
+    const auto dropped = getDroppedCollections(*db.getDb());
+    for (const auto& collection : dropped) {
+        if (hasCollectionDocuments(*db.getDb(), collection.collectionId)) {
+            return false;
+        }
+    }
+
+    if (!dropped.empty()) {
+        errCode = deleteLocalDoc(*db.getDb(),
+                                 Collections::droppedCollectionsName);
+        if (errCode != COUCHSTORE_SUCCESS) {
+            return false;
+        }
+        errCode = couchstore_commit(db.getDb());
+        if (errCode != COUCHSTORE_SUCCESS) {
+            logger.warn(
+                    "CouchKVStore::eraseEmptyDroppedCollections: "
+                    "couchstore_commit error:{} [{}], {}",
+                    couchstore_strerror(errCode),
+                    couchkvstore_strerrno(db.getDb(), errCode),
+                    vbid);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CouchKVStore::hasCollectionDocuments(Db& db, CollectionID cid) {
+    // Committed keys are prefixed by the collection-ID; prepared keys by the
+    // DurabilityPrepare namespace and then the collection-ID.
+    const auto prefix = Collections::makeCollectionIdIntoString(cid);
+    const std::array<std::string, 2> prefixes = {
+            {prefix,
+             Collections::makeCollectionIdIntoString(
+                     CollectionID(CollectionID::DurabilityPrepare,
+                                  CollectionID::SkipIDVerificationTag{})) +
+                     prefix}};
+
+    struct ProbeState {
+        const std::string& prefix;
+        bool found;
+    };
+
+    // Only the first document at or after the prefix is of interest.
+    auto callback = [](Db*, DocInfo* docinfo, void* ctx) -> int {
+        auto& state = *reinterpret_cast<ProbeState*>(ctx);
+        state.found =
+                docinfo->id.size >= state.prefix.size() &&
+                std::equal(state.prefix.begin(),
+                           state.prefix.end(),
+                           reinterpret_cast<const char*>(docinfo->id.buf));
+        return COUCHSTORE_ERROR_CANCEL;
+    };
+
+    for (const auto& start : prefixes) {
+        // Keys are at most 250 bytes, so any key with the prefix sorts
+        // below the prefix followed by that many 0xff bytes.
+        const std::string end = start + std::string(250, '\xff');
+        const std::array<sized_buf, 2> range = {
+                {{const_cast<char*>(start.data()), start.size()},
+                 {const_cast<char*>(end.data()), end.size()}}};
+        ProbeState state{start, false};
+        auto errCode = couchstore_docinfos_by_id(
+                &db, range.data(), range.size(), RANGES, callback, &state);
+        if (errCode != COUCHSTORE_SUCCESS &&
+            errCode != COUCHSTORE_ERROR_CANCEL) {
+            // Can't tell, so assume there is data to purge.
+            return true;
+        }
+        if (state.found) {
+            return true;
+        }
+    }
+    return false;
+}
+
 size_t CouchKVStore::getDroppedCollectionCount(Db& db) {
     auto dropped = readLocalDoc(db, Collections::droppedCollectionsName);
 
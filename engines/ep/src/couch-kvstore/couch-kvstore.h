@@ -18,6 +18,7 @@
 
 #include "atomicqueue.h"
 #include "configuration.h"
+#include "couch-kvstore/couch-block-cache.h"
 #include "couch-kvstore/couch-fs-stats.h"
 #include "couch-kvstore/couch-kvstore-metadata.h"
 #include "kvstore.h"
@@ -30,8 +31,12 @@
 #include <relaxed_atomic.h>
 
 #include <engines/ep/src/vbucket_state.h>
+#include <array>
+#include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -53,6 +58,8 @@ public:
      */
     CouchRequest(const Item& it, MutationRequestCallback cb);
 
+    CouchRequest(CouchRequest&&) = default;
+
     ~CouchRequest();
 
     /**
@@ -62,21 +69,14 @@ public:
      *         or nullptr if the its a deleted item and doesn't have
      *         a value.
      */
-    Doc* getDbDoc() {
-        if (isDelete() && value.get() == nullptr) {
-            return nullptr;
-        }
-        return &dbDoc;
-    }
+    Doc* getDbDoc();
 
     /**
      * Get the couchstore DocInfo instance of a document to be persisted
      *
      * @return pointer to the couchstore DocInfo instance of a document
      */
-    DocInfo *getDbDocInfo(void) {
-        return &dbDocInfo;
-    }
+    DocInfo* getDbDocInfo();
 
 protected:
     static couchstore_content_meta_flags getContentMeta(const Item& it);
@@ -226,6 +226,10 @@ public:
      */
     void delVBucket(Vbid vbucket, uint64_t fileRev) override;
 
+    size_t truncateVBucketFile(Vbid vbucket,
+                               uint64_t fileRev,
+                               size_t bytes) override;
+
     /**
      * Retrieve the list of persisted vbucket states
      *
@@ -324,6 +328,25 @@ public:
 
     bool getStat(const char* name, size_t& value) override;
 
+    /**
+     * @return true if discarding rollbackSeqCount of the file's totSeqCount
+     *         updates is too many to roll back (rather than reset) for.
+     */
+    static bool isRollbackTooLarge(uint64_t totSeqCount,
+                                   uint64_t rollbackSeqCount);
+
+    /**
+     * Look up the keys of a batch of updates discarded by a rollback in the
+     * Rollback header with a single walk of its by-id tree, then invoke
+     * cb.discardedUpdate() for each of them.
+     *
+     * @return false if the lookup failed or cb ran out of memory
+     */
+    bool rollbackDiscardedUpdates(Db* rollbackDb,
+                                  Vbid vbid,
+                                  std::vector<GetValue>& discarded,
+                                  RollbackCB& cb);
+
     static int recordDbDump(Db *db, DocInfo *docinfo, void *ctx);
     static int recordDbStat(Db *db, DocInfo *docinfo, void *ctx);
     static int getMultiCb(Db *db, DocInfo *docinfo, void *ctx);
@@ -333,6 +356,15 @@ public:
                                 GetValue& docValue,
                                 Vbid vbId,
                                 GetMetaOnly metaOnly);
+
+    /**
+     * Fetch the document of a getMulti() batch described by docinfo, and
+     * hand the result to every request waiting on it.
+     */
+    void completeGetMultiFetch(Db* db,
+                               DocInfo& docinfo,
+                               vb_bgfetch_item_ctx_t& bg_itm_ctx,
+                               Vbid vbId);
     ENGINE_ERROR_CODE couchErr2EngineErr(couchstore_error_t errCode);
 
     uint64_t getLastPersistedSeqno(Vbid vbid);
@@ -344,7 +376,7 @@ public:
             Vbid vbid,
             const DiskDocKey& start_key,
             uint32_t count,
-            std::shared_ptr<Callback<const DiskDocKey&>> cb) override;
+            std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) override;
 
     ScanContext* initScanContext(
             std::shared_ptr<StatusCallback<GetValue>> cb,
@@ -354,6 +386,12 @@ public:
             DocumentFilter options,
             ValueFilter valOptions) override;
 
+    /**
+     * If the ScanContext names a collection, CouchKVStore reads the
+     * collection's keys (and prepares, and its system event) from the by-id
+     * tree rather than every document in the seqno range, then returns them
+     * in seqno order.
+     */
     scan_error_t scan(ScanContext* sctx) override;
 
     void destroyScanContext(ScanContext* ctx) override;
@@ -391,6 +429,24 @@ public:
     std::vector<Collections::KVStore::DroppedCollection> getDroppedCollections(
             Vbid vbid) override;
 
+    /**
+     * CouchKVStore probes the by-id tree for each dropped collection's keys
+     * (committed and prepared); if there are none the dropped list is removed
+     * in place, avoiding the rewrite of the whole file by a compaction.
+     */
+    bool eraseEmptyDroppedCollections(Vbid vbid) override;
+
+    /**
+     * CouchKVStore persists the filter as a _local document, prefixed by the
+     * high seqno it is valid for.
+     */
+    bool persistBloomFilter(Vbid vbid,
+                            uint64_t highSeqno,
+                            cb::const_char_buffer filter) override;
+
+    std::pair<uint64_t, std::string> getPersistedBloomFilter(
+            Vbid vbid) override;
+
 protected:
     /**
      * Internal RAII class for managing a Db* and having it closed when
@@ -436,10 +492,35 @@ protected:
             return fileRev;
         }
 
+        /// Record which vBucket's file is open, and whether for writing.
+        void setOpenedFor(Vbid vb, bool write) {
+            vbid = vb;
+            writable = write;
+        }
+
+        /**
+         * Mark the handle as a cached read handle (see openReadHandle),
+         * current as of the given file generation, so that it's returned to
+         * the cache when closed.
+         */
+        void setReadHandleGeneration(uint64_t gen) {
+            cachedReadHandle = true;
+            generation = gen;
+        }
+
         // Allow a non-RAII close, needed for some use-cases
         void close() {
-            if (db) {
+            if (!db) {
+                return;
+            }
+            if (cachedReadHandle) {
+                kvstore.returnReadHandle(vbid, fileRev, generation, releaseDb());
+            } else {
                 kvstore.closeDatabaseHandle(releaseDb());
+                if (writable) {
+                    // Anything committed is now visible to new handles.
+                    kvstore.fileHeadersChanged(vbid);
+                }
             }
         }
 
@@ -449,6 +530,10 @@ protected:
         CouchKVStore& kvstore;
         Db* db;
         uint64_t fileRev;
+        Vbid vbid{0};
+        bool writable = false;
+        bool cachedReadHandle = false;
+        uint64_t generation = 0;
     };
 
     /**
@@ -498,12 +583,13 @@ protected:
     /**
      * Container for pending couchstore requests.
      *
-     * Using deque as (a) it doesn't move (and hence invalidate) any existing
-     * elements, which is relied on as CouchRequest has pointers to it's own
-     * data, and (b) as the expansion behviour is less aggressive compared to
-     * std::vector (CouchRequest objects are ~256 bytes in size).
+     * A vector, so the requests of a flush batch are stored contiguously and
+     * the storage can be kept for the next batch (see commit2couchstore());
+     * in steady state queueing a request makes no allocation. CouchRequest
+     * re-points its Doc / DocInfo at its own data when they are accessed,
+     * so the requests may be moved as the vector grows.
      */
-    using PendingRequestQueue = std::deque<CouchRequest>;
+    using PendingRequestQueue = std::vector<CouchRequest>;
 
     /*
      * Returns the DbInfo for the given vbucket database.
@@ -535,6 +621,37 @@ protected:
                               couchstore_open_flags options,
                               FileOpsInterface* ops = nullptr);
 
+    /**
+     * Open the vBucket's file read-only, reusing the handle cached by an
+     * earlier read if nothing has been committed to the file since (and
+     * 'couchstore_cache_read_handles' is enabled). The handle goes back to
+     * the cache when the DbHolder closes it; so it must not be kept beyond
+     * the operation (as scans do).
+     */
+    couchstore_error_t openReadHandle(Vbid vbucketId, DbHolder& db);
+
+    /// Return a handle opened by openReadHandle to the cache (or close it).
+    void returnReadHandle(Vbid vbucketId,
+                          uint64_t fileRev,
+                          uint64_t generation,
+                          Db* db);
+
+    /**
+     * Note that new headers may have been committed to the vBucket's file,
+     * so read handles opened before now are stale.
+     */
+    void fileHeadersChanged(Vbid vbucketId);
+
+    /**
+     * Note that the vBucket's file is being removed; stale read handles of
+     * all vBuckets are closed by the next openReadHandle, rather than pinning
+     * removed files.
+     */
+    void fileRemoved(Vbid vbucketId);
+
+    /// Close all the cached read handles.
+    void closeReadHandles();
+
     couchstore_error_t openSpecificDB(Vbid vbucketId,
                                       uint64_t rev,
                                       DbHolder& db,
@@ -557,23 +674,31 @@ protected:
                                 std::vector<DocInfo*>& docinfos,
                                 kvstats_ctx& kvctx);
 
+    /// Queue a set / delete request for the current transaction
+    void addPendingRequest(const Item& itm, MutationRequestCallback cb);
+
     void commitCallback(PendingRequestQueue& committedReqs,
                         kvstats_ctx& kvctx,
                         couchstore_error_t errCode);
     couchstore_error_t saveVBState(Db *db, const vbucket_state &vbState);
 
     /**
-     * Save stats for collection cid into the file referenced by db
+     * Save the stats of the collections changed by a flush into the file
+     * referenced by db. All of the vBucket's collection stats are kept in a
+     * single local doc, which is merged with the changes (and has any
+     * collections being dropped removed) and only rewritten if it changed.
      * @param db The Db to write to
-     * @param cid The collection to update
-     * @param stats The stats that should be persisted
+     * @param stats The stats of the changed collections
+     * @return the size of the stats doc written (0 if it was unchanged)
      */
-    size_t saveCollectionStats(Db& db,
-                               CollectionID cid,
-                               Collections::VB::PersistedStats stats);
+    size_t saveCollectionStats(
+            Db& db,
+            const std::unordered_map<CollectionID,
+                                     Collections::VB::PersistedStats>& stats);
 
     /**
-     * Delete the count for collection cid
+     * Delete the count for collection cid, as written by versions which
+     * stored a local doc per collection
      * @param db The Db to write to
      * @param cid The collection to delete
      */
@@ -618,6 +743,11 @@ protected:
      */
     couchstore_error_t deleteLocalDoc(Db& db, const std::string& name);
 
+    /// Write the bloom filter _local document (without committing).
+    couchstore_error_t writeBloomFilter(Db& db,
+                                        uint64_t highSeqno,
+                                        cb::const_char_buffer filter);
+
     /**
      * Sync the KVStore::collectionsMeta structures to the database.
      *
@@ -692,6 +822,15 @@ protected:
      */
     size_t getDroppedCollectionCount(Db& db);
 
+    /// scan() for a ScanContext which names a collection
+    scan_error_t scanCollection(Db* db, ScanContext& ctx);
+
+    /**
+     * @return true if the by-id tree has any document (alive, deleted or
+     *         prepared) with a key in the given collection
+     */
+    bool hasCollectionDocuments(Db& db, CollectionID cid);
+
     void setDocsCommitted(uint16_t docs);
     void closeDatabaseHandle(Db *db);
 
@@ -776,6 +915,40 @@ protected:
      */
     std::shared_ptr<RevisionMap> dbFileRevMap;
 
+    /**
+     * Counts of the changes made to the vBucket files, telling cached read
+     * handles when they're stale. Shared (like the RevisionMap) by a RW
+     * store, which makes the changes, and its RO store.
+     */
+    struct FileGenerations {
+        explicit FileGenerations(size_t vbuckets) : headers(vbuckets) {
+        }
+
+        /// Per-vBucket, bumped after each commit to (or removal of) the file
+        std::vector<std::atomic<uint64_t>> headers;
+        /// Bumped by each file removal
+        std::atomic<uint64_t> removals{0};
+    };
+
+    std::shared_ptr<FileGenerations> fileGenerations;
+
+    /// A read-only handle kept open between reads.
+    struct CachedReadHandle {
+        Db* db = nullptr;
+        uint64_t fileRev = 0;
+        /// FileGenerations::headers of the vBucket when the handle was opened
+        uint64_t generation = 0;
+    };
+
+    /// Cached read handle of each vBucket; guarded by readHandlesMutex.
+    std::vector<CachedReadHandle> readHandles;
+    /// FileGenerations::removals when readHandles was last checked for stale
+    /// handles; guarded by readHandlesMutex.
+    uint64_t readHandlesCheckedAt = 0;
+    std::mutex readHandlesMutex;
+    cb::RelaxedAtomic<size_t> readHandleHits;
+    cb::RelaxedAtomic<size_t> readHandleMisses;
+
     /**
      * An internal rwlock used to keep openDB and compaction in sync
      * Primarily that compaction and scans can be ran concurrently, we must
@@ -787,6 +960,8 @@ protected:
 
     uint16_t numDbFiles;
     PendingRequestQueue pendingReqsQ;
+    // Number of times pendingReqsQ had to grow in the current transaction
+    size_t pendingReqsAllocs = 0;
     bool intransaction;
     std::unique_ptr<TransactionContext> transactionCtx;
 
@@ -806,6 +981,25 @@ protected:
      */
     std::unique_ptr<FileOpsInterface> statCollectingFileOpsCompaction;
 
+    /**
+     * Cache of the blocks read from (non-compaction) couchstore files; shared
+     * with the read-only store. Null if 'couchstore_block_cache_size' is 0.
+     */
+    std::shared_ptr<CouchBlockCache> blockCache;
+
+    /**
+     * FileOpsInterface implementation serving reads from blockCache, wrapping
+     * statCollectingFileOps (so the fs stats only count real reads).
+     */
+    std::unique_ptr<FileOpsInterface> blockCacheOps;
+
+    /**
+     * FileOpsInterface implementation dropping the flushed data from the page
+     * cache once synced, wrapping blockCacheOps (or statCollectingFileOps).
+     * Null unless 'couchstore_drop_written_pages' is "all".
+     */
+    std::unique_ptr<FileOpsInterface> dropCacheOps;
+
     /* deleted docs in each file, indexed by vBucket. RelaxedAtomic
        to allow stats access witout lock */
     std::vector<cb::RelaxedAtomic<size_t>> cachedDeleteCount;
@@ -816,7 +1010,50 @@ protected:
 
     std::atomic<size_t> scanCounter; //atomic counter for generating scan id
     std::map<size_t, Db*> scans; //map holding active scans
-    std::mutex scanLock; //lock guarding the scan map
+
+    /**
+     * A document found by a collection scan; holds a deep copy of the
+     * DocInfo (which couchstore frees once the callback returns).
+     */
+    struct CollectionScanDoc {
+        explicit CollectionScanDoc(const DocInfo& docinfo)
+            : info(docinfo),
+              id(docinfo.id.buf, docinfo.id.size),
+              meta(docinfo.rev_meta.buf, docinfo.rev_meta.size) {
+        }
+
+        /// @return the DocInfo, pointing at our copies of its buffers.
+        DocInfo& getDocInfo() {
+            info.id = {&id[0], id.size()};
+            info.rev_meta = {&meta[0], meta.size()};
+            return info;
+        }
+
+        DocInfo info;
+        std::string id;
+        std::string meta;
+    };
+
+    /// The documents (in seqno order) a collection scan is yet to return.
+    struct CollectionScan {
+        bool loaded = false;
+        std::deque<CollectionScanDoc> docs;
+        /// Key order scans: the key range being read...
+        size_t range = 0;
+        /// ... and the key to resume it from (empty for its start)
+        std::string resumeKey;
+    };
+
+    /// Collection scans (ScanContext::collection set), by scan id
+    std::unordered_map<size_t, CollectionScan> collectionScans;
+
+    /// scanCollection() for a ScanContext which allows key order
+    scan_error_t scanCollectionByKey(
+            Db* db,
+            ScanContext& ctx,
+            CollectionScan& scan,
+            const std::array<std::pair<std::string, std::string>, 3>& ranges);
+    std::mutex scanLock; //lock guarding the scan maps
 
     BucketLogger& logger;
 
@@ -836,11 +1073,17 @@ private:
      * @param readOnly true if the store can only do read functionality
      * @param dbFileRevMap a revisionMap to use (which should be data owned by
      *        the RW store).
+     * @param blockCache the block cache to use (owned with the RW store), or
+     *        null for none.
+     * @param fileGenerations the file generations to use (owned with the RW
+     *        store).
      */
     CouchKVStore(KVStoreConfig& config,
                  FileOpsInterface& ops,
                  bool readOnly,
-                 std::shared_ptr<RevisionMap> dbFileRevMap);
+                 std::shared_ptr<RevisionMap> dbFileRevMap,
+                 std::shared_ptr<CouchBlockCache> blockCache,
+                 std::shared_ptr<FileGenerations> fileGenerations);
 
     /**
      * Construct a read-only store - private as should be called via
@@ -849,9 +1092,13 @@ private:
      * @param config configuration data for the store
      * @param dbFileRevMap The revisionMap to use (which should be intially
      * created owned by the RW store).
+     * @param blockCache The block cache of the RW store (may be null).
+     * @param fileGenerations The file generations of the RW store.
      */
     CouchKVStore(KVStoreConfig& config,
-                 std::shared_ptr<RevisionMap> dbFileRevMap);
+                 std::shared_ptr<RevisionMap> dbFileRevMap,
+                 std::shared_ptr<CouchBlockCache> blockCache,
+                 std::shared_ptr<FileGenerations> fileGenerations);
 
 
     class CouchKVFileHandle : public ::KVFileHandle {
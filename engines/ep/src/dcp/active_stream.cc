@@ -19,6 +19,7 @@
 
 #include "checkpoint.h"
 #include "checkpoint_manager.h"
+#include "dcp/dcpconnmap.h"
 #include "dcp/producer.h"
 #include "dcp/response.h"
 #include "ep_time.h"
@@ -82,8 +83,10 @@ ActiveStream::ActiveStream(EventuallyPersistentEngine* e,
                                     ? ForceValueCompression::Yes
                                     : ForceValueCompression::No),
       syncReplication(p->getSyncReplSupport()),
+      outOfOrderSnapshots(p->isOutOfOrderSnapshotsEnabled()),
       filter(std::move(f)),
-      sid(filter.getStreamId()) {
+      sid(filter.getStreamId()),
+      singleCollection(filter.getSingleCollection()) {
     const char* type = "";
     if (flags_ & DCP_ADD_STREAM_FLAG_TAKEOVER) {
         type = "takeover ";
@@ -250,7 +253,8 @@ void ActiveStream::registerCursor(CheckpointManager& chkptmgr,
 void ActiveStream::markDiskSnapshot(
         uint64_t startSeqno,
         uint64_t endSeqno,
-        boost::optional<uint64_t> highCompletedSeqno) {
+        boost::optional<uint64_t> highCompletedSeqno,
+        bool outOfSeqnoOrder) {
     {
         LockHolder lh(streamMutex);
         uint64_t chkCursorSeqno = endSeqno;
@@ -308,19 +312,24 @@ void ActiveStream::markDiskSnapshot(
         auto hcsToSend = sendHCS ? highCompletedSeqno : boost::none;
         log(spdlog::level::level_enum::info,
             "{} Sending disk snapshot with start seqno {}, end seqno {}, and"
-            " high completed seqno {}",
+            " high completed seqno {}{}",
             logPrefix,
             startSeqno,
             endSeqno,
-            hcsToSend);
-        pushToReadyQ(std::make_unique<SnapshotMarker>(
-                opaque_,
-                vb_,
-                startSeqno,
-                endSeqno,
-                MARKER_FLAG_DISK | MARKER_FLAG_CHK,
-                hcsToSend,
-                sid));
+            hcsToSend,
+            outOfSeqnoOrder ? " (in key order)" : "");
+        uint32_t markerFlags = MARKER_FLAG_DISK | MARKER_FLAG_CHK;
+        if (outOfSeqnoOrder) {
+            markerFlags |= MARKER_FLAG_OSO;
+            outOfOrderSnapshot = true;
+        }
+        pushToReadyQ(std::make_unique<SnapshotMarker>(opaque_,
+                                                      vb_,
+                                                      startSeqno,
+                                                      endSeqno,
+                                                      markerFlags,
+                                                      hcsToSend,
+                                                      sid));
         lastSentSnapEndSeqno.store(endSeqno, std::memory_order_relaxed);
 
         if (!(flags_ & DCP_ADD_STREAM_FLAG_DISKONLY)) {
@@ -363,7 +372,10 @@ bool ActiveStream::backfillReceived(std::unique_ptr<Item> itm,
 
         bufferedBackfill.bytes.fetch_add(resp->getApproximateSize());
         bufferedBackfill.items++;
-        lastReadSeqno.store(uint64_t(*resp->getBySeqno()));
+        const auto seqno = uint64_t(*resp->getBySeqno());
+        if (!outOfOrderSnapshot || seqno > lastReadSeqno.load()) {
+            lastReadSeqno.store(seqno);
+        }
 
         pushToReadyQ(std::move(resp));
 
@@ -383,6 +395,16 @@ bool ActiveStream::backfillReceived(std::unique_ptr<Item> itm,
 void ActiveStream::completeBackfill() {
     {
         LockHolder lh(streamMutex);
+        if (isBackfilling() && outOfOrderSnapshot) {
+            // The items were sent in key order; tell the client the snapshot
+            // is complete (and the stream has advanced to its end).
+            const uint64_t snapEnd = lastSentSnapEndSeqno.load();
+            pushToReadyQ(
+                    std::make_unique<SeqnoAdvanced>(opaque_, vb_, snapEnd, sid));
+            if (snapEnd > lastReadSeqno.load()) {
+                lastReadSeqno.store(snapEnd);
+            }
+        }
         if (isBackfilling()) {
             log(spdlog::level::level_enum::info,
                 "{} Backfill complete, {}"
@@ -818,7 +840,10 @@ std::unique_ptr<DcpResponse> ActiveStream::nextQueuedItem() {
         }
         if (producer->bufferLogInsert(response->getMessageSize())) {
             auto seqno = response->getBySeqno();
-            if (seqno) {
+            if (response->getEvent() == DcpResponse::Event::SeqnoAdvanced) {
+                outOfOrderSnapshot = false;
+            }
+            if (seqno && (!outOfOrderSnapshot || *seqno > lastSentSeqno)) {
                 lastSentSeqno.store(*seqno);
 
                 if (isBackfilling()) {
@@ -1023,7 +1048,11 @@ std::unique_ptr<DcpResponse> ActiveStream::makeResponseFromItem(
             if (isSnappyEnabled()) {
                 if (isForceValueCompressionEnabled()) {
                     if (!mcbp::datatype::is_snappy(finalItem->getDataType())) {
-                        if (!finalItem->compressValue()) {
+                        // Values which barely compress (e.g. small documents)
+                        // are sent as is, saving the consumer inflating them.
+                        const auto maxRatio = engine->getDcpConnMap()
+                                                      .getMinCompressionRatio();
+                        if (!finalItem->compressValue(false, maxRatio)) {
                             log(spdlog::level::level_enum::warn,
                                 "{} Failed to snappy compress an uncompressed "
                                 "value",
@@ -1366,7 +1395,16 @@ void ActiveStream::scheduleBackfill_UNLOCKED(bool reschedule) {
     uint64_t backfillEnd = 0;
     bool tryBackfill = false;
 
-    if ((flags_ & DCP_ADD_STREAM_FLAG_DISKONLY) || reschedule) {
+    // When rescheduling after the cursor was dropped, the stream may resume
+    // from exactly where it had read up to: re-register the cursor there (as
+    // for a new stream) so only the items no longer in the checkpoints are
+    // backfilled, instead of everything up to the last persisted seqno.
+    const bool resumeFromMemory =
+            reschedule && !(flags_ & DCP_ADD_STREAM_FLAG_DISKONLY) &&
+            engine->getConfiguration().isCursorDroppingResumeFromMemory();
+
+    if ((flags_ & DCP_ADD_STREAM_FLAG_DISKONLY) ||
+        (reschedule && !resumeFromMemory)) {
         uint64_t vbHighSeqno = static_cast<uint64_t>(vbucket->getHighSeqno());
         if (lastReadSeqno.load() > vbHighSeqno) {
             throw std::logic_error(logPrefix +
@@ -1455,7 +1493,7 @@ void ActiveStream::scheduleBackfill_UNLOCKED(bool reschedule) {
         /// completes the scan phase - reset backfillRemaining counter.
         backfillRemaining.reset();
     } else {
-        if (reschedule) {
+        if (reschedule && !resumeFromMemory) {
             // Infrequent code path, see comment below.
             log(spdlog::level::level_enum::info,
                 "{} Did not schedule "
@@ -152,9 +152,17 @@ public:
     /// (unknown) value.
     void clearBackfillRemaining();
 
+    /**
+     * Queue the snapshot marker of a backfill.
+     *
+     * @param outOfSeqnoOrder the backfill returns the items in key order; the
+     *        snapshot is then ended by a SeqnoAdvanced message when the
+     *        backfill completes
+     */
     void markDiskSnapshot(uint64_t startSeqno,
                           uint64_t endSeqno,
-                          boost::optional<uint64_t> highCompletedSeqno);
+                          boost::optional<uint64_t> highCompletedSeqno,
+                          bool outOfSeqnoOrder);
 
     bool backfillReceived(std::unique_ptr<Item> itm,
                           backfill_source_t backfill_source,
@@ -221,6 +229,16 @@ public:
         return cursor;
     }
 
+    /// @return the collection, if this stream only streams one collection
+    boost::optional<CollectionID> getSingleCollection() const {
+        return singleCollection;
+    }
+
+    /// @return true if the client accepts disk snapshots in key order
+    bool isOutOfOrderSnapshotsEnabled() const {
+        return outOfOrderSnapshots;
+    }
+
     std::string getStreamTypeName() const override;
 
     std::string getStateName() const override;
@@ -389,6 +407,10 @@ private:
      *                       finished backfilling once and still in
      *                       STREAM_BACKFILLING state or in STREAM_IN_MEMORY
      *                       state.
+     *                       If cursor_dropping_resume_from_memory is set
+     *                       the cursor is re-registered at lastReadSeqno, and
+     *                       only the seqnos no longer in the checkpoints are
+     *                       backfilled.
      * Note: Expects the streamMutex to be acquired when called
      */
     void scheduleBackfill_UNLOCKED(bool reschedule);
@@ -462,6 +484,13 @@ private:
     // @TODO - update to be part of the state machine.
     bool firstMarkerSent;
 
+    /**
+     * Set while the items of an out of sequence order disk snapshot are being
+     * queued and sent (until its SeqnoAdvanced is sent); lastReadSeqno and
+     * lastSentSeqno then only track the highest seqno seen.
+     */
+    bool outOfOrderSnapshot = false;
+
     /**
      * Indicates if the stream is currently waiting for a snapshot to be
      * acknowledged by the peer. Incremented when forming SnapshotMarkers in
@@ -526,6 +555,9 @@ private:
      */
     const SyncReplication syncReplication;
 
+    /// Does the client accept disk snapshots in key order?
+    const bool outOfOrderSnapshots;
+
     /**
      * The filter the stream will use to decide which keys should be transmitted
      */
@@ -538,6 +570,10 @@ protected:
      */
     const cb::mcbp::DcpStreamId sid;
 
+    /// The filter's single collection, fixed at creation (the filter itself
+    /// changes as collections are dropped).
+    const boost::optional<CollectionID> singleCollection;
+
 private:
     /**
      * A prefix to use in all stream log messages
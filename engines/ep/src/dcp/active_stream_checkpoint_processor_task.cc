@@ -22,13 +22,19 @@
 #include "executorpool.h"
 #include "statwriter.h"
 #include <phosphor/phosphor.h>
+#include <chrono>
 #include <climits>
 
 ActiveStreamCheckpointProcessorTask::ActiveStreamCheckpointProcessorTask(
-        EventuallyPersistentEngine& e, std::shared_ptr<DcpProducer> p)
+        EventuallyPersistentEngine& e,
+        std::shared_ptr<DcpProducer> p,
+        size_t shard)
     : GlobalTask(
               &e, TaskId::ActiveStreamCheckpointProcessorTask, INT_MAX, false),
-      description("Process checkpoint(s) for DCP producer " + p->getName()),
+      description("Process checkpoint(s) for DCP producer " + p->getName() +
+                  (shard ? " (shard " + std::to_string(shard) + ")" : "")),
+      shard(shard),
+      queue(e.getConfiguration().getMaxVbuckets()),
       notified(false),
       iterationsBeforeYield(
               e.getConfiguration().getDcpProducerSnapshotMarkerYieldLimit()),
@@ -42,6 +48,8 @@ bool ActiveStreamCheckpointProcessorTask::run() {
         return false;
     }
 
+    const auto start = std::chrono::steady_clock::now();
+
     // Setup that we will sleep forever when done.
     snooze(INT_MAX);
 
@@ -51,17 +59,22 @@ bool ActiveStreamCheckpointProcessorTask::run() {
     size_t iterations = 0;
     do {
         auto streams = queuePop();
+        if (!streams && queueEmpty()) {
+            // Nothing left of our own, help a sibling which is behind.
+            streams = steal();
+        }
 
         if (streams) {
             for (auto rh = streams->rlock(); !rh.end(); rh.next()) {
                 ActiveStream* as = static_cast<ActiveStream*>(rh.get().get());
                 as->nextCheckpointItemTask();
             }
+            ++streamsProcessed;
         } else {
             break;
         }
         iterations++;
-    } while (!queueEmpty() && iterations < iterationsBeforeYield);
+    } while (iterations < iterationsBeforeYield);
 
     // Now check if we were re-notified or there are still checkpoints
     bool expected = true;
@@ -70,8 +83,14 @@ bool ActiveStreamCheckpointProcessorTask::run() {
         TRACE_EVENT0("ep-engine/task",
                      "ActiveStreamCheckpointProcessorTask::rerun");
         wakeUp();
+        if (!queueEmpty()) {
+            wakeIdleSiblings();
+        }
     }
 
+    runtimeUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
     return true;
 }
 
@@ -105,10 +124,20 @@ void ActiveStreamCheckpointProcessorTask::cancelTask() {
 void ActiveStreamCheckpointProcessorTask::addStats(const std::string& name,
                                                    const AddStatFn& add_stat,
                                                    const void* c) const {
-    auto prefix = name + ":ckpt_processor_queue_";
-    queue.addStats(prefix, add_stat, c);
-
-    add_casted_stat((prefix + "notified").c_str(), notified, add_stat, c);
+    auto prefix = name + ":ckpt_processor_";
+    if (shard) {
+        prefix += std::to_string(shard) + "_";
+    }
+    queue.addStats(prefix + "queue_", add_stat, c);
+
+    add_casted_stat((prefix + "queue_notified").c_str(), notified, add_stat, c);
+    add_casted_stat((prefix + "streams_processed").c_str(),
+                    streamsProcessed,
+                    add_stat,
+                    c);
+    add_casted_stat(
+            (prefix + "streams_stolen").c_str(), streamsStolen, add_stat, c);
+    add_casted_stat((prefix + "runtime_us").c_str(), runtimeUs, add_stat, c);
 }
 
 std::shared_ptr<StreamContainer<std::shared_ptr<Stream>>>
@@ -130,3 +159,53 @@ ActiveStreamCheckpointProcessorTask::queuePop() {
     }
     return nullptr;
 }
+
+std::shared_ptr<StreamContainer<std::shared_ptr<Stream>>>
+ActiveStreamCheckpointProcessorTask::steal() {
+    auto producer = producerPtr.lock();
+    if (!producer) {
+        return nullptr;
+    }
+
+    ActiveStreamCheckpointProcessorTask* victim = nullptr;
+    size_t deepest = 0;
+    for (const auto& task : producer->getCheckpointProcessorTasks()) {
+        auto* sibling =
+                static_cast<ActiveStreamCheckpointProcessorTask*>(task.get());
+        if (sibling == this) {
+            continue;
+        }
+        const auto depth = sibling->queueSize();
+        if (depth > deepest) {
+            victim = sibling;
+            deepest = depth;
+        }
+    }
+
+    Vbid vbid = Vbid(0);
+    if (!victim || !victim->queue.popFront(vbid)) {
+        return nullptr;
+    }
+    TRACE_EVENT1("ep-engine/task",
+                 "ActiveStreamCheckpointProcessorTask::steal",
+                 "vbid",
+                 vbid.get());
+    ++streamsStolen;
+    return producer->findStreams(vbid);
+}
+
+void ActiveStreamCheckpointProcessorTask::wakeIdleSiblings() {
+    auto producer = producerPtr.lock();
+    if (!producer) {
+        return;
+    }
+    for (const auto& task : producer->getCheckpointProcessorTasks()) {
+        auto* sibling =
+                static_cast<ActiveStreamCheckpointProcessorTask*>(task.get());
+        bool expected = false;
+        if (sibling != this && sibling->queueEmpty() &&
+            sibling->notified.compare_exchange_strong(expected, true)) {
+            sibling->wakeup();
+        }
+    }
+}
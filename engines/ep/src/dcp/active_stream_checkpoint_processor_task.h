@@ -33,10 +33,23 @@ class Stream;
 template <class E>
 class StreamContainer;
 
+/**
+ * Moves items from the checkpoints of a DcpProducer's ActiveStreams to their
+ * readyQs.
+ *
+ * A producer may share its streams between several of these tasks (see
+ * dcp_producer_checkpoint_processor_tasks), so they can run on different
+ * NONIO threads. Each vBucket is scheduled on one task (its "shard"); a task
+ * which has emptied its own queue steals vBuckets from the sibling with the
+ * most queued. The same stream may therefore be processed by two tasks at
+ * once, but ActiveStream::nextCheckpointItemTask() holds the streamMutex
+ * while moving items, so the order of each stream's items is unchanged.
+ */
 class ActiveStreamCheckpointProcessorTask : public GlobalTask {
 public:
     ActiveStreamCheckpointProcessorTask(EventuallyPersistentEngine& e,
-                                        std::shared_ptr<DcpProducer> p);
+                                        std::shared_ptr<DcpProducer> p,
+                                        size_t shard = 0);
 
     std::string getDescription() {
         return description;
@@ -60,6 +73,11 @@ public:
         return queue.size();
     }
 
+    /// @return the number of vBuckets this task took from its siblings.
+    size_t getStreamsStolen() const {
+        return streamsStolen;
+    }
+
     /// Outputs statistics related to this task via the given callback.
     void addStats(const std::string& name,
                   const AddStatFn& add_stat,
@@ -68,6 +86,17 @@ public:
 private:
     std::shared_ptr<StreamContainer<std::shared_ptr<Stream>>> queuePop();
 
+    /**
+     * Take the next vBucket from the queue of the sibling task with the most
+     * vBuckets queued.
+     * @return the streams of that vBucket, or null if there is nothing to
+     *         steal.
+     */
+    std::shared_ptr<StreamContainer<std::shared_ptr<Stream>>> steal();
+
+    /// Wake the sibling tasks which are idle, so they can steal our work.
+    void wakeIdleSiblings();
+
     bool queueEmpty() {
         return queue.empty();
     }
@@ -75,6 +104,9 @@ private:
     /// Human-readable description of this task.
     const std::string description;
 
+    /// Index of this task among its producer's checkpoint processor tasks.
+    const size_t shard;
+
     /*
      * Maintain a queue of unique vbucket ids for which stream should be
      * processed.
@@ -93,4 +125,11 @@ private:
     const size_t iterationsBeforeYield;
 
     const std::weak_ptr<DcpProducer> producerPtr;
+
+    /// Number of vBuckets processed, and how many of those were stolen.
+    std::atomic<size_t> streamsProcessed{0};
+    std::atomic<size_t> streamsStolen{0};
+
+    /// Total time spent in run().
+    std::atomic<uint64_t> runtimeUs{0};
 };
@@ -29,6 +29,8 @@
 
 #include <phosphor/phosphor.h>
 
+#include <algorithm>
+
 static const size_t sleepTime = 1;
 
 class BackfillManagerTask : public GlobalTask {
@@ -97,13 +99,16 @@ std::chrono::microseconds BackfillManagerTask::maxExpectedDuration() {
 }
 
 BackfillManager::BackfillManager(EventuallyPersistentEngine& e)
-    : engine(e), managerTask(NULL) {
+    : engine(e),
+      managerTask(NULL),
+      scanSharing(e.getConfiguration().isDcpBackfillScanSharing()) {
     Configuration& config = e.getConfiguration();
 
     scanBuffer.bytesRead = 0;
     scanBuffer.itemsRead = 0;
     scanBuffer.maxBytes = config.getDcpScanByteLimit();
     scanBuffer.maxItems = config.getDcpScanItemLimit();
+    scanBuffer.numStreams = 1;
 
     buffer.bytesRead = 0;
     buffer.maxBytes = config.getDcpBackfillByteLimit();
@@ -159,6 +164,26 @@ void BackfillManager::schedule(VBucket& vb,
                                uint64_t start,
                                uint64_t end) {
     LockHolder lh(lock);
+    if (scanSharing) {
+        auto attach = [&stream, start, end](UniqueDCPBackfillPtr& backfill) {
+            return backfill->attach(stream, start, end);
+        };
+        if (std::any_of(activeBackfills.begin(),
+                        activeBackfills.end(),
+                        attach) ||
+            std::any_of(snoozingBackfills.begin(),
+                        snoozingBackfills.end(),
+                        [&attach](auto& snoozer) {
+                            return attach(snoozer.second);
+                        }) ||
+            std::any_of(pendingBackfills.begin(),
+                        pendingBackfills.end(),
+                        attach)) {
+            // The existing backfill's task is already scheduled.
+            return;
+        }
+    }
+
     UniqueDCPBackfillPtr backfill =
             vb.createDCPBackfill(engine, stream, start, end);
     if (engine.getDcpConnMap().canAddBackfillToActiveQ()) {
@@ -170,23 +195,37 @@ void BackfillManager::schedule(VBucket& vb,
     }
 
     if (managerTask && !managerTask->isdead()) {
-        ExecutorPool::get()->wake(managerTask->getId());
+        notifyTask_UNLOCKED();
         return;
     }
 
     managerTask.reset(new BackfillManagerTask(engine, shared_from_this()));
     ExecutorPool::get()->schedule(managerTask);
+    taskNotified = true;
+}
+
+void BackfillManager::notifyTask_UNLOCKED() {
+    // When many streams are opened back to back (e.g. at the start of a
+    // rebalance) only the first backfill scheduled needs to wake the task;
+    // it admits all the queued backfills when it runs.
+    if (managerTask && !taskNotified) {
+        taskNotified = true;
+        ExecutorPool::get()->wake(managerTask->getId());
+    }
 }
 
 bool BackfillManager::bytesCheckAndRead(size_t bytes) {
     LockHolder lh(lock);
-    if (scanBuffer.itemsRead >= scanBuffer.maxItems) {
+    // A shared scan gives each of its streams their own share of the limits.
+    const auto maxItems = scanBuffer.maxItems * scanBuffer.numStreams;
+    const auto maxBytes = scanBuffer.maxBytes * scanBuffer.numStreams;
+    if (scanBuffer.itemsRead >= maxItems) {
         return false;
     }
 
     // Always allow an item to be backfilled if the scan buffer is empty,
     // otherwise check to see if there is room for the item.
-    if (scanBuffer.bytesRead + bytes <= scanBuffer.maxBytes ||
+    if (scanBuffer.bytesRead + bytes <= maxBytes ||
         scanBuffer.bytesRead == 0) {
         scanBuffer.bytesRead += bytes;
     } else {
@@ -252,15 +291,14 @@ void BackfillManager::bytesSent(size_t bytes) {
         if (canFitNext && enoughCleared) {
             buffer.nextReadSize = 0;
             buffer.full = false;
-            if (managerTask) {
-                ExecutorPool::get()->wake(managerTask->getId());
-            }
+            notifyTask_UNLOCKED();
         }
     }
 }
 
 backfill_status_t BackfillManager::backfill() {
     std::unique_lock<std::mutex> lh(lock);
+    taskNotified = false;
 
     if (activeBackfills.empty() && snoozingBackfills.empty()
         && pendingBackfills.empty()) {
@@ -309,6 +347,7 @@ backfill_status_t BackfillManager::backfill() {
 
     UniqueDCPBackfillPtr backfill = std::move(activeBackfills.front());
     activeBackfills.pop_front();
+    scanBuffer.numStreams = backfill->getNumStreams();
 
     lh.unlock();
     backfill_status_t status = backfill->run();
@@ -316,6 +355,7 @@ backfill_status_t BackfillManager::backfill() {
 
     scanBuffer.bytesRead = 0;
     scanBuffer.itemsRead = 0;
+    scanBuffer.numStreams = 1;
 
     switch (status) {
         case backfill_success:
@@ -374,7 +414,5 @@ void BackfillManager::moveToActiveQueue() {
 
 void BackfillManager::wakeUpTask() {
     LockHolder lh(lock);
-    if (managerTask) {
-        ExecutorPool::get()->wake(managerTask->getId());
-    }
+    notifyTask_UNLOCKED();
 }
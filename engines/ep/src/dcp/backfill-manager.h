@@ -40,6 +40,11 @@
  * - dcp_scan_byte_limit
  * - dcp_scan_item_limit
  * - dcp_backfill_byte_limit
+ *
+ * With dcp_backfill_scan_sharing enabled, a backfill scheduled for a stream
+ * of the same vBucket as one which is still waiting to run (e.g. several
+ * streams, with different stream IDs, opened on the same vBucket) is added
+ * to the existing backfill, so one scan serves both streams.
  */
 #pragma once
 
@@ -60,6 +65,9 @@ struct BackfillScanBuffer {
     size_t itemsRead;
     size_t maxBytes;
     size_t maxItems;
+    //! Number of streams the current backfill reads for; each has its own
+    //! share of maxBytes and maxItems.
+    size_t numStreams;
 };
 
 class BackfillManager : public std::enable_shared_from_this<BackfillManager> {
@@ -118,6 +126,10 @@ private:
 
     void moveToActiveQueue();
 
+    /// Wake the managerTask, unless it has already been woken (and not run
+    /// since). Caller must hold lock.
+    void notifyTask_UNLOCKED();
+
     std::mutex lock;
     std::list<UniqueDCPBackfillPtr> activeBackfills;
     std::list<std::pair<rel_time_t, UniqueDCPBackfillPtr> > snoozingBackfills;
@@ -126,4 +138,9 @@ private:
     std::list<UniqueDCPBackfillPtr> pendingBackfills;
     EventuallyPersistentEngine& engine;
     ExTask managerTask;
+    //! Has managerTask been scheduled / woken since it last ran?
+    bool taskNotified = false;
+
+    //! Should streams share the scans of queued backfills (if possible)?
+    const bool scanSharing;
 };
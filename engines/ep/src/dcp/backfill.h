@@ -63,13 +63,37 @@ public:
      *
      * @return true if stream is in dead state; else false
      */
-    bool isStreamDead() const;
+    virtual bool isStreamDead() const;
 
     /**
      * Cancels the backfill
      */
     virtual void cancel() = 0;
 
+    /**
+     * Attempt to add another stream to this backfill, so that both are
+     * served by a single scan. Only backfills which support sharing, and
+     * which have not started running yet, accept a stream.
+     *
+     * @param s The stream to backfill
+     * @param startSeqno Start seqno of the stream's backfill
+     * @param endSeqno End seqno of the stream's backfill
+     * @return true if the stream was added, in which case no separate
+     *         backfill should be created for it
+     */
+    virtual bool attach(std::shared_ptr<ActiveStream> s,
+                        uint64_t startSeqno,
+                        uint64_t endSeqno) {
+        return false;
+    }
+
+    /**
+     * @return the number of streams this backfill reads items for
+     */
+    virtual size_t getNumStreams() const {
+        return 1;
+    }
+
 protected:
     /**
      * Ptr to the associated Active DCP stream. Backfill can be run for only
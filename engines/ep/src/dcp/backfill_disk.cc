@@ -21,6 +21,9 @@
 #include "kv_bucket.h"
 #include "vbucket.h"
 
+#include <algorithm>
+#include <limits>
+
 static std::string backfillStateToString(backfill_state_t state) {
     switch (state) {
     case backfill_state_init:
@@ -35,12 +38,107 @@ static std::string backfillStateToString(backfill_state_t state) {
     return "<invalid>:" + std::to_string(state);
 }
 
+BackfillStreams::BackfillStreams(std::shared_ptr<ActiveStream> s,
+                                 uint64_t startSeqno) {
+    add(s, startSeqno);
+}
+
+void BackfillStreams::add(std::shared_ptr<ActiveStream> s,
+                          uint64_t startSeqno) {
+    if (s == nullptr) {
+        throw std::invalid_argument("BackfillStreams::add: stream is NULL");
+    }
+    entries.push_back({s, startSeqno, 0});
+}
+
+bool BackfillStreams::received(std::unique_ptr<Item> item,
+                               backfill_source_t source) {
+    const auto seqno = uint64_t(item->getBySeqno());
+
+    // Find the streams which still need this item; the last one can be
+    // given the item itself, the others a copy.
+    std::vector<std::pair<Entry*, std::shared_ptr<ActiveStream>>> targets;
+    for (auto& entry : entries) {
+        if (seqno < entry.startSeqno ||
+            (!keyOrder && seqno <= entry.lastReceivedSeqno)) {
+            continue;
+        }
+        auto stream = entry.stream.lock();
+        if (stream && stream->isActive()) {
+            targets.emplace_back(&entry, std::move(stream));
+        }
+    }
+
+    for (size_t ii = 0; ii < targets.size(); ++ii) {
+        auto toSend = (ii + 1 == targets.size())
+                              ? std::move(item)
+                              : std::make_unique<Item>(*item);
+        if (!targets[ii].second->backfillReceived(
+                    std::move(toSend), source, /*force*/ false)) {
+            return false;
+        }
+        targets[ii].first->lastReceivedSeqno = seqno;
+    }
+    return true;
+}
+
+std::shared_ptr<ActiveStream> BackfillStreams::lockFirst() const {
+    for (const auto& entry : entries) {
+        if (auto stream = entry.stream.lock()) {
+            return stream;
+        }
+    }
+    return {};
+}
+
+std::vector<std::shared_ptr<ActiveStream>> BackfillStreams::lockAll() const {
+    std::vector<std::shared_ptr<ActiveStream>> result;
+    for (const auto& entry : entries) {
+        if (auto stream = entry.stream.lock()) {
+            result.push_back(std::move(stream));
+        }
+    }
+    return result;
+}
+
+void BackfillStreams::remove(const ActiveStream& s) {
+    for (auto& entry : entries) {
+        if (entry.stream.lock().get() == &s) {
+            entry.stream.reset();
+        }
+    }
+}
+
+uint64_t BackfillStreams::getStartSeqno() const {
+    uint64_t start = std::numeric_limits<uint64_t>::max();
+    for (const auto& entry : entries) {
+        start = std::min(start, entry.startSeqno);
+    }
+    return start;
+}
+
+uint64_t BackfillStreams::getStartSeqno(const ActiveStream& s) const {
+    for (const auto& entry : entries) {
+        if (entry.stream.lock().get() == &s) {
+            return entry.startSeqno;
+        }
+    }
+    throw std::invalid_argument(
+            "BackfillStreams::getStartSeqno: stream not found");
+}
+
 CacheCallback::CacheCallback(EventuallyPersistentEngine& e,
                              std::shared_ptr<ActiveStream> s)
-    : engine_(e), streamPtr(s) {
+    : engine_(e) {
     if (s == nullptr) {
         throw std::invalid_argument("CacheCallback(): stream is NULL");
     }
+    streams = std::make_shared<BackfillStreams>(s, 0);
+}
+
+CacheCallback::CacheCallback(EventuallyPersistentEngine& e,
+                             std::shared_ptr<BackfillStreams> s)
+    : engine_(e), streams(std::move(s)) {
 }
 
 // Do a get and restrict the collections lock scope to just these checks.
@@ -62,7 +160,7 @@ GetValue CacheCallback::get(VBucket& vb,
 }
 
 void CacheCallback::callback(CacheLookup& lookup) {
-    auto stream_ = streamPtr.lock();
+    auto stream_ = streams->lockFirst();
     if (!stream_) {
         setStatus(ENGINE_SUCCESS);
         return;
@@ -93,9 +191,7 @@ void CacheCallback::callback(CacheLookup& lookup) {
         }
 
         if (gv.item->getBySeqno() == lookup.getBySeqno()) {
-            if (stream_->backfillReceived(std::move(gv.item),
-                                          BACKFILL_FROM_MEMORY,
-                                          /*force */ false)) {
+            if (streams->received(std::move(gv.item), BACKFILL_FROM_MEMORY)) {
                 setStatus(ENGINE_KEY_EEXISTS);
                 return;
             }
@@ -106,15 +202,19 @@ void CacheCallback::callback(CacheLookup& lookup) {
     setStatus(ENGINE_SUCCESS);
 }
 
-DiskCallback::DiskCallback(std::shared_ptr<ActiveStream> s) : streamPtr(s) {
+DiskCallback::DiskCallback(std::shared_ptr<ActiveStream> s) {
     if (s == nullptr) {
         throw std::invalid_argument("DiskCallback(): stream is NULL");
     }
+    streams = std::make_shared<BackfillStreams>(s, 0);
+}
+
+DiskCallback::DiskCallback(std::shared_ptr<BackfillStreams> s)
+    : streams(std::move(s)) {
 }
 
 void DiskCallback::callback(GetValue& val) {
-    auto stream_ = streamPtr.lock();
-    if (!stream_) {
+    if (!streams->lockFirst()) {
         setStatus(ENGINE_SUCCESS);
         return;
     }
@@ -128,9 +228,7 @@ void DiskCallback::callback(GetValue& val) {
     val.item->setNRUValue(MAX_NRU_VALUE);
     val.item->setFreqCounterValue(0);
 
-    if (!stream_->backfillReceived(std::move(val.item),
-                                   BACKFILL_FROM_DISK,
-                                   /*force*/ false)) {
+    if (!streams->received(std::move(val.item), BACKFILL_FROM_DISK)) {
         setStatus(ENGINE_ENOMEM); // Pause the backfill
     } else {
         setStatus(ENGINE_SUCCESS);
@@ -143,6 +241,7 @@ DCPBackfillDisk::DCPBackfillDisk(EventuallyPersistentEngine& e,
                                  uint64_t endSeqno)
     : DCPBackfill(s, startSeqno, endSeqno),
       engine(e),
+      streams(std::make_shared<BackfillStreams>(s, startSeqno)),
       scanCtx(nullptr),
       state(backfill_state_init) {
 }
@@ -171,8 +270,60 @@ void DCPBackfillDisk::cancel() {
     }
 }
 
+// Note: isStreamDead() and getNumStreams() are called by the BackfillManager
+// with its lock held, so cannot take our lock (run() takes them in the
+// opposite order). They are only called for backfills which are queued (not
+// running), and the streams are only added to under the BackfillManager's
+// lock.
+bool DCPBackfillDisk::isStreamDead() const {
+    for (const auto& stream : streams->lockAll()) {
+        if (stream->isActive()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DCPBackfillDisk::attach(std::shared_ptr<ActiveStream> s,
+                             uint64_t startSeqno,
+                             uint64_t endSeqno) {
+    // If the backfill is running it has (or soon will have) started its scan;
+    // don't wait for it (the BackfillManager's lock is held).
+    std::unique_lock<std::mutex> lh(lock, std::try_to_lock);
+    if (!lh || state != backfill_state_init || s->getVBucket() != vbid) {
+        return false;
+    }
+
+    auto first = streams->lockFirst();
+    if (!first || first->isKeyOnly() != s->isKeyOnly() ||
+        first->isCompressionEnabled() != s->isCompressionEnabled() ||
+        first->isOutOfOrderSnapshotsEnabled() ||
+        s->isOutOfOrderSnapshotsEnabled()) {
+        return false;
+    }
+
+    // Only share a scan whose range overlaps this stream's.
+    if (startSeqno > this->endSeqno || endSeqno < streams->getStartSeqno()) {
+        return false;
+    }
+
+    streams->add(s, startSeqno);
+    this->endSeqno = std::max(this->endSeqno, endSeqno);
+    s->log(spdlog::level::level_enum::info,
+           "({}) Backfill ({} to {}) shares the scan of {} other stream(s)",
+           vbid,
+           startSeqno,
+           endSeqno,
+           streams->size() - 1);
+    return true;
+}
+
+size_t DCPBackfillDisk::getNumStreams() const {
+    return streams->size();
+}
+
 backfill_status_t DCPBackfillDisk::create() {
-    auto stream = streamPtr.lock();
+    auto stream = streams->lockFirst();
     if (!stream) {
         EP_LOG_WARN(
                 "DCPBackfillDisk::create(): "
@@ -209,10 +360,14 @@ backfill_status_t DCPBackfillDisk::create() {
         }
     }
 
-    auto cb = std::make_shared<DiskCallback>(stream);
-    auto cl = std::make_shared<CacheCallback>(engine, stream);
-    scanCtx = kvstore->initScanContext(
-            cb, cl, vbid, startSeqno, DocumentFilter::ALL_ITEMS, valFilter);
+    auto cb = std::make_shared<DiskCallback>(streams);
+    auto cl = std::make_shared<CacheCallback>(engine, streams);
+    scanCtx = kvstore->initScanContext(cb,
+                                       cl,
+                                       vbid,
+                                       streams->getStartSeqno(),
+                                       DocumentFilter::ALL_ITEMS,
+                                       valFilter);
 
     // Check startSeqno against the purge-seqno of the opened datafile.
     // 1) A normal stream request would of checked inside streamRequest, but
@@ -221,50 +376,112 @@ backfill_status_t DCPBackfillDisk::create() {
     //    behind the current purge-seqno
     // If the startSeqno != 1 (a client 0 to n request becomes 1 to n) then
     // start-seqno must be above purge-seqno
-    if (!scanCtx || (startSeqno != 1 && (startSeqno <= scanCtx->purgeSeqno))) {
-        auto vb = engine.getVBucket(vbid);
-        std::stringstream log;
-        log << "DCPBackfillDisk::create(): (" << getVBucketId()
-            << ") cannot be scanned. Associated stream is set to dead state.";
-        end_stream_status_t status = END_STREAM_BACKFILL_FAIL;
+    // When the scan is shared each stream is checked (and failed) on its own.
+    auto liveStreams = streams->lockAll();
+    for (const auto& s : liveStreams) {
+        const auto start = streams->getStartSeqno(*s);
+        if (!scanCtx || (start != 1 && (start <= scanCtx->purgeSeqno))) {
+            auto vb = engine.getVBucket(vbid);
+            std::stringstream log;
+            log << "DCPBackfillDisk::create(): (" << getVBucketId()
+                << ") cannot be scanned. Associated stream is set to dead "
+                   "state.";
+            end_stream_status_t status = END_STREAM_BACKFILL_FAIL;
+            if (scanCtx) {
+                log << " startSeqno:" << start
+                    << " < purgeSeqno:" << scanCtx->purgeSeqno;
+                status = END_STREAM_ROLLBACK;
+            } else {
+                log << " failed to create scan";
+            }
+            log << ". The vbucket state:";
+            if (vb) {
+                log << VBucket::toString(vb->getState());
+            } else {
+                log << "vb not found!!";
+            }
+
+            s->log(spdlog::level::level_enum::warn, "{}", log.str());
+            s->setDead(status);
+            streams->remove(*s);
+        }
+    }
+
+    if (!streams->lockFirst()) {
         if (scanCtx) {
-            log << " startSeqno:" << startSeqno
-                << " < purgeSeqno:" << scanCtx->purgeSeqno;
             kvstore->destroyScanContext(scanCtx);
-            status = END_STREAM_ROLLBACK;
-        } else {
-            log << " failed to create scan";
-        }
-        log << ". The vbucket state:";
-        if (vb) {
-            log << VBucket::toString(vb->getState());
-        } else {
-            log << "vb not found!!";
         }
-
-        stream->log(spdlog::level::level_enum::warn, "{}", log.str());
-        stream->setDead(status);
         transitionState(backfill_state_done);
     } else {
-        stream->setBackfillRemaining(scanCtx->documentCount);
-        stream->markDiskSnapshot(startSeqno,
-                                 scanCtx->maxSeqno,
-                                 scanCtx->persistedCompletedSeqno);
+        // A stream which accepts out of sequence order snapshots may be sent
+        // the collection's items in key order (its scan isn't shared).
+        const auto all = streams->lockAll();
+        const bool keyOrder =
+                all.size() == 1 && all.front()->isOutOfOrderSnapshotsEnabled();
+        scanCtx->collection = getScanCollection(vbid, keyOrder);
+        scanCtx->keyOrder = keyOrder && scanCtx->collection;
+        if (scanCtx->keyOrder) {
+            streams->setKeyOrder();
+        }
+        for (const auto& s : all) {
+            s->setBackfillRemaining(scanCtx->documentCount);
+            s->markDiskSnapshot(streams->getStartSeqno(*s),
+                                scanCtx->maxSeqno,
+                                scanCtx->persistedCompletedSeqno,
+                                scanCtx->keyOrder);
+        }
         transitionState(backfill_state_scanning);
     }
 
     return backfill_success;
 }
 
+boost::optional<CollectionID> DCPBackfillDisk::getScanCollection(
+        Vbid vbid, bool keyOrder) const {
+    boost::optional<CollectionID> cid;
+    for (const auto& s : streams->lockAll()) {
+        const auto single = s->getSingleCollection();
+        if (!single || (cid && *cid != *single)) {
+            return {};
+        }
+        cid = single;
+    }
+    if (!cid) {
+        return {};
+    }
+
+    auto vb = engine.getVBucket(vbid);
+    if (!vb) {
+        return {};
+    }
+    uint64_t items = 0;
+    {
+        auto handle = vb->lockCollections();
+        if (!handle.exists(*cid)) {
+            return {};
+        }
+        items = handle.getItemCount(*cid);
+    }
+
+    // Only read by key when the collection is a small part of the vbucket;
+    // unless they may be returned in key order, the collection's keys must
+    // also be held and sorted into seqno order.
+    if ((!keyOrder && items > maxCollectionScanItems) ||
+        items * collectionScanRatio > scanCtx->documentCount) {
+        return {};
+    }
+    return cid;
+}
+
 backfill_status_t DCPBackfillDisk::scan() {
-    auto stream = streamPtr.lock();
+    auto stream = streams->lockFirst();
     if (!stream) {
         return complete(true);
     }
 
     Vbid vbid = stream->getVBucket();
 
-    if (!(stream->isActive())) {
+    if (isStreamDead()) {
         return complete(true);
     }
 
@@ -286,8 +503,8 @@ backfill_status_t DCPBackfillDisk::complete(bool cancelled) {
     KVStore* kvstore = engine.getKVBucket()->getROUnderlying(getVBucketId());
     kvstore->destroyScanContext(scanCtx);
 
-    auto stream = streamPtr.lock();
-    if (!stream) {
+    auto liveStreams = streams->lockAll();
+    if (liveStreams.empty()) {
         EP_LOG_WARN(
                 "DCPBackfillDisk::complete(): "
                 "({}) backfill create ended prematurely as the associated "
@@ -298,16 +515,17 @@ backfill_status_t DCPBackfillDisk::complete(bool cancelled) {
         return backfill_finished;
     }
 
-    stream->completeBackfill();
-
     auto severity = cancelled ? spdlog::level::level_enum::info
                               : spdlog::level::level_enum::debug;
-    stream->log(severity,
-                "({}) Backfill task ({} to {}) {}",
-                vbid,
-                startSeqno,
-                endSeqno,
-                cancelled ? "cancelled" : "finished");
+    for (const auto& stream : liveStreams) {
+        stream->completeBackfill();
+        stream->log(severity,
+                    "({}) Backfill task ({} to {}) {}",
+                    vbid,
+                    streams->getStartSeqno(*stream),
+                    endSeqno,
+                    cancelled ? "cancelled" : "finished");
+    }
 
     transitionState(backfill_state_done);
 
@@ -19,10 +19,14 @@
 
 #include "callbacks.h"
 #include "dcp/backfill.h"
+#include "dcp/stream.h"
 
+#include <boost/optional.hpp>
 #include <mutex>
+#include <vector>
 
 class EventuallyPersistentEngine;
+class Item;
 class ScanContext;
 class VBucket;
 
@@ -34,12 +38,79 @@ enum backfill_state_t {
     backfill_state_done
 };
 
+/**
+ * The streams a DCPBackfillDisk reads items for. Normally a single stream,
+ * but with dcp_backfill_scan_sharing several streams of a connection which
+ * backfill the same vBucket can share one scan (see DCPBackfillDisk::attach).
+ *
+ * Each stream is only given the items from its own start seqno, and each
+ * item only once: if a stream cannot accept an item (its buffer is full) the
+ * scan pauses and is later resumed at that item, at which point the streams
+ * which already received it are skipped.
+ */
+class BackfillStreams {
+public:
+    BackfillStreams(std::shared_ptr<ActiveStream> s, uint64_t startSeqno);
+
+    void add(std::shared_ptr<ActiveStream> s, uint64_t startSeqno);
+
+    /**
+     * Give an item read by the scan to every stream which still needs it.
+     *
+     * @return false if a stream could not accept the item, and the scan must
+     *         pause
+     */
+    bool received(std::unique_ptr<Item> item, backfill_source_t source);
+
+    /// @return the first stream still alive, or nullptr if there is none
+    std::shared_ptr<ActiveStream> lockFirst() const;
+
+    /// @return all of the streams still alive
+    std::vector<std::shared_ptr<ActiveStream>> lockAll() const;
+
+    /// Stop giving items to the given stream.
+    void remove(const ActiveStream& s);
+
+    /// @return the lowest start seqno of the streams
+    uint64_t getStartSeqno() const;
+
+    /// @return the start seqno the given stream was added with
+    uint64_t getStartSeqno(const ActiveStream& s) const;
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    /**
+     * The scan returns the items in key order (so they aren't checked
+     * against the highest seqno already given to a stream). Only used when
+     * the scan isn't shared.
+     */
+    void setKeyOrder() {
+        keyOrder = true;
+    }
+
+private:
+    struct Entry {
+        std::weak_ptr<ActiveStream> stream;
+        uint64_t startSeqno;
+        /// Highest seqno given to the stream (0 for none)
+        uint64_t lastReceivedSeqno;
+    };
+
+    std::vector<Entry> entries;
+    bool keyOrder = false;
+};
+
 /* Callback to get the items that are found to be in the cache */
 class CacheCallback : public StatusCallback<CacheLookup> {
 public:
     CacheCallback(EventuallyPersistentEngine& e,
                   std::shared_ptr<ActiveStream> s);
 
+    CacheCallback(EventuallyPersistentEngine& e,
+                  std::shared_ptr<BackfillStreams> s);
+
     void callback(CacheLookup& lookup);
 
 private:
@@ -51,7 +122,7 @@ private:
     GetValue get(VBucket& vb, CacheLookup& lookup, ActiveStream& stream);
 
     EventuallyPersistentEngine& engine_;
-    std::weak_ptr<ActiveStream> streamPtr;
+    std::shared_ptr<BackfillStreams> streams;
 };
 
 /* Callback to get the items that are found to be in the disk */
@@ -59,10 +130,12 @@ class DiskCallback : public StatusCallback<GetValue> {
 public:
     DiskCallback(std::shared_ptr<ActiveStream> s);
 
+    DiskCallback(std::shared_ptr<BackfillStreams> s);
+
     void callback(GetValue& val);
 
 private:
-    std::weak_ptr<ActiveStream> streamPtr;
+    std::shared_ptr<BackfillStreams> streams;
 };
 
 /**
@@ -83,6 +156,23 @@ public:
 
     void cancel() override;
 
+    bool isStreamDead() const override;
+
+    /**
+     * Add another stream of the same connection to this backfill, if it
+     * hasn't started yet. The stream must read the same vBucket with the
+     * same value options (key only / compressed), and its seqno range must
+     * overlap the backfill's. Streams which accept out of sequence order
+     * snapshots aren't shared (their scan may return the items in key
+     * order). The shared scan then starts from the lowest
+     * start seqno of all the streams.
+     */
+    bool attach(std::shared_ptr<ActiveStream> s,
+                uint64_t startSeqno,
+                uint64_t endSeqno) override;
+
+    size_t getNumStreams() const override;
+
 private:
     /**
      * Creates a scan context with the KV Store to read items in the sequential
@@ -90,6 +180,24 @@ private:
      */
     backfill_status_t create();
 
+    /**
+     * @return the collection the scan can be restricted to - set if every
+     *         stream wants only the same single collection, and that
+     *         collection is small enough (relative to the vbucket) to be
+     *         worth reading by key.
+     * @param keyOrder the items may be returned in key order (so the keys
+     *        needn't be held to sort them)
+     */
+    boost::optional<CollectionID> getScanCollection(Vbid vbid,
+                                                    bool keyOrder) const;
+
+    /// A collection is read by key only if it holds at most 1/ratio of the
+    /// vbucket's documents...
+    static constexpr uint64_t collectionScanRatio = 4;
+    /// ... and (unless returned in key order) at most this many (their keys
+    /// are held in memory to be sorted into seqno order).
+    static constexpr uint64_t maxCollectionScanItems = 100000;
+
     /**
      * Scan the disk (by calling KVStore apis) for the items in the backfill
      * snapshot range created in the create scan context. This is an
@@ -120,6 +228,9 @@ private:
      */
     EventuallyPersistentEngine& engine;
 
+    /// The streams items are read for; shared with the scan callbacks.
+    const std::shared_ptr<BackfillStreams> streams;
+
     ScanContext* scanCtx;
     backfill_state_t state;
     std::mutex lock;
@@ -116,8 +116,8 @@ backfill_status_t DCPBackfillMemoryBuffered::create() {
         } else {
             stream->log(spdlog::level::level_enum::debug,
                         "{}"
-                        " Deferring backfill creation as another "
-                        "range iterator is already on the sequence list",
+                        " Deferring backfill creation as the sequence list "
+                        "is being purged",
                         getVBucketId());
             return backfill_snooze;
         }
@@ -170,8 +170,10 @@ backfill_status_t DCPBackfillMemoryBuffered::create() {
                     std::min(endSeqno, static_cast<uint64_t>(rangeItr.back()));
 
             /* Mark disk snapshot */
-            stream->markDiskSnapshot(
-                    startSeqno, endSeqno, evb->getHighCompletedSeqno());
+            stream->markDiskSnapshot(startSeqno,
+                                     endSeqno,
+                                     evb->getHighCompletedSeqno(),
+                                     /*outOfSeqnoOrder*/ false);
 
             /* Change the backfill state */
             transitionState(BackfillState::Scanning);
@@ -53,6 +53,7 @@ class DcpConsumerTask : public GlobalTask {
 public:
     DcpConsumerTask(EventuallyPersistentEngine* e,
                     std::shared_ptr<DcpConsumer> c,
+                    size_t processor,
                     double sleeptime = 1,
                     bool completeBeforeShutdown = true)
         : GlobalTask(e,
@@ -60,14 +61,18 @@ public:
                      sleeptime,
                      completeBeforeShutdown),
           consumerPtr(c),
+          processor(processor),
           description("DcpConsumerTask, processing buffered items for " +
-                      c->getName()) {
+                      c->getName() +
+                      (processor ? " (processor " +
+                                           std::to_string(processor) + ")"
+                                 : "")) {
     }
 
     ~DcpConsumerTask() {
         auto consumer = consumerPtr.lock();
         if (consumer) {
-            consumer->taskCancelled();
+            consumer->taskCancelled(processor);
         }
     }
 
@@ -83,7 +88,8 @@ public:
         }
 
         double sleepFor = 0.0;
-        enum process_items_error_t state = consumer->processBufferedItems();
+        enum process_items_error_t state =
+                consumer->processBufferedItems(processor);
         switch (state) {
             case all_processed:
                 sleepFor = INT_MAX;
@@ -92,7 +98,9 @@ public:
                 sleepFor = 0.0;
                 break;
             case cannot_process:
-                sleepFor = 5.0;
+                sleepFor = engine->getReplicationThrottle()
+                                   .getBackoffTime()
+                                   .count();
                 break;
             case stop_processing:
                 return false;
@@ -101,30 +109,30 @@ public:
         // Check if we've been notified of more work to do - if not then sleep;
         // if so then wakeup and re-run the task.
         // Note: The order of the wakeUp / snooze here is *critical* - another
-        // thread may concurrently notify us (set processorNotification=true)
+        // thread may concurrently notify us (set the processor notification)
         // while we are performing the checks, so we need to ensure we don't
         // loose a wakeup as that would result in this Task sleeping forever
         // (and DCP hanging).
         // To prevent this, we perform an initial check of notifiedProcessor(),
         // which if false we initially sleep, and then check a second time.
-        // We could race if the other actor sets processorNotification=true
+        // We could race if the other actor sets the notification
         // between the second `if(consumer->notifiedProcessor)` and us calling
         // `wakeUp()`; but that's essentially a benign race as it will just
         // result in wakeUp() being called twice which is benign.
-        if (consumer->notifiedProcessor(false)) {
+        if (consumer->notifiedProcessor(false, processor)) {
             wakeUp();
             state = more_to_process;
         } else {
             snooze(sleepFor);
             // Check if the processor was notified again,
             // in which case the task should wake immediately.
-            if (consumer->notifiedProcessor(false)) {
+            if (consumer->notifiedProcessor(false, processor)) {
                 wakeUp();
                 state = more_to_process;
             }
         }
 
-        consumer->setProcessorTaskState(state);
+        consumer->setProcessorTaskState(state, processor);
 
         return true;
     }
@@ -140,9 +148,11 @@ public:
     }
 
 private:
-    /* we have one task per consumer. the task only needs a reference to the
-       consumer object and does not own it. Hence std::weak_ptr should be used*/
+    /* we have one task per consumer processor. the task only needs a
+       reference to the consumer object and does not own it. Hence
+       std::weak_ptr should be used*/
     const std::weak_ptr<DcpConsumer> consumerPtr;
+    const size_t processor;
     const std::string description;
 };
 
@@ -154,15 +164,11 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine& engine,
       lastMessageTime(ep_current_time()),
       engine(engine),
       opaqueCounter(0),
-      processorTaskId(0),
-      processorTaskState(all_processed),
-      processorNotification(false),
       backoffs(0),
       dcpNoopTxInterval(engine.getConfiguration().getDcpNoopTxInterval()),
       pendingSendStreamEndOnClientStreamClose(true),
       consumerName(consumerName_),
       producerIsVersion5orHigher(false),
-      processorTaskRunning(false),
       flowControl(engine, this),
       processBufferedMessagesYieldThreshold(
               engine.getConfiguration()
@@ -171,6 +177,10 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine& engine,
               engine.getConfiguration()
                       .getDcpConsumerProcessBufferedMessagesBatchSize()) {
     Configuration& config = engine.getConfiguration();
+    processors.resize(config.getDcpConsumerProcessorTasks());
+    for (auto& processor : processors) {
+        processor = std::make_unique<Processor>(config.getMaxVbuckets());
+    }
     setSupportAck(false);
     setLogHeader("DCP (Consumer) " + getName() + " -");
     setReserved(true);
@@ -204,14 +214,16 @@ DcpConsumer::~DcpConsumer() {
 
 
 void DcpConsumer::cancelTask() {
-    bool exp = true;
-    if (processorTaskRunning.compare_exchange_strong(exp, false)) {
-        ExecutorPool::get()->cancel(processorTaskId);
+    for (auto& processor : processors) {
+        bool exp = true;
+        if (processor->taskRunning.compare_exchange_strong(exp, false)) {
+            ExecutorPool::get()->cancel(processor->taskId);
+        }
     }
 }
 
-void DcpConsumer::taskCancelled() {
-    processorTaskRunning.store(false);
+void DcpConsumer::taskCancelled(size_t processor) {
+    processors[processor]->taskRunning.store(false);
 }
 
 std::shared_ptr<PassiveStream> DcpConsumer::makePassiveStream(
@@ -297,13 +309,16 @@ ENGINE_ERROR_CODE DcpConsumer::addStream(uint32_t opaque,
         }
     }
 
-    /* We need 'Processor' task only when we have a stream. Hence create it
-     only once when the first stream is added */
-    bool exp = false;
-    if (processorTaskRunning.compare_exchange_strong(exp, true)) {
-        ExTask task = std::make_shared<DcpConsumerTask>(
-                &engine, shared_from_this(), 1);
-        processorTaskId = ExecutorPool::get()->schedule(task);
+    /* We need 'Processor' tasks only when we have a stream. Hence create
+     them only once when the first stream is added */
+    for (size_t ii = 0; ii < processors.size(); ++ii) {
+        auto& processor = *processors[ii];
+        bool exp = false;
+        if (processor.taskRunning.compare_exchange_strong(exp, true)) {
+            ExTask task = std::make_shared<DcpConsumerTask>(
+                    &engine, shared_from_this(), ii, 1);
+            processor.taskId = ExecutorPool::get()->schedule(task);
+        }
     }
 
     stream = makePassiveStream(engine_,
@@ -756,6 +771,17 @@ ENGINE_ERROR_CODE DcpConsumer::snapshotMarker(
 
 ENGINE_ERROR_CODE DcpConsumer::noop(uint32_t opaque) {
     lastMessageTime = ep_current_time();
+
+    // Let the streams know that they've received everything the producer
+    // sent before the noop
+    std::vector<PassiveStreamMap::mapped_type> valid_streams;
+    streams.for_each(
+            [&valid_streams](const PassiveStreamMap::value_type& element) {
+                valid_streams.push_back(element.second);
+            });
+    for (const auto& stream : valid_streams) {
+        stream->processNoop();
+    }
     return ENGINE_SUCCESS;
 }
 
@@ -968,6 +994,7 @@ bool DcpConsumer::handleResponse(const protocol_binary_response_header* resp) {
     } else if (opcode == cb::mcbp::ClientOpcode::DcpBufferAcknowledgement) {
         return true;
     } else if (opcode == cb::mcbp::ClientOpcode::DcpControl) {
+        flowControl.handleControlResponse(opaque);
         // The Consumer-Producer negotiation for Sync Replication happens over
         // DCP_CONTROL and introduces a blocking step.
         // The blocking DCP_CONTROL request is signed at Consumer by tracking
@@ -1094,12 +1121,31 @@ void DcpConsumer::addStats(const AddStatFn& add_stat, const void* c) {
     addStat("processor_task_state", getProcessorTaskStatusStr(), add_stat, c);
     flowControl.addStats(add_stat, c);
 
-    vbReady.addStats(getName() + ":dcp_buffered_ready_queue_", add_stat, c);
+    processors[0]->vbReady.addStats(
+            getName() + ":dcp_buffered_ready_queue_", add_stat, c);
     addStat("processor_notification",
-            processorNotification.load(),
+            processors[0]->notification.load(),
             add_stat,
             c);
 
+    // Additional processors' stats are reported by index.
+    for (size_t ii = 1; ii < processors.size(); ++ii) {
+        const auto prefix = "processor_" + std::to_string(ii) + "_";
+        addStat((prefix + "task_state").c_str(),
+                getProcessorTaskStatusStr(ii),
+                add_stat,
+                c);
+        processors[ii]->vbReady.addStats(
+                getName() + ":dcp_buffered_ready_queue_" + std::to_string(ii) +
+                        "_",
+                add_stat,
+                c);
+        addStat((prefix + "notification").c_str(),
+                processors[ii]->notification.load(),
+                add_stat,
+                c);
+    }
+
     addStat("synchronous_replication", isSyncReplicationEnabled(), add_stat, c);
 }
 
@@ -1116,12 +1162,14 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
         switch (engine_.getReplicationThrottle().getStatus()) {
         case ReplicationThrottle::Status::Pause:
             backoffs++;
-            vbReady.pushUnique(stream->getVBucket());
+            getProcessor(stream->getVBucket())
+                    .vbReady.pushUnique(stream->getVBucket());
             return cannot_process;
 
         case ReplicationThrottle::Status::Disconnect:
             backoffs++;
-            vbReady.pushUnique(stream->getVBucket());
+            getProcessor(stream->getVBucket())
+                    .vbReady.pushUnique(stream->getVBucket());
             logger->warn(
                     "{} Processor task indicating disconnection "
                     "as there is no memory to complete replication",
@@ -1132,6 +1180,7 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
             bytesProcessed = 0;
             rval = stream->processBufferedMessages(
                     bytesProcessed, processBufferedMessagesBatchSize);
+            engine_.getReplicationThrottle().processed(bytesProcessed);
             if ((rval == cannot_process) || (rval == stop_processing)) {
                 backoffs++;
             }
@@ -1149,7 +1198,8 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
 
     // The stream may not be done yet so must go back in the ready queue
     if (bytesProcessed > 0) {
-        vbReady.pushUnique(stream->getVBucket());
+        getProcessor(stream->getVBucket())
+                .vbReady.pushUnique(stream->getVBucket());
         if (rval == stop_processing) {
             return stop_processing;
         }
@@ -1159,7 +1209,8 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
     return rval;
 }
 
-process_items_error_t DcpConsumer::processBufferedItems() {
+process_items_error_t DcpConsumer::processBufferedItems(size_t processor) {
+    auto& vbReady = processors[processor]->vbReady;
     process_items_error_t process_ret = all_processed;
     Vbid vbucket = Vbid(0);
     while (vbReady.popFront(vbucket)) {
@@ -1195,23 +1246,26 @@ process_items_error_t DcpConsumer::processBufferedItems() {
 }
 
 void DcpConsumer::notifyVbucketReady(Vbid vbucket) {
-    if (vbReady.pushUnique(vbucket) &&
-        notifiedProcessor(true)) {
-        ExecutorPool::get()->wake(processorTaskId);
+    auto& processor = getProcessor(vbucket);
+    if (processor.vbReady.pushUnique(vbucket) &&
+        !processor.notification.exchange(true)) {
+        ExecutorPool::get()->wake(processor.taskId);
     }
 }
 
-bool DcpConsumer::notifiedProcessor(bool to) {
+bool DcpConsumer::notifiedProcessor(bool to, size_t processor) {
     bool inverse = !to;
-    return processorNotification.compare_exchange_strong(inverse, to);
+    return processors[processor]->notification.compare_exchange_strong(inverse,
+                                                                       to);
 }
 
-void DcpConsumer::setProcessorTaskState(enum process_items_error_t to) {
-    processorTaskState = to;
+void DcpConsumer::setProcessorTaskState(enum process_items_error_t to,
+                                        size_t processor) {
+    processors[processor]->taskState = to;
 }
 
-std::string DcpConsumer::getProcessorTaskStatusStr() {
-    switch (processorTaskState.load()) {
+std::string DcpConsumer::getProcessorTaskStatusStr(size_t processor) {
+    switch (processors[processor]->taskState.load()) {
         case all_processed:
             return "ALL_PROCESSED";
         case more_to_process:
@@ -31,6 +31,8 @@
 
 #include <list>
 #include <map>
+#include <memory>
+#include <vector>
 #include <engines/ep/src/collections/collections_types.h>
 
 class DcpResponse;
@@ -264,7 +266,15 @@ public:
 
     void closeStreamDueToVbStateChange(Vbid vbucket, vbucket_state_t state);
 
-    process_items_error_t processBufferedItems();
+    /**
+     * Process the buffered items of the streams which are ready in one of
+     * the consumer's processors (one per DcpConsumerTask). Each vBucket
+     * belongs to exactly one processor, so the streams of different
+     * processors may be drained concurrently.
+     *
+     * @param processor The index of the processor to run.
+     */
+    process_items_error_t processBufferedItems(size_t processor = 0);
 
     uint64_t incrOpaqueCounter();
 
@@ -272,19 +282,29 @@ public:
 
     void setFlowControlBufSize(uint32_t newSize);
 
+    FlowControl& getFlowControl() {
+        return flowControl;
+    }
+
     static const std::string& getControlMsgKey(void);
 
     bool isStreamPresent(Vbid vbucket);
 
     void cancelTask();
 
-    void taskCancelled();
+    void taskCancelled(size_t processor);
 
-    bool notifiedProcessor(bool to);
+    bool notifiedProcessor(bool to, size_t processor = 0);
 
-    void setProcessorTaskState(enum process_items_error_t to);
+    void setProcessorTaskState(enum process_items_error_t to,
+                               size_t processor = 0);
 
-    std::string getProcessorTaskStatusStr();
+    std::string getProcessorTaskStatusStr(size_t processor = 0);
+
+    /// @return the number of processors (DcpConsumerTasks) of this consumer.
+    size_t getNumProcessors() const {
+        return processors.size();
+    }
 
     /**
      * Check if the enough bytes have been removed from the flow control
@@ -533,11 +553,32 @@ protected:
     /* Reference to the ep engine; need to create the 'Processor' task */
     EventuallyPersistentEngine& engine;
     uint64_t opaqueCounter;
-    size_t processorTaskId;
-    std::atomic<enum process_items_error_t> processorTaskState;
+    /**
+     * The state of one DcpConsumerTask; the vBuckets of the consumer are
+     * shared between the processors by vbid (modulo the number of
+     * processors), so a stream is only ever drained by one task at a time.
+     */
+    struct Processor {
+        explicit Processor(size_t maxVbuckets) : vbReady(maxVbuckets) {
+        }
+
+        size_t taskId = 0;
+        std::atomic<enum process_items_error_t> taskState{all_processed};
+
+        VBReadyQueue vbReady;
+        std::atomic<bool> notification{false};
+
+        /* Indicates if the 'Processor' task is running */
+        std::atomic<bool> taskRunning{false};
+    };
+
+    /// @return the processor which handles the given vBucket.
+    Processor& getProcessor(Vbid vbucket) {
+        return *processors[vbucket.get() % processors.size()];
+    }
 
-    VBReadyQueue vbReady;
-    std::atomic<bool> processorNotification;
+    /// Processors, sized from 'dcp_consumer_processor_tasks' on creation.
+    std::vector<std::unique_ptr<Processor>> processors;
 
     std::mutex readyMutex;
     std::list<Vbid> ready;
@@ -597,9 +638,6 @@ protected:
     } getErrorMapState;
     bool producerIsVersion5orHigher;
 
-    /* Indicates if the 'Processor' task is running */
-    std::atomic<bool> processorTaskRunning;
-
     FlowControl flowControl;
 
        /**
@@ -78,7 +78,9 @@ enum dcp_marker_flag_t {
     MARKER_FLAG_MEMORY = 0x01,
     MARKER_FLAG_DISK = 0x02,
     MARKER_FLAG_CHK = 0x04,
-    MARKER_FLAG_ACK = 0x08
+    MARKER_FLAG_ACK = 0x08,
+    /// The items of the (disk) snapshot are not in seqno order
+    MARKER_FLAG_OSO = 0x10
 };
 
 /*
@@ -249,10 +249,8 @@ void DcpConnMap::closeStreamsDueToRollback(Vbid vbucket) {
 }
 
 bool DcpConnMap::handleSlowStream(Vbid vbid, const CheckpointCursor* cursor) {
-    size_t lock_num = vbid.get() % vbConnLockNum;
-    std::lock_guard<std::mutex> lh(vbConnLocks[lock_num]);
-
-    for (const auto& weakPtr : vbConns[vbid.get()]) {
+    const auto vb_conns = getVBConns(vbid);
+    for (const auto& weakPtr : *vb_conns) {
         auto connection = weakPtr.lock();
         if (!connection) {
             continue;
@@ -400,20 +398,7 @@ void DcpConnMap::removeVBConnections(DcpProducer& prod) {
     for (const auto vbid : prod.getVBVector()) {
         size_t lock_num = vbid.get() % vbConnLockNum;
         std::lock_guard<std::mutex> lh(vbConnLocks[lock_num]);
-        auto& vb_conns = vbConns[vbid.get()];
-        for (auto itr = vb_conns.begin(); itr != vb_conns.end();) {
-            auto connection = (*itr).lock();
-            if (!connection) {
-                // ConnHandler no longer exists, cleanup.
-                itr = vb_conns.erase(itr);
-            } else if (prod.getCookie() == connection->getCookie()) {
-                // Found conn with matching cookie, done.
-                vb_conns.erase(itr);
-                break;
-            } else {
-                ++itr;
-            }
-        }
+        removeVBConnByVBId_UNLOCKED(prod.getCookie(), vbid);
     }
 }
 
@@ -424,10 +409,11 @@ void DcpConnMap::notifyVBConnections(Vbid vbid, uint64_t bySeqno) {
                  vbid.get(),
                  "seqno",
                  bySeqno);
-    size_t lock_num = vbid.get() % vbConnLockNum;
-    std::lock_guard<std::mutex> lh(vbConnLocks[lock_num]);
-
-    for (auto& weakPtr : vbConns[vbid.get()]) {
+    // No locking; the list is an immutable snapshot and the streams
+    // coalesce the notifications (only the first notification after the
+    // stream was drained schedules the producer)
+    const auto vb_conns = getVBConns(vbid);
+    for (const auto& weakPtr : *vb_conns) {
         auto connection = weakPtr.lock();
         if (!connection) {
             continue;
@@ -446,28 +432,17 @@ void DcpConnMap::seqnoAckVBPassiveStream(Vbid vbid, int64_t seqno) {
                  vbid.get(),
                  "seqno",
                  seqno);
+    // Note: logically we should only have one Consumer per vBucket but
+    // we may keep around old Consumers with either no PassiveStream for
+    // this vBucket or a dead PassiveStream. We need to search the list of
+    // ConnHandlers for the Consumer with the alive PassiveStream for this
+    // vBucket.
     std::vector<std::shared_ptr<DcpConsumer>> conns;
-    { // Locking scope for vbConnsLocks[index]
-        size_t index = vbid.get() % vbConnLockNum;
-        std::lock_guard<std::mutex> lg(vbConnLocks[index]);
-
-        // Note: logically we should only have one Consumer per vBucket but
-        // we may keep around old Consumers with either no PassiveStream for
-        // this vBucket or a dead PassiveStream. We need to search the list of
-        // ConnHandlers for the Consumer with the alive PassiveStream for this
-        // vBucket.
-        for (auto& weakPtr : vbConns[vbid.get()]) {
-            auto connection = weakPtr.lock();
-            if (!connection) {
-                continue;
-            }
-            auto consumer = dynamic_pointer_cast<DcpConsumer>(connection);
-            if (consumer) {
-                // We need to search for the alive stream in the Consumers but
-                // can't do so inside the vbConnLock due to lock order inversion
-                // so store the Consumers for later processing.
-                conns.push_back(std::move(consumer));
-            }
+    const auto vb_conns = getVBConns(vbid);
+    for (const auto& weakPtr : *vb_conns) {
+        auto consumer = dynamic_pointer_cast<DcpConsumer>(weakPtr.lock());
+        if (consumer) {
+            conns.push_back(std::move(consumer));
         }
     }
 
@@ -21,6 +21,10 @@
 #include "dcp/consumer.h"
 #include "ep_engine.h"
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 DcpFlowControlManager::DcpFlowControlManager(EventuallyPersistentEngine &engine)
     : engine_(engine)
 {
@@ -223,3 +227,113 @@ void DcpFlowControlManagerAggressive::resizeBuffers_UNLOCKED(size_t bufferSize)
         iter.second->setFlowControlBufSize(bufferSize);
     }
 }
+
+DcpFlowControlManagerAdaptive::DcpFlowControlManagerAdaptive(
+        EventuallyPersistentEngine& engine)
+    : DcpFlowControlManager(engine),
+      dcpConnBufferSizeAggrFrac(
+              static_cast<double>(engine.getConfiguration()
+                                          .getDcpConnBufferSizeAggressivePerc()) /
+              100),
+      lastResize(std::chrono::steady_clock::now()) {
+}
+
+size_t DcpFlowControlManagerAdaptive::newConsumerConn(
+        DcpConsumer* consumerConn) {
+    std::lock_guard<std::mutex> lh(dcpConsumersMapMutex);
+
+    if (consumerConn == nullptr) {
+        throw std::invalid_argument(
+                "DcpFlowControlManagerAdaptive::newConsumerConn: resp is "
+                "NULL");
+    }
+
+    // Nothing is known about the new connection yet; start it with an equal
+    // share of the cap, and size it properly once it has been measured.
+    size_t bufferSize =
+            (dcpConnBufferSizeAggrFrac * engine_.getEpStats().getMaxDataSize()) /
+            (dcpConsumersMap.size() + 1);
+    setBufSizeWithinBounds(consumerConn, bufferSize);
+    EP_LOG_DEBUG("{} Conn flow control buffer is {}",
+                 consumerConn->logHeader(),
+                 bufferSize);
+
+    dcpConsumersMap[consumerConn->getCookie()] = consumerConn;
+    return bufferSize;
+}
+
+void DcpFlowControlManagerAdaptive::handleDisconnect(
+        DcpConsumer* consumerConn) {
+    std::lock_guard<std::mutex> lh(dcpConsumersMapMutex);
+    dcpConsumersMap.erase(consumerConn->getCookie());
+}
+
+bool DcpFlowControlManagerAdaptive::isEnabled() const {
+    return true;
+}
+
+void DcpFlowControlManagerAdaptive::handleDrainRateSample() {
+    std::lock_guard<std::mutex> lh(dcpConsumersMapMutex);
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastResize < std::chrono::seconds(1)) {
+        return;
+    }
+    lastResize = now;
+    resizeBuffers_UNLOCKED();
+}
+
+void DcpFlowControlManagerAdaptive::resizeBuffers() {
+    std::lock_guard<std::mutex> lh(dcpConsumersMapMutex);
+    lastResize = std::chrono::steady_clock::now();
+    resizeBuffers_UNLOCKED();
+}
+
+void DcpFlowControlManagerAdaptive::resizeBuffers_UNLOCKED() {
+    const size_t minSize = engine_.getConfiguration().getDcpConnBufferSize();
+    const size_t cap =
+            dcpConnBufferSizeAggrFrac * engine_.getEpStats().getMaxDataSize();
+
+    struct Wanted {
+        DcpConsumer* consumer;
+        size_t size;
+        const char* reason;
+    };
+    std::vector<Wanted> wanted;
+    wanted.reserve(dcpConsumersMap.size());
+    size_t total = 0;
+    for (const auto& entry : dcpConsumersMap) {
+        auto& flowControl = entry.second->getFlowControl();
+        const uint64_t bdp = flowControl.getDrainRate() *
+                             flowControl.getRtt().count() / 1000000;
+        if (2 * bdp > minSize) {
+            wanted.push_back({entry.second, size_t(2 * bdp), "bdp"});
+        } else {
+            wanted.push_back({entry.second, minSize, "min"});
+        }
+        total += wanted.back().size;
+    }
+
+    const double scale = (total > cap) ? double(cap) / total : 1.0;
+    for (auto& w : wanted) {
+        if (scale < 1.0 && w.size > minSize) {
+            w.size = std::max(minSize, size_t(w.size * scale));
+            w.reason = "capped";
+        }
+
+        // The buffer size is sent to the producer as a uint32
+        w.size = std::min(w.size, size_t(std::numeric_limits<uint32_t>::max()));
+
+        // Avoid a DCP_CONTROL message for every small change.
+        const size_t current = w.consumer->getFlowControlBufSize();
+        const size_t delta = (w.size > current) ? w.size - current
+                                                : current - w.size;
+        if (delta > current / 8) {
+            EP_LOG_DEBUG("{} Conn flow control buffer is {} ({})",
+                         w.consumer->logHeader(),
+                         w.size,
+                         w.reason);
+            w.consumer->getFlowControl().setFlowControlBufSize(
+                    uint32_t(w.size), w.reason);
+        }
+    }
+}
@@ -19,6 +19,7 @@
 #include "memcached/types.h"
 
 #include <atomic>
+#include <chrono>
 #include <map>
 #include <mutex>
 
@@ -51,6 +52,15 @@ public:
     /* Will indicate if flow control is enabled */
     virtual bool isEnabled(void) const;
 
+    /* Should consumers measure their drain rate and RTT for this policy? */
+    virtual bool usesDrainRate() const {
+        return false;
+    }
+
+    /* To be called when a consumer has taken a new drain rate sample */
+    virtual void handleDrainRateSample() {
+    }
+
 protected:
     void setBufSizeWithinBounds(DcpConsumer *consumerConn, size_t &bufSize);
 
@@ -130,3 +140,55 @@ private:
     /* Fraction of memQuota for all dcp consumer connection buffers */
     std::atomic<double> dcpConnBufferSizeAggrFrac;
 };
+
+/**
+ * In this policy each flow control buffer is sized from how quickly the
+ * consumer drains it, rather than from the number of consumers: twice the
+ * bandwidth-delay product, where the bandwidth is the consumer's recent
+ * drain rate and the delay the round trip time of a DCP_CONTROL message to
+ * its producer. A connection whose throughput is limited by its window
+ * measures a drain rate of window / RTT, so its window doubles each time
+ * the buffers are resized until the consumer (or the network) rather than
+ * the window is the limit; a consumer which isn't keeping up, or is close
+ * to its producer, is given the minimum (dcp_conn_buffer_size).
+ *
+ * The total of all buffers is capped at a percentage
+ * (dcp_conn_buffer_size_aggressive_perc) of the bucket memory quota; if the
+ * wanted sizes exceed that they are all scaled down proportionally (but not
+ * below the minimum). Buffers are resized at most once a second, and only
+ * if the size changes by more than an eighth.
+ */
+class DcpFlowControlManagerAdaptive : public DcpFlowControlManager {
+public:
+    DcpFlowControlManagerAdaptive(EventuallyPersistentEngine& engine);
+
+    size_t newConsumerConn(DcpConsumer* consumerConn) override;
+
+    void handleDisconnect(DcpConsumer* consumerConn) override;
+
+    bool isEnabled() const override;
+
+    bool usesDrainRate() const override {
+        return true;
+    }
+
+    void handleDrainRateSample() override;
+
+    /**
+     * Resize all flow control buffers from their consumers' current drain
+     * rates and RTTs.
+     */
+    void resizeBuffers();
+
+private:
+    void resizeBuffers_UNLOCKED();
+
+    /* Mutex to ensure dcpConsumersMap is thread safe */
+    std::mutex dcpConsumersMapMutex;
+    /* All DCP Consumers with flow control buffer */
+    std::map<const void*, DcpConsumer*> dcpConsumersMap;
+    /* Fraction of memQuota for all dcp consumer connection buffers */
+    const double dcpConnBufferSizeAggrFrac;
+    /* When the buffers were last resized */
+    std::chrono::steady_clock::time_point lastResize;
+};
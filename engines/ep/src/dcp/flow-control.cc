@@ -34,6 +34,8 @@ FlowControl::FlowControl(EventuallyPersistentEngine &engine,
 {
     enabled = engine.getDcpFlowControlManager().isEnabled();
     if (enabled) {
+        measureDrain = engine.getDcpFlowControlManager().usesDrainRate();
+        lastDrainSample = std::chrono::steady_clock::now();
         bufferSize =
                     engine.getDcpFlowControlManager().newConsumerConn(consumer);
     }
@@ -49,6 +51,9 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
 {
     if (enabled) {
         ENGINE_ERROR_CODE ret;
+        if (measureDrain) {
+            maybeSampleDrainRate();
+        }
         uint32_t ackable_bytes = freedBytes.load();
         std::unique_lock<std::mutex> lh(bufferSizeLock);
         if (pendingControl) {
@@ -57,6 +62,11 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
             lh.unlock();
             uint64_t opaque = consumerConn->incrOpaqueCounter();
             const std::string &controlMsgKey = consumerConn->getControlMsgKey();
+            if (measureDrain) {
+                // Time the round trip of the control message.
+                rttSendTime = std::chrono::steady_clock::now();
+                rttOpaque = uint32_t(opaque);
+            }
             NonBucketAllocationGuard guard;
             ret = producers->control(opaque, controlMsgKey, buf_size);
             return ret;
@@ -107,6 +117,48 @@ void FlowControl::setFlowControlBufSize(uint32_t newSize)
     }
 }
 
+void FlowControl::setFlowControlBufSize(uint32_t newSize, const char* reason) {
+    bufSizeReason = reason;
+    setFlowControlBufSize(newSize);
+}
+
+void FlowControl::handleControlResponse(uint32_t opaque) {
+    if (!measureDrain || opaque == 0 || rttOpaque != opaque) {
+        return;
+    }
+    rttOpaque = 0;
+    const uint64_t sample =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - rttSendTime)
+                    .count();
+    // Smooth as TCP does (RFC 6298), giving the new sample a weight of 1/8.
+    const auto previous = rttUs.load();
+    rttUs = previous ? (previous * 7 + sample) / 8 : sample;
+}
+
+void FlowControl::maybeSampleDrainRate() {
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = now - lastDrainSample;
+    if (elapsed < std::chrono::seconds(1)) {
+        return;
+    }
+
+    // Bytes freed in total (acked, or waiting to be).
+    const uint64_t freed = ackedBytes.load() + freedBytes.load();
+    const uint64_t sample =
+            (freed - lastDrainSampleBytes) * 1000000 /
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                    .count();
+    lastDrainSample = now;
+    lastDrainSampleBytes = freed;
+
+    // Weight the new sample 1/4, so the rate follows changes within a few
+    // seconds without jumping on every sample.
+    drainRate = (drainRate.load() * 3 + sample) / 4;
+
+    engine_.getDcpFlowControlManager().handleDrainRateSample();
+}
+
 bool FlowControl::isBufferSufficientlyDrained() {
     std::lock_guard<std::mutex> lh(bufferSizeLock);
     return isBufferSufficientlyDrained_UNLOCKED(freedBytes.load());
@@ -120,4 +172,10 @@ void FlowControl::addStats(const AddStatFn& add_stat, const void* c) {
     consumerConn->addStat("total_acked_bytes", ackedBytes, add_stat, c);
     consumerConn->addStat("max_buffer_bytes", bufferSize, add_stat, c);
     consumerConn->addStat("unacked_bytes", freedBytes, add_stat, c);
+    if (measureDrain) {
+        consumerConn->addStat("drain_rate", drainRate, add_stat, c);
+        consumerConn->addStat("rtt_us", rttUs, add_stat, c);
+        consumerConn->addStat(
+                "max_buffer_bytes_reason", bufSizeReason.load(), add_stat, c);
+    }
 }
@@ -21,6 +21,8 @@
 
 #include <relaxed_atomic.h>
 
+#include <chrono>
+
 class DcpConsumer;
 class EventuallyPersistentEngine;
 
@@ -53,11 +55,41 @@ public:
         return freedBytes.load();
     }
 
+    /**
+     * Set the buffer size, recording why it is that size (reported in the
+     * connection's stats).
+     */
+    void setFlowControlBufSize(uint32_t newSize, const char* reason);
+
+    /**
+     * To be called with the response to a DCP_CONTROL message sent by the
+     * consumer; used to measure the round trip time to the producer.
+     */
+    void handleControlResponse(uint32_t opaque);
+
+    /// @return the (smoothed) rate the consumer frees buffer bytes, in bytes
+    ///         per second. Only measured if the policy uses it.
+    uint64_t getDrainRate() const {
+        return drainRate.load();
+    }
+
+    /// @return the (smoothed) round trip time of a DCP_CONTROL message to
+    ///         the producer. Only measured if the policy uses it.
+    std::chrono::microseconds getRtt() const {
+        return std::chrono::microseconds(rttUs.load());
+    }
+
 private:
     void setBufSizeWithinBounds(size_t &bufSize);
 
     bool isBufferSufficientlyDrained_UNLOCKED(uint32_t ackable_bytes);
 
+    /**
+     * Update the drain rate if at least a second has passed since it was
+     * last sampled, and if so tell the flow control manager.
+     */
+    void maybeSampleDrainRate();
+
     /* Associated consumer connection handler */
     DcpConsumer* consumerConn;
 
@@ -85,4 +117,22 @@ private:
 
     /* Bytes processed from the flow control buffer */
     std::atomic<uint64_t> freedBytes;
+
+    /* Does the flow control policy need the drain rate and RTT measured? */
+    bool measureDrain = false;
+
+    /* When, and after how many freed bytes, the drain rate was last sampled */
+    std::chrono::steady_clock::time_point lastDrainSample;
+    uint64_t lastDrainSampleBytes = 0;
+
+    std::atomic<uint64_t> drainRate{0};
+
+    /* The opaque and send time of the DCP_CONTROL message being timed */
+    std::atomic<uint32_t> rttOpaque{0};
+    std::chrono::steady_clock::time_point rttSendTime;
+
+    std::atomic<uint64_t> rttUs{0};
+
+    /* Why the buffer size was last changed */
+    std::atomic<const char*> bufSizeReason{"initial"};
 };
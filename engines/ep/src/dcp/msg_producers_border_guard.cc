@@ -242,3 +242,11 @@ ENGINE_ERROR_CODE DcpMsgProducersBorderGuard::abort(uint32_t opaque,
     NonBucketAllocationGuard guard;
     return guarded.abort(opaque, vbucket, key, prepared_seqno, abort_seqno);
 }
+ENGINE_ERROR_CODE DcpMsgProducersBorderGuard::seqno_advanced(
+        uint32_t opaque,
+        Vbid vbucket,
+        uint64_t seqno,
+        cb::mcbp::DcpStreamId sid) {
+    NonBucketAllocationGuard guard;
+    return guarded.seqno_advanced(opaque, vbucket, seqno, sid);
+}
@@ -150,6 +150,11 @@ public:
                             uint64_t prepared_seqno,
                             uint64_t abort_seqno) override;
 
+    ENGINE_ERROR_CODE seqno_advanced(uint32_t opaque,
+                                     Vbid vbucket,
+                                     uint64_t seqno,
+                                     cb::mcbp::DcpStreamId sid) override;
+
 private:
     /// The DCP message producers we are guarding.
     dcp_message_producers& guarded;
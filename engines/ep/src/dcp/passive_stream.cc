@@ -23,6 +23,7 @@
 #include "dcp/response.h"
 #include "ep_engine.h"
 #include "failover-table.h"
+#include "hlc.h"
 #include "kv_bucket.h"
 #include "replicationthrottle.h"
 #include "statwriter.h"
@@ -171,6 +172,16 @@ bool PassiveStream::isPending() const {
     return state_ == StreamState::Pending;
 }
 
+void PassiveStream::processNoop() {
+    if (state_ != StreamState::Reading || !buffer.empty()) {
+        return;
+    }
+    auto vb = engine->getVBucket(vb_);
+    if (vb && uint64_t(vb->getHighSeqno()) >= cur_snapshot_end.load()) {
+        vb->setReplicaInSync();
+    }
+}
+
 void PassiveStream::acceptStream(cb::mcbp::Status status, uint32_t add_opaque) {
     VBucketPtr vb = engine->getVBucket(vb_);
     if (!vb) {
@@ -370,6 +381,7 @@ ENGINE_ERROR_CODE PassiveStream::messageReceived(
             case DcpResponse::Event::StreamReq:
             case DcpResponse::Event::AddStream:
             case DcpResponse::Event::SeqnoAcknowledgement:
+            case DcpResponse::Event::SeqnoAdvanced:
                 // These are invalid events for this path, they are handled by
                 // the DcpConsumer class
                 throw std::invalid_argument(
@@ -389,6 +401,8 @@ ENGINE_ERROR_CODE PassiveStream::messageReceived(
             }
 
             if (ret != ENGINE_TMPFAIL && ret != ENGINE_ENOMEM) {
+                engine->getReplicationThrottle().processed(
+                        dcpResponse->getMessageSize());
                 return ret;
             }
         }
@@ -486,6 +500,7 @@ process_items_error_t PassiveStream::processBufferedMessages(
         case DcpResponse::Event::StreamReq:
         case DcpResponse::Event::AddStream:
         case DcpResponse::Event::SeqnoAcknowledgement:
+        case DcpResponse::Event::SeqnoAdvanced:
             // These are invalid events for this path, they are handled by the
             // DcpConsumer class
             throw std::invalid_argument(
@@ -687,12 +702,25 @@ ENGINE_ERROR_CODE PassiveStream::processMessage(
             taskToString[messageType],
             message->getItem()->getBySeqno());
     } else {
+        if (cur_snapshot_type.load() == Snapshot::Memory) {
+            recordApplyDelay(message->getItem()->getCas());
+        }
         handleSnapshotEnd(vb, *message->getBySeqno());
     }
 
     return ret;
 }
 
+void PassiveStream::recordApplyDelay(uint64_t cas) {
+    const auto delay = std::chrono::duration_cast<std::chrono::microseconds>(
+            HLC::getAge(cas));
+    engine->getEpStats().replicationApplyDelayHisto.add(delay);
+
+    const uint64_t delayUs = delay.count();
+    applyDelayLastUs.store(delayUs);
+    atomic_setIfBigger(applyDelayMaxUs, delayUs);
+}
+
 ENGINE_ERROR_CODE PassiveStream::processMutation(
         MutationConsumerMessage* mutation) {
     return processMessage(mutation, MessageType::Mutation);
@@ -929,6 +957,9 @@ void PassiveStream::processMarker(SnapshotMarker* marker) {
 
     cur_snapshot_start.store(marker->getStartSeqno());
     cur_snapshot_end.store(marker->getEndSeqno());
+    if (vb) {
+        vb->setLastKnownActiveSeqno(marker->getEndSeqno());
+    }
     cur_snapshot_type.store((marker->getFlags() & MARKER_FLAG_DISK)
                                     ? Snapshot::Disk
                                     : Snapshot::Memory);
@@ -995,6 +1026,7 @@ void PassiveStream::handleSnapshotEnd(VBucketPtr& vb, uint64_t byseqno) {
                  "seqno",
                  byseqno);
     if (byseqno == cur_snapshot_end.load()) {
+        vb->setReplicaInSync();
         if (cur_snapshot_type.load() == Snapshot::Disk) {
             vb->setReceivingInitialDiskSnapshot(false);
         }
@@ -1095,6 +1127,18 @@ void PassiveStream::addStats(const AddStatFn& add_stat, const void* c) {
                          name_.c_str(),
                          vb_.get());
         add_casted_stat(buf, cur_snapshot_prepare.load(), add_stat, c);
+        checked_snprintf(buf,
+                         bsize,
+                         "%s:stream_%d_apply_delay_last_us",
+                         name_.c_str(),
+                         vb_.get());
+        add_casted_stat(buf, applyDelayLastUs.load(), add_stat, c);
+        checked_snprintf(buf,
+                         bsize,
+                         "%s:stream_%d_apply_delay_max_us",
+                         name_.c_str(),
+                         vb_.get());
+        add_casted_stat(buf, applyDelayMaxUs.load(), add_stat, c);
 
         auto stream_req_value = createStreamReqValue();
 
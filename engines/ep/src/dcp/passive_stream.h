@@ -78,6 +78,14 @@ public:
     /// @Returns true if state_ is Pending
     bool isPending() const;
 
+    /**
+     * Called when the consumer receives a noop from the producer. As the
+     * producer sends the noop after everything it has sent earlier, the
+     * vBucket is in sync with the active if we've processed the full
+     * snapshot (and nothing is buffered).
+     */
+    void processNoop();
+
     /**
      * Place a StreamRequest message into the readyQueue, requesting a DCP
      * stream for the given UUID.
@@ -210,6 +218,12 @@ protected:
 
     void handleSnapshotEnd(VBucketPtr& vb, uint64_t byseqno);
 
+    /**
+     * Record the replication apply delay of an item with the given (HLC)
+     * CAS, which has just been applied.
+     */
+    void recordApplyDelay(uint64_t cas);
+
     virtual void processMarker(SnapshotMarker* marker);
 
     void processSetVBucketState(SetVBucketState* state);
@@ -268,6 +282,15 @@ protected:
     // front-end threads.
     std::atomic<bool> cur_snapshot_prepare;
 
+    // Replication apply delay of the most recently applied (in-memory
+    // snapshot) mutation, and the maximum seen by this stream; the time from
+    // the mutation being made on the active (the physical part of its HLC
+    // CAS) until it was applied here. Disk snapshots are excluded as they
+    // carry older, de-duplicated items. The distribution over all streams is
+    // EPStats::replicationApplyDelayHisto.
+    std::atomic<uint64_t> applyDelayLastUs{0};
+    std::atomic<uint64_t> applyDelayMaxUs{0};
+
     // To keep the collections manifest for the Replica consistent we cannot
     // allow it to stream from an Active that is behind in terms of the
     // collections manifest. Send the collections manifest uid to the Active
@@ -170,6 +170,7 @@ DcpProducer::DcpProducer(EventuallyPersistentEngine& e,
       lastSendTime(ep_current_time()),
       log(*this),
       backfillMgr(std::make_shared<BackfillManager>(engine_)),
+      ready(e.getConfiguration().getMaxVbuckets()),
       streams(streamsMapSize),
       itemsSent(0),
       totalBytesSent(0),
@@ -261,11 +262,10 @@ DcpProducer::~DcpProducer() {
 
 void DcpProducer::cancelCheckpointCreatorTask() {
     LockHolder guard(checkpointCreator->mutex);
-    if (checkpointCreator->task) {
-        static_cast<ActiveStreamCheckpointProcessorTask*>(
-                checkpointCreator->task.get())
+    for (const auto& task : checkpointCreator->tasks) {
+        static_cast<ActiveStreamCheckpointProcessorTask*>(task.get())
                 ->cancelTask();
-        ExecutorPool::get()->cancel(checkpointCreator->task->getId());
+        ExecutorPool::get()->cancel(task->getId());
     }
 }
 
@@ -488,7 +488,7 @@ ENGINE_ERROR_CODE DcpProducer::streamRequest(
            the stream creation fails later on in the func. The goal is to
            create the 'checkpointProcessorTask' before any valid active stream
            is created */
-        if (createChkPtProcessorTsk && !checkpointCreator->task) {
+        if (createChkPtProcessorTsk && checkpointCreator->tasks.empty()) {
             createCheckpointProcessorTask();
             scheduleCheckpointProcessorTask();
         }
@@ -770,6 +770,14 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
                     s->getOpaque(), s->getVBucket(), s->getState());
             break;
         }
+        case DcpResponse::Event::SeqnoAdvanced: {
+            auto* s = static_cast<SeqnoAdvanced*>(resp.get());
+            ret = producers->seqno_advanced(s->getOpaque(),
+                                            s->getVbucket(),
+                                            *s->getBySeqno(),
+                                            resp->getStreamId());
+            break;
+        }
         case DcpResponse::Event::SystemEvent: {
             SystemEventProducerMessage* s =
                     static_cast<SystemEventProducerMessage*>(resp.get());
@@ -976,6 +984,9 @@ ENGINE_ERROR_CODE DcpProducer::control(uint32_t opaque,
         }
         multipleStreamRequests = MultipleStreamRequests::Yes;
         return ENGINE_SUCCESS;
+    } else if (key == "enable_out_of_order_snapshots") {
+        outOfOrderSnapshots = valueStr == "true";
+        return ENGINE_SUCCESS;
     } else if (key == "enable_sync_writes") {
         if (valueStr == "true") {
             supportsSyncReplication = SyncReplication::SyncWrites;
@@ -1105,7 +1116,8 @@ bool DcpProducer::handleResponse(const protocol_binary_response_header* resp) {
                opcode == cb::mcbp::ClientOpcode::DcpSystemEvent ||
                opcode == cb::mcbp::ClientOpcode::DcpCommit ||
                opcode == cb::mcbp::ClientOpcode::DcpPrepare ||
-               opcode == cb::mcbp::ClientOpcode::DcpAbort) {
+               opcode == cb::mcbp::ClientOpcode::DcpAbort ||
+               opcode == cb::mcbp::ClientOpcode::DcpSeqnoAdvanced) {
         // The consumer could of closed the stream, enoent is expected, but
         // any other errors are not expected.
         if (resp->response.getStatus() == cb::mcbp::Status::KeyEnoent) {
@@ -1272,6 +1284,7 @@ void DcpProducer::addStats(const AddStatFn& add_stat, const void* c) {
             multipleStreamRequests == MultipleStreamRequests::Yes,
             add_stat,
             c);
+    addStat("out_of_order_snapshots", outOfOrderSnapshots, add_stat, c);
     addStat("synchronous_replication", isSyncReplicationEnabled(), add_stat, c);
     addStat("synchronous_writes", isSyncWritesEnabled(), add_stat, c);
 
@@ -1283,14 +1296,8 @@ void DcpProducer::addStats(const AddStatFn& add_stat, const void* c) {
 
     log.addStats(add_stat, c);
 
-    ExTask pointerCopy;
-    { // Locking scope
-        LockHolder guard(checkpointCreator->mutex);
-        pointerCopy = checkpointCreator->task;
-    }
-
-    if (pointerCopy) {
-        static_cast<ActiveStreamCheckpointProcessorTask*>(pointerCopy.get())
+    for (const auto& task : getCheckpointProcessorTasks()) {
+        static_cast<ActiveStreamCheckpointProcessorTask*>(task.get())
                 ->addStats(getName(), add_stat, c);
     }
 
@@ -1510,7 +1517,7 @@ std::unique_ptr<DcpResponse> DcpProducer::getNextItem() {
         unPause();
 
         Vbid vbucket = Vbid(0);
-        while (ready.popFront(vbucket)) {
+        while (popReadyVBucket(vbucket)) {
             if (log.pauseIfFull()) {
                 ready.pushUnique(vbucket);
                 return NULL;
@@ -1549,6 +1556,7 @@ std::unique_ptr<DcpResponse> DcpProducer::getNextItem() {
                         case DcpResponse::Event::StreamEnd:
                         case DcpResponse::Event::SetVbucket:
                         case DcpResponse::Event::SystemEvent:
+                        case DcpResponse::Event::SeqnoAdvanced:
                             break;
                         default:
                             throw std::logic_error(
@@ -1578,6 +1586,18 @@ std::unique_ptr<DcpResponse> DcpProducer::getNextItem() {
     return nullptr;
 }
 
+bool DcpProducer::popReadyVBucket(Vbid& vbucket) {
+    if (readyBatchPos == readyBatch.size()) {
+        readyBatch.clear();
+        readyBatchPos = 0;
+        if (ready.popFront(readyBatch, readyBatchSize) == 0) {
+            return false;
+        }
+    }
+    vbucket = readyBatch[readyBatchPos++];
+    return true;
+}
+
 void DcpProducer::setDisconnect() {
     ConnHandler::setDisconnect();
     std::for_each(
@@ -1718,27 +1738,40 @@ bool DcpProducer::bufferLogInsert(size_t bytes) {
 }
 
 void DcpProducer::createCheckpointProcessorTask() {
+    const auto numTasks = engine_.getConfiguration()
+                                  .getDcpProducerCheckpointProcessorTasks();
     LockHolder guard(checkpointCreator->mutex);
-    checkpointCreator->task =
-            std::make_shared<ActiveStreamCheckpointProcessorTask>(
-                    engine_, shared_from_this());
+    checkpointCreator->tasks.clear();
+    for (size_t shard = 0; shard < numTasks; ++shard) {
+        checkpointCreator->tasks.push_back(
+                std::make_shared<ActiveStreamCheckpointProcessorTask>(
+                        engine_, shared_from_this(), shard));
+    }
 }
 
 void DcpProducer::scheduleCheckpointProcessorTask() {
     LockHolder guard(checkpointCreator->mutex);
-    ExecutorPool::get()->schedule(checkpointCreator->task);
+    for (const auto& task : checkpointCreator->tasks) {
+        ExecutorPool::get()->schedule(task);
+    }
 }
 
 void DcpProducer::scheduleCheckpointProcessorTask(
         std::shared_ptr<ActiveStream> s) {
     LockHolder guard(checkpointCreator->mutex);
-    if (!checkpointCreator->task) {
+    const auto& tasks = checkpointCreator->tasks;
+    if (tasks.empty()) {
         throw std::logic_error(
                 "DcpProducer::scheduleCheckpointProcessorTask task is null");
     }
-    static_cast<ActiveStreamCheckpointProcessorTask*>(
-            checkpointCreator->task.get())
-            ->schedule(s);
+    // Always schedule a vBucket on the same task; others may still steal it.
+    const auto& task = tasks[s->getVBucket().get() % tasks.size()];
+    static_cast<ActiveStreamCheckpointProcessorTask*>(task.get())->schedule(s);
+}
+
+std::vector<ExTask> DcpProducer::getCheckpointProcessorTasks() const {
+    LockHolder guard(checkpointCreator->mutex);
+    return checkpointCreator->tasks;
 }
 
 std::shared_ptr<StreamContainer<std::shared_ptr<Stream>>>
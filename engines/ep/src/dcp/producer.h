@@ -213,6 +213,11 @@ public:
         return enableExpiryOpcode;
     }
 
+    /// @return true if the client accepts disk snapshots in key order
+    bool isOutOfOrderSnapshotsEnabled() const {
+        return outOfOrderSnapshots;
+    }
+
     /**
      * Tracks the amount of outstanding sent data for a Dcp Producer, alongside
      * how many bytes have been acknowledged by the peer connection.
@@ -323,6 +328,9 @@ public:
     */
     void scheduleCheckpointProcessorTask(std::shared_ptr<ActiveStream> s);
 
+    /// @return the checkpoint processor tasks, one per shard.
+    std::vector<ExTask> getCheckpointProcessorTasks() const;
+
     /** Searches the streams map for a stream for vbucket ID. Returns the
      *  found stream, or an empty pointer if none found.
      */
@@ -354,13 +362,13 @@ protected:
     ENGINE_ERROR_CODE maybeSendNoop(struct dcp_message_producers* producers);
 
     /**
-     * Create the ActiveStreamCheckpointProcessorTask and assign to
-     * checkpointCreatorTask
+     * Create the ActiveStreamCheckpointProcessorTasks (one per shard) and
+     * assign to checkpointCreator->tasks
      */
     void createCheckpointProcessorTask();
 
     /**
-     * Schedule the checkpointCreatorTask on the ExecutorPool
+     * Schedule the checkpointCreator->tasks on the ExecutorPool
      */
     void scheduleCheckpointProcessorTask();
 
@@ -384,6 +392,15 @@ protected:
 
     std::unique_ptr<DcpResponse> getNextItem();
 
+    /**
+     * Get the next vbucket to visit in getNextItem. The vbuckets are popped
+     * from the ready queue in batches (of up to readyBatchSize) to reduce
+     * the number of atomic operations on the queue.
+     *
+     * @return false if there is no ready vbucket
+     */
+    bool popReadyVBucket(Vbid& vbucket);
+
     size_t getItemsRemaining();
 
     /**
@@ -541,6 +558,14 @@ protected:
 
     VBReadyQueue ready;
 
+    /// The number of vbuckets popped from the ready queue at a time
+    static const size_t readyBatchSize = 32;
+
+    /// The vbuckets popped from the ready queue which getNextItem hasn't
+    /// visited yet (from readyBatchPos and out)
+    std::vector<Vbid> readyBatch;
+    size_t readyBatchPos = 0;
+
     /**
      * Folly's AtomicHashMap offers great performance if you know the maximum
      * size of the map up front and don't care about freeing memory when you
@@ -566,11 +591,12 @@ protected:
     std::atomic<size_t> totalBytesSent;
     std::atomic<size_t> totalUncompressedDataSize;
 
-    /// Guards access to checkpointCreatorTask, so multiple threads can
-    /// safely access  checkpointCreatorTask shared ptr.
+    /// Guards access to the checkpoint processor tasks, so multiple threads
+    /// can safely access the tasks' shared ptrs.
     struct CheckpointCreator {
         mutable std::mutex mutex;
-        ExTask task;
+        /// One task per shard (dcp_producer_checkpoint_processor_tasks).
+        std::vector<ExTask> tasks;
     };
 
     // MB-30488: padding to keep mutex from sharing cachelines with
@@ -602,4 +628,10 @@ protected:
      * per vbucket (client must enable this feature)
      */
     MultipleStreamRequests multipleStreamRequests{MultipleStreamRequests::No};
+
+    /**
+     * Does the client accept the items of a disk snapshot in key order
+     * (enable_out_of_order_snapshots)
+     */
+    cb::RelaxedAtomic<bool> outOfOrderSnapshots{false};
 };
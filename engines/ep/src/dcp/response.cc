@@ -61,6 +61,8 @@ const char* DcpResponse::to_string() const {
         return "system event";
     case Event::SeqnoAcknowledgement:
         return "seqno acknowledgement";
+    case Event::SeqnoAdvanced:
+        return "seqno advanced";
     }
     throw std::logic_error(
         "DcpResponse::to_string(): " + std::to_string(int(event_)));
@@ -43,6 +43,7 @@ public:
         AddStream,
         SystemEvent,
         SeqnoAcknowledgement,
+        SeqnoAdvanced,
     };
 
     DcpResponse(Event event, uint32_t opaque, cb::mcbp::DcpStreamId sid)
@@ -92,6 +93,7 @@ public:
         case Event::AddStream:
         case Event::SystemEvent:
         case Event::SeqnoAcknowledgement:
+        case Event::SeqnoAdvanced:
             return true;
         }
         throw std::invalid_argument(
@@ -614,6 +616,39 @@ private:
     cb::mcbp::request::DcpSeqnoAcknowledgedPayload payload;
 };
 
+/**
+ * Ends an out of sequence order snapshot: the stream has sent everything up to
+ * the given seqno (even if the last item sent had a lower one).
+ */
+class SeqnoAdvanced : public DcpResponse {
+public:
+    SeqnoAdvanced(uint32_t opaque,
+                  Vbid vbucket,
+                  uint64_t seqno,
+                  cb::mcbp::DcpStreamId sid)
+        : DcpResponse(Event::SeqnoAdvanced, opaque, sid),
+          vbucket(vbucket),
+          payload(seqno) {
+    }
+
+    OptionalSeqno getBySeqno() const override {
+        return OptionalSeqno{payload.getSeqno()};
+    }
+
+    uint32_t getMessageSize() const override {
+        return sizeof(protocol_binary_request_header) +
+               sizeof(cb::mcbp::request::DcpSeqnoAdvancedPayload);
+    }
+
+    Vbid getVbucket() const {
+        return vbucket;
+    }
+
+private:
+    Vbid vbucket;
+    cb::mcbp::request::DcpSeqnoAdvancedPayload payload;
+};
+
 /**
  * Represents the Commit of a prepared SyncWrite.
  */
@@ -84,6 +84,9 @@ bool DefragmenterTask::run(void) {
         if (engine->getConfiguration().getBucketType() == "persistent") {
             visitor.setStoredValueAgeThreshold(getStoredValueAgeThreshold());
         }
+        visitor.setSizeClasses(getSizeClasses(alloc_hooks,
+                                              stats.getMemoryArena(),
+                                              getSparseClassThreshold()));
         visitor.clearStats();
 
         // Do it - set off the visitor.
@@ -120,7 +123,9 @@ bool DefragmenterTask::run(void) {
                             end - start);
             ss << " Took " << duration.count() << " us."
                << " moved " << visitor.getDefragCount() << "/"
-               << visitor.getVisitedCount() << " visited documents."
+               << visitor.getVisitedCount() << " visited documents"
+               << " (skipped " << visitor.getSkippedCount()
+               << " in dense size classes)."
                << " mem_used=" << stats.getEstimatedTotalMemoryUsed()
                << ", mapped_bytes=" << getMappedBytes() << ". Sleeping for "
                << getSleepTime() << " seconds.";
@@ -171,11 +176,16 @@ size_t DefragmenterTask::getStoredValueAgeThreshold() const {
     return engine->getConfiguration().getDefragmenterStoredValueAgeThreshold();
 }
 
+size_t DefragmenterTask::getSparseClassThreshold() const {
+    return engine->getConfiguration().getDefragmenterSparseClassThreshold();
+}
+
 void DefragmenterTask::updateStats(DefragmentVisitor& visitor) {
     stats.defragNumMoved.fetch_add(visitor.getDefragCount());
     stats.defragStoredValueNumMoved.fetch_add(
             visitor.getStoredValueDefragCount());
     stats.defragNumVisited.fetch_add(visitor.getVisitedCount());
+    stats.defragNumSkipped.fetch_add(visitor.getSkippedCount());
 }
 
 size_t DefragmenterTask::getMaxValueSize(ServerAllocatorIface* alloc_hooks) {
@@ -194,6 +204,65 @@ size_t DefragmenterTask::getMaxValueSize(ServerAllocatorIface* alloc_hooks) {
     return largest_bin_size;
 }
 
+DefragSizeClasses DefragmenterTask::getSizeClasses(
+        ServerAllocatorIface* alloc_hooks, unsigned arena, size_t threshold) {
+    if (threshold >= 100) {
+        return {};
+    }
+
+    // jemalloc caches its statistics; get_allocator_stats refreshes them
+    allocator_stats allocStats = {0};
+    allocStats.ext_stats.resize(alloc_hooks->get_extra_stats_size());
+    alloc_hooks->get_allocator_stats(&allocStats);
+
+    size_t nbins{0};
+    if (!alloc_hooks->get_allocator_property("arenas.nbins", &nbins) ||
+        nbins == 0) {
+        return {};
+    }
+
+    // MALLCTL_ARENAS_ALL; the merged stats of all arenas
+    const uint64_t statsArena = arena == 0 ? 4096 : arena;
+    std::vector<size_t> sizes;
+    std::vector<bool> sparse;
+    sizes.reserve(nbins);
+    sparse.reserve(nbins);
+    char buff[64];
+    for (uint64_t bin = 0; bin < nbins; ++bin) {
+        size_t size{0};
+        size_t slabSize{0};
+        size_t curregs{0};
+        size_t curslabs{0};
+        snprintf(buff, sizeof(buff), "arenas.bin.%" PRIu64 ".size", bin);
+        bool ok = alloc_hooks->get_allocator_property(buff, &size);
+        snprintf(buff, sizeof(buff), "arenas.bin.%" PRIu64 ".slab_size", bin);
+        ok = ok && alloc_hooks->get_allocator_property(buff, &slabSize);
+        snprintf(buff,
+                 sizeof(buff),
+                 "stats.arenas.%" PRIu64 ".bins.%" PRIu64 ".curregs",
+                 statsArena,
+                 bin);
+        ok = ok && alloc_hooks->get_allocator_property(buff, &curregs);
+        snprintf(buff,
+                 sizeof(buff),
+                 "stats.arenas.%" PRIu64 ".bins.%" PRIu64 ".curslabs",
+                 statsArena,
+                 bin);
+        ok = ok && alloc_hooks->get_allocator_property(buff, &curslabs);
+        if (!ok || size == 0) {
+            return {};
+        }
+
+        const size_t capacity = curslabs * (slabSize / size);
+        sizes.push_back(size);
+        sparse.push_back(curregs * 100 < threshold * capacity);
+    }
+
+    return DefragSizeClasses(std::move(sizes),
+                             std::move(sparse),
+                             alloc_hooks->get_allocation_size);
+}
+
 std::chrono::milliseconds DefragmenterTask::getChunkDuration() const {
     return std::chrono::milliseconds(
             engine->getConfiguration().getDefragmenterChunkDuration());
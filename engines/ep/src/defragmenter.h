@@ -19,6 +19,7 @@
 #include "globaltask.h"
 #include "kv_bucket_iface.h"
 
+class DefragSizeClasses;
 class DefragmentVisitor;
 class EPStats;
 class PauseResumeVBAdapter;
@@ -84,6 +85,14 @@ class PauseResumeVBAdapter;
  * 2. Document size - Skip documents which are larger than the largest
  *    size class, or are zero-sized.
  *
+ * 3. Size class utilization - Before each chunk we read the number of
+ *    regions in use and the number of slabs of each of the small size
+ *    classes from jemalloc, and only move objects of the size classes
+ *    where the utilization is below defragmenter_sparse_class_threshold.
+ *    Moving an object of a dense size class can't release a slab, so
+ *    skipping them saves most of the copying when only a few classes are
+ *    fragmented.
+ *
  * An additional policy consideration is how to locate
  * candidate documents. In a large instance, the simple act of
  * visiting each element in the HashTable is a expensive operation -
@@ -110,6 +119,20 @@ public:
     /// Maximum allocation size the defragmenter should consider
     static size_t getMaxValueSize(ServerAllocatorIface* alloc_hooks);
 
+    /**
+     * Read the utilization of the allocator's small size classes.
+     *
+     * @param alloc_hooks the allocator to query
+     * @param arena the bucket's arena (0 to use the stats for all arenas)
+     * @param threshold size classes with a utilization (in percent) below
+     *        the threshold are considered sparse
+     * @return the size classes (all objects are considered sparse if the
+     *         allocator doesn't provide the stats, or the threshold is 100)
+     */
+    static DefragSizeClasses getSizeClasses(ServerAllocatorIface* alloc_hooks,
+                                            unsigned arena,
+                                            size_t threshold);
+
 private:
 
     /// Duration (in seconds) defragmenter should sleep for between iterations.
@@ -123,6 +146,10 @@ private:
     // must be to be considered for defragmentation.
     size_t getStoredValueAgeThreshold() const;
 
+    // Size classes with a utilization (percent) below the threshold are
+    // defragmented.
+    size_t getSparseClassThreshold() const;
+
     // Upper limit on how long each defragmention chunk can run for, before
     // being paused.
     std::chrono::milliseconds getChunkDuration() const;
@@ -17,6 +17,40 @@
 
 #include "defragmenter_visitor.h"
 
+#include <algorithm>
+#include <stdexcept>
+
+// DefragSizeClasses implementation //////////////////////////////////////////
+
+DefragSizeClasses::DefragSizeClasses(std::vector<size_t> sizes,
+                                     std::vector<bool> sparse,
+                                     size_t (*getAllocationSize)(const void*))
+    : sizes(std::move(sizes)),
+      sparse(std::move(sparse)),
+      getAllocationSize(getAllocationSize) {
+    if (this->sizes.size() != this->sparse.size()) {
+        throw std::invalid_argument(
+                "DefragSizeClasses: sizes and sparse must be the same size");
+    }
+}
+
+bool DefragSizeClasses::isSparse(const void* ptr) const {
+    if (sizes.empty() || getAllocationSize == nullptr) {
+        return true;
+    }
+    const auto size = getAllocationSize(ptr);
+    const auto it = std::lower_bound(sizes.begin(), sizes.end(), size);
+    if (it == sizes.end()) {
+        // Not one of the small size classes
+        return true;
+    }
+    return sparse[it - sizes.begin()];
+}
+
+size_t DefragSizeClasses::getNumSparse() const {
+    return std::count(sparse.begin(), sparse.end(), true);
+}
+
 // DegragmentVisitor implementation ///////////////////////////////////////////
 
 DefragmentVisitor::DefragmentVisitor(size_t max_size_class)
@@ -42,6 +76,10 @@ void DefragmentVisitor::setStoredValueAgeThreshold(uint8_t age) {
     sv_age_threshold = age;
 }
 
+void DefragmentVisitor::setSizeClasses(DefragSizeClasses classes) {
+    sizeClasses = std::move(classes);
+}
+
 bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
                               StoredValue& v) {
     const size_t value_len = v.valuelen();
@@ -58,8 +96,13 @@ bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
         // should be good enough.
         if (v.getValue()->getAge() >= age_threshold &&
             v.getValue().refCount() < 2) {
-            v.reallocate();
-            defrag_count++;
+            // Keep the age, so it's moved once the size class gets sparse
+            if (sizeClasses.isSparse(v.getValue().get())) {
+                v.reallocate();
+                defrag_count++;
+            } else {
+                skipped_count++;
+            }
         } else {
             v.getValue()->incrementAge();
         }
@@ -67,7 +110,11 @@ bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
 
     if (sv_age_threshold) {
         if (v.getAge() >= sv_age_threshold.get()) {
-            defragmentStoredValue(v);
+            if (sizeClasses.isSparse(&v)) {
+                defragmentStoredValue(v);
+            } else {
+                skipped_count++;
+            }
         } else {
             v.incrementAge();
         }
@@ -84,6 +131,7 @@ void DefragmentVisitor::clearStats() {
     defrag_count = 0;
     visited_count = 0;
     sv_defrag_count = 0;
+    skipped_count = 0;
 }
 
 size_t DefragmentVisitor::getDefragCount() const {
@@ -98,6 +146,10 @@ size_t DefragmentVisitor::getStoredValueDefragCount() const {
     return sv_defrag_count;
 }
 
+size_t DefragmentVisitor::getSkippedCount() const {
+    return skipped_count;
+}
+
 void DefragmentVisitor::setCurrentVBucket(VBucket& vb) {
     currentVb = &vb;
 }
@@ -22,6 +22,44 @@
 #include "vb_visitors.h"
 #include "vbucket.h"
 
+/**
+ * Which of the allocator's (small) size classes are sparse, i.e. have a
+ * utilization (the fraction of the regions in the size class' slabs which
+ * are in use) below a threshold. Moving an object of a dense size class
+ * just copies it into another (nearly) full slab without releasing any
+ * memory, so the defragmenter only moves objects of the sparse classes.
+ */
+class DefragSizeClasses {
+public:
+    /// Consider all size classes sparse (defragment everything)
+    DefragSizeClasses() = default;
+
+    /**
+     * @param sizes the size of each of the size classes (ascending)
+     * @param sparse if the size class at the same index is sparse
+     * @param getAllocationSize function returning the size of an allocation
+     */
+    DefragSizeClasses(std::vector<size_t> sizes,
+                      std::vector<bool> sparse,
+                      size_t (*getAllocationSize)(const void*));
+
+    /// @return true if the allocation is in a sparse size class
+    bool isSparse(const void* ptr) const;
+
+    /// @return the number of sparse size classes
+    size_t getNumSparse() const;
+
+    /// @return the number of size classes we know the utilization of
+    size_t size() const {
+        return sizes.size();
+    }
+
+private:
+    std::vector<size_t> sizes;
+    std::vector<bool> sparse;
+    size_t (*getAllocationSize)(const void*) = nullptr;
+};
+
 /**
  * Defragmentation visitor - visit all objects in a VBucket, compress the
  * documents and defragment any which have reached the specified age.
@@ -46,6 +84,12 @@ public:
      */
     void setStoredValueAgeThreshold(uint8_t age);
 
+    /**
+     * Set the size classes to defragment; objects of the other size classes
+     * are left where they are (by default all objects are defragmented)
+     */
+    void setSizeClasses(DefragSizeClasses classes);
+
     // Implementation of HashTableVisitor interface:
     virtual bool visit(const HashTable::HashBucketLock& lh,
                        StoredValue& v) override;
@@ -62,6 +106,10 @@ public:
     // Returns the number of StoredValues that have been defragmented.
     size_t getStoredValueDefragCount() const;
 
+    // Returns the number of documents and StoredValues old enough to be
+    // defragmented, which were skipped as their size class is dense.
+    size_t getSkippedCount() const;
+
     void setCurrentVBucket(VBucket& vb) override;
 
 private:
@@ -76,6 +124,9 @@ private:
     // How old a blob must be to consider it for defragmentation.
     uint8_t age_threshold{0};
 
+    // The size classes worth defragmenting.
+    DefragSizeClasses sizeClasses;
+
     /* Runtime state */
 
     // Estimates how far we have got, and when we should pause.
@@ -88,6 +139,8 @@ private:
     size_t visited_count;
     // How many stored-values have been defrag'd
     mutable size_t sv_defrag_count{0};
+    // How many objects were skipped as they are in a dense size class
+    mutable size_t skipped_count{0};
 
     // The current vbucket that is being processed
     VBucket* currentVb;
@@ -299,9 +299,27 @@ ENGINE_ERROR_CODE ActiveDurabilityMonitor::seqnoAckReceived(
     // just throws if an error occurs in the current implementation), so this
     // is a @todo.
 
-    // Identify all SyncWrites which are committed by this seqnoAck,
+    // Queue the ack, then process all of the queued acks in one pass under
+    // the State lock. Acks which arrive (from other replicas) while we wait
+    // for or hold the lock are processed by the same pass, so the cost of
+    // the State lock and of the resolvedQueue notification is paid once for
+    // the whole backlog.
+    {
+        auto acks = pendingSeqnoAcks.wlock();
+        auto it = acks->emplace(replica, preparedSeqno).first;
+        it->second = std::max(it->second, preparedSeqno);
+    }
+
+    // Identify all SyncWrites which are committed by the queued seqnoAcks,
     // transferring them into the resolvedQueue (under the correct locks).
-    state.wlock()->processSeqnoAck(replica, preparedSeqno, *resolvedQueue);
+    {
+        auto s = state.wlock();
+        std::unordered_map<std::string, int64_t> acks;
+        pendingSeqnoAcks.wlock()->swap(acks);
+        for (const auto& ack : acks) {
+            s->processSeqnoAck(ack.first, ack.second, *resolvedQueue);
+        }
+    }
 
     if (seqnoAckReceivedPostProcessHook) {
         seqnoAckReceivedPostProcessHook();
@@ -325,8 +343,14 @@ void ActiveDurabilityMonitor::processTimeout(
 
     // Identify SyncWrites which can be timed out as of this time point
     // and should be aborted, transferring them into the completedQeuue (under
-    // the correct locks).
-    state.wlock()->removeExpired(asOf, *resolvedQueue);
+    // the correct locks). Then schedule the next check for the (new) first
+    // SyncWrite, as the check that triggered this call has been consumed.
+    {
+        auto s = state.wlock();
+        s->removeExpired(asOf, *resolvedQueue);
+        s->scheduledTimeout.reset();
+        s->scheduleTimeoutForFirstSyncWrite();
+    }
 
     checkForResolvedSyncWrites();
 }
@@ -433,26 +457,34 @@ void ActiveDurabilityMonitor::processCompletedSyncWriteQueue() {
                  "ActiveDM::processCompletedSyncWriteQueue",
                  "vbid",
                  vb.getId().get());
-    std::lock_guard<ResolvedQueue::ConsumerLock> lock(
-            resolvedQueue->getConsumerLock());
-    while (auto sw = resolvedQueue->try_dequeue(lock)) {
-        switch (sw->getStatus()) {
-        case SyncWriteStatus::Pending:
-        case SyncWriteStatus::Completed:
-            throw std::logic_error(
-                    "ActiveDurabilityMonitor::processCompletedSyncWriteQueue "
-                    "found a SyncWrite with unexpected state: " +
-                    to_string(sw->getStatus()));
-            continue;
-        case SyncWriteStatus::ToCommit:
-            commit(*sw);
-            continue;
-        case SyncWriteStatus::ToAbort:
-            abort(*sw);
-            continue;
-        }
-        folly::assume_unreachable();
-    };
+    // All of the SyncWrites resolved so far are completed as a single batch;
+    // the flusher / DCP are notified once for the batch (rather than for
+    // every Commit / Abort), and the clients once all of them are completed.
+    SyncWriteCompletionBatch batch;
+    {
+        std::lock_guard<ResolvedQueue::ConsumerLock> lock(
+                resolvedQueue->getConsumerLock());
+        while (auto sw = resolvedQueue->try_dequeue(lock)) {
+            switch (sw->getStatus()) {
+            case SyncWriteStatus::Pending:
+            case SyncWriteStatus::Completed:
+                throw std::logic_error(
+                        "ActiveDurabilityMonitor::"
+                        "processCompletedSyncWriteQueue found a SyncWrite "
+                        "with unexpected state: " +
+                        to_string(sw->getStatus()));
+                continue;
+            case SyncWriteStatus::ToCommit:
+                commit(*sw, batch);
+                continue;
+            case SyncWriteStatus::ToAbort:
+                abort(*sw, batch);
+                continue;
+            }
+            folly::assume_unreachable();
+        };
+    }
+    vb.notifySyncWritesCompleted(batch);
 }
 
 void ActiveDurabilityMonitor::unresolveCompletedSyncWriteQueue() {
@@ -540,86 +572,113 @@ ActiveDurabilityMonitor::State::State(const ActiveDurabilityMonitor& adm)
     highCompletedSeqno.setLabel(prefix + "highCompletedSeqno");
 }
 
-ActiveDurabilityMonitor::Container::iterator
-ActiveDurabilityMonitor::State::getNodeNext(const std::string& node) {
+ActiveDurabilityMonitor::State::NodePositions
+ActiveDurabilityMonitor::State::getNodePositions(const std::string& node) {
     Expects(firstChain.get());
-    // Note: Container::end could be the new position when the pointed SyncWrite
-    //     is removed from Container and the iterator repositioned.
-    //     In that case next=Container::begin
+    NodePositions ret;
     auto firstChainItr = firstChain->positions.find(node);
     if (firstChainItr != firstChain->positions.end()) {
-        const auto& it = firstChainItr->second.it;
-        return (it == trackedWrites.end()) ? trackedWrites.begin()
-                                           : std::next(it);
+        ret.first = &firstChainItr->second;
     }
 
     if (secondChain) {
         auto secondChainItr = secondChain->positions.find(node);
         if (secondChainItr != secondChain->positions.end()) {
-            const auto& it = secondChainItr->second.it;
-            return (it == trackedWrites.end()) ? trackedWrites.begin()
-                                               : std::next(it);
+            ret.second = &secondChainItr->second;
         }
     }
+    return ret;
+}
+
+ActiveDurabilityMonitor::Container::iterator
+ActiveDurabilityMonitor::State::getNodeNext(const std::string& node) {
+    return getNodeNext(getNodePositions(node));
+}
+
+ActiveDurabilityMonitor::Container::iterator
+ActiveDurabilityMonitor::State::getNodeNext(const NodePositions& positions) {
+    // Note: Container::end could be the new position when the pointed SyncWrite
+    //     is removed from Container and the iterator repositioned.
+    //     In that case next=Container::begin
+    const auto* pos = positions.first ? positions.first : positions.second;
+    if (!pos) {
+        // Node not found, return the trackedWrites.end(), stl style.
+        return trackedWrites.end();
+    }
 
-    // Node not found, return the trackedWrites.end(), stl style.
-    return trackedWrites.end();
+    const auto& it = pos->it;
+    return (it == trackedWrites.end()) ? trackedWrites.begin() : std::next(it);
 }
 
 ActiveDurabilityMonitor::Container::iterator
 ActiveDurabilityMonitor::State::advanceNodePosition(const std::string& node) {
+    std::vector<std::chrono::microseconds> ackDurations;
+    const auto ackTime = std::chrono::steady_clock::now();
+    const auto it = advanceNodePosition(
+            getNodePositions(node), node, ackTime, ackDurations);
+    if (!ackDurations.empty()) {
+        auto histos = adm.stats.syncWriteReplicaAckTimes.wlock();
+        for (const auto& duration : ackDurations) {
+            (*histos)[node].add(duration);
+        }
+    }
+    return it;
+}
+
+ActiveDurabilityMonitor::Container::iterator
+ActiveDurabilityMonitor::State::advanceNodePosition(
+        const NodePositions& positions,
+        const std::string& node,
+        std::chrono::steady_clock::time_point ackTime,
+        std::vector<std::chrono::microseconds>& ackDurations) {
     // We must have at least a firstChain
     Expects(firstChain.get());
 
     // But the node may not be in it if we have a secondChain
-    auto firstChainItr = firstChain->positions.find(node);
-    auto firstChainFound = firstChainItr != firstChain->positions.end();
-    if (!firstChainFound && !secondChain) {
+    if (!positions.first && !secondChain) {
         // Attempting to advance for a node we don't know about, panic
         throwException<std::logic_error>(
                 __func__,
                 "Attempting to advance positions for an invalid node " + node);
     }
 
-    std::unordered_map<std::string, Position<Container>>::iterator
-            secondChainItr;
-    auto secondChainFound = false;
-    if (secondChain) {
-        secondChainItr = secondChain->positions.find(node);
-        secondChainFound = secondChainItr != secondChain->positions.end();
-        if (!firstChainFound && !secondChainFound) {
-            throwException<std::logic_error>(
-                    __func__,
-                    "Attempting to advance positions for an invalid node " +
-                            node +
-                            ". Node is not in firstChain or secondChain");
-        }
+    if (!positions.first && !positions.second) {
+        throwException<std::logic_error>(
+                __func__,
+                "Attempting to advance positions for an invalid node " + node +
+                        ". Node is not in firstChain or secondChain");
     }
 
     // Node may be in both chains (or only one) so we need to advance only the
     // correct chain.
-    if (firstChainFound) {
-        auto& pos = const_cast<Position<Container>&>(firstChainItr->second);
+    if (positions.first) {
         // We only ack if we do not have this node in the secondChain because
         // we only want to ack once
-        advanceAndAckForPosition(pos, node, !secondChainFound /*should ack*/);
-        if (!secondChainFound) {
-            return pos.it;
+        advanceAndAckForPosition(*positions.first,
+                                 node,
+                                 !positions.second /*should ack*/,
+                                 ackTime,
+                                 ackDurations);
+        if (!positions.second) {
+            return positions.first->it;
         }
     }
 
-    if (secondChainFound) {
-        // Update second chain itr
-        auto& pos = const_cast<Position<Container>&>(secondChainItr->second);
-        advanceAndAckForPosition(pos, node, true /* should ack*/);
-        return pos.it;
-    }
-
-    folly::assume_unreachable();
+    // Update second chain itr
+    advanceAndAckForPosition(*positions.second,
+                             node,
+                             true /* should ack*/,
+                             ackTime,
+                             ackDurations);
+    return positions.second->it;
 }
 
 void ActiveDurabilityMonitor::State::advanceAndAckForPosition(
-        Position<Container>& pos, const std::string& node, bool shouldAck) {
+        Position<Container>& pos,
+        const std::string& node,
+        bool shouldAck,
+        std::chrono::steady_clock::time_point ackTime,
+        std::vector<std::chrono::microseconds>& ackDurations) {
     if (pos.it == trackedWrites.end()) {
         pos.it = trackedWrites.begin();
     } else {
@@ -638,6 +697,15 @@ void ActiveDurabilityMonitor::State::advanceAndAckForPosition(
         pos.it->ack(node);
     }
 
+    // Record how long this replica took to ack the SyncWrite (from it being
+    // tracked here), per replica node. The caller adds them to the histogram
+    // once for all of the SyncWrites covered by the ack.
+    if (shouldAck && node != getActive()) {
+        ackDurations.push_back(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        ackTime - pos.it->getStartTime()));
+    }
+
     // Add a trace event for the ACK from this node (assuming we have a cookie
     // // for it).
     // ActiveDM has no visibility of when a replica was sent the prepare
@@ -645,7 +713,6 @@ void ActiveDurabilityMonitor::State::advanceAndAckForPosition(
     // cookie) so just make the start+end the same.
     auto* cookie = pos.it->getCookie();
     if (cookie) {
-        const auto ackTime = std::chrono::steady_clock::now();
         const auto event =
                 (node == getActive())
                         ? cb::tracing::TraceCode::SYNC_WRITE_ACK_LOCAL
@@ -810,12 +877,20 @@ ActiveDurabilityMonitor::State::removeSyncWrite(Container::iterator it,
         }
     }
 
+    const bool removingFirst = (it == trackedWrites.begin());
+
     Container removed;
     removed.splice(removed.end(), trackedWrites, it);
+
+    if (removingFirst) {
+        scheduleTimeoutForFirstSyncWrite();
+    }
+
     return std::move(removed.front());
 }
 
-void ActiveDurabilityMonitor::commit(const ActiveSyncWrite& sw) {
+void ActiveDurabilityMonitor::commit(const ActiveSyncWrite& sw,
+                                     SyncWriteCompletionBatch& batch) {
     TRACE_EVENT1("durability", "ActiveDM::commit", "vbid", vb.getId().get());
     const auto& key = sw.getKey();
 
@@ -825,8 +900,8 @@ void ActiveDurabilityMonitor::commit(const ActiveSyncWrite& sw) {
         // Record a Span for the prepare phase duration. We do this before
         // actually calling VBucket::commit() as we want to add a TraceSpan to
         // the cookie before the response to the client is actually sent (and we
-        // report the end of the request), which is done within
-        // VBucket::commit().
+        // report the end of the request), which is done once the batch of
+        // SyncWrites is completed.
         TracerStopwatch prepareDuration(
                 cookie, cb::tracing::TraceCode::SYNC_WRITE_PREPARE);
         prepareDuration.start(sw.getStartTime());
@@ -836,7 +911,8 @@ void ActiveDurabilityMonitor::commit(const ActiveSyncWrite& sw) {
                             sw.getBySeqno() /*prepareSeqno*/,
                             {} /*commitSeqno*/,
                             vb.lockCollections(key),
-                            sw.getCookie());
+                            sw.getCookie(),
+                            &batch);
     if (result != ENGINE_SUCCESS) {
         throwException<std::logic_error>(
                 __func__, "failed with status:" + std::to_string(result));
@@ -862,13 +938,15 @@ void ActiveDurabilityMonitor::commit(const ActiveSyncWrite& sw) {
     }
 }
 
-void ActiveDurabilityMonitor::abort(const ActiveSyncWrite& sw) {
+void ActiveDurabilityMonitor::abort(const ActiveSyncWrite& sw,
+                                    SyncWriteCompletionBatch& batch) {
     const auto& key = sw.getKey();
     auto result = vb.abort(key,
                            sw.getBySeqno() /*prepareSeqno*/,
                            {} /*abortSeqno*/,
                            vb.lockCollections(key),
-                           sw.getCookie());
+                           sw.getCookie(),
+                           &batch);
     if (result != ENGINE_SUCCESS) {
         throwException<std::logic_error>(
                 __func__, "failed with status:" + std::to_string(result));
@@ -903,12 +981,19 @@ void ActiveDurabilityMonitor::State::processSeqnoAck(const std::string& node,
     // We should never ack for the active
     Expects(firstChain->active != node);
 
-    // Note: process up to the ack'ed seqno
+    // Note: process up to the ack'ed seqno. The node's Positions, the ack
+    // time and the histogram of the ack times are looked up once for all of
+    // the SyncWrites covered by the ack, as a single ack may cover a large
+    // number of SyncWrites.
+    const auto positions = getNodePositions(node);
+    const auto ackTime = std::chrono::steady_clock::now();
+    std::vector<std::chrono::microseconds> ackDurations;
     ActiveDurabilityMonitor::Container::iterator next;
-    while ((next = getNodeNext(node)) != trackedWrites.end() &&
+    while ((next = getNodeNext(positions)) != trackedWrites.end() &&
            next->getBySeqno() <= seqno) {
         // Update replica tracking
-        const auto& posIt = advanceNodePosition(node);
+        const auto& posIt =
+                advanceNodePosition(positions, node, ackTime, ackDurations);
 
         // Check if Durability Requirements satisfied now, and add for commit
         if (posIt->isSatisfied()) {
@@ -917,6 +1002,14 @@ void ActiveDurabilityMonitor::State::processSeqnoAck(const std::string& node,
         }
     }
 
+    if (!ackDurations.empty()) {
+        auto histos = adm.stats.syncWriteReplicaAckTimes.wlock();
+        auto& histo = (*histos)[node];
+        for (const auto& duration : ackDurations) {
+            histo.add(duration);
+        }
+    }
+
     // We keep track of the actual ack'ed seqno
     updateNodeAck(node, seqno);
 }
@@ -1291,6 +1384,10 @@ void ActiveDurabilityMonitor::State::addSyncWrite(const void* cookie,
                                secondChain.get());
     lastTrackedSeqno = seqno;
     totalAccepted++;
+
+    if (trackedWrites.size() == 1) {
+        scheduleTimeoutForFirstSyncWrite();
+    }
 }
 
 void ActiveDurabilityMonitor::State::removeExpired(
@@ -1315,6 +1412,18 @@ void ActiveDurabilityMonitor::State::removeExpired(
     }
 }
 
+void ActiveDurabilityMonitor::State::scheduleTimeoutForFirstSyncWrite() {
+    if (trackedWrites.empty()) {
+        return;
+    }
+    const auto expiry = trackedWrites.front().getExpiryTime();
+    if (!expiry || (scheduledTimeout && *scheduledTimeout <= *expiry)) {
+        return;
+    }
+    scheduledTimeout = expiry;
+    adm.vb.scheduleSyncWriteTimeout(*expiry);
+}
+
 void ActiveDurabilityMonitor::State::updateHighPreparedSeqno(
         ResolvedQueue& completed) {
     // Note: All the logic below relies on the fact that HPS for Active is
@@ -1375,15 +1484,19 @@ void ActiveDurabilityMonitor::State::updateHighPreparedSeqno(
         }
     };
 
+    const auto positions = getNodePositions(active);
+    const auto ackTime = std::chrono::steady_clock::now();
+    // Not used, we don't record ack times for the active
+    std::vector<std::chrono::microseconds> ackDurations;
     Container::iterator next;
     // First, blindly move HPS up to high-persisted-seqno. Note that here we
     // don't need to check any Durability Level: persistence makes
     // locally-satisfied all the pending Prepares up to high-persisted-seqno.
-    while ((next = getNodeNext(active)) != trackedWrites.end() &&
+    while ((next = getNodeNext(positions)) != trackedWrites.end() &&
            static_cast<uint64_t>(next->getBySeqno()) <=
                    adm.vb.getPersistenceSeqno()) {
         highPreparedSeqno = next->getBySeqno();
-        advanceNodePosition(active);
+        advanceNodePosition(positions, active, ackTime, ackDurations);
         removeForCommitIfSatisfied();
     }
 
@@ -1393,7 +1506,7 @@ void ActiveDurabilityMonitor::State::updateHighPreparedSeqno(
     // satisfied now. The first non-satisfied Prepare is the first
     // PersistToMajority or MajorityAndPersistToMaster not covered by
     // persisted-seqno.
-    while ((next = getNodeNext(active)) != trackedWrites.end()) {
+    while ((next = getNodeNext(positions)) != trackedWrites.end()) {
         const auto level = next->getDurabilityReqs().getLevel();
         Expects(level != cb::durability::Level::None);
 
@@ -1405,7 +1518,7 @@ void ActiveDurabilityMonitor::State::updateHighPreparedSeqno(
         }
 
         highPreparedSeqno = next->getBySeqno();
-        advanceNodePosition(active);
+        advanceNodePosition(positions, active, ackTime, ackDurations);
         removeForCommitIfSatisfied();
     }
 
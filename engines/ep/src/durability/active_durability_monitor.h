@@ -23,10 +23,12 @@
 #include <folly/SynchronizedPtr.h>
 #include <nlohmann/json_fwd.hpp>
 
+#include <unordered_map>
 #include <unordered_set>
 
 class EPStats;
 class PassiveDurabilityMonitor;
+struct SyncWriteCompletionBatch;
 struct vbucket_state;
 class VBucket;
 
@@ -178,6 +180,9 @@ public:
 
     /**
      * Expected to be called by memcached at receiving a DCP_SEQNO_ACK packet.
+     * Acks received concurrently (e.g. from different replicas) are queued
+     * and processed in a single pass by whichever caller acquires the State
+     * lock first.
      *
      * @param replica The replica that sent the ACK
      * @param diskSeqno The ack'ed prepared seqno.
@@ -338,15 +343,17 @@ protected:
      * Commit the given SyncWrite.
      *
      * @param sw The SyncWrite to commit
+     * @param batch The notifications of the batch of completed SyncWrites
      */
-    void commit(const ActiveSyncWrite& sw);
+    void commit(const ActiveSyncWrite& sw, SyncWriteCompletionBatch& batch);
 
     /**
      * Abort the given SyncWrite.
      *
      * @param sw The SyncWrite to abort
+     * @param batch The notifications of the batch of completed SyncWrites
      */
-    void abort(const ActiveSyncWrite& sw);
+    void abort(const ActiveSyncWrite& sw, SyncWriteCompletionBatch& batch);
 
     /**
      * Test only (for now; shortly this will be probably needed at rollback).
@@ -418,6 +425,14 @@ protected:
      */
     std::unique_ptr<ResolvedQueue> resolvedQueue;
 
+    /**
+     * Seqno acks received but not yet processed, per replica (only the
+     * highest seqno of each replica is kept). Drained by seqnoAckReceived()
+     * under the State lock.
+     */
+    folly::Synchronized<std::unordered_map<std::string, int64_t>>
+            pendingSeqnoAcks;
+
     // Maximum number of replicas which can be specified in topology.
     static const size_t maxReplicas = 3;
 
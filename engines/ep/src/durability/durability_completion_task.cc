@@ -26,7 +26,8 @@ using namespace std::chrono_literals;
 
 DurabilityCompletionTask::DurabilityCompletionTask(
         EventuallyPersistentEngine& engine)
-    : GlobalTask(&engine, TaskId::DurabilityCompletionTask) {
+    : GlobalTask(&engine, TaskId::DurabilityCompletionTask),
+      queue(engine.getConfiguration().getMaxVbuckets()) {
 }
 
 bool DurabilityCompletionTask::run() {
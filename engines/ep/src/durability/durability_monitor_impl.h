@@ -192,6 +192,12 @@ public:
      */
     bool isExpired(std::chrono::steady_clock::time_point asOf) const;
 
+    /// @returns the expiry-time of this SyncWrite, if it has a timeout
+    boost::optional<std::chrono::steady_clock::time_point> getExpiryTime()
+            const {
+        return expiryTime;
+    }
+
     /**
      * Reset the ack-state for this SyncWrite and set it up for the new
      * given topology. In general, checkDurabilityPossibleAndResetTopology
@@ -437,6 +443,25 @@ struct ActiveDurabilityMonitor::State {
      */
     void addSyncWrite(const void* cookie, queued_item item);
 
+    /**
+     * The Positions of a node in the first and second chain. Looked up once
+     * when walking the SyncWrites acked by a node, rather than once per
+     * tracked SyncWrite.
+     */
+    struct NodePositions {
+        /// Position in firstChain, nullptr if the node isn't in it
+        Position<Container>* first = nullptr;
+        /// Position in secondChain, nullptr if the node isn't in it
+        Position<Container>* second = nullptr;
+    };
+
+    /**
+     * @param node
+     * @return the Positions of the given node (both nullptr if the node is
+     *         not in any chain)
+     */
+    NodePositions getNodePositions(const std::string& node);
+
     /**
      * Returns the next position for a node iterator.
      *
@@ -446,6 +471,9 @@ struct ActiveDurabilityMonitor::State {
      */
     Container::iterator getNodeNext(const std::string& node);
 
+    /// As getNodeNext(const std::string&), for the Positions of a node
+    Container::iterator getNodeNext(const NodePositions& positions);
+
     /**
      * Advance a node tracking to the next Position in the tracked
      * Container. Note that a Position tracks a node in terms of both:
@@ -459,6 +487,22 @@ struct ActiveDurabilityMonitor::State {
      */
     Container::iterator advanceNodePosition(const std::string& node);
 
+    /**
+     * As advanceNodePosition(const std::string&), for the Positions of a
+     * node.
+     *
+     * @param positions the Positions of the node
+     * @param node the node to advance
+     * @param ackTime the time the ack was received
+     * @param [out] ackDurations the time taken by the node to ack the
+     *        SyncWrite is appended, if the node is a replica
+     */
+    Container::iterator advanceNodePosition(
+            const NodePositions& positions,
+            const std::string& node,
+            std::chrono::steady_clock::time_point ackTime,
+            std::vector<std::chrono::microseconds>& ackDurations);
+
     /**
      * This function updates the tracking with the last seqno ack'ed by
      * node.
@@ -497,6 +541,15 @@ struct ActiveDurabilityMonitor::State {
     void removeExpired(std::chrono::steady_clock::time_point asOf,
                        ResolvedQueue& expired);
 
+    /**
+     * Register the expiry-time of the first tracked SyncWrite with the
+     * VBucket (see VBucket::scheduleSyncWriteTimeout), unless a timeout
+     * check is already scheduled at or before it. Given that SyncWrites are
+     * aborted in-order, the first SyncWrite is the only one which may time
+     * out next.
+     */
+    void scheduleTimeoutForFirstSyncWrite();
+
     /// @returns the name of the active node. Assumes the first chain is valid.
     const std::string& getActive() const;
 
@@ -651,10 +704,15 @@ private:
      * @param shouldAck should we call SyncWrite->ack() on this node?
      *        Optional as we want to avoid acking a SyncWrite twice if a
      *        node exists in both the first and second chain.
+     * @param ackTime the time the ack was received
+     * @param [out] ackDurations see advanceNodePosition
      */
-    void advanceAndAckForPosition(Position<Container>& pos,
-                                  const std::string& node,
-                                  bool shouldAck);
+    void advanceAndAckForPosition(
+            Position<Container>& pos,
+            const std::string& node,
+            bool shouldAck,
+            std::chrono::steady_clock::time_point ackTime,
+            std::vector<std::chrono::microseconds>& ackDurations);
 
     /**
      * throw exception with the following error string:
@@ -698,6 +756,10 @@ public:
     // Stores the highCompletedSeqno
     Monotonic<int64_t> highCompletedSeqno = 0;
 
+    // The deadline at which a timeout check is currently scheduled for this
+    // vBucket, if any. Reset when the check is performed (processTimeout).
+    boost::optional<std::chrono::steady_clock::time_point> scheduledTimeout;
+
     // Cumulative count of accepted (tracked) SyncWrites.
     size_t totalAccepted = 0;
     // Cumulative count of Committed SyncWrites.
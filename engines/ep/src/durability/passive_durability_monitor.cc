@@ -276,21 +276,48 @@ void PassiveDurabilityMonitor::notifyLocalPersistence() {
 
 void PassiveDurabilityMonitor::storeSeqnoAck(int64_t prevHps, int64_t newHps) {
     if (prevHps != newHps) {
-        auto seqno = seqnoToAck.wlock();
-        if (*seqno < newHps) {
-            *seqno = newHps;
+        auto ack = seqnoToAck.wlock();
+        if (ack->seqno < newHps) {
+            if (ack->seqno == 0) {
+                ack->firstUpdate = std::chrono::steady_clock::now();
+            }
+            ack->seqno = newHps;
+            ack->updates++;
         }
     }
 }
 
-void PassiveDurabilityMonitor::sendSeqnoAck() {
+void PassiveDurabilityMonitor::sendSeqnoAck(
+        std::chrono::steady_clock::time_point now) {
     TRACE_EVENT0("durability", "PassiveDM::sendSeqnoAck");
     // Hold the lock throughout to ensure that we do not race with another ack
-    auto seqno = seqnoToAck.wlock();
-    if (*seqno != 0) {
-        vb.sendSeqnoAck(*seqno);
+    auto ack = seqnoToAck.wlock();
+    if (ack->seqno == 0) {
+        return;
+    }
+
+    const auto window = vb.seqnoAckCoalesceWindow;
+    if (window.count() != 0) {
+        const auto limit = vb.seqnoAckCoalesceCount;
+        const auto deadline = ack->firstUpdate + window;
+        if ((limit == 0 || ack->updates < limit) && now < deadline) {
+            // Coalesce with the HPS updates which follow; make sure that the
+            // ack is sent at the latest when the window expires.
+            if (!ack->deadlineScheduled) {
+                ack->deadlineScheduled = true;
+                vb.scheduleSyncWriteTimeout(deadline);
+            }
+            return;
+        }
     }
-    *seqno = 0;
+
+    vb.sendSeqnoAck(ack->seqno);
+    *ack = SeqnoAck{};
+}
+
+void PassiveDurabilityMonitor::processSeqnoAckTimeout(
+        std::chrono::steady_clock::time_point asOf) {
+    sendSeqnoAck(asOf);
 }
 
 std::string PassiveDurabilityMonitor::to_string(Resolution res) {
@@ -22,6 +22,7 @@
 #include <boost/optional.hpp>
 #include <folly/SynchronizedPtr.h>
 
+#include <chrono>
 #include <vector>
 
 class ActiveDurabilityMonitor;
@@ -159,6 +160,15 @@ public:
      */
     void notifyLocalPersistence() override;
 
+    /**
+     * Send the seqno ack deferred for coalescing, if its coalescing window has
+     * expired as of the given time. Invoked by the DurabilityTimeoutTask at
+     * the deadline registered when the ack was deferred.
+     *
+     * @param asOf The time to be compared with the ack's deadline
+     */
+    void processSeqnoAckTimeout(std::chrono::steady_clock::time_point asOf);
+
     /**
      * Get the highest seqno for which there is a SyncWrite in trackedWrites.
      * Returns 0 if trackedWrites is empty.
@@ -183,9 +193,15 @@ protected:
     void storeSeqnoAck(int64_t prevHps, int64_t newHps);
 
     /**
-     * Send, if we need to, a seqno ack to the active node.
+     * Send, if we need to, a seqno ack to the active node. If the VBucket
+     * coalesces seqno acks, the ack is deferred until the coalescing window
+     * (which starts at the first HPS update stored) expires or the count of
+     * HPS updates stored reaches the configured limit.
+     *
+     * @param now The current time
      */
-    void sendSeqnoAck();
+    void sendSeqnoAck(std::chrono::steady_clock::time_point now =
+                              std::chrono::steady_clock::now());
 
     void toOStream(std::ostream& os) const override;
     /**
@@ -208,8 +224,18 @@ protected:
     struct State;
     folly::SynchronizedPtr<std::unique_ptr<State>> state;
 
-    /// Outstanding seqno ack to send to the active. 0 if no ack outstanding
-    folly::Synchronized<int64_t> seqnoToAck{0};
+    struct SeqnoAck {
+        /// Outstanding seqno ack to send to the active. 0 if no ack
+        /// outstanding
+        int64_t seqno{0};
+        /// Number of HPS updates coalesced into the outstanding ack
+        size_t updates{0};
+        /// Time of the first HPS update coalesced into the outstanding ack
+        std::chrono::steady_clock::time_point firstUpdate;
+        /// Has a deadline been registered for sending the outstanding ack?
+        bool deadlineScheduled{false};
+    };
+    folly::Synchronized<SeqnoAck> seqnoToAck;
 
     // Necessary for implementing ADM(PDM&&)
     friend class ActiveDurabilityMonitor;
@@ -17,10 +17,13 @@
 
 #include "durability_timeout_task.h"
 #include "ep_engine.h"
+#include "executorpool.h"
 #include "kv_bucket.h"
 
 #include <phosphor/phosphor.h>
 
+#include <algorithm>
+
 class DurabilityTimeoutTask::ConfigChangeListener
     : public ValueChangedListener {
 public:
@@ -53,26 +56,59 @@ DurabilityTimeoutTask::DurabilityTimeoutTask(EventuallyPersistentEngine& engine,
 bool DurabilityTimeoutTask::run() {
     TRACE_EVENT0("ep-engine/task", "DurabilityTimeoutTask");
 
-    // @todo: A meaningful value will be the P99.99
-    const auto maxExpectedDurationForVisitorTask =
-            std::chrono::milliseconds(100);
+    const auto now = std::chrono::steady_clock::now();
 
-    auto& kvBucket = *engine->getKVBucket();
-    kvBucket.visitAsync(std::make_unique<DurabilityTimeoutVisitor>(),
-                        "DurabilityTimeoutVisitor",
-                        TaskId::DurabilityTimeoutVisitor,
-                        maxExpectedDurationForVisitorTask);
+    // Collect the vBuckets whose deadline has been reached and snooze until
+    // the next deadline (or for at most sleepTime). Snoozing before
+    // processing the vBuckets allows any deadline re-registered by
+    // processDurabilityTimeout() to bring the next run forward.
+    std::vector<Vbid> expired;
+    {
+        auto locked = deadlines.lock();
+        while (!locked->heap.empty() && locked->heap.top().first <= now) {
+            expired.push_back(locked->heap.top().second);
+            locked->heap.pop();
+        }
 
-    // Note: Default unit for std::duration is seconds, so the following gives
-    // the seconds-representation (as double) of the given millis (sleepTime)
-    snooze(std::chrono::duration_cast<std::chrono::duration<double>>(
-                   sleepTime.load())
-                   .count());
+        auto wakeTime = now + sleepTime.load();
+        if (!locked->heap.empty()) {
+            wakeTime = std::min(wakeTime, locked->heap.top().first);
+        }
+        locked->nextRun = wakeTime;
+        snooze(std::chrono::duration<double>(wakeTime - now).count());
+    }
+
+    // A vBucket may have registered more than one expired deadline.
+    std::sort(expired.begin(), expired.end());
+    expired.erase(std::unique(expired.begin(), expired.end()), expired.end());
+
+    auto& kvBucket = *engine->getKVBucket();
+    for (const auto vbid : expired) {
+        auto vb = kvBucket.getVBucket(vbid);
+        if (vb) {
+            vb->processDurabilityTimeout(now);
+        }
+    }
 
     // Schedule again if not shutting down
     return !engine->getEpStats().isShutdown;
 }
 
-void DurabilityTimeoutVisitor::visitBucket(const VBucketPtr& vb) {
-    vb->processDurabilityTimeout(startTime);
+void DurabilityTimeoutTask::scheduleTimeout(
+        Vbid vbid, std::chrono::steady_clock::time_point deadline) {
+    auto locked = deadlines.lock();
+    locked->heap.emplace(deadline, vbid);
+    if (deadline >= locked->nextRun) {
+        // Already covered by the next run.
+        return;
+    }
+    locked->nextRun = deadline;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (deadline <= now) {
+        ExecutorPool::get()->wake(getId());
+    } else {
+        ExecutorPool::get()->snooze(
+                getId(), std::chrono::duration<double>(deadline - now).count());
+    }
 }
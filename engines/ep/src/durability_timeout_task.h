@@ -17,18 +17,32 @@
 #pragma once
 
 #include "globaltask.h"
-#include "vb_visitors.h"
+#include <folly/Synchronized.h>
+#include <memcached/vbucket.h>
 #include <platform/atomic_duration.h>
 
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <vector>
+
 /*
  * Enforces the Durability Timeout for the SyncWrites tracked in this KVBucket.
+ *
+ * Rather than periodically visiting every vBucket, the task keeps a min-heap
+ * of (deadline, vbid) entries. Each ActiveDurabilityMonitor registers (via
+ * VBucket::scheduleSyncWriteTimeout) the expiry-time of the SyncWrite which
+ * may time out next, and the task only visits the vBuckets whose deadline has
+ * been reached. The task sleeps until the earliest registered deadline, or
+ * for at most durability_timeout_task_interval.
  */
 class DurabilityTimeoutTask : public GlobalTask {
 public:
     class ConfigChangeListener;
 
     /**
-     * @param engine The engine that will be visited
+     * @param engine The engine whose vBuckets will be checked
+     * @param interval The maximum interval between subsequent runs
      */
     DurabilityTimeoutTask(EventuallyPersistentEngine& engine,
                           std::chrono::milliseconds interval);
@@ -40,35 +54,41 @@ public:
     }
 
     std::chrono::microseconds maxExpectedDuration() override {
-        // This tasks just spawns a new VBCBAdaptor, which is the actual tasks
-        // that executes the DurabilityTimeoutVisitor. So, keeping the value
-        // relatively high as there is no too much value in logging this timing.
-        return std::chrono::seconds(1);
+        // The task only processes the vBuckets which have a SyncWrite that
+        // expired; each of them is a (usually short) walk of the head of the
+        // tracked SyncWrites.
+        return std::chrono::milliseconds(100);
     }
 
     void setSleepTime(std::chrono::milliseconds value) {
         sleepTime = value;
     }
 
-private:
-    // Note: this is the actual minimum interval between subsequent runs.
-    // The VBCBAdaptor (which is the actual task that executes this Visitor)
-    // has its internal sleep-time which is used for a different purpose,
-    // details in VBCBAdaptor.
-    cb::AtomicDuration<std::memory_order::memory_order_seq_cst> sleepTime;
-};
+    /**
+     * Register the time at which the SyncWrites of the given vBucket must be
+     * checked for timeout. If the deadline is earlier than the next scheduled
+     * run then the task is re-scheduled to run at the deadline.
+     *
+     * @param vbid The vBucket to check
+     * @param deadline The time point at which a SyncWrite may time out
+     */
+    void scheduleTimeout(Vbid vbid,
+                         std::chrono::steady_clock::time_point deadline);
 
-/**
- * DurabilityTimeoutVisitor visits a VBucket for enforcing the Durability
- * Timeout for the SyncWrites tracked by VBucket.
- */
-class DurabilityTimeoutVisitor : public CappedDurationVBucketVisitor {
-public:
-    DurabilityTimeoutVisitor() : startTime(std::chrono::steady_clock::now()) {
-    }
+private:
+    using Deadline = std::pair<std::chrono::steady_clock::time_point, Vbid>;
 
-    void visitBucket(const VBucketPtr& vb) override;
+    struct Deadlines {
+        std::priority_queue<Deadline,
+                            std::vector<Deadline>,
+                            std::greater<Deadline>>
+                heap;
+        // The time point at which the task is currently scheduled to run.
+        std::chrono::steady_clock::time_point nextRun;
+    };
+    folly::Synchronized<Deadlines, std::mutex> deadlines;
 
-private:
-    const std::chrono::steady_clock::time_point startTime;
+    // Note: this is the maximum interval between subsequent runs. The task
+    // runs earlier if any SyncWrite deadline is reached before.
+    cb::AtomicDuration<std::memory_order::memory_order_seq_cst> sleepTime;
 };
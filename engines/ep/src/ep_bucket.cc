@@ -23,6 +23,7 @@
 #include "bucket_logger.h"
 #include "checkpoint_manager.h"
 #include "collections/manager.h"
+#include "compaction_rate_limiter.h"
 #include "ep_engine.h"
 #include "ep_time.h"
 #include "ep_vb.h"
@@ -32,6 +33,7 @@
 #include "item.h"
 #include "persistence_callback.h"
 #include "replicationthrottle.h"
+#include "resident_image.h"
 #include "rollback_result.h"
 #include "statwriter.h"
 #include "tasks.h"
@@ -46,6 +48,9 @@
 #include <gsl.h>
 #include <phosphor/phosphor.h>
 
+#include <algorithm>
+#include <thread>
+
 /**
  * Callback class used by EpStore, for adding relevant keys
  * to bloomfilter during compaction.
@@ -97,6 +102,8 @@ public:
                 } else {
                     if (isDeleted || !store.isMetaDataResident(vb, key)) {
                         vb->addToTempFilter(key);
+                    } else {
+                        vb->markTempFilterIncomplete();
                     }
                 }
             }
@@ -199,17 +206,17 @@ private:
  */
 class NotifyFlusherCB : public Callback<Vbid> {
 public:
-    NotifyFlusherCB(KVShard* sh) : shard(sh) {
+    NotifyFlusherCB(EPBucket& bucket) : bucket(bucket) {
     }
 
     void callback(Vbid& vb) override {
-        if (shard->getBucket(vb)) {
-            shard->getFlusher()->notifyFlushEvent();
+        if (bucket.getVBucket(vb)) {
+            bucket.getFlusher(vb)->notifyFlushEvent();
         }
     }
 
 private:
-    KVShard* shard;
+    EPBucket& bucket;
 };
 
 class EPBucket::ValueChangedListener : public ::ValueChangedListener {
@@ -221,10 +228,27 @@ public:
                                   size_t value) override {
         if (key == "flusher_batch_split_trigger") {
             bucket.setFlusherBatchSplitTrigger(value);
+        } else if (key == "flusher_step_time_limit") {
+            bucket.setFlusherStepTimeLimit(std::chrono::milliseconds(value));
+        } else if (key == "flusher_vbstate_persist_delay") {
+            bucket.setVBStatePersistDelay(std::chrono::milliseconds(value));
+        } else if (key == "durability_group_commit_window") {
+            bucket.setDurabilityGroupCommitWindow(
+                    std::chrono::microseconds(value));
+        } else if (key == "compaction_max_bytes_per_sec") {
+            bucket.compactionRateLimiter->setMaxBytesPerSec(value);
+        } else if (key == "compaction_max_iops") {
+            bucket.compactionRateLimiter->setMaxIOPS(value);
+        } else if (key == "compaction_io_backoff_sync_write_latency") {
+            bucket.compactionIOBackoffSyncWriteLatency = value;
         } else if (key == "alog_sleep_time") {
             bucket.setAccessScannerSleeptime(value, false);
         } else if (key == "alog_task_time") {
             bucket.resetAccessScannerStartTime();
+        } else if (key == "max_num_flushers") {
+            bucket.setNumFlushers(value);
+        } else if (key == "max_num_bgfetchers") {
+            bucket.setNumBgFetchers(value);
         } else {
             EP_LOG_WARN("Failed to change value for unknown variable, {}", key);
         }
@@ -261,18 +285,64 @@ EPBucket::EPBucket(EventuallyPersistentEngine& theEngine)
     replicationThrottle = std::make_unique<ReplicationThrottle>(
             engine.getConfiguration(), stats);
 
-    vbMap.enablePersistence(*this);
+    for (size_t id = 0; id < vbMap.getNumShards(); ++id) {
+        flushers.push_back(std::make_unique<Flusher>(this, id));
+    }
+    setNumFlushers(config.getMaxNumFlushers());
+    config.addValueChangedListener(
+            "max_num_flushers", std::make_unique<ValueChangedListener>(*this));
+
+    bgFetchers.resize(vbMap.getSize());
+    setNumBgFetchers(config.getMaxNumBgfetchers());
+    config.addValueChangedListener(
+            "max_num_bgfetchers",
+            std::make_unique<ValueChangedListener>(*this));
 
     flusherBatchSplitTrigger = config.getFlusherBatchSplitTrigger();
     config.addValueChangedListener(
             "flusher_batch_split_trigger",
             std::make_unique<ValueChangedListener>(*this));
 
+    setFlusherStepTimeLimit(
+            std::chrono::milliseconds(config.getFlusherStepTimeLimit()));
+    config.addValueChangedListener(
+            "flusher_step_time_limit",
+            std::make_unique<ValueChangedListener>(*this));
+
+    setVBStatePersistDelay(std::chrono::milliseconds(
+            config.getFlusherVbstatePersistDelay()));
+    config.addValueChangedListener(
+            "flusher_vbstate_persist_delay",
+            std::make_unique<ValueChangedListener>(*this));
+
+    setDurabilityGroupCommitWindow(std::chrono::microseconds(
+            config.getDurabilityGroupCommitWindow()));
+    config.addValueChangedListener(
+            "durability_group_commit_window",
+            std::make_unique<ValueChangedListener>(*this));
+
     retainErroneousTombstones = config.isRetainErroneousTombstones();
     config.addValueChangedListener(
            "retain_erroneous_tombstones",
            std::make_unique<ValueChangedListener>(*this));
 
+    compactionRateLimiter = std::make_unique<CompactionRateLimiter>(
+            stats, [this]() { return shouldCompactionBackOff(); });
+    compactionRateLimiter->setMaxBytesPerSec(
+            config.getCompactionMaxBytesPerSec());
+    config.addValueChangedListener(
+            "compaction_max_bytes_per_sec",
+            std::make_unique<ValueChangedListener>(*this));
+    compactionRateLimiter->setMaxIOPS(config.getCompactionMaxIops());
+    config.addValueChangedListener(
+            "compaction_max_iops",
+            std::make_unique<ValueChangedListener>(*this));
+    compactionIOBackoffSyncWriteLatency =
+            config.getCompactionIoBackoffSyncWriteLatency();
+    config.addValueChangedListener(
+            "compaction_io_backoff_sync_write_latency",
+            std::make_unique<ValueChangedListener>(*this));
+
     initializeWarmupTask();
 }
 
@@ -301,10 +371,63 @@ void EPBucket::deinitialize() {
     stopFlusher();
     stopBgFetcher();
 
+    if (!stats.forceShutdown) {
+        persistBloomFilters();
+        if (engine.getConfiguration().isWarmupResidentImage()) {
+            writeResidentImages();
+        }
+    }
+
     stopWarmup();
     KVBucket::deinitialize();
 }
 
+void EPBucket::persistBloomFilters() {
+    if (!engine.getConfiguration().isBfilterEnabled()) {
+        return;
+    }
+    for (auto vbid : vbMap.getBuckets()) {
+        auto vb = getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        const auto filter = vb->serialiseFilter();
+        auto* store = getRWUnderlying(vbid);
+        const auto* state = store->getVBucketState(vbid);
+        if (filter.empty() || !state) {
+            continue;
+        }
+        store->persistBloomFilter(vbid, state->highSeqno, filter);
+    }
+}
+
+void EPBucket::writeResidentImages() {
+    const auto& dbname = engine.getConfiguration().getDbname();
+    size_t written = 0;
+    for (auto vbid : vbMap.getBuckets()) {
+        auto vb = getVBucket(vbid);
+        const auto* state = getRWUnderlying(vbid)->getVBucketState(vbid);
+        // Only an image of everything on disk (and nothing else) is of use.
+        if (!vb || !state || vb->getHighSeqno() != state->highSeqno) {
+            continue;
+        }
+        if (ResidentImage::write(ResidentImage::getPath(dbname, vbid),
+                                 *vb,
+                                 state->highSeqno)) {
+            ++written;
+        }
+    }
+    EP_LOG_INFO("EPBucket::writeResidentImages: wrote images of {} vbuckets",
+                written);
+}
+
+void EPBucket::removeResidentImages() {
+    const auto& dbname = engine.getConfiguration().getDbname();
+    for (uint16_t vb = 0; vb < vbMap.getSize(); ++vb) {
+        remove(ResidentImage::getPath(dbname, Vbid(vb)).c_str());
+    }
+}
+
 void EPBucket::reset() {
     KVBucket::reset();
 }
@@ -339,7 +462,29 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
 
     int items_flushed = 0;
     bool moreAvailable = false;
-    const auto flush_start = std::chrono::steady_clock::now();
+    auto flush_start = std::chrono::steady_clock::now();
+
+    // If a SyncWrite requiring persistence was queued very recently, wait
+    // (up to the group commit window from when it was queued) for any
+    // further SyncWrites to arrive before flushing; so they all share one
+    // commit. Done before locking the vBucket so it isn't held meanwhile.
+    const auto window =
+            std::chrono::microseconds(durabilityGroupCommitWindow.load());
+    if (window.count() != 0) {
+        auto vbPtr = getVBucket(vbid);
+        if (vbPtr) {
+            const auto oldest = vbPtr->getOldestUnflushedPrepareTime();
+            if (oldest && (*oldest + window) > flush_start) {
+                std::this_thread::sleep_until(*oldest + window);
+                flush_start = std::chrono::steady_clock::now();
+            }
+        }
+    }
+
+    // Only one flusher may write to a KVStore at a time; only contended while
+    // the shards are being reassigned to a different number of flushers.
+    std::lock_guard<std::mutex> shardGuard(
+            vbMap.getShardByVbId(vbid)->getFlushLock());
 
     auto vb = getLockedVBucket(vbid, std::try_to_lock);
     if (!vb.owns_lock()) {
@@ -386,6 +531,11 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
                 // Copies, we don't actually modify the value at the pointer.
                 vbstate = *persistedVbState;
             }
+            // A deferred vbucket_state change is persisted as part of this
+            // batch (unless a set_vbucket_state in the batch supersedes it)
+            if (vb->deferredVBState) {
+                vbstate.transition = *vb->deferredVBState;
+            }
             // We need to set a few values from the in-memory state.
             uint64_t maxSeqno = 0;
             uint64_t maxVbStateOpCas = 0;
@@ -588,10 +738,23 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
 
                 // Do we need to trigger a persist of the state?
                 // If there are no "real" items to flush, and we encountered
-                // a set_vbucket_state meta-item.
+                // a set_vbucket_state meta-item (or have a deferred one).
+                // The state change may be deferred to the next batch with
+                // any mutations, to save a commit.
                 auto options = VBStatePersist::VBSTATE_CACHE_UPDATE_ONLY;
-                if ((items_flushed == 0) && mustCheckpointVBState) {
-                    options = VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT;
+                if ((items_flushed == 0) &&
+                    (mustCheckpointVBState || vb->deferredVBState)) {
+                    if (!hcs && !hps &&
+                        canDeferVBStatePersist(
+                                *vb, vbstate.transition, persistedVbState)) {
+                        if (mustCheckpointVBState) {
+                            deferVBStatePersist(*vb, vbstate.transition);
+                        }
+                        // The cached state represents what's on disk
+                        vbstate.transition = persistedVbState->transition;
+                    } else {
+                        options = VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT;
+                    }
                 }
 
                 if (hcs) {
@@ -609,6 +772,12 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
                     return {true, 0};
                 }
 
+                if (options == VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT ||
+                    items_flushed > 0) {
+                    // Written by snapshotVBucket or the commit below
+                    vb->deferredVBState.reset();
+                }
+
                 if (vb->setBucketCreation(false)) {
                     EP_LOG_DEBUG("{} created", vbid);
                 }
@@ -670,6 +839,13 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
                 //     So, given that here we are executing in a slow bg-thread
                 //     (write+sync to disk), then we can just afford to calling
                 //     back to the DM unconditionally.
+                if (toFlush.oldestPrepareQueued) {
+                    stats.syncWritePersistWaitHisto.add(
+                            std::chrono::duration_cast<
+                                    std::chrono::microseconds>(
+                                    std::chrono::steady_clock::now() -
+                                    *toFlush.oldestPrepareQueued));
+                }
                 vb->notifyPersistenceToDurabilityMonitor();
             }
 
@@ -687,11 +863,35 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
             stats.totalPersistVBState++;
 
             collectionFlush.checkAndTriggerPurge(vb->getId(), *this);
+        } else if (vb->deferredVBState) {
+            // Nothing to flush; persist the deferred vbucket_state change if
+            // it can't wait any longer
+            const auto* persistedVbState =
+                    rwUnderlying->getVBucketState(vb->getId());
+            if (canDeferVBStatePersist(
+                        *vb, *vb->deferredVBState, persistedVbState)) {
+                getFlusher(vbid)->scheduleDeferredFlush(
+                        vb->deferredVBStateDeadline);
+            } else {
+                if (persistedVbState) {
+                    vbstate = *persistedVbState;
+                }
+                vbstate.transition = *vb->deferredVBState;
+                if (!rwUnderlying->snapshotVBucket(
+                            vb->getId(),
+                            vbstate,
+                            VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT)) {
+                    return {true, 0};
+                }
+                vb->deferredVBState.reset();
+                stats.totalPersistVBState++;
+            }
         }
 
         rwUnderlying->pendingTasks();
 
-        if (vb->checkpointManager->hasClosedCheckpointWhichCanBeRemoved()) {
+        if (vb->checkpointManager->hasClosedCheckpointWhichCanBeRemoved() ||
+            vb->checkpointManager->isOverMemoryBudget()) {
             wakeUpCheckpointRemover();
         }
 
@@ -716,6 +916,77 @@ void EPBucket::setFlusherBatchSplitTrigger(size_t limit) {
     flusherBatchSplitTrigger = limit;
 }
 
+void EPBucket::setFlusherStepTimeLimit(std::chrono::milliseconds limit) {
+    flusherStepTimeLimit = limit.count();
+}
+
+std::chrono::milliseconds EPBucket::getFlusherStepTimeLimit() const {
+    return std::chrono::milliseconds(flusherStepTimeLimit.load());
+}
+
+bool EPBucket::tryStartVBucketFileDeletion() {
+    const auto limit =
+            engine.getConfiguration().getVbucketDeletionMaxConcurrent();
+    auto current = vbucketFileDeletions.load();
+    do {
+        if (limit != 0 && current >= limit) {
+            return false;
+        }
+    } while (!vbucketFileDeletions.compare_exchange_weak(current, current + 1));
+    return true;
+}
+
+void EPBucket::completeVBucketFileDeletion() {
+    vbucketFileDeletions--;
+}
+
+void EPBucket::setVBStatePersistDelay(std::chrono::milliseconds delay) {
+    vbStatePersistDelay = delay.count();
+}
+
+bool EPBucket::canDeferVBStatePersist(
+        VBucket& vb,
+        const vbucket_transition_state& transition,
+        const vbucket_state* persistedVbState) {
+    if (vbStatePersistDelay == 0 || persistedVbState == nullptr) {
+        return false;
+    }
+
+    // Changes of the state itself (and any change somebody is waiting to
+    // be persisted) are always persisted immediately
+    if (transition.state != persistedVbState->transition.state ||
+        vb.getHighPriorityChkSize() > 0) {
+        return false;
+    }
+
+    if (getFlusher(vb.getId())->isStopping()) {
+        return false;
+    }
+
+    return !vb.deferredVBState ||
+           std::chrono::steady_clock::now() < vb.deferredVBStateDeadline;
+}
+
+void EPBucket::deferVBStatePersist(VBucket& vb,
+                                   const vbucket_transition_state& transition) {
+    if (vb.deferredVBState) {
+        *vb.deferredVBState = transition;
+    } else {
+        vb.deferredVBState =
+                std::make_unique<vbucket_transition_state>(transition);
+        vb.deferredVBStateDeadline =
+                std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(vbStatePersistDelay.load());
+    }
+    ++stats.totalDeferredVBState;
+    getFlusher(vb.getId())->scheduleDeferredFlush(vb.deferredVBStateDeadline);
+}
+
+void EPBucket::setDurabilityGroupCommitWindow(
+        std::chrono::microseconds window) {
+    durabilityGroupCommitWindow = window.count();
+}
+
 void EPBucket::commit(KVStore& kvstore,
                       Collections::VB::Flush& collectionsFlush) {
     BlockTimer timer(&stats.diskCommitHisto, "disk_commit", stats.timingLog);
@@ -737,19 +1008,38 @@ void EPBucket::commit(KVStore& kvstore,
     stats.cumulativeCommitTime.fetch_add(commit_time);
 }
 
+Flusher* EPBucket::getFlusher(Vbid vbid) {
+    return flushers[getFlusherIndex(vbMap.getShardByVbId(vbid)->getId())]
+            .get();
+}
+
+void EPBucket::setNumFlushers(size_t count) {
+    const auto numShards = vbMap.getNumShards();
+    if (count == 0 || count > numShards) {
+        count = numShards;
+    }
+    if (numFlushers.exchange(count) == count) {
+        return;
+    }
+    EP_LOG_INFO("EPBucket::setNumFlushers: {} flushers for {} shards",
+                count,
+                numShards);
+    // The shards may have moved to a different flusher; have every flusher
+    // revisit the vBuckets it's now responsible for.
+    for (const auto& flusher : flushers) {
+        flusher->notifyFlushEvent();
+    }
+}
+
 void EPBucket::startFlusher() {
-    for (const auto& shard : vbMap.shards) {
-        shard->getFlusher()->start();
+    for (const auto& flusher : flushers) {
+        flusher->start();
     }
 }
 
 void EPBucket::stopFlusher() {
-    for (const auto& shard : vbMap.shards) {
-        auto* flusher = shard->getFlusher();
-        EP_LOG_INFO(
-                "Attempting to stop the flusher for "
-                "shard:{}",
-                shard->getId());
+    for (const auto& flusher : flushers) {
+        EP_LOG_INFO("Attempting to stop flusher:{}", flusher->getId());
         bool rv = flusher->stop(stats.forceShutdown);
         if (rv && !stats.forceShutdown) {
             flusher->wait();
@@ -759,14 +1049,13 @@ void EPBucket::stopFlusher() {
 
 bool EPBucket::pauseFlusher() {
     bool rv = true;
-    for (const auto& shard : vbMap.shards) {
-        auto* flusher = shard->getFlusher();
+    for (const auto& flusher : flushers) {
         if (!flusher->pause()) {
             EP_LOG_WARN(
                     "Attempted to pause flusher in state "
-                    "[{}], shard = {}",
+                    "[{}], flusher = {}",
                     flusher->stateName(),
-                    shard->getId());
+                    flusher->getId());
             rv = false;
         }
     }
@@ -775,14 +1064,13 @@ bool EPBucket::pauseFlusher() {
 
 bool EPBucket::resumeFlusher() {
     bool rv = true;
-    for (const auto& shard : vbMap.shards) {
-        auto* flusher = shard->getFlusher();
+    for (const auto& flusher : flushers) {
         if (!flusher->resume()) {
             EP_LOG_WARN(
                     "Attempted to resume flusher in state [{}], "
-                    "shard = {}",
+                    "flusher = {}",
                     flusher->stateName(),
-                    shard->getId());
+                    flusher->getId());
             rv = false;
         }
     }
@@ -791,36 +1079,67 @@ bool EPBucket::resumeFlusher() {
 
 void EPBucket::wakeUpFlusher() {
     if (stats.diskQueueSize.load() == 0) {
-        for (const auto& shard : vbMap.shards) {
-            shard->getFlusher()->wake();
+        for (const auto& flusher : flushers) {
+            flusher->wake();
+        }
+    }
+}
+
+BgFetcher* EPBucket::getBgFetcher(Vbid vbid) {
+    std::lock_guard<std::mutex> lh(bgFetchersMutex);
+    auto& bgFetcher = bgFetchers[vbid.get() % numBgFetchers.load()];
+    if (!bgFetcher) {
+        bgFetcher = std::make_unique<BgFetcher>(*this);
+        if (bgFetchersStarted) {
+            bgFetcher->start();
         }
     }
+    return bgFetcher.get();
+}
+
+void EPBucket::setNumBgFetchers(size_t count) {
+    if (count == 0) {
+        count = vbMap.getNumShards();
+    }
+    count = std::min(count, vbMap.getSize());
+    if (numBgFetchers.exchange(count) != count) {
+        EP_LOG_INFO("EPBucket::setNumBgFetchers: {} background fetchers",
+                    count);
+    }
 }
 
 bool EPBucket::startBgFetcher() {
-    for (const auto& shard : vbMap.shards) {
-        BgFetcher* bgfetcher = shard->getBgFetcher();
-        if (bgfetcher == NULL) {
-            EP_LOG_WARN("Failed to start bg fetcher for shard {}",
-                        shard->getId());
-            return false;
+    std::lock_guard<std::mutex> lh(bgFetchersMutex);
+    for (size_t id = 0; id < numBgFetchers.load(); ++id) {
+        if (!bgFetchers[id]) {
+            bgFetchers[id] = std::make_unique<BgFetcher>(*this);
+        }
+    }
+    for (const auto& bgFetcher : bgFetchers) {
+        if (bgFetcher) {
+            bgFetcher->start();
         }
-        bgfetcher->start();
     }
+    bgFetchersStarted = true;
     return true;
 }
 
 void EPBucket::stopBgFetcher() {
-    for (const auto& shard : vbMap.shards) {
-        BgFetcher* bgfetcher = shard->getBgFetcher();
-        if (bgfetcher->pendingJob()) {
+    std::lock_guard<std::mutex> lh(bgFetchersMutex);
+    bgFetchersStarted = false;
+    for (size_t id = 0; id < bgFetchers.size(); ++id) {
+        auto& bgFetcher = bgFetchers[id];
+        if (!bgFetcher) {
+            continue;
+        }
+        if (bgFetcher->pendingJob()) {
             EP_LOG_WARN(
                     "Shutting down engine while there are still pending data "
-                    "read for shard {} from database storage",
-                    shard->getId());
+                    "read for bg fetcher {} from database storage",
+                    id);
         }
-        EP_LOG_INFO("Stopping bg fetcher for shard:{}", shard->getId());
-        bgfetcher->stop();
+        EP_LOG_INFO("Stopping bg fetcher:{}", id);
+        bgFetcher->stop();
     }
 }
 
@@ -961,6 +1280,15 @@ void EPBucket::compactInternal(const CompactionConfig& config,
                                  std::placeholders::_1,
                                  std::placeholders::_2);
 
+    ctx.rateLimiter = compactionRateLimiter.get();
+
+    if (engine.getConfiguration().isBfilterEnabled()) {
+        ctx.getBloomFilter = [this, vbid = config.db_file_id]() {
+            auto vb = getVBucket(vbid);
+            return vb ? vb->serialiseTempFilter() : std::string();
+        };
+    }
+
     KVShard* shard = vbMap.getShardByVbId(config.db_file_id);
     KVStore* store = shard->getRWUnderlying();
     bool result = store->compactDB(&ctx);
@@ -1013,6 +1341,30 @@ bool EPBucket::doCompact(const CompactionConfig& config,
     bool concWriteCompact = storeProp.hasConcWriteCompact();
     Vbid vbid = config.db_file_id;
 
+    // A compaction only to erase dropped collections may be avoidable: the
+    // KVStore can complete the erasure in place if none of them has any data
+    // left on disk. That updates the live file, so is serialised with the
+    // flusher by the vbucket lock.
+    if (config.dropped_collections_only) {
+        auto vb = getLockedVBucket(vbid, std::try_to_lock);
+        if (!vb.owns_lock()) {
+            // VB currently locked; try again later.
+            return true;
+        }
+
+        if (vb && getRWUnderlying(vbid)->eraseEmptyDroppedCollections(vbid)) {
+            EP_LOG_INFO(
+                    "Erased the dropped collections of {} without compaction",
+                    vbid);
+            updateCompactionTasks(vbid);
+            if (cookie) {
+                engine.notifyIOComplete(cookie, ENGINE_SUCCESS);
+            }
+            --stats.pendingCompactions;
+            return false;
+        }
+    }
+
     /**
      * Check if the underlying storage engine allows writes concurrently
      * as the database file is being compacted. If not, a lock needs to
@@ -1050,6 +1402,33 @@ bool EPBucket::doCompact(const CompactionConfig& config,
     return false;
 }
 
+bool EPBucket::shouldCompactionBackOff() {
+    if (stats.diskQueueSize > compactionWriteQueueCap) {
+        return true;
+    }
+
+    const size_t threshold = compactionIOBackoffSyncWriteLatency;
+    if (threshold == 0) {
+        return false;
+    }
+    // The histogram covers all time; compare the mean of just the commits
+    // since the last check.
+    const auto& histo = stats.syncWriteCommitTimes.at(
+            size_t(cb::durability::Level::PersistToMajority) - 1);
+    const uint64_t commits = histo.getValueCount();
+    const double commitTime = histo.getMean() * commits;
+    if (commits < lastSyncWriteCommits) {
+        // The histogram was reset.
+        lastSyncWriteCommits = 0;
+        lastSyncWriteCommitTime = 0;
+    }
+    const uint64_t newCommits = commits - lastSyncWriteCommits;
+    const double newCommitTime = commitTime - lastSyncWriteCommitTime;
+    lastSyncWriteCommits = commits;
+    lastSyncWriteCommitTime = commitTime;
+    return newCommits != 0 && newCommitTime / newCommits > threshold * 1000.0;
+}
+
 void EPBucket::updateCompactionTasks(Vbid db_file_id) {
     LockHolder lh(compactionLock);
     bool erased = false, woke = false;
@@ -1155,7 +1534,7 @@ VBucketPtr EPBucket::makeVBucket(
         int64_t hlcEpochSeqno,
         bool mightContainXattrs,
         const nlohmann::json& replicationTopology) {
-    auto flusherCb = std::make_shared<NotifyFlusherCB>(shard);
+    auto flusherCb = std::make_shared<NotifyFlusherCB>(*this);
     // Not using make_shared or allocate_shared
     // 1. make_shared doesn't accept a Deleter
     // 2. allocate_shared has inconsistencies between platforms in calling
@@ -1172,6 +1551,7 @@ VBucketPtr EPBucket::makeVBucket(
                                     flusherCb,
                                     std::move(newSeqnoCb),
                                     makeSyncWriteResolvedCB(),
+                                    makeSyncWriteTimeoutCB(),
                                     makeSyncWriteCompleteCB(),
                                     makeSeqnoAckCB(),
                                     engine.getConfiguration(),
@@ -1182,7 +1562,8 @@ VBucketPtr EPBucket::makeVBucket(
                                     maxCas,
                                     hlcEpochSeqno,
                                     mightContainXattrs,
-                                    replicationTopology),
+                                    replicationTopology,
+                                    storedValueSlabs),
                       VBucket::DeferredDeleter(engine));
 }
 
@@ -1238,7 +1619,7 @@ public:
     EPDiskRollbackCB(EventuallyPersistentEngine& e) : RollbackCB(), engine(e) {
     }
 
-    void callback(GetValue& val) {
+    void callback(GetValue& val) override {
         if (!val.item) {
             throw std::invalid_argument(
                     "EPDiskRollbackCB::callback: val is NULL");
@@ -1253,6 +1634,37 @@ public:
             return;
         }
 
+        // The get value of the item before the rollback seqno (not needed
+        // for prepares / aborts, which are simply removed)
+        GetValue preRbSeqnoGetValue;
+        if (!val.item->isPending() && !val.item->isAbort()) {
+            const auto vbid = val.item->getVBucketId();
+            preRbSeqnoGetValue =
+                    engine.getKVBucket()->getROUnderlying(vbid)->getWithHeader(
+                            dbHandle,
+                            DiskDocKey{*val.item},
+                            vbid,
+                            GetMetaOnly::No);
+        }
+        discardedUpdate(val, preRbSeqnoGetValue);
+    }
+
+    bool needsPreRollbackState() const override {
+        return true;
+    }
+
+    void discardedUpdate(GetValue& val,
+                         GetValue& preRbSeqnoGetValue) override {
+        if (!val.item) {
+            throw std::invalid_argument(
+                    "EPDiskRollbackCB::discardedUpdate: val is NULL");
+        }
+
+        // Skip system keys, they aren't stored in the hashtable
+        if (val.item->getKey().getCollectionID().isSystem()) {
+            return;
+        }
+
         // This is the item in its current state, after the rollback seqno
         // (i.e. the state that we are reverting)
         UniqueItemPtr postRbSeqnoItem(std::move(val.item));
@@ -1270,15 +1682,6 @@ public:
         EP_LOG_DEBUG("EPDiskRollbackCB: Handling post rollback item: {}",
                      *postRbSeqnoItem);
 
-        // The get value of the item before the rollback seqno
-        GetValue preRbSeqnoGetValue =
-                engine.getKVBucket()
-                        ->getROUnderlying(postRbSeqnoItem->getVBucketId())
-                        ->getWithHeader(dbHandle,
-                                        DiskDocKey{*postRbSeqnoItem},
-                                        postRbSeqnoItem->getVBucketId(),
-                                        GetMetaOnly::No);
-
         // This is the item in the state it was before the rollback seqno
         // (i.e. the desired state). null if there was no previous
         // Item.
@@ -1344,7 +1747,8 @@ public:
             removeDeletedDoc(*vb, *postRbSeqnoItem);
         } else {
             EP_LOG_WARN(
-                    "EPDiskRollbackCB::callback:Unexpected Error Status: {}",
+                    "EPDiskRollbackCB::discardedUpdate:Unexpected Error "
+                    "Status: {}",
                     preRbSeqnoGetValue.getStatus());
         }
     }
@@ -1541,7 +1945,11 @@ EPBucket::LoadPreparedSyncWritesResult EPBucket::loadPreparedSyncWrites(
     // *is* marked as deleted as that's the resulting state).
     // We need to see that Commit, hence ALL_ITEMS.
     const auto docFilter = DocumentFilter::ALL_ITEMS;
-    const auto valFilter = getValueFilterForCompressionMode();
+    // The durability state of each item is in its metadata, so the scan only
+    // needs keys; most of the range is normally mutations and completed
+    // prepares whose values we'd discard. The values of the outstanding
+    // prepares are fetched once the scan has identified them.
+    const auto valFilter = ValueFilter::KEYS_ONLY;
 
     auto* scanCtx = kvStore->initScanContext(
             storageCB, cacheCB, epVb.getId(), startSeqno, docFilter, valFilter);
@@ -1565,6 +1973,29 @@ EPBucket::LoadPreparedSyncWritesResult EPBucket::loadPreparedSyncWrites(
 
     kvStore->destroyScanContext(scanCtx);
 
+    // Fetch the values of the outstanding prepares in a single batch.
+    vb_bgfetch_queue_t prepareFetches;
+    for (const auto& prepare : storageCB->outstandingPrepares) {
+        auto& fetchCtx = prepareFetches[DiskDocKey(*prepare.second)];
+        fetchCtx.isMetaOnly = GetMetaOnly::No;
+        fetchCtx.bgfetched_list.emplace_back(
+                std::make_unique<VBucketBGFetchItem>(nullptr, false));
+        fetchCtx.bgfetched_list.back()->value = &fetchCtx.value;
+    }
+    kvStore->getMulti(epVb.getId(), prepareFetches);
+    for (auto& prepare : storageCB->outstandingPrepares) {
+        auto& value = prepareFetches.at(DiskDocKey(*prepare.second)).value;
+        if (value.getStatus() != ENGINE_SUCCESS) {
+            throw std::runtime_error(
+                    "EPBucket::loadPreparedSyncWrites: failed to read the "
+                    "prepare at seqno " +
+                    std::to_string(prepare.second->getBySeqno()) + " for " +
+                    epVb.getId().to_string() +
+                    ", status:" + std::to_string(value.getStatus()));
+        }
+        prepare.second = std::move(value.item);
+    }
+
     EP_LOG_DEBUG(
             "EPBucket::loadPreparedSyncWrites: Identified {} outstanding "
             "prepared SyncWrites for {} in {}",
@@ -1738,6 +2169,8 @@ void EPBucket::warmupCompleted() {
     statsSnapshotTaskId = iom->schedule(task);
 
     collectionsManager->warmupCompleted(*this);
+
+    removeResidentImages();
 }
 
 void EPBucket::stopWarmup(void) {
@@ -19,6 +19,11 @@
 
 #include "kv_bucket.h"
 
+class BgFetcher;
+class CompactionRateLimiter;
+struct vbucket_state;
+struct vbucket_transition_state;
+
 /**
  * Eventually Persistent Bucket
  *
@@ -57,12 +62,56 @@ public:
      */
     void setFlusherBatchSplitTrigger(size_t limit);
 
+    /**
+     * Set the maximum time a Flusher may spend flushing vBuckets in one
+     * run of its task (0 to flush a single vBucket per run).
+     */
+    void setFlusherStepTimeLimit(std::chrono::milliseconds limit);
+
+    std::chrono::milliseconds getFlusherStepTimeLimit() const;
+
+    /**
+     * Set the time the flusher may defer persisting a vbucket_state change
+     * which isn't accompanied by any mutations, so that it may be written
+     * as part of the next flush batch (0 to persist it immediately).
+     */
+    void setVBStatePersistDelay(std::chrono::milliseconds delay);
+
+    /**
+     * Set the time the flusher may wait after a SyncWrite requiring
+     * persistence is queued before flushing its vBucket, so that any
+     * SyncWrites which follow may be persisted in the same commit.
+     */
+    void setDurabilityGroupCommitWindow(std::chrono::microseconds window);
+
     void commit(KVStore& kvstore, Collections::VB::Flush& collectionsFlush);
 
-    /// Start the Flusher for all shards in this bucket.
+    Flusher* getFlusher(Vbid vbid) override;
+
+    /**
+     * @return the index of the Flusher persisting the vBuckets of the given
+     *         shard. The shards are assigned to the flushers round-robin, so
+     *         a KVStore is only ever written by a single flusher.
+     */
+    size_t getFlusherIndex(KVShard::id_type shardId) const {
+        return shardId % getNumFlushers();
+    }
+
+    /// @return the number of flushers the shards are assigned to
+    size_t getNumFlushers() const {
+        return numFlushers.load();
+    }
+
+    /**
+     * Set the number of flushers the shards are assigned to (0 for one per
+     * shard). Clamped to the number of shards.
+     */
+    void setNumFlushers(size_t count);
+
+    /// Start the Flushers of this bucket.
     void startFlusher();
 
-    /// Stop the Flusher for all shards in this bucket.
+    /// Stop the Flushers of this bucket.
     void stopFlusher();
 
     bool pauseFlusher() override;
@@ -71,14 +120,31 @@ public:
     void wakeUpFlusher() override;
 
     /**
-     * Starts the background fetcher for each shard.
+     * Starts the background fetchers of this bucket.
      * @return true if successful.
      */
     bool startBgFetcher();
 
-    /// Stops the background fetcher for each shard.
+    /// Stops the background fetchers of this bucket.
     void stopBgFetcher();
 
+    /**
+     * @return the BgFetcher reading the items of the given vBucket. The
+     *         vBuckets are assigned to the BgFetchers round-robin.
+     */
+    BgFetcher* getBgFetcher(Vbid vbid);
+
+    /// @return the number of BgFetchers the vBuckets are assigned to
+    size_t getNumBgFetchers() const {
+        return numBgFetchers.load();
+    }
+
+    /**
+     * Set the number of BgFetchers the vBuckets are assigned to (0 for one
+     * per shard). Clamped to the number of vBuckets.
+     */
+    void setNumBgFetchers(size_t count);
+
     ENGINE_ERROR_CODE scheduleCompaction(Vbid vbid,
                                          const CompactionConfig& c,
                                          const void* ck) override;
@@ -191,6 +257,17 @@ public:
 
     void warmupCompleted();
 
+    /**
+     * Start the disk phase of a vBucket deletion, unless
+     * vbucket_deletion_max_concurrent deletions are already deleting files.
+     *
+     * @return true if the deletion may go ahead; it must then call
+     *         completeVBucketFileDeletion() once finished
+     */
+    bool tryStartVBucketFileDeletion();
+
+    void completeVBucketFileDeletion();
+
 protected:
     // During the warmup phase we might want to enable external traffic
     // at a given point in time.. The LoadStorageKvPairCallback will be
@@ -201,6 +278,23 @@ protected:
 
     void flushOneDelOrSet(const queued_item& qi, VBucketPtr& vb);
 
+    /**
+     * Check if persisting the given vbucket_state change may be deferred
+     * (the caller must hold the vBucket lock).
+     *
+     * @param vb the vBucket
+     * @param transition the state to persist
+     * @param persistedVbState the currently persisted state (if any)
+     */
+    bool canDeferVBStatePersist(VBucket& vb,
+                                const vbucket_transition_state& transition,
+                                const vbucket_state* persistedVbState);
+
+    /// Defer persisting the vbucket_state change to the next flush batch
+    /// (or until the persist delay expires)
+    void deferVBStatePersist(VBucket& vb,
+                             const vbucket_transition_state& transition);
+
     /**
      * Compaction of a database file
      *
@@ -220,6 +314,33 @@ protected:
     /// function which is passed down to compactor for dropping keys
     void dropKey(Vbid vbid, const DiskDocKey& key, int64_t bySeqno);
 
+    /**
+     * Check whether compaction should reduce its I/O budget: while the disk
+     * write queue is over compaction_write_queue_cap, or when the mean
+     * latency of the PersistToMajority SyncWrites committed since the last
+     * check exceeds compaction_io_backoff_sync_write_latency.
+     * Only called by the compactionRateLimiter (which serialises calls).
+     */
+    bool shouldCompactionBackOff();
+
+    /**
+     * Persist the bloom filters of all vbuckets (which can be used after a
+     * warmup), once everything has been flushed at shutdown.
+     */
+    void persistBloomFilters();
+
+    /**
+     * Write the HashTable image of every vbucket which is fully persisted
+     * (see ResidentImage), once everything has been flushed at shutdown.
+     */
+    void writeResidentImages();
+
+    /**
+     * Remove any HashTable images left from the previous shutdown; they
+     * don't describe the vbuckets once they've been modified.
+     */
+    void removeResidentImages();
+
     /**
      * Max number of backill items in a single flusher batch before we split
      * into multiple batches.
@@ -228,11 +349,60 @@ protected:
      */
     std::atomic<size_t> flusherBatchSplitTrigger;
 
+    /**
+     * Max time (in ms) a Flusher may spend flushing vBuckets before
+     * yielding; see setFlusherStepTimeLimit.
+     */
+    std::atomic<size_t> flusherStepTimeLimit{0};
+
+    /// Max time (in ms) a vbucket_state change may be deferred by the flusher
+    std::atomic<size_t> vbStatePersistDelay{0};
+
+    /// Group commit window (in us) for SyncWrites requiring persistence
+    std::atomic<size_t> durabilityGroupCommitWindow{0};
+
+    /// Number of vBucket deletions currently deleting their file
+    std::atomic<size_t> vbucketFileDeletions{0};
+
+    /**
+     * One Flusher per shard; only the first numFlushers of them are assigned
+     * any shards (the others stay idle). The vector itself never changes
+     * once the bucket is created.
+     */
+    std::vector<std::unique_ptr<Flusher>> flushers;
+    std::atomic<size_t> numFlushers{1};
+
+    /**
+     * The BgFetchers, created on demand. Sized to the number of vBuckets up
+     * front and only the first numBgFetchers elements are assigned any
+     * vBuckets. A fetcher is never destroyed before the bucket, so a fetch
+     * queued just before the number of fetchers is reduced is still
+     * completed.
+     */
+    std::vector<std::unique_ptr<BgFetcher>> bgFetchers;
+    std::atomic<size_t> numBgFetchers{0};
+
+    /// Guards bgFetchers and bgFetchersStarted
+    std::mutex bgFetchersMutex;
+    bool bgFetchersStarted = false;
+
     /**
      * Indicates whether erroneous tombstones need to retained or not during
      * compaction
      */
     cb::RelaxedAtomic<bool> retainErroneousTombstones;
 
+    /// Budget for the disk I/O of all of the bucket's compactions.
+    std::unique_ptr<CompactionRateLimiter> compactionRateLimiter;
+
+    /// PersistToMajority SyncWrite latency (in ms) over which compaction
+    /// backs off; 0 to disable.
+    std::atomic<size_t> compactionIOBackoffSyncWriteLatency{0};
+
+    /// Number and total duration (us) of PersistToMajority SyncWrite
+    /// commits as of the last shouldCompactionBackOff() call.
+    uint64_t lastSyncWriteCommits = 0;
+    double lastSyncWriteCommitTime = 0;
+
     std::unique_ptr<Warmup> warmupTask;
 };
@@ -39,16 +39,18 @@
 #include "flusher.h"
 #include "hash_table_stat_visitor.h"
 #include "htresizer.h"
+#include "lock_profiler.h"
 #include "memory_tracker.h"
+#include "random_key_sampler.h"
 #include "replicationthrottle.h"
 #include "server_document_iface_border_guard.h"
+#include "slab_allocator.h"
 #include "stats-info.h"
 #include "statwriter.h"
 #include "string_utils.h"
 #include "vb_count_visitor.h"
 #include "warmup.h"
 
-#include <JSON_checker.h>
 #include <logger/logger.h>
 #include <memcached/audit_interface.h>
 #include <memcached/engine.h>
@@ -64,6 +66,7 @@
 #include <platform/scope_timer.h>
 #include <tracing/trace_helpers.h>
 #include <utilities/hdrhistogram.h>
+#include <utilities/json_validator.h>
 #include <utilities/logtags.h>
 #include <xattr/utils.h>
 
@@ -78,6 +81,7 @@
 #include <limits>
 #include <memory>
 #include <mutex>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -188,7 +192,13 @@ static void checkNumeric(const char* str) {
 void EventuallyPersistentEngine::destroy(const bool force) {
     auto eng = acquireEngine(this);
     eng->destroyInner(force);
+    const auto arena = eng->getEpStats().getMemoryArena();
     delete eng.get();
+    if (arena) {
+        // All of the bucket's memory has now been freed.
+        ObjectRegistry::removeArenaEngine();
+        getServerApiFunc()->alloc_hooks->release_arena(arena);
+    }
 }
 
 cb::EngineErrorItemPair EventuallyPersistentEngine::allocate(
@@ -328,6 +338,15 @@ cb::EngineErrorItemPair EventuallyPersistentEngine::get_locked(
     return cb::makeEngineErrorItemPair(cb::engine_errc(ret), itm, this);
 }
 
+cb::EngineErrorItemPair EventuallyPersistentEngine::get_replica(
+        gsl::not_null<const void*> cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        std::chrono::milliseconds maxStaleness) {
+    return acquireEngine(this)->getReplicaInner(
+            cookie, key, vbucket, maxStaleness);
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::unlock(
         gsl::not_null<const void*> cookie,
         const DocKey& key,
@@ -427,6 +446,15 @@ cb::mcbp::Status EventuallyPersistentEngine::setReplicationParam(
             getConfiguration().setReplicationThrottleQueueCap(std::stoll(val));
         } else if (key == "replication_throttle_cap_pcnt") {
             getConfiguration().setReplicationThrottleCapPcnt(std::stoull(val));
+        } else if (key == "replication_throttle_adaptive") {
+            getConfiguration().setReplicationThrottleAdaptive(cb_stob(val));
+        } else if (key == "replication_throttle_target_headroom") {
+            getConfiguration().setReplicationThrottleTargetHeadroom(
+                    std::stoull(val));
+        } else if (key == "replication_throttle_min_rate") {
+            getConfiguration().setReplicationThrottleMinRate(std::stoull(val));
+        } else if (key == "replication_throttle_max_rate") {
+            getConfiguration().setReplicationThrottleMaxRate(std::stoull(val));
         } else {
             msg = "Unknown config param";
             rv = cb::mcbp::Status::KeyEnoent;
@@ -477,6 +505,12 @@ cb::mcbp::Status EventuallyPersistentEngine::setCheckpointParam(
             getConfiguration().setItemNumBasedNewChk(cb_stob(val));
         } else if (key == "keep_closed_chks") {
             getConfiguration().setKeepClosedChks(cb_stob(val));
+        } else if (key == "chk_cursor_read_batch_size") {
+            getConfiguration().setChkCursorReadBatchSize(std::stoull(val));
+        } else if (key == "chk_max_size") {
+            getConfiguration().setChkMaxSize(std::stoull(val));
+        } else if (key == "checkpoint_memory_ratio") {
+            getConfiguration().setCheckpointMemoryRatio(std::stoull(val));
         } else if (key == "cursor_dropping_checkpoint_mem_upper_mark") {
             getConfiguration().setCursorDroppingCheckpointMemUpperMark(
                     std::stoull(val));
@@ -487,6 +521,8 @@ cb::mcbp::Status EventuallyPersistentEngine::setCheckpointParam(
             getConfiguration().setCursorDroppingLowerMark(std::stoull(val));
         } else if (key == "cursor_dropping_upper_mark") {
             getConfiguration().setCursorDroppingUpperMark(std::stoull(val));
+        } else if (key == "cursor_dropping_resume_from_memory") {
+            getConfiguration().setCursorDroppingResumeFromMemory(cb_stob(val));
         } else {
             msg = "Unknown config param";
             rv = cb::mcbp::Status::KeyEnoent;
@@ -573,16 +609,33 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setExpPagerEnabled(cb_stob(val));
         } else if (key == "exp_pager_stime") {
             getConfiguration().setExpPagerStime(std::stoull(val));
+        } else if (key == "exp_pager_index_full_scan_interval") {
+            getConfiguration().setExpPagerIndexFullScanInterval(
+                    std::stoull(val));
         } else if (key == "exp_pager_initial_run_time") {
             getConfiguration().setExpPagerInitialRunTime(std::stoll(val));
         } else if (key == "flusher_batch_split_trigger") {
             getConfiguration().setFlusherBatchSplitTrigger(std::stoll(val));
+        } else if (key == "flusher_step_time_limit") {
+            getConfiguration().setFlusherStepTimeLimit(std::stoull(val));
+        } else if (key == "flusher_vbstate_persist_delay") {
+            getConfiguration().setFlusherVbstatePersistDelay(std::stoull(val));
+        } else if (key == "max_num_flushers") {
+            getConfiguration().setMaxNumFlushers(std::stoull(val));
+        } else if (key == "max_num_bgfetchers") {
+            getConfiguration().setMaxNumBgfetchers(std::stoull(val));
+        } else if (key == "durability_group_commit_window") {
+            getConfiguration().setDurabilityGroupCommitWindow(std::stoull(val));
         } else if (key == "getl_default_timeout") {
             getConfiguration().setGetlDefaultTimeout(std::stoull(val));
         } else if (key == "getl_max_timeout") {
             getConfiguration().setGetlMaxTimeout(std::stoull(val));
         } else if (key == "ht_resize_interval") {
             getConfiguration().setHtResizeInterval(std::stoull(val));
+        } else if (key == "ht_resize_mode") {
+            getConfiguration().setHtResizeMode(val);
+        } else if (key == "ht_resize_step_buckets") {
+            getConfiguration().setHtResizeStepBuckets(std::stoull(val));
         } else if (key == "max_item_privileged_bytes") {
             getConfiguration().setMaxItemPrivilegedBytes(std::stoull(val));
         } else if (key == "max_item_size") {
@@ -613,6 +666,12 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
         } else if (key == "item_eviction_freq_counter_age_threshold") {
             getConfiguration().setItemEvictionFreqCounterAgeThreshold(
                     std::stoull(val));
+        } else if (key == "item_eviction_sample_size") {
+            getConfiguration().setItemEvictionSampleSize(std::stoull(val));
+        } else if (key == "stats_cache_max_age_ms") {
+            getConfiguration().setStatsCacheMaxAgeMs(std::stoull(val));
+        } else if (key == "lock_profiler_sample_rate") {
+            getConfiguration().setLockProfilerSampleRate(std::stoull(val));
         } else if (key == "item_freq_decayer_chunk_duration") {
             getConfiguration().setItemFreqDecayerChunkDuration(
                     std::stoull(val));
@@ -627,6 +686,10 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             size_t value = std::stoull(val);
             getConfiguration().setNumReaderThreads(value);
             ExecutorPool::get()->setNumReaders(value);
+        } else if (key == "num_reader_threads_reserved_for_bg_fetch") {
+            size_t value = std::stoull(val);
+            getConfiguration().setNumReaderThreadsReservedForBgFetch(value);
+            ExecutorPool::get()->setNumReadersReservedForBgFetch(value);
         } else if (key == "num_writer_threads") {
             size_t value = std::stoull(val);
             getConfiguration().setNumWriterThreads(value);
@@ -656,6 +719,12 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setItemCompressorInterval(v);
         } else if (key == "item_compressor_chunk_duration") {
             getConfiguration().setItemCompressorChunkDuration(std::stoull(val));
+        } else if (key == "item_compressor_sample_interval") {
+            getConfiguration().setItemCompressorSampleInterval(
+                    std::stoull(val));
+        } else if (key == "item_compressor_freq_counter_threshold") {
+            getConfiguration().setItemCompressorFreqCounterThreshold(
+                    std::stoull(val));
         } else if (key == "defragmenter_age_threshold") {
             getConfiguration().setDefragmenterAgeThreshold(std::stoull(val));
         } else if (key == "defragmenter_chunk_duration") {
@@ -663,10 +732,20 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
         } else if (key == "defragmenter_stored_value_age_threshold") {
             getConfiguration().setDefragmenterStoredValueAgeThreshold(
                     std::stoull(val));
+        } else if (key == "defragmenter_sparse_class_threshold") {
+            getConfiguration().setDefragmenterSparseClassThreshold(
+                    std::stoull(val));
         } else if (key == "defragmenter_run") {
             runDefragmenterTask();
         } else if (key == "compaction_write_queue_cap") {
             getConfiguration().setCompactionWriteQueueCap(std::stoull(val));
+        } else if (key == "compaction_max_bytes_per_sec") {
+            getConfiguration().setCompactionMaxBytesPerSec(std::stoull(val));
+        } else if (key == "compaction_max_iops") {
+            getConfiguration().setCompactionMaxIops(std::stoull(val));
+        } else if (key == "compaction_io_backoff_sync_write_latency") {
+            getConfiguration().setCompactionIoBackoffSyncWriteLatency(
+                    std::stoull(val));
         } else if (key == "chk_expel_enabled") {
             getConfiguration().setChkExpelEnabled(cb_stob(val));
         } else if (key == "dcp_min_compression_ratio") {
@@ -778,6 +857,8 @@ cb::mcbp::Status EventuallyPersistentEngine::setDcpParam(const std::string& key,
             validate(v, size_t(1), std::numeric_limits<size_t>::max());
             getConfiguration().setDcpConsumerProcessBufferedMessagesBatchSize(
                     v);
+        } else if (key == "dcp_consumer_processor_tasks") {
+            getConfiguration().setDcpConsumerProcessorTasks(std::stoull(val));
         } else if (key == "dcp_enable_noop") {
             getConfiguration().setDcpEnableNoop(cb_stob(val));
         } else if (key == "dcp_idle_timeout") {
@@ -787,6 +868,9 @@ cb::mcbp::Status EventuallyPersistentEngine::setDcpParam(const std::string& key,
             getConfiguration().setDcpIdleTimeout(v);
         } else if (key == "dcp_noop_tx_interval") {
             getConfiguration().setDcpNoopTxInterval(std::stoull(val));
+        } else if (key == "dcp_producer_checkpoint_processor_tasks") {
+            getConfiguration().setDcpProducerCheckpointProcessorTasks(
+                    std::stoull(val));
         } else if (key == "dcp_producer_snapshot_marker_yield_limit") {
             getConfiguration().setDcpProducerSnapshotMarkerYieldLimit(
                     std::stoull(val));
@@ -982,44 +1066,76 @@ static ENGINE_ERROR_CODE delVBucket(EventuallyPersistentEngine* e,
     return error;
 }
 
-ENGINE_ERROR_CODE EventuallyPersistentEngine::getReplicaCmd(
-        const cb::mcbp::Request& request,
-        const AddResponseFn& response,
-        const void* cookie) {
-    DocKey key = makeDocKey(cookie, request.getKey());
+cb::EngineErrorItemPair EventuallyPersistentEngine::getReplicaInner(
+        const void* cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        std::chrono::milliseconds maxStaleness) {
+    if (maxStaleness != std::chrono::milliseconds::max()) {
+        auto vb = getVBucket(vbucket);
+        if (vb && vb->getState() == vbucket_state_replica) {
+            const auto staleness = vb->getReplicaStaleness();
+            if (staleness > maxStaleness) {
+                ++getEpStats().numStaleReplicaReads;
+                setErrorContext(cookie,
+                                "Replica may be more out of date than the "
+                                "requested max staleness");
+                return cb::makeEngineErrorItemPair(
+                        cb::engine_errc::temporary_failure);
+            }
+        }
+    }
 
     auto options = static_cast<get_options_t>(
             QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | DELETE_TEMP |
             HIDE_LOCKED_CAS | TRACK_STATISTICS);
 
-    GetValue rv(getKVBucket()->getReplica(
-            key, request.getVBucket(), cookie, options));
+    GetValue rv(getKVBucket()->getReplica(key, vbucket, cookie, options));
     auto error_code = rv.getStatus();
     if (error_code != ENGINE_EWOULDBLOCK) {
         ++(getEpStats().numOpsGet);
     }
 
-    if (error_code == ENGINE_SUCCESS) {
-        uint32_t flags = rv.item->getFlags();
-        ServerDocumentIfaceBorderGuard guardedIface(*serverApi->document);
-        guardedIface.audit_document_access(
-                cookie, cb::audit::document::Operation::Read);
-        return sendResponse(response,
-                            static_cast<const void*>(rv.item->getKey().data()),
-                            rv.item->getKey().size(),
-                            (const void*)&flags,
-                            sizeof(uint32_t),
-                            static_cast<const void*>(rv.item->getData()),
-                            rv.item->getNBytes(),
-                            rv.item->getDataType(),
-                            cb::mcbp::Status::Success,
-                            rv.item->getCas(),
-                            cookie);
-    } else if (error_code == ENGINE_TMPFAIL) {
-        return ENGINE_KEY_ENOENT;
+    if (error_code == ENGINE_TMPFAIL) {
+        error_code = ENGINE_KEY_ENOENT;
     }
 
-    return error_code;
+    return cb::makeEngineErrorItemPair(
+            cb::engine_errc(error_code), rv.item.release(), this);
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::getReplicaCmd(
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response,
+        const void* cookie) {
+    DocKey key = makeDocKey(cookie, request.getKey());
+    auto maxStaleness = std::chrono::milliseconds::max();
+    const auto extras = request.getExtdata();
+    if (extras.size() == sizeof(uint32_t)) {
+        maxStaleness = std::chrono::milliseconds(
+                ntohl(*reinterpret_cast<const uint32_t*>(extras.data())));
+    }
+    auto rv = getReplicaInner(cookie, key, request.getVBucket(), maxStaleness);
+    if (rv.first != cb::engine_errc::success) {
+        return ENGINE_ERROR_CODE(rv.first);
+    }
+
+    const auto* it = reinterpret_cast<const Item*>(rv.second.get());
+    uint32_t flags = it->getFlags();
+    ServerDocumentIfaceBorderGuard guardedIface(*serverApi->document);
+    guardedIface.audit_document_access(cookie,
+                                       cb::audit::document::Operation::Read);
+    return sendResponse(response,
+                        static_cast<const void*>(it->getKey().data()),
+                        it->getKey().size(),
+                        (const void*)&flags,
+                        sizeof(uint32_t),
+                        static_cast<const void*>(it->getData()),
+                        it->getNBytes(),
+                        it->getDataType(),
+                        cb::mcbp::Status::Success,
+                        it->getCas(),
+                        cookie);
 }
 
 static ENGINE_ERROR_CODE compactDB(EventuallyPersistentEngine* e,
@@ -1201,6 +1317,8 @@ static ENGINE_ERROR_CODE processUnknownCommand(EventuallyPersistentEngine* h,
     case cb::mcbp::ClientOpcode::AddWithMeta:
     case cb::mcbp::ClientOpcode::AddqWithMeta:
         return h->setWithMeta(cookie, request, response);
+    case cb::mcbp::ClientOpcode::SetWithMetaMulti:
+        return h->setWithMetaMulti(cookie, request, response);
     case cb::mcbp::ClientOpcode::DelWithMeta:
     case cb::mcbp::ClientOpcode::DelqWithMeta:
         return h->deleteWithMeta(cookie, request, response);
@@ -1220,7 +1338,7 @@ static ENGINE_ERROR_CODE processUnknownCommand(EventuallyPersistentEngine* h,
         return rv;
     }
     case cb::mcbp::ClientOpcode::GetRandomKey:
-        return h->getRandomKey(cookie, response);
+        return h->getRandomKey(cookie, request, response);
     case cb::mcbp::ClientOpcode::GetKeys:
         return h->getAllKeys(cookie, request, response);
     default:
@@ -1744,7 +1862,8 @@ ENGINE_ERROR_CODE create_instance(GET_SERVER_API get_server_api,
     BucketLogger::setLoggerAPI(api->log);
 
     MemoryTracker::getInstance(*api->alloc_hooks);
-    ObjectRegistry::initialize(api->alloc_hooks->get_allocation_size);
+    ObjectRegistry::initialize(api->alloc_hooks->get_allocation_size,
+                               api->alloc_hooks->set_thread_arena);
 
     std::atomic<size_t>* inital_tracking = new std::atomic<size_t>();
 
@@ -1998,6 +2117,8 @@ public:
             engine.setMaxItemSize(value);
         } else if (key.compare("max_item_privileged_bytes") == 0) {
             engine.setMaxItemPrivilegedBytes(value);
+        } else if (key == "lock_profiler_sample_rate") {
+            LockProfiler::setSampleRate(value);
         }
     }
 
@@ -2033,6 +2154,23 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
 
     name = configuration.getCouchBucket();
 
+    if (configuration.isMemoryArena()) {
+        const auto* hooks = serverApi->alloc_hooks;
+        unsigned arena;
+        if (hooks->create_arena && hooks->create_arena(&arena)) {
+            stats->setMemoryArena(arena, hooks->get_arena_allocated);
+            ObjectRegistry::addArenaEngine();
+            // Move this thread onto the new arena.
+            ObjectRegistry::onSwitchThread(this);
+            EP_LOG_INFO("EPEngine::initialize: using memory arena {}", arena);
+        } else {
+            EP_LOG_WARN(
+                    "EPEngine::initialize: memory_arena is set but the "
+                    "allocator doesn't support arenas; tracking allocations "
+                    "instead");
+        }
+    }
+
     if (config != nullptr) {
         EP_LOG_INFO(R"(EPEngine::initialize: using configuration:"{}")",
                     config);
@@ -2092,6 +2230,11 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
             "getl_max_timeout",
             std::make_unique<EpEngineValueChangeListener>(*this));
 
+    LockProfiler::setSampleRate(configuration.getLockProfilerSampleRate());
+    configuration.addValueChangedListener(
+            "lock_profiler_sample_rate",
+            std::make_unique<EpEngineValueChangeListener>(*this));
+
     workload = new WorkLoadPolicy(configuration.getMaxNumWorkers(),
                                   configuration.getMaxNumShards());
     if ((unsigned int)workload->getNumShards() >
@@ -2116,6 +2259,9 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
     } else if (!flowCtlPolicy.compare("aggressive")) {
         dcpFlowControlManager_ =
                 std::make_unique<DcpFlowControlManagerAggressive>(*this);
+    } else if (!flowCtlPolicy.compare("adaptive")) {
+        dcpFlowControlManager_ =
+                std::make_unique<DcpFlowControlManagerAdaptive>(*this);
     } else {
         /* Flow control is not enabled */
         dcpFlowControlManager_ = std::make_unique<DcpFlowControlManager>(*this);
@@ -2660,7 +2806,11 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                     epstats.diskQueueSize, add_stat, cookie);
     add_casted_stat("ep_diskqueue_items",
                     epstats.diskQueueSize, add_stat, cookie);
-    auto* flusher = kvBucket->getFlusher(EP_PRIMARY_SHARD);
+    add_casted_stat("ep_replication_throttle_rate",
+                    getReplicationThrottle().getRate(),
+                    add_stat,
+                    cookie);
+    auto* flusher = kvBucket->getFlusher(Vbid(0));
     if (flusher) {
         add_casted_stat("ep_commit_num", epstats.flusherCommits,
                         add_stat, cookie);
@@ -2696,12 +2846,20 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
     add_casted_stat("ep_flush_duration_total",
                     epstats.cumulativeFlushTime, add_stat, cookie);
 
-    kvBucket->getAggregatedVBucketStats(cookie, add_stat);
+    aggregatedVBucketStatsCache.addStats(
+            std::chrono::milliseconds(configuration.getStatsCacheMaxAgeMs()),
+            cookie,
+            add_stat,
+            [this, cookie](const AddStatFn& addStat) {
+                kvBucket->getAggregatedVBucketStats(cookie, addStat);
+            });
 
     kvBucket->getFileStats(cookie, add_stat);
 
     add_casted_stat("ep_persist_vbstate_total",
                     epstats.totalPersistVBState, add_stat, cookie);
+    add_casted_stat("ep_persist_vbstate_deferred",
+                    epstats.totalDeferredVBState, add_stat, cookie);
 
     // Read the estimate first so any difference with precise can be seen
     add_casted_stat("mem_used_estimate",
@@ -2742,7 +2900,20 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
 #endif
     add_casted_stat(
             "ep_storedval_num", stats->getNumStoredVal(), add_stat, cookie);
+    const auto* slabs = kvBucket->getStoredValueSlabAllocator();
+    add_casted_stat("ep_storedval_slab_size",
+                    slabs ? slabs->getAllocatedBytes() : 0,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_storedval_slab_free_size",
+                    slabs ? slabs->getFreeBytes() : 0,
+                    add_stat,
+                    cookie);
     add_casted_stat("ep_overhead", stats->getMemOverhead(), add_stat, cookie);
+    add_casted_stat("ep_ht_huge_page_memory",
+                    stats->htHugePageMemory,
+                    add_stat,
+                    cookie);
     add_casted_stat("ep_item_num", stats->getNumItem(), add_stat, cookie);
 
     add_casted_stat("ep_oom_errors", stats->oom_errors, add_stat, cookie);
@@ -2756,18 +2927,38 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                     add_stat, cookie);
     add_casted_stat("ep_bg_meta_fetched", epstats.bg_meta_fetched,
                     add_stat, cookie);
+    add_casted_stat("ep_key_directory_hits", epstats.keyDirectoryHits,
+                    add_stat, cookie);
+    add_casted_stat("ep_negative_lookup_cache_hits",
+                    epstats.negativeLookupCacheHits, add_stat, cookie);
     add_casted_stat("ep_bg_remaining_items", epstats.numRemainingBgItems,
                     add_stat, cookie);
     add_casted_stat("ep_bg_remaining_jobs", epstats.numRemainingBgJobs,
                     add_stat, cookie);
     add_casted_stat("ep_num_pager_runs", epstats.pagerRuns,
                     add_stat, cookie);
+    add_casted_stat("ep_num_pager_predictive_runs",
+                    epstats.pagerPredictiveRuns,
+                    add_stat,
+                    cookie);
     add_casted_stat("ep_num_expiry_pager_runs", epstats.expiryPagerRuns,
                     add_stat, cookie);
+    add_casted_stat("ep_num_expiry_pager_full_scans",
+                    epstats.expiryPagerFullScans,
+                    add_stat,
+                    cookie);
     add_casted_stat("ep_num_freq_decayer_runs",
                     epstats.freqDecayerRuns,
                     add_stat,
                     cookie);
+    add_casted_stat("ep_tasks_runtime_ns",
+                    epstats.taskRuntimeNs.load(),
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_tasks_cpu_time_ns",
+                    epstats.taskCpuTimeNs.load(),
+                    add_stat,
+                    cookie);
     add_casted_stat("ep_items_expelled_from_checkpoints",
                     epstats.itemsExpelledFromCheckpoints,
                     add_stat, cookie);
@@ -2780,6 +2971,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                     add_stat, cookie);
     add_casted_stat("ep_num_not_my_vbuckets", epstats.numNotMyVBuckets,
                     add_stat, cookie);
+    add_casted_stat("ep_num_stale_replica_reads",
+                    epstats.numStaleReplicaReads,
+                    add_stat,
+                    cookie);
 
     add_casted_stat("ep_pending_ops", epstats.pendingOps, add_stat, cookie);
     add_casted_stat("ep_pending_ops_total", epstats.pendingOpsTotal,
@@ -2792,6 +2987,18 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
 
     add_casted_stat("ep_pending_compactions", epstats.pendingCompactions,
                     add_stat, cookie);
+    add_casted_stat("ep_compaction_io_throttled",
+                    epstats.compactionIOThrottled,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_compaction_io_throttle_time",
+                    epstats.compactionIOThrottleTime,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_compaction_io_backoffs",
+                    epstats.compactionIOBackoffs,
+                    add_stat,
+                    cookie);
     add_casted_stat("ep_rollback_count", epstats.rollbackCount,
                     add_stat, cookie);
 
@@ -2935,6 +3142,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                     epstats.defragStoredValueNumMoved,
                     add_stat,
                     cookie);
+    add_casted_stat("ep_defragmenter_num_skipped",
+                    epstats.defragNumSkipped,
+                    add_stat,
+                    cookie);
 
     add_casted_stat("ep_item_compressor_num_visited",
                     epstats.compressorNumVisited,
@@ -2944,6 +3155,18 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                     epstats.compressorNumCompressed,
                     add_stat,
                     cookie);
+    add_casted_stat("ep_item_compressor_num_skipped",
+                    epstats.compressorNumSkipped,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_item_compressor_num_hot",
+                    epstats.compressorNumHot,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_item_compressor_bytes_saved",
+                    epstats.compressorBytesSaved,
+                    add_stat,
+                    cookie);
 
     add_casted_stat("ep_cursor_dropping_lower_threshold",
                     epstats.cursorDroppingLThreshold, add_stat, cookie);
@@ -3008,6 +3231,27 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                         cookie);
     }
 
+    // Specific to Couchstore, when the block cache is enabled. The RO and RW
+    // stores of a shard share one cache, so only count the RW ones.
+    if (kvBucket->getKVStoreStat("block_cache_hits",
+                                 value,
+                                 KVBucketIface::KVSOption::RW)) {
+        add_casted_stat(
+                "ep_couchstore_block_cache_hits", value, add_stat, cookie);
+    }
+    if (kvBucket->getKVStoreStat("block_cache_misses",
+                                 value,
+                                 KVBucketIface::KVSOption::RW)) {
+        add_casted_stat(
+                "ep_couchstore_block_cache_misses", value, add_stat, cookie);
+    }
+    if (kvBucket->getKVStoreStat("block_cache_mem_used",
+                                 value,
+                                 KVBucketIface::KVSOption::RW)) {
+        add_casted_stat(
+                "ep_couchstore_block_cache_mem_used", value, add_stat, cookie);
+    }
+
     // Specific to RocksDB. Cumulative ep-engine stats.
     // Note: These are also reported per-shard in 'kvstore' stats.
     // Memory Usage
@@ -3173,6 +3417,15 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doMemoryStats(
 #endif
     add_casted_stat(
             "ep_storedval_num", stats->getNumStoredVal(), add_stat, cookie);
+    const auto* slabs = kvBucket->getStoredValueSlabAllocator();
+    add_casted_stat("ep_storedval_slab_size",
+                    slabs ? slabs->getAllocatedBytes() : 0,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_storedval_slab_free_size",
+                    slabs ? slabs->getFreeBytes() : 0,
+                    add_stat,
+                    cookie);
     add_casted_stat("ep_item_num", stats->getNumItem(), add_stat, cookie);
 
     std::map<std::string, size_t> alloc_stats;
@@ -3806,6 +4059,26 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doDcpStats(
         const void* cookie,
         const AddStatFn& add_stat,
         cb::const_char_buffer value) {
+    // Only the unfiltered group is cached.
+    if (value.empty()) {
+        dcpStatsCache.addStats(
+                std::chrono::milliseconds(
+                        configuration.getStatsCacheMaxAgeMs()),
+                cookie,
+                add_stat,
+                [this, cookie](const AddStatFn& addStat) {
+                    doDcpStatsInner(cookie, addStat, {});
+                });
+        return ENGINE_SUCCESS;
+    }
+    doDcpStatsInner(cookie, add_stat, value);
+    return ENGINE_SUCCESS;
+}
+
+void EventuallyPersistentEngine::doDcpStatsInner(
+        const void* cookie,
+        const AddStatFn& add_stat,
+        cb::const_char_buffer value) {
     ConnCounter aggregator;
     ConnStatBuilder dcpVisitor(
             cookie, add_stat, DcpStatsFilter{value}, aggregator);
@@ -3830,7 +4103,6 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doDcpStats(
                     dcpConnMap_->getMaxActiveSnoozingBackfills(), add_stat, cookie);
 
     dcpConnMap_->addStats(add_stat, cookie);
-    return ENGINE_SUCCESS;
 }
 
 ENGINE_ERROR_CODE EventuallyPersistentEngine::doEvictionStats(
@@ -4027,6 +4299,22 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doTimingStats(
                     stats->syncWriteCommitTimes.at(2),
                     add_stat,
                     cookie);
+    add_casted_stat("sync_write_persist_wait",
+                    stats->syncWritePersistWaitHisto,
+                    add_stat,
+                    cookie);
+    for (const auto& entry : *stats->syncWriteReplicaAckTimes.rlock()) {
+        add_casted_stat(("sync_write_ack_" + entry.first).c_str(),
+                        entry.second,
+                        add_stat,
+                        cookie);
+    }
+
+    // Replication stats
+    add_casted_stat("replication_apply_delay",
+                    stats->replicationApplyDelayHisto,
+                    add_stat,
+                    cookie);
 
     return ENGINE_SUCCESS;
 }
@@ -4044,6 +4332,12 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doSchedulerStats(
                         add_stat,
                         cookie);
     }
+    for (size_t ii = 0; ii < stats->readerClassSchedulingHisto.size(); ++ii) {
+        add_casted_stat(("reader_class_" + to_string(ReaderClass(ii))).c_str(),
+                        stats->readerClassSchedulingHisto[ii],
+                        add_stat,
+                        cookie);
+    }
 
     return ENGINE_SUCCESS;
 }
@@ -4060,6 +4354,65 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doRunTimeStats(
     return ENGINE_SUCCESS;
 }
 
+ENGINE_ERROR_CODE EventuallyPersistentEngine::doTopTasksStats(
+        const void* cookie,
+        const AddStatFn& add_stat,
+        cb::const_char_buffer keyArgs) {
+    std::string args(keyArgs.data(), keyArgs.size());
+    args.erase(0, args.find_first_not_of(' '));
+    size_t seconds = 10;
+    if (!args.empty()) {
+        try {
+            seconds = std::stoull(args);
+        } catch (const std::exception&) {
+            return ENGINE_EINVAL;
+        }
+        if (seconds == 0 || seconds > TaskRuntimeWindow::windowSeconds) {
+            return ENGINE_EINVAL;
+        }
+    }
+
+    const auto now = ep_current_time();
+    std::vector<std::pair<std::chrono::nanoseconds, TaskId>> runtimes;
+    std::chrono::nanoseconds total(0);
+    for (TaskId id : GlobalTask::allTaskIds) {
+        const auto runtime = stats->taskRuntimeWindow.getRuntime(
+                static_cast<int>(id), now, seconds);
+        if (runtime.count() > 0) {
+            runtimes.emplace_back(runtime, id);
+            total += runtime;
+        }
+    }
+    std::sort(runtimes.begin(),
+              runtimes.end(),
+              [](const std::pair<std::chrono::nanoseconds, TaskId>& a,
+                 const std::pair<std::chrono::nanoseconds, TaskId>& b) {
+                  return a.first > b.first;
+              });
+
+    add_casted_stat("ep_tasks_top:window_s", seconds, add_stat, cookie);
+    add_casted_stat(
+            "ep_tasks_top:total_runtime_ns", total.count(), add_stat, cookie);
+    for (size_t rank = 0; rank < runtimes.size(); ++rank) {
+        const auto prefix = "ep_tasks_top:" + std::to_string(rank) + ":";
+        add_casted_stat((prefix + "task").c_str(),
+                        getTaskDescrForStats(runtimes[rank].second),
+                        add_stat,
+                        cookie);
+        add_casted_stat((prefix + "runtime_ns").c_str(),
+                        runtimes[rank].first.count(),
+                        add_stat,
+                        cookie);
+        // Share of the runtime of all of this bucket's tasks in the window.
+        add_casted_stat((prefix + "share_pct").c_str(),
+                        runtimes[rank].first.count() * 100 / total.count(),
+                        add_stat,
+                        cookie);
+    }
+
+    return ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::doDispatcherStats(
         const void* cookie, const AddStatFn& add_stat) {
     ExecutorPool::get()->doWorkerStat(ObjectRegistry::getCurrentEngine(),
@@ -4112,6 +4465,12 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doWorkloadStats(
         checked_snprintf(statname, sizeof(statname), "ep_workload:max_nonio");
         add_casted_stat(statname, max_nonio, add_stat, cookie);
 
+        int maxBackgroundReaders = expool->getMaxBackgroundReaders();
+        checked_snprintf(statname,
+                         sizeof(statname),
+                         "ep_workload:max_background_readers");
+        add_casted_stat(statname, maxBackgroundReaders, add_stat, cookie);
+
         int shards = workload->getNumShards();
         checked_snprintf(statname, sizeof(statname), "ep_workload:num_shards");
         add_casted_stat(statname, shards, add_stat, cookie);
@@ -4532,6 +4891,16 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getStats(
     if (key == "runtimes"_ccb) {
         return doRunTimeStats(cookie, add_stat);
     }
+    if (cb_isPrefix(key, "tasks-top")) {
+        const size_t keyLen = strlen("tasks-top");
+        cb::const_char_buffer keyArgs(key.data() + keyLen,
+                                      key.size() - keyLen);
+        return doTopTasksStats(cookie, add_stat, keyArgs);
+    }
+    if (key == "lock-profile"_ccb) {
+        LockProfiler::addStats(add_stat, cookie);
+        return ENGINE_SUCCESS;
+    }
     if (key == "memory"_ccb) {
         return doMemoryStats(cookie, add_stat);
     }
@@ -4562,6 +4931,14 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getStats(
         }
         return ENGINE_KEY_ENOENT;
     }
+    if (key == "warmup timeline"_ccb) {
+        const auto* warmup = getKVBucket()->getWarmup();
+        if (warmup != nullptr) {
+            warmup->addTimelineStats(add_stat, cookie);
+            return ENGINE_SUCCESS;
+        }
+        return ENGINE_KEY_ENOENT;
+    }
     if (key == "info"_ccb) {
         add_casted_stat("info", get_stats_info(), add_stat, cookie);
         return ENGINE_SUCCESS;
@@ -5042,34 +5419,46 @@ bool EventuallyPersistentEngine::decodeWithMetaOptions(
         CheckConflicts& checkConflicts,
         PermittedVBStates& permittedVBStates,
         DeleteSource& deleteSource) {
-    bool forceFlag = false;
+    uint32_t options = 0;
     if (extras.size() == 28 || extras.size() == 30) {
         const size_t fixed_extras_size = 24;
-        uint32_t options;
         memcpy(&options, extras.data() + fixed_extras_size, sizeof(options));
         options = ntohl(options);
+    }
+    return decodeWithMetaOptions(options,
+                                 generateCas,
+                                 checkConflicts,
+                                 permittedVBStates,
+                                 deleteSource);
+}
 
-        if (options & SKIP_CONFLICT_RESOLUTION_FLAG) {
-            checkConflicts = CheckConflicts::No;
-        }
+bool EventuallyPersistentEngine::decodeWithMetaOptions(
+        uint32_t options,
+        GenerateCas& generateCas,
+        CheckConflicts& checkConflicts,
+        PermittedVBStates& permittedVBStates,
+        DeleteSource& deleteSource) {
+    bool forceFlag = false;
+    if (options & SKIP_CONFLICT_RESOLUTION_FLAG) {
+        checkConflicts = CheckConflicts::No;
+    }
 
-        if (options & FORCE_ACCEPT_WITH_META_OPS) {
-            forceFlag = true;
-        }
+    if (options & FORCE_ACCEPT_WITH_META_OPS) {
+        forceFlag = true;
+    }
 
-        if (options & REGENERATE_CAS) {
-            generateCas = GenerateCas::Yes;
-        }
+    if (options & REGENERATE_CAS) {
+        generateCas = GenerateCas::Yes;
+    }
 
-        if (options & FORCE_WITH_META_OP) {
-            permittedVBStates.set(vbucket_state_replica);
-            permittedVBStates.set(vbucket_state_pending);
-            checkConflicts = CheckConflicts::No;
-        }
+    if (options & FORCE_WITH_META_OP) {
+        permittedVBStates.set(vbucket_state_replica);
+        permittedVBStates.set(vbucket_state_pending);
+        checkConflicts = CheckConflicts::No;
+    }
 
-        if (options & IS_EXPIRATION) {
-            deleteSource = DeleteSource::TTL;
-        }
+    if (options & IS_EXPIRATION) {
+        deleteSource = DeleteSource::TTL;
     }
 
     // Validate options
@@ -5123,8 +5512,8 @@ protocol_binary_datatype_t EventuallyPersistentEngine::checkForDatatypeJson(
             body = cb::xattr::get_body(body);
         }
 
-        if (checkUTF8JSON(reinterpret_cast<const uint8_t*>(body.data()),
-                          body.size())) {
+        if (cb::isValidJson(reinterpret_cast<const uint8_t*>(body.data()),
+                            body.size())) {
             datatype |= PROTOCOL_BINARY_DATATYPE_JSON;
         }
     }
@@ -5382,6 +5771,169 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
     return ret;
 }
 
+/**
+ * The progress of a SetWithMetaMulti request, kept in the engine specific
+ * of the cookie while the request is blocked.
+ */
+struct SetWithMetaMultiContext {
+    /// The opaque of the request (to detect a context left behind by a
+    /// request which failed while blocked)
+    uint32_t opaque = 0;
+    /// The next entry to apply
+    size_t next = 0;
+    /// The status (2 bytes) and CAS (8 bytes) of each of the applied
+    /// entries, in network byte order
+    std::vector<uint8_t> results;
+};
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMetaMulti(
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    using cb::mcbp::request::SetWithMetaMultiEntry;
+    if (isDegradedMode()) {
+        return ENGINE_TMPFAIL;
+    }
+
+    // The (optional) extras holds the options for all of the entries
+    uint32_t options = 0;
+    const auto extras = request.getExtdata();
+    if (extras.size() == sizeof(options)) {
+        memcpy(&options, extras.data(), sizeof(options));
+        options = ntohl(options);
+    }
+    CheckConflicts checkConflicts = CheckConflicts::Yes;
+    PermittedVBStates permittedVBStates{vbucket_state_active};
+    GenerateCas generateCas = GenerateCas::No;
+    DeleteSource deleteSource = DeleteSource::Explicit;
+    if (!decodeWithMetaOptions(options,
+                               generateCas,
+                               checkConflicts,
+                               permittedVBStates,
+                               deleteSource)) {
+        return ENGINE_EINVAL;
+    }
+
+    // The validator checked the entries
+    struct Entry {
+        const SetWithMetaMultiEntry* header;
+        DocKey key;
+        cb::const_byte_buffer value;
+    };
+    std::vector<Entry> entries;
+    SetWithMetaMultiEntry::parse(
+            request.getValue(),
+            [this, cookie, &entries](const SetWithMetaMultiEntry& entry,
+                                     cb::const_byte_buffer key,
+                                     cb::const_byte_buffer value) {
+                entries.push_back({&entry, makeDocKey(cookie, key), value});
+                return true;
+            });
+
+    auto* ctx = static_cast<SetWithMetaMultiContext*>(
+            getEngineSpecific(cookie));
+    if (ctx && ctx->opaque != request.getOpaque()) {
+        delete ctx;
+        ctx = nullptr;
+    }
+    if (ctx == nullptr) {
+        auto newCtx = std::make_unique<SetWithMetaMultiContext>();
+        newCtx->opaque = request.getOpaque();
+        newCtx->results.reserve(entries.size() *
+                                (sizeof(uint16_t) + sizeof(uint64_t)));
+        if (checkConflicts == CheckConflicts::Yes) {
+            // Queue the meta-only BgFetch of every non-resident document up
+            // front so that the BgFetcher reads them in one batch, rather
+            // than one at a time as each entry blocks.
+            for (const auto& entry : entries) {
+                auto vb = kvBucket->getVBucket(entry.header->getVBucket());
+                if (vb) {
+                    VBucket::StateReadLockHolder rlh(vb->getStateLock());
+                    if (vb->getState() == vbucket_state_active) {
+                        vb->fetchMetaForConflictResolution(entry.key, *this);
+                    }
+                }
+            }
+        }
+        ctx = newCtx.release();
+        storeEngineSpecific(cookie, ctx);
+    }
+
+    for (; ctx->next < entries.size(); ++ctx->next) {
+        const auto& entry = entries[ctx->next];
+        const auto& meta = entry.header->getMeta();
+        uint64_t cas = 0;
+        uint64_t bySeqno = 0;
+        ENGINE_ERROR_CODE ret;
+        try {
+            ret = setWithMeta(entry.header->getVBucket(),
+                              entry.key,
+                              entry.value,
+                              {meta.getCas(),
+                               meta.getSeqno(),
+                               meta.getFlagsInNetworkByteOrder(),
+                               time_t(meta.getExpiration())},
+                              false /*isDeleted*/,
+                              entry.header->getDatatype(),
+                              cas,
+                              &bySeqno,
+                              cookie,
+                              permittedVBStates,
+                              checkConflicts,
+                              true /*allowExisting*/,
+                              GenerateBySeqno::Yes,
+                              generateCas,
+                              {});
+        } catch (const std::bad_alloc&) {
+            ret = ENGINE_ENOMEM;
+        }
+
+        if (ret == ENGINE_EWOULDBLOCK) {
+            ++stats->numOpsGetMetaOnSetWithMeta;
+            return ret;
+        }
+
+        if (ret == ENGINE_SUCCESS) {
+            ServerDocumentIfaceBorderGuard guardedIface(*serverApi->document);
+            guardedIface.audit_document_access(
+                    cookie, cb::audit::document::Operation::Modify);
+            ++stats->numOpsSetMeta;
+        }
+
+        cb::mcbp::Status status;
+        try {
+            status = serverApi->cookie->engine_error2mcbp(cookie, ret);
+        } catch (const cb::engine_error&) {
+            delete ctx;
+            storeEngineSpecific(cookie, nullptr);
+            return ENGINE_DISCONNECT;
+        }
+        const uint16_t netStatus = htons(uint16_t(status));
+        const uint64_t netCas = htonll(cas);
+        const auto* statusBytes = reinterpret_cast<const uint8_t*>(&netStatus);
+        const auto* casBytes = reinterpret_cast<const uint8_t*>(&netCas);
+        ctx->results.insert(ctx->results.end(),
+                            statusBytes,
+                            statusBytes + sizeof(netStatus));
+        ctx->results.insert(
+                ctx->results.end(), casBytes, casBytes + sizeof(netCas));
+    }
+
+    std::unique_ptr<SetWithMetaMultiContext> done(ctx);
+    storeEngineSpecific(cookie, nullptr);
+    return sendResponse(response,
+                        nullptr,
+                        0,
+                        nullptr,
+                        0,
+                        done->results.data(),
+                        uint32_t(done->results.size()),
+                        PROTOCOL_BINARY_RAW_BYTES,
+                        cb::mcbp::Status::Success,
+                        0,
+                        cookie);
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::deleteWithMeta(
         const void* cookie,
         const cb::mcbp::Request& request,
@@ -5762,14 +6314,20 @@ EventuallyPersistentEngine::returnMeta(const void* cookie,
  * allKeys to 34000 (1000 * 32 + 1000 * 2), the additional 2 bytes per
  * key is for the keylength.
  *
- * This initially allocated buffersize is doubled whenever the length
- * of the buffer holding all the keys, crosses the buffersize.
+ * The size of the buffer is bounded by maxBytes (if non-zero): once the
+ * next key wouldn't fit the enumeration is stopped, and the key is kept
+ * so the client may resume the enumeration from it. At least one key is
+ * always returned so the client makes progress.
  */
-class AllKeysCallback : public Callback<const DiskDocKey&> {
+class AllKeysCallback : public StatusCallback<const DiskDocKey&> {
 public:
-    AllKeysCallback(bool collectionsSupported)
-        : collectionsSupported(collectionsSupported) {
-        buffer.reserve((avgKeySize + sizeof(uint16_t)) * expNumKeys);
+    AllKeysCallback(bool collectionsSupported, size_t maxBytes)
+        : collectionsSupported(collectionsSupported), maxBytes(maxBytes) {
+        size_t initial = (avgKeySize + sizeof(uint16_t)) * expNumKeys;
+        if (maxBytes != 0) {
+            initial = std::min(initial, maxBytes);
+        }
+        buffer.reserve(initial);
     }
 
     void callback(const DiskDocKey& key) {
@@ -5789,10 +6347,13 @@ public:
             }
         }
 
-        if (buffer.size() + outKey.size() + sizeof(uint16_t) > buffer.size()) {
-            // Reserve the 2x space for the copy-to buffer.
-            buffer.reserve(buffer.size()*2);
+        if (maxBytes != 0 && !buffer.empty() &&
+            buffer.size() + sizeof(uint16_t) + outKey.size() > maxBytes) {
+            resumeKey.assign(outKey.data(), outKey.data() + outKey.size());
+            setStatus(ENGINE_E2BIG);
+            return;
         }
+
         uint16_t outlen = htons(outKey.size());
         // insert 1 x u16
         const auto* outlenPtr = reinterpret_cast<const char*>(&outlen);
@@ -5805,9 +6366,20 @@ public:
     char* getAllKeysPtr() { return buffer.data(); }
     uint64_t getAllKeysLen() { return buffer.size(); }
 
+    /**
+     * @return the key the enumeration should be resumed from (encoded as
+     *         the client encodes its keys), or an empty buffer if the
+     *         enumeration wasn't stopped by the size limit
+     */
+    const std::vector<char>& getResumeKey() const {
+        return resumeKey;
+    }
+
 private:
     std::vector<char> buffer;
+    std::vector<char> resumeKey;
     bool collectionsSupported{false};
+    const size_t maxBytes;
     static const int avgKeySize = 32;
     static const int expNumKeys = 1000;
 };
@@ -5824,7 +6396,8 @@ public:
                      const DocKey start_key_,
                      Vbid vbucket,
                      uint32_t count_,
-                     bool collectionsSupported)
+                     bool collectionsSupported,
+                     size_t maxBytes)
         : GlobalTask(e, TaskId::FetchAllKeysTask, 0, false),
           engine(e),
           cookie(c),
@@ -5833,7 +6406,8 @@ public:
           start_key(start_key_),
           vbid(vbucket),
           count(count_),
-          collectionsSupported(collectionsSupported) {
+          collectionsSupported(collectionsSupported),
+          maxBytes(maxBytes) {
     }
 
     std::string getDescription() {
@@ -5865,18 +6439,22 @@ public:
                                0,
                                cookie);
         } else {
-            auto cb = std::make_shared<AllKeysCallback>(collectionsSupported);
+            auto cb = std::make_shared<AllKeysCallback>(collectionsSupported,
+                                                        maxBytes);
             err = engine->getKVBucket()->getROUnderlying(vbid)->getAllKeys(
                                                     vbid, start_key, count, cb);
             if (err == ENGINE_SUCCESS) {
+                // The key of the response holds the start key of the next
+                // chunk when the response was cut short by the size limit
+                const auto& resumeKey = cb->getResumeKey();
                 err = sendResponse(
                         response,
+                        resumeKey.data(),
+                        resumeKey.size(),
                         NULL,
                         0,
-                        NULL,
-                        0,
-                        ((AllKeysCallback*)cb.get())->getAllKeysPtr(),
-                        ((AllKeysCallback*)cb.get())->getAllKeysLen(),
+                        cb->getAllKeysPtr(),
+                        cb->getAllKeysLen(),
                         PROTOCOL_BINARY_RAW_BYTES,
                         cb::mcbp::Status::Success,
                         0,
@@ -5897,6 +6475,7 @@ private:
     Vbid vbid;
     uint32_t count;
     bool collectionsSupported{false};
+    const size_t maxBytes;
 };
 
 ENGINE_ERROR_CODE
@@ -5935,14 +6514,15 @@ EventuallyPersistentEngine::getAllKeys(const void* cookie,
     }
 
     DocKey start_key = makeDocKey(cookie, request.getKey());
-    ExTask task =
-            std::make_shared<FetchAllKeysTask>(this,
-                                               cookie,
-                                               response,
-                                               start_key,
-                                               request.getVBucket(),
-                                               count,
-                                               isCollectionsSupported(cookie));
+    ExTask task = std::make_shared<FetchAllKeysTask>(
+            this,
+            cookie,
+            response,
+            start_key,
+            request.getVBucket(),
+            count,
+            isCollectionsSupported(cookie),
+            configuration.getGetAllKeysMaxResponseBytes());
     ExecutorPool::get()->schedule(task);
     return ENGINE_EWOULDBLOCK;
 }
@@ -5970,8 +6550,103 @@ void EventuallyPersistentEngine::notifyIOComplete(const void* cookie,
     }
 }
 
+/**
+ * Task building a uniform sample of the keys of the bucket and sending the
+ * keys back (encoded as in a GET_KEYS response). The whole bucket is
+ * visited, in chunks so the task doesn't hog the thread.
+ */
+class RandomKeySampleTask : public GlobalTask {
+public:
+    RandomKeySampleTask(EventuallyPersistentEngine* e,
+                        const void* c,
+                        const AddResponseFn& resp,
+                        size_t count,
+                        boost::optional<CollectionID> collection,
+                        bool collectionsSupported)
+        : GlobalTask(e, TaskId::RandomKeySampleTask, 0, false),
+          engine(e),
+          cookie(c),
+          response(resp),
+          collectionsSupported(collectionsSupported),
+          position(e->getKVBucket()->startPosition()),
+          adapter(std::make_unique<RandomKeySampler>(
+                  count, collection, std::random_device{}())) {
+    }
+
+    std::string getDescription() {
+        return "Sampling random keys";
+    }
+
+    std::chrono::microseconds maxExpectedDuration() {
+        return chunkDuration * 2;
+    }
+
+    bool run() {
+        TRACE_EVENT0("ep-engine/task", "RandomKeySampleTask");
+        auto& sampler = static_cast<RandomKeySampler&>(adapter.getHTVisitor());
+        sampler.setDeadline(std::chrono::steady_clock::now() + chunkDuration);
+        position = engine->getKVBucket()->pauseResumeVisit(adapter, position);
+        if (!(position == engine->getKVBucket()->endPosition())) {
+            snooze(0);
+            return true;
+        }
+
+        std::vector<char> buffer;
+        for (const auto& key : sampler.getSample()) {
+            const DocKey outKey =
+                    collectionsSupported
+                            ? DocKey(key)
+                            : DocKey(key).makeDocKeyWithoutCollectionID();
+            uint16_t outlen = htons(outKey.size());
+            const auto* outlenPtr = reinterpret_cast<const char*>(&outlen);
+            buffer.insert(
+                    buffer.end(), outlenPtr, outlenPtr + sizeof(uint16_t));
+            buffer.insert(buffer.end(),
+                          outKey.data(),
+                          outKey.data() + outKey.size());
+        }
+
+        ENGINE_ERROR_CODE err = sendResponse(response,
+                                             NULL,
+                                             0,
+                                             NULL,
+                                             0,
+                                             buffer.data(),
+                                             buffer.size(),
+                                             PROTOCOL_BINARY_RAW_BYTES,
+                                             cb::mcbp::Status::Success,
+                                             0,
+                                             cookie);
+        // The result is handed over like the result of a GET_KEYS (the
+        // cookie only executes one command at a time)
+        engine->addLookupAllKeys(cookie, err);
+        engine->notifyIOComplete(cookie, err);
+        return false;
+    }
+
+private:
+    // How long the task may visit the hash tables before yielding
+    static constexpr std::chrono::milliseconds chunkDuration{25};
+
+    EventuallyPersistentEngine* engine;
+    const void* cookie;
+    AddResponseFn response;
+    const bool collectionsSupported;
+    KVBucketIface::Position position;
+    PauseResumeVBAdapter adapter;
+};
+
+constexpr std::chrono::milliseconds RandomKeySampleTask::chunkDuration;
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::getRandomKey(
-        const void* cookie, const AddResponseFn& response) {
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    auto extras = request.getExtdata();
+    if (!extras.empty()) {
+        return sampleRandomKeys(cookie, extras, response);
+    }
+
     GetValue gv(kvBucket->getRandomKey());
     ENGINE_ERROR_CODE ret = gv.getStatus();
 
@@ -5996,6 +6671,51 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getRandomKey(
     return ret;
 }
 
+ENGINE_ERROR_CODE EventuallyPersistentEngine::sampleRandomKeys(
+        const void* cookie,
+        cb::const_byte_buffer extras,
+        const AddResponseFn& response) {
+    {
+        LockHolder lh(lookupMutex);
+        auto it = allKeysLookups.find(cookie);
+        if (it != allKeysLookups.end()) {
+            ENGINE_ERROR_CODE err = it->second;
+            allKeysLookups.erase(it);
+            return err;
+        }
+    }
+
+    // extras: no. of keys to sample, [collection]
+    const auto* payload = reinterpret_cast<const uint32_t*>(extras.data());
+    size_t count = ntohl(payload[0]);
+    if (count == 0) {
+        return ENGINE_EINVAL;
+    }
+    count = std::min(count, configuration.getRandomKeyMaxSampleSize());
+
+    boost::optional<CollectionID> collection;
+    if (extras.size() == 2 * sizeof(uint32_t)) {
+        collection = CollectionID(ntohl(payload[1]));
+    }
+    if (!isCollectionsSupported(cookie)) {
+        // Only the keys of the default collection can be returned
+        if (collection && !collection->isDefaultCollection()) {
+            return ENGINE_EINVAL;
+        }
+        collection = CollectionID(CollectionID::Default);
+    }
+
+    ExTask task = std::make_shared<RandomKeySampleTask>(
+            this,
+            cookie,
+            response,
+            count,
+            collection,
+            isCollectionsSupported(cookie));
+    ExecutorPool::get()->schedule(task);
+    return ENGINE_EWOULDBLOCK;
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::dcpOpen(
         const void* cookie,
         uint32_t opaque,
@@ -6104,6 +6824,11 @@ void EventuallyPersistentEngine::handleDisconnect(const void *cookie) {
             storeEngineSpecific(cookie, NULL);
             break;
         }
+        case cb::mcbp::ClientOpcode::SetWithMetaMulti:
+            delete static_cast<SetWithMetaMultiContext*>(
+                    getEngineSpecific(cookie));
+            storeEngineSpecific(cookie, nullptr);
+            break;
             default:
                 break;
             }
@@ -6443,6 +7168,7 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::setVBucketState(
 EventuallyPersistentEngine::~EventuallyPersistentEngine() {
     if (kvBucket) {
         kvBucket->deinitialize();
+        kvBucket->releaseHashTables();
     }
     EP_LOG_INFO("~EPEngine: Completed deinitialize.");
     delete workload;
@@ -6484,6 +7210,11 @@ void EpEngineTaskable::logRunTime(
     myEngine->getKVBucket()->logRunTime(id, runTime);
 }
 
+void EpEngineTaskable::logCpuTime(TaskId id,
+                                  const std::chrono::nanoseconds cpuTime) {
+    myEngine->getKVBucket()->logCpuTime(id, cpuTime);
+}
+
 item_info EventuallyPersistentEngine::getItemInfo(const Item& item) {
     VBucketPtr vb = getKVBucket()->getVBucket(item.getVBucketId());
     uint64_t uuid = 0;
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "cached_stats.h"
 #include "configuration.h"
 #include "connhandler.h"
 #include "permitted_vb_states.h"
@@ -87,6 +88,8 @@ public:
     void logRunTime(TaskId id,
                     const std::chrono::steady_clock::duration runTime);
 
+    void logCpuTime(TaskId id, const std::chrono::nanoseconds cpuTime);
+
 private:
     EventuallyPersistentEngine* myEngine;
 };
@@ -146,6 +149,12 @@ public:
                                        Vbid vbucket,
                                        uint32_t lock_timeout) override;
 
+    cb::EngineErrorItemPair get_replica(
+            gsl::not_null<const void*> cookie,
+            const DocKey& key,
+            Vbid vbucket,
+            std::chrono::milliseconds maxStaleness) override;
+
     ENGINE_ERROR_CODE unlock(gsl::not_null<const void*> cookie,
                              const DocKey& key,
                              Vbid vbucket,
@@ -464,6 +473,12 @@ public:
                                      Vbid vbucket,
                                      uint32_t lock_timeout);
 
+    cb::EngineErrorItemPair getReplicaInner(
+            const void* cookie,
+            const DocKey& key,
+            Vbid vbucket,
+            std::chrono::milliseconds maxStaleness);
+
     ENGINE_ERROR_CODE unlockInner(const void* cookie,
                                   const DocKey& key,
                                   Vbid vbucket,
@@ -511,6 +526,17 @@ public:
                                   const cb::mcbp::Request& request,
                                   const AddResponseFn& response);
 
+    /**
+     * Apply every SetWithMeta entry in the value of a SetWithMetaMulti
+     * request. The metadata needed for the conflict resolution of the
+     * non-resident documents is fetched with a single batch of BgFetches,
+     * and the progress is kept in the engine specific of the cookie while
+     * the request is blocked.
+     */
+    ENGINE_ERROR_CODE setWithMetaMulti(const void* cookie,
+                                       const cb::mcbp::Request& request,
+                                       const AddResponseFn& response);
+
     ENGINE_ERROR_CODE deleteWithMeta(const void* cookie,
                                      const cb::mcbp::Request& request,
                                      const AddResponseFn& response);
@@ -710,7 +736,13 @@ public:
         workloadPriority = p;
     }
 
+    /**
+     * Get a random key. When the request has extras it asks for a sample
+     * of (up to) the given number of keys instead (optionally from a single
+     * collection), which is built in the background.
+     */
     ENGINE_ERROR_CODE getRandomKey(const void* cookie,
+                                   const cb::mcbp::Request& request,
                                    const AddResponseFn& response);
 
     void setCompressionMode(const std::string& compressModeStr);
@@ -836,6 +868,15 @@ protected:
      */
     bool hasMemoryForItemAllocation(uint32_t totalItemSize);
 
+    /**
+     * Schedule the sampling of (up to) the number of keys in the extras of
+     * a GET_RANDOM_KEY request, or return the result of the sampling once
+     * it has completed.
+     */
+    ENGINE_ERROR_CODE sampleRandomKeys(const void* cookie,
+                                       cb::const_byte_buffer extras,
+                                       const AddResponseFn& response);
+
     friend class KVBucket;
     friend class EPBucket;
 
@@ -873,6 +914,9 @@ protected:
     ENGINE_ERROR_CODE doDcpStats(const void* cookie,
                                  const AddStatFn& add_stat,
                                  cb::const_char_buffer value);
+    void doDcpStatsInner(const void* cookie,
+                         const AddStatFn& add_stat,
+                         cb::const_char_buffer value);
     ENGINE_ERROR_CODE doEvictionStats(const void* cookie,
                                       const AddStatFn& add_stat);
     ENGINE_ERROR_CODE doConnAggStats(const void* cookie,
@@ -885,6 +929,13 @@ protected:
                                        const AddStatFn& add_stat);
     ENGINE_ERROR_CODE doRunTimeStats(const void* cookie,
                                      const AddStatFn& add_stat);
+    /**
+     * Report the tasks which have run for longest over the last N seconds
+     * (default 10), given as an optional argument to "tasks-top".
+     */
+    ENGINE_ERROR_CODE doTopTasksStats(const void* cookie,
+                                      const AddStatFn& add_stat,
+                                      cb::const_char_buffer keyArgs);
     ENGINE_ERROR_CODE doDispatcherStats(const void* cookie,
                                         const AddStatFn& add_stat);
     ENGINE_ERROR_CODE doTasksStats(const void* cookie,
@@ -986,6 +1037,13 @@ protected:
                                PermittedVBStates& permittedVBStates,
                                DeleteSource& deleteSource);
 
+    /// Overload of the above for the options taken from the extras
+    bool decodeWithMetaOptions(uint32_t options,
+                               GenerateCas& generateCas,
+                               CheckConflicts& checkConflicts,
+                               PermittedVBStates& permittedVBStates,
+                               DeleteSource& deleteSource);
+
     /**
      * Private wrapper method for decodeWithMetaOptions called from setWithMeta
      * to abstract out deleteSource, which is unused by setWithMeta.
@@ -1165,4 +1223,9 @@ protected:
     EpEngineTaskable taskable;
     std::atomic<BucketCompressionMode> compressionMode;
     std::atomic<float> minCompressionRatio;
+
+    // Results of the heavy stat groups, cached for up to
+    // stats_cache_max_age_ms.
+    CachedStats aggregatedVBucketStatsCache;
+    CachedStats dcpStatsCache;
 };
@@ -22,6 +22,7 @@
 #include "checkpoint_manager.h"
 #include "durability/active_durability_monitor.h"
 #include "durability/passive_durability_monitor.h"
+#include "ep_bucket.h"
 #include "ep_engine.h"
 #include "ep_time.h"
 #include "executorpool.h"
@@ -35,6 +36,24 @@
 #include "vbucket_state.h"
 #include "vbucketdeletiontask.h"
 #include <folly/lang/Assume.h>
+#include <gsl/gsl>
+
+namespace {
+std::unique_ptr<AbstractStoredValueFactory> makeStoredValueFactory(
+        EPStats& st,
+        Configuration& config,
+        std::shared_ptr<SlabAllocator> storedValueSlabs) {
+    const auto inlineValueSize = config.getStoredValueInlineValueSize();
+    if (inlineValueSize == 0) {
+        return std::make_unique<StoredValueFactory>(
+                st, std::move(storedValueSlabs));
+    }
+    return std::make_unique<InlineValueStoredValueFactory>(
+            st,
+            gsl::narrow<uint8_t>(inlineValueSize),
+            std::move(storedValueSlabs));
+}
+} // namespace
 
 EPVBucket::EPVBucket(Vbid i,
                      vbucket_state_t newState,
@@ -48,6 +67,7 @@ EPVBucket::EPVBucket(Vbid i,
                      std::shared_ptr<Callback<Vbid>> flusherCb,
                      NewSeqnoCallback newSeqnoCb,
                      SyncWriteResolvedCallback syncWriteResolvedCb,
+                     SyncWriteTimeoutCallback syncWriteTimeoutCb,
                      SyncWriteCompleteCallback syncWriteCb,
                      SeqnoAckCallback seqnoAckCb,
                      Configuration& config,
@@ -58,7 +78,8 @@ EPVBucket::EPVBucket(Vbid i,
                      uint64_t maxCas,
                      int64_t hlcEpochSeqno,
                      bool mightContainXattrs,
-                     const nlohmann::json& replicationTopology)
+                     const nlohmann::json& replicationTopology,
+                     std::shared_ptr<SlabAllocator> storedValueSlabs)
     : VBucket(i,
               newState,
               st,
@@ -68,9 +89,11 @@ EPVBucket::EPVBucket(Vbid i,
               lastSnapEnd,
               std::move(table),
               flusherCb,
-              std::make_unique<StoredValueFactory>(st),
+              makeStoredValueFactory(
+                      st, config, std::move(storedValueSlabs)),
               std::move(newSeqnoCb),
               syncWriteResolvedCb,
+              syncWriteTimeoutCb,
               syncWriteCb,
               seqnoAckCb,
               config,
@@ -83,6 +106,14 @@ EPVBucket::EPVBucket(Vbid i,
               mightContainXattrs,
               replicationTopology),
       shard(kvshard) {
+    if (evictionPolicy == EvictionPolicy::Full &&
+        config.isKeyDirectoryEnabled()) {
+        ht.enableKeyDirectory();
+    }
+    if (evictionPolicy == EvictionPolicy::Full &&
+        config.getNegativeLookupCacheSize() > 0) {
+        ht.enableNegativeLookupCache(config.getNegativeLookupCacheSize());
+    }
 }
 
 EPVBucket::~EPVBucket() {
@@ -168,7 +199,16 @@ ENGINE_ERROR_CODE EPVBucket::completeBGFetchForSingleItem(
                                 "restoreValue()");
                     }
                 } else if (status == ENGINE_KEY_ENOENT) {
-                    v->setNonExistent();
+                    if (v->isTempInitialItem() &&
+                        ht.isNegativeLookupCacheEnabled()) {
+                        // Remember the miss in the NegativeLookupCache
+                        // instead of keeping a temp item in the HashTable
+                        // until the pager removes it.
+                        ht.recordNonExistent(docKey);
+                        ht.unlocked_del(res.lock, v);
+                    } else {
+                        v->setNonExistent();
+                    }
                     if (eviction == EvictionPolicy::Full) {
                         // For the full eviction, we should notify
                         // ENGINE_SUCCESS to the memcached worker thread,
@@ -260,8 +300,10 @@ void EPVBucket::notifyAllPendingConnsFailed(EventuallyPersistentEngine& e) {
         for (auto& bgf : pendingBGFetches) {
             vb_bgfetch_item_ctx_t& bg_itm_ctx = bgf.second;
             for (auto& bgitem : bg_itm_ctx.bgfetched_list) {
-                toNotify[bgitem->cookie] = ENGINE_NOT_MY_VBUCKET;
-                e.storeEngineSpecific(bgitem->cookie, nullptr);
+                if (bgitem->cookie) {
+                    toNotify[bgitem->cookie] = ENGINE_NOT_MY_VBUCKET;
+                    e.storeEngineSpecific(bgitem->cookie, nullptr);
+                }
                 ++num_of_deleted_pending_fetches;
             }
         }
@@ -640,13 +682,13 @@ void EPVBucket::bgFetch(const DocKey& key,
                         const bool isMeta) {
     // schedule to the current batch of background fetch of the given
     // vbucket
+    auto* bgFetcher =
+            static_cast<EPBucket&>(*engine.getKVBucket()).getBgFetcher(getId());
     size_t bgfetch_size = queueBGFetchItem(
             key,
             std::make_unique<VBucketBGFetchItem>(cookie, isMeta),
-            getShard()->getBgFetcher());
-    if (getShard()) {
-        getShard()->getBgFetcher()->notifyBGEvent();
-    }
+            bgFetcher);
+    bgFetcher->notifyBGEvent();
     EP_LOG_DEBUG("Queued a background fetch, now at {}",
                  uint64_t(bgfetch_size));
 }
@@ -735,7 +777,16 @@ MutationStatus EPVBucket::insertFromWarmup(Item& itm,
         return MutationStatus::NoMem;
     }
 
-    return ht.insertFromWarmup(itm, eject, keyMetaDataOnly, eviction);
+    const auto status =
+            ht.insertFromWarmup(itm, eject, keyMetaDataOnly, eviction);
+    auto* index = getExpiryIndex();
+    if (index && itm.isCommitted() && !itm.isDeleted() &&
+        itm.getExptime() != 0) {
+        // An entry for a document which wasn't inserted is ignored by the
+        // expiry pager
+        index->add(itm.getKey(), itm.getExptime());
+    }
+    return status;
 }
 
 void EPVBucket::loadOutstandingPrepares(
@@ -21,13 +21,14 @@
 #include "vbucket_bgfetch_item.h"
 
 struct vbucket_state;
+class SlabAllocator;
 class BgFetcher;
 
 /**
  * Eventually Peristent VBucket (EPVBucket) is a child class of VBucket.
  * It implements the logic of VBucket that is related only to persistence.
  */
-class EPVBucket : public VBucket {
+class EPVBucket final : public VBucket {
 public:
     EPVBucket(Vbid i,
               vbucket_state_t newState,
@@ -41,6 +42,7 @@ public:
               std::shared_ptr<Callback<Vbid>> flusherCb,
               NewSeqnoCallback newSeqnoCb,
               SyncWriteResolvedCallback syncWriteResolvedCb,
+              SyncWriteTimeoutCallback syncWriteTimeoutCb,
               SyncWriteCompleteCallback syncWriteCb,
               SeqnoAckCallback seqnoAckCb,
               Configuration& config,
@@ -51,7 +53,8 @@ public:
               uint64_t maxCas = 0,
               int64_t hlcEpochSeqno = HlcCasSeqnoUninitialised,
               bool mightContainXattrs = false,
-              const nlohmann::json& replicationTopology = {});
+              const nlohmann::json& replicationTopology = {},
+              std::shared_ptr<SlabAllocator> storedValueSlabs = {});
 
     ~EPVBucket();
 
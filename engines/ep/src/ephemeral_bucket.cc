@@ -102,10 +102,14 @@ EphemeralBucket::EphemeralBucket(EventuallyPersistentEngine& theEngine)
              that we are going to use like NRU, FIFO etc. */
     eviction_policy = EvictionPolicy::Value;
 
-    // Create tombstone purger task; it will later be scheduled as necessary
-    // in initialize().
-    tombstonePurgerTask =
-            std::make_shared<EphTombstoneHTCleaner>(&engine, *this);
+    // Create tombstone purger tasks; they will later be scheduled as
+    // necessary in initialize().
+    const auto numPurgers =
+            engine.getConfiguration().getEphemeralMetadataPurgeTasks();
+    for (size_t partition = 0; partition < numPurgers; ++partition) {
+        tombstonePurgerTasks.push_back(std::make_shared<EphTombstoneHTCleaner>(
+                &engine, *this, partition, numPurgers));
+    }
 
     replicationThrottle = std::make_unique<ReplicationThrottleEphe>(
             engine.getConfiguration(), stats);
@@ -160,10 +164,12 @@ void EphemeralBucket::attemptToFreeMemory() {
         wakeUpExpiryPager();
     }
 
-    // Additionally, wake up the tombstone purger to scan for and remove any
+    // Additionally, wake up the tombstone purgers to scan for and remove any
     // tombstones in the HashTable / sequence list.
-    if (tombstonePurgerTask->getState() == TASK_SNOOZED) {
-        ExecutorPool::get()->wake(tombstonePurgerTask->getId());
+    for (auto& task : tombstonePurgerTasks) {
+        if (task->getState() == TASK_SNOOZED) {
+            ExecutorPool::get()->wake(task->getId());
+        }
     }
 }
 
@@ -209,6 +215,7 @@ VBucketPtr EphemeralBucket::makeVBucket(
                                            std::move(table),
                                            std::move(newSeqnoCb),
                                            makeSyncWriteResolvedCB(),
+                                           makeSyncWriteTimeoutCB(),
                                            makeSyncWriteCompleteCB(),
                                            makeSeqnoAckCB(),
                                            engine.getConfiguration(),
@@ -218,7 +225,8 @@ VBucketPtr EphemeralBucket::makeVBucket(
                                            purgeSeqno,
                                            maxCas,
                                            mightContainXattrs,
-                                           replicationTopology),
+                                           replicationTopology,
+                                           storedValueSlabs),
                       VBucket::DeferredDeleter(engine));
 }
 
@@ -240,12 +248,16 @@ RollbackResult EphemeralBucket::doRollback(Vbid vbid, uint64_t rollbackSeqno) {
 }
 
 void EphemeralBucket::enableTombstonePurgerTask() {
-    ExecutorPool::get()->cancel(tombstonePurgerTask->getId());
-    ExecutorPool::get()->schedule(tombstonePurgerTask);
+    for (auto& task : tombstonePurgerTasks) {
+        ExecutorPool::get()->cancel(task->getId());
+        ExecutorPool::get()->schedule(task);
+    }
 }
 
 void EphemeralBucket::disableTombstonePurgerTask() {
-    ExecutorPool::get()->cancel(tombstonePurgerTask->getId());
+    for (auto& task : tombstonePurgerTasks) {
+        ExecutorPool::get()->cancel(task->getId());
+    }
 }
 
 void EphemeralBucket::reconfigureForEphemeral(Configuration& config) {
@@ -148,8 +148,9 @@ protected:
 
     // Protected member variables /////////////////////////////////////////////
 
-    /// Task responsible for purging in-memory tombstones.
-    ExTask tombstonePurgerTask;
+    /// Tasks responsible for purging in-memory tombstones, one per partition
+    /// of vBuckets (see ephemeral_metadata_purge_tasks).
+    std::vector<ExTask> tombstonePurgerTasks;
 
 private:
     /**
@@ -29,7 +29,7 @@
 #include <climits>
 
 EphemeralVBucket::HTTombstonePurger::HTTombstonePurger(rel_time_t purgeAge)
-    : now(ep_current_time()), purgeAge(purgeAge), numPurgedItems(0) {
+    : now(ep_current_time()), purgeAge(purgeAge) {
 }
 
 void EphemeralVBucket::HTTombstonePurger::setDeadline(
@@ -43,35 +43,94 @@ void EphemeralVBucket::HTTombstonePurger::setCurrentVBucket(VBucket& vb) {
 
 bool EphemeralVBucket::HTTombstonePurger::visit(
         const HashTable::HashBucketLock& hbl, StoredValue& v) {
-    auto* osv = v.toOrderedStoredValue();
+    purgeIfOld(hbl, *v.toOrderedStoredValue());
+    ++numVisitedItems;
+
+    // See if we have done enough work for this chunk. If so
+    // stop visiting (for now).
+    return progressTracker.shouldContinueVisiting(numVisitedItems);
+}
+
+bool EphemeralVBucket::HTTombstonePurger::visitTombstoneIndex() {
+    // Only consider the entries present when we start; any we put back (as
+    // they are not yet old enough) are considered by the next pass.
+    size_t remaining;
+    {
+        std::lock_guard<std::mutex> lh(vbucket->tombstoneIndexLock);
+        remaining = vbucket->tombstoneIndex.size();
+    }
+
+    for (; remaining > 0; --remaining) {
+        boost::optional<IndexedTombstone> entry;
+        {
+            std::lock_guard<std::mutex> lh(vbucket->tombstoneIndexLock);
+            if (vbucket->tombstoneIndex.empty()) {
+                break;
+            }
+            auto& front = vbucket->tombstoneIndex.front();
+            // Entries are in the order they were indexed; once one is too
+            // young to purge so are all which follow it.
+            if (now < front.indexedTime ||
+                now - front.indexedTime < purgeAge) {
+                break;
+            }
+            entry = std::move(front);
+            vbucket->tombstoneIndex.pop_front();
+        }
 
+        auto result = entry->prepared
+                              ? vbucket->ht.findOnlyPrepared(entry->key)
+                              : vbucket->ht.findOnlyCommitted(entry->key);
+        auto* sv = result.storedValue;
+        // Discard the entry if the item has since been modified or removed;
+        // any newer tombstone for the key has its own entry.
+        if (sv && sv->getBySeqno() == entry->bySeqno &&
+            (sv->isDeleted() || sv->isCompleted())) {
+            if (!purgeIfOld(result.lock, *sv->toOrderedStoredValue())) {
+                // The item's deleted time is later than when it was indexed
+                // (e.g. a delete time supplied by the active); look again in
+                // a later pass.
+                std::lock_guard<std::mutex> lh(vbucket->tombstoneIndexLock);
+                entry->indexedTime = now;
+                vbucket->tombstoneIndex.push_back(std::move(*entry));
+            }
+        }
+        ++numVisitedItems;
+
+        if (!progressTracker.shouldContinueVisiting(numVisitedItems)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EphemeralVBucket::HTTombstonePurger::purgeIfOld(
+        const HashTable::HashBucketLock& hbl, OrderedStoredValue& osv) {
     // MB-31175: Item must have been deleted before this task starts to ensure
     // that we do not get a -ve value when we check if the time difference
     // is >= purgeAge. This is preferable to updating the task start time for
     // every visit and has little impact as this task runs frequently.
-    if ((osv->isDeleted() || osv->isCompleted()) &&
-        (now >= osv->getCompletedOrDeletedTime()) &&
-        (now - osv->getCompletedOrDeletedTime() >= purgeAge)) {
-        // This item should be purged. Remove from the HashTable and move over
-        // to being owned by the sequence list. Remove by pointer (not by key)
-        // so that we do not remove any committed/prepared StoredValues for
-        // which there may be two with the same key.
-        auto ownedSV = vbucket->ht.unlocked_release(hbl, osv);
-        {
-            std::lock_guard<std::mutex> listWriteLg(
-                    vbucket->seqList->getListWriteLock());
-            // Mark the item stale, with no replacement item
-            vbucket->seqList->markItemStale(
-                    listWriteLg, std::move(ownedSV), nullptr);
-        }
-        ++vbucket->htDeletedPurgeCount;
-        ++numPurgedItems;
+    if (!(osv.isDeleted() || osv.isCompleted()) ||
+        (now < osv.getCompletedOrDeletedTime()) ||
+        (now - osv.getCompletedOrDeletedTime() < purgeAge)) {
+        return false;
     }
-    ++numVisitedItems;
 
-    // See if we have done enough work for this chunk. If so
-    // stop visiting (for now).
-    return progressTracker.shouldContinueVisiting(numVisitedItems);
+    // This item should be purged. Remove from the HashTable and move over
+    // to being owned by the sequence list. Remove by pointer (not by key)
+    // so that we do not remove any committed/prepared StoredValues for
+    // which there may be two with the same key.
+    auto ownedSV = vbucket->ht.unlocked_release(hbl, &osv);
+    {
+        std::lock_guard<std::mutex> listWriteLg(
+                vbucket->seqList->getListWriteLock());
+        // Mark the item stale, with no replacement item
+        vbucket->seqList->markItemStale(
+                listWriteLg, std::move(ownedSV), nullptr);
+    }
+    ++vbucket->htDeletedPurgeCount;
+    ++numPurgedItems;
+    return true;
 }
 
 void EphemeralVBucket::HTTombstonePurger::clearStats() {
@@ -79,16 +138,46 @@ void EphemeralVBucket::HTTombstonePurger::clearStats() {
     numPurgedItems = 0;
 }
 
+/**
+ * Adapter which visits the tombstone index of each VBucket in a partition
+ * of the bucket with a HTTombstonePurger.
+ */
+class TombstoneIndexVisitor : public PauseResumeVBVisitor {
+public:
+    TombstoneIndexVisitor(EphemeralVBucket::HTTombstonePurger& purger,
+                          size_t partition,
+                          size_t numPartitions)
+        : purger(purger), partition(partition), numPartitions(numPartitions) {
+    }
+
+    bool visit(VBucket& vb) override {
+        if (vb.getId().get() % numPartitions != partition) {
+            return true;
+        }
+        purger.setCurrentVBucket(vb);
+        return purger.visitTombstoneIndex();
+    }
+
+private:
+    EphemeralVBucket::HTTombstonePurger& purger;
+    const size_t partition;
+    const size_t numPartitions;
+};
+
 EphTombstoneHTCleaner::EphTombstoneHTCleaner(EventuallyPersistentEngine* e,
-                                             EphemeralBucket& bucket)
+                                             EphemeralBucket& bucket,
+                                             size_t partition,
+                                             size_t numPartitions)
     : GlobalTask(e,
                  TaskId::EphTombstoneHTCleaner,
                  e->getConfiguration().getEphemeralMetadataPurgeInterval(),
                  false),
       bucket(bucket),
+      partition(partition),
+      numPartitions(numPartitions),
       bucketPosition(bucket.endPosition()),
-      staleItemDeleterTask(
-              std::make_shared<EphTombstoneStaleItemDeleter>(e, bucket)) {
+      staleItemDeleterTask(std::make_shared<EphTombstoneStaleItemDeleter>(
+              e, bucket, partition, numPartitions)) {
     staleItemDeleterTaskId =
             ExecutorPool::get()->schedule(staleItemDeleterTask);
 }
@@ -98,9 +187,8 @@ bool EphTombstoneHTCleaner::run() {
     // then resume from where we last were, otherwise create a new visitor
     // starting from the beginning.
     if (bucketPosition == bucket.endPosition()) {
-        prAdapter = std::make_unique<PauseResumeVBAdapter>(
-                std::make_unique<EphemeralVBucket::HTTombstonePurger>(
-                        getDeletedPurgeAge()));
+        purger = std::make_unique<EphemeralVBucket::HTTombstonePurger>(
+                getDeletedPurgeAge());
         bucketPosition = bucket.startPosition();
 
         EP_LOG_DEBUG("{} starting with purge age:{}s",
@@ -109,13 +197,15 @@ bool EphTombstoneHTCleaner::run() {
     }
 
     // Prepare the underlying visitor.
-    auto& visitor = getPurgerVisitor();
+    auto& visitor = *purger;
     visitor.setDeadline(std::chrono::steady_clock::now() + getChunkDuration());
     visitor.clearStats();
 
-    // (re)start visiting.
+    // (re)start visiting. A paused VBucket is resumed from the front of its
+    // tombstone index, which only holds the entries not yet visited.
+    TombstoneIndexVisitor indexVisitor(visitor, partition, numPartitions);
     auto start = std::chrono::steady_clock::now();
-    bucketPosition = bucket.pauseResumeVisit(*prAdapter, bucketPosition);
+    bucketPosition = bucket.pauseResumeVisit(indexVisitor, bucketPosition);
     auto end = std::chrono::steady_clock::now();
 
     // Check if the visitor completed a full pass.
@@ -148,7 +238,11 @@ bool EphTombstoneHTCleaner::run() {
 }
 
 std::string EphTombstoneHTCleaner::getDescription() {
-    return "Eph tombstone hashtable cleaner";
+    if (numPartitions == 1) {
+        return "Eph tombstone hashtable cleaner";
+    }
+    return "Eph tombstone hashtable cleaner (partition " +
+           std::to_string(partition) + ")";
 }
 
 std::chrono::microseconds EphTombstoneHTCleaner::maxExpectedDuration() {
@@ -174,12 +268,6 @@ size_t EphTombstoneHTCleaner::getDeletedPurgeAge() const {
     return engine->getConfiguration().getEphemeralMetadataPurgeAge();
 }
 
-EphemeralVBucket::HTTombstonePurger&
-EphTombstoneHTCleaner::getPurgerVisitor() {
-    return dynamic_cast<EphemeralVBucket::HTTombstonePurger&>(
-            prAdapter->getHTVisitor());
-}
-
 /**
  * Ephemeral VBucket Sequence stale item deleter
  *
@@ -188,10 +276,16 @@ EphTombstoneHTCleaner::getPurgerVisitor() {
  */
 class EphemeralVBucket::StaleItemDeleter : public PauseResumeVBVisitor {
 public:
-    StaleItemDeleter(EphemeralBucket& bucket) : bucket(bucket) {
+    StaleItemDeleter(EphemeralBucket& bucket,
+                     size_t partition = 0,
+                     size_t numPartitions = 1)
+        : bucket(bucket), partition(partition), numPartitions(numPartitions) {
     }
 
     bool visit(VBucket& vb) override {
+        if (vb.getId().get() % numPartitions != partition) {
+            return true;
+        }
         auto* vbucket = dynamic_cast<EphemeralVBucket*>(&vb);
         if (!vbucket) {
             throw std::invalid_argument(
@@ -231,6 +325,10 @@ protected:
     /// The bucket we are associated with.
     EphemeralBucket& bucket;
 
+    /// Partition of VBuckets visited, and how many partitions exist.
+    const size_t partition;
+    const size_t numPartitions;
+
     /// Count of how many items have been deleted for all visited vBuckets.
     size_t numItemsDeleted = 0;
 
@@ -246,9 +344,14 @@ protected:
 };
 
 EphTombstoneStaleItemDeleter::EphTombstoneStaleItemDeleter(
-        EventuallyPersistentEngine* e, EphemeralBucket& bucket)
+        EventuallyPersistentEngine* e,
+        EphemeralBucket& bucket,
+        size_t partition,
+        size_t numPartitions)
     : GlobalTask(e, TaskId::EphTombstoneStaleItemDeleter, INT_MAX, false),
       bucket(bucket),
+      partition(partition),
+      numPartitions(numPartitions),
       bucketPosition(bucket.endPosition()) {
 }
 
@@ -258,7 +361,8 @@ bool EphTombstoneStaleItemDeleter::run() {
     // starting from the beginning.
     if (bucketPosition == bucket.endPosition()) {
         staleItemDeleteVbVisitor =
-                std::make_unique<EphemeralVBucket::StaleItemDeleter>(bucket);
+                std::make_unique<EphemeralVBucket::StaleItemDeleter>(
+                        bucket, partition, numPartitions);
         bucketPosition = bucket.startPosition();
 
         EP_LOG_DEBUG("{} starting", getDescription());
@@ -299,7 +403,11 @@ bool EphTombstoneStaleItemDeleter::run() {
 }
 
 std::string EphTombstoneStaleItemDeleter::getDescription() {
-    return "Eph tombstone stale item deleter";
+    if (numPartitions == 1) {
+        return "Eph tombstone stale item deleter";
+    }
+    return "Eph tombstone stale item deleter (partition " +
+           std::to_string(partition) + ")";
 }
 
 std::chrono::microseconds EphTombstoneStaleItemDeleter::maxExpectedDuration() {
@@ -44,11 +44,15 @@
  * Therefore, purging is handled with a two-phase approach, with each phase
  * done by a different Task:
  *
- * 1. EphTombstoneHTCleaner - visit the HashTable for deleted items exceeding
- *    ephemeral_metadata_purge_age. For such items, unlink from the HashTable
- *    (but don't delete the object), and mark the item as stale.
+ * 1. EphTombstoneHTCleaner - visit each VBucket's tombstone index (the
+ *    tombstones and completed prepares in the order they were created) for
+ *    items exceeding ephemeral_metadata_purge_age. For such items, unlink from
+ *    the HashTable (but don't delete the object), and mark the item as stale.
  *    Such item can no longer be located via the HashTable, but are still in
  *    the SequenceList, hence in-progress range reads are safe to continue.
+ *    As the index is in creation order a pass stops at the first entry which
+ *    is too young, so the cost of a pass is proportional to the number of
+ *    tombstones purged and not to the size of the HashTable.
  *
  * 2. EphTombstoneStaleItemDeleter - iterate the SequenceList in order
  *    looking for stale OSVs. For such items unlink from the SequenceList and
@@ -92,6 +96,16 @@ public:
 
     bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
 
+    /**
+     * Visit the current VBucket's tombstone index, purging every indexed
+     * tombstone which is older than purgeAge. Stops at the first entry which
+     * was indexed too recently to be purged.
+     *
+     * @return True if the index was fully visited, false if visiting paused
+     *         as the deadline was reached.
+     */
+    bool visitTombstoneIndex();
+
     /// Return the number of items visited in the HashTable.
     size_t getVisitedCount() const {
         return numVisitedItems;
@@ -105,6 +119,16 @@ public:
     void clearStats();
 
 protected:
+    /**
+     * Purge the given item from the HashTable (marking it stale in the
+     * SequenceList) if it is a tombstone or completed prepare older than
+     * purgeAge.
+     *
+     * @return True if the item was purged.
+     */
+    bool purgeIfOld(const HashTable::HashBucketLock& hbl,
+                    OrderedStoredValue& osv);
+
     /// VBucket being visited.
     EphemeralVBucket* vbucket;
 
@@ -120,10 +144,10 @@ protected:
     ProgressTracker progressTracker;
 
     /// Count of how many items have been visited.
-    size_t numVisitedItems;
+    size_t numVisitedItems = 0;
 
     /// Count of how many items have been purged.
-    size_t numPurgedItems;
+    size_t numPurgedItems = 0;
 };
 
 /**
@@ -132,8 +156,16 @@ protected:
  */
 class EphTombstoneHTCleaner : public GlobalTask {
 public:
+    /**
+     * @param partition The partition of VBuckets (vbid % numPartitions) this
+     *        task purges.
+     * @param numPartitions The number of HTCleaner tasks the VBuckets are
+     *        split across.
+     */
     EphTombstoneHTCleaner(EventuallyPersistentEngine* e,
-                          EphemeralBucket& bucket);
+                          EphemeralBucket& bucket,
+                          size_t partition = 0,
+                          size_t numPartitions = 1);
 
     bool run() override;
 
@@ -151,21 +183,21 @@ private:
     /// Age (in seconds) which deleted items will be purged after.
     size_t getDeletedPurgeAge() const;
 
-    /// Returns the underlying VBTombstonePurger instance.
-    EphemeralVBucket::HTTombstonePurger& getPurgerVisitor();
-
     /// The bucket we are associated with.
     EphemeralBucket& bucket;
 
+    /// Partition of VBuckets this task visits, and how many partitions exist.
+    const size_t partition;
+    const size_t numPartitions;
+
     /// Opaque marker indicating how far through the KVBucket we have visited.
     KVBucketIface::Position bucketPosition;
 
     /**
-     * Visitor adapter which supports pausing & resuming (records how far
-     * though a VBucket is has got). unique_ptr as we re-create it for each
-     * complete pass.
+     * The tombstone purger. unique_ptr as we re-create it for each complete
+     * pass (so its notion of "now" advances).
      */
-    std::unique_ptr<PauseResumeVBAdapter> prAdapter;
+    std::unique_ptr<EphemeralVBucket::HTTombstonePurger> purger;
 
     /// Second paired task which deletes stale items from the sequenceList.
     std::shared_ptr<EphTombstoneStaleItemDeleter> staleItemDeleterTask;
@@ -183,7 +215,9 @@ private:
 class EphTombstoneStaleItemDeleter : public GlobalTask {
 public:
     EphTombstoneStaleItemDeleter(EventuallyPersistentEngine* e,
-                                 EphemeralBucket& bucket);
+                                 EphemeralBucket& bucket,
+                                 size_t partition = 0,
+                                 size_t numPartitions = 1);
 
     bool run() override;
 
@@ -198,6 +232,10 @@ private:
     /// The bucket we are associated with.
     EphemeralBucket& bucket;
 
+    /// Partition of VBuckets this task visits, and how many partitions exist.
+    const size_t partition;
+    const size_t numPartitions;
+
     /// Opaque marker indicating how far through the KVBucket we have visited.
     KVBucketIface::Position bucketPosition;
 
@@ -45,6 +45,7 @@ EphemeralVBucket::EphemeralVBucket(
         std::unique_ptr<FailoverTable> table,
         NewSeqnoCallback newSeqnoCb,
         SyncWriteResolvedCallback syncWriteResolvedCb,
+        SyncWriteTimeoutCallback syncWriteTimeoutCb,
         SyncWriteCompleteCallback syncWriteCb,
         SeqnoAckCallback seqnoAckCb,
         Configuration& config,
@@ -54,7 +55,8 @@ EphemeralVBucket::EphemeralVBucket(
         uint64_t purgeSeqno,
         uint64_t maxCas,
         bool mightContainXattrs,
-        const nlohmann::json& replicationTopology)
+        const nlohmann::json& replicationTopology,
+        std::shared_ptr<SlabAllocator> storedValueSlabs)
     : VBucket(i,
               newState,
               st,
@@ -64,9 +66,11 @@ EphemeralVBucket::EphemeralVBucket(
               lastSnapEnd,
               std::move(table),
               /*flusherCb*/ nullptr,
-              std::make_unique<OrderedStoredValueFactory>(st),
+              std::make_unique<OrderedStoredValueFactory>(
+                      st, std::move(storedValueSlabs)),
               std::move(newSeqnoCb),
               syncWriteResolvedCb,
+              syncWriteTimeoutCb,
               syncWriteCb,
               seqnoAckCb,
               config,
@@ -435,6 +439,8 @@ EphemeralVBucket::updateStoredValue(const HashTable::HashBucketLock& hbl,
         }
     }
 
+    indexTombstone(*newSv->toOrderedStoredValue());
+
     if (recreatingDeletedItem) {
         ++opsCreate;
         notifyCtx.itemCountDifference = 1;
@@ -491,6 +497,7 @@ std::pair<StoredValue*, VBNotifyCtx> EphemeralVBucket::addNewStoredValue(
         /* Update the high seqno in the sequential storage */
         seqList->updateHighSeqno(listWriteLg, *osv);
     }
+    indexTombstone(*osv);
     ++opsCreate;
     notifyCtx.itemCountDifference = 1;
 
@@ -594,6 +601,8 @@ EphemeralVBucket::softDeleteStoredValue(const HashTable::HashBucketLock& hbl,
         }
     }
 
+    indexTombstone(*newSv->toOrderedStoredValue());
+
     ++opsDelete;
 
     seqList->updateNumDeletedItems(oldValueDeleted, true);
@@ -665,6 +674,7 @@ VBNotifyCtx EphemeralVBucket::commitStoredValue(
     osv.setPrepareSeqno(prepareSeqno);
 
     values.pending.setCommitted(CommittedState::PrepareCommitted);
+    indexTombstone(*values.pending.getSV()->toOrderedStoredValue());
     return notifyCtx;
 }
 
@@ -742,6 +752,8 @@ VBNotifyCtx EphemeralVBucket::abortStoredValue(
         }
     }
 
+    indexTombstone(*newSv->toOrderedStoredValue());
+
     return notifyCtx;
 }
 
@@ -774,6 +786,8 @@ VBNotifyCtx EphemeralVBucket::addNewAbort(const HashTable::HashBucketLock& hbl,
         updateSeqListPostAbort(listWriteLg, nullptr, osv, prepareSeqno);
     }
 
+    indexTombstone(osv);
+
     return notifyCtx;
 }
 
@@ -939,4 +953,16 @@ bool EphemeralVBucket::isValidDurabilityLevel(cb::durability::Level level) {
 void EphemeralVBucket::processImplicitlyCompletedPrepare(
         HashTable::StoredValueProxy& v) {
     v.setCommitted(CommittedState::PrepareCommitted);
+    indexTombstone(*v.getSV()->toOrderedStoredValue());
+}
+
+void EphemeralVBucket::indexTombstone(const OrderedStoredValue& osv) {
+    if (!(osv.isDeleted() || osv.isCompleted()) || osv.isTempItem()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lh(tombstoneIndexLock);
+    tombstoneIndex.push_back({StoredDocKey(osv.getKey()),
+                              osv.getBySeqno(),
+                              osv.isPending() || osv.isCompleted(),
+                              ep_current_time()});
 }
@@ -23,6 +23,10 @@
 
 #include <boost/optional/optional.hpp>
 
+#include <deque>
+
+class SlabAllocator;
+
 class EphemeralVBucket : public VBucket {
 public:
     class CountVisitor;
@@ -40,6 +44,7 @@ public:
                      std::unique_ptr<FailoverTable> table,
                      NewSeqnoCallback newSeqnoCb,
                      SyncWriteResolvedCallback syncWriteResolvedCb,
+                     SyncWriteTimeoutCallback syncWriteTimeoutCb,
                      SyncWriteCompleteCallback syncWriteCb,
                      SeqnoAckCallback seqnoAckCb,
                      Configuration& config,
@@ -49,7 +54,8 @@ public:
                      uint64_t purgeSeqno = 0,
                      uint64_t maxCas = 0,
                      bool mightContainXattrs = false,
-                     const nlohmann::json& replicationTopology = {});
+                     const nlohmann::json& replicationTopology = {},
+                     std::shared_ptr<SlabAllocator> storedValueSlabs = {});
 
     ENGINE_ERROR_CODE completeBGFetchForSingleItem(
             const DiskDocKey& key,
@@ -358,6 +364,25 @@ private:
             std::lock_guard<std::mutex>& writeLock,
             OrderedStoredValue& osv);
 
+    /**
+     * Record in the tombstoneIndex that the given StoredValue has just become
+     * a tombstone (deleted, or a completed prepare), if it has.
+     */
+    void indexTombstone(const OrderedStoredValue& osv);
+
+    /**
+     * A StoredValue which became a tombstone, identified by key, namespace
+     * (prepared or committed) and seqno so the purger can find it again and
+     * check it has not since been modified.
+     */
+    struct IndexedTombstone {
+        StoredDocKey key;
+        int64_t bySeqno;
+        bool prepared;
+        /// When the entry was (re-)added to the index
+        rel_time_t indexedTime;
+    };
+
     /**
      * Lock to synchronize order of bucket elements.
      * The sequence number is not generated in EphemeralVBucket for now. It is
@@ -387,6 +412,18 @@ private:
      *  (removed from seqList and deleted).
      */
     EPStats::Counter seqListPurgeCount;
+
+    /**
+     * The tombstones in this VBucket, in the order they were created (and so
+     * approximately oldest first). Lets the HTTombstonePurger visit only the
+     * tombstones old enough to purge, rather than the whole HashTable.
+     * Entries whose StoredValue has since been modified or removed are
+     * discarded when the purger reaches them.
+     */
+    std::deque<IndexedTombstone> tombstoneIndex;
+
+    /// Lock protecting tombstoneIndex
+    std::mutex tombstoneIndexLock;
 };
 
 using EphemeralVBucketPtr = std::shared_ptr<EphemeralVBucket>;
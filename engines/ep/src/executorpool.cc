@@ -138,6 +138,8 @@ ExecutorPool *ExecutorPool::get(void) {
                                    config.getNumWriterThreads(),
                                    config.getNumAuxioThreads(),
                                    config.getNumNonioThreads());
+            tmp->setNumReadersReservedForBgFetch(
+                    config.getNumReaderThreadsReservedForBgFetch());
             instance.store(tmp);
         }
     }
@@ -286,6 +288,33 @@ void ExecutorPool::doneWork(task_type_t taskType) {
     }
 }
 
+size_t ExecutorPool::getMaxBackgroundReaders() {
+    const size_t numReaders = getNumReaders();
+    const size_t reserved = numReadersReservedForBgFetch;
+    return numReaders > reserved ? numReaders - reserved : 1;
+}
+
+bool ExecutorPool::tryStartBackgroundRead() {
+    const size_t max = getMaxBackgroundReaders();
+    size_t current = curBackgroundReaders.load();
+    do {
+        if (current >= max) {
+            return false;
+        }
+    } while (!curBackgroundReaders.compare_exchange_weak(current,
+                                                          current + 1));
+    return true;
+}
+
+void ExecutorPool::doneBackgroundRead() {
+    curBackgroundReaders--;
+    // A Background task may be waiting for this slot in a pendingQueue;
+    // wake a sleeping reader to run it rather than leaving it until the
+    // sleeper next times out.
+    size_t numToWake = 1;
+    getSleepQ(READER_TASK_IDX)->doWake(numToWake);
+}
+
 bool ExecutorPool::_cancel(size_t taskId, bool eraseTask) {
     LockHolder lh(tMutex);
     std::map<size_t, TaskQpair>::iterator itr = taskLocator.find(taskId);
@@ -192,6 +192,32 @@ public:
         adjustWorkers(NONIO_TASK_IDX, v);
     }
 
+    /**
+     * Set how many reader threads are reserved for ReaderClass::BgFetch
+     * tasks. ReaderClass::Background tasks run on at most the remaining
+     * reader threads (but on at least one).
+     */
+    void setNumReadersReservedForBgFetch(size_t v) {
+        numReadersReservedForBgFetch = v;
+    }
+
+    size_t getNumReadersReservedForBgFetch() const {
+        return numReadersReservedForBgFetch;
+    }
+
+    /// @return the maximum number of threads running Background reads.
+    size_t getMaxBackgroundReaders();
+
+    /**
+     * Take a reader thread slot for running a ReaderClass::Background task,
+     * if fewer than getMaxBackgroundReaders() are running.
+     * @return true if a slot was taken; it must be given back with
+     *         doneBackgroundRead() once the task has run.
+     */
+    bool tryStartBackgroundRead();
+
+    void doneBackgroundRead();
+
     size_t getNumReadyTasks(void) { return totReadyTasks; }
 
     size_t getNumSleepers(void) { return numSleepers; }
@@ -258,6 +284,11 @@ protected:
     std::vector<std::atomic<uint16_t>> numWorkers; // and limit it to the value set here
     std::vector<std::atomic<size_t>> numReadyTasks; // number of ready tasks per task set
 
+    // Reader threads which Background reads may not use, and the number of
+    // threads currently running Background reads.
+    std::atomic<size_t> numReadersReservedForBgFetch{0};
+    std::atomic<size_t> curBackgroundReaders{0};
+
     // Set of all known task owners
     std::set<void *> taskOwners;
 
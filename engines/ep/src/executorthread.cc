@@ -25,7 +25,9 @@
 #include "globaltask.h"
 #include "taskqueue.h"
 
+#include <memcached/sampling_profiler.h>
 #include <platform/timeutils.h>
+#include <utilities/thread_cpu_time.h>
 #include <sstream>
 
 extern "C" {
@@ -75,6 +77,8 @@ void ExecutorThread::stop(bool wait) {
 
 void ExecutorThread::run() {
     EP_LOG_DEBUG("Thread {} running..", getName());
+    cb::profiler::ScopedThreadRegistration profilerRegistration(
+            getName().c_str());
 
     for (uint8_t tick = 1;; tick++) {
         resetCurrentTask();
@@ -95,7 +99,7 @@ void ExecutorThread::run() {
             }
 
             if (currentTask->isdead()) {
-                manager->doneWork(taskType);
+                doneWork();
                 manager->cancel(currentTask->uid, true);
                 continue;
             }
@@ -150,13 +154,23 @@ void ExecutorThread::run() {
 
             // Now Run the Task ....
             currentTask->setState(TASK_RUNNING, TASK_SNOOZED);
-            bool again = currentTask->run();
+            bool again;
+            const auto cpuStart = cb::getThreadCpuTime();
+            {
+                cb::profiler::ScopedTag profilerTag(
+                        currentTask->getTaskable().getName().c_str(),
+                        GlobalTask::getTaskName(currentTask->getTaskId()));
+                again = currentTask->run();
+            }
 
             // Task done, log it ...
             const std::chrono::steady_clock::duration runtime(
                     std::chrono::steady_clock::now() - getTaskStart());
             currentTask->getTaskable().logRunTime(currentTask->getTaskId(),
                                                   runtime);
+            currentTask->getTaskable().logCpuTime(
+                    currentTask->getTaskId(),
+                    cb::getThreadCpuTime() - cpuStart);
             currentTask->updateRuntime(runtime);
 
             // Check if exceeded expected duration; and if so log.
@@ -190,7 +204,7 @@ void ExecutorThread::run() {
                         currentTask->getId(),
                         to_ns_since_epoch(currentTask->getWaketime()).count());
             }
-            manager->doneWork(taskType);
+            doneWork();
         }
     }
     // Thread is about to terminate - disassociate it from any engine.
@@ -199,6 +213,14 @@ void ExecutorThread::run() {
     state = EXECUTOR_DEAD;
 }
 
+void ExecutorThread::doneWork() {
+    if (runningBackgroundRead) {
+        runningBackgroundRead = false;
+        manager->doneBackgroundRead();
+    }
+    manager->doneWork(taskType);
+}
+
 void ExecutorThread::setCurrentTask(ExTask newTask) {
     LockHolder lh(currentTaskMutex);
     currentTask = newTask;
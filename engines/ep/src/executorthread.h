@@ -143,6 +143,8 @@ public:
     }
 
 protected:
+    /// Tell the pool that currentTask has finished running.
+    void doneWork();
 
     cb_thread_t thread;
     ExecutorPool *manager;
@@ -156,4 +158,8 @@ protected:
 
     std::mutex currentTaskMutex; // Protects currentTask
     ExTask currentTask;
+
+    // Is currentTask running in one of the ExecutorPool's Background read
+    // slots (which must be given back when it finishes)?
+    bool runningBackgroundRead = false;
 };
@@ -0,0 +1,48 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "expiry_index.h"
+
+void ExpiryIndex::add(const DocKey& key, time_t exptime) {
+    const auto slot = exptime - (exptime % SlotWidth);
+    std::lock_guard<std::mutex> guard(mutex);
+    slots[slot].emplace_back(key);
+    ++numKeys;
+}
+
+std::vector<StoredDocKey> ExpiryIndex::takeDue(time_t now) {
+    std::vector<StoredDocKey> ret;
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = slots.begin();
+    while (it != slots.end() && it->first <= now) {
+        if (ret.empty()) {
+            ret = std::move(it->second);
+        } else {
+            ret.insert(ret.end(),
+                       std::make_move_iterator(it->second.begin()),
+                       std::make_move_iterator(it->second.end()));
+        }
+        it = slots.erase(it);
+    }
+    numKeys -= ret.size();
+    return ret;
+}
+
+size_t ExpiryIndex::size() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return numKeys;
+}
@@ -0,0 +1,62 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "storeddockey.h"
+
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * Index of the keys of a vBucket's documents with an expiry time, so the
+ * expiry pager only has to visit the documents which are due instead of
+ * the entire HashTable.
+ *
+ * The keys are bucketed into slots of SlotWidth seconds by their expiry
+ * time. The index is only ever added to: when the expiry time of a
+ * document changes (or the document is deleted) the old entry is left in
+ * the index, and it's up to the caller of takeDue() to look up the
+ * document and check its current expiry time (re-adding the key if it
+ * isn't due yet).
+ */
+class ExpiryIndex {
+public:
+    /// The range of expiry times (in seconds) covered by each slot
+    static const time_t SlotWidth = 60;
+
+    /// Add the key of a document expiring at the given (absolute) time
+    void add(const DocKey& key, time_t exptime);
+
+    /**
+     * Remove the keys of all of the slots starting at or before the given
+     * time. As a slot may cover the future, some of the keys returned
+     * may not have expired yet.
+     */
+    std::vector<StoredDocKey> takeDue(time_t now);
+
+    /// @return the number of keys in the index
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex;
+    /// The keys in each slot, keyed by the start of the slot
+    std::map<time_t, std::vector<StoredDocKey>> slots;
+    size_t numKeys = 0;
+};
@@ -196,7 +196,7 @@ public:
 
     std::chrono::steady_clock::time_point completeCurrentTask() {
         auto min_waketime = std::chrono::steady_clock::time_point::min();
-        manager->doneWork(taskType);
+        doneWork();
         if (rescheduled && !currentTask->isdead()) {
             min_waketime = queue.reschedule(currentTask);
         } else {
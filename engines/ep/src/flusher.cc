@@ -21,6 +21,7 @@
 #include "common.h"
 #include "ep_bucket.h"
 #include "executorpool.h"
+#include "kvshard.h"
 #include "tasks.h"
 
 #include <platform/timeutils.h>
@@ -31,7 +32,7 @@
 #include <sstream>
 #include <thread>
 
-Flusher::Flusher(EPBucket* st, KVShard* k)
+Flusher::Flusher(EPBucket* st, size_t flusherId)
     : store(st),
       _state(State::Initializing),
       taskId(0),
@@ -39,7 +40,7 @@ Flusher::Flusher(EPBucket* st, KVShard* k)
       doHighPriority(false),
       numHighPriority(0),
       pendingMutation(false),
-      shard(k) {
+      flusherId(flusherId) {
 }
 
 Flusher::~Flusher() {
@@ -161,7 +162,7 @@ void Flusher::initialize() {
 void Flusher::schedule_UNLOCKED() {
     ExecutorPool* iom = ExecutorPool::get();
     ExTask task = std::make_shared<FlusherTask>(
-            ObjectRegistry::getCurrentEngine(), this, shard->getId());
+            ObjectRegistry::getCurrentEngine(), this, flusherId);
     this->setTaskId(task->getId());
     iom->schedule(task);
 }
@@ -185,6 +186,15 @@ void Flusher::wake(void) {
     }
 }
 
+void Flusher::scheduleDeferredFlush(
+        std::chrono::steady_clock::time_point deadline) {
+    const auto ticks = int64_t(deadline.time_since_epoch().count());
+    auto current = deferredFlushDeadline.load();
+    while ((current == 0 || ticks < current) &&
+           !deferredFlushDeadline.compare_exchange_weak(current, ticks)) {
+    }
+}
+
 bool Flusher::step(GlobalTask *task) {
     State currentState = _state.load();
 
@@ -216,11 +226,24 @@ bool Flusher::step(GlobalTask *task) {
 
         flushVB();
 
+        {
+            // Optionally keep on flushing further vBuckets (for up to the
+            // configured time) rather than paying for a round-trip through
+            // the executor pool after every one.
+            const auto limit = store->getFlusherStepTimeLimit();
+            if (limit.count() != 0) {
+                const auto start = std::chrono::steady_clock::now();
+                while (_state == State::Running && !canSnooze() &&
+                       (std::chrono::steady_clock::now() - start) < limit) {
+                    flushVB();
+                }
+            }
+        }
+
         if (_state == State::Running) {
-            /// If there's still work to do for this shard, wake up the Flusher
-            /// to run again.
-            const bool shouldWakeUp =
-                    !canSnooze() || (shard->highPriorityCount.load() > 0);
+            /// If there's still work to do for this flusher's shards, wake up
+            /// the Flusher to run again.
+            const bool shouldWakeUp = !canSnooze() || hasHighPriorityVBuckets();
 
             // Testing hook
             if (stepPreSnoozeHook) {
@@ -229,6 +252,21 @@ bool Flusher::step(GlobalTask *task) {
 
             if (shouldWakeUp) {
                 task->updateWaketime(std::chrono::steady_clock::now());
+            } else if (deferredFlushDeadline.load() != 0) {
+                // Come back to persist the deferred vbucket_state changes
+                // (flushVB() revisits all of the vBuckets when the deadline
+                // has passed).
+                const auto deadline = std::chrono::steady_clock::time_point(
+                        std::chrono::steady_clock::duration(
+                                deferredFlushDeadline.load()));
+                const auto now = std::chrono::steady_clock::now();
+                if (deadline <= now) {
+                    deferredFlushDeadline = 0;
+                    pendingMutation = true;
+                    task->updateWaketime(now);
+                } else {
+                    task->updateWaketime(deadline);
+                }
             }
         }
         return true;
@@ -252,11 +290,65 @@ bool Flusher::step(GlobalTask *task) {
 }
 
 void Flusher::completeFlush() {
+    // Visit all of the vBuckets so any deferred vbucket_state is persisted
+    if (deferredFlushDeadline.exchange(0) != 0) {
+        pendingMutation = true;
+    }
     while(!canSnooze()) {
         flushVB();
     }
 }
 
+std::vector<KVShard*> Flusher::getShards() const {
+    // The shards are assigned round-robin (see EPBucket::getFlusherIndex())
+    std::vector<KVShard*> shards;
+    const auto& vbMap = store->getVBuckets();
+    const auto numFlushers = store->getNumFlushers();
+    if (flusherId >= numFlushers) {
+        // Not currently assigned any shards
+        return shards;
+    }
+    for (auto id = flusherId; id < vbMap.getNumShards(); id += numFlushers) {
+        shards.push_back(vbMap.getShard(KVShard::id_type(id)));
+    }
+    return shards;
+}
+
+std::vector<Vbid> Flusher::getVBucketsSortedByState() const {
+    const auto shards = getShards();
+    if (shards.empty()) {
+        return {};
+    }
+    if (shards.size() == 1) {
+        return shards.front()->getVBucketsSortedByState();
+    }
+
+    // Flush the active vBuckets of all of the shards first, then the replicas
+    // and so on
+    std::vector<Vbid> rv;
+    for (int state = vbucket_state_active; state <= vbucket_state_dead;
+         ++state) {
+        for (auto* shard : shards) {
+            for (auto vbid : shard->getVBuckets()) {
+                auto vb = shard->getBucket(vbid);
+                if (vb && vb->getState() == state) {
+                    rv.push_back(vbid);
+                }
+            }
+        }
+    }
+    return rv;
+}
+
+bool Flusher::hasHighPriorityVBuckets() const {
+    for (auto* shard : getShards()) {
+        if (shard->highPriorityCount.load() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void Flusher::flushVB(void) {
     TRACE_EVENT0("ep-engine", "Flusher::flushVB");
 
@@ -268,17 +360,22 @@ void Flusher::flushVB(void) {
         }
         bool inverse = true;
         if (pendingMutation.compare_exchange_strong(inverse, false)) {
-            for (auto vbid : shard->getVBucketsSortedByState()) {
+            for (auto vbid : getVBucketsSortedByState()) {
                 lpVbs.push(vbid);
             }
         }
     }
 
-    if (!doHighPriority && shard->highPriorityCount.load() > 0) {
-        for (auto vbid : shard->getVBuckets()) {
-            VBucketPtr vb = store->getVBucket(vbid);
-            if (vb && vb->getHighPriorityChkSize() > 0) {
-                hpVbs.push(vbid);
+    if (!doHighPriority && hasHighPriorityVBuckets()) {
+        for (auto* shard : getShards()) {
+            if (shard->highPriorityCount.load() == 0) {
+                continue;
+            }
+            for (auto vbid : shard->getVBuckets()) {
+                VBucketPtr vb = store->getVBucket(vbid);
+                if (vb && vb->getHighPriorityChkSize() > 0) {
+                    hpVbs.push(vbid);
+                }
             }
         }
         numHighPriority = hpVbs.size();
@@ -21,8 +21,11 @@
 
 #include <memcached/vbucket.h>
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <queue>
+#include <vector>
 
 #define NO_VBUCKETS_INSTANTIATED 0xFFFF
 #define RETRY_FLUSH_VBUCKET (-1)
@@ -32,10 +35,13 @@ class KVShard;
 
 /**
  * Manage persistence of data for an EPBucket.
+ *
+ * A Flusher persists the vBuckets of the shards assigned to it by the
+ * bucket (see EPBucket::getFlusherIndex()).
  */
 class Flusher {
 public:
-    Flusher(EPBucket* st, KVShard* k);
+    Flusher(EPBucket* st, size_t flusherId);
 
     ~Flusher();
 
@@ -51,7 +57,7 @@ public:
 
     void notifyFlushEvent(void) {
         // By setting pendingMutation to true we are guaranteeing that the given
-        // flusher will iterate the entire vbuckets under its shard from the
+        // flusher will iterate the entire vbuckets under its shards from the
         // begining and flush for all mutations
         bool disable = false;
         if (pendingMutation.compare_exchange_strong(disable, true)) {
@@ -60,6 +66,23 @@ public:
     }
     void setTaskId(size_t newId) { taskId = newId; }
 
+    size_t getId() const {
+        return flusherId;
+    }
+
+    /**
+     * Request that the flusher runs (and visits all of its vBuckets) no
+     * later than the given time, so it may persist a deferred vbucket_state
+     * change.
+     */
+    void scheduleDeferredFlush(std::chrono::steady_clock::time_point deadline);
+
+    /// @return true if the flusher is writing all outstanding data before
+    ///         stopping (and nothing may be deferred)
+    bool isStopping() const {
+        return _state == State::Stopping;
+    }
+
     // Testing hook - if non-empty, called from step() just before snoozing
     // the task.
     std::function<void()> stepPreSnoozeHook;
@@ -83,6 +106,16 @@ private:
 
     const char* stateName(State st) const;
 
+    /// @return the shards currently assigned to this flusher
+    std::vector<KVShard*> getShards() const;
+
+    /// @return the vBuckets of this flusher's shards, sorted by state
+    std::vector<Vbid> getVBucketsSortedByState() const;
+
+    /// @return true if any vBucket of this flusher's shards has a high
+    ///         priority (persistence) request outstanding
+    bool hasHighPriorityVBuckets() const;
+
     bool canSnooze(void) {
         return lpVbs.empty() && hpVbs.empty() && !pendingMutation.load();
     }
@@ -102,7 +135,11 @@ private:
     size_t numHighPriority;
     std::atomic<bool> pendingMutation;
 
-    KVShard *shard;
+    /// The earliest deadline requested by scheduleDeferredFlush (as
+    /// steady_clock ticks, 0 if none)
+    std::atomic<int64_t> deferredFlushDeadline{0};
+
+    const size_t flusherId;
 
     DISALLOW_COPY_AND_ASSIGN(Flusher);
 };
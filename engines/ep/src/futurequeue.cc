@@ -0,0 +1,295 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "futurequeue.h"
+
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+constexpr std::chrono::milliseconds FutureQueue::tickDuration;
+constexpr int FutureQueue::slotBits;
+constexpr size_t FutureQueue::slotsPerLevel;
+constexpr uint8_t FutureQueue::numLevels;
+constexpr uint8_t FutureQueue::overflowLevel;
+
+static const int64_t tickNs =
+        std::chrono::nanoseconds(FutureQueue::tickDuration).count();
+
+void FutureQueue::push(ExTask task) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    const auto tick = toTick(task->getWaketime());
+    if (index.empty()) {
+        // Nothing queued - rebase the wheel on this task.
+        currentTick = tick;
+    }
+
+    EntryList pending;
+    pending.push_back({task, std::max(tick, currentTick), 0, 0});
+    auto it = pending.begin();
+    place_UNLOCKED(pending, it);
+    index.emplace(task->getId(), it);
+    updateEarliest_UNLOCKED();
+}
+
+void FutureQueue::pop() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (index.empty()) {
+        throw std::logic_error("FutureQueue::pop: queue is empty");
+    }
+
+    auto range = index.equal_range(earliest->task->getId());
+    for (auto itr = range.first; itr != range.second; ++itr) {
+        if (itr->second == earliest) {
+            index.erase(itr);
+            break;
+        }
+    }
+
+    auto& list = getList(*earliest);
+    const auto level = earliest->level;
+    const auto slot = earliest->slot;
+    list.erase(earliest);
+    if (level != overflowLevel && list.empty()) {
+        occupied[level] &= ~(uint64_t(1) << slot);
+    }
+    updateEarliest_UNLOCKED();
+}
+
+ExTask FutureQueue::top() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (index.empty()) {
+        throw std::logic_error("FutureQueue::top: queue is empty");
+    }
+    return earliest->task;
+}
+
+bool FutureQueue::updateWaketime(const ExTask& task,
+                                 std::chrono::steady_clock::time_point newTime) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    task->updateWaketime(newTime);
+    return reposition_UNLOCKED(task);
+}
+
+bool FutureQueue::snooze(const ExTask& task, const double secs) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    task->snooze(secs);
+    return reposition_UNLOCKED(task);
+}
+
+std::chrono::steady_clock::time_point FutureQueue::roundUpToTick(
+        std::chrono::steady_clock::time_point time) {
+    const auto ns = to_ns_since_epoch(time).count();
+    if (ns > std::numeric_limits<int64_t>::max() - tickNs ||
+        ns < std::numeric_limits<int64_t>::min() + tickNs) {
+        return time;
+    }
+    const auto tick = toTick(time);
+    if (tick * tickNs == ns) {
+        return time;
+    }
+    return std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::nanoseconds((tick + 1) * tickNs)));
+}
+
+int64_t FutureQueue::toTick(std::chrono::steady_clock::time_point time) {
+    const auto ns = to_ns_since_epoch(time).count();
+    // Round towards negative infinity so that ticks are ordered like times.
+    auto tick = ns / tickNs;
+    if (ns % tickNs < 0) {
+        --tick;
+    }
+    return tick;
+}
+
+uint8_t FutureQueue::getLevel(int64_t tick) const {
+    const auto diff = uint64_t(tick) ^ uint64_t(currentTick);
+    if (diff == 0) {
+        return 0;
+    }
+    const auto level = (folly::findLastSet(diff) - 1) / slotBits;
+    return level < numLevels ? uint8_t(level) : overflowLevel;
+}
+
+uint8_t FutureQueue::getSlot(int64_t tick, uint8_t level) {
+    return uint8_t((uint64_t(tick) >> (level * slotBits)) &
+                   (slotsPerLevel - 1));
+}
+
+FutureQueue::EntryList& FutureQueue::getList(const Entry& entry) {
+    if (entry.level == overflowLevel) {
+        return overflow;
+    }
+    return wheel[entry.level][entry.slot];
+}
+
+void FutureQueue::place_UNLOCKED(EntryList& from, EntryList::iterator it) {
+    it->level = getLevel(it->tick);
+    if (it->level == overflowLevel) {
+        it->slot = 0;
+        overflow.splice(overflow.end(), from, it);
+        return;
+    }
+    it->slot = getSlot(it->tick, it->level);
+    wheel[it->level][it->slot].splice(
+            wheel[it->level][it->slot].end(), from, it);
+    occupied[it->level] |= uint64_t(1) << it->slot;
+}
+
+bool FutureQueue::reposition_UNLOCKED(const ExTask& task) {
+    auto range = index.equal_range(task->getId());
+    if (range.first == range.second) {
+        return false;
+    }
+
+    const auto tick = std::max(toTick(task->getWaketime()), currentTick);
+    for (auto itr = range.first; itr != range.second; ++itr) {
+        auto it = itr->second;
+        auto& from = getList(*it);
+        const auto level = it->level;
+        const auto slot = it->slot;
+        it->tick = tick;
+        place_UNLOCKED(from, it);
+        if (level != overflowLevel && from.empty()) {
+            occupied[level] &= ~(uint64_t(1) << slot);
+        }
+    }
+    updateEarliest_UNLOCKED();
+    return true;
+}
+
+void FutureQueue::updateEarliest_UNLOCKED() {
+    auto waketime = std::chrono::steady_clock::time_point::max();
+    while (!index.empty()) {
+        uint8_t level = 0;
+        while (level < numLevels && occupied[level] == 0) {
+            ++level;
+        }
+
+        if (level == numLevels) {
+            // Everything left is in the overflow list; rebase the wheel on
+            // the earliest of them and re-place them all.
+            EntryList pending;
+            pending.swap(overflow);
+            currentTick = std::min_element(pending.begin(),
+                                           pending.end(),
+                                           [](const Entry& a, const Entry& b) {
+                                               return a.tick < b.tick;
+                                           })
+                                  ->tick;
+            while (!pending.empty()) {
+                place_UNLOCKED(pending, pending.begin());
+            }
+            continue;
+        }
+
+        // Advance the current tick to the earliest occupied slot. Every
+        // entry at a lower level is empty, and every other entry at this
+        // level is in a later slot, so all entries remain correctly placed.
+        const auto slot = folly::findFirstSet(occupied[level]) - 1;
+        const auto levelMask =
+                (uint64_t(1) << (slotBits * (level + 1))) - 1;
+        currentTick = int64_t((uint64_t(currentTick) & ~levelMask) |
+                              (uint64_t(slot) << (slotBits * level)));
+
+        auto& list = wheel[level][slot];
+        if (level == 0) {
+            earliest = std::min_element(
+                    list.begin(), list.end(), [](const Entry& a, const Entry& b) {
+                        return a.task->getWaketime() < b.task->getWaketime();
+                    });
+            waketime = earliest->task->getWaketime();
+            break;
+        }
+
+        // Cascade the slot onto the lower levels.
+        EntryList pending;
+        pending.splice(pending.end(), list);
+        occupied[level] &= ~(uint64_t(1) << slot);
+        while (!pending.empty()) {
+            place_UNLOCKED(pending, pending.begin());
+        }
+    }
+
+    earliestWaketime.store(waketime.time_since_epoch().count(),
+                           std::memory_order_release);
+}
+
+void FutureQueue::assertInvariants() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    std::string errors;
+    size_t entries = 0;
+    auto check = [this, &errors, &entries](const Entry& entry,
+                                           uint8_t level,
+                                           uint8_t slot) {
+        ++entries;
+        const auto wakeTick = toTick(entry.task->getWaketime());
+        const bool misplaced =
+                entry.level != level || entry.slot != slot ||
+                entry.tick < currentTick || getLevel(entry.tick) != level ||
+                (level != overflowLevel && getSlot(entry.tick, level) != slot);
+        // An entry's tick is that of its wakeTime unless it was clamped up
+        // to the current tick.
+        const bool stale =
+                wakeTick > entry.tick ||
+                (wakeTick < entry.tick && entry.tick != currentTick);
+        if (misplaced || stale) {
+            errors += "\t task:" + entry.task->getDescription() +
+                      " wake:" +
+                      std::to_string(
+                              to_ns_since_epoch(entry.task->getWaketime())
+                                      .count()) +
+                      " tick:" + std::to_string(entry.tick) +
+                      " level:" + std::to_string(level) +
+                      " slot:" + std::to_string(slot) + "\n";
+        }
+    };
+
+    for (uint8_t level = 0; level < numLevels; ++level) {
+        for (uint8_t slot = 0; slot < slotsPerLevel; ++slot) {
+            const auto& list = wheel[level][slot];
+            const bool marked = (occupied[level] >> slot) & 1;
+            if (marked == list.empty()) {
+                errors += "\t level:" + std::to_string(level) +
+                          " slot:" + std::to_string(slot) +
+                          " occupied bit incorrect\n";
+            }
+            for (const auto& entry : list) {
+                check(entry, level, slot);
+            }
+        }
+    }
+    for (const auto& entry : overflow) {
+        check(entry, overflowLevel, 0);
+    }
+    if (entries != index.size()) {
+        errors += "\t index has " + std::to_string(index.size()) +
+                  " entries but the wheel has " + std::to_string(entries) +
+                  "\n";
+    }
+
+    if (!errors.empty()) {
+        throw std::logic_error(
+                "FutureQueue::assertInvariants() - wheel invariant broken. "
+                "currentTick:" +
+                std::to_string(currentTick) + "\n" + errors);
+    }
+}
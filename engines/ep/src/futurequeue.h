@@ -22,148 +22,156 @@
  *
  * FutureQueue provides methods that allow a task's wakeTime to be mutated
  * whilst maintaining the priority ordering.
+ *
+ * Tasks are held in a hierarchical timer wheel: wakeTimes are bucketed into
+ * ticks of tickDuration, and each of numLevels levels has slotsPerLevel
+ * slots, each level covering slotsPerLevel times the range of the level
+ * below. A task is placed at the level of the highest slotBits-wide group in
+ * which its tick differs from the wheel's current tick, so push(),
+ * snooze() and updateWaketime() are O(1); slots are only redistributed onto
+ * lower levels (cascaded) when the wheel's current tick advances into them.
+ * Tasks further out than the wheel covers are kept in an overflow list,
+ * which is only rebased onto the wheel once the wheel itself is empty.
+ *
+ * Within the earliest slot tasks are still ordered exactly by wakeTime.
  */
 
 #pragma once
 
-#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <list>
 #include <mutex>
-#include <queue>
+#include <unordered_map>
 
 #include "globaltask.h"
 
-template <class C = std::deque<ExTask>,
-          class Compare = CompareByDueDate>
 class FutureQueue {
 public:
+    /// Granularity in which wakeTimes are bucketed by the wheel.
+    static constexpr std::chrono::milliseconds tickDuration{1};
 
-    void push(ExTask task) {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        queue.push(task);
-    }
+    void push(ExTask task);
 
-    void pop() {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        queue.pop();
-    }
+    void pop();
 
-    ExTask top() {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        return queue.top();
-    }
+    ExTask top();
 
     size_t size() {
         std::lock_guard<std::mutex> lock(queueMutex);
-        return queue.size();
+        return index.size();
     }
 
     bool empty() {
         std::lock_guard<std::mutex> lock(queueMutex);
-        return queue.empty();
+        return index.empty();
+    }
+
+    /**
+     * @returns the wakeTime of the top() task, or time_point::max() if the
+     * queue is empty. Does not acquire the queueMutex, so callers can cheaply
+     * check whether any task may be due without contending on the queue;
+     * the value reflects the queue as of the last completed mutation.
+     */
+    std::chrono::steady_clock::time_point getEarliestWaketime() const {
+        return std::chrono::steady_clock::time_point(
+                std::chrono::steady_clock::duration(
+                        earliestWaketime.load(std::memory_order_acquire)));
     }
 
     /*
-     * Update the wakeTime of task and ensure the heap property is
-     * maintained.
+     * Update the wakeTime of task and move it to its new position.
      * @returns true if 'task' is in the FutureQueue.
      */
     bool updateWaketime(const ExTask& task,
-                        std::chrono::steady_clock::time_point newTime) {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        task->updateWaketime(newTime);
-        // After modifiying the task's wakeTime, rebuild the heap
-        return queue.heapify(task);
-    }
+                        std::chrono::steady_clock::time_point newTime);
 
     /*
-     * snooze the task (by altering its wakeTime) and ensure the
-     * heap property is maintained.
+     * snooze the task (by altering its wakeTime) and move it to its new
+     * position.
      * @returns true if 'task' is in the FutureQueue.
      */
-    bool snooze(const ExTask& task, const double secs) {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        task->snooze(secs);
-        // After modifiying the task's wakeTime, rebuild the heap
-        return queue.heapify(task);
-    }
+    bool snooze(const ExTask& task, const double secs);
 
     /**
      * Checks that the invariants of the future queue are valid.
      * If not then throws std::logic_error.
      */
-    void assertInvariants() {
-        return queue.verifyHeapProperty();
-    }
+    void assertInvariants();
+
+    /**
+     * Round the given time up to the end of its tick, so that a thread
+     * sleeping until then will find every task due in the same tick ready
+     * at once rather than waking separately for each of them.
+     */
+    static std::chrono::steady_clock::time_point roundUpToTick(
+            std::chrono::steady_clock::time_point time);
 
 protected:
+    static constexpr int slotBits = 6;
+    static constexpr size_t slotsPerLevel = size_t(1) << slotBits;
+    static constexpr uint8_t numLevels = 4;
+    /// Value of Entry::level for tasks in the overflow list.
+    static constexpr uint8_t overflowLevel = numLevels;
 
-    /*
-     * HeapifiableQueue exposes a method to maintain the heap ordering
-     * of the underlying queue.
-     *
-     * This class is deliberately hidden inside FutureQueue so that any
-     * extensions made to priority_queue can't be accessed without work.
-     * I.e. correct locking and any need to 'heapify'.
+    struct Entry {
+        ExTask task;
+        // Tick the task was placed by; its wakeTime's tick, or the wheel's
+        // current tick if that was later.
+        int64_t tick;
+        uint8_t level;
+        uint8_t slot;
+    };
+    using EntryList = std::list<Entry>;
+
+    static int64_t toTick(std::chrono::steady_clock::time_point time);
+
+    /// @returns the level (or overflowLevel) `tick` should be placed at.
+    uint8_t getLevel(int64_t tick) const;
+
+    static uint8_t getSlot(int64_t tick, uint8_t level);
+
+    EntryList& getList(const Entry& entry);
+
+    /**
+     * Move the entry `it` from the list `from` to its position in the wheel
+     * according to it->tick.
+     */
+    void place_UNLOCKED(EntryList& from, EntryList::iterator it);
+
+    /// Re-place every entry of `task` after its wakeTime has changed.
+    bool reposition_UNLOCKED(const ExTask& task);
+
+    /**
+     * Locate the task with the earliest wakeTime, advancing the wheel's
+     * current tick to it (cascading slots as required), and record it in
+     * `earliest` and earliestWaketime.
      */
-    class HeapifiableQueue : public std::priority_queue<ExTask, C, Compare> {
-    public:
-        /*
-         * Ensure the heap property is maintained
-         * @returns true if 'task' is in the queue and heapify() did something.
-         */
-        bool heapify(const ExTask& task) {
-            // if the task exists, rebuild
-            if (exists(task)) {
-                if (this->c.back()->getId() == task->getId()) {
-                    std::push_heap(this->c.begin(),
-                                   this->c.end(),
-                                   this->comp);
-                } else {
-                    std::make_heap(this->c.begin(),
-                                   this->c.end(),
-                                   this->comp);
-                }
-                return true;
-            } else {
-                return false;
-            }
-        }
-
-        void verifyHeapProperty() {
-            auto heap_end = std::is_heap_until(
-                    this->c.begin(), this->c.end(), this->comp);
-            if (heap_end != this->c.end()) {
-                std::string msg;
-                msg += "FutureQueue::verifyHeapProperty() - heap invariant "
-                       "broken. First non-heap is task:" +
-                       (*heap_end)->getDescription() + " wake:" +
-                       std::to_string(
-                               to_ns_since_epoch((*heap_end)->getWaketime())
-                                       .count()) +
-                       "\nAll items:\n";
-
-                for (auto& task : this->c) {
-                    msg += "\t task:" + task->getDescription() + " wake:" +
-                           std::to_string(to_ns_since_epoch(task->getWaketime())
-                                                  .count()) +
-                           "\n";
-                }
-                throw std::logic_error(msg);
-            }
-        }
-
-    protected:
-        bool exists(const ExTask& task) {
-            return std::find_if(this->c.begin(),
-                                this->c.end(),
-                                [&task](const ExTask& qTask) {
-                                    return task->getId() == qTask->getId();
-                                }) != this->c.end();
-        }
-
-    } queue;
-
-    // All access to queue must be done with the queueMutex
+    void updateEarliest_UNLOCKED();
+
+    std::array<std::array<EntryList, slotsPerLevel>, numLevels> wheel;
+    // Bitmap per level of which slots are non-empty.
+    std::array<uint64_t, numLevels> occupied{};
+    EntryList overflow;
+
+    // Location of every entry, by task id. A task may be pushed more than
+    // once, hence a multimap.
+    std::unordered_multimap<size_t, EntryList::iterator> index;
+
+    // Tick of the wheel's earliest slot; every entry's tick is >= this.
+    int64_t currentTick = 0;
+
+    // Entry of the top() task; only valid when the queue is not empty.
+    EntryList::iterator earliest;
+
+    // All access to the wheel must be done with the queueMutex
     std::mutex queueMutex;
+
+    // Copy of top()'s wakeTime (as a count of steady_clock ticks), written
+    // with queueMutex held after every mutation of the queue.
+    std::atomic<std::chrono::steady_clock::rep> earliestWaketime{
+            std::chrono::steady_clock::time_point::max()
+                    .time_since_epoch()
+                    .count()};
 };
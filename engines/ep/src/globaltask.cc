@@ -139,6 +139,16 @@ task_type_t GlobalTask::getTaskType(TaskId id) {
                            std::to_string(static_cast<int>(id)));
 }
 
+ReaderClass GlobalTask::getReaderClass(TaskId id) {
+    switch (id) {
+    case TaskId::MultiBGFetcherTask:
+    case TaskId::VKeyStatBGFetchTask:
+        return ReaderClass::BgFetch;
+    default:
+        return ReaderClass::Background;
+    }
+}
+
 std::array<TaskId, static_cast<int>(TaskId::TASK_COUNT)> GlobalTask::allTaskIds = {{
 #define TASK(name, type, prio) TaskId::name,
 #include "tasks.def.h"
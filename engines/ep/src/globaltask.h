@@ -52,7 +52,6 @@ class Taskable;
 class EventuallyPersistentEngine;
 
 class GlobalTask {
-    friend class CompareByDueDate;
     friend class CompareByPriority;
     friend class ExecutorPool;
     friend class ExecutorThread;
@@ -236,6 +235,11 @@ public:
      */
     static task_type_t getTaskType(TaskId id);
 
+    /*
+     * Lookup the ReaderClass of a READER_TASK_IDX task.
+     */
+    static ReaderClass getReaderClass(TaskId id);
+
     /*
      * A vector of all TaskId generated from tasks.def.h
      */
@@ -259,7 +263,7 @@ protected:
      * We are using a int64_t as opposed to ProcessTime::time_point because we
      * want the access to be atomic without the use of a mutex. The reason for
      * this is that we update these timepoints in locations which have been
-     * shown to be pretty hot (e.g. CompareByDueDate) and we want to avoid
+     * shown to be pretty hot (e.g. the FutureQueue) and we want to avoid
      * the overhead of acquiring mutexes.
      */
     using atomic_time_point = std::atomic<int64_t>;
@@ -297,14 +301,3 @@ public:
                (t1->getQueuePriority() > t2->getQueuePriority());
     }
 };
-
-/**
- * Order tasks by their ready date.
- * @return true if t2 should have priority over t1
- */
-class CompareByDueDate {
-public:
-    bool operator()(ExTask &t1, ExTask &t2) {
-        return t2->waketime < t1->waketime;
-    }
-};
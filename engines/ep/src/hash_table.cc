@@ -23,12 +23,20 @@
 #include "stored_value_factories.h"
 
 #include <folly/lang/Assume.h>
+#include <folly/lang/Bits.h>
 #include <phosphor/phosphor.h>
 #include <platform/compress.h>
 
 #include <logtags.h>
 #include <nlohmann/json.hpp>
 #include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 static const ssize_t prime_size_table[] = {
     3, 7, 13, 23, 47, 97, 193, 383, 769, 1531, 3079, 6143, 12289, 24571, 49157,
@@ -60,6 +68,15 @@ static const ssize_t prime_size_table[] = {
  */
 static const double freqCounterIncFactor = 0.012;
 
+/// Hint to the CPU that the cache line containing addr will soon be read.
+static inline void prefetchForRead(const void* addr) {
+#if defined(_MSC_VER)
+    _mm_prefetch(static_cast<const char*>(addr), _MM_HINT_T0);
+#else
+    __builtin_prefetch(addr, 0 /* read */);
+#endif
+}
+
 std::string to_string(MutationStatus status) {
     switch (status) {
     case MutationStatus::NotFound:
@@ -133,22 +150,59 @@ StoredValue* HashTable::FindUpdateResult::selectSVToModify(const Item& itm) {
     return selectSVToModify(itm.isPending());
 }
 
+HashTable::BucketLayout HashTable::bucketLayoutFromString(
+        const std::string& layout) {
+    if (layout == "chained") {
+        return BucketLayout::Chained;
+    }
+    if (layout == "tagged") {
+        return BucketLayout::Tagged;
+    }
+    throw std::invalid_argument(
+            "HashTable::bucketLayoutFromString: unknown layout:" + layout);
+}
+
+HashTable::table_type::allocator_type HashTable::makeAllocator(
+        EPStats& st, cb::HugePageMode mode) {
+    auto policy = std::make_shared<table_type::allocator_type::Policy>();
+    policy->mode = mode;
+    // The mappings aren't seen by the allocation hooks; account for them
+    // explicitly in the bucket's memory usage
+    policy->mapped = [&st](size_t size) {
+        st.memAllocated(size);
+        st.htHugePageMemory.fetch_add(size);
+    };
+    policy->unmapped = [&st](size_t size) {
+        st.memDeallocated(size);
+        st.htHugePageMemory.fetch_sub(size);
+    };
+    return table_type::allocator_type(std::move(policy));
+}
+
 HashTable::HashTable(EPStats& st,
                      std::unique_ptr<AbstractStoredValueFactory> svFactory,
                      size_t initialSize,
-                     size_t locks)
+                     size_t locks,
+                     BucketLayout layout,
+                     cb::HugePageMode hugePages,
+                     bool perCoreStats)
     : initialSize(initialSize),
+      bucketLayout(layout),
       size(initialSize),
+      values(makeAllocator(st, hugePages)),
       mutexes(locks),
       stats(st),
       valFact(std::move(svFactory)),
       visitors(0),
-      valueStats(stats),
+      valueStats(stats, perCoreStats),
       numEjects(0),
       numResizes(0),
       maxDeletedRevSeqno(0),
       probabilisticCounter(freqCounterIncFactor) {
     values.resize(size);
+    if (bucketLayout == BucketLayout::Tagged) {
+        tagIndex.reset(size);
+    }
     activeState = true;
 }
 
@@ -160,6 +214,10 @@ HashTable::~HashTable() {
     while (visitors > 0) {
         std::this_thread::sleep_for(std::chrono::microseconds(100));
     }
+    if (negativeLookupCache) {
+        stats.coreLocal.get()->memOverhead.fetch_sub(
+                negativeLookupCache->memorySize());
+    }
 }
 
 void HashTable::cleanupIfTemporaryItem(const HashBucketLock& hbl,
@@ -169,6 +227,28 @@ void HashTable::cleanupIfTemporaryItem(const HashBucketLock& hbl,
     }
 }
 
+void HashTable::enableKeyDirectory() {
+    if (!keyDirectory) {
+        keyDirectory = std::make_unique<KeyDirectory>();
+        stats.coreLocal.get()->memOverhead.fetch_add(
+                keyDirectory->memorySize());
+    }
+}
+
+void HashTable::enableNegativeLookupCache(size_t capacity) {
+    if (!negativeLookupCache) {
+        negativeLookupCache = std::make_unique<NegativeLookupCache>(capacity);
+        stats.coreLocal.get()->memOverhead.fetch_add(
+                negativeLookupCache->memorySize());
+    }
+}
+
+void HashTable::clearKeyDirectory() {
+    if (keyDirectory) {
+        stats.coreLocal.get()->memOverhead.fetch_sub(keyDirectory->clear());
+    }
+}
+
 void HashTable::clear(bool deactivate) {
     if (!deactivate) {
         // If not deactivating, assert we're already active.
@@ -187,15 +267,37 @@ void HashTable::clear_UNLOCKED(bool deactivate) {
     }
     size_t clearedMemSize = 0;
     size_t clearedValSize = 0;
-    for (int i = 0; i < (int)size; i++) {
-        while (values[i]) {
+    auto clearChain = [&clearedMemSize,
+                       &clearedValSize](StoredValue::UniquePtr& chain) {
+        while (chain) {
             // Take ownership of the StoredValue from the vector, update
             // statistics and release it.
-            auto v = std::move(values[i]);
+            auto v = std::move(chain);
             clearedMemSize += v->size();
             clearedValSize += v->valuelen();
-            values[i] = std::move(v->getNext());
+            chain = std::move(v->getNext());
         }
+    };
+    for (int i = 0; i < (int)size; i++) {
+        clearChain(values[i]);
+    }
+
+    tagIndex.clear();
+    clearKeyDirectory();
+    clearNegativeLookupCache();
+
+    if (isResizeInProgress()) {
+        // Nothing left to migrate - discard the old bucket array.
+        stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
+        for (auto& chain : resizeMigration.oldValues) {
+            clearChain(chain);
+        }
+        table_type().swap(resizeMigration.oldValues);
+        resizeMigration.oldSize = 0;
+        resizeMigration.bucketsRemaining = 0;
+        resizeMigration.nextOldBucket.clear();
+        resizeMigration.nextLock = 0;
+        stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
     }
 
     stats.coreLocal.get()->currentSize.fetch_sub(clearedMemSize -
@@ -204,6 +306,56 @@ void HashTable::clear_UNLOCKED(bool deactivate) {
     valueStats.reset();
 }
 
+size_t HashTable::clearStripe(size_t lock) {
+    if (lock >= mutexes.size()) {
+        throw std::invalid_argument("HashTable::clearStripe: lock (which is " +
+                                    std::to_string(lock) +
+                                    ") must be less than " +
+                                    std::to_string(mutexes.size()));
+    }
+
+    // A table cleared in steps is being torn down; deactivate it first so
+    // that nothing looks up (or adds) items while its stripes are released.
+    if (isActive()) {
+        setActiveState(false);
+        clearKeyDirectory();
+        clearNegativeLookupCache();
+    }
+
+    std::lock_guard<std::mutex> guard(*mutexes[lock]);
+    size_t released = 0;
+    auto clearChain = [this, &released](StoredValue::UniquePtr& chain) {
+        while (chain) {
+            // Take ownership of the StoredValue from the chain, update
+            // statistics and release it.
+            auto v = std::move(chain);
+            chain = std::move(v->getNext());
+            const auto preProps = valueStats.prologue(v.get().get());
+            valueStats.epilogue(preProps, nullptr);
+            ++released;
+        }
+    };
+    for (size_t bucket = lock; bucket < size; bucket += mutexes.size()) {
+        clearChain(values[bucket]);
+        if (tagIndex.isEnabled()) {
+            tagIndex.rebuild(bucket, nullptr);
+        }
+    }
+
+    if (isResizeInProgress()) {
+        // The old buckets of this stripe not yet migrated are guarded by the
+        // same lock; clear them and mark them as processed.
+        auto& next = resizeMigration.nextOldBucket[lock];
+        size_t cleared = 0;
+        for (; next < resizeMigration.oldSize; next += mutexes.size()) {
+            clearChain(resizeMigration.oldValues[next]);
+            ++cleared;
+        }
+        resizeMigration.bucketsRemaining.fetch_sub(cleared);
+    }
+    return released;
+}
+
 static size_t distance(size_t a, size_t b) {
     return std::max(a, b) - std::min(a, b);
 }
@@ -217,7 +369,12 @@ static bool isCurrently(size_t size, ssize_t a, ssize_t b) {
     return (current == a || current == b);
 }
 
-void HashTable::resize() {
+static ssize_t alignUp(ssize_t value, size_t alignment) {
+    const auto align = static_cast<ssize_t>(alignment);
+    return ((value + align - 1) / align) * align;
+}
+
+size_t HashTable::getPreferredSize(size_t alignment) const {
     size_t ni = getNumInMemoryItems();
     int i(0);
     size_t new_size(0);
@@ -230,22 +387,209 @@ void HashTable::resize() {
 
     if (prime_size_table[i] == -1) {
         // We're at the end, take the biggest
-        new_size = prime_size_table[i-1];
+        new_size = alignUp(prime_size_table[i - 1], alignment);
     } else if (prime_size_table[i] < static_cast<ssize_t>(initialSize)) {
         // Was going to be smaller than the initial size.
-        new_size = initialSize;
+        new_size = alignUp(initialSize, alignment);
     } else if (0 == i) {
-        new_size = prime_size_table[i];
-    }else if (isCurrently(size, prime_size_table[i-1], prime_size_table[i])) {
+        new_size = alignUp(prime_size_table[i], alignment);
+    } else if (isCurrently(size,
+                           alignUp(prime_size_table[i - 1], alignment),
+                           alignUp(prime_size_table[i], alignment))) {
         // If one of the candidate sizes is the current size, maintain
         // the current size in order to remain stable.
         new_size = size;
     } else {
         // Somewhere in the middle, use the one we're closer to.
-        new_size = nearest(ni, prime_size_table[i-1], prime_size_table[i]);
+        new_size = nearest(ni,
+                           alignUp(prime_size_table[i - 1], alignment),
+                           alignUp(prime_size_table[i], alignment));
+    }
+    return new_size;
+}
+
+void HashTable::resize() {
+    resize(getPreferredSize(1));
+}
+
+void HashTable::resizeIncremental(size_t bucketsPerStep) {
+    const auto numLocks = mutexes.size();
+    if (!isResizeInProgress()) {
+        const auto newSize = getPreferredSize(numLocks);
+        if (newSize == size) {
+            return;
+        }
+        if ((size % numLocks) != 0) {
+            // Current bucket array isn't compatible with an incremental
+            // resize (old & new buckets for a key could be under different
+            // locks); perform a one-off blocking resize to an aligned size.
+            resize(newSize);
+            return;
+        }
+        if (!beginIncrementalResize(newSize)) {
+            return;
+        }
     }
 
-    resize(new_size);
+    while (continueIncrementalResize(bucketsPerStep)) {
+        // Each step acquires (and releases) the locks it needs; allowing
+        // front-end operations to proceed between steps.
+    }
+}
+
+bool HashTable::beginIncrementalResize(size_t newSize) {
+    if (!isActive()) {
+        throw std::logic_error(
+                "HashTable::beginIncrementalResize: Cannot call on a "
+                "non-active object");
+    }
+
+    const auto numLocks = mutexes.size();
+    if (newSize > static_cast<size_t>(std::numeric_limits<int>::max()) ||
+        newSize == 0 || (newSize % numLocks) != 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(resizeMutex);
+    if (isResizeInProgress() || newSize == size || (size % numLocks) != 0) {
+        return false;
+    }
+
+    TRACE_EVENT2("HashTable",
+                 "beginIncrementalResize",
+                 "size",
+                 size.load(),
+                 "newSize",
+                 newSize);
+
+    // Allocate everything before acquiring the locks, so they are only held
+    // while switching between the arrays.
+    table_type newValues(newSize, values.get_allocator());
+    HashTableTagIndex newTagIndex;
+    if (tagIndex.isEnabled()) {
+        newTagIndex.reset(newSize);
+    }
+    std::vector<size_t> nextOldBucket(numLocks);
+    for (size_t lock = 0; lock < numLocks; ++lock) {
+        nextOldBucket[lock] = lock;
+    }
+
+    MultiLockHolder mlh(mutexes);
+    if (visitors.load() > 0) {
+        // As per resize(); visitors iterate based on `size` so we cannot
+        // switch arrays underneath them.
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
+    ++numResizes;
+
+    resizeMigration.oldValues.swap(values);
+    values.swap(newValues);
+    // The old tag index is no longer needed - items remaining in the old
+    // array are only located by walking their chains while being migrated.
+    tagIndex.swap(newTagIndex);
+    resizeMigration.nextOldBucket.swap(nextOldBucket);
+    resizeMigration.nextLock = 0;
+    resizeMigration.bucketsRemaining = size.load();
+    resizeMigration.oldSize = size.load();
+    size.store(newSize);
+
+    stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
+    recordResizeStep(start);
+    return true;
+}
+
+bool HashTable::continueIncrementalResize(size_t maxBuckets) {
+    std::lock_guard<std::mutex> guard(resizeMutex);
+    return continueIncrementalResize_UNLOCKED(maxBuckets);
+}
+
+bool HashTable::continueIncrementalResize_UNLOCKED(size_t maxBuckets) {
+    if (!isResizeInProgress()) {
+        return false;
+    }
+
+    const auto numLocks = mutexes.size();
+    size_t budget = std::max(maxBuckets, size_t(1));
+    auto& migration = resizeMigration;
+    while (budget > 0 && migration.nextLock < numLocks) {
+        const auto start = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lh(*mutexes[migration.nextLock]);
+        if (!isResizeInProgress()) {
+            // Discarded by a concurrent clear().
+            return false;
+        }
+        budget -= migrateStripe_UNLOCKED(migration.nextLock, budget);
+        if (migration.nextOldBucket[migration.nextLock] >= migration.oldSize) {
+            ++migration.nextLock;
+        }
+        recordResizeStep(start);
+    }
+
+    if (migration.nextLock < numLocks) {
+        return true;
+    }
+
+    // All old buckets migrated; discard the old array. Destroying the
+    // (now empty) array is done after the locks are released.
+    table_type oldValues;
+    {
+        MultiLockHolder mlh(mutexes);
+        if (!isResizeInProgress()) {
+            return false;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
+        oldValues.swap(migration.oldValues);
+        migration.oldSize = 0;
+        migration.bucketsRemaining = 0;
+        migration.nextOldBucket.clear();
+        migration.nextLock = 0;
+        stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
+        recordResizeStep(start);
+    }
+    return false;
+}
+
+void HashTable::migrateOldBucket_UNLOCKED(size_t oldBucket) {
+    auto& chain = resizeMigration.oldValues[oldBucket];
+    while (chain) {
+        // unlink the front element from the old hash chain...
+        auto v = std::move(chain);
+        chain = std::move(v->getNext());
+
+        // ... and re-link it into the correct place in values.
+        const auto hash = v->getKey().hash();
+        const int newBucket = getBucketForHash(hash);
+        v->setNext(std::move(values[newBucket]));
+        values[newBucket] = std::move(v);
+        indexLinked(newBucket, *values[newBucket].get().get());
+    }
+}
+
+size_t HashTable::migrateStripe_UNLOCKED(size_t lock, size_t maxBuckets) {
+    if (!isResizeInProgress()) {
+        return 0;
+    }
+    auto& next = resizeMigration.nextOldBucket[lock];
+    size_t migrated = 0;
+    while (next < resizeMigration.oldSize && migrated < maxBuckets) {
+        migrateOldBucket_UNLOCKED(next);
+        next += mutexes.size();
+        ++migrated;
+    }
+    resizeMigration.bucketsRemaining.fetch_sub(migrated);
+    return migrated;
+}
+
+void HashTable::recordResizeStep(std::chrono::steady_clock::time_point start) {
+    const auto duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    atomic_setIfBigger(maxResizeStepUs, uint64_t(duration));
 }
 
 void HashTable::resize(size_t newSize) {
@@ -268,6 +612,16 @@ void HashTable::resize(size_t newSize) {
     TRACE_EVENT2(
             "HashTable", "resize", "size", size.load(), "newSize", newSize);
 
+    std::lock_guard<std::mutex> guard(resizeMutex);
+    // Complete any in-progress incremental resize first, so there is only
+    // one bucket array to rehash.
+    while (continueIncrementalResize_UNLOCKED(
+            std::numeric_limits<size_t>::max())) {
+    }
+    if (newSize == size) {
+        return;
+    }
+
     MultiLockHolder mlh(mutexes);
     if (visitors.load() > 0) {
         // Do not allow a resize while any visitors are actually
@@ -277,8 +631,14 @@ void HashTable::resize(size_t newSize) {
         return;
     }
 
+    const auto start = std::chrono::steady_clock::now();
+
     // Get a place for the new items.
-    table_type newValues(newSize);
+    table_type newValues(newSize, values.get_allocator());
+    HashTableTagIndex newTagIndex;
+    if (tagIndex.isEnabled()) {
+        newTagIndex.reset(newSize);
+    }
 
     stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
     ++numResizes;
@@ -295,7 +655,11 @@ void HashTable::resize(size_t newSize) {
             values[i] = std::move(v->getNext());
 
             // And re-link it into the correct place in newValues.
-            int newBucket = getBucketForHash(v->getKey().hash());
+            const auto hash = v->getKey().hash();
+            int newBucket = getBucketForHash(hash);
+            if (newTagIndex.isEnabled()) {
+                newTagIndex.insert(newBucket, hash, v.get().get());
+            }
             v->setNext(std::move(newValues[newBucket]));
             newValues[newBucket] = std::move(v);
         }
@@ -303,8 +667,71 @@ void HashTable::resize(size_t newSize) {
 
     // Finally assign the new table to values.
     values = std::move(newValues);
+    tagIndex.swap(newTagIndex);
 
     stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
+    recordResizeStep(start);
+}
+
+std::vector<uint32_t> HashTable::hashKeys(const std::vector<DocKey>& keys) {
+    // Must produce exactly DocKey::hash(); see DocKeyInterface::hash().
+    auto seed = [](const DocKey& key) {
+        uint32_t h = 5381;
+        if (key.getEncoding() == DocKeyEncodesCollectionId::No) {
+            h = ((h << 5) + h) ^ uint32_t(DefaultCollectionLeb128Encoded);
+        }
+        return h;
+    };
+
+    std::vector<uint32_t> hashes(keys.size());
+    constexpr size_t Lanes = 4;
+    size_t k = 0;
+    for (; k + Lanes <= keys.size(); k += Lanes) {
+        std::array<uint32_t, Lanes> h;
+        std::array<const uint8_t*, Lanes> data;
+        size_t common = std::numeric_limits<size_t>::max();
+        for (size_t l = 0; l < Lanes; ++l) {
+            h[l] = seed(keys[k + l]);
+            data[l] = keys[k + l].data();
+            common = std::min(common, keys[k + l].size());
+        }
+        // Hash the common prefix length of all lanes in lockstep...
+        for (size_t i = 0; i < common; ++i) {
+            for (size_t l = 0; l < Lanes; ++l) {
+                h[l] = ((h[l] << 5) + h[l]) ^ uint32_t(data[l][i]);
+            }
+        }
+        // ... then the remaining tail of each key.
+        for (size_t l = 0; l < Lanes; ++l) {
+            for (size_t i = common; i < keys[k + l].size(); ++i) {
+                h[l] = ((h[l] << 5) + h[l]) ^ uint32_t(data[l][i]);
+            }
+            hashes[k + l] = h[l];
+        }
+    }
+    for (; k < keys.size(); ++k) {
+        hashes[k] = keys[k].hash();
+    }
+    return hashes;
+}
+
+void HashTable::prefetchBuckets(const std::vector<uint32_t>& hashes) {
+    if (!isActive()) {
+        throw std::logic_error(
+                "HashTable::prefetchBuckets: Cannot call on a "
+                "non-active object");
+    }
+    // The bucket array (and tag index) are only reallocated with all of the
+    // mutexes held; holding any one of them keeps them stable while we
+    // compute the addresses to prefetch.
+    std::lock_guard<std::mutex> lh(*mutexes[0]);
+    for (const auto hash : hashes) {
+        const auto bucket = getBucketForHash(hash);
+        prefetchForRead(&values[bucket]);
+        if (tagIndex.isEnabled()) {
+            prefetchForRead(&tagIndex[bucket]);
+        }
+    }
 }
 
 HashTable::FindInnerResult HashTable::findInner(const DocKey& key) {
@@ -313,21 +740,43 @@ HashTable::FindInnerResult HashTable::findInner(const DocKey& key) {
                 "HashTable::find: Cannot call on a "
                 "non-active object");
     }
-    HashBucketLock hbl = getLockedBucket(key);
-    // Scan through all elements in the hash bucket chain looking for Committed
-    // and Pending items with the same key.
+    const auto hash = key.hash();
+    HashBucketLock hbl = getLockedBucketForHash(hash);
     StoredValue* foundCmt = nullptr;
     StoredValue* foundPend = nullptr;
+    auto record = [&foundCmt, &foundPend](StoredValue* v) {
+        if (v->isPending() || v->isCompleted()) {
+            Expects(!foundPend);
+            foundPend = v;
+        } else {
+            Expects(!foundCmt);
+            foundCmt = v;
+        }
+    };
+
+    if (tagIndex.isEnabled()) {
+        const auto& group = tagIndex[hbl.getBucketNum()];
+        if (!group.overflow) {
+            // All elements of the bucket are indexed; only the StoredValues
+            // whose tag matches need to be compared with the key.
+            auto mask = group.match(HashTableTagIndex::tagForHash(hash));
+            while (mask) {
+                const auto slot = folly::findFirstSet(mask) - 1;
+                mask &= mask - 1;
+                if (group.values[slot]->hasKey(key)) {
+                    record(group.values[slot]);
+                }
+            }
+            return {std::move(hbl), foundCmt, foundPend};
+        }
+    }
+
+    // Scan through all elements in the hash bucket chain looking for Committed
+    // and Pending items with the same key.
     for (StoredValue* v = values[hbl.getBucketNum()].get().get(); v;
          v = v->getNext().get().get()) {
         if (v->hasKey(key)) {
-            if (v->isPending() || v->isCompleted()) {
-                Expects(!foundPend);
-                foundPend = v;
-            } else {
-                Expects(!foundCmt);
-                foundCmt = v;
-            }
+            record(v);
         }
     }
 
@@ -421,7 +870,17 @@ StoredValue* HashTable::unlocked_addNewStoredValue(const HashBucketLock& hbl,
     valueStats.epilogue(emptyProperties, v.get().get());
 
     values[hbl.getBucketNum()] = std::move(v);
-    return values[hbl.getBucketNum()].get().get();
+    auto* added = values[hbl.getBucketNum()].get().get();
+    indexLinked(hbl.getBucketNum(), *added);
+    if (keyDirectory) {
+        // The HashTable is authoritative for the key again
+        keyDirectory->erase(added->getKey());
+    }
+    if (negativeLookupCache) {
+        // The key exists again (at least in memory)
+        negativeLookupCache->erase(added->getKey());
+    }
+    return added;
 }
 
 HashTable::Statistics::StoredValueProperties::StoredValueProperties(
@@ -442,6 +901,7 @@ HashTable::Statistics::StoredValueProperties::StoredValueProperties(
     isTempItem = sv->isTempItem();
     isSystemItem = sv->getKey().getCollectionID().isSystem();
     isPreparedSyncWrite = sv->isPending() || sv->isCompleted();
+    collection = sv->getKey().getCollectionID();
 }
 
 HashTable::Statistics::StoredValueProperties HashTable::Statistics::prologue(
@@ -455,20 +915,29 @@ void HashTable::Statistics::epilogue(StoredValueProperties pre,
     // update all statistics for all properties which have changed.
 
     const auto post = StoredValueProperties(v);
+    auto& counts = localCounts();
 
     // Update size, metadataSize & uncompressed size if pre/post differ.
     if (pre.size != post.size) {
-        cacheSize.fetch_add(post.size - pre.size);
-        memSize.fetch_add(post.size - pre.size);
+        counts.cacheSize.fetch_add(post.size - pre.size);
+        counts.memSize.fetch_add(post.size - pre.size);
+        // A StoredValue's key (and hence collection) never changes, so a
+        // valid pre/post pair always shares the same collection.
+        if (pre.isValid) {
+            collectionMemSize.add(pre.collection, -pre.size);
+        }
+        if (post.isValid) {
+            collectionMemSize.add(post.collection, post.size);
+        }
     }
     if (pre.metaDataSize != post.metaDataSize) {
-        metaDataMemory.fetch_add(post.metaDataSize - pre.metaDataSize);
+        counts.metaDataMemory.fetch_add(post.metaDataSize - pre.metaDataSize);
         epStats.coreLocal.get()->currentSize.fetch_add(post.metaDataSize -
                                                        pre.metaDataSize);
     }
     if (pre.uncompressedSize != post.uncompressedSize) {
-        uncompressedMemSize.fetch_add(post.uncompressedSize -
-                                      pre.uncompressedSize);
+        counts.uncompressedMemSize.fetch_add(post.uncompressedSize -
+                                             pre.uncompressedSize);
     }
 
     // Determine if valid, non resident; and update numNonResidentItems if
@@ -479,29 +948,29 @@ void HashTable::Statistics::epilogue(StoredValueProperties pre,
             post.isValid &&
             (!post.isResident && !post.isDeleted && !post.isTempItem);
     if (preNonResident != postNonResident) {
-        numNonResidentItems.fetch_add(postNonResident - preNonResident);
+        counts.numNonResidentItems.fetch_add(postNonResident - preNonResident);
     }
 
     if (pre.isTempItem != post.isTempItem) {
-        numTempItems.fetch_add(post.isTempItem - pre.isTempItem);
+        counts.numTempItems.fetch_add(post.isTempItem - pre.isTempItem);
     }
 
     // nonItems only considers valid; non-temporary items:
     bool preNonTemp = pre.isValid && !pre.isTempItem;
     bool postNonTemp = post.isValid && !post.isTempItem;
     if (preNonTemp != postNonTemp) {
-        numItems.fetch_add(postNonTemp - preNonTemp);
+        counts.numItems.fetch_add(postNonTemp - preNonTemp);
     }
 
     if (pre.isSystemItem != post.isSystemItem) {
-        numSystemItems.fetch_add(post.isSystemItem - pre.isSystemItem);
+        counts.numSystemItems.fetch_add(post.isSystemItem - pre.isSystemItem);
     }
 
     // numPreparedItems counts valid, prepared (not yet committed) items.
     const bool prePrepared = pre.isValid && pre.isPreparedSyncWrite;
     const bool postPrepared = post.isValid && post.isPreparedSyncWrite;
     if (prePrepared != postPrepared) {
-        numPreparedSyncWrites.fetch_add(postPrepared - prePrepared);
+        counts.numPreparedSyncWrites.fetch_add(postPrepared - prePrepared);
     }
 
     // Don't include system items in the deleted count, numSystemItems will
@@ -513,27 +982,155 @@ void HashTable::Statistics::epilogue(StoredValueProperties pre,
     const bool postDeleted =
             post.isDeleted && !post.isSystemItem && !post.isPreparedSyncWrite;
     if (preDeleted != postDeleted) {
-        numDeletedItems.fetch_add(postDeleted - preDeleted);
+        counts.numDeletedItems.fetch_add(postDeleted - preDeleted);
     }
 
     // Update datatypes. These are only tracked for non-temp, non-deleted,
     // committed items.
     if (preNonTemp && !pre.isDeleted && !pre.isPreparedSyncWrite) {
-        --datatypeCounts[pre.datatype];
+        counts.datatypeCounts[pre.datatype].fetch_sub(1);
     }
     if (postNonTemp && !post.isDeleted && !post.isPreparedSyncWrite) {
-        ++datatypeCounts[post.datatype];
+        counts.datatypeCounts[post.datatype].fetch_add(1);
+    }
+}
+
+HashTable::Statistics::Statistics(EPStats& epStats, bool perCoreCounts)
+    : epStats(epStats) {
+    if (perCoreCounts) {
+        coreCounts = std::make_unique<
+                CoreStore<folly::CachelinePadded<CoreCounts>>>();
     }
 }
 
 void HashTable::Statistics::reset() {
-    datatypeCounts.fill(0);
-    numItems.store(0);
-    numTempItems.store(0);
-    numNonResidentItems.store(0);
-    memSize.store(0);
-    cacheSize.store(0);
-    uncompressedMemSize.store(0);
+    auto resetCounts = [](CoreCounts& counts) {
+        for (auto& count : counts.datatypeCounts) {
+            count.store(0);
+        }
+        counts.numItems.store(0);
+        counts.numTempItems.store(0);
+        counts.numNonResidentItems.store(0);
+        counts.memSize.store(0);
+        counts.cacheSize.store(0);
+        counts.uncompressedMemSize.store(0);
+    };
+    resetCounts(sharedCounts);
+    if (coreCounts) {
+        for (auto& core : *coreCounts) {
+            resetCounts(*core);
+        }
+    }
+    collectionMemSize.reset();
+}
+
+HashTable::DatatypeCombo HashTable::Statistics::getDatatypeCounts() const {
+    std::array<int64_t, mcbp::datatype::highest + 1> totals{};
+    if (coreCounts) {
+        for (const auto& core : *coreCounts) {
+            for (size_t ii = 0; ii < totals.size(); ++ii) {
+                totals[ii] += core->datatypeCounts[ii].load();
+            }
+        }
+    } else {
+        for (size_t ii = 0; ii < totals.size(); ++ii) {
+            totals[ii] = sharedCounts.datatypeCounts[ii].load();
+        }
+    }
+    DatatypeCombo result;
+    for (size_t ii = 0; ii < totals.size(); ++ii) {
+        result[ii] = checkedCount(totals[ii]);
+    }
+    return result;
+}
+
+size_t HashTable::Statistics::sum(
+        cb::RelaxedAtomic<int64_t> CoreCounts::*count) const {
+    if (!coreCounts) {
+        return checkedCount((sharedCounts.*count).load());
+    }
+    int64_t result = 0;
+    for (const auto& core : *coreCounts) {
+        result += ((*core).*count).load();
+    }
+    return checkedCount(result);
+}
+
+size_t HashTable::Statistics::checkedCount(int64_t count) const {
+    if (count >= 0) {
+        return size_t(count);
+    }
+#if CB_DEVELOPMENT_ASSERTS
+    if (!coreCounts) {
+        throw std::underflow_error(
+                "HashTable::Statistics: count underflowed to " +
+                std::to_string(count));
+    }
+#endif
+    // The cores aren't read atomically, so a concurrent update may be seen
+    // on one core but not the other.
+    return 0;
+}
+
+HashTable::Statistics::CoreCounts::CoreCounts()
+    : numItems(0),
+      numNonResidentItems(0),
+      numDeletedItems(0),
+      numTempItems(0),
+      numSystemItems(0),
+      numPreparedSyncWrites(0),
+      cacheSize(0),
+      metaDataMemory(0),
+      memSize(0),
+      uncompressedMemSize(0) {
+    for (auto& count : datatypeCounts) {
+        count.store(0);
+    }
+}
+
+void HashTable::Statistics::CollectionMemSize::add(CollectionID cid,
+                                                   int64_t delta) {
+    const CollectionIDType id = cid;
+    const size_t start = std::hash<CollectionID>()(cid) % Slots;
+    for (size_t ii = 0; ii < Slots; ++ii) {
+        auto& slot = slots[(start + ii) % Slots];
+        auto owner = slot.cid.load(std::memory_order_acquire);
+        if (owner == Unused &&
+            slot.cid.compare_exchange_strong(owner, id)) {
+            owner = id;
+        }
+        if (owner == id) {
+            slot.memSize.fetch_add(delta, std::memory_order_relaxed);
+            return;
+        }
+    }
+    overflow.fetch_add(delta, std::memory_order_relaxed);
+}
+
+size_t HashTable::Statistics::CollectionMemSize::get(CollectionID cid) const {
+    const CollectionIDType id = cid;
+    const size_t start = std::hash<CollectionID>()(cid) % Slots;
+    for (size_t ii = 0; ii < Slots; ++ii) {
+        const auto& slot = slots[(start + ii) % Slots];
+        const auto owner = slot.cid.load(std::memory_order_acquire);
+        if (owner == id) {
+            return std::max(int64_t(0),
+                            slot.memSize.load(std::memory_order_relaxed));
+        }
+        if (owner == Unused) {
+            break;
+        }
+    }
+    // Not tracked individually; report the shared overflow so callers err
+    // on the side of treating the collection as large.
+    return std::max(int64_t(0), overflow.load(std::memory_order_relaxed));
+}
+
+void HashTable::Statistics::CollectionMemSize::reset() {
+    for (auto& slot : slots) {
+        slot.memSize.store(0);
+    }
+    overflow.store(0);
 }
 
 std::pair<StoredValue*, StoredValue::UniquePtr>
@@ -563,7 +1160,9 @@ HashTable::unlocked_replaceByCopy(const HashBucketLock& hbl,
     valueStats.epilogue(emptyProperties, newSv.get().get());
 
     values[hbl.getBucketNum()] = std::move(newSv);
-    return {values[hbl.getBucketNum()].get().get(), std::move(releasedSv)};
+    auto* copy = values[hbl.getBucketNum()].get().get();
+    indexLinked(hbl.getBucketNum(), *copy);
+    return {copy, std::move(releasedSv)};
 }
 
 HashTable::DeleteResult HashTable::unlocked_softDelete(
@@ -783,6 +1382,30 @@ HashTable::FindResult HashTable::findItem(const Item& item) {
             std::move(result.lock)};
 }
 
+StoredValue::UniquePtr HashTable::unlinkStoredValue(int bucket,
+                                                    const StoredValue* sv) {
+    auto matches = [sv](const StoredValue* v) { return v == sv; };
+    if (values[bucket]) {
+        auto removed = hashChainRemoveFirst(values[bucket], matches);
+        if (removed) {
+            indexUnlinked(bucket, removed.get().get());
+            return removed;
+        }
+    }
+
+    if (isResizeInProgress()) {
+        // Not yet migrated from the old bucket array (the caller holds the
+        // lock for the key, which also guards its old bucket).
+        const int h = sv->getKey().hash();
+        auto& oldChain = resizeMigration.oldValues[abs(
+                h % static_cast<int>(resizeMigration.oldSize))];
+        if (oldChain) {
+            return hashChainRemoveFirst(oldChain, matches);
+        }
+    }
+    return nullptr;
+}
+
 void HashTable::unlocked_del(const HashBucketLock& hbl, StoredValue* value) {
     unlocked_release(hbl, value).reset();
 }
@@ -802,10 +1425,7 @@ StoredValue::UniquePtr HashTable::unlocked_release(
     }
     // Remove the first (should only be one) StoredValue matching the given
     // pointer
-    auto released = hashChainRemoveFirst(
-            values[hbl.getBucketNum()], [valueToRelease](const StoredValue* v) {
-                return v == valueToRelease;
-            });
+    auto released = unlinkStoredValue(hbl.getBucketNum(), valueToRelease);
 
     if (!released) {
         /* We shouldn't reach here, we must delete the StoredValue in the
@@ -814,7 +1434,6 @@ StoredValue::UniquePtr HashTable::unlocked_release(
                 "HashTable::unlocked_release_base: StoredValue to be released "
                 "not found in HashTable; possibly HashTable leak");
     }
-
     // Update statistics for the item which is now gone.
     const auto preProps = valueStats.prologue(released.get().get());
     valueStats.epilogue(preProps, nullptr);
@@ -883,16 +1502,34 @@ MutationStatus HashTable::insertFromWarmup(const Item& itm,
 
 bool HashTable::reallocateStoredValue(StoredValue&& sv) {
     // Search the chain and reallocate
-    for (StoredValue::UniquePtr* curr =
-                 &values[getBucketForHash(sv.getKey().hash())];
-         curr->get().get();
+    const int bucket = getBucketForHash(sv.getKey().hash());
+    for (StoredValue::UniquePtr* curr = &values[bucket]; curr->get().get();
          curr = &curr->get()->getNext()) {
         if (&sv == curr->get().get()) {
             auto newSv = valFact->copyStoredValue(sv, std::move(sv.getNext()));
             curr->swap(newSv);
+            if (tagIndex.isEnabled()) {
+                tagIndex.replace(bucket, &sv, curr->get().get());
+            }
             return true;
         }
     }
+
+    if (isResizeInProgress()) {
+        const int h = sv.getKey().hash();
+        const int oldBucket = abs(h % static_cast<int>(resizeMigration.oldSize));
+        for (StoredValue::UniquePtr* curr =
+                     &resizeMigration.oldValues[oldBucket];
+             curr->get().get();
+             curr = &curr->get()->getNext()) {
+            if (&sv == curr->get().get()) {
+                auto newSv =
+                        valFact->copyStoredValue(sv, std::move(sv.getNext()));
+                curr->swap(newSv);
+                return true;
+            }
+        }
+    }
     return false;
 }
 
@@ -903,16 +1540,18 @@ void HashTable::dump() const {
 nlohmann::json HashTable::dumpStoredValuesAsJson() const {
     MultiLockHolder mlh(mutexes);
     auto obj = nlohmann::json::array();
-    for (const auto& chain : values) {
-        if (chain) {
-            for (StoredValue* sv = chain.get().get(); sv != nullptr;
-                 sv = sv->getNext().get().get()) {
-                std::stringstream ss;
-                ss << sv->getKey();
-                obj.push_back(*sv);
+    auto dumpChains = [&obj](const table_type& table) {
+        for (const auto& chain : table) {
+            if (chain) {
+                for (StoredValue* sv = chain.get().get(); sv != nullptr;
+                     sv = sv->getNext().get().get()) {
+                    obj.push_back(*sv);
+                }
             }
         }
-    }
+    };
+    dumpChains(values);
+    dumpChains(resizeMigration.oldValues);
 
     return obj;
 }
@@ -933,6 +1572,38 @@ void HashTable::visit(HashTableVisitor& visitor) {
     }
 }
 
+size_t HashTable::visitSample(HashTableVisitor& visitor,
+                              size_t samples,
+                              uint64_t seed) {
+    if (valueStats.getNumItems() == 0 || !isActive()) {
+        return 0;
+    }
+    std::mt19937_64 rng(seed);
+    size_t visited = 0;
+    for (size_t tries = 0; tries < samples * 4 && visited < samples;
+         ++tries) {
+        const int bucket = static_cast<int>(rng() % size);
+        auto lh = getLockedBucket(bucket);
+        if (static_cast<size_t>(bucket) >= size) {
+            // Shrunk before we took the lock.
+            continue;
+        }
+        visitor.setUpHashBucketVisit();
+        bool keepGoing = true;
+        for (StoredValue* v = values[bucket].get().get();
+             v && keepGoing && visited < samples;
+             v = v->getNext().get().get()) {
+            ++visited;
+            keepGoing = visitor.visit(lh, *v);
+        }
+        visitor.tearDownHashBucketVisit();
+        if (!keepGoing) {
+            break;
+        }
+    }
+    return visited;
+}
+
 void HashTable::visitDepth(HashTableDepthVisitor &visitor) {
     if (valueStats.getNumItems() == 0 || !isActive()) {
         return;
@@ -941,15 +1612,21 @@ void HashTable::visitDepth(HashTableDepthVisitor &visitor) {
     // Acquire one (any) of the mutexes before incrementing {visitors}, this
     // prevents any race between this visitor and the HashTable resizer.
     // See comments in pauseResumeVisit() for further details.
-    std::unique_lock<std::mutex> lh(mutexes[0]);
+    std::unique_lock<std::mutex> lh(*mutexes[0]);
     VisitorTracker vt(&visitors);
     lh.unlock();
 
     for (int l = 0; l < static_cast<int>(mutexes.size()); l++) {
+        if (isResizeInProgress()) {
+            // Move any items guarded by this lock into `values` so the
+            // depth of each (new) bucket is complete.
+            LockHolder stripeLock(*mutexes[l]);
+            migrateStripe_UNLOCKED(l, std::numeric_limits<size_t>::max());
+        }
         for (int i = l; i < static_cast<int>(size); i+= mutexes.size()) {
             // (re)acquire mutex on each HashBucket, to minimise any impact
             // on front-end threads.
-            LockHolder lh(mutexes[l]);
+            LockHolder lh(*mutexes[l]);
 
             size_t depth = 0;
             StoredValue* p = values[i].get().get();
@@ -998,7 +1675,7 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
     // inside the inner for() loop. To prevent this race, we explicitly acquire
     // (any) mutex, increment {visitors} and then release the mutex. This
     //avoids the race as if visitors >0 then Resizer will not attempt to resize.
-    std::unique_lock<std::mutex> lh(mutexes[0]);
+    std::unique_lock<std::mutex> lh(*mutexes[0]);
     VisitorTracker vt(&visitors);
     lh.unlock();
 
@@ -1010,6 +1687,15 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
 
         // If the bucket position is *this* lock, then start from the
         // recorded bucket (as long as we haven't resized).
+        if (isResizeInProgress()) {
+            // An incremental resize is in progress; migrate all of the old
+            // buckets guarded by this lock first so every item belonging to
+            // this lock is visited via `values`. Only this one lock is held
+            // while doing so. (A resize cannot begin while we are visiting.)
+            std::lock_guard<std::mutex> guard(*mutexes[lock]);
+            migrateStripe_UNLOCKED(lock, std::numeric_limits<size_t>::max());
+        }
+
         hash_bucket = lock;
         if (start_pos.lock == lock &&
             start_pos.ht_size == size &&
@@ -1027,7 +1713,7 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
             // around the HashBucket visit then we need to release it before
             // tearDownHashBucketVisit() is called.
             {
-                HashBucketLock lh(hash_bucket, mutexes[lock]);
+                HashBucketLock lh(hash_bucket, *mutexes[lock]);
 
                 StoredValue* v = values[hash_bucket].get().get();
                 while (!paused && v) {
@@ -1083,11 +1769,17 @@ bool HashTable::unlocked_ejectItem(const HashTable::HashBucketLock&,
         break;
     }
     case EvictionPolicy::Full: {
+        // Documents with an expiry time are not recorded in the KeyDirectory
+        // as they may expire (on disk) while evicted.
+        if (keyDirectory && vptr->isCommitted() && !vptr->isDeleted() &&
+            !vptr->isTempItem() && vptr->getExptime() == 0) {
+            stats.coreLocal.get()->memOverhead.fetch_add(keyDirectory->insert(
+                    vptr->getKey(), vptr->getBySeqno()));
+        }
+
         // Remove the item from the hash table.
         int bucket_num = getBucketForHash(vptr->getKey().hash());
-        auto removed = hashChainRemoveFirst(
-                values[bucket_num],
-                [vptr](const StoredValue* v) { return v == vptr; });
+        auto removed = unlinkStoredValue(bucket_num, vptr);
 
         if (removed->isResident()) {
             ++stats.numValueEjects;
@@ -1184,11 +1876,13 @@ std::ostream& operator<<(std::ostream& os, const HashTable& ht) {
        << " numSystemItems:" << ht.getNumSystemItems()
        << " numPreparedSW:" << ht.getNumPreparedSyncWrites()
        << " values: " << std::endl;
-    for (const auto& chain : ht.values) {
-        if (chain) {
-            for (StoredValue* sv = chain.get().get(); sv != nullptr;
-                 sv = sv->getNext().get().get()) {
-                os << "    " << *sv << std::endl;
+    for (const auto* table : {&ht.values, &ht.resizeMigration.oldValues}) {
+        for (const auto& chain : *table) {
+            if (chain) {
+                for (StoredValue* sv = chain.get().get(); sv != nullptr;
+                     sv = sv->getNext().get().get()) {
+                    os << "    " << *sv << std::endl;
+                }
             }
         }
     }
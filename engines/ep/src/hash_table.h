@@ -17,14 +17,26 @@
 
 #pragma once
 
+#include "hash_table_tag_index.h"
+#include "key_directory.h"
+#include "locks.h"
+#include "lock_profiler.h"
+#include "negative_lookup_cache.h"
 #include "probabilistic_counter.h"
 #include "stored-value.h"
 #include "storeddockey.h"
 
+#include <folly/CachelinePadded.h>
+#include <platform/corestore.h>
 #include <platform/non_negative_counter.h>
+#include <relaxed_atomic.h>
+#include <utilities/huge_page_allocator.h>
 
 #include <array>
+#include <chrono>
 #include <functional>
+#include <limits>
+#include <vector>
 
 class AbstractStoredValueFactory;
 class HashTableVisitor;
@@ -139,11 +151,27 @@ enum class DeletionDurability : uint8_t {};
  * bucket; then chaining is used (StoredValue::chain_next_or_replacement) to
  * handle any collisions.
  *
+ * Optionally (BucketLayout::Tagged) each bucket additionally has a cache-line
+ * sized group of key tags and StoredValue pointers in front of its chain (see
+ * HashTableTagIndex). Lookups compare the requested key's tag against the
+ * group first, and only touch the StoredValues whose tag matches; avoiding
+ * the dependent cache misses of walking the chain. The chains remain the
+ * owners of the StoredValues, so visiting is unaffected by the layout.
+ *
  * The HashTable can be resized if it grows too full - this is done by
  * acquiring all the ht_locks, and then allocating a new vector of buckets and
  * re-hashing all elements into the new table. While resizing is occuring all
  * other access to the HashTable is blocked.
  *
+ * Alternatively the HashTable can be resized incrementally (see
+ * beginIncrementalResize()). The previous bucket array is kept alive and its
+ * buckets are migrated into the new array a bounded number at a time, with
+ * only one lock held per step. This requires that both the old and the new
+ * size are multiples of the number of locks - that way a key's old and new
+ * buckets are guarded by the same lock, and any access to a key (via
+ * getLockedBucket()) first migrates that key's old bucket. Visitors migrate
+ * each lock's buckets before visiting them, so see every item exactly once.
+ *
  * Support for holding both Committed and Pending items requires that we
  * can represent having for each key, either:
  *  1. No item present
@@ -159,6 +187,20 @@ enum class DeletionDurability : uint8_t {};
  */
 class HashTable {
 public:
+    /**
+     * How StoredValues are located within a hash bucket.
+     */
+    enum class BucketLayout : uint8_t {
+        /// Walk the bucket chain, comparing keys of every element.
+        Chained,
+        /// Probe a per-bucket group of key tags before touching any
+        /// StoredValue; falling back to the chain only if the group overflows.
+        Tagged,
+    };
+
+    /// Convert the "ht_bucket_layout" configuration value to a BucketLayout.
+    static BucketLayout bucketLayoutFromString(const std::string& layout);
+
     /**
      * Datatype counts; one element for each combination of datatypes
      * (e.g. JSON, JSON+XATTR, JSON+Snappy, etc...)
@@ -221,8 +263,11 @@ public:
      */
     class Statistics {
     public:
-        Statistics(EPStats& epStats) : epStats(epStats) {
-        }
+        /**
+         * @param perCoreCounts keep a copy of the counts per core (see
+         *        CoreCounts) rather than a single shared copy
+         */
+        Statistics(EPStats& epStats, bool perCoreCounts);
 
         /**
          * Set of properties on a StoredValue which are considerd by statistics
@@ -246,6 +291,7 @@ public:
             bool isTempItem = false;
             bool isSystemItem = false;
             bool isPreparedSyncWrite = false;
+            CollectionID collection;
         };
 
         /**
@@ -290,90 +336,164 @@ public:
         void reset();
 
         size_t getNumItems() const {
-            return numItems;
+            return sum(&CoreCounts::numItems);
         }
 
         size_t getNumNonResidentItems() const {
-            return numNonResidentItems;
+            return sum(&CoreCounts::numNonResidentItems);
         }
 
         size_t getNumDeletedItems() const {
-            return numDeletedItems;
+            return sum(&CoreCounts::numDeletedItems);
         }
 
         size_t getNumTempItems() const {
-            return numTempItems;
+            return sum(&CoreCounts::numTempItems);
         }
 
         size_t getNumSystemItems() const {
-            return numSystemItems;
+            return sum(&CoreCounts::numSystemItems);
         }
 
         size_t getNumPreparedSyncWrites() const {
-            return numPreparedSyncWrites;
+            return sum(&CoreCounts::numPreparedSyncWrites);
         }
 
-        DatatypeCombo getDatatypeCounts() const {
-            return datatypeCounts;
-        }
+        DatatypeCombo getDatatypeCounts() const;
 
         size_t getCacheSize() const {
-            return cacheSize;
+            return sum(&CoreCounts::cacheSize);
         }
 
         size_t getMetaDataMemory() const {
-            return metaDataMemory;
+            return sum(&CoreCounts::metaDataMemory);
         }
 
         size_t getMemSize() const {
-            return memSize;
+            return sum(&CoreCounts::memSize);
         }
 
         size_t getUncompressedMemSize() const {
-            return uncompressedMemSize;
+            return sum(&CoreCounts::uncompressedMemSize);
+        }
+
+        size_t getCollectionMemSize(CollectionID cid) const {
+            return collectionMemSize.get(cid);
+        }
+
+        /// @return the memory used by the per-core counters (if enabled).
+        size_t memorySize() const {
+            return coreCounts ? coreCounts->size() * sizeof((*coreCounts)[0])
+                              : 0;
         }
 
     private:
-        /// Count of alive & deleted, in-memory non-resident and resident items.
-        /// Excludes temporary and prepared items.
-        cb::NonNegativeCounter<size_t> numItems;
+        /**
+         * Memory consumed by the items of each collection. Updated from
+         * epilogue() which may run concurrently for different hash buckets,
+         * so this is a fixed size, open-addressed table of atomics: a slot is
+         * claimed (by CAS) by the first collection which probes it and is
+         * never released. Collections which don't find a slot share the
+         * overflow counter; the pager only uses these as a hint so that is
+         * acceptable.
+         */
+        class CollectionMemSize {
+        public:
+            void add(CollectionID cid, int64_t delta);
+            size_t get(CollectionID cid) const;
+            void reset();
+
+        private:
+            static constexpr size_t Slots = 64;
+            static constexpr CollectionIDType Unused =
+                    std::numeric_limits<CollectionIDType>::max();
+            struct Slot {
+                std::atomic<CollectionIDType> cid{Unused};
+                std::atomic<int64_t> memSize{0};
+            };
+            std::array<Slot, Slots> slots;
+            std::atomic<int64_t> overflow{0};
+        };
+
+        /**
+         * The counts are updated by every HashTable mutation, from all of the
+         * front-end threads writing to the vBucket. By default they are a
+         * single shared set of atomics. With ht_per_core_stats each core
+         * instead updates its own (cacheline padded) copy, so the cachelines
+         * don't bounce between cores, and reads sum the copies of all cores.
+         * An item may then be counted on one core and uncounted on another,
+         * so a single core's count may be negative; only the sum is
+         * meaningful.
+         */
+        struct CoreCounts {
+            CoreCounts();
 
-        /// Count of alive, non-resident items.
-        cb::NonNegativeCounter<size_t> numNonResidentItems;
+            /// Count of alive & deleted, in-memory non-resident and resident
+            /// items. Excludes temporary and prepared items.
+            cb::RelaxedAtomic<int64_t> numItems;
 
-        /// Count of deleted items.
-        cb::NonNegativeCounter<size_t> numDeletedItems;
+            /// Count of alive, non-resident items.
+            cb::RelaxedAtomic<int64_t> numNonResidentItems;
 
-        /// Count of items where StoredValue::isTempItem() is true.
-        cb::NonNegativeCounter<size_t> numTempItems;
+            /// Count of deleted items.
+            cb::RelaxedAtomic<int64_t> numDeletedItems;
 
-        /// Count of items where StoredValue resides in system namespace
-        cb::NonNegativeCounter<size_t> numSystemItems;
+            /// Count of items where StoredValue::isTempItem() is true.
+            cb::RelaxedAtomic<int64_t> numTempItems;
 
-        /// Count of items where StoredValue is a prepared SyncWrite.
-        cb::NonNegativeCounter<size_t> numPreparedSyncWrites;
+            /// Count of items where StoredValue resides in system namespace
+            cb::RelaxedAtomic<int64_t> numSystemItems;
 
-        /**
-         * Number of documents of a given datatype. Includes alive
-         * (non-deleted), committed documents in the HashTable.
-         * (Prepared documents are not counted).
-         * For value eviction includes resident & non-resident items (as the
-         * datatype is part of the metadata), for full-eviction will only
-         * include resident items.
-         */
-        DatatypeCombo datatypeCounts = {};
+            /// Count of items where StoredValue is a prepared SyncWrite.
+            cb::RelaxedAtomic<int64_t> numPreparedSyncWrites;
+
+            /**
+             * Number of documents of a given datatype. Includes alive
+             * (non-deleted), committed documents in the HashTable.
+             * (Prepared documents are not counted).
+             * For value eviction includes resident & non-resident items (as
+             * the datatype is part of the metadata), for full-eviction will
+             * only include resident items.
+             */
+            std::array<cb::RelaxedAtomic<int64_t>, mcbp::datatype::highest + 1>
+                    datatypeCounts;
 
-        //! Cache size (fixed-length fields in StoredValue + keylen + valuelen).
-        std::atomic<size_t> cacheSize = {};
+            //! Cache size (fixed-length fields in StoredValue + keylen +
+            //! valuelen).
+            cb::RelaxedAtomic<int64_t> cacheSize;
 
-        //! Meta-data size (fixed-length fields in StoredValue + keylen).
-        std::atomic<size_t> metaDataMemory = {};
+            //! Meta-data size (fixed-length fields in StoredValue + keylen).
+            cb::RelaxedAtomic<int64_t> metaDataMemory;
 
-        //! Memory consumed by items in this hashtable.
-        std::atomic<size_t> memSize = {};
+            //! Memory consumed by items in this hashtable.
+            cb::RelaxedAtomic<int64_t> memSize;
 
-        /// Memory consumed if the items were uncompressed.
-        std::atomic<size_t> uncompressedMemSize = {};
+            /// Memory consumed if the items were uncompressed.
+            cb::RelaxedAtomic<int64_t> uncompressedMemSize;
+        };
+
+        /// @return the counts to update from the calling thread.
+        CoreCounts& localCounts() {
+            return coreCounts ? *coreCounts->get() : sharedCounts;
+        }
+
+        /// @return the sum of the given count over all cores.
+        size_t sum(cb::RelaxedAtomic<int64_t> CoreCounts::*count) const;
+
+        /**
+         * @return the given summed count as a size_t. The shared counts are
+         * exact, so a negative count there is an accounting error (reported
+         * in development builds, as cb::NonNegativeCounter would have done);
+         * per-core sums may be transiently negative and clamp at zero.
+         */
+        size_t checkedCount(int64_t count) const;
+
+        CoreCounts sharedCounts;
+        std::unique_ptr<CoreStore<folly::CachelinePadded<CoreCounts>>>
+                coreCounts;
+
+        /// Memory consumed by items in this hashtable, per collection.
+        CollectionMemSize collectionMemSize;
 
         EPStats& epStats;
     };
@@ -390,11 +510,24 @@ public:
             : bucketNum(-1) {}
 
         HashBucketLock(int bucketNum, std::mutex& mutex)
-            : bucketNum(bucketNum), htLock(mutex) {
+            : bucketNum(bucketNum),
+              sample(LockProfileSample::begin<std::unique_lock<std::mutex>>(
+                      LockProfiler::Site::HashTable, mutex)),
+              htLock(mutex) {
+            sample.acquired();
         }
 
         HashBucketLock(HashBucketLock&& other)
-            : bucketNum(other.bucketNum), htLock(std::move(other.htLock)) {
+            : bucketNum(other.bucketNum),
+              sample(std::move(other.sample)),
+              htLock(std::move(other.htLock)) {
+        }
+
+        ~HashBucketLock() {
+            // Only a lock released by us has a meaningful hold time.
+            if (htLock.owns_lock()) {
+                sample.released();
+            }
         }
 
         // Cannot copy HashBucketLock.
@@ -402,7 +535,11 @@ public:
         HashBucketLock& operator=(const HashBucketLock& other) = delete;
 
         HashBucketLock& operator=(HashBucketLock&& other) {
+            if (htLock.owns_lock()) {
+                sample.released();
+            }
             bucketNum = other.bucketNum;
+            sample = std::move(other.sample);
             htLock = std::move(other.htLock);
             return *this;
         }
@@ -421,6 +558,7 @@ public:
 
     private:
         int bucketNum;
+        LockProfileSample sample;
         std::unique_lock<std::mutex> htLock;
     };
 
@@ -431,18 +569,118 @@ public:
      * @param svFactory Factory to use for constructing stored values
      * @param initialSize the number of hash table buckets to initially create.
      * @param locks the number of locks in the hash table
+     * @param layout how StoredValues are located within each bucket
+     * @param hugePages how bucket arrays of at least one huge page should
+     *        be allocated
      */
     HashTable(EPStats& st,
               std::unique_ptr<AbstractStoredValueFactory> svFactory,
               size_t initialSize,
-              size_t locks);
+              size_t locks,
+              BucketLayout layout = BucketLayout::Chained,
+              cb::HugePageMode hugePages = cb::HugePageMode::None,
+              bool perCoreStats = false);
 
     ~HashTable();
 
     size_t memorySize() {
         return sizeof(HashTable)
-            + (size * sizeof(StoredValue*))
-            + (mutexes.size() * sizeof(std::mutex));
+            + ((size + resizeMigration.oldSize) * sizeof(StoredValue*))
+            + (mutexes.size() * sizeof(StripedMutexes::value_type))
+            + tagIndex.memorySize()
+            + valueStats.memorySize();
+    }
+
+    /**
+     * Enable the KeyDirectory; from now on Committed documents ejected
+     * under full eviction are recorded in it (until they are added back to
+     * the HashTable).
+     */
+    void enableKeyDirectory();
+
+    /// @return true if the KeyDirectory is enabled
+    bool isKeyDirectoryEnabled() const {
+        return keyDirectory != nullptr;
+    }
+
+    /**
+     * Look up an evicted key in the KeyDirectory.
+     *
+     * @return the bySeqno of the evicted document, or an uninitialized
+     *         optional if the key isn't in the directory (or the directory
+     *         isn't enabled)
+     */
+    boost::optional<int64_t> findInKeyDirectory(const DocKey& key) const {
+        if (!keyDirectory) {
+            return {};
+        }
+        return keyDirectory->find(key);
+    }
+
+    /// Remove all keys from the KeyDirectory (e.g. on rollback)
+    void clearKeyDirectory();
+
+    /// @return the number of keys in the KeyDirectory
+    size_t getKeyDirectorySize() const {
+        return keyDirectory ? keyDirectory->size() : 0;
+    }
+
+    /// @return the memory used by the KeyDirectory
+    size_t getKeyDirectoryMemory() const {
+        return keyDirectory ? keyDirectory->memorySize() : 0;
+    }
+
+    /**
+     * Enable the NegativeLookupCache; keys a background fetch found don't
+     * exist can then be recorded in it (until a StoredValue for the key is
+     * added to the HashTable) instead of being kept as temp items.
+     *
+     * @param capacity the number of keys the cache can hold
+     */
+    void enableNegativeLookupCache(size_t capacity);
+
+    /// @return true if the NegativeLookupCache is enabled
+    bool isNegativeLookupCacheEnabled() const {
+        return negativeLookupCache != nullptr;
+    }
+
+    /**
+     * Record that the given key doesn't exist (on disk or in the HashTable).
+     * Caller must hold the HashBucketLock for the key, and have checked
+     * that the cache is enabled.
+     */
+    void recordNonExistent(const DocKey& key) {
+        negativeLookupCache->insert(key);
+    }
+
+    /**
+     * @return true if the given key is recorded in the NegativeLookupCache
+     *         as not existing. Only valid while the caller holds the
+     *         HashBucketLock for the key (and found no StoredValue for it).
+     */
+    bool isKnownNonExistent(const DocKey& key) const {
+        return negativeLookupCache && negativeLookupCache->contains(key);
+    }
+
+    /// Remove all keys from the NegativeLookupCache (e.g. on rollback)
+    void clearNegativeLookupCache() {
+        if (negativeLookupCache) {
+            negativeLookupCache->clear();
+        }
+    }
+
+    /// @return the number of keys in the NegativeLookupCache
+    size_t getNegativeLookupCacheSize() const {
+        return negativeLookupCache ? negativeLookupCache->size() : 0;
+    }
+
+    BucketLayout getBucketLayout() const {
+        return bucketLayout;
+    }
+
+    /// @return the memory used by bucket arrays backed by huge pages
+    size_t getHugePageMemory() const {
+        return values.get_allocator().getHugePageBytes();
     }
 
     /**
@@ -559,6 +797,13 @@ public:
         return valueStats.getUncompressedMemSize();
     }
 
+    /**
+     * Get the item memory size of the given collection in this hash table.
+     */
+    size_t getCollectionItemMemory(CollectionID cid) const {
+        return valueStats.getCollectionMemSize(cid);
+    }
+
     /**
      * Clear the hash table.
      *
@@ -566,6 +811,19 @@ public:
      */
     void clear(bool deactivate = false);
 
+    /**
+     * Release the StoredValues in the buckets guarded by the given lock,
+     * including the old buckets of an in-progress resize, updating the
+     * statistics and the tag index as clear() does. Used to tear down a hash
+     * table in steps when a bucket or vBucket is deleted, so the freeing can
+     * be throttled. The first call deactivates the table (and clears the
+     * KeyDirectory and NegativeLookupCache): lookups throw from then on.
+     *
+     * @param lock the index of the lock (less than getNumLocks())
+     * @return the number of StoredValues released
+     */
+    size_t clearStripe(size_t lock);
+
     /**
      * Get the number of times this hash table has been resized.
      */
@@ -589,9 +847,68 @@ public:
 
     /**
      * Resize to the specified size.
+     *
+     * If an incremental resize is in progress it is completed first.
      */
     void resize(size_t to);
 
+    /**
+     * Automatically resize to fit the current data, using an incremental
+     * resize where possible (see beginIncrementalResize()).
+     *
+     * If the current size is not a multiple of the number of locks then the
+     * table is resized (blocking) to the nearest such size instead; later
+     * resizes can then be incremental.
+     *
+     * Returns once the resize (if any) has completed; locks are only held for
+     * one step (at most bucketsPerStep buckets) at a time.
+     *
+     * @param bucketsPerStep Maximum number of old buckets to migrate per step.
+     */
+    void resizeIncremental(size_t bucketsPerStep);
+
+    /**
+     * Begin an incremental resize to the specified size.
+     *
+     * Allocates the new bucket array and switches all new inserts to it;
+     * existing items are migrated by subsequent calls to
+     * continueIncrementalResize(), or when their key is next locked.
+     *
+     * @return true if the resize was started; false if it could not be (a
+     *         resize is already in progress, visitors are running, the size
+     *         is unchanged, or either size is not a multiple of the number
+     *         of locks).
+     */
+    bool beginIncrementalResize(size_t newSize);
+
+    /**
+     * Perform one step of an in-progress incremental resize, migrating at
+     * most maxBuckets buckets of the old bucket array.
+     *
+     * @return true if the incremental resize is still in progress.
+     */
+    bool continueIncrementalResize(size_t maxBuckets);
+
+    /// @return true if an incremental resize is in progress.
+    bool isResizeInProgress() const {
+        return resizeMigration.oldSize != 0;
+    }
+
+    /// @return Number of old buckets still to be migrated by the current
+    ///         incremental resize (zero if none in progress).
+    size_t getResizeBucketsRemaining() const {
+        return resizeMigration.bucketsRemaining;
+    }
+
+    /**
+     * @return The longest duration any single resize step has held
+     *         HashTable locks for (an entire blocking resize counts as one
+     *         step).
+     */
+    std::chrono::microseconds getMaxResizeStepDuration() const {
+        return std::chrono::microseconds(maxResizeStepUs.load());
+    }
+
     /**
      * Result of the findForRead() method.
      */
@@ -1093,6 +1410,29 @@ public:
         return getLockedBucketForHash(key.hash());
     }
 
+    /**
+     * Compute the hash (as per DocKey::hash()) of each of the given keys.
+     *
+     * The hash of a single key is a serial dependency chain over its bytes;
+     * computing several keys' hashes in lockstep lets those chains execute
+     * in parallel, so a batch of keys is hashed faster than by calling
+     * DocKey::hash() on each in turn.
+     *
+     * @param keys Keys to hash
+     * @return hashes, in the same order as keys.
+     */
+    static std::vector<uint32_t> hashKeys(const std::vector<DocKey>& keys);
+
+    /**
+     * Issue prefetches for the hash buckets (and, for the Tagged layout, the
+     * tag Groups) of a batch of keys which are about to be looked up - e.g.
+     * the keys of a completed multi-key background fetch - so the cache
+     * misses of the subsequent lookups overlap instead of being serialised.
+     *
+     * @param hashes Hashes of the keys, as returned by hashKeys().
+     */
+    void prefetchBuckets(const std::vector<uint32_t>& hashes);
+
     /**
      * Erase an item from the HashTable.
      * Item will be removed from the HashTable and deleted.
@@ -1107,6 +1447,25 @@ public:
      */
     void visit(HashTableVisitor &visitor);
 
+    /**
+     * Visit a random sample of the items within this hashtable: the items
+     * of randomly chosen hash buckets, until the given number of items have
+     * been visited (or until 4 times that many buckets have been tried, so a
+     * sparse table isn't searched indefinitely).
+     *
+     * A bucket may be chosen more than once, so an item may be visited more
+     * than once. Items which are still to be migrated by an incremental
+     * resize aren't sampled.
+     *
+     * @param visitor The visitor object to use.
+     * @param samples The number of items to visit.
+     * @param seed Seed for the choice of buckets.
+     * @return The number of items visited.
+     */
+    size_t visitSample(HashTableVisitor& visitor,
+                       size_t samples,
+                       uint64_t seed);
+
     /**
      * Visit all items within this call with a depth visitor.
      */
@@ -1270,7 +1629,9 @@ public:
 
 private:
     // The container for actually holding the StoredValues.
-    using table_type = std::vector<StoredValue::UniquePtr>;
+    using table_type =
+            std::vector<StoredValue::UniquePtr,
+                        HugePageAllocator<StoredValue::UniquePtr>>;
 
     friend class StoredValue;
     friend std::ostream& operator<<(std::ostream& os, const HashTable& ht);
@@ -1285,7 +1646,7 @@ private:
      * @return HashBucektLock which contains a lock and the hash bucket number
      */
     inline HashBucketLock getLockedBucket(int bucket) {
-        return HashBucketLock(bucket, mutexes[mutexForBucket(bucket)]);
+        return HashBucketLock(bucket, *mutexes[mutexForBucket(bucket)]);
     }
 
     /**
@@ -1303,8 +1664,15 @@ private:
                         "Cannot call on a non-active object");
             }
             int bucket = getBucketForHash(h);
-            HashBucketLock rv(bucket, mutexes[mutexForBucket(bucket)]);
+            HashBucketLock rv(bucket, *mutexes[mutexForBucket(bucket)]);
             if (bucket == getBucketForHash(h)) {
+                if (isResizeInProgress()) {
+                    // Ensure any item with this hash has been migrated from
+                    // the old bucket array; so callers only need to consider
+                    // `values`. The old bucket is guarded by the same lock.
+                    migrateOldBucket_UNLOCKED(
+                            abs(h % static_cast<int>(resizeMigration.oldSize)));
+                }
                 return rv;
             }
         }
@@ -1349,15 +1717,84 @@ private:
      */
     FindInnerResult findInner(const DocKey& key);
 
+    /**
+     * Record v (which has just been linked into bucket) in the tag index, if
+     * the index is in use.
+     */
+    void indexLinked(size_t bucket, StoredValue& v) {
+        if (tagIndex.isEnabled()) {
+            tagIndex.insert(bucket, v.getKey().hash(), &v);
+        }
+    }
+
+    /**
+     * Remove v (which has just been unlinked from bucket) from the tag index,
+     * if the index is in use.
+     */
+    void indexUnlinked(size_t bucket, const StoredValue* v) {
+        if (tagIndex.isEnabled()) {
+            tagIndex.remove(bucket, v, values[bucket].get().get());
+        }
+    }
+
+    /// Create the allocator used for the bucket arrays
+    static table_type::allocator_type makeAllocator(EPStats& st,
+                                                    cb::HugePageMode mode);
+
+    /**
+     * Calculate the size the HashTable should be resized to for the current
+     * number of items, where all candidate sizes are rounded up to a multiple
+     * of alignment.
+     */
+    size_t getPreferredSize(size_t alignment) const;
+
+    /**
+     * Move every StoredValue in the given bucket of the old (pre-resize)
+     * bucket array into `values`. Caller must hold the lock for the bucket.
+     */
+    void migrateOldBucket_UNLOCKED(size_t oldBucket);
+
+    /**
+     * Migrate up to maxBuckets of the old buckets guarded by the given lock
+     * (which the caller must hold).
+     * @return the number of old buckets processed.
+     */
+    size_t migrateStripe_UNLOCKED(size_t lock, size_t maxBuckets);
+
+    /// Implementation of continueIncrementalResize; resizeMutex must be held.
+    bool continueIncrementalResize_UNLOCKED(size_t maxBuckets);
+
+    /// Record the duration of a resize step which started at `start`.
+    void recordResizeStep(std::chrono::steady_clock::time_point start);
+
+    /**
+     * Unlink the given StoredValue from the bucket chain it resides in
+     * (normally values[bucket], but during an incremental resize possibly the
+     * old bucket array), keeping the tag index in step.
+     * @return the unlinked StoredValue, or nullptr if it was not found.
+     */
+    StoredValue::UniquePtr unlinkStoredValue(int bucket, const StoredValue* sv);
+
     // The initial (and minimum) size of the HashTable.
     const size_t initialSize;
 
+    const BucketLayout bucketLayout;
+
     // The size of the hash table (number of buckets) - i.e. number of elements
     // in `values`
     std::atomic<size_t> size;
     table_type values;
+    // Tag groups for each element of `values`; only allocated for
+    // BucketLayout::Tagged.
+    HashTableTagIndex tagIndex;
+    // Directory of the keys ejected under full eviction; only allocated if
+    // enabled (see enableKeyDirectory()).
+    std::unique_ptr<KeyDirectory> keyDirectory;
+    // Keys known not to exist; only allocated if enabled (see
+    // enableNegativeLookupCache()).
+    std::unique_ptr<NegativeLookupCache> negativeLookupCache;
     // Mutable so that we can make dumpStoredValuesAsJson const
-    mutable std::vector<std::mutex> mutexes;
+    mutable StripedMutexes mutexes;
     EPStats&             stats;
     std::unique_ptr<AbstractStoredValueFactory> valFact;
     std::atomic<size_t>       visitors;
@@ -1367,6 +1804,32 @@ private:
     std::atomic<size_t> numEjects;
     std::atomic<size_t>       numResizes;
 
+    /**
+     * State of an in-progress incremental resize. oldValues / oldSize are
+     * only modified with all locks held; the contents of each old bucket (and
+     * the per-lock cursor) are guarded by that bucket's lock.
+     */
+    struct ResizeMigration {
+        // The previous bucket array, being drained into `values`.
+        table_type oldValues;
+        // Size of oldValues; zero if no incremental resize is in progress.
+        std::atomic<size_t> oldSize{0};
+        // For each lock, the next old bucket guarded by it to be migrated.
+        std::vector<size_t> nextOldBucket;
+        // The lock whose buckets are currently being migrated by
+        // continueIncrementalResize(). Guarded by resizeMutex.
+        size_t nextLock = 0;
+        // Number of old buckets not yet processed.
+        std::atomic<size_t> bucketsRemaining{0};
+    } resizeMigration;
+
+    // Serialises resize operations (blocking and incremental) against each
+    // other. Acquired before any of the `mutexes`.
+    std::mutex resizeMutex;
+
+    // Longest time (in microseconds) locks were held by one resize step.
+    std::atomic<uint64_t> maxResizeStepUs{0};
+
     std::atomic<uint64_t> maxDeletedRevSeqno;
     bool                 activeState;
 
@@ -0,0 +1,153 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "hash_table_tag_index.h"
+
+#include "stored-value.h"
+
+#include <folly/Memory.h>
+#include <folly/lang/Bits.h>
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+constexpr uint8_t HashTableTagIndex::EmptyTag;
+constexpr size_t HashTableTagIndex::Group::Slots;
+
+uint32_t HashTableTagIndex::Group::match(uint8_t tag) const {
+    // The tags (plus the overflow byte) occupy the first 8 bytes of the
+    // Group; compare all of them against the requested tag at once and
+    // discard the result for the overflow byte.
+    constexpr uint32_t slotMask = (1u << Slots) - 1;
+    static_assert(offsetof(Group, overflow) == Slots,
+                  "Group::match expects tags followed by overflow byte");
+#if defined(__SSE2__)
+    const auto word = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(this));
+    const auto eq = _mm_cmpeq_epi8(word, _mm_set1_epi8(char(tag)));
+    return uint32_t(_mm_movemask_epi8(eq)) & slotMask;
+#else
+    // SWAR: XOR with the broadcast tag so matching bytes become zero, then
+    // set the high bit of every zero byte (exactly; no false positives from
+    // borrows) and gather those bits into the low byte of the result.
+    constexpr uint64_t lows = 0x0101010101010101ull;
+    constexpr uint64_t highs = 0x7F7F7F7F7F7F7F7Full;
+    uint64_t word;
+    std::memcpy(&word, this, sizeof(word));
+    word = folly::Endian::little(word) ^ (lows * tag);
+    const uint64_t zeros = ~(((word & highs) + highs) | word | highs);
+    // Bit 8i (byte i) lands at bit 49 + i; no two partial products overlap.
+    return uint32_t(((zeros >> 7) * 0x0002040810204081ull) >> 49) & slotMask;
+#endif
+}
+
+int HashTableTagIndex::Group::findEmpty() const {
+    for (size_t i = 0; i < Slots; ++i) {
+        if (tags[i] == EmptyTag) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+void HashTableTagIndex::GroupDeleter::operator()(Group* ptr) const {
+    folly::aligned_free(ptr);
+}
+
+void HashTableTagIndex::reset(size_t numBuckets) {
+    groups.reset();
+    numGroups = 0;
+    if (numBuckets == 0) {
+        return;
+    }
+
+    auto* mem = folly::aligned_malloc(numBuckets * sizeof(Group),
+                                      sizeof(Group));
+    if (!mem) {
+        throw std::bad_alloc();
+    }
+    groups.reset(static_cast<Group*>(mem));
+    numGroups = numBuckets;
+    clear();
+}
+
+void HashTableTagIndex::clear() {
+    if (groups) {
+        // Group is trivial; all-zero is an empty, non-overflowed group.
+        std::memset(groups.get(), 0, numGroups * sizeof(Group));
+    }
+}
+
+void HashTableTagIndex::insert(size_t bucket, uint32_t hash, StoredValue* sv) {
+    auto& group = (*this)[bucket];
+    const int slot = group.findEmpty();
+    if (slot < 0) {
+        group.overflow = 1;
+        return;
+    }
+    group.tags[slot] = tagForHash(hash);
+    group.values[slot] = sv;
+}
+
+void HashTableTagIndex::remove(size_t bucket,
+                               const StoredValue* sv,
+                               StoredValue* chain) {
+    auto& group = (*this)[bucket];
+    for (size_t i = 0; i < Group::Slots; ++i) {
+        if (group.tags[i] != EmptyTag && group.values[i] == sv) {
+            group.tags[i] = EmptyTag;
+            group.values[i] = nullptr;
+            break;
+        }
+    }
+    if (group.overflow) {
+        // An element which didn't previously fit may now do so (or sv was
+        // one of the unindexed elements) - rebuild to restore the fast path.
+        rebuild(bucket, chain);
+    }
+}
+
+void HashTableTagIndex::replace(size_t bucket,
+                                const StoredValue* oldSv,
+                                StoredValue* newSv) {
+    auto& group = (*this)[bucket];
+    for (size_t i = 0; i < Group::Slots; ++i) {
+        if (group.tags[i] != EmptyTag && group.values[i] == oldSv) {
+            group.values[i] = newSv;
+            return;
+        }
+    }
+    // oldSv was not indexed; only legitimate if the Group had overflowed.
+    if (!group.overflow) {
+        throw std::logic_error(
+                "HashTableTagIndex::replace: StoredValue not found in "
+                "non-overflowed group");
+    }
+}
+
+void HashTableTagIndex::rebuild(size_t bucket, StoredValue* chain) {
+    auto& group = (*this)[bucket];
+    std::memset(&group, 0, sizeof(Group));
+    for (auto* v = chain; v; v = v->getNext().get().get()) {
+        insert(bucket, v->getKey().hash(), v);
+    }
+}
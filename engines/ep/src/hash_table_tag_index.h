@@ -0,0 +1,145 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+class StoredValue;
+
+/**
+ * A per-bucket lookup index for the HashTable, used when the HashTable is
+ * configured with BucketLayout::Tagged.
+ *
+ * For every hash bucket the index holds one cache-line sized Group, which
+ * records a small (1 byte) tag derived from the key hash for up to
+ * Group::Slots StoredValues in the bucket, alongside a raw pointer to each
+ * of them. A lookup first compares the tag of the requested key against all
+ * tags in the Group (touching a single cache line), and only dereferences the
+ * StoredValues whose tag matches - instead of walking the bucket chain and
+ * comparing the key of every element.
+ *
+ * The index is non-owning - ownership of StoredValues remains with the
+ * HashTable bucket chains (StoredValue::chain_next_or_replacement). As such
+ * all existing iteration (visitors, pauseResumeVisit, dumps) is unaffected;
+ * the HashTable is responsible for keeping the index in step with the chains
+ * whenever it links or unlinks a StoredValue.
+ *
+ * If a bucket chain has more elements than a Group has slots, the Group is
+ * marked as overflowed and lookups on that bucket fall back to walking the
+ * chain. When an element is later removed from an overflowed bucket the Group
+ * is rebuilt from the chain.
+ *
+ * Access to a Group must be guarded by the HashTable lock for its bucket.
+ */
+class HashTableTagIndex {
+public:
+    /// Tag value which marks an unused slot.
+    static constexpr uint8_t EmptyTag = 0;
+
+    struct Group {
+        static constexpr size_t Slots = 7;
+
+        /// Bitmask (bit N == slot N) of slots whose tag matches the given tag.
+        uint32_t match(uint8_t tag) const;
+
+        /// @return index of an empty slot, or -1 if none.
+        int findEmpty() const;
+
+        std::array<uint8_t, Slots> tags;
+        /// Non-zero if the bucket has elements which are not in the Group.
+        uint8_t overflow;
+        std::array<StoredValue*, Slots> values;
+    };
+
+    static_assert(sizeof(Group) == 64,
+                  "HashTableTagIndex::Group should occupy one cache line");
+
+    /// Derive the tag for the given key hash. Never returns EmptyTag.
+    static uint8_t tagForHash(uint32_t hash) {
+        // Use the high bits of a multiplicative mix; the low bits of the raw
+        // hash are already used to select the bucket.
+        const auto tag = uint8_t((hash * 0x9E3779B1u) >> 24);
+        return tag == EmptyTag ? 1 : tag;
+    }
+
+    HashTableTagIndex() = default;
+
+    HashTableTagIndex(const HashTableTagIndex&) = delete;
+    HashTableTagIndex& operator=(const HashTableTagIndex&) = delete;
+
+    void swap(HashTableTagIndex& other) {
+        groups.swap(other.groups);
+        std::swap(numGroups, other.numGroups);
+    }
+
+    /**
+     * (Re)allocate the index for the given number of buckets; all Groups are
+     * initially empty. A size of zero frees the index.
+     */
+    void reset(size_t numBuckets);
+
+    /// Mark all Groups as empty, keeping the current allocation.
+    void clear();
+
+    /// @return true if the index has been allocated.
+    bool isEnabled() const {
+        return numGroups != 0;
+    }
+
+    Group& operator[](size_t bucket) {
+        return groups.get()[bucket];
+    }
+
+    const Group& operator[](size_t bucket) const {
+        return groups.get()[bucket];
+    }
+
+    /// Record that sv (with the given key hash) has been linked into bucket.
+    void insert(size_t bucket, uint32_t hash, StoredValue* sv);
+
+    /**
+     * Record that sv has been unlinked from bucket.
+     *
+     * @param chain The head of the bucket chain after sv has been unlinked;
+     *        used to rebuild the Group if it had overflowed.
+     */
+    void remove(size_t bucket, const StoredValue* sv, StoredValue* chain);
+
+    /// Record that oldSv has been replaced in bucket by newSv (same key).
+    void replace(size_t bucket, const StoredValue* oldSv, StoredValue* newSv);
+
+    /// Rebuild the Group for bucket from the given bucket chain.
+    void rebuild(size_t bucket, StoredValue* chain);
+
+    /// Memory used by the index (excluding the HashTableTagIndex itself).
+    size_t memorySize() const {
+        return numGroups * sizeof(Group);
+    }
+
+private:
+    struct GroupDeleter {
+        void operator()(Group* ptr) const;
+    };
+
+    std::unique_ptr<Group, GroupDeleter> groups;
+    size_t numGroups = 0;
+};
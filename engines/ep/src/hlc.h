@@ -17,10 +17,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <chrono>
 
 #include "atomic.h"
 
+#include <folly/CachelinePadded.h>
 #include <memcached/engine_common.h>
 #include <platform/checked_snprintf.h>
 
@@ -79,16 +81,20 @@ public:
         // b) dropping 16-bits (done by nowHLC)
         // c) comparing it with the last known time (max_cas)
         // d) returning either now or max_cas + 1
-        uint64_t timeNow = getMasked48(getTime());
-        uint64_t l = maxHLC.load();
-
-        if (timeNow > l) {
-            atomic_setIfBigger(maxHLC, timeNow);
-            return timeNow;
+        // The new value is published with a single compare-exchange (only
+        // retried if another thread moved maxHLC), which also ensures
+        // concurrent callers never get the same value.
+        const uint64_t timeNow = getMasked48(getTime());
+        uint64_t l = maxHLC->load();
+        uint64_t next;
+        do {
+            next = timeNow > l ? timeNow : l + 1;
+        } while (!maxHLC->compare_exchange_weak(l, next));
+
+        if (next != timeNow) {
+            logicalClockTicks++;
         }
-        logicalClockTicks++;
-        atomic_setIfBigger(maxHLC, l + 1);
-        return l + 1;
+        return next;
     }
 
     void setMaxHLCAndTrackDrift(uint64_t hlc) {
@@ -117,15 +123,15 @@ public:
     }
 
     void setMaxHLC(uint64_t hlc) {
-        atomic_setIfBigger(maxHLC, hlc);
+        atomic_setIfBigger(*maxHLC, hlc);
     }
 
     void forceMaxHLC(uint64_t hlc) {
-        maxHLC = hlc;
+        maxHLC->store(hlc);
     }
 
     uint64_t getMaxHLC() const {
-        return maxHLC;
+        return maxHLC->load();
     }
 
     DriftStats getDriftStats() const {
@@ -172,6 +178,16 @@ public:
         epochSeqno = seqno;
     }
 
+    /**
+     * @returns how long ago (by this node's clock) the HLC value hlc was
+     *          generated, based on its physical part; zero if it is in the
+     *          future, e.g. because of clock skew or logical ticks.
+     */
+    static std::chrono::nanoseconds getAge(uint64_t hlc) {
+        const auto age = getTime() - getMasked48(hlc);
+        return std::chrono::nanoseconds(std::max(age, int64_t(0)));
+    }
+
 private:
     /*
      * Returns 48-bit of t (bottom 16-bit zero)
@@ -188,9 +204,11 @@ private:
     /*
      * maxHLC tracks the current highest time, either our own or a peer who
      * has a larger clock value. nextHLC and setMax* methods change this and can
-     * be called from different threads
+     * be called from different threads. It is written for every mutation, so
+     * it's kept on its own cacheline (away from the drift stats and the
+     * fields of the owning VBucket).
      */
-    std::atomic<uint64_t> maxHLC;
+    folly::CachelinePadded<std::atomic<uint64_t>> maxHLC;
 
     /*
      * The following are used for stats/drift tracking.
@@ -29,11 +29,26 @@
  */
 class ResizingVisitor : public CappedDurationVBucketVisitor {
 public:
-    ResizingVisitor() { }
+    /**
+     * @param incremental Should HashTables be resized incrementally?
+     * @param bucketsPerStep If incremental, the maximum number of buckets
+     *        to migrate while holding a HashTable lock.
+     */
+    ResizingVisitor(bool incremental, size_t bucketsPerStep)
+        : incremental(incremental), bucketsPerStep(bucketsPerStep) {
+    }
 
     void visitBucket(const VBucketPtr& vb) override {
-        vb->ht.resize();
+        if (incremental) {
+            vb->ht.resizeIncremental(bucketsPerStep);
+        } else {
+            vb->ht.resize();
+        }
     }
+
+private:
+    const bool incremental;
+    const size_t bucketsPerStep;
 };
 
 HashtableResizerTask::HashtableResizerTask(KVBucketIface& s, double sleepTime)
@@ -46,10 +61,13 @@ HashtableResizerTask::HashtableResizerTask(KVBucketIface& s, double sleepTime)
 
 bool HashtableResizerTask::run(void) {
     TRACE_EVENT0("ep-engine/task", "HashtableResizerTask");
-    auto pv = std::make_unique<ResizingVisitor>();
+    auto& config = engine->getConfiguration();
+    auto pv = std::make_unique<ResizingVisitor>(
+            config.getHtResizeMode() == "incremental",
+            config.getHtResizeStepBuckets());
 
-    // [per-VBucket Task] While a Hashtable is resizing no user
-    // requests can be performed (the resizing process needs to
+    // [per-VBucket Task] While a Hashtable is resizing (in blocking mode) no
+    // user requests can be performed (the resizing process needs to
     // acquire all HT locks). As such we are sensitive to the duration
     // of this task - we want to log anything which has a
     // non-negligible impact on frontend operations.
@@ -155,8 +155,10 @@ public:
     /* Snappy compress value and update datatype
      * @param force force compression regardless if it makes
      *              the value larger than the original
+     * @param maxRatio only keep the compressed value if it is at most this
+     *                 fraction of the original size (ignored if force)
      */
-    bool compressValue(bool force = false);
+    bool compressValue(bool force = false, float maxRatio = 1.0);
 
     /* Snappy uncompress value and update datatype */
     bool decompressValue();
@@ -25,9 +25,13 @@
 #include <phosphor/phosphor.h>
 
 ItemCompressorTask::ItemCompressorTask(EventuallyPersistentEngine* e,
-                                       EPStats& stats_)
+                                       EPStats& stats_,
+                                       size_t lane,
+                                       size_t numLanes)
     : GlobalTask(e, TaskId::ItemCompressorTask, 0, false),
       stats(stats_),
+      lane(lane),
+      numLanes(numLanes),
       epstore_position(engine->getKVBucket()->startPosition()) {
 }
 
@@ -39,7 +43,8 @@ bool ItemCompressorTask::run(void) {
         // starting from the beginning.
         if (!prAdapter) {
             prAdapter = std::make_unique<PauseResumeVBAdapter>(
-                    std::make_unique<ItemCompressorVisitor>());
+                    std::make_unique<ItemCompressorVisitor>(),
+                    getLaneFilter());
             epstore_position = engine->getKVBucket()->startPosition();
         }
 
@@ -68,6 +73,12 @@ bool ItemCompressorTask::run(void) {
         visitor.clearStats();
         visitor.setCompressionMode(engine->getCompressionMode());
         visitor.setMinCompressionRatio(engine->getMinCompressionRatio());
+        compressibility.setSampleInterval(
+                engine->getConfiguration().getItemCompressorSampleInterval());
+        visitor.setCollectionCompressibility(&compressibility);
+        visitor.setFreqCounterThreshold(
+                engine->getConfiguration()
+                        .getItemCompressorFreqCounterThreshold());
 
         // Do it - set off the visitor.
         epstore_position = engine->getKVBucket()->pauseResumeVisit(
@@ -77,6 +88,9 @@ bool ItemCompressorTask::run(void) {
         // Update stats
         stats.compressorNumCompressed.fetch_add(visitor.getCompressedCount());
         stats.compressorNumVisited.fetch_add(visitor.getVisitedCount());
+        stats.compressorNumSkipped.fetch_add(visitor.getSkippedCount());
+        stats.compressorNumHot.fetch_add(visitor.getHotCount());
+        stats.compressorBytesSaved.fetch_add(visitor.getBytesSaved());
 
         // Check if the visitor completed a full pass.
         bool completed =
@@ -97,7 +111,10 @@ bool ItemCompressorTask::run(void) {
                             end - start);
             ss << " Took " << duration.count() << " us."
                << " compressed " << visitor.getCompressedCount() << "/"
-               << visitor.getVisitedCount() << " visited documents."
+               << visitor.getVisitedCount() << " visited documents"
+               << " (skipped " << visitor.getSkippedCount() << ", "
+               << visitor.getHotCount() << " hot), saving "
+               << visitor.getBytesSaved() << " bytes."
                << " mem_used=" << stats.getEstimatedTotalMemoryUsed()
                << ".Sleeping for " << getSleepTime() << " seconds.";
             EP_LOG_DEBUG("{}", ss.str());
@@ -123,7 +140,11 @@ void ItemCompressorTask::stop(void) {
 }
 
 std::string ItemCompressorTask::getDescription() {
-    return "Item Compressor";
+    if (numLanes == 1) {
+        return "Item Compressor";
+    }
+    return "Item Compressor (lane " + std::to_string(lane) + "/" +
+           std::to_string(numLanes) + ")";
 }
 
 std::chrono::microseconds ItemCompressorTask::maxExpectedDuration() {
@@ -144,6 +165,18 @@ std::chrono::milliseconds ItemCompressorTask::getChunkDuration() const {
             engine->getConfiguration().getItemCompressorChunkDuration());
 }
 
+VBucketFilter ItemCompressorTask::getLaneFilter() const {
+    if (numLanes == 1) {
+        return {};
+    }
+    std::vector<Vbid> vbids;
+    const auto maxVbuckets = engine->getConfiguration().getMaxVbuckets();
+    for (size_t vbid = lane; vbid < maxVbuckets; vbid += numLanes) {
+        vbids.emplace_back(Vbid(vbid));
+    }
+    return VBucketFilter(vbids);
+}
+
 ItemCompressorVisitor& ItemCompressorTask::getItemCompressorVisitor() {
     return dynamic_cast<ItemCompressorVisitor&>(prAdapter->getHTVisitor());
 }
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "globaltask.h"
+#include "item_compressor_visitor.h"
 #include "kv_bucket_iface.h"
 
 class ItemCompressorVisitor;
@@ -25,10 +26,24 @@ class PauseResumeVBAdapter;
 
 /**
  * Task responsible for compressing items in memory.
+ *
+ * The bucket may run several of these tasks (item_compressor_concurrency),
+ * each a "lane" compressing the disjoint set of VBuckets whose id modulo the
+ * number of lanes is its lane, so that compression can use several NonIO
+ * threads. Each lane runs for at most item_compressor_chunk_duration every
+ * item_compressor_interval, bounding the CPU the compressor uses to that
+ * fraction of (concurrency) threads.
  */
 class ItemCompressorTask : public GlobalTask {
 public:
-    ItemCompressorTask(EventuallyPersistentEngine* e, EPStats& stats_);
+    /**
+     * @param lane the lane (0 to numLanes-1) of this task
+     * @param numLanes the number of item compressor tasks
+     */
+    ItemCompressorTask(EventuallyPersistentEngine* e,
+                       EPStats& stats_,
+                       size_t lane = 0,
+                       size_t numLanes = 1);
 
     bool run();
 
@@ -47,12 +62,18 @@ private:
     // being paused.
     std::chrono::milliseconds getChunkDuration() const;
 
+    /// Returns the VBuckets this task's lane compresses.
+    VBucketFilter getLaneFilter() const;
+
     /// Returns the underlying ItemCompressorVisitor instance.
     ItemCompressorVisitor& getItemCompressorVisitor();
 
     /// Reference to EP stats, used to check on mem_used.
     EPStats& stats;
 
+    const size_t lane;
+    const size_t numLanes;
+
     // Opaque marker indicating how far through the epStore we have visited.
     KVBucketIface::Position epstore_position;
 
@@ -62,4 +83,8 @@ private:
      * complete pass.
      */
     std::unique_ptr<PauseResumeVBAdapter> prAdapter;
+
+    /// The sampled compressibility of each collection's values, kept
+    /// across passes.
+    CollectionCompressibility compressibility;
 };
@@ -18,6 +18,37 @@
 #include "item_compressor_visitor.h"
 #include <platform/compress.h>
 
+// CollectionCompressibility implementation //////////////////////////
+
+bool CollectionCompressibility::shouldDeflate(CollectionID cid) {
+    if (sampleInterval == 0) {
+        return true;
+    }
+    auto& entry = collections[cid];
+    if (entry.compressedFraction >= MinCompressedFraction) {
+        return true;
+    }
+    if (++entry.skipped >= sampleInterval) {
+        entry.skipped = 0;
+        return true;
+    }
+    return false;
+}
+
+void CollectionCompressibility::recordDeflate(CollectionID cid,
+                                              bool compressed) {
+    // Exponentially weighted (1/16) moving average
+    auto& entry = collections[cid];
+    entry.compressedFraction +=
+            ((compressed ? 1.0f : 0.0f) - entry.compressedFraction) / 16;
+}
+
+bool CollectionCompressibility::isSampling(CollectionID cid) const {
+    auto iter = collections.find(cid);
+    return sampleInterval != 0 && iter != collections.end() &&
+           iter->second.compressedFraction < MinCompressedFraction;
+}
+
 // ItemCompressorVisitor implementation //////////////////////////////
 
 ItemCompressorVisitor::ItemCompressorVisitor()
@@ -40,6 +71,19 @@ bool ItemCompressorVisitor::visit(const HashTable::HashBucketLock& lh,
 
     // Check if the item can be compressed
     if (compressMode == BucketCompressionMode::Active && v.isCompressible()) {
+        if (v.getFreqCounterValue() > freqCounterThreshold) {
+            hot_count++;
+            visited_count++;
+            return progressTracker.shouldContinueVisiting(visited_count);
+        }
+
+        const auto cid = v.getKey().getCollectionID();
+        if (compressibility && !compressibility->shouldDeflate(cid)) {
+            skipped_count++;
+            visited_count++;
+            return progressTracker.shouldContinueVisiting(visited_count);
+        }
+
         cb::compression::Buffer deflated;
         if (cb::compression::deflate(cb::compression::Algorithm::Snappy,
                                      {v.getValue()->getData(), v.valuelen()},
@@ -49,7 +93,12 @@ bool ItemCompressorVisitor::visit(const HashTable::HashBucketLock& lh,
 
             // Compress the document only if the compression ratio is greater
             // than or equal to the current minium compression ratio
-            if (comp_ratio >= currentMinCompressionRatio) {
+            const bool keep = comp_ratio >= currentMinCompressionRatio;
+            if (compressibility) {
+                compressibility->recordDeflate(cid, keep);
+            }
+            if (keep) {
+                bytes_saved += v.valuelen() - deflated.size();
                 currentVb->ht.storeCompressedBuffer(deflated, v);
 
                 // If the value was compressed, increment the count of number
@@ -71,6 +120,9 @@ bool ItemCompressorVisitor::visit(const HashTable::HashBucketLock& lh,
 void ItemCompressorVisitor::clearStats() {
     compressed_count = 0;
     visited_count = 0;
+    skipped_count = 0;
+    hot_count = 0;
+    bytes_saved = 0;
 }
 
 size_t ItemCompressorVisitor::getCompressedCount() const {
@@ -81,6 +133,18 @@ size_t ItemCompressorVisitor::getVisitedCount() const {
     return visited_count;
 }
 
+size_t ItemCompressorVisitor::getSkippedCount() const {
+    return skipped_count;
+}
+
+size_t ItemCompressorVisitor::getHotCount() const {
+    return hot_count;
+}
+
+size_t ItemCompressorVisitor::getBytesSaved() const {
+    return bytes_saved;
+}
+
 void ItemCompressorVisitor::setCompressionMode(
         const BucketCompressionMode compressionMode) {
     compressMode = compressionMode;
@@ -93,3 +157,12 @@ void ItemCompressorVisitor::setCurrentVBucket(VBucket& vb) {
 void ItemCompressorVisitor::setMinCompressionRatio(float minCompressionRatio) {
     currentMinCompressionRatio = minCompressionRatio;
 }
+
+void ItemCompressorVisitor::setCollectionCompressibility(
+        CollectionCompressibility* value) {
+    compressibility = value;
+}
+
+void ItemCompressorVisitor::setFreqCounterThreshold(uint8_t threshold) {
+    freqCounterThreshold = threshold;
+}
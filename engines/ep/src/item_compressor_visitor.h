@@ -22,6 +22,67 @@
 #include "vb_visitors.h"
 #include "vbucket.h"
 
+#include <limits>
+#include <unordered_map>
+
+/**
+ * The sampled compressibility of the values of each collection, kept by
+ * the ItemCompressorTask across its passes over the bucket.
+ *
+ * Collections whose values mostly fail to compress to the bucket's minimum
+ * compression ratio (already compressed or encrypted payloads etc.) cost
+ * CPU for every attempted deflate without saving memory. Once fewer than
+ * MinCompressedFraction of a collection's recent attempts were kept only
+ * one in sampleInterval of its values are tried; those samples let the
+ * collection recover if its values become compressible again.
+ */
+class CollectionCompressibility {
+public:
+    explicit CollectionCompressibility(size_t sampleInterval = 16)
+        : sampleInterval(sampleInterval) {
+    }
+
+    /**
+     * @param cid the collection of a value to be compressed
+     * @return true if the value should be deflated, false if it should be
+     *         skipped
+     */
+    bool shouldDeflate(CollectionID cid);
+
+    /**
+     * Record the outcome of deflating a value of the collection.
+     *
+     * @param cid the collection of the value
+     * @param compressed true if the value met the minimum compression ratio
+     */
+    void recordDeflate(CollectionID cid, bool compressed);
+
+    /**
+     * @return true if the values of the collection are currently only
+     *         sampled
+     */
+    bool isSampling(CollectionID cid) const;
+
+    /// Set the interval of sampling (0 to always deflate)
+    void setSampleInterval(size_t interval) {
+        sampleInterval = interval;
+    }
+
+    /// The fraction of attempts which must be kept to try every value
+    static constexpr float MinCompressedFraction = 0.1f;
+
+private:
+    struct Entry {
+        /// Moving average of the fraction of deflated values kept
+        float compressedFraction = 1.0f;
+        /// The number of values skipped since the last sample
+        size_t skipped = 0;
+    };
+
+    std::unordered_map<CollectionID, Entry> collections;
+    size_t sampleInterval;
+};
+
 /**
  * Item Compressor visitor - visit all objects in a VBucket and compress
  * the values
@@ -41,6 +102,14 @@ public:
     // Set the minimum compression ratio
     void setMinCompressionRatio(float minCompressionRatio);
 
+    // Set the per collection compressibility to consult and update (if
+    // not set every compressible value is deflated)
+    void setCollectionCompressibility(CollectionCompressibility* value);
+
+    // Set the frequency counter above which items are considered hot and
+    // not compressed (they would only be decompressed again on each read)
+    void setFreqCounterThreshold(uint8_t threshold);
+
     // Implementation of HashTableVisitor interface:
     virtual bool visit(const HashTable::HashBucketLock& lh,
                        StoredValue& v) override;
@@ -54,6 +123,17 @@ public:
     // Returns the number of documents that have been visited.
     size_t getVisitedCount() const;
 
+    // Returns the number of documents not deflated as their collection's
+    // values are only sampled.
+    size_t getSkippedCount() const;
+
+    // Returns the number of compressible documents not deflated as they
+    // are hot.
+    size_t getHotCount() const;
+
+    // Returns the number of bytes of value saved by compressing documents.
+    size_t getBytesSaved() const;
+
     void setCurrentVBucket(VBucket& vb) override;
 
 private:
@@ -67,6 +147,12 @@ private:
     size_t compressed_count;
     // How many documents have been visited.
     size_t visited_count;
+    // How many documents were skipped by the collection sampling.
+    size_t skipped_count = 0;
+    // How many documents were skipped as hot.
+    size_t hot_count = 0;
+    // How many bytes of value compressing the documents saved.
+    size_t bytes_saved = 0;
 
     // Current compression mode of the bucket
     BucketCompressionMode compressMode;
@@ -76,4 +162,10 @@ private:
 
     // The current minimum compression ratio supported by the bucket
     float currentMinCompressionRatio;
+
+    // The sampled compressibility of the collections (may be nullptr)
+    CollectionCompressibility* compressibility = nullptr;
+
+    // Items with a frequency counter above this are not compressed
+    uint8_t freqCounterThreshold = std::numeric_limits<uint8_t>::max();
 };
@@ -21,6 +21,9 @@
 
 ItemFreqDecayerVisitor::ItemFreqDecayerVisitor(uint16_t percentage_)
     : percentage(percentage_), visitedCount(0) {
+    for (size_t ii = 0; ii < decayed.size(); ++ii) {
+        decayed[ii] = static_cast<uint8_t>(ii * (percentage * 0.01));
+    }
 }
 
 void ItemFreqDecayerVisitor::setDeadline(
@@ -30,8 +33,14 @@ void ItemFreqDecayerVisitor::setDeadline(
 
 bool ItemFreqDecayerVisitor::visit(const HashTable::HashBucketLock& lh,
                                    StoredValue& v) {
-    // age the value's frequency counter by the given percentage
-    v.setFreqCounterValue(v.getFreqCounterValue() * (percentage * 0.01));
+    // age the value's frequency counter by the given percentage. Most of
+    // the (cold) documents have already decayed to zero, so avoid writing
+    // to the StoredValue unless the counter changes.
+    const auto current = v.getFreqCounterValue();
+    const auto next = decayed[current];
+    if (next != current) {
+        v.setFreqCounterValue(next);
+    }
     visitedCount++;
 
     // See if we have done enough work for this chunk. If so
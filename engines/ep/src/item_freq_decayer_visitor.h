@@ -21,6 +21,8 @@
 #include "progress_tracker.h"
 #include "vb_visitors.h"
 
+#include <array>
+
 /**
  * Visit all documents in a hash table and reduce the frequency count of each
  * document by a given percentage.
@@ -53,6 +55,10 @@ private:
     // 100 would reset the counter to zero.
     const uint16_t percentage;
 
+    // The decayed value of each of the possible counter values, so the
+    // visit is a table lookup rather than a floating point multiply.
+    std::array<uint8_t, 256> decayed;
+
     /* Runtime state */
 
     // Estimates how far we have got, and when we should pause.
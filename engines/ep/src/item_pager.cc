@@ -19,6 +19,7 @@
 
 #include "bucket_logger.h"
 #include "checkpoint_manager.h"
+#include "collections/manager.h"
 #include "connmap.h"
 #include "dcp/dcpconnmap.h"
 #include "ep_engine.h"
@@ -32,11 +33,13 @@
 
 #include <platform/platform_time.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <limits>
 #include <list>
+#include <set>
 #include <string>
 #include <utility>
 
@@ -52,7 +55,16 @@ ItemPager::ItemPager(EventuallyPersistentEngine& e, EPStats& st)
       doEvict(false),
       sleepTime(std::chrono::milliseconds(
               e.getConfiguration().getPagerSleepTimeMs())),
-      notified(false) {
+      notified(false),
+      concurrentVisitors(e.getConfiguration().getPagerConcurrentVisitors()),
+      predictiveEviction(e.getConfiguration().isPagerPredictiveEviction()),
+      predictiveHorizon(std::chrono::milliseconds(
+              e.getConfiguration().getPagerPredictiveHorizonMs())) {
+    if (predictiveEviction) {
+        // The prediction is only as current as the last run, so check well
+        // within the horizon.
+        sleepTime = std::min(sleepTime, predictiveHorizon / 4);
+    }
     // For the hifi_mfu algorithm if a couchbase/persistent bucket we
     // want to start visiting the replica vbucket first.  However for
     // ephemeral we do not evict from replica vbuckets and therefore
@@ -78,7 +90,8 @@ bool ItemPager::run(void) {
     notified.store(false);
 
     KVBucket* kvBucket = engine.getKVBucket();
-    double current = static_cast<double>(stats.getEstimatedTotalMemoryUsed());
+    const size_t memUsed = stats.getEstimatedTotalMemoryUsed();
+    double current = static_cast<double>(memUsed);
     double upper = static_cast<double>(stats.mem_high_wat);
     double lower = static_cast<double>(stats.mem_low_wat);
 
@@ -86,16 +99,47 @@ bool ItemPager::run(void) {
         doEvict = false;
     }
 
+    // Usage to evict down to; the low watermark unless predictive eviction
+    // is heading off the high watermark.
+    double target = lower;
+    bool predicted = false;
+    if (predictiveEviction) {
+        updateAllocationRate(memUsed, std::chrono::steady_clock::now());
+        if (current <= upper && !doEvict && !wasNotified) {
+            const auto predictedTarget =
+                    getPredictiveEvictionTarget(memUsed,
+                                                stats.mem_high_wat,
+                                                stats.mem_low_wat,
+                                                allocationRate,
+                                                predictiveHorizon);
+            if (predictedTarget != 0 && current > predictedTarget) {
+                predicted = true;
+                target = static_cast<double>(predictedTarget);
+            }
+        }
+    }
+
     bool inverse = true;
-    if (((current > upper) || doEvict || wasNotified) &&
+    if (((current > upper) || doEvict || wasNotified || predicted) &&
         (*available).compare_exchange_strong(inverse, false)) {
-        if (kvBucket->getItemEvictionPolicy() == EvictionPolicy::Value) {
+        // A predictive run only needs to restore the headroom, so don't
+        // keep on running until the low watermark is reached.
+        if (kvBucket->getItemEvictionPolicy() == EvictionPolicy::Value &&
+            !predicted) {
             doEvict = true;
         }
 
         ++stats.pagerRuns;
+        if (current > upper) {
+            // Storage write buffers hold memory which can be given back
+            // without evicting anything.
+            kvBucket->releaseKVStoreWriteBufferMemory();
+        }
+        if (predicted) {
+            ++stats.pagerPredictiveRuns;
+        }
 
-        double toKill = (current - static_cast<double>(lower)) / current;
+        double toKill = (current - target) / current;
 
         EP_LOG_DEBUG("Using {} bytes of memory, paging out {} of items.",
                      stats.getEstimatedTotalMemoryUsed(),
@@ -131,33 +175,102 @@ bool ItemPager::run(void) {
 
         bool isEphemeral = (cfg.getBucketType() == "ephemeral");
 
-        auto pv = std::make_unique<PagingVisitor>(
-                *kvBucket,
-                stats,
-                toKill,
-                available,
-                ITEM_PAGER,
-                false,
-                bias,
-                filter,
-                &phase,
-                isEphemeral,
-                cfg.getItemEvictionAgePercentage(),
-                cfg.getItemEvictionFreqCounterAgeThreshold());
-
         // p99.99 is ~200ms
         const auto maxExpectedDurationForVisitorTask =
                 std::chrono::milliseconds(200);
 
-        kvBucket->visitAsync(std::move(pv),
-                             "Item pager",
-                             TaskId::ItemPagerVisitor,
-                             maxExpectedDurationForVisitorTask);
+        const auto filters = splitFilter(filter, concurrentVisitors);
+        // The run is complete (available again) once the last of its
+        // visitors completes.
+        auto running = std::make_shared<std::atomic<size_t>>(filters.size());
+        // Collections over their quota (or of low priority) are evicted
+        // from first; computed once per run and shared by its visitors.
+        std::shared_ptr<const std::unordered_set<CollectionID>> preferred =
+                std::make_shared<std::unordered_set<CollectionID>>(
+                        kvBucket->getCollectionsManager()
+                                .getEvictionPreferredCollections(*kvBucket));
+        for (const auto& visitorFilter : filters) {
+            auto pv = std::make_unique<PagingVisitor>(
+                    *kvBucket,
+                    stats,
+                    toKill,
+                    available,
+                    ITEM_PAGER,
+                    false,
+                    bias,
+                    visitorFilter,
+                    &phase,
+                    isEphemeral,
+                    cfg.getItemEvictionAgePercentage(),
+                    cfg.getItemEvictionFreqCounterAgeThreshold());
+            pv->setEvictionTarget(static_cast<size_t>(target));
+            pv->setConcurrentVisitors(running);
+            pv->setThresholdSampleSize(cfg.getItemEvictionSampleSize());
+            pv->setPreferredCollections(preferred);
+
+            kvBucket->visitAsync(std::move(pv),
+                                 "Item pager",
+                                 TaskId::ItemPagerVisitor,
+                                 maxExpectedDurationForVisitorTask);
+        }
     }
 
     return true;
 }
 
+size_t ItemPager::getPredictiveEvictionTarget(
+        size_t current,
+        size_t upper,
+        size_t lower,
+        double bytesPerSecond,
+        std::chrono::duration<double> horizon) {
+    const double headroom = bytesPerSecond * horizon.count();
+    if (bytesPerSecond <= 0 ||
+        static_cast<double>(current) + headroom <= static_cast<double>(upper)) {
+        return 0;
+    }
+    const double target = static_cast<double>(upper) - headroom;
+    return target > static_cast<double>(lower) ? static_cast<size_t>(target)
+                                               : lower;
+}
+
+std::vector<VBucketFilter> ItemPager::splitFilter(const VBucketFilter& filter,
+                                                  size_t n) {
+    if (filter.empty() || n <= 1) {
+        return {filter};
+    }
+    std::vector<std::set<Vbid>> sets(std::min(n, filter.size()));
+    size_t next = 0;
+    for (auto vbid : filter.getVBSet()) {
+        sets[next].insert(vbid);
+        next = (next + 1) % sets.size();
+    }
+    std::vector<VBucketFilter> filters;
+    for (auto& set : sets) {
+        filters.emplace_back(std::move(set));
+    }
+    return filters;
+}
+
+void ItemPager::updateAllocationRate(
+        size_t memUsed, std::chrono::steady_clock::time_point now) {
+    if (lastRateUpdate != std::chrono::steady_clock::time_point{}) {
+        const std::chrono::duration<double> elapsed = now - lastRateUpdate;
+        if (elapsed.count() <= 0) {
+            return;
+        }
+        // Only growth counts; memory freed (e.g. by eviction) says nothing
+        // about how fast new data is arriving.
+        const double growth =
+                memUsed > lastMemUsed ? double(memUsed - lastMemUsed) : 0;
+        // Weight the latest interval equally with the history, so the
+        // pager responds within a couple of runs to a change in load.
+        allocationRate = (allocationRate + growth / elapsed.count()) / 2;
+    }
+    lastMemUsed = memUsed;
+    lastRateUpdate = now;
+}
+
 void ItemPager::scheduleNow() {
     bool expected = false;
     if (notified.compare_exchange_strong(expected, true)) {
@@ -234,6 +347,17 @@ bool ExpiredItemPager::run(void) {
                 cfg.getItemEvictionAgePercentage(),
                 cfg.getItemEvictionFreqCounterAgeThreshold());
 
+        // Every exp_pager_index_full_scan_interval run visits the whole
+        // HashTable to pick up the items which isn't in the index (such as
+        // the temporary items created by bg fetches)
+        ++runs;
+        if (cfg.isExpPagerIndexEnabled() &&
+            runs % cfg.getExpPagerIndexFullScanInterval() != 0) {
+            pv->setUseExpiryIndex(true);
+        } else {
+            ++stats.expiryPagerFullScans;
+        }
+
         // p99.99 is ~50ms (same as ItemPager).
         const auto maxExpectedDurationForVisitorTask =
                 std::chrono::milliseconds(50);
@@ -17,9 +17,13 @@
 #pragma once
 
 #include "globaltask.h"
+#include "vb_filter.h"
 
 #include <memcached/types.h> // for ssize_t
 
+#include <chrono>
+#include <vector>
+
 typedef std::pair<int64_t, int64_t> row_range_t;
 
 // Forward declaration.
@@ -37,6 +41,17 @@ enum item_pager_phase {
 /**
  * Dispatcher job responsible for periodically pushing data out of
  * memory.
+ *
+ * Normally the pager evicts when memory usage is above the high watermark
+ * (or it is asked to), down to the low watermark. With
+ * pager_predictive_eviction it additionally tracks the rate at which memory
+ * usage grows, and starts evicting before the high watermark is reached if
+ * that rate would reach it within pager_predictive_horizon_ms - evicting
+ * only enough to keep that much headroom, so eviction is spread out instead
+ * of happening in bursts once writes are already being rejected.
+ *
+ * Each run's vBuckets are split between pager_concurrent_visitors
+ * PagingVisitors, which run concurrently.
  */
 class ItemPager : public GlobalTask {
 public:
@@ -73,6 +88,29 @@ public:
      */
     void scheduleNow();
 
+    /**
+     * The memory usage predictive eviction should evict down to, given the
+     * current usage and growth rate: the high watermark less the memory
+     * expected to be allocated within horizon, but no lower than the low
+     * watermark.
+     *
+     * @return the target, or 0 if the high watermark isn't predicted to be
+     *         reached within horizon.
+     */
+    static size_t getPredictiveEvictionTarget(
+            size_t current,
+            size_t upper,
+            size_t lower,
+            double bytesPerSecond,
+            std::chrono::duration<double> horizon);
+
+    /**
+     * Split the given vBuckets into (at most) n disjoint, similarly sized
+     * sets. An empty filter (all vBuckets) is not split.
+     */
+    static std::vector<VBucketFilter> splitFilter(const VBucketFilter& filter,
+                                                  size_t n);
+
 private:
     EventuallyPersistentEngine& engine;
     EPStats& stats;
@@ -92,6 +130,21 @@ private:
 
     /// atomic bool used in the task's run trigger
     std::atomic<bool> notified;
+
+    /// Update allocationRate with the memory usage at the given time.
+    void updateAllocationRate(size_t memUsed,
+                              std::chrono::steady_clock::time_point now);
+
+    /// Number of PagingVisitors each run is split between.
+    const size_t concurrentVisitors;
+
+    const bool predictiveEviction;
+    const std::chrono::duration<double> predictiveHorizon;
+
+    /// Moving average of the growth in memory usage (bytes/s).
+    double allocationRate = 0;
+    size_t lastMemUsed = 0;
+    std::chrono::steady_clock::time_point lastRateUpdate;
 };
 
 /**
@@ -134,4 +187,7 @@ private:
     EPStats                        &stats;
     double                          sleepTime;
     std::shared_ptr<std::atomic<bool>>   available;
+    /// The number of runs (used to schedule the full scans when the
+    /// expiry index is enabled)
+    size_t runs = 0;
 };
@@ -0,0 +1,159 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "key_directory.h"
+
+#include <stdexcept>
+
+/// Initial number of slots in a shard (must be a power of two)
+static const size_t InitialShardCapacity = 64;
+
+KeyDirectory::KeyDirectory(size_t shards)
+    : numShards(shards), shards(new Shard[shards]) {
+    if (shards == 0) {
+        throw std::invalid_argument(
+                "KeyDirectory::KeyDirectory: shards must be non-zero");
+    }
+}
+
+uint64_t KeyDirectory::fingerprint(const DocKey& key) {
+    // 64bit FNV-1a over the key including the collection-ID, matching the
+    // way DocKey::hash() treats keys without an encoded collection-ID.
+    uint64_t h = 0xcbf29ce484222325ull;
+    const uint64_t prime = 0x100000001b3ull;
+    if (key.getEncoding() == DocKeyEncodesCollectionId::No) {
+        h = (h ^ uint64_t(DefaultCollectionLeb128Encoded)) * prime;
+    }
+    for (auto c : cb::const_byte_buffer(key.data(), key.size())) {
+        h = (h ^ uint64_t(c)) * prime;
+    }
+    return h <= Tombstone ? Tombstone + 1 : h;
+}
+
+void KeyDirectory::rehash(Shard& shard, size_t capacity) {
+    std::vector<Slot> slots(capacity, Slot{Empty, 0});
+    const size_t mask = capacity - 1;
+    for (const auto& slot : shard.slots) {
+        if (slot.fingerprint == Empty || slot.fingerprint == Tombstone) {
+            continue;
+        }
+        size_t idx = slot.fingerprint & mask;
+        while (slots[idx].fingerprint != Empty) {
+            idx = (idx + 1) & mask;
+        }
+        slots[idx] = slot;
+    }
+    allocated += capacity * sizeof(Slot);
+    allocated -= shard.slots.size() * sizeof(Slot);
+    shard.slots.swap(slots);
+    shard.used = shard.live;
+}
+
+size_t KeyDirectory::insert(const DocKey& key, int64_t bySeqno) {
+    const auto fp = fingerprint(key);
+    auto& shard = getShard(fp);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    size_t grown = 0;
+    // Keep the load factor (including tombstones) at or below 3/4
+    if ((shard.used + 1) * 4 > shard.slots.size() * 3) {
+        const auto before = shard.slots.size();
+        size_t capacity = before ? before : InitialShardCapacity;
+        if ((shard.live + 1) * 2 > capacity) {
+            capacity *= 2;
+        }
+        rehash(shard, capacity);
+        grown = (capacity - before) * sizeof(Slot);
+    }
+
+    const size_t mask = shard.slots.size() - 1;
+    size_t idx = fp & mask;
+    Slot* reuse = nullptr;
+    while (shard.slots[idx].fingerprint != Empty) {
+        auto& slot = shard.slots[idx];
+        if (slot.fingerprint == fp) {
+            slot.bySeqno = bySeqno;
+            return grown;
+        }
+        if (slot.fingerprint == Tombstone && !reuse) {
+            reuse = &slot;
+        }
+        idx = (idx + 1) & mask;
+    }
+
+    if (!reuse) {
+        reuse = &shard.slots[idx];
+        ++shard.used;
+    }
+    *reuse = Slot{fp, bySeqno};
+    ++shard.live;
+    ++numEntries;
+    return grown;
+}
+
+void KeyDirectory::erase(const DocKey& key) {
+    const auto fp = fingerprint(key);
+    auto& shard = getShard(fp);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.live == 0) {
+        return;
+    }
+
+    const size_t mask = shard.slots.size() - 1;
+    for (size_t idx = fp & mask; shard.slots[idx].fingerprint != Empty;
+         idx = (idx + 1) & mask) {
+        if (shard.slots[idx].fingerprint == fp) {
+            shard.slots[idx].fingerprint = Tombstone;
+            --shard.live;
+            --numEntries;
+            return;
+        }
+    }
+}
+
+boost::optional<int64_t> KeyDirectory::find(const DocKey& key) const {
+    const auto fp = fingerprint(key);
+    auto& shard = getShard(fp);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.live == 0) {
+        return {};
+    }
+
+    const size_t mask = shard.slots.size() - 1;
+    for (size_t idx = fp & mask; shard.slots[idx].fingerprint != Empty;
+         idx = (idx + 1) & mask) {
+        if (shard.slots[idx].fingerprint == fp) {
+            return shard.slots[idx].bySeqno;
+        }
+    }
+    return {};
+}
+
+size_t KeyDirectory::clear() {
+    size_t released = 0;
+    for (size_t ii = 0; ii < numShards; ++ii) {
+        auto& shard = shards[ii];
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        released += shard.slots.size() * sizeof(Slot);
+        allocated -= shard.slots.size() * sizeof(Slot);
+        numEntries -= shard.live;
+        std::vector<Slot>().swap(shard.slots);
+        shard.live = 0;
+        shard.used = 0;
+    }
+    return released;
+}
@@ -0,0 +1,133 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <boost/optional/optional.hpp>
+#include <memcached/dockey.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * A compact directory of the keys which have been evicted from a
+ * full-eviction HashTable.
+ *
+ * For every evicted (alive) document the directory records a 64bit
+ * fingerprint of the key and the bySeqno of the document - 16 bytes per key
+ * (plus the load factor overhead), compared to a full StoredValue (key,
+ * metadata and the HashTable chain pointer) for value eviction. It allows
+ * existence checks for evicted keys to be answered without a bloom filter
+ * check and disk lookup.
+ *
+ * As only the fingerprint of the key is stored, two keys with the same
+ * fingerprint cannot be told apart (with a 64bit fingerprint this is
+ * vanishingly unlikely); callers must only use a hit where treating the key
+ * as existing is acceptable.
+ *
+ * The directory is split into a number of independently locked shards, each
+ * an open addressing (linear probing) table which grows as required.
+ */
+class KeyDirectory {
+public:
+    /// Default number of shards
+    static constexpr size_t DefaultShards = 16;
+
+    explicit KeyDirectory(size_t shards = DefaultShards);
+
+    KeyDirectory(const KeyDirectory&) = delete;
+    KeyDirectory& operator=(const KeyDirectory&) = delete;
+
+    /**
+     * Record (or update) the given key.
+     *
+     * @param key the key of the evicted document
+     * @param bySeqno the seqno of the evicted document
+     * @return the number of bytes the directory allocation grew by
+     */
+    size_t insert(const DocKey& key, int64_t bySeqno);
+
+    /// Remove the given key (if present)
+    void erase(const DocKey& key);
+
+    /**
+     * Look up the given key.
+     *
+     * @return the bySeqno recorded for the key, or an uninitialized optional
+     *         if the key isn't in the directory
+     */
+    boost::optional<int64_t> find(const DocKey& key) const;
+
+    /**
+     * Remove all keys and release the memory used by the shards.
+     *
+     * @return the number of bytes released
+     */
+    size_t clear();
+
+    /// @return the number of keys in the directory
+    size_t size() const {
+        return numEntries.load();
+    }
+
+    /// @return the number of bytes allocated for the directory
+    size_t memorySize() const {
+        return sizeof(KeyDirectory) + allocated.load();
+    }
+
+    /// Calculate the fingerprint of the given key (never Empty or Tombstone)
+    static uint64_t fingerprint(const DocKey& key);
+
+    /// Fingerprint value which marks an unused slot
+    static constexpr uint64_t Empty = 0;
+    /// Fingerprint value which marks a slot which used to hold a key
+    static constexpr uint64_t Tombstone = 1;
+
+private:
+    struct Slot {
+        uint64_t fingerprint;
+        int64_t bySeqno;
+    };
+
+    static_assert(sizeof(Slot) == 16, "KeyDirectory::Slot should be 16 bytes");
+
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Slot> slots;
+        /// Number of slots holding a key
+        size_t live = 0;
+        /// Number of slots holding a key or a tombstone
+        size_t used = 0;
+    };
+
+    Shard& getShard(uint64_t fp) const {
+        // The low bits select the slot within the shard
+        return shards[(fp >> 48) % numShards];
+    }
+
+    /// Rebuild the shard with the given capacity (dropping tombstones)
+    void rehash(Shard& shard, size_t capacity);
+
+    const size_t numShards;
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<size_t> numEntries{0};
+    std::atomic<size_t> allocated{0};
+};
@@ -18,16 +18,19 @@
 #include <string.h>
 #include <time.h>
 
+#include <chrono>
 #include <functional>
 #include <map>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <memcached/server_document_iface.h>
 #include <phosphor/phosphor.h>
+#include <platform/timeutils.h>
 #include <utilities/logtags.h>
 
 #include "access_scanner.h"
@@ -58,6 +61,7 @@
 #include "mutation_log.h"
 #include "replicationthrottle.h"
 #include "rollback_result.h"
+#include "slab_allocator.h"
 #include "statwriter.h"
 #include "tasks.h"
 #include "trace_helpers.h"
@@ -153,6 +157,13 @@ public:
             store.setCompactionExpMemThreshold(value);
         } else if (key.compare("replication_throttle_cap_pcnt") == 0) {
             store.getEPEngine().getReplicationThrottle().setCapPercent(value);
+        } else if (key.compare("replication_throttle_target_headroom") == 0) {
+            store.getEPEngine().getReplicationThrottle().setTargetHeadroom(
+                    value);
+        } else if (key.compare("replication_throttle_min_rate") == 0) {
+            store.getEPEngine().getReplicationThrottle().setMinRate(value);
+        } else if (key.compare("replication_throttle_max_rate") == 0) {
+            store.getEPEngine().getReplicationThrottle().setMaxRate(value);
         } else if (key.compare("max_ttl") == 0) {
             store.setMaxTtl(value);
         } else {
@@ -179,6 +190,8 @@ public:
             }
         } else if (key.compare("xattr_enabled") == 0) {
             store.setXattrEnabled(value);
+        } else if (key.compare("replication_throttle_adaptive") == 0) {
+            store.getEPEngine().getReplicationThrottle().setAdaptive(value);
         }
     }
 
@@ -287,7 +300,6 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
       stats(engine.getEpStats()),
       vbMap(theEngine.getConfiguration(), *this),
       defragmenterTask(NULL),
-      itemCompressorTask(nullptr),
       itemFreqDecayerTask(nullptr),
       vb_mutexes(engine.getConfiguration().getMaxVbuckets()),
       backfillMemoryThreshold(0.95),
@@ -300,6 +312,10 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
     cachedResidentRatio.replicaRatio.store(0);
 
     Configuration &config = engine.getConfiguration();
+    if (config.isStoredValueSlabAllocator()) {
+        storedValueSlabs = SlabAllocator::create();
+    }
+
     for (uint16_t i = 0; i < config.getMaxNumShards(); i++) {
         accessLog.emplace_back(
                 config.getAlogPath() + "." + std::to_string(i),
@@ -310,11 +326,15 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
     const size_t size = GlobalTask::allTaskIds.size();
     stats.schedulingHisto.resize(size);
     stats.taskRuntimeHisto.resize(size);
+    stats.taskRuntimeWindow.resize(size);
 
     for (size_t i = 0; i < GlobalTask::allTaskIds.size(); i++) {
         stats.schedulingHisto[i].reset();
         stats.taskRuntimeHisto[i].reset();
     }
+    for (auto& histo : stats.readerClassSchedulingHisto) {
+        histo.reset();
+    }
 
     ExecutorPool::get()->registerTaskable(ObjectRegistry::getCurrentEngine()->getTaskable());
 
@@ -368,6 +388,18 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
     config.addValueChangedListener(
             "replication_throttle_cap_pcnt",
             std::make_unique<EPStoreValueChangeListener>(*this));
+    config.addValueChangedListener(
+            "replication_throttle_adaptive",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+    config.addValueChangedListener(
+            "replication_throttle_target_headroom",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+    config.addValueChangedListener(
+            "replication_throttle_min_rate",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+    config.addValueChangedListener(
+            "replication_throttle_max_rate",
+            std::make_unique<EPStoreValueChangeListener>(*this));
 
     stats.warmupMemUsedCap.store(static_cast<double>
                                (config.getWarmupMinMemoryThreshold()) / 100.0);
@@ -500,19 +532,76 @@ void KVBucket::deinitialize() {
                                             stats.forceShutdown);
 }
 
+void KVBucket::releaseHashTables() {
+    if (engine.getConfiguration().getBucketType() == "ephemeral") {
+        return;
+    }
+
+    const auto rate = stats.forceShutdown
+                              ? 0
+                              : engine.getConfiguration()
+                                        .getBucketDeletionFreeRate();
+    const auto start = std::chrono::steady_clock::now();
+    size_t released = 0;
+    size_t total = 0;
+    for (auto vbid : vbMap.getBuckets()) {
+        auto vb = getVBucket(vbid);
+        if (vb) {
+            total += vb->ht.getNumItems() + vb->ht.getNumTempItems();
+        }
+    }
+    EP_LOG_INFO("KVBucket::releaseHashTables: releasing {} documents{}",
+                total,
+                rate ? " at " + std::to_string(rate) + "/s" : "");
+
+    auto lastLog = start;
+    for (auto vbid : vbMap.getBuckets()) {
+        auto vb = getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        for (size_t lock = 0; lock < vb->ht.getNumLocks(); ++lock) {
+            released += vb->ht.clearStripe(lock);
+            auto now = std::chrono::steady_clock::now();
+            if (rate) {
+                // Sleep until we're back within the permitted rate
+                const auto due =
+                        start + std::chrono::microseconds(released * 1000000 /
+                                                          rate);
+                if (due > now) {
+                    std::this_thread::sleep_until(due);
+                    now = std::chrono::steady_clock::now();
+                }
+            }
+            if (now - lastLog >= std::chrono::seconds(10)) {
+                EP_LOG_INFO(
+                        "KVBucket::releaseHashTables: released {} of {} "
+                        "documents",
+                        released,
+                        total);
+                lastLog = now;
+            }
+        }
+    }
+
+    EP_LOG_INFO("KVBucket::releaseHashTables: released {} documents in {}",
+                released,
+                cb::time2text(std::chrono::steady_clock::now() - start));
+}
+
 KVBucket::~KVBucket() {
     EP_LOG_INFO("Deleting vb_mutexes");
     EP_LOG_INFO("Deleting defragmenterTask");
     defragmenterTask.reset();
-    EP_LOG_INFO("Deleting itemCompressorTask");
-    itemCompressorTask.reset();
+    EP_LOG_INFO("Deleting itemCompressorTasks");
+    itemCompressorTasks.clear();
     EP_LOG_INFO("Deleting itemFreqDecayerTask");
     itemFreqDecayerTask.reset();
     EP_LOG_INFO("Deleted KvBucket.");
 }
 
-const Flusher* KVBucket::getFlusher(uint16_t shardId) {
-    return vbMap.shards[shardId]->getFlusher();
+Flusher* KVBucket::getFlusher(Vbid vbid) {
+    return nullptr;
 }
 
 Warmup* KVBucket::getWarmup(void) const {
@@ -542,7 +631,7 @@ cb::mcbp::Status KVBucket::evictKey(const DocKey& key,
         return cb::mcbp::Status::NotMyVbucket;
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (vb->getState() != vbucket_state_active) {
         return cb::mcbp::Status::NotMyVbucket;
     }
@@ -615,7 +704,7 @@ void KVBucket::deleteExpiredItem(Item& it,
 
         // Obtain reader access to the VB state change lock so that
         // the VB can't switch state whilst we're processing
-        folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+        VBucket::StateReadLockHolder rlh(vb->getStateLock());
         if (vb->getState() == vbucket_state_active) {
             vb->deleteExpiredItem(it, startTime, source);
         }
@@ -645,12 +734,27 @@ void KVBucket::logQTime(TaskId taskType,
                         const std::chrono::steady_clock::duration enqTime) {
     auto ms = std::chrono::duration_cast<std::chrono::microseconds>(enqTime);
     stats.schedulingHisto[static_cast<int>(taskType)].add(ms);
+    if (GlobalTask::getTaskType(taskType) == READER_TASK_IDX) {
+        const auto readerClass = GlobalTask::getReaderClass(taskType);
+        stats.readerClassSchedulingHisto[size_t(readerClass)].add(ms);
+    }
 }
 
 void KVBucket::logRunTime(TaskId taskType,
                           const std::chrono::steady_clock::duration runTime) {
     auto ms = std::chrono::duration_cast<std::chrono::microseconds>(runTime);
     stats.taskRuntimeHisto[static_cast<int>(taskType)].add(ms);
+
+    const auto ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(runTime);
+    stats.taskRuntimeWindow.add(
+            static_cast<int>(taskType), ep_current_time(), ns);
+    stats.taskRuntimeNs.fetch_add(ns.count(), std::memory_order_relaxed);
+}
+
+void KVBucket::logCpuTime(TaskId taskType,
+                          const std::chrono::nanoseconds cpuTime) {
+    stats.taskCpuTimeNs.fetch_add(cpuTime.count(), std::memory_order_relaxed);
 }
 
 ENGINE_ERROR_CODE KVBucket::set(Item& itm,
@@ -664,7 +768,7 @@ ENGINE_ERROR_CODE KVBucket::set(Item& itm,
 
     // Obtain read-lock on VB state to ensure VB state changes are interlocked
     // with this set
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (vb->getState() == vbucket_state_dead) {
         ++stats.numNotMyVBuckets;
         return ENGINE_NOT_MY_VBUCKET;
@@ -717,7 +821,7 @@ ENGINE_ERROR_CODE KVBucket::add(Item &itm, const void *cookie)
 
     // Obtain read-lock on VB state to ensure VB state changes are interlocked
     // with this add
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (vb->getState() == vbucket_state_dead ||
         vb->getState() == vbucket_state_replica) {
         ++stats.numNotMyVBuckets;
@@ -773,7 +877,7 @@ ENGINE_ERROR_CODE KVBucket::replace(Item& itm,
 
     // Obtain read-lock on VB state to ensure VB state changes are interlocked
     // with this replace
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (vb->getState() == vbucket_state_dead ||
         vb->getState() == vbucket_state_replica) {
         ++stats.numNotMyVBuckets;
@@ -837,7 +941,7 @@ void KVBucket::releaseRegisteredSyncWrites() {
         if (!vb) {
             continue;
         }
-        folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+        VBucket::StateReadLockHolder rlh(vb->getStateLock());
         if (vb->getState() != vbucket_state_active) {
             continue;
         }
@@ -1426,12 +1530,26 @@ void KVBucket::completeBGFetchMulti(
         std::chrono::steady_clock::time_point startTime) {
     VBucketPtr vb = getVBucket(vbId);
     if (vb) {
+        {
+            // Warm the cache for the HashTable lookups made by each
+            // completion below.
+            std::vector<DocKey> keys;
+            keys.reserve(fetchedItems.size());
+            for (const auto& item : fetchedItems) {
+                keys.push_back(item.first.getDocKey());
+            }
+            vb->ht.prefetchBuckets(HashTable::hashKeys(keys));
+        }
         for (const auto& item : fetchedItems) {
             auto& key = item.first;
             auto* fetched_item = item.second;
             ENGINE_ERROR_CODE status = vb->completeBGFetchForSingleItem(
                     key, *fetched_item, startTime);
-            engine.notifyIOComplete(fetched_item->cookie, status);
+            // A fetch issued ahead of time (see
+            // VBucket::fetchMetaForConflictResolution) has nobody to notify
+            if (fetched_item->cookie) {
+                engine.notifyIOComplete(fetched_item->cookie, status);
+            }
         }
         EP_LOG_DEBUG(
                 "EP Store completes {} of batched background fetch "
@@ -1443,8 +1561,10 @@ void KVBucket::completeBGFetchMulti(
                         .count());
     } else {
         for (const auto& item : fetchedItems) {
-            engine.notifyIOComplete(item.second->cookie,
-                                    ENGINE_NOT_MY_VBUCKET);
+            if (item.second->cookie) {
+                engine.notifyIOComplete(item.second->cookie,
+                                        ENGINE_NOT_MY_VBUCKET);
+            }
         }
         EP_LOG_WARN(
                 "EP Store completes {} of batched background fetch for "
@@ -1468,7 +1588,7 @@ GetValue KVBucket::getInternal(const DocKey& key,
 
     const bool honorStates = (options & HONOR_STATES);
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (honorStates) {
         vbucket_state_t disallowedState =
                 (getReplicaItem == ForGetReplicaOp::Yes)
@@ -1529,7 +1649,7 @@ GetValue KVBucket::getRandomKey() {
     while (itm == NULL) {
         VBucketPtr vb = getVBucket(Vbid(curr++));
         if (vb) {
-            folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+            VBucket::StateReadLockHolder rlh(vb->getStateLock());
             if (vb->getState() == vbucket_state_active &&
                 (itm = vb->ht.getRandomKey(getRandom()))) {
                 GetValue rv(std::move(itm), ENGINE_SUCCESS);
@@ -1562,7 +1682,7 @@ ENGINE_ERROR_CODE KVBucket::getMetaData(const DocKey& key,
         return ENGINE_NOT_MY_VBUCKET;
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (vb->getState() == vbucket_state_dead ||
         vb->getState() == vbucket_state_replica) {
         ++stats.numNotMyVBuckets;
@@ -1601,7 +1721,7 @@ ENGINE_ERROR_CODE KVBucket::setWithMeta(Item& itm,
         return ENGINE_NOT_MY_VBUCKET;
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (!permittedVBStates.test(vb->getState())) {
         if (vb->getState() == vbucket_state_pending) {
             if (vb->addPendingOp(cookie)) {
@@ -1662,7 +1782,7 @@ ENGINE_ERROR_CODE KVBucket::prepare(Item& itm, const void* cookie) {
         return ENGINE_NOT_MY_VBUCKET;
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     PermittedVBStates permittedVBStates = {vbucket_state_replica,
                                            vbucket_state_pending};
     if (!permittedVBStates.test(vb->getState())) {
@@ -1716,7 +1836,7 @@ GetValue KVBucket::getAndUpdateTtl(const DocKey& key,
         return GetValue(NULL, ENGINE_NOT_MY_VBUCKET);
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (vb->getState() == vbucket_state_dead) {
         ++stats.numNotMyVBuckets;
         return GetValue(NULL, ENGINE_NOT_MY_VBUCKET);
@@ -1759,7 +1879,7 @@ GetValue KVBucket::getLocked(const DocKey& key,
         return GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (vb->getState() != vbucket_state_active) {
         ++stats.numNotMyVBuckets;
         return GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
@@ -1787,7 +1907,7 @@ ENGINE_ERROR_CODE KVBucket::unlockKey(const DocKey& key,
         return ENGINE_NOT_MY_VBUCKET;
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (vb->getState() != vbucket_state_active) {
         ++stats.numNotMyVBuckets;
         return ENGINE_NOT_MY_VBUCKET;
@@ -1848,7 +1968,7 @@ ENGINE_ERROR_CODE KVBucket::getKeyStats(const DocKey& key,
         return ENGINE_NOT_MY_VBUCKET;
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     auto cHandle = vb->lockCollections(key);
     if (!cHandle.valid()) {
         engine.setErrorJsonExtras(cookie,
@@ -1907,7 +2027,7 @@ ENGINE_ERROR_CODE KVBucket::deleteItem(
         return ENGINE_NOT_MY_VBUCKET;
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (vb->getState() == vbucket_state_dead) {
         ++stats.numNotMyVBuckets;
         return ENGINE_NOT_MY_VBUCKET;
@@ -1969,7 +2089,7 @@ ENGINE_ERROR_CODE KVBucket::deleteWithMeta(const DocKey& key,
         return ENGINE_NOT_MY_VBUCKET;
     }
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    VBucket::StateReadLockHolder rlh(vb->getStateLock());
     if (!permittedVBStates.test(vb->getState())) {
         if (vb->getState() == vbucket_state_pending) {
             if (vb->addPendingOp(cookie)) {
@@ -2228,8 +2348,12 @@ void KVBucket::resetAccessScannerStartTime() {
 }
 
 void KVBucket::enableItemCompressor() {
-    itemCompressorTask = std::make_shared<ItemCompressorTask>(&engine, stats);
-    ExecutorPool::get()->schedule(itemCompressorTask);
+    const auto lanes = engine.getConfiguration().getItemCompressorConcurrency();
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        itemCompressorTasks.emplace_back(std::make_shared<ItemCompressorTask>(
+                &engine, stats, lane, lanes));
+        ExecutorPool::get()->schedule(itemCompressorTasks.back());
+    }
 }
 
 void KVBucket::setAllBloomFilters(bool to) {
@@ -2345,6 +2469,10 @@ void KVBucket::resetUnderlyingStats(void)
         stats.schedulingHisto[i].reset();
         stats.taskRuntimeHisto[i].reset();
     }
+    for (auto& histo : stats.readerClassSchedulingHisto) {
+        histo.reset();
+    }
+    stats.taskRuntimeWindow.reset();
 }
 
 void KVBucket::addKVStoreStats(const AddStatFn& add_stat,
@@ -2432,6 +2560,11 @@ TaskStatus KVBucket::rollback(Vbid vbid, uint64_t rollbackSeqno) {
                 static_cast<uint64_t>(vb->checkpointManager->getHighSeqno());
         if (rollbackSeqno != 0) {
             RollbackResult result = doRollback(vbid, rollbackSeqno);
+            // The evicted keys recorded in the KeyDirectory may no longer
+            // exist (or have a different seqno) on disk
+            vb->ht.clearKeyDirectory();
+            // Likewise keys recorded as missing may exist again
+            vb->ht.clearNegativeLookupCache();
 
             if (result.success /* not success hence reset vbucket to
                                   avoid data loss */
@@ -2545,11 +2678,11 @@ std::ostream& operator<<(std::ostream& os, const KVBucket::Position& pos) {
 }
 
 void KVBucket::notifyFlusher(const Vbid vbid) {
-    KVShard* shard = vbMap.getShardByVbId(vbid);
-    if (shard) {
-        shard->getFlusher()->notifyFlushEvent();
+    auto* flusher = getFlusher(vbid);
+    if (flusher) {
+        flusher->notifyFlushEvent();
     } else {
-        throw std::logic_error("KVBucket::notifyFlusher() : shard null for " +
+        throw std::logic_error("KVBucket::notifyFlusher() : flusher null for " +
                                vbid.to_string());
     }
 }
@@ -2638,6 +2771,14 @@ SyncWriteResolvedCallback KVBucket::makeSyncWriteResolvedCB() {
     };
 }
 
+SyncWriteTimeoutCallback KVBucket::makeSyncWriteTimeoutCB() {
+    return [this](Vbid vbid, std::chrono::steady_clock::time_point deadline) {
+        if (this->durabilityTimeoutTask) {
+            this->durabilityTimeoutTask->scheduleTimeout(vbid, deadline);
+        }
+    };
+}
+
 SyncWriteCompleteCallback KVBucket::makeSyncWriteCompleteCB() {
     auto& engine = this->engine;
     return [&engine](const void* cookie, ENGINE_ERROR_CODE status) {
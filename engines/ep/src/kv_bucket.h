@@ -28,7 +28,9 @@
 #include <deque>
 
 class DurabilityCompletionTask;
+class DurabilityTimeoutTask;
 class ReplicationThrottle;
+class SlabAllocator;
 class VBucketCountVisitor;
 namespace Collections {
 class Manager;
@@ -110,6 +112,19 @@ public:
 
     void deinitialize() override;
 
+    /**
+     * Release the documents held in memory by the vBuckets ahead of the
+     * bucket being destroyed. The hash tables are cleared one lock stripe at
+     * a time, limited to bucket_deletion_free_rate documents per second
+     * (unless the shutdown is forced), so the deletion of a large bucket
+     * doesn't monopolise the memory allocator. Must be called after
+     * deinitialize(), once no other thread accesses the vBuckets.
+     *
+     * Ephemeral vBuckets are left alone; their sequence list references
+     * the StoredValues and is torn down with the vBucket.
+     */
+    void releaseHashTables();
+
     ENGINE_ERROR_CODE set(Item& item,
                           const void* cookie,
                           cb::StoreIfPredicate predicate = {}) override;
@@ -263,6 +278,17 @@ public:
         return mem;
     }
 
+    /**
+     * Ask every KVStore to release the memory it holds buffering writes;
+     * called when the bucket is over its high watermark.
+     */
+    void releaseKVStoreWriteBufferMemory() {
+        for (auto& shard : vbMap.shards) {
+            shard->forEachKVStore(
+                    [](KVStore* store) { store->releaseWriteBufferMemory(); });
+        }
+    }
+
     std::pair<uint64_t, bool> getLastPersistedCheckpointId(Vbid vb) override {
         // No persistence at the KVBucket class level.
         return {0, false};
@@ -363,7 +389,7 @@ public:
 
     Position endPosition() const override;
 
-    const Flusher* getFlusher(uint16_t shardId) override;
+    Flusher* getFlusher(Vbid vbid) override;
 
     Warmup* getWarmup() const override;
 
@@ -505,6 +531,9 @@ public:
     void logRunTime(TaskId taskType,
                     const std::chrono::steady_clock::duration runTime) override;
 
+    void logCpuTime(TaskId taskType,
+                    const std::chrono::nanoseconds cpuTime) override;
+
     void updateCachedResidentRatio(size_t activePerc, size_t replicaPerc) override {
         cachedResidentRatio.activeRatio.store(activePerc);
         cachedResidentRatio.replicaRatio.store(replicaPerc);
@@ -661,6 +690,11 @@ public:
     /// set the buckets maxTtl
     void setMaxTtl(size_t max);
 
+    /// @return the allocator StoredValues are allocated from, if any.
+    const SlabAllocator* getStoredValueSlabAllocator() const {
+        return storedValueSlabs.get();
+    }
+
 protected:
     GetValue getInternal(const DocKey& key,
                          Vbid vbucket,
@@ -710,6 +744,13 @@ protected:
      */
     SyncWriteResolvedCallback makeSyncWriteResolvedCB();
 
+    /**
+     * Returns the callback function to be invoked when the earliest timeout
+     * deadline of the SyncWrites tracked by a vBucket changes. Used by
+     * makeVBucket().
+     */
+    SyncWriteTimeoutCallback makeSyncWriteTimeoutCB();
+
     /**
      * Returns the callback function to be invoked when a SyncWrite has been
      * completed. Used by makeVBucket().
@@ -732,7 +773,8 @@ protected:
     ExTask                          chkTask;
     float                           bfilterResidencyThreshold;
     ExTask                          defragmenterTask;
-    ExTask itemCompressorTask;
+    // One task per item_compressor_concurrency lane.
+    std::vector<ExTask> itemCompressorTasks;
     // The itemFreqDecayerTask is used to decay the frequency count of items
     // stored in the hash table.  This is required to ensure that all the
     // frequency counts do not become saturated.
@@ -742,7 +784,7 @@ protected:
 
     // Responsible for enforcing the Durability Timeout for the SyncWrites
     // tracked in this KVBucket.
-    ExTask durabilityTimeoutTask;
+    std::shared_ptr<DurabilityTimeoutTask> durabilityTimeoutTask;
 
     /// Responsible for completing (commiting or aborting SyncWrites which have
     /// completed in this KVBucket.
@@ -800,6 +842,12 @@ protected:
 
     std::atomic<size_t> maxTtl;
 
+    /**
+     * Shared by the HashTables of all vBuckets, if stored_value_slab_allocator
+     * is set.
+     */
+    std::shared_ptr<SlabAllocator> storedValueSlabs;
+
     /**
      * Allows us to override the random function.  This is used for testing
      * purposes where we want a constant number as opposed to a random one.
@@ -527,7 +527,9 @@ public:
      */
     virtual Position endPosition() const = 0;
 
-    virtual const Flusher* getFlusher(uint16_t shardId) = 0;
+    /// @return the Flusher persisting the given vBucket (nullptr if the
+    ///         bucket isn't persistent)
+    virtual Flusher* getFlusher(Vbid vbid) = 0;
 
     virtual Warmup* getWarmup(void) const = 0;
 
@@ -633,6 +635,9 @@ public:
             TaskId taskType,
             const std::chrono::steady_clock::duration runTime) = 0;
 
+    virtual void logCpuTime(TaskId taskType,
+                            const std::chrono::nanoseconds cpuTime) = 0;
+
     virtual void updateCachedResidentRatio(size_t activePerc,
                                            size_t replicaPerc) = 0;
 
@@ -18,10 +18,7 @@
 #include <functional>
 #include <memory>
 
-#include "bgfetcher.h"
-#include "ep_bucket.h"
 #include "ep_engine.h"
-#include "flusher.h"
 #include "kvshard.h"
 #ifdef EP_USE_MAGMA
 #include "magma-kvstore/magma-kvstore_config.h"
@@ -65,23 +62,10 @@ KVShard::KVShard(uint16_t id, Configuration& config)
     }
 }
 
-void KVShard::enablePersistence(EPBucket& ep) {
-    flusher = std::make_unique<Flusher>(&ep, this);
-    bgFetcher = std::make_unique<BgFetcher>(ep, *this);
-}
-
 // Non-inline destructor so we can destruct
 // unique_ptrs of forward-declared items
 KVShard::~KVShard() = default;
 
-Flusher *KVShard::getFlusher() {
-    return flusher.get();
-}
-
-BgFetcher *KVShard::getBgFetcher() {
-    return bgFetcher.get();
-}
-
 VBucketPtr KVShard::getBucket(Vbid id) const {
     if (id.get() < vbuckets.size()) {
         return vbuckets[id.get()].lock().get();
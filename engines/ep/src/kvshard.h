@@ -22,6 +22,7 @@
 #include "vbucket.h"
 
 #include <atomic>
+#include <mutex>
 
 /**
  * Base class encapsulating individual couchstore(vbucket) into a
@@ -51,10 +52,7 @@
  *   -----------------------------------
  *
  */
-class BgFetcher;
 class Configuration;
-class EPBucket;
-class Flusher;
 
 class KVShard {
 public:
@@ -63,9 +61,6 @@ public:
     KVShard(KVShard::id_type id, Configuration& config);
     ~KVShard();
 
-    /// Enable persistence for this KVShard; setting up flusher and BGFetcher.
-    void enablePersistence(EPBucket& epBucket);
-
     KVStore* getRWUnderlying() {
         return rwStore.get();
     }
@@ -85,9 +80,6 @@ public:
         f(rwStore.get());
     }
 
-    Flusher *getFlusher();
-    BgFetcher *getBgFetcher();
-
     VBucketPtr getBucket(Vbid id) const;
     void setBucket(VBucketPtr vb);
 
@@ -111,6 +103,16 @@ public:
     std::vector<Vbid> getVBucketsSortedByState();
     std::vector<Vbid> getVBuckets();
 
+    /**
+     * The lock held while flushing a vBucket of this shard. A KVStore only
+     * supports a single write transaction at a time; the shards are
+     * partitioned between the flushers, so it's only contended while the
+     * shards are being reassigned (the number of flushers changes).
+     */
+    std::mutex& getFlushLock() {
+        return flushLock;
+    }
+
 private:
     // Holds the store configuration for the current shard.
     // We need to use a unique_ptr in place of the concrete class because
@@ -207,8 +209,7 @@ private:
     std::unique_ptr<KVStore> rwStore;
     std::unique_ptr<KVStore> roStore;
 
-    std::unique_ptr<Flusher> flusher;
-    std::unique_ptr<BgFetcher> bgFetcher;
+    std::mutex flushLock;
 
 public:
     std::atomic<size_t> highPriorityCount;
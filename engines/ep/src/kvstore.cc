@@ -86,6 +86,7 @@ void FileStats::reset() {
     writeCountHisto.reset();
     totalBytesRead = 0;
     totalBytesWritten = 0;
+    totalBytesDropped = 0;
 }
 
 size_t FileStats::getMemFootPrint() const {
@@ -99,6 +100,7 @@ KVStoreStats::KVStoreStats() = default;
 
 void KVStoreStats::reset() {
     docsCommitted = 0;
+    commitRequestAllocs = 0;
     numOpen = 0;
     numClose = 0;
     numLoadedVb = 0;
@@ -129,6 +131,8 @@ void KVStoreStats::reset() {
     getMultiFsReadCount.reset();
     getMultiFsReadHisto.reset();
     getMultiFsReadPerDocHisto.reset();
+    getMultiBodyReadHisto.reset();
+    getMultiAdjacentReadHisto.reset();
     flusherWriteAmplificationHisto.reset();
 
     fsStats.reset();
@@ -344,6 +348,11 @@ void KVStore::addStats(const AddStatFn& add_stat,
         addStat(prefix, "failure_del",   st.numDelFailure,   add_stat, c);
         addStat(prefix, "failure_vbset", st.numVbSetFailure, add_stat, c);
         addStat(prefix, "lastCommDocs",  st.docsCommitted,   add_stat, c);
+        addStat(prefix,
+                "lastCommReqAllocs",
+                st.commitRequestAllocs,
+                add_stat,
+                c);
     }
 
     addStat(prefix,
@@ -397,8 +406,58 @@ void KVStore::addStats(const AddStatFn& add_stat,
     addStat(prefix, "io_compaction_write_bytes",
             st.fsStatsCompaction.totalBytesWritten, add_stat, c);
 
-    // Specific to RocksDB. Per-shard stats.
+    const size_t dropped = st.fsStats.totalBytesDropped.load() +
+                           st.fsStatsCompaction.totalBytesDropped.load();
+    addStat(prefix, "io_page_cache_dropped_bytes", dropped, add_stat, c);
+
     size_t value = 0;
+    // Specific to Couchstore (when the block cache is enabled).
+    if (getStat("block_cache_hits", value)) {
+        addStat(prefix, "couchstore_block_cache_hits", value, add_stat, c);
+    }
+    if (getStat("block_cache_misses", value)) {
+        addStat(prefix, "couchstore_block_cache_misses", value, add_stat, c);
+    }
+    if (getStat("block_cache_evictions", value)) {
+        addStat(prefix, "couchstore_block_cache_evictions", value, add_stat, c);
+    }
+    if (getStat("block_cache_mem_used", value)) {
+        addStat(prefix, "couchstore_block_cache_mem_used", value, add_stat, c);
+    }
+    // Specific to Couchstore.
+    if (getStat("read_handle_cache_hits", value)) {
+        addStat(prefix,
+                "couchstore_read_handle_cache_hits",
+                value,
+                add_stat,
+                c);
+    }
+    if (getStat("read_handle_cache_misses", value)) {
+        addStat(prefix,
+                "couchstore_read_handle_cache_misses",
+                value,
+                add_stat,
+                c);
+    }
+
+    // Specific to Magma.
+    if (getStat("magma_write_batches", value)) {
+        addStat(prefix, "magma_write_batches", value, add_stat, c);
+    }
+    if (getStat("magma_write_items", value)) {
+        addStat(prefix, "magma_write_items", value, add_stat, c);
+    }
+    if (getStat("magma_write_bytes", value)) {
+        addStat(prefix, "magma_write_bytes", value, add_stat, c);
+    }
+    if (getStat("magma_value_log_write_bytes", value)) {
+        addStat(prefix, "magma_value_log_write_bytes", value, add_stat, c);
+    }
+    if (getStat("magma_write_cache_releases", value)) {
+        addStat(prefix, "magma_write_cache_releases", value, add_stat, c);
+    }
+
+    // Specific to RocksDB. Per-shard stats.
     // Memory Usage
     if (getStat("kMemTableTotal", value)) {
         addStat(prefix, "rocksdb_kMemTableTotal", value, add_stat, c);
@@ -530,6 +589,16 @@ void KVStore::addTimingStats(const AddStatFn& add_stat, const void* c) {
             st.getMultiFsReadPerDocHisto,
             add_stat,
             c);
+    addStat(prefix,
+            "getMultiBodyReadCount",
+            st.getMultiBodyReadHisto,
+            add_stat,
+            c);
+    addStat(prefix,
+            "getMultiAdjacentReadCount",
+            st.getMultiAdjacentReadHisto,
+            add_stat,
+            c);
     addStat(prefix,
             "flusherWriteAmplificationRatio",
             st.flusherWriteAmplificationHisto,
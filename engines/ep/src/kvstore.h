@@ -37,6 +37,7 @@
 
 /* Forward declarations */
 class BucketLogger;
+class CompactionRateLimiter;
 class DiskDocKey;
 class Item;
 class KVStore;
@@ -113,6 +114,8 @@ struct CompactionConfig {
     Vbid db_file_id = Vbid(0);
     uint64_t purgeSeq = 0;
     bool retain_erroneous_tombstones = false;
+    /// Compaction is only required to erase dropped collections
+    bool dropped_collections_only = false;
 };
 
 struct compaction_ctx {
@@ -133,6 +136,14 @@ struct compaction_ctx {
 
     /// The SyncRepl HCS, can purge any prepares before the HCS.
     uint64_t highCompletedSeqno = 0;
+
+    /// If non-null, the I/O budget the compaction's reads and writes are
+    /// limited to.
+    CompactionRateLimiter* rateLimiter = nullptr;
+
+    /// If set, returns the serialised bloom filter built by the compaction,
+    /// to be persisted with the compacted file (or empty if it shouldn't be).
+    std::function<std::string()> getBloomFilter;
 };
 
 struct kvstats_ctx {
@@ -249,6 +260,21 @@ public:
     BucketLogger* logger;
     const KVStoreConfig& config;
     Collections::VB::ScanContext collectionsContext;
+
+    /**
+     * If set, only the items of this collection (and its system events) are
+     * wanted; a KVStore which can read a collection's keys more cheaply than
+     * the whole seqno range may do so, returning the items in seqno order.
+     * Other KVStores ignore it (the caller filters the items it's given).
+     */
+    boost::optional<CollectionID> collection;
+
+    /**
+     * If set (with collection), the items of the collection may be returned
+     * in key order instead (the KVStore then needn't hold the keys to sort
+     * them). lastReadSeqno is then only the seqno of the last item returned.
+     */
+    bool keyOrder = false;
 };
 
 struct FileStats {
@@ -275,6 +301,8 @@ struct FileStats {
     cb::RelaxedAtomic<size_t> totalBytesRead{0};
     // Total bytes written to disk.
     cb::RelaxedAtomic<size_t> totalBytesWritten{0};
+    // Total bytes of written data dropped from the page cache.
+    cb::RelaxedAtomic<size_t> totalBytesDropped{0};
 
     size_t getMemFootPrint() const;
 
@@ -294,6 +322,8 @@ public:
 
     // the number of docs committed
     cb::RelaxedAtomic<size_t> docsCommitted;
+    // the number of allocations made to queue the requests of the last commit
+    cb::RelaxedAtomic<size_t> commitRequestAllocs;
     // the number of open() calls
     cb::RelaxedAtomic<size_t> numOpen;
     // the number of close() calls
@@ -356,6 +386,14 @@ public:
     // per fetched document.
     Hdr1sfInt32Histogram getMultiFsReadPerDocHisto;
 
+    // Histogram of document bodies read per getMulti() request (the bodies
+    // are read in file order once all the keys have been looked up).
+    Hdr1sfInt32Histogram getMultiBodyReadHisto;
+
+    // Histogram of the getMulti() body reads per request which started
+    // within a block of the end of the previous read.
+    Hdr1sfInt32Histogram getMultiAdjacentReadHisto;
+
     /// Histogram of disk Write Amplification ratios for each batch of items
     /// flushed to disk (each saveDocs() call).
     /// Encoded as integer, by multipling the floating-point ratio by 10 -
@@ -379,6 +417,8 @@ public:
                saveDocsHisto.getMemFootPrint() + batchSize.getMemFootPrint() +
                getMultiFsReadHisto.getMemFootPrint() +
                getMultiFsReadPerDocHisto.getMemFootPrint() +
+               getMultiBodyReadHisto.getMemFootPrint() +
+               getMultiAdjacentReadHisto.getMemFootPrint() +
                fsStats.getMemFootPrint() + fsStatsCompaction.getMemFootPrint() +
                flusherWriteAmplificationHisto.getMemFootPrint();
     }
@@ -544,6 +584,14 @@ public:
         return false;
     }
 
+    /**
+     * Ask the KVStore to give back the memory it holds buffering writes, as
+     * the bucket is over its high watermark. Must not block; the store may
+     * release the memory later (e.g. from its next commit).
+     */
+    virtual void releaseWriteBufferMemory() {
+    }
+
     /**
      * Show kvstore specific timing stats.
      *
@@ -674,6 +722,24 @@ public:
      */
     virtual void delVBucket(Vbid vbucket, uint64_t fileRev) = 0;
 
+    /**
+     * Shrink the file of a vbucket which is about to be deleted (via
+     * delVBucket) by up to the given number of bytes. Releasing a large file
+     * in steps avoids the unlink blocking the calling thread for as long as
+     * it takes the filesystem to free all of the file's extents.
+     *
+     * @param vbucket vbucket id
+     * @param fileRev the revision of the file to shrink
+     * @param bytes the maximum number of bytes to truncate
+     * @return the size of the file after the call; 0 when there is nothing
+     *         (more) worth truncating before the file is deleted
+     */
+    virtual size_t truncateVBucketFile(Vbid vbucket,
+                                       uint64_t fileRev,
+                                       size_t bytes) {
+        return 0;
+    }
+
     /**
      * Get a list of all persisted vbuckets (with their states).
      */
@@ -801,11 +867,21 @@ public:
         return st;
     }
 
+    /**
+     * Enumerate the (non-deleted) keys of the vBucket in key order, starting
+     * at start_key.
+     *
+     * @param vbid the vBucket to enumerate
+     * @param start_key the key to start from (inclusive)
+     * @param count the maximum number of keys to return
+     * @param cb invoked for each key. The callback may end the enumeration
+     *           early by setting a status other than ENGINE_SUCCESS.
+     */
     virtual ENGINE_ERROR_CODE getAllKeys(
             Vbid vbid,
             const DiskDocKey& start_key,
             uint32_t count,
-            std::shared_ptr<Callback<const DiskDocKey&>> cb) = 0;
+            std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) = 0;
 
     /**
      * Create a KVStore Scan Context with the given options. On success,
@@ -923,6 +999,44 @@ public:
     virtual std::vector<Collections::KVStore::DroppedCollection>
     getDroppedCollections(Vbid vbid) = 0;
 
+    /**
+     * Complete the erasure of the vbucket's dropped collections without a
+     * compaction, which is possible when none of them has any data left on
+     * disk. The caller must serialise this with the flusher.
+     *
+     * @param vbid vbucket whose dropped collections are to be erased
+     * @return true if the dropped collections are now erased, false if a
+     *         compaction is required to erase them
+     */
+    virtual bool eraseEmptyDroppedCollections(Vbid vbid) {
+        return false;
+    }
+
+    /**
+     * Persist a vbucket's bloom filter alongside its data, so that it need
+     * not be rebuilt at warmup.
+     *
+     * @param vbid vbucket the filter is for
+     * @param highSeqno the vbucket high seqno which the filter is valid for
+     * @param filter the filter, as serialised by BloomFilter::serialise
+     * @return true if the filter was persisted
+     */
+    virtual bool persistBloomFilter(Vbid vbid,
+                                    uint64_t highSeqno,
+                                    cb::const_char_buffer filter) {
+        return false;
+    }
+
+    /**
+     * @param vbid vbucket to get the filter of
+     * @return the high seqno and serialised bloom filter last persisted for
+     *         the vbucket; the filter is empty if there is none.
+     */
+    virtual std::pair<uint64_t, std::string> getPersistedBloomFilter(
+            Vbid vbid) {
+        return {0, {}};
+    }
+
 protected:
     /**
      * Prepare for delete of the vbucket file - Implementation specific method
@@ -1020,6 +1134,29 @@ public:
 
     virtual void callback(GetValue &val) = 0;
 
+    /**
+     * @return true if the callback needs the state of each discarded update's
+     *         key in the Rollback header; a KVStore may then look the keys up
+     *         in bulk and invoke discardedUpdate() instead of callback().
+     */
+    virtual bool needsPreRollbackState() const {
+        return false;
+    }
+
+    /**
+     * Invoked instead of callback() by a KVStore which has already looked up
+     * the state of the discarded update's key in the Rollback header (in bulk,
+     * rather than one key at a time via getWithHeader).
+     *
+     * @param postRollback The discarded update (key and metadata only)
+     * @param preRollback The key's state in the Rollback header; status
+     *        ENGINE_KEY_ENOENT if it didn't exist.
+     */
+    virtual void discardedUpdate(GetValue& postRollback,
+                                 GetValue& preRollback) {
+        callback(postRollback);
+    }
+
     void setDbHeader(void *db) {
         dbHandle = db;
     }
@@ -70,6 +70,13 @@ KVStoreConfig::KVStoreConfig(Configuration& config, uint16_t shardid)
     config.addValueChangedListener(
             "couchstore_mprotect",
             std::make_unique<ConfigChangeListener>(*this));
+    // The cache is divided evenly between the shards.
+    setCouchstoreBlockCacheSize(config.getCouchstoreBlockCacheSize() /
+                                config.getMaxNumShards());
+    setCouchstoreCacheReadHandles(config.isCouchstoreCacheReadHandles());
+    const auto& dropWrittenPages = config.getCouchstoreDropWrittenPages();
+    setCouchstoreDropWrittenPages(dropWrittenPages == "all",
+                                  dropWrittenPages != "none");
 }
 
 KVStoreConfig::KVStoreConfig(uint16_t _maxVBuckets,
@@ -86,7 +93,11 @@ KVStoreConfig::KVStoreConfig(uint16_t _maxVBuckets,
       buffered(true),
       couchstoreTracingEnabled(false),
       couchstoreWriteValidationEnabled(false),
-      couchstoreMprotectEnabled(false) {
+      couchstoreMprotectEnabled(false),
+      couchstoreBlockCacheSize(0),
+      couchstoreCacheReadHandles(false),
+      couchstoreDropFlushedPages(false),
+      couchstoreDropCompactedPages(false) {
 }
 
 KVStoreConfig::~KVStoreConfig() = default;
@@ -121,6 +121,54 @@ public:
         return couchstoreMprotectEnabled;
     }
 
+    /**
+     * Set the size (in bytes) of the block cache of a CouchKVStore; 0 for no
+     * cache. Only takes effect when the store is created.
+     */
+    KVStoreConfig& setCouchstoreBlockCacheSize(size_t value) {
+        couchstoreBlockCacheSize = value;
+        return *this;
+    }
+
+    size_t getCouchstoreBlockCacheSize() const {
+        return couchstoreBlockCacheSize;
+    }
+
+    /**
+     * Set whether a CouchKVStore keeps a read-only handle of each vBucket's
+     * file open between reads (off by default: it costs a file descriptor
+     * per vBucket read, in both the RW and the RO store). Only takes effect
+     * when the store is created.
+     */
+    KVStoreConfig& setCouchstoreCacheReadHandles(bool value) {
+        couchstoreCacheReadHandles = value;
+        return *this;
+    }
+
+    bool getCouchstoreCacheReadHandles() const {
+        return couchstoreCacheReadHandles;
+    }
+
+    /**
+     * Set whether the data written by the flusher / by compaction is dropped
+     * from the page cache once synced. Only takes effect when the store is
+     * created.
+     */
+    KVStoreConfig& setCouchstoreDropWrittenPages(bool flusher,
+                                                 bool compaction) {
+        couchstoreDropFlushedPages = flusher;
+        couchstoreDropCompactedPages = compaction;
+        return *this;
+    }
+
+    bool getCouchstoreDropFlushedPages() const {
+        return couchstoreDropFlushedPages;
+    }
+
+    bool getCouchstoreDropCompactedPages() const {
+        return couchstoreDropCompactedPages;
+    }
+
 private:
     class ConfigChangeListener;
 
@@ -148,4 +196,14 @@ private:
     std::atomic_bool couchstoreWriteValidationEnabled;
     /* enbale mprotect of couchstore internal io buffer */
     std::atomic_bool couchstoreMprotectEnabled;
+
+    /* size of the couchstore block cache of this shard */
+    size_t couchstoreBlockCacheSize;
+
+    /* keep read-only couchstore handles open between reads */
+    bool couchstoreCacheReadHandles;
+
+    /* drop the pages written by the flusher / compaction once synced */
+    bool couchstoreDropFlushedPages;
+    bool couchstoreDropCompactedPages;
 };
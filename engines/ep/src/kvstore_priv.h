@@ -45,6 +45,8 @@ public:
      */
     IORequest(Vbid vbid, MutationRequestCallback, DiskDocKey key);
 
+    IORequest(IORequest&&) = default;
+
     ~IORequest();
 
     /// @returns true if the document to be persisted is for DELETE
@@ -21,11 +21,11 @@
 #include "stats.h"
 
 #include <memcached/vbucket.h>
+#include <limits>
 #include <mutex>
 
 BasicLinkedList::BasicLinkedList(Vbid vbucketId, EPStats& st)
     : SequenceList(),
-      readRange(0, 0),
       staleSize(0),
       staleMetaDataSize(0),
       highSeqno(0),
@@ -67,13 +67,16 @@ SequenceList::UpdateStatus BasicLinkedList::updateListElem(
         std::lock_guard<std::mutex>& seqLock,
         std::lock_guard<std::mutex>& writeLock,
         OrderedStoredValue& v) {
-    /* Lock that needed for consistent read of SeqRange 'readRange' */
+    /* Lock that needed for consistent read of the SeqRanges 'readRanges' */
     std::lock_guard<SpinLock> lh(rangeLock);
 
-    if (readRange.fallsInRange(v.getBySeqno())) {
-        /* Range read is in middle of a point-in-time snapshot, hence we cannot
-           move the element to the end of the list. Return a temp failure */
-        return UpdateStatus::Append;
+    for (const auto& range : readRanges) {
+        if (range.fallsInRange(v.getBySeqno())) {
+            /* Range read is in middle of a point-in-time snapshot, hence we
+               cannot move the element to the end of the list. Return a temp
+               failure */
+            return UpdateStatus::Append;
+        }
     }
 
     /* Since there is no other reads or writes happenning in this range, we can
@@ -102,12 +105,9 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
         return std::make_tuple(ENGINE_ERANGE, std::vector<UniqueItemPtr>(), 0);
     }
 
-    /* Allows only 1 rangeRead for now */
-    std::lock_guard<std::mutex> lckGd(rangeReadLock);
-
+    ReadRangeGuard range;
     {
         std::lock_guard<std::mutex> listWriteLg(getListWriteLock());
-        std::lock_guard<SpinLock> lh(rangeLock);
         if (start > highSeqno) {
             EP_LOG_WARN(
                     "BasicLinkedList::rangeRead(): "
@@ -124,7 +124,13 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
         /* Mark the initial read range */
         end = std::min(end, static_cast<seqno_t>(highSeqno));
         end = std::max(end, static_cast<seqno_t>(highestDedupedSeqno));
-        readRange = SeqRange(1, end);
+        range = tryAddReadRange(
+                listWriteLg, SeqRange(1, end), false /*exclusive*/);
+        if (!range) {
+            /* The list is being purged, try again later */
+            return std::make_tuple(
+                    ENGINE_TMPFAIL, std::vector<UniqueItemPtr>(), 0);
+        }
     }
 
     /* Read items in the range */
@@ -139,12 +145,8 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
             break;
         }
 
-        {
-            std::lock_guard<SpinLock> lh(rangeLock);
-            readRange.setBegin(currSeqno); /* [EPHE TODO]: should we
-                                                     update the min every time ?
-                                                   */
-        }
+        range.setBegin(currSeqno); /* [EPHE TODO]: should we update the min
+                                      every time ? */
 
         if (currSeqno < start) {
             /* skip this item */
@@ -184,10 +186,7 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
     }
 
     /* Done with range read, reset the range */
-    {
-        std::lock_guard<SpinLock> lh(rangeLock);
-        readRange.reset();
-    }
+    range.reset();
 
     /* Return all the range read items */
     return std::make_tuple(ENGINE_SUCCESS, std::move(items), end);
@@ -231,6 +230,12 @@ void BasicLinkedList::markItemStale(std::lock_guard<std::mutex>& listWriteLg,
 
     ++numStaleItems;
     v->toOrderedStoredValue()->markStale(listWriteLg, newSv);
+
+    if (newSv) {
+        /* A superseded version; reclaimable by range reads once none of them
+           can reach it */
+        staleVersions.emplace(v->getBySeqno(), v->toOrderedStoredValue());
+    }
 }
 
 size_t BasicLinkedList::purgeTombstones(
@@ -242,7 +247,7 @@ size_t BasicLinkedList::purgeTombstones(
     // Strategy - we try to ensure that this function does not block
     // frontend-writes (adding new OrderedStoredValues (OSVs) to the seqList).
     // To achieve this (safely),
-    // we (try to) acquire the rangeReadLock and setup a 'read' range for the
+    // we (try to) register an exclusive 'read' range for the
     // whole of the seqList. This prevents any other readers from iterating
     // the list (and accessing stale items) while we purge on it; but permits
     // front-end operations to continue as they:
@@ -257,20 +262,24 @@ size_t BasicLinkedList::purgeTombstones(
     // release the lock between each element so front-end operations can
     // have the opportunity to acquire it.
     //
-    // Attempt to acquire the readRangeLock, to block anyone else concurrently
-    // reading from the list while we remove elements from it.
-    std::unique_lock<std::mutex> rrGuard(rangeReadLock, std::try_to_lock);
-    if (!rrGuard) {
-        // If we cannot acquire the lock then another thread is
-        // running a range read. Given these are typically long-running,
-        // return without blocking.
-        return 0;
-    }
-
     // Determine the start and end iterators.
     OrderedLL::iterator startIt;
+    ReadRangeGuard purgeRange;
     {
         std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+
+        // Attempt to register an exclusive read range, to block anyone else
+        // concurrently reading from the list while we remove elements from
+        // it.
+        purgeRange = tryAddReadRange(
+                writeGuard, SeqRange(0, 0), true /*exclusive*/);
+        if (!purgeRange) {
+            // If we cannot register the range then another thread is
+            // running a range read. Given these are typically long-running,
+            // return without blocking.
+            return 0;
+        }
+
         if (seqList.empty()) {
             // Nothing in sequence list - nothing to purge.
             return 0;
@@ -289,9 +298,8 @@ size_t BasicLinkedList::purgeTombstones(
             return 0;
         }
 
-        // Update readRange
-        std::lock_guard<SpinLock> rangeGuard(rangeLock);
-        readRange = SeqRange(startIt->getBySeqno(), purgeUpToSeqno);
+        // Update the purge range
+        purgeRange.set(SeqRange(startIt->getBySeqno(), purgeUpToSeqno));
     }
 
     // Iterate across all but the last item in the seqList, looking
@@ -304,13 +312,10 @@ size_t BasicLinkedList::purgeTombstones(
             break;
         }
 
-        {
-            // As we move past the items in the list, increment the begin of
-            // 'readRange' to reduce the window of creating stale items during
-            // updates
-            std::lock_guard<SpinLock> rangeGuard(rangeLock);
-            readRange.setBegin(it->getBySeqno());
-        }
+        // As we move past the items in the list, increment the begin of
+        // the purge range to reduce the window of creating stale items during
+        // updates
+        purgeRange.setBegin(it->getBySeqno());
 
         {
             std::lock_guard<std::mutex> writeGuard(getListWriteLock());
@@ -337,11 +342,8 @@ size_t BasicLinkedList::purgeTombstones(
         }
     }
 
-    // Complete; reset the readRange.
-    {
-        std::lock_guard<SpinLock> lh(rangeLock);
-        readRange.reset();
-    }
+    // Complete; reset the purge range.
+    purgeRange.reset();
     return purgedCount;
 }
 
@@ -391,12 +393,23 @@ seqno_t BasicLinkedList::getHighestPurgedDeletedSeqno() const {
 
 uint64_t BasicLinkedList::getRangeReadBegin() const {
     std::lock_guard<SpinLock> lh(rangeLock);
-    return readRange.getBegin();
+    seqno_t begin = 0;
+    for (const auto& range : readRanges) {
+        if (range.getBegin() > 0) {
+            begin = (begin == 0) ? range.getBegin()
+                                 : std::min(begin, range.getBegin());
+        }
+    }
+    return begin;
 }
 
 uint64_t BasicLinkedList::getRangeReadEnd() const {
     std::lock_guard<SpinLock> lh(rangeLock);
-    return readRange.getEnd();
+    seqno_t end = 0;
+    for (const auto& range : readRanges) {
+        end = std::max(end, range.getEnd());
+    }
+    return end;
 }
 std::mutex& BasicLinkedList::getListWriteLock() const {
     return writeLock;
@@ -428,34 +441,161 @@ std::ostream& operator <<(std::ostream& os, const BasicLinkedList& ll) {
     return os;
 }
 
-OrderedLL::iterator BasicLinkedList::purgeListElem(OrderedLL::iterator it,
-                                                   bool isStale) {
-    StoredValue::UniquePtr purged(&*it);
-    {
-        std::lock_guard<std::mutex> lckGd(getListWriteLock());
-        it = seqList.erase(it);
+BasicLinkedList::ReadRangeGuard BasicLinkedList::tryAddReadRange(
+        std::lock_guard<std::mutex>& writeGuard,
+        const SeqRange& range,
+        bool exclusive) {
+    std::lock_guard<SpinLock> lh(rangeLock);
+    if (purging || (exclusive && !readRanges.empty())) {
+        return {};
     }
+    purging = exclusive;
+    return {*this, readRanges.insert(readRanges.end(), range), exclusive};
+}
 
+size_t BasicLinkedList::reclaimStaleVersions() {
+    size_t reclaimedCount = 0;
+    std::vector<StoredValue::UniquePtr> reclaimed;
+    do {
+        reclaimed.clear();
+        {
+            std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+            if (staleVersions.empty()) {
+                break;
+            }
+
+            // Any version below the begin of every in-flight read has been
+            // passed by all of them (and new reads skip stale versions),
+            // so nothing can reach it any more.
+            seqno_t oldestRead = std::numeric_limits<seqno_t>::max();
+            {
+                std::lock_guard<SpinLock> lh(rangeLock);
+                if (purging) {
+                    // The purger owns the list; it removes stale items itself
+                    break;
+                }
+                for (const auto& range : readRanges) {
+                    oldestRead = std::min(oldestRead, range.getBegin());
+                }
+            }
+
+            // Versions are reclaimed in seqno order, so any (lower) version
+            // which points at a reclaimed one as its replacement has already
+            // gone.
+            auto it = staleVersions.begin();
+            while (it != staleVersions.end() && it->first < oldestRead &&
+                   reclaimed.size() < reclaimChunkSize) {
+                auto listIt = seqList.iterator_to(*it->second);
+                if (pausedPurgePoint == listIt) {
+                    pausedPurgePoint = seqList.erase(listIt);
+                } else {
+                    seqList.erase(listIt);
+                }
+                reclaimed.emplace_back(it->second);
+                it = staleVersions.erase(it);
+            }
+        }
+
+        for (const auto& sv : reclaimed) {
+            updateStatsForPurgedElem(*sv->toOrderedStoredValue(), true);
+        }
+        reclaimedCount += reclaimed.size();
+    } while (reclaimed.size() == reclaimChunkSize);
+
+    return reclaimedCount;
+}
+
+void BasicLinkedList::updateStatsForPurgedElem(const OrderedStoredValue& purged,
+                                               bool isStale) {
     if (isStale) {
         /* Update the stats tracking the memory owned by the list */
-        staleSize.fetch_sub(purged->size());
-        staleMetaDataSize.fetch_sub(purged->metaDataSize());
+        staleSize.fetch_sub(purged.size());
+        staleMetaDataSize.fetch_sub(purged.metaDataSize());
         --numStaleItems;
     }
 
-    st.coreLocal.get()->currentSize.fetch_sub(purged->metaDataSize());
+    st.coreLocal.get()->currentSize.fetch_sub(purged.metaDataSize());
 
-    if (purged->isDeleted()) {
+    if (purged.isDeleted()) {
         --numDeletedItems;
     }
 
-    if (purged->isDeleted()) {
+    if (purged.isDeleted()) {
         highestPurgedDeletedSeqno = std::max(seqno_t(highestPurgedDeletedSeqno),
-                                             purged->getBySeqno());
+                                             purged.getBySeqno());
     }
+}
+
+OrderedLL::iterator BasicLinkedList::purgeListElem(OrderedLL::iterator it,
+                                                   bool isStale) {
+    StoredValue::UniquePtr purged(&*it);
+    {
+        std::lock_guard<std::mutex> lckGd(getListWriteLock());
+        it = seqList.erase(it);
+        if (isStale) {
+            staleVersions.erase(purged->getBySeqno());
+        }
+    }
+
+    updateStatsForPurgedElem(*purged->toOrderedStoredValue(), isStale);
     return it;
 }
 
+BasicLinkedList::ReadRangeGuard::ReadRangeGuard(BasicLinkedList& list,
+                                                ReadRanges::iterator range,
+                                                bool exclusive)
+    : list(&list), range(range), exclusive(exclusive) {
+}
+
+BasicLinkedList::ReadRangeGuard::ReadRangeGuard(ReadRangeGuard&& other)
+    : list(other.list), range(other.range), exclusive(other.exclusive) {
+    other.list = nullptr;
+}
+
+BasicLinkedList::ReadRangeGuard& BasicLinkedList::ReadRangeGuard::operator=(
+        ReadRangeGuard&& other) {
+    if (this != &other) {
+        reset();
+        list = other.list;
+        range = other.range;
+        exclusive = other.exclusive;
+        other.list = nullptr;
+    }
+    return *this;
+}
+
+BasicLinkedList::ReadRangeGuard::~ReadRangeGuard() {
+    reset();
+}
+
+void BasicLinkedList::ReadRangeGuard::set(const SeqRange& newRange) {
+    std::lock_guard<SpinLock> lh(list->rangeLock);
+    *range = newRange;
+}
+
+void BasicLinkedList::ReadRangeGuard::setBegin(seqno_t begin) {
+    std::lock_guard<SpinLock> lh(list->rangeLock);
+    range->setBegin(begin);
+}
+
+void BasicLinkedList::ReadRangeGuard::reset() {
+    if (!list) {
+        return;
+    }
+    auto* ll = list;
+    list = nullptr;
+    {
+        std::lock_guard<SpinLock> lh(ll->rangeLock);
+        ll->readRanges.erase(range);
+        if (exclusive) {
+            // The purger has dealt with the stale items itself
+            ll->purging = false;
+            return;
+        }
+    }
+    ll->reclaimStaleVersions();
+}
+
 std::unique_ptr<BasicLinkedList::RangeIteratorLL>
 BasicLinkedList::RangeIteratorLL::create(BasicLinkedList& ll, bool isBackfill) {
     /* Note: cannot use std::make_unique because the constructor of
@@ -468,23 +608,25 @@ BasicLinkedList::RangeIteratorLL::create(BasicLinkedList& ll, bool isBackfill) {
 BasicLinkedList::RangeIteratorLL::RangeIteratorLL(BasicLinkedList& ll,
                                                   bool isBackfill)
     : list(ll),
-      /* Try to get range read lock, do not block */
-      readLockHolder(list.rangeReadLock, std::try_to_lock),
       itrRange(0, 0),
       numRemaining(0),
       earlySnapShotEndSeqno(0),
       isBackfill(isBackfill) {
-    if (!readLockHolder) {
-        /* no blocking */
+    std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
+    if (list.highSeqno < 1) {
+        /* No need of registering a range for the snapshot as there are no
+           items; Also iterator range is at default (0, 0) */
         return;
     }
 
-    std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
-    std::lock_guard<SpinLock> lh(list.rangeLock);
-    if (list.highSeqno < 1) {
-        /* No need of holding a lock for the snapshot as there are no items;
-           Also iterator range is at default (0, 0) */
-        readLockHolder.unlock();
+    /* Mark the snapshot range on linked list. The range that can be read by the
+       iterator is inclusive of the start and the end. Does not block; fails
+       only if the list is being purged. */
+    readRange = list.tryAddReadRange(listWriteLg,
+                                     SeqRange(list.seqList.front().getBySeqno(),
+                                              list.seqList.back().getBySeqno()),
+                                     false /*exclusive*/);
+    if (!readRange) {
         return;
     }
 
@@ -498,15 +640,10 @@ BasicLinkedList::RangeIteratorLL::RangeIteratorLL(BasicLinkedList& ll,
        read snapshot */
     earlySnapShotEndSeqno = list.highestDedupedSeqno;
 
-    /* Mark the snapshot range on linked list. The range that can be read by the
-       iterator is inclusive of the start and the end. */
-    list.readRange =
-            SeqRange(currIt->getBySeqno(), list.seqList.back().getBySeqno());
-
     /* Keep the range in the iterator obj. We store the range end seqno as one
        higher than the end seqno that can be read by this iterator.
        This is because, we must identify the end point of the iterator, and
-       we the read is inclusive of the end points of list.readRange.
+       we the read is inclusive of the end points of the list read range.
 
        Further, since use the class 'SeqRange' for 'itrRange' we cannot use
        curr() == end() + 1 to identify the end point because 'SeqRange' does
@@ -525,17 +662,15 @@ BasicLinkedList::RangeIteratorLL::RangeIteratorLL(BasicLinkedList& ll,
 }
 
 BasicLinkedList::RangeIteratorLL::~RangeIteratorLL() {
-    std::lock_guard<SpinLock> lh(list.rangeLock);
-    if (readLockHolder.owns_lock()) {
-        /* we must reset the list readRange only if the list iterator still owns
-           the read lock on the list */
-        list.readRange.reset();
+    if (readRange) {
+        /* we must remove the list read range only if the list iterator still
+           has it registered */
         auto severity = isBackfill ? spdlog::level::level_enum::info
                                    : spdlog::level::level_enum::debug;
         EP_LOG_FMT(severity, "{} Releasing the range iterator", list.vbid);
     }
-    /* As readLockHolder goes out of scope here, it will automatically release
-       the snapshot read lock on the linked list */
+    /* As readRange goes out of scope here, it will automatically remove
+       the snapshot read range from the linked list */
 }
 
 OrderedStoredValue& BasicLinkedList::RangeIteratorLL::operator*() const {
@@ -575,15 +710,13 @@ void BasicLinkedList::RangeIteratorLL::incrOperatorHelper() {
     /* Check if the iterator is pointing to the last element. Increment beyond
        the last element indicates the end of the iteration */
     if (curr() == itrRange.getEnd() - 1) {
-        std::lock_guard<SpinLock> lh(list.rangeLock);
-        /* We reset the range and release the readRange lock here so that any
-           iterator client that does not delete the iterator obj will not end up
-           holding the list readRange lock forever */
-        list.readRange.reset();
+        /* We remove the read range here so that any iterator client that does
+           not delete the iterator obj will not end up holding the list read
+           range (and the stale versions in it) forever */
         auto severity = isBackfill ? spdlog::level::level_enum::info
                                    : spdlog::level::level_enum::debug;
         EP_LOG_FMT(severity, "{} Releasing the range iterator", list.vbid);
-        readLockHolder.unlock();
+        readRange.reset();
 
         /* Update the begin to end() so the client can see that the iteration
            has ended */
@@ -592,16 +725,20 @@ void BasicLinkedList::RangeIteratorLL::incrOperatorHelper() {
     }
 
     ++currIt;
-    {
-        /* As the iterator moves we reduce the snapshot range being read on the
-           linked list. This helps reduce the stale items in the list during
-           heavy update load from the front end */
-        std::lock_guard<SpinLock> lh(list.rangeLock);
-        list.readRange.setBegin(currIt->getBySeqno());
-    }
+
+    /* As the iterator moves we reduce the snapshot range being read on the
+       linked list. This helps reduce the stale items in the list during
+       heavy update load from the front end */
+    readRange.setBegin(currIt->getBySeqno());
 
     /* Also update the current range stored in the iterator obj */
     itrRange.setBegin(currIt->getBySeqno());
+
+    /* Periodically free the stale versions that this (and every other) read
+       has now moved past */
+    if (numRemaining % reclaimChunkSize == 0) {
+        list.reclaimStaleVersions();
+    }
 }
 
 bool BasicLinkedList::RangeIteratorLL::itrRangeContainsAnUpdatedVersion() {
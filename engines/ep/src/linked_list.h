@@ -31,6 +31,9 @@
 #include <platform/non_negative_counter.h>
 #include <relaxed_atomic.h>
 
+#include <list>
+#include <map>
+
 /* This option will configure "list" to use the member hook */
 using MemberHookOption =
         boost::intrusive::member_hook<OrderedStoredValue,
@@ -129,20 +132,31 @@ private:
  *      BasicLinkedList (invalidate next, prev links) and then delete from the
  *      hashtable.
  *
+ * Range reads and stale versions:
+ * ==============================
+ * Any number of range reads (range iterators and rangeRead()) may run
+ * concurrently; each registers the range it still has to read in
+ * 'readRanges'. An update of an element in any registered range cannot move
+ * the element, so the old version is kept in place (marked stale) and the new
+ * version is appended. Once every in-flight read has moved past a stale
+ * version no reader can reach it, and the readers reclaim it as they advance
+ * (and when they finish) rather than leaving it for the stale item purger.
+ * purgeTombstones() removes arbitrary elements and hence runs exclusively of
+ * all range reads.
+ *
  * Ordering/Hierarchy of Locks:
  * ===========================
- * BasicLinkedList has 3 locks namely:
- * (i) writeLock (ii) rangeLock (iii) rangeReadLock
+ * BasicLinkedList has 2 locks namely:
+ * (i) writeLock (ii) rangeLock
  * Description of each lock can be found below in the class declaration, here
  * we describe in what order the locks should be grabbed
  *
- * rangeReadLock ==> writeLock ==> rangeLock is the valid lock hierarchy.
+ * writeLock ==> rangeLock is the valid lock hierarchy.
  *
  * Preferred/Expected Lock Duration:
  * ================================
  * 'writeLock' and 'rangeLock' are held for short durations, typically for
  * single list element writes and reads.
- * 'rangeReadLock' is held for longer duration on the list (for entire range).
  */
 class BasicLinkedList : public SequenceList {
 public:
@@ -208,6 +222,9 @@ public:
     void dump() const override;
 
 protected:
+    /* The ranges being read from the list, one per in-flight read */
+    using ReadRanges = std::list<SeqRange>;
+
     /* Underlying data structure that holds the items in an Ordered Sequence */
     OrderedLL seqList;
 
@@ -219,33 +236,35 @@ protected:
     mutable std::mutex writeLock;
 
     /**
-     * Used to mark of the range where point-in-time snapshot is happening.
+     * Used to mark of the ranges where point-in-time snapshots are happening.
      * To get a valid point-in-time snapshot and for correct list iteration we
-     * must not de-duplicate an item in the list in this range.
+     * must not de-duplicate an item in the list in any of these ranges.
+     * Each read shrinks its own range as it advances.
      */
-    SeqRange readRange;
+    ReadRanges readRanges;
 
     /**
-     * Lock that protects readRange.
+     * True while purgeTombstones() is running; no range read may be started
+     * while set, and it is only set when no range read is in flight.
+     * Guarded by rangeLock.
+     */
+    bool purging = false;
+
+    /**
+     * Lock that protects readRanges and purging.
      * We use spinlock here since the lock is held only for very small time
      * periods.
      */
     mutable SpinLock rangeLock;
 
     /**
-     * Lock that serializes range reads on the 'seqList' - i.e. serializes
-     * the addition / removal of range reads from the set in-flight.
-     * We need to serialize range reads because, range reads set a list level
-     * range in which items are read. If we have multiple range reads then we
-     * must handle the races in the updation of the range to have most inclusive
-     * range.
-     * For now we use this lock to allow only one range read at a time.
-     *
-     * It is also additionally used in purgeTombstones() to prevent the
-     * creation of any new rangeReads while purge is in-progress - see
-     * detailed comments there.
+     * The stale items which have been superseded by a newer version in the
+     * list (as opposed to stale tombstones, which have no replacement),
+     * ordered by seqno. A version can be reclaimed once its seqno is below
+     * the begin of every readRange.
+     * Guarded by writeLock.
      */
-    std::mutex rangeReadLock;
+    std::map<seqno_t, OrderedStoredValue*> staleVersions;
 
     /* Overall memory consumed by (stale) OrderedStoredValues owned by the
        list */
@@ -256,8 +275,78 @@ protected:
     cb::RelaxedAtomic<size_t> staleMetaDataSize;
 
 private:
+    /**
+     * RAII handle on one entry of 'readRanges'. Removing a (non-exclusive)
+     * range may make stale versions unreachable, so they are reclaimed on
+     * release.
+     */
+    class ReadRangeGuard {
+    public:
+        ReadRangeGuard() = default;
+
+        ReadRangeGuard(BasicLinkedList& list,
+                       ReadRanges::iterator range,
+                       bool exclusive);
+
+        ReadRangeGuard(ReadRangeGuard&& other);
+
+        ReadRangeGuard& operator=(ReadRangeGuard&& other);
+
+        ~ReadRangeGuard();
+
+        explicit operator bool() const {
+            return list != nullptr;
+        }
+
+        /// Replace the registered range
+        void set(const SeqRange& range);
+
+        /// Move the begin of the registered range
+        void setBegin(seqno_t begin);
+
+        /// Unregister the range and reclaim the versions it was holding
+        void reset();
+
+    private:
+        BasicLinkedList* list = nullptr;
+        ReadRanges::iterator range;
+        bool exclusive = false;
+    };
+
+    /**
+     * Register a range read on the list.
+     *
+     * @param writeGuard The locked writeLock; reads must be registered under
+     *        it so that they see a consistent list.
+     * @param range The range to be read
+     * @param exclusive true if the read may not run concurrently with any
+     *        other (used by purgeTombstones()).
+     * @return a valid guard on success, or an empty one if the range cannot
+     *         be registered now (an exclusive read is in flight or, for an
+     *         exclusive read, any read is in flight).
+     */
+    ReadRangeGuard tryAddReadRange(std::lock_guard<std::mutex>& writeGuard,
+                                   const SeqRange& range,
+                                   bool exclusive);
+
+    /**
+     * Remove from the list (and free) the stale versions which no in-flight
+     * range read can reach any more. The writeLock is released every
+     * 'reclaimChunkSize' items so that front-end writes are not held up.
+     *
+     * @return the number of stale versions reclaimed
+     */
+    size_t reclaimStaleVersions();
+
+    /// Update the list stats for an element removed from the list
+    void updateStatsForPurgedElem(const OrderedStoredValue& purged,
+                                  bool isStale);
+
     OrderedLL::iterator purgeListElem(OrderedLL::iterator it, bool isStale);
 
+    /// Max stale versions reclaimed under one acquisition of writeLock
+    static const size_t reclaimChunkSize = 1024;
+
     /**
      * We need to keep track of the highest seqno separately because there is a
      * small window wherein the last element of the list (though in correct
@@ -316,17 +405,17 @@ private:
     class RangeIteratorLL : public SequenceList::RangeIteratorImpl {
     public:
         /**
-         * Method to create instances of RangeIteratorLL. We only
-         * allow one RangeIteratorLL object to exist at any one time,
-         * hence creation can fail and that's why object creation is via a
-         * public method and not constructor.
+         * Method to create instances of RangeIteratorLL. Any number of
+         * RangeIteratorLL objects may exist at once, but none can be created
+         * while the list is being purged, hence creation can fail and that's
+         * why object creation is via a public method and not constructor.
          *
          * @param ll ref to the linkedlist on which the iterator is created
          * @param isBackfill indicates if the iterator is for backfill (for
          *                   debug)
          *
-         * @return Non-null pointer on success, or null if a RangeIteratorLL
-         *         already exists.
+         * @return Non-null pointer on success, or null if the list is being
+         *         purged.
          */
         static std::unique_ptr<RangeIteratorLL> create(BasicLinkedList& ll,
                                                        bool isBackfill);
@@ -362,7 +451,8 @@ private:
 
     private:
         /* We have a private constructor because we want to create the iterator
-           optionally, that is, only when it is possible to get a read lock */
+           optionally, that is, only when it is possible to register a read
+           range */
         RangeIteratorLL(BasicLinkedList& ll, bool isBackfill);
 
         /**
@@ -373,8 +463,8 @@ private:
          *         false: iterator created successfully
          */
         bool tryLater() const {
-            /* could not lock and the list has items */
-            return (!readLockHolder && (list.getHighSeqno() > 0));
+            /* could not register a range and the list has items */
+            return (!readRange && (list.getHighSeqno() > 0));
         }
 
         /**
@@ -399,8 +489,8 @@ private:
         /* The current list element pointed by the iterator */
         OrderedLL::iterator currIt;
 
-        /* Lock holder which allows having only one iterator at a time */
-        std::unique_lock<std::mutex> readLockHolder;
+        /* The range registered on the list, which is yet to be read */
+        ReadRangeGuard readRange;
 
         /* Current range of the iterator */
         SeqRange itrRange;
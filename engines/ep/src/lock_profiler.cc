@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "lock_profiler.h"
+#include "statwriter.h"
+
+#include <utilities/hdrhistogram.h>
+
+#include <array>
+
+std::atomic<size_t> LockProfiler::sampleRate{0};
+
+namespace {
+/// The samples recorded for one lock site.
+struct SiteProfile {
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> contended{0};
+    Hdr1sfMicroSecHistogram waitHisto;
+    Hdr1sfMicroSecHistogram holdHisto;
+};
+
+// Constructed when the engine is loaded, so the histograms aren't accounted
+// to whichever bucket happens to record the first sample.
+std::array<SiteProfile, LockProfiler::numSites> profiles;
+} // namespace
+
+const char* LockProfiler::to_string(Site site) {
+    switch (site) {
+    case Site::HashTable:
+        return "hash_table";
+    case Site::CheckpointQueue:
+        return "checkpoint_queue";
+    case Site::VBucketState:
+        return "vbucket_state";
+    case Site::TaskQueue:
+        return "task_queue";
+    case Site::BgFetcherQueue:
+        return "bgfetcher_queue";
+    }
+    return "unknown";
+}
+
+void LockProfiler::setSampleRate(size_t rate) {
+    sampleRate.store(rate, std::memory_order_relaxed);
+}
+
+void LockProfiler::recordAcquire(Site site,
+                                 bool contended,
+                                 std::chrono::steady_clock::duration wait) {
+    auto& profile = profiles[size_t(site)];
+    profile.samples++;
+    if (contended) {
+        profile.contended++;
+    }
+    profile.waitHisto.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(wait));
+}
+
+void LockProfiler::recordHold(Site site,
+                              std::chrono::steady_clock::duration held) {
+    profiles[size_t(site)].holdHisto.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(held));
+}
+
+void LockProfiler::addStats(const AddStatFn& add_stat, const void* cookie) {
+    add_casted_stat(
+            "ep_lock_profile:sample_rate", getSampleRate(), add_stat, cookie);
+    for (size_t ii = 0; ii < numSites; ++ii) {
+        const auto& profile = profiles[ii];
+        const std::string prefix =
+                std::string("ep_lock_profile:") + to_string(Site(ii)) + ":";
+        add_casted_stat((prefix + "samples").c_str(),
+                        profile.samples.load(),
+                        add_stat,
+                        cookie);
+        add_casted_stat((prefix + "contended").c_str(),
+                        profile.contended.load(),
+                        add_stat,
+                        cookie);
+        add_casted_stat((prefix + "wait_us").c_str(),
+                        profile.waitHisto,
+                        add_stat,
+                        cookie);
+        add_casted_stat((prefix + "hold_us").c_str(),
+                        profile.holdHisto,
+                        add_stat,
+                        cookie);
+    }
+}
+
+void LockProfiler::reset() {
+    for (auto& profile : profiles) {
+        profile.samples = 0;
+        profile.contended = 0;
+        profile.waitHisto.reset();
+        profile.holdHisto.reset();
+    }
+}
@@ -0,0 +1,253 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/SharedMutex.h>
+#include <memcached/engine_common.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Sampling contention profiler for a fixed set of hot ep-engine locks.
+ *
+ * One in every sampleRate acquisitions (per thread) of a profiled lock site
+ * is measured: whether the lock was contended (could not be acquired
+ * immediately), how long the acquisition waited, and how long the lock was
+ * then held. The results are accumulated per site, process-wide (the
+ * TaskQueues are shared by all buckets), and reported by the "lock-profile"
+ * stat group.
+ *
+ * With a sample rate of zero (the default) profiling is disabled and a
+ * profiled acquisition costs a single relaxed atomic load on top of
+ * taking the lock.
+ *
+ * For LockTimer-style debugging of a single lock holder with logged
+ * thresholds see lock_timer.h.
+ */
+class LockProfiler {
+public:
+    enum class Site : uint8_t {
+        /// The striped HashTable bucket mutexes (HashBucketLock).
+        HashTable,
+        /// CheckpointManager::queueLock.
+        CheckpointQueue,
+        /// VBucket::stateLock, when acquired on the front-end paths.
+        VBucketState,
+        /// The TaskQueue mutexes of the ExecutorPool.
+        TaskQueue,
+        /// BgFetcher::queueMutex.
+        BgFetcherQueue,
+    };
+
+    static constexpr size_t numSites = size_t(Site::BgFetcherQueue) + 1;
+
+    static const char* to_string(Site site);
+
+    /**
+     * Set how often acquisitions are sampled - one in every `rate`
+     * acquisitions of each thread. 0 disables profiling.
+     */
+    static void setSampleRate(size_t rate);
+
+    static size_t getSampleRate() {
+        return sampleRate.load(std::memory_order_relaxed);
+    }
+
+    /// @returns true if the calling thread's next acquisition is sampled.
+    static bool shouldSample() {
+        const auto rate = sampleRate.load(std::memory_order_relaxed);
+        if (rate == 0) {
+            return false;
+        }
+        thread_local size_t acquisitions = 0;
+        if (++acquisitions < rate) {
+            return false;
+        }
+        acquisitions = 0;
+        return true;
+    }
+
+    /// Record a sampled acquisition of site.
+    static void recordAcquire(Site site,
+                              bool contended,
+                              std::chrono::steady_clock::duration wait);
+
+    /// Record how long a sampled acquisition of site held the lock.
+    static void recordHold(Site site, std::chrono::steady_clock::duration held);
+
+    /// Add the per-site profile (samples, contended, wait & hold times).
+    static void addStats(const AddStatFn& add_stat, const void* cookie);
+
+    /// Clear all recorded samples (used by tests).
+    static void reset();
+
+private:
+    static std::atomic<size_t> sampleRate;
+};
+
+/**
+ * How to test whether a lock holder of type T could acquire its mutex
+ * without waiting: try-lock (and immediately release) it in the same mode
+ * the holder will take it.
+ */
+template <typename T>
+struct LockProfilerProbe {
+    template <typename Mutex>
+    static bool isFree(Mutex& m) {
+        if (m.try_lock()) {
+            m.unlock();
+            return true;
+        }
+        return false;
+    }
+};
+
+template <>
+struct LockProfilerProbe<folly::SharedMutex::ReadHolder> {
+    static bool isFree(folly::SharedMutex& m) {
+        if (m.try_lock_shared()) {
+            m.unlock_shared();
+            return true;
+        }
+        return false;
+    }
+};
+
+/**
+ * One (possibly) sampled acquisition of a profiled lock. Inactive unless
+ * LockProfiler::shouldSample() selected it, in which case it records the
+ * wait when acquired() is called and the hold time when released() is.
+ */
+class LockProfileSample {
+public:
+    LockProfileSample() = default;
+
+    /**
+     * Begin an acquisition of m at site by a lock holder of type T. Must be
+     * called before the lock is taken.
+     */
+    template <typename T, typename Mutex>
+    static LockProfileSample begin(LockProfiler::Site site, Mutex& m) {
+        LockProfileSample sample;
+        if (LockProfiler::shouldSample()) {
+            sample.active = true;
+            sample.site = site;
+            sample.contended = !LockProfilerProbe<T>::isFree(m);
+            sample.start = std::chrono::steady_clock::now();
+        }
+        return sample;
+    }
+
+    LockProfileSample(LockProfileSample&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    LockProfileSample& operator=(LockProfileSample&& other) noexcept {
+        active = other.active;
+        contended = other.contended;
+        site = other.site;
+        start = other.start;
+        other.active = false;
+        return *this;
+    }
+
+    /// The lock has been acquired.
+    void acquired() {
+        if (active) {
+            const auto now = std::chrono::steady_clock::now();
+            LockProfiler::recordAcquire(site, contended, now - start);
+            start = now;
+        }
+    }
+
+    /// The lock is about to be released.
+    void released() {
+        if (active) {
+            LockProfiler::recordHold(site,
+                                     std::chrono::steady_clock::now() - start);
+            active = false;
+        }
+    }
+
+private:
+    bool active = false;
+    bool contended = false;
+    LockProfiler::Site site = LockProfiler::Site::HashTable;
+    // When the acquisition started; once acquired, when the lock was taken.
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * RAII lock holder wrapper which profiles the acquisition at lock site Site
+ * (when sampled). Wraps the underlying lock holder type T (LockHolder,
+ * std::unique_lock, folly::SharedMutex::ReadHolder) and converts to it, so
+ * it can be passed to the *_UNLOCKED functions which take the holder as
+ * proof of locking:
+ *
+ *   LockHolder lh(queueLock);
+ *
+ * becomes:
+ *
+ *   ProfiledLockHolder<LockHolder, LockProfiler::Site::CheckpointQueue> lh(
+ *           queueLock);
+ *
+ * (typically via a per-class alias). The hold time covers the lifetime of
+ * the holder, or until unlock().
+ */
+template <typename T, LockProfiler::Site Site>
+class ProfiledLockHolder {
+public:
+    template <typename Mutex>
+    explicit ProfiledLockHolder(Mutex& m)
+        : sample(LockProfileSample::begin<T>(Site, m)), lock_holder(m) {
+        sample.acquired();
+    }
+
+    ~ProfiledLockHolder() {
+        sample.released();
+    }
+
+    ProfiledLockHolder(const ProfiledLockHolder&) = delete;
+    ProfiledLockHolder& operator=(const ProfiledLockHolder&) = delete;
+
+    /* explicitly unlock the lock */
+    void unlock() {
+        sample.released();
+        lock_holder.unlock();
+    }
+
+    T& get() {
+        return lock_holder;
+    }
+
+    operator T&() {
+        return lock_holder;
+    }
+
+    operator const T&() const {
+        return lock_holder;
+    }
+
+private:
+    LockProfileSample sample;
+
+    // The underlying 'real' lock holder we are wrapping.
+    T lock_holder;
+};
@@ -17,11 +17,21 @@
 #pragma once
 
 #include "utility.h"
+
+#include <folly/CachelinePadded.h>
+
 #include <mutex>
 #include <vector>
 
 using LockHolder = std::lock_guard<std::mutex>;
 
+/**
+ * A set of striped locks, each padded to its own cacheline(s) so that
+ * threads contending on neighbouring stripes don't also contend on the
+ * cacheline holding them.
+ */
+using StripedMutexes = std::vector<folly::CachelinePadded<std::mutex>>;
+
 /**
  * RAII lock holder over multiple locks.
  */
@@ -33,7 +43,7 @@ public:
      *
      * @param m reference to a vector of locks
      */
-    MultiLockHolder(std::vector<std::mutex>& m)
+    MultiLockHolder(StripedMutexes& m)
         : mutexes(m) {
         lock();
     }
@@ -48,7 +58,7 @@ private:
      */
     void lock() {
         for (auto& m : mutexes) {
-            m.lock();
+            m->lock();
         }
     }
 
@@ -57,11 +67,11 @@ private:
      */
     void unlock() {
         for (auto& m : mutexes) {
-            m.unlock();
+            m->unlock();
         }
     }
 
-    std::vector<std::mutex>& mutexes;
+    StripedMutexes& mutexes;
 
     DISALLOW_COPY_AND_ASSIGN(MultiLockHolder);
 };
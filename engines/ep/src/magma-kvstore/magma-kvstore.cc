@@ -518,6 +518,7 @@ MagmaKVStore::MagmaKVStore(MagmaKVStoreConfig& configuration)
       magmaPath(configuration.getDBName() + "/magma." +
                 std::to_string(configuration.getShardId())),
       scanCounter(0),
+      valueSeparationSize(configuration.getMagmaValueSeparationSize()),
       cachedMagmaInfo(configuration.getMaxVBuckets()),
       compaction_ctxList(configuration.getMaxVBuckets()) {
     const size_t memtablesQuota = configuration.getBucketQuota() /
@@ -1299,6 +1300,27 @@ std::unique_ptr<Item> MagmaKVStore::makeItem(Vbid vb,
                            meta.to_string(meta.getOperation()));
 }
 
+bool MagmaKVStore::getStat(const char* name, size_t& value) {
+    if (strcmp("magma_write_batches", name) == 0) {
+        value = writeStats.batches;
+    } else if (strcmp("magma_write_items", name) == 0) {
+        value = writeStats.items;
+    } else if (strcmp("magma_write_bytes", name) == 0) {
+        value = writeStats.bytes;
+    } else if (strcmp("magma_value_log_write_bytes", name) == 0) {
+        value = writeStats.valueLogBytes;
+    } else if (strcmp("magma_write_cache_releases", name) == 0) {
+        value = writeStats.writeCacheReleases;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void MagmaKVStore::releaseWriteBufferMemory() {
+    writeCacheReleaseRequested = true;
+}
+
 GetValue MagmaKVStore::makeGetValue(Vbid vb,
                                     const Slice& keySlice,
                                     const Slice& metaSlice,
@@ -1336,14 +1358,22 @@ int MagmaKVStore::saveDocs(Collections::VB::Flush& collectionsFlush,
     }
 
     auto begin = std::chrono::steady_clock::now();
+    size_t batchBytes = 0;
+    size_t batchValueLogBytes = 0;
 
     for (auto& req : *pendingReqs) {
+        // The slices refer directly to the request's key, metadata and
+        // (refcounted) value; the requests outlive the batch.
         Slice key = Slice{req.getKey(), req.getKeyLen()};
-        auto docMeta = req.getDocMeta();
-        Slice meta = Slice{reinterpret_cast<char*>(&docMeta),
-                           sizeof(magmakv::MetaData)};
+        Slice meta = Slice{reinterpret_cast<char*>(&req.getDocMeta()),
+                           req.getMetaSize()};
         Slice value = Slice{req.getBodyData(), req.getBodySize()};
 
+        batchBytes += key.Size() + meta.Size() + value.Size();
+        if (value.Size() >= valueSeparationSize) {
+            batchValueLogBytes += value.Size();
+        }
+
         if (req.getDocMeta().bySeqno > lastSeqno) {
             lastSeqno = req.getDocMeta().bySeqno;
         }
@@ -1478,12 +1508,32 @@ int MagmaKVStore::saveDocs(Collections::VB::Flush& collectionsFlush,
                     "MagmaKVStore::saveDocs: SyncCommitBatches {} status:{}",
                     vbid,
                     status.String());
+        } else if (writeCacheReleaseRequested.exchange(false)) {
+            // The write cache is sized from the bucket quota but its memory
+            // counts towards mem_used. With the bucket over its high
+            // watermark, persist the memtables now so the memory goes back
+            // to the bucket rather than forcing the pager to evict.
+            status = magma->Sync();
+            if (!status) {
+                logger->warn("MagmaKVStore::saveDocs: Sync {} status:{}",
+                             vbid,
+                             status.String());
+            } else {
+                ++writeStats.writeCacheReleases;
+            }
         }
     }
 
     st.commitHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
             std::chrono::steady_clock::now() - begin));
 
+    if (status) {
+        ++writeStats.batches;
+        writeStats.items += pendingReqs->size();
+        writeStats.bytes += batchBytes;
+        writeStats.valueLogBytes += batchValueLogBytes;
+    }
+
     return status.ErrorCode();
 }
 
@@ -1983,7 +2033,7 @@ ENGINE_ERROR_CODE MagmaKVStore::getAllKeys(
         Vbid vbid,
         const DiskDocKey& startKey,
         uint32_t count,
-        std::shared_ptr<Callback<const DiskDocKey&>> cb) {
+        std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) {
     auto kvHandle = getMagmaKVHandle(vbid);
 
     Slice startKeySlice = {reinterpret_cast<const char*>(startKey.data()),
@@ -2008,7 +2058,9 @@ ENGINE_ERROR_CODE MagmaKVStore::getAllKeys(
                     isDeleted(metaSlice));
         }
 
-        if (isDeleted(metaSlice)) {
+        // GetRange can't be cancelled; skip the remaining keys once the
+        // callback doesn't want any more
+        if (isDeleted(metaSlice) || cb->getStatus() != ENGINE_SUCCESS) {
             return;
         }
         auto retKey = makeDiskDocKey(keySlice);
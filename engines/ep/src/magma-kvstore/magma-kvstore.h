@@ -27,6 +27,7 @@
 
 #include <platform/dirutils.h>
 #include <platform/non_negative_counter.h>
+#include <relaxed_atomic.h>
 
 #include <map>
 #include <shared_mutex>
@@ -124,6 +125,10 @@ public:
 
     std::vector<vbucket_state*> listPersistedVbuckets(void) override;
 
+    bool getStat(const char* name, size_t& value) override;
+
+    void releaseWriteBufferMemory() override;
+
     /**
      * Take a snapshot of the stats in the main DB.
      */
@@ -209,7 +214,7 @@ public:
             Vbid vbid,
             const DiskDocKey& start_key,
             uint32_t count,
-            std::shared_ptr<Callback<const DiskDocKey&>> cb) override;
+            std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) override;
 
     ScanContext* initScanContext(
             std::shared_ptr<StatusCallback<GetValue>> cb,
@@ -521,6 +526,31 @@ private:
 
     std::atomic<size_t> scanCounter; // atomic counter for generating scan id
 
+    // Values of at least this size are stored by Magma in its value log,
+    // separately from the key index (magma_value_separation_size).
+    const size_t valueSeparationSize;
+
+    /**
+     * Volume of the writes handed to Magma by saveDocs. Every item is
+     * written to the WAL (and then the key index); values of at least
+     * valueSeparationSize also go to the value log. These are logical
+     * (uncompressed, pre-Magma) bytes, without Magma's own overheads.
+     */
+    struct WriteStats {
+        cb::RelaxedAtomic<size_t> batches{0};
+        cb::RelaxedAtomic<size_t> items{0};
+        // Key, metadata and value bytes of all items.
+        cb::RelaxedAtomic<size_t> bytes{0};
+        // Value bytes of the items whose values are separated.
+        cb::RelaxedAtomic<size_t> valueLogBytes{0};
+        // Times the write cache was persisted early to release its memory.
+        cb::RelaxedAtomic<size_t> writeCacheReleases{0};
+    } writeStats;
+
+    // Set when the bucket is short of memory; the next commit persists the
+    // write cache rather than waiting for it to fill.
+    std::atomic<bool> writeCacheReleaseRequested{false};
+
     // Magma does not keep track of docCount, # of persistedDeletes or
     // revFile internal so we need a mechanism to do that. We use magmaInfo
     // as the structure to store that and we save magmaInfo with the vbstate.
@@ -16,6 +16,7 @@
  */
 
 #include <fcntl.h>
+#include <platform/crc32c.h>
 #include <platform/dirutils.h>
 #include <platform/strerror.h>
 #include <sys/stat.h>
@@ -251,6 +252,15 @@ static bool writeFully(file_handle_t fd, const uint8_t *buf, size_t nbytes) {
     return true;
 }
 
+uint16_t MutationLog::blockChecksum(MutationLogVersion version,
+                                    const uint8_t* data,
+                                    size_t len) {
+    const uint32_t crc = version >= MutationLogVersion::V5
+                                 ? crc32c(data, len, 0)
+                                 : crc32buf(const_cast<uint8_t*>(data), len);
+    return crc & 0xffff;
+}
+
 MutationLog::MutationLog(const std::string& path, const size_t bs)
     : logPath(path),
       blockSize(bs),
@@ -303,6 +313,8 @@ void MutationLog::sync() {
         throw std::logic_error("MutationLog::sync: Not valid on a closed log");
     }
 
+    writeBufferedBlocks();
+
     HdrMicroSecBlockTimer timer(&syncTimeHisto);
     try {
         doFsync(file);
@@ -402,6 +414,8 @@ void MutationLog::readInitialBlock() {
     case MutationLogVersion::V1:
     case MutationLogVersion::V2:
     case MutationLogVersion::V3:
+    case MutationLogVersion::V4:
+    case MutationLogVersion::V5:
         break;
     default: {
         std::stringstream ss;
@@ -670,14 +684,25 @@ bool MutationLog::flush() {
         entries = htons(entries);
         memcpy(blockBuffer.get() + 2, &entries, sizeof(entries));
 
-        uint32_t crc32(crc32buf(blockBuffer.get() + 2, blockSize - 2));
-        uint16_t crc16(htons(crc32 & 0xffff));
+        uint16_t crc16(htons(blockChecksum(
+                headerBlock.version(), blockBuffer.get() + 2, blockSize - 2)));
         memcpy(blockBuffer.get(), &crc16, sizeof(crc16));
 
-        if (writeFully(file, blockBuffer.get(), blockSize)) {
+        if (writeBufferSize > blockSize) {
+            writeBuffer.insert(writeBuffer.end(),
+                               blockBuffer.get(),
+                               blockBuffer.get() + blockSize);
+            blockPos = HEADER_RESERVED;
+            entries = 0;
+            previousKey.clear();
+            if (writeBuffer.size() >= writeBufferSize) {
+                return writeBufferedBlocks();
+            }
+        } else if (writeFully(file, blockBuffer.get(), blockSize)) {
             logSize.fetch_add(blockSize);
             blockPos = HEADER_RESERVED;
             entries = 0;
+            previousKey.clear();
         } else {
             /* write to the mutation log failed. Disable the log */
             disabled = true;
@@ -689,6 +714,24 @@ bool MutationLog::flush() {
     return true;
 }
 
+bool MutationLog::writeBufferedBlocks() {
+    if (writeBuffer.empty() || disabled) {
+        return !disabled;
+    }
+
+    const bool success =
+            writeFully(file, writeBuffer.data(), writeBuffer.size());
+    if (success) {
+        logSize.fetch_add(writeBuffer.size());
+    } else {
+        /* write to the mutation log failed. Disable the log */
+        disabled = true;
+        EP_LOG_WARN("Disabling access log due to write failures");
+    }
+    writeBuffer.clear();
+    return success;
+}
+
 void MutationLog::writeEntry(MutationLogEntry *mle) {
     if (mle->len() >= blockSize) {
         throw std::invalid_argument("MutationLog::writeEntry: argument mle "
@@ -706,13 +749,28 @@ void MutationLog::writeEntry(MutationLogEntry *mle) {
     }
     needWriteAccess();
 
-    size_t len(mle->len());
-    if (blockPos + len > blockSize) {
-        flush();
+    // A log written before V4 (being appended to) keeps its own layout.
+    if (headerBlock.version() < MutationLogVersion::V4) {
+        size_t len(mle->len());
+        if (blockPos + len > blockSize) {
+            flush();
+        }
+        memcpy(blockBuffer.get() + blockPos, mle, len);
+        blockPos += len;
+    } else {
+        const cb::const_byte_buffer previous{previousKey.data(),
+                                             previousKey.size()};
+        if (blockPos + MutationLogEntryV4::len(*mle, previous) > blockSize) {
+            flush();
+            blockPos += MutationLogEntryV4::encode(
+                    blockBuffer.get() + blockPos, *mle, {});
+        } else {
+            blockPos += MutationLogEntryV4::encode(
+                    blockBuffer.get() + blockPos, *mle, previous);
+        }
+        previousKey.assign(mle->key().data(),
+                           mle->key().data() + mle->key().size());
     }
-
-    memcpy(blockBuffer.get() + blockPos, mle, len);
-    blockPos += len;
     ++entries;
 
     ++itemsLogged[int(mle->type())];
@@ -776,6 +834,23 @@ void MutationLog::iterator::prepItem() {
                 MutationLogEntryV3::newEntry(p, bufferBytesRemaining())->len();
         break;
     }
+    case MutationLogVersion::V4:
+    case MutationLogVersion::V5: {
+        // V4 keys are encoded against the previous entry in the block, which
+        // (unless this is the first entry of the block) is still in entryBuf.
+        const auto* mle =
+                MutationLogEntryV4::newEntry(p, bufferBytesRemaining());
+        cb::const_byte_buffer previous;
+        if (!entryBuf.empty()) {
+            const auto& key = MutationLogEntryV3::newEntry(entryBuf.begin(),
+                                                           entryBuf.size())
+                                      ->key();
+            previous = {key.data(), key.size()};
+        }
+        entryBuf.resize(LOG_ENTRY_BUF_SIZE);
+        mle->decode(entryBuf.data(), previous);
+        return;
+    }
     }
 
     entryBuf.resize(LOG_ENTRY_BUF_SIZE);
@@ -796,6 +871,12 @@ size_t MutationLog::iterator::getCurrentEntryLen() const {
         return MutationLogEntryV3::newEntry(entryBuf.begin(), entryBuf.size())
                 ->len();
     }
+    case MutationLogVersion::V4:
+    case MutationLogVersion::V5: {
+        // entryBuf holds the decoded entry; the encoded one is at p.
+        return MutationLogEntryV4::newEntry(p, buf.size() - (p - buf.begin()))
+                ->len();
+    }
     }
     throw std::logic_error(
             "MutationLog::iterator::getCurrentEntryLen unknown version " +
@@ -854,16 +935,12 @@ MutationLog::MutationLogEntryHolder MutationLog::iterator::upgradeEntry()
         mleV2 = MutationLogEntryV2::newEntry(entryBuf.begin(), entryBuf.size());
         break;
     }
-    /* If V4 exists then add a case for V3, for example:
-    case MutationLogVersion::V3: {
-        mleV3 = MutationLogEntryV3::newEntry(entryBuf.begin(), entryBuf.size());
-        break;
-    }
-    */
-    case MutationLogVersion::Current: {
+    case MutationLogVersion::V3:
+    case MutationLogVersion::V4:
+    case MutationLogVersion::V5: {
         throw std::invalid_argument(
                 "MutationLog::iterator::upgradeEntry cannot"
-                " upgrade if version == current");
+                " upgrade if version >= V3 (the in-memory layout)");
     }
     }
 
@@ -908,18 +985,13 @@ MutationLog::MutationLogEntryHolder MutationLog::iterator::upgradeEntry()
 
         // fall through
     }
-        /* If V4 exists then add a case (which is hit by V3 falling through)
-        case MutationLogVersion::V4: {
-            // Upgrade V3 to V4
-            // Alloc a buffer using the length read from V3 as input to V4::len
-            allocated = std::make_unique<uint8_t[]>(
-                    MutationLogEntryV4::len(mleV3->getKeylen()));
-
-            // Now in-place construct into the new buffer and assign to mleV4
-            mleV4 = new (allocated.get()) MutationLogEntryV3(*mleV3);
-            // fall through
-        }
-        */
+    case MutationLogVersion::V4:
+    case MutationLogVersion::V5: {
+        // V4 is only an on-disk encoding of V3 (decoded by prepItem), and V5
+        // only changes the block checksum, so there's no upgrade step beyond
+        // V3.
+        break;
+    }
     }
 
     // transfer ownership to the MutationLogEntryHolder and mark that it's
@@ -928,8 +1000,9 @@ MutationLog::MutationLogEntryHolder MutationLog::iterator::upgradeEntry()
 }
 
 MutationLog::MutationLogEntryHolder MutationLog::iterator::operator*() {
-    // If the file version is down-level return an upgraded entry
-    if (log->headerBlock.version() != MutationLogVersion::Current) {
+    // If the file version is down-level return an upgraded entry. V4 entries
+    // are decoded into the V3 layout by prepItem.
+    if (log->headerBlock.version() < MutationLogVersion::V3) {
         return upgradeEntry();
     } else {
         return {entryBuf.data(), false /*not allocated*/};
@@ -963,8 +1036,9 @@ void MutationLog::iterator::nextBlock() {
     offset += bytesread;
 
     // block starts with 2 byte crc and 2 byte item count
-    uint32_t crc32(crc32buf(buf.data() + sizeof(uint16_t), buf.size() - sizeof(uint16_t)));
-    uint16_t computed_crc16(crc32 & 0xffff);
+    uint16_t computed_crc16(blockChecksum(log->headerBlock.version(),
+                                          buf.data() + sizeof(uint16_t),
+                                          buf.size() - sizeof(uint16_t)));
     uint16_t retrieved_crc16;
     memcpy(&retrieved_crc16, buf.data(), sizeof(retrieved_crc16));
     retrieved_crc16 = ntohs(retrieved_crc16);
@@ -982,6 +1056,9 @@ void MutationLog::iterator::nextBlock() {
     // the first item.
     p = buf.begin() + sizeof(uint16_t) + sizeof(uint16_t);
 
+    // There's no previous entry for the first entry of a block.
+    entryBuf.clear();
+
     prepItem();
 }
 
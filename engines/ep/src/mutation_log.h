@@ -73,7 +73,15 @@ const int MUTATION_LOG_COMPACTOR_FREQ(3600);
 const size_t MIN_LOG_HEADER_SIZE(4096);
 const size_t HEADER_RESERVED(4);
 
-enum class MutationLogVersion { V1 = 1, V2 = 2, V3 = 3, Current = V3 };
+enum class MutationLogVersion {
+    V1 = 1,
+    V2 = 2,
+    V3 = 3,
+    V4 = 4,
+    // V4 entries; blocks checksummed with CRC32C rather than CRC32.
+    V5 = 5,
+    Current = V5
+};
 
 const size_t LOG_ENTRY_BUF_SIZE(512);
 
@@ -216,10 +224,41 @@ public:
 
     void commit2();
 
+    /**
+     * Complete the current block. The block is written to the file
+     * immediately, or appended to the write buffer if one is configured
+     * (see setWriteBufferSize).
+     *
+     * @return false if we failed to write to the file (the log is disabled)
+     */
     bool flush();
 
+    /// Write any buffered blocks and sync the file
     void sync();
 
+    /**
+     * Buffer the completed blocks and write them to the file in writes of
+     * (at least) the given size (instead of one write per block), when the
+     * buffer is full or the log is synced.
+     *
+     * @param size the size of the writes in bytes (0 writes every block as
+     *             soon as it's completed)
+     */
+    void setWriteBufferSize(size_t size) {
+        writeBufferSize = size;
+    }
+
+    /**
+     * @return the checksum stored at the start of a block of a log of the
+     *         given version (the low 16 bits of the CRC of the rest of the
+     *         block). V5 uses CRC32C, computed with the CPU's CRC
+     *         instructions where available; earlier versions the table-driven
+     *         CRC32.
+     */
+    static uint16_t blockChecksum(MutationLogVersion version,
+                                  const uint8_t* data,
+                                  size_t len);
+
     void disable();
 
     bool isEnabled() const {
@@ -446,6 +485,9 @@ private:
     }
     void writeEntry(MutationLogEntry *mle);
 
+    /// Write the blocks in the write buffer to the file
+    bool writeBufferedBlocks();
+
     bool writeInitialBlock();
     void readInitialBlock();
     void updateInitialBlock(void);
@@ -463,8 +505,15 @@ private:
     uint16_t           entries;
     std::unique_ptr<uint8_t[]> entryBuffer;
     std::unique_ptr<uint8_t[]> blockBuffer;
+    //! Key of the last entry written to the current block (V4 encodes
+    //! each key against it).
+    std::vector<uint8_t> previousKey;
     uint8_t            syncConfig;
     bool               readOnly;
+    //! Completed blocks which haven't been written to the file yet
+    std::vector<uint8_t> writeBuffer;
+    //! Write the buffered blocks once the buffer reaches this size
+    size_t             writeBufferSize = 0;
 
     friend std::ostream& operator<<(std::ostream& os, const MutationLog& mlog);
 
@@ -20,7 +20,12 @@
 #include "storeddockey.h"
 #include "utility.h"
 
+#include <gsl/gsl>
 #include <memcached/vbucket.h>
+#include <platform/sized_buffer.h>
+
+#include <algorithm>
+#include <limits>
 #include <type_traits>
 
 enum class MutationLogType : uint8_t {
@@ -455,6 +460,195 @@ private:
                   "_type must be a uint8_t");
 };
 
+/**
+ * An entry in the MutationLog.
+ * This is the V4 layout, in which each key is delta-encoded against the key
+ * of the previous entry in the same block: only the length of the prefix
+ * the two keys share and the remaining suffix are stored. The access log is
+ * written sorted by key within each vBucket, so neighbouring keys typically
+ * share most of their bytes.
+ *
+ * V4 is only an on-disk encoding; entries are decoded into the V3 layout,
+ * which remains the in-memory MutationLogEntry.
+ */
+class MutationLogEntryV4 {
+public:
+    static const uint8_t MagicMarker = 0x48;
+
+    /**
+     * Encode the given entry into buf.
+     *
+     * @param buf buffer of at least len(entry, previous) bytes
+     * @param entry the entry to encode
+     * @param previous the key of the previous entry in the block (empty if
+     *        this is the first)
+     * @return the number of bytes written
+     */
+    static size_t encode(uint8_t* buf,
+                         const MutationLogEntryV3& entry,
+                         cb::const_byte_buffer previous) {
+        const auto& key = entry.key();
+        const auto shared = sharedPrefix(key, previous);
+        auto* me = new (buf) MutationLogEntryV4(
+                entry.type(),
+                entry.vbucket(),
+                gsl::narrow_cast<uint8_t>(shared),
+                gsl::narrow_cast<uint8_t>(key.size() - shared));
+        std::copy(key.data() + shared,
+                  key.data() + key.size(),
+                  buf + sizeof(MutationLogEntryV4));
+        return me->len();
+    }
+
+    /**
+     * Initialize a new entry using the contents of the given buffer.
+     *
+     * @param buf a chunk of memory thought to contain a valid
+     *        MutationLogEntryV4
+     * @param buflen the length of said buf
+     */
+    static const MutationLogEntryV4* newEntry(
+            std::vector<uint8_t>::const_iterator itr, size_t buflen) {
+        if (buflen < len(0)) {
+            throw std::invalid_argument(
+                    "MutationLogEntryV4::newEntry: buflen "
+                    "(which is " +
+                    std::to_string(buflen) +
+                    ") is less than minimum required (which is " +
+                    std::to_string(len(0)) + ")");
+        }
+
+        const auto* me = reinterpret_cast<const MutationLogEntryV4*>(&(*itr));
+
+        if (me->magic != MagicMarker) {
+            throw std::invalid_argument(
+                    "MutationLogEntryV4::newEntry: "
+                    "magic (which is " +
+                    std::to_string(me->magic) + ") is not equal to " +
+                    std::to_string(MagicMarker));
+        }
+        if (me->len() > buflen) {
+            throw std::invalid_argument(
+                    "MutationLogEntryV4::newEntry: "
+                    "entry length (which is " +
+                    std::to_string(me->len()) +
+                    ") is greater than available buflen (which is " +
+                    std::to_string(buflen) + ")");
+        }
+        return me;
+    }
+
+    // Statically buffered.  There is no delete.
+    void operator delete(void*) = delete;
+
+    /**
+     * The size of a MutationLogEntryV4, in bytes, storing a key suffix of
+     * the specified length.
+     */
+    static size_t len(size_t suffixlen) {
+        return sizeof(MutationLogEntryV4) + suffixlen;
+    }
+
+    /// The size the given entry would be encoded to.
+    static size_t len(const MutationLogEntryV3& entry,
+                      cb::const_byte_buffer previous) {
+        return len(entry.key().size() - sharedPrefix(entry.key(), previous));
+    }
+
+    /**
+     * The number of bytes of the serialized form of this
+     * MutationLogEntryV4.
+     */
+    size_t len() const {
+        return len(suffixlen);
+    }
+
+    /**
+     * Decode this entry into a MutationLogEntryV3 in buf.
+     *
+     * @param buf buffer of at least MutationLogEntryV3::len(255) bytes; may
+     *        hold the previous entry, as the previous key is copied first.
+     * @param previous the key of the previous entry in the block
+     */
+    void decode(uint8_t* buf, cb::const_byte_buffer previous) const {
+        if (shared > previous.size()) {
+            throw std::invalid_argument(
+                    "MutationLogEntryV4::decode: shared prefix "
+                    "(which is " +
+                    std::to_string(shared) +
+                    ") is longer than the previous key (which is " +
+                    std::to_string(previous.size()) + ")");
+        }
+        const size_t keylen = size_t(shared) + suffixlen;
+        if (keylen > std::numeric_limits<uint8_t>::max()) {
+            throw std::invalid_argument(
+                    "MutationLogEntryV4::decode: key length (which is " +
+                    std::to_string(keylen) + ") is greater than " +
+                    std::to_string(std::numeric_limits<uint8_t>::max()));
+        }
+        uint8_t key[std::numeric_limits<uint8_t>::max()];
+        std::copy_n(previous.data(), shared, key);
+        std::copy_n(reinterpret_cast<const uint8_t*>(this + 1),
+                    suffixlen,
+                    key + shared);
+
+        if (_type == MutationLogType::New) {
+            MutationLogEntryV3::newEntry(
+                    buf,
+                    _type,
+                    vbucket(),
+                    {key, keylen, DocKeyEncodesCollectionId::Yes});
+        } else {
+            MutationLogEntryV3::newEntry(buf, _type, vbucket());
+        }
+    }
+
+    /**
+     * This entry's vbucket.
+     */
+    Vbid vbucket() const {
+        return _vbucket.ntoh();
+    }
+
+    /**
+     * The type of this log entry.
+     */
+    MutationLogType type() const {
+        return _type;
+    }
+
+private:
+    MutationLogEntryV4(MutationLogType t,
+                       Vbid vb,
+                       uint8_t shared,
+                       uint8_t suffixlen)
+        : _vbucket(vb.hton()),
+          magic(MagicMarker),
+          _type(t),
+          shared(shared),
+          suffixlen(suffixlen) {
+    }
+
+    static size_t sharedPrefix(const SerialisedDocKey& key,
+                               cb::const_byte_buffer previous) {
+        const size_t max = std::min(key.size(), previous.size());
+        size_t shared = 0;
+        while (shared < max && key.data()[shared] == previous[shared]) {
+            ++shared;
+        }
+        return shared;
+    }
+
+    const Vbid _vbucket;
+    const uint8_t magic;
+    const MutationLogType _type;
+    const uint8_t shared;
+    const uint8_t suffixlen;
+    // followed by suffixlen bytes of key
+
+    DISALLOW_COPY_AND_ASSIGN(MutationLogEntryV4);
+};
+
 using MutationLogEntry = MutationLogEntryV3;
 
 std::ostream& operator<<(std::ostream& out, const MutationLogEntryV1& mle);
@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "negative_lookup_cache.h"
+
+#include "key_directory.h"
+
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+/// @return the number of sets each shard needs for the given capacity
+static size_t calculateSetsPerShard(size_t capacity, size_t shards) {
+    if (shards == 0) {
+        throw std::invalid_argument(
+                "NegativeLookupCache::NegativeLookupCache: shards must be "
+                "non-zero");
+    }
+    const auto perSet = shards * NegativeLookupCache::Ways;
+    return folly::nextPowTwo(
+            std::max(size_t(1), (capacity + perSet - 1) / perSet));
+}
+
+NegativeLookupCache::NegativeLookupCache(size_t capacity, size_t shards)
+    : numShards(shards),
+      setsPerShard(calculateSetsPerShard(capacity, shards)),
+      shards(new Shard[shards]) {
+    for (size_t ii = 0; ii < numShards; ++ii) {
+        this->shards[ii].slots.resize(setsPerShard * Ways, Empty);
+    }
+}
+
+void NegativeLookupCache::insert(const DocKey& key) {
+    const auto fp = KeyDirectory::fingerprint(key);
+    auto& shard = getShard(fp);
+    const auto set = getSet(fp);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    uint64_t* unused = nullptr;
+    for (size_t way = 0; way < Ways; ++way) {
+        auto& slot = shard.slots[set + way];
+        if (slot == fp) {
+            return;
+        }
+        if (slot == Empty && !unused) {
+            unused = &slot;
+        }
+    }
+
+    if (unused) {
+        *unused = fp;
+        ++numEntries;
+    } else {
+        // Set is full - replace one of the existing keys
+        shard.slots[set + (shard.nextVictim++ % Ways)] = fp;
+    }
+}
+
+void NegativeLookupCache::erase(const DocKey& key) {
+    const auto fp = KeyDirectory::fingerprint(key);
+    auto& shard = getShard(fp);
+    const auto set = getSet(fp);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    for (size_t way = 0; way < Ways; ++way) {
+        if (shard.slots[set + way] == fp) {
+            shard.slots[set + way] = Empty;
+            --numEntries;
+            return;
+        }
+    }
+}
+
+bool NegativeLookupCache::contains(const DocKey& key) const {
+    const auto fp = KeyDirectory::fingerprint(key);
+    auto& shard = getShard(fp);
+    const auto set = getSet(fp);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    for (size_t way = 0; way < Ways; ++way) {
+        if (shard.slots[set + way] == fp) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void NegativeLookupCache::clear() {
+    for (size_t ii = 0; ii < numShards; ++ii) {
+        auto& shard = shards[ii];
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        for (auto& slot : shard.slots) {
+            if (slot != Empty) {
+                slot = Empty;
+                --numEntries;
+            }
+        }
+    }
+}
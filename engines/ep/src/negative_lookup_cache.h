@@ -0,0 +1,121 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <memcached/dockey.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * A bounded cache of keys known not to exist on disk, for a full-eviction
+ * VBucket.
+ *
+ * When a background fetch finds no document (not even a deletion) for a key
+ * the miss is recorded here, so the temporary StoredValue created for the
+ * fetch can be removed from the HashTable straight away; subsequent lookups
+ * of the key are answered from the cache without a bloom filter check or
+ * disk lookup. An entry is removed as soon as a StoredValue for the key is
+ * added back to the HashTable, so a hit is only valid while the caller
+ * holds the HashBucketLock for the key.
+ *
+ * Only a 64bit fingerprint of the key is stored (see
+ * KeyDirectory::fingerprint()); two keys with the same fingerprint cannot
+ * be told apart, which with a 64bit fingerprint is vanishingly unlikely.
+ *
+ * The cache is split into a number of independently locked shards, each a
+ * fixed size set-associative table; when a set is full the next entry
+ * replaces one of its existing entries in round-robin order, so the memory
+ * used is fixed at construction.
+ */
+class NegativeLookupCache {
+public:
+    /// Default number of shards
+    static constexpr size_t DefaultShards = 16;
+    /// Number of entries in each set
+    static constexpr size_t Ways = 4;
+
+    /**
+     * @param capacity the (minimum) number of keys the cache can hold
+     * @param shards the number of independently locked shards
+     */
+    explicit NegativeLookupCache(size_t capacity,
+                                 size_t shards = DefaultShards);
+
+    NegativeLookupCache(const NegativeLookupCache&) = delete;
+    NegativeLookupCache& operator=(const NegativeLookupCache&) = delete;
+
+    /// Record that the given key doesn't exist
+    void insert(const DocKey& key);
+
+    /// Remove the given key (if present)
+    void erase(const DocKey& key);
+
+    /// @return true if the given key is recorded as not existing
+    bool contains(const DocKey& key) const;
+
+    /// Remove all keys
+    void clear();
+
+    /// @return the number of keys in the cache
+    size_t size() const {
+        return numEntries.load();
+    }
+
+    /// @return the maximum number of keys the cache can hold
+    size_t getCapacity() const {
+        return numShards * setsPerShard * Ways;
+    }
+
+    /// @return the number of bytes allocated for the cache
+    size_t memorySize() const {
+        return sizeof(NegativeLookupCache) +
+               numShards * (sizeof(Shard) + setsPerShard * Ways *
+                                                    sizeof(uint64_t));
+    }
+
+private:
+    /// Fingerprint value which marks an unused slot
+    static constexpr uint64_t Empty = 0;
+
+    struct Shard {
+        std::mutex mutex;
+        std::vector<uint64_t> slots;
+        /// Way to replace next when inserting into a full set
+        size_t nextVictim = 0;
+    };
+
+    Shard& getShard(uint64_t fp) const {
+        // The low bits select the set within the shard
+        return shards[(fp >> 48) % numShards];
+    }
+
+    /// @return the index of the first slot of the set for the fingerprint
+    size_t getSet(uint64_t fp) const {
+        return (fp & (setsPerShard - 1)) * Ways;
+    }
+
+    const size_t numShards;
+    const size_t setsPerShard;
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<size_t> numEntries{0};
+};
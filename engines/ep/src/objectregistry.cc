@@ -33,6 +33,10 @@ extern "C" {
 }
 
 static get_allocation_size getAllocSize = defaultGetAllocSize;
+static set_thread_arena setThreadArena = nullptr;
+
+/// Number of engines with their own allocator arena.
+static std::atomic<int> arenaEngines{0};
 
 
 
@@ -68,12 +72,26 @@ static bool verifyEngine(EventuallyPersistentEngine *engine)
    return true;
 }
 
-void ObjectRegistry::initialize(get_allocation_size func) {
+/**
+ * Direct the calling thread's allocations to the given engine's arena (or
+ * the default arena if the engine doesn't have one).
+ */
+static void switchArena(EventuallyPersistentEngine* engine) {
+    if (arenaEngines.load(std::memory_order_relaxed) == 0 || !setThreadArena) {
+        return;
+    }
+    setThreadArena(engine ? engine->getEpStats().getMemoryArena() : 0);
+}
+
+void ObjectRegistry::initialize(get_allocation_size func,
+                                set_thread_arena arenaFunc) {
     getAllocSize = func;
+    setThreadArena = arenaFunc;
 }
 
 void ObjectRegistry::reset() {
     getAllocSize = defaultGetAllocSize;
+    setThreadArena = nullptr;
 }
 
 void ObjectRegistry::onCreateBlob(const Blob *blob)
@@ -82,13 +100,17 @@ void ObjectRegistry::onCreateBlob(const Blob *blob)
    if (verifyEngine(engine)) {
        auto& coreLocalStats = engine->getEpStats().coreLocal.get();
 
-       size_t size = getAllocSize(blob);
+       // An embedded Blob is part of its owner's allocation, and counted
+       // in its owner's size.
+       size_t size = blob->isEmbedded() ? 0 : getAllocSize(blob);
        if (size == 0) {
            size = blob->getSize();
        } else {
            coreLocalStats->blobOverhead.fetch_add(size - blob->getSize());
        }
-       coreLocalStats->currentSize.fetch_add(size);
+       if (!blob->isEmbedded()) {
+           coreLocalStats->currentSize.fetch_add(size);
+       }
        coreLocalStats->totalValueSize.fetch_add(size);
        coreLocalStats->numBlob++;
    }
@@ -100,13 +122,17 @@ void ObjectRegistry::onDeleteBlob(const Blob *blob)
    if (verifyEngine(engine)) {
        auto& coreLocalStats = engine->getEpStats().coreLocal.get();
 
-       size_t size = getAllocSize(blob);
+       // An embedded Blob is part of its owner's allocation, and counted
+       // in its owner's size.
+       size_t size = blob->isEmbedded() ? 0 : getAllocSize(blob);
        if (size == 0) {
            size = blob->getSize();
        } else {
            coreLocalStats->blobOverhead.fetch_sub(size - blob->getSize());
        }
-       coreLocalStats->currentSize.fetch_sub(size);
+       if (!blob->isEmbedded()) {
+           coreLocalStats->currentSize.fetch_sub(size);
+       }
        coreLocalStats->totalValueSize.fetch_sub(size);
        coreLocalStats->numBlob--;
    }
@@ -118,7 +144,8 @@ void ObjectRegistry::onCreateStoredValue(const StoredValue *sv)
    if (verifyEngine(engine)) {
        auto& coreLocalStats = engine->getEpStats().coreLocal.get();
 
-       size_t size = getAllocSize(sv);
+       // A slab chunk isn't an allocation the allocator knows the size of.
+       size_t size = sv->isSlabAllocated() ? 0 : getAllocSize(sv);
        if (size == 0) {
            size = sv->getObjectSize();
        }
@@ -133,7 +160,8 @@ void ObjectRegistry::onDeleteStoredValue(const StoredValue *sv)
    if (verifyEngine(engine)) {
        auto& coreLocalStats = engine->getEpStats().coreLocal.get();
 
-       size_t size = getAllocSize(sv);
+       // A slab chunk isn't an allocation the allocator knows the size of.
+       size_t size = sv->isSlabAllocated() ? 0 : getAllocSize(sv);
        if (size == 0) {
            size = sv->getObjectSize();
        }
@@ -179,9 +207,18 @@ EventuallyPersistentEngine *ObjectRegistry::onSwitchThread(
     }
 
     th->set(engine);
+    switchArena(engine);
     return old_engine;
 }
 
+void ObjectRegistry::addArenaEngine() {
+    ++arenaEngines;
+}
+
+void ObjectRegistry::removeArenaEngine() {
+    --arenaEngines;
+}
+
 void ObjectRegistry::setStats(std::atomic<size_t>* init_track) {
     initial_track->set(init_track);
 }
@@ -215,10 +252,12 @@ bool ObjectRegistry::memoryDeallocated(size_t mem) {
 NonBucketAllocationGuard::NonBucketAllocationGuard() {
     engine = th->get();
     th->set(nullptr);
+    switchArena(nullptr);
 }
 
 NonBucketAllocationGuard::~NonBucketAllocationGuard() {
     th->set(engine);
+    switchArena(engine);
 }
 
 #endif
@@ -26,13 +26,19 @@ class StoredValue;
 
 extern "C" {
     typedef size_t (*get_allocation_size)(const void *ptr);
+    typedef bool (*set_thread_arena)(unsigned arena);
 }
 
 class StoredValue;
 
 class ObjectRegistry {
 public:
-    static void initialize(get_allocation_size func);
+    /**
+     * @param arenaFunc Used to switch a thread's allocator arena along with
+     *        its engine, for engines which have their own arena.
+     */
+    static void initialize(get_allocation_size func,
+                           set_thread_arena arenaFunc = nullptr);
 
     /**
      * Resets the ObjectRegistry back to initial state (before initialize()
@@ -55,6 +61,14 @@ public:
     static EventuallyPersistentEngine *onSwitchThread(EventuallyPersistentEngine *engine,
                                                       bool want_old_thread_local = false);
 
+    /**
+     * Record that an engine has been given (or has given up) its own
+     * allocator arena. While any engine has one, switching a thread between
+     * engines also switches the thread's arena.
+     */
+    static void addArenaEngine();
+    static void removeArenaEngine();
+
     static void setStats(std::atomic<size_t>* init_track);
     static bool memoryAllocated(size_t mem);
     static bool memoryDeallocated(size_t mem);
@@ -33,6 +33,7 @@
 #include <iostream>
 #include <limits>
 #include <list>
+#include <random>
 #include <string>
 #include <utility>
 
@@ -104,27 +105,16 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
     auto storedValueFreqCounter = v.getFreqCounterValue();
     bool evicted = true;
 
-    /*
-     * Calculate the age when the item was last stored / modified.
-     * We do this by taking the item's current cas from the maxCas
-     * (which is the maximum cas value of the current vbucket just
-     * before we begin visiting all the items in the hash table).
-     *
-     * The time is actually stored in the top 48 bits of the cas
-     * therefore we shift the age by casBitsNotTime.
-     *
-     * Note: If the item was written before we switched over to the
-     * hybrid logical clock (HLC) (i.e. the item was written when the
-     * bucket was 4.0/3.x etc...) then the cas value will be low and
-     * so the item will appear very old.  However, this does not
-     * matter as it just means that is likely to be evicted.
-     */
-    uint64_t age = (maxCas > v.getCas()) ? (maxCas - v.getCas()) : 0;
-    age = age >> ItemEviction::casBitsNotTime;
+    uint64_t age = getAge(v);
+
+    const bool preferred =
+            preferredCollections &&
+            preferredCollections->count(v.getKey().getCollectionID()) != 0;
 
-    if ((storedValueFreqCounter <= freqCounterThreshold) &&
-        ((storedValueFreqCounter < freqCounterAgeThreshold) ||
-         (age >= ageThreshold))) {
+    if (preferred ||
+        ((storedValueFreqCounter <= freqCounterThreshold) &&
+         ((storedValueFreqCounter < freqCounterAgeThreshold) ||
+          (age >= ageThreshold)))) {
         /*
          * If the storedValue is eligible for eviction then add its
          * frequency counter value to the histogram, otherwise add the
@@ -160,7 +150,9 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
             }
         }
     }
-    itemEviction.addFreqAndAgeToHistograms(storedValueFreqCounter, age);
+    if (!thresholdsFromSample) {
+        itemEviction.addFreqAndAgeToHistograms(storedValueFreqCounter, age);
+    }
 
     if (evicted) {
         /**
@@ -181,7 +173,8 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
     // Whilst we are learning it is worth always updating the
     // threshold. We also want to update the threshold at periodic
     // intervals.
-    if (itemEviction.isLearning() || itemEviction.isRequiredToUpdate()) {
+    if (!thresholdsFromSample &&
+        (itemEviction.isLearning() || itemEviction.isRequiredToUpdate())) {
         auto thresholds =
                 itemEviction.getThresholds(percent * 100.0, agePercentage);
         freqCounterThreshold = thresholds.first;
@@ -191,6 +184,25 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
     return true;
 }
 
+void PagingVisitor::visitExpiryIndex(VBucket& vb, ExpiryIndex& index) {
+    for (const auto& key : index.takeDue(startTime)) {
+        auto res = vb.ht.findOnlyCommitted(key);
+        auto* v = res.storedValue;
+        // The index isn't updated when a document is modified or removed,
+        // so the entry may be stale
+        if (v == nullptr || v->isDeleted() || v->getExptime() == 0) {
+            continue;
+        }
+        if (v->isExpired(startTime) && vb.getState() == vbucket_state_active) {
+            visit(res.lock, *v);
+        } else {
+            // Not yet expired (the expiry time was extended), or we can't
+            // expire it in the current state
+            index.add(key, v->getExptime());
+        }
+    }
+}
+
 void PagingVisitor::visitBucket(const VBucketPtr& vb) {
     update();
     removeClosedUnrefCheckpoints(*vb);
@@ -201,14 +213,20 @@ void PagingVisitor::visitBucket(const VBucketPtr& vb) {
             currentBucket = vb;
             // EvictionPolicy is not required when running expiry item
             // pager
-            vb->ht.visit(*this);
+            auto* index = vb->getExpiryIndex();
+            if (useExpiryIndex && index) {
+                visitExpiryIndex(*vb, *index);
+            } else {
+                vb->ht.visit(*this);
+            }
         }
         return;
     }
 
     // skip active vbuckets if active resident ratio is lower than replica
     double current = static_cast<double>(stats.getEstimatedTotalMemoryUsed());
-    double lower = static_cast<double>(stats.mem_low_wat);
+    double lower = static_cast<double>(
+            evictionTarget ? evictionTarget : stats.mem_low_wat.load());
     double high = static_cast<double>(stats.mem_high_wat);
     if (vb->getState() == vbucket_state_active && current < high &&
         store.getActiveResidentRatio() < store.getReplicaResidentRatio()) {
@@ -223,6 +241,7 @@ void PagingVisitor::visitBucket(const VBucketPtr& vb) {
             maxCas = currentBucket->getMaxCas();
             itemEviction.reset();
             freqCounterThreshold = 0;
+            thresholdsFromSample = thresholdSampleSize > 0 && sampleThresholds();
 
             // Percent of items in the hash table to be visited
             // between updating the interval.
@@ -271,6 +290,70 @@ void PagingVisitor::visitBucket(const VBucketPtr& vb) {
     }
 }
 
+/**
+ * Adds a sample of a vBucket's items to the eviction histograms, as visit()
+ * would add them. Sampled items are not themselves evicted.
+ */
+class PagingVisitor::ThresholdSampler : public HashTableVisitor {
+public:
+    explicit ThresholdSampler(PagingVisitor& pv) : pv(pv) {
+    }
+
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override {
+        // As for visit(), prepares, temporary items and expired items aren't
+        // eviction candidates.
+        if (v.isPending() || v.isCompleted() || v.isTempItem() ||
+            v.isExpired(pv.startTime)) {
+            return true;
+        }
+        const uint8_t freq = pv.currentBucket->eligibleToPageOut(lh, v)
+                                     ? v.getFreqCounterValue()
+                                     : std::numeric_limits<uint8_t>::max();
+        pv.itemEviction.addFreqAndAgeToHistograms(freq, pv.getAge(v));
+        return true;
+    }
+
+private:
+    PagingVisitor& pv;
+};
+
+bool PagingVisitor::sampleThresholds() {
+    ThresholdSampler sampler(*this);
+    currentBucket->ht.visitSample(
+            sampler, thresholdSampleSize, std::random_device{}());
+    if (itemEviction.getFreqHistogramValueCount() <=
+        ItemEviction::learningPopulation) {
+        // Too few to go on; learn from the visit as usual.
+        itemEviction.reset();
+        return false;
+    }
+    auto thresholds =
+            itemEviction.getThresholds(percent * 100.0, agePercentage);
+    freqCounterThreshold = thresholds.first;
+    ageThreshold = thresholds.second;
+    return true;
+}
+
+uint64_t PagingVisitor::getAge(const StoredValue& v) const {
+    /*
+     * Calculate the age when the item was last stored / modified.
+     * We do this by taking the item's current cas from the maxCas
+     * (which is the maximum cas value of the current vbucket just
+     * before we begin visiting all the items in the hash table).
+     *
+     * The time is actually stored in the top 48 bits of the cas
+     * therefore we shift the age by casBitsNotTime.
+     *
+     * Note: If the item was written before we switched over to the
+     * hybrid logical clock (HLC) (i.e. the item was written when the
+     * bucket was 4.0/3.x etc...) then the cas value will be low and
+     * so the item will appear very old.  However, this does not
+     * matter as it just means that is likely to be evicted.
+     */
+    uint64_t age = (maxCas > v.getCas()) ? (maxCas - v.getCas()) : 0;
+    return age >> ItemEviction::casBitsNotTime;
+}
+
 void PagingVisitor::update() {
     store.deleteExpiredItems(expired, ExpireBy::Pager);
 
@@ -303,6 +386,11 @@ void PagingVisitor::complete() {
         stats.expiryPagerHisto.add(elapsed_time);
     }
 
+    if (runningVisitors && --(*runningVisitors) != 0) {
+        // Another visitor of this run is still going; it finishes the run.
+        return;
+    }
+
     bool inverse = false;
     (*stateFinalizer).compare_exchange_strong(inverse, true);
 
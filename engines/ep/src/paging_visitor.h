@@ -25,8 +25,10 @@
 
 #include <atomic>
 #include <list>
+#include <unordered_set>
 
 class EPStats;
+class ExpiryIndex;
 class Item;
 class EventuallyPersistentEngine;
 class KVBucket;
@@ -97,6 +99,52 @@ public:
      */
     void tearDownHashBucketVisit() override;
 
+    /**
+     * Evict down to the given memory usage rather than the low watermark.
+     */
+    void setEvictionTarget(size_t target) {
+        evictionTarget = target;
+    }
+
+    /**
+     * Estimate each vBucket's eviction thresholds from a random sample of
+     * (at most) the given number of its items, rather than learning them
+     * from the items visited. The pass over the vBucket then only evicts.
+     * 0 (the default) disables sampling.
+     */
+    void setThresholdSampleSize(size_t samples) {
+        thresholdSampleSize = samples;
+    }
+
+    /**
+     * Evict every eligible item of the given collections, regardless of the
+     * frequency and age thresholds - used for the collections which are over
+     * their memory quota or have a low eviction priority.
+     */
+    void setPreferredCollections(
+            std::shared_ptr<const std::unordered_set<CollectionID>> cids) {
+        preferredCollections = std::move(cids);
+    }
+
+    /**
+     * Only visit the items due to expire according to each vBucket's
+     * ExpiryIndex (if it has one) rather than the whole HashTable. Only
+     * used by the expiry pager.
+     */
+    void setUseExpiryIndex(bool use) {
+        useExpiryIndex = use;
+    }
+
+    /**
+     * Share a pager run with other visitors: running counts the run's
+     * visitors which are yet to complete, and only the last of them to
+     * complete finishes the run (marking the pager available, and moving
+     * it on to its next phase).
+     */
+    void setConcurrentVisitors(std::shared_ptr<std::atomic<size_t>> running) {
+        runningVisitors = std::move(running);
+    }
+
     /**
      * Get the number of items ejected during the visit.
      */
@@ -125,6 +173,18 @@ protected:
     uint64_t ageThreshold;
 
 private:
+    class ThresholdSampler;
+
+    /**
+     * Set the thresholds for currentBucket from a sample of its items.
+     * @return false (leaving the histograms empty) if too few items were
+     *         sampled to go on.
+     */
+    bool sampleThresholds();
+
+    /// @return the age of the given item (relative to maxCas).
+    uint64_t getAge(const StoredValue& v) const;
+
     // Removes checkpoints that are both closed and unreferenced, thereby
     // freeing the associated memory.
     // @param vb  The vbucket whose eligible checkpoints are removed from.
@@ -134,6 +194,9 @@ private:
 
     bool doEviction(const HashTable::HashBucketLock& lh, StoredValue* v);
 
+    /// Visit the items the vBucket's expiry index says are due to expire
+    void visitExpiryIndex(VBucket& vb, ExpiryIndex& index);
+
     std::list<Item> expired;
 
     KVBucket& store;
@@ -144,8 +207,24 @@ private:
     std::shared_ptr<std::atomic<bool>> stateFinalizer;
     pager_type_t owner;
     bool canPause;
-    /// Flag used to identify if memory usage is below the low watermark.
+    /// Flag used to identify if memory usage is below the low watermark (or
+    /// the eviction target, if one is set).
     bool isBelowLowWaterMark;
+    /// Memory usage to evict down to; 0 for the low watermark.
+    size_t evictionTarget = 0;
+    /// Number of items to sample for the thresholds; 0 to learn them from
+    /// the visit.
+    size_t thresholdSampleSize = 0;
+    /// True if the current vBucket's thresholds came from a sample, and so
+    /// aren't updated by the visit.
+    bool thresholdsFromSample = false;
+    /// Collections to evict from first; null (or empty) for none.
+    std::shared_ptr<const std::unordered_set<CollectionID>>
+            preferredCollections;
+    /// Visit the expiry index rather than the HashTable (expiry pager only)
+    bool useExpiryIndex = false;
+    /// Visitors of the same pager run yet to complete, if shared.
+    std::shared_ptr<std::atomic<size_t>> runningVisitors;
     bool wasHighMemoryUsage;
     std::chrono::steady_clock::time_point taskStart;
     std::atomic<item_pager_phase>* pager_phase;
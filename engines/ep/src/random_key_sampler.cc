@@ -0,0 +1,67 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "random_key_sampler.h"
+
+#include "stored-value.h"
+#include "vbucket.h"
+
+RandomKeySampler::RandomKeySampler(size_t sampleSize,
+                                   boost::optional<CollectionID> collection,
+                                   uint64_t seed)
+    : sampleSize(sampleSize), collection(collection), generator(seed) {
+    sample.reserve(sampleSize);
+}
+
+bool RandomKeySampler::visit(const HashTable::HashBucketLock& lh,
+                             StoredValue& v) {
+    ++visitedCount;
+    if (skipVBucket || v.isTempItem() || v.isDeleted() || !v.isCommitted()) {
+        return progressTracker.shouldContinueVisiting(visitedCount);
+    }
+
+    const auto key = v.getKey();
+    if (key.getCollectionID().isSystem() ||
+        (collection && key.getCollectionID() != *collection)) {
+        return progressTracker.shouldContinueVisiting(visitedCount);
+    }
+
+    // Algorithm R: the n'th candidate replaces a random member of the
+    // sample with probability sampleSize / n
+    if (sample.size() < sampleSize) {
+        sample.emplace_back(key);
+    } else {
+        std::uniform_int_distribution<size_t> distribution(0, candidates);
+        const auto index = distribution(generator);
+        if (index < sampleSize) {
+            sample[index] = StoredDocKey(key);
+        }
+    }
+    ++candidates;
+
+    return progressTracker.shouldContinueVisiting(visitedCount);
+}
+
+void RandomKeySampler::setCurrentVBucket(VBucket& vb) {
+    skipVBucket = vb.getState() != vbucket_state_active;
+}
+
+void RandomKeySampler::setDeadline(
+        std::chrono::steady_clock::time_point deadline) {
+    visitedCount = 0;
+    progressTracker.setDeadline(deadline);
+}
@@ -0,0 +1,86 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "progress_tracker.h"
+#include "storeddockey.h"
+#include "vb_visitors.h"
+
+#include <boost/optional.hpp>
+#include <memcached/dockey.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+/**
+ * Builds a uniform random sample of the keys of a bucket (optionally
+ * restricted to a single collection).
+ *
+ * The sample is built with reservoir sampling while visiting every item of
+ * the active vBuckets, so each of the (committed, alive) keys in memory has
+ * the same probability of being part of the sample, and the memory used is
+ * bounded by the size of the sample. The visit may be paused (see
+ * setDeadline()) and resumed with a PauseResumeVBAdapter.
+ */
+class RandomKeySampler : public VBucketAwareHTVisitor {
+public:
+    /**
+     * @param sampleSize the (maximum) number of keys to sample
+     * @param collection only sample the keys of this collection, if set
+     * @param seed the seed of the random choices
+     */
+    RandomKeySampler(size_t sampleSize,
+                     boost::optional<CollectionID> collection,
+                     uint64_t seed);
+
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
+
+    void setCurrentVBucket(VBucket& vb) override;
+
+    boost::optional<CollectionID> getVisitedCollection() const override {
+        return collection;
+    }
+
+    /// Set the time at which the visit should pause
+    void setDeadline(std::chrono::steady_clock::time_point deadline);
+
+    /// @return the sampled keys (in no particular order)
+    const std::vector<StoredDocKey>& getSample() const {
+        return sample;
+    }
+
+    /// @return the number of keys the sample was drawn from
+    size_t getCandidateCount() const {
+        return candidates;
+    }
+
+private:
+    const size_t sampleSize;
+    const boost::optional<CollectionID> collection;
+    std::mt19937_64 generator;
+    std::vector<StoredDocKey> sample;
+    size_t candidates = 0;
+
+    // Skip the items of the current vBucket (it isn't active)
+    bool skipVBucket = false;
+
+    ProgressTracker progressTracker;
+    // The number of items visited since the deadline was set
+    size_t visitedCount = 0;
+};
@@ -19,11 +19,33 @@
 #include "configuration.h"
 #include "stats.h"
 
+#include <algorithm>
+
+constexpr std::chrono::milliseconds ReplicationThrottle::UpdateInterval;
+
+/// The gains of the PID controller (the output is the change of the rate
+/// as a fraction of the max rate)
+static const double ProportionalGain = 1.0;
+static const double IntegralGain = 0.5;
+static const double DerivativeGain = 0.05;
+
+/// Back off time when we're not using the adaptive throttle
+static const std::chrono::duration<double> DefaultBackoffTime{5.0};
+
 ReplicationThrottle::ReplicationThrottle(const Configuration& config,
                                          EPStats& s)
     : queueCap(config.getReplicationThrottleQueueCap()),
       capPercent(config.getReplicationThrottleCapPcnt()),
-      stats(s) {
+      stats(s),
+      adaptive(config.isReplicationThrottleAdaptive()),
+      targetHeadroom(config.getReplicationThrottleTargetHeadroom()),
+      minRate(config.getReplicationThrottleMinRate()),
+      maxRate(config.getReplicationThrottleMaxRate()),
+      rate(config.getReplicationThrottleMaxRate()),
+      budget(0) {
+    controller.lastUpdate = std::chrono::steady_clock::now();
+    budget = int64_t(std::chrono::duration<double>(UpdateInterval).count() *
+                     rate.load());
 }
 
 bool ReplicationThrottle::persistenceQueueSmallEnough() const {
@@ -42,9 +64,127 @@ bool ReplicationThrottle::hasSomeMemory() const {
     return memoryUsed <= (maxSize * stats.replicationThrottleThreshold);
 }
 
+bool ReplicationThrottle::hasRateBudget() const {
+    const auto now = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(controllerMutex, std::try_to_lock);
+    if (lock && now - controller.lastUpdate >= UpdateInterval) {
+        updateRate_UNLOCKED(now);
+    }
+    return budget.load(std::memory_order_relaxed) > 0;
+}
+
 ReplicationThrottle::Status ReplicationThrottle::getStatus() const {
-    return (persistenceQueueSmallEnough() && hasSomeMemory()) ? Status::Process
-                                                              : Status::Pause;
+    if (!persistenceQueueSmallEnough() || !hasSomeMemory()) {
+        return Status::Pause;
+    }
+    if (adaptive.load() && !hasRateBudget()) {
+        return Status::Pause;
+    }
+    return Status::Process;
+}
+
+void ReplicationThrottle::setAdaptive(bool enabled) {
+    std::lock_guard<std::mutex> guard(controllerMutex);
+    if (enabled && !adaptive.load()) {
+        // Start over at the max rate
+        rate.store(maxRate.load());
+        budget = int64_t(
+                std::chrono::duration<double>(UpdateInterval).count() *
+                rate.load());
+        controller.lastUpdate = std::chrono::steady_clock::now();
+        controller.previousError = 0;
+        controller.previousError2 = 0;
+    }
+    adaptive.store(enabled);
+}
+
+void ReplicationThrottle::processed(size_t bytes) {
+    if (adaptive.load()) {
+        budget.fetch_sub(int64_t(bytes), std::memory_order_relaxed);
+    }
+}
+
+size_t ReplicationThrottle::getRate() const {
+    return adaptive.load() ? rate.load() : 0;
+}
+
+std::chrono::duration<double> ReplicationThrottle::getBackoffTime() const {
+    if (adaptive.load()) {
+        return UpdateInterval;
+    }
+    return DefaultBackoffTime;
+}
+
+double ReplicationThrottle::getHeadroomError() const {
+    const double target = static_cast<double>(targetHeadroom.load()) / 100.0;
+    double error = 1.0;
+
+    const double maxSize = static_cast<double>(stats.getMaxDataSize());
+    if (maxSize > 0) {
+        const double limit = maxSize * stats.replicationThrottleThreshold;
+        const double memoryUsed =
+                static_cast<double>(stats.getEstimatedTotalMemoryUsed());
+        error = (limit - memoryUsed) / maxSize - target;
+    }
+
+    const auto cap = stats.replicationThrottleWriteQueueCap.load();
+    if (cap > 0) {
+        const double queued = static_cast<double>(stats.diskQueueSize.load());
+        error = std::min(error, (cap - queued) / cap - target);
+    }
+
+    return std::max(-1.0, std::min(1.0, error));
+}
+
+void ReplicationThrottle::updateRate(
+        std::chrono::steady_clock::time_point now) const {
+    std::lock_guard<std::mutex> guard(controllerMutex);
+    updateRate_UNLOCKED(now);
+}
+
+void ReplicationThrottle::updateRate_UNLOCKED(
+        std::chrono::steady_clock::time_point now) const {
+    // Don't let a long idle period blow up the integral term
+    const double dt = std::max(
+            std::chrono::duration<double>(UpdateInterval).count(),
+            std::min(1.0,
+                     std::chrono::duration<double>(now - controller.lastUpdate)
+                             .count()));
+    controller.lastUpdate = now;
+
+    const double low = static_cast<double>(minRate.load());
+    const double high =
+            std::max(low, static_cast<double>(maxRate.load()));
+
+    // Velocity form of the PID controller, so we don't need to track
+    // (and limit) the integral; the rate is the accumulated output
+    const double error = getHeadroomError();
+    const double delta =
+            ProportionalGain * (error - controller.previousError) +
+            IntegralGain * error * dt +
+            DerivativeGain *
+                    (error - 2 * controller.previousError +
+                     controller.previousError2) /
+                    dt;
+    controller.previousError2 = controller.previousError;
+    controller.previousError = error;
+
+    const double next = std::max(
+            low,
+            std::min(high, static_cast<double>(rate.load()) + delta * high));
+    rate.store(static_cast<size_t>(next));
+
+    // Refill the budget for the elapsed time, but don't let the budget
+    // accumulate for more than two intervals (to avoid bursts after an idle
+    // period)
+    const auto refill = int64_t(next * dt);
+    const auto limit = int64_t(
+            next * 2 * std::chrono::duration<double>(UpdateInterval).count());
+    auto current = budget.load(std::memory_order_relaxed);
+    while (!budget.compare_exchange_weak(current,
+                                         std::min(current + refill, limit),
+                                         std::memory_order_relaxed)) {
+    }
 }
 
 void ReplicationThrottle::adjustWriteQueueCap(size_t totalItems) {
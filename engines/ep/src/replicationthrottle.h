@@ -19,12 +19,28 @@
 #include <platform/socket.h>
 #include <relaxed_atomic.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
 class EPStats;
 class Configuration;
 
 /**
  * Monitors various internal state to report whether we should
  * throttle incoming tap and DCP items.
+ *
+ * In addition to the hard limits (replication_throttle_threshold and the
+ * write queue cap) the throttle may pace the consumers (when
+ * replication_throttle_adaptive is set). The consumers then get a budget
+ * of bytes they may process per update interval, and the rate is adjusted
+ * by a PID controller which tries to keep the memory headroom (below the
+ * throttle threshold) and the write queue headroom (below the cap) at
+ * replication_throttle_target_headroom percent. The derivative term reacts
+ * to the write queue growing faster than the flusher drains it, so the
+ * rate backs off before we hit the hard limits instead of flipping between
+ * processing and pausing.
  */
 class ReplicationThrottle {
 public:
@@ -56,13 +72,86 @@ public:
 
     void adjustWriteQueueCap(size_t totalItems);
 
+    void setAdaptive(bool enabled);
+    void setTargetHeadroom(size_t percent) {
+        targetHeadroom = percent;
+    }
+    void setMinRate(size_t bytesPerSecond) {
+        minRate = bytesPerSecond;
+    }
+    void setMaxRate(size_t bytesPerSecond) {
+        maxRate = bytesPerSecond;
+    }
+
+    /**
+     * Record that a consumer processed replication input (consumes from
+     * the budget of the adaptive throttle)
+     *
+     * @param bytes the size of the processed messages
+     */
+    void processed(size_t bytes);
+
+    /**
+     * @return the rate (bytes per second) the consumers may currently
+     *         process replication input at, or 0 if the adaptive throttle
+     *         is disabled
+     */
+    size_t getRate() const;
+
+    /**
+     * @return how long a consumer should back off before it tries to
+     *         process its buffered items again after being paused
+     */
+    std::chrono::duration<double> getBackoffTime() const;
+
+    /**
+     * Run the controller to calculate the next rate and refill the budget
+     * (called from getStatus() once per UpdateInterval; public for testing)
+     *
+     * @param now the current time
+     */
+    void updateRate(std::chrono::steady_clock::time_point now) const;
+
+    /// How often the adaptive throttle adjust the rate
+    static constexpr std::chrono::milliseconds UpdateInterval{100};
+
 private:
     bool persistenceQueueSmallEnough() const;
     bool hasSomeMemory() const;
+    bool hasRateBudget() const;
+
+    /**
+     * The controller error; the headroom minus the target headroom (the
+     * smallest of the memory and write queue headroom) as a fraction in
+     * the range [-1, 1]
+     */
+    double getHeadroomError() const;
+
+    void updateRate_UNLOCKED(std::chrono::steady_clock::time_point now) const;
 
     cb::RelaxedAtomic<ssize_t> queueCap;
     cb::RelaxedAtomic<size_t> capPercent;
     EPStats &stats;
+
+    cb::RelaxedAtomic<bool> adaptive;
+    cb::RelaxedAtomic<size_t> targetHeadroom;
+    cb::RelaxedAtomic<size_t> minRate;
+    cb::RelaxedAtomic<size_t> maxRate;
+
+    /// The current rate in bytes per second
+    mutable cb::RelaxedAtomic<size_t> rate;
+
+    /// The number of bytes the consumers may process until the next update
+    /// (goes negative if they process more than the budget)
+    mutable std::atomic<int64_t> budget;
+
+    /// Serialise the updates of the controller
+    mutable std::mutex controllerMutex;
+    mutable struct {
+        std::chrono::steady_clock::time_point lastUpdate;
+        double previousError = 0;
+        double previousError2 = 0;
+    } controller;
 };
 
 /**
@@ -0,0 +1,234 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "resident_image.h"
+
+#include "bucket_logger.h"
+#include "hash_table.h"
+#include "item.h"
+#include "stored-value.h"
+#include "vbucket.h"
+
+#include <gsl/gsl>
+#include <platform/memorymap.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+const uint64_t imageMagic = 0x45504854494d4731ULL; // "EPHTIMG1"
+const uint32_t imageVersion = 1;
+
+struct ImageHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint16_t vbid;
+    uint16_t padding;
+    uint64_t highSeqno;
+    uint64_t count;
+};
+static_assert(sizeof(ImageHeader) == 32, "ImageHeader is not the expected size");
+
+/// Followed by the key (keyLen bytes) and then the value (valueLen bytes).
+struct RecordHeader {
+    uint64_t cas;
+    uint64_t revSeqno;
+    int64_t bySeqno;
+    uint32_t exptime;
+    uint32_t flags;
+    uint32_t valueLen;
+    uint16_t keyLen;
+    uint8_t datatype;
+    uint8_t resident;
+    uint8_t freqCount;
+    uint8_t padding[7];
+};
+static_assert(sizeof(RecordHeader) == 48,
+              "RecordHeader is not the expected size");
+
+/// Size of the stdio buffer used to write images.
+const size_t writeBufferSize = 1024 * 1024;
+
+class ImageWriter : public HashTableVisitor {
+public:
+    ImageWriter(FILE* file,
+                const Collections::VB::Manifest::ReadHandle& collections)
+        : file(file), collections(collections) {
+    }
+
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override {
+        // Prepares are loaded separately by warmup, and deletes (and items
+        // of dropped collections) aren't loaded at all.
+        if (v.isTempItem() || v.isDeleted() || !v.isCommitted() ||
+            collections.isLogicallyDeleted(v.getKey(), v.getBySeqno())) {
+            return true;
+        }
+        if (v.isDirty()) {
+            // Not persisted; the image would not match the data file.
+            valid = false;
+            return false;
+        }
+
+        const auto& key = v.getKey();
+        const bool resident = v.isResident() && v.getValue();
+        RecordHeader rec{};
+        rec.cas = v.getCas();
+        rec.revSeqno = v.getRevSeqno();
+        rec.bySeqno = v.getBySeqno();
+        rec.exptime = gsl::narrow_cast<uint32_t>(v.getExptime());
+        rec.flags = v.getFlags();
+        rec.valueLen = resident ? v.getValue()->valueSize() : 0;
+        rec.keyLen = gsl::narrow<uint16_t>(key.size());
+        rec.datatype = v.getDatatype();
+        rec.resident = resident ? 1 : 0;
+        rec.freqCount = v.getFreqCounterValue();
+
+        if (fwrite(&rec, sizeof(rec), 1, file) != 1 ||
+            fwrite(key.data(), key.size(), 1, file) != 1 ||
+            (rec.valueLen &&
+             fwrite(v.getValue()->getData(), rec.valueLen, 1, file) != 1)) {
+            valid = false;
+            return false;
+        }
+        ++count;
+        return true;
+    }
+
+    FILE* const file;
+    const Collections::VB::Manifest::ReadHandle& collections;
+    uint64_t count = 0;
+    bool valid = true;
+};
+} // namespace
+
+std::string ResidentImage::getPath(const std::string& dbname, Vbid vbid) {
+    return dbname + "/" + std::to_string(vbid.get()) + ".resident";
+}
+
+bool ResidentImage::write(const std::string& path,
+                          VBucket& vb,
+                          uint64_t highSeqno) {
+    // Written under a temporary name, so that a partial image is never seen
+    // by warmup.
+    const auto tmpPath = path + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (file == nullptr) {
+        EP_LOG_WARN("ResidentImage::write: {} failed to open {}: {}",
+                    vb.getId(),
+                    tmpPath,
+                    strerror(errno));
+        return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, writeBufferSize);
+
+    ImageHeader header{};
+    header.magic = imageMagic;
+    header.version = imageVersion;
+    header.vbid = vb.getId().get();
+    header.highSeqno = highSeqno;
+
+    auto collections = vb.lockCollections();
+    ImageWriter writer(file, collections);
+    bool valid = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (valid) {
+        vb.ht.visit(writer);
+        valid = writer.valid;
+    }
+    if (valid) {
+        // Now the count is known, rewrite the header.
+        header.count = writer.count;
+        valid = fseek(file, 0, SEEK_SET) == 0 &&
+                fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+    valid = (fclose(file) == 0) && valid;
+
+    if (!valid || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        EP_LOG_WARN("ResidentImage::write: {} failed to write {}",
+                    vb.getId(),
+                    path);
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ResidentImage::load(const std::string& path,
+                         Vbid vbid,
+                         uint64_t highSeqno,
+                         const LoadCallback& cb) {
+    cb::io::MemoryMappedFile map(path, cb::io::MemoryMappedFile::Mode::RDONLY);
+    const auto content = map.content();
+    const auto* data = reinterpret_cast<const uint8_t*>(content.data());
+    const size_t size = content.size();
+
+    ImageHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != imageMagic || header.version != imageVersion ||
+        header.vbid != vbid.get() || header.highSeqno != highSeqno) {
+        return false;
+    }
+
+    // Check the records are all complete before loading any of them.
+    size_t offset = sizeof(header);
+    for (uint64_t ii = 0; ii < header.count; ++ii) {
+        RecordHeader rec;
+        if (size - offset < sizeof(rec)) {
+            return false;
+        }
+        std::memcpy(&rec, data + offset, sizeof(rec));
+        offset += sizeof(rec);
+        if (size - offset < size_t(rec.keyLen) + rec.valueLen) {
+            return false;
+        }
+        offset += rec.keyLen + rec.valueLen;
+    }
+    if (offset != size) {
+        return false;
+    }
+
+    offset = sizeof(header);
+    for (uint64_t ii = 0; ii < header.count; ++ii) {
+        RecordHeader rec;
+        std::memcpy(&rec, data + offset, sizeof(rec));
+        offset += sizeof(rec);
+        const DocKey key(data + offset,
+                         rec.keyLen,
+                         DocKeyEncodesCollectionId::Yes);
+        offset += rec.keyLen;
+        auto item = std::make_unique<Item>(key,
+                                           rec.flags,
+                                           rec.exptime,
+                                           data + offset,
+                                           rec.valueLen,
+                                           rec.datatype,
+                                           rec.cas,
+                                           rec.bySeqno,
+                                           vbid,
+                                           rec.revSeqno,
+                                           INITIAL_NRU_VALUE,
+                                           rec.freqCount);
+        offset += rec.valueLen;
+        if (!cb(std::move(item), rec.resident == 0)) {
+            break;
+        }
+    }
+    return true;
+}
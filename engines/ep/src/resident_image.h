@@ -0,0 +1,83 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <memcached/vbucket.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+class Item;
+class VBucket;
+
+/**
+ * An image of the items in a vBucket's HashTable, written at a clean
+ * shutdown and read back by warmup in place of scanning the vBucket's data
+ * file.
+ *
+ * The image holds the metadata of every (committed, alive) item in the
+ * HashTable, and the value of each resident one, in a single file which is
+ * written and read sequentially (reading maps the whole file). Loading it
+ * therefore restores the resident set as it was at shutdown, without the
+ * random reads and per-document decoding of a data file scan.
+ *
+ * An image is only valid for the data file it was taken alongside, so it
+ * records the vBucket's persisted high seqno and is ignored unless that
+ * still matches; the file is removed once warmup has read it.
+ *
+ * The file is in host byte order; it is only ever read back by the node
+ * which wrote it.
+ */
+class ResidentImage {
+public:
+    /// @return the path of the image for the given vBucket.
+    static std::string getPath(const std::string& dbname, Vbid vbid);
+
+    /**
+     * Write the image of the given vBucket's HashTable to path.
+     *
+     * The HashTable must match the data file, i.e. everything must have
+     * been persisted; if a dirty item is found no image is written.
+     *
+     * @return true if the image was written.
+     */
+    static bool write(const std::string& path,
+                      VBucket& vb,
+                      uint64_t highSeqno);
+
+    /**
+     * Callback for each item read from an image; keyOnly if the item's value
+     * wasn't resident. @return false to stop loading.
+     */
+    using LoadCallback =
+            std::function<bool(std::unique_ptr<Item> item, bool keyOnly)>;
+
+    /**
+     * Read the image at path, if it is a valid image of the given vBucket at
+     * highSeqno, passing each of its items to cb.
+     *
+     * The whole image is validated before any of its items are passed on.
+     *
+     * @return true if the image was valid (and so was used).
+     */
+    static bool load(const std::string& path,
+                     Vbid vbid,
+                     uint64_t highSeqno,
+                     const LoadCallback& cb);
+};
@@ -30,6 +30,7 @@
 #include <platform/sysinfo.h>
 #include <rocksdb/convenience.h>
 #include <rocksdb/filter_policy.h>
+#include <rocksdb/version.h>
 #include <nlohmann/json.hpp>
 
 #include <stdio.h>
@@ -713,25 +714,71 @@ GetValue RocksDBKVStore::getWithHeader(void* dbHandle,
 }
 
 void RocksDBKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
-    // TODO RDB: RocksDB supports a multi get which we should use here.
+    if (itms.empty()) {
+        return;
+    }
+    const auto vbh = getVBHandle(vb);
+
+    // Look up the whole batch (full and meta-only fetches alike) with a single
+    // MultiGet, in key order. RocksDB can then share the work of locating
+    // keys in the same blocks, and (where supported) read the blocks of
+    // different files in parallel rather than one key at a time.
+    std::vector<vb_bgfetch_queue_t::value_type*> fetches;
+    fetches.reserve(itms.size());
     for (auto& it : itms) {
-        auto& key = it.first;
-        rocksdb::Slice keySlice = getKeySlice(key);
-        rocksdb::PinnableSlice value;
-        const auto vbh = getVBHandle(vb);
-        rocksdb::Status s = rdb->Get(rocksdb::ReadOptions(),
-                                     vbh->defaultCFH.get(),
-                                     keySlice,
-                                     &value);
-        if (s.ok()) {
-            it.second.value =
-                    makeGetValue(vb, key, value, it.second.isMetaOnly);
-            GetValue* rv = &it.second.value;
-            for (auto& fetch : it.second.bgfetched_list) {
+        fetches.push_back(&it);
+    }
+    std::sort(fetches.begin(),
+              fetches.end(),
+              [this](const vb_bgfetch_queue_t::value_type* a,
+                     const vb_bgfetch_queue_t::value_type* b) {
+                  return getKeySlice(a->first).compare(getKeySlice(b->first)) <
+                         0;
+              });
+    std::vector<rocksdb::Slice> keys;
+    keys.reserve(fetches.size());
+    for (const auto* fetch : fetches) {
+        keys.push_back(getKeySlice(fetch->first));
+    }
+
+    rocksdb::ReadOptions options;
+#if ROCKSDB_MAJOR > 7 || (ROCKSDB_MAJOR == 7 && ROCKSDB_MINOR >= 6)
+    options.async_io = true;
+#endif
+#if ROCKSDB_MAJOR > 6 || (ROCKSDB_MAJOR == 6 && ROCKSDB_MINOR >= 4)
+    std::vector<rocksdb::PinnableSlice> values(keys.size());
+    std::vector<rocksdb::Status> statuses(keys.size());
+    rdb->MultiGet(options,
+                  vbh->defaultCFH.get(),
+                  keys.size(),
+                  keys.data(),
+                  values.data(),
+                  statuses.data(),
+                  true /*sorted_input*/);
+#else
+    // No batched MultiGet; this one still saves a lookup of the column
+    // family's state (and a snapshot) per key.
+    std::vector<std::string> values;
+    const auto statuses = rdb->MultiGet(
+            options,
+            std::vector<rocksdb::ColumnFamilyHandle*>(keys.size(),
+                                                      vbh->defaultCFH.get()),
+            keys,
+            &values);
+#endif
+
+    for (size_t i = 0; i < fetches.size(); ++i) {
+        const auto& key = fetches[i]->first;
+        auto& ctx = fetches[i]->second;
+        if (statuses[i].ok()) {
+            ctx.value = makeGetValue(vb, key, values[i], ctx.isMetaOnly);
+            GetValue* rv = &ctx.value;
+            for (auto& fetch : ctx.bgfetched_list) {
                 fetch->value = rv;
             }
         } else {
-            for (auto& fetch : it.second.bgfetched_list) {
+            ctx.value.setStatus(ENGINE_KEY_ENOENT);
+            for (auto& fetch : ctx.bgfetched_list) {
                 fetch->value->setStatus(ENGINE_KEY_ENOENT);
             }
         }
@@ -273,7 +273,7 @@ public:
             Vbid vbid,
             const DiskDocKey& start_key,
             uint32_t count,
-            std::shared_ptr<Callback<const DiskDocKey&>> cb) override {
+            std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) override {
         // TODO vmx 2016-10-29: implement
         return ENGINE_SUCCESS;
     }
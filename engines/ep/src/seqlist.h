@@ -156,8 +156,9 @@ public:
      * Note: (a) Do not hold the iterator for long, as it will result in stale
      *           items in list and hence increased memory usage.
      *       (b) Make sure to delete the iterator after using it.
-     *       (c) For now, we allow on one RangeIterator. Try to create more
-     *           iterators will result in the create call(s) being blocked.
+     *       (c) Any number of RangeIterators may be in use at once; creation
+     *           only fails (and should be retried later) while the list is
+     *           being purged.
      */
     class RangeIterator {
     public:
@@ -275,6 +276,7 @@ public:
      * @return ENGINE_SUCCESS, items in the snapshot and adjusted endSeqNo
      *         ENGINE_ENOMEM on no memory to copy items
      *         ENGINE_ERANGE on incorrect start and end
+     *         ENGINE_TMPFAIL if the list is being purged
      */
     virtual std::tuple<ENGINE_ERROR_CODE, std::vector<UniqueItemPtr>, seqno_t>
     rangeRead(seqno_t start, seqno_t end) = 0;
@@ -421,8 +423,8 @@ public:
 
     /**
      * Creates a range iterator for the underlying SequenceList 'optionally'.
-     * Under scenarios like where we want to limit the number of range iterators
-     * the SequenceList, new range iterator will not be allowed
+     * Under scenarios like where the SequenceList is being purged, new range
+     * iterator will not be allowed
      *
      * @param isBackfill indicates if the iterator is for backfill (for debug)
      *
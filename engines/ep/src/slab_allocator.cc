@@ -0,0 +1,125 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "slab_allocator.h"
+
+#include <cstdint>
+
+constexpr size_t SlabAllocator::slabSize;
+constexpr size_t SlabAllocator::slabsPerRegion;
+constexpr size_t SlabAllocator::chunkGranularity;
+constexpr size_t SlabAllocator::maxChunkSize;
+
+std::shared_ptr<SlabAllocator> SlabAllocator::create() {
+    return std::shared_ptr<SlabAllocator>(
+            new SlabAllocator(), [](SlabAllocator* a) { a->release(); });
+}
+
+SlabAllocator::SlabAllocator() {
+    for (size_t ii = 0; ii < numSizeClasses; ++ii) {
+        sizeClasses[ii].chunkSize = (ii + 1) * chunkGranularity;
+    }
+}
+
+SlabAllocator::~SlabAllocator() {
+    for (auto* region : regions) {
+        ::operator delete(region);
+    }
+}
+
+void* SlabAllocator::allocate(size_t size) {
+    if (size > maxChunkSize) {
+        return nullptr;
+    }
+    auto& sizeClass = sizeClasses[size == 0 ? 0
+                                            : (size - 1) / chunkGranularity];
+    void* chunk;
+    {
+        std::lock_guard<std::mutex> lh(sizeClass.mutex);
+        if (sizeClass.freeList) {
+            chunk = sizeClass.freeList;
+            sizeClass.freeList = *static_cast<void**>(chunk);
+        } else {
+            if (size_t(sizeClass.end - sizeClass.next) < sizeClass.chunkSize) {
+                auto* slab = newSlab(sizeClass);
+                // The header occupies the first chunk's worth of the slab.
+                sizeClass.next = slab + sizeClass.chunkSize;
+                sizeClass.end = slab + slabSize;
+            }
+            chunk = sizeClass.next;
+            sizeClass.next += sizeClass.chunkSize;
+        }
+    }
+    usedBytes += sizeClass.chunkSize;
+    ++refs;
+    return chunk;
+}
+
+void SlabAllocator::deallocate(void* ptr) {
+    auto* header = reinterpret_cast<SlabHeader*>(
+            reinterpret_cast<uintptr_t>(ptr) & ~uintptr_t(slabSize - 1));
+    auto& sizeClass = *header->sizeClass;
+    auto* owner = header->owner;
+    {
+        std::lock_guard<std::mutex> lh(sizeClass.mutex);
+        *static_cast<void**>(ptr) = sizeClass.freeList;
+        sizeClass.freeList = ptr;
+    }
+    owner->usedBytes -= sizeClass.chunkSize;
+    owner->release();
+}
+
+size_t SlabAllocator::getAllocatedBytes() const {
+    return allocatedBytes;
+}
+
+size_t SlabAllocator::getFreeBytes() const {
+    return allocatedBytes - usedBytes;
+}
+
+char* SlabAllocator::newSlab(SizeClass& sizeClass) {
+    char* slab;
+    {
+        std::lock_guard<std::mutex> lh(regionMutex);
+        if (slabsLeft == 0) {
+            // One extra slab's worth, so the region can be aligned to
+            // slabSize.
+            const size_t regionSize = (slabsPerRegion + 1) * slabSize;
+            regions.reserve(regions.size() + 1);
+            auto* region = ::operator new(regionSize);
+            regions.push_back(region);
+            allocatedBytes += regionSize;
+            nextSlab = reinterpret_cast<char*>(
+                    (reinterpret_cast<uintptr_t>(region) + slabSize - 1) &
+                    ~uintptr_t(slabSize - 1));
+            slabsLeft = slabsPerRegion;
+        }
+        slab = nextSlab;
+        nextSlab += slabSize;
+        --slabsLeft;
+    }
+    auto* header = reinterpret_cast<SlabHeader*>(slab);
+    header->sizeClass = &sizeClass;
+    header->owner = this;
+    return slab;
+}
+
+void SlabAllocator::release() {
+    if (--refs == 0) {
+        delete this;
+    }
+}
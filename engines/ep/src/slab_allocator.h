@@ -0,0 +1,121 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Size-classed slab allocator for a bucket's small, numerous objects
+ * (StoredValues).
+ *
+ * Memory is taken from the heap in large regions, which are carved into
+ * slabs; each slab is given to a single size class and split into equal
+ * chunks. Objects of similar size therefore pack together instead of being
+ * interleaved with everything else on the heap, so freeing them doesn't
+ * leave holes which only other sizes could fill, and a bucket's regions are
+ * all handed back as soon as the bucket is gone.
+ *
+ * Freed chunks go onto their size class' free list and are reused by that
+ * class only; regions are not returned until the allocator is destroyed.
+ *
+ * Slabs are aligned to slabSize and start with a header naming their size
+ * class, so deallocate() needs only the pointer. The allocator stays alive
+ * until both its owner has released it and every chunk has been freed,
+ * hence it is only created via create().
+ */
+class SlabAllocator {
+public:
+    static constexpr size_t slabSize = 64 * 1024;
+    static constexpr size_t slabsPerRegion = 32;
+    static constexpr size_t chunkGranularity = 16;
+    /// Requests larger than this aren't served by the allocator.
+    static constexpr size_t maxChunkSize = 512;
+
+    /// @return a new allocator, which is released when the pointer is reset.
+    static std::shared_ptr<SlabAllocator> create();
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    /**
+     * @return a chunk of at least size bytes (aligned to chunkGranularity),
+     *         or nullptr if size is larger than maxChunkSize.
+     * @throws std::bad_alloc if a new region couldn't be allocated.
+     */
+    void* allocate(size_t size);
+
+    /// Return a chunk allocated from any SlabAllocator.
+    static void deallocate(void* ptr);
+
+    /// @return bytes taken from the heap (all regions).
+    size_t getAllocatedBytes() const;
+
+    /// @return bytes of the regions not currently allocated as chunks.
+    size_t getFreeBytes() const;
+
+private:
+    struct SizeClass;
+
+    /// Start of every slab.
+    struct SlabHeader {
+        SizeClass* sizeClass;
+        SlabAllocator* owner;
+    };
+    static_assert(sizeof(SlabHeader) <= chunkGranularity,
+                  "SlabHeader must fit in the first chunk of a slab");
+
+    struct SizeClass {
+        std::mutex mutex;
+        size_t chunkSize = 0;
+        /// Freed chunks, linked through their first word.
+        void* freeList = nullptr;
+        /// Unused part of the class' current slab.
+        char* next = nullptr;
+        char* end = nullptr;
+    };
+
+    static constexpr size_t numSizeClasses = maxChunkSize / chunkGranularity;
+
+    SlabAllocator();
+    ~SlabAllocator();
+
+    /// @return a new slab for the given class.
+    char* newSlab(SizeClass& sizeClass);
+
+    /// Drop a reference; the last one deletes the allocator.
+    void release();
+
+    std::array<SizeClass, numSizeClasses> sizeClasses;
+
+    /// Guards regions, nextSlab and slabsLeft.
+    std::mutex regionMutex;
+    std::vector<void*> regions;
+    char* nextSlab = nullptr;
+    size_t slabsLeft = 0;
+
+    std::atomic<size_t> allocatedBytes{0};
+    std::atomic<size_t> usedBytes{0};
+
+    /// The owner's reference plus one per allocated chunk.
+    std::atomic<size_t> refs{1};
+};
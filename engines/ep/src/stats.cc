@@ -24,6 +24,8 @@
 #define DEFAULT_MAX_DATA_SIZE (std::numeric_limits<size_t>::max())
 #endif
 
+constexpr std::chrono::milliseconds EPStats::arenaMemoryRefreshInterval;
+
 EPStats::EPStats()
     : warmedUpKeys(0),
       warmedUpValues(0),
@@ -43,6 +45,7 @@ EPStats::EPStats()
       tooOld(0),
       totalPersisted(0),
       totalPersistVBState(0),
+      totalDeferredVBState(0),
       totalEnqueued(0),
       flushFailed(0),
       flushExpired(0),
@@ -64,14 +67,18 @@ EPStats::EPStats()
       cursorDroppingUThreshold(0),
       cursorsDropped(0),
       cursorMemoryFreed(0),
+      htHugePageMemory(0),
       pagerRuns(0),
+      pagerPredictiveRuns(0),
       expiryPagerRuns(0),
+      expiryPagerFullScans(0),
       freqDecayerRuns(0),
       itemsExpelledFromCheckpoints(0),
       itemsRemovedFromCheckpoints(0),
       numValueEjects(0),
       numFailedEjects(0),
       numNotMyVBuckets(0),
+      numStaleReplicaReads(0),
       estimatedTotalMemory(0),
       memoryTrackerEnabled(false),
       forceShutdown(false),
@@ -82,8 +89,13 @@ EPStats::EPStats()
       pendingOpsMax(0),
       pendingOpsMaxDuration(0),
       pendingCompactions(0),
+      compactionIOThrottled(0),
+      compactionIOThrottleTime(0),
+      compactionIOBackoffs(0),
       bg_fetched(0),
       bg_meta_fetched(0),
+      keyDirectoryHits(0),
+      negativeLookupCacheHits(0),
       numRemainingBgItems(0),
       numRemainingBgJobs(0),
       bgNumOperations(0),
@@ -118,8 +130,12 @@ EPStats::EPStats()
       defragNumVisited(0),
       defragNumMoved(0),
       defragStoredValueNumMoved(0),
+      defragNumSkipped(0),
       compressorNumVisited(0),
       compressorNumCompressed(0),
+      compressorNumSkipped(0),
+      compressorNumHot(0),
+      compressorBytesSaved(0),
       dirtyAgeHisto(),
       diskCommitHisto(),
       timingLog(NULL),
@@ -154,7 +170,7 @@ void EPStats::calculateMemUsedMergeThreshold() {
 }
 
 void EPStats::memAllocated(size_t sz) {
-    if (isShutdown) {
+    if (isShutdown || memoryArena.load(std::memory_order_relaxed)) {
         return;
     }
 
@@ -172,7 +188,7 @@ void EPStats::memAllocated(size_t sz) {
 }
 
 void EPStats::memDeallocated(size_t sz) {
-    if (isShutdown) {
+    if (isShutdown || memoryArena.load(std::memory_order_relaxed)) {
         return;
     }
 
@@ -199,6 +215,9 @@ void EPStats::maybeUpdateEstimatedTotalMemUsed(
 }
 
 size_t EPStats::getPreciseTotalMemoryUsed() {
+    if (memoryArena.load()) {
+        return getArenaMemoryUsed(true);
+    }
     if (memoryTrackerEnabled.load()) {
         for (auto& core : coreLocal) {
             estimatedTotalMemory->fetch_add(
@@ -211,6 +230,39 @@ size_t EPStats::getPreciseTotalMemoryUsed() {
     return getCurrentSize() + getMemOverhead();
 }
 
+void EPStats::setMemoryArena(unsigned arena,
+                             bool (*getArenaAllocated)(unsigned arena,
+                                                       size_t* value)) {
+    arenaBaseline = getPreciseTotalMemoryUsed();
+    this->getArenaAllocated = getArenaAllocated;
+    size_t allocated = 0;
+    getArenaAllocated(arena, &allocated);
+    arenaMemoryUsed = arenaBaseline + allocated;
+    arenaMemoryReadTime = std::chrono::steady_clock::now()
+                                  .time_since_epoch()
+                                  .count();
+    memoryArena = arena;
+}
+
+size_t EPStats::getArenaMemoryUsed(bool refresh) const {
+    using std::chrono::steady_clock;
+    const auto now = steady_clock::now().time_since_epoch().count();
+    const auto interval =
+            std::chrono::duration_cast<steady_clock::duration>(
+                    arenaMemoryRefreshInterval)
+                    .count();
+    auto readTime = arenaMemoryReadTime.load();
+    // Only one thread re-reads the arena's stats when they go stale.
+    if ((refresh || now - readTime >= interval) &&
+        arenaMemoryReadTime.compare_exchange_strong(readTime, now)) {
+        size_t allocated;
+        if (getArenaAllocated(memoryArena, &allocated)) {
+            arenaMemoryUsed = arenaBaseline + allocated;
+        }
+    }
+    return arenaMemoryUsed;
+}
+
 size_t EPStats::getCurrentSize() const {
     int64_t result = 0;
     for (const auto& core : coreLocal) {
@@ -279,20 +331,26 @@ void EPStats::reset() {
     tooYoung.store(0);
     tooOld.store(0);
     totalPersistVBState.store(0);
+    totalDeferredVBState.store(0);
     dirtyAge.store(0);
     dirtyAgeHighWat.store(0);
     commit_time.store(0);
     cursorsDropped.store(0);
     cursorMemoryFreed.store(0);
     pagerRuns.store(0);
+    pagerPredictiveRuns.store(0);
     expiryPagerRuns.store(0);
+    expiryPagerFullScans.store(0);
     freqDecayerRuns.store(0);
     itemsExpelledFromCheckpoints.store(0);
     itemsRemovedFromCheckpoints.store(0);
     numValueEjects.store(0);
     numFailedEjects.store(0);
     numNotMyVBuckets.store(0);
+    numStaleReplicaReads.store(0);
     bg_fetched.store(0);
+    keyDirectoryHits.store(0);
+    negativeLookupCacheHits.store(0);
     bgNumOperations.store(0);
     bgWait.store(0);
     bgLoad.store(0);
@@ -306,15 +364,21 @@ void EPStats::reset() {
     pendingOpsTotal.store(0);
     pendingOpsMax.store(0);
     pendingOpsMaxDuration.store(0);
+    compactionIOThrottled.store(0);
+    compactionIOThrottleTime.store(0);
+    compactionIOBackoffs.store(0);
     vbucketDelMaxWalltime.store(0);
     vbucketDelTotWalltime.store(0);
 
     alogRuns.store(0);
     accessScannerSkips.store(0), defragNumVisited.store(0),
-            defragNumMoved.store(0);
+            defragNumMoved.store(0), defragNumSkipped.store(0);
 
     compressorNumVisited.store(0);
     compressorNumCompressed.store(0);
+    compressorNumSkipped.store(0);
+    compressorNumHot.store(0);
+    compressorBytesSaved.store(0);
 
     pendingOpsHisto.reset();
     bgWaitHisto.reset();
@@ -352,6 +416,9 @@ void EPStats::reset() {
     for (auto& hist : syncWriteCommitTimes) {
         hist.reset();
     }
+    syncWritePersistWaitHisto.reset();
+    syncWriteReplicaAckTimes.wlock()->clear();
+    replicationApplyDelayHisto.reset();
 }
 
 size_t EPStats::getMemFootPrint() const {
@@ -365,6 +432,14 @@ size_t EPStats::getMemFootPrint() const {
         taskHistogramSizes +=
                 taskRuntimeHisto.size() * taskRuntimeHisto[0].getMemFootPrint();
     }
+    taskHistogramSizes += readerClassSchedulingHisto.size() *
+                          readerClassSchedulingHisto[0].getMemFootPrint();
+    taskHistogramSizes += taskRuntimeWindow.getMemFootPrint();
+
+    size_t replicaAckHistogramSizes = 0;
+    for (const auto& entry : *syncWriteReplicaAckTimes.rlock()) {
+        replicaAckHistogramSizes += entry.second.getMemFootPrint();
+    }
 
     return pendingOpsHisto.getMemFootPrint() + bgWaitHisto.getMemFootPrint() +
            bgLoadHisto.getMemFootPrint() + setWithMetaHisto.getMemFootPrint() +
@@ -392,5 +467,7 @@ size_t EPStats::getMemFootPrint() const {
            replicaFrequencyValuesEvictedHisto.getMemFootPrint() +
            activeOrPendingFrequencyValuesSnapshotHisto.getMemFootPrint() +
            replicaFrequencyValuesSnapshotHisto.getMemFootPrint() +
-           taskHistogramSizes;
+           syncWritePersistWaitHisto.getMemFootPrint() +
+           replicationApplyDelayHisto.getMemFootPrint() + taskHistogramSizes +
+           replicaAckHistogramSizes;
 }
@@ -17,10 +17,14 @@
 
 #pragma once
 
+#include "core_local_counter.h"
 #include "hdrhistogram.h"
 #include "objectregistry.h"
+#include "task_runtime_window.h"
+#include "task_type.h"
 
 #include <folly/CachelinePadded.h>
+#include <folly/Synchronized.h>
 #include <memcached/durability_spec.h>
 #include <memcached/types.h>
 #include <platform/corestore.h>
@@ -32,6 +36,9 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
 
 class CoreLocalStats;
 
@@ -82,6 +89,9 @@ public:
      * returns.
      */
     size_t getEstimatedTotalMemoryUsed() const {
+        if (memoryArena.load()) {
+            return getArenaMemoryUsed(false);
+        }
         int64_t rv = 0;
         if (memoryTrackerEnabled.load()) {
             rv = estimatedTotalMemory->load();
@@ -103,6 +113,27 @@ public:
      */
     size_t getPreciseTotalMemoryUsed();
 
+    /**
+     * Account for this bucket's memory from the stats of its own allocator
+     * arena (which all of its threads' allocations now go to), in place of
+     * the per-allocation tracking.
+     *
+     * Memory allocated before the arena was created continues to be counted
+     * at its size at this point.
+     *
+     * @param arena the bucket's arena
+     * @param getArenaAllocated function reading the bytes allocated from an
+     *        arena
+     */
+    void setMemoryArena(unsigned arena,
+                        bool (*getArenaAllocated)(unsigned arena,
+                                                  size_t* value));
+
+    /// @return the bucket's allocator arena, or 0 if it doesn't have one.
+    unsigned getMemoryArena() const {
+        return memoryArena.load();
+    }
+
     /// @returns total size of stored objects.
     size_t getCurrentSize() const;
 
@@ -173,10 +204,12 @@ public:
     Counter totalPersisted;
     //! Number of times VBucket state persisted.
     Counter totalPersistVBState;
+    //! Number of VBucket state changes deferred to a later flush batch.
+    Counter totalDeferredVBState;
     //! Cumulative number of items added to the queue.
-    Counter totalEnqueued;
+    CoreLocalCounter totalEnqueued;
     //! Cumulative count of items de-duplicated when queued to CheckpointManager
-    Counter totalDeduplicated;
+    CoreLocalCounter totalDeduplicated;
     //! Number of times an item flush failed.
     Counter flushFailed;
     //! Number of times an item is not flushed due to the item's expiry
@@ -189,11 +222,11 @@ public:
     // persisted to disk (and callback invoked).
 
     //! Number of times an object was expired on access.
-    Counter expired_access;
+    CoreLocalCounter expired_access;
     //! Number of times an object was expired by compactor.
-    Counter expired_compactor;
+    CoreLocalCounter expired_compactor;
     //! Number of times an object was expired by pager.
-    Counter expired_pager;
+    CoreLocalCounter expired_pager;
 
     //! Number of times we failed to start a transaction
     Counter beginFailed;
@@ -228,10 +261,20 @@ public:
     //! Amount of memory we have freed by dropping cursors
     std::atomic<size_t> cursorMemoryFreed;
 
+    //! Memory used by HashTable bucket arrays backed by huge pages (see
+    //! ht_huge_pages). Included in the memory used by the bucket.
+    Counter htHugePageMemory;
+
     //! Number of times we needed to kick in the pager
     Counter pagerRuns;
+    //! Number of pager runs started by a predicted (rather than actual)
+    //! crossing of the high watermark
+    Counter pagerPredictiveRuns;
     //! Number of times the expiry pager runs for purging expired items
     Counter expiryPagerRuns;
+    //! Number of expiry pager runs which visited the whole HashTable
+    //! (rather than the expiry index)
+    Counter expiryPagerFullScans;
     //! Number of times the item frequency decayer runs
     Counter freqDecayerRuns;
     //! The number items expelled from checkpoints
@@ -243,7 +286,10 @@ public:
     //! Number of times a value could not be ejected
     Counter numFailedEjects;
     //! Number of times "Not my bucket" happened
-    Counter numNotMyVBuckets;
+    CoreLocalCounter numNotMyVBuckets;
+    //! Number of replica reads rejected as the replica may be more out of
+    //! date than the client accepts
+    Counter numStaleReplicaReads;
 
     //! The total amount of memory used by this bucket (From memory tracking)
     // This is a signed variable as depending on how/when the thread-local
@@ -255,12 +301,15 @@ public:
 
     //! True if the memory usage tracker is enabled.
     std::atomic<bool> memoryTrackerEnabled;
+
+    /// How long a reading of the arena's stats is used for, at most.
+    static constexpr std::chrono::milliseconds arenaMemoryRefreshInterval{10};
     //! Whether or not to force engine shutdown.
     std::atomic<bool> forceShutdown;
     //! Number of times unrecoverable oom errors happened while processing operations.
-    Counter oom_errors;
+    CoreLocalCounter oom_errors;
     //! Number of times temporary oom errors encountered while processing operations.
-    Counter tmp_oom_errors;
+    CoreLocalCounter tmp_oom_errors;
 
     //! Number of ops blocked on all vbuckets in pending state
     Counter pendingOps;
@@ -276,17 +325,29 @@ public:
 
     //! Number of pending vbucket compaction requests
     Counter pendingCompactions;
+    //! Number of compaction I/Os delayed by the compaction rate limiter
+    Counter compactionIOThrottled;
+    //! Total time (in us) compaction I/Os were delayed by the rate limiter
+    Counter compactionIOThrottleTime;
+    //! Number of times the compaction rate limiter backed off
+    Counter compactionIOBackoffs;
 
     //! Number of times background fetches occurred.
-    Counter bg_fetched;
+    CoreLocalCounter bg_fetched;
     //! Number of times meta background fetches occurred.
-    Counter bg_meta_fetched;
+    CoreLocalCounter bg_meta_fetched;
+    //! Number of adds of evicted keys rejected by the KeyDirectory (without
+    //! a background fetch)
+    Counter keyDirectoryHits;
+    //! Number of lookups of missing keys answered by the NegativeLookupCache
+    //! (without a bloom filter check or background fetch)
+    Counter negativeLookupCacheHits;
     //! Number of remaining bg fetch items
     Counter numRemainingBgItems;
     //! Number of remaining bg fetch jobs.
     Counter numRemainingBgJobs;
     //! The number of samples the bgWaitDelta and bgLoadDelta contains of
-    Counter bgNumOperations;
+    CoreLocalCounter bgNumOperations;
 
     /** The sum of the deltas (in usec) from an item was put in queue until
      *  the dispatcher started the work for this item
@@ -333,28 +394,28 @@ public:
     std::atomic<double> replicationThrottleThreshold;
 
     //! The number of basic store (add, set, arithmetic, touch, etc.) operations
-    Counter numOpsStore;
+    CoreLocalCounter numOpsStore;
     //! The number of basic delete operations
-    Counter numOpsDelete;
+    CoreLocalCounter numOpsDelete;
     //! The number of basic get operations
-    Counter numOpsGet;
+    CoreLocalCounter numOpsGet;
 
     //! The number of get with meta operations
-    Counter  numOpsGetMeta;
+    CoreLocalCounter numOpsGetMeta;
     //! The number of set with meta operations
-    Counter  numOpsSetMeta;
+    CoreLocalCounter numOpsSetMeta;
     //! The number of delete with meta operations
-    Counter  numOpsDelMeta;
+    CoreLocalCounter numOpsDelMeta;
     //! The number of failed set meta ops due to conflict resoltion
-    Counter numOpsSetMetaResolutionFailed;
+    CoreLocalCounter numOpsSetMetaResolutionFailed;
     //! The number of failed del meta ops due to conflict resoltion
-    Counter numOpsDelMetaResolutionFailed;
+    CoreLocalCounter numOpsDelMetaResolutionFailed;
     //! The number of set returning meta operations
-    Counter  numOpsSetRetMeta;
+    CoreLocalCounter numOpsSetRetMeta;
     //! The number of delete returning meta operations
-    Counter  numOpsDelRetMeta;
+    CoreLocalCounter numOpsDelRetMeta;
     //! The number of background get meta ops due to set_with_meta operations
-    Counter  numOpsGetMetaOnSetWithMeta;
+    CoreLocalCounter numOpsGetMetaOnSetWithMeta;
 
     //! The number of times the access scanner runs
     Counter alogRuns;
@@ -392,8 +453,22 @@ public:
      */
     Counter defragStoredValueNumMoved;
 
+    /**
+     * The number of items and StoredValues old enough to be defragmented,
+     * which the defragmenter task skipped as their size class is dense.
+     */
+    Counter defragNumSkipped;
+
     Counter compressorNumVisited;
     Counter compressorNumCompressed;
+    /// Compressible items the compressor didn't deflate, as their collection
+    /// (recently) didn't compress well (see CollectionCompressibility)
+    Counter compressorNumSkipped;
+    /// Compressible items the compressor didn't deflate, as their frequency
+    /// counter was above item_compressor_freq_counter_threshold
+    Counter compressorNumHot;
+    /// Bytes of value saved by the compressor deflating items
+    Counter compressorBytesSaved;
 
     //! Histogram of queue processing dirty age.
     Hdr1sfMicroSecHistogram dirtyAgeHisto;
@@ -491,9 +566,25 @@ public:
     // ! Histograms of various task wait times, one per Task.
     std::vector<Hdr1sfMicroSecHistogram> schedulingHisto;
 
+    //! Histograms of reader task wait times, one per ReaderClass.
+    std::array<Hdr1sfMicroSecHistogram, size_t(ReaderClass::Count)>
+            readerClassSchedulingHisto;
+
     // ! Histograms of various task run times, one per Task.
     std::vector<Hdr1sfMicroSecHistogram> taskRuntimeHisto;
 
+    //! Recent run time of each Task, for the "tasks-top" stat group.
+    TaskRuntimeWindow taskRuntimeWindow;
+
+    //! Total time (ns) this bucket's tasks have spent running on executor
+    //! threads. Monotonic; not cleared by reset().
+    std::atomic<uint64_t> taskRuntimeNs{0};
+
+    //! Total CPU time (ns) executor threads have spent running this bucket's
+    //! tasks (excludes time blocked on IO or locks). Monotonic; not cleared
+    //! by reset().
+    std::atomic<uint64_t> taskCpuTimeNs{0};
+
     //! Checkpoint Cursor histograms
     Hdr1sfMicroSecHistogram persistenceCursorGetItemsHisto;
     Hdr1sfMicroSecHistogram dcpCursorsGetItemsHisto;
@@ -506,6 +597,24 @@ public:
                size_t(cb::durability::Level::PersistToMajority)>
             syncWriteCommitTimes;
 
+    /// Histogram of the time SyncWrites requiring persistence wait to be
+    /// persisted; measured from when the oldest such SyncWrite in a flush
+    /// batch is queued up to when the batch is committed.
+    Hdr1sfMicroSecHistogram syncWritePersistWaitHisto;
+
+    /// Histograms of how long each replica takes to ack a SyncWrite;
+    /// measured from when the SyncWrite is added to the (active) durability
+    /// monitor up to when the replica's seqno ack reaches it. Keyed by
+    /// replica node name.
+    folly::Synchronized<std::map<std::string, Hdr1sfMicroSecHistogram>>
+            syncWriteReplicaAckTimes;
+
+    /// Histogram of the replication apply delay on this node as a replica;
+    /// measured from when a mutation was made on the active (the physical
+    /// time in its HLC CAS) up to when it is applied here. Subject to any
+    /// clock skew between the nodes.
+    Hdr1sfMicroSecHistogram replicationApplyDelayHisto;
+
     //! Reset all stats to reasonable values.
     void reset();
 
@@ -515,6 +624,23 @@ public:
     std::ostream *timingLog;
 
 protected:
+    /**
+     * @return the memory used according to the bucket's arena, re-reading
+     *         the arena's stats if refresh is set or the last reading is
+     *         older than arenaMemoryRefreshInterval.
+     */
+    size_t getArenaMemoryUsed(bool refresh) const;
+
+    /// The bucket's allocator arena; 0 if memory is tracked per allocation.
+    std::atomic<unsigned> memoryArena{0};
+    bool (*getArenaAllocated)(unsigned arena, size_t* value) = nullptr;
+    /// Memory used by the bucket before its arena was created.
+    size_t arenaBaseline = 0;
+    /// The last reading of the arena's stats (plus arenaBaseline).
+    mutable cb::RelaxedAtomic<size_t> arenaMemoryUsed{0};
+    /// When arenaMemoryUsed was read, in steady_clock ticks.
+    mutable std::atomic<int64_t> arenaMemoryReadTime{0};
+
     /**
      * Check abs(value) against memUsedMergeThreshold, if it is greater then
      * The thread will attempt to reset coreMemory to zero. If the thread
@@ -25,9 +25,12 @@
 #include <platform/sized_buffer.h>
 
 #include <atomic>
+#include <cinttypes>
+#include <cstdio>
 #include <cstring>
 #include <sstream>
 #include <tuple>
+#include <type_traits>
 
 class EventuallyPersistentEngine;
 
@@ -39,14 +42,56 @@ inline void add_casted_stat(const char* k,
              v, static_cast<uint32_t>(strlen(v)), cookie);
 }
 
+/// @cond DETAILS
+/**
+ * Format an integer on the stack; stats calls for every vBucket / stream
+ * format dozens of integers, where a std::stringstream per value dominates
+ * the cost. (Single byte types are excluded as a stringstream formats
+ * those as characters.)
+ */
+template <typename T>
+void add_casted_stat_value(const char* k,
+                           const T& v,
+                           const AddStatFn& add_stat,
+                           const void* cookie,
+                           std::true_type) {
+    char buf[32];
+    const int len =
+            std::is_signed<T>::value
+                    ? snprintf(buf, sizeof(buf), "%" PRId64, int64_t(v))
+                    : snprintf(buf, sizeof(buf), "%" PRIu64, uint64_t(v));
+    add_stat(k,
+             static_cast<uint16_t>(strlen(k)),
+             buf,
+             static_cast<uint32_t>(len),
+             cookie);
+}
+
+template <typename T>
+void add_casted_stat_value(const char* k,
+                           const T& v,
+                           const AddStatFn& add_stat,
+                           const void* cookie,
+                           std::false_type) {
+    std::stringstream vals;
+    vals << v;
+    add_casted_stat(k, vals.str().c_str(), add_stat, cookie);
+}
+/// @endcond
+
 template <typename T>
 void add_casted_stat(const char* k,
                      const T& v,
                      const AddStatFn& add_stat,
                      const void* cookie) {
-    std::stringstream vals;
-    vals << v;
-    add_casted_stat(k, vals.str().c_str(), add_stat, cookie);
+    add_casted_stat_value(
+            k,
+            v,
+            add_stat,
+            cookie,
+            std::integral_constant<bool,
+                                   std::is_integral<T>::value &&
+                                           (sizeof(T) > 1)>{});
 }
 
 inline void add_casted_stat(const char* k,
@@ -20,6 +20,7 @@
 #include "ep_time.h"
 #include "item.h"
 #include "objectregistry.h"
+#include "slab_allocator.h"
 #include "stats.h"
 
 #include <nlohmann/json.hpp>
@@ -36,7 +37,9 @@ const int64_t StoredValue::state_temp_init = -5;
 StoredValue::StoredValue(const Item& itm,
                          UniquePtr n,
                          EPStats& stats,
-                         bool isOrdered)
+                         bool isOrdered,
+                         bool slabAllocated,
+                         uint8_t inlineValueCapacity)
     : value(itm.getValue()),
       chain_next_or_replacement(std::move(n)),
       cas(itm.getCas()),
@@ -47,10 +50,12 @@ StoredValue::StoredValue(const Item& itm,
       revSeqno(itm.getRevSeqno()),
       datatype(itm.getDataType()),
       deletionSource(0),
-      committed(static_cast<uint8_t>(CommittedState::CommittedViaMutation)) {
+      committed(static_cast<uint8_t>(CommittedState::CommittedViaMutation)),
+      inlineValue(0) {
     // Initialise bit fields
     setDeletedPriv(itm.isDeleted());
     setOrdered(isOrdered);
+    bits.set(slabAllocatedIndex, slabAllocated);
     setNru(itm.getNRUValue());
     setResident(!isTempItem());
     setStale(false);
@@ -61,6 +66,7 @@ StoredValue::StoredValue(const Item& itm,
     // Placement-new the key which lives in memory directly after this
     // object.
     new (key()) SerialisedDocKey(itm.getKey());
+    initInlineValue(inlineValueCapacity);
 
     if (isTempInitialItem()) {
         markClean();
@@ -70,6 +76,8 @@ StoredValue::StoredValue(const Item& itm,
 
     if (isTempItem()) {
         resetValue();
+    } else {
+        maybeInlineValue();
     }
 
     if (itm.isDeleted()) {
@@ -83,7 +91,11 @@ StoredValue::~StoredValue() {
     ObjectRegistry::onDeleteStoredValue(this);
 }
 
-StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
+StoredValue::StoredValue(const StoredValue& other,
+                         UniquePtr n,
+                         EPStats& stats,
+                         bool slabAllocated,
+                         uint8_t inlineValueCapacity)
     : value(other.value), // Implicitly also copies the frequency counter
       chain_next_or_replacement(std::move(n)),
       cas(other.cas),
@@ -93,10 +105,12 @@ StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
       exptime(other.exptime),
       flags(other.flags),
       revSeqno(other.revSeqno),
-      datatype(other.datatype) {
+      datatype(other.datatype),
+      inlineValue(0) {
     setDirty(other.isDirty());
     setDeletedPriv(other.isDeleted());
     setOrdered(other.isOrdered());
+    bits.set(slabAllocatedIndex, slabAllocated);
     setNru(other.getNru());
     setResident(other.isResident());
     setStale(false);
@@ -106,6 +120,16 @@ StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
     // object.
     StoredDocKey sKey(other.getKey());
     new (key()) SerialisedDocKey(sKey);
+    initInlineValue(inlineValueCapacity);
+
+    // An inline value is never shared; the copy has its own (inline if it
+    // fits, otherwise on the heap).
+    maybeInlineValue();
+    if (value && value->isEmbedded() && !isValueInline()) {
+        auto tag = getValueTag();
+        value.reset(Blob::Copy(*value));
+        setValueTag(tag);
+    }
 
     if (isDeleted()) {
         setDeletionSource(other.getDeletionSource());
@@ -170,6 +194,7 @@ void StoredValue::restoreValue(const Item& itm) {
     auto age = getAge();
 
     value = itm.getValue();
+    maybeInlineValue();
 
     setFreqCounterValue(freq);
     setCommitted(itm.getCommitted());
@@ -215,8 +240,15 @@ bool StoredValue::del(DeleteSource delSource) {
     }
 }
 
-size_t StoredValue::getRequiredStorage(const DocKey& key) {
-    return sizeof(StoredValue) + SerialisedDocKey::getObjectSize(key.size());
+size_t StoredValue::getRequiredStorage(const DocKey& key,
+                                       uint8_t inlineValueCapacity) {
+    const auto keyEnd =
+            sizeof(StoredValue) + SerialisedDocKey::getObjectSize(key.size());
+    if (inlineValueCapacity == 0) {
+        return keyEnd;
+    }
+    return getInlineValueOffset(keyEnd) +
+           Blob::getEmbeddedSize(inlineValueCapacity);
 }
 
 std::unique_ptr<Item> StoredValue::toItem(
@@ -270,17 +302,75 @@ std::unique_ptr<Item> StoredValue::toItemAbort(Vbid vbid) const {
 }
 
 void StoredValue::reallocate() {
+    if (isValueInline()) {
+        // Nothing separately allocated to move.
+        return;
+    }
     // Allocate a new Blob for this stored value; copy the existing Blob to
     // the new one and free the old.
     replaceValue(std::unique_ptr<Blob>{Blob::Copy(*value)});
 }
 
+void StoredValue::initInlineValue(uint8_t capacity) {
+    if (capacity == 0) {
+        return;
+    }
+    inlineValue = 1;
+    *const_cast<uint8_t*>(inlineValueCapacity()) = capacity;
+}
+
+void StoredValue::maybeInlineValue() {
+    if (!inlineValue || !value || isValueInline() ||
+        value->valueSize() > *inlineValueCapacity()) {
+        return;
+    }
+    // The pre-link step may patch the xattrs of a new document (macro
+    // expansion) after it has been linked into the HashTable, through the
+    // Blob shared with the Item being stored - so it must stay shared.
+    if (mcbp::datatype::is_xattr(datatype)) {
+        return;
+    }
+    // Any previous inline value has been released (it is only ever
+    // referenced by us), so the storage is free.
+    auto* storage = const_cast<void*>(inlineValueStorage());
+    auto tag = getValueTag();
+    value.reset(Blob::Embed(storage, *value));
+    setValueTag(tag);
+}
+
+bool StoredValue::maybeOverwriteValue(const value_t& newValue) {
+    if (!value || !newValue || value.get().get() == newValue.get().get() ||
+        value->isEmbedded() || value.refCount() != 1 ||
+        value->valueSize() != newValue->valueSize()) {
+        return false;
+    }
+    // As for inlining, a value with xattrs must stay shared with the Item so
+    // the pre-link step can patch it.
+    if (mcbp::datatype::is_xattr(datatype)) {
+        return false;
+    }
+    // Only referenced by us (under the HashBucketLock), so no reader can see
+    // the copy in progress.
+    value->overwrite(*newValue);
+    return true;
+}
+
 void StoredValue::Deleter::operator()(StoredValue* val) {
+    if (!val->isSlabAllocated()) {
+        if (val->isOrdered()) {
+            delete static_cast<OrderedStoredValue*>(val);
+        } else {
+            delete val;
+        }
+        return;
+    }
+
     if (val->isOrdered()) {
-        delete static_cast<OrderedStoredValue*>(val);
+        static_cast<OrderedStoredValue*>(val)->~OrderedStoredValue();
     } else {
-        delete val;
+        val->~StoredValue();
     }
+    SlabAllocator::deallocate(val);
 }
 
 OrderedStoredValue* StoredValue::toOrderedStoredValue() {
@@ -348,7 +438,11 @@ std::unique_ptr<Item> StoredValue::toItemBase(Vbid vbid,
             getKey(),
             getFlags(),
             getExptime(),
-            includeValue == IncludeValue::Yes ? value : value_t{},
+            includeValue == IncludeValue::No
+                    ? value_t{}
+                    // An inline value can't outlive us, so give the Item
+                    // a copy.
+                    : isValueInline() ? value_t{Blob::Copy(*value)} : value,
             datatype,
             hideLockedCas == HideLockedCas::Yes ? static_cast<uint64_t>(-1)
                                                 : getCas(),
@@ -390,7 +484,9 @@ void StoredValue::setValueImpl(const Item& itm) {
         setResident(false);
     } else {
         setResident(true);
-        replaceValue(itm.getValue().get());
+        if (!maybeOverwriteValue(itm.getValue())) {
+            replaceValue(itm.getValue().get());
+        }
     }
     setCommitted(itm.getCommitted());
 }
@@ -285,6 +285,9 @@ public:
 
     /**
      * Get this item's value.
+     *
+     * If the value is stored inline (see isValueInline()) it must not be
+     * retained beyond the StoredValue's lifetime; use toItem() to take a copy.
      */
     const value_t &getValue() const {
         return value;
@@ -559,6 +562,28 @@ public:
         return bits.test(residentIndex);
     }
 
+    /**
+     * True if this object's storage came from a SlabAllocator (rather than
+     * directly from the heap).
+     */
+    bool isSlabAllocated() const {
+        return bits.test(slabAllocatedIndex);
+    }
+
+    /**
+     * @return the size of the largest value which can be stored inline (in
+     *         this object's own storage, rather than a separately allocated
+     *         Blob); zero if there is no inline storage.
+     */
+    size_t getInlineValueCapacity() const {
+        return inlineValue ? *inlineValueCapacity() : 0;
+    }
+
+    /// True if the value is stored inline.
+    bool isValueInline() const {
+        return inlineValue && value.get().get() == inlineValueStorage();
+    }
+
     void markNotResident() {
         resetValue();
         setResident(false);
@@ -585,6 +610,7 @@ public:
         auto tag = getValueTag();
         value.reset(data.release());
         setValueTag(tag);
+        maybeInlineValue();
     }
 
     /**
@@ -596,6 +622,7 @@ public:
         auto tag = getValueTag();
         this->value = value;
         setValueTag(tag);
+        maybeInlineValue();
     }
 
     /**
@@ -736,7 +763,8 @@ public:
 
     /**
      * Return the size in byte of this object; both the fixed fields and the
-     * variable-length key. Doesn't include value size (allocated externally).
+     * variable-length key (and the inline value storage, if any). Doesn't
+     * include the size of a value allocated externally.
      */
     inline size_t getObjectSize() const;
 
@@ -766,8 +794,13 @@ public:
 
     bool operator!=(const StoredValue& other) const;
 
-    /// Return how many bytes are need to store item given key as a StoredValue
-    static size_t getRequiredStorage(const DocKey& key);
+    /**
+     * Return how many bytes are need to store item given key as a StoredValue
+     * @param inlineValueCapacity size of the largest value to be stored
+     *        inline.
+     */
+    static size_t getRequiredStorage(const DocKey& key,
+                                     uint8_t inlineValueCapacity = 0);
 
     /**
      * @return the deletion source of the stored value
@@ -844,7 +877,9 @@ protected:
     StoredValue(const Item& itm,
                 UniquePtr n,
                 EPStats& stats,
-                bool isOrdered);
+                bool isOrdered,
+                bool slabAllocated = false,
+                uint8_t inlineValueCapacity = 0);
 
     // Destructor. protected, as needs to be carefully deleted (via
     // StoredValue::Destructor) depending on the value of isOrdered flag.
@@ -863,7 +898,9 @@ protected:
      */
     StoredValue(const StoredValue& other,
                 UniquePtr n,
-                EPStats& stats);
+                EPStats& stats,
+                bool slabAllocated = false,
+                uint8_t inlineValueCapacity = 0);
 
     /* Do not allow assignment */
     StoredValue& operator=(const StoredValue& other) = delete;
@@ -873,6 +910,45 @@ protected:
      */
     inline SerialisedDocKey* key();
 
+    /// @return the offset of the end of the key from the start of the object.
+    inline size_t getKeyEnd() const;
+
+    /**
+     * Inline value storage follows the key: a byte holding the capacity,
+     * then (aligned for a Blob) space for an embedded Blob of that capacity.
+     */
+    static size_t getInlineValueOffset(size_t keyEnd) {
+        return (keyEnd + 1 + alignof(Blob) - 1) & ~(alignof(Blob) - 1);
+    }
+
+    const uint8_t* inlineValueCapacity() const {
+        return reinterpret_cast<const uint8_t*>(this) + getKeyEnd();
+    }
+
+    const void* inlineValueStorage() const {
+        return reinterpret_cast<const char*>(this) +
+               getInlineValueOffset(getKeyEnd());
+    }
+
+    /// Give the object inline value storage of the given capacity.
+    void initInlineValue(uint8_t capacity);
+
+    /**
+     * If there's inline value storage and the (current, heap-allocated)
+     * value fits, move the value into it. Values with xattrs are never
+     * inlined.
+     */
+    void maybeInlineValue();
+
+    /**
+     * If our value is a heap Blob referenced only by us and the same size as
+     * newValue, copy newValue into it rather than switching Blobs, so the
+     * HashTable keeps its allocation and the caller's Blob is freed by the
+     * caller, outside the HashBucketLock.
+     * @return true if the value was overwritten in place
+     */
+    bool maybeOverwriteValue(const value_t& newValue);
+
     /**
      * Logically mark this SV as deleted.
      * Implementation for StoredValue instances (dispatched to by del() based
@@ -943,6 +1019,7 @@ protected:
     }
 
     friend class StoredValueFactory;
+    friend class InlineValueStoredValueFactory;
 
     /**
      * Granting friendship to StoredValueProtected test fixture to access
@@ -1011,8 +1088,9 @@ protected:
      */
     static constexpr size_t dirtyIndex = 0;
     static constexpr size_t deletedIndex = 1;
-    // Bit 2 of bits is currently unused and may be used for new purposes.
-    // static constexpr size_t unused = 2;
+    // slabAllocated := true if the object's storage came from a
+    //                  SlabAllocator rather than the heap.
+    static constexpr size_t slabAllocatedIndex = 2;
     // ordered := true if this is an instance of OrderedStoredValue
     static constexpr size_t orderedIndex = 3;
     // 2 bit nru managed via setNru/getNru
@@ -1036,6 +1114,8 @@ protected:
     uint8_t deletionSource : 1;
     /// 3-bit value which encodes the CommittedState of the StoredValue
     uint8_t committed : 3;
+    /// True if the object has inline value storage (after the key).
+    uint8_t inlineValue : 1;
 
     friend std::ostream& operator<<(std::ostream& os, const StoredValue& sv);
     friend void to_json(nlohmann::json& json, const StoredValue& sv);
@@ -1161,8 +1241,10 @@ private:
     // OrderedStoredValueFactory.
     OrderedStoredValue(const Item& itm,
                        UniquePtr n,
-                       EPStats& stats)
-        : StoredValue(itm, std::move(n), stats, /*isOrdered*/ true) {
+                       EPStats& stats,
+                       bool slabAllocated = false)
+        : StoredValue(
+                  itm, std::move(n), stats, /*isOrdered*/ true, slabAllocated) {
     }
 
     // Copy Constructor. Private, as needs to be carefully created via
@@ -1173,8 +1255,9 @@ private:
     // data structure.
     OrderedStoredValue(const StoredValue& other,
                        UniquePtr n,
-                       EPStats& stats)
-        : StoredValue(other, std::move(n), stats) {
+                       EPStats& stats,
+                       bool slabAllocated = false)
+        : StoredValue(other, std::move(n), stats, slabAllocated) {
     }
 
     // Prepare seqno of a commit or abort StoredValue.
@@ -1208,7 +1291,7 @@ SerialisedDocKey* StoredValue::key() {
     }
 }
 
-size_t StoredValue::getObjectSize() const {
+size_t StoredValue::getKeyEnd() const {
     // Size of fixed part of OrderedStoredValue or StoredValue, plus size of
     // (variable) key.
     if (isOrdered()) {
@@ -1216,3 +1299,11 @@ size_t StoredValue::getObjectSize() const {
     }
     return sizeof(*this) + getKey().getObjectSize();
 }
+
+size_t StoredValue::getObjectSize() const {
+    if (inlineValue) {
+        return getInlineValueOffset(getKeyEnd()) +
+               Blob::getEmbeddedSize(*inlineValueCapacity());
+    }
+    return getKeyEnd();
+}
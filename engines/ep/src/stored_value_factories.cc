@@ -18,43 +18,89 @@
 #include "stored_value_factories.h"
 
 #include "item.h"
+#include "slab_allocator.h"
+
+namespace {
+/**
+ * Storage of size bytes for a StoredValue; from slabs if there is a slab
+ * allocator and the size fits, otherwise from the heap.
+ */
+void* allocateStorage(SlabAllocator* slabs, size_t size, bool& fromSlab) {
+    void* storage = slabs ? slabs->allocate(size) : nullptr;
+    fromSlab = storage != nullptr;
+    return storage ? storage : ::operator new(size);
+}
+} // namespace
 
 StoredValue::UniquePtr StoredValueFactory::operator()(
         const Item& itm, StoredValue::UniquePtr next) {
     // Allocate a buffer to store the StoredValue and any trailing bytes
     // that maybe required.
-    return StoredValue::UniquePtr(
-            new (::operator new(StoredValue::getRequiredStorage(itm.getKey())))
-                    StoredValue(itm,
-                                std::move(next),
-                                *stats,
-                                /*isOrdered*/ false));
+    bool fromSlab;
+    auto* storage = allocateStorage(
+            slabs.get(), StoredValue::getRequiredStorage(itm.getKey()), fromSlab);
+    return StoredValue::UniquePtr(new (storage) StoredValue(
+            itm, std::move(next), *stats, /*isOrdered*/ false, fromSlab));
 }
 
 StoredValue::UniquePtr StoredValueFactory::copyStoredValue(
         const StoredValue& other, StoredValue::UniquePtr next) {
     // Allocate a buffer to store the copy of StoredValue and any
     // trailing bytes required for the key.
-    return StoredValue::UniquePtr(
-            new (::operator new(other.getObjectSize()))
-                    StoredValue(other, std::move(next), *stats));
+    bool fromSlab;
+    auto* storage =
+            allocateStorage(slabs.get(), other.getObjectSize(), fromSlab);
+    return StoredValue::UniquePtr(new (storage) StoredValue(
+            other, std::move(next), *stats, fromSlab));
+}
+
+StoredValue::UniquePtr InlineValueStoredValueFactory::operator()(
+        const Item& itm, StoredValue::UniquePtr next) {
+    bool fromSlab;
+    auto* storage = allocateStorage(
+            slabs.get(),
+            StoredValue::getRequiredStorage(itm.getKey(), inlineValueCapacity),
+            fromSlab);
+    return StoredValue::UniquePtr(new (storage) StoredValue(itm,
+                                                            std::move(next),
+                                                            *stats,
+                                                            /*isOrdered*/ false,
+                                                            fromSlab,
+                                                            inlineValueCapacity));
+}
+
+StoredValue::UniquePtr InlineValueStoredValueFactory::copyStoredValue(
+        const StoredValue& other, StoredValue::UniquePtr next) {
+    bool fromSlab;
+    auto* storage = allocateStorage(
+            slabs.get(),
+            StoredValue::getRequiredStorage(other.getKey(),
+                                            inlineValueCapacity),
+            fromSlab);
+    return StoredValue::UniquePtr(new (storage) StoredValue(
+            other, std::move(next), *stats, fromSlab, inlineValueCapacity));
 }
 
 StoredValue::UniquePtr OrderedStoredValueFactory::operator()(
         const Item& itm, StoredValue::UniquePtr next) {
     // Allocate a buffer to store the OrderStoredValue and any trailing
     // bytes required for the key.
-    return StoredValue::UniquePtr(
-            new (::operator new(
-                    OrderedStoredValue::getRequiredStorage(itm.getKey())))
-                    OrderedStoredValue(itm, std::move(next), *stats));
+    bool fromSlab;
+    auto* storage = allocateStorage(
+            slabs.get(),
+            OrderedStoredValue::getRequiredStorage(itm.getKey()),
+            fromSlab);
+    return StoredValue::UniquePtr(new (storage) OrderedStoredValue(
+            itm, std::move(next), *stats, fromSlab));
 }
 
 StoredValue::UniquePtr OrderedStoredValueFactory::copyStoredValue(
         const StoredValue& other, StoredValue::UniquePtr next) {
     // Allocate a buffer to store the copy ofOrderStoredValue and any
     // trailing bytes required for the key.
-    return StoredValue::UniquePtr(
-            new (::operator new(other.getObjectSize()))
-                    OrderedStoredValue(other, std::move(next), *stats));
+    bool fromSlab;
+    auto* storage =
+            allocateStorage(slabs.get(), other.getObjectSize(), fromSlab);
+    return StoredValue::UniquePtr(new (storage) OrderedStoredValue(
+            other, std::move(next), *stats, fromSlab));
 }
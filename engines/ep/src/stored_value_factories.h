@@ -25,6 +25,8 @@
 
 #include "stored-value.h"
 
+class SlabAllocator;
+
 /**
  * Abstract base class for StoredValue factories.
  */
@@ -63,7 +65,12 @@ class StoredValueFactory : public AbstractStoredValueFactory {
 public:
     using value_type = StoredValue;
 
-    StoredValueFactory(EPStats& s) : stats(&s) {
+    /**
+     * @param slabs If non-null, StoredValues are allocated from it where
+     *        they fit (rather than from the heap).
+     */
+    StoredValueFactory(EPStats& s, std::shared_ptr<SlabAllocator> slabs = {})
+        : stats(&s), slabs(std::move(slabs)) {
     }
 
     /**
@@ -77,6 +84,47 @@ public:
 
 private:
     EPStats* stats;
+    std::shared_ptr<SlabAllocator> slabs;
+};
+
+/**
+ * Creator of StoredValue instances which store small values inline.
+ *
+ * Each StoredValue has space after its key for a value of up to
+ * inlineValueCapacity bytes; values which fit are kept there (as an embedded
+ * Blob) instead of in a separately allocated Blob, saving the allocation and
+ * its overhead for small values at the cost of the space for values which
+ * don't fit.
+ *
+ * An inline value is never shared: toItem() gives the Item a copy of it.
+ */
+class InlineValueStoredValueFactory : public AbstractStoredValueFactory {
+public:
+    using value_type = StoredValue;
+
+    /**
+     * @param inlineValueCapacity size of the largest value to store inline
+     * @param slabs If non-null, StoredValues are allocated from it where
+     *        they fit (rather than from the heap).
+     */
+    InlineValueStoredValueFactory(EPStats& s,
+                                  uint8_t inlineValueCapacity,
+                                  std::shared_ptr<SlabAllocator> slabs = {})
+        : stats(&s),
+          inlineValueCapacity(inlineValueCapacity),
+          slabs(std::move(slabs)) {
+    }
+
+    StoredValue::UniquePtr operator()(const Item& itm,
+                                      StoredValue::UniquePtr next) override;
+
+    StoredValue::UniquePtr copyStoredValue(
+            const StoredValue& other, StoredValue::UniquePtr next) override;
+
+private:
+    EPStats* stats;
+    const uint8_t inlineValueCapacity;
+    std::shared_ptr<SlabAllocator> slabs;
 };
 
 /**
@@ -86,7 +134,12 @@ class OrderedStoredValueFactory : public AbstractStoredValueFactory {
 public:
     using value_type = OrderedStoredValue;
 
-    OrderedStoredValueFactory(EPStats& s) : stats(&s) {
+    /**
+     * @param slabs If non-null, StoredValues are allocated from it where
+     *        they fit (rather than from the heap).
+     */
+    OrderedStoredValueFactory(EPStats& s, std::shared_ptr<SlabAllocator> slabs = {})
+        : stats(&s), slabs(std::move(slabs)) {
     }
 
     /**
@@ -103,4 +156,5 @@ public:
 
 private:
     EPStats* stats;
+    std::shared_ptr<SlabAllocator> slabs;
 };
@@ -76,6 +76,18 @@ CollectionID SerialisedDocKey::getCollectionID() const {
 }
 
 bool SerialisedDocKey::operator==(const DocKey& rhs) const {
+    // The common case of (single byte) collection-IDs below 0x80, which have
+    // a single encoding: compare the bytes without decoding either prefix
+    if (rhs.getEncoding() == DocKeyEncodesCollectionId::No) {
+        if (bytes[0] == DefaultCollectionLeb128Encoded) {
+            return size_t(length) == rhs.size() + 1 &&
+                   std::equal(rhs.data(), rhs.data() + rhs.size(), bytes + 1);
+        }
+    } else if (rhs.size() != 0 && ((bytes[0] | rhs.data()[0]) & 0x80) == 0) {
+        return size_t(length) == rhs.size() &&
+               std::equal(rhs.data(), rhs.data() + rhs.size(), bytes);
+    }
+
     auto rhsIdAndData = rhs.getIdAndKey();
     auto lhsIdAndData = cb::mcbp::decode_unsigned_leb128<CollectionIDType>(
             {data(), size()});
@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "task_runtime_window.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+constexpr size_t TaskRuntimeWindow::windowSeconds;
+
+void TaskRuntimeWindow::resize(size_t numTaskIds) {
+    slots.reset(new Slot[numTaskIds * windowSeconds]);
+    this->numTaskIds = numTaskIds;
+}
+
+void TaskRuntimeWindow::reset() {
+    for (size_t ii = 0; ii < numTaskIds * windowSeconds; ++ii) {
+        slots[ii].ns.store(0);
+    }
+}
+
+size_t TaskRuntimeWindow::getMemFootPrint() const {
+    return numTaskIds * windowSeconds * sizeof(Slot);
+}
+
+void TaskRuntimeWindow::add(size_t taskIdx,
+                            rel_time_t now,
+                            std::chrono::nanoseconds runtime) {
+    if (taskIdx >= numTaskIds) {
+        throw std::out_of_range("TaskRuntimeWindow::add: taskIdx:" +
+                                std::to_string(taskIdx) + " >= numTaskIds:" +
+                                std::to_string(numTaskIds));
+    }
+    auto& slot = slots[taskIdx * windowSeconds + now % windowSeconds];
+    auto second = slot.second.load();
+    if (second != now && slot.second.compare_exchange_strong(second, now)) {
+        // First add in this second; discard what the slot held from
+        // windowSeconds (or more) ago.
+        slot.ns.store(0);
+    }
+    slot.ns.fetch_add(runtime.count());
+}
+
+std::chrono::nanoseconds TaskRuntimeWindow::getRuntime(size_t taskIdx,
+                                                       rel_time_t now,
+                                                       size_t seconds) const {
+    if (taskIdx >= numTaskIds) {
+        throw std::out_of_range("TaskRuntimeWindow::getRuntime: taskIdx:" +
+                                std::to_string(taskIdx) + " >= numTaskIds:" +
+                                std::to_string(numTaskIds));
+    }
+    seconds = std::min(seconds, windowSeconds);
+    uint64_t total = 0;
+    for (size_t ii = 0; ii < windowSeconds; ++ii) {
+        const auto& slot = slots[taskIdx * windowSeconds + ii];
+        const auto second = slot.second.load();
+        if (second <= now && now - second < seconds) {
+            total += slot.ns.load();
+        }
+    }
+    return std::chrono::nanoseconds(total);
+}
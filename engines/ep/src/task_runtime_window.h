@@ -0,0 +1,73 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <memcached/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+/**
+ * Sliding window of the time tasks have spent running, kept per task id in
+ * one-second slots over the last windowSeconds seconds. Used to report
+ * which tasks have been consuming the most executor time recently.
+ *
+ * Recording is lock-free; a slot is recycled by the first add() in a new
+ * second, so concurrent adds at a second boundary may be lost - acceptable
+ * for a statistic.
+ */
+class TaskRuntimeWindow {
+public:
+    static constexpr size_t windowSeconds = 60;
+
+    /// (Re)size the window for the given number of task ids, clearing it.
+    void resize(size_t numTaskIds);
+
+    /// Clear all recorded runtime.
+    void reset();
+
+    /**
+     * Record that the task with the given index ran for `runtime` at time
+     * `now`.
+     */
+    void add(size_t taskIdx, rel_time_t now, std::chrono::nanoseconds runtime);
+
+    /**
+     * @returns the total runtime recorded for the given task index in the
+     * `seconds` seconds up to and including `now` (capped at windowSeconds).
+     */
+    std::chrono::nanoseconds getRuntime(size_t taskIdx,
+                                        rel_time_t now,
+                                        size_t seconds) const;
+
+    size_t size() const {
+        return numTaskIds;
+    }
+
+    size_t getMemFootPrint() const;
+
+private:
+    struct Slot {
+        std::atomic<rel_time_t> second{0};
+        std::atomic<uint64_t> ns{0};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t numTaskIds = 0;
+};
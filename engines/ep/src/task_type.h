@@ -47,3 +47,24 @@ static inline std::string to_string(const task_type_t type) {
                                     std::to_string(int(type)) + "}");
     }
 }
+
+/**
+ * QoS classes of the tasks run by the READER_TASK_IDX threads. Some reader
+ * threads are reserved for BgFetch (front-end reads of non-resident items),
+ * so that Background reads (warmup, access log loading, fetching all keys)
+ * can never occupy every reader thread and delay the front-end.
+ */
+enum class ReaderClass : int { BgFetch, Background, Count };
+
+static inline std::string to_string(const ReaderClass readerClass) {
+    switch (readerClass) {
+    case ReaderClass::BgFetch:
+        return "bg_fetch";
+    case ReaderClass::Background:
+        return "background";
+    case ReaderClass::Count:
+        return "count";
+    }
+    throw std::invalid_argument("to_string(ReaderClass) unknown class:{" +
+                                std::to_string(int(readerClass)) + "}");
+}
@@ -75,6 +75,12 @@ public:
     virtual void logRunTime(
             TaskId id, const std::chrono::steady_clock::duration runTime) = 0;
 
+    /*
+        Called with the CPU time the executor thread spent running
+    */
+    virtual void logCpuTime(TaskId id,
+                            const std::chrono::nanoseconds cpuTime) = 0;
+
 protected:
     virtual ~Taskable() {}
 };
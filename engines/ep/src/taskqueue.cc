@@ -17,6 +17,7 @@
 #include "bucket_logger.h"
 #include "executorpool.h"
 #include "executorthread.h"
+#include "globaltask.h"
 #include "taskqueue.h"
 
 #include <phosphor/phosphor.h>
@@ -37,29 +38,30 @@ const std::string TaskQueue::getName() const {
 }
 
 size_t TaskQueue::getReadyQueueSize() {
-    LockHolder lh(mutex);
+    QueueLockHolder lh(mutex);
     return readyQueue.size();
 }
 
 size_t TaskQueue::getFutureQueueSize() {
-    LockHolder lh(mutex);
+    QueueLockHolder lh(mutex);
     return futureQueue.size();
 }
 
 size_t TaskQueue::getPendingQueueSize() {
-    LockHolder lh(mutex);
+    QueueLockHolder lh(mutex);
     return pendingQueue.size();
 }
 
 ExTask TaskQueue::_popReadyTask(void) {
     ExTask t = readyQueue.top();
     readyQueue.pop();
+    numRunnable--;
     manager->lessWork(queueType);
     return t;
 }
 
 void TaskQueue::doWake(size_t &numToWake) {
-    LockHolder lh(mutex);
+    QueueLockHolder lh(mutex);
     _doWake_UNLOCKED(numToWake);
 }
 
@@ -82,9 +84,12 @@ bool TaskQueue::_doSleep(ExecutorThread &t,
 
     // Determine the time point to wake this thread - either "forever" if the
     // futureQueue is empty, or the earliest wake time in the futureQueue.
+    // The wake time is rounded up to the end of its FutureQueue tick so that
+    // tasks due within the same tick are run after a single wakeup.
     const auto wakeTime = futureQueue.empty()
                                   ? std::chrono::steady_clock::time_point::max()
-                                  : futureQueue.top()->getWaketime();
+                                  : FutureQueue::roundUpToTick(
+                                            futureQueue.top()->getWaketime());
 
     if (t.getCurTime() < wakeTime && manager->trySleep(queueType)) {
         // Atomically switch from running to sleeping; iff we were previously
@@ -128,8 +133,19 @@ bool TaskQueue::_sleepThenFetchNextTask(ExecutorThread& t) {
     return _fetchNextTaskInner(t, lh);
 }
 
+bool TaskQueue::mayHaveRunnableTask(
+        std::chrono::steady_clock::time_point now) const {
+    return numRunnable.load() != 0 || futureQueue.getEarliestWaketime() <= now;
+}
+
 bool TaskQueue::_fetchNextTask(ExecutorThread& t) {
-    std::unique_lock<std::mutex> lh(mutex);
+    // When polling, skip queues with nothing due rather than contending
+    // with the other threads of this type on the queue mutex. Sleeping
+    // (sleepThenFetchNextTask) always takes the lock.
+    if (!mayHaveRunnableTask(t.getCurTime())) {
+        return false;
+    }
+    QueueUniqueLock lh(mutex);
     return _fetchNextTaskInner(t, lh);
 }
 
@@ -147,10 +163,14 @@ bool TaskQueue::_fetchNextTaskInner(ExecutorThread& t,
         // order, the function below will push any pending task back into the
         // readyQueue (sorted by priority)
         _checkPendingQueue();
-        ExTask tid = _popReadyTask(); // and pop out the top task
-        t.setCurrentTask(tid);
-        ret = true;
-    } else { // Let the task continue waiting in pendingQueue
+        ExTask tid = _popRunnableTask(t); // and pop out the top task
+        if (tid) {
+            t.setCurrentTask(tid);
+            ret = true;
+        }
+    }
+
+    if (!ret) { // Let the task continue waiting in pendingQueue
         numToWake = numToWake ? numToWake - 1 : 0; // 1 fewer task ready
     }
 
@@ -158,6 +178,26 @@ bool TaskQueue::_fetchNextTaskInner(ExecutorThread& t,
     return ret;
 }
 
+ExTask TaskQueue::_popRunnableTask(ExecutorThread& t) {
+    while (!readyQueue.empty()) {
+        ExTask task = _popReadyTask();
+        if (queueType != READER_TASK_IDX || task->isdead() ||
+            GlobalTask::getReaderClass(task->getTaskId()) ==
+                    ReaderClass::BgFetch) {
+            return task;
+        }
+        if (manager->tryStartBackgroundRead()) {
+            t.runningBackgroundRead = true;
+            return task;
+        }
+        // All the reader threads Background reads may use are busy; leave
+        // it pending until one of them finishes.
+        pendingQueue.push_back(task);
+        numRunnable++;
+    }
+    return {};
+}
+
 bool TaskQueue::fetchNextTask(ExecutorThread& thread) {
     NonBucketAllocationGuard guard;
     return _fetchNextTask(thread);
@@ -180,6 +220,7 @@ size_t TaskQueue::_moveReadyTasks(
         if (tid->getWaketime() <= tv) {
             futureQueue.pop();
             readyQueue.push(tid);
+            numRunnable++;
             numReady++;
         } else {
             break;
@@ -197,12 +238,13 @@ void TaskQueue::_checkPendingQueue(void) {
         ExTask runnableTask = pendingQueue.front();
         readyQueue.push(runnableTask);
         manager->addWork(1, queueType);
+        // Moved from pendingQueue to readyQueue; numRunnable is unchanged.
         pendingQueue.pop_front();
     }
 }
 
 std::chrono::steady_clock::time_point TaskQueue::_reschedule(ExTask& task) {
-    LockHolder lh(mutex);
+    QueueLockHolder lh(mutex);
 
     futureQueue.push(task);
     return futureQueue.top()->getWaketime();
@@ -219,7 +261,7 @@ void TaskQueue::_schedule(ExTask &task) {
     size_t numToWake = 1;
 
     {
-        LockHolder lh(mutex);
+        QueueLockHolder lh(mutex);
 
         // If we are rescheduling a previously cancelled task, we should reset
         // the task state to the initial value of running.
@@ -254,7 +296,7 @@ void TaskQueue::_wake(ExTask &task) {
     // One task is being made ready regardless of the queue it's in.
     size_t readyCount = 1;
     {
-        LockHolder lh(mutex);
+        QueueLockHolder lh(mutex);
         EP_LOG_DEBUG("{}: Wake a task \"{}\" id {}",
                      name,
                      task->getDescription(),
@@ -268,6 +310,7 @@ void TaskQueue::_wake(ExTask &task) {
             if (tid->getId() == task->getId() || tid->isdead()) {
                 notReady.push(tid);
                 it = pendingQueue.erase(it);
+                numRunnable--;
             } else {
                 it++;
             }
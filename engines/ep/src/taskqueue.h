@@ -16,9 +16,11 @@
 #pragma once
 
 #include "futurequeue.h"
+#include "lock_profiler.h"
 #include "syncobject.h"
 #include "task_type.h"
 
+#include <atomic>
 #include <chrono>
 #include <list>
 #include <queue>
@@ -94,6 +96,34 @@ private:
     size_t _moveReadyTasks(const std::chrono::steady_clock::time_point tv);
     ExTask _popReadyTask(void);
 
+    /**
+     * Pop the highest priority ready task which thread `t` may run. A
+     * ReaderClass::Background task is only returned if a Background read
+     * slot is available (taken on behalf of `t`); otherwise it's moved to
+     * the pendingQueue.
+     * @return the task, or null if no ready task may run.
+     */
+    ExTask _popRunnableTask(ExecutorThread& t);
+
+    /**
+     * Lock-free check of whether this queue may have a task for a thread to
+     * run at time `now` - i.e. it has ready or pending tasks, or its earliest
+     * future task is due. Used to avoid taking the queue mutex when polling
+     * an idle queue; a false positive simply falls through to the locked
+     * path.
+     */
+    bool mayHaveRunnableTask(
+            std::chrono::steady_clock::time_point now) const;
+
+    /// Holders of mutex, profiled by the LockProfiler. (Sleeping on the
+    /// queue isn't profiled, as the wait would count as hold time.)
+    using QueueLockHolder =
+            ProfiledLockHolder<std::lock_guard<std::mutex>,
+                               LockProfiler::Site::TaskQueue>;
+    using QueueUniqueLock =
+            ProfiledLockHolder<std::unique_lock<std::mutex>,
+                               LockProfiler::Site::TaskQueue>;
+
     SyncObject mutex;
     const std::string name;
     task_type_t queueType;
@@ -105,7 +135,12 @@ private:
                         CompareByPriority> readyQueue;
 
     // sorted by waketime. Guarded by `mutex`.
-    FutureQueue<> futureQueue;
+    FutureQueue futureQueue;
 
+    // Tasks waiting for a thread they may run on (see _popRunnableTask).
     std::list<ExTask> pendingQueue;
+
+    // Number of tasks in readyQueue plus pendingQueue. Only modified with
+    // `mutex` held, but read without it by mayHaveRunnableTask().
+    std::atomic<size_t> numRunnable{0};
 };
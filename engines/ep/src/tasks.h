@@ -35,12 +35,12 @@ class EventuallyPersistentEngine;
 class Flusher;
 class FlusherTask : public GlobalTask {
 public:
-    FlusherTask(EventuallyPersistentEngine *e, Flusher* f, uint16_t shardid,
+    FlusherTask(EventuallyPersistentEngine *e, Flusher* f, size_t flusherId,
                 bool completeBeforeShutdown = true)
         : GlobalTask(e, TaskId::FlusherTask, 0, completeBeforeShutdown),
           flusher(f) {
         std::stringstream ss;
-        ss<<"Running a flusher loop: shard "<<shardid;
+        ss<<"Running a flusher loop: flusher "<<flusherId;
         desc = ss.str();
     }
 
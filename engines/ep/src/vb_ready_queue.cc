@@ -16,105 +16,153 @@
  */
 
 #include "vb_ready_queue.h"
+#include <folly/lang/Bits.h>
 #include <phosphor/phosphor.h>
 
-#include "locks.h"
 #include "statwriter.h"
 
-bool VBReadyQueue::exists(Vbid vbucket) {
-    LockHolder lh(lock);
-    return (queuedValues.count(vbucket) != 0);
+#include <stdexcept>
+
+VBReadyQueue::VBReadyQueue(size_t maxVbuckets)
+    : maxVbuckets(maxVbuckets),
+      bitmap((maxVbuckets + BitsPerWord - 1) / BitsPerWord) {
+    for (auto& word : bitmap) {
+        word.store(0);
+    }
+}
+
+bool VBReadyQueue::exists(Vbid vbucket) const {
+    const auto vb = size_t(vbucket.get());
+    if (vb >= maxVbuckets) {
+        return false;
+    }
+    const auto mask = uint64_t(1) << (vb % BitsPerWord);
+    return (bitmap[vb / BitsPerWord].load(std::memory_order_acquire) & mask) !=
+           0;
 }
 
 bool VBReadyQueue::popFront(Vbid& frontValue) {
-    LockHolder lh(lock);
-    if (!readyQueue.empty()) {
-        frontValue = readyQueue.front();
-        readyQueue.pop();
-        queuedValues.erase(frontValue);
-        return true;
+    std::vector<Vbid> batch;
+    batch.reserve(1);
+    if (popFront(batch, 1) == 0) {
+        return false;
     }
-    return false;
+    frontValue = batch.front();
+    return true;
 }
 
-void VBReadyQueue::pop() {
-    LockHolder lh(lock);
-    if (!readyQueue.empty()) {
-        queuedValues.erase(readyQueue.front());
-        readyQueue.pop();
+size_t VBReadyQueue::popFront(std::vector<Vbid>& batch, size_t limit) {
+    if (limit == 0 || bitmap.empty() ||
+        count.load(std::memory_order_acquire) == 0) {
+        return 0;
+    }
+
+    const auto words = bitmap.size();
+    const auto start = cursor.load(std::memory_order_relaxed) % maxVbuckets;
+    const auto startMask = ~uint64_t(0) << (start % BitsPerWord);
+    size_t popped = 0;
+    size_t next = start;
+
+    // Visit the word containing the cursor twice; first for the vbuckets
+    // from the cursor and out, and at the end for the ones before the
+    // cursor
+    for (size_t ii = 0; ii <= words && popped < limit; ++ii) {
+        const auto word = (start / BitsPerWord + ii) % words;
+        auto bits = bitmap[word].load(std::memory_order_acquire);
+        if (ii == 0) {
+            bits &= startMask;
+        } else if (ii == words) {
+            bits &= ~startMask;
+        }
+
+        while (bits != 0 && popped < limit) {
+            const auto bit = size_t(folly::findFirstSet(bits) - 1);
+            const auto mask = uint64_t(1) << bit;
+            bits &= ~mask;
+            // Someone else may have popped it in the meantime
+            if (bitmap[word].fetch_and(~mask, std::memory_order_acq_rel) &
+                mask) {
+                count.fetch_sub(1, std::memory_order_acq_rel);
+                const auto vb = word * BitsPerWord + bit;
+                batch.emplace_back(Vbid(uint16_t(vb)));
+                next = vb + 1;
+                ++popped;
+            }
+        }
     }
+
+    if (popped) {
+        cursor.store(next % maxVbuckets, std::memory_order_relaxed);
+    }
+    return popped;
+}
+
+void VBReadyQueue::pop() {
+    Vbid vbid;
+    popFront(vbid);
 }
 
 bool VBReadyQueue::pushUnique(Vbid vbucket) {
     TRACE_EVENT1("ep-engine/VBReadyQueue", "pushUnique", "vbid", vbucket.get());
-    bool wasEmpty;
-    {
-        LockHolder lh(lock);
-        wasEmpty = queuedValues.empty();
-        const bool inserted = queuedValues.emplace(vbucket).second;
-        if (inserted) {
-            readyQueue.push(vbucket);
-        }
+    const auto vb = size_t(vbucket.get());
+    if (vb >= maxVbuckets) {
+        throw std::out_of_range("VBReadyQueue::pushUnique: " +
+                                vbucket.to_string() + " exceeds maxVbuckets:" +
+                                std::to_string(maxVbuckets));
+    }
+
+    const auto wasEmpty = count.fetch_add(1, std::memory_order_acq_rel) == 0;
+    const auto mask = uint64_t(1) << (vb % BitsPerWord);
+    if (bitmap[vb / BitsPerWord].fetch_or(mask, std::memory_order_acq_rel) &
+        mask) {
+        // Already queued (and the count was at least one)
+        count.fetch_sub(1, std::memory_order_acq_rel);
+        return false;
     }
     return wasEmpty;
 }
 
-size_t VBReadyQueue::size() {
-    LockHolder lh(lock);
-    return readyQueue.size();
+size_t VBReadyQueue::size() const {
+    return count.load(std::memory_order_acquire);
 }
 
-bool VBReadyQueue::empty() {
-    LockHolder lh(lock);
-    return readyQueue.empty();
+bool VBReadyQueue::empty() const {
+    return size() == 0;
 }
 
 void VBReadyQueue::clear() {
-    LockHolder lh(lock);
-    while (!readyQueue.empty()) {
-        readyQueue.pop();
+    for (auto& word : bitmap) {
+        const auto bits = word.exchange(0, std::memory_order_acq_rel);
+        if (bits) {
+            count.fetch_sub(size_t(folly::popcount(bits)),
+                            std::memory_order_acq_rel);
+        }
     }
-    queuedValues.clear();
 }
 
 void VBReadyQueue::addStats(const std::string& prefix,
                             const AddStatFn& add_stat,
                             const void* c) const {
-    // Take a copy of the queue data under lock; then format it to stats.
-    std::queue<Vbid> qCopy;
-    std::unordered_set<Vbid> qMapCopy;
-    {
-        LockHolder lh(lock);
-        qCopy = readyQueue;
-        qMapCopy = queuedValues;
-    }
-
-    add_casted_stat((prefix + "size").c_str(), qCopy.size(), add_stat, c);
-    add_casted_stat(
-            (prefix + "map_size").c_str(), qMapCopy.size(), add_stat, c);
-
-    // Form a comma-separated string of the queue's contents.
+    // Form a comma-separated string of the queue's contents (in the order
+    // they would be popped)
     std::string contents;
-    while (!qCopy.empty()) {
-        contents += std::to_string(qCopy.front().get()) + ",";
-        qCopy.pop();
+    size_t queued = 0;
+    const auto start = cursor.load(std::memory_order_relaxed);
+    for (size_t ii = 0; ii < maxVbuckets; ++ii) {
+        const auto vb = (start + ii) % maxVbuckets;
+        if (exists(Vbid(uint16_t(vb)))) {
+            contents += std::to_string(vb) + ",";
+            ++queued;
+        }
     }
     if (!contents.empty()) {
         contents.pop_back();
     }
+
+    add_casted_stat((prefix + "size").c_str(), size(), add_stat, c);
+    add_casted_stat((prefix + "map_size").c_str(), queued, add_stat, c);
     add_casted_stat(
             (prefix + "contents").c_str(), contents.c_str(), add_stat, c);
-
-    // Form a comma-separated string of the queue map's contents.
-    std::string qMapContents;
-    for (auto& vbid : qMapCopy) {
-        qMapContents += std::to_string(vbid.get()) + ",";
-    }
-    if (!qMapContents.empty()) {
-        qMapContents.pop_back();
-    }
-    add_casted_stat((prefix + "map_contents").c_str(),
-                    qMapContents.c_str(),
-                    add_stat,
-                    c);
+    add_casted_stat(
+            (prefix + "map_contents").c_str(), contents.c_str(), add_stat, c);
 }
@@ -20,28 +20,46 @@
 #include <memcached/engine_common.h>
 #include <memcached/vbucket.h>
 
-#include <mutex>
-#include <queue>
-#include <unordered_set>
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
 /**
- * VBReadyQueue is a std::queue wrapper for managing a queue of vbuckets that
- * are ready for some task to process. The queue does not allow duplicates and
- * the push_unique method enforces this.
+ * VBReadyQueue manages the set of vbuckets that are ready for some task to
+ * process. A vbucket is only present once, and the pushUnique method
+ * enforces this.
  *
- * Internally a std::queue and std::set track the contents and the std::set
- * enables a fast exists method which is used by front-end threads.
+ * The set is a bitmap (one bit per vbucket) updated with atomic
+ * operations, so pushing a vbucket (which is done by the front-end threads
+ * for every mutation) never blocks, and the consumer pops the vbuckets in
+ * round-robin order starting after the last one it popped (so a vbucket
+ * which is immediately ready again is served after all of the other ready
+ * vbuckets).
  */
 class VBReadyQueue {
 public:
-    bool exists(Vbid vbucket);
+    /**
+     * @param maxVbuckets the number of vbuckets which may be in the queue
+     *                    (vbids 0..maxVbuckets-1)
+     */
+    explicit VBReadyQueue(size_t maxVbuckets);
+
+    bool exists(Vbid vbucket) const;
 
     /**
      * Return true and set the ref-param 'frontValue' if the queue is not
-     * empty. frontValue is set to the front of the queue.
+     * empty. frontValue is set to the next vbucket (in round-robin order).
      */
     bool popFront(Vbid& frontValue);
 
+    /**
+     * Pop up to limit vbuckets (in round-robin order) and append them to
+     * the batch.
+     *
+     * @return the number of vbuckets popped
+     */
+    size_t popFront(std::vector<Vbid>& batch, size_t limit);
+
     /**
      * Pop the front item.
      * Safe to call on an empty list
@@ -52,18 +70,19 @@ public:
      * Push the vbucket only if it's not already in the queue.
      * @return true if the queue was previously empty (i.e. we have
      * transitioned from zero -> one elements in the queue).
+     * @throws std::out_of_range if vbucket isn't less than maxVbuckets
      */
     bool pushUnique(Vbid vbucket);
 
     /**
      * Size of the queue.
      */
-    size_t size();
+    size_t size() const;
 
     /**
      * @return true if empty
      */
-    bool empty();
+    bool empty() const;
 
     /**
      * Clears the queue
@@ -75,16 +94,20 @@ public:
                   const void* c) const;
 
 private:
-    // Mutable so that we can lock in addStats (const) to copy the queue/set
-    mutable std::mutex lock;
+    static const size_t BitsPerWord = 64;
 
-    /* a queue of vbuckets that are ready for producing */
-    std::queue<Vbid> readyQueue;
+    const size_t maxVbuckets;
+
+    /// One bit per vbucket which is in the queue
+    std::vector<std::atomic<uint64_t>> bitmap;
 
     /**
-     * maintain a std::unordered_set of values that are in the readyQueue.
-     * find() is performed by front-end threads so we want it to be
-     * efficient so just a set lookup is required.
+     * The number of vbuckets in the queue. It is incremented before the
+     * bit is set, and decremented after the bit is cleared so that it is
+     * never less than the number of bits set (it may briefly be higher).
      */
-    std::unordered_set<Vbid> queuedValues;
+    std::atomic<size_t> count{0};
+
+    /// The vbid to start searching from in the next pop
+    std::atomic<size_t> cursor{0};
 };
@@ -37,11 +37,15 @@ bool CappedDurationVBucketVisitor::pauseVisitor() {
 }
 
 PauseResumeVBAdapter::PauseResumeVBAdapter(
-        std::unique_ptr<VBucketAwareHTVisitor> htVisitor)
-    : htVisitor(std::move(htVisitor)) {
+        std::unique_ptr<VBucketAwareHTVisitor> htVisitor, VBucketFilter filter)
+    : htVisitor(std::move(htVisitor)), filter(std::move(filter)) {
 }
 
 bool PauseResumeVBAdapter::visit(VBucket& vb) {
+    if (!filter(vb.getId())) {
+        return true;
+    }
+
     // Check if this vbucket_id matches the position we should resume
     // from. If so then call the visitor using our stored HashTable::Position.
     HashTable::Position ht_start;
@@ -49,6 +53,14 @@ bool PauseResumeVBAdapter::visit(VBucket& vb) {
         ht_start = hashtable_position;
     }
 
+    // Collection-scoped visitors need not walk a HashTable which holds none
+    // of the collection's items.
+    const auto collection = htVisitor->getVisitedCollection();
+    if (collection && vb.ht.getCollectionItemMemory(*collection) == 0) {
+        hashtable_position = vb.ht.endPosition();
+        return true;
+    }
+
     htVisitor->setCurrentVBucket(vb);
     hashtable_position = vb.ht.pauseResumeVisit(*htVisitor, ht_start);
 
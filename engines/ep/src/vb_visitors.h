@@ -21,6 +21,8 @@
 #include "vb_filter.h"
 #include "vbucket_fwd.h"
 
+#include <boost/optional.hpp>
+
 using namespace std::chrono_literals;
 
 class HashTableVisitor;
@@ -156,6 +158,15 @@ public:
      */
     virtual void setCurrentVBucket(VBucket& vb) {
     }
+
+    /**
+     * The collection this visitor is only interested in, if any. A VBucket
+     * whose HashTable holds no items of that collection is skipped without
+     * being visited (nor passed to setCurrentVBucket()).
+     */
+    virtual boost::optional<CollectionID> getVisitedCollection() const {
+        return {};
+    }
 };
 
 /**
@@ -165,12 +176,19 @@ public:
  */
 class PauseResumeVBAdapter : public PauseResumeVBVisitor {
 public:
-    PauseResumeVBAdapter(std::unique_ptr<VBucketAwareHTVisitor> htVisitor);
+    /**
+     * @param htVisitor the HashTable visitor to apply
+     * @param filter the VBuckets to visit (others are skipped); empty visits
+     *        all VBuckets
+     */
+    PauseResumeVBAdapter(std::unique_ptr<VBucketAwareHTVisitor> htVisitor,
+                         VBucketFilter filter = {});
 
     /**
      * Visit a VBucket within an epStore. Records the place where the visit
      * stops (when the wrapped htVisitor returns false), for later resuming
-     * from *approximately* the same place.
+     * from *approximately* the same place. VBuckets not accepted by the
+     * filter are skipped.
      */
     bool visit(VBucket& vb) override;
 
@@ -188,6 +206,9 @@ private:
     // The HashTable visitor to apply to each VBucket's HashTable.
     std::unique_ptr<VBucketAwareHTVisitor> htVisitor;
 
+    // The VBuckets to visit.
+    const VBucketFilter filter;
+
     // When resuming, which vbucket should we start from?
     Vbid resume_vbucket_id = Vbid(0);
 
@@ -37,6 +37,7 @@
 #include "rollback_result.h"
 #include "statwriter.h"
 #include "stored_value_factories.h"
+#include "trace_helpers.h"
 #include "vb_filter.h"
 #include "vbucket_queue_item_ctx.h"
 #include "vbucket_state.h"
@@ -46,6 +47,7 @@
 #include <folly/lang/Assume.h>
 #include <memcached/protocol_binary.h>
 #include <memcached/server_document_iface.h>
+#include <platform/checked_snprintf.h>
 #include <platform/compress.h>
 #include <xattr/blob.h>
 #include <xattr/utils.h>
@@ -67,6 +69,20 @@ const auto MAX_CHK_FLUSH_TIMEOUT = std::chrono::seconds(30);
 
 /* Statics definitions */
 cb::AtomicDuration<> VBucket::chkFlushTimeout(MIN_CHK_FLUSH_TIMEOUT);
+
+/**
+ * Record the time from start until now - the time taken to acquire the
+ * HashTable bucket lock and locate the key - as a HASH_TABLE_LOCK span of
+ * the given front-end cookie (if any).
+ */
+static void traceHashTableLock(const void* cookie,
+                               std::chrono::steady_clock::time_point start) {
+    if (cookie) {
+        TRACE_BEGIN(cookie, cb::tracing::TraceCode::HASH_TABLE_LOCK, start);
+        TRACE_END(cookie, cb::tracing::TraceCode::HASH_TABLE_LOCK);
+    }
+}
+
 double VBucket::mutationMemThreshold = 0.9;
 
 VBucketFilter VBucketFilter::filter_diff(const VBucketFilter &other) const {
@@ -168,6 +184,7 @@ VBucket::VBucket(Vbid i,
                  std::unique_ptr<AbstractStoredValueFactory> valFact,
                  NewSeqnoCallback newSeqnoCb,
                  SyncWriteResolvedCallback syncWriteResolvedCb,
+                 SyncWriteTimeoutCallback syncWriteTimeoutCb,
                  SyncWriteCompleteCallback syncWriteCb,
                  SeqnoAckCallback seqnoAckCb,
                  Configuration& config,
@@ -179,7 +196,13 @@ VBucket::VBucket(Vbid i,
                  int64_t hlcEpochSeqno,
                  bool mightContainXattrs,
                  const nlohmann::json& replTopology)
-    : ht(st, std::move(valFact), config.getHtSize(), config.getHtLocks()),
+    : ht(st,
+         std::move(valFact),
+         config.getHtSize(),
+         config.getHtLocks(),
+         HashTable::bucketLayoutFromString(config.getHtBucketLayout()),
+         cb::to_huge_page_mode(config.getHtHugePages()),
+         config.isHtPerCoreStats()),
       checkpointManager(std::make_unique<CheckpointManager>(st,
                                                             i,
                                                             chkConfig,
@@ -193,6 +216,7 @@ VBucket::VBucket(Vbid i,
       opsGet(0),
       opsReject(0),
       opsUpdate(0),
+      numExpiredItems(0),
       dirtyQueueSize(0),
       dirtyQueueMem(0),
       dirtyQueueFill(0),
@@ -200,8 +224,9 @@ VBucket::VBucket(Vbid i,
       dirtyQueueAge(0),
       dirtyQueuePendingWrites(0),
       metaDataDisk(0),
-      numExpiredItems(0),
       maxAllowedReplicasForSyncWrites(config.getSyncWritesMaxAllowedReplicas()),
+      seqnoAckCoalesceWindow(config.getDurabilitySeqnoAckCoalesceWindow()),
+      seqnoAckCoalesceCount(config.getDurabilitySeqnoAckCoalesceCount()),
       eviction(evictionPolicy),
       stats(st),
       persistenceSeqno(0),
@@ -224,6 +249,7 @@ VBucket::VBucket(Vbid i,
       deferredDeletionCookie(nullptr),
       newSeqnoCb(std::move(newSeqnoCb)),
       syncWriteResolvedCb(syncWriteResolvedCb),
+      syncWriteTimeoutCb(std::move(syncWriteTimeoutCb)),
       syncWriteCompleteCb(syncWriteCb),
       seqnoAckCb(seqnoAckCb),
       manifest(std::move(manifest)),
@@ -234,6 +260,10 @@ VBucket::VBucket(Vbid i,
         conflictResolver.reset(new RevisionSeqnoResolution());
     }
 
+    if (config.isExpPagerIndexEnabled()) {
+        expiryIndex = std::make_unique<ExpiryIndex>();
+    }
+
     pendingOpsStart = std::chrono::steady_clock::time_point();
     stats.coreLocal.get()->memOverhead.fetch_add(
             sizeof(VBucket) + ht.memorySize() + sizeof(CheckpointManager));
@@ -413,12 +443,29 @@ VBucket::ItemsToFlush VBucket::getItemsToPersist(size_t approxLimit) {
                         std::chrono::steady_clock::now() - _begin_));
     } // else result.ranges is empty, all items from rejectQueue
 
+    // Any SyncWrite waiting for persistence is now part of this flush.
+    const auto oldestPrepare = oldestUnflushedPrepare.exchange(0);
+    if (oldestPrepare != 0) {
+        result.oldestPrepareQueued = std::chrono::steady_clock::time_point(
+                std::chrono::steady_clock::duration(oldestPrepare));
+    }
+
     // Check if there's any more items remaining.
     result.moreAvailable = !rejectQueue.empty() || ckptItemsAvailable;
 
     return result;
 }
 
+boost::optional<std::chrono::steady_clock::time_point>
+VBucket::getOldestUnflushedPrepareTime() const {
+    const auto oldest = oldestUnflushedPrepare.load();
+    if (oldest == 0) {
+        return {};
+    }
+    return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(oldest));
+}
+
 const char* VBucket::toString(vbucket_state_t s) {
     switch (s) {
     case vbucket_state_active:
@@ -560,10 +607,26 @@ void VBucket::setState_UNLOCKED(
 
     state = to;
 
+    if (to != oldstate) {
+        // A new replication stream is needed before we learn anything about
+        // the active
+        lastKnownActiveSeqno.store(0);
+        replicaInSyncTime.store({});
+    }
+
     setupSyncReplication(meta.is_null() ? nlohmann::json{}
                                         : meta.at("topology"));
 }
 
+std::chrono::milliseconds VBucket::getReplicaStaleness() const {
+    const auto syncedAt = replicaInSyncTime.load();
+    if (syncedAt == std::chrono::steady_clock::time_point{}) {
+        return std::chrono::milliseconds::max();
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - syncedAt);
+}
+
 vbucket_transition_state VBucket::getTransitionState() const {
     nlohmann::json topology;
     if (getState() == vbucket_state_active) {
@@ -687,17 +750,30 @@ PassiveDurabilityMonitor& VBucket::getPassiveDM() {
 void VBucket::processDurabilityTimeout(
         const std::chrono::steady_clock::time_point asOf) {
     folly::SharedMutex::ReadHolder lh(stateLock);
-    // @todo-durability: Add support for DurabilityMonitor at Replica
-    if (getState() != vbucket_state_active) {
+    switch (getState()) {
+    case vbucket_state_active:
+        getActiveDM().processTimeout(asOf);
+        return;
+    case vbucket_state_replica:
+    case vbucket_state_pending:
+        getPassiveDM().processSeqnoAckTimeout(asOf);
+        return;
+    case vbucket_state_dead:
         return;
     }
-    getActiveDM().processTimeout(asOf);
 }
 
 void VBucket::notifySyncWritesPendingCompletion() {
     syncWriteResolvedCb(getId());
 }
 
+void VBucket::scheduleSyncWriteTimeout(
+        std::chrono::steady_clock::time_point deadline) {
+    if (syncWriteTimeoutCb) {
+        syncWriteTimeoutCb(getId(), deadline);
+    }
+}
+
 void VBucket::processResolvedSyncWrites() {
     // Acquire shared access on stateLock as need to ensure the vbucket is
     // active (and we have an ActiveDM).
@@ -765,9 +841,12 @@ void VBucket::addStat(const char* nm,
                       const T& val,
                       const AddStatFn& add_stat,
                       const void* c) {
-    std::string stat = statPrefix;
     if (nm != NULL) {
-        add_prefixed_stat(statPrefix, nm, val, add_stat, c);
+        // Build the name on the stack, this is called for every stat of
+        // every vBucket.
+        char name[128];
+        checked_snprintf(name, sizeof(name), "%s:%s", statPrefix.c_str(), nm);
+        add_casted_stat(name, val, add_stat, c);
     } else {
         add_casted_stat(statPrefix.data(), val, add_stat, c);
     }
@@ -785,8 +864,7 @@ void VBucket::handlePreExpiry(const HashTable::HashBucketLock& hbl,
                 cb::UserDataView(ss.str()).getSanitizedValue());
     }
 
-    value_t value = v.getValue();
-    if (value) {
+    if (v.getValue()) {
         std::unique_ptr<Item> itm(v.toItem(id));
         item_info itm_info;
         EventuallyPersistentEngine* engine = ObjectRegistry::getCurrentEngine();
@@ -826,7 +904,8 @@ ENGINE_ERROR_CODE VBucket::commit(
         uint64_t prepareSeqno,
         boost::optional<int64_t> commitSeqno,
         const Collections::VB::Manifest::CachingReadHandle& cHandle,
-        const void* cookie) {
+        const void* cookie,
+        SyncWriteCompletionBatch* batch) {
     auto res = ht.findForUpdate(key);
     if (!res.pending) {
         // If we are committing we /should/ always find the pending item.
@@ -867,6 +946,12 @@ ENGINE_ERROR_CODE VBucket::commit(
     auto notify =
             commitStoredValue(res, prepareSeqno, queueItmCtx, commitSeqno);
 
+    if (batch) {
+        doCollectionsStats(cHandle, notify);
+        batch->add(notify, cookie, ENGINE_SUCCESS);
+        return ENGINE_SUCCESS;
+    }
+
     notifyNewSeqno(notify);
     doCollectionsStats(cHandle, notify);
 
@@ -883,7 +968,8 @@ ENGINE_ERROR_CODE VBucket::abort(
         uint64_t prepareSeqno,
         boost::optional<int64_t> abortSeqno,
         const Collections::VB::Manifest::CachingReadHandle& cHandle,
-        const void* cookie) {
+        const void* cookie,
+        SyncWriteCompletionBatch* batch) {
     auto htRes = ht.findForUpdate(key);
 
     if (!htRes.pending) {
@@ -991,6 +1077,12 @@ ENGINE_ERROR_CODE VBucket::abort(
                                    prepareSeqno,
                                    abortSeqno);
 
+    if (batch) {
+        doCollectionsStats(cHandle, notify);
+        batch->add(notify, cookie, ENGINE_SYNC_WRITE_AMBIGUOUS);
+        return ENGINE_SUCCESS;
+    }
+
     notifyNewSeqno(notify);
     doCollectionsStats(cHandle, notify);
 
@@ -1017,6 +1109,27 @@ void VBucket::notifyClientOfSyncWriteComplete(const void* cookie,
     syncWriteCompleteCb(cookie, result);
 }
 
+void SyncWriteCompletionBatch::add(const VBNotifyCtx& notifyCtx,
+                                   const void* cookie,
+                                   ENGINE_ERROR_CODE result) {
+    newSeqno.bySeqno = std::max(newSeqno.bySeqno, notifyCtx.bySeqno);
+    newSeqno.notifyReplication |= notifyCtx.notifyReplication;
+    newSeqno.notifyFlusher |= notifyCtx.notifyFlusher;
+    newSeqno.itemCountDifference += notifyCtx.itemCountDifference;
+    if (cookie) {
+        clients.emplace_back(cookie, result);
+    }
+}
+
+void VBucket::notifySyncWritesCompleted(const SyncWriteCompletionBatch& batch) {
+    if (batch.newSeqno.bySeqno != 0) {
+        notifyNewSeqno(batch.newSeqno);
+    }
+    for (const auto& client : batch.clients) {
+        notifyClientOfSyncWriteComplete(client.first, client.second);
+    }
+}
+
 void VBucket::notifyPassiveDMOfSnapEndReceived(uint64_t snapEnd) {
     getPassiveDM().notifySnapshotEndReceived(snapEnd);
 }
@@ -1095,6 +1208,7 @@ void VBucket::initTempFilter(size_t key_count, double probability) {
     LockHolder lh(bfMutex);
     tempFilter = std::make_unique<BloomFilter>(key_count, probability,
                                      BFILTER_COMPACTING);
+    tempFilterComplete = true;
     if (bFilter) {
         bFilter->setStatus(BFILTER_COMPACTING);
     }
@@ -1117,6 +1231,11 @@ void VBucket::addToFilter(const DocKey& key) {
 }
 
 bool VBucket::maybeKeyExistsInFilter(const DocKey& key) {
+    if (ht.isKnownNonExistent(key)) {
+        ++stats.negativeLookupCacheHits;
+        return false;
+    }
+
     LockHolder lh(bfMutex);
     if (bFilter) {
         return bFilter->maybeKeyExists(key);
@@ -1187,6 +1306,63 @@ void VBucket::setFilterStatus(bfilter_status_t to) {
     }
 }
 
+void VBucket::markTempFilterIncomplete() {
+    LockHolder lh(bfMutex);
+    tempFilterComplete = false;
+}
+
+/*
+ * A persisted filter is prefixed by a byte recording whether it holds every
+ * key on disk (AllKeys) or just the deleted ones (DeletedKeys).
+ */
+enum class PersistedFilterKeys : char { DeletedKeys, AllKeys };
+
+std::string VBucket::serialiseTempFilter() {
+    LockHolder lh(bfMutex);
+    if (!tempFilter) {
+        return {};
+    }
+    PersistedFilterKeys keys = PersistedFilterKeys::DeletedKeys;
+    if (eviction == EvictionPolicy::Full) {
+        if (!tempFilterComplete) {
+            return {};
+        }
+        keys = PersistedFilterKeys::AllKeys;
+    }
+    const auto data = tempFilter->serialise();
+    return data.empty() ? data : char(keys) + data;
+}
+
+std::string VBucket::serialiseFilter() {
+    // Under full eviction, keys which were resident while the filter was in
+    // use aren't in it, so only a value eviction filter may be persisted.
+    LockHolder lh(bfMutex);
+    if (!bFilter || eviction == EvictionPolicy::Full) {
+        return {};
+    }
+    const auto data = bFilter->serialise();
+    return data.empty() ? data
+                        : char(PersistedFilterKeys::DeletedKeys) + data;
+}
+
+bool VBucket::loadFilter(cb::const_char_buffer data) {
+    if (data.empty()) {
+        return false;
+    }
+    const auto keys = PersistedFilterKeys(data.data()[0]);
+    if (eviction == EvictionPolicy::Full &&
+        keys != PersistedFilterKeys::AllKeys) {
+        return false;
+    }
+    auto filter = BloomFilter::deserialise({data.data() + 1, data.size() - 1});
+    if (!filter) {
+        return false;
+    }
+    LockHolder lh(bfMutex);
+    bFilter = std::move(filter);
+    return true;
+}
+
 std::string VBucket::getFilterStatusString() {
     LockHolder lh(bfMutex);
     if (bFilter) {
@@ -1242,6 +1418,17 @@ VBNotifyCtx VBucket::queueItem(queued_item& item, const VBQueueItemCtx& ctx) {
         notifyCtx.notifyReplication = true;
     notifyCtx.bySeqno = item->getBySeqno();
 
+    // Record when the first SyncWrite waiting for local persistence was
+    // queued, so the flusher can group the commit of it with any which
+    // follow shortly after (see durability_group_commit_window).
+    if (item->isPending() && item->getDurabilityReqs().getLevel() !=
+                                     cb::durability::Level::Majority) {
+        auto none = std::chrono::steady_clock::rep(0);
+        oldestUnflushedPrepare.compare_exchange_strong(
+                none,
+                std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
     // Process Durability items (notify the DurabilityMonitor of
     // Prepare/Commit/Abort)
     switch (state) {
@@ -1290,10 +1477,18 @@ VBNotifyCtx VBucket::queueDirty(const HashTable::HashBucketLock& hbl,
                 ctx.durability->requirementsOrPreparedSeqno);
     }
 
+    // The copy of an inline value for the queued item can be avoided by
+    // sharing the value of the Item it was stored from.
+    const bool shareSourceValue = ctx.sourceItem && v.isValueInline() &&
+                                  ctx.sourceItem->getValue();
     queued_item qi(v.toItem(getId(),
                             StoredValue::HideLockedCas::No,
-                            StoredValue::IncludeValue::Yes,
+                            shareSourceValue ? StoredValue::IncludeValue::No
+                                             : StoredValue::IncludeValue::Yes,
                             durabilityReqs));
+    if (shareSourceValue) {
+        qi->replaceValue(ctx.sourceItem->getValue().get());
+    }
 
     if (qi->isCommitSyncWrite()) {
         Expects(ctx.durability.is_initialized());
@@ -1315,6 +1510,8 @@ VBNotifyCtx VBucket::queueDirty(const HashTable::HashBucketLock& hbl,
         setMightContainXattrs();
     }
 
+    addToExpiryIndex(v);
+
     // Enqueue the item for persistence and replication
     VBNotifyCtx notifyCtx = queueItem(qi, ctx);
 
@@ -1329,6 +1526,13 @@ VBNotifyCtx VBucket::queueDirty(const HashTable::HashBucketLock& hbl,
     return notifyCtx;
 }
 
+void VBucket::addToExpiryIndex(const StoredValue& v) {
+    if (expiryIndex && v.isCommitted() && !v.isDeleted() &&
+        v.getExptime() != 0) {
+        expiryIndex->add(v.getKey(), v.getExptime());
+    }
+}
+
 VBNotifyCtx VBucket::queueAbort(const HashTable::HashBucketLock& hbl,
                                 const StoredValue& v,
                                 int64_t prepareSeqno,
@@ -1555,7 +1759,9 @@ ENGINE_ERROR_CODE VBucket::set(
     bool cas_op = (itm.getCas() != 0);
 
     { // HashBucketLock scope
+        const auto htLockStart = std::chrono::steady_clock::now();
         auto htRes = ht.findForUpdate(itm.getKey());
+        traceHashTableLock(cookie, htLockStart);
         auto* v = htRes.selectSVToModify(itm);
         auto& hbl = htRes.getHBL();
 
@@ -1591,6 +1797,7 @@ ENGINE_ERROR_CODE VBucket::set(
                     DurabilityItemCtx{itm.getDurabilityReqs(), cookie};
         }
         queueItmCtx.preLinkDocumentContext = &preLinkDocumentContext;
+        queueItmCtx.sourceItem = &itm;
         MutationStatus status;
         boost::optional<VBNotifyCtx> notifyCtx;
         std::tie(status, notifyCtx) = processSet(htRes,
@@ -1670,7 +1877,9 @@ ENGINE_ERROR_CODE VBucket::replace(
     }
 
     { // HashBucketLock scope
+        const auto htLockStart = std::chrono::steady_clock::now();
         auto htRes = ht.findForUpdate(itm.getKey());
+        traceHashTableLock(cookie, htLockStart);
         auto& hbl = htRes.getHBL();
 
         // If a pending SV was found and it's not yet complete, then we cannot
@@ -1704,6 +1913,7 @@ ENGINE_ERROR_CODE VBucket::replace(
                         engine, cookie, &itm);
                 VBQueueItemCtx queueItmCtx;
                 queueItmCtx.preLinkDocumentContext = &preLinkDocumentContext;
+                queueItmCtx.sourceItem = &itm;
                 if (itm.isPending()) {
                     queueItmCtx.durability =
                             DurabilityItemCtx{itm.getDurabilityReqs(), cookie};
@@ -1971,6 +2181,8 @@ ENGINE_ERROR_CODE VBucket::setWithMeta(
             nullptr /* No pre link step needed */,
             {} /*overwritingPrepareSeqno*/};
 
+    queueItmCtx.sourceItem = &itm;
+
     MutationStatus status;
     boost::optional<VBNotifyCtx> notifyCtx;
     std::tie(status, notifyCtx) = processSet(htRes,
@@ -2057,7 +2269,9 @@ ENGINE_ERROR_CODE VBucket::deleteItem(
     auto ret = durability ? ENGINE_SYNC_WRITE_PENDING : ENGINE_SUCCESS;
 
     { // HashBucketLock scope
+        const auto htLockStart = std::chrono::steady_clock::now();
         auto htRes = ht.findForUpdate(cHandle.getKey());
+        traceHashTableLock(cookie, htLockStart);
         auto& hbl = htRes.getHBL();
 
         if (htRes.pending && htRes.pending->isPending()) {
@@ -2191,6 +2405,19 @@ ENGINE_ERROR_CODE VBucket::deleteItem(
     return ret;
 }
 
+void VBucket::fetchMetaForConflictResolution(
+        const DocKey& key, EventuallyPersistentEngine& engine) {
+    auto htRes = ht.findForUpdate(key);
+    if (htRes.committed || htRes.pending) {
+        // Resident, or a temp item which already has a BgFetch outstanding
+        return;
+    }
+
+    if (maybeKeyExistsInFilter(key)) {
+        addTempItemAndBGFetch(htRes.getHBL(), key, nullptr, engine, true);
+    }
+}
+
 ENGINE_ERROR_CODE VBucket::deleteWithMeta(
         uint64_t& cas,
         uint64_t* seqno,
@@ -2451,7 +2678,9 @@ ENGINE_ERROR_CODE VBucket::add(
     }
 
     { // HashBucketLock scope
+        const auto htLockStart = std::chrono::steady_clock::now();
         auto htRes = ht.findForUpdate(itm.getKey());
+        traceHashTableLock(cookie, htLockStart);
         auto* v = htRes.selectSVToModify(itm);
         auto& hbl = htRes.getHBL();
 
@@ -2462,6 +2691,17 @@ ENGINE_ERROR_CODE VBucket::add(
             return ENGINE_SYNC_WRITE_IN_PROGRESS;
         }
 
+        if (v == nullptr && eviction == EvictionPolicy::Full) {
+            // An evicted key recorded in the KeyDirectory exists on disk
+            // (unless its collection has since been dropped), so the add
+            // can be rejected without fetching it.
+            auto seqno = ht.findInKeyDirectory(itm.getKey());
+            if (seqno && !cHandle.isLogicallyDeleted(*seqno)) {
+                ++stats.keyDirectoryHits;
+                return ENGINE_NOT_STORED;
+            }
+        }
+
         bool maybeKeyExists = true;
         if ((v == nullptr || v->isTempInitialItem()) &&
             (eviction == EvictionPolicy::Full)) {
@@ -2474,6 +2714,7 @@ ENGINE_ERROR_CODE VBucket::add(
         PreLinkDocumentContext preLinkDocumentContext(engine, cookie, &itm);
         VBQueueItemCtx queueItmCtx;
         queueItmCtx.preLinkDocumentContext = &preLinkDocumentContext;
+        queueItmCtx.sourceItem = &itm;
         if (itm.isPending()) {
             queueItmCtx.durability =
                     DurabilityItemCtx{itm.getDurabilityReqs(), cookie};
@@ -2613,6 +2854,22 @@ GetValue VBucket::getAndUpdateTtl(
     folly::assume_unreachable();
 }
 
+GetValue VBucket::getInternal(
+        const void* cookie,
+        EventuallyPersistentEngine& engine,
+        get_options_t options,
+        GetKeyOnly getKeyOnly,
+        const Collections::VB::Manifest::CachingReadHandle& cHandle,
+        const ForGetReplicaOp getReplicaItem) {
+    if (eviction == EvictionPolicy::Full) {
+        return getInternal<EvictionPolicy::Full>(
+                cookie, engine, options, getKeyOnly, cHandle, getReplicaItem);
+    }
+    return getInternal<EvictionPolicy::Value>(
+            cookie, engine, options, getKeyOnly, cHandle, getReplicaItem);
+}
+
+template <EvictionPolicy Policy>
 GetValue VBucket::getInternal(
         const void* cookie,
         EventuallyPersistentEngine& engine,
@@ -2627,11 +2884,13 @@ GetValue VBucket::getInternal(
     const bool getDeletedValue = (options & GET_DELETED_VALUE);
     const bool bgFetchRequired = (options & QUEUE_BG_FETCH);
 
+    const auto htLockStart = std::chrono::steady_clock::now();
     auto res = fetchValidValue(WantsDeleted::Yes,
                                trackReference,
                                QueueExpired::Yes,
                                cHandle,
                                getReplicaItem);
+    traceHashTableLock(cookie, htLockStart);
 
     auto* v = res.storedValue;
     if (v) {
@@ -2705,7 +2964,7 @@ GetValue VBucket::getInternal(
                         !v->isResident(),
                         v->getNRUValue());
     } else {
-        if (!getDeletedValue && (eviction == EvictionPolicy::Value)) {
+        if (Policy == EvictionPolicy::Value && !getDeletedValue) {
             return GetValue();
         }
 
@@ -3034,7 +3293,28 @@ void VBucket::_addStats(bool details,
                 c);
         addStat("ht_cache_size", ht.getCacheSize(), add_stat, c);
         addStat("ht_size", ht.getSize(), add_stat, c);
+        addStat("ht_resize_in_progress", ht.isResizeInProgress(), add_stat, c);
+        addStat("ht_resize_buckets_remaining",
+                ht.getResizeBucketsRemaining(),
+                add_stat,
+                c);
+        addStat("ht_resize_max_step_us",
+                ht.getMaxResizeStepDuration().count(),
+                add_stat,
+                c);
         addStat("num_ejects", ht.getNumEjects(), add_stat, c);
+        addStat("key_directory_items",
+                ht.getKeyDirectorySize(),
+                add_stat,
+                c);
+        addStat("key_directory_memory",
+                ht.getKeyDirectoryMemory(),
+                add_stat,
+                c);
+        addStat("negative_lookup_cache_items",
+                ht.getNegativeLookupCacheSize(),
+                add_stat,
+                c);
         addStat("ops_create", opsCreate.load(), add_stat, c);
         addStat("ops_delete", opsDelete.load(), add_stat, c);
         addStat("ops_get", opsGet.load(), add_stat, c);
@@ -3073,6 +3353,19 @@ void VBucket::_addStats(bool details,
                 getSyncWriteAbortedCount(),
                 add_stat,
                 c);
+        if (getState() == vbucket_state_replica) {
+            addStat("last_known_active_seqno",
+                    getLastKnownActiveSeqno(),
+                    add_stat,
+                    c);
+            const auto staleness = getReplicaStaleness();
+            addStat("replica_staleness_ms",
+                    staleness == std::chrono::milliseconds::max()
+                            ? int64_t(-1)
+                            : int64_t(staleness.count()),
+                    add_stat,
+                    c);
+        }
 
         hlc.addStats(statPrefix, add_stat, c);
     }
@@ -3571,8 +3864,8 @@ VBucket::processExpiredItem(
      * but functionally correct and for performance reasons
      * only the system xattrs need to be stored.
      */
-    value_t value = v.getValue();
-    bool onlyMarkDeleted = value && mcbp::datatype::is_xattr(v.getDatatype());
+    bool onlyMarkDeleted =
+            v.getValue() && mcbp::datatype::is_xattr(v.getDatatype());
     v.setRevSeqno(v.getRevSeqno() + 1);
     VBNotifyCtx notifyCtx;
     StoredValue* newSv;
@@ -20,12 +20,15 @@
 #include "bloomfilter.h"
 #include "collections/vbucket_manifest.h"
 #include "dcp/dcp-types.h"
+#include "expiry_index.h"
 #include "hash_table.h"
 #include "hlc.h"
+#include "lock_profiler.h"
 #include "monotonic.h"
 #include "vbucket_fwd.h"
 
 #include <folly/Synchronized.h>
+#include <folly/lang/Align.h>
 #include <memcached/engine.h>
 #include <nlohmann/json.hpp>
 #include <platform/atomic_duration.h>
@@ -79,6 +82,32 @@ struct VBNotifyCtx {
     int itemCountDifference = 0;
 };
 
+/**
+ * The notifications for a batch of SyncWrites completed (Committed or
+ * Aborted) by the ActiveDurabilityMonitor. Instead of notifying the
+ * flusher, DCP and the client for every SyncWrite as it completes, the
+ * notifications are accumulated and sent once the whole batch is completed
+ * (see VBucket::notifySyncWritesCompleted).
+ */
+struct SyncWriteCompletionBatch {
+    /**
+     * Add the notifications of a completed SyncWrite
+     *
+     * @param notifyCtx The new seqno notification of the Commit / Abort
+     * @param cookie The client to notify (may be nullptr)
+     * @param result The result of the SyncWrite for the client
+     */
+    void add(const VBNotifyCtx& notifyCtx,
+             const void* cookie,
+             ENGINE_ERROR_CODE result);
+
+    /// The notifications of all the new seqnos, merged (highest seqno)
+    VBNotifyCtx newSeqno;
+
+    /// The clients to notify, in completion order
+    std::vector<std::pair<const void*, ENGINE_ERROR_CODE>> clients;
+};
+
 /**
  * Structure that holds seqno based or checkpoint persistence based high
  * priority requests to a vbucket
@@ -114,6 +143,17 @@ typedef std::unique_ptr<Callback<const Vbid, const VBNotifyCtx&>>
  */
 using SyncWriteResolvedCallback = std::function<void(Vbid vbid)>;
 
+/**
+ * Callback function invoked when the earliest deadline at which a tracked
+ * SyncWrite of the given vBucket may time out changes.
+ *
+ * Will normally register the deadline with the DurabilityTimeoutTask, so that
+ * the vBucket is checked for expired SyncWrites (only) once the deadline is
+ * reached.
+ */
+using SyncWriteTimeoutCallback = std::function<void(
+        Vbid vbid, std::chrono::steady_clock::time_point deadline)>;
+
 /**
  * Callback function invoked when an accepted SyncWrite operation has been
  * completed (has been committed / aborted / times out).
@@ -165,6 +205,7 @@ public:
             std::unique_ptr<AbstractStoredValueFactory> valFact,
             NewSeqnoCallback newSeqnoCb,
             SyncWriteResolvedCallback syncWriteResolvedCb,
+            SyncWriteTimeoutCallback syncWriteTimeoutCb,
             SyncWriteCompleteCallback syncWriteCb,
             SeqnoAckCallback seqnoAckCb,
             Configuration& config,
@@ -419,6 +460,12 @@ public:
         return stateLock;
     }
 
+    /// Shared holder of the stateLock for the front-end operations,
+    /// profiled by the LockProfiler.
+    using StateReadLockHolder =
+            ProfiledLockHolder<folly::SharedMutex::ReadHolder,
+                               LockProfiler::Site::VBucketState>;
+
     vbucket_state_t getInitialState(void) { return initialState; }
 
     vbucket_transition_state getTransitionState() const;
@@ -429,7 +476,9 @@ public:
     nlohmann::json getReplicationTopology() const;
 
     /**
-     * Enforce timeout for the expired SyncWrites in this VBucket.
+     * Enforce timeout for the expired SyncWrites in this VBucket. At replica,
+     * sends any seqno ack which the PassiveDM deferred for coalescing and
+     * whose coalescing window has expired.
      *
      * @param asOf The time to be compared with tracked-SWs' expiry-time
      */
@@ -438,6 +487,16 @@ public:
 
     void notifySyncWritesPendingCompletion();
 
+    /**
+     * Request that processDurabilityTimeout() is invoked for this VBucket
+     * once the given deadline is reached. Called by the ActiveDM when the
+     * earliest expiry-time of the tracked SyncWrites changes, and by the
+     * PassiveDM when it defers a seqno ack.
+     *
+     * @param deadline The time point at which a SyncWrite may time out
+     */
+    void scheduleSyncWriteTimeout(std::chrono::steady_clock::time_point deadline);
+
     /**
      * For all SyncWrites which the DurabilityMonitor has resolved (to be
      * committed or aborted), perform the appropriate operation - i.e.
@@ -496,6 +555,10 @@ public:
         bool moreAvailable = false;
         boost::optional<uint64_t> maxDeletedRevSeqno = {};
         CheckpointType checkpointType = CheckpointType::Memory;
+        /// When the oldest SyncWrite (requiring persistence) in the items
+        /// was queued, if any.
+        boost::optional<std::chrono::steady_clock::time_point>
+                oldestPrepareQueued;
     };
 
     /**
@@ -509,6 +572,13 @@ public:
      */
     ItemsToFlush getItemsToPersist(size_t approxLimit);
 
+    /**
+     * @return when the oldest SyncWrite requiring persistence which has not
+     *         yet been fetched by the flusher was queued, if there is one.
+     */
+    boost::optional<std::chrono::steady_clock::time_point>
+    getOldestUnflushedPrepareTime() const;
+
     bool isReceivingInitialDiskSnapshot() {
         return receivingInitialDiskSnapshot.load();
     }
@@ -520,6 +590,33 @@ public:
     /// @return true if we are a replica receiving a disk based snapshot
     bool isReceivingDiskSnapshot() const;
 
+    /**
+     * Set the high seqno of the active vBucket, as last told by DCP (the
+     * end of the latest snapshot received by the replica).
+     */
+    void setLastKnownActiveSeqno(uint64_t seqno) {
+        lastKnownActiveSeqno.store(seqno);
+    }
+
+    uint64_t getLastKnownActiveSeqno() const {
+        return lastKnownActiveSeqno.load();
+    }
+
+    /**
+     * Record that the replica has every item the active sent it (it has
+     * received the end of the last snapshot, and nothing is buffered).
+     */
+    void setReplicaInSync() {
+        replicaInSyncTime.store(std::chrono::steady_clock::now());
+    }
+
+    /**
+     * @return an upper bound of how out of date the replica is: the time
+     *         since it was last in sync with the active (or
+     *         milliseconds::max() if it never was).
+     */
+    std::chrono::milliseconds getReplicaStaleness() const;
+
     /**
      * Returns the map of bgfetch items for this vbucket, clearing the
      * pendingBGFetches.
@@ -609,6 +706,31 @@ public:
     size_t getFilterSize();
     size_t getNumOfKeysInFilter();
 
+    /**
+     * Record that the temp filter is missing (resident) keys; under full
+     * eviction it then can't be used after a warmup.
+     */
+    void markTempFilterIncomplete();
+
+    /**
+     * Bloom filter persistence (see KVStore::persistBloomFilter).
+     *
+     * @return the temp filter (as populated by compaction) / the main filter
+     *         serialised, or empty if it could not be used after a warmup:
+     *         under full eviction every key on disk must be in the filter,
+     *         under value eviction every deleted key.
+     */
+    std::string serialiseTempFilter();
+    std::string serialiseFilter();
+
+    /**
+     * Replace the bloom filter with one serialised by serialise*Filter().
+     *
+     * @return false (leaving the filter unchanged) if data is not a valid
+     *         filter for this vbucket's eviction policy.
+     */
+    bool loadFilter(cb::const_char_buffer data);
+
     uint64_t nextHLCCas() {
         return hlc.nextHLC();
     }
@@ -1033,6 +1155,19 @@ public:
             GenerateCas genCas,
             const Collections::VB::Manifest::CachingReadHandle& cHandle);
 
+    /**
+     * Make the metadata of a key available for the conflict resolution of
+     * a later setWithMeta; if the key isn't in the HashTable (and may exist
+     * on disk) a temp item is added and a meta-only BgFetch is queued
+     * without a cookie to notify. Used to batch the BgFetches of a
+     * SetWithMetaMulti request rather than blocking on them one at a time.
+     *
+     * @param key the key to fetch the metadata of
+     * @param engine Reference to ep engine
+     */
+    void fetchMetaForConflictResolution(const DocKey& key,
+                                        EventuallyPersistentEngine& engine);
+
     ENGINE_ERROR_CODE prepare(
             Item& itm,
             uint64_t cas,
@@ -1314,13 +1449,16 @@ public:
      *                    by the CheckpointManager.
      * @param cookie (Optional) The cookie representing the client connection,
      *     must be provided if the operation needs to be notified to a client
+     * @param batch (Optional) If provided, the new seqno and client
+     *     notifications are added to the batch instead of being sent
      */
     ENGINE_ERROR_CODE commit(
             const DocKey& key,
             uint64_t prepareSeqno,
             boost::optional<int64_t> commitSeqno,
             const Collections::VB::Manifest::CachingReadHandle& cHandle,
-            const void* cookie = nullptr);
+            const void* cookie = nullptr,
+            SyncWriteCompletionBatch* batch = nullptr);
 
     /**
      * Perform an abort against the given pending Sync Write.
@@ -1334,13 +1472,25 @@ public:
      * @param cHandle The collections handle
      * @param cookie (Optional) The cookie representing the client connection,
      *     must be provided if the operation needs to be notified to a client
+     * @param batch (Optional) If provided, the new seqno and client
+     *     notifications are added to the batch instead of being sent
      */
     ENGINE_ERROR_CODE abort(
             const DocKey& key,
             uint64_t prepareSeqno,
             boost::optional<int64_t> abortSeqno,
             const Collections::VB::Manifest::CachingReadHandle& cHandle,
-            const void* cookie = nullptr);
+            const void* cookie = nullptr,
+            SyncWriteCompletionBatch* batch = nullptr);
+
+    /**
+     * Send the notifications of a batch of completed SyncWrites: the new
+     * seqnos are notified once (for the highest seqno), followed by the
+     * clients.
+     *
+     * @param batch The notifications accumulated by commit() / abort()
+     */
+    void notifySyncWritesCompleted(const SyncWriteCompletionBatch& batch);
 
     /**
      * Notify the ActiveDurabilityMonitor that a SyncWrite has been locally
@@ -1490,6 +1640,20 @@ public:
         return mayContainXattrs.load();
     }
 
+    /**
+     * @return the index of the documents with an expiry time, or nullptr if
+     *         exp_pager_index_enabled isn't set
+     */
+    ExpiryIndex* getExpiryIndex() {
+        return expiryIndex.get();
+    }
+
+    /**
+     * Add the StoredValue to the expiry index if it's a live document with
+     * an expiry time (and the index is enabled).
+     */
+    void addToExpiryIndex(const StoredValue& v);
+
     cb::vbucket_info getInfo() const {
         return {mightContainXattrs()};
     }
@@ -1612,11 +1776,32 @@ public:
     std::queue<queued_item> rejectQueue;
     std::unique_ptr<FailoverTable> failovers;
 
+    /**
+     * A vbucket_state change (failover table or replication topology) the
+     * flusher deferred, so it may be persisted as part of the next flush
+     * batch. Only accessed by the flusher (while holding the vBucket lock).
+     */
+    std::unique_ptr<vbucket_transition_state> deferredVBState;
+    /// When the deferred vbucket_state change must be persisted
+    std::chrono::steady_clock::time_point deferredVBStateDeadline;
+
+    /*
+     * The counters below are written for every operation, by the front-end
+     * threads (ops and expiry counters) and by both the front-end threads
+     * and the flusher (dirty queue stats). They are grouped and padded so
+     * that they don't share cachelines with each other or with the
+     * read-mostly fields around them.
+     */
+    char opsCountersPadding[folly::hardware_destructive_interference_size];
+
     std::atomic<size_t>  opsCreate;
     std::atomic<size_t>  opsDelete;
     std::atomic<size_t>  opsGet;
     std::atomic<size_t>  opsReject;
     std::atomic<size_t>  opsUpdate;
+    std::atomic<size_t>  numExpiredItems;
+
+    char dirtyQueuePadding[folly::hardware_destructive_interference_size];
 
     cb::NonNegativeCounter<size_t> dirtyQueueSize;
     std::atomic<size_t>  dirtyQueueMem;
@@ -1626,7 +1811,7 @@ public:
     std::atomic<size_t>  dirtyQueuePendingWrites;
     std::atomic<size_t>  metaDataDisk;
 
-    std::atomic<size_t>  numExpiredItems;
+    char readMostlyPadding[folly::hardware_destructive_interference_size];
 
     /**
      * Should SyncWrites be blocked (isDurabilityPossible() return false) if
@@ -1636,6 +1821,14 @@ public:
      */
     const size_t maxAllowedReplicasForSyncWrites;
 
+    /**
+     * Seqno ack coalescing policy applied by the PassiveDM (see
+     * durability_seqno_ack_coalesce_window / _count). A zero window disables
+     * coalescing.
+     */
+    const std::chrono::microseconds seqnoAckCoalesceWindow;
+    const size_t seqnoAckCoalesceCount;
+
     /**
      * A custom delete function for deleting VBucket objects. Any thread could
      * be the last thread to release a VBucketPtr and deleting a VB will
@@ -2045,6 +2238,21 @@ protected:
 private:
     void fireAllOps(EventuallyPersistentEngine& engine, ENGINE_ERROR_CODE code);
 
+    /**
+     * getInternal() specialised for the vBucket's eviction policy, which
+     * getInternal() selects once per call so the policy checks on the path
+     * are resolved at compile time (and the Value eviction miss path doesn't
+     * consult the bloom filter through a virtual call).
+     */
+    template <EvictionPolicy Policy>
+    GetValue getInternal(
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            get_options_t options,
+            GetKeyOnly getKeyOnly,
+            const Collections::VB::Manifest::CachingReadHandle& cHandle,
+            ForGetReplicaOp getReplicaItem);
+
     void decrDirtyQueueMem(size_t decrementBy);
 
     void decrDirtyQueueAge(uint32_t decrementBy);
@@ -2367,9 +2575,16 @@ private:
      */
     std::atomic<bool> receivingInitialDiskSnapshot;
 
+    /// See setLastKnownActiveSeqno()
+    std::atomic<uint64_t> lastKnownActiveSeqno{0};
+    /// When the replica was last in sync with the active (the epoch if never)
+    std::atomic<std::chrono::steady_clock::time_point> replicaInSyncTime{};
+
     std::mutex bfMutex;
     std::unique_ptr<BloomFilter> bFilter;
     std::unique_ptr<BloomFilter> tempFilter;    // Used during compaction.
+    // Whether the temp filter holds every key on disk (guarded by bfMutex).
+    bool tempFilterComplete = false;
 
     std::atomic<uint64_t> rollbackItemCount;
 
@@ -2397,6 +2612,12 @@ private:
      */
     SyncWriteResolvedCallback syncWriteResolvedCb;
 
+    /**
+     * Callback invoked when the earliest timeout deadline of the SyncWrites
+     * tracked by this VBucket changes.
+     */
+    SyncWriteTimeoutCallback syncWriteTimeoutCb;
+
     /**
      * Callback invoked after a SyncWrite has been completed (Committed /
      * Aborted / Times Out), so the requesting client can be informed of the
@@ -2420,6 +2641,10 @@ private:
      */
     std::atomic<bool> mayContainXattrs;
 
+    /// The keys of the documents with an expiry time (see
+    /// exp_pager_index_enabled)
+    std::unique_ptr<ExpiryIndex> expiryIndex;
+
     // Durable writes are enqueued also into the DurabilityMonitor.
     // The seqno-order of items tracked by the DM must be the same as in the
     // Backfill/CheckpointManager Queues (seqno is strictly monotonic).
@@ -2427,6 +2652,10 @@ private:
     // which is what this mutex is used for.
     std::mutex dmQueueMutex;
 
+    // steady_clock time (0 if none) at which the oldest SyncWrite requiring
+    // persistence not yet fetched by the flusher was queued.
+    std::atomic<std::chrono::steady_clock::rep> oldestUnflushedPrepare{0};
+
     static cb::AtomicDuration<> chkFlushTimeout;
 
     static double mutationMemThreshold;
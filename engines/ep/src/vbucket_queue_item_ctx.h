@@ -23,6 +23,7 @@
 #include <boost/variant.hpp>
 #include <memcached/durability_spec.h>
 
+class Item;
 class PreLinkDocumentContext;
 
 /**
@@ -89,4 +90,8 @@ struct VBQueueItemCtx {
     /// Passed into the durability monitor to instruct it to remove an old
     /// prepare with the given seqno
     boost::optional<int64_t> overwritingPrepareSeqno = {};
+    /// The Item the StoredValue was stored from. If the StoredValue holds its
+    /// value inline, the queued item shares the Item's value instead of
+    /// copying the inline value.
+    const Item* sourceItem = nullptr;
 };
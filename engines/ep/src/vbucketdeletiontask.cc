@@ -16,6 +16,7 @@
  */
 
 #include "vbucketdeletiontask.h"
+#include "ep_bucket.h"
 #include "ep_engine.h"
 #include "ep_vb.h"
 #include "executorpool.h"
@@ -91,16 +92,94 @@ VBucketMemoryAndDiskDeletionTask::VBucketMemoryAndDiskDeletionTask(
     description += " and disk";
 }
 
+VBucketMemoryAndDiskDeletionTask::~VBucketMemoryAndDiskDeletionTask() {
+    // Cancelled (bucket shutdown) while deleting the file
+    if (deletingFile) {
+        static_cast<EPBucket&>(*engine->getKVBucket())
+                .completeVBucketFileDeletion();
+    }
+}
+
 bool VBucketMemoryAndDiskDeletionTask::run() {
     TRACE_EVENT1("ep-engine/task",
                  "VBucketMemoryAndDiskDeletionTask",
                  "vb",
                  (vbucket->getId()).get());
-    notifyAllPendingConnsFailed(false);
+    const auto deadline = std::chrono::steady_clock::now() + maxRunTime;
+
+    if (phase == Phase::Memory) {
+        if (nextStripe == 0) {
+            notifyAllPendingConnsFailed(false);
+        }
+        if (!clearMemory(deadline)) {
+            snooze(0);
+            return true;
+        }
+        phase = Phase::Disk;
+    }
+
+    if (!deletingFile) {
+        if (!static_cast<EPBucket&>(*engine->getKVBucket())
+                     .tryStartVBucketFileDeletion()) {
+            // Wait for one of the other deletions to complete
+            snooze(0.1);
+            return true;
+        }
+        deletingFile = true;
+        fileDeletionStart = std::chrono::steady_clock::now();
+    }
+
+    if (!truncateFile(deadline)) {
+        snooze(0);
+        return true;
+    }
 
-    auto start = std::chrono::steady_clock::now();
+    deleteFile();
+
+    if (vbucket->getDeferredDeletionCookie()) {
+        engine->notifyIOComplete(vbucket->getDeferredDeletionCookie(),
+                                 ENGINE_SUCCESS);
+    }
+
+    return false;
+}
+
+bool VBucketMemoryAndDiskDeletionTask::clearMemory(
+        std::chrono::steady_clock::time_point deadline) {
+    auto& ht = vbucket->ht;
+    while (nextStripe < ht.getNumLocks()) {
+        ht.clearStripe(nextStripe++);
+        if (nextStripe < ht.getNumLocks() &&
+            std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VBucketMemoryAndDiskDeletionTask::truncateFile(
+        std::chrono::steady_clock::time_point deadline) {
+    const auto step =
+            engine->getConfiguration().getVbucketDeletionTruncateSize();
+    auto* kvstore = shard.getRWUnderlying();
+    while (kvstore->truncateVBucketFile(
+                   vbucket->getId(), vbDeleteRevision, step) != 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void VBucketMemoryAndDiskDeletionTask::deleteFile() {
     shard.getRWUnderlying()->delVBucket(vbucket->getId(), vbDeleteRevision);
-    auto elapsed = std::chrono::steady_clock::now() - start;
+    static_cast<EPBucket&>(*engine->getKVBucket())
+            .completeVBucketFileDeletion();
+    deletingFile = false;
+
+    // The (wall) time includes the truncation steps and any time spent
+    // yielding between them
+    auto elapsed = std::chrono::steady_clock::now() - fileDeletionStart;
     auto wallTime =
             std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
 
@@ -110,11 +189,4 @@ bool VBucketMemoryAndDiskDeletionTask::run() {
     atomic_setIfBigger(engine->getEpStats().vbucketDelMaxWalltime,
                        hrtime_t(wallTime.count()));
     engine->getEpStats().vbucketDelTotWalltime.fetch_add(wallTime.count());
-
-    if (vbucket->getDeferredDeletionCookie()) {
-        engine->notifyIOComplete(vbucket->getDeferredDeletionCookie(),
-                                 ENGINE_SUCCESS);
-    }
-
-    return false;
 }
@@ -20,6 +20,8 @@
 #include "globaltask.h"
 #include "vbucket.h"
 
+#include <chrono>
+
 class EPVBucket;
 
 /*
@@ -71,6 +73,13 @@ protected:
  * responsible for clearing all the VBucket's pending operations and for
  * clearing the VBucket's hash table and removing the disk file.
  *
+ * The work is done in steps so a large vBucket doesn't hold on to an AUXIO
+ * thread (and the deletions of many vBuckets progress side by side): the
+ * hash table is cleared a lock stripe at a time, then the file is truncated
+ * vbucket_deletion_truncate_size bytes at a time before it is unlinked. The
+ * task yields whenever a run exceeds maxRunTime. At most
+ * vbucket_deletion_max_concurrent deletions work on their files at once.
+ *
  * This task is designed to be invoked only when the EPVBucket has no owners.
  */
 class VBucketMemoryAndDiskDeletionTask : public VBucketMemoryDeletionTask {
@@ -88,9 +97,37 @@ public:
                                      KVShard& shard,
                                      EPVBucket* vbucket);
 
+    ~VBucketMemoryAndDiskDeletionTask();
+
     bool run();
 
+    /// How long a single run may go on before the task yields
+    static constexpr std::chrono::milliseconds maxRunTime{25};
+
 protected:
+    enum class Phase { Memory, Disk };
+
+    /**
+     * Clear the next hash table stripes.
+     * @return true if the hash table has been cleared
+     */
+    bool clearMemory(std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * Truncate the file in steps.
+     * @return true if the file is ready to be unlinked
+     */
+    bool truncateFile(std::chrono::steady_clock::time_point deadline);
+
+    /// Unlink the file and update the deletion stats
+    void deleteFile();
+
     KVShard& shard;
     uint64_t vbDeleteRevision;
+    Phase phase = Phase::Memory;
+    /// The next hash table lock stripe to clear
+    size_t nextStripe = 0;
+    /// True once the deletion holds one of the concurrent file deletions
+    bool deletingFile = false;
+    std::chrono::steady_clock::time_point fileDeletionStart;
 };
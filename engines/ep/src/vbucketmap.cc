@@ -58,12 +58,6 @@ ENGINE_ERROR_CODE VBucketMap::addBucket(VBucketPtr vb) {
     return ENGINE_ERANGE;
 }
 
-void VBucketMap::enablePersistence(EPBucket& ep) {
-    for (auto& shard : shards) {
-        shard->enablePersistence(ep);
-    }
-}
-
 void VBucketMap::dropVBucketAndSetupDeferredDeletion(Vbid id,
                                                      const void* cookie) {
     if (id.get() < size) {
@@ -58,8 +58,6 @@ public:
      */
     ENGINE_ERROR_CODE addBucket(VBucketPtr vb);
 
-    void enablePersistence(EPBucket& ep);
-
     /**
      * Drop the vbucket from the map and setup deferred deletion of the VBucket.
      * Once the VBucketPtr has no more references the vbucket is deleted, but
@@ -30,6 +30,7 @@
 #include "failover-table.h"
 #include "item.h"
 #include "mutation_log.h"
+#include "resident_image.h"
 #include "statwriter.h"
 #include "vb_visitors.h"
 #include "vbucket_bgfetch_item.h"
@@ -40,6 +41,7 @@
 #include <platform/timeutils.h>
 #include <utilities/logtags.h>
 
+#include <algorithm>
 #include <array>
 #include <limits>
 #include <memory>
@@ -344,11 +346,11 @@ private:
 
 class WarmupKeyDump : public GlobalTask {
 public:
-    WarmupKeyDump(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupKeyDump(EPBucket& st, size_t taskId, Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupKeyDump, 0, false),
-          _shardId(sh),
+          _taskId(taskId),
           _warmup(w),
-          _description("Warmup - key dump: shard " + std::to_string(_shardId)) {
+          _description("Warmup - key dump: task " + std::to_string(_taskId)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -365,14 +367,14 @@ public:
     }
 
     bool run() override {
-        TRACE_EVENT1("ep-engine/task", "WarmupKeyDump", "shard", _shardId);
-        _warmup->keyDumpforShard(_shardId);
+        TRACE_EVENT1("ep-engine/task", "WarmupKeyDump", "task", _taskId);
+        _warmup->keyDump();
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
-    uint16_t _shardId;
+    size_t _taskId;
     Warmup* _warmup;
     const std::string _description;
 };
@@ -410,12 +412,14 @@ private:
 
 class WarmupLoadAccessLog : public GlobalTask {
 public:
-    WarmupLoadAccessLog(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupLoadAccessLog(EPBucket& st, uint16_t sh, size_t part, Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadAccessLog, 0, false),
           _shardId(sh),
+          _part(part),
           _warmup(w),
           _description("Warmup - loading access log: shard " +
-                       std::to_string(_shardId)) {
+                       std::to_string(_shardId) + " part " +
+                       std::to_string(_part)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -433,25 +437,26 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadAccessLog");
-        _warmup->loadingAccessLog(_shardId);
+        _warmup->loadingAccessLog(_shardId, _part);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    size_t _part;
     Warmup* _warmup;
     const std::string _description;
 };
 
 class WarmupLoadingKVPairs : public GlobalTask {
 public:
-    WarmupLoadingKVPairs(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupLoadingKVPairs(EPBucket& st, size_t taskId, Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadingKVPairs, 0, false),
-          _shardId(sh),
+          _taskId(taskId),
           _warmup(w),
-          _description("Warmup - loading KV Pairs: shard " +
-                       std::to_string(_shardId)) {
+          _description("Warmup - loading KV Pairs: task " +
+                       std::to_string(_taskId)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -470,25 +475,25 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadingKVPairs");
-        _warmup->loadKVPairsforShard(_shardId);
+        _warmup->loadKVPairs();
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
-    uint16_t _shardId;
+    size_t _taskId;
     Warmup* _warmup;
     const std::string _description;
 };
 
 class WarmupLoadingData : public GlobalTask {
 public:
-    WarmupLoadingData(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupLoadingData(EPBucket& st, size_t taskId, Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadingData, 0, false),
-          _shardId(sh),
+          _taskId(taskId),
           _warmup(w),
-          _description("Warmup - loading data: shard " +
-                       std::to_string(_shardId)) {
+          _description("Warmup - loading data: task " +
+                       std::to_string(_taskId)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -507,13 +512,13 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadingData");
-        _warmup->loadDataforShard(_shardId);
+        _warmup->loadData();
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
-    uint16_t _shardId;
+    size_t _taskId;
     Warmup* _warmup;
     const std::string _description;
 };
@@ -732,6 +737,7 @@ void LoadStorageKVPairCallback::callback(GetValue &val) {
         }
         bool succeeded(false);
         int retry = 2;
+        const auto insertStart = std::chrono::steady_clock::now();
         do {
             if (i->getCas() == static_cast<uint64_t>(-1)) {
                 if (val.isPartial()) {
@@ -787,6 +793,11 @@ void LoadStorageKVPairCallback::callback(GetValue &val) {
                         std::to_string(static_cast<uint16_t>(res)));
             }
         } while (!succeeded && retry-- > 0);
+        epstore.getWarmup()->recordLoadedItem(
+                i->getVBucketId(),
+                warmupState,
+                i->getKey().size() + i->getNBytes(),
+                std::chrono::steady_clock::now() - insertStart);
 
         if (maybeEnableTraffic) {
             stopLoading = epstore.maybeEnableTraffic();
@@ -918,6 +929,8 @@ Warmup::Warmup(EPBucket& st, Configuration& config_)
       config(config_),
       shardVbStates(store.vbMap.getNumShards()),
       shardVbIds(store.vbMap.getNumShards()),
+      vbLoadedFromImage(config.getMaxVbuckets()),
+      shardLoadStats(store.vbMap.getNumShards()),
       warmedUpVbuckets(config.getMaxVbuckets()) {
 }
 
@@ -973,6 +986,7 @@ void Warmup::initialize()
         std::lock_guard<std::mutex> lock(warmupStart.mutex);
         warmupStart.time = std::chrono::steady_clock::now();
     }
+    phaseTimes[size_t(WarmupState::State::Initialize)].started = true;
 
     std::map<std::string, std::string> session_stats;
     store.getOneROUnderlying()->getPersistedStats(session_stats);
@@ -1072,6 +1086,33 @@ void Warmup::createVBuckets(uint16_t shardId) {
             vb->setFreqSaturatedCallback(
                     [bucket]() { bucket->wakeItemFreqDecayerTask(); });
 
+            // Reuse the bloom filter persisted with the vbucket if nothing
+            // has been written since; otherwise the vbucket runs without one
+            // until compaction rebuilds it.
+            if (config.isBfilterEnabled()) {
+                const auto persisted =
+                        store.getROUnderlyingByShard(shardId)
+                                ->getPersistedBloomFilter(vbid);
+                if (persisted.second.empty()) {
+                    // None persisted.
+                } else if (persisted.first !=
+                           static_cast<uint64_t>(vbs.highSeqno)) {
+                    EP_LOG_INFO(
+                            "Warmup::createVBuckets: {} persisted bloom "
+                            "filter is stale (seqno:{}, highSeqno:{})",
+                            vbid,
+                            persisted.first,
+                            vbs.highSeqno);
+                } else if (vb->loadFilter(persisted.second)) {
+                    ++bloomFiltersLoaded;
+                } else {
+                    EP_LOG_WARN(
+                            "Warmup::createVBuckets: {} persisted bloom "
+                            "filter could not be loaded",
+                            vbid);
+                }
+            }
+
             // Add the new vbucket to our local map, it will later be added
             // to the bucket's vbMap once the vbuckets are fully initialised
             // from KVStore data
@@ -1272,38 +1313,23 @@ void Warmup::populateVBucketMap(uint16_t shardId) {
 
 void Warmup::scheduleKeyDump()
 {
-    threadtask_count = 0;
-    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
+    const auto numTasks = prepareVBucketLoad();
+    for (size_t i = 0; i < numTasks; i++) {
         ExTask task = std::make_shared<WarmupKeyDump>(store, i, this);
         ExecutorPool::get()->schedule(task);
     }
 
 }
 
-void Warmup::keyDumpforShard(uint16_t shardId)
+void Warmup::keyDump()
 {
-    KVStore* kvstore = store.getROUnderlyingByShard(shardId);
+    // Each task has its own callbacks, as they track the status of a scan.
     auto cb = std::make_shared<LoadStorageKVPairCallback>(
             store, false, state.getState());
     auto cl = std::make_shared<NoLookupCallback>();
 
-    for (const auto vbid : shardVbIds[shardId]) {
-        ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
-                                                    DocumentFilter::NO_DELETES,
-                                                    ValueFilter::KEYS_ONLY);
-        if (ctx) {
-            auto errorCode = kvstore->scan(ctx);
-            kvstore->destroyScanContext(ctx);
-            if (errorCode == scan_again) { // ENGINE_ENOMEM
-                // skip loading remaining VBuckets as memory limit was reached
-                break;
-            }
-        }
-    }
-
-    if (++threadtask_count == store.vbMap.getNumShards()) {
-        transition(WarmupState::State::CheckForAccessLog);
-    }
+    loadVBuckets(cb, cl, ValueFilter::KEYS_ONLY, true);
+    vbucketLoadTaskComplete(WarmupState::State::CheckForAccessLog);
 }
 
 void Warmup::scheduleCheckForAccessLog()
@@ -1349,23 +1375,42 @@ void Warmup::checkForAccessLog()
 void Warmup::scheduleLoadingAccessLog()
 {
     threadtask_count = 0;
-    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadAccessLog>(store, i, this);
-        ExecutorPool::get()->schedule(task);
+    // Fetching the logged keys is dominated by random reads, so rather than
+    // a single task per shard, split each shard's vBuckets between enough
+    // tasks to use all of the reader threads. Each task reads the whole of
+    // its shard's log (sequentially), fetching only its own vBuckets' keys.
+    const size_t numShards = store.vbMap.getNumShards();
+    accessLogTasksPerShard =
+            std::max(size_t(1), ExecutorPool::get()->getNumReaders() / numShards);
+    for (size_t i = 0; i < numShards; i++) {
+        for (size_t part = 0; part < accessLogTasksPerShard; part++) {
+            ExTask task = std::make_shared<WarmupLoadAccessLog>(
+                    store, i, part, this);
+            ExecutorPool::get()->schedule(task);
+        }
     }
 }
 
-void Warmup::loadingAccessLog(uint16_t shardId)
+void Warmup::loadingAccessLog(uint16_t shardId, size_t part)
 {
+    // The vBuckets of the shard which this task loads.
+    std::map<Vbid, vbucket_state> vbStates;
+    size_t index = 0;
+    for (const auto& vbState : shardVbStates[shardId]) {
+        if (index++ % accessLogTasksPerShard == part) {
+            vbStates.insert(vbState);
+        }
+    }
+
     LoadStorageKVPairCallback load_cb(store, true, state.getState());
     bool success = false;
     auto stTime = std::chrono::steady_clock::now();
-    if (store.accessLog[shardId].exists()) {
+    // Several tasks read each log, so each opens its own (read-only) handle.
+    MutationLog curr(store.accessLog[shardId].getLogFile());
+    if (curr.exists()) {
         try {
-            store.accessLog[shardId].open();
-            if (doWarmup(store.accessLog[shardId],
-                         shardVbStates[shardId],
-                         load_cb) != (size_t)-1) {
+            curr.open(true);
+            if (doWarmup(curr, vbStates, load_cb) != (size_t)-1) {
                 success = true;
             }
         } catch (MutationLog::ReadException &e) {
@@ -1381,9 +1426,8 @@ void Warmup::loadingAccessLog(uint16_t shardId)
         MutationLog old(nm);
         if (old.exists()) {
             try {
-                old.open();
-                if (doWarmup(old, shardVbStates[shardId], load_cb) !=
-                    (size_t)-1) {
+                old.open(true);
+                if (doWarmup(old, vbStates, load_cb) != (size_t)-1) {
                     success = true;
                 }
             } catch (MutationLog::ReadException &e) {
@@ -1393,6 +1437,17 @@ void Warmup::loadingAccessLog(uint16_t shardId)
         }
     }
 
+    if (!vbStates.empty()) {
+        // Attribute the task's time evenly between its vBuckets.
+        const auto taskTime = (std::chrono::steady_clock::now() - stTime) /
+                              vbStates.size();
+        for (const auto& vbState : vbStates) {
+            recordScanTime(vbState.first,
+                           WarmupState::State::LoadingAccessLog,
+                           taskTime);
+        }
+    }
+
     size_t numItems = store.getEPEngine().getEpStats().warmedUpValues;
     if (success && numItems) {
         EP_LOG_INFO("{} items loaded from access log, completed in {}",
@@ -1403,7 +1458,8 @@ void Warmup::loadingAccessLog(uint16_t shardId)
         setEstimatedWarmupCount(estimatedCount);
     }
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (++threadtask_count ==
+        store.vbMap.getNumShards() * accessLogTasksPerShard) {
         if (!store.maybeEnableTraffic()) {
             transition(WarmupState::State::LoadingData);
         } else {
@@ -1465,47 +1521,29 @@ void Warmup::scheduleLoadingKVPairs()
     // keys have been warmed up at this point.
     setEstimatedWarmupCount(estimatedItemCount);
 
-    threadtask_count = 0;
-    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
+    const auto numTasks = prepareVBucketLoad();
+    for (size_t i = 0; i < numTasks; i++) {
         ExTask task = std::make_shared<WarmupLoadingKVPairs>(store, i, this);
         ExecutorPool::get()->schedule(task);
     }
 
 }
 
-void Warmup::loadKVPairsforShard(uint16_t shardId)
+void Warmup::loadKVPairs()
 {
     bool maybe_enable_traffic = false;
-    scan_error_t errorCode = scan_success;
 
     if (store.getItemEvictionPolicy() == EvictionPolicy::Full) {
         maybe_enable_traffic = true;
     }
 
-    KVStore* kvstore = store.getROUnderlyingByShard(shardId);
     auto cb = std::make_shared<LoadStorageKVPairCallback>(
             store, maybe_enable_traffic, state.getState());
     auto cl =
             std::make_shared<LoadValueCallback>(store.vbMap, state.getState());
 
-    ValueFilter valFilter = store.getValueFilterForCompressionMode();
-
-    for (const auto vbid : shardVbIds[shardId]) {
-        ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
-                                                    DocumentFilter::NO_DELETES,
-                                                    valFilter);
-        if (ctx) {
-            errorCode = kvstore->scan(ctx);
-            kvstore->destroyScanContext(ctx);
-            if (errorCode == scan_again) { // ENGINE_ENOMEM
-                // skip loading remaining VBuckets as memory limit was reached
-                break;
-            }
-        }
-    }
-    if (++threadtask_count == store.vbMap.getNumShards()) {
-        transition(WarmupState::State::Done);
-    }
+    loadVBuckets(cb, cl, store.getValueFilterForCompressionMode(), true);
+    vbucketLoadTaskComplete(WarmupState::State::Done);
 }
 
 void Warmup::scheduleLoadingData()
@@ -1513,41 +1551,143 @@ void Warmup::scheduleLoadingData()
     size_t estimatedCount = store.getEPEngine().getEpStats().warmedUpKeys;
     setEstimatedWarmupCount(estimatedCount);
 
-    threadtask_count = 0;
-    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
+    const auto numTasks = prepareVBucketLoad();
+    for (size_t i = 0; i < numTasks; i++) {
         ExTask task = std::make_shared<WarmupLoadingData>(store, i, this);
         ExecutorPool::get()->schedule(task);
     }
 }
 
-void Warmup::loadDataforShard(uint16_t shardId)
+void Warmup::loadData()
 {
-    scan_error_t errorCode = scan_success;
-
-    KVStore* kvstore = store.getROUnderlyingByShard(shardId);
     auto cb = std::make_shared<LoadStorageKVPairCallback>(
             store, true, state.getState());
     auto cl =
             std::make_shared<LoadValueCallback>(store.vbMap, state.getState());
 
-    ValueFilter valFilter = store.getValueFilterForCompressionMode();
+    loadVBuckets(cb, cl, store.getValueFilterForCompressionMode(), false);
+    vbucketLoadTaskComplete(WarmupState::State::Done);
+}
 
-    for (const auto vbid : shardVbIds[shardId]) {
-        ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
-                                                    DocumentFilter::NO_DELETES,
-                                                    valFilter);
-        if (ctx) {
-            errorCode = kvstore->scan(ctx);
-            kvstore->destroyScanContext(ctx);
-            if (errorCode == scan_again) { // ENGINE_ENOMEM
-                // skip loading remaining VBuckets as memory limit was reached
-                break;
+size_t Warmup::prepareVBucketLoad() {
+    vbLoadQueue.clear();
+    for (size_t pos = 0;; ++pos) {
+        bool added = false;
+        for (const auto& vbids : shardVbIds) {
+            if (pos < vbids.size()) {
+                // Already fully loaded if restored from its image.
+                if (!vbLoadedFromImage[vbids[pos].get()]) {
+                    vbLoadQueue.push_back(vbids[pos]);
+                }
+                added = true;
             }
         }
+        if (!added) {
+            break;
+        }
     }
+    nextVbToLoad = 0;
+    vbLoadStopped = false;
+    threadtask_count = 0;
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
-        transition(WarmupState::State::Done);
+    // No point in more tasks than vBuckets, but always at least one so that
+    // the phase completes.
+    vbLoadTaskCount = std::max(
+            size_t(1),
+            std::min(vbLoadQueue.size(), ExecutorPool::get()->getNumReaders()));
+    return vbLoadTaskCount;
+}
+
+void Warmup::loadVBuckets(std::shared_ptr<StatusCallback<GetValue>> cb,
+                          std::shared_ptr<StatusCallback<CacheLookup>> cl,
+                          ValueFilter valFilter,
+                          bool useImages) {
+    useImages = useImages && config.isWarmupResidentImage();
+    while (!vbLoadStopped) {
+        const size_t index = nextVbToLoad++;
+        if (index >= vbLoadQueue.size()) {
+            break;
+        }
+        const auto vbid = vbLoadQueue[index];
+        const auto phase = state.getState();
+        TRACE_EVENT2("ep-engine/warmup",
+                     "loadVBucket",
+                     "vbid",
+                     vbid.get(),
+                     "phase",
+                     int(phase));
+        const auto scanStart = std::chrono::steady_clock::now();
+        if (useImages && loadResidentImage(vbid, *cb, valFilter)) {
+            if (cb->getStatus() == ENGINE_ENOMEM) {
+                vbLoadStopped = true;
+            }
+        } else {
+            KVStore* kvstore = store.getROUnderlying(vbid);
+            ScanContext* ctx = kvstore->initScanContext(
+                    cb, cl, vbid, 0, DocumentFilter::NO_DELETES, valFilter);
+            if (ctx) {
+                auto errorCode = kvstore->scan(ctx);
+                kvstore->destroyScanContext(ctx);
+                if (errorCode == scan_again) { // ENGINE_ENOMEM
+                    // skip loading remaining VBuckets as memory limit was
+                    // reached
+                    vbLoadStopped = true;
+                }
+            }
+        }
+        recordScanTime(vbid, phase, std::chrono::steady_clock::now() - scanStart);
+    }
+}
+
+bool Warmup::loadResidentImage(Vbid vbid,
+                               StatusCallback<GetValue>& cb,
+                               ValueFilter valFilter) {
+    const auto path = ResidentImage::getPath(config.getDbname(), vbid);
+    if (!cb::io::isFile(path)) {
+        return false;
+    }
+
+    bool loaded = false;
+    const auto& vbStates =
+            shardVbStates[vbid.get() % store.vbMap.getNumShards()];
+    const auto found = vbStates.find(vbid);
+    if (found != vbStates.end()) {
+        try {
+            loaded = ResidentImage::load(
+                    path,
+                    vbid,
+                    found->second.highSeqno,
+                    [&cb, valFilter](std::unique_ptr<Item> item, bool keyOnly) {
+                        if (!keyOnly &&
+                            valFilter == ValueFilter::VALUES_DECOMPRESSED) {
+                            item->decompressValue();
+                        }
+                        GetValue gv(std::move(item),
+                                    ENGINE_SUCCESS,
+                                    -1,
+                                    keyOnly);
+                        cb.callback(gv);
+                        return cb.getStatus() != ENGINE_ENOMEM;
+                    });
+        } catch (const std::exception& e) {
+            EP_LOG_WARN("Warmup::loadResidentImage: {} failed to read {}: {}",
+                        vbid,
+                        path,
+                        e.what());
+        }
+    }
+    remove(path.c_str());
+
+    if (loaded) {
+        vbLoadedFromImage[vbid.get()] = 1;
+        ++residentImagesLoaded;
+    }
+    return loaded;
+}
+
+void Warmup::vbucketLoadTaskComplete(WarmupState::State next) {
+    if (++threadtask_count == vbLoadTaskCount) {
+        transition(next);
     }
 }
 
@@ -1558,6 +1698,7 @@ void Warmup::scheduleCompletion() {
 
 void Warmup::done()
 {
+    recordPhaseTransition(WarmupState::State::Done, WarmupState::State::Done);
     if (setComplete()) {
         setWarmupTime();
         store.warmupCompleted();
@@ -1612,10 +1753,63 @@ void Warmup::transition(WarmupState::State to, bool force) {
     auto old = state.getState();
     if (old != WarmupState::State::Done) {
         state.transition(to, force);
+        recordPhaseTransition(old, to);
         step();
     }
 }
 
+std::chrono::steady_clock::duration Warmup::sinceStart(
+        std::chrono::steady_clock::time_point time) {
+    std::lock_guard<std::mutex> lock(warmupStart.mutex);
+    return time - warmupStart.time;
+}
+
+void Warmup::recordPhaseTransition(WarmupState::State from,
+                                   WarmupState::State to) {
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = sinceStart(now);
+
+    auto& ended = phaseTimes[size_t(from)];
+    if (ended.started && !ended.finished.exchange(true)) {
+        const auto start = ended.start.load();
+        ended.duration.store(elapsed - start);
+        TRACE_COMPLETE1("ep-engine/warmup",
+                        "phase",
+                        now - (elapsed - start),
+                        now,
+                        "state",
+                        int(from));
+    }
+
+    auto& started = phaseTimes[size_t(to)];
+    if (from != to && !started.started) {
+        started.start.store(elapsed);
+        started.started = true;
+    }
+}
+
+void Warmup::recordLoadedItem(Vbid vbid,
+                              WarmupState::State phase,
+                              size_t bytes,
+                              std::chrono::steady_clock::duration insertTime) {
+    auto& stats =
+            shardLoadStats[vbid.get() % shardLoadStats.size()][size_t(phase)];
+    ++stats.items;
+    stats.bytes += bytes;
+    stats.insertTime +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(insertTime)
+                    .count();
+}
+
+void Warmup::recordScanTime(Vbid vbid,
+                            WarmupState::State phase,
+                            std::chrono::steady_clock::duration duration) {
+    shardLoadStats[vbid.get() % shardLoadStats.size()][size_t(phase)]
+            .scanTime +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+                    .count();
+}
+
 template <typename T>
 void addStat(const char* nm,
              const T& val,
@@ -1648,6 +1842,11 @@ void Warmup::addStats(const AddStatFn& add_stat, const void* c) const {
     addStat("value_count", stats.warmedUpValues, add_stat, c);
     addStat("dups", stats.warmDups, add_stat, c);
     addStat("oom", stats.warmOOM, add_stat, c);
+    addStat("bloom_filters_loaded", bloomFiltersLoaded.load(), add_stat, c);
+    addStat("resident_images_loaded",
+            residentImagesLoaded.load(),
+            add_stat,
+            c);
     addStat("min_memory_threshold",
             stats.warmupMemUsedCap * 100.0,
             add_stat,
@@ -1696,6 +1895,111 @@ void Warmup::addStats(const AddStatFn& add_stat, const void* c) const {
     }
 }
 
+/// @return the name of the given phase as used in the timeline stats
+static const char* getPhaseStatName(WarmupState::State phase) {
+    switch (phase) {
+    case WarmupState::State::Initialize:
+        return "initialize";
+    case WarmupState::State::CreateVBuckets:
+        return "create_vbuckets";
+    case WarmupState::State::LoadingCollectionCounts:
+        return "loading_collection_counts";
+    case WarmupState::State::EstimateDatabaseItemCount:
+        return "estimate_item_count";
+    case WarmupState::State::LoadPreparedSyncWrites:
+        return "loading_prepared_sync_writes";
+    case WarmupState::State::PopulateVBucketMap:
+        return "populate_vbucket_map";
+    case WarmupState::State::KeyDump:
+        return "key_dump";
+    case WarmupState::State::LoadingAccessLog:
+        return "loading_access_log";
+    case WarmupState::State::CheckForAccessLog:
+        return "check_for_access_log";
+    case WarmupState::State::LoadingKVPairs:
+        return "loading_kv_pairs";
+    case WarmupState::State::LoadingData:
+        return "loading_data";
+    case WarmupState::State::Done:
+        return "done";
+    }
+    return "unknown";
+}
+
+void Warmup::addTimelineStats(const AddStatFn& add_stat, const void* c) const {
+    using namespace std::chrono;
+
+    for (size_t ii = 0; ii < numPhases; ++ii) {
+        const auto& times = phaseTimes[ii];
+        if (!times.started) {
+            continue;
+        }
+        const std::string prefix =
+                getPhaseStatName(WarmupState::State(ii)) + std::string("_");
+        addStat((prefix + "start").c_str(),
+                duration_cast<microseconds>(times.start.load()).count(),
+                add_stat,
+                c);
+        const auto phaseTime = times.duration.load();
+        if (times.finished) {
+            addStat((prefix + "duration").c_str(),
+                    duration_cast<microseconds>(phaseTime).count(),
+                    add_stat,
+                    c);
+        }
+
+        LoadStats total;
+        for (const auto& shard : shardLoadStats) {
+            total.items += shard[ii].items;
+            total.bytes += shard[ii].bytes;
+            total.scanTime += shard[ii].scanTime;
+            total.insertTime += shard[ii].insertTime;
+        }
+        if (total.scanTime == 0 && total.items == 0) {
+            // Not a loading phase.
+            continue;
+        }
+
+        // scan_time is the time the phase's tasks spent loading; of that,
+        // insert_time was spent inserting into the HashTable and read_time
+        // reading, decoding and decompressing.
+        const auto addLoadStats = [&add_stat, c](const std::string& name,
+                                                 const LoadStats& load) {
+            const uint64_t scanTime = load.scanTime;
+            const uint64_t insertTime =
+                    std::min(scanTime, load.insertTime.load());
+            addStat((name + "items").c_str(), load.items.load(), add_stat, c);
+            addStat((name + "bytes").c_str(), load.bytes.load(), add_stat, c);
+            addStat((name + "scan_time").c_str(),
+                    scanTime / 1000,
+                    add_stat,
+                    c);
+            addStat((name + "insert_time").c_str(),
+                    insertTime / 1000,
+                    add_stat,
+                    c);
+            addStat((name + "read_time").c_str(),
+                    (scanTime - insertTime) / 1000,
+                    add_stat,
+                    c);
+        };
+        addLoadStats(prefix, total);
+        if (times.finished && phaseTime > phaseTime.zero()) {
+            // Throughput over the phase's wall-clock time.
+            addStat((prefix + "bytes_per_sec").c_str(),
+                    uint64_t(total.bytes /
+                             duration_cast<duration<double>>(phaseTime)
+                                     .count()),
+                    add_stat,
+                    c);
+        }
+        for (size_t shard = 0; shard < shardLoadStats.size(); ++shard) {
+            addLoadStats(prefix + "shard_" + std::to_string(shard) + "_",
+                         shardLoadStats[shard][ii]);
+        }
+    }
+}
+
 /* In the case of CouchKVStore, all vbucket states of all the shards
  * are stored in a single instance. Others (e.g. RocksDBKVStore) store
  * only the vbucket states specific to that shard. Hence the vbucket
@@ -24,6 +24,7 @@
 #include <memcached/engine_common.h>
 #include <platform/atomic_duration.h>
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <deque>
@@ -34,6 +35,7 @@
 #include <unordered_set>
 #include <vector>
 
+class CacheLookup;
 class Configuration;
 class EPStats;
 class EPBucket;
@@ -44,6 +46,8 @@ class Vbid;
 
 struct vbucket_state;
 
+enum class ValueFilter;
+
 template <typename...>
 class StatusCallback;
 
@@ -228,8 +232,33 @@ public:
 
     size_t getEstimatedItemCount() const;
 
+    /// @return the number of vBuckets loaded from a ResidentImage.
+    size_t getResidentImagesLoaded() const {
+        return residentImagesLoaded;
+    }
+
     void addStats(const AddStatFn& add_stat, const void* c) const;
 
+    /**
+     * Add the warmup timeline ("stats warmup timeline"): when each phase
+     * started and how long it took, and for the phases which load items, how
+     * much was loaded and how the tasks' time divides between reading from
+     * disk (including decoding & decompressing) and inserting into the
+     * HashTable - both overall and by shard, to find stragglers.
+     */
+    void addTimelineStats(const AddStatFn& add_stat, const void* c) const;
+
+    /**
+     * Account for an item inserted by a loading phase.
+     *
+     * @param bytes the size of the item's key and value
+     * @param insertTime the time taken to insert it into the HashTable
+     */
+    void recordLoadedItem(Vbid vbid,
+                          WarmupState::State phase,
+                          size_t bytes,
+                          std::chrono::steady_clock::duration insertTime);
+
     std::chrono::steady_clock::duration getTime() {
         return warmup.load();
     }
@@ -343,9 +372,10 @@ private:
 
     /**
      * [Value-eviction only]
-     * Loads all keys into memory for each vBucket in the given shard.
+     * Loads all keys into memory for each vBucket claimed by the calling
+     * task (see loadVBuckets).
      */
-    void keyDumpforShard(uint16_t shardId);
+    void keyDump();
 
     /**
      * Checks for the existance of an access log file for each shard:
@@ -356,26 +386,66 @@ private:
     void checkForAccessLog();
 
     /**
-     * Loads the access log for the given shardId:
+     * Loads the access log for the given shardId, for the vBuckets of the
+     * shard in the given part (each shard's vBuckets are split into
+     * accessLogTasksPerShard parts, each loaded by its own task):
      * - Reads a batch of keys from the access log
      * - For each key read, attempt to fetch key+value from the underlying
      *   KVStore.
      * - If key exists (wasn't subsequently deleted), insert into the
      *   HashTable.
      */
-    void loadingAccessLog(uint16_t shardId);
+    void loadingAccessLog(uint16_t shardId, size_t part);
 
     /**
      * [Full-eviction only]
-     * Loads both keys and values into memory for each vBucket in the given
-     * shard.
+     * Loads both keys and values into memory for each vBucket claimed by
+     * the calling task.
+     */
+    void loadKVPairs();
+
+    /**
+     * Loads values into memory for each vBucket claimed by the calling task.
+     */
+    void loadData();
+
+    /**
+     * Prepare for one of the per-vBucket phases (KeyDump, LoadingKVPairs,
+     * LoadingData). These aren't limited to one task per shard: all of the
+     * shards' vBuckets are put in a single queue (interleaving the shards,
+     * each in its shardVbIds order), which a task per READER thread drains.
+     * @return the number of tasks to schedule for the phase.
+     */
+    size_t prepareVBucketLoad();
+
+    /**
+     * Scan vBuckets claimed from the queue set up by prepareVBucketLoad
+     * until it is empty, or a scan runs out of memory (which stops all of
+     * the phase's tasks).
+     * @param useImages Load each vBucket from its HashTable image instead,
+     *        where it has a valid one.
      */
-    void loadKVPairsforShard(uint16_t shardId);
+    void loadVBuckets(std::shared_ptr<StatusCallback<GetValue>> cb,
+                      std::shared_ptr<StatusCallback<CacheLookup>> cl,
+                      ValueFilter valFilter,
+                      bool useImages);
 
     /**
-     * Loads values into memory for each vBucket in the given shard.
+     * Load the given vBucket's items from its HashTable image (written at
+     * the last shutdown) into cb, if it has one which matches its data file.
+     * The image is removed either way.
+     * @return true if the image was loaded; the vBucket is then skipped by
+     *         the later loading phases.
      */
-    void loadDataforShard(uint16_t shardId);
+    bool loadResidentImage(Vbid vbid,
+                           StatusCallback<GetValue>& cb,
+                           ValueFilter valFilter);
+
+    /**
+     * Called by each task of a per-vBucket phase once it's done; the last
+     * one moves warmup on to the given state.
+     */
+    void vbucketLoadTaskComplete(WarmupState::State next);
 
     /* Terminal state of warmup. Updates statistics and marks warmup as
      * completed
@@ -430,6 +500,55 @@ private:
     /// contains all vBucket IDs which are present for the given shard.
     std::vector<std::vector<Vbid>> shardVbIds;
 
+    /// The vBuckets to be loaded by the current per-vBucket phase, in order
+    std::vector<Vbid> vbLoadQueue;
+    /// Index into vbLoadQueue of the next vBucket to be claimed by a task
+    std::atomic<size_t> nextVbToLoad{0};
+    /// Number of tasks scheduled for the current per-vBucket phase
+    size_t vbLoadTaskCount{0};
+    /// Set once a scan runs out of memory, to stop the remaining loads
+    std::atomic<bool> vbLoadStopped{false};
+    /// Number of tasks replaying each shard's access log
+    size_t accessLogTasksPerShard{1};
+
+    static constexpr size_t numPhases = size_t(WarmupState::State::Done) + 1;
+
+    /// When a phase ran, relative to warmupStart.
+    struct PhaseTimes {
+        std::atomic<bool> started{false};
+        std::atomic<bool> finished{false};
+        cb::AtomicDuration<> start;
+        cb::AtomicDuration<> duration;
+    };
+
+    /// What a loading phase loaded from one shard, and where the time went.
+    struct LoadStats {
+        std::atomic<size_t> items{0};
+        std::atomic<size_t> bytes{0};
+        /// Nanoseconds (summed over tasks) spent loading the shard's vBuckets
+        std::atomic<uint64_t> scanTime{0};
+        /// Nanoseconds of scanTime spent inserting into the HashTable
+        std::atomic<uint64_t> insertTime{0};
+    };
+
+    /// Record the end of phase `from` and the start of phase `to`.
+    void recordPhaseTransition(WarmupState::State from, WarmupState::State to);
+
+    /// Account for time spent by a loading phase loading a vBucket.
+    void recordScanTime(Vbid vbid,
+                        WarmupState::State phase,
+                        std::chrono::steady_clock::duration duration);
+
+    /// @return the time elapsed since warmupStart
+    std::chrono::steady_clock::duration sinceStart(
+            std::chrono::steady_clock::time_point time);
+
+    std::array<PhaseTimes, numPhases> phaseTimes;
+    /// Indexed by shard, then by phase
+    std::vector<std::array<LoadStats, numPhases>> shardLoadStats;
+    /// Non-zero for each vBucket (by id) loaded from its HashTable image
+    std::vector<uint8_t> vbLoadedFromImage;
+
     cb::AtomicDuration<> estimateTime;
     std::atomic<size_t> estimatedItemCount{std::numeric_limits<size_t>::max()};
     bool cleanShutdown{true};
@@ -438,6 +557,10 @@ private:
     std::atomic<bool> warmupOOMFailure{false};
     std::atomic<size_t> estimatedWarmupCount{
             std::numeric_limits<size_t>::max()};
+    /// Number of vbuckets whose persisted bloom filter was loaded
+    std::atomic<size_t> bloomFiltersLoaded{0};
+    /// Number of vbuckets loaded from their HashTable image
+    std::atomic<size_t> residentImagesLoaded{0};
 
     /// All of the cookies which need notifying when create-vbuckets is done
     std::deque<const void*> pendingCookies;
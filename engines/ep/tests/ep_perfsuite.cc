@@ -41,9 +41,12 @@
 #include <platform/platform_time.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cmath>
 #include <condition_variable>
 #include <fstream>
+#include <functional>
 #include <iterator>
 #include <mutex>
 #include <numeric>
@@ -325,6 +328,35 @@ void output_result(const std::string& name,
         break;
     }
 }
+// Print (or record for cbnt) the throughput, in operations per second.
+static void output_throughput(const std::string& name, double opsPerSec) {
+    std::string new_name = name;
+    std::replace(new_name.begin(), new_name.end(), ' ', '_');
+
+    switch (testHarness->output_format) {
+    case OutputFormat::Text:
+        printf("Throughput [%s]: %.0f ops/s\n\n", name.c_str(), opsPerSec);
+        break;
+
+    case OutputFormat::XML: {
+        std::string classname = "ep-perfsuite";
+        if (testHarness->bucket_type != "") {
+            classname += "-" + testHarness->bucket_type;
+        }
+        std::ofstream file(testHarness->output_file_prefix + new_name +
+                           "_throughput.xml");
+        file << "<testsuites>\n"
+             << "  <testsuite name=\"" << classname << "\">\n"
+             << "    <testcase name=\"" << new_name
+             << ".throughput\" time=\"" << opsPerSec << "\" classname=\""
+             << classname << "\"/>\n"
+             << "  </testsuite>\n"
+             << "</testsuites>\n";
+        break;
+    }
+    }
+}
+
 /* Add a sentinel document (one with a the key SENTINEL_KEY).
  * This can be used by DCP streams to reliably detect the end of
  * a run (sequence numbers are only supported by DCP, and
@@ -1553,6 +1585,387 @@ static enum test_result perf_slow_stat_latency_100vb_sets_and_dcp(
             100);
 }
 
+/*
+ * Configurable (YCSB-style) workload engine.
+ *
+ * A workload first loads numKeys documents, evicts enough of them to reach
+ * the target resident ratio (so reads of evicted documents trigger
+ * BgFetches), optionally starts a DCP consumer, and then performs numOps
+ * operations picked according to the operation mix, with keys selected
+ * from the given key distribution. The latency of every operation is
+ * recorded per operation type, together with the overall throughput.
+ */
+
+enum class KeyDistribution {
+    // All keys are equally likely
+    Uniform,
+    // A few (low numbered) keys are much more popular than the rest
+    Zipfian,
+    // The most recently inserted keys are the most popular
+    Latest
+};
+
+/*
+ * Generates integers in the range [0, n) following a Zipfian distribution,
+ * using the algorithm from "Quickly Generating Billion-Record Synthetic
+ * Databases" (Gray et al) as used by YCSB.
+ */
+class ZipfianDistribution {
+public:
+    explicit ZipfianDistribution(size_t n, double theta = 0.99)
+        : n(n),
+          theta(theta),
+          alpha(1.0 / (1.0 - theta)),
+          zetan(zeta(n, theta)),
+          eta((1.0 - std::pow(2.0 / n, 1.0 - theta)) /
+              (1.0 - zeta(2, theta) / zetan)) {
+    }
+
+    template <class Generator>
+    size_t operator()(Generator& g) {
+        const double u = std::uniform_real_distribution<>(0.0, 1.0)(g);
+        const double uz = u * zetan;
+        if (uz < 1.0) {
+            return 0;
+        }
+        if (uz < 1.0 + std::pow(0.5, theta)) {
+            return 1;
+        }
+        const auto ret = size_t(n * std::pow(eta * u - eta + 1.0, alpha));
+        return std::min(ret, n - 1);
+    }
+
+private:
+    static double zeta(size_t n, double theta) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(double(i + 1), theta);
+        }
+        return sum;
+    }
+
+    const size_t n;
+    const double theta;
+    const double alpha;
+    const double zetan;
+    const double eta;
+};
+
+struct WorkloadSpec {
+    std::string name;
+    size_t numKeys;
+    size_t numOps;
+    KeyDistribution keyDistribution;
+    // Operation mix (in percent); the remaining operations are Gets.
+    // Inserts create new keys, RMW operations read a document and write it
+    // back with CAS (the engine side of a sub-document mutation).
+    int setPercent;
+    int insertPercent;
+    int rmwPercent;
+    // Percentage of writes which set an expiry time of ttl seconds.
+    int ttlPercent;
+    uint32_t ttl;
+    // Value sizes are uniformly distributed over [minValueSize, maxValueSize]
+    size_t minValueSize;
+    size_t maxValueSize;
+    // Run a DCP consumer on vbucket 0 alongside the front-end operations
+    bool dcp;
+    // Percentage of the loaded documents which remain resident in memory
+    int residentRatio;
+};
+
+enum class WorkloadOp { Get, Set, Insert, Rmw };
+
+static std::string workload_key(size_t i) {
+    return "key" + std::to_string(i);
+}
+
+/*
+ * Evict every document which the filter selects. Bypasses evict_key() as
+ * that checks the eviction stats for every key.
+ */
+static void evict_keys(EngineIface* h,
+                       size_t numKeys,
+                       std::function<bool(size_t)> filter) {
+    for (size_t i = 0; i < numKeys; ++i) {
+        if (!filter(i)) {
+            continue;
+        }
+        const auto key = workload_key(i);
+        auto pkt = createPacket(cb::mcbp::ClientOpcode::EvictKey,
+                                Vbid(0),
+                                0,
+                                {},
+                                {key.data(), key.size()});
+        checkeq(ENGINE_SUCCESS,
+                h->unknown_command(nullptr, *pkt, add_response),
+                "Failed to perform CMD_EVICT_KEY.");
+        checkeq(cb::mcbp::Status::Success,
+                last_status.load(),
+                "Failed to evict key");
+    }
+}
+
+static enum test_result perf_workload(EngineIface* h,
+                                      const WorkloadSpec& spec) {
+    const void* cookie = testHarness->create_cookie();
+    // Fixed seed so every run performs the same sequence of operations.
+    std::mt19937_64 gen(spec.numKeys);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<size_t> valueSize(spec.minValueSize,
+                                                    spec.maxValueSize);
+    const std::string data(spec.maxValueSize, 'x');
+
+    // Load the initial documents.
+    for (size_t i = 0; i < spec.numKeys; ++i) {
+        const auto key = workload_key(i);
+        checkeq(cb::engine_errc::success,
+                storeCasVb11(h,
+                             cookie,
+                             OPERATION_SET,
+                             key.c_str(),
+                             data.data(),
+                             valueSize(gen),
+                             0,
+                             0,
+                             Vbid(0),
+                             0)
+                        .first,
+                "Failed to load a value");
+    }
+
+    if (isPersistentBucket(h)) {
+        wait_for_flusher_to_settle(h);
+        if (spec.residentRatio < 100) {
+            // Documents must be clean (persisted) before they can be
+            // evicted.
+            std::uniform_int_distribution<int> resident(0, 99);
+            evict_keys(h, spec.numKeys, [&](size_t) {
+                return resident(gen) >= spec.residentRatio;
+            });
+        }
+    }
+
+    std::vector<hrtime_t> ignored_send_times;
+    std::vector<size_t> ignored_send_bytes;
+    std::thread dcp_thread;
+    if (spec.dcp) {
+        // The consumer streams everything until it sees the sentinel.
+        dcp_thread = std::thread{perf_dcp_client,
+                                 h,
+                                 0,
+                                 "DCP",
+                                 /*opaque*/ 0x1,
+                                 Vbid(0),
+                                 /*compressed*/ false,
+                                 std::ref(ignored_send_times),
+                                 std::ref(ignored_send_bytes)};
+    }
+
+    std::array<std::vector<hrtime_t>, 4> timings;
+    for (auto& t : timings) {
+        t.reserve(spec.numOps);
+    }
+
+    ZipfianDistribution zipf(spec.numKeys);
+    size_t numInserted = spec.numKeys;
+    auto nextKey = [&]() -> size_t {
+        switch (spec.keyDistribution) {
+        case KeyDistribution::Uniform:
+            return std::uniform_int_distribution<size_t>(0, numInserted - 1)(
+                    gen);
+        case KeyDistribution::Zipfian:
+            return zipf(gen);
+        case KeyDistribution::Latest:
+            return numInserted - 1 - std::min(zipf(gen), numInserted - 1);
+        }
+        throw std::logic_error("nextKey: unknown key distribution");
+    };
+
+    auto write = [&](const std::string& key,
+                     ENGINE_STORE_OPERATION op,
+                     uint64_t cas) {
+        const uint32_t exp = percent(gen) < spec.ttlPercent ? spec.ttl : 0;
+        return storeCasVb11(h,
+                            cookie,
+                            op,
+                            key.c_str(),
+                            data.data(),
+                            valueSize(gen),
+                            0,
+                            cas,
+                            Vbid(0),
+                            exp)
+                .first;
+    };
+
+    const auto runStart = std::chrono::steady_clock::now();
+    for (size_t ii = 0; ii < spec.numOps; ++ii) {
+        auto op = WorkloadOp::Get;
+        const int p = percent(gen);
+        if (p < spec.setPercent) {
+            op = WorkloadOp::Set;
+        } else if (p < spec.setPercent + spec.insertPercent) {
+            op = WorkloadOp::Insert;
+        } else if (p < spec.setPercent + spec.insertPercent +
+                               spec.rmwPercent) {
+            op = WorkloadOp::Rmw;
+        }
+
+        const auto key = workload_key(op == WorkloadOp::Insert ? numInserted++
+                                                               : nextKey());
+        const auto start = std::chrono::steady_clock::now();
+        switch (op) {
+        case WorkloadOp::Get: {
+            // Documents with a TTL may have expired
+            auto ret = get(h, cookie, key, Vbid(0));
+            check(ret.first == cb::engine_errc::success ||
+                          ret.first == cb::engine_errc::no_such_key,
+                  "Failed to get a value");
+            break;
+        }
+        case WorkloadOp::Set:
+            checkeq(cb::engine_errc::success,
+                    write(key, OPERATION_SET, 0),
+                    "Failed to set a value");
+            break;
+        case WorkloadOp::Insert:
+            checkeq(cb::engine_errc::success,
+                    write(key, OPERATION_ADD, 0),
+                    "Failed to insert a value");
+            break;
+        case WorkloadOp::Rmw: {
+            auto ret = get(h, cookie, key, Vbid(0));
+            uint64_t cas = 0;
+            if (ret.first == cb::engine_errc::success) {
+                item_info info;
+                check(h->get_item_info(ret.second.get(), &info),
+                      "Failed to get item info");
+                cas = info.cas;
+            } else {
+                checkeq(cb::engine_errc::no_such_key,
+                        ret.first,
+                        "Failed to read a value to modify");
+            }
+            // The document may have expired since it was read
+            const auto status =
+                    write(key, cas ? OPERATION_CAS : OPERATION_SET, cas);
+            check(status == cb::engine_errc::success ||
+                          status == cb::engine_errc::no_such_key,
+                  "Failed to write back a modified value");
+            break;
+        }
+        }
+        const auto end = std::chrono::steady_clock::now();
+        timings[int(op)].push_back((end - start).count());
+    }
+    const auto runEnd = std::chrono::steady_clock::now();
+
+    if (spec.dcp) {
+        add_sentinel_doc(h, Vbid(0));
+        dcp_thread.join();
+    }
+    testHarness->destroy_cookie(cookie);
+
+    const std::array<const char*, 4> opNames = {
+            {"Get", "Set", "Insert", "RMW"}};
+    std::vector<std::pair<std::string, std::vector<hrtime_t>*>> all_timings;
+    for (size_t ii = 0; ii < timings.size(); ++ii) {
+        if (!timings[ii].empty()) {
+            all_timings.emplace_back(opNames[ii], &timings[ii]);
+        }
+    }
+
+    const auto seconds =
+            std::chrono::duration<double>(runEnd - runStart).count();
+    const auto throughput = spec.numOps / seconds;
+    std::string description("Latency [" + spec.name + "] - " +
+                            std::to_string(spec.numOps) + " ops, " +
+                            std::to_string(int(throughput)) + " ops/s (µs)");
+    output_result(spec.name, description, all_timings, "µs");
+    output_throughput(spec.name, throughput);
+    return SUCCESS;
+}
+
+/* YCSB workload A: update heavy (50/50 reads and updates), zipfian keys */
+static enum test_result perf_workload_a(EngineIface* h) {
+    return perf_workload(h,
+                         {"Workload A (update heavy)",
+                          ITERATIONS / 10,
+                          ITERATIONS,
+                          KeyDistribution::Zipfian,
+                          /*set*/ 50,
+                          /*insert*/ 0,
+                          /*rmw*/ 0,
+                          /*ttl*/ 0,
+                          0,
+                          /*value size*/ 100,
+                          1000,
+                          /*dcp*/ false,
+                          /*resident*/ 100});
+}
+
+/*
+ * YCSB workload B: read mostly (95/5 reads and updates), zipfian keys, with
+ * half of the documents evicted so reads regularly BgFetch.
+ */
+static enum test_result perf_workload_b_half_resident(EngineIface* h) {
+    return perf_workload(h,
+                         {"Workload B (read mostly, 50% resident)",
+                          ITERATIONS / 10,
+                          ITERATIONS,
+                          KeyDistribution::Zipfian,
+                          /*set*/ 5,
+                          /*insert*/ 0,
+                          /*rmw*/ 0,
+                          /*ttl*/ 0,
+                          0,
+                          /*value size*/ 100,
+                          1000,
+                          /*dcp*/ false,
+                          /*resident*/ 50});
+}
+
+/* YCSB workload D: read latest (95/5 reads and inserts) */
+static enum test_result perf_workload_d(EngineIface* h) {
+    return perf_workload(h,
+                         {"Workload D (read latest)",
+                          ITERATIONS / 10,
+                          ITERATIONS,
+                          KeyDistribution::Latest,
+                          /*set*/ 0,
+                          /*insert*/ 5,
+                          /*rmw*/ 0,
+                          /*ttl*/ 0,
+                          0,
+                          /*value size*/ 100,
+                          1000,
+                          /*dcp*/ false,
+                          /*resident*/ 100});
+}
+
+/*
+ * Approximation of a production workload: zipfian and read heavy with a
+ * tail of sets, inserts and read-modify-writes, some of them with a short
+ * TTL, a DCP consumer and 80% of the documents resident.
+ */
+static enum test_result perf_workload_production_mix(EngineIface* h) {
+    return perf_workload(h,
+                         {"Production mix (DCP, TTL, 80% resident)",
+                          ITERATIONS / 10,
+                          ITERATIONS,
+                          KeyDistribution::Zipfian,
+                          /*set*/ 10,
+                          /*insert*/ 2,
+                          /*rmw*/ 3,
+                          /*ttl*/ 20,
+                          1,
+                          /*value size*/ 64,
+                          4096,
+                          /*dcp*/ true,
+                          /*resident*/ 80});
+}
+
 /*****************************************************************************
  * List of testcases
  *****************************************************************************/
@@ -1679,6 +2092,34 @@ BaseTestCase testsuite_testcases[] = {
                  prepare,
                  cleanup),
 
+        TestCase("YCSB workload A", perf_workload_a,
+                 test_setup, teardown,
+                 "backend=couchdb;ht_size=393209",
+                 prepare, cleanup),
+
+        TestCase("YCSB workload B, 50% resident",
+                 perf_workload_b_half_resident,
+                 test_setup, teardown,
+                 "backend=couchdb;ht_size=393209",
+                 prepare, cleanup),
+
+        TestCase("YCSB workload B, 50% resident, full eviction",
+                 perf_workload_b_half_resident,
+                 test_setup, teardown,
+                 "backend=couchdb;ht_size=393209"
+                 ";item_eviction_policy=full_eviction",
+                 prepare, cleanup),
+
+        TestCase("YCSB workload D", perf_workload_d,
+                 test_setup, teardown,
+                 "backend=couchdb;ht_size=393209",
+                 prepare, cleanup),
+
+        TestCase("Production workload mix", perf_workload_production_mix,
+                 test_setup, teardown,
+                 "backend=couchdb;ht_size=393209",
+                 prepare, cleanup),
+
         TestCase(NULL, NULL, NULL, NULL,
                  "backend=couchdb", prepare, cleanup)
 };
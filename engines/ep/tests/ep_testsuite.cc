@@ -6559,6 +6559,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "ro_0:failure_open",
                 "ro_0:io_compaction_read_bytes",
                 "ro_0:io_compaction_write_bytes",
+                "ro_0:io_page_cache_dropped_bytes",
                 "ro_0:io_bg_fetch_docs_read",
                 "ro_0:io_num_write",
                 "ro_0:io_bg_fetch_doc_bytes",
@@ -6574,6 +6575,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "ro_1:failure_open",
                 "ro_1:io_compaction_read_bytes",
                 "ro_1:io_compaction_write_bytes",
+                "ro_1:io_page_cache_dropped_bytes",
                 "ro_1:io_bg_fetch_docs_read",
                 "ro_1:io_num_write",
                 "ro_1:io_bg_fetch_doc_bytes",
@@ -6589,6 +6591,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "ro_2:failure_open",
                 "ro_2:io_compaction_read_bytes",
                 "ro_2:io_compaction_write_bytes",
+                "ro_2:io_page_cache_dropped_bytes",
                 "ro_2:io_bg_fetch_docs_read",
                 "ro_2:io_num_write",
                 "ro_2:io_bg_fetch_doc_bytes",
@@ -6604,6 +6607,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "ro_3:failure_open",
                 "ro_3:io_compaction_read_bytes",
                 "ro_3:io_compaction_write_bytes",
+                "ro_3:io_page_cache_dropped_bytes",
                 "ro_3:io_bg_fetch_docs_read",
                 "ro_3:io_num_write",
                 "ro_3:io_bg_fetch_doc_bytes",
@@ -6627,6 +6631,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_0:io_total_write_amplification",
                 "rw_0:io_compaction_read_bytes",
                 "rw_0:io_compaction_write_bytes",
+                "rw_0:io_page_cache_dropped_bytes",
                 "rw_0:io_bg_fetch_docs_read",
                 "rw_0:io_num_write",
                 "rw_0:io_bg_fetch_doc_bytes",
@@ -6634,6 +6639,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_0:io_total_write_bytes",
                 "rw_0:io_write_bytes",
                 "rw_0:lastCommDocs",
+                "rw_0:lastCommReqAllocs",
                 "rw_0:numLoadedVb",
                 "rw_0:open",
                 "rw_1:backend_type",
@@ -6648,6 +6654,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_1:io_total_write_amplification",
                 "rw_1:io_compaction_read_bytes",
                 "rw_1:io_compaction_write_bytes",
+                "rw_1:io_page_cache_dropped_bytes",
                 "rw_1:io_bg_fetch_docs_read",
                 "rw_1:io_num_write",
                 "rw_1:io_bg_fetch_doc_bytes",
@@ -6655,6 +6662,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_1:io_total_write_bytes",
                 "rw_1:io_write_bytes",
                 "rw_1:lastCommDocs",
+                "rw_1:lastCommReqAllocs",
                 "rw_1:numLoadedVb",
                 "rw_1:open",
                 "rw_2:backend_type",
@@ -6669,6 +6677,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_2:io_total_write_amplification",
                 "rw_2:io_compaction_read_bytes",
                 "rw_2:io_compaction_write_bytes",
+                "rw_2:io_page_cache_dropped_bytes",
                 "rw_2:io_bg_fetch_docs_read",
                 "rw_2:io_num_write",
                 "rw_2:io_bg_fetch_doc_bytes",
@@ -6676,6 +6685,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_2:io_total_write_bytes",
                 "rw_2:io_write_bytes",
                 "rw_2:lastCommDocs",
+                "rw_2:lastCommReqAllocs",
                 "rw_2:numLoadedVb",
                 "rw_2:open",
                 "rw_3:backend_type",
@@ -6690,6 +6700,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_3:io_total_write_amplification",
                 "rw_3:io_compaction_read_bytes",
                 "rw_3:io_compaction_write_bytes",
+                "rw_3:io_page_cache_dropped_bytes",
                 "rw_3:io_bg_fetch_docs_read",
                 "rw_3:io_num_write",
                 "rw_3:io_bg_fetch_doc_bytes",
@@ -6697,6 +6708,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_3:io_total_write_bytes",
                 "rw_3:io_write_bytes",
                 "rw_3:lastCommDocs",
+                "rw_3:lastCommReqAllocs",
                 "rw_3:numLoadedVb",
                 "rw_3:open"
     };
@@ -6762,10 +6774,16 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "vb_0:ht_item_memory",
               "vb_0:ht_item_memory_uncompressed",
               "vb_0:ht_memory",
+              "vb_0:ht_resize_buckets_remaining",
+              "vb_0:ht_resize_in_progress",
+              "vb_0:ht_resize_max_step_us",
               "vb_0:ht_size",
+              "vb_0:key_directory_items",
+              "vb_0:key_directory_memory",
               "vb_0:logical_clock_ticks",
               "vb_0:max_cas",
               "vb_0:max_cas_str",
+              "vb_0:negative_lookup_cache_items",
               "vb_0:num_ejects",
               "vb_0:num_items",
               "vb_0:num_non_resident",
@@ -6850,43 +6868,57 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
             {"allocator", {"detailed"}},
             {"config",
              {"ep_backend",
+              "ep_alog_write_buffer_size",
               "ep_backfill_mem_threshold",
               "ep_bfilter_enabled",
               "ep_bfilter_fp_prob",
               "ep_bfilter_key_count",
               "ep_bfilter_residency_threshold",
+              "ep_bucket_deletion_free_rate",
               "ep_bucket_type",
               "ep_cache_size",
+              "ep_checkpoint_memory_ratio",
+              "ep_chk_cursor_read_batch_size",
               "ep_chk_expel_enabled",
               "ep_chk_max_items",
+              "ep_chk_max_size",
               "ep_chk_period",
               "ep_chk_remover_stime",
               "ep_collections_enabled",
               "ep_collections_max_size",
               "ep_compaction_exp_mem_threshold",
+              "ep_compaction_io_backoff_sync_write_latency",
+              "ep_compaction_max_bytes_per_sec",
+              "ep_compaction_max_iops",
               "ep_compaction_write_queue_cap",
               "ep_compression_mode",
               "ep_conflict_resolution_type",
               "ep_connection_manager_interval",
               "ep_couch_bucket",
+              "ep_couchstore_block_cache_size",
+              "ep_couchstore_cache_read_handles",
               "ep_cursor_dropping_lower_mark",
+              "ep_cursor_dropping_resume_from_memory",
               "ep_cursor_dropping_upper_mark",
               "ep_cursor_dropping_checkpoint_mem_upper_mark",
               "ep_cursor_dropping_checkpoint_mem_lower_mark",
               "ep_data_traffic_enabled",
               "ep_dbname",
               "ep_dcp_backfill_byte_limit",
+              "ep_dcp_backfill_scan_sharing",
               "ep_dcp_conn_buffer_size",
               "ep_dcp_conn_buffer_size_aggr_mem_threshold",
               "ep_dcp_conn_buffer_size_aggressive_perc",
               "ep_dcp_conn_buffer_size_max",
               "ep_dcp_conn_buffer_size_perc",
+              "ep_dcp_consumer_processor_tasks",
               "ep_dcp_enable_noop",
               "ep_dcp_flow_control_policy",
               "ep_dcp_min_compression_ratio",
               "ep_dcp_idle_timeout",
               "ep_dcp_noop_mandatory_for_v5_features",
               "ep_dcp_noop_tx_interval",
+              "ep_dcp_producer_checkpoint_processor_tasks",
               "ep_dcp_producer_snapshot_marker_yield_limit",
               "ep_dcp_consumer_process_buffered_messages_yield_limit",
               "ep_dcp_consumer_process_buffered_messages_batch_size",
@@ -6897,32 +6929,53 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_defragmenter_chunk_duration",
               "ep_defragmenter_enabled",
               "ep_defragmenter_interval",
+              "ep_defragmenter_sparse_class_threshold",
               "ep_defragmenter_stored_value_age_threshold",
+              "ep_durability_group_commit_window",
+              "ep_durability_seqno_ack_coalesce_count",
+              "ep_durability_seqno_ack_coalesce_window",
               "ep_durability_timeout_task_interval",
+              "ep_ephemeral_metadata_purge_tasks",
               "ep_exp_pager_enabled",
+              "ep_exp_pager_index_enabled",
+              "ep_exp_pager_index_full_scan_interval",
               "ep_exp_pager_initial_run_time",
               "ep_exp_pager_stime",
               "ep_failpartialwarmup",
               "ep_flusher_batch_split_trigger",
+              "ep_flusher_step_time_limit",
+              "ep_flusher_vbstate_persist_delay",
               "ep_fsync_after_every_n_bytes_written",
               "ep_couchstore_tracing",
               "ep_couchstore_write_validation",
               "ep_couchstore_mprotect",
+              "ep_get_all_keys_max_response_bytes",
               "ep_getl_default_timeout",
               "ep_getl_max_timeout",
               "ep_hlc_drift_ahead_threshold_us",
               "ep_hlc_drift_behind_threshold_us",
+              "ep_ht_bucket_layout",
+              "ep_ht_huge_pages",
               "ep_ht_locks",
+              "ep_ht_per_core_stats",
               "ep_ht_resize_interval",
+              "ep_ht_resize_mode",
+              "ep_ht_resize_step_buckets",
               "ep_ht_size",
               "ep_item_compressor_chunk_duration",
+              "ep_item_compressor_concurrency",
+              "ep_item_compressor_freq_counter_threshold",
               "ep_item_compressor_interval",
+              "ep_item_compressor_sample_interval",
               "ep_item_eviction_age_percentage",
               "ep_item_eviction_freq_counter_age_threshold",
+              "ep_item_eviction_sample_size",
               "ep_item_freq_decayer_chunk_duration",
               "ep_item_freq_decayer_percent",
               "ep_item_num_based_new_chk",
               "ep_keep_closed_chks",
+              "ep_key_directory_enabled",
+              "ep_lock_profiler_sample_rate",
               "ep_magma_commit_point_every_batch",
               "ep_magma_commit_point_interval",
               "ep_magma_delete_frag_ratio",
@@ -6943,6 +6996,8 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_max_failover_entries",
               "ep_max_item_privileged_bytes",
               "ep_max_item_size",
+              "ep_max_num_bgfetchers",
+              "ep_max_num_flushers",
               "ep_max_num_shards",
               "ep_max_num_workers",
               "ep_max_size",
@@ -6952,16 +7007,27 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_mem_high_wat",
               "ep_mem_low_wat",
               "ep_mem_used_merge_threshold_percent",
+              "ep_memory_arena",
               "ep_min_compression_ratio",
               "ep_mutation_mem_threshold",
+              "ep_negative_lookup_cache_size",
               "ep_num_auxio_threads",
               "ep_num_nonio_threads",
               "ep_num_reader_threads",
+              "ep_num_reader_threads_reserved_for_bg_fetch",
               "ep_num_writer_threads",
               "ep_pager_active_vb_pcnt",
+              "ep_pager_concurrent_visitors",
+              "ep_pager_predictive_eviction",
+              "ep_pager_predictive_horizon_ms",
               "ep_pager_sleep_time_ms",
+              "ep_random_key_max_sample_size",
+              "ep_replication_throttle_adaptive",
               "ep_replication_throttle_cap_pcnt",
+              "ep_replication_throttle_max_rate",
+              "ep_replication_throttle_min_rate",
               "ep_replication_throttle_queue_cap",
+              "ep_replication_throttle_target_headroom",
               "ep_replication_throttle_threshold",
               "ep_retain_erroneous_tombstones",
               "ep_rocksdb_options",
@@ -6978,12 +7044,18 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_rocksdb_write_rate_limit",
               "ep_rocksdb_uc_max_size_amplification_percent",
               "ep_scopes_max_size",
+              "ep_stats_cache_max_age_ms",
+              "ep_stored_value_inline_value_size",
+              "ep_stored_value_slab_allocator",
               "ep_sync_writes_max_allowed_replicas",
               "ep_time_synchronization",
               "ep_uuid",
+              "ep_vbucket_deletion_max_concurrent",
+              "ep_vbucket_deletion_truncate_size",
               "ep_warmup_batch_size",
               "ep_warmup_min_items_threshold",
               "ep_warmup_min_memory_threshold",
+              "ep_warmup_resident_image",
               "ep_xattr_enabled"}},
             {"workload",
              {"ep_workload:num_readers",
@@ -6994,6 +7066,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_workload:max_writers",
               "ep_workload:max_auxio",
               "ep_workload:max_nonio",
+              "ep_workload:max_background_readers",
               "ep_workload:num_shards",
               "ep_workload:ready_tasks",
               "ep_workload:num_sleepers",
@@ -7035,6 +7108,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_active_datatype_xattr",
               "ep_active_hlc_drift",
               "ep_active_hlc_drift_count",
+              "ep_alog_write_buffer_size",
               "ep_backend",
               "ep_backfill_mem_threshold",
               "ep_bfilter_enabled",
@@ -7048,11 +7122,15 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_bg_remaining_jobs",
               "ep_blob_num",
               "ep_blob_overhead",
+              "ep_bucket_deletion_free_rate",
               "ep_bucket_priority",
               "ep_bucket_type",
               "ep_cache_size",
+              "ep_checkpoint_memory_ratio",
+              "ep_chk_cursor_read_batch_size",
               "ep_chk_expel_enabled",
               "ep_chk_max_items",
+              "ep_chk_max_size",
               "ep_chk_period",
               "ep_chk_persistence_remains",
               "ep_chk_remover_stime",
@@ -7060,13 +7138,22 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_collections_enabled",
               "ep_collections_max_size",
               "ep_compaction_exp_mem_threshold",
+              "ep_compaction_io_backoff_sync_write_latency",
+              "ep_compaction_io_backoffs",
+              "ep_compaction_io_throttle_time",
+              "ep_compaction_io_throttled",
+              "ep_compaction_max_bytes_per_sec",
+              "ep_compaction_max_iops",
               "ep_compaction_write_queue_cap",
               "ep_compression_mode",
               "ep_conflict_resolution_type",
               "ep_connection_manager_interval",
               "ep_couch_bucket",
+              "ep_couchstore_block_cache_size",
+              "ep_couchstore_cache_read_handles",
               "ep_cursor_dropping_lower_mark",
               "ep_cursor_dropping_lower_threshold",
+              "ep_cursor_dropping_resume_from_memory",
               "ep_cursor_dropping_upper_mark",
               "ep_cursor_dropping_upper_threshold",
               "ep_cursor_dropping_checkpoint_mem_upper_mark",
@@ -7078,6 +7165,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_data_traffic_enabled",
               "ep_dbname",
               "ep_dcp_backfill_byte_limit",
+              "ep_dcp_backfill_scan_sharing",
               "ep_dcp_conn_buffer_size",
               "ep_dcp_conn_buffer_size_aggr_mem_threshold",
               "ep_dcp_conn_buffer_size_aggressive_perc",
@@ -7085,12 +7173,14 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_dcp_conn_buffer_size_perc",
               "ep_dcp_consumer_process_buffered_messages_batch_size",
               "ep_dcp_consumer_process_buffered_messages_yield_limit",
+              "ep_dcp_consumer_processor_tasks",
               "ep_dcp_enable_noop",
               "ep_dcp_flow_control_policy",
               "ep_dcp_idle_timeout",
               "ep_dcp_min_compression_ratio",
               "ep_dcp_noop_mandatory_for_v5_features",
               "ep_dcp_noop_tx_interval",
+              "ep_dcp_producer_checkpoint_processor_tasks",
               "ep_dcp_producer_snapshot_marker_yield_limit",
               "ep_dcp_scan_byte_limit",
               "ep_dcp_scan_item_limit",
@@ -7100,7 +7190,9 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_defragmenter_enabled",
               "ep_defragmenter_interval",
               "ep_defragmenter_num_moved",
+              "ep_defragmenter_num_skipped",
               "ep_defragmenter_num_visited",
+              "ep_defragmenter_sparse_class_threshold",
               "ep_defragmenter_stored_value_age_threshold",
               "ep_defragmenter_sv_num_moved",
               "ep_degraded_mode",
@@ -7109,8 +7201,14 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_diskqueue_items",
               "ep_diskqueue_memory",
               "ep_diskqueue_pending",
+              "ep_durability_group_commit_window",
+              "ep_durability_seqno_ack_coalesce_count",
+              "ep_durability_seqno_ack_coalesce_window",
               "ep_durability_timeout_task_interval",
+              "ep_ephemeral_metadata_purge_tasks",
               "ep_exp_pager_enabled",
+              "ep_exp_pager_index_enabled",
+              "ep_exp_pager_index_full_scan_interval",
               "ep_exp_pager_initial_run_time",
               "ep_exp_pager_stime",
               "ep_expired_access",
@@ -7121,28 +7219,44 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_flush_all",
               "ep_flush_duration_total",
               "ep_flusher_batch_split_trigger",
+              "ep_flusher_step_time_limit",
+              "ep_flusher_vbstate_persist_delay",
               "ep_fsync_after_every_n_bytes_written",
               "ep_couchstore_tracing",
               "ep_couchstore_write_validation",
               "ep_couchstore_mprotect",
+              "ep_get_all_keys_max_response_bytes",
               "ep_getl_default_timeout",
               "ep_getl_max_timeout",
               "ep_hlc_drift_ahead_threshold_us",
               "ep_hlc_drift_behind_threshold_us",
+              "ep_ht_bucket_layout",
+              "ep_ht_huge_page_memory",
+              "ep_ht_huge_pages",
               "ep_ht_locks",
+              "ep_ht_per_core_stats",
               "ep_ht_resize_interval",
+              "ep_ht_resize_mode",
+              "ep_ht_resize_step_buckets",
               "ep_ht_size",
               "ep_io_bg_fetch_read_count",
               "ep_io_compaction_read_bytes",
               "ep_io_compaction_write_bytes",
               "ep_io_total_read_bytes",
               "ep_io_total_write_bytes",
+              "ep_item_compressor_bytes_saved",
               "ep_item_compressor_chunk_duration",
+              "ep_item_compressor_concurrency",
+              "ep_item_compressor_freq_counter_threshold",
               "ep_item_compressor_interval",
               "ep_item_compressor_num_compressed",
+              "ep_item_compressor_num_hot",
+              "ep_item_compressor_num_skipped",
               "ep_item_compressor_num_visited",
+              "ep_item_compressor_sample_interval",
               "ep_item_eviction_age_percentage",
               "ep_item_eviction_freq_counter_age_threshold",
+              "ep_item_eviction_sample_size",
               "ep_item_freq_decayer_chunk_duration",
               "ep_item_freq_decayer_percent",
               "ep_item_num",
@@ -7150,11 +7264,16 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_items_expelled_from_checkpoints",
               "ep_items_rm_from_checkpoints",
               "ep_keep_closed_chks",
+              "ep_key_directory_enabled",
+              "ep_key_directory_hits",
               "ep_kv_size",
+              "ep_lock_profiler_sample_rate",
               "ep_max_checkpoints",
               "ep_max_failover_entries",
               "ep_max_item_privileged_bytes",
               "ep_max_item_size",
+              "ep_max_num_bgfetchers",
+              "ep_max_num_flushers",
               "ep_max_num_shards",
               "ep_max_num_workers",
               "ep_max_size",
@@ -7167,6 +7286,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_mem_low_wat_percent",
               "ep_mem_tracker_enabled",
               "ep_mem_used_merge_threshold_percent",
+              "ep_memory_arena",
               "ep_meta_data_disk",
               "ep_checkpoint_memory",
               "ep_checkpoint_memory_overhead",
@@ -7174,10 +7294,13 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_meta_data_memory",
               "ep_min_compression_ratio",
               "ep_mutation_mem_threshold",
+              "ep_negative_lookup_cache_hits",
+              "ep_negative_lookup_cache_size",
               "ep_num_access_scanner_runs",
               "ep_num_access_scanner_skips",
               "ep_num_auxio_threads",
               "ep_num_eject_failures",
+              "ep_num_expiry_pager_full_scans",
               "ep_num_expiry_pager_runs",
               "ep_num_freq_decayer_runs",
               "ep_num_non_resident",
@@ -7191,8 +7314,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_num_ops_set_meta",
               "ep_num_ops_set_meta_res_fail",
               "ep_num_ops_set_ret_meta",
+              "ep_num_pager_predictive_runs",
               "ep_num_pager_runs",
               "ep_num_reader_threads",
+              "ep_num_reader_threads_reserved_for_bg_fetch",
+              "ep_num_stale_replica_reads",
               "ep_num_value_ejects",
               "ep_num_workers",
               "ep_num_writer_threads",
@@ -7215,14 +7341,19 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_oom_errors",
               "ep_overhead",
               "ep_pager_active_vb_pcnt",
+              "ep_pager_concurrent_visitors",
+              "ep_pager_predictive_eviction",
+              "ep_pager_predictive_horizon_ms",
               "ep_pager_sleep_time_ms",
               "ep_pending_compactions",
               "ep_pending_ops",
               "ep_pending_ops_max",
               "ep_pending_ops_max_duration",
               "ep_pending_ops_total",
+              "ep_persist_vbstate_deferred",
               "ep_persist_vbstate_total",
               "ep_queue_size",
+              "ep_random_key_max_sample_size",
               "ep_replica_ahead_exceptions",
               "ep_replica_behind_exceptions",
               "ep_replica_datatype_json",
@@ -7235,8 +7366,13 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_replica_datatype_xattr",
               "ep_replica_hlc_drift",
               "ep_replica_hlc_drift_count",
+              "ep_replication_throttle_adaptive",
               "ep_replication_throttle_cap_pcnt",
+              "ep_replication_throttle_max_rate",
+              "ep_replication_throttle_min_rate",
               "ep_replication_throttle_queue_cap",
+              "ep_replication_throttle_rate",
+              "ep_replication_throttle_target_headroom",
               "ep_replication_throttle_threshold",
               "ep_retain_erroneous_tombstones",
               "ep_rocksdb_options",
@@ -7255,12 +7391,19 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_rollback_count",
               "ep_scopes_max_size",
               "ep_startup_time",
+              "ep_stats_cache_max_age_ms",
               "ep_storage_age",
               "ep_storage_age_highwat",
+              "ep_stored_value_inline_value_size",
+              "ep_stored_value_slab_allocator",
               "ep_storedval_num",
               "ep_storedval_overhead",
               "ep_storedval_size",
+              "ep_storedval_slab_free_size",
+              "ep_storedval_slab_size",
               "ep_sync_writes_max_allowed_replicas",
+              "ep_tasks_cpu_time_ns",
+              "ep_tasks_runtime_ns",
               "ep_time_synchronization",
               "ep_tmp_oom_errors",
               "ep_total_cache_size",
@@ -7273,9 +7416,12 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_vb_total",
               "ep_vbucket_del",
               "ep_vbucket_del_fail",
+              "ep_vbucket_deletion_max_concurrent",
+              "ep_vbucket_deletion_truncate_size",
               "ep_warmup_batch_size",
               "ep_warmup_min_items_threshold",
               "ep_warmup_min_memory_threshold",
+              "ep_warmup_resident_image",
               "ep_workload_pattern",
               "ep_xattr_enabled",
               "mem_used",
@@ -7635,6 +7781,8 @@ static enum test_result test_mb19687_variable(EngineIface* h) {
                      "ep_storedval_num",
                      "ep_storedval_overhead",
                      "ep_storedval_size",
+                     "ep_storedval_slab_free_size",
+                     "ep_storedval_slab_size",
                      "ep_tmp_oom_errors",
                      "ep_value_size",
                      "mem_used",
@@ -7648,6 +7796,7 @@ static enum test_result test_mb19687_variable(EngineIface* h) {
             {"scheduler", {}},
             {"runtimes", {}},
             {"kvtimings", {}},
+            {"lock-profile", {}},
     };
 
     if (isWarmupEnabled(h)) {
@@ -7658,6 +7807,8 @@ static enum test_result test_mb19687_variable(EngineIface* h) {
                                         "ep_warmup_value_count",
                                         "ep_warmup_dups",
                                         "ep_warmup_oom",
+                                        "ep_warmup_bloom_filters_loaded",
+                                        "ep_warmup_resident_images_loaded",
                                         "ep_warmup_min_memory_threshold",
                                         "ep_warmup_min_item_threshold",
                                         "ep_warmup_estimated_key_count",
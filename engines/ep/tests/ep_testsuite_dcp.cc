@@ -1874,6 +1874,47 @@ static enum test_result test_dcp_consumer_flow_control_aggressive(
     return SUCCESS;
 }
 
+static enum test_result test_dcp_consumer_flow_control_adaptive(
+        EngineIface* h) {
+    set_param(h,
+              cb::mcbp::request::SetParamPayload::Type::Flush,
+              "max_size",
+              "1000000000");
+    checkeq(1000000000, get_int_stat(h, "ep_max_size"), "Incorrect new size.");
+
+    const auto* cookie1 = testHarness->create_cookie();
+    const std::string name("unittest");
+    auto dcp = requireDcpIface(h);
+    checkeq(ENGINE_SUCCESS,
+            dcp->open(cookie1,
+                      /*opaque*/ 0,
+                      /*seqno*/ 0,
+                      /*flags*/ 0,
+                      name,
+                      R"({"consumer_name":"replica1"})"),
+            "Failed dcp consumer open connection.");
+
+    // Until it has been measured, the first connection gets the whole
+    // (5% of the memory quota) cap.
+    const auto prefix("eq_dcpq:" + name + ":");
+    checkeq(50000000,
+            get_int_stat(h, (prefix + "max_buffer_bytes").c_str(), "dcp"),
+            "Flow Control Buffer Size not equal to the cap");
+    checkeq(std::string("initial"),
+            get_str_stat(
+                    h, (prefix + "max_buffer_bytes_reason").c_str(), "dcp"),
+            "Unexpected reason for the Flow Control Buffer Size");
+    checkeq(0,
+            get_int_stat(h, (prefix + "drain_rate").c_str(), "dcp"),
+            "Expected no drain rate to have been measured");
+    checkeq(0,
+            get_int_stat(h, (prefix + "rtt_us").c_str(), "dcp"),
+            "Expected no RTT to have been measured");
+    testHarness->destroy_cookie(cookie1);
+
+    return SUCCESS;
+}
+
 static enum test_result test_dcp_producer_open(EngineIface* h) {
     const auto* cookie1 = testHarness->create_cookie();
     const std::string name("unittest");
@@ -7829,6 +7870,10 @@ BaseTestCase testsuite_testcases[] = {
                  test_dcp_consumer_flow_control_aggressive,
                  test_setup, teardown, "dcp_flow_control_policy=aggressive",
                  prepare, cleanup),
+        TestCase("test dcp consumer flow control adaptive",
+                 test_dcp_consumer_flow_control_adaptive,
+                 test_setup, teardown, "dcp_flow_control_policy=adaptive",
+                 prepare, cleanup),
         TestCase("test open producer", test_dcp_producer_open,
                  test_setup, teardown, nullptr, prepare, cleanup),
         TestCase("test open producer same cookie", test_dcp_producer_open_same_cookie,
@@ -1552,6 +1552,73 @@ static enum test_result test_set_with_meta_race_with_delete(EngineIface* h) {
     return SUCCESS;
 }
 
+static enum test_result test_set_with_meta_multi(EngineIface* h) {
+    // An existing document, newer than the first one in the batch
+    ItemMetaData existingMeta(0xdeadbeef, 10, 0, 0);
+    checkeq(ENGINE_SUCCESS,
+            set_with_meta(h, "key1", 4, "value", 5, Vbid(0), &existingMeta, 0),
+            "Expected set with meta to succeed");
+    wait_for_flusher_to_settle(h);
+    evict_key(h, "key1", Vbid(0), "Ejected.");
+
+    std::string value;
+    auto addEntry = [&value](const std::string& key, uint64_t revSeqno) {
+        cb::mcbp::request::SetWithMetaMultiEntry entry;
+        entry.setVBucket(Vbid(0));
+        entry.setKeylen(uint16_t(key.size()));
+        entry.setValuelen(5);
+        entry.getMeta().setCas(0xdeadbeef + revSeqno);
+        entry.getMeta().setSeqno(revSeqno);
+        const auto header = entry.getBuffer();
+        value.append(reinterpret_cast<const char*>(header.data()),
+                     header.size());
+        value.append(key);
+        value.append("value");
+    };
+    addEntry("key1", 5); // loses the conflict resolution
+    addEntry("key2", 1); // a new document
+
+    const void* cookie = testHarness->create_cookie();
+    auto request = createPacket(cb::mcbp::ClientOpcode::SetWithMetaMulti,
+                                Vbid(0),
+                                0,
+                                {},
+                                {},
+                                {value.data(), value.size()});
+    checkeq(ENGINE_SUCCESS,
+            h->unknown_command(cookie, *request, add_response),
+            "Expected SetWithMetaMulti to succeed");
+    testHarness->destroy_cookie(cookie);
+    checkeq(cb::mcbp::Status::Success,
+            last_status.load(),
+            "Expected SetWithMetaMulti to succeed");
+    checkeq(size_t(20), last_body.size(), "Expected two results");
+
+    auto getStatus = [](size_t index) {
+        uint16_t status;
+        memcpy(&status, last_body.data() + index * 10, sizeof(status));
+        return cb::mcbp::Status(ntohs(status));
+    };
+    checkeq(cb::mcbp::Status::KeyEexists,
+            getStatus(0),
+            "Expected the first entry to lose the conflict resolution");
+    checkeq(cb::mcbp::Status::Success,
+            getStatus(1),
+            "Expected the second entry to be stored");
+    checkeq(2, get_int_stat(h, "ep_num_ops_set_meta"), "Expect two ops");
+
+    cb::EngineErrorMetadataPair errorMetaPair;
+    check(get_meta(h, "key1", errorMetaPair), "Expected to get meta");
+    checkeq(uint64_t(10),
+            uint64_t(errorMetaPair.second.seqno),
+            "Expected key1 to be unchanged");
+    check(get_meta(h, "key2", errorMetaPair), "Expected to get meta");
+    checkeq(uint64_t(1),
+            uint64_t(errorMetaPair.second.seqno),
+            "Expected key2 to be stored with the given metadata");
+    return SUCCESS;
+}
+
 static enum test_result test_set_with_meta_xattr(EngineIface* h) {
     const char* key = "set_with_meta_xattr_key";
 
@@ -3314,6 +3381,13 @@ BaseTestCase testsuite_testcases[] = {
                  NULL,
                  prepare,
                  cleanup),
+        TestCase("set_with_meta_multi",
+                 test_set_with_meta_multi,
+                 test_setup,
+                 teardown,
+                 NULL,
+                 prepare_ep_bucket,
+                 cleanup),
         TestCase("test set_with_meta exp persisted",
                  test_exp_persisted_set_del,
                  test_setup,
@@ -165,6 +165,12 @@ public:
                                    uint64_t prepared_seqno,
                                    uint64_t abort_seqno));
 
+    MOCK_METHOD4(seqno_advanced,
+                 ENGINE_ERROR_CODE(uint32_t opaque,
+                                   Vbid vbucket,
+                                   uint64_t seqno,
+                                   cb::mcbp::DcpStreamId sid));
+
     // Current version of GMock doesn't support move-only types (e.g.
     // std::unique_ptr) for mocked function arguments. Workaround directly
     // implementing the affected methods (without GMock) and have them delegate
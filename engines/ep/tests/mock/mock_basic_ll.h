@@ -23,6 +23,7 @@
 
 #include "linked_list.h"
 
+#include <boost/optional.hpp>
 #include <mutex>
 #include <vector>
 
@@ -45,19 +46,26 @@ public:
         return allSeqnos;
     }
 
-    /// Expose the rangeReadLock for testing.
-    std::mutex& getRangeReadLock() {
-        return rangeReadLock;
-    }
-
     /* Register fake read range for testing */
     void registerFakeReadRange(seqno_t start, seqno_t end) {
         std::lock_guard<SpinLock> lh(rangeLock);
-        readRange = SeqRange(start, end);
+        if (fakeRange) {
+            **fakeRange = SeqRange(start, end);
+        } else {
+            fakeRange = readRanges.insert(readRanges.end(),
+                                           SeqRange(start, end));
+        }
     }
 
     void resetReadRange() {
         std::lock_guard<SpinLock> lh(rangeLock);
-        readRange.reset();
+        if (fakeRange) {
+            readRanges.erase(*fakeRange);
+            fakeRange.reset();
+        }
     }
+
+private:
+    /* The range registered by registerFakeReadRange(), if any */
+    boost::optional<ReadRanges::iterator> fakeRange;
 };
@@ -125,6 +125,22 @@ ENGINE_ERROR_CODE MockDcpMessageProducers::stream_end(
     return ENGINE_SUCCESS;
 }
 
+ENGINE_ERROR_CODE MockDcpMessageProducers::seqno_advanced(
+        uint32_t opaque,
+        Vbid vbucket,
+        uint64_t seqno,
+        cb::mcbp::DcpStreamId sid) {
+    clear_dcp_data();
+    last_op = cb::mcbp::ClientOpcode::DcpSeqnoAdvanced;
+    last_opaque = opaque;
+    last_vbucket = vbucket;
+    last_byseqno = seqno;
+    last_packet_size = 32;
+    last_stream_id = sid;
+
+    return ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE MockDcpMessageProducers::marker(
         uint32_t opaque,
         Vbid vbucket,
@@ -152,6 +152,11 @@ public:
         return ENGINE_ENOTSUP;
     }
 
+    ENGINE_ERROR_CODE seqno_advanced(uint32_t opaque,
+                                     Vbid vbucket,
+                                     uint64_t seqno,
+                                     cb::mcbp::DcpStreamId sid) override;
+
     void clear_dcp_data();
 
     cb::mcbp::ClientOpcode last_op;
@@ -108,10 +108,13 @@ std::shared_ptr<Stream> MockDcpProducer::findStream(Vbid vbid) {
 }
 
 ActiveStreamCheckpointProcessorTask*
-MockDcpProducer::getCheckpointSnapshotTask() const {
+MockDcpProducer::getCheckpointSnapshotTask(size_t shard) const {
     LockHolder guard(checkpointCreator->mutex);
+    if (shard >= checkpointCreator->tasks.size()) {
+        return nullptr;
+    }
     return static_cast<ActiveStreamCheckpointProcessorTask*>(
-            checkpointCreator->task.get());
+            checkpointCreator->tasks[shard].get());
 }
 
 std::pair<std::shared_ptr<Stream>, bool> MockDcpProducer::findStream(
@@ -89,21 +89,23 @@ public:
     }
 
     /**
-     * Create the ActiveStreamCheckpointProcessorTask and assign to
-     * checkpointCreator->task
+     * Create the ActiveStreamCheckpointProcessorTasks and assign to
+     * checkpointCreator->tasks
      */
     void createCheckpointProcessorTask() {
         DcpProducer::createCheckpointProcessorTask();
     }
 
     /**
-     * Schedule the checkpointCreator->task on the ExecutorPool
+     * Schedule the checkpointCreator->tasks on the ExecutorPool
      */
     void scheduleCheckpointProcessorTask() {
         DcpProducer::scheduleCheckpointProcessorTask();
     }
 
-    ActiveStreamCheckpointProcessorTask* getCheckpointSnapshotTask() const;
+    /// @return the checkpoint processor task of the given shard (or null).
+    ActiveStreamCheckpointProcessorTask* getCheckpointSnapshotTask(
+            size_t shard = 0) const;
 
     /**
      * Finds the stream for a given vbucket
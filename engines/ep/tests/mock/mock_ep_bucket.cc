@@ -85,5 +85,5 @@ void MockEPBucket::setDurabilityCompletionTask(
 }
 
 Flusher* MockEPBucket::getFlusherNonConst(Vbid vbid) {
-    return vbMap.getShardByVbId(vbid)->getFlusher();
+    return getFlusher(vbid);
 }
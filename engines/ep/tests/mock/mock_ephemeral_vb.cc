@@ -15,6 +15,7 @@ MockEphemeralVBucket::MockEphemeralVBucket(
         std::unique_ptr<FailoverTable> table,
         NewSeqnoCallback newSeqnoCb,
         SyncWriteResolvedCallback syncWriteResolvedCb,
+        SyncWriteTimeoutCallback syncWriteTimeoutCb,
         SyncWriteCompleteCallback syncWriteCb,
         SeqnoAckCallback seqnoAckCb,
         Configuration& config,
@@ -30,6 +31,7 @@ MockEphemeralVBucket::MockEphemeralVBucket(
                        std::move(table),
                        std::move(newSeqnoCb),
                        syncWriteResolvedCb,
+                       syncWriteTimeoutCb,
                        syncWriteCb,
                        seqnoAckCb,
                        config,
@@ -53,6 +55,15 @@ size_t MockEphemeralVBucket::markOldTombstonesStale(rel_time_t purgeAge) {
     return purger.getNumItemsMarkedStale();
 }
 
+size_t MockEphemeralVBucket::markOldIndexedTombstonesStale(
+        rel_time_t purgeAge) {
+    HTTombstonePurger purger(purgeAge);
+    purger.setCurrentVBucket(*this);
+    purger.visitTombstoneIndex();
+
+    return purger.getNumItemsMarkedStale();
+}
+
 void MockEphemeralVBucket::public_doCollectionsStats(
         const Collections::VB::Manifest::CachingReadHandle& cHandle,
         const VBNotifyCtx& notifyCtx) {
@@ -40,6 +40,7 @@ public:
                          std::unique_ptr<FailoverTable> table,
                          NewSeqnoCallback newSeqnoCb,
                          SyncWriteResolvedCallback syncWriteResolvedCb,
+                         SyncWriteTimeoutCallback syncWriteTimeoutCb,
                          SyncWriteCompleteCallback syncWriteCb,
                          SeqnoAckCallback seqnoAckCb,
                          Configuration& config,
@@ -82,6 +83,13 @@ public:
      */
     size_t markOldTombstonesStale(rel_time_t purgeAge);
 
+    /**
+     * As markOldTombstonesStale, but finds the tombstones via the
+     * VBucket's tombstone index (as the purger task does) instead of visiting
+     * the HashTable.
+     */
+    size_t markOldIndexedTombstonesStale(rel_time_t purgeAge);
+
     void public_doCollectionsStats(
             const Collections::VB::Manifest::CachingReadHandle& cHandle,
             const VBNotifyCtx& notifyCtx);
@@ -683,7 +683,7 @@ TEST_F(BasicLinkedListTest, RangeIteratorUpdateItemDuringRead) {
 }
 
 /* Creates 2 range iterators such that iterator2 is created after iterator1
-   has read all items, and has hence released the rangeReadLock, but before
+   has read all items, and has hence released its read range, but before
    iterator1 is deleted */
 TEST_F(BasicLinkedListTest, MultipleRangeIterator_MB24474) {
     const int numItems = 3;
@@ -729,25 +729,64 @@ TEST_F(BasicLinkedListTest, NonBlockingRangeIterators) {
     std::vector<seqno_t> expectedSeqno =
             addNewItemsToList(1, keyPrefix, numItems);
 
-    {
-        auto itr1 = getRangeIterator();
-        auto itr2 = basicLL->makeRangeIterator(true /*isBackfill*/);
-        /* itr1 is already using the list, we cannot have another iterator */
-        EXPECT_FALSE(itr2);
+    /* itr1 is already using the list; another iterator can still be created
+       and both read all the items */
+    auto itr1 = getRangeIterator();
+    auto itr2 = getRangeIterator();
 
-        /* itr1 goes out of scope and releases the read lock on the list */
+    std::vector<seqno_t> actualSeqno1;
+    std::vector<seqno_t> actualSeqno2;
+    while (itr1.curr() != itr1.end()) {
+        actualSeqno1.push_back((*itr1).getBySeqno());
+        ++itr1;
+        if (itr2.curr() != itr2.end()) {
+            actualSeqno2.push_back((*itr2).getBySeqno());
+            ++itr2;
+        }
     }
+    EXPECT_EQ(expectedSeqno, actualSeqno1);
+    EXPECT_EQ(expectedSeqno, actualSeqno2);
+}
 
-    /* Iterator created now, should be able to read all items */
-    auto itr = getRangeIterator();
-    std::vector<seqno_t> actualSeqno;
+/* A stale version is kept while any range iterator can still reach it, and
+   reclaimed as soon as all of them have moved past it */
+TEST_F(BasicLinkedListTest, StaleVersionReclaimedByRangeIterators) {
+    const int numItems = 3;
+    const std::string keyPrefix("key");
 
-    /* Read all the items with the iterator */
-    while (itr.curr() != itr.end()) {
-        actualSeqno.push_back((*itr).getBySeqno());
-        ++itr;
+    /* Add 3 items */
+    std::vector<seqno_t> expectedSeqno =
+            addNewItemsToList(1, keyPrefix, numItems);
+
+    /* itr1 is past the first item, itr2 is still on it */
+    auto itr1 = getRangeIterator();
+    ++itr1;
+    auto itr2 = getRangeIterator();
+    std::vector<seqno_t> actualSeqno2;
+    actualSeqno2.push_back((*itr2).getBySeqno());
+
+    /* Update the first item; itr2 is reading it so a new version is
+       appended */
+    updateItemDuringRangeRead(numItems, keyPrefix + std::to_string(1));
+    EXPECT_EQ(1, basicLL->getNumStaleItems());
+
+    ++itr2;
+
+    /* itr1 completes; no iterator can reach the stale version any more */
+    while (itr1.curr() != itr1.end()) {
+        ++itr1;
     }
-    EXPECT_EQ(expectedSeqno, actualSeqno);
+    EXPECT_EQ(0, basicLL->getNumStaleItems());
+    EXPECT_EQ(0, basicLL->getStaleValueBytes());
+    std::vector<seqno_t> expectedListSeqno = {2, 3, 4};
+    EXPECT_EQ(expectedListSeqno, basicLL->getAllSeqnoForVerification());
+
+    /* itr2 still reads its snapshot */
+    while (itr2.curr() != itr2.end()) {
+        actualSeqno2.push_back((*itr2).getBySeqno());
+        ++itr2;
+    }
+    EXPECT_EQ(expectedSeqno, actualSeqno2);
 }
 
 TEST_F(BasicLinkedListTest, RangeReadStopsOnInvalidSeqno) {
@@ -14,7 +14,7 @@
  *   limitations under the License.
  */
 
-#include <unordered_set>
+#include <bitset>
 
 #include <folly/portability/GTest.h>
 
@@ -38,22 +38,30 @@ TEST_P(BloomFilterDocKeyTest, check_hashing) {
     if (std::get<0>(GetParam()) != std::get<1>(GetParam())) {
         auto key1 = StoredDocKey("key", std::get<0>(GetParam()));
         auto key2 = StoredDocKey("key", std::get<1>(GetParam()));
-        std::unordered_set<uint64_t> key1_hashes;
-        std::unordered_set<uint64_t> key2_hashes;
+        EXPECT_NE(hashDocKey(key1), hashDocKey(key2));
+        EXPECT_NE(getMask(hashDocKey(key1)), getMask(hashDocKey(key2)));
+    }
+}
+
+// All of a key's bits are set in one (cache line aligned) block.
+TEST_P(BloomFilterDocKeyTest, check_keyInOneBlock) {
+    auto key = StoredDocKey("key", std::get<0>(GetParam()));
+    addKey(key);
 
-        // Always insert the first two hashes then check every subsequent hash
-        // has no match in the set.
-        key1_hashes.insert(hashDocKey(key1, 0));
-        key2_hashes.insert(hashDocKey(key2, 0));
-        for (size_t i = 1; i < noOfHashes; i++)  {
-            EXPECT_EQ(0, key1_hashes.count(hashDocKey(key1, i)));
-            EXPECT_EQ(0, key2_hashes.count(hashDocKey(key1, i)));
-            EXPECT_EQ(0, key1_hashes.count(hashDocKey(key2, i)));
-            EXPECT_EQ(0, key2_hashes.count(hashDocKey(key2, i)));
-            key1_hashes.insert(hashDocKey(key1, i));
-            key2_hashes.insert(hashDocKey(key2, i));
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(blocks) % (blockBits / 8));
+    size_t blocksUsed = 0;
+    size_t bitsSet = 0;
+    for (size_t b = 0; b < noOfBlocks; b++) {
+        size_t bits = 0;
+        for (size_t w = 0; w < wordsPerBlock; w++) {
+            bits += std::bitset<64>(blocks[b * wordsPerBlock + w]).count();
         }
+        blocksUsed += bits ? 1 : 0;
+        bitsSet += bits;
     }
+    EXPECT_EQ(1, blocksUsed);
+    EXPECT_LE(bitsSet, noOfHashes);
+    EXPECT_GT(bitsSet, 0);
 }
 
 TEST_P(BloomFilterDocKeyTest, check_addKey) {
@@ -80,6 +88,44 @@ TEST_P(BloomFilterDocKeyTest, check_maybeKeyExist) {
     }
 }
 
+// Blocking the filter costs a little accuracy; check it stays close to the
+// requested false positive probability.
+TEST(BloomFilterTest, falsePositiveRate) {
+    const size_t keys = 10000;
+    BloomFilter filter(keys, 0.01, BFILTER_ENABLED);
+    for (size_t i = 0; i < keys; i++) {
+        filter.addKey(makeStoredDocKey("key_" + std::to_string(i)));
+    }
+    size_t falsePositives = 0;
+    for (size_t i = 0; i < keys; i++) {
+        EXPECT_TRUE(filter.maybeKeyExists(
+                makeStoredDocKey("key_" + std::to_string(i))));
+        if (filter.maybeKeyExists(
+                    makeStoredDocKey("other_" + std::to_string(i)))) {
+            falsePositives++;
+        }
+    }
+    EXPECT_LT(falsePositives, keys / 50);
+}
+
+TEST(BloomFilterTest, serialise) {
+    BloomFilter filter(1000, 0.01, BFILTER_ENABLED);
+    filter.addKey(makeStoredDocKey("key"));
+
+    const auto data = filter.serialise();
+    auto loaded = BloomFilter::deserialise(data);
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(BFILTER_ENABLED, loaded->getStatus());
+    EXPECT_EQ(filter.getFilterSize(), loaded->getFilterSize());
+    EXPECT_EQ(1, loaded->getNumOfKeysInFilter());
+    EXPECT_TRUE(loaded->maybeKeyExists(makeStoredDocKey("key")));
+    EXPECT_EQ(data, loaded->serialise());
+
+    // Truncated or empty data is rejected.
+    EXPECT_FALSE(BloomFilter::deserialise({data.data(), data.size() - 1}));
+    EXPECT_FALSE(BloomFilter::deserialise({}));
+}
+
 // Test params includes our labelled collections that have 'special meaning' and
 // one normal collection ID (100)
 static std::vector<CollectionID> allDocNamespaces = {
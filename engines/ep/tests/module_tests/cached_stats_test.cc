@@ -0,0 +1,82 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "cached_stats.h"
+
+#include <folly/portability/GTest.h>
+
+#include <map>
+#include <thread>
+
+class CachedStatsTest : public ::testing::Test {
+protected:
+    void addStats(std::chrono::milliseconds maxAge) {
+        output.clear();
+        cache.addStats(maxAge,
+                       this,
+                       [this](const char* key,
+                              const uint16_t klen,
+                              const char* val,
+                              const uint32_t vlen,
+                              gsl::not_null<const void*> cookie) {
+                           EXPECT_EQ(this, cookie.get());
+                           output[std::string(key, klen)] =
+                                   std::string(val, vlen);
+                       },
+                       [this](const AddStatFn& addStat) {
+                           ++generated;
+                           const auto value = std::to_string(generated);
+                           addStat("key",
+                                   3,
+                                   value.data(),
+                                   uint32_t(value.size()),
+                                   this);
+                       });
+    }
+
+    CachedStats cache;
+    int generated = 0;
+    std::map<std::string, std::string> output;
+};
+
+// With no max age every request generates the stats.
+TEST_F(CachedStatsTest, Disabled) {
+    addStats(std::chrono::milliseconds(0));
+    addStats(std::chrono::milliseconds(0));
+    EXPECT_EQ(2, generated);
+    EXPECT_EQ("2", output["key"]);
+}
+
+TEST_F(CachedStatsTest, Cached) {
+    addStats(std::chrono::hours(1));
+    EXPECT_EQ("1", output["key"]);
+    addStats(std::chrono::hours(1));
+    EXPECT_EQ(1, generated);
+    EXPECT_EQ("1", output["key"]);
+
+    cache.invalidate();
+    addStats(std::chrono::hours(1));
+    EXPECT_EQ(2, generated);
+    EXPECT_EQ("2", output["key"]);
+}
+
+TEST_F(CachedStatsTest, Expired) {
+    addStats(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    addStats(std::chrono::milliseconds(1));
+    EXPECT_EQ(2, generated);
+}
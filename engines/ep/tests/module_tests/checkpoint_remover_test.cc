@@ -109,19 +109,20 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
     // We should have one checkpoint which is for the state change
     ASSERT_EQ(1, checkpointManager->getNumCheckpoints());
 
-    // The queue (toWrite) is implemented as std:list, therefore
-    // when we add an item it results in the creation of 3 pointers -
-    // forward ptr, backward ptr and ptr to object.
-    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
-
-    // Allocator used for tracking memory used by the CheckpointQueue
-    checkpoint_index::allocator_type memoryTrackingAllocator;
+    // Emulate the Checkpoint toWrite queue so we can determine the number
+    // of bytes that should be allocated during its use (the queue allocates
+    // a chunk at a time, not per item).
+    MemoryTrackingAllocator<queued_item> queueTrackingAllocator;
+    CheckpointQueue toWrite(queueTrackingAllocator);
+
+    // Allocator used for tracking memory used by the keyIndex
+    CheckpointKeyIndex::allocator_type memoryTrackingAllocator;
     // Emulate the Checkpoint metaKeyIndex so we can determine the number
     // of bytes that should be allocated during its use.
     meta_checkpoint_index metaKeyIndex(memoryTrackingAllocator);
     // Emulate the Checkpoint keyIndex so we can determine the number
     // of bytes that should be allocated during its use.
-    checkpoint_index keyIndex(memoryTrackingAllocator);
+    CheckpointKeyIndex keyIndex(memoryTrackingAllocator);
     ChkptQueueIterator iterator =
             CheckpointManagerTestIntrospector::public_getCheckpointList(
                     *checkpointManager)
@@ -136,17 +137,12 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
                  *checkpointManager)) {
         // Add the overhead of the Checkpoint object
         expected_size += sizeof(Checkpoint);
-#ifdef WIN32
-        // On windows for an empty list we still allocate space for
-        // containing one element.
-        expected_size += perElementOverhead;
-#endif
 
         for (auto itr = checkpoint->begin(); itr != checkpoint->end(); ++itr) {
             // Add the size of the item
             expected_size += (*itr)->size();
-            // Add the size of adding to the queue
-            expected_size += perElementOverhead;
+            // Add to the emulated queue
+            toWrite.push_back(*itr);
             // Add to the emulated metaKeyIndex
             metaKeyIndex.emplace((*itr)->getKey(), entry);
         }
@@ -154,7 +150,8 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
 
     const auto metaKeyIndexSize =
             *(metaKeyIndex.get_allocator().getBytesAllocated());
-    ASSERT_EQ(expected_size + metaKeyIndexSize,
+    const auto toWriteSize = *(toWrite.get_allocator().getBytesAllocated());
+    ASSERT_EQ(expected_size + metaKeyIndexSize + toWriteSize,
               checkpointManager->getMemoryUsage());
 
     // Check that the new checkpoint memory usage is equal to the previous
@@ -163,21 +160,20 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
     size_t new_expected_size = expected_size;
     // Add the size of the item
     new_expected_size += item.size();
-    // Add the size of adding to the queue
-    new_expected_size += perElementOverhead;
+    // Add to the emulated queue
+    toWrite.push_back(queued_item(new Item(item)));
     // Add to the keyIndex
-    keyIndex.emplace(
-            CheckpointIndexKey(item.getKey(),
-                               item.isCommitted()
-                                       ? CheckpointIndexKeyNamespace::Committed
-                                       : CheckpointIndexKeyNamespace::Prepared),
-            entry);
+    keyIndex.insert(item.getKey(),
+                    item.isCommitted() ? CheckpointIndexKeyNamespace::Committed
+                                       : CheckpointIndexKeyNamespace::Prepared,
+                    entry);
 
     // As the metaKeyIndex and keyIndex share the same allocator, retrieving
     // the bytes allocated for the keyIndex, will also include the bytes
     // allocated for the metaKeyIndex.
     size_t keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
-    ASSERT_EQ(new_expected_size + keyIndexSize,
+    ASSERT_EQ(new_expected_size + keyIndexSize +
+                      *(toWrite.get_allocator().getBytesAllocated()),
               checkpointManager->getMemoryUsage());
 }
 
@@ -254,20 +250,24 @@ TEST_F(CheckpointRemoverEPTest, CursorDropMemoryFreed) {
 
     createDcpStream(*producer);
 
-    // The queue (toWrite) is implemented as std:list, therefore
-    // when we add an item it results in the creation of 3 pointers -
-    // forward ptr, backward ptr and ptr to object.
-    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
+    // Emulate the Checkpoint toWrite queue so we can determine the number
+    // of bytes that should be allocated during its use (the queue allocates
+    // a chunk at a time, not per item).
+    MemoryTrackingAllocator<queued_item> queueTrackingAllocator;
+    CheckpointQueue toWrite(queueTrackingAllocator);
 
-    // Allocator used for tracking memory used by the CheckpointQueue
-    checkpoint_index::allocator_type memoryTrackingAllocator;
     // Emulate the Checkpoint keyIndex so we can determine the number
     // of bytes that should be allocated during its use.
-    checkpoint_index keyIndex(memoryTrackingAllocator);
+    CheckpointKeyIndex::allocator_type keyIndexTrackingAllocator;
+    CheckpointKeyIndex keyIndex(keyIndexTrackingAllocator);
     // Grab the initial size of the keyIndex because on Windows an empty
     // std::unordered_map allocated 200 bytes.
     const auto initialKeyIndexSize =
             *(keyIndex.get_allocator().getBytesAllocated());
+    // Emulate the Checkpoint metaKeyIndex, which includes the meta items
+    // already in the checkpoint.
+    CheckpointKeyIndex::allocator_type metaKeyIndexTrackingAllocator;
+    meta_checkpoint_index metaKeyIndex(metaKeyIndexTrackingAllocator);
     ChkptQueueIterator iterator =
             CheckpointManagerTestIntrospector::public_getCheckpointList(
                     *checkpointManager)
@@ -275,27 +275,36 @@ TEST_F(CheckpointRemoverEPTest, CursorDropMemoryFreed) {
                     ->begin();
     index_entry entry{iterator, 0};
 
+    // The queue allocation for the items already in the checkpoint is
+    // included in initialSize.
+    const auto& checkpoint =
+            *CheckpointManagerTestIntrospector::public_getCheckpointList(
+                     *checkpointManager)
+                     .front();
+    for (auto itr = checkpoint.begin(); itr != checkpoint.end(); ++itr) {
+        toWrite.push_back(*itr);
+        if ((*itr)->getKey().size() > 0) {
+            metaKeyIndex.emplace((*itr)->getKey(), entry);
+        }
+    }
+    const auto initialToWriteSize =
+            *(toWrite.get_allocator().getBytesAllocated());
+    const auto initialMetaKeyIndexSize =
+            *(metaKeyIndex.get_allocator().getBytesAllocated());
+
     auto expectedFreedMemoryFromItems = initialSize;
-    // The initial setVBucketState is a meta item and will be dropped when we
-    // drop the first checkpoint. It is slightly smaller than an item enqueued
-    // in the keyIndex as it does not include the CheckpointIndexKeyNamespace
-    // the CheckpointIndexKeyNamespace ends up generating 3 bytes of padding,
-    // which is also removed here
-    expectedFreedMemoryFromItems -= (sizeof(CheckpointIndexKeyNamespace) + 3);
     for (size_t i = 0; i < getMaxCheckpointItems(*vb); i++) {
         std::string doc_key = "key_" + std::to_string(i);
         Item item = store_item(vbid, makeStoredDocKey(doc_key), "value");
         expectedFreedMemoryFromItems += item.size();
-        // Add the size of adding to the queue
-        expectedFreedMemoryFromItems += perElementOverhead;
+        // Add to the emulated queue
+        toWrite.push_back(queued_item(new Item(item)));
         // Add to the emulated keyIndex
-        keyIndex.emplace(
-                CheckpointIndexKey(
-                        item.getKey(),
+        keyIndex.insert(item.getKey(),
                         item.isCommitted()
                                 ? CheckpointIndexKeyNamespace::Committed
-                                : CheckpointIndexKeyNamespace::Prepared),
-                entry);
+                                : CheckpointIndexKeyNamespace::Prepared,
+                        entry);
     }
 
     ASSERT_EQ(1, checkpointManager->getNumCheckpoints());
@@ -319,25 +328,22 @@ TEST_F(CheckpointRemoverEPTest, CursorDropMemoryFreed) {
     // Needed to calculate the size of a checkpoint_end queued_item
     StoredDocKey key("checkpoint_end", CollectionID::System);
     queued_item chkptEnd(new Item(key, vbid, queue_op::checkpoint_end, 0, 0));
-    // checkpoint_end is a meta item and has slightly smaller size than an item
-    // enqueued in the keyIndex as it does not include the
-    // CheckpointIndexKeyNamespace
-    expectedFreedMemoryFromItems -= (sizeof(CheckpointIndexKeyNamespace) + 3);
 
     // Add the size of the checkpoint end
     expectedFreedMemoryFromItems += chkptEnd->size();
-    // Add the size of adding to the queue
-    expectedFreedMemoryFromItems += perElementOverhead;
-    // Add to the emulated keyIndex
-    keyIndex.emplace(
-            CheckpointIndexKey(chkptEnd->getKey(),
-                               chkptEnd->isCommitted()
-                                       ? CheckpointIndexKeyNamespace::Committed
-                                       : CheckpointIndexKeyNamespace::Prepared),
-            entry);
+    // Add to the emulated queue
+    toWrite.push_back(chkptEnd);
+    // Add to the emulated metaKeyIndex
+    metaKeyIndex.emplace(chkptEnd->getKey(), entry);
 
     const auto keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
     expectedFreedMemoryFromItems += (keyIndexSize - initialKeyIndexSize);
+    expectedFreedMemoryFromItems +=
+            (*(metaKeyIndex.get_allocator().getBytesAllocated()) -
+             initialMetaKeyIndexSize);
+    expectedFreedMemoryFromItems +=
+            (*(toWrite.get_allocator().getBytesAllocated()) -
+             initialToWriteSize);
 
     // Manually handle the slow stream, this is the same logic as the checkpoint
     // remover task uses, just without the overhead of setting up the task
@@ -66,6 +66,7 @@ CheckpointTest<V>::CheckpointTest()
                     callback,
                     /*newSeqnoCb*/ nullptr,
                     SyncWriteResolvedCallback{},
+                    SyncWriteTimeoutCallback{},
                     NoopSyncWriteCompleteCb,
                     NoopSeqnoAckCb,
                     config,
@@ -243,6 +244,7 @@ TYPED_TEST(CheckpointTest, basic_chk_test) {
                           cb,
                           /*newSeqnoCb*/ nullptr,
                           SyncWriteResolvedCallback{},
+                          SyncWriteTimeoutCallback{},
                           NoopSyncWriteCompleteCb,
                           NoopSeqnoAckCb,
                           this->config,
@@ -447,6 +449,25 @@ TYPED_TEST(CheckpointTest, Delete) {
 }
 
 
+// Test de-duplication against a keyIndex holding enough keys to have been
+// resized (and probed past colliding entries) multiple times.
+TYPED_TEST(CheckpointTest, DedupeManyKeys) {
+    const int numKeys = 300;
+    for (int ii = 0; ii < numKeys; ++ii) {
+        EXPECT_TRUE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+    ASSERT_EQ(1, this->manager->getNumCheckpoints());
+    EXPECT_EQ(numKeys, this->manager->getNumOpenChkItems());
+
+    // Re-queue every key (in reverse); each should replace the existing item
+    for (int ii = numKeys - 1; ii >= 0; --ii) {
+        EXPECT_FALSE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+    EXPECT_EQ(1, this->manager->getNumCheckpoints());
+    EXPECT_EQ(numKeys, this->manager->getNumOpenChkItems());
+    EXPECT_EQ(numKeys, this->manager->getNumItemsForPersistence());
+}
+
 // Test with one open and one closed checkpoint.
 TYPED_TEST(CheckpointTest, OneOpenOneClosed) {
     // Add some items to the initial (open) checkpoint.
@@ -646,6 +667,33 @@ TYPED_TEST(CheckpointTest, ItemBasedCheckpointCreation) {
     EXPECT_EQ(1, this->manager->getNumOpenChkItems()); // 1x op_set
 }
 
+// Test the automatic creation of checkpoints based on the memory used by the
+// open checkpoint.
+TYPED_TEST(CheckpointTest, MemoryBasedCheckpointCreation) {
+    // A budget smaller than any item, so every (non-empty) open checkpoint
+    // exceeds it.
+    this->checkpoint_config.setCheckpointMaxSize(1);
+    this->createManager();
+
+    EXPECT_TRUE(this->queueNewItem("key0"));
+    EXPECT_EQ(1, this->manager->getNumCheckpoints());
+    EXPECT_TRUE(this->manager->isOverMemoryBudget());
+
+    // The open checkpoint is over budget - should create a new checkpoint.
+    EXPECT_TRUE(this->queueNewItem("key1"));
+    EXPECT_EQ(2, this->manager->getNumCheckpoints());
+    EXPECT_EQ(1, this->manager->getNumOpenChkItems());
+
+    // max_checkpoints still caps the number of checkpoints.
+    EXPECT_TRUE(this->queueNewItem("key2"));
+    EXPECT_EQ(2, this->manager->getNumCheckpoints());
+    EXPECT_EQ(2, this->manager->getNumOpenChkItems());
+
+    // No budget - never over it.
+    this->checkpoint_config.setCheckpointMaxSize(0);
+    EXPECT_FALSE(this->manager->isOverMemoryBudget());
+}
+
 // Test checkpoint and cursor accounting - when checkpoints are closed the
 // offset of cursors is updated as appropriate.
 TYPED_TEST(CheckpointTest, CursorOffsetOnCheckpointClose) {
@@ -845,6 +893,114 @@ TYPED_TEST(CheckpointTest, ItemsForCheckpointCursorLimited) {
             << "Cursor should have moved into second checkpoint.";
 }
 
+// Test that getItemsForCursor() releases the queueLock between batches of
+// items while reading a closed checkpoint, but not in the open checkpoint.
+TYPED_TEST(CheckpointTest, ItemsForCursorYieldsBetweenBatches) {
+    this->checkpoint_config.setCursorReadBatchSize(4);
+    this->createManager();
+
+    for (int ii = 0; ii < 10; ++ii) {
+        ASSERT_TRUE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+    this->manager->createNewCheckpoint();
+    ASSERT_TRUE(this->queueNewItem("open"));
+
+    // Front-end writes can proceed while the closed checkpoint is read.
+    int yields = 0;
+    this->manager->cursorReadYieldHook = [this, &yields]() {
+        EXPECT_TRUE(this->queueNewItem("new" + std::to_string(yields++)));
+    };
+
+    std::vector<queued_item> items;
+    auto result = this->manager->getNextItemsForPersistence(items);
+    this->manager->cursorReadYieldHook = {};
+
+    // checkpoint_start, 10 items and checkpoint_end: 3 batches.
+    EXPECT_EQ(3, yields);
+    EXPECT_FALSE(result.moreAvailable);
+    ASSERT_EQ(2, result.ranges.size());
+    EXPECT_EQ(1010, result.ranges.front().getEnd());
+    EXPECT_EQ(1014, result.ranges.back().getEnd());
+    // The open checkpoint is read after the writes made while yielding:
+    // checkpoint_start, "open" and the 3 new items.
+    ASSERT_EQ(12 + 5, items.size());
+    EXPECT_EQ(1014, items.back()->getBySeqno());
+}
+
+// Test that a key de-duplicated while getItemsForCursor() has released the
+// queueLock is not lost from the snapshot range returned for the open
+// checkpoint.
+TYPED_TEST(CheckpointTest, ItemsForCursorDedupWhileYielding) {
+    this->checkpoint_config.setCursorReadBatchSize(2);
+    this->createManager();
+
+    ASSERT_TRUE(this->queueNewItem("closed"));
+    this->manager->createNewCheckpoint();
+    for (int ii = 0; ii < 10; ++ii) {
+        ASSERT_TRUE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+
+    // Update an unread key of the open checkpoint every time the lock is
+    // released; its previous mutation is removed from the checkpoint.
+    int yields = 0;
+    this->manager->cursorReadYieldHook = [this, &yields]() {
+        ++yields;
+        EXPECT_FALSE(this->queueNewItem("key5"));
+    };
+
+    std::vector<queued_item> items;
+    auto result = this->manager->getNextItemsForPersistence(items);
+    this->manager->cursorReadYieldHook = {};
+
+    // Only the closed checkpoint (checkpoint_start, "closed" and
+    // checkpoint_end) was read in batches.
+    EXPECT_EQ(1, yields);
+    EXPECT_FALSE(result.moreAvailable);
+    ASSERT_EQ(2, result.ranges.size());
+    const auto end = result.ranges.back().getEnd();
+    EXPECT_EQ(1012, end);
+
+    // Every key is returned once, within the range of its checkpoint.
+    size_t mutations = 0;
+    size_t updated = 0;
+    for (const auto& qi : items) {
+        if (!qi->isCheckPointMetaItem()) {
+            EXPECT_LE(uint64_t(qi->getBySeqno()), end);
+            ++mutations;
+            if (qi->getKey() == makeStoredDocKey("key5")) {
+                EXPECT_EQ(1012, qi->getBySeqno());
+                ++updated;
+            }
+        }
+    }
+    EXPECT_EQ(11, mutations);
+    EXPECT_EQ(1, updated);
+}
+
+// Test that a cursor removed while getItemsForCursor() has released the
+// queueLock is not read any further.
+TYPED_TEST(CheckpointTest, ItemsForCursorRemovedWhileYielding) {
+    this->checkpoint_config.setCursorReadBatchSize(4);
+    this->createManager();
+
+    for (int ii = 0; ii < 10; ++ii) {
+        ASSERT_TRUE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+    this->manager->createNewCheckpoint();
+
+    auto dcpCursor = this->manager->registerCursorBySeqno("dcp", 0);
+    auto cursor = dcpCursor.cursor.lock();
+    this->manager->cursorReadYieldHook = [this, &cursor]() {
+        EXPECT_TRUE(this->manager->removeCursor(cursor.get()));
+    };
+
+    std::vector<queued_item> items;
+    auto result = this->manager->getNextItemsForCursor(cursor.get(), items);
+    EXPECT_FALSE(result.moreAvailable);
+    EXPECT_EQ(4, items.size());
+    EXPECT_EQ(1, this->manager->getNumOfCursors());
+}
+
 // Test the checkpoint cursor movement
 TYPED_TEST(CheckpointTest, CursorMovement) {
     /* We want to have items across 2 checkpoints. Size down the default number
@@ -1554,6 +1710,64 @@ TYPED_TEST(CheckpointTest, DuplicateCheckpointCursorDifferentCheckpoints) {
     EXPECT_EQ(1, ckptList.back()->getNumCursorsInCheckpoint());
 }
 
+// Test that each checkpoint's index of cursors follows the cursors as they
+// are registered, move between checkpoints and are removed.
+TYPED_TEST(CheckpointTest, CheckpointIndexesItsCursors) {
+    this->checkpoint_config = CheckpointConfig(DEFAULT_CHECKPOINT_PERIOD,
+                                               MIN_CHECKPOINT_ITEMS,
+                                               /*numCheckpoints*/ 2,
+                                               /*itemBased*/ true,
+                                               /*keepClosed*/ false,
+                                               /*persistenceEnabled*/ true);
+    this->createManager();
+    auto* ckptMgr = this->manager.get();
+    const auto& ckptList =
+            CheckpointManagerTestIntrospector::public_getCheckpointList(
+                    *ckptMgr);
+
+    auto dcpCursor1 = this->manager->registerCursorBySeqno(
+            DCP_CURSOR_PREFIX + std::to_string(1), 0);
+    auto dcpCursor2 = this->manager->registerCursorBySeqno(
+            DCP_CURSOR_PREFIX + std::to_string(2), 0);
+    auto* cursor1 = dcpCursor1.cursor.lock().get();
+    auto* cursor2 = dcpCursor2.cursor.lock().get();
+
+    // 2 checkpoints, with all 3 cursors in the first.
+    for (int ii = 0; ii < 2 * MIN_CHECKPOINT_ITEMS; ++ii) {
+        this->queueNewItem("key" + std::to_string(ii));
+    }
+    ASSERT_EQ(2, ckptList.size());
+    const auto& first = ckptList.front()->getCursors();
+    const auto& second = ckptList.back()->getCursors();
+    EXPECT_EQ(3, first.size());
+    EXPECT_EQ(1, first.count(cursor1));
+    EXPECT_EQ(1, first.count(cursor2));
+    EXPECT_TRUE(second.empty());
+
+    // The persistence cursor is still in the first checkpoint, so no cursor
+    // can be dropped yet.
+    EXPECT_TRUE(this->manager->getListOfCursorsToDrop().empty());
+
+    // Moving cursors to the open checkpoint moves them in the index.
+    std::vector<queued_item> items;
+    this->manager->getNextItemsForCursor(cursor1, items);
+    this->manager->getNextItemsForPersistence(items);
+    EXPECT_EQ(1, first.size());
+    EXPECT_EQ(1, first.count(cursor2));
+    EXPECT_EQ(2, second.size());
+    EXPECT_EQ(1, second.count(cursor1));
+
+    // Only the cursor left behind in the closed checkpoint can be dropped.
+    auto toDrop = this->manager->getListOfCursorsToDrop();
+    ASSERT_EQ(1, toDrop.size());
+    EXPECT_EQ(cursor2, toDrop.front().lock().get());
+
+    // Removing a cursor removes it from the index.
+    EXPECT_TRUE(this->manager->removeCursor(cursor2));
+    EXPECT_TRUE(first.empty());
+    EXPECT_EQ(2, second.size());
+}
+
 // Test that when adding duplicate queued_items (of the same size) it
 // does not increase the size of the checkpoint.
 TYPED_TEST(CheckpointTest, dedupeMemoryTest) {
@@ -1595,10 +1809,10 @@ TYPED_TEST(CheckpointTest, checkpointMemoryTest) {
     auto initialSize = this->manager->getMemoryUsage();
 
     // Allocator used for tracking memory used by the CheckpointQueue
-    checkpoint_index::allocator_type memoryTrackingAllocator;
+    CheckpointKeyIndex::allocator_type memoryTrackingAllocator;
     // Emulate the Checkpoint keyIndex so we can determine the number
     // of bytes that should be allocated during its use.
-    checkpoint_index keyIndex(memoryTrackingAllocator);
+    CheckpointKeyIndex keyIndex(memoryTrackingAllocator);
     // Grab the initial size of the keyIndex because on Windows an empty
     // std::unordered_map allocated 200 bytes.
     const auto initialKeyIndexSize =
@@ -1629,25 +1843,19 @@ TYPED_TEST(CheckpointTest, checkpointMemoryTest) {
                               GenerateCas::Yes,
                               /*preLinkDocCtx*/ nullptr);
 
-    // The queue (toWrite) is implemented as std:list, therefore
-    // when we add an item it results in the creation of 3 pointers -
-    // forward ptr, backward ptr and ptr to object.
-    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
-
     // Check that checkpoint size is the initial size plus the addition of
-    // qiSmall.
+    // qiSmall. The queue (toWrite) allocates a chunk of items at a time; the
+    // item fits in the chunk already holding the dummy and checkpoint start
+    // items, so adding it to the queue doesn't allocate.
     auto expectedSize = initialSize;
     // Add the size of the item
     expectedSize += qiSmall->size();
-    // Add the size of adding to the queue
-    expectedSize += perElementOverhead;
     // Add to the emulated keyIndex
-    keyIndex.emplace(
-            CheckpointIndexKey(qiSmall->getKey(),
-                               qiSmall->isCommitted()
-                                       ? CheckpointIndexKeyNamespace::Committed
-                                       : CheckpointIndexKeyNamespace::Prepared),
-            entry);
+    keyIndex.insert(qiSmall->getKey(),
+                    qiSmall->isCommitted()
+                            ? CheckpointIndexKeyNamespace::Committed
+                            : CheckpointIndexKeyNamespace::Prepared,
+                    entry);
 
     auto keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
     expectedSize += (keyIndexSize - initialKeyIndexSize);
@@ -1678,15 +1886,7 @@ TYPED_TEST(CheckpointTest, checkpointMemoryTest) {
     expectedSize = initialSize;
     // Add the size of the item
     expectedSize += qiBig->size();
-    // Add the size of adding to the queue
-    expectedSize += perElementOverhead;
-    // Add to the keyIndex
-    keyIndex.emplace(
-            CheckpointIndexKey(qiBig->getKey(),
-                               qiBig->isCommitted()
-                                       ? CheckpointIndexKeyNamespace::Committed
-                                       : CheckpointIndexKeyNamespace::Prepared),
-            entry);
+    // qiBig replaces qiSmall (same key), so the keyIndex is unchanged.
 
     keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
     expectedSize += (keyIndexSize - initialKeyIndexSize);
@@ -1730,10 +1930,10 @@ TYPED_TEST(CheckpointTest, checkpointTrackingMemoryOverheadTest) {
     const auto initialOverhead = this->manager->getMemoryOverhead();
 
     // Allocator used for tracking memory used by the CheckpointQueue
-    checkpoint_index::allocator_type memoryTrackingAllocator;
+    CheckpointKeyIndex::allocator_type memoryTrackingAllocator;
     // Emulate the Checkpoint keyIndex so we can determine the number
     // of bytes that should be allocated during its use.
-    checkpoint_index keyIndex(memoryTrackingAllocator);
+    CheckpointKeyIndex keyIndex(memoryTrackingAllocator);
     // Grab the initial size of the keyIndex because on Windows an empty
     // std::unordered_map allocated 200 bytes.
     const auto initialKeyIndexSize =
@@ -1767,18 +1967,17 @@ TYPED_TEST(CheckpointTest, checkpointTrackingMemoryOverheadTest) {
 
     // Re-measure the checkpoint overhead
     const auto updatedOverhead = this->manager->getMemoryOverhead();
-    // Three pointers - forward, backward and pointer to item
-    const auto perElementListOverhead = sizeof(uintptr_t) * 3;
+    // The item fits in the queue's existing chunk (holding the dummy and
+    // checkpoint start items), so only the keyIndex should grow.
     // Add entry into keyIndex
-    keyIndex.emplace(
-            CheckpointIndexKey(qiSmall->getKey(),
-                               qiSmall->isCommitted()
-                                       ? CheckpointIndexKeyNamespace::Committed
-                                       : CheckpointIndexKeyNamespace::Prepared),
-            entry);
+    keyIndex.insert(qiSmall->getKey(),
+                    qiSmall->isCommitted()
+                            ? CheckpointIndexKeyNamespace::Committed
+                            : CheckpointIndexKeyNamespace::Prepared,
+                    entry);
 
     const auto keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
-    EXPECT_EQ(perElementListOverhead + (keyIndexSize - initialKeyIndexSize),
+    EXPECT_EQ(keyIndexSize - initialKeyIndexSize,
               updatedOverhead - initialOverhead);
 
     bool isLastMutationItem;
@@ -2191,20 +2390,12 @@ TYPED_TEST(CheckpointTest, expelCheckpointItemsMemoryRecoveredTest) {
     // Get the memory usage after expelling
     auto checkpointMemoryUsageAfterExpel = this->manager->getMemoryUsage();
 
-    size_t extra = 0;
-    // A list is comprised of 3 pointers (forward, backwards and
-    // pointer to the element).
-    const size_t perElementOverhead = extra + (3 * sizeof(uintptr_t));
-#if WIN32
-    // On windows for an empty list we still allocate space for
-    // containing one element.
-    extra = perElementOverhead;
-#endif
-
     const size_t reductionInCheckpointMemoryUsage =
             checkpointMemoryUsageBeforeExpel - checkpointMemoryUsageAfterExpel;
-    const size_t checkpointListSaving =
-            (perElementOverhead * expelResult.expelCount);
+    // The queue frees memory a chunk at a time; all of the items fit in a
+    // single chunk which still holds the remaining items.
+    ASSERT_LT(5, CheckpointQueue::chunkSize);
+    const size_t checkpointListSaving = 0;
     const auto& checkpointStartItem =
             this->manager->public_createCheckpointItem(
                     0, Vbid(0), queue_op::checkpoint_start);
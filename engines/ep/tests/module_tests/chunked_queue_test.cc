@@ -0,0 +1,180 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "chunked_queue.h"
+#include "checkpoint_iterator.h"
+
+#include <folly/portability/GTest.h>
+#include <utilities/memory_tracking_allocator.h>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+/*
+ * Unit tests for the ChunkedQueue
+ */
+
+// Use a small chunk size so tests can easily span multiple chunks.
+using Queue = ChunkedQueue<std::shared_ptr<int>,
+                           MemoryTrackingAllocator<std::shared_ptr<int>>,
+                           4>;
+
+class ChunkedQueueTest : public ::testing::Test {
+protected:
+    void fill(int count) {
+        for (int ii = 0; ii < count; ++ii) {
+            queue.push_back(std::make_shared<int>(ii));
+        }
+    }
+
+    std::vector<int> contents() const {
+        std::vector<int> result;
+        for (const auto& e : queue) {
+            result.push_back(*e);
+        }
+        return result;
+    }
+
+    size_t bytesAllocated() const {
+        return *queue.get_allocator().getBytesAllocated();
+    }
+
+    MemoryTrackingAllocator<std::shared_ptr<int>> allocator;
+    Queue queue{allocator};
+};
+
+TEST_F(ChunkedQueueTest, Empty) {
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(0, queue.size());
+    EXPECT_EQ(queue.end(), queue.begin());
+    // Nothing is allocated until an item is added.
+    EXPECT_EQ(0, bytesAllocated());
+}
+
+TEST_F(ChunkedQueueTest, PushBackAllocatesChunks) {
+    fill(4);
+    EXPECT_EQ(1, queue.getNumChunks());
+    EXPECT_EQ(Queue::getChunkAllocationSize(), bytesAllocated());
+
+    fill(1);
+    EXPECT_EQ(2, queue.getNumChunks());
+    EXPECT_EQ(2 * Queue::getChunkAllocationSize(), bytesAllocated());
+    EXPECT_EQ(5, queue.size());
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 0}), contents());
+}
+
+TEST_F(ChunkedQueueTest, IteratorsStableOverPushBack) {
+    fill(3);
+    auto second = std::next(queue.begin());
+    auto end = queue.end();
+    fill(10);
+    EXPECT_EQ(1, **second);
+    EXPECT_EQ(queue.end(), end);
+    // end() can be decremented to the last element.
+    EXPECT_EQ(9, **std::prev(end));
+}
+
+TEST_F(ChunkedQueueTest, EraseMiddle) {
+    fill(10);
+    auto it = std::next(queue.begin(), 5);
+    auto before = std::prev(it);
+    auto after = std::next(it);
+
+    EXPECT_EQ(after, queue.erase(it));
+    EXPECT_EQ(9, queue.size());
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 6, 7, 8, 9}), contents());
+
+    // Neighbouring iterators remain valid and step over the hole.
+    EXPECT_EQ(after, std::next(before));
+    EXPECT_EQ(before, std::prev(after));
+}
+
+TEST_F(ChunkedQueueTest, EraseWholeChunkFreesIt) {
+    fill(12);
+    ASSERT_EQ(3, queue.getNumChunks());
+
+    // Erase all of the middle chunk (elements 4..7).
+    auto it = std::next(queue.begin(), 4);
+    for (int ii = 0; ii < 4; ++ii) {
+        it = queue.erase(it);
+    }
+    EXPECT_EQ(8, **it);
+    EXPECT_EQ(2, queue.getNumChunks());
+    EXPECT_EQ(2 * Queue::getChunkAllocationSize(), bytesAllocated());
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 9, 10, 11}), contents());
+    EXPECT_EQ(3, **std::prev(it));
+}
+
+TEST_F(ChunkedQueueTest, EraseFrontRange) {
+    fill(10);
+    auto keep = std::next(queue.begin(), 6);
+    EXPECT_EQ(keep, queue.erase(queue.begin(), keep));
+    EXPECT_EQ(keep, queue.begin());
+    EXPECT_EQ(4, queue.size());
+    // The first chunk was freed; the second still holds elements 6 & 7.
+    EXPECT_EQ(2, queue.getNumChunks());
+    EXPECT_EQ((std::vector<int>{6, 7, 8, 9}), contents());
+}
+
+TEST_F(ChunkedQueueTest, EraseAllReusesTail) {
+    fill(3);
+    queue.erase(queue.begin(), queue.end());
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.end(), queue.begin());
+    EXPECT_EQ(1, queue.getNumChunks());
+
+    fill(4);
+    EXPECT_EQ(1, queue.getNumChunks());
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), contents());
+}
+
+TEST_F(ChunkedQueueTest, ElementsReleased) {
+    auto value = std::make_shared<int>(1);
+    queue.push_back(value);
+    queue.push_back(value);
+    ASSERT_EQ(3, value.use_count());
+    queue.erase(queue.begin());
+    EXPECT_EQ(2, value.use_count());
+    queue.clear();
+    EXPECT_EQ(1, value.use_count());
+    EXPECT_EQ(0, bytesAllocated());
+}
+
+// The CheckpointIterator should behave the same over a ChunkedQueue as over
+// a std::list, including skipping null elements.
+TEST_F(ChunkedQueueTest, CheckpointIterator) {
+    using Iterator = CheckpointIterator<Queue>;
+    queue.push_back({});
+    fill(2);
+    queue.push_back({});
+    fill(1);
+
+    std::vector<int> seen;
+    for (Iterator it(queue, Iterator::Position::begin);
+         it != Iterator(queue, Iterator::Position::end);
+         ++it) {
+        seen.push_back(**it);
+    }
+    EXPECT_EQ((std::vector<int>{0, 1, 0}), seen);
+
+    Iterator it(queue, Iterator::Position::end);
+    --it;
+    EXPECT_EQ(0, **it);
+    --it;
+    EXPECT_EQ(1, **it);
+}
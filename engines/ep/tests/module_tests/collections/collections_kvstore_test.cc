@@ -17,6 +17,7 @@
 
 #include "checkpoint_config.h"
 #include "checkpoint_manager.h"
+#include "collections/kvstore.h"
 #include "configuration.h"
 #include "ep_vb.h"
 #include "failover-table.h"
@@ -62,6 +63,7 @@ public:
                   std::make_shared<DummyCB>(),
                   /*newSeqnoCb*/ nullptr,
                   SyncWriteResolvedCallback{},
+                  SyncWriteTimeoutCallback{},
                   NoopSyncWriteCompleteCb,
                   NoopSeqnoAckCb,
                   config,
@@ -294,6 +296,52 @@ TEST_P(CollectionsKVStoreTest, add_of_dropped) {
     }
 }
 
+// The stats of all of a vBucket's collections are encoded into one flatbuffer,
+// merging the changed collections' stats with what was already stored.
+TEST(CollectionsKVStoreStatsTest, EncodeMergesStats) {
+    using namespace Collections::KVStore;
+    cb::const_byte_buffer empty;
+    auto first = encodeCollectionsStats(
+            {{CollectionUid::fruit, {10, 20}}, {CollectionUid::meat, {1, 2}}},
+            {},
+            empty);
+    cb::const_byte_buffer firstBuf{first.data(), first.size()};
+
+    // Update meat, add vegetable and drop fruit.
+    auto second = encodeCollectionsStats(
+            {{CollectionUid::meat, {3, 4}}, {CollectionUid::vegetable, {5, 6}}},
+            {{0, 20, CollectionUid::fruit}},
+            firstBuf);
+    cb::const_byte_buffer secondBuf{second.data(), second.size()};
+
+    auto fruit = decodeCollectionStats(firstBuf, CollectionUid::fruit);
+    ASSERT_TRUE(fruit.is_initialized());
+    EXPECT_EQ(10, fruit->itemCount);
+    EXPECT_EQ(20, fruit->highSeqno);
+    EXPECT_FALSE(decodeCollectionStats(secondBuf, CollectionUid::fruit)
+                         .is_initialized());
+
+    auto meat = decodeCollectionStats(secondBuf, CollectionUid::meat);
+    ASSERT_TRUE(meat.is_initialized());
+    EXPECT_EQ(3, meat->itemCount);
+    EXPECT_EQ(4, meat->highSeqno);
+
+    auto vegetable = decodeCollectionStats(secondBuf, CollectionUid::vegetable);
+    ASSERT_TRUE(vegetable.is_initialized());
+    EXPECT_EQ(5, vegetable->itemCount);
+
+    EXPECT_FALSE(
+            decodeCollectionStats(empty, CollectionUid::meat).is_initialized());
+
+    // Re-encoding unchanged stats gives the same bytes.
+    auto third = encodeCollectionsStats(
+            {{CollectionUid::meat, {3, 4}}}, {}, secondBuf);
+    ASSERT_EQ(second.size(), third.size());
+    EXPECT_TRUE(std::equal(second.data(),
+                           second.data() + second.size(),
+                           third.data()));
+}
+
 static std::string kvstoreTestParams[] = {"couchdb"};
 
 INSTANTIATE_TEST_CASE_P(CollectionsKVStoreTests,
@@ -1225,6 +1225,111 @@ TEST_F(CollectionsFilteredDcpTest, filtering) {
     testDcpCreateDelete({CollectionEntry::dairy}, {}, 2, false);
 }
 
+// Backfill of a stream filtered to a single, small collection reads only that
+// collection's keys; check the documents still arrive in seqno order.
+TEST_F(CollectionsFilteredDcpTest, filtering_small_collection_backfill) {
+    CollectionsManifest cm;
+    store->setCollections({cm.add(CollectionEntry::meat)
+                                   .add(CollectionEntry::dairy)
+                                   .remove(CollectionEntry::defaultC)});
+
+    // Store the dairy keys so that key order is the reverse of seqno order,
+    // and enough meat keys that dairy is a small part of the vbucket.
+    const int meatItems = 20;
+    store_item(vbid, StoredDocKey{"dairy:two", CollectionEntry::dairy}, "v");
+    for (int ii = 0; ii < meatItems; ii++) {
+        store_item(vbid,
+                   StoredDocKey{"meat:" + std::to_string(ii),
+                                CollectionEntry::meat},
+                   "value");
+    }
+    store_item(vbid, StoredDocKey{"dairy:one", CollectionEntry::dairy}, "v");
+
+    // 3 system events + meat + 2 dairy
+    flush_vbucket_to_disk(vbid, 3 + meatItems + 2);
+
+    resetEngineAndWarmup();
+
+    createDcpObjects({{R"({"collections":["c"]})"}});
+    notifyAndStepToCheckpoint(cb::mcbp::ClientOpcode::DcpSnapshotMarker,
+                              false /*from disk*/);
+
+    EXPECT_EQ(ENGINE_SUCCESS, producer->step(producers.get()));
+    EXPECT_EQ(cb::mcbp::ClientOpcode::DcpSystemEvent, producers->last_op);
+    EXPECT_EQ(CollectionEntry::dairy.getId(), producers->last_collection_id);
+    uint64_t lastSeqno = producers->last_byseqno;
+
+    for (const auto& key : {"dairy:two", "dairy:one"}) {
+        EXPECT_EQ(ENGINE_SUCCESS, producer->step(producers.get()));
+        EXPECT_EQ(cb::mcbp::ClientOpcode::DcpMutation, producers->last_op);
+        EXPECT_EQ(CollectionEntry::dairy.getId(),
+                  producers->last_collection_id);
+        EXPECT_EQ(key, producers->last_key);
+        EXPECT_LT(lastSeqno, producers->last_byseqno);
+        lastSeqno = producers->last_byseqno;
+    }
+    EXPECT_NE(ENGINE_SUCCESS, producer->step(producers.get()));
+}
+
+// As above, but the client accepts out of sequence order snapshots: the
+// collection's documents arrive in key order, then its system event, and the
+// snapshot is ended by a SeqnoAdvanced for the end of the snapshot.
+TEST_F(CollectionsFilteredDcpTest, filtering_small_collection_key_order) {
+    CollectionsManifest cm;
+    store->setCollections({cm.add(CollectionEntry::meat)
+                                   .add(CollectionEntry::dairy)
+                                   .remove(CollectionEntry::defaultC)});
+
+    const int meatItems = 20;
+    store_item(vbid, StoredDocKey{"dairy:two", CollectionEntry::dairy}, "v");
+    for (int ii = 0; ii < meatItems; ii++) {
+        store_item(vbid,
+                   StoredDocKey{"meat:" + std::to_string(ii),
+                                CollectionEntry::meat},
+                   "value");
+    }
+    store_item(vbid, StoredDocKey{"dairy:one", CollectionEntry::dairy}, "v");
+    // The snapshot ends with an item of another collection
+    store_item(vbid, StoredDocKey{"meat:last", CollectionEntry::meat}, "v");
+
+    // 3 system events + meat + 2 dairy + 1 meat
+    flush_vbucket_to_disk(vbid, 3 + meatItems + 2 + 1);
+    const auto highSeqno = uint64_t(store->getVBucket(vbid)->getHighSeqno());
+
+    resetEngineAndWarmup();
+
+    createDcpConsumer();
+    producer = SingleThreadedKVBucketTest::createDcpProducer(
+            cookieP, IncludeDeleteTime::No);
+    producers->consumer = consumer.get();
+    producers->replicaVB = replicaVB;
+    EXPECT_EQ(ENGINE_SUCCESS,
+              producer->control(0, "enable_out_of_order_snapshots", "true"));
+    createDcpStream({{R"({"collections":["c"]})"}});
+
+    notifyAndStepToCheckpoint(cb::mcbp::ClientOpcode::DcpSnapshotMarker,
+                              false /*from disk*/);
+    EXPECT_EQ(MARKER_FLAG_OSO, producers->last_flags & MARKER_FLAG_OSO);
+    EXPECT_EQ(highSeqno, producers->last_snap_end_seqno);
+
+    for (const auto& key : {"dairy:one", "dairy:two"}) {
+        EXPECT_EQ(ENGINE_SUCCESS, producer->step(producers.get()));
+        EXPECT_EQ(cb::mcbp::ClientOpcode::DcpMutation, producers->last_op);
+        EXPECT_EQ(CollectionEntry::dairy.getId(),
+                  producers->last_collection_id);
+        EXPECT_EQ(key, producers->last_key);
+    }
+
+    EXPECT_EQ(ENGINE_SUCCESS, producer->step(producers.get()));
+    EXPECT_EQ(cb::mcbp::ClientOpcode::DcpSystemEvent, producers->last_op);
+    EXPECT_EQ(CollectionEntry::dairy.getId(), producers->last_collection_id);
+
+    EXPECT_EQ(ENGINE_SUCCESS, producer->step(producers.get()));
+    EXPECT_EQ(cb::mcbp::ClientOpcode::DcpSeqnoAdvanced, producers->last_op);
+    EXPECT_EQ(highSeqno, producers->last_byseqno);
+    EXPECT_NE(ENGINE_SUCCESS, producer->step(producers.get()));
+}
+
 TEST_F(CollectionsFilteredDcpTest, filtering_scope) {
     VBucketPtr vb = store->getVBucket(vbid);
 
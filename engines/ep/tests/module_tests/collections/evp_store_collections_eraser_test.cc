@@ -441,6 +441,39 @@ TEST_P(CollectionsEraserTest, tombstone_cleaner) {
     EXPECT_EQ(0, vb->getNumSystemItems());
 }
 
+// Test that erasing a collection with no data on disk doesn't need couchstore
+// to rewrite the vbucket file
+TEST_P(CollectionsEraserTest, erase_empty_without_compaction) {
+    CollectionsManifest cm(CollectionEntry::dairy);
+    vb->updateFromManifest({cm});
+    flush_vbucket_to_disk(vbid, 1 /* 1 x system */);
+
+    // A document in another collection doesn't need purging
+    store_item(vbid, StoredDocKey{"key", CollectionEntry::defaultC}, "value");
+    flush_vbucket_to_disk(vbid, 1 /* 1 x item */);
+
+    vb->updateFromManifest({cm.remove(CollectionEntry::dairy)});
+    flush_vbucket_to_disk(vbid, 1 /* 1 x system */);
+
+    if (!persistent() ||
+        engine->getConfiguration().getBackend() != "couchdb") {
+        runCollectionsEraser();
+        EXPECT_EQ(1, vb->getNumItems());
+        return;
+    }
+
+    auto* kvstore = store->getRWUnderlying(vbid);
+    const auto pre = kvstore->getDbFileInfo(vbid);
+
+    runCollectionsEraser();
+
+    // A compaction would write a new (smaller) file, the in-place erase only
+    // appends
+    EXPECT_LE(pre.fileSize, kvstore->getDbFileInfo(vbid).fileSize);
+    EXPECT_EQ(1, vb->getNumItems());
+    EXPECT_FALSE(vb->lockCollections().exists(CollectionEntry::dairy));
+}
+
 // Test that a collection erase "resumes" after a restart/warmup
 TEST_P(CollectionsEraserTest, erase_after_warmup) {
     if (!persistent()) {
@@ -53,6 +53,7 @@ public:
              std::make_shared<DummyCB>(),
              /*newSeqnoCb*/ nullptr,
              SyncWriteResolvedCallback{},
+             SyncWriteTimeoutCallback{},
              NoopSyncWriteCompleteCb,
              NoopSeqnoAckCb,
              config,
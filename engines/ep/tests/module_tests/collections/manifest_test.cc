@@ -21,6 +21,7 @@
 #include <folly/portability/GTest.h>
 #include <memcached/engine_error.h>
 
+#include <algorithm>
 #include <cctype>
 #include <limits>
 #include <unordered_set>
@@ -252,6 +253,26 @@ TEST(ManifestTest, validation) {
                 "scopes":[{"name":"_default", "uid":"0",
                 "collections":[{"name":"_default","uid":"0"},
                                {"name":"brewery","uid":"9","maxTTL":4294967296}]}]})",
+
+            // memQuota/evictionPriority invalid cases
+            R"({"uid" : "0",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9","memQuota":"1"}]}]})",
+            R"({"uid" : "0",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9","memQuota":-1}]}]})",
+            R"({"uid" : "0",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9",
+                                "evictionPriority":"high"}]}]})",
+            R"({"uid" : "0",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9",
+                                "evictionPriority":0}]}]})",
             // Test duplicate scope names
             R"({"uid" : "0",
                 "scopes":[{"name":"_default", "uid":"0",
@@ -362,6 +383,23 @@ TEST(ManifestTest, validation) {
                 "scopes":[{"name":"_default", "uid":"0",
                 "collections":[{"name":"_default","uid":"0"},
                                {"name":"brewery","uid":"9","maxTTL":4294967295}]}]})",
+
+            // memQuota/evictionPriority valid cases
+            R"({"uid" : "0",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9","memQuota":0}]}]})",
+            R"({"uid" : "0",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9",
+                                "memQuota":1048576,
+                                "evictionPriority":"normal"}]}]})",
+            R"({"uid" : "0",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9",
+                                "evictionPriority":"low"}]}]})",
     };
 
     for (auto& manifest : invalidManifests) {
@@ -558,6 +596,40 @@ TEST(ManifestTest, toJson) {
 }
 #endif // !defined(__clang_major__) || __clang_major__ > 7
 
+TEST(ManifestTest, evictionSettings) {
+    Collections::Manifest m(std::string(R"({"uid" : "0",
+        "scopes":[{"name":"_default", "uid":"0",
+        "collections":[{"name":"_default","uid":"0"},
+                       {"name":"beer","uid":"8","memQuota":1024},
+                       {"name":"brewery","uid":"9",
+                        "evictionPriority":"low"},
+                       {"name":"meat","uid":"a",
+                        "evictionPriority":"normal"}]}]})"));
+
+    auto settings = m.getEvictionSettings();
+    ASSERT_EQ(2, settings.size());
+    std::sort(settings.begin(),
+              settings.end(),
+              [](const auto& a, const auto& b) { return a.id < b.id; });
+    EXPECT_EQ(CollectionID(8), settings[0].id);
+    ASSERT_TRUE(settings[0].memQuota);
+    EXPECT_EQ(1024, settings[0].memQuota.get());
+    EXPECT_FALSE(settings[0].lowEvictionPriority);
+    EXPECT_EQ(CollectionID(9), settings[1].id);
+    EXPECT_FALSE(settings[1].memQuota);
+    EXPECT_TRUE(settings[1].lowEvictionPriority);
+
+    // The settings survive a round trip through toJson
+    Collections::Manifest copy(m.toJson());
+    auto copied = copy.getEvictionSettings();
+    ASSERT_EQ(2, copied.size());
+    std::sort(copied.begin(),
+              copied.end(),
+              [](const auto& a, const auto& b) { return a.id < b.id; });
+    EXPECT_EQ(1024, copied[0].memQuota.get());
+    EXPECT_TRUE(copied[1].lowEvictionPriority);
+}
+
 TEST(ManifestTest, badNames) {
     for (char c = 127; c >= 0; c--) {
         std::string name(1, c);
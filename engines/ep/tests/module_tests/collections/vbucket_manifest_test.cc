@@ -29,6 +29,8 @@
 
 #include <folly/portability/GTest.h>
 
+#include <thread>
+
 class MockVBManifest : public Collections::VB::Manifest {
 public:
     MockVBManifest() {
@@ -39,19 +41,19 @@ public:
     }
 
     bool exists(CollectionID identifier) const {
-        std::lock_guard<cb::ReaderLock> readLock(rwlock.reader());
+        std::lock_guard<cb::ReaderLock> readLock(getReadLock().reader());
         return exists_UNLOCKED(identifier);
     }
 
     size_t size() const {
-        std::lock_guard<cb::ReaderLock> readLock(rwlock.reader());
+        std::lock_guard<cb::ReaderLock> readLock(getReadLock().reader());
         return map.size();
     }
 
     bool compareEntry(CollectionID id,
                       const Collections::VB::ManifestEntry& entry,
                       bool ignoreHighSeqno = false) const {
-        std::lock_guard<cb::ReaderLock> readLock(rwlock.reader());
+        std::lock_guard<cb::ReaderLock> readLock(getReadLock().reader());
         if (exists_UNLOCKED(id)) {
             auto itr = map.find(id);
             const auto& myEntry = itr->second;
@@ -77,7 +79,7 @@ public:
     }
 
     bool operator==(const MockVBManifest& rhs) const {
-        std::lock_guard<cb::ReaderLock> readLock(rwlock.reader());
+        std::lock_guard<cb::ReaderLock> readLock(getReadLock().reader());
         if (rhs.size() != size()) {
             return false;
         }
@@ -167,6 +169,7 @@ public:
               std::make_shared<DummyCB>(),
               /*newSeqnoCb*/ nullptr,
               SyncWriteResolvedCallback{},
+              SyncWriteTimeoutCallback{},
               NoopSyncWriteCompleteCb,
               NoopSeqnoAckCb,
               config,
@@ -184,6 +187,7 @@ public:
               std::make_shared<DummyCB>(),
               /*newSeqnoCb*/ nullptr,
               SyncWriteResolvedCallback{},
+              SyncWriteTimeoutCallback{},
               NoopSyncWriteCompleteCb,
               NoopSeqnoAckCb,
               config,
@@ -834,6 +838,48 @@ TEST_F(VBucketManifestCachingReadHandle, basic) {
     }
 }
 
+// The lock is striped per thread; check that readers on many threads can share
+// the manifest and that a writer still waits for all of them.
+TEST_F(VBucketManifestCachingReadHandle, striped_lock_excludes_readers) {
+    EXPECT_TRUE(manifest.update(cm));
+    StoredDocKey key{"vegetable:v1", CollectionEntry::vegetable};
+
+    // More readers than stripes, so some stripes are shared by readers
+    const size_t numReaders = Collections::VB::Manifest::LockStripes * 2;
+    std::atomic<size_t> locked{0};
+    std::atomic<bool> release{false};
+    std::vector<std::thread> readers;
+    for (size_t ii = 0; ii < numReaders; ++ii) {
+        readers.emplace_back([this, &key, &locked, &release]() {
+            auto rh = manifest.active.lock(key);
+            EXPECT_TRUE(rh.valid());
+            locked++;
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (locked != numReaders) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> writerDone{false};
+    std::thread writer([this, &writerDone]() {
+        auto wh = manifest.active.wlock();
+        writerDone = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_FALSE(writerDone);
+
+    release = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+    writer.join();
+    EXPECT_TRUE(writerDone);
+}
+
 TEST_F(VBucketManifestCachingReadHandle, deleted_default) {
     // Check we can still get an iterator into the map when the default
     // collection is logically deleted only (i.e marked deleted, but in the map)
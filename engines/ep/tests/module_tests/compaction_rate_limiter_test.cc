@@ -0,0 +1,127 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compaction_rate_limiter.h"
+#include "stats.h"
+
+#include <folly/portability/GTest.h>
+
+/*
+ * Unit tests for the CompactionRateLimiter
+ */
+
+using namespace std::chrono_literals;
+
+/// Limiter whose clock only advances when it "sleeps" or the test says so.
+class MockCompactionRateLimiter : public CompactionRateLimiter {
+public:
+    MockCompactionRateLimiter(EPStats& stats, std::function<bool()> backOff)
+        : CompactionRateLimiter(stats, std::move(backOff)) {
+    }
+
+    Clock::time_point now() const override {
+        return time;
+    }
+
+    void sleepFor(std::chrono::microseconds duration) override {
+        slept += duration;
+        time += duration;
+    }
+
+    Clock::time_point time = Clock::time_point() + 1h;
+    std::chrono::microseconds slept{0};
+};
+
+class CompactionRateLimiterTest : public ::testing::Test {
+protected:
+    EPStats stats;
+    bool backOff = false;
+    MockCompactionRateLimiter limiter{stats, [this]() { return backOff; }};
+};
+
+TEST_F(CompactionRateLimiterTest, UnlimitedByDefault) {
+    EXPECT_FALSE(limiter.isEnabled());
+    for (int ii = 0; ii < 1000; ++ii) {
+        limiter.acquire(1024 * 1024);
+    }
+    EXPECT_EQ(0us, limiter.slept);
+    EXPECT_EQ(0, stats.compactionIOThrottled);
+}
+
+TEST_F(CompactionRateLimiterTest, LimitsBytes) {
+    limiter.setMaxBytesPerSec(1000);
+    // The first second's worth is available immediately...
+    limiter.acquire(1000);
+    EXPECT_EQ(0us, limiter.slept);
+    // ... after which I/O proceeds at the configured rate.
+    limiter.acquire(500);
+    EXPECT_EQ(500ms, limiter.slept);
+    limiter.acquire(2000);
+    EXPECT_EQ(2500ms, limiter.slept);
+    EXPECT_EQ(2, stats.compactionIOThrottled);
+    EXPECT_EQ(2500000, stats.compactionIOThrottleTime);
+}
+
+TEST_F(CompactionRateLimiterTest, LimitsIOPS) {
+    limiter.setMaxIOPS(10);
+    for (int ii = 0; ii < 10; ++ii) {
+        limiter.acquire(1);
+    }
+    EXPECT_EQ(0us, limiter.slept);
+    for (int ii = 0; ii < 10; ++ii) {
+        limiter.acquire(1);
+    }
+    EXPECT_EQ(1s, limiter.slept);
+}
+
+// Budget accumulates while idle, but no more than one second's worth.
+TEST_F(CompactionRateLimiterTest, IdleBudgetBounded) {
+    limiter.setMaxBytesPerSec(1000);
+    limiter.acquire(1000);
+    limiter.time += 10s;
+    limiter.acquire(1000);
+    EXPECT_EQ(0us, limiter.slept);
+    limiter.acquire(1000);
+    EXPECT_EQ(1s, limiter.slept);
+}
+
+TEST_F(CompactionRateLimiterTest, BacksOff) {
+    limiter.setMaxBytesPerSec(1000);
+    limiter.acquire(1000);
+    EXPECT_FALSE(limiter.isBackedOff());
+
+    backOff = true;
+    limiter.time += CompactionRateLimiter::backoffCheckInterval;
+    limiter.acquire(0);
+    EXPECT_TRUE(limiter.isBackedOff());
+    EXPECT_EQ(1, stats.compactionIOBackoffs);
+    // Use up what budget has accumulated; at a quarter of the rate the
+    // next 1000 bytes then take 4 seconds.
+    limiter.acquire(1000);
+    const auto before = limiter.slept;
+    limiter.acquire(1000);
+    EXPECT_NEAR((before + 1s * CompactionRateLimiter::backoffDivisor).count(),
+                limiter.slept.count(),
+                1);
+
+    // The back-off is lifted at the next check once no longer required.
+    backOff = false;
+    limiter.time += CompactionRateLimiter::backoffCheckInterval;
+    limiter.acquire(0);
+    EXPECT_FALSE(limiter.isBackedOff());
+    EXPECT_EQ(1, stats.compactionIOBackoffs);
+}
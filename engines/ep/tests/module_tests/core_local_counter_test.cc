@@ -0,0 +1,71 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "core_local_counter.h"
+
+#include <folly/portability/GTest.h>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+TEST(CoreLocalCounterTest, Basic) {
+    CoreLocalCounter counter;
+    EXPECT_EQ(0, counter.load());
+    ++counter;
+    counter++;
+    counter += 10;
+    EXPECT_EQ(12, counter.load());
+    counter.fetch_sub(2);
+    --counter;
+    EXPECT_EQ(9, counter);
+
+    std::stringstream ss;
+    ss << counter;
+    EXPECT_EQ("9", ss.str());
+
+    counter.store(100);
+    EXPECT_EQ(100, counter.load());
+    counter = 0;
+    EXPECT_EQ(0, counter.load());
+}
+
+// The value never goes below zero, even if a decrement is seen before the
+// increment
+TEST(CoreLocalCounterTest, NotNegative) {
+    CoreLocalCounter counter;
+    --counter;
+    EXPECT_EQ(0, counter.load());
+}
+
+TEST(CoreLocalCounterTest, ManyThreads) {
+    CoreLocalCounter counter(5);
+    const size_t numThreads = 8;
+    const size_t iterations = 100000;
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < numThreads; ++ii) {
+        threads.emplace_back([&counter, iterations]() {
+            for (size_t jj = 0; jj < iterations; ++jj) {
+                ++counter;
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(5 + numThreads * iterations, counter.load());
+}
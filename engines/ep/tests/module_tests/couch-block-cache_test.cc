@@ -0,0 +1,134 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-block-cache.h"
+
+#include <folly/portability/GTest.h>
+
+#include <vector>
+
+/*
+ * Unit tests for the CouchBlockCache
+ */
+
+class CouchBlockCacheTest : public ::testing::Test {
+protected:
+    static constexpr size_t blockSize = CouchBlockCache::blockSize;
+
+    void insert(cs_off_t block, uint8_t fill) {
+        std::vector<uint8_t> data(blockSize, fill);
+        cache.insert(file, block * blockSize, data.data());
+    }
+
+    /// @return the first byte of the cached block, or -1 if not cached.
+    int lookup(cs_off_t block) {
+        std::vector<uint8_t> data(blockSize);
+        if (!cache.lookup(file, block * blockSize, data.data())) {
+            return -1;
+        }
+        return data[0];
+    }
+
+    // Room for 10 blocks; 8 may be protected.
+    CouchBlockCache cache{10 * blockSize};
+    const uint64_t file = cache.getFileId("0.couch.1");
+};
+
+constexpr size_t CouchBlockCacheTest::blockSize;
+
+TEST_F(CouchBlockCacheTest, LookupInserted) {
+    EXPECT_EQ(-1, lookup(0));
+    insert(0, 'a');
+    EXPECT_EQ('a', lookup(0));
+    EXPECT_EQ(1, cache.getHits());
+    EXPECT_EQ(1, cache.getMisses());
+    EXPECT_EQ(blockSize, cache.getMemUsed());
+}
+
+TEST_F(CouchBlockCacheTest, FileIds) {
+    EXPECT_EQ(file, cache.getFileId("0.couch.1"));
+    const auto other = cache.getFileId("0.couch.2");
+    EXPECT_NE(file, other);
+    insert(0, 'a');
+    std::vector<uint8_t> data(blockSize);
+    EXPECT_FALSE(cache.lookup(other, 0, data.data()));
+}
+
+TEST_F(CouchBlockCacheTest, EvictsLeastRecentlyUsed) {
+    for (int ii = 0; ii < 10; ++ii) {
+        insert(ii, ii);
+    }
+    insert(10, 10);
+    EXPECT_EQ(1, cache.getEvictions());
+    EXPECT_EQ(10 * blockSize, cache.getMemUsed());
+    EXPECT_EQ(-1, lookup(0));
+    EXPECT_EQ(1, lookup(1));
+    EXPECT_EQ(10, lookup(10));
+}
+
+// Blocks which have been read again survive a scan of blocks read once.
+TEST_F(CouchBlockCacheTest, ProtectedBlocksSurviveScan) {
+    insert(0, 0);
+    insert(1, 1);
+    ASSERT_EQ(0, lookup(0));
+    ASSERT_EQ(1, lookup(1));
+
+    for (int ii = 100; ii < 200; ++ii) {
+        insert(ii, ii);
+    }
+    EXPECT_EQ(0, lookup(0));
+    EXPECT_EQ(1, lookup(1));
+    EXPECT_EQ(-1, lookup(100));
+    EXPECT_EQ(199 % 256, lookup(199));
+}
+
+// The protected segment is bounded; the least recently used protected
+// blocks are demoted back to probation.
+TEST_F(CouchBlockCacheTest, ProtectedSegmentBounded) {
+    for (int ii = 0; ii < 10; ++ii) {
+        insert(ii, ii);
+        ASSERT_EQ(ii, lookup(ii));
+    }
+    // 0 & 1 were demoted, and are the first to go.
+    insert(10, 10);
+    insert(11, 11);
+    EXPECT_EQ(-1, lookup(0));
+    EXPECT_EQ(-1, lookup(1));
+    for (int ii = 2; ii < 10; ++ii) {
+        EXPECT_EQ(ii, lookup(ii));
+    }
+}
+
+TEST_F(CouchBlockCacheTest, InvalidateOverlapping) {
+    insert(0, 0);
+    insert(1, 1);
+    insert(2, 2);
+    // Covers the end of block 0 and the start of block 1.
+    cache.invalidate(file, blockSize - 10, 20);
+    EXPECT_EQ(-1, lookup(0));
+    EXPECT_EQ(-1, lookup(1));
+    EXPECT_EQ(2, lookup(2));
+    EXPECT_EQ(blockSize, cache.getMemUsed());
+}
+
+TEST_F(CouchBlockCacheTest, ZeroSizeCachesNothing) {
+    CouchBlockCache empty(0);
+    std::vector<uint8_t> data(blockSize);
+    empty.insert(0, 0, data.data());
+    EXPECT_FALSE(empty.lookup(0, 0, data.data()));
+    EXPECT_EQ(0, empty.getMemUsed());
+}
@@ -0,0 +1,152 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-fs-dropcache.h"
+#include "kvstore.h"
+
+#include <folly/portability/GTest.h>
+
+#include <utility>
+#include <vector>
+
+/*
+ * Unit tests for DropCacheOps
+ */
+
+/// FileOpsInterface which discards all writes, recording DONTNEED advice.
+class AdviceRecordingOps : public FileOpsInterface {
+public:
+    couch_file_handle constructor(couchstore_error_info_t*) override {
+        return reinterpret_cast<couch_file_handle>(this);
+    }
+    couchstore_error_t open(couchstore_error_info_t*,
+                            couch_file_handle*,
+                            const char*,
+                            int) override {
+        return COUCHSTORE_SUCCESS;
+    }
+    couchstore_error_t close(couchstore_error_info_t*,
+                             couch_file_handle) override {
+        return COUCHSTORE_SUCCESS;
+    }
+    ssize_t pread(couchstore_error_info_t*,
+                  couch_file_handle,
+                  void*,
+                  size_t nbytes,
+                  cs_off_t) override {
+        return nbytes;
+    }
+    ssize_t pwrite(couchstore_error_info_t*,
+                   couch_file_handle,
+                   const void*,
+                   size_t nbytes,
+                   cs_off_t) override {
+        return nbytes;
+    }
+    cs_off_t goto_eof(couchstore_error_info_t*, couch_file_handle) override {
+        return 0;
+    }
+    couchstore_error_t sync(couchstore_error_info_t*,
+                            couch_file_handle) override {
+        return syncResult;
+    }
+    couchstore_error_t advise(couchstore_error_info_t*,
+                              couch_file_handle,
+                              cs_off_t offset,
+                              cs_off_t len,
+                              couchstore_file_advice_t advice) override {
+        if (advice == COUCHSTORE_FILE_ADVICE_DONTNEED) {
+            dropped.emplace_back(offset, len);
+        }
+        return COUCHSTORE_SUCCESS;
+    }
+    void destructor(couch_file_handle) override {
+    }
+
+    couchstore_error_t syncResult = COUCHSTORE_SUCCESS;
+    std::vector<std::pair<cs_off_t, cs_off_t>> dropped;
+};
+
+class DropCacheOpsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        handle = ops.constructor(&errinfo);
+        ASSERT_EQ(COUCHSTORE_SUCCESS,
+                  ops.open(&errinfo, &handle, "0.couch.1", 0));
+    }
+
+    void TearDown() override {
+        ops.close(&errinfo, handle);
+        ops.destructor(handle);
+    }
+
+    void write(cs_off_t offset, size_t size) {
+        std::vector<char> buf(size);
+        ASSERT_EQ(ssize_t(size),
+                  ops.pwrite(&errinfo, handle, buf.data(), size, offset));
+    }
+
+    using Drops = std::vector<std::pair<cs_off_t, cs_off_t>>;
+
+    FileStats stats;
+    AdviceRecordingOps recorder;
+    DropCacheOps ops{stats, recorder};
+    couchstore_error_info_t errinfo;
+    couch_file_handle handle = nullptr;
+};
+
+TEST_F(DropCacheOpsTest, DropsWrittenRangeOnSync) {
+    write(100, 50);
+    write(150, 100);
+    EXPECT_TRUE(recorder.dropped.empty());
+    ASSERT_EQ(COUCHSTORE_SUCCESS, ops.sync(&errinfo, handle));
+    EXPECT_EQ(Drops({{100, 150}}), recorder.dropped);
+    EXPECT_EQ(150, stats.totalBytesDropped);
+
+    // Nothing written since; nothing more to drop.
+    ASSERT_EQ(COUCHSTORE_SUCCESS, ops.sync(&errinfo, handle));
+    EXPECT_EQ(1, recorder.dropped.size());
+}
+
+TEST_F(DropCacheOpsTest, FailedSyncDropsNothing) {
+    write(0, 4096);
+    recorder.syncResult = COUCHSTORE_ERROR_WRITE;
+    EXPECT_EQ(COUCHSTORE_ERROR_WRITE, ops.sync(&errinfo, handle));
+    EXPECT_TRUE(recorder.dropped.empty());
+
+    // The range is still dropped by the next successful sync.
+    recorder.syncResult = COUCHSTORE_SUCCESS;
+    ASSERT_EQ(COUCHSTORE_SUCCESS, ops.sync(&errinfo, handle));
+    EXPECT_EQ(Drops({{0, 4096}}), recorder.dropped);
+}
+
+TEST_F(DropCacheOpsTest, PeriodicSyncDropsPreviousPeriod) {
+    ASSERT_EQ(COUCHSTORE_SUCCESS, ops.set_periodic_sync(handle, 1000));
+    write(0, 1000);
+    // First period may not have been synced yet.
+    EXPECT_TRUE(recorder.dropped.empty());
+    write(1000, 1000);
+    // A whole period written after the first one; the first is synced.
+    EXPECT_EQ(Drops({{0, 1000}}), recorder.dropped);
+    write(2000, 500);
+    EXPECT_EQ(1, recorder.dropped.size());
+
+    ASSERT_EQ(COUCHSTORE_SUCCESS, ops.sync(&errinfo, handle));
+    EXPECT_EQ(Drops({{0, 1000}, {1000, 1000}, {2000, 500}}),
+              recorder.dropped);
+    EXPECT_EQ(2500, stats.totalBytesDropped);
+}
@@ -2109,6 +2109,109 @@ TEST_P(SingleThreadedPassiveStreamTest, MB_33773_oom_close) {
     mb_33773(mb_33773Mode::noMemoryAndClosed);
 }
 
+// Test that the replica is only considered in sync with the active once it
+// has received the full snapshot, and that replica reads with a max
+// staleness are rejected until then
+// The value of a DCP mutation is copied once, out of the connection's read
+// buffer into the Item the consumer creates. A mutation buffered by the
+// PassiveStream holds that Item, and its Blob is the one which ends up in
+// the HashTable.
+TEST_P(SingleThreadedPassiveStreamTest, BufferedMutationSharesValue) {
+    // The stream's opaque is the one after the addStream() opaque
+    const uint32_t opaque = 1;
+    ASSERT_EQ(ENGINE_SUCCESS,
+              consumer->snapshotMarker(opaque,
+                                       vbid,
+                                       1 /*snapStart*/,
+                                       1 /*snapEnd*/,
+                                       dcp_marker_flag_t::MARKER_FLAG_MEMORY,
+                                       {} /*HCS*/));
+
+    // Trick the replication throttle into returning pause so that the
+    // mutation is buffered.
+    engine->getReplicationThrottle().adjustWriteQueueCap(0);
+    auto& stats = engine->getEpStats();
+    const size_t size = stats.getMaxDataSize();
+    stats.setMaxDataSize(1);
+
+    const auto key = makeStoredDocKey("key");
+    const std::string value(1024 * 1024, 'x');
+    ASSERT_EQ(ENGINE_SUCCESS,
+              consumer->mutation(
+                      opaque,
+                      key,
+                      {reinterpret_cast<const uint8_t*>(value.data()),
+                       value.size()},
+                      0,
+                      PROTOCOL_BINARY_RAW_BYTES,
+                      0,
+                      vbid,
+                      0,
+                      1 /*seqno*/,
+                      0,
+                      0,
+                      0,
+                      {},
+                      0));
+    ASSERT_EQ(1, stream->getNumBufferItems());
+    const auto buffered =
+            dynamic_cast<MutationResponse&>(
+                    *stream->getBufferMessages().front())
+                    .getItem()
+                    ->getValue();
+    stats.setMaxDataSize(size);
+
+    uint32_t bytesProcessed = 0;
+    ASSERT_EQ(all_processed,
+              stream->processBufferedMessages(bytesProcessed, 1));
+
+    auto vb = engine->getVBucket(vbid);
+    const auto res = vb->ht.findForRead(key);
+    ASSERT_TRUE(res.storedValue);
+    EXPECT_EQ(buffered.get().get(), res.storedValue->getValue().get().get());
+}
+
+TEST_P(SingleThreadedPassiveStreamTest, ReplicaStaleness) {
+    auto vb = engine->getVBucket(vbid);
+    using std::chrono::milliseconds;
+    EXPECT_EQ(milliseconds::max(), vb->getReplicaStaleness());
+
+    const auto key = makeStoredDocKey("key_1");
+    auto getReplica = [this, &key](milliseconds maxStaleness) {
+        return engine->get_replica(cookie, key, vbid, maxStaleness).first;
+    };
+    EXPECT_EQ(cb::engine_errc::temporary_failure,
+              getReplica(std::chrono::seconds(60)));
+    EXPECT_EQ(1, engine->getEpStats().numStaleReplicaReads);
+
+    SnapshotMarker marker(0 /*opaque*/,
+                          vbid,
+                          1 /*snapStart*/,
+                          2 /*snapEnd*/,
+                          dcp_marker_flag_t::MARKER_FLAG_MEMORY,
+                          {} /*HCS*/,
+                          {} /*streamId*/);
+    stream->processMarker(&marker);
+    EXPECT_EQ(2, vb->getLastKnownActiveSeqno());
+
+    // A noop doesn't help before we've received the full snapshot
+    ASSERT_EQ(ENGINE_SUCCESS,
+              stream->messageReceived(
+                      makeMutationConsumerMessage(1, vbid, "value", 0)));
+    ASSERT_EQ(ENGINE_SUCCESS, consumer->noop(0));
+    EXPECT_EQ(milliseconds::max(), vb->getReplicaStaleness());
+
+    ASSERT_EQ(ENGINE_SUCCESS,
+              stream->messageReceived(
+                      makeMutationConsumerMessage(2, vbid, "value", 0)));
+    EXPECT_LT(vb->getReplicaStaleness(), std::chrono::seconds(60));
+    EXPECT_EQ(cb::engine_errc::success, getReplica(std::chrono::seconds(60)));
+
+    // No bound is applied unless requested
+    EXPECT_EQ(cb::engine_errc::success, getReplica(milliseconds::max()));
+    EXPECT_EQ(1, engine->getEpStats().numStaleReplicaReads);
+}
+
 TEST_P(SingleThreadedPassiveStreamTest,
        InitialDiskSnapshotFlagClearedOnStateTransition) {
     // Test that a vbucket changing state away from replica clears the initial
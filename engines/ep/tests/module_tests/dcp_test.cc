@@ -685,6 +685,45 @@ TEST_P(CompressionStreamTest, force_value_compression_enabled) {
     destroy_dcp_stream();
 }
 
+/**
+ * Test that with force_value_compression, a value which doesn't compress
+ * by at least dcp_min_compression_ratio is streamed uncompressed.
+ */
+TEST_P(CompressionStreamTest, force_value_compression_below_min_ratio) {
+    engine->getConfiguration().setDcpMinCompressionRatio(0.1f);
+    VBucketPtr vb = engine->getKVBucket()->getVBucket(vbid);
+    std::string valueData(
+            "{\"product\": \"car\",\"price\": \"100\"},"
+            "{\"product\": \"bus\",\"price\": \"1000\"},"
+            "{\"product\": \"Train\",\"price\": \"100000\"}");
+
+    auto item = makeCompressibleItem(vbid,
+                                     makeStoredDocKey("key"),
+                                     valueData,
+                                     PROTOCOL_BINARY_DATATYPE_JSON,
+                                     false, // not compressed
+                                     isXattr());
+
+    mock_set_datatype_support(cookie, PROTOCOL_BINARY_DATATYPE_SNAPPY);
+    auto includeValue = isXattr() ? IncludeValue::No : IncludeValue::Yes;
+    setup_dcp_stream(0,
+                     includeValue,
+                     IncludeXattrs::Yes,
+                     {{"force_value_compression", "true"}});
+    EXPECT_EQ(ENGINE_SUCCESS, doStreamRequest(*producer).status);
+    ASSERT_TRUE(producer->isForceValueCompressionEnabled());
+
+    queued_item qi = std::move(item);
+    auto dcpResponse = stream->public_makeResponseFromItem(
+            qi, SendCommitSyncWriteAs::Commit);
+    auto* mutProdResponse = dynamic_cast<MutationResponse*>(dcpResponse.get());
+    ASSERT_NE(nullptr, mutProdResponse);
+    EXPECT_FALSE(mcbp::datatype::is_snappy(
+            mutProdResponse->getItem()->getDataType()));
+
+    destroy_dcp_stream();
+}
+
 class ConnectionTest : public DCPTest,
                        public ::testing::WithParamInterface<
                                std::tuple<std::string, std::string>> {
@@ -392,6 +392,61 @@ TEST_P(DefragmenterTest, DISABLED_MaxDefragValueSize) {
                       get_mock_server_api()->alloc_hooks));
 }
 
+#if defined(HAVE_JEMALLOC)
+TEST_P(DefragmenterTest, SizeClasses) {
+#else
+TEST_P(DefragmenterTest, DISABLED_SizeClasses) {
+#endif
+    auto* alloc_hooks = get_mock_server_api()->alloc_hooks;
+    // A threshold of 100 disables the size class targeting
+    EXPECT_EQ(0, DefragmenterTask::getSizeClasses(alloc_hooks, 0, 100).size());
+
+    // Create a size class where each page only holds a single value
+    const size_t num_docs = 5000;
+    setDocs(64, num_docs);
+    size_t num_remaining;
+    fragment(num_docs, num_remaining);
+
+    auto classes = DefragmenterTask::getSizeClasses(alloc_hooks, 0, 90);
+    EXPECT_LT(0, classes.size());
+    EXPECT_LT(0, classes.getNumSparse());
+    snprintf(keyScratch, sizeof(keyScratch), keyPattern, 0);
+    auto* sv = vbucket->ht
+                       .findForRead(DocKey(keyScratch,
+                                           DocKeyEncodesCollectionId::No))
+                       .storedValue;
+    ASSERT_NE(nullptr, sv);
+    EXPECT_TRUE(classes.isSparse(isModeStoredValue()
+                                         ? static_cast<const void*>(sv)
+                                         : sv->getValue().get()));
+
+    // Nothing is sparse with a threshold of 0
+    EXPECT_EQ(0,
+              DefragmenterTask::getSizeClasses(alloc_hooks, 0, 0)
+                      .getNumSparse());
+}
+
+/// Use the address as the allocation size
+static size_t addressAsSize(const void* ptr) {
+    return reinterpret_cast<uintptr_t>(ptr);
+}
+
+TEST(DefragSizeClassesTest, IsSparse) {
+    DefragSizeClasses classes({8, 16, 32}, {false, true, false}, addressAsSize);
+    EXPECT_EQ(1, classes.getNumSparse());
+    EXPECT_FALSE(classes.isSparse(reinterpret_cast<const void*>(8)));
+    EXPECT_TRUE(classes.isSparse(reinterpret_cast<const void*>(12)));
+    EXPECT_TRUE(classes.isSparse(reinterpret_cast<const void*>(16)));
+    EXPECT_FALSE(classes.isSparse(reinterpret_cast<const void*>(32)));
+    // Larger than the small size classes
+    EXPECT_TRUE(classes.isSparse(reinterpret_cast<const void*>(64)));
+
+    // By default everything is defragmented
+    DefragSizeClasses all;
+    EXPECT_EQ(0, all.size());
+    EXPECT_TRUE(all.isSparse(reinterpret_cast<const void*>(8)));
+}
+
 INSTANTIATE_TEST_CASE_P(
         FullAndValueEviction,
         DefragmenterTest,
@@ -560,6 +560,42 @@ TEST_P(ActiveDurabilityMonitorTest, SeqnoAckReceivedEqualPending) {
     }
 }
 
+// Each replica seqno ack records the ack latency of the SyncWrites it acks,
+// per replica node. The (local) active acks are not recorded.
+TEST_P(ActiveDurabilityMonitorTest, SeqnoAckRecordsReplicaAckTime) {
+    ASSERT_EQ(2, addSyncWrites(1 /*seqnoStart*/, 2 /*seqnoEnd*/));
+    EXPECT_TRUE(global_stats.syncWriteReplicaAckTimes.rlock()->empty());
+
+    EXPECT_NO_THROW(getActiveDM().seqnoAckReceived(replica1, 2));
+
+    auto histos = global_stats.syncWriteReplicaAckTimes.rlock();
+    ASSERT_EQ(1, histos->size());
+    ASSERT_EQ(1, histos->count(replica1));
+    EXPECT_EQ(2, histos->at(replica1).getValueCount());
+}
+
+// A single seqno ack covering many SyncWrites of a node which is in both
+// chains acks (and records the ack time of) each SyncWrite once.
+TEST_P(ActiveDurabilityMonitorTest, SeqnoAckManySyncWritesTwoChains) {
+    auto& adm = getActiveDM();
+    adm.setReplicationTopology(
+            nlohmann::json::array({{active, replica1}, {active, replica1}}));
+    ASSERT_EQ(2, adm.getFirstChainSize());
+    ASSERT_EQ(2, adm.getSecondChainSize());
+
+    const int64_t numWrites = 1000;
+    ASSERT_EQ(numWrites, addSyncWrites(1 /*seqnoStart*/, numWrites));
+
+    EXPECT_NO_THROW(adm.seqnoAckReceived(replica1, numWrites));
+    EXPECT_EQ(0, adm.getNumTracked());
+    EXPECT_EQ(numWrites, adm.getNodeWriteSeqno(replica1));
+    EXPECT_EQ(numWrites, adm.getNodeAckSeqno(replica1));
+
+    auto histos = global_stats.syncWriteReplicaAckTimes.rlock();
+    ASSERT_EQ(1, histos->count(replica1));
+    EXPECT_EQ(numWrites, histos->at(replica1).getValueCount());
+}
+
 TEST_P(ActiveDurabilityMonitorTest, SeqnoAckReceivedEqualPendingTwoChains) {
     auto& adm = getActiveDM();
     adm.setReplicationTopology(
@@ -3384,6 +3420,48 @@ TEST_P(PassiveDurabilityMonitorTest, SendSeqnoAckRace) {
     EXPECT_EQ(2, ackedSeqno);
 }
 
+class PassiveDurabilityMonitorCoalesceTest
+    : public PassiveDurabilityMonitorTest {
+public:
+    void SetUp() override {
+        config_string +=
+                "durability_seqno_ack_coalesce_window=60000000;"
+                "durability_seqno_ack_coalesce_count=2";
+        PassiveDurabilityMonitorTest::SetUp();
+    }
+};
+
+// Check that seqno acks are deferred until either the coalescing count is
+// reached or the coalescing window expires.
+TEST_P(PassiveDurabilityMonitorCoalesceTest, SeqnoAcksAreCoalesced) {
+    auto& pdm = getPassiveDM();
+    std::vector<int64_t> acks;
+    VBucketTestIntrospector::setSeqnoAckCb(
+            *vb, [&acks](Vbid vbid, uint64_t hps) { acks.push_back(hps); });
+
+    using namespace cb::durability;
+    const Requirements reqs{Level::Majority, Timeout::Infinity()};
+
+    addSyncWrite(1 /*seqno*/, reqs);
+    pdm.notifySnapshotEndReceived(1);
+    EXPECT_TRUE(acks.empty());
+
+    // Second HPS update reaches the count limit, both are acked together.
+    addSyncWrite(2 /*seqno*/, reqs);
+    pdm.notifySnapshotEndReceived(2);
+    EXPECT_EQ(std::vector<int64_t>({2}), acks);
+
+    // Third update is deferred until the window expires.
+    addSyncWrite(3 /*seqno*/, reqs);
+    pdm.notifySnapshotEndReceived(3);
+    vb->processDurabilityTimeout(std::chrono::steady_clock::now());
+    EXPECT_EQ(std::vector<int64_t>({2}), acks);
+
+    vb->processDurabilityTimeout(std::chrono::steady_clock::now() +
+                                 std::chrono::seconds(61));
+    EXPECT_EQ(std::vector<int64_t>({2, 3}), acks);
+}
+
 class ActiveDurabilityMonitorAbortTest
     : public ActiveDurabilityMonitorPersistentTest {
 public:
@@ -3442,6 +3520,11 @@ INSTANTIATE_TEST_CASE_P(AllBucketTypes,
                         STParameterizedBucketTest::allConfigValues(),
                         STParameterizedBucketTest::PrintToStringParamName);
 
+INSTANTIATE_TEST_CASE_P(AllBucketTypes,
+                        PassiveDurabilityMonitorCoalesceTest,
+                        STParameterizedBucketTest::allConfigValues(),
+                        STParameterizedBucketTest::PrintToStringParamName);
+
 INSTANTIATE_TEST_CASE_P(
         AllBucketTypes,
         PassiveDurabilityMonitorPersistentTest,
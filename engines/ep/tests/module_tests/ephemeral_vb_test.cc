@@ -52,6 +52,7 @@ protected:
                                               /*table*/ nullptr,
                                               /*newSeqnoCb*/ nullptr,
                                               SyncWriteResolvedCallback{},
+                                              SyncWriteTimeoutCallback{},
                                               NoopSyncWriteCompleteCb,
                                               NoopSeqnoAckCb,
                                               config,
@@ -531,6 +532,38 @@ TEST_F(EphTombstoneTest, NoPurgeIfNoneOldEnough) {
     EXPECT_EQ(1, vbucket->getNumInMemoryDeletes());
 }
 
+// Check that the tombstone index finds only the tombstones old enough to be
+// purged, and discards entries for items which have since been modified.
+TEST_F(EphTombstoneTest, IndexedPurgeOnlyOldTombstones) {
+    // Delete key0 and then recreate it - its index entry is now out of date.
+    softDeleteOne(keys.at(0), MutationStatus::WasDirty);
+    ASSERT_EQ(MutationStatus::WasDirty, setOne(keys.at(0)));
+
+    // Delete key1 "now", and key2 at time 30.
+    softDeleteOne(keys.at(1), MutationStatus::WasDirty);
+    TimeTraveller looper(30);
+    softDeleteOne(keys.at(2), MutationStatus::WasDirty);
+    ASSERT_EQ(1, vbucket->getNumItems());
+    ASSERT_EQ(2, vbucket->getNumInMemoryDeletes());
+
+    // Only key1 is old enough; key0 is alive so must not be purged.
+    TimeTraveller looper2(30);
+    EXPECT_EQ(1, mockEpheVB->markOldIndexedTombstonesStale(60));
+    EXPECT_NE(nullptr, findValue(keys.at(0)));
+    EXPECT_EQ(nullptr, findValue(keys.at(1)));
+    EXPECT_NE(nullptr, findValue(keys.at(2)));
+
+    // Once key2 is old enough it is purged too.
+    TimeTraveller looper3(30);
+    EXPECT_EQ(1, mockEpheVB->markOldIndexedTombstonesStale(60));
+    EXPECT_EQ(nullptr, findValue(keys.at(2)));
+    EXPECT_EQ(0, mockEpheVB->markOldIndexedTombstonesStale(0));
+
+    EXPECT_EQ(2, mockEpheVB->purgeStaleItems());
+    EXPECT_EQ(1, vbucket->getNumItems());
+    EXPECT_EQ(0, vbucket->getNumInMemoryDeletes());
+}
+
 // Check that items should be purged when they are old enough.
 TEST_F(EphTombstoneTest, OnePurgeIfDeletedItemOld) {
     // Delete the first item "now"
@@ -654,8 +687,6 @@ TEST_F(EphTombstoneTest, ImmediatePurgeOfAliveStale) {
     // be added for that key.
     auto& seqList = mockEpheVB->getLL()->getSeqList();
     {
-        std::lock_guard<std::mutex> rrGuard(
-                mockEpheVB->getLL()->getRangeReadLock());
         mockEpheVB->registerFakeReadRange(1, 2);
         ASSERT_EQ(MutationStatus::WasClean, setOne(keys.at(1)));
 
@@ -682,7 +713,7 @@ TEST_F(EphTombstoneTest, ImmediatePurgeOfAliveStale) {
         // Clear the ReadRange (so we can actually purge items) and retry the
         // purge which should now succeed.
         mockEpheVB->getLL()->resetReadRange();
-    } // END rrGuard.
+    }
 
     // Scan sequenceList for stale items.
     EXPECT_EQ(1, mockEpheVB->purgeStaleItems());
@@ -403,6 +403,87 @@ TEST_P(DurabilityEPBucketTest, PersistPrepareDelete) {
     testPersistPrepare(DocumentState::Deleted);
 }
 
+// Check that with a group commit window the flusher waits for (up to) the
+// window after a persistence-level SyncWrite is queued, and that the wait
+// for persistence is recorded.
+TEST_P(DurabilityEPBucketTest, GroupCommitWindowDelaysFlush) {
+    setVBucketStateAndRunPersistTask(
+            vbid,
+            vbucket_state_active,
+            {{"topology", nlohmann::json::array({{"active", "replica"}})}});
+
+    const auto window = std::chrono::milliseconds(20);
+    engine->getConfiguration().setDurabilityGroupCommitWindow(
+            std::chrono::duration_cast<std::chrono::microseconds>(window)
+                    .count());
+
+    auto& stats = engine->getEpStats();
+    ASSERT_EQ(0, stats.syncWritePersistWaitHisto.getValueCount());
+
+    // A level=Majority SyncWrite doesn't need persistence; not delayed and
+    // not recorded.
+    ASSERT_EQ(ENGINE_SYNC_WRITE_PENDING,
+              store->set(*makePendingItem(makeStoredDocKey("majority"), "v"),
+                         cookie));
+    flushVBucketToDiskIfPersistent(vbid, 1);
+    EXPECT_EQ(0, stats.syncWritePersistWaitHisto.getValueCount());
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto* key : {"key1", "key2"}) {
+        auto pending = makePendingItem(
+                makeStoredDocKey(key),
+                "v",
+                {cb::durability::Level::PersistToMajority, {}});
+        ASSERT_EQ(ENGINE_SYNC_WRITE_PENDING, store->set(*pending, cookie));
+    }
+
+    // Both prepares are persisted by a single flush, no sooner than the
+    // window after the first was queued.
+    flushVBucketToDiskIfPersistent(vbid, 2);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, window);
+    EXPECT_EQ(1, stats.syncWritePersistWaitHisto.getValueCount());
+}
+
+// Check that with a vbstate persist delay a topology change which isn't
+// accompanied by any mutations is persisted with the next flush batch
+// instead of in a commit of its own.
+TEST_P(DurabilityEPBucketTest, VBStatePersistDeferredToNextBatch) {
+    setVBucketStateAndRunPersistTask(
+            vbid,
+            vbucket_state_active,
+            {{"topology", nlohmann::json::array({{"active", "replica"}})}});
+
+    engine->getConfiguration().setFlusherVbstatePersistDelay(60000);
+    auto& stats = engine->getEpStats();
+    auto* kvstore = store->getRWUnderlying(vbid);
+    const auto persistCount = stats.totalPersistVBState.load();
+
+    const auto newTopology =
+            nlohmann::json::array({{"active", "replica1", "replica2"}});
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->setVBucketState(
+                      vbid, vbucket_state_active, {{"topology", newTopology}}));
+    flushVBucketToDiskIfPersistent(vbid, 0);
+    EXPECT_EQ(1, stats.totalDeferredVBState);
+    EXPECT_NE(newTopology,
+              kvstore->getVBucketState(vbid)->transition.replicationTopology);
+
+    // The deferred state is written by the next flush with a mutation
+    store_item(vbid, makeStoredDocKey("key"), "value");
+    flushVBucketToDiskIfPersistent(vbid, 1);
+    EXPECT_EQ(newTopology,
+              kvstore->getVBucketState(vbid)->transition.replicationTopology);
+    EXPECT_EQ(persistCount + 1, stats.totalPersistVBState);
+
+    // A change of the state itself is never deferred
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->setVBucketState(vbid, vbucket_state_replica));
+    flushVBucketToDiskIfPersistent(vbid, 0);
+    EXPECT_EQ(1, stats.totalDeferredVBState);
+    EXPECT_EQ(vbucket_state_replica,
+              kvstore->getVBucketState(vbid)->transition.state);
+}
+
 void DurabilityEPBucketTest::testPersistPrepareAbort(DocumentState docState) {
     setVBucketStateAndRunPersistTask(
             vbid,
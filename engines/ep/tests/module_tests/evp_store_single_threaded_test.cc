@@ -35,6 +35,7 @@
 #include "dcp/response.h"
 #include "ep_bucket.h"
 #include "ep_time.h"
+#include "ep_vb.h"
 #include "ephemeral_tombstone_purger.h"
 #include "evp_store_test.h"
 #include "failover-table.h"
@@ -45,6 +46,7 @@
 #include "taskqueue.h"
 #include "tests/module_tests/test_helpers.h"
 #include "tests/module_tests/test_task.h"
+#include "vbucketdeletiontask.h"
 
 #include <string_utilities.h>
 #include <xattr/blob.h>
@@ -458,6 +460,216 @@ TEST_P(STParameterizedBucketTest, SlowStreamBackfillPurgeSeqnoCheck) {
     cancelAndPurgeTasks();
 }
 
+/*
+ * With cursor_dropping_resume_from_memory, a stream whose cursor was dropped
+ * while the checkpoints still contain the items after its lastReadSeqno
+ * resumes from the checkpoints without any backfill.
+ */
+TEST_F(SingleThreadedEPBucketTest, CursorDroppingResumeFromMemoryNoBackfill) {
+    engine->getConfiguration().setCursorDroppingResumeFromMemory(true);
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    auto vb = store->getVBuckets().getBucket(vbid);
+    ASSERT_TRUE(vb.get());
+    auto& ckpt_mgr =
+            *(static_cast<MockCheckpointManager*>(vb->checkpointManager.get()));
+
+    store_item(vbid, makeStoredDocKey("k1"), "v");
+    store_item(vbid, makeStoredDocKey("k2"), "v");
+    flushVBucketToDiskIfPersistent(vbid, 2);
+
+    auto producer = std::make_shared<MockDcpProducer>(*engine,
+                                                      cookie,
+                                                      "test_producer",
+                                                      /*flags*/ 0);
+    auto mock_stream = std::make_shared<MockActiveStream>(
+            static_cast<EventuallyPersistentEngine*>(engine.get()),
+            producer,
+            /*flags*/ 0,
+            /*opaque*/ 0,
+            *vb,
+            /*st_seqno*/ 1,
+            /*en_seqno*/ ~0,
+            /*vb_uuid*/ 0xabcd,
+            /*snap_start_seqno*/ 0,
+            /*snap_end_seqno*/ ~0,
+            IncludeValue::Yes,
+            IncludeXattrs::Yes);
+
+    producer->createCheckpointProcessorTask();
+    producer->scheduleCheckpointProcessorTask();
+
+    mock_stream->transitionStateToBackfilling();
+    ASSERT_TRUE(mock_stream->isInMemory());
+    ASSERT_EQ(2, ckpt_mgr.getNumOfCursors());
+
+    EXPECT_TRUE(mock_stream->handleSlowStream());
+    EXPECT_TRUE(mock_stream->public_getPendingBackfill());
+    EXPECT_EQ(1, ckpt_mgr.getNumOfCursors());
+
+    // The checkpoint still holds seqno 2 onwards, so no backfill is needed.
+    mock_stream->transitionStateToBackfilling();
+    EXPECT_TRUE(mock_stream->isInMemory());
+    EXPECT_FALSE(mock_stream->public_isBackfillTaskRunning());
+    EXPECT_EQ(2, ckpt_mgr.getNumOfCursors());
+
+    producer->cancelCheckpointCreatorTask();
+}
+
+/*
+ * With cursor_dropping_resume_from_memory, a stream whose cursor was dropped
+ * and whose next seqno is no longer in the checkpoints backfills from exactly
+ * its lastReadSeqno.
+ */
+TEST_F(SingleThreadedEPBucketTest, CursorDroppingResumeFromMemoryBackfill) {
+    engine->getConfiguration().setCursorDroppingResumeFromMemory(true);
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    auto vb = store->getVBuckets().getBucket(vbid);
+    ASSERT_TRUE(vb.get());
+    auto& ckpt_mgr =
+            *(static_cast<MockCheckpointManager*>(vb->checkpointManager.get()));
+
+    store_item(vbid, makeStoredDocKey("k1"), "v");
+    store_item(vbid, makeStoredDocKey("k2"), "v");
+    flushVBucketToDiskIfPersistent(vbid, 2);
+
+    auto producer = std::make_shared<MockDcpProducer>(*engine,
+                                                      cookie,
+                                                      "test_producer",
+                                                      /*flags*/ 0);
+    auto mock_stream = std::make_shared<MockActiveStream>(
+            static_cast<EventuallyPersistentEngine*>(engine.get()),
+            producer,
+            /*flags*/ 0,
+            /*opaque*/ 0,
+            *vb,
+            /*st_seqno*/ 1,
+            /*en_seqno*/ ~0,
+            /*vb_uuid*/ 0xabcd,
+            /*snap_start_seqno*/ 0,
+            /*snap_end_seqno*/ ~0,
+            IncludeValue::Yes,
+            IncludeXattrs::Yes);
+
+    producer->createCheckpointProcessorTask();
+    producer->scheduleCheckpointProcessorTask();
+
+    mock_stream->transitionStateToBackfilling();
+    ASSERT_TRUE(mock_stream->isInMemory());
+    EXPECT_TRUE(mock_stream->handleSlowStream());
+
+    // With the cursor dropped, seqnos 1..3 are removed from memory.
+    store_item(vbid, makeStoredDocKey("k3"), "v");
+    ckpt_mgr.createNewCheckpoint();
+    store_item(vbid, makeStoredDocKey("k4"), "v");
+    flushVBucketToDiskIfPersistent(vbid, 2);
+    bool newCkptCreated;
+    EXPECT_EQ(1, ckpt_mgr.removeClosedUnrefCheckpoints(*vb, newCkptCreated));
+
+    // The cursor is registered at the start of the remaining checkpoint
+    // (seqno 4), and a backfill scheduled from seqno 2.
+    mock_stream->transitionStateToBackfilling();
+    ASSERT_TRUE(mock_stream->isBackfilling());
+    EXPECT_EQ(2, ckpt_mgr.getNumOfCursors());
+
+    auto& bfm = producer->getBFM();
+    bfm.backfill();
+    bfm.backfill();
+
+    auto resp = mock_stream->public_popFromReadyQ();
+    ASSERT_TRUE(resp);
+    ASSERT_EQ(DcpResponse::Event::SnapshotMarker, resp->getEvent());
+    EXPECT_EQ(4, static_cast<SnapshotMarker&>(*resp).getEndSeqno());
+    for (int64_t seqno = 2; seqno <= 4; ++seqno) {
+        resp = mock_stream->public_popFromReadyQ();
+        ASSERT_TRUE(resp);
+        EXPECT_EQ(DcpResponse::Event::Mutation, resp->getEvent());
+        EXPECT_EQ(seqno, *resp->getBySeqno());
+    }
+    EXPECT_FALSE(mock_stream->public_popFromReadyQ());
+
+    producer->cancelCheckpointCreatorTask();
+}
+
+/*
+ * With dcp_backfill_scan_sharing, a second stream of the same vBucket joins
+ * the queued backfill of the first, and each stream is sent the items from
+ * its own start.
+ */
+TEST_F(SingleThreadedEPBucketTest, BackfillScanSharing) {
+    engine->getConfiguration().setDcpBackfillScanSharing(true);
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    auto vb = store->getVBuckets().getBucket(vbid);
+    ASSERT_TRUE(vb.get());
+    auto& ckpt_mgr =
+            *(static_cast<MockCheckpointManager*>(vb->checkpointManager.get()));
+
+    // Seqnos 1..3 only on disk, 4 also in memory.
+    store_item(vbid, makeStoredDocKey("k1"), "v");
+    store_item(vbid, makeStoredDocKey("k2"), "v");
+    store_item(vbid, makeStoredDocKey("k3"), "v");
+    ckpt_mgr.createNewCheckpoint();
+    store_item(vbid, makeStoredDocKey("k4"), "v");
+    flushVBucketToDiskIfPersistent(vbid, 4);
+    bool newCkptCreated;
+    ASSERT_EQ(3, ckpt_mgr.removeClosedUnrefCheckpoints(*vb, newCkptCreated));
+
+    auto producer = std::make_shared<MockDcpProducer>(*engine,
+                                                      cookie,
+                                                      "test_producer",
+                                                      /*flags*/ 0);
+    auto makeStream = [this, &producer, &vb](uint64_t startSeqno) {
+        return std::make_shared<MockActiveStream>(
+                static_cast<EventuallyPersistentEngine*>(engine.get()),
+                producer,
+                /*flags*/ 0,
+                /*opaque*/ 0,
+                *vb,
+                startSeqno,
+                /*en_seqno*/ ~0,
+                /*vb_uuid*/ 0xabcd,
+                /*snap_start_seqno*/ startSeqno,
+                /*snap_end_seqno*/ startSeqno,
+                IncludeValue::Yes,
+                IncludeXattrs::Yes);
+    };
+    auto streamA = makeStream(0);
+    auto streamB = makeStream(2);
+
+    producer->createCheckpointProcessorTask();
+    producer->scheduleCheckpointProcessorTask();
+
+    auto& connMap = engine->getDcpConnMap();
+    const auto backfills = connMap.getNumActiveSnoozingBackfills();
+    streamA->transitionStateToBackfilling();
+    ASSERT_TRUE(streamA->isBackfilling());
+    streamB->transitionStateToBackfilling();
+    ASSERT_TRUE(streamB->isBackfilling());
+    // Only one backfill was created.
+    EXPECT_EQ(backfills + 1, connMap.getNumActiveSnoozingBackfills());
+
+    auto& bfm = producer->getBFM();
+    bfm.backfill();
+    bfm.backfill();
+
+    auto checkStream = [](MockActiveStream& stream, int64_t first) {
+        auto resp = stream.public_popFromReadyQ();
+        ASSERT_TRUE(resp);
+        ASSERT_EQ(DcpResponse::Event::SnapshotMarker, resp->getEvent());
+        EXPECT_EQ(4, static_cast<SnapshotMarker&>(*resp).getEndSeqno());
+        for (int64_t seqno = first; seqno <= 4; ++seqno) {
+            resp = stream.public_popFromReadyQ();
+            ASSERT_TRUE(resp);
+            EXPECT_EQ(DcpResponse::Event::Mutation, resp->getEvent());
+            EXPECT_EQ(seqno, *resp->getBySeqno());
+        }
+        EXPECT_FALSE(stream.public_popFromReadyQ());
+    };
+    checkStream(*streamA, 1);
+    checkStream(*streamB, 3);
+
+    producer->cancelCheckpointCreatorTask();
+}
+
 /*
  * The following test checks to see if we call handleSlowStream when in a
  * backfilling state, but the backfillTask is not running, we
@@ -582,6 +794,62 @@ TEST_F(SingleThreadedEPBucketTest, MB22421_reregister_cursor) {
     producer->cancelCheckpointCreatorTask();
 }
 
+/*
+ * With dcp_producer_checkpoint_processor_tasks > 1, each vBucket is
+ * scheduled on one task (shard), and a task whose own queue is empty steals
+ * vBuckets from its siblings.
+ */
+TEST_F(SingleThreadedEPBucketTest, CheckpointProcessorTaskWorkStealing) {
+    engine->getConfiguration().setDcpProducerCheckpointProcessorTasks(2);
+    auto producer = createDcpProducer(cookie, IncludeDeleteTime::Yes);
+    ASSERT_TRUE(producer->getCheckpointSnapshotTask(1));
+    ASSERT_FALSE(producer->getCheckpointSnapshotTask(2));
+    auto& shard0 = *producer->getCheckpointSnapshotTask(0);
+    auto& shard1 = *producer->getCheckpointSnapshotTask(1);
+
+    // vb:0 and vb:2 are scheduled on shard 0, vb:1 on shard 1.
+    std::vector<std::shared_ptr<MockActiveStream>> streams;
+    for (uint16_t id = 0; id < 3; id++) {
+        Vbid vbid = Vbid(id);
+        setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+        auto vb = store->getVBucket(vbid);
+        auto stream = producer->mockActiveStreamRequest(/*flags*/ 0,
+                                                        /*opaque*/ 0,
+                                                        *vb,
+                                                        /*st_seqno*/ 0,
+                                                        /*en_seqno*/ ~0,
+                                                        /*vb_uuid*/ 0xabcd,
+                                                        /*snap_start_seqno*/ 0,
+                                                        /*snap_end_seqno*/ ~0);
+        EXPECT_FALSE(stream->next());
+        ASSERT_TRUE(stream->isInMemory());
+
+        EXPECT_TRUE(queueNewItem(*vb, "key1"));
+        EXPECT_EQ(std::make_pair(false, size_t(1)),
+                  getEPBucket().flushVBucket(vbid));
+        EXPECT_FALSE(stream->next());
+        streams.push_back(stream);
+    }
+    EXPECT_EQ(2, shard0.queueSize());
+    EXPECT_EQ(1, shard1.queueSize());
+
+    // Shard 1 processes vb:1, then (being idle) takes both of shard 0's.
+    shard1.run();
+    EXPECT_EQ(0, shard1.queueSize());
+    EXPECT_EQ(0, shard0.queueSize());
+    EXPECT_EQ(2, shard1.getStreamsStolen());
+    EXPECT_EQ(0, shard0.getStreamsStolen());
+
+    for (auto& stream : streams) {
+        auto result = stream->next();
+        ASSERT_TRUE(result) << stream->getVBucket();
+        EXPECT_EQ(DcpResponse::Event::SnapshotMarker, result->getEvent());
+        result = stream->next();
+        ASSERT_TRUE(result) << stream->getVBucket();
+        EXPECT_EQ(DcpResponse::Event::Mutation, result->getEvent());
+    }
+}
+
 /**
  * The following test checks to see that if a cursor drop (and subsequent
  * re-registration) is a safe operation in that the background checkpoint
@@ -1515,6 +1783,94 @@ TEST_F(SingleThreadedEPBucketTest, MB19815_doDcpVbTakeoverStats) {
               getEPBucket().flushVBucket(vbid));
 }
 
+/// Exposes the steps of the deletion task, so a test can stop part-way
+class MockVBucketMemoryAndDiskDeletionTask
+    : public VBucketMemoryAndDiskDeletionTask {
+public:
+    using VBucketMemoryAndDiskDeletionTask::VBucketMemoryAndDiskDeletionTask;
+    using VBucketMemoryAndDiskDeletionTask::clearMemory;
+
+    VBucket& getVBucket() {
+        return *vbucket;
+    }
+};
+
+/*
+ * A vBucket whose hash table has been partly cleared by the deletion task
+ * (the task yielded between lock stripes) must not hand out the freed
+ * StoredValues: lookups fail with an exception and visitors stop, until the
+ * task completes the clear.
+ */
+TEST_F(SingleThreadedEPBucketTest, FindAndVisitWhileDeletingVBucket) {
+    // A dead vBucket with no owner, as handed to the deletion task (it isn't
+    // in the vBucket map and has no file on disk).
+    const Vbid deadVbid(1);
+    auto* deadVb = new EPVBucket(
+            deadVbid,
+            vbucket_state_dead,
+            engine->getEpStats(),
+            engine->getCheckpointConfig(),
+            store->getVBuckets().getShardByVbId(deadVbid),
+            0,
+            0,
+            0,
+            /*table*/ nullptr,
+            /*flusher callback*/ nullptr,
+            /*newSeqnoCb*/ nullptr,
+            [](Vbid) {},
+            [](Vbid, std::chrono::steady_clock::time_point) {},
+            NoopSyncWriteCompleteCb,
+            NoopSeqnoAckCb,
+            engine->getConfiguration(),
+            store->getItemEvictionPolicy(),
+            std::make_unique<Collections::VB::Manifest>());
+    std::vector<StoredDocKey> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(makeStoredDocKey("key" + std::to_string(i)));
+        auto item = make_item(deadVbid, keys.back(), "value");
+        ASSERT_EQ(MutationStatus::WasClean, deadVb->ht.set(item));
+    }
+    auto& ht = deadVb->ht;
+    ASSERT_LT(1, ht.getNumLocks());
+
+    auto task = std::make_shared<MockVBucketMemoryAndDiskDeletionTask>(
+            *engine, *store->getVBuckets().getShardByVbId(deadVbid), deadVb);
+    ASSERT_EQ(deadVb, &task->getVBucket());
+
+    // The deadline has already passed: only the first stripe is cleared.
+    EXPECT_FALSE(task->clearMemory(std::chrono::steady_clock::now()));
+    EXPECT_FALSE(ht.isActive());
+    EXPECT_LT(0, ht.getNumItems());
+    EXPECT_GT(keys.size(), ht.getNumItems());
+
+    // Lookups don't return a (freed) StoredValue..
+    for (const auto& key : keys) {
+        EXPECT_THROW(ht.findForRead(key), std::logic_error);
+    }
+
+    // .. nor do visitors see any of the remaining items.
+    struct Visitor : public HashTableVisitor {
+        bool visit(const HashTable::HashBucketLock& lh,
+                   StoredValue& v) override {
+            ++visited;
+            return true;
+        }
+        size_t visited = 0;
+    } visitor;
+    ht.visit(visitor);
+    EXPECT_EQ(0, visitor.visited);
+
+    // The task finishes clearing the hash table, with the item counts (and
+    // memory) accounted for.
+    while (!task->clearMemory(std::chrono::steady_clock::now() +
+                              std::chrono::seconds(10))) {
+    }
+    EXPECT_EQ(0, ht.getNumItems());
+    EXPECT_EQ(0, ht.getItemMemory());
+    ht.visit(visitor);
+    EXPECT_EQ(0, visitor.visited);
+}
+
 /*
  * Test that
  * 1. We cannot create a stream against a dead vb (MB-17230)
@@ -1759,6 +2115,76 @@ TEST_F(SingleThreadedEPBucketTest, MB18452_yield_dcp_processor) {
     consumer->closeStream(/*opaque*/0, vbid);
 }
 
+/*
+ * Test that with dcp_consumer_processor_tasks > 1 the buffered items of each
+ * vBucket are only processed by the processor the vBucket belongs to.
+ */
+TEST_F(SingleThreadedEPBucketTest, dcp_consumer_processors_shard_vbuckets) {
+    engine->getConfiguration().setDcpConsumerProcessorTasks(2);
+    const Vbid vbid1(1);
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_replica);
+    setVBucketStateAndRunPersistTask(vbid1, vbucket_state_replica);
+
+    auto consumer = std::make_shared<MockDcpConsumer>(*engine, cookie, "test");
+    ASSERT_EQ(2, consumer->getNumProcessors());
+
+    // Force the streams to buffer rather than process messages immediately
+    const ssize_t queueCap =
+            engine->getEpStats().replicationThrottleWriteQueueCap;
+    engine->getEpStats().replicationThrottleWriteQueueCap = 0;
+
+    for (const auto vb : {vbid, vbid1}) {
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  consumer->addStream(/*opaque*/ 0, vb, /*flags*/ 0));
+        const uint32_t opaque = consumer->getVbucketStream(vb)->getOpaque();
+        consumer->snapshotMarker(opaque,
+                                 vb,
+                                 /*startseq*/ 0,
+                                 /*endseq*/ 1,
+                                 /*flags*/ 0,
+                                 /*HCS*/ {});
+        const DocKey docKey{"key", DocKeyEncodesCollectionId::No};
+        consumer->mutation(opaque,
+                           docKey,
+                           {},
+                           0, // privileged bytes
+                           PROTOCOL_BINARY_RAW_BYTES, // datatype
+                           0, // cas
+                           vb, // vbucket
+                           0, // flags
+                           1, // bySeqno
+                           0, // revSeqno
+                           0, // exptime
+                           0, // locktime
+                           {}, // meta
+                           0); // nru
+    }
+    engine->getEpStats().replicationThrottleWriteQueueCap = queueCap;
+
+    auto stream0 = static_cast<MockPassiveStream*>(
+            consumer->getVbucketStream(vbid).get());
+    auto stream1 = static_cast<MockPassiveStream*>(
+            consumer->getVbucketStream(vbid1).get());
+    ASSERT_EQ(2, stream0->getNumBufferItems());
+    ASSERT_EQ(2, stream1->getNumBufferItems());
+
+    consumer->public_notifyVbucketReady(vbid);
+    consumer->public_notifyVbucketReady(vbid1);
+
+    // vb:1 belongs to processor 1; processing it leaves vb:0 untouched.
+    EXPECT_EQ(more_to_process, consumer->processBufferedItems(1));
+    EXPECT_EQ(all_processed, consumer->processBufferedItems(1));
+    EXPECT_EQ(0, stream1->getNumBufferItems());
+    EXPECT_EQ(2, stream0->getNumBufferItems());
+
+    EXPECT_EQ(more_to_process, consumer->processBufferedItems(0));
+    EXPECT_EQ(all_processed, consumer->processBufferedItems(0));
+    EXPECT_EQ(0, stream0->getNumBufferItems());
+
+    consumer->closeStream(/*opaque*/ 0, vbid);
+    consumer->closeStream(/*opaque*/ 0, vbid1);
+}
+
 /**
  * MB-29861: Ensure that a delete time is generated for a document
  * that is received on the consumer side as a result of a disk
@@ -767,6 +767,55 @@ TEST_P(EPStoreEvictionTest, getIfOnlyFetchesMetaForFilterPositive) {
     }
 }
 
+/**
+ * Verify that under full eviction a get of a key which doesn't exist on disk
+ * records the key in the NegativeLookupCache (rather than leaving a temp
+ * item in the HashTable), and later gets are answered from the cache.
+ */
+TEST_P(EPStoreEvictionTest, GetMissingKeyUsesNegativeLookupCache) {
+    auto key = makeStoredDocKey("missing");
+    auto vb = store->getVBucket(vbid);
+    // Without a bloom filter every miss needs a background fetch.
+    vb->clearFilter();
+
+    auto options = static_cast<get_options_t>(
+            QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | DELETE_TEMP |
+            HIDE_LOCKED_CAS | TRACK_STATISTICS);
+    auto& stats = engine->getEpStats();
+
+    if (GetParam() == "value_only") {
+        EXPECT_FALSE(vb->ht.isNegativeLookupCacheEnabled());
+        EXPECT_EQ(ENGINE_KEY_ENOENT,
+                  store->get(key, vbid, cookie, options).getStatus());
+        return;
+    }
+
+    ASSERT_TRUE(vb->ht.isNegativeLookupCacheEnabled());
+    EXPECT_EQ(ENGINE_EWOULDBLOCK,
+              store->get(key, vbid, cookie, options).getStatus());
+    EXPECT_EQ(1, vb->getNumTempItems());
+
+    runBGFetcherTask();
+    EXPECT_EQ(1, stats.bg_fetched);
+    EXPECT_EQ(0, vb->getNumTempItems());
+    EXPECT_EQ(1, vb->ht.getNegativeLookupCacheSize());
+
+    // Answered from the cache - no temp item or background fetch.
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              store->get(key, vbid, cookie, options).getStatus());
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              store->get(key, vbid, cookie, options).getStatus());
+    EXPECT_EQ(2, stats.negativeLookupCacheHits);
+    EXPECT_EQ(0, vb->getNumTempItems());
+    EXPECT_EQ(1, stats.bg_fetched);
+
+    // Storing the key removes it from the cache.
+    store_item(vbid, key, "value");
+    EXPECT_EQ(0, vb->ht.getNegativeLookupCacheSize());
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->get(key, vbid, cookie, options).getStatus());
+}
+
 /**
  * Verify that a get of a deleted item with no value successfully
  * returns an item
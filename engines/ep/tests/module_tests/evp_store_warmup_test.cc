@@ -30,10 +30,14 @@
 #include "failover-table.h"
 #include "kvstore.h"
 #include "programs/engine_testapp/mock_server.h"
+#include "resident_image.h"
 #include "test_helpers.h"
+#include "tracing/trace_helpers.h"
 #include "vbucket_state.h"
 #include "warmup.h"
 
+#include <platform/dirutils.h>
+
 class WarmupTest : public SingleThreadedKVBucketTest {
 public:
     void MB_31450(bool newCheckpoint);
@@ -794,6 +798,12 @@ void DurabilityWarmupTest::testPendingSyncWrite(
         EXPECT_TRUE(prepared.storedValue->isPending());
         EXPECT_EQ(item->isDeleted(), prepared.storedValue->isDeleted());
         EXPECT_EQ(item->getCas(), prepared.storedValue->getCas());
+        // The prepare's value is read separately from the (keys only) scan.
+        if (docState == DocumentState::Alive) {
+            ASSERT_TRUE(prepared.storedValue->getValue());
+            EXPECT_EQ("pending_value",
+                      prepared.storedValue->getValue()->to_s());
+        }
 
         // DurabilityMonitor be tracking the prepare.
         EXPECT_EQ(++numTracked, vb->getDurabilityMonitor().getNumTracked());
@@ -1797,6 +1807,132 @@ TEST_F(WarmupTest, MB_35326) {
     flush_vbucket_to_disk(vbid);
 }
 
+// The warmup timeline records every phase warmup went through, and what
+// each loading phase loaded (in total and per shard).
+TEST_F(WarmupTest, Timeline) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    store_item(vbid, makeStoredDocKey("key"), "value");
+    flush_vbucket_to_disk(vbid);
+    resetEngineAndWarmup();
+
+    struct StatMap : cb::tracing::Traceable {
+        std::map<std::string, std::string> map;
+    };
+    StatMap stats;
+    auto add_stats = [](const char* key,
+                        const uint16_t klen,
+                        const char* val,
+                        const uint32_t vlen,
+                        gsl::not_null<const void*> cookie) {
+        auto* stats =
+                reinterpret_cast<StatMap*>(const_cast<void*>(cookie.get()));
+        stats->map[std::string(key, klen)] = std::string(val, vlen);
+    };
+    const std::string key = "warmup timeline";
+    ASSERT_EQ(ENGINE_SUCCESS,
+              engine->get_stats(&stats, {key.data(), key.size()}, {}, add_stats));
+
+    for (const auto* phase : {"initialize", "key_dump", "done"}) {
+        const std::string prefix = std::string("ep_warmup_") + phase + "_";
+        EXPECT_EQ(1, stats.map.count(prefix + "start")) << phase;
+        EXPECT_EQ(1, stats.map.count(prefix + "duration")) << phase;
+    }
+    EXPECT_EQ("1", stats.map["ep_warmup_key_dump_items"]);
+    // vbid is in shard 0.
+    EXPECT_EQ("1", stats.map["ep_warmup_key_dump_shard_0_items"]);
+    EXPECT_EQ(1, stats.map.count("ep_warmup_key_dump_read_time"));
+    EXPECT_EQ(1, stats.map.count("ep_warmup_key_dump_insert_time"));
+}
+
+class SingleShardWarmupTest : public WarmupTest {
+protected:
+    void SetUp() override {
+        config_string += "max_num_shards=1";
+        WarmupTest::SetUp();
+    }
+};
+
+// The per-vBucket loading phases aren't limited to a task per shard; with all
+// the vBuckets in one shard, they are still spread over the reader threads.
+TEST_F(SingleShardWarmupTest, LoadingNotLimitedToTaskPerShard) {
+    const size_t numVBuckets = 4;
+    for (size_t ii = 0; ii < numVBuckets; ii++) {
+        const Vbid id(ii);
+        setVBucketStateAndRunPersistTask(id, vbucket_state_active);
+        store_item(id, makeStoredDocKey("key"), "value");
+        flush_vbucket_to_disk(id);
+    }
+
+    resetEngineAndEnableWarmup();
+    auto* warmupPtr = store->getWarmup();
+    auto& readerQueue = *task_executor->getLpTaskQ()[READER_TASK_IDX];
+    while (warmupPtr->getWarmupState() != WarmupState::State::KeyDump) {
+        runNextTask(readerQueue);
+    }
+    EXPECT_GE(readerQueue.getFutureQueueSize(), numVBuckets);
+
+    runReadersUntilWarmedUp();
+    for (size_t ii = 0; ii < numVBuckets; ii++) {
+        auto gv = store->get(
+                makeStoredDocKey("key"), Vbid(ii), cookie, QUEUE_BG_FETCH);
+        EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    }
+}
+
+class ResidentImageWarmupTest : public WarmupTest {
+protected:
+    void SetUp() override {
+        config_string += "warmup_resident_image=true";
+        WarmupTest::SetUp();
+    }
+};
+
+// A clean shutdown saves an image of the HashTable, which warmup then loads
+// in place of scanning the data file.
+TEST_F(ResidentImageWarmupTest, LoadedAtWarmup) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    store_item(vbid, makeStoredDocKey("key1"), "value1");
+    store_item(vbid, makeStoredDocKey("key2"), "value2");
+    flush_vbucket_to_disk(vbid, 2);
+
+    resetEngineAndWarmup();
+    EXPECT_EQ(1, store->getWarmup()->getResidentImagesLoaded());
+    // An image is only used once.
+    EXPECT_FALSE(cb::io::isFile(ResidentImage::getPath(test_dbname, vbid)));
+
+    auto vb = store->getVBucket(vbid);
+    EXPECT_EQ(2, vb->getNumItems());
+    for (const auto* key : {"key1", "key2"}) {
+        auto gv = store->get(
+                makeStoredDocKey(key), vbid, cookie, get_options_t::NONE);
+        EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus()) << key;
+    }
+}
+
+// An invalid image is ignored (and removed), and the data file scanned.
+TEST_F(ResidentImageWarmupTest, InvalidImageIgnored) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    store_item(vbid, makeStoredDocKey("key1"), "value1");
+    flush_vbucket_to_disk(vbid);
+
+    resetEngineAndEnableWarmup();
+    const auto path = ResidentImage::getPath(test_dbname, vbid);
+    ASSERT_TRUE(cb::io::isFile(path));
+    {
+        FILE* file = fopen(path.c_str(), "wb");
+        ASSERT_NE(nullptr, file);
+        fputs("not an image", file);
+        fclose(file);
+    }
+
+    runReadersUntilWarmedUp();
+    EXPECT_EQ(0, store->getWarmup()->getResidentImagesLoaded());
+    EXPECT_FALSE(cb::io::isFile(path));
+    auto gv = store->get(
+            makeStoredDocKey("key1"), vbid, cookie, get_options_t::NONE);
+    EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+}
+
 INSTANTIATE_TEST_CASE_P(FullOrValue,
                         MB_34718_WarmupTest,
                         STParameterizedBucketTest::persistentConfigValues(),
@@ -1351,7 +1351,7 @@ TEST_P(DelWithMetaTest, setting_zero_deleteTime) {
                                  deleted,
                                  datatype));
     MockGlobalTask mockTask(engine->getTaskable(), TaskId::MultiBGFetcherTask);
-    store->getVBucket(vbid)->getShard()->getBgFetcher()->run(&mockTask);
+    static_cast<EPBucket&>(*store).getBgFetcher(vbid)->run(&mockTask);
     EXPECT_EQ(ENGINE_SUCCESS,
               store->getMetaData({"mykey", DocKeyEncodesCollectionId::No},
                                  vbid,
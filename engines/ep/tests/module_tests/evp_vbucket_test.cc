@@ -43,8 +43,8 @@ size_t EPVBucketTest::public_queueBGFetchItem(
 }
 
 /**
- * To test the BgFetcher with a VBucket we need references to an EPBucket and
- * a KVShard. The easiest way to create these is to create an entire engine...
+ * To test the BgFetcher with a VBucket we need a reference to an EPBucket.
+ * The easiest way to create one is to create an entire engine...
  *
  * Measure performance of VBucket::getBGFetchItems - queue and then get
  * 100,000 items from the vbucket.
@@ -54,8 +54,7 @@ TEST_P(EPVBucketTest, GetBGFetchItemsPerformance) {
     // bgFetcher
     auto mockEPBucket =
             engine->public_makeMockBucket(engine->getConfiguration());
-    KVShard kvShard(0, engine->getConfiguration());
-    BgFetcher bgFetcher(*mockEPBucket.get(), kvShard);
+    BgFetcher bgFetcher(*mockEPBucket.get());
 
     for (unsigned int ii = 0; ii < 100000; ii++) {
         auto fetchItem = std::make_unique<VBucketBGFetchItem>(nullptr,
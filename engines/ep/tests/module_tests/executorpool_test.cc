@@ -22,6 +22,8 @@
 #include "executorpool_test.h"
 #include "lambda_task.h"
 
+#include <atomic>
+
 MockTaskable::MockTaskable() : policy(HIGH_BUCKET_PRIORITY, 1) {
 }
 
@@ -52,6 +54,10 @@ void MockTaskable::logRunTime(
         TaskId id, const std::chrono::steady_clock::duration runTime) {
 }
 
+void MockTaskable::logCpuTime(TaskId id,
+                              const std::chrono::nanoseconds cpuTime) {
+}
+
 ExTask makeTask(Taskable& taskable, ThreadGate& tg, size_t i) {
     return std::make_shared<LambdaTask>(
             taskable, TaskId::StatSnap, 0, true, [&]() -> bool {
@@ -250,6 +256,51 @@ TEST_F(ExecutorPoolDynamicWorkerTest, reschedule_dead_task) {
     EXPECT_EQ(2, runCount);
 }
 
+/* Background reader tasks (here FetchAllKeysTask) must leave the reserved
+ * reader thread free for BgFetch tasks, and not run concurrently on it.
+ */
+TEST_F(ExecutorPoolDynamicWorkerTest, ReaderThreadReservedForBgFetch) {
+    pool->setNumReadersReservedForBgFetch(1);
+    ASSERT_EQ(1, pool->getMaxBackgroundReaders());
+
+    // The first Background read can only finish once the BgFetch has run.
+    tg = std::make_unique<ThreadGate>(2);
+    std::atomic<int> backgroundRunning{0};
+    std::atomic<bool> backgroundOverlapped{false};
+    auto runBackground = [this, &backgroundRunning, &backgroundOverlapped](
+                                 bool waitForBgFetch) {
+        if (++backgroundRunning > 1) {
+            backgroundOverlapped = true;
+        }
+        if (waitForBgFetch) {
+            tg->threadUp();
+        }
+        --backgroundRunning;
+        return false;
+    };
+
+    pool->schedule(std::make_shared<LambdaTask>(
+            taskable, TaskId::FetchAllKeysTask, 0, true, [&runBackground] {
+                return runBackground(true);
+            }));
+    while (backgroundRunning == 0) {
+        std::this_thread::yield();
+    }
+    pool->schedule(std::make_shared<LambdaTask>(
+            taskable, TaskId::FetchAllKeysTask, 0, true, [&runBackground] {
+                return runBackground(false);
+            }));
+    pool->schedule(std::make_shared<LambdaTask>(
+            taskable, TaskId::MultiBGFetcherTask, 0, true, [this] {
+                tg->threadUp();
+                return false;
+            }));
+
+    pool->waitForEmptyTaskLocator();
+    EXPECT_TRUE(tg->isComplete());
+    EXPECT_FALSE(backgroundOverlapped);
+}
+
 /* Testing to ensure that repeatedly scheduling a task does not result in
  * multiple entries in the taskQueue - this could cause a deadlock in
  * _unregisterTaskable when the taskLocator is empty but duplicate tasks remain
@@ -48,6 +48,8 @@ public:
     void logRunTime(TaskId id,
                     const std::chrono::steady_clock::duration runTime);
 
+    void logCpuTime(TaskId id, const std::chrono::nanoseconds cpuTime);
+
 protected:
     std::string name;
     WorkLoadPolicy policy;
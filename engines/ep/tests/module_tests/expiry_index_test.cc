@@ -0,0 +1,55 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "expiry_index.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+
+TEST(ExpiryIndexTest, TakeDue) {
+    ExpiryIndex index;
+    const time_t base = 1000 * ExpiryIndex::SlotWidth;
+    index.add(makeStoredDocKey("a"), base + 1);
+    index.add(makeStoredDocKey("b"), base + ExpiryIndex::SlotWidth);
+    index.add(makeStoredDocKey("c"), base + 10 * ExpiryIndex::SlotWidth);
+    EXPECT_EQ(3, index.size());
+
+    // Nothing is due before the start of the first slot
+    EXPECT_TRUE(index.takeDue(base - 1).empty());
+
+    // The whole slot is returned once it's started (even if a key in it
+    // hasn't expired yet)
+    auto due = index.takeDue(base);
+    ASSERT_EQ(1, due.size());
+    EXPECT_EQ(makeStoredDocKey("a"), due.front());
+    EXPECT_EQ(2, index.size());
+
+    due = index.takeDue(base + 100 * ExpiryIndex::SlotWidth);
+    ASSERT_EQ(2, due.size());
+    EXPECT_EQ(makeStoredDocKey("b"), due[0]);
+    EXPECT_EQ(makeStoredDocKey("c"), due[1]);
+    EXPECT_EQ(0, index.size());
+    EXPECT_TRUE(index.takeDue(base + 100 * ExpiryIndex::SlotWidth).empty());
+}
+
+TEST(ExpiryIndexTest, DuplicateKeys) {
+    // The index doesn't remove the old entry when a key is re-added
+    ExpiryIndex index;
+    index.add(makeStoredDocKey("a"), 100);
+    index.add(makeStoredDocKey("a"), 100);
+    EXPECT_EQ(2, index.takeDue(100).size());
+}
@@ -22,6 +22,7 @@
 
 #include <engines/ep/src/bucket_logger.h>
 #include <folly/portability/GTest.h>
+#include <gsl/gsl>
 #include <programs/engine_testapp/mock_server.h>
 
 class FlusherTest : public ::testing::Test {
@@ -55,11 +56,11 @@ protected:
     // Non-owning poitner to SingleThreadedExecutorPool.
     SingleThreadedExecutorPool* task_executor;
 
-    // Non-owning pointer to first shard's flusher.
+    // Non-owning pointer to the flusher of vBucket 0.
     Flusher* flusher;
 
     static constexpr const char* flusherName =
-            "Running a flusher loop: shard 0";
+            "Running a flusher loop: flusher 0";
 };
 
 // Regression test for MB-36380 - if the Flusher receives a wakeup for a vBucket
@@ -87,3 +88,58 @@ TEST_F(FlusherTest, MissingWakeupBeforeSnooze) {
     // Check the Flusher is indeed ready to run a second time.
     task_executor->runNextTask(WRITER_TASK_IDX, flusherName);
 }
+
+// With a step time limit configured the Flusher should flush all of the
+// vBuckets with outstanding items in a single run of its task.
+TEST_F(FlusherTest, StepTimeLimitFlushesMultipleVBuckets) {
+    auto& bucket = *engine->getKVBucket();
+    const Vbid vb0(0);
+    const Vbid vb1(gsl::narrow<uint16_t>(bucket.getVBuckets().getNumShards()));
+    engine->getConfiguration().setFlusherStepTimeLimit(60000);
+
+    bucket.setVBucketState(vb0, vbucket_state_active);
+    bucket.setVBucketState(vb1, vbucket_state_active);
+    flusher->notifyFlushEvent();
+    ASSERT_EQ(2, engine->getEpStats().diskQueueSize);
+
+    task_executor->runNextTask(WRITER_TASK_IDX, flusherName);
+    EXPECT_EQ(0, engine->getEpStats().diskQueueSize);
+}
+
+// By default the Flusher flushes one vBucket per run of its task.
+TEST_F(FlusherTest, DefaultFlushesOneVBucketPerStep) {
+    auto& bucket = *engine->getKVBucket();
+    const Vbid vb0(0);
+    const Vbid vb1(gsl::narrow<uint16_t>(bucket.getVBuckets().getNumShards()));
+
+    bucket.setVBucketState(vb0, vbucket_state_active);
+    bucket.setVBucketState(vb1, vbucket_state_active);
+    flusher->notifyFlushEvent();
+    ASSERT_EQ(2, engine->getEpStats().diskQueueSize);
+
+    task_executor->runNextTask(WRITER_TASK_IDX, flusherName);
+    EXPECT_EQ(1, engine->getEpStats().diskQueueSize);
+    task_executor->runNextTask(WRITER_TASK_IDX, flusherName);
+    EXPECT_EQ(0, engine->getEpStats().diskQueueSize);
+}
+
+// With a single flusher configured, the vBuckets of all of the shards are
+// persisted by the same Flusher.
+TEST_F(FlusherTest, SingleFlusherFlushesAllShards) {
+    auto& bucket = *engine->getKVBucket();
+    const Vbid vb0(0);
+    const Vbid vb1(1);
+    ASSERT_NE(bucket.getVBuckets().getShardByVbId(vb0),
+              bucket.getVBuckets().getShardByVbId(vb1));
+    engine->getConfiguration().setMaxNumFlushers(1);
+    engine->getConfiguration().setFlusherStepTimeLimit(60000);
+    EXPECT_EQ(flusher, bucket.getFlusher(vb1));
+
+    bucket.setVBucketState(vb0, vbucket_state_active);
+    bucket.setVBucketState(vb1, vbucket_state_active);
+    flusher->notifyFlushEvent();
+    ASSERT_EQ(2, engine->getEpStats().diskQueueSize);
+
+    task_executor->runNextTask(WRITER_TASK_IDX, flusherName);
+    EXPECT_EQ(0, engine->getEpStats().diskQueueSize);
+}
@@ -21,9 +21,12 @@
 #include "tests/module_tests/executorpool_test.h"
 #include "tests/module_tests/test_task.h"
 
+#include <algorithm>
+#include <vector>
+
 class FutureQueueTest : public ::testing::TestWithParam<std::string> {
 public:
-    FutureQueue<> queue;
+    FutureQueue queue;
     MockTaskable taskable;
 };
 
@@ -224,3 +227,90 @@ TEST_F(FutureQueueTest, taskNotInQueue) {
     EXPECT_EQ(-1,
               static_cast<TestTask*>(queue.top().get())->order);
 }
+
+/*
+ * The lock-free earliest waketime tracks top() across push, pop and
+ * wakeTime updates.
+ */
+TEST_F(FutureQueueTest, earliestWaketime) {
+    using time_point = std::chrono::steady_clock::time_point;
+    EXPECT_EQ(time_point::max(), queue.getEarliestWaketime());
+
+    ExTask task1 = std::make_shared<TestTask>(
+            taskable, TaskId::PendingOpsNotification, 1);
+    task1->updateWaketime(time_point(std::chrono::nanoseconds(10)));
+    queue.push(task1);
+    EXPECT_EQ(time_point(std::chrono::nanoseconds(10)),
+              queue.getEarliestWaketime());
+
+    ExTask task2 = std::make_shared<TestTask>(
+            taskable, TaskId::PendingOpsNotification, 2);
+    task2->updateWaketime(time_point(std::chrono::nanoseconds(20)));
+    queue.push(task2);
+    EXPECT_EQ(time_point(std::chrono::nanoseconds(10)),
+              queue.getEarliestWaketime());
+
+    EXPECT_TRUE(queue.updateWaketime(task2,
+                                     time_point(std::chrono::nanoseconds(5))));
+    EXPECT_EQ(time_point(std::chrono::nanoseconds(5)),
+              queue.getEarliestWaketime());
+
+    queue.pop();
+    EXPECT_EQ(time_point(std::chrono::nanoseconds(10)),
+              queue.getEarliestWaketime());
+
+    queue.pop();
+    EXPECT_EQ(time_point::max(), queue.getEarliestWaketime());
+}
+
+/*
+ * Push tasks with wakeTimes spread from nanoseconds to days apart, so they
+ * land at every level of the timer wheel and in its overflow list, and check
+ * they are popped in wakeTime order.
+ */
+TEST_F(FutureQueueTest, wheelOrder) {
+    using namespace std::chrono;
+    const std::vector<nanoseconds> times = {hours(24 * 30),
+                                            nanoseconds(3),
+                                            milliseconds(70),
+                                            seconds(5),
+                                            nanoseconds(1),
+                                            hours(2),
+                                            milliseconds(1),
+                                            minutes(3),
+                                            hours(24 * 10),
+                                            microseconds(10),
+                                            seconds(5),
+                                            milliseconds(64)};
+    for (size_t ii = 0; ii < times.size(); ii++) {
+        ExTask task = std::make_shared<TestTask>(
+                taskable, TaskId::PendingOpsNotification, ii);
+        task->updateWaketime(steady_clock::time_point(times[ii]));
+        queue.push(task);
+    }
+    queue.assertInvariants();
+    EXPECT_EQ(times.size(), queue.size());
+
+    auto sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    for (const auto& time : sorted) {
+        ASSERT_FALSE(queue.empty());
+        EXPECT_EQ(steady_clock::time_point(time), queue.top()->getWaketime());
+        EXPECT_EQ(steady_clock::time_point(time), queue.getEarliestWaketime());
+        queue.pop();
+        queue.assertInvariants();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(FutureQueueTest, roundUpToTick) {
+    using namespace std::chrono;
+    const auto tick = FutureQueue::tickDuration;
+    EXPECT_EQ(steady_clock::time_point(tick),
+              FutureQueue::roundUpToTick(steady_clock::time_point(tick)));
+    EXPECT_EQ(steady_clock::time_point(tick * 2),
+              FutureQueue::roundUpToTick(
+                      steady_clock::time_point(tick + nanoseconds(1))));
+    EXPECT_EQ(steady_clock::time_point::max(),
+              FutureQueue::roundUpToTick(steady_clock::time_point::max()));
+}
@@ -19,6 +19,7 @@
 #include "item.h"
 #include "item_freq_decayer_visitor.h"
 #include "kv_bucket.h"
+#include "random_key_sampler.h"
 #include "programs/engine_testapp/mock_server.h"
 #include "stats.h"
 #include "stored_value_factories.h"
@@ -32,7 +33,9 @@
 #include <signal.h>
 #include <algorithm>
 #include <limits>
+#include <map>
 #include <string>
+#include <thread>
 
 EPStats global_stats;
 
@@ -292,6 +295,54 @@ TEST_F(HashTableTest, ConcurrentAccessResize) {
     getCompletedThreads(4, &gen);
 }
 
+// With per-core stats, items counted by one thread (core) and uncounted by
+// another must still sum to the correct totals.
+TEST_F(HashTableTest, ConcurrentStatsUpdates) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                3,
+                HashTable::BucketLayout::Chained,
+                cb::HugePageMode::None,
+                /*perCoreStats*/ true);
+    const int numThreads = 4;
+    const int keysPerThread = 500;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&h, t]() {
+            auto keys = generateKeys((t + 1) * keysPerThread,
+                                     t * keysPerThread);
+            storeMany(h, keys);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+    EXPECT_EQ(numThreads * keysPerThread, h.getNumItems());
+    EXPECT_EQ(numThreads * keysPerThread,
+              h.getDatatypeCounts()[PROTOCOL_BINARY_RAW_BYTES]);
+    EXPECT_LT(0, h.getItemMemory());
+
+    // Delete each thread's keys from a different thread.
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&h, t]() {
+            const int start = ((t + 1) % numThreads) * keysPerThread;
+            for (const auto& key : generateKeys(start + keysPerThread, start)) {
+                EXPECT_TRUE(del(h, key));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(0, h.getNumItems());
+    EXPECT_EQ(0, h.getDatatypeCounts()[PROTOCOL_BINARY_RAW_BYTES]);
+    EXPECT_EQ(0, h.getItemMemory());
+    EXPECT_EQ(0, h.getCacheSize());
+}
+
 TEST_F(HashTableTest, AutoResize) {
     HashTable h(global_stats, makeFactory(), 5, 3);
 
@@ -320,6 +371,19 @@ TEST_F(HashTableTest, DepthCounting) {
     EXPECT_GT(depthCounter.max, 1000);
 }
 
+TEST_F(HashTableTest, VisitSample) {
+    HashTable h(global_stats, makeFactory(), 47, 1);
+    Counter empty(true);
+    EXPECT_EQ(0, h.visitSample(empty, 10, 1));
+    EXPECT_EQ(0, empty.count);
+
+    auto keys = generateKeys(500);
+    storeMany(h, keys);
+    Counter sample(true);
+    EXPECT_EQ(10, h.visitSample(sample, 10, 1));
+    EXPECT_EQ(10, sample.count);
+}
+
 TEST_F(HashTableTest, PoisonKey) {
     HashTable h(global_stats, makeFactory(), 5, 1);
 
@@ -368,6 +432,7 @@ protected:
 
     void TearDown() override {
         EXPECT_EQ(0, ht.getItemMemory());
+        EXPECT_EQ(0, ht.getCollectionItemMemory(key.getCollectionID()));
         EXPECT_EQ(0, ht.getUncompressedItemMemory());
         EXPECT_EQ(0, ht.getCacheSize());
         EXPECT_EQ(initialSize, stats.getCurrentSize());
@@ -413,6 +478,25 @@ TEST_P(HashTableStatsTest, Size) {
     del(ht, key);
 }
 
+TEST_P(HashTableStatsTest, CollectionItemMemory) {
+    EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
+    const auto defaultMem = ht.getItemMemory();
+    EXPECT_EQ(defaultMem, ht.getCollectionItemMemory(key.getCollectionID()));
+
+    const auto otherKey = makeStoredDocKey("key", CollectionID(8));
+    Item other(otherKey, 0, 0, "value", 5);
+    other.setBySeqno(11);
+    EXPECT_EQ(MutationStatus::WasClean, ht.set(other));
+    EXPECT_EQ(defaultMem, ht.getCollectionItemMemory(key.getCollectionID()));
+    EXPECT_EQ(ht.getItemMemory() - defaultMem,
+              ht.getCollectionItemMemory(CollectionID(8)));
+    EXPECT_EQ(0, ht.getCollectionItemMemory(CollectionID(9)));
+
+    del(ht, otherKey);
+    EXPECT_EQ(0, ht.getCollectionItemMemory(CollectionID(8)));
+    del(ht, key);
+}
+
 TEST_P(HashTableStatsTest, SizeFlush) {
     EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
 
@@ -1188,3 +1272,588 @@ TEST_F(HashTableTest, InsertFromWarmupAlreadyResident) {
                                   /*keyMetaOnly*/ false,
                                   EvictionPolicy::Full));
 }
+
+// Tests for HashTable::BucketLayout::Tagged - the tag index must be kept in
+// step with the bucket chains across all operations which (re)link
+// StoredValues.
+
+TEST_F(HashTableTest, TaggedFind) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                1,
+                HashTable::BucketLayout::Tagged);
+    ASSERT_EQ(HashTable::BucketLayout::Tagged, h.getBucketLayout());
+    // 1000 keys into 5 buckets - all groups overflow, exercising the chain
+    // fallback.
+    testFind(h);
+    EXPECT_EQ(1000, count(h));
+}
+
+TEST_F(HashTableTest, TaggedResize) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                3,
+                HashTable::BucketLayout::Tagged);
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+    verifyFound(h, keys);
+
+    // Grow so the majority of buckets are served by their tag group.
+    h.resize(6143);
+    EXPECT_EQ(6143, h.getSize());
+    verifyFound(h, keys);
+
+    h.resize(769);
+    verifyFound(h, keys);
+}
+
+TEST_F(HashTableTest, TaggedDeletions) {
+    HashTable h(global_stats,
+                makeFactory(),
+                47,
+                1,
+                HashTable::BucketLayout::Tagged);
+    const int nkeys = 1000;
+    auto keys = generateKeys(nkeys);
+    storeMany(h, keys);
+
+    // Delete every other key; the remainder must all still be found (groups
+    // are rebuilt as chains shrink below the group size).
+    std::vector<StoredDocKey> remaining;
+    for (int i = 0; i < nkeys; ++i) {
+        if (i % 2) {
+            EXPECT_TRUE(del(h, keys[i]));
+        } else {
+            remaining.push_back(keys[i]);
+        }
+    }
+    verifyFound(h, remaining);
+    for (int i = 1; i < nkeys; i += 2) {
+        EXPECT_FALSE(h.findForRead(keys[i]).storedValue);
+    }
+
+    for (const auto& key : remaining) {
+        EXPECT_TRUE(del(h, key));
+    }
+    EXPECT_EQ(0, count(h));
+}
+
+TEST_F(HashTableTest, TaggedReallocateAndReplace) {
+    HashTable h(global_stats,
+                makeFactory(true),
+                1543,
+                1,
+                HashTable::BucketLayout::Tagged);
+    auto keys = generateKeys(10);
+    storeMany(h, keys);
+
+    for (const auto& key : keys) {
+        auto* v = h.findForWrite(key, WantsDeleted::No).storedValue;
+        ASSERT_NE(nullptr, v);
+        EXPECT_TRUE(h.reallocateStoredValue(std::forward<StoredValue>(*v)));
+        auto* reallocated = h.findForWrite(key, WantsDeleted::No).storedValue;
+        ASSERT_NE(nullptr, reallocated);
+        EXPECT_NE(v, reallocated);
+    }
+
+    // Replace by copy must also be visible via the index.
+    auto res = h.findForWrite(keys[0]);
+    ASSERT_TRUE(res.storedValue);
+    auto replaced = h.unlocked_replaceByCopy(res.lock, *res.storedValue);
+    EXPECT_NE(replaced.first, replaced.second.get().get());
+    res.lock.getHTLock().unlock();
+    EXPECT_EQ(replaced.first, h.findForWrite(keys[0]).storedValue);
+}
+
+TEST_F(HashTableTest, TaggedMemorySize) {
+    HashTable chained(global_stats, makeFactory(), 47, 1);
+    HashTable tagged(global_stats,
+                     makeFactory(),
+                     47,
+                     1,
+                     HashTable::BucketLayout::Tagged);
+    EXPECT_EQ(chained.memorySize() +
+                      47 * sizeof(HashTableTagIndex::Group),
+              tagged.memorySize());
+}
+
+// Tests for the KeyDirectory - keys ejected under full eviction are recorded
+// until they are added back to the HashTable.
+
+static void ejectKey(HashTable& h, const StoredDocKey& key) {
+    auto res = h.findForWrite(key);
+    ASSERT_TRUE(res.storedValue);
+    res.storedValue->markClean();
+    ASSERT_TRUE(h.unlocked_ejectItem(
+            res.lock, res.storedValue, EvictionPolicy::Full));
+}
+
+TEST_F(HashTableTest, KeyDirectoryRecordsEvictedKeys) {
+    HashTable h(global_stats, makeFactory(), 47, 1);
+    h.enableKeyDirectory();
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+    EXPECT_EQ(0, h.getKeyDirectorySize());
+
+    int64_t seqno = 1;
+    for (const auto& key : keys) {
+        h.findForWrite(key).storedValue->setBySeqno(seqno++);
+        ejectKey(h, key);
+    }
+    EXPECT_EQ(1000, h.getKeyDirectorySize());
+    EXPECT_EQ(0, h.getNumInMemoryItems());
+
+    seqno = 1;
+    for (const auto& key : keys) {
+        auto found = h.findInKeyDirectory(key);
+        ASSERT_TRUE(found) << key.to_string();
+        EXPECT_EQ(seqno++, *found);
+    }
+    EXPECT_FALSE(h.findInKeyDirectory(makeStoredDocKey("missing")));
+
+    // Adding a key back to the HashTable removes it from the directory.
+    store(h, keys[0]);
+    EXPECT_FALSE(h.findInKeyDirectory(keys[0]));
+    EXPECT_EQ(999, h.getKeyDirectorySize());
+
+    h.clearKeyDirectory();
+    EXPECT_EQ(0, h.getKeyDirectorySize());
+    EXPECT_FALSE(h.findInKeyDirectory(keys[1]));
+}
+
+TEST_F(HashTableTest, KeyDirectorySkipsItemsWithExpiry) {
+    HashTable h(global_stats, makeFactory(), 47, 1);
+    h.enableKeyDirectory();
+    auto key = makeStoredDocKey("key");
+    Item item(key, 0, /*exptime*/ 1000, "value", 5);
+    ASSERT_EQ(MutationStatus::WasClean, h.set(item));
+    ejectKey(h, key);
+    EXPECT_FALSE(h.findInKeyDirectory(key));
+    EXPECT_EQ(0, h.getKeyDirectorySize());
+}
+
+TEST_F(HashTableTest, KeyDirectoryDisabledByDefault) {
+    HashTable h(global_stats, makeFactory(), 47, 1);
+    EXPECT_FALSE(h.isKeyDirectoryEnabled());
+    auto key = makeStoredDocKey("key");
+    store(h, key);
+    ejectKey(h, key);
+    EXPECT_FALSE(h.findInKeyDirectory(key));
+    EXPECT_EQ(0, h.getKeyDirectoryMemory());
+}
+
+// Tests for the NegativeLookupCache - keys recorded as missing until a
+// StoredValue for them is added to the HashTable.
+
+TEST_F(HashTableTest, NegativeLookupCacheForgetsAddedKeys) {
+    HashTable h(global_stats, makeFactory(), 47, 1);
+    h.enableNegativeLookupCache(1024);
+    auto keys = generateKeys(100);
+    for (const auto& key : keys) {
+        h.recordNonExistent(key);
+    }
+    EXPECT_EQ(100, h.getNegativeLookupCacheSize());
+    for (const auto& key : keys) {
+        EXPECT_TRUE(h.isKnownNonExistent(key)) << key.to_string();
+    }
+    EXPECT_FALSE(h.isKnownNonExistent(makeStoredDocKey("other")));
+
+    // Adding a key to the HashTable removes it from the cache.
+    store(h, keys[0]);
+    EXPECT_FALSE(h.isKnownNonExistent(keys[0]));
+    EXPECT_EQ(99, h.getNegativeLookupCacheSize());
+
+    h.clearNegativeLookupCache();
+    EXPECT_EQ(0, h.getNegativeLookupCacheSize());
+    EXPECT_FALSE(h.isKnownNonExistent(keys[1]));
+}
+
+TEST_F(HashTableTest, NegativeLookupCacheIsBounded) {
+    NegativeLookupCache cache(64);
+    EXPECT_EQ(64, cache.getCapacity());
+    const auto memory = cache.memorySize();
+
+    auto keys = generateKeys(1000);
+    for (const auto& key : keys) {
+        cache.insert(key);
+    }
+    EXPECT_LE(cache.size(), cache.getCapacity());
+    EXPECT_EQ(memory, cache.memorySize());
+    // The most recently recorded key is always present.
+    EXPECT_TRUE(cache.contains(keys.back()));
+}
+
+TEST_F(HashTableTest, NegativeLookupCacheDisabledByDefault) {
+    HashTable h(global_stats, makeFactory(), 47, 1);
+    EXPECT_FALSE(h.isNegativeLookupCacheEnabled());
+    EXPECT_FALSE(h.isKnownNonExistent(makeStoredDocKey("key")));
+    EXPECT_EQ(0, h.getNegativeLookupCacheSize());
+}
+
+// Tests for incremental resize.
+
+TEST_F(HashTableTest, IncrementalResizeRequiresAlignedSizes) {
+    // 5 buckets isn't a multiple of 3 locks.
+    HashTable h(global_stats, makeFactory(), 5, 3);
+    EXPECT_FALSE(h.beginIncrementalResize(9));
+
+    HashTable aligned(global_stats, makeFactory(), 6, 3);
+    EXPECT_FALSE(aligned.beginIncrementalResize(10));
+    EXPECT_FALSE(aligned.beginIncrementalResize(6));
+    EXPECT_TRUE(aligned.beginIncrementalResize(9));
+    // Only one at a time.
+    EXPECT_FALSE(aligned.beginIncrementalResize(12));
+}
+
+TEST_F(HashTableTest, IncrementalResize) {
+    HashTable h(global_stats, makeFactory(), 6, 3);
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    const auto numResizes = h.getNumResizes();
+    ASSERT_TRUE(h.beginIncrementalResize(3000));
+    EXPECT_TRUE(h.isResizeInProgress());
+    EXPECT_EQ(3000, h.getSize());
+    EXPECT_EQ(6, h.getResizeBucketsRemaining());
+    EXPECT_EQ(numResizes + 1, h.getNumResizes());
+
+    // Items are all still accessible (and counted) before any explicit
+    // migration.
+    verifyFound(h, keys);
+    EXPECT_EQ(1000, h.getNumItems());
+
+    // Add more items while migrating - they go straight into the new array.
+    auto moreKeys = generateKeys(1500, 1000);
+    storeMany(h, moreKeys);
+
+    // Migrate one bucket at a time until complete.
+    size_t steps = 0;
+    while (h.continueIncrementalResize(1)) {
+        ++steps;
+        EXPECT_EQ(6 - steps, h.getResizeBucketsRemaining());
+    }
+    EXPECT_FALSE(h.isResizeInProgress());
+    EXPECT_EQ(0, h.getResizeBucketsRemaining());
+    EXPECT_EQ(3000, h.getSize());
+
+    verifyFound(h, keys);
+    verifyFound(h, moreKeys);
+    EXPECT_EQ(1500, count(h));
+}
+
+TEST_F(HashTableTest, IncrementalResizeVisitAndDelete) {
+    HashTable h(global_stats, makeFactory(), 3, 3);
+    auto keys = generateKeys(500);
+    storeMany(h, keys);
+
+    ASSERT_TRUE(h.beginIncrementalResize(999));
+
+    // Visiting must see every item exactly once, wherever it currently is.
+    EXPECT_EQ(500, count(h, false));
+
+    // Deleting works whether or not the key has been migrated yet.
+    for (const auto& key : keys) {
+        EXPECT_TRUE(del(h, key));
+    }
+    EXPECT_EQ(0, count(h));
+
+    while (h.continueIncrementalResize(1)) {
+    }
+    EXPECT_FALSE(h.isResizeInProgress());
+}
+
+TEST_F(HashTableTest, IncrementalResizeCompletedByBlockingResize) {
+    HashTable h(global_stats, makeFactory(), 6, 3);
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    ASSERT_TRUE(h.beginIncrementalResize(3000));
+    h.resize(769);
+    EXPECT_FALSE(h.isResizeInProgress());
+    EXPECT_EQ(769, h.getSize());
+    verifyFound(h, keys);
+}
+
+TEST_F(HashTableTest, IncrementalResizeClear) {
+    HashTable h(global_stats, makeFactory(), 6, 3);
+    auto keys = generateKeys(100);
+    storeMany(h, keys);
+
+    ASSERT_TRUE(h.beginIncrementalResize(300));
+    h.clear();
+    EXPECT_FALSE(h.isResizeInProgress());
+    EXPECT_EQ(0, count(h));
+    EXPECT_FALSE(h.continueIncrementalResize(1));
+}
+
+TEST_F(HashTableTest, ResizeIncrementalAuto) {
+    // Initial size not aligned to the lock count - first resize is blocking
+    // to an aligned size, subsequent ones incremental.
+    HashTable h(global_stats, makeFactory(), 5, 3);
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    h.resizeIncremental(16);
+    EXPECT_FALSE(h.isResizeInProgress());
+    EXPECT_EQ(0, h.getSize() % h.getNumLocks());
+    EXPECT_GE(h.getSize(), 769);
+    verifyFound(h, keys);
+
+    auto moreKeys = generateKeys(10000, 1000);
+    storeMany(h, moreKeys);
+    h.resizeIncremental(16);
+    EXPECT_FALSE(h.isResizeInProgress());
+    EXPECT_EQ(0, h.getSize() % h.getNumLocks());
+    EXPECT_GE(h.getSize(), 6143);
+    verifyFound(h, keys);
+    verifyFound(h, moreKeys);
+
+    // Stable once sized correctly.
+    const auto sizeAfter = h.getSize();
+    const auto resizes = h.getNumResizes();
+    h.resizeIncremental(16);
+    EXPECT_EQ(sizeAfter, h.getSize());
+    EXPECT_EQ(resizes, h.getNumResizes());
+}
+
+TEST_F(HashTableTest, TaggedIncrementalResize) {
+    HashTable h(global_stats,
+                makeFactory(),
+                6,
+                3,
+                HashTable::BucketLayout::Tagged);
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    ASSERT_TRUE(h.beginIncrementalResize(1536));
+    verifyFound(h, keys);
+    while (h.continueIncrementalResize(2)) {
+    }
+    verifyFound(h, keys);
+    for (const auto& key : keys) {
+        EXPECT_TRUE(del(h, key));
+    }
+    EXPECT_EQ(0, count(h));
+}
+
+// Check that bucket arrays of at least one huge page are allocated from huge
+// page backed mappings (and accounted for) with ht_huge_pages.
+TEST_F(HashTableTest, HugePageBucketArrays) {
+    const auto initialHugePageMemory = global_stats.htHugePageMemory.load();
+    HashTable h(global_stats,
+                makeFactory(),
+                6,
+                3,
+                HashTable::BucketLayout::Chained,
+                cb::HugePageMode::Transparent);
+    EXPECT_EQ(0, h.getHugePageMemory());
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    // Large enough for the bucket array to span multiple huge pages (and a
+    // multiple of the number of locks, for the incremental resize below)
+    size_t largeSize = (2 * cb::HugePageSize) / sizeof(StoredValue*) + 1;
+    largeSize += (3 - (largeSize % 3)) % 3;
+    h.resize(largeSize);
+    EXPECT_EQ(largeSize, h.getSize());
+    EXPECT_LE(largeSize * sizeof(StoredValue*), h.getHugePageMemory());
+    EXPECT_EQ(0, h.getHugePageMemory() % cb::HugePageSize);
+    EXPECT_EQ(initialHugePageMemory + h.getHugePageMemory(),
+              global_stats.htHugePageMemory.load());
+    verifyFound(h, keys);
+
+    // Migrating incrementally back to a small array keeps both arrays
+    // until the migration completes
+    ASSERT_TRUE(h.beginIncrementalResize(300));
+    EXPECT_NE(0, h.getHugePageMemory());
+    while (h.continueIncrementalResize(1000)) {
+    }
+    verifyFound(h, keys);
+    EXPECT_EQ(0, h.getHugePageMemory());
+    EXPECT_EQ(initialHugePageMemory, global_stats.htHugePageMemory.load());
+}
+
+// Clearing each lock stripe in turn releases every StoredValue (and the
+// memory they account for), leaving an empty, inactive table behind.
+TEST_F(HashTableTest, ClearStripe) {
+    const auto initialSize = global_stats.getCurrentSize();
+    HashTable h(global_stats, makeFactory(), 5, 3);
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+    ASSERT_LT(initialSize, global_stats.getCurrentSize());
+
+    size_t released = 0;
+    for (size_t lock = 0; lock < h.getNumLocks(); ++lock) {
+        const auto stripe = h.clearStripe(lock);
+        EXPECT_NE(0, stripe) << "lock:" << lock;
+        released += stripe;
+        // The first stripe cleared deactivates the table
+        EXPECT_FALSE(h.isActive());
+    }
+    EXPECT_EQ(keys.size(), released);
+    EXPECT_THROW(h.findForRead(keys.front()), std::logic_error);
+    EXPECT_EQ(0, h.getNumItems());
+    EXPECT_EQ(0, h.getNumInMemoryItems());
+    EXPECT_EQ(0, h.getItemMemory());
+    EXPECT_EQ(0, h.getUncompressedItemMemory());
+    for (const auto& count : h.getDatatypeCounts()) {
+        EXPECT_EQ(0, count);
+    }
+    EXPECT_EQ(initialSize, global_stats.getCurrentSize());
+    EXPECT_THROW(h.clearStripe(h.getNumLocks()), std::invalid_argument);
+}
+
+// Clearing the stripes of a tagged table in the middle of an incremental
+// resize also releases the items still in the old bucket array, and empties
+// the tag index.
+TEST_F(HashTableTest, TaggedClearStripeDuringResize) {
+    const auto initialSize = global_stats.getCurrentSize();
+    HashTable h(global_stats,
+                makeFactory(),
+                6,
+                3,
+                HashTable::BucketLayout::Tagged);
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    ASSERT_TRUE(h.beginIncrementalResize(3000));
+    ASSERT_TRUE(h.continueIncrementalResize(1));
+    ASSERT_EQ(5, h.getResizeBucketsRemaining());
+    // Some items go straight into the new array.
+    auto moreKeys = generateKeys(1500, 1000);
+    storeMany(h, moreKeys);
+    ASSERT_EQ(1500, h.getNumItems());
+
+    // Clear one stripe; the items in the other stripes are still there (but
+    // can no longer be looked up).
+    const auto first = h.clearStripe(0);
+    EXPECT_NE(0, first);
+    EXPECT_FALSE(h.isActive());
+    EXPECT_THROW(h.findForWrite(keys.front()), std::logic_error);
+    EXPECT_THROW(h.findForRead(moreKeys.front()), std::logic_error);
+    EXPECT_EQ(1500 - first, h.getNumItems());
+    EXPECT_EQ(4, h.getResizeBucketsRemaining());
+
+    size_t released = first;
+    for (size_t lock = 1; lock < h.getNumLocks(); ++lock) {
+        released += h.clearStripe(lock);
+    }
+    EXPECT_EQ(1500, released);
+    EXPECT_EQ(0, h.getResizeBucketsRemaining());
+    EXPECT_EQ(0, h.getNumItems());
+    EXPECT_EQ(0, h.getItemMemory());
+    for (const auto& count : h.getDatatypeCounts()) {
+        EXPECT_EQ(0, count);
+    }
+    EXPECT_EQ(initialSize, global_stats.getCurrentSize());
+
+    // The (empty) migration completes, and once reactivated the table - and
+    // its tag index - is empty.
+    while (h.continueIncrementalResize(100)) {
+    }
+    EXPECT_FALSE(h.isResizeInProgress());
+    h.setActiveState(true);
+    for (const auto& key : keys) {
+        EXPECT_FALSE(h.findForRead(key).storedValue);
+    }
+    for (const auto& key : moreKeys) {
+        EXPECT_FALSE(h.findForRead(key).storedValue);
+    }
+    EXPECT_EQ(0, count(h));
+
+    // .. and usable again.
+    storeMany(h, keys);
+    verifyFound(h, keys);
+}
+
+// The sampler returns (at most) the requested number of distinct keys,
+// drawn uniformly from the keys of the requested collection.
+TEST_F(HashTableTest, RandomKeySampler) {
+    HashTable h(global_stats, makeFactory(), 5, 1);
+    auto keys = generateKeys(10);
+    storeMany(h, keys);
+    const CollectionID collection(8);
+    std::vector<StoredDocKey> otherKeys;
+    for (int i = 0; i < 5; i++) {
+        otherKeys.push_back(makeStoredDocKey(std::to_string(i), collection));
+    }
+    storeMany(h, otherKeys);
+
+    RandomKeySampler all(100, {}, 0);
+    h.visit(all);
+    EXPECT_EQ(15, all.getCandidateCount());
+    EXPECT_EQ(15, all.getSample().size());
+
+    RandomKeySampler inCollection(3, collection, 0);
+    h.visit(inCollection);
+    EXPECT_EQ(5, inCollection.getCandidateCount());
+    ASSERT_EQ(3, inCollection.getSample().size());
+    for (const auto& key : inCollection.getSample()) {
+        EXPECT_EQ(collection, key.getCollectionID());
+    }
+
+    // Every key of the default collection is about as likely to be picked
+    std::map<StoredDocKey, int> picked;
+    const int rounds = 2000;
+    for (int seed = 0; seed < rounds; seed++) {
+        RandomKeySampler sampler(
+                1, CollectionID(CollectionID::Default), seed);
+        h.visit(sampler);
+        ASSERT_EQ(1, sampler.getSample().size());
+        ++picked[sampler.getSample().front()];
+    }
+    EXPECT_EQ(keys.size(), picked.size());
+    for (const auto& key : keys) {
+        EXPECT_LT(rounds / int(keys.size()) / 2, picked[key]) << key;
+    }
+}
+
+// Check Group::match reports exactly the slots holding the given tag, and
+// never the overflow byte.
+TEST(HashTableTagIndexTest, GroupMatch) {
+    HashTableTagIndex::Group group{};
+    group.tags = {{1, 2, 0x80, 2, 0xff, 0, 2}};
+    group.overflow = 2;
+    EXPECT_EQ(0b1001010u, group.match(2));
+    EXPECT_EQ(0b0000001u, group.match(1));
+    EXPECT_EQ(0b0000100u, group.match(0x80));
+    EXPECT_EQ(0b0010000u, group.match(0xff));
+    EXPECT_EQ(0u, group.match(3));
+    EXPECT_EQ(5, group.findEmpty());
+}
+
+// hashKeys must give the same result as DocKey::hash() for every key,
+// regardless of length, encoding and position within the batch.
+TEST_F(HashTableTest, HashKeysMatchesDocKeyHash) {
+    std::vector<StoredDocKey> storage;
+    for (size_t len = 0; len < 300; len += 7) {
+        storage.push_back(makeStoredDocKey(std::string(len, 'a' + (len % 26))));
+        storage.push_back(makeStoredDocKey(std::string(len, 'z'), 8));
+    }
+    std::vector<DocKey> keys(storage.begin(), storage.end());
+    // Also add a key not encoding a collection ID.
+    keys.emplace_back("legacy", DocKeyEncodesCollectionId::No);
+
+    const auto hashes = HashTable::hashKeys(keys);
+    ASSERT_EQ(keys.size(), hashes.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(keys[i].hash(), hashes[i]) << "for key " << i;
+    }
+    EXPECT_TRUE(HashTable::hashKeys({}).empty());
+}
+
+TEST_F(HashTableTest, PrefetchBuckets) {
+    for (auto layout :
+         {HashTable::BucketLayout::Chained, HashTable::BucketLayout::Tagged}) {
+        HashTable h(global_stats, makeFactory(), 5, 1, layout);
+        auto keys = generateKeys(100);
+        storeMany(h, keys);
+        std::vector<DocKey> docKeys(keys.begin(), keys.end());
+        h.prefetchBuckets(HashTable::hashKeys(docKeys));
+        verifyFound(h, keys);
+    }
+}
@@ -398,4 +398,75 @@ TEST(HdrHistogramTest, aggregationTestEmptyRhs) {
     // Check the totals of each histogram
     EXPECT_EQ(200, histogramOne.getValueCount());
     EXPECT_EQ(0, histogramTwo.getValueCount());
-}
\ No newline at end of file
+}
+// Test that a histogram survives being encoded and decoded
+TEST(HdrHistogramTest, encodeDecode) {
+    HdrHistogram histogram{0, 3600000000, 2};
+    for (uint64_t ii = 0; ii < 10000; ii += 7) {
+        histogram.addValueAndCount(ii * ii, ii % 5 + 1);
+    }
+
+    auto decoded = HdrHistogram::decode(histogram.encode());
+    EXPECT_EQ(histogram.getMinTrackableValue(),
+              decoded.getMinTrackableValue());
+    EXPECT_EQ(histogram.getMaxTrackableValue(),
+              decoded.getMaxTrackableValue());
+    EXPECT_EQ(histogram.getSigFigAccuracy(), decoded.getSigFigAccuracy());
+    EXPECT_EQ(histogram.getValueCount(), decoded.getValueCount());
+
+    auto iterOne = histogram.makeRecordedIterator();
+    auto iterTwo = decoded.makeRecordedIterator();
+    while (auto resultOne = histogram.getNextValueAndCount(iterOne)) {
+        auto resultTwo = decoded.getNextValueAndCount(iterTwo);
+        ASSERT_TRUE(resultTwo);
+        EXPECT_EQ(*resultOne, *resultTwo);
+    }
+    EXPECT_FALSE(decoded.getNextValueAndCount(iterTwo));
+}
+
+// Test that an (empty) histogram containing the value 0 may be encoded
+TEST(HdrHistogramTest, encodeDecodeZero) {
+    HdrHistogram histogram{0, 255, 3};
+    EXPECT_EQ(0, HdrHistogram::decode(histogram.encode()).getValueCount());
+
+    histogram.addValue(0);
+    auto decoded = HdrHistogram::decode(histogram.encode());
+    EXPECT_EQ(1, decoded.getValueCount());
+    EXPECT_EQ(0, decoded.getMaxValue());
+}
+
+// Test that the merge of decoded histograms gives the same percentiles as
+// the merge of the original histograms
+TEST(HdrHistogramTest, encodeDecodeAggregation) {
+    HdrHistogram histogramOne{0, 1000000, 2};
+    HdrHistogram histogramTwo{0, 1000000, 2};
+    for (int ii = 0; ii < 1000; ++ii) {
+        histogramOne.addValue(ii);
+        histogramTwo.addValue(ii * 100);
+    }
+
+    auto decoded = HdrHistogram::decode(histogramOne.encode());
+    decoded += HdrHistogram::decode(histogramTwo.encode());
+    histogramOne += histogramTwo;
+
+    EXPECT_EQ(histogramOne.getValueCount(), decoded.getValueCount());
+    for (auto percentile : {50.0, 90.0, 99.0, 99.9}) {
+        EXPECT_EQ(histogramOne.getValueAtPercentile(percentile),
+                  decoded.getValueAtPercentile(percentile));
+    }
+}
+
+// Test that invalid encodings are rejected
+TEST(HdrHistogramTest, decodeInvalid) {
+    HdrHistogram histogram{0, 255, 3};
+    histogram.addValue(10);
+    const auto encoded = histogram.encode();
+
+    EXPECT_THROW(HdrHistogram::decode(""), std::invalid_argument);
+    EXPECT_THROW(HdrHistogram::decode(encoded.substr(0, encoded.size() - 1)),
+                 std::invalid_argument);
+    EXPECT_THROW(HdrHistogram::decode(encoded + "x"), std::invalid_argument);
+    auto badVersion = encoded;
+    badVersion[0] = 0x7f;
+    EXPECT_THROW(HdrHistogram::decode(badVersion), std::invalid_argument);
+}
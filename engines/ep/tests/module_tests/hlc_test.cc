@@ -0,0 +1,65 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "hlc.h"
+
+#include <folly/portability/GTest.h>
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <vector>
+
+// A HLC ahead of the wall clock generates logical ticks
+TEST(HLCTest, LogicalTicksWhenAhead) {
+    const uint64_t future = std::numeric_limits<uint64_t>::max() / 2;
+    HLC hlc(future,
+            0,
+            std::chrono::microseconds(0),
+            std::chrono::microseconds(0));
+    EXPECT_EQ(future + 1, hlc.nextHLC());
+    EXPECT_EQ(future + 2, hlc.nextHLC());
+    EXPECT_EQ(future + 2, hlc.getMaxHLC());
+}
+
+// Concurrent callers must all get unique, per-thread increasing values
+TEST(HLCTest, ConcurrentNextHLCIsUnique) {
+    HLC hlc(0, 0, std::chrono::microseconds(0), std::chrono::microseconds(0));
+    const size_t numThreads = 4;
+    const size_t iterations = 10000;
+    std::vector<std::vector<uint64_t>> values(numThreads);
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < numThreads; ++ii) {
+        threads.emplace_back([&hlc, &values, ii, iterations]() {
+            for (size_t jj = 0; jj < iterations; ++jj) {
+                values[ii].push_back(hlc.nextHLC());
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<uint64_t> all;
+    for (const auto& v : values) {
+        EXPECT_TRUE(std::is_sorted(v.begin(), v.end()));
+        all.insert(all.end(), v.begin(), v.end());
+    }
+    std::sort(all.begin(), all.end());
+    EXPECT_EQ(all.end(), std::adjacent_find(all.begin(), all.end()));
+    EXPECT_EQ(all.back(), hlc.getMaxHLC());
+}
@@ -129,6 +129,146 @@ TEST_P(ItemCompressorTest, testStoreUncompressedInActiveMode) {
     EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, v->getDatatype());
 }
 
+// Test that the values of a collection which doesn't compress well are only
+// sampled
+TEST_P(ItemCompressorTest, testSkipPoorlyCompressibleCollection) {
+    std::string compressibleValue(1024, 'a');
+    auto key = makeStoredDocKey("key");
+    auto item = make_item(vbucket->getId(),
+                          key,
+                          compressibleValue,
+                          0,
+                          PROTOCOL_BINARY_DATATYPE_RAW_BYTES);
+    ASSERT_EQ(MutationStatus::WasClean, public_processSet(item, 0));
+
+    // Record enough attempts which weren't kept for the default collection
+    // to be sampled
+    CollectionCompressibility compressibility(4);
+    while (!compressibility.isSampling(CollectionID::Default)) {
+        compressibility.recordDeflate(CollectionID::Default, false);
+    }
+
+    PauseResumeVBAdapter prAdapter(std::make_unique<ItemCompressorVisitor>());
+    auto& visitor =
+            dynamic_cast<ItemCompressorVisitor&>(prAdapter.getHTVisitor());
+    visitor.setCompressionMode(BucketCompressionMode::Active);
+    visitor.setMinCompressionRatio(config.getMinCompressionRatio());
+    visitor.setCollectionCompressibility(&compressibility);
+
+    // The first visits skip the value (without marking it uncompressible),
+    // until the sample interval is reached.
+    for (size_t ii = 0; ii < 3; ++ii) {
+        prAdapter.visit(*vbucket);
+        EXPECT_EQ(ii + 1, visitor.getSkippedCount());
+        EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_RAW_BYTES,
+                  findValue(key)->getDatatype());
+        EXPECT_TRUE(findValue(key)->isCompressible());
+    }
+
+    prAdapter.visit(*vbucket);
+    EXPECT_EQ(3u, visitor.getSkippedCount());
+    EXPECT_EQ(1u, visitor.getCompressedCount());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_SNAPPY, findValue(key)->getDatatype());
+}
+
+// Test that items whose frequency counter is above the threshold are left
+// uncompressed (but still compressible), and that compressing the cold
+// ones accounts for the bytes saved
+TEST_P(ItemCompressorTest, testSkipHotItems) {
+    std::string compressibleValue(1024, 'a');
+    auto hotKey = makeStoredDocKey("hot");
+    auto coldKey = makeStoredDocKey("cold");
+    for (const auto& key : {hotKey, coldKey}) {
+        auto item = make_item(vbucket->getId(),
+                              key,
+                              compressibleValue,
+                              0,
+                              PROTOCOL_BINARY_DATATYPE_RAW_BYTES);
+        ASSERT_EQ(MutationStatus::WasClean, public_processSet(item, 0));
+    }
+    findValue(hotKey)->setFreqCounterValue(33);
+    findValue(coldKey)->setFreqCounterValue(32);
+
+    PauseResumeVBAdapter prAdapter(std::make_unique<ItemCompressorVisitor>());
+    auto& visitor =
+            dynamic_cast<ItemCompressorVisitor&>(prAdapter.getHTVisitor());
+    visitor.setCompressionMode(BucketCompressionMode::Active);
+    visitor.setMinCompressionRatio(config.getMinCompressionRatio());
+    visitor.setFreqCounterThreshold(32);
+    prAdapter.visit(*vbucket);
+
+    EXPECT_EQ(2u, visitor.getVisitedCount());
+    EXPECT_EQ(1u, visitor.getHotCount());
+    EXPECT_EQ(1u, visitor.getCompressedCount());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_RAW_BYTES,
+              findValue(hotKey)->getDatatype());
+    EXPECT_TRUE(findValue(hotKey)->isCompressible());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_SNAPPY,
+              findValue(coldKey)->getDatatype());
+    EXPECT_EQ(compressibleValue.size() - findValue(coldKey)->valuelen(),
+              visitor.getBytesSaved());
+}
+
+// Test that the adapter only visits the VBuckets accepted by its filter
+TEST_P(ItemCompressorTest, testFilterSkipsVBucket) {
+    auto key = makeStoredDocKey("key");
+    auto item = make_item(vbucket->getId(),
+                          key,
+                          std::string(1024, 'a'),
+                          0,
+                          PROTOCOL_BINARY_DATATYPE_RAW_BYTES);
+    ASSERT_EQ(MutationStatus::WasClean, public_processSet(item, 0));
+
+    const Vbid otherVb(vbucket->getId().get() + 1);
+    PauseResumeVBAdapter prAdapter(std::make_unique<ItemCompressorVisitor>(),
+                                   VBucketFilter(std::vector<Vbid>{otherVb}));
+    auto& visitor =
+            dynamic_cast<ItemCompressorVisitor&>(prAdapter.getHTVisitor());
+    visitor.setCompressionMode(BucketCompressionMode::Active);
+    visitor.setMinCompressionRatio(config.getMinCompressionRatio());
+
+    EXPECT_TRUE(prAdapter.visit(*vbucket));
+    EXPECT_EQ(0u, visitor.getVisitedCount());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_RAW_BYTES,
+              findValue(key)->getDatatype());
+}
+
+TEST(CollectionCompressibilityTest, SamplesAndRecovers) {
+    CollectionCompressibility compressibility(4);
+    const CollectionID cid = 8;
+
+    // Collections are optimistically assumed to be compressible
+    EXPECT_TRUE(compressibility.shouldDeflate(cid));
+    EXPECT_FALSE(compressibility.isSampling(cid));
+
+    while (!compressibility.isSampling(cid)) {
+        compressibility.recordDeflate(cid, false);
+    }
+    // Other collections aren't affected
+    EXPECT_FALSE(compressibility.isSampling(CollectionID::Default));
+
+    // One in 4 values is sampled
+    EXPECT_FALSE(compressibility.shouldDeflate(cid));
+    EXPECT_FALSE(compressibility.shouldDeflate(cid));
+    EXPECT_FALSE(compressibility.shouldDeflate(cid));
+    EXPECT_TRUE(compressibility.shouldDeflate(cid));
+
+    // Compressible samples bring the collection back...
+    for (int ii = 0; ii < 2 && compressibility.isSampling(cid); ++ii) {
+        compressibility.recordDeflate(cid, true);
+    }
+    EXPECT_FALSE(compressibility.isSampling(cid));
+    EXPECT_TRUE(compressibility.shouldDeflate(cid));
+
+    // ... and an interval of 0 disables the sampling
+    while (!compressibility.isSampling(cid)) {
+        compressibility.recordDeflate(cid, false);
+    }
+    compressibility.setSampleInterval(0);
+    EXPECT_FALSE(compressibility.isSampling(cid));
+    EXPECT_TRUE(compressibility.shouldDeflate(cid));
+}
+
 INSTANTIATE_TEST_CASE_P(
         AllVBTypesAllEvictionModes,
         ItemCompressorTest,
@@ -1079,6 +1079,48 @@ TEST_P(STValueEvictionExpiryPagerTest, MB_25991_ExpiryNonResident) {
     EXPECT_EQ(ENGINE_KEY_ENOENT, result.getStatus());
 }
 
+/**
+ * Test fixture for the expiry pager using the expiry index (with a full
+ * scan interval long enough to never do a full scan in the test)
+ */
+class STExpiryIndexPagerTest : public STExpiryPagerTest {
+protected:
+    void SetUp() override {
+        config_string +=
+                "exp_pager_index_enabled=true;"
+                "exp_pager_index_full_scan_interval=1000;";
+        STExpiryPagerTest::SetUp();
+    }
+};
+
+TEST_P(STExpiryIndexPagerTest, ExpiredItemsDeleted) {
+    expiredItemsDeleted();
+    EXPECT_EQ(0, engine->getEpStats().expiryPagerFullScans);
+}
+
+// An item which had its expiry time extended must not be expired using the
+// (stale) entry for the previous expiry time
+TEST_P(STExpiryIndexPagerTest, ExpiryExtended) {
+    auto key = makeStoredDocKey("key");
+    auto item =
+            make_item(vbid, key, "value", ep_abs_time(ep_current_time() + 5));
+    ASSERT_EQ(ENGINE_SUCCESS, storeItem(item));
+    item = make_item(
+            vbid, key, "value", ep_abs_time(ep_current_time() + 100));
+    ASSERT_EQ(ENGINE_SUCCESS, storeItem(item));
+    flushDirectlyIfPersistent(vbid, std::make_pair(false, 1));
+
+    TimeTraveller bill(11);
+    wakeUpExpiryPager();
+    EXPECT_EQ(1, engine->getVBucket(vbid)->getNumItems());
+
+    TimeTraveller ted(100);
+    wakeUpExpiryPager();
+    flushDirectlyIfPersistent(vbid, std::make_pair(false, 1));
+    EXPECT_EQ(0, engine->getVBucket(vbid)->getNumItems());
+    EXPECT_EQ(0, engine->getEpStats().expiryPagerFullScans);
+}
+
 class MB_32669 : public STValueEvictionExpiryPagerTest {
 public:
     void SetUp() override {
@@ -1271,6 +1313,32 @@ TEST_P(MB_36087, DelWithMeta_EvictedKey) {
     EXPECT_EQ(metadata.revSeqno, gv.item->getRevSeqno());
 }
 
+TEST(ItemPagerPredictiveTest, EvictionTarget) {
+    using namespace std::chrono_literals;
+    // No growth, or not predicted to reach the high watermark: no target.
+    EXPECT_EQ(0, ItemPager::getPredictiveEvictionTarget(800, 900, 700, 0, 2s));
+    EXPECT_EQ(0, ItemPager::getPredictiveEvictionTarget(800, 900, 700, 40, 2s));
+    // Predicted to reach it: keep the expected growth as headroom.
+    EXPECT_EQ(840,
+              ItemPager::getPredictiveEvictionTarget(880, 900, 700, 30, 2s));
+    // ... but don't evict below the low watermark.
+    EXPECT_EQ(700,
+              ItemPager::getPredictiveEvictionTarget(880, 900, 700, 500, 2s));
+}
+
+TEST(ItemPagerPredictiveTest, SplitFilter) {
+    VBucketFilter filter(std::vector<Vbid>{Vbid(0), Vbid(1), Vbid(2)});
+    auto filters = ItemPager::splitFilter(filter, 2);
+    ASSERT_EQ(2, filters.size());
+    EXPECT_EQ(2, filters[0].size());
+    EXPECT_EQ(1, filters[1].size());
+    EXPECT_TRUE(filters[0].filter_intersection(filters[1]).empty());
+
+    // Never more sets than vBuckets, and "all vBuckets" isn't split.
+    EXPECT_EQ(3, ItemPager::splitFilter(filter, 8).size());
+    EXPECT_EQ(1, ItemPager::splitFilter(VBucketFilter(), 8).size());
+}
+
 // TODO: Ideally all of these tests should run with or without jemalloc,
 // however we currently rely on jemalloc for accurate memory tracking; and
 // hence it is required currently.
@@ -1286,6 +1354,11 @@ INSTANTIATE_TEST_CASE_P(EphemeralOrPersistent,
                         STParameterizedBucketTest::allConfigValues(),
                         STParameterizedBucketTest::PrintToStringParamName);
 
+INSTANTIATE_TEST_CASE_P(EphemeralOrPersistent,
+                        STExpiryIndexPagerTest,
+                        STParameterizedBucketTest::allConfigValues(),
+                        STParameterizedBucketTest::PrintToStringParamName);
+
 INSTANTIATE_TEST_CASE_P(ValueOnly,
                         STValueEvictionExpiryPagerTest,
                         STValueEvictionExpiryPagerTest::configValues(),
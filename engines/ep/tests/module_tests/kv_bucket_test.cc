@@ -235,7 +235,7 @@ bool KVBucketTest::isItemFreqDecayerTaskSnoozed() const {
 void KVBucketTest::runBGFetcherTask() {
     MockGlobalTask mockTask(engine->getTaskable(),
                             TaskId::MultiBGFetcherTask);
-    store->getVBucket(vbid)->getShard()->getBgFetcher()->run(&mockTask);
+    static_cast<EPBucket&>(*store).getBgFetcher(vbid)->run(&mockTask);
 }
 
 /**
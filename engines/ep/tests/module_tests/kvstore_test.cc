@@ -322,6 +322,390 @@ TEST_F(CouchKVStoreTest, StatsTest) {
     EXPECT_GE(io_total_write_bytes, io_write_bytes);
 }
 
+// Verify that the storage for the requests of a flush batch is reused by
+// the next batch, and requests moved as the batch grew are persisted intact.
+TEST_F(CouchKVStoreTest, FlushReusesRequestStorage) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    const int numItems = 100;
+    auto flushBatch = [&kvstore, this](const std::string& value) {
+        kvstore->begin(std::make_unique<TransactionContext>());
+        WriteCallback wc;
+        for (int i = 0; i < numItems; i++) {
+            Item item(makeStoredDocKey("key" + std::to_string(i)),
+                      0,
+                      0,
+                      value.c_str(),
+                      value.size());
+            kvstore->set(item, wc);
+        }
+        EXPECT_TRUE(kvstore->commit(flush));
+
+        std::map<std::string, std::string> stats;
+        kvstore->addStats(add_stat_callback, &stats, "");
+        return std::stoul(stats["rw_0:lastCommReqAllocs"]);
+    };
+
+    EXPECT_GT(flushBatch("value1"), 0);
+    EXPECT_EQ(0, flushBatch("value2"));
+
+    for (int i = 0; i < numItems; i++) {
+        const DiskDocKey key{makeStoredDocKey("key" + std::to_string(i))};
+        auto gv = kvstore->get(key, Vbid(0));
+        ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+        EXPECT_EQ(key, DiskDocKey{*gv.item});
+        EXPECT_EQ("value2", gv.item->getValue()->to_s());
+    }
+}
+
+// Verify that getMulti fetches every document of a batch, reading the
+// bodies (adjacent in the file, as they were flushed together) in order.
+TEST_F(CouchKVStoreTest, GetMultiReadsBodiesInFileOrder) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    const int numItems = 10;
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    for (int i = 0; i < numItems; i++) {
+        std::string key("key" + std::to_string(i));
+        std::string value("value" + std::to_string(i));
+        Item item(makeStoredDocKey(key), 0, 0, value.c_str(), value.size());
+        kvstore->set(item, wc);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    vb_bgfetch_queue_t itms;
+    for (int i = 0; i < numItems; i++) {
+        vb_bgfetch_item_ctx_t ctx;
+        ctx.isMetaOnly = GetMetaOnly::No;
+        itms[DiskDocKey{makeStoredDocKey("key" + std::to_string(i))}] =
+                std::move(ctx);
+    }
+    kvstore->getMulti(Vbid(0), itms);
+
+    for (int i = 0; i < numItems; i++) {
+        auto& value =
+                itms[DiskDocKey{makeStoredDocKey("key" + std::to_string(i))}]
+                        .value;
+        ASSERT_EQ(ENGINE_SUCCESS, value.getStatus());
+        EXPECT_EQ("value" + std::to_string(i), value.item->getValue()->to_s());
+    }
+
+    const auto& st = kvstore->getKVStoreStat();
+    EXPECT_EQ(1, st.getMultiBodyReadHisto.getValueCount());
+    EXPECT_EQ(numItems, st.getMultiBodyReadHisto.getMaxValue());
+    EXPECT_EQ(numItems - 1, st.getMultiAdjacentReadHisto.getMaxValue());
+}
+
+// Verify that a (compressed on disk) body is inflated into the fetched Item,
+// and that a meta-only fetch doesn't allocate space for the value.
+TEST_F(CouchKVStoreTest, GetMultiMetaOnlySkipsValue) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    const std::string value(8192, 'x');
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    for (const auto* key : {"meta", "body"}) {
+        Item item(makeStoredDocKey(key), 0, 0, value.c_str(), value.size());
+        kvstore->set(item, wc);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    vb_bgfetch_queue_t itms;
+    vb_bgfetch_item_ctx_t metaCtx;
+    metaCtx.isMetaOnly = GetMetaOnly::Yes;
+    itms[DiskDocKey{makeStoredDocKey("meta")}] = std::move(metaCtx);
+    vb_bgfetch_item_ctx_t bodyCtx;
+    bodyCtx.isMetaOnly = GetMetaOnly::No;
+    itms[DiskDocKey{makeStoredDocKey("body")}] = std::move(bodyCtx);
+    kvstore->getMulti(Vbid(0), itms);
+
+    auto& meta = itms[DiskDocKey{makeStoredDocKey("meta")}].value;
+    ASSERT_EQ(ENGINE_SUCCESS, meta.getStatus());
+    EXPECT_EQ(0, meta.item->getNBytes());
+
+    auto& body = itms[DiskDocKey{makeStoredDocKey("body")}].value;
+    ASSERT_EQ(ENGINE_SUCCESS, body.getStatus());
+    EXPECT_EQ(value, body.item->getValue()->to_s());
+    EXPECT_EQ(PROTOCOL_BINARY_RAW_BYTES, body.item->getDataType());
+}
+
+/// Rollback callback recording the pre-rollback state it is given.
+class PreRollbackStateCallback : public RollbackCB {
+public:
+    bool needsPreRollbackState() const override {
+        return true;
+    }
+
+    void callback(GetValue& val) override {
+        ADD_FAILURE() << "callback() invoked instead of discardedUpdate()";
+    }
+
+    void discardedUpdate(GetValue& postRollback,
+                         GetValue& preRollback) override {
+        preRollbackState.emplace(postRollback.item->getKey(),
+                                 std::move(preRollback));
+    }
+
+    std::map<StoredDocKey, GetValue> preRollbackState;
+};
+
+// Verify that a rollback hands a callback which asks for it the state of each
+// discarded key in the Rollback header.
+TEST_F(CouchKVStoreTest, RollbackProvidesPreRollbackState) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    WriteCallback wc;
+    int64_t seqno = 1;
+    auto set = [&kvstore, &wc, &seqno](const std::string& key,
+                                       const std::string& value) {
+        Item item(makeStoredDocKey(key), 0, 0, value.c_str(), value.size());
+        item.setBySeqno(seqno++);
+        kvstore->set(item, wc);
+    };
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    for (const auto* key : {"key1", "key2", "key3", "key4"}) {
+        set(key, "before");
+    }
+    ASSERT_TRUE(kvstore->commit(flush));
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    set("key1", "after");
+    set("key5", "after");
+    ASSERT_TRUE(kvstore->commit(flush));
+
+    auto rcb = std::make_shared<PreRollbackStateCallback>();
+    auto result = kvstore->rollback(Vbid(0), 4, rcb);
+    ASSERT_TRUE(result.success);
+
+    ASSERT_EQ(2, rcb->preRollbackState.size());
+    auto& key1 = rcb->preRollbackState.at(makeStoredDocKey("key1"));
+    ASSERT_EQ(ENGINE_SUCCESS, key1.getStatus());
+    EXPECT_EQ("before", key1.item->getValue()->to_s());
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              rcb->preRollbackState.at(makeStoredDocKey("key5")).getStatus());
+}
+
+// Verify that with the block cache enabled, repeated reads of a document are
+// served from the cache (and still return the right document).
+TEST_F(CouchKVStoreTest, BlockCache) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    config.setCouchstoreBlockCacheSize(1024 * 1024);
+    auto kvstore = setup_kv_store(config);
+
+    size_t value;
+    ASSERT_TRUE(kvstore->getStat("block_cache_hits", value));
+    EXPECT_EQ(0, value);
+
+    // Enough documents for the file to span a number of (full) blocks.
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    const std::string docValue(100, 'x');
+    for (int i = 0; i < 200; i++) {
+        Item item(makeStoredDocKey("key" + std::to_string(i)),
+                  0,
+                  0,
+                  docValue.c_str(),
+                  docValue.size());
+        kvstore->set(item, wc);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    const DiskDocKey key{makeStoredDocKey("key0")};
+    auto gv = kvstore->get(key, Vbid(0));
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    ASSERT_TRUE(kvstore->getStat("block_cache_hits", value));
+    const auto hits = value;
+    ASSERT_TRUE(kvstore->getStat("block_cache_mem_used", value));
+    EXPECT_GT(value, 0);
+
+    gv = kvstore->get(key, Vbid(0));
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(docValue, gv.item->getValue()->to_s());
+    ASSERT_TRUE(kvstore->getStat("block_cache_hits", value));
+    EXPECT_GT(value, hits);
+}
+
+// Verify that reads reuse a cached read-only handle until the file changes,
+// and then see the change; both on the RW store and on its RO store.
+TEST_F(CouchKVStoreTest, ReadHandleCache) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    config.setCouchstoreCacheReadHandles(true);
+    auto kvstore = KVStoreFactory::create(config);
+    initialize_kv_store(kvstore.rw.get(), Vbid(0));
+
+    WriteCallback wc;
+    auto set = [&kvstore, &wc](const std::string& value, int64_t seqno) {
+        kvstore.rw->begin(std::make_unique<TransactionContext>());
+        Item item(makeStoredDocKey("key"), 0, 0, value.c_str(), value.size());
+        item.setBySeqno(seqno);
+        kvstore.rw->set(item, wc);
+        ASSERT_TRUE(kvstore.rw->commit(flush));
+    };
+    auto get = [](KVStore& store) -> std::string {
+        auto gv = store.get(DiskDocKey{makeStoredDocKey("key")}, Vbid(0));
+        EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+        return gv.item ? gv.item->getValue()->to_s() : "";
+    };
+    auto stat = [](KVStore& store, const char* name) {
+        size_t value = 0;
+        EXPECT_TRUE(store.getStat(name, value));
+        return value;
+    };
+
+    set("one", 1);
+    for (auto* store : {kvstore.rw.get(), kvstore.ro.get()}) {
+        EXPECT_EQ("one", get(*store));
+        EXPECT_EQ("one", get(*store));
+        EXPECT_EQ(1, stat(*store, "read_handle_cache_misses"));
+        EXPECT_EQ(1, stat(*store, "read_handle_cache_hits"));
+    }
+
+    // A commit makes the cached handles stale...
+    set("two", 2);
+    for (auto* store : {kvstore.rw.get(), kvstore.ro.get()}) {
+        EXPECT_EQ("two", get(*store));
+        EXPECT_EQ(2, stat(*store, "read_handle_cache_misses"));
+    }
+
+    // ... as does compaction, which replaces the file.
+    CompactionConfig compactionConfig;
+    compactionConfig.db_file_id = Vbid(0);
+    compaction_ctx cctx(compactionConfig, 0);
+    cctx.curr_time = 0;
+    EXPECT_TRUE(kvstore.rw->compactDB(&cctx));
+    for (auto* store : {kvstore.rw.get(), kvstore.ro.get()}) {
+        EXPECT_EQ("two", get(*store));
+        EXPECT_EQ(3, stat(*store, "read_handle_cache_misses"));
+        EXPECT_EQ(1, stat(*store, "read_handle_cache_hits"));
+    }
+}
+
+// A new revision of the file (here the vBucket is reset) makes the cached
+// handles of the old revision stale, in both the RW and the RO store.
+TEST_F(CouchKVStoreTest, ReadHandleCacheFileRevisionChange) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    config.setCouchstoreCacheReadHandles(true);
+    auto kvstore = KVStoreFactory::create(config);
+    initialize_kv_store(kvstore.rw.get(), Vbid(0));
+
+    kvstore.rw->begin(std::make_unique<TransactionContext>());
+    const std::string value{"value"};
+    Item item(makeStoredDocKey("key"), 0, 0, value.c_str(), value.size());
+    item.setBySeqno(1);
+    WriteCallback wc;
+    kvstore.rw->set(item, wc);
+    ASSERT_TRUE(kvstore.rw->commit(flush));
+
+    const DiskDocKey key{makeStoredDocKey("key")};
+    size_t misses = 0;
+    for (auto* store : {kvstore.rw.get(), kvstore.ro.get()}) {
+        EXPECT_EQ(ENGINE_SUCCESS, store->get(key, Vbid(0)).getStatus());
+        EXPECT_TRUE(store->getStat("read_handle_cache_misses", misses));
+        EXPECT_EQ(1, misses);
+    }
+
+    kvstore.rw->reset(Vbid(0));
+    for (auto* store : {kvstore.rw.get(), kvstore.ro.get()}) {
+        // The document only exists in the old revision of the file
+        EXPECT_EQ(ENGINE_KEY_ENOENT, store->get(key, Vbid(0)).getStatus());
+        EXPECT_TRUE(store->getStat("read_handle_cache_misses", misses));
+        EXPECT_EQ(2, misses);
+        size_t hits = 0;
+        EXPECT_TRUE(store->getStat("read_handle_cache_hits", hits));
+        EXPECT_EQ(0, hits);
+    }
+}
+
+// The handles are only cached when enabled, as each costs a file descriptor
+TEST_F(CouchKVStoreTest, ReadHandleCacheDisabledByDefault) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    EXPECT_FALSE(config.getCouchstoreCacheReadHandles());
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    const std::string value{"value"};
+    Item item(makeStoredDocKey("key"), 0, 0, value.c_str(), value.size());
+    item.setBySeqno(1);
+    WriteCallback wc;
+    kvstore->set(item, wc);
+    ASSERT_TRUE(kvstore->commit(flush));
+
+    const DiskDocKey key{makeStoredDocKey("key")};
+    EXPECT_EQ(ENGINE_SUCCESS, kvstore->get(key, Vbid(0)).getStatus());
+    EXPECT_EQ(ENGINE_SUCCESS, kvstore->get(key, Vbid(0)).getStatus());
+    size_t count = 0;
+    EXPECT_TRUE(kvstore->getStat("read_handle_cache_misses", count));
+    EXPECT_EQ(0, count);
+    EXPECT_TRUE(kvstore->getStat("read_handle_cache_hits", count));
+    EXPECT_EQ(0, count);
+}
+
+// A bloom filter may be persisted directly, or by compaction, along with
+// the high seqno it is valid for.
+TEST_F(CouchKVStoreTest, PersistedBloomFilter) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+    EXPECT_TRUE(kvstore->getPersistedBloomFilter(Vbid(0)).second.empty());
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    const std::string value{"value"};
+    Item item(makeStoredDocKey("key"), 0, 0, value.c_str(), value.size());
+    item.setBySeqno(1);
+    WriteCallback wc;
+    kvstore->set(item, wc);
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    EXPECT_TRUE(kvstore->persistBloomFilter(Vbid(0), 1, "filter"));
+    auto persisted = kvstore->getPersistedBloomFilter(Vbid(0));
+    EXPECT_EQ(1, persisted.first);
+    EXPECT_EQ("filter", persisted.second);
+
+    CompactionConfig compactionConfig;
+    compactionConfig.db_file_id = Vbid(0);
+    compaction_ctx cctx(compactionConfig, 0);
+    cctx.curr_time = 0;
+    cctx.getBloomFilter = []() { return std::string("compacted"); };
+    EXPECT_TRUE(kvstore->compactDB(&cctx));
+
+    persisted = kvstore->getPersistedBloomFilter(Vbid(0));
+    EXPECT_EQ(1, persisted.first);
+    EXPECT_EQ("compacted", persisted.second);
+}
+
+// The file of a vbucket being deleted can be truncated in steps before it
+// is unlinked.
+TEST_F(CouchKVStoreTest, TruncateVBucketFile) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    const std::string value(4096, 'x');
+    Item item(makeStoredDocKey("key"), 0, 0, value.c_str(), value.size());
+    item.setBySeqno(1);
+    WriteCallback wc;
+    kvstore->set(item, wc);
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    const auto rev = kvstore->prepareToDelete(Vbid(0));
+    const auto size = kvstore->truncateVBucketFile(Vbid(0), rev, 1);
+    EXPECT_LT(value.size(), size);
+    EXPECT_EQ(size - 100, kvstore->truncateVBucketFile(Vbid(0), rev, 100));
+
+    // Truncation disabled, or the remainder left for the unlink
+    EXPECT_EQ(0, kvstore->truncateVBucketFile(Vbid(0), rev, 0));
+    EXPECT_EQ(0, kvstore->truncateVBucketFile(Vbid(0), rev, size));
+    EXPECT_EQ(size - 101, kvstore->truncateVBucketFile(Vbid(0), rev, 1));
+
+    kvstore->delVBucket(Vbid(0), rev);
+    EXPECT_EQ(0, kvstore->truncateVBucketFile(Vbid(0), rev, 1));
+}
+
 // Verify the compaction stats returned from operations are accurate.
 TEST_F(CouchKVStoreTest, CompactStatsTest) {
     KVStoreConfig config(1, 4, data_dir, "couchdb", 0);
@@ -2193,6 +2577,47 @@ TEST_P(KVStoreParamTest, BasicTest) {
     checkGetValue(gv);
 }
 
+// Verify that getMulti returns every document of a batch (whatever order
+// the keys are in), meta-only fetches included, and reports missing keys.
+TEST_P(KVStoreParamTest, GetMultiBatch) {
+    const int numItems = 10;
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    for (int i = 0; i < numItems; i++) {
+        std::string key("key" + std::to_string(i));
+        std::string value("value" + std::to_string(i));
+        Item item(makeStoredDocKey(key), 0, 0, value.c_str(), value.size());
+        item.setBySeqno(i + 1);
+        kvstore->set(item, wc);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    vb_bgfetch_queue_t itms;
+    for (int i = numItems; i >= 0; i--) {
+        vb_bgfetch_item_ctx_t ctx;
+        ctx.isMetaOnly = (i % 2) ? GetMetaOnly::Yes : GetMetaOnly::No;
+        itms[DiskDocKey{makeStoredDocKey("key" + std::to_string(i))}] =
+                std::move(ctx);
+    }
+    kvstore->getMulti(Vbid(0), itms);
+
+    for (int i = 0; i < numItems; i++) {
+        auto& value =
+                itms[DiskDocKey{makeStoredDocKey("key" + std::to_string(i))}]
+                        .value;
+        ASSERT_EQ(ENGINE_SUCCESS, value.getStatus());
+        EXPECT_EQ(i + 1, value.item->getBySeqno());
+        if (!(i % 2)) {
+            EXPECT_EQ("value" + std::to_string(i),
+                      value.item->getValue()->to_s());
+        }
+    }
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              itms[DiskDocKey{makeStoredDocKey(
+                           "key" + std::to_string(numItems))}]
+                      .value.getStatus());
+}
+
 TEST_P(KVStoreParamTest, TestPersistenceCallbacksForSet) {
     kvstore->begin(std::make_unique<TransactionContext>());
 
@@ -2645,6 +3070,37 @@ TEST_P(KVStoreParamTestSkipRocks, GetAllKeysSanity) {
     EXPECT_EQ(keys, int(cb->getProcessedCount()));
 }
 
+// The callback may end the key enumeration early by setting a non-success
+// status (as done when a GET_KEYS response reaches its size limit).
+TEST_P(KVStoreParamTestSkipRocks, GetAllKeysStoppedByCallback) {
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    for (int i = 0; i < 20; i++) {
+        Item item(makeStoredDocKey("key" + std::to_string(i)),
+                  0,
+                  0,
+                  "value",
+                  5,
+                  PROTOCOL_BINARY_RAW_BYTES,
+                  0,
+                  i + 1);
+        kvstore->set(item, wc);
+    }
+    kvstore->commit(flush);
+
+    std::shared_ptr<CustomCallback<const DiskDocKey&>> cb;
+    int seen = 0;
+    cb = std::make_shared<CustomCallback<const DiskDocKey&>>(
+            [&cb, &seen](const DiskDocKey&) {
+                if (++seen == 5) {
+                    cb->setStatus(ENGINE_E2BIG);
+                }
+            });
+    DiskDocKey start(nullptr, 0);
+    EXPECT_EQ(ENGINE_SUCCESS, kvstore->getAllKeys(Vbid(0), start, 20, cb));
+    EXPECT_EQ(5, seen);
+}
+
 static std::string kvstoreTestParams[] = {
 #ifdef EP_USE_MAGMA
         "magma",
@@ -2884,6 +3340,64 @@ TEST_F(MagmaKVStoreTest, RollbackNoValidCommitPoint) {
     ASSERT_FALSE(rollbackResult.success);
 }
 
+// Verify the write volume stats, including the values which Magma separates
+// into its value log.
+TEST_F(MagmaKVStoreTest, WriteStats) {
+    auto cfg = reinterpret_cast<MagmaKVStoreConfig*>(kvstoreConfig.get());
+    const std::string small(1, 'x');
+    const std::string large(cfg->getMagmaValueSeparationSize(), 'y');
+
+    WriteCallback wc;
+    kvstore->begin(std::make_unique<TransactionContext>());
+    Item item1(makeStoredDocKey("key1"), 0, 0, small.data(), small.size());
+    item1.setBySeqno(1);
+    kvstore->set(item1, wc);
+    Item item2(makeStoredDocKey("key2"), 0, 0, large.data(), large.size());
+    item2.setBySeqno(2);
+    kvstore->set(item2, wc);
+    ASSERT_TRUE(kvstore->commit(flush));
+
+    size_t value;
+    ASSERT_TRUE(kvstore->getStat("magma_write_batches", value));
+    EXPECT_EQ(1, value);
+    ASSERT_TRUE(kvstore->getStat("magma_write_items", value));
+    EXPECT_EQ(2, value);
+    ASSERT_TRUE(kvstore->getStat("magma_write_bytes", value));
+    EXPECT_GT(value, small.size() + large.size());
+    ASSERT_TRUE(kvstore->getStat("magma_value_log_write_bytes", value));
+    EXPECT_EQ(large.size(), value);
+}
+
+// Verify a request to release write buffer memory persists the write cache
+// from the next commit, once.
+TEST_F(MagmaKVStoreTest, ReleaseWriteBufferMemory) {
+    auto commitItem = [this](const std::string& key, int64_t seqno) {
+        WriteCallback wc;
+        kvstore->begin(std::make_unique<TransactionContext>());
+        Item item(makeStoredDocKey(key), 0, 0, "value", 5);
+        item.setBySeqno(seqno);
+        kvstore->set(item, wc);
+        ASSERT_TRUE(kvstore->commit(flush));
+    };
+
+    size_t value;
+    commitItem("key1", 1);
+    ASSERT_TRUE(kvstore->getStat("magma_write_cache_releases", value));
+    EXPECT_EQ(0, value);
+
+    kvstore->releaseWriteBufferMemory();
+    commitItem("key2", 2);
+    ASSERT_TRUE(kvstore->getStat("magma_write_cache_releases", value));
+    EXPECT_EQ(1, value);
+
+    commitItem("key3", 3);
+    ASSERT_TRUE(kvstore->getStat("magma_write_cache_releases", value));
+    EXPECT_EQ(1, value);
+
+    GetValue gv = kvstore->get(DiskDocKey{makeStoredDocKey("key2")}, Vbid(0));
+    EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+}
+
 TEST_F(MagmaKVStoreTest, prepareToCreate) {
     EXPECT_THROW(kvstore->prepareToCreate(Vbid(0)), std::logic_error);
     auto kvsRev = kvstore->prepareToDelete(Vbid(0));
@@ -0,0 +1,118 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "lock_profiler.h"
+#include "locks.h"
+
+#include <folly/portability/GTest.h>
+
+#include <atomic>
+#include <map>
+#include <thread>
+
+using FetcherLockHolder =
+        ProfiledLockHolder<LockHolder, LockProfiler::Site::BgFetcherQueue>;
+
+class LockProfilerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        LockProfiler::reset();
+    }
+
+    void TearDown() override {
+        LockProfiler::setSampleRate(0);
+        LockProfiler::reset();
+    }
+
+    std::string getStat(const std::string& name) {
+        std::map<std::string, std::string> stats;
+        LockProfiler::addStats(
+                [&stats](const char* key,
+                         const uint16_t klen,
+                         const char* val,
+                         const uint32_t vlen,
+                         gsl::not_null<const void*>) {
+                    stats[std::string(key, klen)] = std::string(val, vlen);
+                },
+                this);
+        return stats.at("ep_lock_profile:bgfetcher_queue:" + name);
+    }
+
+    // Acquire (and release) mutex count times on a new thread, so the
+    // sampling starts afresh.
+    void lockOnNewThread(size_t count) {
+        std::thread thread([this, count]() {
+            for (size_t ii = 0; ii < count; ++ii) {
+                FetcherLockHolder lh(mutex);
+            }
+        });
+        thread.join();
+    }
+
+    std::mutex mutex;
+};
+
+TEST_F(LockProfilerTest, DisabledByDefault) {
+    EXPECT_EQ(0, LockProfiler::getSampleRate());
+    lockOnNewThread(10);
+    EXPECT_EQ("0", getStat("samples"));
+}
+
+TEST_F(LockProfilerTest, SampleRate) {
+    LockProfiler::setSampleRate(1);
+    lockOnNewThread(3);
+    EXPECT_EQ("3", getStat("samples"));
+    EXPECT_EQ("0", getStat("contended"));
+
+    LockProfiler::reset();
+    LockProfiler::setSampleRate(4);
+    lockOnNewThread(9);
+    EXPECT_EQ("2", getStat("samples"));
+}
+
+// An acquisition which has to wait for another holder counts as contended.
+TEST_F(LockProfilerTest, Contended) {
+    LockProfiler::setSampleRate(1);
+    std::thread thread;
+    {
+        LockHolder lh(mutex);
+        std::atomic<bool> started{false};
+        thread = std::thread([this, &started]() {
+            started = true;
+            FetcherLockHolder lh(mutex);
+        });
+        while (!started) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    thread.join();
+    EXPECT_EQ("1", getStat("samples"));
+    EXPECT_EQ("1", getStat("contended"));
+}
+
+// The wrapper converts to the underlying holder, so it can be passed to
+// functions taking the holder as proof of locking.
+TEST_F(LockProfilerTest, ConvertsToLockHolder) {
+    LockProfiler::setSampleRate(1);
+    {
+        FetcherLockHolder lh(mutex);
+        auto requiresLock = [](const LockHolder&) { return true; };
+        EXPECT_TRUE(requiresLock(lh));
+    }
+    EXPECT_EQ("1", getStat("samples"));
+}
@@ -482,12 +482,88 @@ TEST_F(MutationLogTest, BatchLoad) {
     }
 }
 
+// Keys are delta-encoded against the previous key in the block; check that
+// they are all read back intact, including across block boundaries, and that
+// the encoding is smaller than the V3 layout.
+TEST_F(MutationLogTest, DeltaEncodedKeys) {
+    std::vector<std::pair<Vbid, StoredDocKey>> logged;
+    size_t v3Bytes = 0;
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        for (uint16_t vb = 0; vb < 2; vb++) {
+            for (size_t ii = 0; ii < 1000; ii++) {
+                logged.emplace_back(
+                        Vbid(vb),
+                        makeStoredDocKey("user::profile::" +
+                                         std::to_string(100000 + ii)));
+                ml.newItem(logged.back().first, logged.back().second);
+                v3Bytes += MutationLogEntryV3::len(logged.back().second.size());
+            }
+            ml.commit1();
+            ml.commit2();
+        }
+        ml.flush();
+        EXPECT_LT(ml.logSize, v3Bytes);
+    }
+
+    MutationLog ml(tmp_log_filename.c_str());
+    ml.open(true);
+    ASSERT_EQ(MutationLogVersion::V5, ml.header().version());
+    auto expected = logged.begin();
+    for (auto it = ml.begin(); it != ml.end(); ++it) {
+        const auto& le = *it;
+        if (le->type() != MutationLogType::New) {
+            continue;
+        }
+        ASSERT_NE(logged.end(), expected);
+        EXPECT_EQ(expected->first, le->vbucket());
+        EXPECT_EQ(expected->second, StoredDocKey(le->key()));
+        ++expected;
+    }
+    EXPECT_EQ(logged.end(), expected);
+}
+
 // @todo
 //   Test Read Only log
 //   Test close / open / close / open
 //   Fix copy constructor bug
 //
 
+// With a write buffer the completed blocks are only written once the buffer
+// is full (or the log is synced), and the log reads back as normal.
+TEST_F(MutationLogTest, WriteBuffer) {
+    std::vector<StoredDocKey> logged;
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.setSyncConfig(0);
+        ml.setWriteBufferSize(1024 * 1024);
+        ml.open();
+        const size_t initialSize = ml.logSize;
+
+        for (size_t ii = 0; ii < 2000; ii++) {
+            logged.push_back(makeStoredDocKey("key" + std::to_string(ii)));
+            ml.newItem(Vbid(0), logged.back());
+            ml.commit1();
+            ml.commit2();
+        }
+        ASSERT_TRUE(ml.flush());
+        EXPECT_EQ(initialSize, ml.logSize);
+
+        ml.sync();
+        EXPECT_LT(initialSize, ml.logSize);
+        EXPECT_EQ(0, (ml.logSize - initialSize) % ml.header().blockSize());
+    }
+
+    MutationLog ml(tmp_log_filename.c_str());
+    ml.open(true);
+    MutationLogHarvester h(ml);
+    h.setVBucket(Vbid(0));
+    EXPECT_TRUE(h.load());
+    EXPECT_EQ(logged.size(), h.getItemsSeen()[int(MutationLogType::New)]);
+    EXPECT_EQ(logged.size(), h.getItemsSeen()[int(MutationLogType::Commit2)]);
+}
+
 TEST_F(MutationLogTest, ReadOnly) {
     remove(tmp_log_filename.c_str());
     MutationLog ml(tmp_log_filename.c_str());
@@ -532,6 +608,66 @@ public:
     }
 };
 
+// A V4 log differs only in its block checksums (CRC32 rather than CRC32C),
+// and is still read.
+TEST_F(MutationLogTest, readV4) {
+    std::vector<std::string> keys;
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        for (int ii = 0; ii < 10; ii++) {
+            keys.push_back("key" + std::to_string(ii));
+            ml.newItem(Vbid(0), makeStoredDocKey(keys.back()));
+        }
+        ml.commit1();
+        ml.commit2();
+    }
+
+    // Rewrite the log as V4: the header's version and each block's checksum.
+    std::vector<uint8_t> contents;
+    {
+        std::ifstream logFile(tmp_log_filename, std::ifstream::binary);
+        contents.assign(std::istreambuf_iterator<char>(logFile),
+                        std::istreambuf_iterator<char>());
+    }
+    ASSERT_EQ(0, contents.size() % MIN_LOG_HEADER_SIZE);
+    ASSERT_GT(contents.size(), MIN_LOG_HEADER_SIZE);
+    const uint32_t version = htonl(uint32_t(MutationLogVersion::V4));
+    std::copy_n(reinterpret_cast<const uint8_t*>(&version),
+                sizeof(version),
+                contents.begin());
+    for (size_t offset = MIN_LOG_HEADER_SIZE; offset < contents.size();
+         offset += MIN_LOG_HEADER_SIZE) {
+        uint32_t crc32(
+                crc32buf(&contents[offset + 2], MIN_LOG_HEADER_SIZE - 2));
+        uint16_t crc16(htons(crc32 & 0xffff));
+        std::copy_n(reinterpret_cast<uint8_t*>(&crc16),
+                    sizeof(uint16_t),
+                    contents.begin() + offset);
+    }
+    {
+        std::ofstream logFile(tmp_log_filename,
+                              std::ios::out | std::ofstream::binary);
+        std::copy(contents.begin(),
+                  contents.end(),
+                  std::ostreambuf_iterator<char>(logFile));
+    }
+
+    MutationLog ml(tmp_log_filename.c_str());
+    ml.open(true);
+    ASSERT_EQ(MutationLogVersion::V4, ml.header().version());
+    MutationLogHarvester h(ml);
+    h.setVBucket(Vbid(0));
+    EXPECT_EQ(ml.end(), h.loadBatch(ml.begin(), keys.size()));
+
+    std::set<StoredDocKey> maps[1];
+    h.apply(&maps, loaderFun);
+    EXPECT_EQ(keys.size(), maps[0].size());
+    for (const auto& key : keys) {
+        EXPECT_EQ(1, maps[0].count(makeStoredDocKey(key)));
+    }
+}
+
 TEST_F(MutationLogTest, upgrade) {
     // Craft a V1 format file
     LogHeaderBlock headerBlock(MutationLogVersion::V1);
@@ -0,0 +1,95 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "configuration.h"
+#include "replicationthrottle.h"
+#include "stats.h"
+
+#include <folly/portability/GTest.h>
+
+/*
+ * Unit tests for the adaptive mode of the ReplicationThrottle
+ */
+
+class ReplicationThrottleTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        stats.setMaxDataSize(1024 * 1024 * 1024);
+        stats.replicationThrottleThreshold = 0.99;
+        stats.replicationThrottleWriteQueueCap = 1000;
+        throttle.setMinRate(minRate);
+        throttle.setMaxRate(maxRate);
+        throttle.setTargetHeadroom(10);
+        throttle.setAdaptive(true);
+    }
+
+    /// Run the controller for the given number of intervals
+    void runController(int intervals) {
+        for (int ii = 0; ii < intervals; ++ii) {
+            now += ReplicationThrottle::UpdateInterval;
+            throttle.updateRate(now);
+        }
+    }
+
+    const size_t minRate = 1024 * 1024;
+    const size_t maxRate = 100 * 1024 * 1024;
+    EPStats stats;
+    Configuration config;
+    ReplicationThrottle throttle{config, stats};
+    std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now();
+};
+
+TEST_F(ReplicationThrottleTest, DisabledByDefault) {
+    ReplicationThrottle other{config, stats};
+    EXPECT_EQ(0, other.getRate());
+    EXPECT_EQ(std::chrono::duration<double>(5.0), other.getBackoffTime());
+    other.processed(1024 * 1024 * 1024);
+    EXPECT_EQ(ReplicationThrottle::Status::Process, other.getStatus());
+}
+
+TEST_F(ReplicationThrottleTest, RunsAtMaxRateWithHeadroom) {
+    runController(50);
+    EXPECT_EQ(maxRate, throttle.getRate());
+    EXPECT_EQ(ReplicationThrottle::Status::Process, throttle.getStatus());
+    EXPECT_EQ(ReplicationThrottle::UpdateInterval, throttle.getBackoffTime());
+}
+
+TEST_F(ReplicationThrottleTest, BacksOffWhenWriteQueueGrows) {
+    // The write queue is above the target (but below the hard cap)
+    stats.diskQueueSize = 990;
+    runController(500);
+    EXPECT_EQ(minRate, throttle.getRate());
+
+    // ... and we recover once the flusher catch up
+    stats.diskQueueSize = 0;
+    runController(50);
+    EXPECT_EQ(maxRate, throttle.getRate());
+}
+
+TEST_F(ReplicationThrottleTest, PausesWhenBudgetIsExhausted) {
+    ASSERT_EQ(ReplicationThrottle::Status::Process, throttle.getStatus());
+    // 100 seconds worth of input at the max rate
+    throttle.processed(100 * maxRate);
+    EXPECT_EQ(ReplicationThrottle::Status::Pause, throttle.getStatus());
+
+    // The budget is refilled by the controller (one interval at the time)
+    runController(100);
+    EXPECT_EQ(ReplicationThrottle::Status::Pause, throttle.getStatus());
+    runController(1000);
+    EXPECT_EQ(ReplicationThrottle::Status::Process, throttle.getStatus());
+}
@@ -0,0 +1,119 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "slab_allocator.h"
+
+#include "item.h"
+#include "stats.h"
+#include "stored_value_factories.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+
+/*
+ * Unit tests for the SlabAllocator
+ */
+
+class SlabAllocatorTest : public ::testing::Test {
+protected:
+    static constexpr size_t regionSize =
+            (SlabAllocator::slabsPerRegion + 1) * SlabAllocator::slabSize;
+
+    std::shared_ptr<SlabAllocator> slabs = SlabAllocator::create();
+};
+
+constexpr size_t SlabAllocatorTest::regionSize;
+
+TEST_F(SlabAllocatorTest, AllocateDistinctAlignedChunks) {
+    std::set<void*> chunks;
+    for (size_t size = 1; size <= SlabAllocator::maxChunkSize; ++size) {
+        auto* chunk = slabs->allocate(size);
+        ASSERT_NE(nullptr, chunk);
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(chunk) %
+                             SlabAllocator::chunkGranularity);
+        // Writable across the whole requested size.
+        std::memset(chunk, 0xff, size);
+        EXPECT_TRUE(chunks.insert(chunk).second);
+    }
+    EXPECT_EQ(regionSize, slabs->getAllocatedBytes());
+    for (auto* chunk : chunks) {
+        SlabAllocator::deallocate(chunk);
+    }
+    EXPECT_EQ(regionSize, slabs->getFreeBytes());
+}
+
+TEST_F(SlabAllocatorTest, TooLarge) {
+    EXPECT_EQ(nullptr, slabs->allocate(SlabAllocator::maxChunkSize + 1));
+    EXPECT_EQ(0, slabs->getAllocatedBytes());
+}
+
+// Freed chunks are reused by their own size class.
+TEST_F(SlabAllocatorTest, ReuseFreed) {
+    auto* chunk = slabs->allocate(60);
+    EXPECT_EQ(regionSize - 64, slabs->getFreeBytes());
+    SlabAllocator::deallocate(chunk);
+    EXPECT_EQ(regionSize, slabs->getFreeBytes());
+    auto* sameClass = slabs->allocate(49);
+    auto* otherClass = slabs->allocate(80);
+    EXPECT_EQ(chunk, sameClass);
+    EXPECT_NE(chunk, otherClass);
+    SlabAllocator::deallocate(sameClass);
+    SlabAllocator::deallocate(otherClass);
+}
+
+// Fill more than a region with a single size class.
+TEST_F(SlabAllocatorTest, NewRegion) {
+    const size_t chunksPerSlab =
+            SlabAllocator::slabSize / SlabAllocator::maxChunkSize - 1;
+    std::vector<void*> chunks;
+    for (size_t ii = 0; ii <= chunksPerSlab * SlabAllocator::slabsPerRegion;
+         ++ii) {
+        chunks.push_back(slabs->allocate(SlabAllocator::maxChunkSize));
+    }
+    EXPECT_EQ(2 * regionSize, slabs->getAllocatedBytes());
+    for (auto* chunk : chunks) {
+        SlabAllocator::deallocate(chunk);
+    }
+}
+
+// Chunks may be freed after the owner has released the allocator.
+TEST_F(SlabAllocatorTest, OutlivesOwner) {
+    auto* chunk = slabs->allocate(100);
+    slabs.reset();
+    SlabAllocator::deallocate(chunk);
+}
+
+TEST_F(SlabAllocatorTest, StoredValueFactory) {
+    EPStats stats;
+    StoredValueFactory factory(stats, slabs);
+    auto item = make_item(Vbid(0), makeStoredDocKey("key"), "value");
+    ASSERT_LE(StoredValue::getRequiredStorage(item.getKey()),
+              SlabAllocator::maxChunkSize);
+
+    auto sv = factory(item, {});
+    EXPECT_EQ(regionSize, slabs->getAllocatedBytes());
+    EXPECT_LT(slabs->getFreeBytes(), regionSize);
+    auto copy = factory.copyStoredValue(*sv, {});
+    EXPECT_EQ(*sv, *copy);
+    sv.reset();
+    copy.reset();
+    EXPECT_EQ(regionSize, slabs->getFreeBytes());
+}
@@ -28,6 +28,7 @@
 #include "item.h"
 #include "kv_bucket.h"
 #include "memory_tracker.h"
+#include "statwriter.h"
 #include "tasks.h"
 #include "test_helpers.h"
 #include "tests/mock/mock_synchronous_ep_engine.h"
@@ -104,6 +105,49 @@ TEST_F(StatTest, vbucket_seqno_stats_test) {
                         Pair(vbucket + ":high_completed_seqno", "0")));
 }
 
+TEST_F(StatTest, vbucket_details_stats_format) {
+    store_item(vbid, makeStoredDocKey("key"), "value");
+    const std::string vbucket = "vb_" + std::to_string(vbid.get());
+    auto vals = get_stat(("vbucket-details " + std::to_string(vbid.get()))
+                                 .c_str());
+
+    EXPECT_EQ("active", vals[vbucket]);
+    EXPECT_EQ("1", vals[vbucket + ":num_items"]);
+    EXPECT_EQ("1", vals[vbucket + ":high_seqno"]);
+    EXPECT_EQ("false", vals[vbucket + ":ht_resize_in_progress"]);
+    EXPECT_EQ(std::to_string(
+                      store->getVBucket(vbid)->failovers->getLatestUUID()),
+              vals[vbucket + ":uuid"]);
+}
+
+// Integers are formatted without a stringstream; check the extremes.
+TEST(StatWriterTest, add_casted_stat_integers) {
+    std::map<std::string, std::string> stats;
+    auto add_stats = [](const char* key,
+                        const uint16_t klen,
+                        const char* val,
+                        const uint32_t vlen,
+                        gsl::not_null<const void*> cookie) {
+        auto* stats = reinterpret_cast<std::map<std::string, std::string>*>(
+                const_cast<void*>(cookie.get()));
+        (*stats)[std::string(key, klen)] = std::string(val, vlen);
+    };
+
+    add_casted_stat(
+            "u64", std::numeric_limits<uint64_t>::max(), add_stats, &stats);
+    add_casted_stat(
+            "i64", std::numeric_limits<int64_t>::min(), add_stats, &stats);
+    add_casted_stat("i32", int32_t(-1), add_stats, &stats);
+    add_casted_stat("atomic", std::atomic<size_t>{42}, add_stats, &stats);
+    add_casted_stat("bool", true, add_stats, &stats);
+
+    EXPECT_EQ("18446744073709551615", stats["u64"]);
+    EXPECT_EQ("-9223372036854775808", stats["i64"]);
+    EXPECT_EQ("-1", stats["i32"]);
+    EXPECT_EQ("42", stats["atomic"]);
+    EXPECT_EQ("true", stats["bool"]);
+}
+
 // Test that if we request takeover stats for stream that does not exist we
 // return does_not_exist.
 TEST_F(StatTest, vbucket_takeover_stats_no_stream) {
@@ -446,6 +490,33 @@ TEST_F(EpStatsTest, memoryNegativeUntracked) {
     EXPECT_EQ(0, stats.getEstimatedTotalMemoryUsed());
 }
 
+static size_t arenaAllocated;
+
+static bool getArenaAllocated(unsigned arena, size_t* value) {
+    EXPECT_EQ(3u, arena);
+    *value = arenaAllocated;
+    return true;
+}
+
+// With its own arena, a bucket's memory used is read from the arena (on top
+// of what had been tracked before) and allocations aren't tracked.
+TEST_F(EpStatsTest, memoryArena) {
+    TestEpStat stats;
+    stats.memoryTrackerEnabled = true;
+    stats.memAllocated(100);
+
+    arenaAllocated = 1000;
+    stats.setMemoryArena(3, getArenaAllocated);
+    EXPECT_EQ(3u, stats.getMemoryArena());
+    EXPECT_EQ(1100, stats.getEstimatedTotalMemoryUsed());
+
+    stats.memAllocated(50);
+    stats.memDeallocated(100);
+    arenaAllocated = 2000;
+    EXPECT_EQ(2100, stats.getPreciseTotalMemoryUsed());
+    EXPECT_EQ(2100, stats.getEstimatedTotalMemoryUsed());
+}
+
 // Create n threads who all allocate the same amount of memory in very different
 // orders
 TEST_F(EpStatsTest, memoryAllocated) {
@@ -306,6 +306,35 @@ TYPED_TEST(ValueTest, replaceValue) {
     EXPECT_EQ(this->ageInitialValue, this->sv->getAge());
 }
 
+// A value of the same size overwrites a Blob referenced only by the
+// StoredValue in place.
+TYPED_TEST(ValueTest, setValueSameSizeOverwritesInPlace) {
+    auto sv = this->factory(
+            make_item(Vbid(0), makeStoredDocKey("key"), "value"), {});
+    const auto* blob = sv->getValue().get().get();
+    ASSERT_EQ(1, sv->getValue().refCount());
+
+    sv->setValue(make_item(Vbid(0), makeStoredDocKey("key"), "VALUE"));
+    EXPECT_EQ(blob, sv->getValue().get().get());
+    EXPECT_EQ("VALUE", sv->getValue()->to_s());
+
+    // A different size switches to the new Blob.
+    auto item = make_item(Vbid(0), makeStoredDocKey("key"), "value2");
+    sv->setValue(item);
+    EXPECT_EQ(item.getValue().get().get(), sv->getValue().get().get());
+}
+
+// A Blob shared with an Item (e.g. one queued in a checkpoint) is left
+// untouched.
+TYPED_TEST(ValueTest, setValueSameSizeSharedValueNotOverwritten) {
+    ASSERT_EQ(this->item.getValue().get().get(),
+              this->sv->getValue().get().get());
+    auto item = make_item(Vbid(0), makeStoredDocKey("key"), "VALUE");
+    this->sv->setValue(item);
+    EXPECT_EQ(item.getValue().get().get(), this->sv->getValue().get().get());
+    EXPECT_EQ("value", this->item.getValue()->to_s());
+}
+
 TYPED_TEST(ValueTest, restoreValue) {
     ASSERT_EQ(4, this->sv->getFreqCounterValue());
     this->sv->setFreqCounterValue(100);
@@ -512,3 +541,96 @@ TYPED_TEST(StoredValueProtectedTest, MB_32835) {
 
     EXPECT_EQ(this->sv, sv2);
 }
+
+/**
+ * Test fixture for StoredValues with inline value storage.
+ */
+class InlineValueStoredValueTest : public ::testing::Test {
+protected:
+    static constexpr uint8_t capacity = 16;
+
+    StoredValue::UniquePtr makeStoredValue(const std::string& value) {
+        return factory(make_item(Vbid(0), key, value), {});
+    }
+
+    EPStats stats;
+    InlineValueStoredValueFactory factory{stats, capacity};
+    StoredDocKey key = makeStoredDocKey("key");
+};
+
+constexpr uint8_t InlineValueStoredValueTest::capacity;
+
+TEST_F(InlineValueStoredValueTest, SmallValueIsInline) {
+    auto sv = makeStoredValue("value");
+    EXPECT_EQ(capacity, sv->getInlineValueCapacity());
+    EXPECT_TRUE(sv->isValueInline());
+    EXPECT_TRUE(sv->getValue()->isEmbedded());
+    EXPECT_EQ("value", sv->getValue()->to_s());
+    EXPECT_EQ(StoredValue::getRequiredStorage(key, capacity),
+              sv->getObjectSize());
+}
+
+TEST_F(InlineValueStoredValueTest, LargeValueIsNotInline) {
+    const std::string value(capacity + 1, 'x');
+    auto sv = makeStoredValue(value);
+    EXPECT_FALSE(sv->isValueInline());
+    EXPECT_FALSE(sv->getValue()->isEmbedded());
+    EXPECT_EQ(value, sv->getValue()->to_s());
+}
+
+// A value with xattrs stays shared with the Item it was stored from, as the
+// pre-link step may patch the xattrs in place.
+TEST_F(InlineValueStoredValueTest, XattrValueIsNotInline) {
+    auto item = make_item(
+            Vbid(0), key, "value", 0, PROTOCOL_BINARY_DATATYPE_XATTR);
+    auto sv = factory(item, {});
+    EXPECT_FALSE(sv->isValueInline());
+    EXPECT_EQ(item.getValue().get().get(), sv->getValue().get().get());
+}
+
+// Values move in and out of the inline storage as they change size.
+TEST_F(InlineValueStoredValueTest, SetValue) {
+    auto sv = makeStoredValue("value");
+    const std::string large(capacity * 2, 'x');
+    sv->setValue(make_item(Vbid(0), key, large));
+    EXPECT_FALSE(sv->isValueInline());
+    EXPECT_EQ(large, sv->getValue()->to_s());
+
+    sv->setValue(make_item(Vbid(0), key, "small"));
+    EXPECT_TRUE(sv->isValueInline());
+    EXPECT_EQ("small", sv->getValue()->to_s());
+}
+
+// An Item made from the StoredValue has its own copy of an inline value, and
+// so outlives the StoredValue.
+TEST_F(InlineValueStoredValueTest, ToItemCopiesValue) {
+    auto sv = makeStoredValue("value");
+    auto item = sv->toItem(Vbid(0));
+    EXPECT_NE(sv->getValue().get().get(), item->getValue().get().get());
+    EXPECT_FALSE(item->getValue()->isEmbedded());
+    EXPECT_EQ(sv->getFreqCounterValue(), item->getFreqCounterValue());
+    sv.reset();
+    EXPECT_EQ("value", item->getValue()->to_s());
+}
+
+TEST_F(InlineValueStoredValueTest, CopyStoredValue) {
+    auto sv = makeStoredValue("value");
+    auto copy = factory.copyStoredValue(*sv, {});
+    EXPECT_TRUE(copy->isValueInline());
+    EXPECT_NE(sv->getValue().get().get(), copy->getValue().get().get());
+    EXPECT_EQ(*sv, *copy);
+    sv.reset();
+    EXPECT_EQ("value", copy->getValue()->to_s());
+}
+
+// A plain StoredValueFactory can copy a StoredValue with an inline value,
+// giving the copy its own value on the heap.
+TEST_F(InlineValueStoredValueTest, CopyToPlainStoredValue) {
+    auto sv = makeStoredValue("value");
+    StoredValueFactory plainFactory(stats);
+    auto copy = plainFactory.copyStoredValue(*sv, {});
+    EXPECT_EQ(0, copy->getInlineValueCapacity());
+    EXPECT_FALSE(copy->getValue()->isEmbedded());
+    sv.reset();
+    EXPECT_EQ("value", copy->getValue()->to_s());
+}
@@ -258,6 +258,51 @@ TEST_P(SerialisedDocKeyTest, equals) {
     EXPECT_EQ(*serialKey, key);
 }
 
+// SerialisedDocKey compares the bytes of single byte collection-IDs directly,
+// and decodes the others - check both agree with the logical key.
+TEST(SerialisedDocKeyTest, equalsDocKey) {
+    for (CollectionIDType cid : {0x0u, 0x8u, 0x7fu, 0x80u, 0x1234u}) {
+        StoredDocKey key("key", cid);
+        auto serialKey = SerialisedDocKey::make(key);
+        EXPECT_EQ(*serialKey, DocKey(key)) << cid;
+        EXPECT_FALSE(*serialKey == DocKey(StoredDocKey("kez", cid))) << cid;
+        EXPECT_FALSE(*serialKey == DocKey(StoredDocKey("key", cid + 1)))
+                << cid;
+        EXPECT_FALSE(*serialKey == DocKey(StoredDocKey("key1", cid))) << cid;
+
+        const uint8_t legacy[] = {'k', 'e', 'y'};
+        DocKey legacyKey(legacy, sizeof(legacy), DocKeyEncodesCollectionId::No);
+        EXPECT_EQ(cid == CollectionID::Default, *serialKey == legacyKey) << cid;
+    }
+}
+
+// The collection-ID prefix DocKey decodes when created is used by its
+// accessors, including for keys in the durability prepare namespace.
+TEST(DocKeyTest, collectionIdPrefix) {
+    const uint8_t keyRaw[] = {0x80, 0x01, 'k', 'e', 'y'};
+    DocKey key(keyRaw, sizeof(keyRaw), DocKeyEncodesCollectionId::Yes);
+    EXPECT_EQ(CollectionID(0x80), key.getCollectionID());
+    auto idAndKey = key.getIdAndKey();
+    EXPECT_EQ(CollectionID(0x80), idAndKey.first);
+    EXPECT_EQ(keyRaw + 2, idAndKey.second.data());
+    EXPECT_EQ(3, idAndKey.second.size());
+    auto noCollection = key.makeDocKeyWithoutCollectionID();
+    EXPECT_EQ(keyRaw + 2, noCollection.data());
+    EXPECT_EQ(3, noCollection.size());
+
+    const uint8_t prepareRaw[] = {
+            CollectionID::DurabilityPrepare, 0x80, 0x01, 'k', 'e', 'y'};
+    DocKey prepare(
+            prepareRaw, sizeof(prepareRaw), DocKeyEncodesCollectionId::Yes);
+    EXPECT_EQ(CollectionID(0x80), prepare.getCollectionID());
+
+    // An invalid prefix fails as it always did
+    const uint8_t invalidRaw[] = {0x80, 0x80};
+    DocKey invalid(
+            invalidRaw, sizeof(invalidRaw), DocKeyEncodesCollectionId::Yes);
+    EXPECT_THROW(invalid.getCollectionID(), std::invalid_argument);
+}
+
 TEST_P(StoredDocKeyTest, constructFromSerialisedDocKey) {
     StoredDocKey key1("key", GetParam());
     auto serialKey = SerialisedDocKey::make(key1);
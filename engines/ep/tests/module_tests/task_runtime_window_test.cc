@@ -0,0 +1,69 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "task_runtime_window.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace std::chrono_literals;
+
+class TaskRuntimeWindowTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        window.resize(2);
+    }
+
+    TaskRuntimeWindow window;
+};
+
+TEST_F(TaskRuntimeWindowTest, Empty) {
+    EXPECT_EQ(2u, window.size());
+    EXPECT_EQ(0ns, window.getRuntime(0, 100, 10));
+    EXPECT_THROW(window.getRuntime(2, 100, 10), std::out_of_range);
+    EXPECT_THROW(window.add(2, 100, 1ns), std::out_of_range);
+}
+
+// Runtime is summed per task over the requested number of seconds.
+TEST_F(TaskRuntimeWindowTest, Window) {
+    window.add(0, 100, 10ns);
+    window.add(0, 100, 5ns);
+    window.add(0, 105, 20ns);
+    window.add(1, 105, 7ns);
+
+    EXPECT_EQ(20ns, window.getRuntime(0, 105, 1));
+    EXPECT_EQ(20ns, window.getRuntime(0, 105, 5));
+    EXPECT_EQ(35ns, window.getRuntime(0, 105, 6));
+    EXPECT_EQ(7ns, window.getRuntime(1, 105, 10));
+
+    // Older than the window - not counted, and the request is capped at
+    // windowSeconds.
+    const auto later = 100 + TaskRuntimeWindow::windowSeconds;
+    EXPECT_EQ(20ns,
+              window.getRuntime(0, later, TaskRuntimeWindow::windowSeconds * 2));
+
+    window.reset();
+    EXPECT_EQ(0ns, window.getRuntime(0, 105, 10));
+}
+
+// A slot is recycled when the same second-of-window comes round again.
+TEST_F(TaskRuntimeWindowTest, SlotReuse) {
+    window.add(0, 100, 10ns);
+    const auto later = 100 + TaskRuntimeWindow::windowSeconds;
+    window.add(0, later, 3ns);
+    EXPECT_EQ(3ns,
+              window.getRuntime(0, later, TaskRuntimeWindow::windowSeconds));
+}
@@ -0,0 +1,124 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <folly/portability/GTest.h>
+
+#include "vb_ready_queue.h"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class VBReadyQueueTest : public ::testing::Test {
+public:
+    VBReadyQueue queue{200};
+};
+
+TEST_F(VBReadyQueueTest, initAssumptions) {
+    EXPECT_EQ(0u, queue.size());
+    EXPECT_TRUE(queue.empty());
+    Vbid vbid;
+    EXPECT_FALSE(queue.popFront(vbid));
+}
+
+TEST_F(VBReadyQueueTest, PushUnique) {
+    EXPECT_TRUE(queue.pushUnique(Vbid(3)));
+    EXPECT_FALSE(queue.pushUnique(Vbid(3)));
+    EXPECT_FALSE(queue.pushUnique(Vbid(199)));
+    EXPECT_EQ(2u, queue.size());
+    EXPECT_TRUE(queue.exists(Vbid(3)));
+    EXPECT_TRUE(queue.exists(Vbid(199)));
+    EXPECT_FALSE(queue.exists(Vbid(4)));
+    EXPECT_THROW(queue.pushUnique(Vbid(200)), std::out_of_range);
+
+    queue.clear();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.exists(Vbid(3)));
+}
+
+// A vbucket which is ready again should be served after the other ready
+// vbuckets
+TEST_F(VBReadyQueueTest, RoundRobin) {
+    for (uint16_t vb : {5, 70, 130}) {
+        queue.pushUnique(Vbid(vb));
+    }
+
+    Vbid vbid;
+    ASSERT_TRUE(queue.popFront(vbid));
+    EXPECT_EQ(Vbid(5), vbid);
+    queue.pushUnique(Vbid(5));
+    queue.pushUnique(Vbid(1));
+
+    std::vector<uint16_t> order;
+    while (queue.popFront(vbid)) {
+        order.push_back(vbid.get());
+    }
+    EXPECT_EQ((std::vector<uint16_t>{70, 130, 1, 5}), order);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(VBReadyQueueTest, PopBatch) {
+    for (uint16_t vb = 0; vb < 200; vb += 10) {
+        queue.pushUnique(Vbid(vb));
+    }
+
+    std::vector<Vbid> batch;
+    EXPECT_EQ(8u, queue.popFront(batch, 8));
+    EXPECT_EQ(12u, queue.size());
+    EXPECT_EQ(12u, queue.popFront(batch, 100));
+    EXPECT_TRUE(queue.empty());
+    ASSERT_EQ(20u, batch.size());
+    for (size_t ii = 0; ii < batch.size(); ++ii) {
+        EXPECT_EQ(Vbid(uint16_t(ii * 10)), batch[ii]);
+    }
+}
+
+// Every pushed vbucket should be popped (and the count should end up at
+// zero) when multiple threads push and pop concurrently
+TEST_F(VBReadyQueueTest, Concurrent) {
+    std::vector<std::thread> producers;
+    for (int ii = 0; ii < 4; ++ii) {
+        producers.emplace_back([this]() {
+            for (uint16_t vb = 0; vb < 200; ++vb) {
+                queue.pushUnique(Vbid(vb));
+            }
+        });
+    }
+
+    std::vector<int> popped(200);
+    auto drain = [this, &popped]() {
+        std::vector<Vbid> batch;
+        queue.popFront(batch, 16);
+        for (const auto& vb : batch) {
+            popped[vb.get()]++;
+        }
+        return batch.size();
+    };
+    for (int ii = 0; ii < 1000; ++ii) {
+        drain();
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    while (drain() != 0) {
+    }
+
+    EXPECT_TRUE(queue.empty());
+    for (uint16_t vb = 0; vb < 200; ++vb) {
+        EXPECT_LE(1, popped[vb]) << vb;
+    }
+}
@@ -282,6 +282,101 @@ TEST_P(VBucketDurabilityTest, CommitSyncWriteLoop) {
     }
 }
 
+// Commits and Aborts completed as a batch only notify the clients (and the
+// new seqnos) once the whole batch is completed.
+TEST_P(VBucketDurabilityTest, CompleteSyncWritesAsBatch) {
+    using namespace cb::durability;
+    auto reqs = Requirements{Level::Majority, Timeout::Infinity()};
+
+    const int numWrites = 4;
+    for (int i = 0; i < numWrites; i++) {
+        auto key = makeStoredDocKey("key" + std::to_string(i));
+        auto pending = makePendingItem(key, "value");
+        pending->setPendingSyncWrite(reqs);
+        VBQueueItemCtx ctx;
+        ctx.durability = DurabilityItemCtx{reqs, cookie};
+        ASSERT_EQ(MutationStatus::WasClean,
+                  public_processSet(*pending, 0 /*cas*/, ctx));
+    }
+
+    SyncWriteCompletionBatch batch;
+    for (int i = 0; i < numWrites; i++) {
+        auto key = makeStoredDocKey("key" + std::to_string(i));
+        const uint64_t prepareSeqno = lastSeqno + i + 1;
+        if (i % 2) {
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      vbucket->abort(key,
+                                     prepareSeqno,
+                                     {},
+                                     vbucket->lockCollections(key),
+                                     cookie,
+                                     &batch));
+        } else {
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      vbucket->commit(key,
+                                      prepareSeqno,
+                                      {},
+                                      vbucket->lockCollections(key),
+                                      cookie,
+                                      &batch));
+        }
+    }
+
+    // Completed, but nobody notified yet
+    EXPECT_EQ(lastSeqno + 2 * numWrites, vbucket->getHighSeqno());
+    EXPECT_EQ(lastSeqno + 2 * numWrites, batch.newSeqno.bySeqno);
+    EXPECT_EQ(numWrites, batch.clients.size());
+    EXPECT_EQ(SWCompleteTrace(0 /*count*/, nullptr, ENGINE_EINVAL),
+              swCompleteTrace);
+
+    vbucket->notifySyncWritesCompleted(batch);
+    EXPECT_EQ(SWCompleteTrace(numWrites /*count*/,
+                              cookie,
+                              ENGINE_SYNC_WRITE_AMBIGUOUS),
+              swCompleteTrace);
+}
+
+// Check that the ActiveDM registers the expiry-time of the first tracked
+// SyncWrite (the only one which may time out next) with the
+// DurabilityTimeoutTask, and re-registers it after each timeout check.
+TEST_P(VBucketDurabilityTest, ScheduleSyncWriteTimeout) {
+    using namespace cb::durability;
+    const auto start = std::chrono::steady_clock::now();
+    auto& adm = VBucketTestIntrospector::public_getActiveDM(*vbucket);
+
+    auto addSyncWrite = [this](const std::string& key, Timeout timeout) {
+        auto reqs = Requirements{Level::Majority, timeout};
+        auto pending = makePendingItem(makeStoredDocKey(key), "value");
+        pending->setPendingSyncWrite(reqs);
+        VBQueueItemCtx ctx;
+        ctx.durability = DurabilityItemCtx{reqs, cookie};
+        ASSERT_EQ(MutationStatus::WasClean,
+                  public_processSet(*pending, 0 /*cas*/, ctx));
+    };
+
+    addSyncWrite("key1", Timeout(10000));
+    ASSERT_EQ(1, swTimeoutTrace.size());
+    const auto firstExpiry = swTimeoutTrace.back();
+    EXPECT_GE(firstExpiry, start + std::chrono::milliseconds(10000));
+
+    // The second SyncWrite expires earlier, but it cannot be aborted before
+    // the first one so no new deadline is registered.
+    addSyncWrite("key2", Timeout(5000));
+    EXPECT_EQ(1, swTimeoutTrace.size());
+
+    // Nothing expired; the check re-registers the deadline of the first.
+    vbucket->processDurabilityTimeout(std::chrono::steady_clock::now());
+    ASSERT_EQ(2, swTimeoutTrace.size());
+    EXPECT_EQ(firstExpiry, swTimeoutTrace.back());
+    EXPECT_EQ(2, adm.getNumTracked());
+
+    // Both expire; nothing left to schedule.
+    vbucket->processDurabilityTimeout(firstExpiry +
+                                      std::chrono::milliseconds(1));
+    EXPECT_EQ(0, adm.getNumTracked());
+    EXPECT_EQ(2, swTimeoutTrace.size());
+}
+
 TEST_P(VBucketDurabilityTest, AbortSyncWriteLoop) {
     ht->clear();
     ckptMgr->clear(*vbucket, 0);
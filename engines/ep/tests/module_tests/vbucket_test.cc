@@ -27,6 +27,7 @@
 #include "persistence_callback.h"
 #include "programs/engine_testapp/mock_server.h"
 #include "tests/module_tests/test_helpers.h"
+#include "vb_visitors.h"
 #include "vbucket_bgfetch_item.h"
 
 #include "../mock/mock_ephemeral_vb.h"
@@ -71,6 +72,7 @@ VBucketTestBase::VBucketTestBase(VBType vbType,
                               /*flusher callback*/ nullptr,
                               /*newSeqnoCb*/ nullptr,
                               noOpSyncWriteResolvedCb,
+                              TracedSyncWriteTimeoutCb,
                               TracedSyncWriteCompleteCb,
                               NoopSeqnoAckCb,
                               config,
@@ -89,6 +91,7 @@ VBucketTestBase::VBucketTestBase(VBType vbType,
                                                /*table*/ nullptr,
                                                /*newSeqnoCb*/ nullptr,
                                                noOpSyncWriteResolvedCb,
+                                               TracedSyncWriteTimeoutCb,
                                                TracedSyncWriteCompleteCb,
                                                NoopSeqnoAckCb,
                                                config,
@@ -589,6 +592,35 @@ TEST_P(VBucketTest, GetItemsToPersist_LimitCkptMoreAvailable) {
     EXPECT_EQ(0, result.items.size());
 }
 
+// A collection-scoped HashTable visitor skips a VBucket holding none of the
+// collection's items, and visits one which does.
+TEST_P(VBucketTest, CollectionScopedVisitSkipsVBucket) {
+    struct CountingVisitor : public VBucketAwareHTVisitor {
+        bool visit(const HashTable::HashBucketLock&, StoredValue&) override {
+            ++visited;
+            return true;
+        }
+        boost::optional<CollectionID> getVisitedCollection() const override {
+            return CollectionID(8);
+        }
+        size_t visited = 0;
+    };
+
+    for (const auto& key : generateKeys(10)) {
+        ASSERT_EQ(MutationStatus::WasClean, setOne(key));
+    }
+
+    PauseResumeVBAdapter adapter(std::make_unique<CountingVisitor>());
+    auto& visitor = static_cast<CountingVisitor&>(adapter.getHTVisitor());
+    EXPECT_TRUE(adapter.visit(*this->vbucket));
+    EXPECT_EQ(0, visitor.visited);
+
+    ASSERT_EQ(MutationStatus::WasClean,
+              setOne(makeStoredDocKey("key", CollectionID(8))));
+    EXPECT_TRUE(adapter.visit(*this->vbucket));
+    EXPECT_EQ(11, visitor.visited);
+}
+
 class VBucketEvictionTest : public VBucketTest {};
 
 // Regression test for MB-21448 - if an attempt is made to perform a CAS
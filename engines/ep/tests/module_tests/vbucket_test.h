@@ -141,6 +141,16 @@ protected:
         return;
     };
 
+    /// Deadlines passed to the SyncWriteTimeoutCallback, in call order.
+    std::vector<std::chrono::steady_clock::time_point> swTimeoutTrace;
+
+    // Mock SyncWriteTimeoutCallback that helps in testing the scheduling of
+    // the Durability Timeout.
+    const SyncWriteTimeoutCallback TracedSyncWriteTimeoutCb =
+            [this](Vbid, std::chrono::steady_clock::time_point deadline) {
+                swTimeoutTrace.push_back(deadline);
+            };
+
     std::unique_ptr<VBucket> vbucket;
     EPStats global_stats;
     CheckpointConfig checkpoint_config;
@@ -465,6 +465,20 @@ public:
         }
     }
 
+    cb::EngineErrorItemPair get_replica(
+            gsl::not_null<const void*> cookie,
+            const DocKey& key,
+            Vbid vbucket,
+            std::chrono::milliseconds maxStaleness) override {
+        ENGINE_ERROR_CODE err = ENGINE_SUCCESS;
+        if (should_inject_error(Cmd::GET, cookie, err)) {
+            return cb::makeEngineErrorItemPair(cb::engine_errc(err));
+        } else {
+            return real_engine->get_replica(
+                    cookie, key, vbucket, maxStaleness);
+        }
+    }
+
     ENGINE_ERROR_CODE unlock(gsl::not_null<const void*> cookie,
                              const DocKey& key,
                              Vbid vbucket,
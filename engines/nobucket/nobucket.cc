@@ -110,6 +110,13 @@ public:
         return cb::makeEngineErrorItemPair(cb::engine_errc::no_bucket);
     }
 
+    cb::EngineErrorItemPair get_replica(gsl::not_null<const void*>,
+                                        const DocKey&,
+                                        Vbid,
+                                        std::chrono::milliseconds) override {
+        return cb::makeEngineErrorItemPair(cb::engine_errc::no_bucket);
+    }
+
     ENGINE_ERROR_CODE unlock(gsl::not_null<const void*>,
                              const DocKey&,
                              Vbid,
@@ -0,0 +1,358 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <memcached/sampling_profiler.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstdlib>
+#endif
+
+namespace cb {
+namespace profiler {
+
+/// Maximum number of frames recorded per sample
+static const int MaxFrames = 64;
+/// Maximum length (including the terminator) of a recorded tag
+static const size_t MaxTagSize = 64;
+/// Maximum number of distinct stacks kept; further ones are only counted
+static const size_t MaxStacks = 100000;
+/// Frames of a sample belonging to the signal handler (the handler itself
+/// and the signal trampoline)
+static const size_t HandlerFrames = 2;
+/// How long the sampling thread waits for a thread to record its sample
+static const std::chrono::milliseconds SampleTimeout{10};
+
+namespace {
+
+struct ThreadState {
+    std::string name;
+#ifdef __linux__
+    pthread_t thread;
+#endif
+    std::atomic<const char*> bucket{nullptr};
+    std::atomic<const char*> what{nullptr};
+
+    // The sample; written by the signal handler (on the thread itself) and
+    // only read by the sampling thread once sampled is set.
+    void* frames[MaxFrames];
+    int depth = 0;
+    char sampleBucket[MaxTagSize];
+    char sampleWhat[MaxTagSize];
+    std::atomic<bool> sampled{true};
+};
+
+struct StackKey {
+    std::string thread;
+    std::string bucket;
+    std::string what;
+    std::vector<void*> frames;
+
+    bool operator<(const StackKey& other) const {
+        return std::tie(thread, bucket, what, frames) <
+               std::tie(other.thread, other.bucket, other.what, other.frames);
+    }
+};
+
+struct Profiler {
+    /// Registered threads; held while a round of samples is taken
+    std::mutex registryMutex;
+    std::vector<ThreadState*> threads;
+
+    std::mutex samplesMutex;
+    std::map<StackKey, uint64_t> samples;
+    uint64_t dropped = 0;
+
+    /// Serialises start / stop
+    std::mutex controlMutex;
+    std::mutex runningMutex;
+    std::condition_variable runningCond;
+    bool running = false;
+    std::thread sampler;
+};
+
+Profiler& getProfiler() {
+    static Profiler profiler;
+    return profiler;
+}
+
+} // anonymous namespace
+
+static thread_local ThreadState* currentThread = nullptr;
+
+ScopedThreadRegistration::ScopedThreadRegistration(const char* name) {
+    auto* state = new ThreadState;
+    state->name = name;
+#ifdef __linux__
+    state->thread = pthread_self();
+#endif
+    auto& profiler = getProfiler();
+    std::lock_guard<std::mutex> guard(profiler.registryMutex);
+    profiler.threads.push_back(state);
+    currentThread = state;
+}
+
+ScopedThreadRegistration::~ScopedThreadRegistration() {
+    auto& profiler = getProfiler();
+    std::lock_guard<std::mutex> guard(profiler.registryMutex);
+    auto* state = currentThread;
+    // Any sample signal still pending for this thread finds no state.
+    currentThread = nullptr;
+    auto& threads = profiler.threads;
+    threads.erase(std::remove(threads.begin(), threads.end(), state),
+                  threads.end());
+    delete state;
+}
+
+ScopedTag::ScopedTag(const char* bucket, const char* what)
+    : previousBucket(currentThread ? currentThread->bucket.load() : nullptr),
+      previousWhat(currentThread ? currentThread->what.load() : nullptr) {
+    if (currentThread) {
+        currentThread->bucket.store(bucket, std::memory_order_relaxed);
+        currentThread->what.store(what, std::memory_order_relaxed);
+    }
+}
+
+ScopedTag::~ScopedTag() {
+    if (currentThread) {
+        currentThread->bucket.store(previousBucket, std::memory_order_relaxed);
+        currentThread->what.store(previousWhat, std::memory_order_relaxed);
+    }
+}
+
+#ifdef __linux__
+
+static void copyTag(char* dest, const char* tag) {
+    size_t ii = 0;
+    if (tag) {
+        for (; ii < MaxTagSize - 1 && tag[ii] != '\0'; ++ii) {
+            dest[ii] = tag[ii];
+        }
+    }
+    dest[ii] = '\0';
+}
+
+static void sampleHandler(int) {
+    auto* state = currentThread;
+    if (!state || state->sampled.load(std::memory_order_acquire)) {
+        return;
+    }
+    const int savedErrno = errno;
+    state->depth = backtrace(state->frames, MaxFrames);
+    copyTag(state->sampleBucket,
+            state->bucket.load(std::memory_order_relaxed));
+    copyTag(state->sampleWhat, state->what.load(std::memory_order_relaxed));
+    state->sampled.store(true, std::memory_order_release);
+    errno = savedErrno;
+}
+
+/// Interrupt every registered thread and record its stack
+static void sampleThreads(Profiler& profiler) {
+    std::lock_guard<std::mutex> guard(profiler.registryMutex);
+    for (auto* state : profiler.threads) {
+        state->sampled.store(false, std::memory_order_release);
+        pthread_kill(state->thread, SIGPROF);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + SampleTimeout;
+    std::lock_guard<std::mutex> samplesGuard(profiler.samplesMutex);
+    for (auto* state : profiler.threads) {
+        while (!state->sampled.load(std::memory_order_acquire) &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        if (!state->sampled.load(std::memory_order_acquire)) {
+            // Didn't respond in time; skip this round.
+            continue;
+        }
+
+        StackKey key{state->name,
+                     state->sampleBucket,
+                     state->sampleWhat,
+                     {state->frames, state->frames + state->depth}};
+        auto it = profiler.samples.find(key);
+        if (it != profiler.samples.end()) {
+            ++it->second;
+        } else if (profiler.samples.size() < MaxStacks) {
+            profiler.samples.emplace(std::move(key), 1);
+        } else {
+            ++profiler.dropped;
+        }
+    }
+}
+
+static void samplerMain(Profiler& profiler, size_t frequency) {
+    const auto interval = std::chrono::microseconds(1000000 / frequency);
+    std::unique_lock<std::mutex> lock(profiler.runningMutex);
+    while (profiler.running) {
+        profiler.runningCond.wait_for(
+                lock, interval, [&profiler] { return !profiler.running; });
+        if (!profiler.running) {
+            break;
+        }
+        lock.unlock();
+        sampleThreads(profiler);
+        lock.lock();
+    }
+}
+
+static std::string symbolize(void* address) {
+    Dl_info info;
+    if (dladdr(address, &info) && info.dli_sname) {
+        int status = 0;
+        char* demangled =
+                abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = status == 0 ? demangled : info.dli_sname;
+        std::free(demangled);
+        // ';' separates the frames in the folded format
+        std::replace(name.begin(), name.end(), ';', ':');
+        return name;
+    }
+    std::ostringstream ss;
+    ss << address;
+    return ss.str();
+}
+
+bool isSupported() {
+    return true;
+}
+
+void start(size_t frequency) {
+    auto& profiler = getProfiler();
+    std::lock_guard<std::mutex> guard(profiler.controlMutex);
+    if (profiler.sampler.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(profiler.runningMutex);
+            profiler.running = false;
+        }
+        profiler.runningCond.notify_all();
+        profiler.sampler.join();
+    }
+    if (frequency == 0) {
+        return;
+    }
+
+    static std::once_flag installHandler;
+    std::call_once(installHandler, [] {
+        // backtrace() may allocate the first time it's called (loading
+        // libgcc); make sure that isn't in the signal handler.
+        void* frames[1];
+        backtrace(frames, 1);
+
+        struct sigaction sa = {};
+        sa.sa_handler = sampleHandler;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGPROF, &sa, nullptr);
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(profiler.runningMutex);
+        profiler.running = true;
+    }
+    profiler.sampler = std::thread(samplerMain,
+                                   std::ref(profiler),
+                                   std::min(frequency, size_t(1000)));
+}
+
+std::string toFolded() {
+    std::map<StackKey, uint64_t> samples;
+    uint64_t dropped;
+    {
+        auto& profiler = getProfiler();
+        std::lock_guard<std::mutex> guard(profiler.samplesMutex);
+        samples = profiler.samples;
+        dropped = profiler.dropped;
+    }
+
+    std::unordered_map<void*, std::string> symbols;
+    std::string folded;
+    for (const auto& sample : samples) {
+        const auto& key = sample.first;
+        folded.append(key.thread);
+        for (const auto* tag : {&key.bucket, &key.what}) {
+            if (!tag->empty()) {
+                folded.push_back(';');
+                folded.append(*tag);
+            }
+        }
+        // Outermost frame first, omitting the frames of the signal handler
+        const size_t innermost = std::min(HandlerFrames, key.frames.size());
+        for (size_t ii = key.frames.size(); ii > innermost; --ii) {
+            auto* address = key.frames[ii - 1];
+            auto symbol = symbols.find(address);
+            if (symbol == symbols.end()) {
+                symbol = symbols.emplace(address, symbolize(address)).first;
+            }
+            folded.push_back(';');
+            folded.append(symbol->second);
+        }
+        folded.push_back(' ');
+        folded.append(std::to_string(sample.second));
+        folded.push_back('\n');
+    }
+    if (dropped) {
+        folded.append("[dropped] " + std::to_string(dropped) + "\n");
+    }
+    return folded;
+}
+
+#else
+
+bool isSupported() {
+    return false;
+}
+
+void start(size_t) {
+}
+
+std::string toFolded() {
+    return {};
+}
+
+#endif // __linux__
+
+void stop() {
+    start(0);
+}
+
+void clear() {
+    auto& profiler = getProfiler();
+    std::lock_guard<std::mutex> guard(profiler.samplesMutex);
+    profiler.samples.clear();
+    profiler.dropped = 0;
+}
+
+} // namespace profiler
+} // namespace cb
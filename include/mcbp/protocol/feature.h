@@ -68,6 +68,11 @@ enum class Feature : uint16_t {
 
     /// Do the server support OpenTracing
     OpenTracing = 0x13,
+
+    /// The client wants to receive the changes in the vBucket map instead
+    /// of the full cluster map when possible (requires
+    /// ClustermapChangeNotification)
+    ClustermapChangeNotificationDelta = 0x14,
 };
 
 } // namespace mcbp
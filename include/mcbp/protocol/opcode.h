@@ -140,6 +140,7 @@ enum class ClientOpcode : uint8_t {
     DcpSeqnoAcknowledged = 0x61,
     DcpCommit = 0x62,
     DcpAbort = 0x63,
+    DcpSeqnoAdvanced = 0x64,
     /* End DCP */
 
     StopPersistence = 0x80,
@@ -260,6 +261,24 @@ enum class ClientOpcode : uint8_t {
      */
     CollectionsGetScopeID = 0xbc,
 
+    /**
+     * Command to get multiple documents (possibly in different vbuckets)
+     * with a single request
+     */
+    GetMulti = 0xbd,
+
+    /**
+     * Command to apply multiple increment / decrement operations (possibly
+     * in different vbuckets) with a single request
+     */
+    ArithmeticMulti = 0xbe,
+
+    /**
+     * Command to apply multiple SetWithMeta operations (possibly in
+     * different vbuckets) with a single request
+     */
+    SetWithMetaMulti = 0xbf,
+
     /**
      * Commands for GO-XDCR
      */
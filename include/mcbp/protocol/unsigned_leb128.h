@@ -19,9 +19,15 @@
 #include <boost/optional/optional.hpp>
 #include <platform/sized_buffer.h>
 #include <array>
+#include <cstring>
 #include <gsl/gsl>
 #include <type_traits>
 
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && \
+        __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CB_LEB128_WORD_DECODE 1
+#endif
+
 namespace cb {
 namespace mcbp {
 
@@ -33,6 +39,39 @@ namespace mcbp {
 
 struct Leb128NoThrow {};
 
+#ifdef CB_LEB128_WORD_DECODE
+namespace detail {
+/**
+ * Decode a leb128 value of (up to) 8 bytes without looping over the bytes:
+ * the stop byte is located with a single count-trailing-zeros of the 8 bytes
+ * loaded as one word, and the 7 bit groups are then packed together with a
+ * fixed sequence of shifts and masks.
+ *
+ * @param buf the 8 bytes to decode from (they must all be readable)
+ * @param value set to the decoded value
+ * @return the length of the encoding, or 0 if there's no stop byte in the
+ *         first 8 bytes (the value must then be decoded byte by byte)
+ */
+static inline size_t decode_unsigned_leb128_word(const uint8_t* buf,
+                                                 uint64_t& value) {
+    uint64_t word;
+    std::memcpy(&word, buf, sizeof(word));
+    const uint64_t stops = ~word & 0x8080808080808080ull;
+    if (stops == 0) {
+        return 0;
+    }
+    // The stop byte's MSbit is the lowest set bit in stops
+    const auto bits = __builtin_ctzll(stops) + 1;
+    word &= (~0ull >> (64 - bits)) & 0x7f7f7f7f7f7f7f7full;
+    value = (word & 0x7full) | ((word >> 1) & (0x7full << 7)) |
+            ((word >> 2) & (0x7full << 14)) | ((word >> 3) & (0x7full << 21)) |
+            ((word >> 4) & (0x7full << 28)) | ((word >> 5) & (0x7full << 35)) |
+            ((word >> 6) & (0x7full << 42)) | ((word >> 7) & (0x7full << 49));
+    return size_t(bits / 8);
+}
+} // namespace detail
+#endif
+
 /**
  * decode_unsigned_leb128 returns the decoded T and a const_byte_buffer
  * initialised with the data following the leb128 data. This form of the decode
@@ -49,9 +88,26 @@ template <class T>
 typename std::enable_if<std::is_unsigned<T>::value,
                         std::pair<T, cb::const_byte_buffer>>::type
 decode_unsigned_leb128(cb::const_byte_buffer buf, struct Leb128NoThrow) {
+    if (buf.empty()) {
+        return {0, cb::const_byte_buffer{}};
+    }
     T rv = buf[0] & 0x7full;
     size_t end = 0;
     if ((buf[0] & 0x80) == 0x80ull) {
+#ifdef CB_LEB128_WORD_DECODE
+        // Most multi-byte values are followed by enough data (e.g. the rest
+        // of the key) to decode them a word at a time
+        if (buf.size() >= sizeof(uint64_t)) {
+            uint64_t value;
+            const auto length =
+                    detail::decode_unsigned_leb128_word(buf.data(), value);
+            if (length != 0) {
+                return {gsl::narrow_cast<T>(value),
+                        cb::const_byte_buffer{buf.data() + length,
+                                              buf.size() - length}};
+            }
+        }
+#endif
         T shift = 7;
         // shift in the remaining data
         for (end = 1; end < buf.size(); end++) {
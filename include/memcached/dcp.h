@@ -350,6 +350,25 @@ struct dcp_message_producers {
                                     const DocKey& key,
                                     uint64_t prepared_seqno,
                                     uint64_t abort_seqno) = 0;
+
+    /**
+     * Send a seqno advanced message:
+     *
+     * This is sent from the DCP Producer to the DCP Consumer to end an out
+     * of sequence order snapshot; the stream has then sent everything up to
+     * the given seqno even though the last item it sent may have a lower one.
+     *
+     * @param opaque this is the opaque requested by the consumer
+     *               in the Stream Request message
+     * @param vbucket the vbucket the message belong to
+     * @param seqno the seqno the stream has advanced to
+     * @param sid The stream-ID the message applies to (can be 0 for none)
+     * @return ENGINE_SUCCESS upon success
+     */
+    virtual ENGINE_ERROR_CODE seqno_advanced(uint32_t opaque,
+                                             Vbid vbucket,
+                                             uint64_t seqno,
+                                             cb::mcbp::DcpStreamId sid) = 0;
 };
 
 typedef ENGINE_ERROR_CODE (*dcp_add_failover_log)(
@@ -20,6 +20,7 @@
 #include <cstring>
 #include <iomanip>
 
+#include <mcbp/protocol/unsigned_leb128.h>
 #include <platform/sized_buffer.h>
 #include <platform/socket.h>
 
@@ -274,6 +275,10 @@ struct DocKeyInterface {
  * DocKey is a non-owning structure used to describe a document keys over
  * the engine-API. All API commands working with "keys" must specify the
  * data, length and if the data contain an encoded CollectionID
+ *
+ * The collection-ID prefix of a key which encodes one is decoded once, when
+ * the DocKey is created, so the (many) users of the collection-ID along the
+ * path of a request don't each decode it again.
  */
 struct DocKey : DocKeyInterface<DocKey> {
     /**
@@ -281,6 +286,9 @@ struct DocKey : DocKeyInterface<DocKey> {
      */
     DocKey(const uint8_t* key, size_t nkey, DocKeyEncodesCollectionId encoding)
         : buffer(key, nkey), encoding(encoding) {
+        if (encoding == DocKeyEncodesCollectionId::Yes) {
+            decodePrefix();
+        }
     }
 
     /**
@@ -322,7 +330,15 @@ struct DocKey : DocKeyInterface<DocKey> {
         return buffer.size();
     }
 
-    CollectionID getCollectionID() const;
+    CollectionID getCollectionID() const {
+        if (encoding == DocKeyEncodesCollectionId::No) {
+            return CollectionID::Default;
+        }
+        if (prefixLength != 0 && prefixId != CollectionID::DurabilityPrepare) {
+            return prefixId;
+        }
+        return decodeCollectionID();
+    }
 
     /// Certain key prefixes are internal and not to be seen
     bool isPrivate() const {
@@ -356,8 +372,28 @@ struct DocKey : DocKeyInterface<DocKey> {
     std::string to_string() const;
 
 private:
+    /// Decode (and cache) the leading collection-ID prefix of the key
+    void decodePrefix() {
+        const auto decoded = cb::mcbp::decode_unsigned_leb128<CollectionIDType>(
+                buffer, cb::mcbp::Leb128NoThrow());
+        const auto length = buffer.size() - decoded.second.size();
+        // An invalid prefix isn't cached (the users of the prefix decode it
+        // again and fail as normal)
+        if (decoded.second.data() && length <= UINT8_MAX) {
+            prefixId = decoded.first;
+            prefixLength = uint8_t(length);
+        }
+    }
+
+    /// Decode the collection-ID which follows a durability prepare prefix
+    CollectionID decodeCollectionID() const;
+
     cb::const_byte_buffer buffer;
     DocKeyEncodesCollectionId encoding{DocKeyEncodesCollectionId::No};
+    /// The length of the (leading) collection-ID prefix, 0 if not decoded
+    uint8_t prefixLength{0};
+    /// The value of the (leading) collection-ID prefix
+    CollectionIDType prefixId{0};
 };
 
 /**
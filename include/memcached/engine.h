@@ -3,6 +3,7 @@
 #define MEMCACHED_ENGINE_H
 
 #include <sys/types.h>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
@@ -393,6 +394,26 @@ struct MEMCACHED_PUBLIC_CLASS EngineIface {
             Vbid vbucket,
             uint32_t lock_timeout) = 0;
 
+    /**
+     * Retrieve an item from a replica vbucket (GET_REPLICA).
+     *
+     * Optional interface; not supported by all engines.
+     *
+     * @param cookie The cookie provided by the frontend
+     * @param key the key to look up
+     * @param vbucket the virtual bucket id (must be a replica)
+     * @param maxStaleness fail the request with temporary_failure if the
+     *                     replica may be more out of date than this
+     *                     (milliseconds::max() to accept any staleness)
+     *
+     * @return A pair of the error code and (optionally) the item
+     */
+    virtual cb::EngineErrorItemPair get_replica(
+            gsl::not_null<const void*> cookie,
+            const DocKey& key,
+            Vbid vbucket,
+            std::chrono::milliseconds maxStaleness);
+
     /**
      * Unlock an item.
      *
@@ -678,6 +699,14 @@ inline EngineErrorItemPair makeEngineErrorItemPair(cb::engine_errc err,
 }
 }
 
+inline cb::EngineErrorItemPair EngineIface::get_replica(
+        gsl::not_null<const void*>,
+        const DocKey&,
+        Vbid,
+        std::chrono::milliseconds) {
+    return cb::makeEngineErrorItemPair(cb::engine_errc::not_supported);
+}
+
 /**
  * @}
  */
@@ -1443,6 +1443,26 @@ protected:
 };
 static_assert(sizeof(DcpAbortPayload) == 16, "Unexpected struct size");
 
+class DcpSeqnoAdvancedPayload {
+public:
+    explicit DcpSeqnoAdvancedPayload(uint64_t seqno)
+        : by_seqno(htonll(seqno)) {
+    }
+
+    uint64_t getSeqno() const {
+        return ntohll(by_seqno);
+    }
+
+    cb::const_byte_buffer getBuffer() const {
+        return {reinterpret_cast<const uint8_t*>(this), sizeof(*this)};
+    }
+
+protected:
+    // Stored in network order.
+    uint64_t by_seqno = 0;
+};
+static_assert(sizeof(DcpSeqnoAdvancedPayload) == 8, "Unexpected struct size");
+
 class SetParamPayload {
 public:
     enum class Type : uint32_t {
@@ -1575,6 +1595,89 @@ protected:
 };
 static_assert(sizeof(SetWithMetaPayload) == 24, "Unexpected struct size");
 
+/**
+ * The header of an entry in the value of a SetWithMetaMulti request. It is
+ * followed by the key and the value of the document, and the fields have
+ * the same meaning as for SetWithMeta.
+ */
+class SetWithMetaMultiEntry {
+public:
+    Vbid getVBucket() const {
+        return vbucket.ntoh();
+    }
+    void setVBucket(Vbid vbucket) {
+        SetWithMetaMultiEntry::vbucket = vbucket.hton();
+    }
+    uint16_t getKeylen() const {
+        return ntohs(keylen);
+    }
+    void setKeylen(uint16_t keylen) {
+        SetWithMetaMultiEntry::keylen = htons(keylen);
+    }
+    uint8_t getDatatype() const {
+        return datatype;
+    }
+    void setDatatype(uint8_t datatype) {
+        SetWithMetaMultiEntry::datatype = datatype;
+    }
+    uint32_t getValuelen() const {
+        return ntohl(valuelen);
+    }
+    void setValuelen(uint32_t valuelen) {
+        SetWithMetaMultiEntry::valuelen = htonl(valuelen);
+    }
+    const SetWithMetaPayload& getMeta() const {
+        return meta;
+    }
+    SetWithMetaPayload& getMeta() {
+        return meta;
+    }
+    cb::const_byte_buffer getBuffer() const {
+        return {reinterpret_cast<const uint8_t*>(this), sizeof(*this)};
+    }
+
+    /**
+     * Call the callback with the header, key and value of each of the
+     * entries in the value of a SetWithMetaMulti request (until the
+     * callback returns false).
+     *
+     * @return false if the value is malformed (an entry is truncated)
+     */
+    template <typename Callback>
+    static bool parse(cb::const_byte_buffer value, Callback callback) {
+        while (!value.empty()) {
+            if (value.size() < sizeof(SetWithMetaMultiEntry)) {
+                return false;
+            }
+            const auto* entry =
+                    reinterpret_cast<const SetWithMetaMultiEntry*>(
+                            value.data());
+            const size_t total = sizeof(SetWithMetaMultiEntry) +
+                                 entry->getKeylen() + entry->getValuelen();
+            if (value.size() < total) {
+                return false;
+            }
+            const auto* key = value.data() + sizeof(SetWithMetaMultiEntry);
+            if (!callback(*entry,
+                          cb::const_byte_buffer{key, entry->getKeylen()},
+                          cb::const_byte_buffer{key + entry->getKeylen(),
+                                                entry->getValuelen()})) {
+                return true;
+            }
+            value = {value.data() + total, value.size() - total};
+        }
+        return true;
+    }
+
+protected:
+    Vbid vbucket{0};
+    uint16_t keylen = 0;
+    uint8_t datatype = 0;
+    uint32_t valuelen = 0;
+    SetWithMetaPayload meta;
+};
+static_assert(sizeof(SetWithMetaMultiEntry) == 33, "Unexpected struct size");
+
 class DelWithMetaPayload {
 public:
     uint32_t getFlags() const {
@@ -184,6 +184,12 @@ public:
      */
     PrivilegeAccess check(Privilege privilege) const;
 
+    /**
+     * Check if the privilege database changed since this context was
+     * created (and the context needs to be rebuilt)
+     */
+    bool isStale() const;
+
     /**
      * Get the generation of the Privilege Database this context maps
      * to. If there is a mismatch with this number and the current number
@@ -0,0 +1,103 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/engine_utilities_visibility.h>
+
+#include <cstddef>
+#include <string>
+
+/**
+ * A low frequency sampling profiler for the threads doing work on behalf of
+ * the buckets (the front-end threads and the ep-engine executor threads).
+ *
+ * Threads register themselves for sampling (ScopedThreadRegistration), and
+ * tag what they are currently doing - the bucket, and the opcode or task
+ * (ScopedTag). While the profiler is running, a sampling thread interrupts
+ * every registered thread at the configured frequency and records its call
+ * stack and tags. The aggregated samples can be retrieved in the "folded"
+ * format used by flame graph tools (one line per distinct stack, frames
+ * separated by ';', followed by the number of samples).
+ *
+ * The profiler lives in this (shared) library so the daemon and the engines
+ * use the same thread registry.
+ *
+ * Sampling is only supported on Linux; elsewhere the functions are no-ops.
+ */
+namespace cb {
+namespace profiler {
+
+/// @return true if sampling is supported on this platform
+ENGINE_UTILITIES_PUBLIC_API
+bool isSupported();
+
+/**
+ * Start (or change the frequency of) the sampling thread.
+ *
+ * @param frequency the number of samples per second per thread; 0 stops
+ *                  the profiler.
+ */
+ENGINE_UTILITIES_PUBLIC_API
+void start(size_t frequency);
+
+/// Stop the sampling thread (the recorded samples are kept)
+ENGINE_UTILITIES_PUBLIC_API
+void stop();
+
+/// Discard all of the recorded samples
+ENGINE_UTILITIES_PUBLIC_API
+void clear();
+
+/// @return the recorded samples in folded stack format
+ENGINE_UTILITIES_PUBLIC_API
+std::string toFolded();
+
+/**
+ * Registers the calling thread for sampling for the lifetime of the object.
+ * Must be created (and destroyed) on the thread being registered.
+ */
+class ENGINE_UTILITIES_PUBLIC_API ScopedThreadRegistration {
+public:
+    /// @param name of the thread (the root frame of its stacks)
+    explicit ScopedThreadRegistration(const char* name);
+    ~ScopedThreadRegistration();
+
+    ScopedThreadRegistration(const ScopedThreadRegistration&) = delete;
+    ScopedThreadRegistration& operator=(const ScopedThreadRegistration&) =
+            delete;
+};
+
+/**
+ * Tags the samples of the calling thread with the bucket and the opcode /
+ * task being run, for the lifetime of the object. The strings must remain
+ * valid until the tag is destroyed. Tags may be nested.
+ */
+class ENGINE_UTILITIES_PUBLIC_API ScopedTag {
+public:
+    ScopedTag(const char* bucket, const char* what);
+    ~ScopedTag();
+
+    ScopedTag(const ScopedTag&) = delete;
+    ScopedTag& operator=(const ScopedTag&) = delete;
+
+private:
+    const char* const previousBucket;
+    const char* const previousWhat;
+};
+
+} // namespace profiler
+} // namespace cb
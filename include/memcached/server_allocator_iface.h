@@ -128,6 +128,34 @@ struct ServerAllocatorIface {
      * @return whether the call was successful
      */
     bool (*get_allocator_property)(const char* name, size_t* value);
+
+    /**
+     * Creates an arena for the exclusive use of one bucket, so that its
+     * memory usage can be read from the allocator directly.
+     * @param arena destination for the (non-zero) index of the new arena
+     * @return whether the allocator supports arenas and one was created
+     */
+    bool (*create_arena)(unsigned* arena);
+
+    /**
+     * Returns an arena created by create_arena once its bucket has gone. The
+     * arena's free memory is released to the OS, and the arena may be
+     * handed out again by a later create_arena.
+     */
+    void (*release_arena)(unsigned arena);
+
+    /**
+     * Directs subsequent allocations __by the calling thread__ to the given
+     * arena, or to the default arena if arena is 0.
+     * @return whether the call was successful
+     */
+    bool (*set_thread_arena)(unsigned arena);
+
+    /**
+     * Gets the bytes currently allocated from the given arena.
+     * @return whether the call was successful
+     */
+    bool (*get_arena_allocated)(unsigned arena, size_t* value);
 };
 
 #ifdef __cplusplus
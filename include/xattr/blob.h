@@ -22,7 +22,9 @@
 #include <xattr/utils.h>
 #include <xattr/visibility.h>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace cb {
 namespace xattr {
@@ -30,6 +32,11 @@ namespace xattr {
 /**
  * The cb::xattr::Blob is a class that provides easy access to the
  * binary format of the blob.
+ *
+ * The location of the kv-pairs is indexed the first time a key is looked
+ * up, so subsequent lookups (and modifications which need to locate the
+ * existing value) compare the keys directly instead of walking the encoded
+ * pairs again. A copy of a Blob shares the index of the original.
  */
 class XATTR_PUBLIC_API Blob {
 public:
@@ -272,9 +279,35 @@ protected:
      */
     void remove_segment(const size_t offset, const size_t size);
 
+    /// The location of a kv-pair in the blob
+    struct IndexEntry {
+        /// The offset of the key (following the length word)
+        uint32_t offset;
+        uint32_t keyLength;
+        uint32_t valueLength;
+    };
+
+    /// Get the index of the kv-pairs, building it if needed
+    const std::vector<IndexEntry>& getIndex() const;
+
 private:
+    /// Discard the index (the layout of the kv-pairs changed)
+    void resetIndex() {
+        index.clear();
+        indexed = false;
+    }
+
+    /**
+     * Update the index for the removal of the kv-pair at the given offset
+     * (the kv-pairs following it move down by size bytes)
+     */
+    void removeFromIndex(size_t offset, size_t size);
+
     cb::char_buffer blob;
 
+    mutable std::vector<IndexEntry> index;
+    mutable bool indexed = false;
+
     /// When the incoming data is compressed will auto-decompress into this
     cb::compression::Buffer decompressed;
 
@@ -0,0 +1,344 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "deferred_logger.h"
+
+#include <platform/platform_thread.h>
+#include <utilities/thread_ring_registry.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace cb {
+namespace logger {
+namespace deferred {
+
+LOGGER_PUBLIC_API
+std::atomic<bool> enabled{false};
+
+/// Every record in the ring starts with a header
+struct alignas(16) Header {
+    /// The number of bytes used by the record (including the header)
+    uint32_t size;
+    /// Set if the header represents the unused space at the end of the
+    /// ring (the record didn't fit and was placed at the beginning)
+    bool padding;
+};
+
+/**
+ * A single producer / single consumer ring buffer of variable sized
+ * records. The owning thread constructs the records directly in the
+ * ring, and the logger thread formats and destroys them.
+ */
+class Ring {
+public:
+    /// The size of the ring (per thread)
+    static const size_t capacity = 128 * 1024;
+    /// The largest record we'll try to defer
+    static const size_t max_record_size = capacity / 4;
+
+    Ring() : storage(new Storage[capacity / sizeof(Storage)]) {
+    }
+
+    ~Ring() {
+        // Release the records which was never drained
+        drain([](const Record&) {});
+    }
+
+    /**
+     * Try to reserve room for a record
+     *
+     * @return the memory for the record or nullptr if the ring is full
+     */
+    void* tryAllocate(size_t size) {
+        const auto needed = align(sizeof(Header) + size);
+        auto t = tail.load(std::memory_order_relaxed);
+        const auto used = t - head.load(std::memory_order_acquire);
+        auto pos = t % capacity;
+        const auto contiguous = capacity - pos;
+
+        if (needed > contiguous) {
+            // Skip the end of the ring and place the record at the
+            // beginning
+            if (capacity - used < contiguous + needed) {
+                return nullptr;
+            }
+            new (buffer() + pos) Header{uint32_t(contiguous), true};
+            t += contiguous;
+            tail.store(t, std::memory_order_release);
+            pos = 0;
+        } else if (capacity - used < needed) {
+            return nullptr;
+        }
+
+        new (buffer() + pos) Header{uint32_t(needed), false};
+        pending = t + needed;
+        return buffer() + pos + sizeof(Header);
+    }
+
+    /// Publish the record returned from the last call to tryAllocate
+    void commit() {
+        // seq_cst so that the publication is ordered before the
+        // producer looks if it needs to wake the logger thread
+        tail.store(pending, std::memory_order_seq_cst);
+    }
+
+    /// Pass all records in the ring to the callback (and destroy them)
+    template <typename Callback>
+    void drain(Callback&& callback) {
+        auto h = head.load(std::memory_order_relaxed);
+        const auto t = tail.load(std::memory_order_acquire);
+        while (h != t) {
+            auto* header = reinterpret_cast<Header*>(buffer() + h % capacity);
+            if (!header->padding) {
+                auto* record = reinterpret_cast<Record*>(header + 1);
+                callback(*record);
+                record->~Record();
+            }
+            h += header->size;
+            head.store(h, std::memory_order_release);
+        }
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_seq_cst) ==
+               tail.load(std::memory_order_seq_cst);
+    }
+
+private:
+    using Storage = std::aligned_storage<16, 16>::type;
+
+    static size_t align(size_t size) {
+        return (size + sizeof(Storage) - 1) & ~(sizeof(Storage) - 1);
+    }
+
+    char* buffer() {
+        return reinterpret_cast<char*>(storage.get());
+    }
+
+    std::unique_ptr<Storage[]> storage;
+    /// The tail to publish in commit() (only used by the producer)
+    size_t pending = 0;
+    /// The offset of the next record to consume (written by the consumer)
+    alignas(64) std::atomic<size_t> head{0};
+    /// The offset of the next record to fill (written by the producer)
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+static struct {
+    std::mutex mutex;
+    /// Used to wake the logger thread
+    std::condition_variable cond;
+    /// Used to notify flush() that all messages was written
+    std::condition_variable flushed;
+    /// The rings of the threads (kept across stop() and start())
+    cb::ThreadRingRegistry<Ring> rings;
+    std::shared_ptr<spdlog::logger> logger;
+    cb_thread_t thread = {};
+    std::atomic<bool> running{false};
+    /// Set by the logger thread while waiting for messages
+    std::atomic<bool> sleeping{false};
+    uint64_t flush_requested = 0;
+    uint64_t flush_completed = 0;
+} state;
+
+/// Set for the logger thread (which must log directly)
+static thread_local bool isLoggerThread = false;
+
+/// The calling thread's ring (retired when the thread exits)
+static thread_local cb::ThreadRingRegistry<Ring>::Handle threadRing;
+
+static Ring* getThreadRing() {
+    auto* ring = threadRing.get(state.rings);
+    if (ring == nullptr) {
+        if (!state.running) {
+            return nullptr;
+        }
+        ring = &state.rings.add(threadRing);
+    }
+    return ring;
+}
+
+static void wakeLoggerThread() {
+    if (state.sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> guard(state.mutex);
+        state.cond.notify_one();
+    }
+}
+
+/// Check if any of the rings contains records
+static bool hasQueuedRecords() {
+    bool queued = false;
+    state.rings.forEach(
+            [&queued](const Ring& ring) { queued = queued || !ring.empty(); });
+    return queued;
+}
+
+static void sinkRecord(spdlog::logger& logger, const Record& record) {
+    spdlog::details::log_msg msg(&logger.name(), record.level);
+    msg.time = record.time;
+    msg.thread_id = record.thread_id;
+    try {
+        record.format(msg.raw);
+    } catch (const std::exception& e) {
+        msg.raw.clear();
+        fmt::format_to(msg.raw, "[*** LOG ERROR ***] {}", e.what());
+    }
+
+    for (auto& sink : logger.sinks()) {
+        if (sink->should_log(msg.level)) {
+            try {
+                sink->log(msg);
+            } catch (const std::exception&) {
+                // Nowhere to report the error, just continue with the next
+            }
+        }
+    }
+}
+
+static void run() {
+    isLoggerThread = true;
+    bool stop = false;
+    while (!stop) {
+        uint64_t flushTarget;
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            if (state.running &&
+                state.flush_requested == state.flush_completed &&
+                !hasQueuedRecords()) {
+                // Announce that we're going to sleep, and check again for
+                // records published before the producers could see it
+                state.sleeping.store(true, std::memory_order_seq_cst);
+                if (!hasQueuedRecords()) {
+                    state.cond.wait_for(lock, std::chrono::seconds(1));
+                }
+                state.sleeping.store(false, std::memory_order_seq_cst);
+            }
+            flushTarget = state.flush_requested;
+            stop = !state.running;
+        }
+
+        for (const auto& entry : state.rings.getRings()) {
+            entry->ring.drain([](const Record& record) {
+                sinkRecord(*state.logger, record);
+            });
+        }
+        // Free the rings of the threads which have exited
+        state.rings.reap();
+
+        std::lock_guard<std::mutex> guard(state.mutex);
+        if (state.flush_completed != flushTarget) {
+            state.flush_completed = flushTarget;
+            state.flushed.notify_all();
+        }
+    }
+}
+
+void* allocate(size_t size, Ring*& ring) {
+    if (size > Ring::max_record_size || isLoggerThread) {
+        return nullptr;
+    }
+
+    ring = getThreadRing();
+    if (ring == nullptr) {
+        return nullptr;
+    }
+
+    // Block the caller until the logger thread catch up (the same policy
+    // as we use for the async logger)
+    void* ret;
+    while ((ret = ring->tryAllocate(size)) == nullptr) {
+        if (!state.running) {
+            return nullptr;
+        }
+        wakeLoggerThread();
+        std::this_thread::yield();
+    }
+    return ret;
+}
+
+void commit(Ring& ring) {
+    ring.commit();
+    wakeLoggerThread();
+}
+
+void start(std::shared_ptr<spdlog::logger> logger) {
+    stop();
+
+    {
+        std::lock_guard<std::mutex> guard(state.mutex);
+        state.logger = std::move(logger);
+        state.running = true;
+    }
+
+    if (cb_create_named_thread(
+                &state.thread,
+                [](void*) { run(); },
+                nullptr,
+                0,
+                "mc:log fmt") != 0) {
+        std::lock_guard<std::mutex> guard(state.mutex);
+        state.running = false;
+        state.logger.reset();
+        throw std::runtime_error(
+                "cb::logger::deferred::start(): Failed to create thread");
+    }
+    enabled = true;
+}
+
+void stop() {
+    enabled = false;
+    {
+        std::lock_guard<std::mutex> guard(state.mutex);
+        if (!state.running) {
+            return;
+        }
+        state.running = false;
+        state.cond.notify_one();
+    }
+
+    cb_join_thread(state.thread);
+
+    std::lock_guard<std::mutex> guard(state.mutex);
+    state.logger.reset();
+    // Release anyone waiting for a flush
+    state.flush_completed = state.flush_requested;
+    state.flushed.notify_all();
+}
+
+void flush() {
+    if (isLoggerThread) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+    if (!state.running) {
+        return;
+    }
+    const auto target = ++state.flush_requested;
+    state.cond.notify_one();
+    state.flushed.wait_for(lock, std::chrono::seconds(5), [target]() {
+        return state.flush_completed >= target;
+    });
+}
+
+} // namespace deferred
+} // namespace logger
+} // namespace cb
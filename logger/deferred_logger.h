@@ -0,0 +1,280 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Deferred formatting of log messages.
+ *
+ * When enabled (see Config::deferred_formatting) the LOG_ macros don't
+ * format the message on the calling thread. Instead the format string and
+ * a copy of the arguments are stored in a ring buffer owned by the calling
+ * thread, and a dedicated logger thread formats the message and passes it
+ * on to the sinks (with the timestamp and thread id of the original
+ * call). A thread's ring is freed by the logger thread once it is drained
+ * after the thread exited. Only arguments which may be safely copied (arithmetic types,
+ * enums and strings) are deferred; if any of the arguments is of a
+ * different type the message is formatted on the calling thread (but
+ * still passed to the logger thread to preserve the order of the messages
+ * from each thread).
+ */
+
+#pragma once
+
+#include <logger/visibility.h>
+#include <spdlog/details/log_msg.h>
+#include <spdlog/details/os.h>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/logger.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace cb {
+namespace logger {
+namespace deferred {
+
+/// Set when the LOG_ macros should use deferred formatting
+LOGGER_PUBLIC_API
+extern std::atomic<bool> enabled;
+
+/**
+ * The base class for the records stored in the ring buffers. The
+ * format string is stored in the ring buffer right after the (derived)
+ * object.
+ */
+class Record {
+public:
+    Record(spdlog::level::level_enum level, fmt::string_view format_string)
+        : level(level),
+          time(spdlog::details::os::now()),
+          thread_id(spdlog::details::os::thread_id()),
+          format_string(format_string) {
+    }
+
+    virtual ~Record() = default;
+
+    /// Format the message into the provided buffer
+    virtual void format(fmt::memory_buffer& buffer) const = 0;
+
+    const spdlog::level::level_enum level;
+    const spdlog::log_clock::time_point time;
+    const size_t thread_id;
+
+protected:
+    const fmt::string_view format_string;
+};
+
+/// The ring buffer owned by a thread
+class Ring;
+
+/**
+ * Reserve room for a record of the given size in the calling thread's
+ * ring buffer (blocks while the ring is full).
+ *
+ * @param size the size of the record
+ * @param ring set to the ring the memory belongs to (to be passed to
+ *             commit())
+ * @return the memory to construct the record in, or nullptr if the
+ *         record can't be deferred (too big or the logger thread isn't
+ *         running)
+ */
+LOGGER_PUBLIC_API
+void* allocate(size_t size, Ring*& ring);
+
+/// Publish the record constructed in the memory returned from allocate()
+LOGGER_PUBLIC_API
+void commit(Ring& ring);
+
+/**
+ * Start the logger thread formatting the deferred messages and passing
+ * them on to the sinks of the provided logger (used by
+ * cb::logger::initialize()).
+ */
+void start(std::shared_ptr<spdlog::logger> logger);
+
+/**
+ * Stop the logger thread (all messages queued before the call is
+ * written to the sinks). The rings are kept, and a message committed
+ * while stopping is written after the next start().
+ */
+void stop();
+
+/// Wait for the logger thread to pass all messages queued before the
+/// call on to the sinks
+void flush();
+
+/// Map the argument types to the type we store in the record (void if the
+/// type can't be safely copied)
+template <typename T, typename = void>
+struct Capture {
+    using type = void;
+};
+
+template <typename T>
+struct Capture<T,
+               typename std::enable_if<std::is_arithmetic<T>::value ||
+                                       std::is_enum<T>::value>::type> {
+    using type = T;
+};
+
+template <>
+struct Capture<std::string> {
+    using type = std::string;
+};
+
+template <>
+struct Capture<const char*> {
+    using type = std::string;
+};
+
+template <>
+struct Capture<char*> {
+    using type = std::string;
+};
+
+template <size_t N>
+struct Capture<char[N]> {
+    using type = std::string;
+};
+
+template <typename T>
+using capture_t = typename Capture<typename std::remove_cv<T>::type>::type;
+
+template <typename... Args>
+struct Deferrable;
+
+template <>
+struct Deferrable<> : std::true_type {};
+
+template <typename T, typename... Args>
+struct Deferrable<T, Args...>
+    : std::integral_constant<bool,
+                             !std::is_void<capture_t<T>>::value &&
+                                     Deferrable<Args...>::value> {};
+
+template <typename... Args>
+class RecordImpl : public Record {
+public:
+    template <typename... Params>
+    RecordImpl(spdlog::level::level_enum level,
+               fmt::string_view fmtstr,
+               const Params&... params)
+        : Record(level,
+                 {reinterpret_cast<const char*>(this + 1), fmtstr.size()}),
+          args(params...) {
+        std::memcpy(this + 1, fmtstr.data(), fmtstr.size());
+    }
+
+    void format(fmt::memory_buffer& buffer) const override {
+        formatArgs(buffer, std::index_sequence_for<Args...>{});
+    }
+
+private:
+    template <size_t... I>
+    void formatArgs(fmt::memory_buffer& buffer,
+                    std::index_sequence<I...>) const {
+        fmt::format_to(buffer, format_string, std::get<I>(args)...);
+    }
+
+    const std::tuple<Args...> args;
+};
+
+/**
+ * Try to place the record in the calling thread's ring buffer
+ *
+ * @return true if the record was queued
+ */
+template <typename... Captures, typename... Args>
+bool enqueue(spdlog::level::level_enum level,
+             fmt::string_view fmt,
+             const Args&... args) {
+    using RecordType = RecordImpl<Captures...>;
+    Ring* ring = nullptr;
+    auto* memory = allocate(sizeof(RecordType) + fmt.size(), ring);
+    if (memory == nullptr) {
+        return false;
+    }
+    new (memory) RecordType(level, fmt, args...);
+    commit(*ring);
+    return true;
+}
+
+/// Log a message where all of the arguments may be copied
+template <typename... Args>
+typename std::enable_if<Deferrable<Args...>::value>::type log(
+        spdlog::logger& logger,
+        spdlog::level::level_enum level,
+        fmt::string_view fmt,
+        const Args&... args) {
+    if (!enqueue<capture_t<Args>...>(level, fmt, args...)) {
+        logger.log(level, fmt.data(), args...);
+    }
+}
+
+/// Log a message where at least one of the arguments needs to be
+/// formatted on the calling thread
+template <typename... Args>
+typename std::enable_if<!Deferrable<Args...>::value>::type log(
+        spdlog::logger& logger,
+        spdlog::level::level_enum level,
+        fmt::string_view fmt,
+        const Args&... args) {
+    const auto message = fmt::format(fmt, args...);
+    if (!enqueue<std::string>(level, "{}", message)) {
+        logger.log(level, message);
+    }
+}
+
+} // namespace deferred
+
+/**
+ * Log the message to the provided logger (used by the LOG_ macros after
+ * they've checked the log level). The messages are passed on to the
+ * logger thread when deferred formatting is enabled.
+ */
+template <typename Arg1, typename... Args>
+void log(spdlog::logger& logger,
+         spdlog::level::level_enum level,
+         fmt::string_view fmt,
+         const Arg1& arg1,
+         const Args&... args) {
+    if (deferred::enabled.load(std::memory_order_relaxed)) {
+        deferred::log(logger, level, fmt, arg1, args...);
+    } else {
+        logger.log(level, fmt.data(), arg1, args...);
+    }
+}
+
+/// Log a message without any arguments (the message isn't formatted)
+template <typename T>
+void log(spdlog::logger& logger,
+         spdlog::level::level_enum level,
+         const T& msg) {
+    if (deferred::enabled.load(std::memory_order_relaxed)) {
+        deferred::log(logger, level, "{}", msg);
+    } else {
+        logger.log(level, msg);
+    }
+}
+
+} // namespace logger
+} // namespace cb
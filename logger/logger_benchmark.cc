@@ -60,6 +60,32 @@ void LoggerBench::SetUp(const benchmark::State& state) {
     }
 }
 
+/**
+ * A fixture for benchmarking the logger with formatting deferred to the
+ * logger thread.
+ */
+class LoggerBench_Deferred : public LoggerBench {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            cb::logger::Config config{};
+            config.cyclesize = 2048;
+            config.buffersize = 8192;
+            config.unit_test = true;
+            config.console = false;
+            config.deferred_formatting = true;
+
+            auto init = cb::logger::initialize(config);
+            if (init) {
+                std::cerr << "Failed to initialize logger: " << *init;
+                return;
+            }
+
+            cb::logger::get()->set_level(spdlog::level::level_enum::trace);
+        }
+    }
+};
+
 class LoggerBench_Blackhole : public LoggerBench {
 protected:
     void SetUp(const benchmark::State& state) override {
@@ -99,6 +125,40 @@ BENCHMARK_DEFINE_F(LoggerBench, LogToLoggerWithEnabledLogLevel)
     }
 }
 
+/**
+ * Benchmark the cost (on the calling thread) of logging a message with
+ * a few arguments which needs formatting.
+ */
+BENCHMARK_DEFINE_F(LoggerBench, LogWithArguments)(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        cb::logger::get()->set_level(spdlog::level::level_enum::trace);
+    }
+    const std::string name{"eq_dcpq:replication:ns_1@127.0.0.1->ns_1"};
+    while (state.KeepRunning()) {
+        LOG_TRACE("{}: Stream created for {} seqno:{} flags:{:x}",
+                  name,
+                  1023,
+                  uint64_t(123456789),
+                  0xdeadbeef);
+    }
+}
+
+/**
+ * Benchmark the cost (on the calling thread) of the same message as
+ * LogWithArguments when the formatting is deferred to the logger thread.
+ */
+BENCHMARK_DEFINE_F(LoggerBench_Deferred, LogWithArguments)
+(benchmark::State& state) {
+    const std::string name{"eq_dcpq:replication:ns_1@127.0.0.1->ns_1"};
+    while (state.KeepRunning()) {
+        LOG_TRACE("{}: Stream created for {} seqno:{} flags:{:x}",
+                  name,
+                  1023,
+                  uint64_t(123456789),
+                  0xdeadbeef);
+    }
+}
+
 /**
  * Benchmark the cost of grabbing the logger (which means checking
  * for it's existence and copy a shared pointer).
@@ -117,6 +177,10 @@ BENCHMARK_REGISTER_F(LoggerBench, LogToLoggerWithDisabledLogLevel)
 BENCHMARK_REGISTER_F(LoggerBench, LogToLoggerWithEnabledLogLevel)
         ->Threads(1)
         ->Threads(16);
+BENCHMARK_REGISTER_F(LoggerBench, LogWithArguments)->Threads(1)->Threads(16);
+BENCHMARK_REGISTER_F(LoggerBench_Deferred, LogWithArguments)
+        ->Threads(1)
+        ->Threads(16);
 
 int main(int argc, char** argv) {
     ::benchmark::Initialize(&argc, argv);
@@ -28,6 +28,8 @@ Config::Config(const nlohmann::json& json) {
     cyclesize = json.value("cyclesize", cyclesize);
     unit_test = json.value("unit_test", unit_test);
     console = json.value("console", console);
+    deferred_formatting =
+            json.value("deferred_formatting", deferred_formatting);
 }
 
 bool Config::operator==(const Config& other) const {
@@ -35,7 +37,8 @@ bool Config::operator==(const Config& other) const {
            (this->buffersize == other.buffersize) &&
            (this->cyclesize == other.cyclesize) &&
            (this->unit_test == other.unit_test) &&
-           (this->console == other.console);
+           (this->console == other.console) &&
+           (this->deferred_formatting == other.deferred_formatting);
 }
 
 bool Config::operator!=(const Config& other) const {
@@ -46,6 +46,9 @@ struct LOGGER_PUBLIC_API Config {
     bool console = true;
     /// The default log level to initialize the logger to
     spdlog::level::level_enum log_level = spdlog::level::level_enum::info;
+    /// Should the LOG_ macros defer the formatting of the messages to
+    /// a dedicated logger thread
+    bool deferred_formatting = false;
 };
 
 } // namespace logger
@@ -22,6 +22,8 @@
 
 #include <valgrind/valgrind.h>
 
+#include <thread>
+
 #ifndef WIN32
 #include <sys/resource.h>
 #endif
@@ -247,3 +249,81 @@ TEST_F(SpdloggerTest, ShutdownRace) {
     EXPECT_EQ(1, countInFile(files.front(), "CRITICAL and this one"));
     EXPECT_EQ(1, countInFile(files.front(), "CRITICAL " + str));
 }
+
+/**
+ * Test class which runs with deferred formatting of the log messages
+ */
+class DeferredFormattingTest : public SpdloggerTest {
+protected:
+    void SetUp() override {
+        config.deferred_formatting = true;
+        setUpLogger();
+    }
+};
+
+TEST_F(DeferredFormattingTest, FmtStyleFormatting) {
+    const uint32_t value = 0xdeadbeef;
+    const std::string str{"string"};
+    LOG_INFO("FmtStyleFormatting {:x} {} {}", value, str, "literal");
+    LOG_INFO("Raw message with {braces}");
+    cb::logger::shutdown();
+    files = cb::io::findFilesWithPrefix(config.filename);
+    ASSERT_EQ(1, files.size()) << "We should only have a single logfile";
+    EXPECT_EQ(1,
+              countInFile(files.front(),
+                          "INFO FmtStyleFormatting deadbeef string literal"));
+    EXPECT_EQ(1, countInFile(files.front(), "INFO Raw message with {braces}"));
+}
+
+/// A type which can't be deferred (and must be formatted by the caller)
+struct NotDeferred {
+    int value;
+};
+
+std::ostream& operator<<(std::ostream& os, const NotDeferred& nd) {
+    return os << nd.value;
+}
+
+/**
+ * Messages which is formatted on the calling thread should still be
+ * logged in order with the deferred ones.
+ */
+TEST_F(DeferredFormattingTest, OrderIsPreserved) {
+    for (int ii = 0; ii < 100; ++ii) {
+        if (ii % 2) {
+            LOG_INFO("Ordered message {}.", ii);
+        } else {
+            LOG_INFO("Ordered message {}.", NotDeferred{ii});
+        }
+    }
+    cb::logger::shutdown();
+
+    const auto content = getLogContents();
+    size_t offset = 0;
+    for (int ii = 0; ii < 100; ++ii) {
+        const auto next = content.find(
+                "INFO Ordered message " + std::to_string(ii) + ".", offset);
+        ASSERT_NE(std::string::npos, next) << "Missing (or reordered) " << ii;
+        offset = next;
+    }
+}
+
+/**
+ * The ring of a thread is freed by the logger thread after the thread
+ * exits, but not before the messages in it are written.
+ */
+TEST_F(DeferredFormattingTest, MessagesFromExitedThreads) {
+    for (int ii = 0; ii < 10; ++ii) {
+        std::thread thread([ii]() { LOG_INFO("Thread message {}.", ii); });
+        thread.join();
+    }
+    cb::logger::shutdown();
+
+    const auto content = getLogContents();
+    for (int ii = 0; ii < 10; ++ii) {
+        EXPECT_NE(std::string::npos,
+                  content.find("INFO Thread message " + std::to_string(ii) +
+                               "."))
+                << "Missing message from thread " << ii;
+    }
+}
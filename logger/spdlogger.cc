@@ -16,6 +16,7 @@
  */
 #include "custom_rotating_file_sink.h"
 
+#include "deferred_logger.h"
 #include "logger.h"
 #include "logger_config.h"
 
@@ -52,6 +53,9 @@ static std::shared_ptr<spdlog::logger> file_logger;
 
 LOGGER_PUBLIC_API
 void cb::logger::flush() {
+    // Make sure that the deferred messages is passed on to the sinks
+    // before flushing them
+    deferred::flush();
     if (file_logger) {
         file_logger->flush();
     }
@@ -62,6 +66,7 @@ void cb::logger::shutdown() {
     // Force a flush (posts a message to the async logger if we are not in unit
     // test mode)
     flush();
+    deferred::stop();
 
     /**
      * This will drop all spdlog instances from the registry, and destruct the
@@ -149,6 +154,7 @@ boost::optional<std::string> cb::logger::initialize(
             sink->add_sink(stderrsink);
         }
 
+        deferred::stop();
         spdlog::drop(logger_name);
 
         if (logger_settings.unit_test) {
@@ -174,10 +180,20 @@ boost::optional<std::string> cb::logger::initialize(
         spdlog::flush_every(std::chrono::seconds(1));
 
         spdlog::register_logger(file_logger);
+
+        if (logger_settings.deferred_formatting) {
+            deferred::start(file_logger);
+        } else {
+            deferred::stop();
+        }
     } catch (const spdlog::spdlog_ex& ex) {
         std::string msg =
                 std::string{"Log initialization failed: "} + ex.what();
         return boost::optional<std::string>{msg};
+    } catch (const std::runtime_error& ex) {
+        std::string msg =
+                std::string{"Log initialization failed: "} + ex.what();
+        return boost::optional<std::string>{msg};
     }
     return {};
 }
@@ -188,12 +204,14 @@ spdlog::logger* cb::logger::get() {
 
 LOGGER_PUBLIC_API
 void cb::logger::reset() {
+    deferred::stop();
     spdlog::drop(logger_name);
     file_logger.reset();
 }
 
 void cb::logger::createBlackholeLogger() {
     // delete if already exists
+    deferred::stop();
     spdlog::drop(logger_name);
 
     file_logger = std::make_shared<spdlog::logger>(
@@ -207,6 +225,7 @@ void cb::logger::createBlackholeLogger() {
 
 void cb::logger::createConsoleLogger() {
     // delete if already exists
+    deferred::stop();
     spdlog::drop(logger_name);
 
     auto stderrsink =
@@ -413,6 +413,10 @@ SERVER_HANDLE_V1* get_mock_server_api() {
         hooks_api.release_free_memory = AllocHooks::release_free_memory;
         hooks_api.enable_thread_cache = AllocHooks::enable_thread_cache;
         hooks_api.get_allocator_property = AllocHooks::get_allocator_property;
+        hooks_api.create_arena = AllocHooks::create_arena;
+        hooks_api.release_arena = AllocHooks::release_arena;
+        hooks_api.set_thread_arena = AllocHooks::set_thread_arena;
+        hooks_api.get_arena_allocated = AllocHooks::get_arena_allocated;
 
         rv.core = &core_api;
         rv.callback = &callback_api;
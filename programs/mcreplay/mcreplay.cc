@@ -0,0 +1,447 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * mcreplay replays a capture of the requests received by memcached
+ * (see docs/TrafficCapture.md) against a node, preserving the
+ * inter-arrival timing of the requests on each of the captured connections
+ * (optionally scaled with --speed), and reports the latency distribution
+ * of the replayed requests.
+ *
+ * Each captured connection is replayed on its own connection (and thread),
+ * authenticated with the credentials given on the command line. Requests on
+ * a connection are sent in the captured order; a non-quiet request waits for
+ * its response before the next request is sent.
+ */
+#include "programs/getpass.h"
+#include "programs/hostname_utils.h"
+
+#include <getopt.h>
+#include <memcached/protocol_binary.h>
+#include <nlohmann/json.hpp>
+#include <protocol/connection/client_connection.h>
+#include <utilities/hdrhistogram.h>
+#include <utilities/terminate_handler.h>
+#include <utilities/traffic_capture.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// How far behind its schedule a request may be sent before it's counted
+/// as late (i.e. the replay couldn't keep up with the captured rate)
+static const std::chrono::milliseconds LateThreshold{1};
+
+struct Options {
+    std::string host;
+    in_port_t port = 0;
+    sa_family_t family = AF_UNSPEC;
+    bool secure = false;
+    std::string user;
+    std::string password;
+    std::string bucket;
+    /// Multiplier of the captured rate; 0 replays as fast as possible
+    double speed = 1.0;
+};
+
+/// The outcome of replaying one or more connections
+struct Result {
+    void merge(const Result& other) {
+        latency += other.latency;
+        for (const auto& entry : other.opcodeLatency) {
+            opcodeLatency[entry.first] += entry.second;
+        }
+        for (const auto& entry : other.status) {
+            status[entry.first] += entry.second;
+        }
+        sent += other.sent;
+        late += other.late;
+        failedConnections += other.failedConnections;
+    }
+
+    Hdr2sfMicroSecHistogram latency;
+    std::map<cb::mcbp::ClientOpcode, Hdr2sfMicroSecHistogram> opcodeLatency;
+    std::map<cb::mcbp::Status, uint64_t> status;
+    uint64_t sent = 0;
+    uint64_t late = 0;
+    uint64_t failedConnections = 0;
+};
+
+/**
+ * Replay the requests of a single captured connection.
+ *
+ * @param options where (and how) to connect
+ * @param records the requests of the connection, in captured order
+ * @param start the time the replay was started (the timestamps of the
+ *              records are relative to it)
+ * @param result where to record the outcome
+ */
+static void replayConnection(const Options& options,
+                             const std::vector<cb::capture::Record>& records,
+                             std::chrono::steady_clock::time_point start,
+                             Result& result) {
+    MemcachedConnection connection(
+            options.host, options.port, options.family, options.secure);
+    connection.connect();
+    if (!options.user.empty()) {
+        connection.authenticate(options.user,
+                                options.password,
+                                connection.getSaslMechanisms());
+    }
+    if (!options.bucket.empty()) {
+        connection.selectBucket(options.bucket);
+    }
+
+    uint32_t opaque = 0;
+    Frame request;
+    Frame response;
+    for (const auto& record : records) {
+        if (record.frame.size() < sizeof(cb::mcbp::Request)) {
+            continue;
+        }
+        request.payload = record.frame;
+        auto& req = *reinterpret_cast<cb::mcbp::Request*>(
+                request.payload.data());
+        const auto opcode = req.getClientOpcode();
+        if (opcode == cb::mcbp::ClientOpcode::SelectBucket &&
+            !options.bucket.empty()) {
+            // Stay in the bucket selected on the command line
+            continue;
+        }
+
+        if (options.speed > 0) {
+            const auto due =
+                    start + std::chrono::duration_cast<
+                                    std::chrono::steady_clock::duration>(
+                                    record.timestamp / options.speed);
+            std::this_thread::sleep_until(due);
+            if (std::chrono::steady_clock::now() - due > LateThreshold) {
+                ++result.late;
+            }
+        }
+
+        // Use our own opaque so the response can be matched up
+        req.setOpaque(++opaque);
+        const auto quiet = req.isQuiet();
+        const auto sent = std::chrono::steady_clock::now();
+        connection.sendFrame(request);
+        ++result.sent;
+        if (quiet) {
+            // Only failures are returned; they're picked up (by status)
+            // while waiting for the response to a later request
+            continue;
+        }
+
+        do {
+            connection.recvFrame(response);
+            if (response.getMagic() == cb::mcbp::Magic::ServerRequest) {
+                // e.g. clustermap change notifications when the captured
+                // client enabled duplex mode
+                continue;
+            }
+            ++result.status[response.getResponse()->getStatus()];
+        } while (response.getMagic() == cb::mcbp::Magic::ServerRequest ||
+                 response.getResponse()->getOpaque() != opaque);
+
+        const auto latency =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - sent);
+        result.latency.add(latency);
+        result.opcodeLatency[opcode].add(latency);
+    }
+}
+
+static nlohmann::json toJson(const HdrHistogram& histogram) {
+    return {{"count", histogram.getValueCount()},
+            {"mean", histogram.getMean()},
+            {"p50", histogram.getValueAtPercentile(50)},
+            {"p90", histogram.getValueAtPercentile(90)},
+            {"p99", histogram.getValueAtPercentile(99)},
+            {"p99.9", histogram.getValueAtPercentile(99.9)},
+            {"max", histogram.getMaxValue()}};
+}
+
+static void printRow(const std::string& name, const HdrHistogram& histogram) {
+    std::cout << std::left << std::setw(24) << name << std::right
+              << std::setw(10) << histogram.getValueCount() << std::setw(10)
+              << uint64_t(histogram.getMean()) << std::setw(10)
+              << histogram.getValueAtPercentile(50) << std::setw(10)
+              << histogram.getValueAtPercentile(90) << std::setw(10)
+              << histogram.getValueAtPercentile(99) << std::setw(10)
+              << histogram.getValueAtPercentile(99.9) << std::setw(10)
+              << histogram.getMaxValue() << std::endl;
+}
+
+static void report(const Result& result,
+                   size_t connections,
+                   std::chrono::steady_clock::duration duration,
+                   bool json) {
+    const auto seconds =
+            std::chrono::duration_cast<std::chrono::duration<double>>(duration)
+                    .count();
+    if (json) {
+        nlohmann::json ret;
+        ret["connections"] = connections;
+        ret["failed_connections"] = result.failedConnections;
+        ret["sent"] = result.sent;
+        ret["late"] = result.late;
+        ret["duration_s"] = seconds;
+        ret["latency_us"] = toJson(result.latency);
+        for (const auto& entry : result.opcodeLatency) {
+            ret["opcodes"][to_string(entry.first)] = toJson(entry.second);
+        }
+        for (const auto& entry : result.status) {
+            ret["status"][to_string(entry.first)] = entry.second;
+        }
+        std::cout << ret.dump(4) << std::endl;
+        return;
+    }
+
+    std::cout << "Replayed " << result.sent << " requests on " << connections
+              << " connections in " << seconds << " s";
+    if (result.failedConnections) {
+        std::cout << " (" << result.failedConnections
+                  << " connections failed)";
+    }
+    std::cout << std::endl;
+    if (result.late) {
+        std::cout << result.late
+                  << " requests were sent late (the replay couldn't keep up "
+                     "with the captured rate)"
+                  << std::endl;
+    }
+    std::cout << std::endl
+              << "Latency (us)" << std::endl
+              << std::left << std::setw(24) << "opcode" << std::right
+              << std::setw(10) << "count" << std::setw(10) << "mean"
+              << std::setw(10) << "p50" << std::setw(10) << "p90"
+              << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+              << std::setw(10) << "max" << std::endl;
+    for (const auto& entry : result.opcodeLatency) {
+        printRow(to_string(entry.first), entry.second);
+    }
+    printRow("total", result.latency);
+
+    std::cout << std::endl << "Status" << std::endl;
+    for (const auto& entry : result.status) {
+        std::cout << std::left << std::setw(24) << to_string(entry.first)
+                  << std::right << std::setw(10) << entry.second << std::endl;
+    }
+}
+
+void usage() {
+    std::cerr << "Usage mcreplay [options] capturefile\n"
+              << R"(Options:
+
+  -h or --host hostname[:port]   The host (with an optional port) to connect to
+  -p or --port port              The port number to connect to
+  -b or --bucket bucketname      The name of the bucket to replay against
+                                 (the captured SelectBucket requests are
+                                 ignored)
+  -u or --user username          The name of the user to authenticate as
+  -P or --password password      The passord to use for authentication
+                                 (use '-' to read from standard input)
+  -s or --ssl                    Connect to the server over SSL
+  -4 or --ipv4                   Connect over IPv4
+  -6 or --ipv6                   Connect over IPv6
+  -S                             Read password from standard input
+  -x or --speed factor           Replay at factor times the captured rate
+                                 (default 1, 0 replays as fast as possible)
+  -j or --json                   Print the result as JSON
+  --help                         This help text
+
+)" << std::endl
+              << "Example:" << std::endl
+              << "    mcreplay --user operator --password - --bucket default "
+                 "--speed 2 /tmp/capture.bin"
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    // Make sure that we dump callstacks on the console
+    install_backtrace_terminate_handler();
+
+    int cmd;
+    std::string port{"11210"};
+    std::string host{"localhost"};
+    Options options;
+    bool json = false;
+
+    /* Initialize the socket subsystem */
+    cb_initialize_sockets();
+
+    struct option long_options[] = {
+            {"ipv4", no_argument, nullptr, '4'},
+            {"ipv6", no_argument, nullptr, '6'},
+            {"host", required_argument, nullptr, 'h'},
+            {"port", required_argument, nullptr, 'p'},
+            {"bucket", required_argument, nullptr, 'b'},
+            {"password", required_argument, nullptr, 'P'},
+            {"user", required_argument, nullptr, 'u'},
+            {"ssl", no_argument, nullptr, 's'},
+            {"speed", required_argument, nullptr, 'x'},
+            {"json", no_argument, nullptr, 'j'},
+            {"help", no_argument, nullptr, 0},
+            {nullptr, 0, nullptr, 0}};
+
+    while ((cmd = getopt_long(argc,
+                              argv,
+                              "46h:p:u:b:P:sSx:j",
+                              long_options,
+                              nullptr)) != EOF) {
+        switch (cmd) {
+        case '6':
+            options.family = AF_INET6;
+            break;
+        case '4':
+            options.family = AF_INET;
+            break;
+        case 'h':
+            host.assign(optarg);
+            break;
+        case 'p':
+            port.assign(optarg);
+            break;
+        case 'S':
+            options.password.assign("-");
+            break;
+        case 'b':
+            options.bucket.assign(optarg);
+            break;
+        case 'u':
+            options.user.assign(optarg);
+            break;
+        case 'P':
+            options.password.assign(optarg);
+            break;
+        case 's':
+            options.secure = true;
+            break;
+        case 'x':
+            try {
+                options.speed = std::stod(optarg);
+            } catch (const std::exception&) {
+                options.speed = -1;
+            }
+            if (options.speed < 0) {
+                std::cerr << "Invalid speed: " << optarg << std::endl;
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'j':
+            json = true;
+            break;
+        default:
+            usage();
+            return cmd == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (optind + 1 != argc) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (options.password == "-") {
+        options.password.assign(getpass());
+    } else if (options.password.empty()) {
+        const char* env_password = std::getenv("CB_PASSWORD");
+        if (env_password) {
+            options.password = env_password;
+        }
+    }
+
+    try {
+        sa_family_t fam;
+        std::tie(options.host, options.port, fam) =
+                cb::inet::parse_hostname(host, port);
+        if (options.family == AF_UNSPEC) { // The user may have used -4 or -6
+            options.family = fam;
+        }
+
+        // Group the requests by the connection they were received on
+        std::map<uint32_t, std::vector<cb::capture::Record>> streams;
+        {
+            cb::capture::Reader reader(argv[optind]);
+            cb::capture::Record record;
+            while (reader.next(record)) {
+                streams[record.connection].push_back(std::move(record));
+            }
+        }
+        if (streams.empty()) {
+            std::cerr << argv[optind] << " contains no requests" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // Offset the timestamps so the earliest request is sent immediately
+        auto first = streams.begin()->second.front().timestamp;
+        for (const auto& stream : streams) {
+            first = std::min(first, stream.second.front().timestamp);
+        }
+        for (auto& stream : streams) {
+            for (auto& record : stream.second) {
+                record.timestamp -= first;
+            }
+        }
+
+        std::mutex mutex;
+        Result total;
+        std::vector<std::thread> threads;
+        threads.reserve(streams.size());
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& stream : streams) {
+            const auto& records = stream.second;
+            const auto id = stream.first;
+            threads.emplace_back(
+                    [&options, &records, start, id, &mutex, &total]() {
+                        Result result;
+                        try {
+                            replayConnection(options, records, start, result);
+                        } catch (const std::exception& e) {
+                            std::cerr << "Replay of connection " << id
+                                      << " failed: " << e.what() << std::endl;
+                            ++result.failedConnections;
+                        }
+                        std::lock_guard<std::mutex> guard(mutex);
+                        total.merge(result);
+                    });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        report(total,
+               streams.size(),
+               std::chrono::steady_clock::now() - start,
+               json);
+    } catch (const ConnectionError& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    } catch (const std::runtime_error& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
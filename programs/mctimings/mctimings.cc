@@ -17,13 +17,17 @@
 #include "programs/hostname_utils.h"
 #include "programs/getpass.h"
 
+#include <boost/optional/optional.hpp>
 #include <getopt.h>
 #include <memcached/protocol_binary.h>
 #include <nlohmann/json.hpp>
+#include <platform/base64.h>
 #include <platform/string_hex.h>
 #include <protocol/connection/client_connection.h>
 #include <protocol/connection/client_mcbp_commands.h>
+#include <utilities/hdrhistogram.h>
 #include <utilities/json_utilities.h>
+#include <utilities/string_utilities.h>
 #include <utilities/terminate_handler.h>
 
 #include <inttypes.h>
@@ -31,8 +35,12 @@
 #include <array>
 #include <cstdlib>
 #include <gsl/gsl>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 #define JSON_DUMP_INDENT_SIZE 4
 
@@ -182,12 +190,13 @@ std::string opcode2string(cb::mcbp::ClientOpcode opcode) {
     }
 }
 
-static void request_cmd_timings(MemcachedConnection& connection,
-                                const std::string& bucket,
-                                cb::mcbp::ClientOpcode opcode,
-                                bool verbose,
-                                bool skip,
-                                bool json) {
+/**
+ * Fetch the timings for the opcode (the program is terminated if the server
+ * fails the request)
+ */
+static nlohmann::json fetch_cmd_timings(MemcachedConnection& connection,
+                                        const std::string& bucket,
+                                        cb::mcbp::ClientOpcode opcode) {
     BinprotGetCmdTimerCommand cmd;
     cmd.setBucket(bucket);
     cmd.setOpcode(opcode);
@@ -221,10 +230,21 @@ static void request_cmd_timings(MemcachedConnection& connection,
         exit(EXIT_FAILURE);
     }
 
+    return resp.getTimings();
+}
+
+static void request_cmd_timings(MemcachedConnection& connection,
+                                const std::string& bucket,
+                                cb::mcbp::ClientOpcode opcode,
+                                bool verbose,
+                                bool skip,
+                                bool json) {
+    auto response = fetch_cmd_timings(connection, bucket, opcode);
+
     try {
         auto command = opcode2string(opcode);
         if (json) {
-            auto timings = resp.getTimings();
+            auto& timings = response;
             if (timings == nullptr) {
                 if (!skip) {
                     std::cerr << "The server doesn't have information about \""
@@ -235,7 +255,7 @@ static void request_cmd_timings(MemcachedConnection& connection,
                 std::cout << timings.dump(JSON_DUMP_INDENT_SIZE) << std::endl;
             }
         } else {
-            Timings timings(resp.getTimings());
+            Timings timings(response);
 
             if (timings.getTotal() == 0) {
                 if (skip == 0) {
@@ -257,6 +277,85 @@ static void request_cmd_timings(MemcachedConnection& connection,
     }
 }
 
+/// A connection to one of the nodes in the cluster (used by --merge)
+struct Node {
+    std::string name;
+    std::unique_ptr<MemcachedConnection> connection;
+};
+
+/**
+ * Fetch the timings for the opcode from all of the nodes and print the
+ * merged histogram (so that the percentiles are the percentiles of the
+ * cluster rather than of an individual node).
+ */
+static void request_merged_cmd_timings(std::vector<Node>& nodes,
+                                       const std::string& bucket,
+                                       cb::mcbp::ClientOpcode opcode,
+                                       bool verbose,
+                                       bool skip,
+                                       bool json) {
+    try {
+        auto command = opcode2string(opcode);
+        boost::optional<HdrHistogram> merged;
+        for (auto& node : nodes) {
+            auto timings = fetch_cmd_timings(*node.connection, bucket, opcode);
+            if (timings == nullptr || timings.find("data") == timings.end()) {
+                continue;
+            }
+            auto encoded = timings.find("encoded");
+            if (encoded == timings.end()) {
+                throw std::runtime_error(
+                        "The server " + node.name +
+                        " doesn't support merging of timings");
+            }
+            const auto raw = cb::base64::decode(encoded->get<std::string>());
+            auto histogram = HdrHistogram::decode(
+                    {reinterpret_cast<const char*>(raw.data()), raw.size()});
+            if (merged) {
+                *merged += histogram;
+            } else {
+                merged = histogram;
+            }
+        }
+
+        if (!merged || merged->getValueCount() == 0) {
+            if (!skip) {
+                std::cout << "The cluster doesn't have information about \""
+                          << command << "\"" << std::endl;
+            }
+            return;
+        }
+
+        auto root = merged->to_json();
+        root["nodes"] = nodes.size();
+        if (json) {
+            root["command"] = command;
+            root["percentiles"] = {
+                    {"50", merged->getValueAtPercentile(50.0)},
+                    {"90", merged->getValueAtPercentile(90.0)},
+                    {"99", merged->getValueAtPercentile(99.0)},
+                    {"99.9", merged->getValueAtPercentile(99.9)}};
+            std::cout << root.dump(JSON_DUMP_INDENT_SIZE) << std::endl;
+            return;
+        }
+
+        if (verbose) {
+            Timings timings(root);
+            timings.dumpHistogram(command);
+        }
+        std::cout << command << " " << merged->getValueCount()
+                  << " operations on " << nodes.size()
+                  << " nodes: p50 " << merged->getValueAtPercentile(50.0)
+                  << "us p90 " << merged->getValueAtPercentile(90.0)
+                  << "us p99 " << merged->getValueAtPercentile(99.0)
+                  << "us p99.9 " << merged->getValueAtPercentile(99.9) << "us"
+                  << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
 static void request_stat_timings(MemcachedConnection& connection,
                                  const std::string& key,
                                  bool verbose,
@@ -314,6 +413,63 @@ static void request_stat_timings(MemcachedConnection& connection,
     }
 }
 
+/**
+ * Print the number of allocations per operation for each opcode, as
+ * returned by "stats allocations" (see allocation_tracking_enabled)
+ */
+static void request_allocations(MemcachedConnection& connection,
+                                bool json_output) {
+    std::map<std::string, std::string> map;
+    try {
+        map = connection.statsMap("allocations");
+    } catch (const ConnectionError& ex) {
+        if (ex.isAccessDenied()) {
+            std::cerr << "Not authorized to access allocation data"
+                      << std::endl;
+        } else {
+            std::cerr << "Fatal error: " << ex.what() << std::endl;
+        }
+        exit(EXIT_FAILURE);
+    }
+
+    try {
+        nlohmann::json json = nlohmann::json::object();
+        for (const auto& entry : map) {
+            json[entry.first] = nlohmann::json::parse(entry.second);
+        }
+
+        if (json_output) {
+            std::cout << json.dump(JSON_DUMP_INDENT_SIZE) << std::endl;
+            return;
+        }
+
+        if (json.empty()) {
+            std::cout << "No allocations recorded (is "
+                         "allocation_tracking_enabled set?)"
+                      << std::endl;
+            return;
+        }
+
+        std::cout << std::left << std::setw(24) << "Opcode" << std::right
+                  << std::setw(14) << "Operations" << std::setw(14)
+                  << "Allocs/op" << std::setw(14) << "Bytes/op" << std::endl;
+        for (auto it = json.begin(); it != json.end(); ++it) {
+            const auto ops = cb::jsonGet<uint64_t>(it.value(), "ops");
+            const auto allocations =
+                    cb::jsonGet<uint64_t>(it.value(), "allocations");
+            const auto bytes = cb::jsonGet<uint64_t>(it.value(), "bytes");
+            std::cout << std::left << std::setw(24) << it.key() << std::right
+                      << std::setw(14) << ops << std::fixed
+                      << std::setprecision(1) << std::setw(14)
+                      << double(allocations) / ops << std::setw(14)
+                      << double(bytes) / ops << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
 void usage() {
     std::cerr << "Usage mctimings [options] [opcode / statname]\n"
               << R"(Options:
@@ -330,14 +486,24 @@ void usage() {
   -v or --verbose                Use verbose output
   -S                             Read password from standard input
   -j or --json[=pretty]          Print JSON instead of histograms
+  -a or --allocations            Print the number of allocations per
+                                 operation for each opcode (requires
+                                 allocation_tracking_enabled)
+  -m or --merge                  Merge the command timings of all of the
+                                 hosts (specify -h multiple times, or use
+                                 a comma separated list of hosts) and
+                                 print the percentiles of the cluster
   --help                         This help text
 
 )" << std::endl
 
               << std::endl
-              << "Example:" << std::endl
+              << "Examples:" << std::endl
               << "    mctimings --user operator --bucket /all/ --password - "
                  "--verbose GET SET"
+              << std::endl
+              << "    mctimings --user operator --password - --merge "
+                 "--host node1,node2,node3 GET"
               << std::endl;
 }
 
@@ -347,7 +513,7 @@ int main(int argc, char** argv) {
 
     int cmd;
     std::string port{"11210"};
-    std::string host{"localhost"};
+    std::vector<std::string> hosts;
     std::string user{};
     std::string password{};
     std::string bucket{"/all/"};
@@ -355,6 +521,8 @@ int main(int argc, char** argv) {
     bool verbose = false;
     bool secure = false;
     bool json = false;
+    bool allocations = false;
+    bool merge = false;
 
     /* Initialize the socket subsystem */
     cb_initialize_sockets();
@@ -370,11 +538,13 @@ int main(int argc, char** argv) {
             {"ssl", no_argument, nullptr, 's'},
             {"verbose", no_argument, nullptr, 'v'},
             {"json", optional_argument, nullptr, 'j'},
+            {"allocations", no_argument, nullptr, 'a'},
+            {"merge", no_argument, nullptr, 'm'},
             {"help", no_argument, nullptr, 0},
             {nullptr, 0, nullptr, 0}};
 
     while ((cmd = getopt_long(
-                    argc, argv, "46h:p:u:b:P:sSvj", long_options, nullptr)) !=
+                    argc, argv, "46h:p:u:b:P:sSvjam", long_options, nullptr)) !=
            EOF) {
         switch (cmd) {
         case '6':
@@ -384,7 +554,11 @@ int main(int argc, char** argv) {
             family = AF_INET;
             break;
         case 'h':
-            host.assign(optarg);
+            for (const auto& h : split_string(optarg, ",")) {
+                if (!h.empty()) {
+                    hosts.push_back(h);
+                }
+            }
             break;
         case 'p':
             port.assign(optarg);
@@ -413,6 +587,12 @@ int main(int argc, char** argv) {
                 verbose = true;
             }
             break;
+        case 'a':
+            allocations = true;
+            break;
+        case 'm':
+            merge = true;
+            break;
         default:
             usage();
             return cmd == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -428,49 +608,92 @@ int main(int argc, char** argv) {
         }
     }
 
-    try {
-        in_port_t in_port;
-        sa_family_t fam;
-        std::tie(host, in_port, fam) = cb::inet::parse_hostname(host, port);
-
-        if (family == AF_UNSPEC) { // The user may have used -4 or -6
-            family = fam;
-        }
-        MemcachedConnection connection(host, in_port, family, secure);
-
-        connection.connect();
-
-        // MEMCACHED_VERSION contains the git sha
-        connection.hello("mctimings",
-                         MEMCACHED_VERSION,
-                         "command line utitilty to fetch command timings");
-        connection.setXerrorSupport(true);
+    if (hosts.empty()) {
+        hosts.emplace_back("localhost");
+    }
+    if (hosts.size() > 1 && !merge) {
+        std::cerr << "Multiple hosts may only be used with --merge"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (merge && allocations) {
+        std::cerr << "--merge can't be used with --allocations" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-        if (!user.empty()) {
-            connection.authenticate(user, password,
-                                    connection.getSaslMechanisms());
-        }
+    try {
+        std::vector<Node> nodes;
+        for (const auto& h : hosts) {
+            std::string host;
+            in_port_t in_port;
+            sa_family_t fam;
+            std::tie(host, in_port, fam) = cb::inet::parse_hostname(h, port);
+
+            // The user may have used -4 or -6
+            auto connection = std::make_unique<MemcachedConnection>(
+                    host, in_port, family == AF_UNSPEC ? fam : family, secure);
+
+            connection->connect();
+
+            // MEMCACHED_VERSION contains the git sha
+            connection->hello("mctimings",
+                              MEMCACHED_VERSION,
+                              "command line utitilty to fetch command timings");
+            connection->setXerrorSupport(true);
+
+            if (!user.empty()) {
+                connection->authenticate(
+                        user, password, connection->getSaslMechanisms());
+            }
 
-        if (!bucket.empty() && bucket != "/all/") {
-            connection.selectBucket(bucket);
+            if (!bucket.empty() && bucket != "/all/") {
+                connection->selectBucket(bucket);
+            }
+            nodes.push_back({h, std::move(connection)});
         }
+        auto& connection = *nodes.front().connection;
 
-        if (optind == argc) {
+        if (allocations) {
+            request_allocations(connection, json);
+        } else if (optind == argc) {
             for (int ii = 0; ii < 256; ++ii) {
-                request_cmd_timings(connection,
-                                    bucket,
-                                    cb::mcbp::ClientOpcode(ii),
-                                    verbose,
-                                    true,
-                                    json);
+                if (merge) {
+                    request_merged_cmd_timings(nodes,
+                                               bucket,
+                                               cb::mcbp::ClientOpcode(ii),
+                                               verbose,
+                                               true,
+                                               json);
+                } else {
+                    request_cmd_timings(connection,
+                                        bucket,
+                                        cb::mcbp::ClientOpcode(ii),
+                                        verbose,
+                                        true,
+                                        json);
+                }
             }
         } else {
             for (; optind < argc; ++optind) {
                 try {
                     const auto opcode = to_opcode(argv[optind]);
-                    request_cmd_timings(
-                            connection, bucket, opcode, verbose, false, json);
+                    if (merge) {
+                        request_merged_cmd_timings(
+                                nodes, bucket, opcode, verbose, false, json);
+                    } else {
+                        request_cmd_timings(connection,
+                                            bucket,
+                                            opcode,
+                                            verbose,
+                                            false,
+                                            json);
+                    }
                 } catch (const std::invalid_argument&) {
+                    if (merge) {
+                        std::cerr << "Only command timings may be merged: "
+                                  << argv[optind] << std::endl;
+                        return EXIT_FAILURE;
+                    }
                     // Not a command timing, try as statistic timing.
                     request_stat_timings(
                             connection, argv[optind], verbose, json);
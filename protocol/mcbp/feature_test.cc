@@ -38,7 +38,9 @@ const std::map<cb::mcbp::Feature, std::string> blueprint = {
          {cb::mcbp::Feature::Tracing, "Tracing"},
          {cb::mcbp::Feature::AltRequestSupport, "AltRequestSupport"},
          {cb::mcbp::Feature::SyncReplication, "SyncReplication"},
-         {cb::mcbp::Feature::OpenTracing, "OpenTracing"}}};
+         {cb::mcbp::Feature::OpenTracing, "OpenTracing"},
+         {cb::mcbp::Feature::ClustermapChangeNotificationDelta,
+          "Clustermap change notification delta"}}};
 
 TEST(to_string, LegalValues) {
     for (const auto& entry : blueprint) {
@@ -114,6 +114,7 @@ bool is_valid_opcode(ClientOpcode opcode) {
     case ClientOpcode::DcpSeqnoAcknowledged:
     case ClientOpcode::DcpCommit:
     case ClientOpcode::DcpAbort:
+    case ClientOpcode::DcpSeqnoAdvanced:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -158,6 +159,9 @@ bool is_valid_opcode(ClientOpcode opcode) {
     case ClientOpcode::CollectionsGetManifest:
     case ClientOpcode::CollectionsGetID:
     case ClientOpcode::CollectionsGetScopeID:
+    case ClientOpcode::GetMulti:
+    case ClientOpcode::ArithmeticMulti:
+    case ClientOpcode::SetWithMetaMulti:
     case ClientOpcode::SetDriftCounterState:
     case ClientOpcode::GetAdjustedTime:
     case ClientOpcode::SubdocGet:
@@ -306,6 +310,7 @@ bool is_durability_supported(ClientOpcode opcode) {
     case ClientOpcode::DcpSeqnoAcknowledged:
     case ClientOpcode::DcpCommit:
     case ClientOpcode::DcpAbort:
+    case ClientOpcode::DcpSeqnoAdvanced:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -350,6 +355,9 @@ bool is_durability_supported(ClientOpcode opcode) {
     case ClientOpcode::CollectionsGetManifest:
     case ClientOpcode::CollectionsGetID:
     case ClientOpcode::CollectionsGetScopeID:
+    case ClientOpcode::GetMulti:
+    case ClientOpcode::ArithmeticMulti:
+    case ClientOpcode::SetWithMetaMulti:
     case ClientOpcode::SetDriftCounterState:
     case ClientOpcode::GetAdjustedTime:
     case ClientOpcode::SubdocGet:
@@ -474,6 +482,7 @@ bool is_reorder_supported(ClientOpcode opcode) {
     case ClientOpcode::DcpSeqnoAcknowledged:
     case ClientOpcode::DcpCommit:
     case ClientOpcode::DcpAbort:
+    case ClientOpcode::DcpSeqnoAdvanced:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -514,6 +523,9 @@ bool is_reorder_supported(ClientOpcode opcode) {
     case ClientOpcode::CollectionsGetManifest:
     case ClientOpcode::CollectionsGetID:
     case ClientOpcode::CollectionsGetScopeID:
+    case ClientOpcode::GetMulti:
+    case ClientOpcode::ArithmeticMulti:
+    case ClientOpcode::SetWithMetaMulti:
     case ClientOpcode::SetDriftCounterState:
     case ClientOpcode::GetAdjustedTime:
     case ClientOpcode::SubdocGet:
@@ -733,6 +745,8 @@ std::string to_string(cb::mcbp::ClientOpcode opcode) {
         return "DCP_COMMIT";
     case ClientOpcode::DcpAbort:
         return "DCP_ABORT";
+    case ClientOpcode::DcpSeqnoAdvanced:
+        return "DCP_SEQNO_ADVANCED";
     case ClientOpcode::StopPersistence:
         return "STOP_PERSISTENCE";
     case ClientOpcode::StartPersistence:
@@ -821,6 +835,12 @@ std::string to_string(cb::mcbp::ClientOpcode opcode) {
         return "COLLECTIONS_GET_ID";
     case ClientOpcode::CollectionsGetScopeID:
         return "COLLECTIONS_GET_SCOPE_ID";
+    case ClientOpcode::GetMulti:
+        return "GET_MULTI";
+    case ClientOpcode::ArithmeticMulti:
+        return "ARITHMETIC_MULTI";
+    case ClientOpcode::SetWithMetaMulti:
+        return "SET_WITH_META_MULTI";
     case ClientOpcode::SetDriftCounterState:
         return "SET_DRIFT_COUNTER_STATE";
     case ClientOpcode::GetAdjustedTime:
@@ -113,6 +113,7 @@ const std::map<cb::mcbp::ClientOpcode, std::string> client_blueprint = {
          {ClientOpcode::DcpSeqnoAcknowledged, "DCP_SEQNO_ACKNOWLEDGED"},
          {ClientOpcode::DcpCommit, "DCP_COMMIT"},
          {ClientOpcode::DcpAbort, "DCP_ABORT"},
+         {ClientOpcode::DcpSeqnoAdvanced, "DCP_SEQNO_ADVANCED"},
          {ClientOpcode::StopPersistence, "STOP_PERSISTENCE"},
          {ClientOpcode::StartPersistence, "START_PERSISTENCE"},
          {ClientOpcode::SetParam, "SET_PARAM"},
@@ -157,6 +158,9 @@ const std::map<cb::mcbp::ClientOpcode, std::string> client_blueprint = {
          {ClientOpcode::CollectionsGetManifest, "COLLECTIONS_GET_MANIFEST"},
          {ClientOpcode::CollectionsGetID, "COLLECTIONS_GET_ID"},
          {ClientOpcode::CollectionsGetScopeID, "COLLECTIONS_GET_SCOPE_ID"},
+         {ClientOpcode::GetMulti, "GET_MULTI"},
+         {ClientOpcode::ArithmeticMulti, "ARITHMETIC_MULTI"},
+         {ClientOpcode::SetWithMetaMulti, "SET_WITH_META_MULTI"},
          {ClientOpcode::SetDriftCounterState, "SET_DRIFT_COUNTER_STATE"},
          {ClientOpcode::GetAdjustedTime, "GET_ADJUSTED_TIME"},
          {ClientOpcode::SubdocGet, "SUBDOC_GET"},
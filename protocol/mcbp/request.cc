@@ -169,6 +169,7 @@ bool Request::isQuiet() const {
         case ClientOpcode::DcpSeqnoAcknowledged:
         case ClientOpcode::DcpCommit:
         case ClientOpcode::DcpAbort:
+        case ClientOpcode::DcpSeqnoAdvanced:
         case ClientOpcode::StopPersistence:
         case ClientOpcode::StartPersistence:
         case ClientOpcode::SetParam:
@@ -209,6 +210,9 @@ bool Request::isQuiet() const {
         case ClientOpcode::CollectionsGetManifest:
         case ClientOpcode::CollectionsGetID:
         case ClientOpcode::CollectionsGetScopeID:
+        case ClientOpcode::GetMulti:
+        case ClientOpcode::ArithmeticMulti:
+        case ClientOpcode::SetWithMetaMulti:
         case ClientOpcode::SetDriftCounterState:
         case ClientOpcode::GetAdjustedTime:
         case ClientOpcode::SubdocGet:
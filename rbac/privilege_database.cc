@@ -43,7 +43,12 @@ struct DatabaseContext {
     std::atomic<uint32_t> current_generation{0};
     std::atomic<uint32_t> create_generation{0};
 
-    folly::Synchronized<std::unique_ptr<PrivilegeDatabase>> db;
+    // Bumped every time db is replaced (including initialize() and
+    // destroy()) so that the per-thread snapshots below know when they
+    // must be refreshed.
+    std::atomic<uint64_t> revision{0};
+
+    folly::Synchronized<std::shared_ptr<const PrivilegeDatabase>> db;
 };
 
 /// We keep one context for the local scope, and one for the external
@@ -62,6 +67,49 @@ static int to_index(Domain domain) {
     throw std::invalid_argument("to_index(): Invalid domain provided");
 }
 
+/**
+ * Get a snapshot of the current database for the given domain.
+ *
+ * Every front end thread keeps its own reference to the database and
+ * only grabs the read lock (to refresh the reference) when the database
+ * was replaced since the last time it looked. Creating privilege contexts
+ * for a large number of connections (or rebuilding them after a reload)
+ * therefore don't all serialize on the same lock. The returned reference
+ * is valid until the next call to getSnapshot from the same thread.
+ */
+static const PrivilegeDatabase& getSnapshot(Domain domain) {
+    struct Snapshot {
+        std::shared_ptr<const PrivilegeDatabase> db;
+        uint64_t revision = 0;
+    };
+    static thread_local Snapshot snapshots[2];
+
+    const auto idx = to_index(domain);
+    auto& ctx = contexts[idx];
+    auto& snapshot = snapshots[idx];
+    const auto revision = ctx.revision.load(std::memory_order_acquire);
+    if (!snapshot.db || snapshot.revision != revision) {
+        // Re-read the revision under the lock so that it matches the
+        // database we pick up
+        auto locked = ctx.db.rlock();
+        snapshot.db = *locked;
+        snapshot.revision = ctx.revision.load(std::memory_order_acquire);
+    }
+    if (!snapshot.db) {
+        throw std::logic_error("cb::rbac::getSnapshot(): not initialized");
+    }
+    return *snapshot.db;
+}
+
+/// Replace the database for the context (the caller must hold the write
+/// lock)
+static void replaceDatabase(DatabaseContext& ctx,
+                            std::shared_ptr<const PrivilegeDatabase>& locked,
+                            std::shared_ptr<const PrivilegeDatabase> next) {
+    locked = std::move(next);
+    ctx.revision.fetch_add(1, std::memory_order_acq_rel);
+}
+
 bool UserEntry::operator==(const UserEntry& other) const {
     return (internal == other.internal && privileges == other.privileges &&
             buckets == other.buckets);
@@ -272,8 +320,12 @@ PrivilegeAccess PrivilegeDatabase::check(const PrivilegeContext& context,
     return context.check(privilege);
 }
 
+bool PrivilegeContext::isStale() const {
+    return generation != contexts[to_index(domain)].current_generation;
+}
+
 PrivilegeAccess PrivilegeContext::check(Privilege privilege) const {
-    if (generation != contexts[to_index(domain)].current_generation) {
+    if (isStale()) {
         return PrivilegeAccess::Stale;
     }
 
@@ -348,14 +400,12 @@ void PrivilegeContext::setBucketPrivilegeBits(bool value) {
 PrivilegeContext createContext(const std::string& user,
                                Domain domain,
                                const std::string& bucket) {
-    auto& ctx = contexts[to_index(domain)];
-    return (*ctx.db.rlock())->createContext(user, domain, bucket);
+    return getSnapshot(domain).createContext(user, domain, bucket);
 }
 
 std::pair<PrivilegeContext, bool> createInitialContext(const std::string& user,
                                                        Domain domain) {
-    auto& ctx = contexts[to_index(domain)];
-    return (*ctx.db.rlock())->createInitialContext(user, domain);
+    return getSnapshot(domain).createInitialContext(user, domain);
 }
 
 void loadPrivilegeDatabase(const std::string& filename) {
@@ -382,23 +432,26 @@ void loadPrivilegeDatabase(const std::string& filename) {
     // Handle race conditions
     if ((*locked)->generation < database->generation) {
         ctx.current_generation = database->generation;
-        locked->swap(database);
+        replaceDatabase(ctx, *locked, std::move(database));
     }
 }
 
 void initialize() {
     // Create an empty database to avoid having to add checks
     // if it exists or not...
-    contexts[to_index(Domain::Local)].db = std::make_unique<PrivilegeDatabase>(
-            nlohmann::json{}, Domain::Local);
-    contexts[to_index(Domain::External)].db =
-            std::make_unique<PrivilegeDatabase>(nlohmann::json{},
-                                                Domain::External);
+    for (auto domain : {Domain::Local, Domain::External}) {
+        auto& ctx = contexts[to_index(domain)];
+        replaceDatabase(
+                ctx,
+                *ctx.db.wlock(),
+                std::make_shared<PrivilegeDatabase>(nlohmann::json{}, domain));
+    }
 }
 
 void destroy() {
-    contexts[to_index(Domain::Local)].db.wlock()->reset();
-    contexts[to_index(Domain::External)].db.wlock()->reset();
+    for (auto& ctx : contexts) {
+        replaceDatabase(ctx, *ctx.db.wlock(), {});
+    }
 }
 
 bool mayAccessBucket(const std::string& user,
@@ -429,7 +482,7 @@ void updateExternalUser(const std::string& descr) {
         // I changed the database. Update the context gen counter and
         // swap the databases
         ctx.current_generation = next->generation;
-        locked->swap(next);
+        replaceDatabase(ctx, *locked, std::move(next));
     }
 }
 
@@ -440,9 +493,8 @@ nlohmann::json to_json(Domain domain) {
 
 boost::optional<std::chrono::steady_clock::time_point> getExternalUserTimestamp(
         const std::string& user) {
-    auto& ctx = contexts[to_index(Domain::External)];
     try {
-        auto ue = (*ctx.db.rlock())->lookup(user);
+        const auto& ue = getSnapshot(Domain::External).lookup(user);
         return {ue.getTimestamp()};
     } catch (const NoSuchUserException&) {
         return {};
@@ -144,3 +144,34 @@ TEST(PrivilegeDatabaseTest, to_json) {
     cb::rbac::PrivilegeDatabase db(json, cb::rbac::Domain::External);
     EXPECT_EQ(json.dump(2), db.to_json(cb::rbac::Domain::External).dump(2));
 }
+
+TEST(PrivilegeDatabaseTest, ContextFollowsDatabaseUpdates) {
+    using cb::rbac::Privilege;
+    using cb::rbac::PrivilegeAccess;
+
+    cb::rbac::initialize();
+    nlohmann::json json;
+    json["trond"]["buckets"]["mybucket"] = {"Read"};
+    json["trond"]["domain"] = "external";
+    cb::rbac::updateExternalUser(json.dump());
+
+    auto ctx = cb::rbac::createContext(
+            "trond", cb::rbac::Domain::External, "mybucket");
+    EXPECT_FALSE(ctx.isStale());
+    EXPECT_EQ(PrivilegeAccess::Ok, ctx.check(Privilege::Read));
+    EXPECT_EQ(PrivilegeAccess::Fail, ctx.check(Privilege::Upsert));
+
+    // Updating the database should invalidate the existing context, and
+    // the new database should be used when creating the next context
+    json["trond"]["buckets"]["mybucket"] = {"Read", "Upsert"};
+    cb::rbac::updateExternalUser(json.dump());
+    EXPECT_TRUE(ctx.isStale());
+    EXPECT_EQ(PrivilegeAccess::Stale, ctx.check(Privilege::Read));
+
+    ctx = cb::rbac::createContext(
+            "trond", cb::rbac::Domain::External, "mybucket");
+    EXPECT_FALSE(ctx.isStale());
+    EXPECT_EQ(PrivilegeAccess::Ok, ctx.check(Privilege::Upsert));
+
+    cb::rbac::destroy();
+}
@@ -636,6 +636,86 @@ TEST_F(SettingsTest, ConnectionIdleTime) {
     }
 }
 
+TEST_F(SettingsTest, SamplingProfilerFrequency) {
+    nonNumericValuesShouldFail("sampling_profiler_frequency");
+
+    nlohmann::json obj;
+    obj["sampling_profiler_frequency"] = 19;
+    Settings settings(obj);
+    EXPECT_EQ(19, settings.getSamplingProfilerFrequency());
+    EXPECT_TRUE(settings.has.sampling_profiler_frequency);
+}
+
+TEST_F(SettingsTest, EventTimeBudget) {
+    nonNumericValuesShouldFail("event_time_budget");
+
+    nlohmann::json obj;
+    obj["event_time_budget"] = 250;
+    Settings settings(obj);
+    EXPECT_EQ(250, settings.getEventTimeBudget());
+    EXPECT_TRUE(settings.has.event_time_budget);
+}
+
+TEST_F(SettingsTest, MaxSendPerEvent) {
+    nonNumericValuesShouldFail("max_send_per_event");
+
+    nlohmann::json obj;
+    obj["max_send_per_event"] = 65536;
+    Settings settings(obj);
+    EXPECT_EQ(65536, settings.getMaxSendPerEvent());
+    EXPECT_TRUE(settings.has.max_send_per_event);
+}
+
+TEST_F(SettingsTest, ResponseCorkSize) {
+    nonNumericValuesShouldFail("response_cork_size");
+
+    nlohmann::json obj;
+    obj["response_cork_size"] = 4096;
+    Settings settings(obj);
+    EXPECT_EQ(4096, settings.getResponseCorkSize());
+    EXPECT_TRUE(settings.has.response_cork_size);
+}
+
+TEST_F(SettingsTest, TracingAutoDumpDir) {
+    nonStringValuesShouldFail("tracing_auto_dump_dir");
+
+    nlohmann::json obj;
+    obj["tracing_auto_dump_dir"] = "/var/tmp";
+    Settings settings(obj);
+    EXPECT_EQ("/var/tmp", settings.getTracingAutoDumpDir());
+    EXPECT_TRUE(settings.has.tracing_auto_dump_dir);
+}
+
+TEST_F(SettingsTest, TracingAutoDumpInterval) {
+    nonNumericValuesShouldFail("tracing_auto_dump_interval");
+
+    nlohmann::json obj;
+    obj["tracing_auto_dump_interval"] = 60;
+    Settings settings(obj);
+    EXPECT_EQ(60, settings.getTracingAutoDumpInterval());
+    EXPECT_TRUE(settings.has.tracing_auto_dump_interval);
+}
+
+TEST_F(SettingsTest, InflatedValueCacheSize) {
+    nonNumericValuesShouldFail("inflated_value_cache_size");
+
+    nlohmann::json obj;
+    obj["inflated_value_cache_size"] = 4096;
+    Settings settings(obj);
+    EXPECT_EQ(4096, settings.getInflatedValueCacheSize());
+    EXPECT_TRUE(settings.has.inflated_value_cache_size);
+}
+
+TEST_F(SettingsTest, TopkeysMaxSampleInterval) {
+    nonNumericValuesShouldFail("topkeys_max_sample_interval");
+
+    nlohmann::json obj;
+    obj["topkeys_max_sample_interval"] = 64;
+    Settings settings(obj);
+    EXPECT_EQ(64, settings.getTopkeysMaxSampleInterval());
+    EXPECT_TRUE(settings.has.topkeys_max_sample_interval);
+}
+
 TEST_F(SettingsTest, BioDrainBufferSize) {
     nonNumericValuesShouldFail("bio_drain_buffer_sz");
 
@@ -675,6 +755,20 @@ TEST_F(SettingsTest, DatatypeJson) {
     }
 }
 
+TEST_F(SettingsTest, NumaAwareThreads) {
+    nonBooleanValuesShouldFail("numa_aware_threads");
+
+    nlohmann::json obj;
+    obj["numa_aware_threads"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isNumaAwareThreads());
+        EXPECT_TRUE(settings.has.numa_aware_threads);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
 TEST_F(SettingsTest, DatatypeSnappy) {
     nonBooleanValuesShouldFail("datatype_snappy");
 
@@ -776,6 +870,24 @@ TEST_F(SettingsTest, SslCipherOrder) {
     }
 }
 
+TEST_F(SettingsTest, SslKtlsEnabled) {
+    nonBooleanValuesShouldFail("ssl_ktls_enabled");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.ssl_ktls_enabled);
+    EXPECT_FALSE(settings.isSslKtlsEnabled());
+
+    obj["ssl_ktls_enabled"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isSslKtlsEnabled());
+        EXPECT_TRUE(settings.has.ssl_ktls_enabled);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
 TEST_F(SettingsTest, SslMinimumProtocol) {
     nonStringValuesShouldFail("ssl_minimum_protocol");
 
@@ -885,6 +997,19 @@ TEST_F(SettingsTest, max_concurrent_commands_per_connection) {
     EXPECT_TRUE(settings.has.max_concurrent_commands_per_connection);
 }
 
+TEST_F(SettingsTest, MaxConcurrentAuthentications) {
+    nonNumericValuesShouldFail("max_concurrent_authentications");
+
+    nlohmann::json obj;
+    obj["max_concurrent_authentications"] = 100;
+    Settings settings(obj);
+    EXPECT_EQ(100, settings.getMaxConcurrentAuthentications());
+    EXPECT_TRUE(settings.has.max_concurrent_authentications);
+
+    obj["max_concurrent_authentications"] = 0;
+    expectFail<std::invalid_argument>(obj);
+}
+
 TEST_F(SettingsTest, SaslMechanisms) {
     nonStringValuesShouldFail("sasl_mechanisms");
 
@@ -979,6 +1104,52 @@ TEST_F(SettingsTest, TracingEnabled) {
     }
 }
 
+TEST_F(SettingsTest, PhaseTimingsEnabled) {
+    nonBooleanValuesShouldFail("phase_timings_enabled");
+
+    nlohmann::json obj;
+    obj["phase_timings_enabled"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isPhaseTimingsEnabled());
+        EXPECT_TRUE(settings.has.phase_timings_enabled);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["phase_timings_enabled"] = false;
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isPhaseTimingsEnabled());
+        EXPECT_TRUE(settings.has.phase_timings_enabled);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, AllocationTrackingEnabled) {
+    nonBooleanValuesShouldFail("allocation_tracking_enabled");
+
+    nlohmann::json obj;
+    obj["allocation_tracking_enabled"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isAllocationTrackingEnabled());
+        EXPECT_TRUE(settings.has.allocation_tracking_enabled);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["allocation_tracking_enabled"] = false;
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isAllocationTrackingEnabled());
+        EXPECT_TRUE(settings.has.allocation_tracking_enabled);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
 TEST_F(SettingsTest, ExternalAuthService) {
     nonBooleanValuesShouldFail("external_auth_service");
 
@@ -1195,6 +1366,20 @@ TEST(SettingsUpdateTest, MaxConcurrentCommandsPerConnectionIsDynamic) {
     EXPECT_EQ(1000, settings.getMaxConcurrentCommandsPerConnection());
 }
 
+TEST(SettingsUpdateTest, MaxConcurrentAuthenticationsIsDynamic) {
+    Settings updated;
+    Settings settings;
+    settings.setMaxConcurrentAuthentications(10);
+    // setting it to the same value should work
+    updated.setMaxConcurrentAuthentications(10);
+    settings.updateSettings(updated, false);
+
+    // changing it should work
+    updated.setMaxConcurrentAuthentications(1000);
+    settings.updateSettings(updated, true);
+    EXPECT_EQ(1000, settings.getMaxConcurrentAuthentications());
+}
+
 TEST(SettingsUpdateTest, DefaultReqIsDynamic) {
     Settings updated;
     Settings settings;
@@ -1291,6 +1476,101 @@ TEST(SettingsUpdateTest, VerbosityIsDynamic) {
     EXPECT_EQ(updated.getVerbose(), settings.getVerbose());
 }
 
+TEST(SettingsUpdateTest, EventTimeBudgetIsDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    auto old = settings.getEventTimeBudget();
+    updated.setEventTimeBudget(old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setEventTimeBudget(old + 100);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(old, settings.getEventTimeBudget());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(updated.getEventTimeBudget(), settings.getEventTimeBudget());
+}
+
+TEST(SettingsUpdateTest, MaxSendPerEventIsDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    auto old = settings.getMaxSendPerEvent();
+    updated.setMaxSendPerEvent(old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setMaxSendPerEvent(old + 4096);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(old, settings.getMaxSendPerEvent());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(updated.getMaxSendPerEvent(), settings.getMaxSendPerEvent());
+}
+
+TEST(SettingsUpdateTest, ResponseCorkSizeIsDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    auto old = settings.getResponseCorkSize();
+    updated.setResponseCorkSize(old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setResponseCorkSize(old + 4096);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(old, settings.getResponseCorkSize());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(updated.getResponseCorkSize(), settings.getResponseCorkSize());
+}
+
+TEST(SettingsUpdateTest, TracingAutoDumpIsDynamic) {
+    Settings updated;
+    Settings settings;
+    updated.setTracingAutoDumpDir("/var/tmp");
+    updated.setTracingAutoDumpInterval(60);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ("", settings.getTracingAutoDumpDir());
+    EXPECT_EQ(300, settings.getTracingAutoDumpInterval());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ("/var/tmp", settings.getTracingAutoDumpDir());
+    EXPECT_EQ(60, settings.getTracingAutoDumpInterval());
+}
+
+TEST(SettingsUpdateTest, InflatedValueCacheSizeIsDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    auto old = settings.getInflatedValueCacheSize();
+    updated.setInflatedValueCacheSize(old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setInflatedValueCacheSize(old + 4096);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(old, settings.getInflatedValueCacheSize());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(updated.getInflatedValueCacheSize(),
+              settings.getInflatedValueCacheSize());
+}
+
+TEST(SettingsUpdateTest, TopkeysMaxSampleIntervalIsDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    auto old = settings.getTopkeysMaxSampleInterval();
+    updated.setTopkeysMaxSampleInterval(old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setTopkeysMaxSampleInterval(old + 63);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(old, settings.getTopkeysMaxSampleInterval());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(updated.getTopkeysMaxSampleInterval(),
+              settings.getTopkeysMaxSampleInterval());
+}
+
 TEST(SettingsUpdateTest, ConnectionIdleTimeIsDynamic) {
     Settings updated;
     Settings settings;
@@ -1336,6 +1616,20 @@ TEST(SettingsUpdateTest, DatatypeJsonIsNotDynamic) {
                  std::invalid_argument);
 }
 
+TEST(SettingsUpdateTest, NumaAwareThreadsIsNotDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    settings.setNumaAwareThreads(true);
+    updated.setNumaAwareThreads(settings.isNumaAwareThreads());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should not work
+    updated.setNumaAwareThreads(!settings.isNumaAwareThreads());
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
 TEST(SettingsUpdateTest, DatatypeSnappyIsDynamic) {
     Settings updated;
     Settings settings;
@@ -1491,6 +1785,28 @@ TEST(SettingsUpdateTest, DedupeNmvbMapsIsDynamic) {
     EXPECT_FALSE(settings.isDedupeNmvbMaps());
 }
 
+TEST(SettingsUpdateTest, SslKtlsEnabledIsDynamic) {
+    Settings settings;
+    Settings updated;
+    EXPECT_FALSE(settings.isSslKtlsEnabled());
+    updated.setSslKtlsEnabled(true);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_FALSE(settings.isSslKtlsEnabled());
+    EXPECT_NO_THROW(settings.updateSettings(updated, true));
+    EXPECT_TRUE(settings.isSslKtlsEnabled());
+}
+
+TEST(SettingsUpdateTest, PhaseTimingsEnabledIsDynamic) {
+    Settings settings;
+    Settings updated;
+    EXPECT_FALSE(settings.isPhaseTimingsEnabled());
+    updated.setPhaseTimingsEnabled(true);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_FALSE(settings.isPhaseTimingsEnabled());
+    EXPECT_NO_THROW(settings.updateSettings(updated, true));
+    EXPECT_TRUE(settings.isPhaseTimingsEnabled());
+}
+
 TEST(SettingsUpdateTest, OpcodeAttributesOverrideIsDynamic) {
     Settings settings;
     Settings updated;
@@ -1530,6 +1846,47 @@ TEST(SettingsUpdateTest, OpcodeAttributesMustBeValidFormat) {
     EXPECT_EQ("", settings.getOpcodeAttributesOverride());
 }
 
+TEST(SettingsUpdateTest, BucketThrottleIsDynamic) {
+    Settings settings;
+    Settings updated;
+
+    settings.setBucketThrottle(R"({"default":{"ops_per_sec":1000}})");
+    updated.setBucketThrottle(
+            R"({"default":{"ops_per_sec":1000,"bytes_per_sec":1048576}})");
+
+    // Dry-run
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_NE(updated.getBucketThrottle(), settings.getBucketThrottle());
+
+    // with update
+    EXPECT_NO_THROW(settings.updateSettings(updated, true));
+    EXPECT_EQ(updated.getBucketThrottle(), settings.getBucketThrottle());
+}
+
+TEST(SettingsUpdateTest, BucketThrottleMustBeValidFormat) {
+    Settings settings;
+
+    EXPECT_THROW(settings.setBucketThrottle("[]"), std::invalid_argument);
+    EXPECT_THROW(settings.setBucketThrottle(R"({"default":5})"),
+                 std::invalid_argument);
+    EXPECT_THROW(
+            settings.setBucketThrottle(R"({"default":{"ops_per_sec":-1}})"),
+            std::invalid_argument);
+    EXPECT_THROW(settings.setBucketThrottle(R"({"default":{"ops":1}})"),
+                 std::invalid_argument);
+    EXPECT_THROW(settings.setBucketThrottle(
+                         R"({"default":{"collections":{"xyz":{}}}})"),
+                 std::invalid_argument);
+
+    settings.setBucketThrottle(
+            R"({"default":{"ops_per_sec":1000,
+                           "collections":{"8":{"bytes_per_sec":1024}}}})");
+
+    // Setting to an empty value means drop the previous content
+    settings.setBucketThrottle("");
+    EXPECT_EQ("", settings.getBucketThrottle());
+}
+
 TEST_F(SettingsTest, ScramshaFallbackSaltIsDynamic) {
     Settings settings;
     Settings updated;
@@ -25,6 +25,7 @@
 #include <phosphor/phosphor.h>
 #include <platform/backtrace.h>
 #include <atomic>
+#include <future>
 #include <memory>
 
 class ExecutorTest : public ::testing::Test {
@@ -297,6 +298,51 @@ TEST_F(ExecutorTest, PeriodicExecution) {
     EXPECT_TRUE(cmd->executionComplete);
 }
 
+/// A task whose execution blocks until it is released.
+class BlockingTestTask : public Task {
+public:
+    Status execute() override {
+        started.set_value();
+        released.get_future().wait();
+        return Status::Finished;
+    }
+
+    std::promise<void> started;
+    std::promise<void> released;
+};
+
+/*
+ * A task which runs for a long time must not hold up the tasks scheduled
+ * after it while other executors are idle.
+ */
+TEST_F(ExecutorTest, ScheduleAvoidsBusyExecutor) {
+    executorpool = std::make_unique<cb::ExecutorPool>(2);
+
+    auto blocker = std::make_shared<BlockingTestTask>();
+    auto blockerStarted = blocker->started.get_future();
+    {
+        std::shared_ptr<Task> task = blocker;
+        std::lock_guard<std::mutex> guard(task->getMutex());
+        executorpool->schedule(task);
+    }
+    blockerStarted.wait();
+
+    // With the tasks distributed round robin, every other one would wait
+    // for the blocker.
+    for (int ii = 0; ii < 4; ++ii) {
+        auto cmd = std::make_shared<BasicTestTask>(1);
+        std::shared_ptr<Task> task = cmd;
+        std::unique_lock<std::mutex> lock(task->getMutex());
+        executorpool->schedule(task);
+        ASSERT_TRUE(cmd->cond.wait_for(lock, std::chrono::seconds(10), [&cmd] {
+            return cmd->executionComplete.load();
+        }));
+        EXPECT_EQ(1, cmd->runcount);
+    }
+
+    blocker->released.set_value();
+}
+
 using StaleTraceDumpRemoverTest = ExecutorTest;
 
 /**
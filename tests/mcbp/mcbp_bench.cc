@@ -19,9 +19,15 @@
 #include <benchmark/benchmark.h>
 #include <daemon/cookie.h>
 #include <daemon/front_end_thread.h>
+#include <daemon/mcbp_frame_batch.h>
 #include <daemon/mcbp_validators.h>
+#include <daemon/timings.h>
+#include <mcbp/protocol/framebuilder.h>
 #include <mcbp/protocol/header.h>
+#include <mcbp/protocol/unsigned_leb128.h>
+#include <memcached/dockey.h>
 #include <memcached/protocol_binary.h>
+#include <xattr/blob.h>
 
 FrontEndThread thread;
 /**
@@ -106,4 +112,170 @@ BENCHMARK_DEFINE_F(McbpValidatorBench, AddBench)(benchmark::State& state) {
 BENCHMARK_REGISTER_F(McbpValidatorBench, GetBench);
 BENCHMARK_REGISTER_F(McbpValidatorBench, SetBench);
 BENCHMARK_REGISTER_F(McbpValidatorBench, AddBench);
+
+/// Create a pipeline of count GET requests
+static std::vector<uint8_t> createGetPipeline(size_t count) {
+    const std::string key = "pipelined_key";
+    std::vector<uint8_t> frame(sizeof(cb::mcbp::Request) + key.size());
+    cb::mcbp::RequestBuilder builder({frame.data(), frame.size()});
+    builder.setMagic(cb::mcbp::Magic::ClientRequest);
+    builder.setOpcode(cb::mcbp::ClientOpcode::Get);
+    builder.setKey(key);
+
+    std::vector<uint8_t> pipeline;
+    for (size_t ii = 0; ii < count; ++ii) {
+        pipeline.insert(pipeline.end(), frame.begin(), frame.end());
+    }
+    return pipeline;
+}
+
+/**
+ * Test the per-packet cost of decoding the frames of a pipeline of
+ * state.range(0) GET requests from the input buffer: scanning them in
+ * batches and handing them out as pre-validated (as try_read_mcbp_command
+ * does), or checking each header on its own.
+ */
+static void FrameBatchDecodeBench(benchmark::State& state) {
+    const auto pipeline = createGetPipeline(state.range(0));
+    FrameBatch frames;
+
+    while (state.KeepRunning()) {
+        cb::const_byte_buffer input{pipeline.data(), pipeline.size()};
+        while (!input.empty()) {
+            auto frame = frames.next(input);
+            if (frame.empty()) {
+                frames.scan(input, 20 * 1024 * 1024);
+                frame = frames.next(input);
+            }
+            input = {input.data() + frame.size(), input.size() - frame.size()};
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void FramePerPacketDecodeBench(benchmark::State& state) {
+    const auto pipeline = createGetPipeline(state.range(0));
+
+    while (state.KeepRunning()) {
+        cb::const_byte_buffer input{pipeline.data(), pipeline.size()};
+        while (!input.empty()) {
+            const auto& header =
+                    *reinterpret_cast<const cb::mcbp::Header*>(input.data());
+            if (!header.isValid() ||
+                header.getBodylen() > 20 * 1024 * 1024) {
+                break;
+            }
+            const auto size = sizeof(header) + header.getBodylen();
+            benchmark::DoNotOptimize(size <= input.size());
+            input = {input.data() + size, input.size() - size};
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(FrameBatchDecodeBench)->Arg(1)->Arg(16)->Arg(128);
+BENCHMARK(FramePerPacketDecodeBench)->Arg(1)->Arg(16)->Arg(128);
+
+Timings timings;
+
+/**
+ * Test the cost of recording a command's duration into the per-opcode
+ * timings, as done for every command completion, with a number of threads
+ * recording concurrently.
+ */
+static void TimingsCollectBench(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        timings.collect(cb::mcbp::ClientOpcode::Get,
+                        std::chrono::microseconds(10));
+    }
+}
+
+BENCHMARK(TimingsCollectBench)->Threads(1)->Threads(4)->Threads(16);
+
+/**
+ * Create a collection-aware key of 32 bytes using the given collection-ID
+ */
+static std::vector<uint8_t> createCollectionKey(CollectionIDType cid) {
+    cb::mcbp::unsigned_leb128<CollectionIDType> leb128(cid);
+    std::vector<uint8_t> key(leb128.begin(), leb128.end());
+    key.resize(32, 'k');
+    return key;
+}
+
+/**
+ * Test the cost of decoding the collection-ID prefix of a key (arg is the
+ * collection-ID, which determines the length of the encoding).
+ */
+static void Leb128DecodeBench(benchmark::State& state) {
+    const auto key = createCollectionKey(CollectionIDType(state.range(0)));
+    cb::const_byte_buffer buffer{key.data(), key.size()};
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(
+                cb::mcbp::decode_unsigned_leb128<CollectionIDType>(buffer));
+    }
+}
+
+/**
+ * Test the cost of creating a DocKey and using its collection-ID a few times,
+ * as done along the path of a request.
+ */
+static void DocKeyCollectionIDBench(benchmark::State& state) {
+    const auto key = createCollectionKey(CollectionIDType(state.range(0)));
+    while (state.KeepRunning()) {
+        DocKey docKey(key.data(), key.size(), DocKeyEncodesCollectionId::Yes);
+        benchmark::DoNotOptimize(docKey.getCollectionID());
+        benchmark::DoNotOptimize(docKey.isPrivate());
+        benchmark::DoNotOptimize(docKey.makeDocKeyWithoutCollectionID());
+    }
+}
+
+/**
+ * Create an xattr blob with the given number of kv-pairs (every other one
+ * a system xattr)
+ */
+static cb::xattr::Blob createXattrBlob(size_t count) {
+    cb::xattr::Blob blob;
+    for (size_t ii = 0; ii < count; ++ii) {
+        const auto key = (ii % 2 ? "_sys" : "user") + std::to_string(ii);
+        blob.set(key, "{\"field\":\"value\"}");
+    }
+    return blob;
+}
+
+/**
+ * Test the cost of the lookups of a multi-path subdoc command against an
+ * xattr blob (arg is the number of xattrs)
+ */
+static void XattrBlobGetBench(benchmark::State& state) {
+    const auto count = size_t(state.range(0));
+    std::vector<std::string> keys;
+    for (size_t ii = 0; ii < count; ++ii) {
+        keys.push_back((ii % 2 ? "_sys" : "user") + std::to_string(ii));
+    }
+    const auto blob = createXattrBlob(count);
+    while (state.KeepRunning()) {
+        cb::xattr::Blob copy(blob);
+        for (const auto& key : keys) {
+            benchmark::DoNotOptimize(copy.get(key));
+        }
+    }
+}
+
+/**
+ * Test the cost of stripping the user xattrs off a blob (arg is the number
+ * of xattrs)
+ */
+static void XattrBlobPruneBench(benchmark::State& state) {
+    const auto blob = createXattrBlob(size_t(state.range(0)));
+    while (state.KeepRunning()) {
+        cb::xattr::Blob copy(blob);
+        copy.prune_user_keys();
+        benchmark::DoNotOptimize(copy.finalize());
+    }
+}
+
+BENCHMARK(Leb128DecodeBench)->Arg(8)->Arg(0x1234)->Arg(0xcafef00d);
+BENCHMARK(DocKeyCollectionIDBench)->Arg(8)->Arg(0x1234)->Arg(0xcafef00d);
+BENCHMARK(XattrBlobGetBench)->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK(XattrBlobPruneBench)->Arg(4)->Arg(16)->Arg(64);
 BENCHMARK_MAIN()
@@ -0,0 +1,91 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <daemon/mcbp_frame_batch.h>
+#include <folly/portability/GTest.h>
+#include <mcbp/protocol/framebuilder.h>
+
+#include <vector>
+
+class FrameBatchTest : public ::testing::Test {
+protected:
+    /// Append a GET request for key to the input
+    void addGet(const std::string& key) {
+        std::vector<uint8_t> frame(sizeof(cb::mcbp::Request) + key.size());
+        cb::mcbp::RequestBuilder builder({frame.data(), frame.size()});
+        builder.setMagic(cb::mcbp::Magic::ClientRequest);
+        builder.setOpcode(cb::mcbp::ClientOpcode::Get);
+        builder.setKey(key);
+        input.insert(input.end(), frame.begin(), frame.end());
+    }
+
+    cb::const_byte_buffer getInput(size_t offset = 0) const {
+        return {input.data() + offset, input.size() - offset};
+    }
+
+    std::vector<uint8_t> input;
+    FrameBatch frames;
+};
+
+TEST_F(FrameBatchTest, CompleteFrames) {
+    addGet("key1");
+    addGet("key22");
+    EXPECT_EQ(2, frames.scan(getInput(), 1024));
+
+    auto frame = frames.next(getInput());
+    EXPECT_EQ(sizeof(cb::mcbp::Request) + 4, frame.size());
+    frame = frames.next(getInput(frame.size()));
+    EXPECT_EQ(sizeof(cb::mcbp::Request) + 5, frame.size());
+    EXPECT_TRUE(frames.empty());
+}
+
+// A trailing partial frame is left for the per-packet path
+TEST_F(FrameBatchTest, PartialFrame) {
+    addGet("key1");
+    addGet("key2");
+    input.resize(input.size() - 1);
+    EXPECT_EQ(1, frames.scan(getInput(), 1024));
+
+    input.resize(sizeof(cb::mcbp::Request) - 1);
+    EXPECT_EQ(0, frames.scan(getInput(), 1024));
+}
+
+// Scanning stops at an invalid or oversized frame
+TEST_F(FrameBatchTest, InvalidFrame) {
+    addGet("key1");
+    addGet("key2");
+    input[sizeof(cb::mcbp::Request) + 4] = 0xff; // magic of the 2nd frame
+    EXPECT_EQ(1, frames.scan(getInput(), 1024));
+    EXPECT_EQ(0, frames.scan(getInput(), 3));
+}
+
+TEST_F(FrameBatchTest, MaxFrames) {
+    for (size_t ii = 0; ii < FrameBatch::MaxFrames + 1; ++ii) {
+        addGet("key");
+    }
+    EXPECT_EQ(FrameBatch::MaxFrames, frames.scan(getInput(), 1024));
+}
+
+// The batch is discarded if the input no longer starts with the next frame
+TEST_F(FrameBatchTest, InputChanged) {
+    addGet("key1");
+    addGet("key2");
+    EXPECT_EQ(2, frames.scan(getInput(), 1024));
+    input.clear();
+    EXPECT_TRUE(frames.next(getInput()).empty());
+    EXPECT_TRUE(frames.empty());
+}
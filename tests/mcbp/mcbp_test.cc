@@ -3253,6 +3253,18 @@ TEST_P(GetRandomKeyValidatorTest, InvalidExtlen) {
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
 }
 
+TEST_P(GetRandomKeyValidatorTest, SampleExtras) {
+    req.setExtlen(4);
+    req.setBodylen(4);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+    req.setExtlen(8);
+    req.setBodylen(8);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+    req.setExtlen(12);
+    req.setBodylen(12);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
 TEST_P(GetRandomKeyValidatorTest, InvalidDatatype) {
     req.setDatatype(cb::mcbp::Datatype::JSON);
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
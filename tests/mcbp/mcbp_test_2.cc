@@ -548,6 +548,13 @@ TEST_P(GetReplicaValidatorTest, InvalidMagic) {
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
 }
 
+TEST_P(GetReplicaValidatorTest, MaxStaleness) {
+    // The extras may contain the max staleness
+    req.setExtlen(4);
+    req.setBodylen(6);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
 TEST_P(GetReplicaValidatorTest, InvalidExtlen) {
     req.setExtlen(2);
     req.setBodylen(6);
@@ -659,6 +666,326 @@ TEST_P(ReturnMetaValidatorTest, Bodylen) {
     EXPECT_EQ(cb::mcbp::Status::Success, validate());
 }
 
+class GetMultiValidatorTest : public ::testing::WithParamInterface<bool>,
+                              public ValidatorTest {
+public:
+    GetMultiValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        // Keys in the default collection (leb128 encoded collection-id of
+        // 0), so they're valid with and without collections enabled.
+        addKey(Vbid(0), {"\0key1", 5});
+        addKey(Vbid(1), {"\0key2", 5});
+    }
+
+protected:
+    void addKey(Vbid vbid, cb::const_char_buffer key) {
+        const uint16_t vb = htons(vbid.get());
+        const uint16_t keylen = htons(uint16_t(key.size()));
+        value.append(reinterpret_cast<const char*>(&vb), sizeof(vb));
+        value.append(reinterpret_cast<const char*>(&keylen), sizeof(keylen));
+        value.append(key.data(), key.size());
+        memcpy(blob + sizeof(cb::mcbp::Request),
+               value.data(),
+               value.size());
+        req.setBodylen(gsl::narrow<uint32_t>(value.size()));
+    }
+
+    cb::mcbp::Request& req;
+    std::string value;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(cb::mcbp::ClientOpcode::GetMulti,
+                                       static_cast<void*>(&request));
+    }
+};
+
+TEST_P(GetMultiValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(GetMultiValidatorTest, InvalidMagic) {
+    blob[0] = 0;
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, InvalidExtlen) {
+    req.setExtlen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, InvalidKey) {
+    // The keys live in the value; the key field must be empty
+    req.setKeylen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, InvalidDatatype) {
+    req.setDatatype(cb::mcbp::Datatype::JSON);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, InvalidCas) {
+    req.setCas(0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, NoKeys) {
+    req.setBodylen(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, TruncatedEntry) {
+    // Cut off the last byte of the last key
+    req.setBodylen(req.getBodylen() - 1);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+    // Only part of the vbucket / key length of an entry
+    req.setBodylen(req.getBodylen() - 6);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, EmptyKeyInEntry) {
+    addKey(Vbid(2), {});
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, InvalidCollectionKeyInEntry) {
+    // A single byte key is only valid without collections
+    addKey(Vbid(2), {"a", 1});
+    if (GetParam()) {
+        EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+    } else {
+        EXPECT_EQ(cb::mcbp::Status::Success, validate());
+    }
+}
+
+class ArithmeticMultiValidatorTest
+    : public ::testing::WithParamInterface<bool>,
+      public ValidatorTest {
+public:
+    ArithmeticMultiValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        // Keys in the default collection (leb128 encoded collection-id of
+        // 0), so they're valid with and without collections enabled.
+        addEntry(Vbid(0), cb::mcbp::ClientOpcode::Increment, {"\0key1", 5});
+        addEntry(Vbid(1), cb::mcbp::ClientOpcode::Decrement, {"\0key2", 5});
+    }
+
+protected:
+    void addEntry(Vbid vbid,
+                  cb::mcbp::ClientOpcode opcode,
+                  cb::const_char_buffer key) {
+        const uint16_t vb = htons(vbid.get());
+        const uint16_t keylen = htons(uint16_t(key.size()));
+        cb::mcbp::request::ArithmeticPayload extras;
+        extras.setDelta(1);
+        value.append(reinterpret_cast<const char*>(&vb), sizeof(vb));
+        value.append(reinterpret_cast<const char*>(&keylen), sizeof(keylen));
+        value.push_back(char(opcode));
+        value.append(reinterpret_cast<const char*>(&extras), sizeof(extras));
+        value.append(key.data(), key.size());
+        memcpy(blob + sizeof(cb::mcbp::Request),
+               value.data(),
+               value.size());
+        req.setBodylen(gsl::narrow<uint32_t>(value.size()));
+    }
+
+    cb::mcbp::Request& req;
+    std::string value;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(
+                cb::mcbp::ClientOpcode::ArithmeticMulti,
+                static_cast<void*>(&request));
+    }
+};
+
+TEST_P(ArithmeticMultiValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(ArithmeticMultiValidatorTest, InvalidExtlen) {
+    req.setExtlen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(ArithmeticMultiValidatorTest, InvalidKey) {
+    // The keys live in the value; the key field must be empty
+    req.setKeylen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(ArithmeticMultiValidatorTest, InvalidCas) {
+    req.setCas(0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(ArithmeticMultiValidatorTest, NoEntries) {
+    req.setBodylen(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(ArithmeticMultiValidatorTest, TruncatedEntry) {
+    // Cut off the last byte of the last key
+    req.setBodylen(req.getBodylen() - 1);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+    // Only part of the payload of an entry
+    req.setBodylen(req.getBodylen() - 10);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(ArithmeticMultiValidatorTest, InvalidOpcodeInEntry) {
+    addEntry(Vbid(2), cb::mcbp::ClientOpcode::Set, {"\0key3", 5});
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(ArithmeticMultiValidatorTest, EmptyKeyInEntry) {
+    addEntry(Vbid(2), cb::mcbp::ClientOpcode::Increment, {});
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(ArithmeticMultiValidatorTest, InvalidCollectionKeyInEntry) {
+    // A single byte key is only valid without collections
+    addEntry(Vbid(2), cb::mcbp::ClientOpcode::Increment, {"a", 1});
+    if (GetParam()) {
+        EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+    } else {
+        EXPECT_EQ(cb::mcbp::Status::Success, validate());
+    }
+}
+
+class SetWithMetaMultiValidatorTest
+    : public ::testing::WithParamInterface<bool>,
+      public ValidatorTest {
+public:
+    SetWithMetaMultiValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        // Keys in the default collection (leb128 encoded collection-id of
+        // 0), so they're valid with and without collections enabled.
+        addEntry(Vbid(0), {"\0key1", 5}, "value1");
+        addEntry(Vbid(1), {"\0key2", 5}, "value2");
+    }
+
+protected:
+    void addEntry(Vbid vbid,
+                  cb::const_char_buffer key,
+                  cb::const_char_buffer docValue,
+                  uint8_t datatype = PROTOCOL_BINARY_RAW_BYTES) {
+        cb::mcbp::request::SetWithMetaMultiEntry entry;
+        entry.setVBucket(vbid);
+        entry.setKeylen(uint16_t(key.size()));
+        entry.setDatatype(datatype);
+        entry.setValuelen(uint32_t(docValue.size()));
+        entry.getMeta().setCas(0xdeadbeef);
+        entry.getMeta().setSeqno(1);
+        const auto header = entry.getBuffer();
+        value.append(reinterpret_cast<const char*>(header.data()),
+                     header.size());
+        value.append(key.data(), key.size());
+        value.append(docValue.data(), docValue.size());
+        encode();
+    }
+
+    void setOptions(uint32_t options) {
+        options = htonl(options);
+        extras.assign(reinterpret_cast<const char*>(&options),
+                      sizeof(options));
+        encode();
+    }
+
+    void encode() {
+        req.setExtlen(uint8_t(extras.size()));
+        memcpy(blob + sizeof(cb::mcbp::Request), extras.data(), extras.size());
+        memcpy(blob + sizeof(cb::mcbp::Request) + extras.size(),
+               value.data(),
+               value.size());
+        req.setBodylen(gsl::narrow<uint32_t>(extras.size() + value.size()));
+    }
+
+    cb::mcbp::Request& req;
+    std::string extras;
+    std::string value;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(
+                cb::mcbp::ClientOpcode::SetWithMetaMulti,
+                static_cast<void*>(&request));
+    }
+};
+
+TEST_P(SetWithMetaMultiValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, Options) {
+    setOptions(SKIP_CONFLICT_RESOLUTION_FLAG);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidExtlen) {
+    extras = "ab";
+    encode();
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidKey) {
+    // The keys live in the value; the key field must be empty
+    req.setKeylen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidCas) {
+    req.setCas(0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, NoEntries) {
+    req.setBodylen(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, TruncatedEntry) {
+    // Cut off the last byte of the last value
+    req.setBodylen(req.getBodylen() - 1);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+    // Only part of the header of an entry
+    req.setBodylen(req.getBodylen() - 20);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, EmptyKeyInEntry) {
+    addEntry(Vbid(2), {}, "value");
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidDatatypeInEntry) {
+    addEntry(Vbid(2), {"\0key3", 5}, "value", 0x80);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidCollectionKeyInEntry) {
+    // A single byte key is only valid without collections
+    addEntry(Vbid(2), {"a", 1}, "value");
+    if (GetParam()) {
+        EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+    } else {
+        EXPECT_EQ(cb::mcbp::Status::Success, validate());
+    }
+}
+
 class SeqnoPersistenceValidatorTest
     : public ::testing::WithParamInterface<bool>,
       public ValidatorTest {
@@ -1017,6 +1344,19 @@ INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
                         ::testing::Bool(),
                         ::testing::PrintToStringParamName());
 
+INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
+                        GetMultiValidatorTest,
+                        ::testing::Bool(),
+                        ::testing::PrintToStringParamName());
+INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
+                        ArithmeticMultiValidatorTest,
+                        ::testing::Bool(),
+                        ::testing::PrintToStringParamName());
+INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
+                        SetWithMetaMultiValidatorTest,
+                        ::testing::Bool(),
+                        ::testing::PrintToStringParamName());
+
 INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
                         SeqnoPersistenceValidatorTest,
                         ::testing::Bool(),
@@ -22,6 +22,8 @@
 
 #include "utilities/string_utilities.h"
 
+#include <map>
+
 void validate(cb::char_buffer buffer) {
     EXPECT_TRUE(cb::xattr::validate(
             {static_cast<const char*>(buffer.data()), buffer.size()}));
@@ -125,6 +127,63 @@ TEST(XattrBlob, TestPruneUser) {
     EXPECT_EQ(std::string{"{\"foo\":\"bar\"}"}, to_string(blob.get("_rbac")));
 }
 
+/**
+ * Verify that lookups return the correct values as the blob is modified
+ * (the location of the kv-pairs is indexed by the first lookup and must be
+ * kept in sync with the modifications)
+ */
+TEST(XattrBlob, IndexFollowsModifications) {
+    cb::xattr::Blob blob;
+    std::map<std::string, std::string> expected;
+    for (int ii = 0; ii < 20; ++ii) {
+        const auto key = (ii % 3 ? "user" : "_sys") + std::to_string(ii);
+        expected[key] = std::to_string(ii);
+        blob.set(key, expected[key]);
+    }
+
+    auto verify = [&blob, &expected]() {
+        validate(blob.finalize());
+        for (const auto& entry : expected) {
+            EXPECT_EQ(entry.second, to_string(blob.get(entry.first)))
+                    << "Key: " << entry.first;
+        }
+        EXPECT_EQ(expected.size(), blob.getIndex().size());
+    };
+    verify();
+
+    // Grow, shrink, replace in place and remove values in the middle
+    expected["user1"] = "a much longer value than before";
+    blob.set("user1", expected["user1"]);
+    expected["_sys3"] = "3";
+    blob.set("_sys3", expected["_sys3"]);
+    expected["user10"] = "xy";
+    blob.set("user10", expected["user10"]);
+    expected.erase("user5");
+    blob.remove("user5");
+    expected["user20"] = "appended";
+    blob.set("user20", expected["user20"]);
+    verify();
+
+    // A copy of the blob must work on its own buffer
+    cb::xattr::Blob copy(blob);
+    copy.set("user2", "changed");
+    verify();
+    EXPECT_EQ("changed", to_string(copy.get("user2")));
+
+    // Prune off the user xattrs
+    blob.prune_user_keys();
+    for (auto iter = expected.begin(); iter != expected.end();) {
+        if (iter->first.front() != '_') {
+            iter = expected.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    verify();
+    EXPECT_EQ(0, blob.get("user1").len);
+    EXPECT_EQ(blob.finalize().len, blob.get_system_size());
+}
+
 TEST(XattrBlob, TestToJson) {
     cb::xattr::Blob blob;
     blob.set("_sync",
@@ -200,6 +200,72 @@ TEST_P(ClusterConfigTest, CccpPushNotification) {
     EXPECT_EQ(R"({"rev":666})", config);
 }
 
+TEST_P(ClusterConfigTest, CccpPushNotificationDelta) {
+    auto& conn = getAdminConnection();
+    conn.selectBucket("default");
+
+    auto second = conn.clone();
+    second->setDuplexSupport(true);
+    second->setClustermapChangeNotification(true);
+    second->setFeature(cb::mcbp::Feature::ClustermapChangeNotificationDelta,
+                       true);
+
+    nlohmann::json clustermap = {
+            {"rev", 1000},
+            {"vBucketServerMap",
+             {{"serverList", {"a:11210", "b:11210"}},
+              {"vBucketMap", {{0, 1}, {1, 0}, {0, 1}}}}}};
+
+    // Receive the next push and return the extras and the value
+    auto receive = [&second]() {
+        Frame frame;
+        second->recvFrame(frame);
+        EXPECT_EQ(cb::mcbp::Magic::ServerRequest, frame.getMagic());
+        auto* request = frame.getRequest();
+        EXPECT_EQ(cb::mcbp::ServerOpcode::ClustermapChangeNotification,
+                  request->getServerOpcode());
+        std::vector<uint32_t> extras;
+        auto ext = request->getExtdata();
+        for (size_t ii = 0; ii + sizeof(uint32_t) <= ext.size();
+             ii += sizeof(uint32_t)) {
+            uint32_t value;
+            std::copy_n(ext.begin() + ii,
+                        sizeof(value),
+                        reinterpret_cast<uint8_t*>(&value));
+            extras.push_back(ntohl(value));
+        }
+        auto value = request->getValue();
+        return std::make_pair(
+                extras,
+                nlohmann::json::parse(value.begin(), value.end()));
+    };
+
+    // The client don't know about any revision so it should get the full
+    // map
+    ASSERT_TRUE(setClusterConfig(token, clustermap.dump()).isSuccess());
+    auto push = receive();
+    EXPECT_EQ(std::vector<uint32_t>{1000}, push.first);
+    EXPECT_EQ(clustermap, push.second);
+
+    // Only the vBucket map changed so it should get a delta
+    clustermap["rev"] = 1001;
+    clustermap["vBucketServerMap"]["vBucketMap"][1] = {1, 1};
+    ASSERT_TRUE(setClusterConfig(token, clustermap.dump()).isSuccess());
+    push = receive();
+    EXPECT_EQ((std::vector<uint32_t>{1001, 1000}), push.first);
+    EXPECT_EQ(1001, push.second["rev"].get<int>());
+    EXPECT_EQ(1000, push.second["baseRev"].get<int>());
+    EXPECT_EQ((nlohmann::json{{"1", {1, 1}}}), push.second["vBucketMap"]);
+
+    // The server list changed so it should get the full map
+    clustermap["rev"] = 1002;
+    clustermap["vBucketServerMap"]["serverList"].push_back("c:11210");
+    ASSERT_TRUE(setClusterConfig(token, clustermap.dump()).isSuccess());
+    push = receive();
+    EXPECT_EQ(std::vector<uint32_t>{1002}, push.first);
+    EXPECT_EQ(clustermap, push.second);
+}
+
 TEST_P(ClusterConfigTest, SetGlobalClusterConfig) {
     // Set one for the default bucket
     setClusterConfig(token, R"({"rev":1000})");
@@ -142,6 +142,7 @@ public:
         case cb::mcbp::ClientOpcode::DisableTraffic:
         case cb::mcbp::ClientOpcode::GetFailoverLog:
         case cb::mcbp::ClientOpcode::GetRandomKey:
+        case cb::mcbp::ClientOpcode::GetReplica:
             return false;
         default:
             return true;
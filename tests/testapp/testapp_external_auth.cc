@@ -60,6 +60,8 @@ protected:
         TestappTest::SetUp();
         memcached_cfg["external_auth_service"] = true;
         memcached_cfg["active_external_users_push_interval"] = "100 ms";
+        // Every authentication should reach the provider
+        memcached_cfg["external_auth_cache_ttl"] = 0;
         reconfigure();
 
         auto& conn = getConnection();
@@ -256,6 +258,40 @@ TEST_P(ExternalAuthTest, TestExternalAuthNoRbacUser) {
     }
 }
 
+TEST_P(ExternalAuthTest, TestExternalAuthCache) {
+    // The RBAC entry must be fresh (within 2x the push interval) for the
+    // cached authentication to be used
+    memcached_cfg["active_external_users_push_interval"] = "1 m";
+    memcached_cfg["external_auth_cache_ttl"] = "1 m";
+    reconfigure();
+
+    auto osbourne1 = loginOsbourne();
+    ASSERT_TRUE(osbourne1);
+
+    // The provider isn't involved in the next successful authentication
+    auto osbourne2 = getConnection().clone();
+    BinprotSaslAuthCommand saslAuthCommand;
+    saslAuthCommand.setChallenge({"\0osbourne\0password", 18});
+    saslAuthCommand.setMechanism("PLAIN");
+    osbourne2->sendCommand(saslAuthCommand);
+    BinprotResponse response;
+    osbourne2->recvResponse(response);
+    EXPECT_TRUE(response.isSuccess());
+
+    // but a different password isn't served from the cache
+    auto& conn = getConnection();
+    saslAuthCommand.setChallenge({"\0osbourne\0bubba", 15});
+    conn.sendCommand(saslAuthCommand);
+    stepAuthProvider();
+    conn.recvResponse(response);
+    EXPECT_EQ(cb::mcbp::Status::AuthError, response.getStatus());
+
+    auto stats = getAdminConnection().stats("external_auth");
+    EXPECT_EQ(1, stats["cache_hits"].get<int>());
+    EXPECT_EQ(2, stats["requests"].get<int>());
+    EXPECT_EQ(0, stats["outstanding"].get<int>());
+}
+
 TEST_P(ExternalAuthTest, TestExternalAuthServiceDying) {
     auto& conn = getConnection();
 
@@ -706,6 +706,37 @@ TEST_P(GetSetTest, TestPrependRawToJson) {
     EXPECT_EQ("[1]", stored.value);
 }
 
+// Check that APPEND / PREPEND of anything but whitespace to a JSON object
+// clears the JSON datatype (the server doesn't validate those results)
+TEST_P(GetSetTest, TestAppendPrependToJsonObject) {
+    MemcachedConnection& conn = getConnection();
+    document.info.datatype = cb::mcbp::Datatype::Raw;
+    document.value = R"({"a":1})";
+    conn.mutate(document, Vbid(0), MutationType::Set);
+    auto stored = conn.get(name, Vbid(0));
+    EXPECT_EQ(expectedJSONDatatype(), stored.info.datatype);
+
+    // Whitespace keeps it JSON
+    document.value = "\n";
+    conn.mutate(document, Vbid(0), MutationType::Append);
+    stored = conn.get(name, Vbid(0));
+    EXPECT_EQ(expectedJSONDatatype(), stored.info.datatype);
+    conn.mutate(document, Vbid(0), MutationType::Prepend);
+    stored = conn.get(name, Vbid(0));
+    EXPECT_EQ(expectedJSONDatatype(), stored.info.datatype);
+
+    document.value = R"({"b":2})";
+    conn.mutate(document, Vbid(0), MutationType::Append);
+    stored = conn.get(name, Vbid(0));
+    EXPECT_EQ(cb::mcbp::Datatype::Raw, stored.info.datatype);
+    EXPECT_EQ("\n{\"a\":1}\n{\"b\":2}", stored.value);
+
+    conn.mutate(document, Vbid(0), MutationType::Set);
+    conn.mutate(document, Vbid(0), MutationType::Prepend);
+    stored = conn.get(name, Vbid(0));
+    EXPECT_EQ(cb::mcbp::Datatype::Raw, stored.info.datatype);
+}
+
 TEST_P(GetSetTest, TestAppendWithXattr) {
     // The current code does not preserve XATTRs
     document.info.datatype = cb::mcbp::Datatype::Raw;
@@ -1002,6 +1033,36 @@ TEST_P(GetSetSnappyOnOffTest, TestInvalidCompressedData) {
     }
 }
 
+// Repeated reads of a compressed document by a client which didn't enable
+// Snappy should be served from the front end thread's inflated value cache
+TEST_P(GetSetTest, TestInflatedValueCache) {
+    MemcachedConnection& conn = getConnection();
+    // The document is compressed, and the bucket is in passive mode
+    conn.mutate(document, Vbid(0), MutationType::Set);
+    const auto expected = conn.get(name, Vbid(0));
+
+    auto getHits = [this]() {
+        uint64_t hits = 0;
+        const auto stats = getAdminConnection().stats(
+                "worker_thread_info inflated_values");
+        for (const auto& thread : stats) {
+            hits += thread["hits"].get<uint64_t>();
+        }
+        return hits;
+    };
+    const auto hits = getHits();
+
+    conn.setFeature(cb::mcbp::Feature::SNAPPY, false);
+    for (int ii = 0; ii < 2; ++ii) {
+        const auto doc = conn.get(name, Vbid(0));
+        EXPECT_EQ(expectedJSONDatatype(), doc.info.datatype);
+        EXPECT_EQ(expected.info.cas, doc.info.cas);
+    }
+    conn.setFeature(cb::mcbp::Feature::SNAPPY, true);
+
+    EXPECT_LE(hits + 1, getHits());
+}
+
 // Test appending uncompressed data to an compresssed existing value
 TEST_P(GetSetTest, TestAppendCompressedSource) {
     doTestAppend(/*compressedSource*/ true, /*compressedData*/ false);
@@ -1226,4 +1287,65 @@ TEST_P(GetSetTest, TestGetRandomKey) {
 
 TEST_P(GetSetTest, TestGetRandomKeyCollections) {
     doTestGetRandomKey(true);
-}
\ No newline at end of file
+}
+/// Large values are sent straight from the item (not copied into the
+/// send buffer); verify that the value is transmitted intact (and with the
+/// key for GETK)
+TEST_P(GetSetTest, TestGetLargeValue) {
+    MemcachedConnection& conn = getConnection();
+    document.info.datatype = cb::mcbp::Datatype::Raw;
+    document.value.resize(512 * 1024);
+    for (size_t ii = 0; ii < document.value.size(); ++ii) {
+        document.value[ii] = char('a' + (ii % 26));
+    }
+    const auto info = conn.mutate(document, Vbid(0), MutationType::Set);
+
+    const auto stored = conn.get(name, Vbid(0));
+    EXPECT_EQ(info.cas, stored.info.cas);
+    EXPECT_EQ(document.value, stored.value);
+
+    BinprotGenericCommand cmd(cb::mcbp::ClientOpcode::Getk, name);
+    const auto rsp = conn.execute(cmd);
+    ASSERT_EQ(cb::mcbp::Status::Success, rsp.getStatus());
+    EXPECT_EQ(name, rsp.getKeyString());
+    EXPECT_EQ(info.cas, rsp.getCas());
+    EXPECT_EQ(document.value, rsp.getDataString());
+}
+
+TEST_P(GetSetTest, TestGetReplica) {
+    MemcachedConnection& conn = getConnection();
+    BinprotGenericCommand cmd(cb::mcbp::ClientOpcode::GetReplica, name);
+    if (!GetTestBucket().supportsOp(cb::mcbp::ClientOpcode::GetReplica)) {
+        EXPECT_EQ(cb::mcbp::Status::NotSupported,
+                  conn.execute(cmd).getStatus());
+        return;
+    }
+
+    document.info.datatype = cb::mcbp::Datatype::Raw;
+    document.value.assign(256 * 1024, 'r');
+    const auto info = conn.mutate(document, Vbid(0), MutationType::Set);
+
+    // The vbucket is active so the document can't be read as a replica
+    EXPECT_EQ(cb::mcbp::Status::NotMyVbucket, conn.execute(cmd).getStatus());
+
+    auto& admin = getAdminConnection();
+    admin.selectBucket("default");
+    admin.setVbucket(Vbid(0), vbucket_state_replica, {});
+
+    const auto rsp = conn.execute(cmd);
+    BinprotGetCommand getCmd;
+    getCmd.setKey(name);
+    const auto get = conn.execute(getCmd);
+
+    // Restore the vbucket before checking the responses
+    nlohmann::json meta;
+    meta["topology"] = nlohmann::json::array({{"active"}});
+    admin.setDatatypeJson(true);
+    admin.setVbucket(Vbid(0), vbucket_state_active, meta);
+    admin.setDatatypeJson(false);
+
+    ASSERT_EQ(cb::mcbp::Status::Success, rsp.getStatus());
+    EXPECT_EQ(info.cas, rsp.getCas());
+    EXPECT_EQ(document.value, rsp.getDataString());
+    EXPECT_EQ(cb::mcbp::Status::NotMyVbucket, get.getStatus());
+}
@@ -18,6 +18,7 @@
 #include "testapp_client_test.h"
 #include <protocol/mcbp/ewb_encode.h>
 #include <gsl/gsl>
+#include <algorithm>
 
 class StatsTest : public TestappClientTest {
 public:
@@ -53,6 +54,82 @@ TEST_P(StatsTest, TestDefaultStats) {
     EXPECT_NE(stats.end(), stats.find("uptime"));
 }
 
+TEST_P(StatsTest, TestSyscallStats) {
+    MemcachedConnection& conn = getConnection();
+    auto stats = conn.stats("");
+
+    // We've had to both read and write on the socket to get here
+    EXPECT_LT(0, stats["recv_syscalls"].get<uint64_t>());
+    EXPECT_LT(0, stats["send_syscalls"].get<uint64_t>());
+    EXPECT_NE(stats.end(), stats.find("syscalls_per_op"));
+}
+
+// The responses to a batch of pipelined commands are sent together, and in
+// order
+TEST_P(StatsTest, TestResponseCorking) {
+    MemcachedConnection& conn = getConnection();
+    const auto before = conn.stats("")["responses_corked"].get<uint64_t>();
+
+    Frame frame;
+    for (uint32_t ii = 0; ii < 10; ++ii) {
+        BinprotGenericCommand noop(cb::mcbp::ClientOpcode::Noop);
+        noop.setOpaque(ii);
+        std::vector<uint8_t> buf;
+        noop.encode(buf);
+        std::copy(buf.begin(), buf.end(), std::back_inserter(frame.payload));
+    }
+    conn.sendFrame(frame);
+
+    for (uint32_t ii = 0; ii < 10; ++ii) {
+        BinprotResponse rsp;
+        conn.recvResponse(rsp);
+        EXPECT_TRUE(rsp.isSuccess());
+        EXPECT_EQ(ii, rsp.getResponse().getOpaque());
+    }
+
+    // Connections using userspace TLS send each response on its own
+    if (!conn.isSsl()) {
+        EXPECT_LT(before,
+                  conn.stats("")["responses_corked"].get<uint64_t>());
+    }
+}
+
+TEST_P(StatsTest, TestFrontEndCpuTime) {
+    MemcachedConnection& conn = getConnection();
+    auto before = conn.stats("");
+    ASSERT_NE(before.end(), before.find("front_end_cpu_time_ns"));
+    for (int ii = 0; ii < 10; ++ii) {
+        conn.store(name, Vbid(0), "value");
+    }
+    auto after = conn.stats("");
+    EXPECT_LE(before["front_end_cpu_time_ns"].get<uint64_t>(),
+              after["front_end_cpu_time_ns"].get<uint64_t>());
+}
+
+// The command contexts of repeated GETs should reuse pooled memory rather
+// than be allocated from the heap
+TEST_P(StatsTest, TestCommandContextPool) {
+    MemcachedConnection& conn = getConnection();
+    conn.store(name, Vbid(0), "value");
+    conn.get(name, Vbid(0));
+
+    auto before = conn.stats("");
+    for (int ii = 0; ii < 10; ++ii) {
+        conn.get(name, Vbid(0));
+    }
+    auto after = conn.stats("");
+    EXPECT_LE(before["cmd_context_pool_reuses"].get<uint64_t>() + 10,
+              after["cmd_context_pool_reuses"].get<uint64_t>());
+    EXPECT_NE(after.end(), after.find("cmd_context_heap_allocs"));
+}
+
+TEST_P(StatsTest, TestNotificationStats) {
+    MemcachedConnection& conn = getConnection();
+    auto stats = conn.stats("");
+    EXPECT_NE(stats.end(), stats.find("thread_notifications"));
+    EXPECT_NE(stats.end(), stats.find("thread_wakeups"));
+}
+
 TEST_P(StatsTest, TestGetMeta) {
     MemcachedConnection& conn = getConnection();
 
@@ -297,7 +374,7 @@ TEST_P(StatsTest, TestAudit) {
     conn.authenticate("@admin", "password", "PLAIN");
 
     auto stats = conn.stats("audit");
-    EXPECT_EQ(2, stats.size());
+    EXPECT_EQ(5, stats.size());
     EXPECT_EQ(false, stats["enabled"].get<bool>());
     EXPECT_EQ(0, stats["dropped_events"].get<size_t>());
 
@@ -357,6 +434,51 @@ TEST_P(StatsTest, TestSchedulerInfo_Aggregate) {
     EXPECT_NE(stats.end(), stats.find("aggregate"));
 }
 
+TEST_P(StatsTest, TestSchedulerInfo_Fairness) {
+    auto stats = getConnection().stats("worker_thread_info fairness");
+    // We should at least have an entry for the first thread
+    ASSERT_NE(stats.end(), stats.find("0"));
+    EXPECT_NE(stats["0"].end(), stats["0"].find("budget_yields"));
+}
+
+TEST_P(StatsTest, TestSchedulerInfo_Load) {
+    auto stats = getConnection().stats("worker_thread_info load");
+    ASSERT_NE(stats.end(), stats.find("0"));
+    ASSERT_NE(stats.end(), stats.find("imbalance"));
+
+    // The connection running the stats command was placed on (and is bound
+    // to) one of the threads
+    uint64_t connections = 0;
+    uint64_t placed = 0;
+    for (auto it = stats.begin(); it != stats.end(); ++it) {
+        if (it.key() == "imbalance") {
+            EXPECT_LE(1.0, it.value()["connections"].get<double>());
+            continue;
+        }
+        connections += it.value()["connections"].get<uint64_t>();
+        placed += it.value()["placed"].get<uint64_t>();
+    }
+    EXPECT_LE(1, connections);
+    EXPECT_LE(connections, placed);
+}
+
+TEST_P(StatsTest, TestSchedulerInfo_Buffers) {
+    auto stats = getConnection().stats("worker_thread_info buffers");
+    ASSERT_NE(stats.end(), stats.find("0"));
+
+    // The connection running the stats command holds a read and a write
+    // buffer from its thread's pool
+    uint64_t highWatermark = 0;
+    for (const auto& thread : stats) {
+        ASSERT_NE(thread.end(), thread.find("read"));
+        ASSERT_NE(thread.end(), thread.find("write"));
+        highWatermark = std::max(
+                highWatermark,
+                thread["read"]["in_use_high_watermark"].get<uint64_t>());
+    }
+    EXPECT_LE(1, highWatermark);
+}
+
 TEST_P(StatsTest, TestSchedulerInfo_InvalidSubcommand) {
     try {
         getConnection().stats("worker_thread_info foo");
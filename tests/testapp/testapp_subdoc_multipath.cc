@@ -169,6 +169,38 @@ TEST_P(SubdocTestappTest, SubdocMultiLookup_ExistsMulti) {
     delete_object("dict");
 }
 
+// Test multi-path lookup - lookups sharing a leading path (which are served
+// from the value of that path) return the same results and errors as when
+// looked up individually.
+TEST_P(SubdocTestappTest, SubdocMultiLookup_SharedPrefix) {
+    store_document("dict",
+                   R"({"a":{"b":{"c":1,"d":[10,20]},"e":"x"},"f":[{"g":2}]})");
+
+    const std::vector<std::pair<std::string, SubdocMultiLookupResult>> paths{
+            {"a.b.c", {cb::mcbp::Status::Success, "1"}},
+            {"a.b.d[1]", {cb::mcbp::Status::Success, "20"}},
+            {"a.b.d", {cb::mcbp::Status::Success, "[10,20]"}},
+            {"a.b.zz", {cb::mcbp::Status::SubdocPathEnoent, ""}},
+            {"a.b[0]", {cb::mcbp::Status::SubdocPathMismatch, ""}},
+            {"a.e.h", {cb::mcbp::Status::SubdocPathMismatch, ""}},
+            {"f[0].g", {cb::mcbp::Status::Success, "2"}},
+            {"f[1].g", {cb::mcbp::Status::SubdocPathEnoent, ""}},
+            {"f.g", {cb::mcbp::Status::SubdocPathMismatch, ""}}};
+
+    SubdocMultiLookupCmd lookup;
+    lookup.key = "dict";
+    std::vector<SubdocMultiLookupResult> expected;
+    for (const auto& path : paths) {
+        lookup.specs.push_back(
+                {cb::mcbp::ClientOpcode::SubdocGet, SUBDOC_FLAG_NONE, path.first});
+        expected.push_back(path.second);
+    }
+    expect_subdoc_cmd(
+            lookup, cb::mcbp::Status::SubdocMultiPathFailure, expected);
+
+    delete_object("dict");
+}
+
 /******************* Multi-path mutation tests *******************************/
 
 // Test multi-path mutation command - simple single SUBDOC_DICT_ADD
@@ -71,6 +71,39 @@ protected:
         }
     }
 
+    /// The client side of a TLS session
+    using Session = std::unique_ptr<SSL_SESSION, decltype(&SSL_SESSION_free)>;
+
+    /**
+     * Perform a TLS v1.2 handshake with the server (and close the
+     * connection again)
+     *
+     * @param session the session to try to resume (may be null)
+     * @param reused set to true if the server resumed the session
+     * @return the session established by the handshake
+     */
+    Session handshake(const SSL_SESSION* session, bool& reused) {
+        std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)> ctx(
+                SSL_CTX_new(SSLv23_client_method()), SSL_CTX_free);
+        SSL_CTX_set_min_proto_version(ctx.get(), TLS1_2_VERSION);
+        SSL_CTX_set_max_proto_version(ctx.get(), TLS1_2_VERSION);
+
+        auto sock = cb::net::new_socket("", connection->getPort(), AF_INET);
+        EXPECT_NE(INVALID_SOCKET, sock);
+        std::unique_ptr<SSL, decltype(&SSL_free)> ssl(SSL_new(ctx.get()),
+                                                      SSL_free);
+        SSL_set_fd(ssl.get(), int(sock));
+        if (session) {
+            SSL_set_session(ssl.get(), const_cast<SSL_SESSION*>(session));
+        }
+        EXPECT_EQ(1, SSL_connect(ssl.get())) << "Failed to do SSL handshake";
+        reused = SSL_session_reused(ssl.get()) == 1;
+        Session ret(SSL_get1_session(ssl.get()), SSL_SESSION_free);
+        SSL_shutdown(ssl.get());
+        cb::net::closesocket(sock);
+        return ret;
+    }
+
     std::unique_ptr<MemcachedConnection> connection;
 };
 
@@ -166,3 +199,54 @@ TEST_P(TlsTests, ECDHE_RSA_AES256_GCM_SHA384) {
     reloadConfig();
     shouldPass("tlsv1_2");
 }
+
+/// Changing the TLS configuration replaces the SSL context used by new
+/// connections, while the connections already established keep using the
+/// context they were created with
+TEST_P(TlsTests, ReconfigureWithOpenConnections) {
+    memcached_cfg["ssl_cipher_list"]["tls 1.2"] =
+            "ECDHE-RSA-AES128-GCM-SHA256:ECDHE-RSA-AES256-GCM-SHA384";
+    memcached_cfg["ssl_cipher_list"]["tls 1.3"] = "";
+    reloadConfig();
+    connection->setTls12Ciphers("ECDHE-RSA-AES128-GCM-SHA256");
+    shouldPass("tlsv1_2");
+
+    memcached_cfg["ssl_cipher_list"]["tls 1.2"] = "ECDHE-RSA-AES256-GCM-SHA384";
+    reloadConfig();
+
+    // The open connection still works
+    for (int ii = 0; ii < 2; ++ii) {
+        const auto rsp = connection->execute(
+                BinprotGenericCommand(cb::mcbp::ClientOpcode::Noop));
+        ASSERT_TRUE(rsp.isSuccess());
+    }
+
+    // but new connections must use the new configuration
+    shouldFail("tlsv1_2");
+    connection->setTls12Ciphers("ECDHE-RSA-AES256-GCM-SHA384");
+    shouldPass("tlsv1_2");
+}
+
+/// A client may resume its session with the ticket it was given, also
+/// after the SSL context was rebuilt (the ticket keys are shared)
+TEST_P(TlsTests, ResumeSessionWithTicket) {
+    bool reused = true;
+    auto session = handshake(nullptr, reused);
+    ASSERT_TRUE(session);
+    EXPECT_FALSE(reused);
+    ASSERT_EQ(1, SSL_SESSION_has_ticket(session.get()));
+
+    auto resumed = handshake(session.get(), reused);
+    EXPECT_TRUE(reused);
+
+    // Rebuild the context (and with it the server side session cache)
+    memcached_cfg["ssl_cipher_list"]["tls 1.2"] = "HIGH:!aNULL";
+    reloadConfig();
+
+    resumed = handshake(session.get(), reused);
+    EXPECT_TRUE(reused);
+
+    // A client without a session performs a full handshake
+    resumed = handshake(nullptr, reused);
+    EXPECT_FALSE(reused);
+}
@@ -0,0 +1,248 @@
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks for the full memcached front-end request path: each operation
+ * is sent over a loopback connection to a (single node) memcached and the
+ * response read back, covering the Connection state machine, packet
+ * validation and execution, the engine interface and response building.
+ *
+ * "memcached_mcbp_bench" covers the command validators and
+ * "ep_engine_benchmarks" the engine internals in isolation; these numbers
+ * are for catching regressions in the complete path.
+ *
+ * Each benchmark is run against both an ep-engine bucket ("default") and a
+ * default_engine bucket ("memcache"), except for DCP which only ep-engine
+ * supports.
+ */
+
+#include "cluster.h"
+
+#include <benchmark/benchmark.h>
+#include <event2/thread.h>
+#include <platform/dirutils.h>
+#include <protocol/connection/client_connection.h>
+#include <protocol/connection/client_mcbp_commands.h>
+
+#include <array>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+std::unique_ptr<cb::test::Cluster> cluster;
+
+const std::array<std::string, 2> bucketNames = {{"default", "memcache"}};
+
+/**
+ * Get an authenticated connection to the bucket selected by the benchmark's
+ * first argument (an index into bucketNames).
+ */
+std::unique_ptr<MemcachedConnection> getConnection(benchmark::State& state) {
+    const auto& name = bucketNames.at(state.range(0));
+    state.SetLabel(name == "default" ? "ep" : "default_engine");
+    auto conn = cluster->getConnection(0);
+    conn->authenticate("@admin", "password", "PLAIN");
+    conn->selectBucket(name);
+    return conn;
+}
+
+/**
+ * Send the (pre-encoded) command and read its response, once per benchmark
+ * iteration. Any response other than Success fails the benchmark.
+ */
+void runRequest(benchmark::State& state,
+                MemcachedConnection& conn,
+                const BinprotCommand& command) {
+    Frame request;
+    command.encode(request.payload);
+    Frame response;
+
+    while (state.KeepRunning()) {
+        conn.sendFrame(request);
+        conn.recvFrame(response);
+        const auto status = response.getResponse()->getStatus();
+        if (status != cb::mcbp::Status::Success) {
+            state.SkipWithError(
+                    ("Request failed with status " + to_string(status))
+                            .c_str());
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+static void FrontEndGet(benchmark::State& state) {
+    auto conn = getConnection(state);
+    conn->store("get_key", Vbid(0), std::string(256, 'x'));
+
+    BinprotGenericCommand command(cb::mcbp::ClientOpcode::Get, "get_key");
+    runRequest(state, *conn, command);
+}
+
+static void FrontEndSet(benchmark::State& state) {
+    auto conn = getConnection(state);
+
+    BinprotMutationCommand command;
+    command.setMutationType(MutationType::Set);
+    command.setKey("set_key");
+    command.setValue(std::vector<uint8_t>(256, 'x'));
+    runRequest(state, *conn, command);
+}
+
+static void FrontEndSubdocGet(benchmark::State& state) {
+    auto conn = getConnection(state);
+    conn->store("subdoc_key",
+                Vbid(0),
+                R"({"name":"benchmark","nested":{"array":[1,2,3],"value":42}})",
+                cb::mcbp::Datatype::JSON);
+
+    BinprotSubdocCommand command(
+            cb::mcbp::ClientOpcode::SubdocGet, "subdoc_key", "nested.value");
+    runRequest(state, *conn, command);
+}
+
+/**
+ * Stream a vbucket of state.range(1) items over a DCP producer connection;
+ * each iteration is one complete stream (from a new stream request up to the
+ * stream end), and the items processed are the mutations received.
+ */
+static void FrontEndDcpStream(benchmark::State& state) {
+    auto conn = getConnection(state);
+    conn->setMutationSeqnoSupport(true);
+    const auto numItems = state.range(1);
+    uint64_t endSeqno = 0;
+    for (int64_t ii = 0; ii < numItems; ++ii) {
+        endSeqno = conn->store("dcp_key_" + std::to_string(ii),
+                               Vbid(0),
+                               std::string(256, 'x'))
+                           .seqno;
+    }
+
+    auto producer = getConnection(state);
+    BinprotDcpOpenCommand open("frontend_bench");
+    open.makeProducer();
+    if (!producer->execute(open).isSuccess()) {
+        state.SkipWithError("Failed to open the DCP producer");
+        return;
+    }
+
+    BinprotDcpStreamRequestCommand streamRequest;
+    streamRequest.setDcpEndSeqno(endSeqno);
+    streamRequest.setVBucket(Vbid(0));
+
+    Frame frame;
+    size_t mutations = 0;
+    while (state.KeepRunning()) {
+        if (!producer->execute(streamRequest).isSuccess()) {
+            state.SkipWithError("DCP stream request failed");
+            break;
+        }
+
+        bool streamEnd = false;
+        while (!streamEnd) {
+            producer->recvFrame(frame);
+            switch (frame.getRequest()->getClientOpcode()) {
+            case cb::mcbp::ClientOpcode::DcpMutation:
+                ++mutations;
+                break;
+            case cb::mcbp::ClientOpcode::DcpStreamEnd:
+                streamEnd = true;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    state.SetItemsProcessed(mutations);
+}
+
+// Arguments: {bucket index (see bucketNames)}.
+BENCHMARK(FrontEndGet)->Arg(0)->Arg(1);
+BENCHMARK(FrontEndSet)->Arg(0)->Arg(1);
+BENCHMARK(FrontEndSubdocGet)->Arg(0)->Arg(1);
+// Arguments: {bucket index, number of items in the stream}.
+BENCHMARK(FrontEndDcpStream)->Args({0, 1000});
+
+char isasl_env_var[1024];
+int main(int argc, char** argv) {
+    cb_initialize_sockets();
+
+#if defined(EVTHREAD_USE_WINDOWS_THREADS_IMPLEMENTED)
+    const auto failed = evthread_use_windows_threads() == -1;
+#elif defined(EVTHREAD_USE_PTHREADS_IMPLEMENTED)
+    const auto failed = evthread_use_pthreads() == -1;
+#else
+#error "No locking mechanism for libevent available!"
+#endif
+
+    if (failed) {
+        std::cerr << "Failed to enable libevent locking. Terminating program"
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::string isasl_file_name = SOURCE_ROOT;
+    isasl_file_name.append("/tests/testapp/cbsaslpw.json");
+    cb::io::sanitizePath(isasl_file_name);
+
+    // Add the file to the exec environment
+    snprintf(isasl_env_var,
+             sizeof(isasl_env_var),
+             "CBSASL_PWFILE=%s",
+             isasl_file_name.c_str());
+    putenv(isasl_env_var);
+
+#ifndef WIN32
+    if (sigignore(SIGPIPE) == -1) {
+        std::cerr << "Fatal: failed to ignore SIGPIPE; sigaction" << std::endl;
+        return 1;
+    }
+#endif
+
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    try {
+        cluster = cb::test::Cluster::create(1);
+        if (!cluster) {
+            std::cerr << "Failed to create the cluster" << std::endl;
+            return 1;
+        }
+        if (!cluster->createBucket("default",
+                                   {{"replicas", 0}, {"max_vbuckets", 1}})) {
+            std::cerr << "Failed to create the ep-engine bucket" << std::endl;
+            return 1;
+        }
+        auto conn = cluster->getConnection(0);
+        conn->authenticate("@admin", "password", "PLAIN");
+        conn->createBucket("memcache", "", BucketType::Memcached);
+    } catch (const std::exception& error) {
+        std::cerr << "Failed to set up the cluster: " << error.what()
+                  << std::endl;
+        return 1;
+    }
+
+    ::benchmark::RunSpecifiedBenchmarks();
+    cluster.reset();
+    return 0;
+}
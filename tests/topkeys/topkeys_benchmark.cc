@@ -97,8 +97,71 @@ BENCHMARK_DEFINE_F(TopkeysBench, UpdateRandomKey)(benchmark::State& state) {
     }
 }
 
+/**
+ * Benchmark the code with a skewed workload where every other update is
+ * for one of a small set of hot keys (which keeps updating the hot keys
+ * list of the shards).
+ */
+BENCHMARK_DEFINE_F(TopkeysBench, UpdateSkewedKey)(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        Settings::instance().setTopkeysEnabled(true);
+    }
+
+    std::vector<std::string> mine;
+    std::copy(keys.begin(), keys.end(), std::back_inserter(mine));
+    std::random_shuffle(mine.begin(), mine.end());
+
+    size_t start = 0;
+    const auto size = keys.size();
+
+    while (state.KeepRunning()) {
+        const auto& element = (start & 1) ? keys[(start >> 1) % 20]
+                                          : mine[(start >> 1) % size];
+        ++start;
+        topkeys->updateKey(element.data(), element.size(), 10);
+        ::benchmark::ClobberMemory();
+    }
+}
+
+/**
+ * Benchmark updating "random" keys with sampling enabled (the time
+ * advances every 2^20 updates, so each thread runs at ~1M ops/s as far
+ * as the sampling is concerned)
+ */
+BENCHMARK_DEFINE_F(TopkeysBench, UpdateRandomKeySampled)
+(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        Settings::instance().setTopkeysEnabled(true);
+        Settings::instance().setTopkeysMaxSampleInterval(128);
+    }
+
+    std::vector<std::string> mine;
+    std::copy(keys.begin(), keys.end(), std::back_inserter(mine));
+    std::random_shuffle(mine.begin(), mine.end());
+
+    size_t start = 0;
+    const auto size = keys.size();
+
+    while (state.KeepRunning()) {
+        const auto& element = mine[start % size];
+        topkeys->updateKey(element.data(),
+                           element.size(),
+                           rel_time_t(10 + (start >> 20)));
+        ++start;
+        ::benchmark::ClobberMemory();
+    }
+
+    if (state.thread_index == 0) {
+        Settings::instance().setTopkeysMaxSampleInterval(1);
+    }
+}
+
 BENCHMARK_REGISTER_F(TopkeysBench, TopkeysDisabled)->Threads(8)->Threads(24);
 BENCHMARK_REGISTER_F(TopkeysBench, UpdateSameKey)->Threads(8)->Threads(24);
 BENCHMARK_REGISTER_F(TopkeysBench, UpdateRandomKey)->Threads(8)->Threads(24);
+BENCHMARK_REGISTER_F(TopkeysBench, UpdateSkewedKey)->Threads(8)->Threads(24);
+BENCHMARK_REGISTER_F(TopkeysBench, UpdateRandomKeySampled)
+        ->Threads(8)
+        ->Threads(24);
 
 BENCHMARK_MAIN()
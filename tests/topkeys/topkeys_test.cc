@@ -18,12 +18,14 @@
 #include "daemon/settings.h"
 #include "daemon/topkeys.h"
 #include <folly/portability/GTest.h>
+#include <nlohmann/json.hpp>
 #include <memory>
 
 class TopKeysTest : public ::testing::Test {
 protected:
     void SetUp() {
         Settings::instance().setTopkeysEnabled(true);
+        Settings::instance().setTopkeysMaxSampleInterval(1);
         topkeys.reset(new TopKeys(10));
     }
 
@@ -74,3 +76,77 @@ TEST_F(TopKeysTest, FewerThan80Keys) {
     testWithNKeys(5);
     testWithNKeys(20);
 }
+
+TEST_F(TopKeysTest, HotKeys) {
+    // A few keys accessed much more often than many others
+    for (int ii = 0; ii < 1000; ii++) {
+        for (int jj = 0; jj < 5; jj++) {
+            const auto key = "hot_" + std::to_string(jj);
+            topkeys->updateKey(key.c_str(), key.size(), ii);
+        }
+        const auto key = "cold_" + std::to_string(ii);
+        topkeys->updateKey(key.c_str(), key.size(), ii);
+    }
+
+    nlohmann::json json;
+    ASSERT_EQ(ENGINE_SUCCESS, topkeys->hot_keys_json_stats(json));
+    const auto& hotkeys = json["hotkeys"];
+    ASSERT_EQ(10, hotkeys.size());
+    for (int ii = 0; ii < 5; ii++) {
+        const auto key = hotkeys[ii]["key"].get<std::string>();
+        EXPECT_EQ(0, key.find("hot_")) << key;
+        // The sketch never underestimates (and we didn't decay)
+        EXPECT_LE(1000, hotkeys[ii]["count"].get<int>());
+    }
+}
+
+TEST_F(TopKeysTest, HotKeysDecay) {
+    const std::string old = "old";
+    for (int ii = 0; ii < 1000; ii++) {
+        topkeys->updateKey(old.c_str(), old.size(), ii);
+    }
+
+    // Run over a couple of decay intervals with a different key
+    const std::string current = "current";
+    for (size_t ii = 0; ii < TopKeys::DecayInterval * 2; ii++) {
+        topkeys->updateKey(current.c_str(), current.size(), 0);
+    }
+
+    nlohmann::json json;
+    ASSERT_EQ(ENGINE_SUCCESS, topkeys->hot_keys_json_stats(json));
+    const auto& hotkeys = json["hotkeys"];
+    ASSERT_EQ(2, hotkeys.size());
+    EXPECT_EQ(current, hotkeys[0]["key"].get<std::string>());
+    EXPECT_EQ(old, hotkeys[1]["key"].get<std::string>());
+    // The count of the old key has been halved (it's only exact if
+    // the thread stayed on the same core, and so the same shard)
+    EXPECT_GE(1000, hotkeys[1]["count"].get<int>());
+}
+
+TEST_F(TopKeysTest, HotKeysDisabled) {
+    Settings::instance().setTopkeysEnabled(false);
+    nlohmann::json json;
+    ASSERT_EQ(ENGINE_SUCCESS, topkeys->hot_keys_json_stats(json));
+    EXPECT_TRUE(json.empty());
+}
+
+TEST_F(TopKeysTest, Sampled) {
+    Settings::instance().setTopkeysMaxSampleInterval(16);
+    const std::string key = "sampled";
+
+    // Every access is tracked until the thread has seen a high access rate
+    for (int ii = 0; ii < 100000; ii++) {
+        topkeys->updateKey(key.c_str(), key.size(), 1000);
+    }
+    // .. and after that only 1 of 16 (but each counted 16 times)
+    for (int ii = 0; ii < 100000; ii++) {
+        topkeys->updateKey(key.c_str(), key.size(), 1001);
+    }
+
+    nlohmann::json json;
+    ASSERT_EQ(ENGINE_SUCCESS, topkeys->json_stats(json, 1001));
+    const auto& keys = json["topkeys"];
+    ASSERT_EQ(1, keys.size());
+    EXPECT_EQ(key, keys[0]["key"].get<std::string>());
+    EXPECT_NEAR(200000, keys[0]["access_count"].get<int>(), 16);
+}
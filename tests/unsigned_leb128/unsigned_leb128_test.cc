@@ -20,6 +20,7 @@
 
 #include <limits>
 #include <random>
+#include <vector>
 
 template <class T>
 class UnsignedLeb128 : public ::testing::Test {};
@@ -158,6 +159,33 @@ TYPED_TEST(UnsignedLeb128, DecodeInvalidInput) {
     }
 }
 
+// Values followed by enough data to be decoded a word at a time must decode
+// the same as values decoded byte by byte
+TYPED_TEST(UnsignedLeb128, DecodeWithTrailingData) {
+    std::mt19937_64 twister(sizeof(TypeParam));
+    for (int ii = 0; ii < 10000; ii++) {
+        // Spread the values over all of the encoded lengths
+        auto value = gsl::narrow_cast<TypeParam>(twister() >>
+                                                 (twister() % 64));
+        cb::mcbp::unsigned_leb128<TypeParam> leb(value);
+        std::vector<uint8_t> data(leb.begin(), leb.end());
+        data.insert(data.end(), 8, 0xff);
+
+        auto rv = cb::mcbp::decode_unsigned_leb128<TypeParam>({data});
+        EXPECT_EQ(value, rv.first);
+        ASSERT_EQ(8, rv.second.size());
+        EXPECT_EQ(data.data() + leb.size(), rv.second.data());
+    }
+}
+
+TYPED_TEST(UnsignedLeb128, DecodeEmptyInput) {
+    auto rv = cb::mcbp::decode_unsigned_leb128<TypeParam>(
+            {}, cb::mcbp::Leb128NoThrow());
+    EXPECT_FALSE(rv.second.data());
+    EXPECT_THROW(cb::mcbp::decode_unsigned_leb128<TypeParam>({}),
+                 std::invalid_argument);
+}
+
 // Encode a value and expect the iterators to iterate the encoded bytes
 TYPED_TEST(UnsignedLeb128, iterators) {
     TypeParam value = 1; // Upto 127 and it's 1 byte
@@ -193,9 +221,13 @@ TYPED_TEST(UnsignedLeb128, non_canonical) {
             };
 
     for (const auto& test : testData) {
-        for (const auto& data : test.second) {
+        for (auto data : test.second) {
             auto value = cb::mcbp::decode_unsigned_leb128<TypeParam>({data});
             EXPECT_EQ(test.first, value.first);
+            // and when decoded a word at a time
+            data.insert(data.end(), 8, 0);
+            value = cb::mcbp::decode_unsigned_leb128<TypeParam>({data});
+            EXPECT_EQ(test.first, value.first);
         }
     }
 }
@@ -22,7 +22,11 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <map>
+#include <thread>
 #include <vector>
 #include <sstream>
 
@@ -548,6 +552,215 @@ static enum test_result test_datatype(EngineIface* h) {
     return SUCCESS;
 }
 
+/// Build a value of the given size from the key (so a read may verify that
+/// it got the value of the right document)
+static std::string make_value(const std::string& key, size_t size) {
+    std::string value;
+    while (value.size() < size) {
+        value.append(key);
+    }
+    value.resize(size);
+    return value;
+}
+
+/// Store the document. Returns false if the engine was out of memory
+static bool store_value(EngineIface* h,
+                        const void* cookie,
+                        const std::string& key,
+                        const std::string& value) {
+    DocKey docKey(key, DocKeyEncodesCollectionId::No);
+    auto ret = h->allocate(cookie,
+                           docKey,
+                           value.size(),
+                           0,
+                           0,
+                           PROTOCOL_BINARY_RAW_BYTES,
+                           Vbid(0));
+    if (ret.first == cb::engine_errc::no_memory ||
+        ret.first == cb::engine_errc::temporary_failure) {
+        return false;
+    }
+    cb_assert(ret.first == cb::engine_errc::success);
+    item_info info;
+    cb_assert(h->get_item_info(ret.second.get(), &info));
+    memcpy(info.value[0].iov_base, value.data(), value.size());
+    uint64_t cas = 0;
+    cb_assert(h->store(cookie,
+                       ret.second.get(),
+                       cas,
+                       OPERATION_SET,
+                       {},
+                       DocumentState::Alive) == ENGINE_SUCCESS);
+    return true;
+}
+
+/// Get the value of the document (empty if it doesn't exist)
+static std::string get_value(EngineIface* h,
+                             const void* cookie,
+                             const std::string& key) {
+    DocKey docKey(key, DocKeyEncodesCollectionId::No);
+    auto ret = h->get(cookie, docKey, Vbid(0), DocStateFilter::Alive);
+    if (ret.first == cb::engine_errc::no_such_key) {
+        return {};
+    }
+    cb_assert(ret.first == cb::engine_errc::success);
+    item_info info;
+    cb_assert(h->get_item_info(ret.second.get(), &info));
+    return {static_cast<const char*>(info.value[0].iov_base),
+            info.value[0].iov_len};
+}
+
+/// Get a group of stats
+static std::map<std::string, std::string> get_stat_group(
+        EngineIface* h, const void* cookie, const char* group) {
+    std::map<std::string, std::string> stats;
+    cb_assert(h->get_stats(cookie,
+                           {group, strlen(group)},
+                           {},
+                           [&stats](const char* key,
+                                    const uint16_t klen,
+                                    const char* val,
+                                    const uint32_t vlen,
+                                    gsl::not_null<const void*>) {
+                               stats[std::string(key, klen)] =
+                                       std::string(val, vlen);
+                           }) == ENGINE_SUCCESS);
+    return stats;
+}
+
+/*
+ * Run sets, gets and deletes of an overlapping set of keys from a number of
+ * threads, with enough data to keep the engine evicting (and the LRU
+ * maintainer busy). Every read must return the value of the document it
+ * asked for.
+ */
+static enum test_result concurrent_get_set_evict_test(EngineIface* h) {
+    const int n_threads = 4;
+    const int n_keys = 20000;
+    const int n_ops = 20000;
+    const size_t sizes[] = {100, 1000, 4000};
+
+    std::vector<const void*> cookies;
+    for (int ii = 0; ii < n_threads; ++ii) {
+        cookies.push_back(test_harness->create_cookie());
+    }
+
+    std::atomic<uint64_t> hits{0};
+    std::vector<std::thread> threads;
+    for (int tt = 0; tt < n_threads; ++tt) {
+        threads.emplace_back([h, &cookies, &sizes, &hits, tt]() {
+            const auto* cookie = cookies[tt];
+            uint32_t seed = 1 + tt;
+            for (int ii = 0; ii < n_ops; ++ii) {
+                seed = seed * 1103515245 + 12345;
+                const std::string key =
+                        "concurrent_" + std::to_string((seed >> 8) % n_keys);
+                switch ((seed >> 4) % 4) {
+                case 0:
+                case 1: {
+                    const auto value = get_value(h, cookie, key);
+                    if (!value.empty()) {
+                        cb_assert(value == make_value(key, value.size()));
+                        hits++;
+                    }
+                    break;
+                }
+                case 2:
+                    store_value(h,
+                                cookie,
+                                key,
+                                make_value(key, sizes[(seed >> 16) % 3]));
+                    break;
+                case 3: {
+                    DocKey docKey(key, DocKeyEncodesCollectionId::No);
+                    uint64_t cas = 0;
+                    mutation_descr_t mut_info;
+                    const auto ret = h->remove(
+                            cookie, docKey, cas, Vbid(0), {}, mut_info);
+                    cb_assert(ret == ENGINE_SUCCESS ||
+                              ret == ENGINE_KEY_ENOENT);
+                    break;
+                }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const auto stats = get_stat_group(h, cookies.front(), "");
+    cb_assert(std::stoull(stats.at("evictions")) > 0);
+    cb_assert(hits > 0);
+
+    for (const auto* cookie : cookies) {
+        test_harness->destroy_cookie(cookie);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Fill the engine with small documents which are then left alone, and keep
+ * evicting large documents until the slab automover moves a page of the
+ * small documents over to the large ones. The live documents in the page
+ * must be moved to other chunks and keep their value.
+ */
+static enum test_result slab_rebalance_test(EngineIface* h) {
+    const int n_small = 30000;
+    const auto* cookie = test_harness->create_cookie();
+
+    for (int ii = 0; ii < n_small; ++ii) {
+        const auto key = "small_" + std::to_string(ii);
+        cb_assert(store_value(h, cookie, key, make_value(key, 100)));
+    }
+    // Leave free chunks in all of the pages, so the documents in the page
+    // being moved may be relocated rather than evicted
+    for (int ii = 0; ii < n_small; ii += 2) {
+        DocKey docKey("small_" + std::to_string(ii),
+                      DocKeyEncodesCollectionId::No);
+        uint64_t cas = 0;
+        mutation_descr_t mut_info;
+        cb_assert(h->remove(cookie, docKey, cas, Vbid(0), {}, mut_info) ==
+                  ENGINE_SUCCESS);
+    }
+
+    // The small documents are now old compared with the large ones
+    test_harness->time_travel(1000);
+
+    int next_large = 0;
+    bool moved = false;
+    for (int window = 0; window < 30 && !moved; ++window) {
+        for (int ii = 0; ii < 50; ++ii) {
+            const auto key = "large_" + std::to_string(next_large++);
+            store_value(h, cookie, key, make_value(key, 100 * 1024));
+        }
+        // Let the LRU maintainer look at the evictions of the window
+        test_harness->time_travel(11);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        const auto slabs = get_stat_group(h, cookie, "slabs");
+        moved = std::stoull(slabs.at("slabs_moved")) > 0;
+    }
+    cb_assert(moved);
+
+    const auto slabs = get_stat_group(h, cookie, "slabs");
+    cb_assert(slabs.at("slab_reassign_running") == "0");
+    cb_assert(std::stoull(slabs.at("slab_reassign_rescues")) > 0);
+
+    int found = 0;
+    for (int ii = 1; ii < n_small; ii += 2) {
+        const auto key = "small_" + std::to_string(ii);
+        const auto value = get_value(h, cookie, key);
+        if (!value.empty()) {
+            cb_assert(value == make_value(key, 100));
+            ++found;
+        }
+    }
+    cb_assert(found > 0);
+
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
 /*
  * Destroy many buckets - this test is really more interesting with valgrind
  *  destroy should invoke a background cleaner thread and at exit time there
@@ -665,6 +878,23 @@ engine_test_t* get_tests(void) {
         TEST_CASE("get stats struct test", get_stats_struct_test, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE("aggregate stats test", aggregate_stats_test, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE("Test datatype", test_datatype, NULL, NULL, NULL, NULL, NULL),
+#ifndef VALGRIND
+        // These tests rely on the slab allocator (cache_size) to evict
+        TEST_CASE("Concurrent get/set/evict test",
+                  concurrent_get_set_evict_test,
+                  NULL,
+                  NULL,
+                  "cache_size=16",
+                  NULL,
+                  NULL),
+        TEST_CASE("Slab rebalance test",
+                  slab_rebalance_test,
+                  NULL,
+                  NULL,
+                  "cache_size=10;slab_automove=true",
+                  NULL,
+                  NULL),
+#endif
         TEST_CASE_V2("Bucket destroy", test_n_bucket_destroy, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE_V2("Bucket destroy interleaved", test_bucket_destroy_interleaved, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE(NULL, NULL, NULL, NULL, NULL, NULL, NULL)
@@ -157,6 +157,10 @@ MEMCACHED_PUBLIC_API std::string to_string(
         return "sync_write.ack_local";
     case TraceCode::SYNC_WRITE_ACK_REMOTE:
         return "sync_write.ack_remote";
+    case TraceCode::HASH_TABLE_LOCK:
+        return "ht.lock";
+    case TraceCode::DECOMPRESS:
+        return "decompress";
     }
     return "unknown tracecode";
 }
@@ -41,6 +41,11 @@ enum class TraceCode : uint8_t {
     SYNC_WRITE_ACK_LOCAL,
     /// Time when a SyncWrite replica ACK is received by the Active.
     SYNC_WRITE_ACK_REMOTE,
+    /// Time spent acquiring the HashTable bucket lock (and locating the
+    /// StoredValue) for a front-end operation.
+    HASH_TABLE_LOCK,
+    /// Time spent inflating a Snappy-compressed value.
+    DECOMPRESS,
 };
 } // namespace tracing
 } // namespace cb
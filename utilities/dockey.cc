@@ -45,7 +45,7 @@ std::string DocKey::to_string() const {
     return ss.str();
 }
 
-CollectionID DocKey::getCollectionID() const {
+CollectionID DocKey::decodeCollectionID() const {
     // Durability introduces the new "Prepare" namespace in DocKey.
     // So, the new generic format for a DocKey is:
     //
@@ -72,6 +72,10 @@ CollectionID DocKey::getCollectionID() const {
 
 std::pair<CollectionID, cb::const_byte_buffer> DocKey::getIdAndKey() const {
     if (encoding == DocKeyEncodesCollectionId::Yes) {
+        if (prefixLength != 0) {
+            return {prefixId,
+                    {data() + prefixLength, size() - prefixLength}};
+        }
         return cb::mcbp::decode_unsigned_leb128<CollectionIDType>(buffer);
     }
     return {CollectionID::Default, {data(), size()}};
@@ -79,6 +83,11 @@ std::pair<CollectionID, cb::const_byte_buffer> DocKey::getIdAndKey() const {
 
 DocKey DocKey::makeDocKeyWithoutCollectionID() const {
     if (getEncoding() == DocKeyEncodesCollectionId::Yes) {
+        if (prefixLength != 0) {
+            return {data() + prefixLength,
+                    size() - prefixLength,
+                    DocKeyEncodesCollectionId::No};
+        }
         auto decoded = cb::mcbp::skip_unsigned_leb128<CollectionIDType>(buffer);
         return {decoded.data(), decoded.size(), DocKeyEncodesCollectionId::No};
     }
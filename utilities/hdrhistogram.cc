@@ -20,9 +20,12 @@
 #include <folly/lang/Assume.h>
 #include <hdr_histogram.h>
 #include <nlohmann/json.hpp>
+#include <platform/base64.h>
 #include <platform/cb_malloc.h>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
 
 // Custom deleter for the hdr_histogram struct.
 void HdrHistogram::HdrDeleter::operator()(struct hdr_histogram* val) {
@@ -295,6 +298,8 @@ nlohmann::json HdrHistogram::to_json(Iterator::IterMode itrType) {
         lastval = itr.cumulative_count;
     }
     rootObj["data"] = dataArr;
+    // Allow the consumer to merge the histograms of multiple nodes
+    rootObj["encoded"] = cb::base64::encode(encode(), false);
 
     return rootObj;
 }
@@ -303,6 +308,90 @@ std::string HdrHistogram::to_string() {
     return to_json().dump();
 }
 
+/// The version of the encoding generated by HdrHistogram::encode()
+static const uint8_t EncodingVersion = 1;
+
+static void encodeVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(char(uint8_t(value) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+static uint64_t decodeVarint(const std::string& in, size_t& offset) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (offset >= in.size()) {
+            throw std::invalid_argument(
+                    "HdrHistogram::decode: premature end of data");
+        }
+        const auto byte = uint8_t(in[offset++]);
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::invalid_argument("HdrHistogram::decode: invalid varint");
+}
+
+std::string HdrHistogram::encode() const {
+    std::string ret;
+    ret.push_back(char(EncodingVersion));
+    encodeVarint(ret, getMinTrackableValue());
+    encodeVarint(ret, getMaxTrackableValue());
+    encodeVarint(ret, uint64_t(getSigFigAccuracy()));
+
+    std::vector<std::pair<uint64_t, uint64_t>> values;
+    auto iter = makeRecordedIterator();
+    while (auto pair = getNextValueAndCount(iter)) {
+        values.push_back(*pair);
+    }
+
+    encodeVarint(ret, values.size());
+    // The values are in ascending order, so store the (smaller) deltas
+    uint64_t previous = 0;
+    for (const auto& entry : values) {
+        encodeVarint(ret, entry.first - previous);
+        encodeVarint(ret, entry.second);
+        previous = entry.first;
+    }
+    return ret;
+}
+
+HdrHistogram HdrHistogram::decode(const std::string& encoded) {
+    if (encoded.empty() || uint8_t(encoded[0]) != EncodingVersion) {
+        throw std::invalid_argument(
+                "HdrHistogram::decode: unsupported encoding version");
+    }
+    size_t offset = 1;
+    const auto lowest = decodeVarint(encoded, offset);
+    const auto highest = decodeVarint(encoded, offset);
+    const auto sigfigs = decodeVarint(encoded, offset);
+    if (lowest >= highest ||
+        highest >= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) ||
+        sigfigs < 1 || sigfigs > 5) {
+        throw std::invalid_argument(
+                "HdrHistogram::decode: invalid histogram parameters");
+    }
+
+    HdrHistogram ret(lowest, highest, int(sigfigs));
+    const auto entries = decodeVarint(encoded, offset);
+    uint64_t value = 0;
+    for (uint64_t ii = 0; ii < entries; ++ii) {
+        value += decodeVarint(encoded, offset);
+        const auto count = decodeVarint(encoded, offset);
+        if (value > highest || !ret.addValueAndCount(value, count)) {
+            throw std::invalid_argument(
+                    "HdrHistogram::decode: value out of range");
+        }
+    }
+    if (offset != encoded.size()) {
+        throw std::invalid_argument("HdrHistogram::decode: trailing data");
+    }
+    return ret;
+}
+
 size_t HdrHistogram::getMemFootPrint() const {
     return hdr_get_memory_size(histogram.get()) + sizeof(HdrHistogram);
 }
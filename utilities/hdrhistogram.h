@@ -297,6 +297,29 @@ public:
      */
     std::string to_string();
 
+    /**
+     * Encode the histogram in a compact binary form which may be decoded
+     * (by decode()) and merged with the histograms of other processes
+     * without losing precision (unlike the percentiles in to_json()).
+     *
+     * The encoding is a version byte followed by a sequence of unsigned
+     * LEB128 varints: the lowest and highest trackable value, the number
+     * of significant figures, the number of recorded values and then
+     * a (value delta, count) pair for each of them.
+     *
+     * @return the encoded histogram
+     */
+    std::string encode() const;
+
+    /**
+     * Decode a histogram encoded by encode()
+     *
+     * @param encoded the encoded histogram
+     * @return the decoded histogram
+     * @throws std::invalid_argument if the encoded data is invalid
+     */
+    static HdrHistogram decode(const std::string& encoded);
+
     /**
      * Method to get the total amount of memory being used by this histogram
      * @return number of bytes being used by this histogram
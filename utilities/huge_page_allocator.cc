@@ -0,0 +1,118 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "huge_page_allocator.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+namespace cb {
+
+HugePageMode to_huge_page_mode(const std::string& mode) {
+    if (mode == "none") {
+        return HugePageMode::None;
+    }
+    if (mode == "transparent") {
+        return HugePageMode::Transparent;
+    }
+    if (mode == "explicit") {
+        return HugePageMode::Explicit;
+    }
+    throw std::invalid_argument("cb::to_huge_page_mode: unknown mode: " +
+                                mode);
+}
+
+std::string to_string(HugePageMode mode) {
+    switch (mode) {
+    case HugePageMode::None:
+        return "none";
+    case HugePageMode::Transparent:
+        return "transparent";
+    case HugePageMode::Explicit:
+        return "explicit";
+    }
+    throw std::invalid_argument("cb::to_string(HugePageMode): invalid mode: " +
+                                std::to_string(int(mode)));
+}
+
+#ifdef WIN32
+// Large pages on Windows require the SeLockMemoryPrivilege; just use the
+// normal allocator
+void* allocateHugePages(size_t size, HugePageMode) {
+    return ::operator new(size, std::nothrow);
+}
+
+void freeHugePages(void* ptr, size_t) {
+    ::operator delete(ptr);
+}
+#else
+void* allocateHugePages(size_t size, HugePageMode mode) {
+#ifdef MAP_HUGETLB
+    if (mode == HugePageMode::Explicit) {
+        auto* ret = mmap(nullptr,
+                         size,
+                         PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                         -1,
+                         0);
+        if (ret != MAP_FAILED) {
+            return ret;
+        }
+        // The huge page pool is exhausted (or not configured); use
+        // transparent huge pages instead
+    }
+#endif
+
+    // Transparent huge pages are only used for huge page aligned regions,
+    // so over-allocate and trim the mapping to an aligned one
+    const auto total = size + HugePageSize;
+    auto* mapping = mmap(nullptr,
+                         total,
+                         PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1,
+                         0);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    const auto start = reinterpret_cast<uintptr_t>(mapping);
+    const auto aligned = (start + HugePageSize - 1) & ~(HugePageSize - 1);
+    if (aligned != start) {
+        munmap(mapping, aligned - start);
+    }
+    const auto tail = (start + total) - (aligned + size);
+    if (tail != 0) {
+        munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+
+    auto* ret = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+    // Ignore failures; the memory is still usable with normal pages
+    (void)madvise(ret, size, MADV_HUGEPAGE);
+#endif
+    return ret;
+}
+
+void freeHugePages(void* ptr, size_t size) {
+    munmap(ptr, size);
+}
+#endif
+
+} // namespace cb
@@ -0,0 +1,189 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/non_negative_counter.h>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+
+namespace cb {
+
+/// How (if at all) large allocations should be backed by huge pages
+enum class HugePageMode {
+    /// Use the normal allocator
+    None,
+    /// Map the memory and ask for it to be backed by transparent huge pages
+    Transparent,
+    /// Map the memory from the explicit (hugetlbfs) huge page pool, falling
+    /// back to transparent huge pages if the pool is exhausted
+    Explicit
+};
+
+/**
+ * Parse a HugePageMode ("none", "transparent" or "explicit")
+ *
+ * @throws std::invalid_argument for an unknown mode
+ */
+HugePageMode to_huge_page_mode(const std::string& mode);
+
+std::string to_string(HugePageMode mode);
+
+/// The size of a huge page (allocations are a multiple of it)
+const size_t HugePageSize = 2 * 1024 * 1024;
+
+/**
+ * Map size bytes (which must be a multiple of HugePageSize) of zeroed
+ * memory backed by huge pages as specified by mode.
+ *
+ * @return the memory, or nullptr if it couldn't be mapped
+ */
+void* allocateHugePages(size_t size, HugePageMode mode);
+
+/// Release memory returned by allocateHugePages
+void freeHugePages(void* ptr, size_t size);
+
+} // namespace cb
+
+/**
+ * Allocator which (in addition to tracking the bytes allocated like
+ * MemoryTrackingAllocator) serves the allocations of at least one huge
+ * page directly from huge page backed mappings. Smaller allocations use
+ * the normal allocator.
+ *
+ * Memory mapped by the allocator isn't seen by the malloc hooks, so the
+ * owner may register callbacks to account for it (e.g. in the memory used
+ * by a bucket).
+ *
+ * The policy is shared by all copies (and rebinds) of the allocator, and
+ * is propagated when containers are swapped or move / copy assigned so
+ * that memory is always released by the allocator which mapped it.
+ */
+template <class T>
+class HugePageAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    struct Policy {
+        cb::HugePageMode mode = cb::HugePageMode::None;
+        /// Called with the size of each huge page backed mapping created
+        std::function<void(size_t)> mapped;
+        /// Called with the size of each huge page backed mapping released
+        std::function<void(size_t)> unmapped;
+        /// Bytes allocated by the allocator (mapped or not)
+        cb::NonNegativeCounter<size_t> bytesAllocated{0};
+        /// Bytes allocated from huge page backed mappings
+        cb::NonNegativeCounter<size_t> hugePageBytes{0};
+    };
+
+    HugePageAllocator() noexcept : policy(std::make_shared<Policy>()) {
+    }
+
+    explicit HugePageAllocator(std::shared_ptr<Policy> policy) noexcept
+        : policy(std::move(policy)) {
+    }
+
+    template <class U>
+    HugePageAllocator(HugePageAllocator<U> const& other) noexcept
+        : policy(other.getPolicy()) {
+    }
+
+    value_type* allocate(std::size_t n) {
+        const auto bytes = n * sizeof(T);
+        policy->bytesAllocated += bytes;
+        if (!isMapped(bytes)) {
+            return static_cast<value_type*>(::operator new(bytes));
+        }
+
+        const auto size = mappedSize(bytes);
+        auto* ret = cb::allocateHugePages(size, policy->mode);
+        if (ret == nullptr) {
+            policy->bytesAllocated -= bytes;
+            throw std::bad_alloc();
+        }
+        policy->hugePageBytes += size;
+        if (policy->mapped) {
+            policy->mapped(size);
+        }
+        return static_cast<value_type*>(ret);
+    }
+
+    void deallocate(value_type* p, std::size_t n) noexcept {
+        const auto bytes = n * sizeof(T);
+        policy->bytesAllocated -= bytes;
+        if (!isMapped(bytes)) {
+            ::operator delete(p);
+            return;
+        }
+
+        const auto size = mappedSize(bytes);
+        cb::freeHugePages(p, size);
+        policy->hugePageBytes -= size;
+        if (policy->unmapped) {
+            policy->unmapped(size);
+        }
+    }
+
+    HugePageAllocator select_on_container_copy_construction() const {
+        // A copy shares the policy (and accounting) of the original
+        return *this;
+    }
+
+    const std::shared_ptr<Policy>& getPolicy() const {
+        return policy;
+    }
+
+    size_t getBytesAllocated() const {
+        return policy->bytesAllocated;
+    }
+
+    size_t getHugePageBytes() const {
+        return policy->hugePageBytes;
+    }
+
+private:
+    bool isMapped(size_t bytes) const {
+        return policy->mode != cb::HugePageMode::None &&
+               bytes >= cb::HugePageSize;
+    }
+
+    static size_t mappedSize(size_t bytes) {
+        return ((bytes + cb::HugePageSize - 1) / cb::HugePageSize) *
+               cb::HugePageSize;
+    }
+
+    std::shared_ptr<Policy> policy;
+};
+
+template <class T, class U>
+bool operator==(HugePageAllocator<T> const& a,
+                HugePageAllocator<U> const& b) noexcept {
+    return a.getPolicy() == b.getPolicy();
+}
+
+template <class T, class U>
+bool operator!=(HugePageAllocator<T> const& a,
+                HugePageAllocator<U> const& b) noexcept {
+    return !(a == b);
+}
@@ -0,0 +1,357 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "json_validator.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CB_JSON_VALIDATOR_SSE2 1
+#endif
+
+namespace cb {
+namespace {
+
+class FastPathParser {
+public:
+    FastPathParser(const uint8_t* data, size_t size)
+        : p(data), end(data + size) {
+    }
+
+    bool parse();
+
+private:
+    bool isContinuation(const uint8_t* c) const {
+        return c < end && (*c & 0xc0) == 0x80;
+    }
+
+    bool inRange(const uint8_t* c, uint8_t lo, uint8_t hi) const {
+        return c < end && *c >= lo && *c <= hi;
+    }
+
+    void skipWhitespace() {
+        while (p < end &&
+               (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            ++p;
+        }
+    }
+
+    /// Skip the run of plain string characters (no quote, backslash,
+    /// control or non-ASCII characters) starting at p
+    void skipPlainCharacters();
+    bool parseString();
+    bool parseUtf8Sequence();
+    bool parseNumber();
+    bool parseLiteral(const char* literal, size_t length);
+    bool parseScalar();
+
+    bool push(bool object) {
+        if (depth == JsonValidator::MaxFastPathDepth) {
+            return false;
+        }
+        if (object) {
+            objects |= uint32_t(1) << depth;
+        } else {
+            objects &= ~(uint32_t(1) << depth);
+        }
+        ++depth;
+        return true;
+    }
+
+    bool inObject() const {
+        return (objects >> (depth - 1)) & 1;
+    }
+
+    const uint8_t* p;
+    const uint8_t* const end;
+    size_t depth = 0;
+    /// Bit n is set if nesting level n is an object (else an array)
+    uint32_t objects = 0;
+};
+
+static_assert(JsonValidator::MaxFastPathDepth <= 32,
+              "FastPathParser::objects is too small for MaxFastPathDepth");
+
+void FastPathParser::skipPlainCharacters() {
+#ifdef CB_JSON_VALIDATOR_SSE2
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto control = _mm_set1_epi8(0x1f);
+    while (end - p >= 16) {
+        const auto chunk =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                             _mm_cmpeq_epi8(chunk, backslash)),
+                // c <= 0x1f  <=>  max(c, 0x1f) == 0x1f (unsigned)
+                _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        // The movemask of chunk itself flags the non-ASCII bytes
+        const auto mask = unsigned(_mm_movemask_epi8(special)) |
+                          unsigned(_mm_movemask_epi8(chunk));
+        if (mask != 0) {
+            p += __builtin_ctz(mask);
+            return;
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && *p >= 0x20 && *p < 0x80) {
+        ++p;
+    }
+}
+
+bool FastPathParser::parseUtf8Sequence() {
+    // Well-formed UTF-8 (RFC 3629); no overlong encodings, surrogates or
+    // code points above U+10FFFF.
+    const auto c = *p;
+    if (c >= 0xc2 && c <= 0xdf) {
+        if (!isContinuation(p + 1)) {
+            return false;
+        }
+        p += 2;
+    } else if (c >= 0xe0 && c <= 0xef) {
+        const uint8_t lo = c == 0xe0 ? 0xa0 : 0x80;
+        const uint8_t hi = c == 0xed ? 0x9f : 0xbf;
+        if (!inRange(p + 1, lo, hi) || !isContinuation(p + 2)) {
+            return false;
+        }
+        p += 3;
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        const uint8_t lo = c == 0xf0 ? 0x90 : 0x80;
+        const uint8_t hi = c == 0xf4 ? 0x8f : 0xbf;
+        if (!inRange(p + 1, lo, hi) || !isContinuation(p + 2) ||
+            !isContinuation(p + 3)) {
+            return false;
+        }
+        p += 4;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool FastPathParser::parseString() {
+    // p is at the opening quote
+    ++p;
+    while (true) {
+        skipPlainCharacters();
+        if (p == end) {
+            return false;
+        }
+        const auto c = *p;
+        if (c == '"') {
+            ++p;
+            return true;
+        }
+        if (c == '\\') {
+            if (end - p < 2) {
+                return false;
+            }
+            switch (p[1]) {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                p += 2;
+                break;
+            case 'u':
+                if (end - p < 6) {
+                    return false;
+                }
+                for (int ii = 2; ii < 6; ++ii) {
+                    const auto h = p[ii];
+                    if (!((h >= '0' && h <= '9') || (h >= 'a' && h <= 'f') ||
+                          (h >= 'A' && h <= 'F'))) {
+                        return false;
+                    }
+                }
+                p += 6;
+                break;
+            default:
+                return false;
+            }
+        } else if (c < 0x20) {
+            return false;
+        } else if (!parseUtf8Sequence()) {
+            return false;
+        }
+    }
+}
+
+bool FastPathParser::parseNumber() {
+    auto isDigit = [this](const uint8_t* c) {
+        return c < end && *c >= '0' && *c <= '9';
+    };
+
+    if (*p == '-') {
+        ++p;
+    }
+    if (p < end && *p == '0') {
+        ++p;
+    } else if (isDigit(p)) {
+        while (isDigit(p)) {
+            ++p;
+        }
+    } else {
+        return false;
+    }
+
+    if (p < end && *p == '.') {
+        ++p;
+        if (!isDigit(p)) {
+            return false;
+        }
+        while (isDigit(p)) {
+            ++p;
+        }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p < end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        if (!isDigit(p)) {
+            return false;
+        }
+        while (isDigit(p)) {
+            ++p;
+        }
+    }
+    return true;
+}
+
+bool FastPathParser::parseLiteral(const char* literal, size_t length) {
+    if (size_t(end - p) < length) {
+        return false;
+    }
+    for (size_t ii = 0; ii < length; ++ii) {
+        if (p[ii] != uint8_t(literal[ii])) {
+            return false;
+        }
+    }
+    p += length;
+    return true;
+}
+
+bool FastPathParser::parseScalar() {
+    switch (*p) {
+    case '"':
+        return parseString();
+    case 't':
+        return parseLiteral("true", 4);
+    case 'f':
+        return parseLiteral("false", 5);
+    case 'n':
+        return parseLiteral("null", 4);
+    default:
+        return parseNumber();
+    }
+}
+
+bool FastPathParser::parse() {
+    skipWhitespace();
+    if (p == end || (*p != '{' && *p != '[')) {
+        // Top level scalars (and empty documents) are left for JSON_checker
+        return false;
+    }
+
+    // Each iteration parses one value (at p), followed by the closing of
+    // any containers it completes and the separator before the next value
+    while (true) {
+        if (p == end) {
+            return false;
+        }
+        if (*p == '{' || *p == '[') {
+            const bool object = *p == '{';
+            if (!push(object)) {
+                return false;
+            }
+            ++p;
+            skipWhitespace();
+            if (p == end) {
+                return false;
+            }
+            if (*p == (object ? '}' : ']')) {
+                // Empty container; a complete value
+                ++p;
+                --depth;
+            } else {
+                if (object) {
+                    if (*p != '"' || !parseString()) {
+                        return false;
+                    }
+                    skipWhitespace();
+                    if (p == end || *p != ':') {
+                        return false;
+                    }
+                    ++p;
+                    skipWhitespace();
+                }
+                continue;
+            }
+        } else if (!parseScalar()) {
+            return false;
+        }
+
+        // After a complete value
+        while (true) {
+            if (depth == 0) {
+                skipWhitespace();
+                return p == end;
+            }
+            skipWhitespace();
+            if (p == end) {
+                return false;
+            }
+            const bool object = inObject();
+            if (*p == (object ? '}' : ']')) {
+                ++p;
+                --depth;
+                continue;
+            }
+            if (*p != ',') {
+                return false;
+            }
+            ++p;
+            skipWhitespace();
+            if (object) {
+                if (p == end || *p != '"' || !parseString()) {
+                    return false;
+                }
+                skipWhitespace();
+                if (p == end || *p != ':') {
+                    return false;
+                }
+                ++p;
+                skipWhitespace();
+            }
+            break;
+        }
+    }
+}
+
+} // namespace
+
+bool JsonValidator::isValidFastPath(const uint8_t* data, size_t size) {
+    return FastPathParser(data, size).parse();
+}
+
+} // namespace cb
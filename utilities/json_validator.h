@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <JSON_checker.h>
+#include <platform/sized_buffer.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cb {
+
+/**
+ * JSON validation used to determine the datatype of documents.
+ *
+ * Most JSON documents are objects (or arrays) of mostly plain strings,
+ * numbers and literals; those are validated by a single pass, allocation
+ * free, parser which scans string contents 16 bytes at a time with SSE2
+ * (where available). Anything that parser can't vouch for - invalid
+ * documents, top level scalars, deeply nested documents - is passed on to
+ * JSON_checker, so the result is the same as JSON_checker's.
+ */
+class JsonValidator {
+public:
+    /// @return true if the data is a valid JSON document
+    bool validate(const uint8_t* data, size_t size) {
+        return isValidFastPath(data, size) || fallback.validate(data, size);
+    }
+
+    bool validate(cb::const_byte_buffer data) {
+        return validate(data.data(), data.size());
+    }
+
+    bool validate(cb::const_char_buffer data) {
+        return validate(reinterpret_cast<const uint8_t*>(data.data()),
+                        data.size());
+    }
+
+    /**
+     * The fast path on its own.
+     *
+     * @return true if data is an object or array nested at most
+     *         MaxFastPathDepth deep which is valid JSON (with valid UTF-8
+     *         strings); false if it isn't, or is something else (which
+     *         fallback has to decide on)
+     */
+    static bool isValidFastPath(const uint8_t* data, size_t size);
+
+    /// The deepest nesting the fast path handles
+    static constexpr size_t MaxFastPathDepth = 20;
+
+private:
+    JSON_checker::Validator fallback;
+};
+
+/// Validate data as JSON, for callers without a JsonValidator at hand
+inline bool isValidJson(const uint8_t* data, size_t size) {
+    return JsonValidator::isValidFastPath(data, size) ||
+           checkUTF8JSON(data, size);
+}
+
+} // namespace cb
@@ -0,0 +1,35 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+
+namespace cb {
+
+/**
+ * Get the CPU time (user and system) consumed by the calling thread.
+ *
+ * Used to attribute the CPU time of the front-end and executor threads to
+ * the bucket they're doing work for; only differences between two calls on
+ * the same thread are meaningful.
+ *
+ * @return the CPU time of the calling thread, or zero if the platform
+ *         doesn't support measuring it
+ */
+std::chrono::nanoseconds getThreadCpuTime();
+
+} // namespace cb
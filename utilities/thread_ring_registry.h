@@ -0,0 +1,179 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace cb {
+
+/**
+ * ThreadRingRegistry keeps track of the single producer / single consumer
+ * rings owned by the threads submitting work to a consumer thread (used by
+ * the deferred logger and the audit daemon).
+ *
+ * A producer keeps the handle to its ring in a thread_local Handle. When the
+ * thread exits (or the handle is reset) the ring is marked as retired, and
+ * the consumer frees it once it is drained (see reap()). The registry and
+ * the handle share the ownership of the ring, so the ring stays valid as
+ * long as either the producer or the consumer may use it (even if the
+ * registry is destroyed before the thread exits).
+ *
+ * The Ring type must provide empty(), which the consumer may call.
+ */
+template <typename Ring>
+class ThreadRingRegistry {
+public:
+    class Entry {
+    public:
+        template <typename... Args>
+        explicit Entry(Args&&... args) : ring(std::forward<Args>(args)...) {
+        }
+
+        Ring ring;
+
+    private:
+        friend class ThreadRingRegistry;
+        /// Set once the owning thread won't use the ring again
+        std::atomic<bool> retired{false};
+    };
+
+    using EntryPtr = std::shared_ptr<Entry>;
+
+    /// The producer's reference to its ring (to be kept in a thread_local)
+    class Handle {
+    public:
+        Handle() = default;
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        ~Handle() {
+            reset();
+        }
+
+        /**
+         * @return the ring the handle holds in the registry, or nullptr if it
+         *         doesn't hold one (or holds the ring of another registry)
+         */
+        Ring* get(const ThreadRingRegistry& registry) const {
+            if (entry && owner == registry.id) {
+                return &entry->ring;
+            }
+            return nullptr;
+        }
+
+        /// Retire the ring (the producer won't use it again)
+        void reset() {
+            if (entry) {
+                entry->retired.store(true, std::memory_order_release);
+                entry.reset();
+            }
+        }
+
+    private:
+        friend class ThreadRingRegistry;
+        EntryPtr entry;
+        uint64_t owner = 0;
+    };
+
+    ThreadRingRegistry() = default;
+    ThreadRingRegistry(const ThreadRingRegistry&) = delete;
+    ThreadRingRegistry& operator=(const ThreadRingRegistry&) = delete;
+
+    /**
+     * Create a new ring owned by the calling thread (retiring the ring the
+     * handle held before)
+     *
+     * @param handle the calling thread's handle
+     * @param args the arguments passed on to the constructor of the ring
+     * @return the new ring
+     */
+    template <typename... Args>
+    Ring& add(Handle& handle, Args&&... args) {
+        auto entry = std::make_shared<Entry>(std::forward<Args>(args)...);
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            entries.push_back(entry);
+        }
+        handle.reset();
+        handle.entry = std::move(entry);
+        handle.owner = id;
+        return handle.entry->ring;
+    }
+
+    /// Get the registered rings (so the consumer may drain them without
+    /// holding the registry lock)
+    std::vector<EntryPtr> getRings() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return entries;
+    }
+
+    /// Call the function with each of the registered rings (with the
+    /// registry lock held)
+    template <typename Function>
+    void forEach(Function&& function) const {
+        std::lock_guard<std::mutex> guard(mutex);
+        for (const auto& entry : entries) {
+            function(entry->ring);
+        }
+    }
+
+    /**
+     * Free the rings of the threads which won't use them again, once they
+     * are empty. To be called by the consumer after it drained the rings.
+     *
+     * @return the number of rings released by the registry
+     */
+    size_t reap() {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto iter = std::remove_if(
+                entries.begin(), entries.end(), [](const EntryPtr& entry) {
+                    // The producer's last use of the ring happens before it
+                    // is retired
+                    return entry->retired.load(std::memory_order_acquire) &&
+                           entry->ring.empty();
+                });
+        const auto count = size_t(std::distance(iter, entries.end()));
+        entries.erase(iter, entries.end());
+        return count;
+    }
+
+    /// The number of rings in the registry
+    size_t size() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return entries.size();
+    }
+
+private:
+    static uint64_t nextId() {
+        static std::atomic<uint64_t> next{0};
+        return ++next;
+    }
+
+    /// Used by the handles to tell which registry they belong to (the
+    /// address may be reused by a later instance)
+    const uint64_t id = nextId();
+    mutable std::mutex mutex;
+    std::vector<EntryPtr> entries;
+};
+
+} // namespace cb
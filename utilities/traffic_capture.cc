@@ -0,0 +1,160 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "traffic_capture.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace cb {
+namespace capture {
+
+static const char Magic[8] = {'M', 'C', 'C', 'A', 'P', '0', '0', '1'};
+
+/// Size of the fixed part of a record (timestamp, connection and length)
+static const size_t RecordHeaderSize = 16;
+
+/// Records larger than this are considered corrupt by the Reader
+static const size_t MaxFrameSize = 30 * 1024 * 1024;
+
+static void encode(uint8_t* dest, uint64_t value, size_t bytes) {
+    for (size_t ii = 0; ii < bytes; ++ii) {
+        dest[ii] = uint8_t(value >> (8 * (bytes - ii - 1)));
+    }
+}
+
+static uint64_t decode(const uint8_t* src, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t ii = 0; ii < bytes; ++ii) {
+        value = (value << 8) | src[ii];
+    }
+    return value;
+}
+
+Writer::Writer(const std::string& path, size_t maxSize)
+    : path(path),
+      maxSize(maxSize),
+      start(std::chrono::steady_clock::now()),
+      file(fopen(path.c_str(), "wb")) {
+    if (file == nullptr) {
+        throw std::system_error(
+                errno,
+                std::system_category(),
+                "cb::capture::Writer: failed to create " + path);
+    }
+    if (fwrite(Magic, sizeof(Magic), 1, file) != 1) {
+        const auto error = errno;
+        fclose(file);
+        throw std::system_error(error,
+                                std::system_category(),
+                                "cb::capture::Writer: failed to write " + path);
+    }
+    size = sizeof(Magic);
+}
+
+Writer::~Writer() {
+    fclose(file);
+}
+
+bool Writer::write(uint32_t connection, cb::const_byte_buffer frame) {
+    const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+    uint8_t header[RecordHeaderSize];
+    encode(header, timestamp.count(), 8);
+    encode(header + 8, connection, 4);
+    encode(header + 12, frame.size(), 4);
+
+    std::lock_guard<std::mutex> guard(mutex);
+    if (full) {
+        return false;
+    }
+    if (size + sizeof(header) + frame.size() > maxSize) {
+        full = true;
+        fflush(file);
+        return false;
+    }
+    if (fwrite(header, sizeof(header), 1, file) != 1 ||
+        (!frame.empty() && fwrite(frame.data(), frame.size(), 1, file) != 1)) {
+        full = true;
+        return false;
+    }
+    size += sizeof(header) + frame.size();
+    ++records;
+    return true;
+}
+
+uint64_t Writer::getRecords() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return records;
+}
+
+size_t Writer::getSize() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return size;
+}
+
+bool Writer::isFull() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return full;
+}
+
+Reader::Reader(const std::string& path) : file(fopen(path.c_str(), "rb")) {
+    if (file == nullptr) {
+        throw std::system_error(errno,
+                                std::system_category(),
+                                "cb::capture::Reader: failed to open " + path);
+    }
+    char magic[sizeof(Magic)];
+    if (fread(magic, sizeof(magic), 1, file) != 1 ||
+        memcmp(magic, Magic, sizeof(Magic)) != 0) {
+        fclose(file);
+        throw std::runtime_error("cb::capture::Reader: " + path +
+                                 " is not a capture file");
+    }
+}
+
+Reader::~Reader() {
+    fclose(file);
+}
+
+bool Reader::next(Record& record) {
+    uint8_t header[RecordHeaderSize];
+    const auto nr = fread(header, 1, sizeof(header), file);
+    if (nr == 0 && feof(file)) {
+        return false;
+    }
+    if (nr != sizeof(header)) {
+        throw std::runtime_error("cb::capture::Reader: truncated record");
+    }
+
+    record.timestamp = std::chrono::nanoseconds(decode(header, 8));
+    record.connection = uint32_t(decode(header + 8, 4));
+    const auto length = size_t(decode(header + 12, 4));
+    if (length > MaxFrameSize) {
+        throw std::runtime_error("cb::capture::Reader: invalid frame length " +
+                                 std::to_string(length));
+    }
+    record.frame.resize(length);
+    if (length && fread(record.frame.data(), length, 1, file) != 1) {
+        throw std::runtime_error("cb::capture::Reader: truncated frame");
+    }
+    return true;
+}
+
+} // namespace capture
+} // namespace cb
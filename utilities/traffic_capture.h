@@ -0,0 +1,135 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/sized_buffer.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * The file format used to capture the request frames received by memcached
+ * (so they may be replayed by mcreplay).
+ *
+ * A capture file starts with the 8 byte magic "MCCAP001", followed by one
+ * record per request frame:
+ *
+ *     uint64_t timestamp  nanoseconds since the capture was started
+ *     uint32_t connection the (server) id of the connection
+ *     uint32_t length     length of the frame
+ *     uint8_t  frame[length] the request (header, extras, key and value)
+ *
+ * All integers are stored in network byte order.
+ */
+namespace cb {
+namespace capture {
+
+/// A request frame read from a capture file
+struct Record {
+    std::chrono::nanoseconds timestamp;
+    uint32_t connection;
+    std::vector<uint8_t> frame;
+};
+
+/**
+ * Writes a capture file. Thread safe; records are appended in the order
+ * they're added. Once the file reaches its maximum size further records are
+ * discarded.
+ */
+class Writer {
+public:
+    /**
+     * Create the capture file (replacing any existing file).
+     *
+     * @param path name of the file to create
+     * @param maxSize the maximum size of the file in bytes
+     * @throws std::system_error if the file cannot be created
+     */
+    Writer(const std::string& path, size_t maxSize);
+    ~Writer();
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    /**
+     * Append a request frame.
+     *
+     * @return false if the frame was discarded because the file has reached
+     *         its maximum size (or a write failed)
+     */
+    bool write(uint32_t connection, cb::const_byte_buffer frame);
+
+    const std::string& getPath() const {
+        return path;
+    }
+
+    /// @return the number of records written
+    uint64_t getRecords() const;
+
+    /// @return the number of bytes written
+    size_t getSize() const;
+
+    /// @return true if frames are being discarded
+    bool isFull() const;
+
+private:
+    const std::string path;
+    const size_t maxSize;
+    const std::chrono::steady_clock::time_point start;
+
+    mutable std::mutex mutex;
+    FILE* file;
+    size_t size = 0;
+    uint64_t records = 0;
+    bool full = false;
+};
+
+/**
+ * Reads the records of a capture file.
+ */
+class Reader {
+public:
+    /**
+     * Open the capture file.
+     *
+     * @throws std::system_error if the file cannot be opened
+     * @throws std::runtime_error if it isn't a capture file
+     */
+    explicit Reader(const std::string& path);
+    ~Reader();
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    /**
+     * Read the next record.
+     *
+     * @return false at the end of the file
+     * @throws std::runtime_error if the file is truncated or corrupt
+     */
+    bool next(Record& record);
+
+private:
+    FILE* file;
+};
+
+} // namespace capture
+} // namespace cb
@@ -24,11 +24,19 @@
 
 #include <memcached/util.h>
 #include <memcached/config_parser.h>
+#include "json_validator.h"
 #include "string_utilities.h"
+#include "thread_ring_registry.h"
+#include "traffic_capture.h"
 
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
 TEST(StringTest, safe_strtoul) {
     uint32_t val;
     EXPECT_TRUE(safe_strtoul("123", val));
@@ -467,3 +475,190 @@ TEST(ConfigParserTest, A) {
     EXPECT_EQ(0, fclose(error));
     cb::io::rmrf(outfile);
 }
+
+TEST(JsonValidatorTest, FastPathAcceptsValidContainers) {
+    const std::vector<std::string> documents = {
+            "{}",
+            "[]",
+            " { \"a\" : [1, -2.5e+3, 0.5E-1, true, false, null] }\n",
+            R"({"k":"\"\\\/\b\f\n\r\té"})",
+            "[\"" + std::string(100, 'x') + "\"]",
+            "[\"caf\xc3\xa9 \xe6\x97\xa5 \xf0\x9f\x98\x80\"]",
+            R"({"a":{"b":{"c":[[],{}]}}})"};
+    for (const auto& json : documents) {
+        EXPECT_TRUE(cb::JsonValidator::isValidFastPath(
+                reinterpret_cast<const uint8_t*>(json.data()), json.size()))
+                << json;
+        EXPECT_TRUE(cb::JsonValidator().validate(cb::const_char_buffer(json)))
+                << json;
+    }
+}
+
+TEST(JsonValidatorTest, FastPathRejectsInvalid) {
+    const std::vector<std::string> documents = {
+            "",
+            "{",
+            "{\"a\"}",
+            "{\"a\":1,}",
+            "[1,]",
+            "[01]",
+            "[1.]",
+            "[.5]",
+            "[tru]",
+            "{} {}",
+            R"(["\x"])",
+            R"(["\u12G4"])",
+            "[\"" + std::string(40, 'x') + "\x01\"]",
+            "[\"" + std::string(40, 'x') + "\xff\"]",
+            // Overlong, surrogate, above U+10FFFF and truncated sequences
+            "[\"\xc0\xaf\"]",
+            "[\"\xed\xa0\x80\"]",
+            "[\"\xf4\x90\x80\x80\"]",
+            "[\"\xc3\"]"};
+    for (const auto& json : documents) {
+        EXPECT_FALSE(cb::JsonValidator::isValidFastPath(
+                reinterpret_cast<const uint8_t*>(json.data()), json.size()))
+                << json;
+        EXPECT_FALSE(cb::JsonValidator().validate(cb::const_char_buffer(json)))
+                << json;
+    }
+}
+
+TEST(JsonValidatorTest, FallbackDecidesOtherDocuments) {
+    // Top level scalars aren't handled by the fast path, but are still
+    // identified as JSON
+    for (const std::string json : {"1", "\"string\"", "true"}) {
+        EXPECT_FALSE(cb::JsonValidator::isValidFastPath(
+                reinterpret_cast<const uint8_t*>(json.data()), json.size()))
+                << json;
+        EXPECT_TRUE(cb::JsonValidator().validate(cb::const_char_buffer(json)))
+                << json;
+        EXPECT_TRUE(cb::isValidJson(
+                reinterpret_cast<const uint8_t*>(json.data()), json.size()))
+                << json;
+    }
+
+    // Neither are documents nested deeper than MaxFastPathDepth
+    const auto depth = cb::JsonValidator::MaxFastPathDepth + 1;
+    const auto deep = std::string(depth, '[') + std::string(depth, ']');
+    EXPECT_FALSE(cb::JsonValidator::isValidFastPath(
+            reinterpret_cast<const uint8_t*>(deep.data()), deep.size()));
+}
+
+TEST(TrafficCaptureTest, RoundTrip) {
+    const auto file = cb::io::mktemp("util_test");
+    const std::vector<uint8_t> frame1 = {0x80, 0x00, 0x00, 0x01};
+    const std::vector<uint8_t> frame2(1024, 0xff);
+    {
+        cb::capture::Writer writer(file, 1024 * 1024);
+        EXPECT_TRUE(writer.write(1, {frame1.data(), frame1.size()}));
+        EXPECT_TRUE(writer.write(7, {frame2.data(), frame2.size()}));
+        EXPECT_EQ(2, writer.getRecords());
+    }
+
+    cb::capture::Reader reader(file);
+    cb::capture::Record record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(1, record.connection);
+    EXPECT_EQ(frame1, record.frame);
+    const auto first = record.timestamp;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(7, record.connection);
+    EXPECT_EQ(frame2, record.frame);
+    EXPECT_LE(first, record.timestamp);
+    EXPECT_FALSE(reader.next(record));
+    cb::io::rmrf(file);
+}
+
+TEST(TrafficCaptureTest, MaxSize) {
+    const auto file = cb::io::mktemp("util_test");
+    const std::vector<uint8_t> frame(100, 0x80);
+    {
+        // Room for the magic and a single record
+        cb::capture::Writer writer(file, 8 + 16 + frame.size());
+        EXPECT_TRUE(writer.write(1, {frame.data(), frame.size()}));
+        EXPECT_FALSE(writer.isFull());
+        EXPECT_FALSE(writer.write(1, {frame.data(), frame.size()}));
+        EXPECT_TRUE(writer.isFull());
+        EXPECT_EQ(1, writer.getRecords());
+    }
+
+    cb::capture::Reader reader(file);
+    cb::capture::Record record;
+    EXPECT_TRUE(reader.next(record));
+    EXPECT_FALSE(reader.next(record));
+    cb::io::rmrf(file);
+}
+
+TEST(TrafficCaptureTest, NotACaptureFile) {
+    const auto file = cb::io::mktemp("util_test");
+    EXPECT_THROW(cb::capture::Reader reader(file), std::runtime_error);
+    cb::io::rmrf(file);
+}
+
+/// A ring which is empty once its counter is back at zero
+struct TestRing {
+    bool empty() const {
+        return queued == 0;
+    }
+    std::atomic<int> queued{0};
+};
+
+using TestRingRegistry = cb::ThreadRingRegistry<TestRing>;
+
+// The ring of a thread is freed once the thread exited and the ring is
+// drained (and not before).
+TEST(ThreadRingRegistryTest, RingIsReclaimedAfterThreadExit) {
+    TestRingRegistry registry;
+    std::thread producer([&registry]() {
+        TestRingRegistry::Handle handle;
+        EXPECT_EQ(nullptr, handle.get(registry));
+        auto& ring = registry.add(handle);
+        EXPECT_EQ(&ring, handle.get(registry));
+        ring.queued = 1;
+    });
+    producer.join();
+    ASSERT_EQ(1, registry.size());
+
+    // Still holding an entry, so it may not be freed
+    EXPECT_EQ(0, registry.reap());
+    auto rings = registry.getRings();
+    ASSERT_EQ(1, rings.size());
+    rings.front()->ring.queued = 0;
+    EXPECT_EQ(1, registry.reap());
+    EXPECT_EQ(0, registry.size());
+    // The consumer's reference stays valid
+    EXPECT_TRUE(rings.front()->ring.empty());
+}
+
+// A ring owned by a running thread is kept while it is empty
+TEST(ThreadRingRegistryTest, LiveRingIsKept) {
+    TestRingRegistry registry;
+    TestRingRegistry::Handle handle;
+    registry.add(handle);
+    EXPECT_EQ(0, registry.reap());
+    EXPECT_EQ(1, registry.size());
+    handle.reset();
+    EXPECT_EQ(nullptr, handle.get(registry));
+    EXPECT_EQ(1, registry.reap());
+}
+
+// A handle only returns the ring of the registry it was added to, and
+// switching to another registry retires the old ring
+TEST(ThreadRingRegistryTest, HandleBelongsToOneRegistry) {
+    TestRingRegistry first;
+    TestRingRegistry::Handle handle;
+    first.add(handle);
+    {
+        TestRingRegistry second;
+        EXPECT_EQ(nullptr, handle.get(second));
+        auto& ring = second.add(handle);
+        EXPECT_EQ(&ring, handle.get(second));
+        EXPECT_EQ(nullptr, handle.get(first));
+        EXPECT_EQ(1, first.reap());
+    }
+    // The ring outlived the registry it was added to, and is freed with
+    // the handle
+    EXPECT_EQ(nullptr, handle.get(first));
+    handle.reset();
+}
@@ -24,13 +24,16 @@
 #include <arpa/inet.h>
 #endif
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 namespace cb {
 namespace xattr {
 
 Blob::Blob(const Blob& other)
-    : allocator(default_allocator),
+    : index(other.index),
+      indexed(other.indexed),
+      allocator(default_allocator),
       alloc_size(other.blob.size()) {
     decompressed.resize(other.decompressed.size());
     std::copy_n(other.decompressed.data(),
@@ -50,6 +53,7 @@ Blob::Blob(cb::char_buffer buffer,
 }
 
 Blob& Blob::assign(cb::char_buffer buffer, bool compressed) {
+    resetIndex();
     if (compressed && buffer.size()) {
         // inflate and attach blob to the compression::buffer
         if (!cb::compression::inflate(
@@ -84,50 +88,83 @@ Blob& Blob::assign(cb::char_buffer buffer, bool compressed) {
     return *this;
 }
 
-cb::char_buffer Blob::get(const cb::const_char_buffer& key) const {
+const std::vector<Blob::IndexEntry>& Blob::getIndex() const {
+    if (indexed) {
+        return index;
+    }
+
     try {
         size_t current = 4;
         while (current < blob.len) {
             // Get the length of the next kv-pair
             const auto size = read_length(current);
             current += 4;
-            if (size > key.len) {
-                // This may be the next key
-                if (blob.buf[current + key.len] == '\0' &&
-                    std::memcmp(blob.buf + current, key.buf, key.len) == 0) {
-                    // Yay this is the key!!!
-                    auto* value = blob.buf + current + key.len + 1;
-                    return {value, strlen(value)};
-                } else {
-                    // jump to the next key!!
-                    current += size;
-                }
-            } else {
-                current += size;
+            if (current + size > blob.len) {
+                break;
             }
+            const auto* key = blob.buf + current;
+            const auto keylen = size_t(std::find(key, key + size, '\0') - key);
+            if (keylen + 2 > size) {
+                break;
+            }
+            index.push_back({uint32_t(current),
+                             uint32_t(keylen),
+                             uint32_t(size - keylen - 2)});
+            current += size;
         }
     } catch (const std::out_of_range&) {
     }
+    indexed = true;
+    return index;
+}
+
+cb::char_buffer Blob::get(const cb::const_char_buffer& key) const {
+    for (const auto& entry : getIndex()) {
+        if (entry.keyLength == key.len &&
+            std::memcmp(blob.buf + entry.offset, key.buf, key.len) == 0) {
+            return {blob.buf + entry.offset + key.len + 1, entry.valueLength};
+        }
+    }
 
     // Not found!
     return {nullptr, 0};
 }
 
 void Blob::prune_user_keys() {
+    if (blob.len == 0) {
+        return;
+    }
+
+    // Move the system kv-pairs down over the user ones in a single pass
+    // (rather than moving the rest of the blob for every user key)
+    size_t current = 4;
+    size_t next = 4;
     try {
-        size_t current = 4;
         while (current < blob.len) {
             // Get the length of the next kv-pair
-            const auto size = read_length(current);
-
-            if (blob.buf[current + 4] != '_') {
-                remove_segment(current, size + 4);
-            } else {
-                current += 4 + size;
+            const size_t size = read_length(current) + 4;
+            if (current + size > blob.len) {
+                break;
             }
+            if (blob.buf[current + 4] == '_') {
+                std::memmove(blob.buf + next, blob.buf + current, size);
+                next += size;
+            }
+            current += size;
         }
     } catch (const std::out_of_range&) {
     }
+    // Keep anything we couldn't parse
+    std::memmove(blob.buf + next, blob.buf + current, blob.len - current);
+    blob.len = next + (blob.len - current);
+
+    if (blob.len == 4) {
+        // the last xattr removed... we could just nuke it..
+        blob.len = 0;
+    } else {
+        write_length(0, gsl::narrow<uint32_t>(blob.len) - 4);
+    }
+    resetIndex();
 }
 
 void Blob::remove(const cb::const_char_buffer& key) {
@@ -181,6 +218,7 @@ void Blob::set(const cb::const_char_buffer& key,
             allocator.swap(temp);
             blob = {allocator.get(), newsize - 4 - key.len - 1 - value.len - 1};
             alloc_size = newsize;
+            removeFromIndex(old_offset, old_kv_size);
         }
 
         append_kvpair(key, value);
@@ -230,9 +268,33 @@ void Blob::append_kvpair(const cb::const_char_buffer& key,
 
     grow_buffer(gsl::narrow<uint32_t>(needed));
     write_kvpair(offset, key, value);
+    if (indexed) {
+        index.push_back({uint32_t(offset + 4),
+                         uint32_t(key.len),
+                         uint32_t(value.len)});
+    }
+}
+
+void Blob::removeFromIndex(size_t offset, size_t size) {
+    if (!indexed) {
+        return;
+    }
+    auto iter = std::find_if(
+            index.begin(), index.end(), [offset](const IndexEntry& entry) {
+                return entry.offset == offset + 4;
+            });
+    if (iter == index.end()) {
+        resetIndex();
+        return;
+    }
+    iter = index.erase(iter);
+    for (; iter != index.end(); ++iter) {
+        iter->offset -= uint32_t(size);
+    }
 }
 
 void Blob::remove_segment(const size_t offset, const size_t size) {
+    removeFromIndex(offset, size);
     if (offset + size == blob.len) {
         // No need to do anyting as this was the last thing in our blob..
         // just change the length
@@ -286,17 +348,11 @@ size_t Blob::get_system_size() const {
     // The global length field should be calculated as part of the
     // system xattr's
     size_t ret = 4;
-    try {
-        size_t current = 4;
-        while (current < blob.len) {
-            // Get the length of the next kv-pair
-            const auto size = read_length(current);
-            if (blob.buf[current + 4] == '_') {
-                ret += size + 4;
-            }
-            current += 4 + size;
+    for (const auto& entry : getIndex()) {
+        if (blob.buf[entry.offset] == '_') {
+            // length word, key, value and their terminators
+            ret += 4 + entry.keyLength + entry.valueLength + 2;
         }
-    } catch (const std::out_of_range&) {
     }
 
     return ret;